@@ -53,7 +53,7 @@ static CTxIn MineBlock(const CScript& coinbase_scriptPubKey)
 }
 
 
-static void AssembleBlock(benchmark::State& state)
+static void RunAssembleBlock(benchmark::State& state, bool prepared)
 {
     const std::vector<unsigned char> op_true{OP_TRUE};
     CScriptWitness witness;
@@ -111,8 +111,16 @@ static void AssembleBlock(benchmark::State& state)
         }
     }
 
-    while (state.KeepRunning()) {
-        PrepareBlock(SCRIPT_PUB);
+    if (prepared) {
+        // Selection of an unchanged mempool, as done by the staker ahead of a stake hit
+        BlockAssembler{Params()}.PrepareNextBlock();
+        while (state.KeepRunning()) {
+            BlockAssembler{Params()}.PrepareNextBlock();
+        }
+    } else {
+        while (state.KeepRunning()) {
+            PrepareBlock(SCRIPT_PUB);
+        }
     }
 
     thread_group.interrupt_all();
@@ -121,4 +129,15 @@ static void AssembleBlock(benchmark::State& state)
     GetMainSignals().UnregisterBackgroundSignalScheduler();
 }
 
+static void AssembleBlock(benchmark::State& state)
+{
+    RunAssembleBlock(state, false);
+}
+
+static void AssembleBlockPrepared(benchmark::State& state)
+{
+    RunAssembleBlock(state, true);
+}
+
 BENCHMARK(AssembleBlock, 700);
+BENCHMARK(AssembleBlockPrepared, 700);
@@ -0,0 +1,178 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <fs.h>
+#include <governance/governance.h>
+#include <index/txindex.h>
+#include <scheduler.h>
+#include <script/sigcache.h>
+#include <servicenode/servicenodemgr.h>
+#include <txdb.h>
+#include <util/memory.h>
+#include <util/system.h>
+#include <util/time.h>
+#include <validation.h>
+#include <validationinterface.h>
+
+#include <cstdio>
+#include <iostream>
+
+#include <boost/thread.hpp>
+
+/** Time spent in the BlockConnected callbacks of the subscriber since it was registered */
+static int64_t BlockConnectedMicros(const std::string & subscriber)
+{
+    for (const auto & stats : GetMainSignals().GetSubscriberStats()) {
+        if (stats.name != subscriber)
+            continue;
+        for (const auto & callback : stats.callbacks) {
+            if (callback.first == "BlockConnected")
+                return callback.second.run_micros;
+        }
+    }
+    return 0;
+}
+
+static void PrintStage(const std::string & stage, const int64_t micros, const int64_t blocks)
+{
+    std::cerr << strprintf("#   %-26s %10.2fs %10.3fms/blk", stage, micros * 0.000001,
+                           blocks > 0 ? micros * 0.001 / blocks : 0.0) << std::endl;
+}
+
+/**
+ * Imports a recording of mainnet blocks into an empty chain state in the datadir of the
+ * benchmark and connects them. The recording is a blocks file in the format of the blk*.dat
+ * files of the datadir or of contrib/linearize, starting at the genesis block, passed with
+ * -replayblocks=<file>. The benchmark is skipped without it. Ranges with superblocks and
+ * busy voting periods give the most realistic numbers. The blocks can only be imported
+ * once, run it with -evals=1.
+ *
+ * Scripts are checked for all blocks (no assumevalid). The time of each stage of connecting
+ * the blocks is written to stderr.
+ */
+static void ReplayMainnetBlocks(benchmark::State& state)
+{
+    const std::string path = gArgs.GetArg("-replayblocks", "");
+    if (path.empty())
+        return;
+
+    SelectParams(CBaseChainParams::MAIN);
+    const CChainParams& chainparams = Params();
+    hashAssumeValid = uint256();
+
+    InitSignatureCache();
+    InitScriptExecutionCache();
+
+    boost::thread_group thread_group;
+    CScheduler scheduler;
+    thread_group.create_thread(std::bind(&CScheduler::serviceQueue, &scheduler));
+    GetMainSignals().RegisterBackgroundSignalScheduler(scheduler);
+    GetMainSignals().RegisterWithMempoolSignals(mempool);
+
+    // Default cache sizes of the node
+    const int64_t nCoinDBCache = nDefaultDbCache << 19;
+    {
+        LOCK(cs_main);
+        ::pblocktree.reset(new CBlockTreeDB(1 << 23, false, true));
+        ::pcoinsdbview.reset(new CCoinsViewDB(nCoinDBCache, false, true));
+        ::pcoinsTip.reset(new CCoinsViewCache(pcoinsdbview.get()));
+        nCoinCacheUsage = (nDefaultDbCache << 20) - nCoinDBCache;
+    }
+    // Blocknet PoS requires txindex
+    g_txindex = MakeUnique<TxIndex>(nMaxTxIndexCache << 20, false, true);
+    g_txindex->Start();
+
+    std::string failReason;
+    gov::Governance::instance().openCheckpoint(gov::GOVERNANCE_DB_CACHE, false, true);
+    gov::Governance::instance().loadGovernanceData(chainActive, cs_main, chainparams.GetConsensus(), failReason);
+    // The callbacks of the subscribers are timed by the validation interface
+    RegisterValidationInterface(&gov::Governance::instance());
+    RegisterValidationInterface(&sn::ServiceNodeMgr::instance());
+
+    {
+        bool loaded = LoadGenesisBlock(chainparams);
+        assert(loaded);
+        CValidationState validationState;
+        bool activated = ActivateBestChain(validationState, chainparams);
+        assert(activated);
+    }
+
+    int64_t nTimeImport{0};
+    int64_t nTimeActivate{0};
+    int64_t nTimeFlushState{0};
+    int64_t nTimeCallbacks{0};
+    const ConnectBlockTimes start = GetConnectBlockTimes();
+
+    bool imported{false};
+    while (state.KeepRunning()) {
+        if (imported)
+            break;
+        imported = true;
+
+        FILE *file = fsbridge::fopen(path, "rb");
+        if (!file) {
+            std::cerr << "Could not open blocks file " << path << std::endl;
+            break;
+        }
+        const int64_t nTime1 = GetTimeMicros();
+        LoadExternalBlockFile(chainparams, file); // closes the file
+        const int64_t nTime2 = GetTimeMicros();
+        CValidationState validationState;
+        bool activated = ActivateBestChain(validationState, chainparams);
+        assert(activated);
+        const int64_t nTime3 = GetTimeMicros();
+        SyncWithValidationInterfaceQueue();
+        const int64_t nTime4 = GetTimeMicros();
+        FlushStateToDisk();
+        const int64_t nTime5 = GetTimeMicros();
+        nTimeImport = nTime2 - nTime1;
+        nTimeActivate = nTime3 - nTime2;
+        nTimeCallbacks = nTime4 - nTime3;
+        nTimeFlushState = nTime5 - nTime4;
+    }
+
+    const ConnectBlockTimes end = GetConnectBlockTimes();
+    const int64_t blocks = end.blocks - start.blocks;
+    {
+        LOCK(cs_main);
+        std::cerr << "# ReplayMainnetBlocks: connected " << blocks << " blocks, tip height " << chainActive.Height() << std::endl;
+    }
+    PrintStage("import (read, accept)", nTimeImport, blocks);
+    PrintStage("activate", nTimeActivate, blocks);
+    PrintStage("- PoS stake checks", end.stake - start.stake, blocks);
+    PrintStage("- other sanity checks", (end.checks - start.checks) - (end.stake - start.stake), blocks);
+    PrintStage("- connect transactions", end.connect - start.connect, blocks);
+    PrintStage("- scripts", (end.verify - start.verify) - (end.connect - start.connect), blocks);
+    PrintStage("- utxo flush to tip", end.flush - start.flush, blocks);
+    PrintStage("- utxo flush to disk", end.chainstate - start.chainstate, blocks);
+    PrintStage("governance processBlock", BlockConnectedMicros("governance"), blocks);
+    PrintStage("servicenode callbacks", BlockConnectedMicros("servicenodes"), blocks);
+    PrintStage("callback queue drain", nTimeCallbacks, blocks);
+    PrintStage("final utxo flush", nTimeFlushState, blocks);
+
+    UnregisterValidationInterface(&sn::ServiceNodeMgr::instance());
+    UnregisterValidationInterface(&gov::Governance::instance());
+    gov::Governance::instance().closeCheckpoint();
+    g_txindex->Stop();
+    g_txindex.reset();
+
+    thread_group.interrupt_all();
+    thread_group.join_all();
+    GetMainSignals().FlushBackgroundCallbacks();
+    GetMainSignals().UnregisterBackgroundSignalScheduler();
+    GetMainSignals().UnregisterWithMempoolSignals(mempool);
+    {
+        LOCK(cs_main);
+        UnloadBlockIndex();
+        ::pcoinsTip.reset();
+        ::pcoinsdbview.reset();
+        ::pblocktree.reset();
+    }
+}
+
+BENCHMARK(ReplayMainnetBlocks, 1);
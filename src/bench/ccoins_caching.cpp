@@ -86,3 +86,31 @@ static void CCoinsCaching(benchmark::State& state)
 }
 
 BENCHMARK(CCoinsCaching, 170 * 1000);
+
+// Fills a coins map like a cache filled during block connection and releases it like
+// Flush does, with heap allocated nodes or with nodes from the cache memory pool.
+static void CCoinsMapFill(benchmark::State& state, bool pooled)
+{
+    std::vector<COutPoint> outpoints;
+    outpoints.reserve(10000);
+    for (uint32_t i = 0; i < 10000; ++i)
+        outpoints.emplace_back(uint256S(std::to_string(i / 4)), i % 4);
+
+    while (state.KeepRunning()) {
+        CCoinsMapMemoryResource resource;
+        CCoinsMap map(0, SaltedOutpointHasher(), CCoinsMap::key_equal(), pooled ? &resource : nullptr);
+        for (const COutPoint& outpoint : outpoints) {
+            CCoinsCacheEntry& entry = map[outpoint];
+            entry.coin.out.nValue = COIN;
+            entry.coin.nHeight = 1;
+        }
+        for (const COutPoint& outpoint : outpoints)
+            assert(map.count(outpoint));
+    }
+}
+
+static void CCoinsMapFillHeap(benchmark::State& state) { CCoinsMapFill(state, false); }
+static void CCoinsMapFillPool(benchmark::State& state) { CCoinsMapFill(state, true); }
+
+BENCHMARK(CCoinsMapFillHeap, 100);
+BENCHMARK(CCoinsMapFillPool, 100);
@@ -0,0 +1,42 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+
+#include <coinvalidator.h>
+#include <random.h>
+
+#include <vector>
+
+// Checks the prevouts of a block's 1000 inputs against the static infractions list, one of the
+// inputs is an infraction.
+static void CoinValidatorIsCoinValid(benchmark::State& state)
+{
+    CoinValidator validator;
+    validator.LoadStatic();
+    std::vector<uint256> txids(999);
+    for (auto& txid : txids)
+        txid = GetRandHash();
+    txids.push_back(uint256S("00c0a0a887c2663e563494bd87f0ce279698d3e4f60fa3c5c39893f7fce8c336"));
+    uint64_t invalid{0}, rounds{0};
+    while (state.KeepRunning()) {
+        for (const auto& txid : txids)
+            invalid += !validator.IsCoinValid(txid);
+        ++rounds;
+    }
+    assert(invalid == rounds);
+}
+
+BENCHMARK(CoinValidatorIsCoinValid, 20 * 1000);
+
+// Parses the static infractions list, done once at startup.
+static void CoinValidatorLoadStatic(benchmark::State& state)
+{
+    while (state.KeepRunning()) {
+        CoinValidator validator;
+        validator.LoadStatic();
+    }
+}
+
+BENCHMARK(CoinValidatorLoadStatic, 20);
@@ -61,6 +61,19 @@ static void SHA256D64_1024(benchmark::State& state)
     }
 }
 
+static void SHA256DMulti_1024(benchmark::State& state)
+{
+    std::vector<uint8_t> in(150 * 1024, 0);
+    std::vector<uint8_t> out(32 * 1024);
+    std::vector<const unsigned char*> inputs(1024);
+    std::vector<size_t> sizes(1024, 150);
+    for (size_t i = 0; i < inputs.size(); ++i)
+        inputs[i] = in.data() + 150 * i;
+    while (state.KeepRunning()) {
+        SHA256DMulti(out.data(), inputs.data(), sizes.data(), 1024);
+    }
+}
+
 static void SHA512(benchmark::State& state)
 {
     uint8_t hash[CSHA512::OUTPUT_SIZE];
@@ -102,5 +115,6 @@ BENCHMARK(SHA512, 330);
 BENCHMARK(SHA256_32b, 4700 * 1000);
 BENCHMARK(SipHash_32b, 40 * 1000 * 1000);
 BENCHMARK(SHA256D64_1024, 7400);
+BENCHMARK(SHA256DMulti_1024, 2500);
 BENCHMARK(FastRandom_32bit, 110 * 1000 * 1000);
 BENCHMARK(FastRandom_1bit, 440 * 1000 * 1000);
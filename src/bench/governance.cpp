@@ -0,0 +1,110 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+
+#include <chainparams.h>
+#include <coins.h>
+#include <governance/governance.h>
+#include <key.h>
+#include <random.h>
+#include <txdb.h>
+#include <util/memory.h>
+#include <validation.h>
+
+#include <vector>
+
+// Voters in the synthetic vote set and the voting utxos of each voter
+static const int GOV_BENCH_VOTERS = 200;
+static const int GOV_BENCH_VOTER_UTXOS = 20;
+
+// Exposes the block processing of the governance manager
+class BenchGovernance : public gov::Governance {
+public:
+    using gov::Governance::processBlock;
+};
+
+struct GovernanceBench {
+    uint256 proposal;
+    std::vector<gov::Vote> votes;
+    CBlock block; // one voting transaction per voter
+
+    GovernanceBench() {
+        SelectParams(CBaseChainParams::REGTEST);
+        const auto & consensus = Params().GetConsensus();
+        {
+            LOCK(cs_main);
+            ::pcoinsdbview.reset(new CCoinsViewDB(1 << 23, true));
+            ::pcoinsTip.reset(new CCoinsViewCache(pcoinsdbview.get()));
+        }
+        proposal = GetRandHash();
+        block.vtx.push_back(MakeTransactionRef(CMutableTransaction())); // coinbase placeholder
+
+        for (int i = 0; i < GOV_BENCH_VOTERS; ++i) {
+            CKey key;
+            key.MakeNewKey(true);
+            const CScript script = GetScriptForDestination(key.GetPubKey().GetID());
+            const uint256 fundingTx = GetRandHash();
+            const auto voteType = i % 3 == 0 ? gov::NO : gov::YES;
+            CMutableTransaction mtx;
+            for (int n = 0; n < GOV_BENCH_VOTER_UTXOS; ++n) {
+                const COutPoint utxo{fundingTx, static_cast<uint32_t>(n)};
+                {
+                    LOCK(cs_main);
+                    pcoinsTip->AddCoin(utxo, Coin(CTxOut(consensus.voteBalance, script), 1, false), false);
+                }
+                gov::Vote vote(proposal, voteType, utxo, gov::makeVinHash(utxo));
+                vote.sign(key);
+                votes.push_back(vote);
+
+                // Voting transactions spend the voting utxos, see Vote::isValid
+                mtx.vin.emplace_back(utxo);
+                CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+                ss << vote;
+                mtx.vout.emplace_back(0, CScript() << OP_RETURN << ToByteVector(ss));
+            }
+            block.vtx.push_back(MakeTransactionRef(mtx));
+        }
+    }
+
+    ~GovernanceBench() {
+        LOCK(cs_main);
+        ::pcoinsTip.reset();
+        ::pcoinsdbview.reset();
+    }
+};
+
+// Tallies a proposal with GOV_BENCH_VOTERS * GOV_BENCH_VOTER_UTXOS votes.
+static void GovernanceTally(benchmark::State& state)
+{
+    GovernanceBench bench;
+    const auto & consensus = Params().GetConsensus();
+    // Votes read from the block carry the outpoint of their voting transaction
+    auto governance = MakeUnique<BenchGovernance>();
+    governance->processBlock(&bench.block, nullptr, consensus, false);
+    const std::vector<gov::Vote> votes = governance->getVotes();
+    gov::Tally tally;
+    while (state.KeepRunning()) {
+        tally = gov::Governance::getTally(bench.proposal, votes, consensus);
+    }
+    assert(tally.cyes + tally.cno == consensus.voteBalance * GOV_BENCH_VOTERS * GOV_BENCH_VOTER_UTXOS);
+}
+
+// Loads the votes of a block with GOV_BENCH_VOTERS voting transactions into an empty governance
+// state. The vote keys are cached after the first round, like the keys of the votes prechecked
+// before a block is connected.
+static void GovernanceProcessBlock(benchmark::State& state)
+{
+    GovernanceBench bench;
+    const auto & consensus = Params().GetConsensus();
+    auto governance = MakeUnique<BenchGovernance>();
+    while (state.KeepRunning()) {
+        governance->reset();
+        governance->processBlock(&bench.block, nullptr, consensus, false);
+    }
+    assert(governance->getVotes().size() == bench.votes.size());
+}
+
+BENCHMARK(GovernanceTally, 50);
+BENCHMARK(GovernanceProcessBlock, 20);
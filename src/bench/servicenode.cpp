@@ -0,0 +1,126 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+
+#include <chain.h>
+#include <chainparams.h>
+#include <coins.h>
+#include <key.h>
+#include <random.h>
+#include <servicenode/servicenodemgr.h>
+#include <txdb.h>
+#include <util/memory.h>
+#include <validation.h>
+
+#include <vector>
+
+// Number of registered servicenodes
+static const int SNODE_BENCH_COUNT = 2000;
+
+// Exposes the registry and block processing of the servicenode manager
+class BenchServiceNodeMgr : public sn::ServiceNodeMgr {
+public:
+    using sn::ServiceNodeMgr::addSn;
+    using sn::ServiceNodeMgr::processValidationBlock;
+};
+
+struct ServiceNodeBench {
+    uint256 genesisHash;
+    CBlockIndex genesis;
+    std::vector<sn::ServiceNode> snodes;
+    std::vector<std::vector<unsigned char>> pings; // serialized, one per snode
+
+    ServiceNodeBench() {
+        SelectParams(CBaseChainParams::REGTEST);
+        genesisHash = Params().GenesisBlock().GetHash();
+        genesis.phashBlock = &genesisHash;
+        {
+            LOCK(cs_main);
+            ::pcoinsdbview.reset(new CCoinsViewDB(1 << 23, true));
+            ::pcoinsTip.reset(new CCoinsViewCache(pcoinsdbview.get()));
+            chainActive.SetTip(&genesis); // pings report the genesis block as their best block
+        }
+
+        const std::string config = R"({"xbridgeversion":50,"xrouterversion":50,"xbridge":["BLOCK","BTC","LTC"]})";
+        for (int i = 0; i < SNODE_BENCH_COUNT; ++i) {
+            CKey snodeKey, collateralKey;
+            snodeKey.MakeNewKey(true);
+            collateralKey.MakeNewKey(true);
+            const CKeyID paymentAddress = collateralKey.GetPubKey().GetID();
+            const std::vector<COutPoint> collateral{COutPoint(GetRandHash(), 0)};
+            {
+                LOCK(cs_main);
+                pcoinsTip->AddCoin(collateral[0], Coin(CTxOut(sn::ServiceNode::COLLATERAL_SPV,
+                        GetScriptForDestination(paymentAddress)), 1, false), false);
+            }
+            const uint256 sighash = sn::ServiceNode::CreateSigHash(snodeKey.GetPubKey(), sn::ServiceNode::SPV,
+                    paymentAddress, collateral, 0, genesisHash);
+            std::vector<unsigned char> signature;
+            collateralKey.SignCompact(sighash, signature);
+            sn::ServiceNode snode(snodeKey.GetPubKey(), sn::ServiceNode::SPV, paymentAddress, collateral, 0,
+                                  genesisHash, signature);
+            sn::ServiceNodePing ping(snodeKey.GetPubKey(), 0, genesisHash, static_cast<uint32_t>(GetTime()), config, snode);
+            ping.sign(snodeKey);
+            CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+            ss << ping;
+            pings.emplace_back(ss.begin(), ss.end());
+            snodes.push_back(ping.getSnode());
+        }
+    }
+
+    ~ServiceNodeBench() {
+        LOCK(cs_main);
+        chainActive.SetTip(nullptr);
+        ::pcoinsTip.reset();
+        ::pcoinsdbview.reset();
+    }
+};
+
+// Validates and registers the pings of SNODE_BENCH_COUNT SPV servicenodes in an empty registry.
+static void ServiceNodeProcessPings(benchmark::State& state)
+{
+    ServiceNodeBench bench;
+    auto smgr = MakeUnique<BenchServiceNodeMgr>();
+    while (state.KeepRunning()) {
+        smgr->reset();
+        for (const auto & data : bench.pings) {
+            CDataStream ss(data, SER_NETWORK, PROTOCOL_VERSION);
+            sn::ServiceNodePing ping;
+            bool processed = smgr->processPing(ss, ping);
+            assert(processed);
+        }
+    }
+}
+
+// Checks a block with 1000 transactions against SNODE_BENCH_COUNT registered servicenodes,
+// one in a hundred of the spent utxos is servicenode collateral.
+static void ServiceNodeValidationBlock(benchmark::State& state)
+{
+    ServiceNodeBench bench;
+    auto smgr = MakeUnique<BenchServiceNodeMgr>();
+    for (const auto & snode : bench.snodes)
+        smgr->addSn(snode, false);
+
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    CBlock block;
+    block.vtx.push_back(MakeTransactionRef(coinbase));
+    for (int i = 0; i < 1000; ++i) {
+        CMutableTransaction mtx;
+        for (int n = 0; n < 2; ++n)
+            mtx.vin.emplace_back(COutPoint(GetRandHash(), n));
+        if (i % 50 == 0)
+            mtx.vin.emplace_back(bench.snodes[i % bench.snodes.size()].getCollateral()[0]);
+        mtx.vout.emplace_back(COIN, CScript() << OP_TRUE);
+        block.vtx.push_back(MakeTransactionRef(mtx));
+    }
+    const auto pblock = std::make_shared<const CBlock>(block);
+    while (state.KeepRunning()) {
+        smgr->processValidationBlock(pblock, true, 1);
+    }
+}
+
+BENCHMARK(ServiceNodeProcessPings, 2);
+BENCHMARK(ServiceNodeValidationBlock, 500);
@@ -0,0 +1,173 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chainparams.h>
+#include <coins.h>
+#include <consensus/validation.h>
+#include <interfaces/chain.h>
+#include <kernel.h>
+#include <miner.h>
+#include <pow.h>
+#include <scheduler.h>
+#include <script/sign.h>
+#include <txdb.h>
+#include <util/time.h>
+#include <validation.h>
+#include <validationinterface.h>
+#include <wallet/wallet.h>
+
+#include <boost/thread.hpp>
+
+#include <vector>
+
+// Number of coins in the synthetic staking wallet
+static const int STAKING_BENCH_COINS = 1000;
+
+static void StakeHashV05(benchmark::State& state)
+{
+    CDataStream ss(SER_GETHASH, 0);
+    ss << static_cast<uint64_t>(0x1234567890abcdef);
+    unsigned int nTimeTx = 1569261600;
+    while (state.KeepRunning()) {
+        stakeHashV05(ss, 1569200000, 1000000, 1, nTimeTx++);
+    }
+}
+
+static void StakeKernelHasherV05(benchmark::State& state)
+{
+    const auto hasher = StakeKernelHasher::V05(0x1234567890abcdef, 1569200000, 1000000, 1);
+    unsigned int nTimeTx = 1569261600;
+    while (state.KeepRunning()) {
+        hasher(nTimeTx++);
+    }
+}
+
+static void StakeTargetHit(benchmark::State& state)
+{
+    arith_uint256 bnTargetPerCoinDay;
+    bnTargetPerCoinDay.SetCompact(0x1b0404cb);
+    uint256 hashProofOfStake = GetRandHash();
+    bool hit{false};
+    while (state.KeepRunning()) {
+        hit |= stakeTargetHit(hashProofOfStake, 5000 * COIN, bnTargetPerCoinDay);
+        *hashProofOfStake.begin() += 1;
+    }
+    (void)hit;
+}
+
+static CBlock MineStakingBenchBlock(const std::vector<CMutableTransaction>& txns, const CScript& scriptPubKey)
+{
+    const CChainParams& chainparams = Params();
+    SetMockTime(GetAdjustedTime() + chainparams.GetConsensus().nPowTargetSpacing); // prevent difficulty from increasing
+    std::unique_ptr<CBlockTemplate> pblocktemplate = BlockAssembler(chainparams).CreateNewBlock(scriptPubKey);
+    CBlock& block = pblocktemplate->block;
+    block.vtx.resize(1);
+    for (const CMutableTransaction& tx : txns)
+        block.vtx.push_back(MakeTransactionRef(tx));
+    {
+        LOCK(cs_main);
+        unsigned int extraNonce = 0;
+        IncrementExtraNonce(&block, chainActive.Tip(), extraNonce);
+    }
+    while (!CheckProofOfWork(block.GetHash(), block.nBits, chainparams.GetConsensus())) ++block.nNonce;
+    bool processed{ProcessNewBlock(chainparams, std::make_shared<const CBlock>(block), true, nullptr)};
+    assert(processed);
+    return block;
+}
+
+// Searches the stake window of a synthetic wallet with STAKING_BENCH_COINS mature coins.
+static void StakeMgrUpdate(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    InitScriptExecutionCache();
+    UnloadBlockIndex(); // start a new chain, only PoW blocks up to lastPOWBlock are accepted
+    SetMockTime(GetTime());
+
+    boost::thread_group thread_group;
+    CScheduler scheduler;
+    const CChainParams& chainparams = Params();
+    const Consensus::Params& consensus = chainparams.GetConsensus();
+    {
+        LOCK(cs_main);
+        ::pblocktree.reset(new CBlockTreeDB(1 << 20, true));
+        ::pcoinsdbview.reset(new CCoinsViewDB(1 << 23, true));
+        ::pcoinsTip.reset(new CCoinsViewCache(pcoinsdbview.get()));
+    }
+    {
+        thread_group.create_thread(std::bind(&CScheduler::serviceQueue, &scheduler));
+        GetMainSignals().RegisterBackgroundSignalScheduler(scheduler);
+        LoadGenesisBlock(chainparams);
+        CValidationState cvstate;
+        ActivateBestChain(cvstate, chainparams);
+        assert(::chainActive.Tip() != nullptr);
+    }
+
+    CKey key;
+    key.MakeNewKey(true);
+    CBasicKeyStore keystore;
+    keystore.AddKey(key);
+    const CScript scriptPubKey = CScript() << ToByteVector(key.GetPubKey()) << OP_CHECKSIG;
+
+    // Split a mature coinbase into the staking coins and let the coins mature
+    std::vector<CTransactionRef> coinbases;
+    for (int i = 0; i <= consensus.coinMaturity * 2 + 1; ++i) {
+        std::vector<CMutableTransaction> txs;
+        if (i == consensus.coinMaturity + 1) {
+            const auto& coinbase = coinbases[1];
+            CMutableTransaction mtx;
+            mtx.vin.resize(1);
+            mtx.vin[0] = CTxIn(COutPoint(coinbase->GetHash(), 0));
+            mtx.vout.resize(STAKING_BENCH_COINS);
+            for (auto& out : mtx.vout) {
+                out.scriptPubKey = scriptPubKey;
+                out.nValue = (coinbase->GetValueOut() - COIN) / STAKING_BENCH_COINS;
+            }
+            SignatureData sigdata = DataFromTransaction(mtx, 0, coinbase->vout[0]);
+            ProduceSignature(keystore, MutableTransactionSignatureCreator(&mtx, 0, coinbase->vout[0].nValue, SIGHASH_ALL), coinbase->vout[0].scriptPubKey, sigdata);
+            UpdateInput(mtx.vin[0], sigdata);
+            txs.push_back(mtx);
+        }
+        coinbases.push_back(MineStakingBenchBlock(txs, scriptPubKey).vtx[0]);
+    }
+
+    auto chain = interfaces::MakeChain();
+    auto wallet = std::make_shared<CWallet>(*chain, WalletLocation(), WalletDatabase::CreateDummy());
+    {
+        LOCK(wallet->cs_wallet);
+        wallet->AddKeyPubKey(key, key.GetPubKey());
+    }
+    {
+        WalletRescanReserver reserver(wallet.get());
+        reserver.reserve();
+        wallet->ScanForWalletTransactions(chainActive.Genesis()->GetBlockHash(), {}, reserver, true);
+    }
+    SetMockTime(GetAdjustedTime() + consensus.stakeMinAge + 1); // coins meet the stake min age
+
+    const CBlockIndex* tip = nullptr;
+    {
+        LOCK(cs_main);
+        tip = chainActive.Tip();
+    }
+    StakeMgr staker;
+    std::vector<std::shared_ptr<CWallet>> wallets{wallet};
+    while (state.KeepRunning()) {
+        staker.CoinsChanged(); // search the whole window again
+        staker.Update(wallets, tip, consensus, true);
+    }
+    assert(GetStakingStats().coinsSearched == static_cast<uint64_t>(STAKING_BENCH_COINS));
+
+    wallet.reset();
+    thread_group.interrupt_all();
+    thread_group.join_all();
+    GetMainSignals().FlushBackgroundCallbacks();
+    GetMainSignals().UnregisterBackgroundSignalScheduler();
+    UnloadBlockIndex();
+    SetMockTime(0);
+}
+
+BENCHMARK(StakeHashV05, 2 * 1000 * 1000);
+BENCHMARK(StakeKernelHasherV05, 4 * 1000 * 1000);
+BENCHMARK(StakeTargetHit, 10 * 1000 * 1000);
+BENCHMARK(StakeMgrUpdate, 20);
@@ -4,15 +4,22 @@
 
 #include <bench/bench.h>
 #include <key.h>
+#include <policy/policy.h>
+#include <random.h>
 #if defined(HAVE_CONSENSUS_LIB)
 #include <script/bitcoinconsensus.h>
 #endif
 #include <script/script.h>
 #include <script/sign.h>
 #include <script/standard.h>
+#include <sigbatch.h>
 #include <streams.h>
+#include <util/system.h>
 
 #include <array>
+#include <tuple>
+
+#include <boost/thread/thread.hpp>
 
 // FIXME: Dedup with BuildCreditingTransaction in test/script_tests.cpp.
 static CMutableTransaction BuildCreditingTransaction(const CScript& scriptPubKey)
@@ -106,4 +113,136 @@ static void VerifyScriptBench(benchmark::State& state)
     }
 }
 
+/** Accepts every signature, so the benchmarks below measure the script evaluation only. */
+class AcceptingSignatureChecker : public BaseSignatureChecker
+{
+public:
+    bool CheckSig(const std::vector<unsigned char>& scriptSig, const std::vector<unsigned char>& vchPubKey, const CScript& scriptCode, SigVersion sigversion) const override
+    {
+        return true;
+    }
+};
+
+static void BuildPayToPubKeyHash(CScript& scriptSig, CScript& scriptPubKey)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    const CPubKey pubkey = key.GetPubKey();
+    std::vector<unsigned char> sig;
+    key.Sign(GetRandHash(), sig);
+    sig.push_back(static_cast<unsigned char>(SIGHASH_ALL));
+    scriptPubKey = GetScriptForDestination(pubkey.GetID());
+    scriptSig = CScript() << sig << ToByteVector(pubkey);
+}
+
+// P2PKH spend through VerifyScript, which takes the standard template fast path.
+static void VerifyScriptP2PKHBench(benchmark::State& state)
+{
+    const unsigned int flags = STANDARD_SCRIPT_VERIFY_FLAGS;
+    CScript scriptSig, scriptPubKey;
+    BuildPayToPubKeyHash(scriptSig, scriptPubKey);
+    const AcceptingSignatureChecker checker;
+    while (state.KeepRunning()) {
+        ScriptError err;
+        bool success = VerifyScript(scriptSig, scriptPubKey, nullptr, flags, checker, &err);
+        assert(success);
+    }
+}
+
+// The same spend evaluated by the generic interpreter, as VerifyScript did before the fast path.
+static void EvalScriptP2PKHBench(benchmark::State& state)
+{
+    const unsigned int flags = STANDARD_SCRIPT_VERIFY_FLAGS;
+    CScript scriptSig, scriptPubKey;
+    BuildPayToPubKeyHash(scriptSig, scriptPubKey);
+    const AcceptingSignatureChecker checker;
+    while (state.KeepRunning()) {
+        ScriptError err;
+        std::vector<std::vector<unsigned char>> stack;
+        bool success = EvalScript(stack, scriptSig, flags, checker, SigVersion::BASE, &err) &&
+                       EvalScript(stack, scriptPubKey, flags, checker, SigVersion::BASE, &err);
+        assert(success && stack.size() == 1);
+    }
+}
+
+// 2-of-3 multisig P2SH spend, which VerifyScript leaves to the interpreter.
+static void VerifyScriptP2SHMultisigBench(benchmark::State& state)
+{
+    const unsigned int flags = STANDARD_SCRIPT_VERIFY_FLAGS;
+    std::vector<CPubKey> pubkeys;
+    CScript scriptSig = CScript() << OP_0;
+    for (int i = 0; i < 3; ++i) {
+        CKey key;
+        key.MakeNewKey(true);
+        pubkeys.push_back(key.GetPubKey());
+        if (i < 2) {
+            std::vector<unsigned char> sig;
+            key.Sign(GetRandHash(), sig);
+            sig.push_back(static_cast<unsigned char>(SIGHASH_ALL));
+            scriptSig << sig;
+        }
+    }
+    const CScript redeemScript = GetScriptForMultisig(2, pubkeys);
+    scriptSig << std::vector<unsigned char>(redeemScript.begin(), redeemScript.end());
+    const CScript scriptPubKey = GetScriptForDestination(CScriptID(redeemScript));
+    const AcceptingSignatureChecker checker;
+    while (state.KeepRunning()) {
+        ScriptError err;
+        bool success = VerifyScript(scriptSig, scriptPubKey, nullptr, flags, checker, &err);
+        assert(success);
+    }
+}
+
 BENCHMARK(VerifyScriptBench, 6300);
+BENCHMARK(VerifyScriptP2PKHBench, 300000);
+BENCHMARK(EvalScriptP2PKHBench, 150000);
+BENCHMARK(VerifyScriptP2SHMultisigBench, 50000);
+
+static std::vector<std::tuple<CPubKey, uint256, std::vector<unsigned char>>> BuildSignatures(size_t count)
+{
+    std::vector<std::tuple<CPubKey, uint256, std::vector<unsigned char>>> sigs;
+    for (size_t i = 0; i < count; ++i) {
+        CKey key;
+        key.MakeNewKey(true);
+        const uint256 hash = GetRandHash();
+        std::vector<unsigned char> sig;
+        key.Sign(hash, sig);
+        sigs.emplace_back(key.GetPubKey(), hash, sig);
+    }
+    return sigs;
+}
+
+// Verifies a batch of independent signatures one after the other.
+static void VerifySignaturesSerialBench(benchmark::State& state)
+{
+    const auto sigs = BuildSignatures(64);
+    while (state.KeepRunning()) {
+        for (const auto& sig : sigs) {
+            bool ok = std::get<0>(sig).Verify(std::get<1>(sig), std::get<2>(sig));
+            assert(ok);
+        }
+    }
+}
+
+// Verifies the same batch through CSignatureBatch on the signature check threads.
+static void VerifySignaturesBatchBench(benchmark::State& state)
+{
+    static boost::thread_group threads;
+    static bool started = false;
+    if (!started) {
+        for (int i = 0; i < GetNumCores() - 1; ++i)
+            threads.create_thread(&ThreadSignatureCheck);
+        started = true;
+    }
+    const auto sigs = BuildSignatures(64);
+    CSignatureBatch batch;
+    while (state.KeepRunning()) {
+        for (const auto& sig : sigs)
+            batch.AddVerify(std::get<0>(sig), std::get<1>(sig), std::get<2>(sig));
+        for (const bool ok : batch.Verify())
+            assert(ok);
+    }
+}
+
+BENCHMARK(VerifySignaturesSerialBench, 20);
+BENCHMARK(VerifySignaturesBatchBench, 20);
@@ -0,0 +1,156 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+
+#include <chainparams.h>
+#include <key.h>
+#include <random.h>
+#include <xbridge/util/xseries.h>
+#include <xbridge/xbridgepacket.h>
+
+#include <vector>
+
+// Order packet as sent by a client, see xbcTransaction, with 10 utxos
+static XBridgePacket OrderPacket()
+{
+    XBridgePacket packet(xbcTransaction);
+    const uint256 id = GetRandHash();
+    std::vector<unsigned char> address(XBridgePacket::addressSize, 1);
+    std::vector<unsigned char> currency(8, 0);
+    packet.append(id.begin(), 32);
+    packet.append(address);
+    currency[0] = 'B'; currency[1] = 'T'; currency[2] = 'C';
+    packet.append(currency);
+    packet.append(static_cast<uint64_t>(COIN));
+    packet.append(address);
+    currency[0] = 'L'; currency[1] = 'T'; currency[2] = 'C';
+    packet.append(currency);
+    packet.append(static_cast<uint64_t>(100 * COIN));
+    packet.append(static_cast<uint64_t>(GetTime()));
+    packet.append(static_cast<uint32_t>(10));
+    for (int i = 0; i < 10; ++i) {
+        const uint256 txid = GetRandHash();
+        packet.append(txid.begin(), 32);
+        packet.append(static_cast<uint32_t>(i));
+    }
+    return packet;
+}
+
+static void XBridgePacketSerialize(benchmark::State& state)
+{
+    while (state.KeepRunning()) {
+        XBridgePacket packet = OrderPacket();
+        std::vector<unsigned char> bytes(packet.body());
+    }
+}
+
+static void XBridgePacketParse(benchmark::State& state)
+{
+    const std::vector<unsigned char> bytes = OrderPacket().body();
+    while (state.KeepRunning()) {
+        XBridgePacketView view(bytes.data(), bytes.size());
+        XBridgePacket packet;
+        bool parsed = view.valid() && packet.copyFrom(view);
+        assert(parsed);
+    }
+}
+
+static void XBridgePacketSign(benchmark::State& state)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    const CPubKey pubkey = key.GetPubKey();
+    const std::vector<unsigned char> vpubkey(pubkey.begin(), pubkey.end());
+    const std::vector<unsigned char> vprivkey(key.begin(), key.end());
+    XBridgePacket packet = OrderPacket();
+    while (state.KeepRunning()) {
+        packet.sign(vpubkey, vprivkey);
+    }
+}
+
+static void XBridgePacketVerify(benchmark::State& state)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    const CPubKey pubkey = key.GetPubKey();
+    XBridgePacket packet = OrderPacket();
+    packet.sign(std::vector<unsigned char>(pubkey.begin(), pubkey.end()), std::vector<unsigned char>(key.begin(), key.end()));
+    while (state.KeepRunning()) {
+        bool verified = packet.verify();
+        assert(verified);
+    }
+}
+
+// One day of trades, 8 per minute
+static std::vector<CurrencyPair> XSeriesTrades()
+{
+    const ccy::Currency btc{"BTC", xbridge::TransactionDescr::COIN};
+    const ccy::Currency ltc{"LTC", xbridge::TransactionDescr::COIN};
+    const auto start = boost::posix_time::from_time_t(1569888000);
+    std::vector<CurrencyPair> trades;
+    for (int i = 0; i < 24 * 60 * 8; ++i) {
+        const ccy::Asset from{btc, static_cast<ccy::Amount>(COIN / 100 + i % 97 * 1000)};
+        const ccy::Asset to{ltc, static_cast<ccy::Amount>(COIN + i % 89 * 100000)};
+        trades.emplace_back(GetRandHash().GetHex(), from, to, start + boost::posix_time::seconds{i * 60 / 8});
+    }
+    return trades;
+}
+
+// Aggregates one day of trades into one minute intervals, like the series cache does for each
+// connected block.
+static void XSeriesAggregateTrades(benchmark::State& state)
+{
+    const std::vector<CurrencyPair> trades = XSeriesTrades();
+    const auto minute = boost::posix_time::seconds{60};
+    while (state.KeepRunning()) {
+        std::vector<xAggregate> series;
+        for (const auto& trade : trades) {
+            const auto timeEnd = trade.timeStamp - boost::posix_time::seconds{trade.timeStamp.time_of_day().seconds()} + minute;
+            if (series.empty() || series.back().timeEnd != timeEnd) {
+                series.emplace_back(trade.from.currency(), trade.to.currency());
+                series.back().timeEnd = timeEnd;
+            }
+            series.back().update(trade, xQuery::WithTxids::Included);
+        }
+    }
+}
+
+// Rolls the one minute intervals of one day up into hourly intervals, like a query with a
+// granularity that isn't precomputed.
+static void XSeriesRollup(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    const std::vector<CurrencyPair> trades = XSeriesTrades();
+    xSeriesCache cache;
+    auto& minutes = cache.getXAggregateContainer("LTC/BTC", 0);
+    const auto minute = boost::posix_time::seconds{60};
+    for (const auto& trade : trades) {
+        const auto timeEnd = trade.timeStamp - boost::posix_time::seconds{trade.timeStamp.time_of_day().seconds()} + minute;
+        if (minutes.empty() || minutes.back().timeEnd != timeEnd) {
+            minutes.emplace_back(trade.from.currency(), trade.to.currency());
+            minutes.back().timeEnd = timeEnd;
+        }
+        minutes.back().update(trade, xQuery::WithTxids::Excluded);
+    }
+    const auto start = minutes.front().timeEnd - minute;
+    while (state.KeepRunning()) {
+        std::vector<xAggregate> hours;
+        for (int h = 1; h <= 24; ++h) {
+            const boost::posix_time::time_period hour{start + boost::posix_time::hours{h - 1}, start + boost::posix_time::hours{h}};
+            xAggregate x{minutes.front().fromVolume.currency(), minutes.front().toVolume.currency()};
+            x.timeEnd = hour.end();
+            for (const auto& m : cache.getXAggregateRange(minutes.begin(), minutes.end(), hour))
+                x.update(m, xQuery::WithTxids::Excluded);
+            hours.push_back(x);
+        }
+    }
+}
+
+BENCHMARK(XBridgePacketSerialize, 200 * 1000);
+BENCHMARK(XBridgePacketParse, 500 * 1000);
+BENCHMARK(XBridgePacketSign, 10 * 1000);
+BENCHMARK(XBridgePacketVerify, 10 * 1000);
+BENCHMARK(XSeriesAggregateTrades, 20);
+BENCHMARK(XSeriesRollup, 2000);
@@ -0,0 +1,76 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+
+#include <chainparams.h>
+#include <key.h>
+#include <xrouter/xrouterconnectorbench.h>
+#include <xrouter/xrouterpacket.h>
+#include <xrouter/xrouterserver.h>
+#include <xrouter/xrouterutils.h>
+
+#include <univalue.h>
+
+#include <vector>
+
+// Backend reply of a block with 64 transactions, without the json-rpc wrapper
+static std::string BlockReply()
+{
+    const xrouter::BenchWalletConnectorXRouter conn(0);
+    UniValue reply;
+    reply.read(conn.getBlock(xrouter::BenchWalletConnectorXRouter::fakeHash("block")));
+    return find_value(reply, "result").write();
+}
+
+static void XRouterReplyEncode(benchmark::State& state)
+{
+    const std::string reply = BlockReply();
+    std::vector<unsigned char> encoded;
+    while (state.KeepRunning()) {
+        encoded.clear();
+        xrouter::EncodeBinaryReply(reply, encoded);
+    }
+}
+
+static void XRouterReplyDecode(benchmark::State& state)
+{
+    std::vector<unsigned char> encoded;
+    xrouter::EncodeBinaryReply(BlockReply(), encoded);
+    UniValue reply;
+    while (state.KeepRunning()) {
+        xrouter::DecodeBinaryReply(encoded.data(), encoded.size(), reply);
+    }
+}
+
+static void XRouterPacketVerify(benchmark::State& state)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    const CPubKey pubkey = key.GetPubKey();
+    xrouter::XRouterPacket packet(xrouter::xrGetBlock, xrouter::generateUUID());
+    packet.append(std::string("BLOCK"));
+    packet.append(std::string(""));
+    packet.append(static_cast<uint32_t>(1));
+    packet.append(xrouter::BenchWalletConnectorXRouter::fakeHash("block"));
+    packet.sign(std::vector<unsigned char>(pubkey.begin(), pubkey.end()), std::vector<unsigned char>(key.begin(), key.end()));
+    while (state.KeepRunning()) {
+        packet.verify();
+    }
+}
+
+// One round of 8 clients sending 100 queries each to a backend that replies instantly,
+// xrTest runs the same load test with configurable clients and backend response time.
+static void XRouterLoad(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    while (state.KeepRunning()) {
+        xrouter::XRouterServer::runPerformanceTests(8, 100, 0);
+    }
+}
+
+BENCHMARK(XRouterReplyEncode, 2000);
+BENCHMARK(XRouterReplyDecode, 2000);
+BENCHMARK(XRouterPacketVerify, 10000);
+BENCHMARK(XRouterLoad, 2);
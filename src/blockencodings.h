@@ -144,6 +144,8 @@ protected:
 
 public:
     CBlockHeader header;
+    // The signature of a proof-of-stake block isn't part of the header
+    std::vector<unsigned char> vchBlockSig;
 
     // Dummy for deserialization
     CBlockHeaderAndShortTxIDs() {}
@@ -185,6 +187,7 @@ public:
         }
 
         READWRITE(prefilledtxn);
+        READWRITE(vchBlockSig);
 
         if (BlockTxCount() > std::numeric_limits<uint16_t>::max())
             throw std::ios_base::failure("indexes overflowed 16 bits");
@@ -201,6 +204,7 @@ protected:
     CTxMemPool* pool;
 public:
     CBlockHeader header;
+    std::vector<unsigned char> vchBlockSig;
     explicit PartiallyDownloadedBlock(CTxMemPool* poolIn) : pool(poolIn) {}
 
     // extra_txn is a list of extra transactions to look at, in <witness hash, reference> form
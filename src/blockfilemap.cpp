@@ -0,0 +1,102 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockfilemap.h>
+
+#include <util/system.h>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+BlockFileMaps g_block_file_maps;
+
+MappedBlockFile::~MappedBlockFile()
+{
+#ifndef WIN32
+    munmap(const_cast<unsigned char*>(m_data), m_size);
+#endif
+}
+
+void MappedBlockFile::Advise(bool sequential) const
+{
+#ifndef WIN32
+    posix_madvise(const_cast<unsigned char*>(m_data), m_size, sequential ? POSIX_MADV_SEQUENTIAL : POSIX_MADV_RANDOM);
+#endif
+}
+
+MappedBlockFileRef MapReadOnlyFile(const fs::path& path)
+{
+#ifdef WIN32
+    return nullptr;
+#else
+    int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd == -1) {
+        LogPrintf("%s: Unable to open file %s\n", __func__, path.string());
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return nullptr;
+    }
+    const size_t size = static_cast<size_t>(st.st_size);
+    void *data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // the mapping keeps the file open
+    if (data == MAP_FAILED) {
+        LogPrintf("%s: Unable to map file %s\n", __func__, path.string());
+        return nullptr;
+    }
+    return std::make_shared<const MappedBlockFile>(static_cast<const unsigned char*>(data), size);
+#endif
+}
+
+MappedBlockFileRef BlockFileMaps::Get(int nFile, const fs::path& path, size_t nEnd)
+{
+    LOCK(m_mutex);
+    auto it = m_files.find(nFile);
+    if (it != m_files.end() && it->second->Size() >= nEnd)
+        return it->second;
+
+    MappedBlockFileRef file = MapReadOnlyFile(path);
+    if (!file || file->Size() < nEnd)
+        return nullptr;
+    // Block files are read randomly unless a scan is in progress
+    file->Advise(m_sequential_scans > 0);
+    m_files[nFile] = file;
+    return file;
+}
+
+void BlockFileMaps::Drop(int nFile)
+{
+    LOCK(m_mutex);
+    m_files.erase(nFile);
+}
+
+void BlockFileMaps::Clear()
+{
+    LOCK(m_mutex);
+    m_files.clear();
+}
+
+void BlockFileMaps::BeginSequentialScan()
+{
+    LOCK(m_mutex);
+    if (m_sequential_scans++ == 0) {
+        for (const auto& file : m_files)
+            file.second->Advise(true);
+    }
+}
+
+void BlockFileMaps::EndSequentialScan()
+{
+    LOCK(m_mutex);
+    if (--m_sequential_scans == 0) {
+        for (const auto& file : m_files)
+            file.second->Advise(false);
+    }
+}
@@ -0,0 +1,80 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BLOCKNET_BLOCKFILEMAP_H
+#define BLOCKNET_BLOCKFILEMAP_H
+
+#include <fs.h>
+#include <span.h>
+#include <sync.h>
+
+#include <map>
+#include <memory>
+
+/** Read-only memory map of a block file, unmapped when the last reference is gone */
+class MappedBlockFile
+{
+public:
+    MappedBlockFile(const unsigned char *data, size_t size) : m_data(data), m_size(size) {}
+    ~MappedBlockFile();
+
+    MappedBlockFile(const MappedBlockFile&) = delete;
+    MappedBlockFile& operator=(const MappedBlockFile&) = delete;
+
+    Span<const unsigned char> Data() const { return Span<const unsigned char>(m_data, m_size); }
+    size_t Size() const { return m_size; }
+
+    //! Advise the kernel of sequential (readahead) or random access to the mapping
+    void Advise(bool sequential) const;
+
+private:
+    const unsigned char *m_data;
+    const size_t m_size;
+};
+
+using MappedBlockFileRef = std::shared_ptr<const MappedBlockFile>;
+
+/** Maps a whole file read-only, nullptr if the file is empty or can't be mapped (always on Windows) */
+MappedBlockFileRef MapReadOnlyFile(const fs::path& path);
+
+/**
+ * Memory maps of the block files used by ReadBlockFromDisk. A file is mapped on first use
+ * and mapped again when a read goes past the end of the mapping, the file grew since.
+ * Readers keep the mapping alive while they deserialize from it.
+ */
+class BlockFileMaps
+{
+public:
+    /**
+     * Mapping of the file that covers [0, nEnd), nullptr if the file can't be mapped
+     * or is shorter than nEnd.
+     */
+    MappedBlockFileRef Get(int nFile, const fs::path& path, size_t nEnd);
+
+    //! Forget the mapping of a file that is pruned or truncated
+    void Drop(int nFile);
+    void Clear();
+
+    //! Sequential scans in progress, mappings are advised for readahead while there are any
+    void BeginSequentialScan();
+    void EndSequentialScan();
+
+private:
+    Mutex m_mutex;
+    std::map<int, MappedBlockFileRef> m_files GUARDED_BY(m_mutex);
+    int m_sequential_scans GUARDED_BY(m_mutex){0};
+};
+
+/** Block file mappings, only used with -blockmmap */
+extern BlockFileMaps g_block_file_maps;
+
+/** Marks a sequential scan over the block files (reindex, governance loading) while alive */
+class BlockFileSequentialScan
+{
+public:
+    BlockFileSequentialScan() { g_block_file_maps.BeginSequentialScan(); }
+    ~BlockFileSequentialScan() { g_block_file_maps.EndSequentialScan(); }
+};
+
+#endif // BLOCKNET_BLOCKFILEMAP_H
@@ -6,12 +6,12 @@
 #define BITCOIN_BLOOM_H
 
 #include <serialize.h>
+#include <uint256.h>
 
 #include <vector>
 
 class COutPoint;
 class CTransaction;
-class uint256;
 
 //! 20,000 items with fp rate < 0.1% or 10,000 items and <0.0001%
 static const unsigned int MAX_BLOOM_FILTER_SIZE = 36000; // bytes
@@ -30,6 +30,29 @@ enum bloomflags
     BLOOM_UPDATE_MASK = 3,
 };
 
+/**
+ * The data elements of a transaction that bloom filters are matched against: the pushes of
+ * the output scripts, the spent outpoints and the pushes of the input scripts. The scripts
+ * are parsed once so that the transaction can be matched against the filters of many peers.
+ */
+struct CBloomTxElements
+{
+    struct Output {
+        std::vector<std::vector<unsigned char> > pushes; // up to the first invalid opcode
+        bool isPubKeyOrMultisig{false};
+    };
+    struct Input {
+        std::vector<unsigned char> prevout; // serialized outpoint
+        std::vector<std::vector<unsigned char> > pushes; // up to the first invalid opcode
+    };
+
+    uint256 hash;
+    std::vector<Output> vout;
+    std::vector<Input> vin;
+
+    explicit CBloomTxElements(const CTransaction& tx);
+};
+
 /**
  * BloomFilter is a probabilistic filter which SPV clients provide
  * so that we can filter the transactions we send them.
@@ -93,6 +116,7 @@ public:
 
     //! Also adds any outputs which match the filter to the filter (to match their spending txes)
     bool IsRelevantAndUpdate(const CTransaction& tx);
+    bool IsRelevantAndUpdate(const CBloomTxElements& tx);
 
     //! Checks for empty and full filters to avoid wasting cpu
     void UpdateEmptyFull();
@@ -168,3 +168,43 @@ const CBlockIndex* LastCommonAncestor(const CBlockIndex* pa, const CBlockIndex*
     assert(pa == pb);
     return pa;
 }
+
+CHeaderHeightIndex::~CHeaderHeightIndex()
+{
+    for (auto& chunk : m_chunks)
+        delete[] chunk.load(std::memory_order_relaxed);
+}
+
+CBlockIndex* CHeaderHeightIndex::Get(int nHeight) const
+{
+    if (nHeight < 0 || (nHeight >> CHUNK_BITS) >= MAX_CHUNKS)
+        return nullptr;
+    const std::atomic<CBlockIndex*>* chunk = m_chunks[nHeight >> CHUNK_BITS].load(std::memory_order_acquire);
+    if (!chunk)
+        return nullptr;
+    return chunk[nHeight & (CHUNK_SIZE - 1)].load(std::memory_order_acquire);
+}
+
+void CHeaderHeightIndex::Set(int nHeight, CBlockIndex* pindex)
+{
+    if (nHeight < 0 || (nHeight >> CHUNK_BITS) >= MAX_CHUNKS)
+        return;
+    std::atomic<CBlockIndex*>* chunk = m_chunks[nHeight >> CHUNK_BITS].load(std::memory_order_relaxed);
+    if (!chunk) {
+        chunk = new std::atomic<CBlockIndex*>[CHUNK_SIZE]();
+        m_chunks[nHeight >> CHUNK_BITS].store(chunk, std::memory_order_release);
+    }
+    chunk[nHeight & (CHUNK_SIZE - 1)].store(pindex, std::memory_order_release);
+}
+
+void CHeaderHeightIndex::Clear()
+{
+    // Chunks stay allocated, readers may still hold them
+    for (auto& chunk : m_chunks) {
+        std::atomic<CBlockIndex*>* slots = chunk.load(std::memory_order_relaxed);
+        if (!slots)
+            continue;
+        for (int i = 0; i < CHUNK_SIZE; ++i)
+            slots[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
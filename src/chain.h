@@ -12,6 +12,7 @@
 #include <tinyformat.h>
 #include <uint256.h>
 
+#include <atomic>
 #include <vector>
 
 /**
@@ -238,9 +239,9 @@ public:
     uint64_t nStakeModifier;             // hash modifier for proof-of-stake
     COutPoint prevoutStake;
     uint256 hashProofOfStake;
+    unsigned int nFlags;                 // packed behind the 4 byte aligned hashes, avoids padding
     int64_t nMint;
     int64_t nMoneySupply;
-    unsigned int nFlags;
     CAmount nStakeAmount;
     uint256 hashStakeBlock;
     enum {
@@ -584,4 +585,30 @@ public:
     CBlockIndex* FindEarliestAtLeast(int64_t nTime) const;
 };
 
+/**
+ * The latest header stored at each height, including headers beyond the active tip.
+ * Set() and Clear() are serialized by the caller (cs_main), Get() takes no lock. Chunks
+ * of slots are allocated once and only freed on destruction and block index entries are
+ * never deleted while the node runs, so a reader sees either an entry or nullptr.
+ */
+class CHeaderHeightIndex {
+public:
+    static constexpr int CHUNK_BITS = 14;
+    static constexpr int CHUNK_SIZE = 1 << CHUNK_BITS;
+    static constexpr int MAX_CHUNKS = 4096;
+
+    CHeaderHeightIndex() = default;
+    CHeaderHeightIndex(const CHeaderHeightIndex&) = delete;
+    CHeaderHeightIndex& operator=(const CHeaderHeightIndex&) = delete;
+    ~CHeaderHeightIndex();
+
+    /** Header at the given height, nullptr if there is none. */
+    CBlockIndex* Get(int nHeight) const;
+    void Set(int nHeight, CBlockIndex* pindex);
+    void Clear();
+
+private:
+    std::atomic<std::atomic<CBlockIndex*>*> m_chunks[MAX_CHUNKS]{};
+};
+
 #endif // BITCOIN_CHAIN_H
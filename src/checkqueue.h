@@ -8,6 +8,8 @@
 #include <sync.h>
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <vector>
 
 #include <boost/thread/condition_variable.hpp>
@@ -25,12 +27,32 @@ class CCheckQueueControl;
   * onto the queue, where they are processed by N-1 worker threads. When
   * the master is done adding work, it temporarily joins the worker pool
   * as an N'th worker, until all jobs are done.
+  *
+  * The checks are spread over shards, one per worker (shard 0 is the
+  * master's). A worker takes checks from its own shard and steals from the
+  * other shards once it runs out, so workers only contend on a shard lock
+  * while stealing. The queue mutex is only taken to sleep and wake up.
   */
 template <typename T>
 class CCheckQueue
 {
 private:
-    //! Mutex to protect the inner state
+    //! The most shards, workers beyond it share shards
+    static constexpr unsigned int MAX_SHARDS = 64;
+
+    //! Checks queued for a worker, padded so that shards don't share cache lines
+    struct Shard {
+        boost::mutex mutex;
+        //! As the order of booleans doesn't matter, it is used as a LIFO (stack)
+        std::vector<T> checks;
+        //! The size of checks, read without the lock to skip empty shards
+        std::atomic<unsigned int> nSize{0};
+        char padding[64];
+    };
+
+    std::array<Shard, MAX_SHARDS> shards;
+
+    //! Mutex to protect the sleeping workers and the master
     boost::mutex mutex;
 
     //! Worker threads block on this when out of work
@@ -39,87 +61,112 @@ private:
     //! Master thread blocks on this when out of work
     boost::condition_variable condMaster;
 
-    //! The queue of elements to be processed.
-    //! As the order of booleans doesn't matter, it is used as a LIFO (stack)
-    std::vector<T> queue;
+    //! The number of worker threads (excluding the master) that ever joined.
+    std::atomic<unsigned int> nWorkers{0};
 
-    //! The number of workers (including the master) that are idle.
-    int nIdle;
+    //! The number of workers that are idle.
+    std::atomic<int> nIdle{0};
 
-    //! The total number of workers (including the master).
-    int nTotal;
+    //! The number of checks in the shards.
+    std::atomic<unsigned int> nQueued{0};
+
+    //! The shard the next batch is added to.
+    unsigned int nNextShard{0};
 
     //! The temporary evaluation result.
-    bool fAllOk;
+    std::atomic<bool> fAllOk{true};
 
     /**
      * Number of verifications that haven't completed yet.
      * This includes elements that are no longer queued, but still in the
      * worker's own batches.
      */
-    unsigned int nTodo;
+    std::atomic<unsigned int> nTodo{0};
 
     //! The maximum number of elements to be processed in one batch
     unsigned int nBatchSize;
 
+    unsigned int ShardCount() const
+    {
+        const unsigned int nShards = nWorkers + 1;
+        return nShards < MAX_SHARDS ? nShards : MAX_SHARDS;
+    }
+
+    /**
+     * Moves a batch of checks from the worker's own shard, or else from the
+     * first other shard that has checks, to vChecks.
+     */
+    bool Take(unsigned int nShard, std::vector<T>& vChecks)
+    {
+        const unsigned int nShards = ShardCount();
+        for (unsigned int i = 0; i < nShards && nQueued > 0; ++i) {
+            Shard& shard = shards[(nShard + i) % nShards];
+            if (shard.nSize == 0)
+                continue;
+            boost::unique_lock<boost::mutex> lock(shard.mutex);
+            if (shard.checks.empty())
+                continue;
+            // Take half of the shard up to nBatchSize, so that batches get smaller as
+            // the shards drain and all workers finish approximately simultaneously.
+            const unsigned int nNow = std::max(1U, std::min(nBatchSize, (unsigned int)shard.checks.size() / 2));
+            vChecks.resize(nNow);
+            for (unsigned int j = 0; j < nNow; j++) {
+                // Swap jobs from the shard to the local batch vector instead of copying.
+                vChecks[j].swap(shard.checks.back());
+                shard.checks.pop_back();
+            }
+            shard.nSize = shard.checks.size();
+            nQueued -= nNow;
+            return true;
+        }
+        return false;
+    }
+
     /** Internal function that does bulk of the verification work. */
     bool Loop(bool fMaster = false)
     {
-        boost::condition_variable& cond = fMaster ? condMaster : condWorker;
+        const unsigned int nShard = fMaster ? 0 : 1 + nWorkers++ % (MAX_SHARDS - 1);
         std::vector<T> vChecks;
         vChecks.reserve(nBatchSize);
-        unsigned int nNow = 0;
-        bool fOk = true;
         do {
-            {
+            if (!Take(nShard, vChecks)) {
                 boost::unique_lock<boost::mutex> lock(mutex);
-                // first do the clean-up of the previous loop run (allowing us to do it in the same critsect)
-                if (nNow) {
-                    fAllOk &= fOk;
-                    nTodo -= nNow;
-                    if (nTodo == 0 && !fMaster)
-                        // We processed the last element; inform the master it can exit and return the result
-                        condMaster.notify_one();
-                } else {
-                    // first iteration
-                    nTotal++;
-                }
-                // logically, the do loop starts here
-                while (queue.empty()) {
-                    if (fMaster && nTodo == 0) {
-                        nTotal--;
+                if (fMaster) {
+                    // Only the master adds checks, it waits for the workers to finish theirs
+                    while (nQueued == 0 && nTodo != 0)
+                        condMaster.wait(lock);
+                    if (nQueued == 0) {
                         bool fRet = fAllOk;
                         // reset the status for new work later
-                        if (fMaster)
-                            fAllOk = true;
+                        fAllOk = true;
                         // return the current status
                         return fRet;
                     }
+                } else {
+                    // Add() reads nIdle after queueing, so it either wakes this worker or
+                    // this worker sees the checks
                     nIdle++;
-                    cond.wait(lock); // wait
+                    while (nQueued == 0)
+                        condWorker.wait(lock); // wait
                     nIdle--;
                 }
-                // Decide how many work units to process now.
-                // * Do not try to do everything at once, but aim for increasingly smaller batches so
-                //   all workers finish approximately simultaneously.
-                // * Try to account for idle jobs which will instantly start helping.
-                // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
-                nNow = std::max(1U, std::min(nBatchSize, (unsigned int)queue.size() / (nTotal + nIdle + 1)));
-                vChecks.resize(nNow);
-                for (unsigned int i = 0; i < nNow; i++) {
-                    // We want the lock on the mutex to be as short as possible, so swap jobs from the global
-                    // queue to the local batch vector instead of copying.
-                    vChecks[i].swap(queue.back());
-                    queue.pop_back();
-                }
-                // Check whether we need to do work at all
-                fOk = fAllOk;
+                continue;
             }
+            // Check whether we need to do work at all
+            bool fOk = fAllOk;
             // execute work
             for (T& check : vChecks)
                 if (fOk)
                     fOk = check();
+            if (!fOk)
+                fAllOk = false;
+            const unsigned int nNow = vChecks.size();
             vChecks.clear();
+            if (nTodo.fetch_sub(nNow) == nNow) {
+                // We processed the last element; inform the master it can exit and return the result
+                boost::unique_lock<boost::mutex> lock(mutex);
+                condMaster.notify_one();
+            }
         } while (true);
     }
 
@@ -128,7 +175,7 @@ public:
     boost::mutex ControlMutex;
 
     //! Create a new check queue
-    explicit CCheckQueue(unsigned int nBatchSizeIn) : nIdle(0), nTotal(0), fAllOk(true), nTodo(0), nBatchSize(nBatchSizeIn) {}
+    explicit CCheckQueue(unsigned int nBatchSizeIn) : nBatchSize(nBatchSizeIn) {}
 
     //! Worker thread
     void Thread()
@@ -145,16 +192,31 @@ public:
     //! Add a batch of checks to the queue
     void Add(std::vector<T>& vChecks)
     {
-        boost::unique_lock<boost::mutex> lock(mutex);
-        for (T& check : vChecks) {
-            queue.push_back(T());
-            check.swap(queue.back());
-        }
+        if (vChecks.empty())
+            return;
         nTodo += vChecks.size();
-        if (vChecks.size() == 1)
-            condWorker.notify_one();
-        else if (vChecks.size() > 1)
-            condWorker.notify_all();
+        // Spread large batches over the shards so that every worker starts on its own shard
+        const unsigned int nShards = ShardCount();
+        const size_t nChunk = std::max<size_t>(nBatchSize, (vChecks.size() + nShards - 1) / nShards);
+        for (size_t i = 0; i < vChecks.size();) {
+            Shard& shard = shards[nNextShard++ % nShards];
+            const size_t nEnd = std::min(vChecks.size(), i + nChunk);
+            boost::unique_lock<boost::mutex> lock(shard.mutex);
+            for (size_t j = i; j < nEnd; j++) {
+                shard.checks.emplace_back();
+                shard.checks.back().swap(vChecks[j]);
+            }
+            shard.nSize = shard.checks.size();
+            nQueued += nEnd - i;
+            i = nEnd;
+        }
+        if (nIdle > 0) {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (vChecks.size() == 1)
+                condWorker.notify_one();
+            else
+                condWorker.notify_all();
+        }
     }
 
     ~CCheckQueue()
@@ -5,11 +5,14 @@
 
 #include "coinvalidator.h"
 
+#include <crypto/common.h>
 #include <key_io.h>
 #include <logging.h>
 #include <script/standard.h>
+#include <util/strencodings.h>
 #include <util/system.h>
 
+#include <algorithm>
 #include <fstream>
 
 /**
@@ -17,6 +20,23 @@
  */
 const int CoinValidator::CHAIN_HEIGHT = 101651;
 
+InfractionSet::InfractionSet(const std::vector<uint256> &txs) : txids(txs) {
+    std::sort(txids.begin(), txids.end());
+    for (const uint256 &txid : txids)
+        prefilter.set(ReadLE16(txid.begin()));
+}
+
+bool InfractionSet::Contains(const uint256 &txId) const {
+    if (!prefilter.test(ReadLE16(txId.begin())))
+        return false;
+    return std::binary_search(txids.begin(), txids.end(), txId);
+}
+
+CoinValidator::CoinValidator() {
+    infSets.emplace_back(new InfractionSet(std::vector<uint256>()));
+    infSet.store(infSets.back().get());
+}
+
 /**
  * Returns true if the tx is not associated with any infractions.
  * @param txId
@@ -24,12 +44,10 @@ const int CoinValidator::CHAIN_HEIGHT = 101651;
  */
 bool CoinValidator::IsCoinValid(const uint256 &txId) const {
     // A coin is valid if its tx is not in the infractions list
-    boost::mutex::scoped_lock l(lock);
-    return infMap.count(txId.ToString()) == 0;
+    return !infSet.load(std::memory_order_acquire)->Contains(txId);
 }
 bool CoinValidator::IsCoinValid(uint256 &txId) const {
-    boost::mutex::scoped_lock l(lock);
-    return infMap.count(txId.ToString()) == 0;
+    return !infSet.load(std::memory_order_acquire)->Contains(txId);
 }
 bool CoinValidator::IsCoinValid(const std::string &txId) const {
     boost::mutex::scoped_lock l(lock);
@@ -121,6 +139,7 @@ bool CoinValidator::IsLoaded() const {
 void CoinValidator::Clear() {
     boost::mutex::scoped_lock l(lock);
     infMap.clear();
+    publish();
     lastLoadH = 0;
     infMapLoaded = false;
     downloadErr = false;
@@ -132,11 +151,12 @@ void CoinValidator::Clear() {
  */
 std::vector<InfractionData> CoinValidator::GetInfractions(const uint256 &txId) {
     boost::mutex::scoped_lock l(lock);
-    return infMap[txId.ToString()];
+    // don't insert, infMap must stay in sync with the published infSet
+    auto it = infMap.find(txId.ToString());
+    return it != infMap.end() ? it->second : std::vector<InfractionData>();
 }
 std::vector<InfractionData> CoinValidator::GetInfractions(uint256 &txId) {
-    boost::mutex::scoped_lock l(lock);
-    return infMap[txId.ToString()];
+    return GetInfractions(static_cast<const uint256 &>(txId));
 }
 std::vector<InfractionData> CoinValidator::GetInfractions(const std::string &address) {
     boost::mutex::scoped_lock l(lock);
@@ -203,6 +223,7 @@ bool CoinValidator::Load(int loadHeight) {
 
                     // If we didn't fail return, otherwise proceed to load from network
                     if (!failed) {
+                        publish();
                         LogPrintf("Coin Validator: Loading from cache: %u\n", lastLoadH);
                         return true;
                     }
@@ -219,6 +240,7 @@ bool CoinValidator::Load(int loadHeight) {
     std::list<std::string> lst;
     if (!downloadList(lst, err) || lst.empty()) {
         LogPrintf("Coin Validator: Failed to load from network: %s\n", err);
+        publish();
         infMapLoaded = false;
         return false;
     }
@@ -227,6 +249,7 @@ bool CoinValidator::Load(int loadHeight) {
     for (std::string &line : lst) {
         addLine(line, infMap);
     }
+    publish();
 
     // Save to disk
     std::ofstream file(getExplPath().string(), std::ios::out | std::ofstream::binary);
@@ -270,11 +293,26 @@ bool CoinValidator::LoadStatic() {
         }
     }
 
+    publish();
+
     lastLoadH = CHAIN_HEIGHT;
     LogPrintf("Coin Validator: Ready: %u\n", lastLoadH);
     return true;
 }
 
+/**
+ * Publishes the lookup of the infMap txids. Requires the lock. Older sets are kept
+ * alive since readers don't lock, the list is only reloaded a handful of times.
+ */
+void CoinValidator::publish() {
+    std::vector<uint256> txids;
+    txids.reserve(infMap.size());
+    for (const auto &item : infMap)
+        txids.push_back(uint256S(item.first));
+    infSets.emplace_back(new InfractionSet(txids));
+    infSet.store(infSets.back().get(), std::memory_order_release);
+}
+
 /**
  * Return cached file path.
  * @return
@@ -288,23 +326,26 @@ boost::filesystem::path CoinValidator::getExplPath() {
  * @return
  */
 bool CoinValidator::addLine(std::string &line, std::map<std::string, std::vector<InfractionData>> &map) {
-    std::stringstream os(line);
-    os.imbue(std::locale::classic());
-    std::string t;
-    std::string a;
-    CAmount amt = 0;
-    double amtd = 0;
-    os >> t >> a >> amt >> amtd;
+    // Fields are tab separated: txid, address, amount in satoshis, amount in coin with 6 decimals
+    std::string fields[4];
+    size_t start = 0;
+    for (int i = 0; i < 4; ++i) {
+        const size_t end = i < 3 ? line.find('\t', start) : line.size();
+        if (end == std::string::npos || end == start)
+            return false;
+        fields[i] = line.substr(start, end - start);
+        start = end + 1;
+    }
 
-    if (t.empty() || a.empty() || amt == 0 || amtd == 0)
+    int64_t amt = 0;
+    int64_t amtFixed = 0;
+    if (!ParseInt64(fields[2], &amt) || !ParseFixedPoint(fields[3], 6, &amtFixed) || amt == 0 || amtFixed == 0)
         return false;
 
-    // Make sure parsed line matches expected
-    assert(line == t + "\t" + a + "\t" + std::to_string(amt) + "\t" + CoinValidator::AmountToString(amtd));
-
-    const InfractionData inf(t, a, amt, amtd);
-    std::vector<InfractionData> &infs = map[inf.txid];
-    infs.push_back(inf);
+    const InfractionData inf(fields[0], fields[1], amt, static_cast<double>(amtFixed) / 1000000);
+    // The lists are sorted by txid, appending to the map is constant time then
+    auto it = map.emplace_hint(map.end(), inf.txid, std::vector<InfractionData>());
+    it->second.push_back(inf);
 
     return true;
 }
@@ -11,6 +11,10 @@
 #include <script/script.h>
 #include <uint256.h>
 
+#include <atomic>
+#include <bitset>
+#include <memory>
+
 #include <boost/thread/mutex.hpp>
 #include <boost/filesystem/path.hpp>
 
@@ -40,12 +44,24 @@ struct RedeemData {
     }
 };
 
+/**
+ * Immutable lookup of the infraction txids. Replaced as a whole when the infractions
+ * are (re)loaded, readers probe it without locking or allocating.
+ */
+struct InfractionSet {
+    std::vector<uint256> txids; // sorted
+    std::bitset<1 << 16> prefilter; // first two bytes of each txid
+    explicit InfractionSet(const std::vector<uint256> &txs);
+    bool Contains(const uint256 &txId) const;
+};
+
 /**
  * Manages coin infractions.
  */
 class CoinValidator {
 public:
     static const int CHAIN_HEIGHT;
+    CoinValidator();
     bool IsCoinValid(const uint256 &txId) const;
     bool IsCoinValid(uint256 &txId) const;
     bool IsCoinValid(const std::string &txId) const;
@@ -62,10 +78,13 @@ public:
     static CoinValidator& instance();
 private:
     std::map<std::string, std::vector<InfractionData>> infMap; // Store infractions in memory
+    std::atomic<const InfractionSet*> infSet; // lookup of the infMap txids for IsCoinValid
+    std::vector<std::unique_ptr<const InfractionSet>> infSets; // published sets, kept for lock-free readers
     bool infMapLoaded = false;
     int lastLoadH = 0;
     bool downloadErr = false;
     mutable boost::mutex lock;
+    void publish();
     boost::filesystem::path getExplPath();
     bool addLine(std::string &line, std::map<std::string, std::vector<InfractionData>> &map);
     int getBlockHeight(std::string &line);
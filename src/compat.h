@@ -95,6 +95,14 @@ typedef char* sockopt_arg_type;
 #define USE_POLL
 #endif
 
+// Event queues the sockets stay registered with, so that the socket handler only visits
+// the ready ones. GenerateSelectSet() with poll or select is kept as fallback.
+#if defined(__linux__)
+#define USE_EPOLL
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__DragonFly__)
+#define USE_KQUEUE
+#endif
+
 bool static inline IsSelectableSocket(const SOCKET& s) {
 #if defined(USE_POLL) || defined(WIN32)
     return true;
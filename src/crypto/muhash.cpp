@@ -0,0 +1,227 @@
+// Copyright (c) 2017-2019 The Bitcoin Core developers
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <crypto/muhash.h>
+
+#include <crypto/chacha20.h>
+#include <crypto/common.h>
+#include <crypto/sha256.h>
+
+#include <limits>
+
+namespace {
+
+typedef Num3072::limb_t limb_t;
+typedef Num3072::double_limb_t double_limb_t;
+constexpr int LIMB_SIZE = Num3072::LIMB_SIZE;
+constexpr int LIMBS = Num3072::LIMBS;
+/** The modulus is 2^3072 - MAX_PRIME_DIFF, so 2^3072 is congruent to MAX_PRIME_DIFF. */
+constexpr limb_t MAX_PRIME_DIFF = 1103717;
+
+/**
+ * The inverse is a^(p-2), p-2 = 2^3072 - 1103719 = (2^3051 - 1) * 2^21 + 993433. The
+ * repunit part takes a square per bit and a multiplication per set bit of 3051.
+ */
+constexpr int INV_REPUNIT = 3051;
+constexpr int INV_LOW_BITS = 21;
+constexpr uint32_t INV_LOW = 993433;
+
+} // namespace
+
+Num3072::Num3072(const unsigned char (&data)[BYTE_SIZE])
+{
+    for (int i = 0; i < LIMBS; ++i) {
+        if (sizeof(limb_t) == 8) {
+            limbs[i] = ReadLE64(data + 8 * i);
+        } else {
+            limbs[i] = ReadLE32(data + 4 * i);
+        }
+    }
+    // Below 2^3072 and thereby below twice the modulus
+    if (IsOverflow()) FullReduce();
+}
+
+void Num3072::SetToOne()
+{
+    limbs[0] = 1;
+    for (int i = 1; i < LIMBS; ++i) limbs[i] = 0;
+}
+
+void Num3072::ToBytes(unsigned char (&out)[BYTE_SIZE]) const
+{
+    for (int i = 0; i < LIMBS; ++i) {
+        if (sizeof(limb_t) == 8) {
+            WriteLE64(out + 8 * i, limbs[i]);
+        } else {
+            WriteLE32(out + 4 * i, limbs[i]);
+        }
+    }
+}
+
+bool Num3072::IsOverflow() const
+{
+    if (limbs[0] <= std::numeric_limits<limb_t>::max() - MAX_PRIME_DIFF) return false;
+    for (int i = 1; i < LIMBS; ++i) {
+        if (limbs[i] != std::numeric_limits<limb_t>::max()) return false;
+    }
+    return true;
+}
+
+void Num3072::FullReduce()
+{
+    // Subtracting the modulus is adding MAX_PRIME_DIFF and dropping the 2^3072 bit
+    double_limb_t c = MAX_PRIME_DIFF;
+    for (int i = 0; i < LIMBS && c != 0; ++i) {
+        c += limbs[i];
+        limbs[i] = (limb_t)c;
+        c >>= LIMB_SIZE;
+    }
+}
+
+void Num3072::Reduce(const limb_t (&tmp)[2 * LIMBS])
+{
+    // high * 2^3072 + low is congruent to high * MAX_PRIME_DIFF + low
+    double_limb_t c = 0;
+    for (int i = 0; i < LIMBS; ++i) {
+        c += (double_limb_t)tmp[LIMBS + i] * MAX_PRIME_DIFF + tmp[i];
+        limbs[i] = (limb_t)c;
+        c >>= LIMB_SIZE;
+    }
+    // The carry is below 2^22, folding it back in overflows at most once more
+    while (c != 0) {
+        double_limb_t d = c * MAX_PRIME_DIFF;
+        for (int i = 0; i < LIMBS && d != 0; ++i) {
+            d += limbs[i];
+            limbs[i] = (limb_t)d;
+            d >>= LIMB_SIZE;
+        }
+        c = d;
+    }
+    if (IsOverflow()) FullReduce();
+}
+
+void Num3072::Multiply(const Num3072& a)
+{
+    limb_t tmp[2 * LIMBS] = {};
+    for (int i = 0; i < LIMBS; ++i) {
+        double_limb_t c = 0;
+        for (int j = 0; j < LIMBS; ++j) {
+            c += (double_limb_t)limbs[i] * a.limbs[j] + tmp[i + j];
+            tmp[i + j] = (limb_t)c;
+            c >>= LIMB_SIZE;
+        }
+        tmp[i + LIMBS] = (limb_t)c;
+    }
+    Reduce(tmp);
+}
+
+void Num3072::Square()
+{
+    // The products of different limbs appear twice, they are computed once and doubled
+    limb_t tmp[2 * LIMBS] = {};
+    for (int i = 0; i < LIMBS; ++i) {
+        double_limb_t c = 0;
+        for (int j = i + 1; j < LIMBS; ++j) {
+            c += (double_limb_t)limbs[i] * limbs[j] + tmp[i + j];
+            tmp[i + j] = (limb_t)c;
+            c >>= LIMB_SIZE;
+        }
+        tmp[i + LIMBS] = (limb_t)c;
+    }
+    limb_t top = 0;
+    for (int i = 0; i < 2 * LIMBS; ++i) {
+        const limb_t v = tmp[i];
+        tmp[i] = (v << 1) | top;
+        top = v >> (LIMB_SIZE - 1);
+    }
+    double_limb_t c = 0;
+    for (int i = 0; i < LIMBS; ++i) {
+        c += (double_limb_t)limbs[i] * limbs[i] + tmp[2 * i];
+        tmp[2 * i] = (limb_t)c;
+        c >>= LIMB_SIZE;
+        c += tmp[2 * i + 1];
+        tmp[2 * i + 1] = (limb_t)c;
+        c >>= LIMB_SIZE;
+    }
+    Reduce(tmp);
+}
+
+Num3072 Num3072::GetInverse() const
+{
+    // p[i] = a^(2^(2^i) - 1)
+    Num3072 p[12];
+    p[0] = *this;
+    for (int i = 0; i < 11; ++i) {
+        p[i + 1] = p[i];
+        for (int j = 0; j < (1 << i); ++j) p[i + 1].Square();
+        p[i + 1].Multiply(p[i]);
+    }
+
+    // out = a^(2^INV_REPUNIT - 1), from the highest set bit of INV_REPUNIT down
+    Num3072 out = p[11];
+    for (int i = 10; i >= 0; --i) {
+        if (!((INV_REPUNIT >> i) & 1)) continue;
+        for (int j = 0; j < (1 << i); ++j) out.Square();
+        out.Multiply(p[i]);
+    }
+
+    for (int i = INV_LOW_BITS - 1; i >= 0; --i) {
+        out.Square();
+        if ((INV_LOW >> i) & 1) out.Multiply(*this);
+    }
+    return out;
+}
+
+void Num3072::Divide(const Num3072& a)
+{
+    Multiply(a.GetInverse());
+}
+
+Num3072 MuHash3072::ToNum3072(const unsigned char* data, size_t len)
+{
+    unsigned char hashed[CSHA256::OUTPUT_SIZE];
+    CSHA256().Write(data, len).Finalize(hashed);
+    unsigned char tmp[Num3072::BYTE_SIZE];
+    ChaCha20(hashed, sizeof(hashed)).Output(tmp, sizeof(tmp));
+    return Num3072(tmp);
+}
+
+MuHash3072::MuHash3072(const unsigned char* data, size_t len) : numerator(ToNum3072(data, len)) {}
+
+MuHash3072& MuHash3072::Insert(const unsigned char* data, size_t len)
+{
+    numerator.Multiply(ToNum3072(data, len));
+    return *this;
+}
+
+MuHash3072& MuHash3072::Remove(const unsigned char* data, size_t len)
+{
+    denominator.Multiply(ToNum3072(data, len));
+    return *this;
+}
+
+MuHash3072& MuHash3072::operator*=(const MuHash3072& mul)
+{
+    numerator.Multiply(mul.numerator);
+    denominator.Multiply(mul.denominator);
+    return *this;
+}
+
+MuHash3072& MuHash3072::operator/=(const MuHash3072& div)
+{
+    numerator.Multiply(div.denominator);
+    denominator.Multiply(div.numerator);
+    return *this;
+}
+
+void MuHash3072::Finalize(uint256& out)
+{
+    numerator.Divide(denominator);
+    denominator.SetToOne();
+
+    unsigned char data[Num3072::BYTE_SIZE];
+    numerator.ToBytes(data);
+    CSHA256().Write(data, sizeof(data)).Finalize(out.begin());
+}
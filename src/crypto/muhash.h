@@ -0,0 +1,120 @@
+// Copyright (c) 2017-2019 The Bitcoin Core developers
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CRYPTO_MUHASH_H
+#define BITCOIN_CRYPTO_MUHASH_H
+
+#include <serialize.h>
+#include <uint256.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/** A number modulo 2^3072 - 1103717, the largest 3072 bit safe prime. */
+class Num3072
+{
+public:
+    static constexpr size_t BYTE_SIZE = 384;
+
+#ifdef __SIZEOF_INT128__
+    typedef unsigned __int128 double_limb_t;
+    typedef uint64_t limb_t;
+    static constexpr int LIMBS = 48;
+    static constexpr int LIMB_SIZE = 64;
+#else
+    typedef uint64_t double_limb_t;
+    typedef uint32_t limb_t;
+    static constexpr int LIMBS = 96;
+    static constexpr int LIMB_SIZE = 32;
+#endif
+    limb_t limbs[LIMBS];
+
+    /** Sets the number to one. */
+    Num3072() { SetToOne(); }
+    /** Reads a little endian number, which is reduced modulo the prime. */
+    explicit Num3072(const unsigned char (&data)[BYTE_SIZE]);
+
+    void SetToOne();
+    void Multiply(const Num3072& a);
+    void Square();
+    /** Multiplies by the inverse of a. */
+    void Divide(const Num3072& a);
+    /** Writes the number little endian. */
+    void ToBytes(unsigned char (&out)[BYTE_SIZE]) const;
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        unsigned char data[BYTE_SIZE];
+        ToBytes(data);
+        s.write((const char*)data, BYTE_SIZE);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        unsigned char data[BYTE_SIZE];
+        s.read((char*)data, BYTE_SIZE);
+        *this = Num3072(data);
+    }
+
+private:
+    bool IsOverflow() const;
+    void FullReduce();
+    /** Sets the number to the double width product modulo the prime. */
+    void Reduce(const limb_t (&tmp)[2 * LIMBS]);
+    Num3072 GetInverse() const;
+};
+
+/**
+ * MuHash3072 is a rolling hash of a set of byte strings: the strings are mapped to
+ * numbers modulo a 3072 bit prime and multiplied together. The hash doesn't depend on
+ * the order the strings are added in, a string is removed by dividing by its number and
+ * two sets are combined by multiplying their states, so a set can be hashed in parallel
+ * parts or updated with what changed instead of being hashed again.
+ *
+ * Numerator and denominator are kept apart so that a removal costs a multiplication,
+ * the division is done once by Finalize.
+ */
+class MuHash3072
+{
+private:
+    Num3072 numerator;
+    Num3072 denominator;
+
+    static Num3072 ToNum3072(const unsigned char* data, size_t len);
+
+public:
+    /** The hash of the empty set. */
+    MuHash3072() {}
+
+    /** The hash of the set with the single element. */
+    MuHash3072(const unsigned char* data, size_t len);
+
+    /** Adds the element to the set. */
+    MuHash3072& Insert(const unsigned char* data, size_t len);
+
+    /** Removes the element from the set. */
+    MuHash3072& Remove(const unsigned char* data, size_t len);
+
+    /** Adds the elements of the other set to this one. */
+    MuHash3072& operator*=(const MuHash3072& mul);
+
+    /** Removes the elements of the other set from this one. */
+    MuHash3072& operator/=(const MuHash3072& div);
+
+    /** The sha256 of the reduced state, the state is left reduced. */
+    void Finalize(uint256& out);
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(numerator);
+        READWRITE(denominator);
+    }
+};
+
+#endif // BITCOIN_CRYPTO_MUHASH_H
@@ -22,11 +22,13 @@ void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks);
 namespace sha256d64_sse41
 {
 void Transform_4way(unsigned char* out, const unsigned char* in);
+void TransformMulti_4way(uint32_t* s, const unsigned char* const* chunks);
 }
 
 namespace sha256d64_avx2
 {
 void Transform_8way(unsigned char* out, const unsigned char* in);
+void TransformMulti_8way(uint32_t* s, const unsigned char* const* chunks);
 }
 
 namespace sha256d64_shani
@@ -416,6 +418,7 @@ void TransformD64(unsigned char* out, const unsigned char* in)
 
 typedef void (*TransformType)(uint32_t*, const unsigned char*, size_t);
 typedef void (*TransformD64Type)(unsigned char*, const unsigned char*);
+typedef void (*TransformMultiType)(uint32_t*, const unsigned char* const*);
 
 template<TransformType tr>
 void TransformD64Wrapper(unsigned char* out, const unsigned char* in)
@@ -461,6 +464,8 @@ TransformD64Type TransformD64 = sha256::TransformD64;
 TransformD64Type TransformD64_2way = nullptr;
 TransformD64Type TransformD64_4way = nullptr;
 TransformD64Type TransformD64_8way = nullptr;
+TransformMultiType TransformMulti_4way = nullptr;
+TransformMultiType TransformMulti_8way = nullptr;
 
 bool SelfTest() {
     // Input state (equal to the initial SHA256 state)
@@ -544,6 +549,23 @@ bool SelfTest() {
         if (!std::equal(out, out + 256, result_d64)) return false;
     }
 
+    // Test TransformMulti_4way and TransformMulti_8way, if available. Lane i continues
+    // the state of i input blocks with the next block.
+    for (TransformMultiType multi : {TransformMulti_4way, TransformMulti_8way}) {
+        if (!multi) continue;
+        const size_t lanes = multi == TransformMulti_4way ? 4 : 8;
+        uint32_t states[64];
+        const unsigned char* chunks[8];
+        for (size_t i = 0; i < lanes; ++i) {
+            std::copy(result[i], result[i] + 8, states + 8 * i);
+            chunks[i] = data + 1 + 64 * i;
+        }
+        multi(states, chunks);
+        for (size_t i = 0; i < lanes; ++i) {
+            if (!std::equal(states + 8 * i, states + 8 * i + 8, result[i + 1])) return false;
+        }
+    }
+
     return true;
 }
 
@@ -567,6 +589,99 @@ bool AVXEnabled()
     return (a & 6) == 6;
 }
 #endif
+/** A message double-SHA256'd in one lane of a multi-way transform. */
+class MultiLane
+{
+private:
+    unsigned char* out;
+    const unsigned char* data;
+    size_t blocks; //!< Full blocks of the message not yet transformed
+    unsigned char tail[128]; //!< Padded end of the message, later the input of the outer hash
+    size_t tail_blocks;
+    size_t tail_pos;
+    bool outer;
+
+public:
+    bool active = false;
+
+    void Start(uint32_t* s, unsigned char* out_in, const unsigned char* in, size_t size)
+    {
+        out = out_in;
+        data = in;
+        blocks = size / 64;
+        const size_t rem = size % 64;
+        memset(tail, 0, sizeof(tail));
+        if (rem) memcpy(tail, in + blocks * 64, rem);
+        tail[rem] = 0x80;
+        tail_blocks = rem < 56 ? 1 : 2;
+        tail_pos = 0;
+        WriteBE64(tail + tail_blocks * 64 - 8, (uint64_t)size << 3);
+        outer = false;
+        active = true;
+        sha256::Initialize(s);
+    }
+
+    /** The block to transform next. */
+    const unsigned char* Next()
+    {
+        if (blocks) {
+            const unsigned char* chunk = data;
+            data += 64;
+            --blocks;
+            return chunk;
+        }
+        return tail + 64 * tail_pos++;
+    }
+
+    /** Continues after a transform, with the outer hash once the message is done. */
+    void Transformed(uint32_t* s)
+    {
+        if (blocks || tail_pos < tail_blocks) return;
+        unsigned char* dest = outer ? out : tail;
+        for (int i = 0; i < 8; ++i)
+            WriteBE32(dest + 4 * i, s[i]);
+        if (outer) {
+            active = false;
+            return;
+        }
+        memset(tail + 32, 0, sizeof(tail) - 32);
+        tail[32] = 0x80;
+        tail[62] = 1; // 256 bits
+        tail_blocks = 1;
+        tail_pos = 0;
+        outer = true;
+        sha256::Initialize(s);
+    }
+};
+
+/** Hashes the messages in lanes of a multi-way transform. A lane takes the next message
+ *  as soon as it is done, until all messages are hashed. */
+template<size_t LANES>
+void SHA256DMultiWay(TransformMultiType tr, unsigned char* out, const unsigned char* const* in, const size_t* sizes, size_t count)
+{
+    static const unsigned char idle[64] = {0};
+    uint32_t s[8 * LANES];
+    MultiLane lanes[LANES];
+    const unsigned char* chunks[LANES];
+    size_t next = 0;
+    while (true) {
+        bool any = false;
+        for (size_t i = 0; i < LANES; ++i) {
+            if (!lanes[i].active && next < count) {
+                lanes[i].Start(s + 8 * i, out + 32 * next, in[next], sizes[next]);
+                ++next;
+            }
+            chunks[i] = lanes[i].active ? lanes[i].Next() : idle;
+            any |= lanes[i].active;
+        }
+        if (!any) break;
+        tr(s, chunks);
+        for (size_t i = 0; i < LANES; ++i) {
+            if (lanes[i].active) lanes[i].Transformed(s + 8 * i);
+        }
+    }
+}
+
 } // namespace
 
 
@@ -622,6 +737,7 @@ std::string SHA256AutoDetect()
 #endif
 #if defined(ENABLE_SSE41) && !defined(BUILD_BITCOIN_INTERNAL)
         TransformD64_4way = sha256d64_sse41::Transform_4way;
+        TransformMulti_4way = sha256d64_sse41::TransformMulti_4way;
         ret += ",sse41(4way)";
 #endif
     }
@@ -629,6 +745,7 @@ std::string SHA256AutoDetect()
 #if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
     if (have_avx2 && have_avx && enabled_avx) {
         TransformD64_8way = sha256d64_avx2::Transform_8way;
+        TransformMulti_8way = sha256d64_avx2::TransformMulti_8way;
         ret += ",avx2(8way)";
     }
 #endif
@@ -728,3 +845,20 @@ void SHA256D64(unsigned char* out, const unsigned char* in, size_t blocks)
         --blocks;
     }
 }
+
+void SHA256DMulti(unsigned char* out, const unsigned char* const* in, const size_t* sizes, size_t count)
+{
+    if (TransformMulti_8way && count >= 8) {
+        SHA256DMultiWay<8>(TransformMulti_8way, out, in, sizes, count);
+        return;
+    }
+    if (TransformMulti_4way && count >= 4) {
+        SHA256DMultiWay<4>(TransformMulti_4way, out, in, sizes, count);
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        unsigned char buf[CSHA256::OUTPUT_SIZE];
+        CSHA256().Write(in[i], sizes[i]).Finalize(buf);
+        CSHA256().Write(buf, sizeof(buf)).Finalize(out + 32 * i);
+    }
+}
@@ -38,4 +38,13 @@ std::string SHA256AutoDetect();
  */
 void SHA256D64(unsigned char* output, const unsigned char* input, size_t blocks);
 
+/** Compute multiple double-SHA256's of independent messages of any size. The messages
+ *  are hashed side by side with the 8-way AVX2 or 4-way SSE4.1 transform when available.
+ *  output:  pointer to a count*32 byte output buffer
+ *  inputs:  pointers to the messages
+ *  sizes:   the sizes of the messages
+ *  count:   the number of hashes to compute.
+ */
+void SHA256DMulti(unsigned char* output, const unsigned char* const* inputs, const size_t* sizes, size_t count);
+
 #endif // BITCOIN_CRYPTO_SHA256_H
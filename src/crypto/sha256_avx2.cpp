@@ -320,6 +320,51 @@ void Transform_8way(unsigned char* out, const unsigned char* in)
     Write8(out, 28, Add(h, K(0x5be0cd19ul)));
 }
 
+void TransformMulti_8way(uint32_t* s, const unsigned char* const* chunks)
+{
+    static const uint32_t round_k[64] = {
+        0x428a2f98ul, 0x71374491ul, 0xb5c0fbcful, 0xe9b5dba5ul, 0x3956c25bul, 0x59f111f1ul, 0x923f82a4ul, 0xab1c5ed5ul,
+        0xd807aa98ul, 0x12835b01ul, 0x243185beul, 0x550c7dc3ul, 0x72be5d74ul, 0x80deb1feul, 0x9bdc06a7ul, 0xc19bf174ul,
+        0xe49b69c1ul, 0xefbe4786ul, 0x0fc19dc6ul, 0x240ca1ccul, 0x2de92c6ful, 0x4a7484aaul, 0x5cb0a9dcul, 0x76f988daul,
+        0x983e5152ul, 0xa831c66dul, 0xb00327c8ul, 0xbf597fc7ul, 0xc6e00bf3ul, 0xd5a79147ul, 0x06ca6351ul, 0x14292967ul,
+        0x27b70a85ul, 0x2e1b2138ul, 0x4d2c6dfcul, 0x53380d13ul, 0x650a7354ul, 0x766a0abbul, 0x81c2c92eul, 0x92722c85ul,
+        0xa2bfe8a1ul, 0xa81a664bul, 0xc24b8b70ul, 0xc76c51a3ul, 0xd192e819ul, 0xd6990624ul, 0xf40e3585ul, 0x106aa070ul,
+        0x19a4c116ul, 0x1e376c08ul, 0x2748774cul, 0x34b0bcb5ul, 0x391c0cb3ul, 0x4ed8aa4aul, 0x5b9cca4ful, 0x682e6ff3ul,
+        0x748f82eeul, 0x78a5636ful, 0x84c87814ul, 0x8cc70208ul, 0x90befffaul, 0xa4506cebul, 0xbef9a3f7ul, 0xc67178f2ul
+    };
+
+    // Message schedule, kept as a ring of the last 16 words
+    __m256i w[16];
+    for (int i = 0; i < 16; ++i)
+        w[i] = _mm256_setr_epi32(ReadBE32(chunks[0] + 4 * i), ReadBE32(chunks[1] + 4 * i), ReadBE32(chunks[2] + 4 * i), ReadBE32(chunks[3] + 4 * i), ReadBE32(chunks[4] + 4 * i), ReadBE32(chunks[5] + 4 * i), ReadBE32(chunks[6] + 4 * i), ReadBE32(chunks[7] + 4 * i));
+
+    __m256i v[8], init[8];
+    for (int i = 0; i < 8; ++i)
+        init[i] = v[i] = _mm256_setr_epi32(s[i], s[8 + i], s[16 + i], s[24 + i], s[32 + i], s[40 + i], s[48 + i], s[56 + i]);
+
+    for (int r = 0; r < 64; ++r) {
+        if (r >= 16)
+            Inc(w[r & 15], sigma1(w[(r + 14) & 15]), w[(r + 9) & 15], sigma0(w[(r + 1) & 15]));
+        __m256i t1 = Add(v[7], Sigma1(v[4]), Ch(v[4], v[5], v[6]), K(round_k[r]), w[r & 15]);
+        __m256i t2 = Add(Sigma0(v[0]), Maj(v[0], v[1], v[2]));
+        v[7] = v[6];
+        v[6] = v[5];
+        v[5] = v[4];
+        v[4] = Add(v[3], t1);
+        v[3] = v[2];
+        v[2] = v[1];
+        v[1] = v[0];
+        v[0] = Add(t1, t2);
+    }
+
+    alignas(32) uint32_t out[8];
+    for (int i = 0; i < 8; ++i) {
+        _mm256_store_si256((__m256i*)out, Add(v[i], init[i]));
+        for (int l = 0; l < 8; ++l)
+            s[8 * l + i] = out[l];
+    }
+}
+
 }
 
 #endif
@@ -475,6 +475,18 @@ public:
             }
         return false;
     }
+
+    /** for_each calls f for every element in the table that was not garbage
+     * collected. The caller must make sure there are no concurrent inserts or
+     * erases.
+     */
+    template <typename F>
+    void for_each(F f) const
+    {
+        for (uint32_t i = 0; i < size; ++i)
+            if (!collection_flags.bit_is_set(i))
+                f(table[i]);
+    }
 };
 } // namespace CuckooCache
 
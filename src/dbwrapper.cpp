@@ -6,6 +6,7 @@
 
 #include <memory>
 #include <random.h>
+#include <sync.h>
 
 #include <leveldb/cache.h>
 #include <leveldb/env.h>
@@ -13,6 +14,8 @@
 #include <memenv.h>
 #include <stdint.h>
 #include <algorithm>
+#include <set>
+#include <sstream>
 
 class CBitcoinLevelDBLogger : public leveldb::Logger {
 public:
@@ -97,13 +100,87 @@ static void SetMaxOpenFiles(leveldb::Options *options) {
              options->max_open_files, default_open_files);
 }
 
-static leveldb::Options GetOptions(size_t nCacheSize)
+/** Block cache that counts lookup hits and misses for getdbstats */
+class CountingCache : public leveldb::Cache
 {
+public:
+    explicit CountingCache(size_t capacity) : m_cache(leveldb::NewLRUCache(capacity)) {}
+
+    Handle* Insert(const leveldb::Slice& key, void* value, size_t charge,
+                   void (*deleter)(const leveldb::Slice& key, void* value)) override {
+        return m_cache->Insert(key, value, charge, deleter);
+    }
+    Handle* Lookup(const leveldb::Slice& key) override {
+        Handle* handle = m_cache->Lookup(key);
+        (handle ? m_hits : m_misses).fetch_add(1, std::memory_order_relaxed);
+        return handle;
+    }
+    void Release(Handle* handle) override { m_cache->Release(handle); }
+    void* Value(Handle* handle) override { return m_cache->Value(handle); }
+    void Erase(const leveldb::Slice& key) override { m_cache->Erase(key); }
+    uint64_t NewId() override { return m_cache->NewId(); }
+    void Prune() override { m_cache->Prune(); }
+    size_t TotalCharge() const override { return m_cache->TotalCharge(); }
+
+    uint64_t Hits() const { return m_hits.load(std::memory_order_relaxed); }
+    uint64_t Misses() const { return m_misses.load(std::memory_order_relaxed); }
+
+private:
+    std::unique_ptr<leveldb::Cache> m_cache;
+    std::atomic<uint64_t> m_hits{0};
+    std::atomic<uint64_t> m_misses{0};
+};
+
+/** leveldb settings of one database, adjusted with -dbtune=<name>:<option>=<value> */
+struct DBTuning
+{
+    int block_cache_pct{50}; //!< share of the cache for the block cache, the rest is split between two write buffers
+    int bloom_bits{10};
+    size_t block_size{4 * 1024};
+    bool compression{false};
+    int max_open_files{0}; //!< 0 keeps the platform default
+};
+
+static DBTuning GetTuning(const std::string& name)
+{
+    DBTuning tuning;
+    for (const std::string& arg : gArgs.GetArgs("-dbtune")) {
+        const size_t colon = arg.find(':');
+        const size_t equals = arg.find('=', colon);
+        if (colon == std::string::npos || equals == std::string::npos || arg.substr(0, colon) != name)
+            continue;
+        const std::string option = arg.substr(colon + 1, equals - colon - 1);
+        int64_t value;
+        if (!ParseInt64(arg.substr(equals + 1), &value) || value < 0) {
+            LogPrintf("Ignoring invalid -dbtune=%s\n", arg);
+            continue;
+        }
+        if (option == "blockcache")
+            tuning.block_cache_pct = std::min<int64_t>(value, 100);
+        else if (option == "bloombits")
+            tuning.bloom_bits = std::min<int64_t>(value, 64);
+        else if (option == "blocksize")
+            tuning.block_size = std::max<int64_t>(value, 1024);
+        else if (option == "compression")
+            tuning.compression = value != 0;
+        else if (option == "maxopenfiles")
+            tuning.max_open_files = value;
+        else
+            LogPrintf("Ignoring unknown -dbtune option %s\n", arg);
+    }
+    return tuning;
+}
+
+static leveldb::Options GetOptions(size_t nCacheSize, const std::string& name)
+{
+    const DBTuning tuning = GetTuning(name);
     leveldb::Options options;
-    options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
-    options.compression = leveldb::kNoCompression;
+    options.block_cache = new CountingCache(nCacheSize * tuning.block_cache_pct / 100);
+    // up to two write buffers may be held in memory simultaneously
+    options.write_buffer_size = std::max<size_t>(nCacheSize * (100 - tuning.block_cache_pct) / 200, 64 << 10);
+    options.filter_policy = tuning.bloom_bits > 0 ? leveldb::NewBloomFilterPolicy(tuning.bloom_bits) : nullptr;
+    options.block_size = tuning.block_size;
+    options.compression = tuning.compression ? leveldb::kSnappyCompression : leveldb::kNoCompression;
     options.info_log = new CBitcoinLevelDBLogger();
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
         // LevelDB versions before 1.16 consider short writes to be corruption. Only trigger error
@@ -111,9 +188,18 @@ static leveldb::Options GetOptions(size_t nCacheSize)
         options.paranoid_checks = true;
     }
     SetMaxOpenFiles(&options);
+    if (tuning.max_open_files > 0)
+        options.max_open_files = tuning.max_open_files;
+    LogPrint(BCLog::LEVELDB, "LevelDB %s using block_cache=%u write_buffer=%u bloom_bits=%d block_size=%u compression=%d\n",
+             name, nCacheSize * tuning.block_cache_pct / 100, options.write_buffer_size, tuning.bloom_bits,
+             options.block_size, tuning.compression);
     return options;
 }
 
+/** Open databases for GetAllStats */
+static Mutex g_dbwrappers_mutex;
+static std::set<const CDBWrapper*> g_dbwrappers GUARDED_BY(g_dbwrappers_mutex);
+
 CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate)
     : m_name(fs::basename(path))
 {
@@ -122,7 +208,7 @@ CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bo
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize);
+    options = GetOptions(nCacheSize, m_name);
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -164,10 +250,17 @@ CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bo
     }
 
     LogPrintf("Using obfuscation key for %s: %s\n", path.string(), HexStr(obfuscate_key));
+
+    LOCK(g_dbwrappers_mutex);
+    g_dbwrappers.insert(this);
 }
 
 CDBWrapper::~CDBWrapper()
 {
+    {
+        LOCK(g_dbwrappers_mutex);
+        g_dbwrappers.erase(this);
+    }
     delete pdb;
     pdb = nullptr;
     delete options.filter_policy;
@@ -187,7 +280,11 @@ bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync)
     if (log_memory) {
         mem_before = DynamicMemoryUsage() / 1024.0 / 1024;
     }
+    const int64_t nTimeStart = GetTimeMicros();
     leveldb::Status status = pdb->Write(fSync ? syncoptions : writeoptions, &batch.batch);
+    m_write_time_us.fetch_add(GetTimeMicros() - nTimeStart, std::memory_order_relaxed);
+    m_write_batches.fetch_add(1, std::memory_order_relaxed);
+    m_write_bytes.fetch_add(batch.SizeEstimate(), std::memory_order_relaxed);
     dbwrapper_private::HandleError(status);
     if (log_memory) {
         double mem_after = DynamicMemoryUsage() / 1024.0 / 1024;
@@ -206,6 +303,50 @@ size_t CDBWrapper::DynamicMemoryUsage() const {
     return stoul(memory);
 }
 
+CDBStats CDBWrapper::GetStats() const
+{
+    CDBStats stats;
+    stats.name = m_name;
+    const CountingCache* cache = static_cast<const CountingCache*>(options.block_cache);
+    stats.block_cache_size = cache->TotalCharge();
+    stats.write_buffer_size = options.write_buffer_size;
+    stats.bloom_bits = GetTuning(m_name).bloom_bits;
+    stats.block_size = options.block_size;
+    stats.compression = options.compression != leveldb::kNoCompression;
+    stats.max_open_files = options.max_open_files;
+    stats.reads = m_reads.load(std::memory_order_relaxed);
+    stats.cache_hits = cache->Hits();
+    stats.cache_misses = cache->Misses();
+    stats.write_batches = m_write_batches.load(std::memory_order_relaxed);
+    stats.write_bytes = m_write_bytes.load(std::memory_order_relaxed);
+    stats.write_time_us = m_write_time_us.load(std::memory_order_relaxed);
+    stats.memory_usage = DynamicMemoryUsage();
+
+    // The compaction table of leveldb.stats, three header lines and one line per level
+    std::string property;
+    if (pdb->GetProperty("leveldb.stats", &property)) {
+        std::istringstream lines(property);
+        std::string line;
+        for (int header = 0; header < 3 && std::getline(lines, line); ++header) {}
+        while (std::getline(lines, line)) {
+            CDBStats::Level level;
+            if (sscanf(line.c_str(), "%d %d %lf %lf %lf %lf", &level.level, &level.files, &level.size_mb,
+                       &level.compaction_sec, &level.read_mb, &level.write_mb) == 6)
+                stats.levels.push_back(level);
+        }
+    }
+    return stats;
+}
+
+std::vector<CDBStats> CDBWrapper::GetAllStats()
+{
+    std::vector<CDBStats> stats;
+    LOCK(g_dbwrappers_mutex);
+    for (const CDBWrapper* db : g_dbwrappers)
+        stats.push_back(db->GetStats());
+    return stats;
+}
+
 // Prefixed with null character to avoid collisions with other keys
 //
 // We must use a string constructor which specifies length so that we copy
@@ -233,6 +374,13 @@ bool CDBWrapper::IsEmpty()
     return !(it->Valid());
 }
 
+std::shared_ptr<const leveldb::Snapshot> CDBWrapper::GetSnapshot() const
+{
+    leveldb::DB* db = pdb;
+    return std::shared_ptr<const leveldb::Snapshot>(pdb->GetSnapshot(),
+        [db](const leveldb::Snapshot* snapshot) { db->ReleaseSnapshot(snapshot); });
+}
+
 CDBIterator::~CDBIterator() { delete piter; }
 bool CDBIterator::Valid() const { return piter->Valid(); }
 void CDBIterator::SeekToFirst() { piter->SeekToFirst(); }
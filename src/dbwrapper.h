@@ -16,6 +16,9 @@
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
 
+#include <atomic>
+#include <memory>
+
 static const size_t DBWRAPPER_PREALLOC_KEY_SIZE = 64;
 static const size_t DBWRAPPER_PREALLOC_VALUE_SIZE = 1024;
 
@@ -27,6 +30,37 @@ public:
 
 class CDBWrapper;
 
+/** Settings, counters and leveldb compaction statistics of one database */
+struct CDBStats
+{
+    struct Level
+    {
+        int level{0};
+        int files{0};
+        double size_mb{0};
+        double compaction_sec{0};
+        double read_mb{0};
+        double write_mb{0};
+    };
+
+    std::string name;
+    size_t block_cache_size{0};
+    size_t write_buffer_size{0};
+    int bloom_bits{0};
+    size_t block_size{0};
+    bool compression{false};
+    int max_open_files{0};
+
+    uint64_t reads{0};
+    uint64_t cache_hits{0};   //!< block cache lookups that found the block
+    uint64_t cache_misses{0};
+    uint64_t write_batches{0};
+    uint64_t write_bytes{0};
+    uint64_t write_time_us{0}; //!< time spent in writes, including write stalls
+    size_t memory_usage{0};
+    std::vector<Level> levels; //!< levels with files or compactions
+};
+
 /** These should be considered an implementation detail of the specific database.
  */
 namespace dbwrapper_private {
@@ -118,6 +152,8 @@ class CDBIterator
 {
 private:
     const CDBWrapper &parent;
+    //! kept until the iterator is deleted, which happens first
+    std::shared_ptr<const leveldb::Snapshot> snapshot;
     leveldb::Iterator *piter;
 
 public:
@@ -125,9 +161,11 @@ public:
     /**
      * @param[in] _parent          Parent CDBWrapper instance.
      * @param[in] _piter           The original leveldb iterator.
+     * @param[in] _snapshot        The snapshot the iterator reads, if any.
      */
-    CDBIterator(const CDBWrapper &_parent, leveldb::Iterator *_piter) :
-        parent(_parent), piter(_piter) { };
+    CDBIterator(const CDBWrapper &_parent, leveldb::Iterator *_piter,
+                std::shared_ptr<const leveldb::Snapshot> _snapshot = nullptr) :
+        parent(_parent), snapshot(std::move(_snapshot)), piter(_piter) { };
     ~CDBIterator();
 
     bool Valid() const;
@@ -201,6 +239,12 @@ private:
     //! the name of this database
     std::string m_name;
 
+    //! counters reported by GetStats
+    mutable std::atomic<uint64_t> m_reads{0};
+    std::atomic<uint64_t> m_write_batches{0};
+    std::atomic<uint64_t> m_write_bytes{0};
+    std::atomic<uint64_t> m_write_time_us{0};
+
     //! a key used for optional XOR-obfuscation of the database
     std::vector<unsigned char> obfuscate_key;
 
@@ -215,7 +259,8 @@ private:
 public:
     /**
      * @param[in] path        Location in the filesystem where leveldb data will be stored.
-     * @param[in] nCacheSize  Configures various leveldb cache settings.
+     * @param[in] nCacheSize  Configures various leveldb cache settings, see -dbtune for the
+     *                        per database split and options.
      * @param[in] fMemory     If true, use leveldb's memory environment.
      * @param[in] fWipe       If true, remove all existing data.
      * @param[in] obfuscate   If true, store data obfuscated via simple XOR. If false, XOR
@@ -236,6 +281,7 @@ public:
         leveldb::Slice slKey(ssKey.data(), ssKey.size());
 
         std::string strValue;
+        m_reads.fetch_add(1, std::memory_order_relaxed);
         leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
         if (!status.ok()) {
             if (status.IsNotFound())
@@ -270,6 +316,7 @@ public:
         leveldb::Slice slKey(ssKey.data(), ssKey.size());
 
         std::string strValue;
+        m_reads.fetch_add(1, std::memory_order_relaxed);
         leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
         if (!status.ok()) {
             if (status.IsNotFound())
@@ -293,6 +340,12 @@ public:
     // Get an estimate of LevelDB memory usage (in bytes).
     size_t DynamicMemoryUsage() const;
 
+    //! Settings, counters and compaction statistics of this database
+    CDBStats GetStats() const;
+
+    //! Statistics of all open databases
+    static std::vector<CDBStats> GetAllStats();
+
     // not available for LevelDB; provide for compatibility with BDB
     bool Flush()
     {
@@ -310,6 +363,21 @@ public:
         return new CDBIterator(*this, pdb->NewIterator(iteroptions));
     }
 
+    /**
+     * Pins the current state of the database until the last copy of the snapshot is
+     * released, which has to happen before the database is closed.
+     */
+    std::shared_ptr<const leveldb::Snapshot> GetSnapshot() const;
+
+    //! Iterator over the state of the database at the snapshot, writes made after the
+    //! snapshot was taken aren't seen
+    CDBIterator *NewIterator(const std::shared_ptr<const leveldb::Snapshot>& snapshot)
+    {
+        leveldb::ReadOptions options = iteroptions;
+        options.snapshot = snapshot.get();
+        return new CDBIterator(*this, pdb->NewIterator(options), snapshot);
+    }
+
     /**
      * Return true if the database managed by this class contains no entries.
      */
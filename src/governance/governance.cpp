@@ -3,3 +3,160 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "governance.h"
+
+#include <checkqueue.h>
+#include <coins.h>
+#include <limitedmap.h>
+#include <memusage.h>
+
+#include <unordered_map>
+
+namespace gov {
+
+Mutex muVoteKeys;
+limitedmap<uint256, VoteKey> mapVoteKeys GUARDED_BY(muVoteKeys){MAX_VOTE_KEY_CACHE};
+uint64_t nVoteKeySequence GUARDED_BY(muVoteKeys){0};
+
+bool GetCachedVoteKey(const uint256 & entry, VoteKey & keyRet) {
+    LOCK(muVoteKeys);
+    auto it = mapVoteKeys.find(entry);
+    if (it == mapVoteKeys.end())
+        return false;
+    keyRet = it->second;
+    return true;
+}
+
+void CacheVoteKey(const uint256 & entry, VoteKey key) {
+    LOCK(muVoteKeys);
+    if (mapVoteKeys.count(entry))
+        return;
+    key.sequence = ++nVoteKeySequence;
+    mapVoteKeys.insert(std::make_pair(entry, key));
+}
+
+size_t VoteKeyCacheUsage(size_t & entriesRet) {
+    LOCK(muVoteKeys);
+    entriesRet = mapVoteKeys.size();
+    // limitedmap keeps an entry in its map and its reverse lookup by value
+    typedef std::map<uint256, VoteKey>::iterator VoteKeyIt;
+    return entriesRet * (memusage::MallocUsage(sizeof(memusage::stl_tree_node<std::pair<const uint256, VoteKey>>))
+                       + memusage::MallocUsage(sizeof(memusage::stl_tree_node<std::pair<const VoteKey, VoteKeyIt>>)));
+}
+
+/**
+ * Spent state of vote utxos, valid for the coins tip and mempool sequence it was
+ * looked up at.
+ */
+struct VoteSpentCache {
+    uint256 tip;
+    unsigned int mempoolSequence{0};
+    std::unordered_map<COutPoint, bool, SaltedOutpointHasher> spent;
+};
+
+Mutex muVoteSpent;
+VoteSpentCache voteSpentCache[2] GUARDED_BY(muVoteSpent); // without and with the mempool check
+
+static void LookupVoteUtxos(const CCoinsView & view, const CTxMemPool * pool, const std::vector<COutPoint> & utxos,
+                            std::vector<char> & spentRet) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    const uint256 tip = pcoinsTip->GetBestBlock();
+    const unsigned int sequence = pool ? pool->GetTransactionsUpdated() : 0;
+    LOCK(muVoteSpent);
+    auto & cache = voteSpentCache[pool ? 1 : 0];
+    if (cache.tip != tip || cache.mempoolSequence != sequence) {
+        cache.spent.clear();
+        cache.tip = tip;
+        cache.mempoolSequence = sequence;
+    }
+    Coin coin;
+    for (size_t i = 0; i < utxos.size(); ++i) {
+        auto it = cache.spent.find(utxos[i]);
+        if (it != cache.spent.end()) {
+            spentRet[i] = it->second;
+            continue;
+        }
+        const bool spent = !view.GetCoin(utxos[i], coin) || (pool && pool->isSpent(utxos[i]));
+        if (cache.spent.size() < MAX_VOTE_SPENT_CACHE)
+            cache.spent.emplace(utxos[i], spent);
+        spentRet[i] = spent;
+    }
+}
+
+void CheckVoteUtxosSpent(const std::vector<COutPoint> & utxos, std::vector<char> & spentRet, const bool mempoolCheck) {
+    spentRet.assign(utxos.size(), 0);
+    if (utxos.empty())
+        return;
+    LOCK(cs_main);
+    if (!mempoolCheck) {
+        LookupVoteUtxos(*pcoinsTip, nullptr, utxos, spentRet);
+        return;
+    }
+    LOCK(mempool.cs);
+    CCoinsViewMemPool view(pcoinsTip.get(), mempool);
+    LookupVoteUtxos(view, &mempool, utxos, spentRet);
+}
+
+static CCheckQueue<VoteCheck> votecheckqueue(128);
+
+void ThreadVoteCheck() {
+    RenameThread("blocknet-votech");
+    votecheckqueue.Thread();
+}
+
+void PrecheckVotes(const CBlock & block) {
+    if (!nScriptCheckThreads)
+        return;
+    std::vector<VoteCheck> vChecks;
+    for (const auto & tx : block.vtx) {
+        if (tx->IsCoinBase())
+            continue;
+        for (const auto & out : tx->vout) {
+            Span<const unsigned char> data;
+            if (!GetGovernancePayload(out.scriptPubKey, data) || data[1] != VOTE)
+                continue;
+            Vote vote;
+            try {
+                SpanReader ss(SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_VOTE_NO_KEY, data);
+                ss >> vote;
+            } catch (const std::exception &) {
+                continue; // malformed vote data
+            }
+            VoteKey key;
+            if (GetCachedVoteKey(vote.keyCacheEntry(), key))
+                continue;
+            vChecks.emplace_back(std::move(vote));
+        }
+    }
+    if (vChecks.size() < 2)
+        return; // nothing to run in parallel
+    CCheckQueueControl<VoteCheck> control(&votecheckqueue);
+    control.Add(vChecks);
+    control.Wait();
+}
+
+void SignVotes(std::vector<Vote> & votes, const std::vector<const CKey*> & keys, std::vector<char> & signedRet) {
+    signedRet.assign(votes.size(), 0);
+    const int count = static_cast<int>(votes.size());
+    const int cores = std::max(1, std::min(GetNumCores(), count / 8)); // small batches aren't worth the threads
+    const int slice = count / cores;
+    auto sign = [&votes,&keys,&signedRet](const int start, const int end) {
+        for (int i = start; i < end; ++i)
+            signedRet[i] = votes[i].sign(*keys[i]) ? 1 : 0;
+    };
+    if (cores == 1) {
+        sign(0, count);
+        return;
+    }
+    boost::thread_group tg;
+    for (int k = 0; k < cores; ++k) {
+        const int start = k*slice;
+        const int end = k == cores-1 ? count : start+slice;
+        tg.create_thread([start,end,&sign] {
+            RenameThread("blocknet-votesign");
+            sign(start, end);
+        });
+    }
+    tg.join_all();
+}
+
+}
@@ -6,28 +6,42 @@
 #define BLOCKNET_GOVERNANCE_H
 
 #include <amount.h>
+#include <blockfilemap.h>
 #include <consensus/params.h>
 #include <consensus/validation.h>
+#include <crypto/common.h>
+#include <dbwrapper.h>
 #include <hash.h>
+#include <index/txindex.h>
 #include <key_io.h>
+#include <memusage.h>
 #include <net.h>
 #include <policy/policy.h>
 #include <script/standard.h>
 #include <shutdown.h>
+#include <span.h>
 #include <streams.h>
 #include <txmempool.h>
+#include <ui_interface.h>
 #include <uint256.h>
+#include <util/memory.h>
 #include <util/moneystr.h>
 #include <validation.h>
 #include <wallet/coincontrol.h>
 #include <wallet/fees.h>
 #include <wallet/wallet.h>
 
+#include <array>
+#include <atomic>
+#include <limits>
+#include <memory>
 #include <regex>
 #include <string>
+#include <unordered_map>
 #include <utility>
 
 #include <boost/algorithm/string.hpp>
+#include <boost/signals2/signal.hpp>
 #include <boost/thread.hpp>
 
 /**
@@ -66,24 +80,70 @@ static VinHash makeVinHash(const COutPoint & prevout) {
 }
 
 /**
- * Return the CKeyID for the specified utxo.
+ * Return the CKeyID and the output for the specified utxo. Unspent utxos are read from the
+ * coins tip, spent utxos require a transaction lookup.
  * @param utxo
+ * @param txOutRet
  * @param keyid
+ * @param txindexOnly Only search the txindex, this doesn't require cs_main
  * @return
  */
-static bool GetKeyIDForUTXO(const COutPoint & utxo, CTransactionRef & tx, CKeyID & keyid) {
-    uint256 hashBlock;
-    if (!GetTransaction(utxo.hash, tx, Params().GetConsensus(), hashBlock))
-        return false;
-    if (utxo.n >= tx->vout.size())
-        return false;
+static bool GetKeyIDForUTXO(const COutPoint & utxo, CTxOut & txOutRet, CKeyID & keyid, const bool txindexOnly = false) {
+    if (txindexOnly || !GetCoinFunc(utxo, txOutRet)) {
+        CTransactionRef tx;
+        uint256 hashBlock;
+        if (txindexOnly) {
+            if (!g_txindex || !g_txindex->FindTx(utxo.hash, hashBlock, tx))
+                return false;
+        } else if (!GetTransaction(utxo.hash, tx, Params().GetConsensus(), hashBlock))
+            return false;
+        if (utxo.n >= tx->vout.size())
+            return false;
+        txOutRet = tx->vout[utxo.n];
+    }
     CTxDestination dest;
-    if (!ExtractDestination(tx->vout[utxo.n].scriptPubKey, dest))
+    if (!ExtractDestination(txOutRet.scriptPubKey, dest))
+        return false;
+    const auto *id = boost::get<CKeyID>(&dest);
+    if (!id)
         return false;
-    keyid = *boost::get<CKeyID>(&dest);
+    keyid = *id;
     return true;
 }
 
+/**
+ * Serialization version flag that skips loading a vote's key on read.
+ */
+static const int SERIALIZE_VOTE_NO_KEY = 0x20000000;
+static const size_t MAX_VOTE_KEY_CACHE = 50000;
+static const size_t MAX_VOTE_SPENT_CACHE = 100000;
+
+/**
+ * Key data of a vote recovered from its signature and utxo.
+ */
+struct VoteKey {
+    CPubKey pubkey;
+    CKeyID keyid;
+    CAmount amount{0};
+    uint64_t sequence{0}; // cache insertion order, oldest entries are evicted first
+    friend bool operator<(const VoteKey & a, const VoteKey & b) { return a.sequence < b.sequence; }
+};
+
+/**
+ * Returns true if the vote key for the specified cache entry is known.
+ * @param entry Vote key cache entry, see Vote::keyCacheEntry()
+ * @param keyRet
+ * @return
+ */
+bool GetCachedVoteKey(const uint256 & entry, VoteKey & keyRet);
+
+/**
+ * Caches a verified vote key.
+ * @param entry Vote key cache entry, see Vote::keyCacheEntry()
+ * @param key
+ */
+void CacheVoteKey(const uint256 & entry, VoteKey key);
+
 /**
  * Returns the next superblock from the most recent chain tip by default.
  * If fromBlock is specified the superblock immediately after fromBlock
@@ -145,6 +205,51 @@ protected:
     uint8_t type{NONE};
 };
 
+/**
+ * Finds the governance data in an OP_RETURN script without copying it. The governance
+ * data is the first non-empty push in the script and must begin with the network
+ * version and a governance type, all other scripts are rejected.
+ * @param script
+ * @param payloadRet Span over the governance data in the script
+ * @return
+ */
+static bool GetGovernancePayload(const CScript & script, Span<const unsigned char> & payloadRet) {
+    // OP_RETURN + push opcode + version + type
+    if (script.size() < 4 || script[0] != OP_RETURN)
+        return false;
+    const unsigned char *pc = script.data() + 1;
+    const unsigned char *end = script.data() + script.size();
+    while (pc < end) {
+        const unsigned int opcode = *pc++;
+        unsigned int size{0};
+        if (opcode < OP_PUSHDATA1) {
+            size = opcode;
+        } else if (opcode == OP_PUSHDATA1) {
+            if (end - pc < 1)
+                return false;
+            size = *pc++;
+        } else if (opcode == OP_PUSHDATA2) {
+            if (end - pc < 2)
+                return false;
+            size = ReadLE16(pc);
+            pc += 2;
+        } else if (opcode == OP_PUSHDATA4) {
+            if (end - pc < 4)
+                return false;
+            size = ReadLE32(pc);
+            pc += 4;
+        } else
+            continue; // no data in non-push opcodes
+        if (static_cast<unsigned int>(end - pc) < size)
+            return false;
+        if (size == 0)
+            continue;
+        payloadRet = Span<const unsigned char>(pc, size);
+        return size >= 2 && pc[0] == NETWORK_VERSION && (pc[1] == PROPOSAL || pc[1] == VOTE);
+    }
+    return false;
+}
+
 /**
  * Proposals encapsulate the data required by the network to support voting and payments.
  * They can be created by anyone willing to pay the submission fee.
@@ -292,6 +397,8 @@ public:
         READWRITE(name);
         READWRITE(url);
         READWRITE(description);
+        if (s.GetType() & SER_DISK) // memory only fields are persisted in the governance checkpoint
+            READWRITE(blockNumber);
     }
 
 protected:
@@ -515,10 +622,19 @@ public:
      */
     uint256 getHash() const {
         CHashWriter ss(SER_GETHASH, 0);
-        ss << version << type << proposal << utxo; // exclude vote from hash to properly handle changing votes
+        writeHashData(ss);
         return ss.GetHash();
     }
 
+    /**
+     * Writes the data covered by the vote hash, e.g. to a CHashBatch.
+     * @param s
+     */
+    template <typename Stream>
+    void writeHashData(Stream & s) const {
+        s << version << type << proposal << utxo; // exclude vote from hash to properly handle changing votes
+    }
+
     /**
      * Proposal signature hash
      * @return
@@ -590,10 +706,53 @@ public:
         READWRITE(utxo);
         READWRITE(vinhash);
         READWRITE(signature);
-        if (ser_action.ForRead()) { // assign memory only fields
-            pubkey.RecoverCompact(sigHash(), signature);
-            loadKeyID();
+        if (s.GetType() & SER_DISK) { // memory only fields are persisted in the governance checkpoint
+            READWRITE(pubkey);
+            READWRITE(outpoint);
+            READWRITE(time);
+            READWRITE(amount);
+            READWRITE(keyid);
+            READWRITE(blockNumber);
+            READWRITE(spentBlock);
+            READWRITE(spentHash);
+        } else if (ser_action.ForRead() && !(s.GetVersion() & SERIALIZE_VOTE_NO_KEY)) { // assign memory only fields
+            loadKey();
+        }
+    }
+
+    /**
+     * Hash identifying the vote's signature in the vote key cache.
+     * @return
+     */
+    uint256 keyCacheEntry() const {
+        CHashWriter ss(SER_GETHASH, 0);
+        ss << sigHash() << signature;
+        return ss.GetHash();
+    }
+
+    /**
+     * Recover the pubkey from the signature and load the keyid and amount of the vote's
+     * utxo. Previously verified keys are read from the vote key cache.
+     * @param txindexOnly Only search the txindex for the vote's utxo, this doesn't require cs_main
+     */
+    void loadKey(const bool txindexOnly = false) {
+        const auto entry = keyCacheEntry();
+        VoteKey key;
+        if (GetCachedVoteKey(entry, key)) {
+            pubkey = key.pubkey;
+            keyid = key.keyid;
+            amount = key.amount;
+            return;
         }
+        pubkey.RecoverCompact(sigHash(), signature);
+        CTxOut out;
+        if (!GetKeyIDForUTXO(utxo, out, keyid, txindexOnly))
+            return; // not cached, utxo may not be indexed yet
+        amount = out.nValue;
+        key.pubkey = pubkey;
+        key.keyid = keyid;
+        key.amount = amount;
+        CacheVoteKey(entry, key);
     }
 
 protected:
@@ -610,11 +769,14 @@ protected:
      * Load the keyid and amount.
      */
     void loadKeyID() {
-        CTransactionRef tx;
-        if (GetKeyIDForUTXO(utxo, tx, keyid))
-            amount = tx->vout[utxo.n].nValue;
+        CTxOut out;
+        if (GetKeyIDForUTXO(utxo, out, keyid))
+            amount = out.nValue;
     }
 
+protected:
+    friend class VoteStore;
+
 protected:
     uint8_t version{NETWORK_VERSION};
     uint8_t type{VOTE};
@@ -635,6 +797,58 @@ protected: // memory only
     uint256 spentHash; // tx hash where this vote's utxo was spent (which invalidates it)
 };
 
+/**
+ * Loads the key of a vote on the vote check threads. Results are stored in the vote key cache.
+ */
+class VoteCheck {
+public:
+    VoteCheck() = default;
+    explicit VoteCheck(Vote vote) : vote(std::move(vote)) {}
+
+    bool operator()() {
+        vote.loadKey(true);
+        return true; // invalid votes are rejected by the serial checks
+    }
+
+    void swap(VoteCheck & check) {
+        std::swap(vote, check.vote);
+    }
+
+protected:
+    Vote vote;
+};
+
+/**
+ * Vote check thread, verifies vote signatures in parallel.
+ */
+void ThreadVoteCheck();
+
+/**
+ * Loads the keys of all votes in the block that aren't in the vote key cache on the
+ * vote check threads. This warms the vote key cache ahead of processing the block.
+ * @param block
+ */
+void PrecheckVotes(const CBlock & block);
+
+/**
+ * Signs the votes in parallel, each vote with the key at the same position. The
+ * result of each signing is stored at the same position in signedRet.
+ * @param votes
+ * @param keys
+ * @param signedRet
+ */
+void SignVotes(std::vector<Vote> & votes, const std::vector<const CKey*> & keys, std::vector<char> & signedRet);
+
+/**
+ * Checks that the vote utxos aren't already spent, taking cs_main and the mempool lock
+ * once for all of them. Results are cached until the coins tip or the mempool changes.
+ * The result of each utxo is stored at the same position in spentRet.
+ * @param utxos
+ * @param spentRet
+ * @param mempoolCheck Will check the mempool for spent votes
+ */
+void CheckVoteUtxosSpent(const std::vector<COutPoint> & utxos, std::vector<char> & spentRet, const bool mempoolCheck = true);
+
 /**
  * Check that utxo isn't already spent
  * @param vote
@@ -642,18 +856,9 @@ protected: // memory only
  * @return
  */
 static bool IsVoteSpent(const Vote & vote, const bool & mempoolCheck = true) {
-    Coin coin;
-    if (mempoolCheck) {
-        LOCK2(cs_main, mempool.cs);
-        CCoinsViewMemPool view(pcoinsTip.get(), mempool);
-        if (!view.GetCoin(vote.getUtxo(), coin) || mempool.isSpent(vote.getUtxo()))
-            return true;
-    } else {
-        LOCK(cs_main);
-        if (!pcoinsTip->GetCoin(vote.getUtxo(), coin))
-            return true;
-    }
-    return false;
+    std::vector<char> spent;
+    CheckVoteUtxosSpent({vote.getUtxo()}, spent, mempoolCheck);
+    return spent[0] != 0;
 }
 
 /**
@@ -684,6 +889,498 @@ struct Tally {
     }
 };
 
+/**
+ * Status filter of the proposal listing. Passing proposals are part of the results of their
+ * superblock, for past superblocks these are the proposals that were paid.
+ */
+enum ProposalStatus : uint8_t {
+    PROPOSAL_ANY = 0,
+    PROPOSAL_PASSING = 1,
+    PROPOSAL_FAILING = 2,
+};
+
+/**
+ * Filter and page of a proposal listing. Proposals are listed in superblock and hash order,
+ * the page starts after the proposal "after" (null for the first page).
+ */
+struct ProposalQuery {
+    int fromSuperblock{0};
+    int toSuperblock{std::numeric_limits<int>::max()};
+    ProposalStatus status{PROPOSAL_ANY};
+    std::string namePrefix;
+    uint256 after;
+    size_t limit{0}; // 0 lists all matching proposals
+};
+
+/**
+ * Proposal of a listing with its tally.
+ */
+struct ProposalListing {
+    Proposal proposal;
+    Tally tally;
+    bool passing{false};
+};
+
+static const char DB_GOV_BEST_BLOCK = 'B';
+static const char DB_GOV_PROPOSAL = 'p';
+static const char DB_GOV_VOTE = 'v';
+static const char DB_GOV_ARCHIVE = 'a';
+/**
+ * Votes read by the parallel loader before their proposal are held until the shard
+ * reading the proposal catches up. Votes beyond the limit are dropped.
+ */
+static const size_t MAX_ORPHAN_VOTES = 500000;
+static const size_t GOVERNANCE_DB_CACHE = 2 << 20;
+
+/**
+ * Archive key of a block, the height is big endian so that the records are stored in
+ * height order.
+ */
+struct GovernanceArchiveKey {
+    int height{0};
+
+    GovernanceArchiveKey() = default;
+    explicit GovernanceArchiveKey(const int & h) : height(h) {}
+
+    template<typename Stream>
+    void Serialize(Stream & s) const {
+        ser_writedata8(s, DB_GOV_ARCHIVE);
+        ser_writedata32be(s, static_cast<uint32_t>(height));
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream & s) {
+        if (ser_readdata8(s) != DB_GOV_ARCHIVE)
+            throw std::ios_base::failure("Invalid format for governance archive key");
+        height = static_cast<int>(ser_readdata32be(s));
+    }
+};
+
+/**
+ * The governance changes of a block as processed on the chain tip: the proposals and votes
+ * it added and the spent vote utxos. Replaying the records of consecutive blocks on top of
+ * the governance state of the block before them gives the state after them without reading
+ * the blocks.
+ */
+struct GovernanceBlockRecord {
+    uint256 blockHash;
+    std::vector<Proposal> proposals;
+    std::vector<Vote> votes;
+    std::vector<std::pair<COutPoint, uint256>> spends; // vote utxo, spending tx
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(blockHash);
+        READWRITE(proposals);
+        READWRITE(votes);
+        READWRITE(spends);
+    }
+};
+
+/**
+ * Leveldb checkpoint of the governance state. Stores all known proposals and votes (including
+ * their spent state) as of a specific block, allowing the governance data to be loaded from
+ * the checkpoint instead of reading every block since the governance block. The database
+ * also archives the governance changes of each block connected on the chain tip, which
+ * loadGovernanceData replays instead of reading the blocks after the checkpoint.
+ */
+class GovernanceDB : public CDBWrapper {
+public:
+    explicit GovernanceDB(size_t cacheSize, bool memory = false, bool wipe = false)
+        : CDBWrapper(GetDataDir() / "governance", cacheSize, memory, wipe) {}
+
+    /**
+     * Reads the checkpoint. Returns false if no checkpoint exists.
+     * @param heightRet Height of the checkpoint block
+     * @param hashRet Hash of the checkpoint block
+     * @param proposalsRet
+     * @param votesRet
+     * @return
+     */
+    bool ReadCheckpoint(int & heightRet, uint256 & hashRet, std::map<uint256, Proposal> & proposalsRet,
+                        std::map<uint256, Vote> & votesRet)
+    {
+        std::pair<int, uint256> best;
+        if (!Read(DB_GOV_BEST_BLOCK, best))
+            return false;
+        std::unique_ptr<CDBIterator> pcursor(NewIterator());
+        for (pcursor->Seek(std::make_pair(DB_GOV_PROPOSAL, uint256())); pcursor->Valid(); pcursor->Next()) {
+            std::pair<char, uint256> key;
+            if (!pcursor->GetKey(key) || key.first != DB_GOV_PROPOSAL)
+                break;
+            Proposal proposal;
+            if (!pcursor->GetValue(proposal))
+                return error("%s: failed to read governance proposal %s", __func__, key.second.ToString());
+            proposalsRet[key.second] = proposal;
+        }
+        for (pcursor->Seek(std::make_pair(DB_GOV_VOTE, uint256())); pcursor->Valid(); pcursor->Next()) {
+            std::pair<char, uint256> key;
+            if (!pcursor->GetKey(key) || key.first != DB_GOV_VOTE)
+                break;
+            Vote vote;
+            if (!pcursor->GetValue(vote))
+                return error("%s: failed to read governance vote %s", __func__, key.second.ToString());
+            votesRet[key.second] = vote;
+        }
+        heightRet = best.first;
+        hashRet = best.second;
+        return true;
+    }
+
+    /**
+     * Replaces the checkpoint with the specified governance state.
+     * @param height Height of the block the state corresponds to
+     * @param hash Hash of the block the state corresponds to
+     * @param ps
+     * @param vs
+     * @return
+     */
+    bool WriteCheckpoint(const int & height, const uint256 & hash, const std::map<uint256, Proposal> & ps,
+                         const std::map<uint256, Vote> & vs)
+    {
+        CDBBatch batch(*this);
+        std::unique_ptr<CDBIterator> pcursor(NewIterator());
+        for (pcursor->Seek(std::make_pair(DB_GOV_PROPOSAL, uint256())); pcursor->Valid(); pcursor->Next()) {
+            std::pair<char, uint256> key;
+            if (!pcursor->GetKey(key) || key.first != DB_GOV_PROPOSAL)
+                break;
+            if (!ps.count(key.second))
+                batch.Erase(key);
+        }
+        for (pcursor->Seek(std::make_pair(DB_GOV_VOTE, uint256())); pcursor->Valid(); pcursor->Next()) {
+            std::pair<char, uint256> key;
+            if (!pcursor->GetKey(key) || key.first != DB_GOV_VOTE)
+                break;
+            if (!vs.count(key.second))
+                batch.Erase(key);
+        }
+        for (const auto & item : ps)
+            batch.Write(std::make_pair(DB_GOV_PROPOSAL, item.first), item.second);
+        for (const auto & item : vs)
+            batch.Write(std::make_pair(DB_GOV_VOTE, item.first), item.second);
+        batch.Write(DB_GOV_BEST_BLOCK, std::make_pair(height, hash));
+        return WriteBatch(batch, true);
+    }
+
+    /**
+     * Reads the archive record of the block at the specified height. Returns false if
+     * there is none.
+     * @param height
+     * @param recordRet
+     * @return
+     */
+    bool ReadBlockRecord(const int & height, GovernanceBlockRecord & recordRet) const {
+        return Read(GovernanceArchiveKey(height), recordRet);
+    }
+
+    /**
+     * Writes the archive record of the block at the specified height, replacing the record
+     * of a block at the same height that was disconnected.
+     * @param height
+     * @param record
+     * @return
+     */
+    bool WriteBlockRecord(const int & height, const GovernanceBlockRecord & record) {
+        return Write(GovernanceArchiveKey(height), record);
+    }
+};
+
+/**
+ * Compact in-memory storage of the governance votes. Votes are kept in a slot arena with
+ * their proposal hash and pubkey interned and their compact signature stored in a
+ * fixed-size array. Votes are decoded on access.
+ */
+class VoteStore {
+public:
+    typedef std::array<unsigned char, CPubKey::COMPACT_SIGNATURE_SIZE> Signature;
+
+    bool contains(const uint256 & hash) const {
+        return slots.count(hash) > 0;
+    }
+
+    size_t size() const {
+        return slots.size();
+    }
+
+    bool empty() const {
+        return slots.empty();
+    }
+
+    /**
+     * Removes all votes and releases the arena and the interned ids.
+     */
+    void clear() {
+        slots.clear();
+        std::vector<CompactVote>().swap(arena);
+        std::vector<uint32_t>().swap(freeSlots);
+        std::vector<uint256>().swap(proposalHashes);
+        proposalIds.clear();
+        std::vector<VoteKeyId>().swap(keys);
+        keyIds.clear();
+    }
+
+    /**
+     * Decodes the vote with the specified hash. Returns false if the vote isn't stored.
+     * @param hash
+     * @param voteRet
+     * @return
+     */
+    bool get(const uint256 & hash, Vote & voteRet) const {
+        auto it = slots.find(hash);
+        if (it == slots.end())
+            return false;
+        const auto & cv = arena[it->second];
+        voteRet = Vote{};
+        voteRet.proposal = proposalHashes[cv.proposal];
+        voteRet.vote = cv.vote;
+        voteRet.vinhash = cv.vinhash;
+        voteRet.signature.assign(cv.signature.begin(), cv.signature.end());
+        voteRet.utxo = cv.utxo;
+        voteRet.pubkey = keys[cv.key].first;
+        voteRet.keyid = keys[cv.key].second;
+        voteRet.outpoint = cv.outpoint;
+        voteRet.time = cv.time;
+        voteRet.amount = cv.amount;
+        voteRet.blockNumber = cv.blockNumber;
+        voteRet.spentBlock = cv.spentBlock;
+        voteRet.spentHash = cv.spentHash;
+        return true;
+    }
+
+    /**
+     * Adds or replaces the vote. Returns false if the vote can't be encoded, i.e. it
+     * doesn't have a compact signature.
+     * @param vote
+     * @return
+     */
+    bool set(const Vote & vote) {
+        return set(vote, vote.getHash());
+    }
+
+    /**
+     * Adds or replaces the vote stored under the vote's precomputed hash.
+     * @param vote
+     * @param hash
+     * @return
+     */
+    bool set(const Vote & vote, const uint256 & hash) {
+        if (vote.version != NETWORK_VERSION || vote.type != VOTE || vote.signature.size() != std::tuple_size<Signature>::value
+            || vote.time < 0 || vote.time > std::numeric_limits<uint32_t>::max())
+            return false;
+        CompactVote cv;
+        cv.spentHash = vote.spentHash;
+        cv.utxo = vote.utxo;
+        cv.outpoint = vote.outpoint;
+        cv.amount = vote.amount;
+        std::copy(vote.signature.begin(), vote.signature.end(), cv.signature.begin());
+        cv.vinhash = vote.vinhash;
+        cv.proposal = internProposal(vote.proposal);
+        cv.key = internKey(vote.pubkey, vote.keyid);
+        cv.time = static_cast<uint32_t>(vote.time);
+        cv.blockNumber = vote.blockNumber;
+        cv.spentBlock = vote.spentBlock;
+        cv.vote = vote.vote;
+        auto it = slots.find(hash);
+        if (it != slots.end()) {
+            arena[it->second] = cv;
+        } else if (!freeSlots.empty()) {
+            arena[freeSlots.back()] = cv;
+            slots[hash] = freeSlots.back();
+            freeSlots.pop_back();
+        } else {
+            slots[hash] = static_cast<uint32_t>(arena.size());
+            arena.push_back(cv);
+        }
+        return true;
+    }
+
+    /**
+     * Removes the vote, its slot is reused by the next vote.
+     * @param hash
+     */
+    void erase(const uint256 & hash) {
+        auto it = slots.find(hash);
+        if (it == slots.end())
+            return;
+        freeSlots.push_back(it->second);
+        slots.erase(it);
+    }
+
+    /**
+     * Returns the proposal hash of the vote or a null hash if the vote isn't stored.
+     * @param hash
+     * @return
+     */
+    uint256 getProposal(const uint256 & hash) const {
+        auto it = slots.find(hash);
+        if (it == slots.end())
+            return uint256();
+        return proposalHashes[arena[it->second].proposal];
+    }
+
+    /**
+     * Returns true if the vote is stored and spent.
+     * @param hash
+     * @return
+     */
+    bool spent(const uint256 & hash) const {
+        auto it = slots.find(hash);
+        return it != slots.end() && arena[it->second].spentBlock > 0;
+    }
+
+    /**
+     * Marks the vote as spent, see Vote::spend.
+     * @param hash
+     * @param block
+     * @param txhash
+     */
+    void spend(const uint256 & hash, const int & block, const uint256 & txhash) {
+        auto it = slots.find(hash);
+        if (it == slots.end())
+            return;
+        auto & cv = arena[it->second];
+        cv.spentBlock = block;
+        cv.spentHash = txhash;
+    }
+
+    /**
+     * Unspends the vote, see Vote::unspend.
+     * @param hash
+     * @param block
+     * @param txhash
+     * @return
+     */
+    bool unspend(const uint256 & hash, const int & block, const uint256 & txhash) {
+        auto it = slots.find(hash);
+        if (it == slots.end())
+            return false;
+        auto & cv = arena[it->second];
+        if (cv.spentBlock == block && cv.spentHash == txhash) {
+            cv.spentBlock = 0;
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * Decodes each vote and passes it to the specified function.
+     * @param f Called with the vote hash and the decoded vote
+     */
+    template <typename F>
+    void forEach(F f) const {
+        Vote vote;
+        for (const auto & item : slots) {
+            get(item.first, vote);
+            f(item.first, vote);
+        }
+    }
+
+    /**
+     * Decodes all votes.
+     * @return
+     */
+    std::map<uint256, Vote> all() const {
+        std::map<uint256, Vote> vs;
+        forEach([&vs](const uint256 & hash, const Vote & vote) { vs.emplace(hash, vote); });
+        return vs;
+    }
+
+    /**
+     * Bytes allocated by the arena, the slot lookup and the interned ids.
+     * @return
+     */
+    size_t DynamicMemoryUsage() const {
+        return memusage::DynamicUsage(slots) + memusage::DynamicUsage(arena) + memusage::DynamicUsage(freeSlots)
+             + memusage::DynamicUsage(proposalHashes) + memusage::DynamicUsage(proposalIds)
+             + memusage::DynamicUsage(keys) + memusage::DynamicUsage(keyIds);
+    }
+
+protected:
+    typedef std::pair<CPubKey, CKeyID> VoteKeyId;
+
+    struct CompactVote {
+        uint256 spentHash;
+        COutPoint utxo;
+        COutPoint outpoint;
+        CAmount amount{0};
+        Signature signature;
+        VinHash vinhash;
+        uint32_t proposal{0}; // index into proposalHashes
+        uint32_t key{0}; // index into keys
+        uint32_t time{0};
+        int32_t blockNumber{0};
+        int32_t spentBlock{0};
+        uint8_t vote{ABSTAIN};
+    };
+
+    // Interned ids are kept until the store is cleared, there are far fewer
+    // proposals and voting keys than votes.
+    uint32_t internProposal(const uint256 & hash) {
+        auto it = proposalIds.find(hash);
+        if (it != proposalIds.end())
+            return it->second;
+        proposalHashes.push_back(hash);
+        return proposalIds[hash] = static_cast<uint32_t>(proposalHashes.size() - 1);
+    }
+
+    uint32_t internKey(const CPubKey & pubkey, const CKeyID & keyid) {
+        const VoteKeyId key{pubkey, keyid};
+        auto it = keyIds.find(key);
+        if (it != keyIds.end())
+            return it->second;
+        keys.push_back(key);
+        return keyIds[key] = static_cast<uint32_t>(keys.size() - 1);
+    }
+
+protected:
+    std::unordered_map<uint256, uint32_t, SaltedTxidHasher> slots; // vote hash -> arena slot
+    std::vector<CompactVote> arena;
+    std::vector<uint32_t> freeSlots;
+    std::vector<uint256> proposalHashes;
+    std::map<uint256, uint32_t> proposalIds;
+    std::vector<VoteKeyId> keys;
+    std::map<VoteKeyId, uint32_t> keyIds;
+};
+
+/**
+ * Estimated memory usage of the governance manager.
+ */
+struct GovernanceMemoryUsage {
+    size_t proposals{0};
+    size_t votes{0};
+    size_t voteKeys{0};
+    size_t proposalsUsage{0}; // bytes
+    size_t votesUsage{0};
+    size_t indexUsage{0};
+    size_t cacheUsage{0}; // cached tallies and superblock results
+    size_t voteKeysUsage{0};
+};
+
+/**
+ * Returns the number of entries and the estimated bytes used by the vote key cache.
+ * @param entriesRet
+ * @return
+ */
+size_t VoteKeyCacheUsage(size_t & entriesRet);
+
+/**
+ * Tally of a proposal's unspent votes cached by the governance manager.
+ */
+struct CachedTally {
+    Tally tally;
+    CAmount voteBalance{0}; // vote balance the tally was computed with
+};
+
+/**
+ * Superblock results cached by the governance manager.
+ */
+struct CachedSuperblock {
+    std::map<Proposal, Tally> results;
+    CAmount voteBalance{0}; // vote balance the results were computed with
+};
+
 /**
  * Manages related servicenode functions including handling network messages and storing an active list
  * of valid servicenodes.
@@ -692,6 +1389,11 @@ class Governance : public CValidationInterface {
 public:
     explicit Governance() = default;
 
+    /** Proposal accepted from a block connected to the chain tip */
+    boost::signals2::signal<void (const Proposal & proposal)> NotifyProposal;
+    /** Vote accepted or changed by a block connected to the chain tip */
+    boost::signals2::signal<void (const Vote & vote)> NotifyVote;
+
     /**
      * Returns true if the proposal with the specified name exists.
      * @param name
@@ -699,8 +1401,11 @@ public:
      */
     bool hasProposal(const std::string & name, const int & superblock) {
         LOCK(mu);
-        for (const auto & item : proposals) {
-            if (item.second.getSuperblock() == superblock && item.second.getName() == name)
+        auto it = proposalsBySuperblock.find(superblock);
+        if (it == proposalsBySuperblock.end())
+            return false;
+        for (const auto & hash : it->second) {
+            if (proposals[hash].getName() == name)
                 return true;
         }
         return false;
@@ -735,7 +1440,7 @@ public:
      */
     bool hasVote(const uint256 & hash) {
         LOCK(mu);
-        return votes.count(hash) > 0;
+        return votes.contains(hash);
     }
 
     /**
@@ -747,9 +1452,12 @@ public:
      */
     bool hasVote(const uint256 & proposal, const VoteType & voteType, const COutPoint & utxo) {
         LOCK(mu);
-        for (const auto & item : votes) {
-            const auto & vote = item.second;
-            if (vote.getUtxo() == utxo && vote.getProposal() == proposal && vote.getVote() == voteType)
+        auto it = votesByUtxo.find(utxo);
+        if (it == votesByUtxo.end())
+            return false;
+        Vote vote;
+        for (const auto & hash : it->second) {
+            if (votes.get(hash, vote) && vote.getProposal() == proposal && vote.getVote() == voteType)
                 return true;
         }
         return false;
@@ -763,13 +1471,208 @@ public:
         LOCK(mu);
         proposals.clear();
         votes.clear();
+        proposalsBySuperblock.clear();
+        votesByProposal.clear();
+        votesByUtxo.clear();
+        tallies.clear();
+        superblockResults.clear();
+        changedProposals.clear();
+        clearOrphanVotes();
+        loaded = false;
         return true;
     }
 
     /**
-     * Loads the governance data from the blockchain ledger. It's possible to optimize
-     * this further by creating a separate leveldb for goverance data. Currently, this
-     * method will read every block on the chain and search for goverance data.
+     * Returns the estimated memory usage of the governance state and caches.
+     * @return
+     */
+    GovernanceMemoryUsage getMemoryUsage() {
+        GovernanceMemoryUsage usage;
+        usage.voteKeysUsage = VoteKeyCacheUsage(usage.voteKeys);
+        LOCK(mu);
+        usage.proposals = proposals.size();
+        usage.votes = votes.size();
+        usage.proposalsUsage = memusage::DynamicUsage(proposals);
+        usage.votesUsage = votes.DynamicMemoryUsage();
+        usage.indexUsage = indexUsage(proposalsBySuperblock) + indexUsage(votesByProposal) + indexUsage(votesByUtxo);
+        usage.cacheUsage = memusage::DynamicUsage(tallies) + memusage::DynamicUsage(superblockResults);
+        for (const auto & item : superblockResults)
+            usage.cacheUsage += memusage::DynamicUsage(item.second.results);
+        return usage;
+    }
+
+    /**
+     * Opens the governance checkpoint database. Checkpoints are written each time the
+     * chainstate is flushed and are used by loadGovernanceData to resume loading.
+     * @param cacheSize
+     * @param memory Keep the database in memory only
+     * @param wipe Erase any existing checkpoint
+     * @return
+     */
+    bool openCheckpoint(const size_t & cacheSize, const bool memory = false, const bool wipe = false) {
+        LOCK(mudb);
+        try {
+            db = MakeUnique<GovernanceDB>(cacheSize, memory, wipe);
+        } catch (std::exception & e) {
+            db.reset();
+            return error("%s: failed to open the governance database: %s", __func__, e.what());
+        }
+        return true;
+    }
+
+    /**
+     * Closes the governance checkpoint database.
+     */
+    void closeCheckpoint() {
+        LOCK(mudb);
+        db.reset();
+    }
+
+    /**
+     * Reads the governance checkpoint. Returns false if no checkpoint is available.
+     * @param heightRet
+     * @param hashRet
+     * @param proposalsRet
+     * @param votesRet
+     * @return
+     */
+    bool readCheckpoint(int & heightRet, uint256 & hashRet, std::map<uint256, Proposal> & proposalsRet,
+                        std::map<uint256, Vote> & votesRet)
+    {
+        LOCK(mudb);
+        if (!db)
+            return false;
+        try {
+            return db->ReadCheckpoint(heightRet, hashRet, proposalsRet, votesRet);
+        } catch (std::exception & e) {
+            return error("%s: failed to read the governance checkpoint: %s", __func__, e.what());
+        }
+    }
+
+    /**
+     * Copies all known proposals and votes.
+     * @param proposalsRet
+     * @param votesRet
+     */
+    void copyState(std::map<uint256, Proposal> & proposalsRet, std::map<uint256, Vote> & votesRet) {
+        LOCK(mu);
+        proposalsRet = proposals;
+        votesRet = votes.all();
+    }
+
+    /**
+     * Writes the current governance state as the checkpoint for the specified block. The
+     * governance state must correspond to the specified block.
+     * @param pindex
+     * @return
+     */
+    bool writeCheckpoint(const CBlockIndex *pindex) {
+        if (!pindex)
+            return false;
+        std::map<uint256, Proposal> ps;
+        std::map<uint256, Vote> vs;
+        copyState(ps, vs);
+        LOCK(mudb);
+        if (!db)
+            return false;
+        try {
+            return db->WriteCheckpoint(pindex->nHeight, pindex->GetBlockHash(), ps, vs);
+        } catch (std::exception & e) {
+            return error("%s: failed to write the governance checkpoint: %s", __func__, e.what());
+        }
+    }
+
+    /**
+     * Archives the governance changes of the block at the specified height.
+     * @param height
+     * @param record
+     * @return
+     */
+    bool writeBlockRecord(const int & height, const GovernanceBlockRecord & record) {
+        LOCK(mudb);
+        if (!db)
+            return false;
+        try {
+            return db->WriteBlockRecord(height, record);
+        } catch (std::exception & e) {
+            return error("%s: failed to archive the governance data of block %d: %s", __func__, height, e.what());
+        }
+    }
+
+    /**
+     * Reads the archived governance changes of the block at the specified height.
+     * @param height
+     * @param recordRet
+     * @return
+     */
+    bool readBlockRecord(const int & height, GovernanceBlockRecord & recordRet) {
+        LOCK(mudb);
+        if (!db)
+            return false;
+        try {
+            return db->ReadBlockRecord(height, recordRet);
+        } catch (std::exception & e) {
+            return error("%s: failed to read the governance archive: %s", __func__, e.what());
+        }
+    }
+
+    /**
+     * Replays the archived governance changes of the blocks in the specified range of the
+     * chain. Nothing is applied unless every block of the range has a record, the governance
+     * state must correspond to the block before the range.
+     * @param startBlock
+     * @param endBlock
+     * @param chain
+     * @param chainMutex
+     * @return
+     */
+    bool loadFromArchive(const int & startBlock, const int & endBlock, const CChain & chain, CCriticalSection & chainMutex) {
+        std::vector<GovernanceBlockRecord> records;
+        records.reserve(endBlock - startBlock + 1);
+        {
+            LOCK(mudb);
+            if (!db)
+                return false;
+            try {
+                for (int height = startBlock; height <= endBlock; ++height) {
+                    if (ShutdownRequested())
+                        return false;
+                    GovernanceBlockRecord record;
+                    if (!db->ReadBlockRecord(height, record))
+                        return false;
+                    records.push_back(std::move(record));
+                }
+            } catch (std::exception & e) {
+                return error("%s: failed to read the governance archive: %s", __func__, e.what());
+            }
+        }
+        {
+            LOCK(chainMutex);
+            for (int height = startBlock; height <= endBlock; ++height) {
+                const auto pindex = chain[height];
+                if (!pindex || pindex->GetBlockHash() != records[height - startBlock].blockHash)
+                    return false; // the record is of a block that was disconnected
+            }
+        }
+
+        LOCK(mu);
+        for (int height = startBlock; height <= endBlock; ++height) {
+            const auto & record = records[height - startBlock];
+            for (const auto & proposal : record.proposals)
+                addProposal(proposal);
+            for (const auto & vote : record.votes)
+                setVote(vote);
+            for (const auto & spend : record.spends)
+                spendVotes(spend.first, height, spend.second);
+        }
+        return true;
+    }
+
+    /**
+     * Loads the governance data from the blockchain ledger. If a governance checkpoint
+     * exists on the active chain it's loaded first and only the blocks after the
+     * checkpoint are read, otherwise every block since the governance block is read.
+     * Blocks that are all in the governance archive are replayed from it instead.
      * @return
      */
     bool loadGovernanceData(const CChain & chain, CCriticalSection & chainMutex,
@@ -782,22 +1685,69 @@ public:
         }
         // No need to load any governance data if we on the genesis block
         // or if the governance system hasn't been enabled yet.
-        if (blockHeight == 0 || blockHeight < consensus.governanceBlock)
+        if (blockHeight == 0 || blockHeight < consensus.governanceBlock) {
+            loaded = true;
+            return true;
+        }
+
+        // Resume from the checkpoint if its block is still on the active chain
+        int startBlock{consensus.governanceBlock};
+        int checkpointHeight{0};
+        {
+            uint256 checkpointHash;
+            std::map<uint256, Proposal> ps;
+            std::map<uint256, Vote> vs;
+            if (readCheckpoint(checkpointHeight, checkpointHash, ps, vs) && checkpointHeight >= consensus.governanceBlock) {
+                bool onChain{false};
+                {
+                    LOCK(chainMutex);
+                    const auto pindex = chain[checkpointHeight];
+                    onChain = pindex && pindex->GetBlockHash() == checkpointHash;
+                }
+                if (onChain) {
+                    LOCK(mu);
+                    for (const auto & item : ps)
+                        addProposal(item.second);
+                    for (const auto & item : vs) {
+                        if (!votes.contains(item.first))
+                            setVote(item.second, item.first);
+                    }
+                    startBlock = checkpointHeight + 1;
+                    LogPrintf("Loaded governance checkpoint at block %d with %u proposals and %u votes\n",
+                              checkpointHeight, ps.size(), vs.size());
+                } else
+                    checkpointHeight = 0;
+            } else
+                checkpointHeight = 0;
+        }
+        if (startBlock > blockHeight) {
+            loaded = true;
             return true;
+        }
+        if (loadFromArchive(startBlock, blockHeight, chain, chainMutex)) {
+            LogPrintf("Loaded governance data of blocks %d to %d from the archive\n", startBlock, blockHeight);
+            loaded = true;
+            notifyChanges();
+            return true;
+        }
 
-        // Shard the blocks into num_cores slices
+        // Shard the blocks into num_cores slices, each shard reads its blocks in order
+        BlockFileSequentialScan scan;
         boost::thread_group tg;
         const auto cores = GetNumCores();
-        std::map<COutPoint, std::pair<uint256, int>> spentPrevouts; // pair<txhash, blockheight>
+        // Each shard records the spent prevouts of its own blocks and the
+        // results are merged once all the shards are done.
+        std::vector<std::map<COutPoint, std::pair<uint256, int>>> shardPrevouts(cores); // pair<txhash, blockheight>
         Mutex mut; // manage access to shared data
 
-        const int totalBlocks = blockHeight - consensus.governanceBlock;
+        const int totalBlocks = blockHeight - startBlock;
         int slice = totalBlocks / cores;
         bool failed{false};
         for (int k = 0; k < cores; ++k) {
-            const int start = consensus.governanceBlock + k*slice;
+            const int start = startBlock + k*slice;
             const int end = k == cores-1 ? blockHeight+1 // check bounds, +1 due to "<" logic below, ensure inclusion of last block
                                          : start+slice;
+            auto & spentPrevouts = shardPrevouts[k];
             tg.create_thread([start,end,&spentPrevouts,&failed,&failReasonRet,&chain,&chainMutex,&mut,this] {
                 RenameThread("blocknet-governance");
                 for (int blockNumber = start; blockNumber < end; ++blockNumber) {
@@ -827,7 +1777,6 @@ public:
                     }
                     // Store all vins in order to use as a lookup for spent votes
                     for (const auto & tx : block.vtx) {
-                        LOCK(mut);
                         for (const auto & vin : tx->vin)
                             spentPrevouts[vin.prevout] = {tx->GetHash(), blockIndex->nHeight};
                     }
@@ -841,8 +1790,19 @@ public:
 
         {
             LOCK(mu);
-            if (votes.empty() || failed)
+            const auto discarded = clearOrphanVotes();
+            if (discarded > 0)
+                LogPrintf("Discarded %u governance votes without a proposal\n", discarded);
+            if (votes.empty() || failed) {
+                loaded = !failed;
                 return !failed;
+            }
+        }
+
+        std::map<COutPoint, std::pair<uint256, int>> spentPrevouts;
+        for (auto & prevouts : shardPrevouts) {
+            spentPrevouts.insert(prevouts.begin(), prevouts.end());
+            prevouts.clear();
         }
 
         // Now that all votes are loaded, check and remove any invalid ones.
@@ -850,44 +1810,61 @@ public:
         // have the complete dataset in memory. Below the votes are sliced
         // up into shards and each available thread works on its own shard.
         std::vector<std::pair<uint256, Vote>> tmpvotes;
-        tmpvotes.reserve(votes.size());
         {
             LOCK(mu);
-            std::copy(votes.begin(), votes.end(), std::back_inserter(tmpvotes));
+            tmpvotes.reserve(votes.size());
+            votes.forEach([&tmpvotes](const uint256 & hash, const Vote & vote) { tmpvotes.emplace_back(hash, vote); });
         }
+        // The utxos of votes read after the checkpoint are looked up at once
+        std::vector<char> spentAtCheckpoint;
+        if (checkpointHeight > 0) {
+            std::vector<COutPoint> utxos;
+            utxos.reserve(tmpvotes.size());
+            for (const auto & item : tmpvotes)
+                utxos.push_back(item.second.getUtxo());
+            CheckVoteUtxosSpent(utxos, spentAtCheckpoint, false);
+        }
+        std::vector<std::vector<Vote>> shardVotes(cores);
+        std::vector<std::vector<uint256>> shardVoteHashes(cores);
         slice = static_cast<int>(tmpvotes.size()) / cores;
         for (int k = 0; k < cores; ++k) {
             const int start = k*slice;
             const int end = k == cores-1 ? static_cast<int>(tmpvotes.size())
                                          : start+slice;
+            auto & recorded = shardVotes[k];
+            auto & recordedHashes = shardVoteHashes[k];
             try {
-                tg.create_thread([start,end,&tmpvotes,&spentPrevouts,&failed,&mut,this] {
+                tg.create_thread([start,end,checkpointHeight,&tmpvotes,&spentAtCheckpoint,&recorded,&recordedHashes,&spentPrevouts,&failed,this] {
                     RenameThread("blocknet-governance");
                     for (int i = start; i < end; ++i) {
                         if (ShutdownRequested()) { // don't hold up shutdown requests
                             failed = true;
                             break;
                         }
-                        Vote vote;
-                        {
-                            LOCK(mut);
-                            vote = tmpvotes[i].second;
-                        }
+                        Vote vote = tmpvotes[i].second;
                         // Record vote if it has an associated proposal
                         if (hasProposal(vote.getProposal(), vote.getBlockNumber())) {
                             // Mark vote as spent if its utxo is spent before or on the
                             // associated proposal's superblock.
-                            {
-                                LOCK(mut);
-                                if (spentPrevouts.count(vote.getUtxo()) && spentPrevouts[vote.getUtxo()].second <= getProposal(vote.getProposal()).getSuperblock())
-                                    vote.spend(spentPrevouts[vote.getUtxo()].second, spentPrevouts[vote.getUtxo()].first);
-                            }
-                            {
-                                LOCK(mu);
-                                votes[vote.getHash()] = vote;
+                            auto it = spentPrevouts.find(vote.getUtxo());
+                            if (it != spentPrevouts.end()) {
+                                if (it->second.second <= getProposal(vote.getProposal()).getSuperblock())
+                                    vote.spend(it->second.second, it->second.first);
+                            } else if (checkpointHeight > 0 && vote.getBlockNumber() > checkpointHeight && spentAtCheckpoint[i]) {
+                                // The utxo of a vote read after the checkpoint was spent prior
+                                // to the checkpoint, which is before the vote was cast.
+                                vote.spend(checkpointHeight, uint256());
                             }
+                            recorded.push_back(std::move(vote));
                         }
                     }
+                    // Hash the shard's votes side by side for the vote indexes
+                    CHashBatch batch(SER_GETHASH, 0);
+                    for (const auto & vote : recorded) {
+                        vote.writeHashData(batch);
+                        batch.Next();
+                    }
+                    recordedHashes = batch.GetHashes();
                 });
             } catch (std::exception & e) {
                 failed = true;
@@ -897,6 +1874,18 @@ public:
         // Wait for all threads to complete
         tg.join_all();
 
+        {
+            LOCK(mu);
+            for (int k = 0; k < cores; ++k) {
+                const auto & recorded = shardVotes[k];
+                const auto & recordedHashes = shardVoteHashes[k];
+                for (size_t i = 0; i < recorded.size(); ++i)
+                    setVote(recorded[i], recordedHashes[i]);
+            }
+            loaded = !failed;
+        }
+        notifyChanges();
+
         return !failed;
     }
 
@@ -919,9 +1908,9 @@ public:
      */
     Vote getVote(const uint256 & hash) {
         LOCK(mu);
-        if (votes.count(hash) > 0)
-            return votes[hash];
-        return Vote{};
+        Vote vote;
+        votes.get(hash, vote);
+        return vote;
     }
 
     /**
@@ -937,6 +1926,56 @@ public:
         return std::move(props);
     }
 
+    /**
+     * Lists the proposals matching the query with their cached tallies. Only the superblocks
+     * in the range of the query are visited.
+     * @param query
+     * @param params
+     * @param listings Proposals of the page in superblock and hash order
+     * @return false if the "after" proposal of the query is unknown
+     */
+    bool listProposals(const ProposalQuery & query, const Consensus::Params & params, std::vector<ProposalListing> & listings) {
+        LOCK(mu);
+        int from = query.fromSuperblock;
+        int afterSuperblock{-1};
+        if (!query.after.IsNull()) {
+            auto pit = proposals.find(query.after);
+            if (pit == proposals.end())
+                return false;
+            afterSuperblock = pit->second.getSuperblock();
+            from = std::max(from, afterSuperblock);
+        }
+
+        for (auto it = proposalsBySuperblock.lower_bound(from); it != proposalsBySuperblock.end()
+                                                             && it->first <= query.toSuperblock; ++it)
+        {
+            auto hit = it->first == afterSuperblock ? it->second.upper_bound(query.after) : it->second.begin();
+            std::map<Proposal, Tally> results;
+            bool haveResults{false};
+            for (; hit != it->second.end(); ++hit) {
+                const auto & proposal = proposals[*hit];
+                if (!query.namePrefix.empty() && proposal.getName().compare(0, query.namePrefix.size(), query.namePrefix) != 0)
+                    continue;
+                if (!haveResults) { // one results lookup per superblock
+                    if (isSuperblock(it->first, params))
+                        results = cachedSuperblockResults(it->first, params);
+                    haveResults = true;
+                }
+                const bool passing = results.count(proposal) > 0;
+                if ((query.status == PROPOSAL_PASSING && !passing) || (query.status == PROPOSAL_FAILING && passing))
+                    continue;
+                ProposalListing listing;
+                listing.proposal = proposal;
+                listing.tally = cachedTally(*hit, params);
+                listing.passing = passing;
+                listings.push_back(listing);
+                if (query.limit > 0 && listings.size() >= query.limit)
+                    return true;
+            }
+        }
+        return true;
+    }
+
     /**
      * Fetch the list of all known votes that haven't been spent.
      * @return
@@ -944,10 +1983,10 @@ public:
     std::vector<Vote> getVotes() {
         LOCK(mu);
         std::vector<Vote> vos;
-        for (const auto & item : votes) {
-            if (!item.second.spent())
-                vos.push_back(item.second);
-        }
+        votes.forEach([&vos](const uint256 & hash, const Vote & vote) {
+            if (!vote.spent())
+                vos.push_back(vote);
+        });
         return std::move(vos);
     }
 
@@ -958,12 +1997,19 @@ public:
      */
     std::vector<Vote> getVotes(const uint256 & hash) {
         LOCK(mu);
-        std::vector<Vote> vos;
-        for (const auto & item : votes) {
-            if (item.second.getProposal() == hash && !item.second.spent())
-                vos.push_back(item.second);
-        }
-        return std::move(vos);
+        return unspentVotes(hash);
+    }
+
+    /**
+     * Returns the vote tally for the specified proposal. The tally is cached until one of
+     * the proposal's votes is added, changed, removed or spent.
+     * @param proposal Proposal hash
+     * @param params
+     * @return
+     */
+    Tally getTally(const uint256 & proposal, const Consensus::Params & params) {
+        LOCK(mu);
+        return cachedTally(proposal, params);
     }
 
     /**
@@ -978,24 +2024,16 @@ public:
     std::tuple<int, VoteType, bool, CAmount> getMyVotes(const uint256 & hash, CCoinsViewCache *coinsTip,
             std::vector<std::shared_ptr<CWallet>> & wallets, const Consensus::Params & consensus)
     {
-        std::map<uint256, Vote> copyVotes;
-        {
-            LOCK(mu);
-            copyVotes = votes;
-        }
+        const auto proposalVotes = getVotes(hash);
 
         CAmount voteAmount{0};
         VoteType vtype{ABSTAIN};
-        for (const auto & item : votes) {
-            const auto & vote = item.second;
-            if (vote.getProposal() == hash && !vote.spent()) {
-                const auto & utxo = vote.getUtxo();
-                for (auto & w : wallets) {
-                    if (w->HaveKey(vote.getKeyID())) {
-                        vtype = vote.getVote();
-                        voteAmount += vote.getAmount();
-                        break;
-                    }
+        for (const auto & vote : proposalVotes) {
+            for (auto & w : wallets) {
+                if (w->HaveKey(vote.getKeyID())) {
+                    vtype = vote.getVote();
+                    voteAmount += vote.getAmount();
+                    break;
                 }
             }
         }
@@ -1027,46 +2065,45 @@ public:
             std::set<VinHash> vinHashes;
             for (int n = 0; n < static_cast<int>(tx->vout.size()); ++n) {
                 const auto & out = tx->vout[n];
-                if (out.scriptPubKey[0] != OP_RETURN)
-                    continue; // no proposal data
-                CScript::const_iterator pc = out.scriptPubKey.begin();
-                std::vector<unsigned char> data;
-                while (pc < out.scriptPubKey.end()) {
-                    opcodetype opcode;
-                    if (!out.scriptPubKey.GetOp(pc, opcode, data))
-                        break;
-                    if (!data.empty())
-                        break;
-                }
-
-                CDataStream ss(data, SER_NETWORK, PROTOCOL_VERSION);
-                NetworkObject obj; ss >> obj;
-                if (!obj.isValid())
-                    continue; // must match expected version
-
-                if (obj.getType() == PROPOSAL) {
-                    CDataStream ss2(data, SER_NETWORK, PROTOCOL_VERSION);
-                    Proposal proposal(blockIndex ? blockIndex->nHeight : 0); ss2 >> proposal;
+                Span<const unsigned char> data;
+                if (!GetGovernancePayload(out.scriptPubKey, data))
+                    continue; // no governance data
+
+                SpanReader ss(SER_NETWORK, PROTOCOL_VERSION, data);
+                if (data[1] == PROPOSAL) {
+                    Proposal proposal(blockIndex ? blockIndex->nHeight : 0);
+                    try {
+                        ss >> proposal;
+                    } catch (const std::exception &) {
+                        continue; // malformed proposal data
+                    }
                     // Skip the cutoff check if block index is not specified
                     if (proposal.isValid(params) && (!blockIndex || meetsProposalCutoff(proposal, blockIndex->nHeight, params)))
                         proposalsRet.insert(proposal);
-                } else if (obj.getType() == VOTE) {
+                } else if (data[1] == VOTE) {
                     if (vinHashes.empty()) { // initialize vin hashes
                         for (const auto & vin : tx->vin) {
                             const auto & vhash = makeVinHash(vin.prevout);
                             vinHashes.insert(vhash);
                         }
                     }
-                    CDataStream ss2(data, SER_NETWORK, PROTOCOL_VERSION);
                     Vote vote({tx->GetHash(), static_cast<uint32_t>(n)}, block->GetBlockTime(), blockIndex ? blockIndex->nHeight : 0);
-                    ss2 >> vote;
+                    try {
+                        ss >> vote;
+                    } catch (const std::exception &) {
+                        continue; // malformed vote data
+                    }
                     // Check that the vote is associated with a valid proposal and
                     // the vote is valid and that it also meets the cutoff requirements.
                     // A valid proposal for this vote must exist in a previous block
-                    // otherwise the vote is discarded.
+                    // otherwise the vote is discarded. When the proposal check is
+                    // disabled the proposal may not have been loaded yet, the cutoff
+                    // of such a vote is checked once its proposal is added.
+                    const Proposal proposal = blockIndex ? getProposal(vote.getProposal()) : Proposal{};
+                    const bool orphan = blockIndex && !checkProposal && proposal.isNull();
                     if ((blockIndex && checkProposal && !hasProposal(vote.getProposal(), blockIndex->nHeight))
                         || !vote.isValid(vinHashes, params)
-                        || (blockIndex && !meetsVotingCutoff(getProposal(vote.getProposal()), blockIndex->nHeight, params)))
+                        || (blockIndex && !orphan && !meetsVotingCutoff(proposal, blockIndex->nHeight, params)))
                         continue;
                     // Handle vote changes, if a vote already exists and the user
                     // is submitting a change, only count the vote with the most
@@ -1093,48 +2130,13 @@ public:
      * Return the superblock results for all the proposals scheduled for the specified superblock.
      * @param superblock
      * @param params
-     * @return
-     */
-    std::map<Proposal, Tally> getSuperblockResults(const int & superblock, const Consensus::Params & params) {
-        std::map<Proposal, Tally> r;
-        if (!isSuperblock(superblock, params))
-            return std::move(r);
-
-        std::set<COutPoint> unique;
-        std::vector<Proposal> ps;
-        std::vector<Vote> vs;
-        getProposalsForSuperblock(superblock, ps, vs);
-
-        CAmount uniqueAmount{0};
-        for (const auto & vote : vs) { // count all the unique voting utxos
-            if (unique.count(vote.getUtxo()))
-                continue;
-            unique.insert(vote.getUtxo());
-            uniqueAmount += vote.getAmount();
-        }
-        const auto uniqueVotes = static_cast<int>(uniqueAmount / params.voteBalance);
-
-        for (const auto & proposal : ps) // get results for each proposal
-            r[proposal] = getTally(proposal.getHash(), vs, params);
-
-        // a) Exclude proposals that don't have the required yes votes.
-        //    60% of votes must be "yes" on a passing proposal.
-        // b) Exclude proposals that don't have at least 25% of all participating
-        //    votes. i.e. at least 25% of all votes cast this superblock must have
-        //    voted on this proposal.
-        // c) Exclude proposals with 0 yes votes in all circumstances
-        for (auto it = r.cbegin(); it != r.cend(); ) {
-            const auto & tally = it->second;
-            const int total = tally.yes+tally.no+tally.abstain;
-            if (static_cast<double>(tally.yes) / static_cast<double>(tally.yes+tally.no) < 0.6
-              || static_cast<double>(total) < static_cast<double>(uniqueVotes) * 0.25
-              || tally.yes <= 0)
-                r.erase(it++);
-            else
-                ++it;
-        }
-
-        return std::move(r);
+     * @return
+     */
+    std::map<Proposal, Tally> getSuperblockResults(const int & superblock, const Consensus::Params & params) {
+        if (!isSuperblock(superblock, params))
+            return {};
+        LOCK(mu);
+        return cachedSuperblockResults(superblock, params);
     }
 
     /**
@@ -1145,20 +2147,8 @@ public:
      * @param allVotes Votes specific to the selected proposals.
      */
     void getProposalsForSuperblock(const int & superblock, std::vector<Proposal> & allProposals, std::vector<Vote> & allVotes) {
-        auto ps = getProposals();
-        auto vs = getVotes();
-        std::set<uint256> proposalHashes;
-        for (const auto & p : ps) {
-            if (p.getSuperblock() == superblock) {
-                allProposals.push_back(p);
-                proposalHashes.insert(p.getHash());
-            }
-        }
-        // Find all votes associated with the selected proposals
-        for (const auto & v : vs) {
-            if (proposalHashes.count(v.getProposal()))
-                allVotes.push_back(v);
-        }
+        LOCK(mu);
+        proposalsForSuperblock(superblock, allProposals, allVotes);
     }
 
     /**
@@ -1352,6 +2342,12 @@ public:
         // prove ownership over the associated utxo. Each OP_RETURN
         // vote must contain the signature generated from the
         // associated utxo casting the vote.
+        //
+        // The coins of a wallet are assigned to the votes once. The
+        // votes are grouped by address so that each transaction needs
+        // as few inputs as possible, and the votes of a transaction
+        // are signed in parallel. Once a transaction is sent the change
+        // paid back to an address becomes its input for the next one.
 
         // Store all voting transactions counter
         int txCounter{0};
@@ -1361,139 +2357,140 @@ public:
 
         // Minimum vote input amount
         const auto voteMinAmount = static_cast<CAmount>(gArgs.GetArg("-voteinputamount", VOTING_UTXO_INPUT_AMOUNT));
+        const auto minInputAmount = static_cast<CAmount>((double)voteMinAmount*0.6);
 
         for (auto & wallet : wallets) {
             auto locked_chain = wallet->chain().lock();
             LOCK(wallet->cs_wallet);
 
-            bool completelyDone{false}; // no votes left
-            do {
-                // Obtain all valid coin from this wallet that can be used in casting votes
-                std::vector<COutput> coins;
-                wallet->AvailableCoins(*locked_chain, coins);
-                std::sort(coins.begin(), coins.end(), [](const COutput & out1, const COutput & out2) -> bool { // sort ascending (smallest first)
-                    return out1.GetInputCoin().txout.nValue < out2.GetInputCoin().txout.nValue;
-                });
+            // Obtain all valid coin from this wallet that can be used in casting votes
+            std::vector<COutput> coins;
+            wallet->AvailableCoins(*locked_chain, coins);
+            std::sort(coins.begin(), coins.end(), [](const COutput & out1, const COutput & out2) -> bool { // sort ascending (smallest first)
+                return out1.GetInputCoin().txout.nValue < out2.GetInputCoin().txout.nValue;
+            });
 
-                // Do not proceed if no inputs were found
-                if (coins.empty())
-                    break;
+            // Do not proceed if no inputs were found
+            if (coins.empty())
+                continue;
 
-                // Filter the coins that meet the minimum requirement for utxo amount. These
-                // inputs are used as the inputs to the vote transaction. Need one unique
-                // input per address in the wallet that's being used in voting.
-                std::map<CKeyID, const COutput*> inputCoins;
-                // Store the inputs in use for this round of votes. It's possible that there
-                // are more votes than a single tx allows, as a result, only use the inputs
-                // associated with the votes being used in this tx.
-                std::map<CKeyID, const COutput*> inputsInUse;
-
-                // Select the coin set that meets the utxo amount requirements for use with
-                // vote outputs in the tx.
-                std::vector<COutput> filtered;
-                for (const auto & coin : coins) {
-                    if (!coin.fSpendable)
-                        continue;
-                    CTxDestination dest;
-                    if (!ExtractDestination(coin.GetInputCoin().txout.scriptPubKey, dest))
-                        continue;
-                    // Input selection assumes "coins" is sorted ascending by nValue
-                    const auto & addr = boost::get<CKeyID>(dest);
-                    if (!inputCoins.count(addr) && coin.GetInputCoin().txout.nValue >= static_cast<CAmount>((double)voteMinAmount*0.6)) {
-                        inputCoins[addr] = &coin; // store smallest coin meeting vote input amount requirement
-                        continue; // do not use in the vote b/c it's being used in the input
-                    }
-                    if (coin.GetInputCoin().txout.nValue < params.voteMinUtxoAmount)
+            // Filter the coins that meet the minimum requirement for utxo amount. These
+            // inputs are used as the inputs to the vote transaction. Need one unique
+            // input per address in the wallet that's being used in voting.
+            std::map<CKeyID, CInputCoin> inputCoins;
+            // Select the coin set that meets the utxo amount requirements for use with
+            // vote outputs in the tx. Keys are looked up once per address.
+            std::vector<std::pair<CKeyID, const COutput*>> filtered;
+            std::map<CKeyID, CKey> keys;
+            for (const auto & coin : coins) {
+                if (!coin.fSpendable)
+                    continue;
+                CTxDestination dest;
+                if (!ExtractDestination(coin.GetInputCoin().txout.scriptPubKey, dest) || dest.type() != typeid(CKeyID))
+                    continue;
+                // Input selection assumes "coins" is sorted ascending by nValue
+                const auto & addr = boost::get<CKeyID>(dest);
+                if (!inputCoins.count(addr) && coin.GetInputCoin().txout.nValue >= minInputAmount) {
+                    inputCoins.emplace(addr, coin.GetInputCoin()); // store smallest coin meeting vote input amount requirement
+                    continue; // do not use in the vote b/c it's being used in the input
+                }
+                if (coin.GetInputCoin().txout.nValue < params.voteMinUtxoAmount)
+                    continue;
+                if (!keys.count(addr)) {
+                    const auto keyid = GetKeyForDestination(*wallet, dest);
+                    CKey key; // utxo private key
+                    if (keyid.IsNull() || !wallet->GetKey(keyid, key))
                         continue;
-                    filtered.push_back(coin);
+                    keys.emplace(addr, key);
                 }
+                filtered.emplace_back(addr, &coin);
+            }
 
-                // Do not proceed if no coins or inputs were found
-                if (filtered.empty() || inputCoins.empty())
-                    break;
-
-                // Store all the votes for each proposal across all participating utxos. Each
-                // utxo can be used to vote towards each proposal.
-                std::vector<CRecipient> voteOuts;
-
-                bool doneWithPendingVotes{false}; // do we have any votes left
-
-                // Create all votes, i.e. as many that will fit in a single transaction
-                for (int i = 0; i < static_cast<int>(filtered.size()); ++i) {
-                    const auto &coin = filtered[i];
+            // Do not proceed if no coins or inputs were found
+            if (filtered.empty() || inputCoins.empty())
+                continue;
 
-                    CTxDestination dest;
-                    if (!ExtractDestination(coin.GetInputCoin().txout.scriptPubKey, dest))
+            // Store all the votes for each proposal across all participating utxos. Each
+            // utxo can be used to vote towards each proposal. Votes are grouped by address.
+            struct PendingVote {
+                CKeyID addr;
+                const COutput *coin;
+                const ProposalVote *pv;
+            };
+            std::vector<PendingVote> pending;
+            for (const auto & item : filtered) {
+                if (!inputCoins.count(item.first))
+                    continue; // no input to prove ownership of the address
+                const auto & outpoint = item.second->GetInputCoin().outpoint;
+                for (const auto & pv : proposalVotes) {
+                    const auto it = usedUtxos.find(outpoint);
+                    if (it != usedUtxos.end() && it->second.count(pv.proposal.getHash()) > 0)
                         continue;
+                    if (hasVote(pv.proposal.getHash(), pv.vote, outpoint))
+                        continue; // skip, already voted
+                    pending.push_back({item.first, item.second, &pv});
+                }
+            }
+            std::stable_sort(pending.begin(), pending.end(), [](const PendingVote & a, const PendingVote & b) -> bool {
+                return a.addr < b.addr;
+            });
 
-                    const auto & addr = boost::get<CKeyID>(dest);
+            // Each transaction holds up to MAX_OP_RETURN_IN_TRANSACTION votes
+            for (size_t chunkStart = 0; chunkStart < pending.size(); chunkStart += MAX_OP_RETURN_IN_TRANSACTION) {
+                const size_t chunkEnd = std::min(pending.size(), chunkStart + MAX_OP_RETURN_IN_TRANSACTION);
+
+                // Create the votes of this transaction. The vote is signed with the utxo that
+                // is representing that vote. The signing must happen before the vote object
+                // is serialized.
+                std::vector<Vote> votes;
+                std::vector<const CKey*> voteKeys;
+                std::vector<const PendingVote*> votePending;
+                for (size_t i = chunkStart; i < chunkEnd; ++i) {
+                    const auto & pvote = pending[i];
+                    const auto it = inputCoins.find(pvote.addr);
+                    if (it == inputCoins.end())
+                        continue; // the input of this address was used up by a previous transaction
+                    votes.emplace_back(pvote.pv->proposal.getHash(), pvote.pv->vote, pvote.coin->GetInputCoin().outpoint,
+                                       makeVinHash(it->second.outpoint));
+                    voteKeys.push_back(&keys[pvote.addr]);
+                    votePending.push_back(&pvote);
+                }
+                std::vector<char> signedVotes(votes.size(), 0);
+                SignVotes(votes, voteKeys, signedVotes);
 
-                    CKey key; // utxo private key
-                    {
-                        const auto keyid = GetKeyForDestination(*wallet, dest);
-                        if (keyid.IsNull())
-                            continue;
-                        if (!wallet->GetKey(keyid, key))
-                            continue;
+                std::vector<CRecipient> voteOuts;
+                // Store the inputs in use for this transaction, only the inputs associated
+                // with the votes being used in this tx are spent.
+                std::map<CKeyID, CInputCoin> inputsInUse;
+                for (size_t i = 0; i < votes.size(); ++i) {
+                    const auto & vote = votes[i];
+                    const auto & addr = votePending[i]->addr;
+                    const auto *pv = votePending[i]->pv;
+                    if (!signedVotes[i]) {
+                        LogPrint(BCLog::GOVERNANCE,
+                                 "WARNING: Failed to vote on {%s} proposal, utxo signing failed %s",
+                                 pv->proposal.getName(), vote.getUtxo().ToString());
+                        continue;
                     }
-
-                    for (int j = 0; j < static_cast<int>(proposalVotes.size()); ++j) {
-                        const auto & pv = proposalVotes[j];
-                        const bool utxoAlreadyUsed = usedUtxos.count(coin.GetInputCoin().outpoint) > 0 &&
-                                                     usedUtxos[coin.GetInputCoin().outpoint].count(pv.proposal.getHash()) > 0;
-                        if (utxoAlreadyUsed)
-                            continue;
-                        const bool alreadyVoted = hasVote(pv.proposal.getHash(), pv.vote, coin.GetInputCoin().outpoint);
-                        if (alreadyVoted)
-                            continue; // skip, already voted
-
-                        // Create and serialize the vote data and insert in OP_RETURN script. The vote
-                        // is signed with the utxo that is representing that vote. The signing must
-                        // happen before the vote object is serialized.
-                        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-                        Vote vote(pv.proposal.getHash(), pv.vote, coin.GetInputCoin().outpoint,
-                                makeVinHash(inputCoins[addr]->GetInputCoin().outpoint));
-                        if (!vote.sign(key)) {
-                            LogPrint(BCLog::GOVERNANCE,
-                                     "WARNING: Failed to vote on {%s} proposal, utxo signing failed %s",
-                                     pv.proposal.getName(), coin.GetInputCoin().outpoint.ToString());
-                            continue;
-                        }
-                        if (!vote.isValid(params)) { // validate vote
-                            LogPrint(BCLog::GOVERNANCE, "WARNING: Failed to vote on {%s} proposal, validation failed",
-                                     pv.proposal.getName());
-                            continue;
-                        }
-                        ss << vote;
-                        voteOuts.push_back({CScript() << OP_RETURN << ToByteVector(ss), 0, false});
-
-                        // Track inputs
-                        if (!inputsInUse.count(addr))
-                            inputsInUse[addr] = inputCoins[addr];
-
-                        // Track utxos that already voted on this proposal
-                        usedUtxos[coin.GetInputCoin().outpoint].insert(pv.proposal.getHash());
-
-                        // Track whether we're on the last vote, used to break out while loop
-                        completelyDone = (i == filtered.size() - 1 && j == proposalVotes.size() - 1);
-
-                        if (voteOuts.size() == MAX_OP_RETURN_IN_TRANSACTION) {
-                            doneWithPendingVotes = !completelyDone;
-                            if (doneWithPendingVotes)
-                                break;
-                        }
+                    if (!vote.isValid(params)) { // validate vote
+                        LogPrint(BCLog::GOVERNANCE, "WARNING: Failed to vote on {%s} proposal, validation failed",
+                                 pv->proposal.getName());
+                        continue;
                     }
+                    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+                    ss << vote;
+                    voteOuts.push_back({CScript() << OP_RETURN << ToByteVector(ss), 0, false});
 
-                    // Do not proceed iterating if we can't fit any more votes in the current transaction
-                    if (doneWithPendingVotes)
-                        break;
-                }
+                    // Track inputs
+                    if (!inputsInUse.count(addr))
+                        inputsInUse.emplace(addr, inputCoins.at(addr));
 
-                // At this point the code assumes that MAX_OP_RETURN_IN_TRANSACTION is reached
-                // or that we've reached the last known vote (last item in all iterations)
+                    // Track utxos that already voted on this proposal
+                    usedUtxos[vote.getUtxo()].insert(vote.getProposal());
+                }
 
                 if (voteOuts.empty()) // Handle case where no votes were produced
-                    break;
+                    continue;
 
                 // Select the inputs for use with the transaction. Also add separate outputs to pay
                 // back the vote inputs to their own addresses as change (requires estimating fees).
@@ -1508,9 +2505,9 @@ public:
 
                 // Select inputs and distribute fees equally across the change addresses (paid back to input addresses minus fee)
                 for (const auto & inputItem : inputsInUse) {
-                    cc.Select(inputItem.second->GetInputCoin().outpoint);
+                    cc.Select(inputItem.second.outpoint);
                     voteOuts.push_back({GetScriptForDestination({inputItem.first}),
-                                        inputItem.second->GetInputCoin().txout.nValue - estimatedFeePerInput,
+                                        inputItem.second.txout.nValue - estimatedFeePerInput,
                                         false});
                 }
 
@@ -1540,12 +2537,21 @@ public:
 
                 // Store the committed voting transaction
                 txsRet.push_back(tx);
-                // Clear vote outs
-                voteOuts.clear();
                 // Increment vote transaction counter
                 ++txCounter;
 
-            } while(!completelyDone);
+                // The change paid back to each input address is the input of its next transaction
+                for (const auto & inputItem : inputsInUse) {
+                    inputCoins.erase(inputItem.first);
+                    const auto script = GetScriptForDestination({inputItem.first});
+                    for (unsigned int n = 0; n < tx->vout.size(); ++n) {
+                        if (tx->vout[n].scriptPubKey == script && tx->vout[n].nValue >= minInputAmount) {
+                            inputCoins.emplace(inputItem.first, CInputCoin(tx, n));
+                            break;
+                        }
+                    }
+                }
+            }
         }
 
         // If not voting transactions were created, return error
@@ -1679,25 +2685,16 @@ public: // static
      * @return
      */
     static bool isVoteInTxOut(const CTxOut & out, Vote & vote) {
-        if (out.scriptPubKey[0] != OP_RETURN)
+        Span<const unsigned char> data;
+        if (!GetGovernancePayload(out.scriptPubKey, data) || data[1] != VOTE)
+            return false;
+        try {
+            SpanReader ss(SER_NETWORK, PROTOCOL_VERSION, data);
+            ss >> vote;
+        } catch (const std::exception &) {
             return false;
-        CScript::const_iterator pc = out.scriptPubKey.begin();
-        std::vector<unsigned char> data;
-        while (pc < out.scriptPubKey.end()) {
-            opcodetype opcode;
-            if (!out.scriptPubKey.GetOp(pc, opcode, data))
-                break;
-            if (!data.empty())
-                break;
-        }
-        CDataStream ss(data, SER_NETWORK, PROTOCOL_VERSION);
-        NetworkObject obj; ss >> obj;
-        if (obj.getType() == VOTE) {
-            CDataStream ss2(data, SER_NETWORK, PROTOCOL_VERSION);
-            ss2 >> vote;
-            return true;
         }
-        return false;
+        return true;
     }
 
     /**
@@ -1889,17 +2886,40 @@ public: // static
     }
 
 protected:
+    std::string GetSubscriberName() const override {
+        return "governance";
+    }
+
+    void ChainStateFlushed(const CBlockLocator & locator) override {
+        if (!loaded || locator.IsNull())
+            return; // only checkpoint fully loaded governance state
+        const CBlockIndex *pindex{nullptr};
+        {
+            LOCK(cs_main);
+            pindex = LookupBlockIndex(locator.vHave.front());
+        }
+        writeCheckpoint(pindex);
+    }
+
     void BlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex,
                         const std::vector<CTransactionRef>& txn_conflicted) override
     {
-        processBlock(block.get(), pindex, Params().GetConsensus());
+        const auto & params = Params().GetConsensus();
+        {
+            LOCK(mu);
+            statusChanged(pindex->nHeight, params);
+        }
+        processBlock(block.get(), pindex, params);
+        // Once voting on the upcoming superblock has closed compute its results
+        // ahead of time, connecting the superblock is then a cache lookup.
+        if (pindex->nHeight < params.governanceBlock)
+            return;
+        const auto superblock = NextSuperblock(params, pindex->nHeight);
+        if (pindex->nHeight >= superblock - params.votingCutoff)
+            getSuperblockResults(superblock, params);
     }
 
     void BlockDisconnected(const std::shared_ptr<const CBlock>& block) override {
-        std::set<Proposal> ps;
-        std::set<Vote> vs;
-        dataFromBlock(block.get(), ps, vs, Params().GetConsensus()); // cutoff check disabled here b/c we're disconnecting
-                                                                     // already validated votes/proposals
         // By default use max int for block height in case no
         // index is found we don't want to mark votes as unspent
         // if an accurate spent height can't be verified.
@@ -1908,9 +2928,24 @@ protected:
         {
             LOCK(cs_main);
             const auto pindex = LookupBlockIndex(block->GetHash());
-            blockHeight = pindex->nHeight;
+            if (pindex)
+                blockHeight = pindex->nHeight;
         }
 
+        // Blocks processed on the chain tip are undone from their archived changes, which
+        // are a fraction of the block. Other blocks are read again.
+        GovernanceBlockRecord record;
+        const bool archived = blockHeight != maxInt && readBlockRecord(blockHeight, record)
+                              && record.blockHash == block->GetHash();
+        std::set<Proposal> ps;
+        std::set<Vote> vs;
+        if (archived) {
+            ps.insert(record.proposals.begin(), record.proposals.end());
+            vs.insert(record.votes.begin(), record.votes.end());
+        } else
+            dataFromBlock(block.get(), ps, vs, Params().GetConsensus()); // cutoff check disabled here b/c we're disconnecting
+                                                                         // already validated votes/proposals
+
         {
             LOCK(mu);
             for (auto & proposal : ps) {
@@ -1918,36 +2953,35 @@ protected:
                     continue;
                 const auto & stprop = proposals[proposal.getHash()];
                 if (stprop.getBlockNumber() == blockHeight)
-                    proposals.erase(proposal.getHash());
+                    eraseProposal(proposal.getHash());
             }
             for (auto & vote : vs) {
-                if (!votes.count(vote.getHash()))
+                Vote stvote;
+                if (!votes.get(vote.getHash(), stvote))
                     continue;
-                const auto & stvote = votes[vote.getHash()];
                 if (stvote.getBlockNumber() == blockHeight)
-                    votes.erase(vote.getHash());
+                    eraseVote(vote.getHash());
             }
 
-            if (blockHeight == maxInt)
-                return; // do not unspend votes if block height is undefined
-
             // Unspend any vote utxos that were spent by this
             // block. Only unspend those votes where the block
             // index that tried to spend them was prior to
-            // the proposal's superblock.
-            std::map<COutPoint, uint256> prevouts; // map<outpoint, txhash>
-            for (const auto & tx : block->vtx) {
-                for (const auto & vin : tx->vin)
-                    prevouts[vin.prevout] = tx->GetHash();
-            }
-            for (auto & voteItem : votes) {
-                if (!prevouts.count(voteItem.second.getUtxo()))
-                    continue;
-                // Unspend this vote if it was spent in this block
-                if (blockHeight <= proposals[voteItem.second.getProposal()].getSuperblock())
-                    voteItem.second.unspend(blockHeight, prevouts[voteItem.second.getUtxo()]);
+            // the proposal's superblock. Votes are not unspent
+            // if the block height is undefined.
+            if (blockHeight != maxInt) {
+                statusChanged(blockHeight, Params().GetConsensus());
+                if (archived) {
+                    for (const auto & spend : record.spends)
+                        unspendVotes(spend.first, blockHeight, spend.second);
+                } else {
+                    for (const auto & tx : block->vtx) {
+                        for (const auto & vin : tx->vin)
+                            unspendVotes(vin.prevout, blockHeight, tx->GetHash());
+                    }
+                }
             }
         }
+        notifyChanges();
     }
 
     /**
@@ -1959,20 +2993,42 @@ protected:
      * @param processingChainTip
      */
     void processBlock(const CBlock *block, const CBlockIndex *pindex, const Consensus::Params & params, const bool processingChainTip = true) {
+        if (processingChainTip) // the chain loader already processes blocks in parallel
+            PrecheckVotes(*block);
         std::set<Proposal> ps;
         std::set<Vote> vs;
         dataFromBlock(block, ps, vs, params, pindex, processingChainTip);
+        std::vector<Proposal> addedProposals;
+        std::vector<Vote> addedVotes;
+        // Only changes to fully loaded governance state are archived
+        const bool archive = processingChainTip && loaded;
+        std::vector<std::pair<COutPoint, uint256>> spends;
+        // Only check the mempool and coincache for spent utxos if
+        // we're currently processing the chain tip.
+        std::vector<char> spentVotes(vs.size(), 0);
+        if (processingChainTip && !vs.empty()) {
+            std::vector<COutPoint> utxos;
+            utxos.reserve(vs.size());
+            for (const auto & vote : vs)
+                utxos.push_back(vote.getUtxo());
+            CheckVoteUtxosSpent(utxos, spentVotes);
+        }
         {
             LOCK(mu);
             for (auto & proposal : ps) {
                 // Do not allow proposals with the same parameters to replace
                 // existing proposals.
-                if (!proposals.count(proposal.getHash()))
-                    proposals[proposal.getHash()] = proposal;
+                if (addProposal(proposal))
+                    addedProposals.push_back(proposal);
             }
+            size_t voteN{0};
             for (auto & vote : vs) {
-                if (processingChainTip && !proposals.count(vote.getProposal()))
+                const bool spent = spentVotes[voteN++] != 0;
+                if (!proposals.count(vote.getProposal())) {
+                    if (!processingChainTip) // the proposal may be in a block another shard hasn't read yet
+                        addOrphanVote(vote);
                     continue; // skip votes without valid proposals
+                }
                 // Handle vote changes, if a vote already exists and the user
                 // is submitting a change, only count the vote with the most
                 // recent timestamp. If a vote on the same utxo occurs in the
@@ -1982,24 +3038,23 @@ protected:
                 // The best way to handle this is to build the voting client
                 // to require waiting at least 1 block between vote changes.
                 // Changes to this code below must also be applied to "dataFromBlock()"
-                if (votes.count(vote.getHash())) {
-                    if (vote.getTime() > votes[vote.getHash()].getTime())
-                        votes[vote.getHash()] = vote;
-                    else if (UintToArith256(vote.sigHash()) > UintToArith256(votes[vote.getHash()].sigHash()))
-                        votes[vote.getHash()] = vote;
+                Vote stvote;
+                if (votes.get(vote.getHash(), stvote)) {
+                    if (vote.getTime() > stvote.getTime()
+                        || UintToArith256(vote.sigHash()) > UintToArith256(stvote.sigHash()))
+                    {
+                        setVote(vote);
+                        addedVotes.push_back(vote);
+                    }
                 } else {
-                    // Only check the mempool and coincache for spent utxos if
-                    // we're currently processing the chain tip.
-                    LEAVE_CRITICAL_SECTION(mu);
-                    bool spent = processingChainTip && IsVoteSpent(vote, pindex->nHeight); // check that utxo is unspent
-                    ENTER_CRITICAL_SECTION(mu);
-                    if (spent)
+                    if (spent) // utxo checked above
                         continue;
-                    votes[vote.getHash()] = vote;
+                    setVote(vote);
+                    addedVotes.push_back(vote);
                 }
             }
 
-            if (!processingChainTip || votes.empty()) // if proposal check is disabled, return
+            if (!processingChainTip) // if proposal check is disabled, return
                 return;
 
             // Mark votes as spent, i.e. any votes that have had their
@@ -2007,26 +3062,388 @@ protected:
             // and then check any votes that share those utxos to determine
             // if they've been spent. Only mark votes as spent if the vote's
             // utxo is spent before the proposal expires (on its superblock).
-            std::map<COutPoint, uint256> prevouts; // map<outpoint, txhash>
-            for (const auto & tx : block->vtx) {
-                for (const auto & vin : tx->vin)
-                    prevouts[vin.prevout] = tx->GetHash();
-            }
-            for (auto & voteItem : votes) {
-                if (!prevouts.count(voteItem.second.getUtxo()))
-                    continue;
-                // Only mark the vote as spent if it happens before or on its
-                // proposal's superblock.
-                if (pindex->nHeight <= proposals[voteItem.second.getProposal()].getSuperblock())
-                    voteItem.second.spend(pindex->nHeight, prevouts[voteItem.second.getUtxo()]);
+            if (!votes.empty()) {
+                for (const auto & tx : block->vtx) {
+                    for (const auto & vin : tx->vin) {
+                        if (spendVotes(vin.prevout, pindex->nHeight, tx->GetHash()) && archive)
+                            spends.emplace_back(vin.prevout, tx->GetHash());
+                    }
+                }
             }
         }
+
+        if (archive) {
+            GovernanceBlockRecord record;
+            record.blockHash = pindex->GetBlockHash();
+            record.proposals = addedProposals;
+            record.votes = addedVotes;
+            record.spends = std::move(spends);
+            writeBlockRecord(pindex->nHeight, record);
+        }
+
+        // Notify outside the lock, subscribers may query the governance state
+        for (const auto & proposal : addedProposals)
+            NotifyProposal(proposal);
+        for (const auto & vote : addedVotes)
+            NotifyVote(vote);
+        notifyChanges();
+    }
+
+    /**
+     * Notifies the ui of the proposals that changed since the last notification. Must be
+     * called without holding the governance lock.
+     */
+    void notifyChanges() {
+        std::vector<uint256> changed;
+        {
+            LOCK(mu);
+            if (changedProposals.empty())
+                return;
+            changed.assign(changedProposals.begin(), changedProposals.end());
+            changedProposals.clear();
+        }
+        uiInterface.NotifyGovernanceChanged(changed);
+    }
+
+    /**
+     * Marks the proposals whose status changes when the chain tip reaches or leaves the
+     * specified block, i.e. their superblock, the following superblock or their proposal cutoff.
+     * @param blockHeight
+     * @param params
+     */
+    void statusChanged(const int & blockHeight, const Consensus::Params & params) EXCLUSIVE_LOCKS_REQUIRED(mu) {
+        std::vector<int> superblocks;
+        if (blockHeight % params.superblock == 0)
+            superblocks = {blockHeight, blockHeight - params.superblock};
+        const auto superblock = NextSuperblock(params, blockHeight);
+        if (blockHeight == superblock - params.proposalCutoff + 1)
+            superblocks.push_back(superblock);
+        for (const auto & sb : superblocks) {
+            auto it = proposalsBySuperblock.find(sb);
+            if (it != proposalsBySuperblock.end())
+                changedProposals.insert(it->second.begin(), it->second.end());
+        }
+    }
+
+    /**
+     * Adds the proposal to the proposal indexes. Existing proposals are not replaced.
+     * @param proposal
+     * @return
+     */
+    bool addProposal(const Proposal & proposal) EXCLUSIVE_LOCKS_REQUIRED(mu) {
+        const auto hash = proposal.getHash();
+        if (!proposals.emplace(hash, proposal).second)
+            return false;
+        proposalsBySuperblock[proposal.getSuperblock()].insert(hash);
+        superblockResults.erase(proposal.getSuperblock());
+        changedProposals.insert(hash);
+        resolveOrphanVotes(proposal);
+        return true;
+    }
+
+    /**
+     * Holds the vote until its proposal is added. Only used while loading the chain,
+     * at the chain tip a vote must follow its proposal.
+     * @param vote
+     */
+    void addOrphanVote(const Vote & vote) EXCLUSIVE_LOCKS_REQUIRED(mu) {
+        if (orphanVoteCount >= MAX_ORPHAN_VOTES) {
+            ++droppedOrphanVotes;
+            return;
+        }
+        orphanVotes[vote.getProposal()].push_back(vote);
+        ++orphanVoteCount;
+    }
+
+    /**
+     * Adds the orphan votes of the proposal that were cast after the proposal and before
+     * its voting cutoff. A vote replaces an existing vote on the same utxo by the same
+     * rules as in processBlock.
+     * @param proposal
+     */
+    void resolveOrphanVotes(const Proposal & proposal) EXCLUSIVE_LOCKS_REQUIRED(mu) {
+        auto it = orphanVotes.find(proposal.getHash());
+        if (it == orphanVotes.end())
+            return;
+        const std::vector<Vote> orphans = std::move(it->second);
+        orphanVotes.erase(it);
+        orphanVoteCount -= orphans.size();
+        const auto & params = Params().GetConsensus();
+        for (const auto & vote : orphans) {
+            if (proposal.getBlockNumber() >= vote.getBlockNumber()
+                || !meetsVotingCutoff(proposal, vote.getBlockNumber(), params))
+                continue;
+            Vote stvote;
+            if (!votes.get(vote.getHash(), stvote) || vote.getTime() > stvote.getTime()
+                || UintToArith256(vote.sigHash()) > UintToArith256(stvote.sigHash()))
+                setVote(vote);
+        }
+    }
+
+    /**
+     * Discards the orphan votes whose proposal was never added.
+     * @return Number of votes discarded or dropped for lack of space
+     */
+    size_t clearOrphanVotes() EXCLUSIVE_LOCKS_REQUIRED(mu) {
+        const size_t discarded = orphanVoteCount + droppedOrphanVotes;
+        orphanVotes.clear();
+        orphanVoteCount = 0;
+        droppedOrphanVotes = 0;
+        return discarded;
+    }
+
+    /**
+     * Removes the proposal from the proposal indexes.
+     * @param hash
+     */
+    void eraseProposal(const uint256 & hash) EXCLUSIVE_LOCKS_REQUIRED(mu) {
+        auto it = proposals.find(hash);
+        if (it == proposals.end())
+            return;
+        eraseFromIndex(proposalsBySuperblock, it->second.getSuperblock(), hash);
+        superblockResults.erase(it->second.getSuperblock());
+        tallies.erase(hash);
+        proposals.erase(it);
+        changedProposals.insert(hash);
+    }
+
+    /**
+     * Adds or replaces the vote and updates the vote indexes.
+     * @param vote
+     */
+    void setVote(const Vote & vote) EXCLUSIVE_LOCKS_REQUIRED(mu) {
+        setVote(vote, vote.getHash());
+    }
+
+    /**
+     * Adds the vote under its precomputed hash to the vote indexes.
+     * @param vote
+     * @param hash
+     */
+    void setVote(const Vote & vote, const uint256 & hash) EXCLUSIVE_LOCKS_REQUIRED(mu) {
+        if (!votes.set(vote, hash))
+            return;
+        votesByProposal[vote.getProposal()].insert(hash);
+        votesByUtxo[vote.getUtxo()].insert(hash);
+        invalidateResults(vote.getProposal());
+    }
+
+    /**
+     * Removes the vote from the vote indexes.
+     * @param hash
+     */
+    void eraseVote(const uint256 & hash) EXCLUSIVE_LOCKS_REQUIRED(mu) {
+        Vote vote;
+        if (!votes.get(hash, vote))
+            return;
+        eraseFromIndex(votesByProposal, vote.getProposal(), hash);
+        eraseFromIndex(votesByUtxo, vote.getUtxo(), hash);
+        invalidateResults(vote.getProposal());
+        votes.erase(hash);
+    }
+
+    /**
+     * Marks the votes associated with the utxo as spent. Only votes spent before or on
+     * their proposal's superblock are marked. Returns false if the utxo has no votes.
+     * @param utxo Prevout spent in the block
+     * @param block Height of the spending block
+     * @param txhash Hash of the spending transaction
+     * @return
+     */
+    bool spendVotes(const COutPoint & utxo, const int & block, const uint256 & txhash) EXCLUSIVE_LOCKS_REQUIRED(mu) {
+        auto it = votesByUtxo.find(utxo);
+        if (it == votesByUtxo.end())
+            return false;
+        for (const auto & hash : it->second) {
+            const auto proposal = votes.getProposal(hash);
+            auto pit = proposals.find(proposal);
+            if (pit == proposals.end() || block > pit->second.getSuperblock())
+                continue;
+            votes.spend(hash, block, txhash);
+            invalidateResults(proposal);
+        }
+        return true;
+    }
+
+    /**
+     * Unspends the votes associated with the utxo that were spent by the specified block
+     * and transaction.
+     * @param utxo Prevout spent in the block
+     * @param block Height of the spending block
+     * @param txhash Hash of the spending transaction
+     */
+    void unspendVotes(const COutPoint & utxo, const int & block, const uint256 & txhash) EXCLUSIVE_LOCKS_REQUIRED(mu) {
+        auto it = votesByUtxo.find(utxo);
+        if (it == votesByUtxo.end())
+            return;
+        for (const auto & hash : it->second) {
+            const auto proposal = votes.getProposal(hash);
+            auto pit = proposals.find(proposal);
+            if (pit == proposals.end() || block > pit->second.getSuperblock())
+                continue;
+            if (votes.unspend(hash, block, txhash))
+                invalidateResults(proposal);
+        }
+    }
+
+    /**
+     * Returns the unspent votes for the specified proposal.
+     * @param proposal
+     * @return
+     */
+    std::vector<Vote> unspentVotes(const uint256 & proposal) EXCLUSIVE_LOCKS_REQUIRED(mu) {
+        std::vector<Vote> vos;
+        auto it = votesByProposal.find(proposal);
+        if (it == votesByProposal.end())
+            return vos;
+        vos.reserve(it->second.size());
+        Vote vote;
+        for (const auto & hash : it->second) {
+            if (!votes.spent(hash) && votes.get(hash, vote))
+                vos.push_back(vote);
+        }
+        return vos;
+    }
+
+    /**
+     * Fetch the proposals scheduled for the specified superblock and their unspent votes.
+     * @param superblock
+     * @param allProposals
+     * @param allVotes
+     */
+    void proposalsForSuperblock(const int & superblock, std::vector<Proposal> & allProposals,
+                                std::vector<Vote> & allVotes) EXCLUSIVE_LOCKS_REQUIRED(mu)
+    {
+        auto it = proposalsBySuperblock.find(superblock);
+        if (it == proposalsBySuperblock.end())
+            return;
+        for (const auto & hash : it->second) {
+            allProposals.push_back(proposals[hash]);
+            // Find all votes associated with the selected proposals
+            const auto vs = unspentVotes(hash);
+            allVotes.insert(allVotes.end(), vs.begin(), vs.end());
+        }
+    }
+
+    /**
+     * Returns the cached results of the superblock, computing them if necessary. Results are
+     * cached until a vote or proposal for this superblock changes.
+     * @param superblock
+     * @param params
+     * @return
+     */
+    std::map<Proposal, Tally> cachedSuperblockResults(const int & superblock, const Consensus::Params & params) EXCLUSIVE_LOCKS_REQUIRED(mu) {
+        std::map<Proposal, Tally> r;
+        auto cit = superblockResults.find(superblock);
+        if (cit != superblockResults.end() && cit->second.voteBalance == params.voteBalance)
+            return cit->second.results;
+
+        std::set<COutPoint> unique;
+        std::vector<Proposal> ps;
+        std::vector<Vote> vs;
+        proposalsForSuperblock(superblock, ps, vs);
+
+        CAmount uniqueAmount{0};
+        for (const auto & vote : vs) { // count all the unique voting utxos
+            if (unique.count(vote.getUtxo()))
+                continue;
+            unique.insert(vote.getUtxo());
+            uniqueAmount += vote.getAmount();
+        }
+        const auto uniqueVotes = static_cast<int>(uniqueAmount / params.voteBalance);
+
+        for (const auto & proposal : ps) // get results for each proposal
+            r[proposal] = cachedTally(proposal.getHash(), params);
+
+        // a) Exclude proposals that don't have the required yes votes.
+        //    60% of votes must be "yes" on a passing proposal.
+        // b) Exclude proposals that don't have at least 25% of all participating
+        //    votes. i.e. at least 25% of all votes cast this superblock must have
+        //    voted on this proposal.
+        // c) Exclude proposals with 0 yes votes in all circumstances
+        for (auto it = r.cbegin(); it != r.cend(); ) {
+            const auto & tally = it->second;
+            const int total = tally.yes+tally.no+tally.abstain;
+            if (static_cast<double>(tally.yes) / static_cast<double>(tally.yes+tally.no) < 0.6
+              || static_cast<double>(total) < static_cast<double>(uniqueVotes) * 0.25
+              || tally.yes <= 0)
+                r.erase(it++);
+            else
+                ++it;
+        }
+
+        CachedSuperblock cached;
+        cached.results = r;
+        cached.voteBalance = params.voteBalance;
+        superblockResults[superblock] = cached;
+        return r;
+    }
+
+    /**
+     * Returns the cached tally for the proposal, computing it if necessary.
+     * @param proposal
+     * @param params
+     * @return
+     */
+    Tally cachedTally(const uint256 & proposal, const Consensus::Params & params) EXCLUSIVE_LOCKS_REQUIRED(mu) {
+        auto it = tallies.find(proposal);
+        if (it != tallies.end() && it->second.voteBalance == params.voteBalance)
+            return it->second.tally;
+        CachedTally cached;
+        cached.tally = getTally(proposal, unspentVotes(proposal), params);
+        cached.voteBalance = params.voteBalance;
+        tallies[proposal] = cached;
+        return cached.tally;
+    }
+
+    /**
+     * Drops the cached tally of the proposal and the cached results of its superblock, and marks
+     * the proposal changed for the ui.
+     * @param proposal
+     */
+    void invalidateResults(const uint256 & proposal) EXCLUSIVE_LOCKS_REQUIRED(mu) {
+        tallies.erase(proposal);
+        auto it = proposals.find(proposal);
+        if (it != proposals.end()) {
+            superblockResults.erase(it->second.getSuperblock());
+            changedProposals.insert(proposal);
+        }
+    }
+
+    template <typename K>
+    static void eraseFromIndex(std::map<K, std::set<uint256>> & index, const K & key, const uint256 & hash) {
+        auto it = index.find(key);
+        if (it == index.end())
+            return;
+        it->second.erase(hash);
+        if (it->second.empty())
+            index.erase(it);
+    }
+
+    template <typename K>
+    static size_t indexUsage(const std::map<K, std::set<uint256>> & index) {
+        size_t usage = memusage::DynamicUsage(index);
+        for (const auto & item : index)
+            usage += memusage::DynamicUsage(item.second);
+        return usage;
     }
 
 protected:
     Mutex mu;
     std::map<uint256, Proposal> proposals GUARDED_BY(mu);
-    std::map<uint256, Vote> votes GUARDED_BY(mu);
+    VoteStore votes GUARDED_BY(mu);
+    std::map<int, std::set<uint256>> proposalsBySuperblock GUARDED_BY(mu); // superblock -> proposal hashes
+    std::map<uint256, std::set<uint256>> votesByProposal GUARDED_BY(mu); // proposal hash -> vote hashes
+    std::map<COutPoint, std::set<uint256>> votesByUtxo GUARDED_BY(mu); // vote utxo -> vote hashes
+    std::map<uint256, CachedTally> tallies GUARDED_BY(mu); // proposal hash -> cached tally
+    std::map<int, CachedSuperblock> superblockResults GUARDED_BY(mu); // superblock -> cached results
+    std::set<uint256> changedProposals GUARDED_BY(mu); // proposals changed since the last ui notification
+    std::map<uint256, std::vector<Vote>> orphanVotes GUARDED_BY(mu); // proposal hash -> votes read before the proposal
+    size_t orphanVoteCount GUARDED_BY(mu){0};
+    size_t droppedOrphanVotes GUARDED_BY(mu){0};
+    std::atomic<bool> loaded{false}; // true once loadGovernanceData completes
+    Mutex mudb;
+    std::unique_ptr<GovernanceDB> db GUARDED_BY(mudb); // governance checkpoint, null if not opened
 };
 
 }
@@ -199,6 +199,60 @@ public:
     }
 };
 
+/**
+ * A writer collecting the serializations of several objects, whose 256-bit hashes are
+ * computed together with SHA256DMulti. Each hash covers what was written since the
+ * previous Next() call.
+ */
+class CHashBatch
+{
+private:
+    std::vector<unsigned char> data;
+    std::vector<size_t> ends;
+
+    const int nType;
+    const int nVersion;
+public:
+
+    CHashBatch(int nTypeIn, int nVersionIn) : nType(nTypeIn), nVersion(nVersionIn) {}
+
+    int GetType() const { return nType; }
+    int GetVersion() const { return nVersion; }
+
+    void write(const char *pch, size_t size) {
+        data.insert(data.end(), (const unsigned char*)pch, (const unsigned char*)pch + size);
+    }
+
+    template<typename T>
+    CHashBatch& operator<<(const T& obj) {
+        // Serialize to this stream
+        ::Serialize(*this, obj);
+        return (*this);
+    }
+
+    /** Ends the data of the current hash. */
+    void Next() { ends.push_back(data.size()); }
+
+    /** Number of hashes ended so far. */
+    size_t size() const { return ends.size(); }
+
+    /** Computes the hashes in the order they were ended. */
+    std::vector<uint256> GetHashes() const {
+        std::vector<const unsigned char*> inputs(ends.size());
+        std::vector<size_t> sizes(ends.size());
+        size_t begin = 0;
+        for (size_t i = 0; i < ends.size(); ++i) {
+            inputs[i] = data.data() + begin;
+            sizes[i] = ends[i] - begin;
+            begin = ends[i];
+        }
+        std::vector<uint256> hashes(ends.size());
+        if (!hashes.empty())
+            SHA256DMulti(hashes[0].begin(), inputs.data(), sizes.data(), hashes.size());
+        return hashes;
+    }
+};
+
 /** Compute the 256-bit hash of an object's serialization. */
 template<typename T>
 uint256 SerializeHash(const T& obj, int nType=SER_GETHASH, int nVersion=PROTOCOL_VERSION)
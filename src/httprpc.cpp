@@ -15,9 +15,12 @@
 #include <util/strencodings.h>
 #include <ui_interface.h>
 #include <walletinitinterface.h>
+#include <xrouter/xrouterapp.h>
+#include <xrouter/xroutererror.h>
 #include <crypto/hmac_sha256.h>
 #include <stdio.h>
 
+#include <algorithm>
 #include <memory>
 
 #include <boost/algorithm/string.hpp> // boost::trim
@@ -145,14 +148,9 @@ static bool RPCAuthorized(const std::string& strAuth, std::string& strAuthUserna
     return multiUserAuthorized(strUserPass);
 }
 
-static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
+/** Checks the authorization of the request, replies with 401 if it isn't authorized */
+static bool HTTPReq_Authorized(HTTPRequest* req, JSONRPCRequest& jreq)
 {
-    // JSONRPC handles only POST
-    if (req->GetRequestMethod() != HTTPRequest::POST) {
-        req->WriteReply(HTTP_BAD_METHOD, "JSONRPC server handles only POST requests");
-        return false;
-    }
-    // Check authorization
     std::pair<bool, std::string> authHeader = req->GetHeader("authorization");
     if (!authHeader.first) {
         req->WriteHeader("WWW-Authenticate", WWW_AUTH_HEADER_DATA);
@@ -160,7 +158,6 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         return false;
     }
 
-    JSONRPCRequest jreq;
     jreq.peerAddr = req->GetPeer().ToString();
     if (!RPCAuthorized(authHeader.second, jreq.authUser)) {
         LogPrintf("ThreadRPCServer incorrect password attempt from %s\n", jreq.peerAddr);
@@ -174,34 +171,59 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         req->WriteReply(HTTP_UNAUTHORIZED);
         return false;
     }
+    return true;
+}
+
+static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
+{
+    // JSONRPC handles only POST
+    if (req->GetRequestMethod() != HTTPRequest::POST) {
+        req->WriteReply(HTTP_BAD_METHOD, "JSONRPC server handles only POST requests");
+        return false;
+    }
+    // Check authorization
+    JSONRPCRequest jreq;
+    if (!HTTPReq_Authorized(req, jreq))
+        return false;
 
     try {
-        // Parse request
+        // Parse request in place from the request buffer
         UniValue valRequest;
-        if (!valRequest.read(req->ReadBody()))
+        const auto body = req->GetBodyData();
+        if (!valRequest.read(body.first, body.second))
             throw JSONRPCError(RPC_PARSE_ERROR, "Parse error");
 
         // Set the URI
         jreq.URI = req->GetURI();
 
-        std::string strReply;
         // singleton request
         if (valRequest.isObject()) {
             jreq.parse(valRequest);
 
             UniValue result = tableRPC.execute(jreq);
 
-            // Send reply
-            strReply = JSONRPCReply(result, NullUniValue, jreq.id);
+            // Send reply, large results are serialized straight into the reply buffer
+            req->WriteHeader("Content-Type", "application/json");
+            size_t replySize{0};
+            req->WriteReply(HTTP_OK, [&](const HTTPRequest::BodyAppender& append) {
+                JSONRPCReplyWrite(result, NullUniValue, jreq.id, [&](const char* data, size_t size) {
+                    replySize += size;
+                    append(data, size);
+                });
+            });
+            RPCRecordResponseSize(jreq.strMethod, replySize);
 
         // array of requests
-        } else if (valRequest.isArray())
-            strReply = JSONRPCExecBatch(jreq, valRequest.get_array());
-        else
+        } else if (valRequest.isArray()) {
+            UniValue replies = JSONRPCExecBatch(jreq, valRequest.get_array());
+
+            req->WriteHeader("Content-Type", "application/json");
+            req->WriteReply(HTTP_OK, [&](const HTTPRequest::BodyAppender& append) {
+                JSONWrite(replies, append);
+                append("\n", 1);
+            });
+        } else
             throw JSONRPCError(RPC_PARSE_ERROR, "Top-level object parse error");
-
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strReply);
     } catch (const UniValue& objError) {
         JSONErrorReply(req, objError, jreq.id);
         return false;
@@ -212,6 +234,30 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
     return true;
 }
 
+/** Long-poll for the reply of an async XRouter call (xrAsync): /xrouter/reply/<id>. The request
+ * is parked without a worker thread and answered from the thread that completes the call. */
+static bool HTTPReq_XRouterReply(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (req->GetRequestMethod() != HTTPRequest::GET) {
+        req->WriteReply(HTTP_BAD_METHOD, "XRouter replies are requested with GET");
+        return false;
+    }
+    JSONRPCRequest jreq;
+    if (!HTTPReq_Authorized(req, jreq))
+        return false;
+
+    std::shared_ptr<HTTPRequest> parked = req->Detach();
+    const bool found = xrouter::App::instance().waitAsyncReply(strURIPart, [parked](const std::string& reply) {
+        parked->WriteHeader("Content-Type", "application/json");
+        parked->WriteReply(HTTP_OK, reply + "\n");
+    });
+    if (!found) {
+        parked->WriteReply(HTTP_NOT_FOUND, "Unknown or expired reply id: " + strURIPart + "\r\n");
+        return false;
+    }
+    return true;
+}
+
 static bool InitRPCAuthentication()
 {
     if (gArgs.GetArg("-rpcpassword", "") == "")
@@ -234,6 +280,65 @@ static bool InitRPCAuthentication()
     return true;
 }
 
+/** Bytes at the start of a json-rpc request searched for the method */
+static const size_t JSONRPC_METHOD_SCAN_SIZE = 4096;
+
+/**
+ * Value of the first "method" key in the json-rpc request, empty if there's none or it's
+ * escaped. The request isn't parsed, a "method" key in the params of an earlier call may
+ * be found instead, which only picks another queue.
+ */
+static std::string ScanJSONRPCMethod(const char* data, const size_t size)
+{
+    static const std::string key = "\"method\"";
+    const char* end = data + size;
+    const char* pos = data;
+    while ((pos = std::search(pos, end, key.begin(), key.end())) != end) {
+        const bool escaped = pos != data && *(pos - 1) == '\\';
+        pos += key.size();
+        if (escaped)
+            continue;
+        const char* p = pos;
+        while (p != end && IsSpace(*p))
+            ++p;
+        if (p == end || *p != ':')
+            continue;
+        ++p;
+        while (p != end && IsSpace(*p))
+            ++p;
+        if (p == end || *p != '"')
+            continue;
+        const char* first = ++p;
+        while (p != end && *p != '"' && *p != '\\')
+            ++p;
+        if (p == end || *p != '"')
+            return "";
+        return std::string(first, p);
+    }
+    return "";
+}
+
+/**
+ * Work queue of a json-rpc request: the category of the called method, of the first call for
+ * batches. Runs on the event loop thread, unauthorized requests go to the default queue where
+ * they're rejected, and the method is scanned for instead of parsing the request.
+ */
+static std::string JSONRPCWorkQueue(HTTPRequest* req)
+{
+    if (req->GetRequestMethod() != HTTPRequest::POST)
+        return "";
+    std::pair<bool, std::string> authHeader = req->GetHeader("authorization");
+    std::string authUser;
+    if (!authHeader.first || !RPCAuthorized(authHeader.second, authUser))
+        return "";
+    const auto body = req->GetBodyData(JSONRPC_METHOD_SCAN_SIZE);
+    const std::string method = ScanJSONRPCMethod(body.first, body.second);
+    if (method.empty())
+        return "";
+    const CRPCCommand* command = tableRPC[method];
+    return command ? command->category : "";
+}
+
 bool StartHTTPRPC()
 {
     LogPrint(BCLog::RPC, "Starting HTTP RPC server\n");
@@ -244,6 +349,8 @@ bool StartHTTPRPC()
     if (g_wallet_init_interface.HasWalletSupport()) {
         RegisterHTTPHandler("/wallet/", false, HTTPReq_JSONRPC);
     }
+    RegisterHTTPHandler("/xrouter/reply/", false, HTTPReq_XRouterReply);
+    SetHTTPQueueSelector(JSONRPCWorkQueue);
     struct event_base* eventBase = EventBase();
     assert(eventBase);
     httpRPCTimerInterface = MakeUnique<HTTPRPCTimerInterface>(eventBase);
@@ -259,10 +366,15 @@ void InterruptHTTPRPC()
 void StopHTTPRPC()
 {
     LogPrint(BCLog::RPC, "Stopping HTTP RPC server\n");
+    SetHTTPQueueSelector(nullptr);
     UnregisterHTTPHandler("/", true);
     if (g_wallet_init_interface.HasWalletSupport()) {
         UnregisterHTTPHandler("/wallet/", false);
     }
+    UnregisterHTTPHandler("/xrouter/reply/", false);
+    // Parked long-polls must be answered while the HTTP server still runs
+    for (const auto& onReply : xrouter::App::instance().cancelAsyncWaiters())
+        onReply("{\"error\":\"Shutting down\",\"code\":" + std::to_string(xrouter::SERVER_TIMEOUT) + "}");
     if (httpRPCTimerInterface) {
         RPCUnsetTimerInterface(httpRPCTimerInterface.get());
         httpRPCTimerInterface.reset();
@@ -14,7 +14,9 @@
 #include <sync.h>
 #include <ui_interface.h>
 
+#include <map>
 #include <memory>
+#include <set>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -31,6 +33,8 @@
 
 #include <support/events.h>
 
+#include <boost/algorithm/string.hpp>
+
 #ifdef EVENT__HAVE_NETINET_IN_H
 #include <netinet/in.h>
 #ifdef _XOPEN_SOURCE_EXTENDED
@@ -143,10 +147,21 @@ struct evhttp* eventHTTP = nullptr;
 static std::vector<CSubNet> rpc_allow_subnets;
 //! Work queue for handling longer requests off the event loop thread
 static WorkQueue<HTTPClosure>* workQueue = nullptr;
+//! Work queues configured with -rpcqueue, by queue name (rpc category). Queues listed for
+//! several names are shared.
+static std::map<std::string, std::shared_ptr<WorkQueue<HTTPClosure>>> namedWorkQueues;
+//! Worker thread count of the queues in namedWorkQueues
+static std::map<WorkQueue<HTTPClosure>*, int> namedWorkQueueThreads;
+//! Selects the named work queue of a request
+static HTTPQueueSelector workQueueSelector;
 //! Handlers for (sub)paths
 std::vector<HTTPPathHandler> pathHandlers;
 //! Bound listening sockets
 std::vector<evhttp_bound_socket *> boundSockets;
+//! Open client connections, only accessed on the event loop thread
+static std::set<evhttp_connection*> httpConnections;
+//! Maximum number of open (keep-alive) client connections, 0 for no limit
+static size_t maxHTTPConnections = DEFAULT_HTTP_MAX_CONNECTIONS;
 
 /** Check if a network address is allowed to access the HTTP server */
 static bool ClientAllowed(const CNetAddr& netaddr)
@@ -208,6 +223,27 @@ static std::string RequestMethodString(HTTPRequest::RequestMethod m)
     }
 }
 
+/** Connection close callback of the connections counted for -rpcmaxconnections */
+static void http_connection_close_cb(struct evhttp_connection* conn, void*)
+{
+    httpConnections.erase(conn);
+}
+
+/** Counts the connection of a request, returns false if it is a new connection over the limit */
+static bool http_track_connection(struct evhttp_request* req)
+{
+    if (maxHTTPConnections == 0)
+        return true;
+    evhttp_connection* conn = evhttp_request_get_connection(req);
+    if (!conn || httpConnections.count(conn))
+        return true;
+    if (httpConnections.size() >= maxHTTPConnections)
+        return false;
+    httpConnections.insert(conn);
+    evhttp_connection_set_closecb(conn, http_connection_close_cb, nullptr);
+    return true;
+}
+
 /** HTTP request callback */
 static void http_request_cb(struct evhttp_request* req, void* arg)
 {
@@ -231,6 +267,15 @@ static void http_request_cb(struct evhttp_request* req, void* arg)
         return;
     }
 
+    // Keep-alive connections are reused for many requests, new connections over the limit are closed
+    if (!http_track_connection(req)) {
+        LogPrint(BCLog::HTTP, "HTTP request from %s rejected: Too many connections, see -rpcmaxconnections\n",
+                 hreq->GetPeer().ToString());
+        hreq->WriteHeader("Connection", "close");
+        hreq->WriteReply(HTTP_SERVUNAVAIL, "Too many connections");
+        return;
+    }
+
     // Early reject unknown HTTP methods
     if (hreq->GetRequestMethod() == HTTPRequest::UNKNOWN) {
         LogPrint(BCLog::HTTP, "HTTP request from %s rejected: Unknown HTTP request method\n",
@@ -261,12 +306,23 @@ static void http_request_cb(struct evhttp_request* req, void* arg)
 
     // Dispatch to worker thread
     if (i != iend) {
+        WorkQueue<HTTPClosure>* queue = workQueue;
+        std::string queueName;
+        if (!namedWorkQueues.empty() && workQueueSelector) {
+            queueName = workQueueSelector(hreq.get());
+            auto it = namedWorkQueues.find(queueName);
+            if (it != namedWorkQueues.end())
+                queue = it->second.get();
+        }
         std::unique_ptr<HTTPWorkItem> item(new HTTPWorkItem(std::move(hreq), path, i->handler));
-        assert(workQueue);
-        if (workQueue->Enqueue(item.get()))
+        assert(queue);
+        if (queue->Enqueue(item.get()))
             item.release(); /* if true, queue took ownership */
         else {
-            LogPrintf("WARNING: request rejected because http work queue depth exceeded, it can be increased with the -rpcworkqueue= setting\n");
+            if (queue != workQueue)
+                LogPrintf("WARNING: request rejected because http work queue depth of %s exceeded, it can be increased with the -rpcqueue= setting\n", queueName);
+            else
+                LogPrintf("WARNING: request rejected because http work queue depth exceeded, it can be increased with the -rpcworkqueue= setting\n");
             item->req->WriteReply(HTTP_INTERNAL, "Work queue depth exceeded");
         }
     } else {
@@ -354,6 +410,37 @@ static void libevent_log_cb(int severity, const char *msg)
         LogPrint(BCLog::LIBEVENT, "libevent: %s\n", msg);
 }
 
+/** Parse the -rpcqueue=<name>[,<name>...]:<threads>[:<depth>] work queues */
+static bool InitHTTPNamedWorkQueues()
+{
+    namedWorkQueues.clear();
+    namedWorkQueueThreads.clear();
+    for (const std::string& strQueue : gArgs.GetArgs("-rpcqueue")) {
+        std::vector<std::string> parts;
+        boost::split(parts, strQueue, boost::is_any_of(":"));
+        int64_t threads{0};
+        int64_t depth{DEFAULT_HTTP_WORKQUEUE};
+        if (parts.size() < 2 || parts.size() > 3 || parts[0].empty() ||
+            !ParseInt64(parts[1], &threads) || threads < 1 ||
+            (parts.size() == 3 && (!ParseInt64(parts[2], &depth) || depth < 1))) {
+            uiInterface.ThreadSafeMessageBox(
+                strprintf("Invalid -rpcqueue specification: %s. Valid is a list of rpc categories followed by the thread count and optionally the queue depth (e.g. xrouter,xbridge:2:16).", strQueue),
+                "", CClientUIInterface::MSG_ERROR);
+            return false;
+        }
+        auto queue = std::make_shared<WorkQueue<HTTPClosure>>(static_cast<size_t>(depth));
+        std::vector<std::string> names;
+        boost::split(names, parts[0], boost::is_any_of(","));
+        for (const std::string& name : names) {
+            if (!name.empty())
+                namedWorkQueues[name] = queue;
+        }
+        namedWorkQueueThreads[queue.get()] = static_cast<int>(threads);
+        LogPrintf("HTTP: creating work queue of depth %d for %s\n", depth, parts[0]);
+    }
+    return true;
+}
+
 bool InitHTTPServer()
 {
     if (!InitHTTPAllowList())
@@ -385,6 +472,7 @@ bool InitHTTPServer()
     }
 
     evhttp_set_timeout(http, gArgs.GetArg("-rpcservertimeout", DEFAULT_HTTP_SERVER_TIMEOUT));
+    maxHTTPConnections = static_cast<size_t>(std::max(gArgs.GetArg("-rpcmaxconnections", DEFAULT_HTTP_MAX_CONNECTIONS), (int64_t)0));
     evhttp_set_max_headers_size(http, MAX_HEADERS_SIZE);
     evhttp_set_max_body_size(http, MAX_SIZE);
     evhttp_set_gencb(http, http_request_cb, nullptr);
@@ -399,6 +487,8 @@ bool InitHTTPServer()
     LogPrintf("HTTP: creating work queue of depth %d\n", workQueueDepth);
 
     workQueue = new WorkQueue<HTTPClosure>(workQueueDepth);
+    if (!InitHTTPNamedWorkQueues())
+        return false;
     // transfer ownership to eventBase/HTTP via .release()
     eventBase = base_ctr.release();
     eventHTTP = http_ctr.release();
@@ -432,6 +522,11 @@ void StartHTTPServer()
     for (int i = 0; i < rpcThreads; i++) {
         g_thread_http_workers.emplace_back(HTTPWorkQueueRun, workQueue);
     }
+    for (const auto& queue : namedWorkQueueThreads) {
+        for (int i = 0; i < queue.second; i++) {
+            g_thread_http_workers.emplace_back(HTTPWorkQueueRun, queue.first);
+        }
+    }
 }
 
 void InterruptHTTPServer()
@@ -443,6 +538,8 @@ void InterruptHTTPServer()
     }
     if (workQueue)
         workQueue->Interrupt();
+    for (const auto& queue : namedWorkQueueThreads)
+        queue.first->Interrupt();
 }
 
 void StopHTTPServer()
@@ -456,6 +553,8 @@ void StopHTTPServer()
         g_thread_http_workers.clear();
         delete workQueue;
         workQueue = nullptr;
+        namedWorkQueueThreads.clear();
+        namedWorkQueues.clear();
     }
     // Unlisten sockets, these are what make the event loop running, which means
     // that after this and all connections are closed the event loop will quit.
@@ -523,6 +622,15 @@ HTTPRequest::~HTTPRequest()
     // evhttpd cleans up the request, as long as a reply was sent.
 }
 
+std::unique_ptr<HTTPRequest> HTTPRequest::Detach()
+{
+    assert(!replySent && req);
+    std::unique_ptr<HTTPRequest> detached(new HTTPRequest(req));
+    replySent = true; // the reply is written by the detached request
+    req = nullptr;
+    return detached;
+}
+
 std::pair<bool, std::string> HTTPRequest::GetHeader(const std::string& hdr) const
 {
     const struct evkeyvalq* headers = evhttp_request_get_input_headers(req);
@@ -534,6 +642,31 @@ std::pair<bool, std::string> HTTPRequest::GetHeader(const std::string& hdr) cons
         return std::make_pair(false, "");
 }
 
+std::pair<const char*, size_t> HTTPRequest::GetBodyData()
+{
+    struct evbuffer* buf = evhttp_request_get_input_buffer(req);
+    if (!buf)
+        return {"", 0};
+    size_t size = evbuffer_get_length(buf);
+    // Only linearizes bodies that arrived in several chunks, a single chunk is used in place
+    const char* data = (const char*)evbuffer_pullup(buf, size);
+    if (!data) // returns nullptr in case of empty buffer
+        return {"", 0};
+    return {data, size};
+}
+
+std::pair<const char*, size_t> HTTPRequest::GetBodyData(size_t maxSize)
+{
+    struct evbuffer* buf = evhttp_request_get_input_buffer(req);
+    if (!buf)
+        return {"", 0};
+    size_t size = std::min(evbuffer_get_length(buf), maxSize);
+    const char* data = (const char*)evbuffer_pullup(buf, size);
+    if (!data)
+        return {"", 0};
+    return {data, size};
+}
+
 std::string HTTPRequest::ReadBody()
 {
     struct evbuffer* buf = evhttp_request_get_input_buffer(req);
@@ -567,6 +700,13 @@ void HTTPRequest::WriteHeader(const std::string& hdr, const std::string& value)
  * this cannot be done from worker threads.
  */
 void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
+{
+    WriteReply(nStatus, [&strReply](const BodyAppender& append) {
+        append(strReply.data(), strReply.size());
+    });
+}
+
+void HTTPRequest::WriteReply(int nStatus, const std::function<void(const BodyAppender&)>& writer)
 {
     assert(!replySent && req);
     if (ShutdownRequested()) {
@@ -575,7 +715,9 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
     // Send event to main http thread to send reply message
     struct evbuffer* evb = evhttp_request_get_output_buffer(req);
     assert(evb);
-    evbuffer_add(evb, strReply.data(), strReply.size());
+    writer([evb](const char* data, size_t size) {
+        evbuffer_add(evb, data, size);
+    });
     auto req_copy = req;
     HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, nStatus]{
         evhttp_send_reply(req_copy, nStatus, nullptr, nullptr);
@@ -636,6 +778,11 @@ HTTPRequest::RequestMethod HTTPRequest::GetRequestMethod() const
     }
 }
 
+void SetHTTPQueueSelector(const HTTPQueueSelector &selector)
+{
+    workQueueSelector = selector;
+}
+
 void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler)
 {
     LogPrint(BCLog::HTTP, "Registering HTTP handler for %s (exactmatch %d)\n", prefix, exactMatch);
@@ -5,13 +5,16 @@
 #ifndef BITCOIN_HTTPSERVER_H
 #define BITCOIN_HTTPSERVER_H
 
+#include <memory>
 #include <string>
 #include <stdint.h>
 #include <functional>
+#include <utility>
 
 static const int DEFAULT_HTTP_THREADS=4;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
 static const int DEFAULT_HTTP_SERVER_TIMEOUT=30;
+static const int DEFAULT_HTTP_MAX_CONNECTIONS=0;
 
 struct evhttp_request;
 struct event_base;
@@ -46,6 +49,15 @@ void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPR
 /** Unregister handler for prefix */
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
 
+/** Returns the work queue name of a request, see -rpcqueue. Requests of names without a
+ * queue of their own go to the default queue. Runs on the event loop thread.
+ */
+typedef std::function<std::string(HTTPRequest* req)> HTTPQueueSelector;
+/** Set the work queue selector, only used if work queues were configured with -rpcqueue.
+ * Pass nullptr to send all requests to the default queue.
+ */
+void SetHTTPQueueSelector(const HTTPQueueSelector &selector);
+
 /** Return evhttp event base. This can be used by submodules to
  * queue timers or custom events.
  */
@@ -98,6 +110,17 @@ public:
      */
     std::string ReadBody();
 
+    /**
+     * Get the request body in place, without copying or consuming it. The data
+     * stays valid until the body is read or the reply is written.
+     */
+    std::pair<const char*, size_t> GetBodyData();
+
+    /**
+     * Get at most the first maxSize bytes of the request body in place, see GetBodyData.
+     */
+    std::pair<const char*, size_t> GetBodyData(size_t maxSize);
+
     /**
      * Write output header.
      *
@@ -114,6 +137,25 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Write HTTP reply with a body that is appended in pieces by writer, so that
+     * large replies don't need to be built in a string first.
+     *
+     * @note Same restrictions as WriteReply(int, const std::string&).
+     */
+    typedef std::function<void(const char* data, size_t size)> BodyAppender;
+    void WriteReply(int nStatus, const std::function<void(const BodyAppender&)>& writer);
+
+    /**
+     * Take over the request, so that the reply can be written after the handler
+     * returned, e.g. from a callback on another thread. The reply must be written
+     * before the HTTP server stops.
+     *
+     * @note This object is left without a request, do not call any other HTTPRequest
+     * methods on it.
+     */
+    std::unique_ptr<HTTPRequest> Detach();
 };
 
 /** Event handler closure.
@@ -0,0 +1,343 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/addressindex.h>
+#include <crypto/sha256.h>
+#include <undo.h>
+#include <util/system.h>
+#include <validation.h>
+#include <validationinterface.h>
+
+/* The index database stores the history and the unspent outputs of every script, keyed by
+ * the script hash so that the entries of a script are next to each other:
+ *
+ * 'a' + script hash + height + txid + index + spending -> amount
+ * 'u' + script hash + txid + vout -> (amount, height)
+ * 'w' -> hash of the last block written
+ *
+ * The last block is written with the entries of its block. After a restart it may be ahead
+ * of the best block of the index, it's rewound when the next block is written.
+ */
+constexpr char DB_ADDRESS_HISTORY = 'a';
+constexpr char DB_ADDRESS_UNSPENT = 'u';
+constexpr char DB_WRITTEN_BLOCK = 'w';
+
+std::unique_ptr<AddressIndex> g_addressindex;
+
+uint256 AddressScriptHash(const CScript& script)
+{
+    uint256 hash;
+    CSHA256().Write(script.data(), script.size()).Finalize(hash.begin());
+    return hash;
+}
+
+namespace {
+
+/// Big endian keys so that leveldb iterates the history of a script in height order.
+struct DBHistoryKey {
+    uint256 script_hash;
+    int height{0};
+    uint256 txid;
+    uint32_t index{0};
+    bool spending{false};
+
+    DBHistoryKey() = default;
+    DBHistoryKey(const uint256& script_hash_in, int height_in, const uint256& txid_in, uint32_t index_in, bool spending_in)
+        : script_hash(script_hash_in), height(height_in), txid(txid_in), index(index_in), spending(spending_in) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_ADDRESS_HISTORY);
+        script_hash.Serialize(s);
+        ser_writedata32be(s, static_cast<uint32_t>(height));
+        txid.Serialize(s);
+        ser_writedata32be(s, index);
+        ser_writedata8(s, spending ? 1 : 0);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        if (ser_readdata8(s) != DB_ADDRESS_HISTORY) {
+            throw std::ios_base::failure("Invalid format for address index DB history key");
+        }
+        script_hash.Unserialize(s);
+        height = static_cast<int>(ser_readdata32be(s));
+        txid.Unserialize(s);
+        index = ser_readdata32be(s);
+        spending = ser_readdata8(s) != 0;
+    }
+};
+
+struct DBUnspentKey {
+    uint256 script_hash;
+    COutPoint outpoint;
+
+    DBUnspentKey() = default;
+    DBUnspentKey(const uint256& script_hash_in, const COutPoint& outpoint_in)
+        : script_hash(script_hash_in), outpoint(outpoint_in) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_ADDRESS_UNSPENT);
+        script_hash.Serialize(s);
+        outpoint.hash.Serialize(s);
+        ser_writedata32be(s, outpoint.n);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        if (ser_readdata8(s) != DB_ADDRESS_UNSPENT) {
+            throw std::ios_base::failure("Invalid format for address index DB unspent key");
+        }
+        script_hash.Unserialize(s);
+        outpoint.hash.Unserialize(s);
+        outpoint.n = ser_readdata32be(s);
+    }
+};
+
+struct DBUnspentVal {
+    CAmount amount{0};
+    int height{0};
+
+    DBUnspentVal() = default;
+    DBUnspentVal(CAmount amount_in, int height_in) : amount(amount_in), height(height_in) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(amount);
+        READWRITE(height);
+    }
+};
+
+/// Outputs that never enter the UTXO set are left out, as are the empty coinstake markers.
+bool IsIndexed(const CTxOut& out)
+{
+    return !out.scriptPubKey.empty() && !out.scriptPubKey.IsUnspendable();
+}
+
+} // namespace
+
+/**
+ * Access to the address index database (indexes/addressindex/)
+ */
+class AddressIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    bool ReadWrittenBlock(uint256& block_hash) const;
+
+    /// Adds the entries of the block to the index, or takes them out when disconnecting,
+    /// and records written_block as the last block written at once.
+    bool WriteBlock(const CBlock& block, const CBlockUndo& block_undo, int height, bool connect, const uint256& written_block);
+
+    bool ReadHistory(const uint256& script_hash, int height_begin, std::vector<AddressHistoryEntry>& entries) const;
+
+    bool ReadUnspent(const uint256& script_hash, std::vector<AddressUnspentEntry>& entries) const;
+};
+
+AddressIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "addressindex", n_cache_size, f_memory, f_wipe)
+{}
+
+bool AddressIndex::DB::ReadWrittenBlock(uint256& block_hash) const
+{
+    return Read(DB_WRITTEN_BLOCK, block_hash);
+}
+
+bool AddressIndex::DB::WriteBlock(const CBlock& block, const CBlockUndo& block_undo, int height, bool connect, const uint256& written_block)
+{
+    CDBBatch batch(*this);
+    // Later operations of a batch win, disconnected transactions are undone in reverse
+    // so that outputs spent in the same block end up spent or unspent as they should
+    for (size_t k = 0; k < block.vtx.size(); ++k) {
+        const size_t i = connect ? k : block.vtx.size() - 1 - k;
+        const CTransaction& tx = *block.vtx[i];
+        const uint256& txid = tx.GetHash();
+        for (uint32_t n = 0; n < tx.vout.size(); ++n) {
+            const CTxOut& out = tx.vout[n];
+            if (!IsIndexed(out)) {
+                continue;
+            }
+            const uint256 script_hash = AddressScriptHash(out.scriptPubKey);
+            const DBHistoryKey history_key(script_hash, height, txid, n, false);
+            const DBUnspentKey unspent_key(script_hash, COutPoint(txid, n));
+            if (connect) {
+                batch.Write(history_key, out.nValue);
+                batch.Write(unspent_key, DBUnspentVal(out.nValue, height));
+            } else {
+                batch.Erase(history_key);
+                batch.Erase(unspent_key);
+            }
+        }
+        if (i == 0) {
+            continue; // the coinbase spends nothing
+        }
+        const CTxUndo& tx_undo = block_undo.vtxundo[i - 1];
+        for (uint32_t n = 0; n < tx.vin.size(); ++n) {
+            const Coin& coin = tx_undo.vprevout[n];
+            if (!IsIndexed(coin.out)) {
+                continue;
+            }
+            const uint256 script_hash = AddressScriptHash(coin.out.scriptPubKey);
+            const DBHistoryKey history_key(script_hash, height, txid, n, true);
+            const DBUnspentKey unspent_key(script_hash, tx.vin[n].prevout);
+            if (connect) {
+                batch.Write(history_key, -coin.out.nValue);
+                batch.Erase(unspent_key);
+            } else {
+                batch.Erase(history_key);
+                batch.Write(unspent_key, DBUnspentVal(coin.out.nValue, static_cast<int>(coin.nHeight)));
+            }
+        }
+    }
+    batch.Write(DB_WRITTEN_BLOCK, written_block);
+    return WriteBatch(batch);
+}
+
+bool AddressIndex::DB::ReadHistory(const uint256& script_hash, int height_begin, std::vector<AddressHistoryEntry>& entries) const
+{
+    std::unique_ptr<CDBIterator> it(const_cast<DB*>(this)->NewIterator());
+    for (it->Seek(DBHistoryKey(script_hash, std::max(height_begin, 0), uint256(), 0, false)); it->Valid(); it->Next()) {
+        DBHistoryKey key;
+        if (!it->GetKey(key) || key.script_hash != script_hash) {
+            break;
+        }
+        AddressHistoryEntry entry;
+        if (!it->GetValue(entry.amount)) {
+            return error("%s: failed to read history entry of tx %s", __func__, key.txid.ToString());
+        }
+        entry.height = key.height;
+        entry.txid = key.txid;
+        entry.index = key.index;
+        entry.spending = key.spending;
+        entries.push_back(entry);
+    }
+    return true;
+}
+
+bool AddressIndex::DB::ReadUnspent(const uint256& script_hash, std::vector<AddressUnspentEntry>& entries) const
+{
+    std::unique_ptr<CDBIterator> it(const_cast<DB*>(this)->NewIterator());
+    for (it->Seek(DBUnspentKey(script_hash, COutPoint(uint256(), 0))); it->Valid(); it->Next()) {
+        DBUnspentKey key;
+        if (!it->GetKey(key) || key.script_hash != script_hash) {
+            break;
+        }
+        DBUnspentVal value;
+        if (!it->GetValue(value)) {
+            return error("%s: failed to read unspent output %s", __func__, key.outpoint.ToString());
+        }
+        AddressUnspentEntry entry;
+        entry.outpoint = key.outpoint;
+        entry.amount = value.amount;
+        entry.height = value.height;
+        entries.push_back(entry);
+    }
+    return true;
+}
+
+AddressIndex::AddressIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<AddressIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+AddressIndex::~AddressIndex() {}
+
+bool AddressIndex::Init()
+{
+    if (!m_db->ReadWrittenBlock(m_written_block)) {
+        m_written_block.SetNull();
+    }
+    return BaseIndex::Init();
+}
+
+bool AddressIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    // The transactions of the genesis block aren't connected
+    if (pindex->nHeight == 0) {
+        if (!m_db->WriteBlock(CBlock(), CBlockUndo(), 0, true, pindex->GetBlockHash())) {
+            return false;
+        }
+        m_written_block = pindex->GetBlockHash();
+        return true;
+    }
+
+    if (!m_written_block.IsNull() && m_written_block != pindex->pprev->GetBlockHash() && !Rewind(pindex->pprev)) {
+        return false;
+    }
+
+    CBlockUndo block_undo;
+    if (!UndoReadFromDisk(block_undo, pindex)) {
+        return false;
+    }
+    if (block_undo.vtxundo.size() + 1 != block.vtx.size()) {
+        return error("%s: undo data of block %s doesn't match the block", __func__, pindex->GetBlockHash().ToString());
+    }
+    if (!m_db->WriteBlock(block, block_undo, pindex->nHeight, true, pindex->GetBlockHash())) {
+        return false;
+    }
+    m_written_block = pindex->GetBlockHash();
+    return true;
+}
+
+bool AddressIndex::Rewind(const CBlockIndex* target_index)
+{
+    const CBlockIndex* pindex;
+    {
+        LOCK(cs_main);
+        pindex = LookupBlockIndex(m_written_block);
+    }
+    if (!pindex || pindex->GetAncestor(target_index->nHeight) != target_index) {
+        return error("%s: can't rewind the address index from block %s to block %s", __func__,
+                     m_written_block.ToString(), target_index->GetBlockHash().ToString());
+    }
+
+    const Consensus::Params& consensus_params = Params().GetConsensus();
+    for (; pindex != target_index; pindex = pindex->pprev) {
+        CBlock block;
+        CBlockUndo block_undo;
+        if (!ReadBlockFromDisk(block, pindex, consensus_params) || !UndoReadFromDisk(block_undo, pindex)) {
+            return error("%s: failed to read block %s", __func__, pindex->GetBlockHash().ToString());
+        }
+        if (block_undo.vtxundo.size() + 1 != block.vtx.size()) {
+            return error("%s: undo data of block %s doesn't match the block", __func__, pindex->GetBlockHash().ToString());
+        }
+        if (!m_db->WriteBlock(block, block_undo, pindex->nHeight, false, pindex->pprev->GetBlockHash())) {
+            return false;
+        }
+        m_written_block = pindex->pprev->GetBlockHash();
+    }
+    return true;
+}
+
+BaseIndex::DB& AddressIndex::GetDB() const { return *m_db; }
+
+void AddressIndex::Start()
+{
+    // Register before Init() so that blocks connected during the sync are not missed
+    RegisterValidationInterface(this);
+    BaseIndex::Start();
+}
+
+void AddressIndex::Stop()
+{
+    UnregisterValidationInterface(this);
+    BaseIndex::Stop();
+}
+
+bool AddressIndex::FindHistory(const CScript& script, int height_begin, std::vector<AddressHistoryEntry>& entries) const
+{
+    return m_db->ReadHistory(AddressScriptHash(script), height_begin, entries);
+}
+
+bool AddressIndex::FindUnspent(const CScript& script, std::vector<AddressUnspentEntry>& entries) const
+{
+    return m_db->ReadUnspent(AddressScriptHash(script), entries);
+}
@@ -0,0 +1,102 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BLOCKNET_INDEX_ADDRESSINDEX_H
+#define BLOCKNET_INDEX_ADDRESSINDEX_H
+
+#include <amount.h>
+#include <chain.h>
+#include <index/base.h>
+#include <primitives/transaction.h>
+#include <script/script.h>
+#include <uint256.h>
+
+#include <vector>
+
+static const bool DEFAULT_ADDRESSINDEX = false;
+
+/**
+ * A transaction that paid to or spent from an address. Receiving entries point to
+ * the output of the transaction, spending entries to the input.
+ */
+struct AddressHistoryEntry
+{
+    int height{0};
+    uint256 txid;
+    uint32_t index{0};
+    bool spending{false};
+    /// Negative for spending entries
+    CAmount amount{0};
+};
+
+/**
+ * An unspent output of an address.
+ */
+struct AddressUnspentEntry
+{
+    COutPoint outpoint;
+    CAmount amount{0};
+    int height{0};
+};
+
+/// The key of a script in the address index, the SHA256 of the script.
+uint256 AddressScriptHash(const CScript& script);
+
+/**
+ * AddressIndex keeps the history and the unspent outputs of every script in the active
+ * chain, so that the balance of an address can be looked up without scanning the UTXO set.
+ * The coins a block spends are read from its undo data. Disconnected blocks are taken out
+ * of the index when the next block of the new branch is written, like the running hash of
+ * the coin stats index.
+ */
+class AddressIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+    /// The last block written to the index, may be ahead of the best block after a restart.
+    uint256 m_written_block;
+
+    /// Takes the blocks after target_index out of the index.
+    bool Rewind(const CBlockIndex* target_index);
+
+protected:
+    bool Init() override;
+
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "addressindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit AddressIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~AddressIndex() override;
+
+    /// Registers for block notifications and starts the sync thread.
+    void Start();
+
+    /// Unregisters from block notifications and joins the sync thread.
+    void Stop();
+
+    /// Returns true once the index caught up with the chain.
+    bool IsSynced() const { return m_synced; }
+
+    /// Get the history of the script at and above the height, in chain order.
+    bool FindHistory(const CScript& script, int height_begin, std::vector<AddressHistoryEntry>& entries) const;
+
+    /// Get the unspent outputs of the script.
+    bool FindUnspent(const CScript& script, std::vector<AddressUnspentEntry>& entries) const;
+};
+
+/// The global address index, used by the address rpc calls and XRouter. May be null.
+extern std::unique_ptr<AddressIndex> g_addressindex;
+
+#endif // BLOCKNET_INDEX_ADDRESSINDEX_H
@@ -81,6 +81,8 @@ protected:
 
     void ChainStateFlushed(const CBlockLocator& locator) override;
 
+    std::string GetSubscriberName() const override { return GetName(); }
+
     /// Initialize internal state from the database and block index.
     virtual bool Init();
 
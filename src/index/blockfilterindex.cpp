@@ -0,0 +1,255 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/blockfilterindex.h>
+#include <undo.h>
+#include <util/system.h>
+#include <validation.h>
+#include <validationinterface.h>
+
+/* The index database stores two entries per block, keyed by height:
+ *
+ * 'h' -> (block hash, filter hash, filter header)
+ * 'f' -> encoded filter
+ *
+ * The filter is kept apart so that header and hash range queries don't read the
+ * filters. The block hash identifies which block of the height the entries belong to.
+ */
+constexpr char DB_FILTER_HASHES = 'h';
+constexpr char DB_FILTER = 'f';
+
+std::unique_ptr<BlockFilterIndex> g_blockfilterindex;
+
+namespace {
+
+/// Big endian keys so that leveldb iterates the entries in height order.
+struct DBHeightKey {
+    char prefix{DB_FILTER_HASHES};
+    int height{0};
+
+    DBHeightKey() = default;
+    DBHeightKey(char prefix_in, int height_in) : prefix(prefix_in), height(height_in) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, prefix);
+        ser_writedata32be(s, static_cast<uint32_t>(height));
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        prefix = ser_readdata8(s);
+        height = static_cast<int>(ser_readdata32be(s));
+    }
+};
+
+struct DBHashes {
+    uint256 block_hash;
+    uint256 filter_hash;
+    uint256 header;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(block_hash);
+        READWRITE(filter_hash);
+        READWRITE(header);
+    }
+};
+
+} // namespace
+
+/**
+ * Access to the block filter index database (indexes/blockfilter/basic/)
+ */
+class BlockFilterIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    bool WriteFilter(int height, const BlockFilter& filter, const uint256& header);
+
+    bool ReadHashes(int height, DBHashes& hashes) const;
+
+    bool ReadFilter(int height, std::vector<unsigned char>& encoded_filter) const;
+
+    /// Read the 'h' entries of the heights [start_height, stop_index->nHeight], fails unless
+    /// all of them belong to the chain of stop_index.
+    bool ReadHashesRange(int start_height, const CBlockIndex* stop_index, std::vector<DBHashes>& entries) const;
+};
+
+BlockFilterIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "blockfilter" / "basic", n_cache_size, f_memory, f_wipe)
+{}
+
+bool BlockFilterIndex::DB::WriteFilter(int height, const BlockFilter& filter, const uint256& header)
+{
+    DBHashes hashes;
+    hashes.block_hash = filter.GetBlockHash();
+    hashes.filter_hash = filter.GetHash();
+    hashes.header = header;
+
+    CDBBatch batch(*this);
+    batch.Write(DBHeightKey(DB_FILTER_HASHES, height), hashes);
+    batch.Write(DBHeightKey(DB_FILTER, height), filter.GetEncodedFilter());
+    return WriteBatch(batch);
+}
+
+bool BlockFilterIndex::DB::ReadHashes(int height, DBHashes& hashes) const
+{
+    return Read(DBHeightKey(DB_FILTER_HASHES, height), hashes);
+}
+
+bool BlockFilterIndex::DB::ReadFilter(int height, std::vector<unsigned char>& encoded_filter) const
+{
+    return Read(DBHeightKey(DB_FILTER, height), encoded_filter);
+}
+
+bool BlockFilterIndex::DB::ReadHashesRange(int start_height, const CBlockIndex* stop_index,
+                                           std::vector<DBHashes>& entries) const
+{
+    if (start_height < 0) {
+        return error("%s: start height (%d) is negative", __func__, start_height);
+    }
+    if (start_height > stop_index->nHeight) {
+        return error("%s: start height (%d) is greater than stop height (%d)",
+                     __func__, start_height, stop_index->nHeight);
+    }
+
+    const size_t count = static_cast<size_t>(stop_index->nHeight - start_height + 1);
+    entries.reserve(count);
+    std::unique_ptr<CDBIterator> it(const_cast<DB*>(this)->NewIterator());
+    int height = start_height;
+    for (it->Seek(DBHeightKey(DB_FILTER_HASHES, start_height)); it->Valid() && entries.size() < count; it->Next()) {
+        DBHeightKey key;
+        DBHashes hashes;
+        if (!it->GetKey(key) || key.prefix != DB_FILTER_HASHES || key.height != height || !it->GetValue(hashes)) {
+            break;
+        }
+        entries.push_back(hashes);
+        ++height;
+    }
+    if (entries.size() != count) {
+        return error("%s: filters of heights %d to %d missing from index", __func__, start_height, stop_index->nHeight);
+    }
+
+    const CBlockIndex* pindex = stop_index;
+    for (size_t i = count; i-- > 0; pindex = pindex->pprev) {
+        if (entries[i].block_hash != pindex->GetBlockHash()) {
+            return error("%s: filter at height %d belongs to unexpected block %s; expected %s", __func__,
+                         pindex->nHeight, entries[i].block_hash.ToString(), pindex->GetBlockHash().ToString());
+        }
+    }
+    return true;
+}
+
+BlockFilterIndex::BlockFilterIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<BlockFilterIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+BlockFilterIndex::~BlockFilterIndex() {}
+
+bool BlockFilterIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    CBlockUndo block_undo;
+    uint256 prev_header;
+
+    if (pindex->nHeight > 0) {
+        if (!UndoReadFromDisk(block_undo, pindex)) {
+            return false;
+        }
+
+        DBHashes prev;
+        if (!m_db->ReadHashes(pindex->nHeight - 1, prev)) {
+            return error("%s: filter of block %s missing from index", __func__, pindex->pprev->GetBlockHash().ToString());
+        }
+        if (prev.block_hash != pindex->pprev->GetBlockHash()) {
+            return error("%s: previous block header belongs to unexpected block %s; expected %s", __func__,
+                         prev.block_hash.ToString(), pindex->pprev->GetBlockHash().ToString());
+        }
+        prev_header = prev.header;
+    }
+
+    BlockFilter filter(BlockFilterType::BASIC, block, block_undo);
+    return m_db->WriteFilter(pindex->nHeight, filter, filter.ComputeHeader(prev_header));
+}
+
+BaseIndex::DB& BlockFilterIndex::GetDB() const { return *m_db; }
+
+void BlockFilterIndex::Start()
+{
+    // Register before Init() so that blocks connected during the sync are not missed
+    RegisterValidationInterface(this);
+    BaseIndex::Start();
+}
+
+void BlockFilterIndex::Stop()
+{
+    UnregisterValidationInterface(this);
+    BaseIndex::Stop();
+}
+
+bool BlockFilterIndex::LookupFilter(const CBlockIndex* block_index, BlockFilter& filter_out) const
+{
+    DBHashes hashes;
+    std::vector<unsigned char> encoded_filter;
+    if (!m_db->ReadHashes(block_index->nHeight, hashes) || hashes.block_hash != block_index->GetBlockHash()) {
+        return false;
+    }
+    if (!m_db->ReadFilter(block_index->nHeight, encoded_filter)) {
+        return false;
+    }
+    filter_out = BlockFilter(BlockFilterType::BASIC, hashes.block_hash, std::move(encoded_filter));
+    return true;
+}
+
+bool BlockFilterIndex::LookupFilterHeader(const CBlockIndex* block_index, uint256& header_out) const
+{
+    DBHashes hashes;
+    if (!m_db->ReadHashes(block_index->nHeight, hashes) || hashes.block_hash != block_index->GetBlockHash()) {
+        return false;
+    }
+    header_out = hashes.header;
+    return true;
+}
+
+bool BlockFilterIndex::LookupFilterRange(int start_height, const CBlockIndex* stop_index,
+                                         std::vector<BlockFilter>& filters_out) const
+{
+    std::vector<DBHashes> entries;
+    if (!m_db->ReadHashesRange(start_height, stop_index, entries)) {
+        return false;
+    }
+
+    filters_out.clear();
+    filters_out.reserve(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        std::vector<unsigned char> encoded_filter;
+        if (!m_db->ReadFilter(start_height + static_cast<int>(i), encoded_filter)) {
+            return error("%s: filter at height %d missing from index", __func__, start_height + static_cast<int>(i));
+        }
+        filters_out.emplace_back(BlockFilterType::BASIC, entries[i].block_hash, std::move(encoded_filter));
+    }
+    return true;
+}
+
+bool BlockFilterIndex::LookupFilterHashRange(int start_height, const CBlockIndex* stop_index,
+                                             std::vector<uint256>& hashes_out) const
+{
+    std::vector<DBHashes> entries;
+    if (!m_db->ReadHashesRange(start_height, stop_index, entries)) {
+        return false;
+    }
+
+    hashes_out.clear();
+    hashes_out.reserve(entries.size());
+    for (const auto& entry : entries) {
+        hashes_out.push_back(entry.filter_hash);
+    }
+    return true;
+}
@@ -0,0 +1,76 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_BLOCKFILTERINDEX_H
+#define BITCOIN_INDEX_BLOCKFILTERINDEX_H
+
+#include <blockfilter.h>
+#include <chain.h>
+#include <index/base.h>
+
+#include <vector>
+
+static const bool DEFAULT_BLOCKFILTERINDEX = false;
+
+/**
+ * BlockFilterIndex is used to store and retrieve the BIP 158 basic block filters,
+ * hashes and headers of the blocks in the active chain. Filters are stored by height
+ * together with the block hash, lookups of blocks that are not in the indexed chain
+ * fail. Blocks of a reorged branch are replaced when the blocks of the new branch are
+ * connected.
+ */
+class BlockFilterIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+protected:
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "blockfilterindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit BlockFilterIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~BlockFilterIndex() override;
+
+    /// Registers for block notifications and starts the sync thread.
+    void Start();
+
+    /// Unregisters from block notifications and joins the sync thread.
+    void Stop();
+
+    /// Returns true once the index caught up with the chain.
+    bool IsSynced() const { return m_synced; }
+
+    /// Returns the last block in the index, the block index entry is immutable.
+    const CBlockIndex* BestBlockIndex() const { return m_best_block_index; }
+
+    /// Get a single filter by block.
+    bool LookupFilter(const CBlockIndex* block_index, BlockFilter& filter_out) const;
+
+    /// Get a single filter header by block.
+    bool LookupFilterHeader(const CBlockIndex* block_index, uint256& header_out) const;
+
+    /// Get a range of filters between two heights on a chain.
+    bool LookupFilterRange(int start_height, const CBlockIndex* stop_index,
+                           std::vector<BlockFilter>& filters_out) const;
+
+    /// Get a range of filter hashes between two heights on a chain.
+    bool LookupFilterHashRange(int start_height, const CBlockIndex* stop_index,
+                               std::vector<uint256>& hashes_out) const;
+};
+
+/// The global basic block filter index, used by getblockfilter and the BIP 157 messages. May be null.
+extern std::unique_ptr<BlockFilterIndex> g_blockfilterindex;
+
+#endif // BITCOIN_INDEX_BLOCKFILTERINDEX_H
@@ -0,0 +1,271 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/coinstatsindex.h>
+#include <undo.h>
+#include <util/system.h>
+#include <validation.h>
+#include <validationinterface.h>
+
+/* The index database stores an entry per block, keyed by height, and the running hash:
+ *
+ * 'h' -> (block hash, UTXO set hash, output count, bogo size, total amount)
+ * 'M' -> (block hash, MuHash3072 state)
+ *
+ * The running hash is written with the entry of its block. After a restart it may be
+ * ahead of the best block of the index, it's rewound when the next block is written.
+ */
+constexpr char DB_STATS = 'h';
+constexpr char DB_MUHASH = 'M';
+
+std::unique_ptr<CoinStatsIndex> g_coinstatsindex;
+
+namespace {
+
+/// Big endian keys so that leveldb iterates the entries in height order.
+struct DBHeightKey {
+    int height{0};
+
+    DBHeightKey() = default;
+    explicit DBHeightKey(int height_in) : height(height_in) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_STATS);
+        ser_writedata32be(s, static_cast<uint32_t>(height));
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        if (ser_readdata8(s) != DB_STATS) {
+            throw std::ios_base::failure("Invalid format for coinstatsindex DB height key");
+        }
+        height = static_cast<int>(ser_readdata32be(s));
+    }
+};
+
+struct DBVal {
+    uint256 block_hash;
+    uint256 muhash;
+    uint64_t transaction_output_count{0};
+    uint64_t bogo_size{0};
+    CAmount total_amount{0};
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(block_hash);
+        READWRITE(muhash);
+        READWRITE(transaction_output_count);
+        READWRITE(bogo_size);
+        READWRITE(total_amount);
+    }
+};
+
+/// Coinstakes are stored as coinbase coins, see AddCoins.
+Coin OutputCoin(const CTransaction& tx, size_t n, int height)
+{
+    return Coin(tx.vout[n], height, tx.IsCoinBase() || tx.IsCoinStake());
+}
+
+} // namespace
+
+/**
+ * Access to the coin stats index database (indexes/coinstats/)
+ */
+class CoinStatsIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    bool ReadStats(int height, DBVal& value) const;
+
+    bool ReadMuHash(uint256& block_hash, MuHash3072& muhash) const;
+
+    /// Writes the stats of the block and the running hash after it at once.
+    bool WriteStats(int height, const DBVal& value, const MuHash3072& muhash);
+};
+
+CoinStatsIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "coinstats", n_cache_size, f_memory, f_wipe)
+{}
+
+bool CoinStatsIndex::DB::ReadStats(int height, DBVal& value) const
+{
+    return Read(DBHeightKey(height), value);
+}
+
+bool CoinStatsIndex::DB::ReadMuHash(uint256& block_hash, MuHash3072& muhash) const
+{
+    std::pair<uint256, MuHash3072> entry;
+    if (!Read(DB_MUHASH, entry)) {
+        return false;
+    }
+    block_hash = entry.first;
+    muhash = entry.second;
+    return true;
+}
+
+bool CoinStatsIndex::DB::WriteStats(int height, const DBVal& value, const MuHash3072& muhash)
+{
+    CDBBatch batch(*this);
+    batch.Write(DBHeightKey(height), value);
+    batch.Write(DB_MUHASH, std::make_pair(value.block_hash, muhash));
+    return WriteBatch(batch);
+}
+
+CoinStatsIndex::CoinStatsIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<CoinStatsIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+CoinStatsIndex::~CoinStatsIndex() {}
+
+bool CoinStatsIndex::Init()
+{
+    if (!m_db->ReadMuHash(m_muhash_block, m_muhash)) {
+        m_muhash_block.SetNull();
+        m_muhash = MuHash3072();
+    }
+    return BaseIndex::Init();
+}
+
+bool CoinStatsIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    DBVal value;
+    value.block_hash = pindex->GetBlockHash();
+
+    // The transactions of the genesis block aren't connected, the set starts out empty
+    if (pindex->nHeight == 0) {
+        m_muhash = MuHash3072();
+    } else {
+        DBVal prev;
+        if (!m_db->ReadStats(pindex->nHeight - 1, prev)) {
+            return error("%s: stats of block %s missing from index", __func__, pindex->pprev->GetBlockHash().ToString());
+        }
+        if (prev.block_hash != pindex->pprev->GetBlockHash()) {
+            return error("%s: previous stats belong to unexpected block %s; expected %s", __func__,
+                         prev.block_hash.ToString(), pindex->pprev->GetBlockHash().ToString());
+        }
+        if (m_muhash_block != pindex->pprev->GetBlockHash() && !RewindMuHash(pindex->pprev)) {
+            return false;
+        }
+
+        CBlockUndo block_undo;
+        if (!UndoReadFromDisk(block_undo, pindex)) {
+            return false;
+        }
+        if (block_undo.vtxundo.size() + 1 != block.vtx.size()) {
+            return error("%s: undo data of block %s doesn't match the block", __func__, value.block_hash.ToString());
+        }
+
+        value.transaction_output_count = prev.transaction_output_count;
+        value.bogo_size = prev.bogo_size;
+        value.total_amount = prev.total_amount;
+        for (size_t i = 0; i < block.vtx.size(); ++i) {
+            const CTransaction& tx = *block.vtx[i];
+            for (size_t n = 0; n < tx.vout.size(); ++n) {
+                if (tx.vout[n].scriptPubKey.IsUnspendable()) {
+                    continue;
+                }
+                ApplyCoinHash(m_muhash, COutPoint(tx.GetHash(), n), OutputCoin(tx, n, pindex->nHeight));
+                value.transaction_output_count++;
+                value.bogo_size += GetBogoSize(tx.vout[n].scriptPubKey);
+                value.total_amount += tx.vout[n].nValue;
+            }
+            if (i == 0) {
+                continue; // the coinbase spends nothing
+            }
+            const CTxUndo& tx_undo = block_undo.vtxundo[i - 1];
+            for (size_t n = 0; n < tx.vin.size(); ++n) {
+                const Coin& coin = tx_undo.vprevout[n];
+                RemoveCoinHash(m_muhash, tx.vin[n].prevout, coin);
+                value.transaction_output_count--;
+                value.bogo_size -= GetBogoSize(coin.out.scriptPubKey);
+                value.total_amount -= coin.out.nValue;
+            }
+        }
+    }
+    m_muhash_block = value.block_hash;
+
+    m_muhash.Finalize(value.muhash);
+    return m_db->WriteStats(pindex->nHeight, value, m_muhash);
+}
+
+bool CoinStatsIndex::RewindMuHash(const CBlockIndex* target_index)
+{
+    const CBlockIndex* pindex;
+    {
+        LOCK(cs_main);
+        pindex = LookupBlockIndex(m_muhash_block);
+    }
+    if (!pindex || pindex->GetAncestor(target_index->nHeight) != target_index) {
+        return error("%s: can't rewind the UTXO set hash of block %s to block %s", __func__,
+                     m_muhash_block.ToString(), target_index->GetBlockHash().ToString());
+    }
+
+    const Consensus::Params& consensus_params = Params().GetConsensus();
+    for (; pindex != target_index; pindex = pindex->pprev) {
+        CBlock block;
+        CBlockUndo block_undo;
+        if (!ReadBlockFromDisk(block, pindex, consensus_params) || !UndoReadFromDisk(block_undo, pindex)) {
+            return error("%s: failed to read block %s", __func__, pindex->GetBlockHash().ToString());
+        }
+        if (block_undo.vtxundo.size() + 1 != block.vtx.size()) {
+            return error("%s: undo data of block %s doesn't match the block", __func__, pindex->GetBlockHash().ToString());
+        }
+        for (size_t i = 0; i < block.vtx.size(); ++i) {
+            const CTransaction& tx = *block.vtx[i];
+            for (size_t n = 0; n < tx.vout.size(); ++n) {
+                if (!tx.vout[n].scriptPubKey.IsUnspendable()) {
+                    RemoveCoinHash(m_muhash, COutPoint(tx.GetHash(), n), OutputCoin(tx, n, pindex->nHeight));
+                }
+            }
+            if (i == 0) {
+                continue;
+            }
+            const CTxUndo& tx_undo = block_undo.vtxundo[i - 1];
+            for (size_t n = 0; n < tx.vin.size(); ++n) {
+                ApplyCoinHash(m_muhash, tx.vin[n].prevout, tx_undo.vprevout[n]);
+            }
+        }
+    }
+    m_muhash_block = target_index->GetBlockHash();
+    return true;
+}
+
+BaseIndex::DB& CoinStatsIndex::GetDB() const { return *m_db; }
+
+void CoinStatsIndex::Start()
+{
+    // Register before Init() so that blocks connected during the sync are not missed
+    RegisterValidationInterface(this);
+    BaseIndex::Start();
+}
+
+void CoinStatsIndex::Stop()
+{
+    UnregisterValidationInterface(this);
+    BaseIndex::Stop();
+}
+
+bool CoinStatsIndex::LookUpStats(const CBlockIndex* block_index, CCoinsStats& stats) const
+{
+    DBVal value;
+    if (!m_db->ReadStats(block_index->nHeight, value) || value.block_hash != block_index->GetBlockHash()) {
+        return false;
+    }
+    stats.from_index = true;
+    stats.nHeight = block_index->nHeight;
+    stats.hashBlock = value.block_hash;
+    stats.nTransactionOutputs = value.transaction_output_count;
+    stats.nBogoSize = value.bogo_size;
+    stats.nTotalAmount = value.total_amount;
+    if (stats.hash_type == CoinStatsHashType::MUHASH) {
+        stats.hashSerialized = value.muhash;
+    }
+    return true;
+}
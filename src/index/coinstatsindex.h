@@ -0,0 +1,70 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_COINSTATSINDEX_H
+#define BITCOIN_INDEX_COINSTATSINDEX_H
+
+#include <chain.h>
+#include <crypto/muhash.h>
+#include <index/base.h>
+#include <node/coinstats.h>
+
+static const bool DEFAULT_COINSTATSINDEX = false;
+
+/**
+ * CoinStatsIndex keeps the statistics of the UTXO set after every block of the active
+ * chain: the number of outputs, the total amount and the MuHash3072 of the coins. The
+ * set hash is updated with the outputs a block creates and the coins it spends, read from
+ * its undo data, so a block costs about as much as its transactions. Stats are stored by
+ * height together with the block hash like the block filters, disconnected blocks are
+ * taken out of the running hash when the next block of the new branch is written.
+ */
+class CoinStatsIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+    /// The running hash of the UTXO set and the block it belongs to.
+    MuHash3072 m_muhash;
+    uint256 m_muhash_block;
+
+    /// Takes the blocks after target_index out of the running hash.
+    bool RewindMuHash(const CBlockIndex* target_index);
+
+protected:
+    bool Init() override;
+
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "coinstatsindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit CoinStatsIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~CoinStatsIndex() override;
+
+    /// Registers for block notifications and starts the sync thread.
+    void Start();
+
+    /// Unregisters from block notifications and joins the sync thread.
+    void Stop();
+
+    /// Returns true once the index caught up with the chain.
+    bool IsSynced() const { return m_synced; }
+
+    /// Get the stats of the UTXO set after the block, transactions and disk size aren't known.
+    bool LookUpStats(const CBlockIndex* block_index, CCoinsStats& stats) const;
+};
+
+/// The global UTXO set statistics index, used by gettxoutsetinfo. May be null.
+extern std::unique_ptr<CoinStatsIndex> g_coinstatsindex;
+
+#endif // BITCOIN_INDEX_COINSTATSINDEX_H
@@ -0,0 +1,123 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/spentindex.h>
+#include <util/system.h>
+#include <validation.h>
+#include <validationinterface.h>
+
+constexpr char DB_SPENT = 's';
+
+std::unique_ptr<SpentIndex> g_spentindex;
+
+namespace {
+
+struct DBOutPointKey {
+    COutPoint outpoint;
+
+    DBOutPointKey() = default;
+    explicit DBOutPointKey(const COutPoint& outpoint_in) : outpoint(outpoint_in) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_SPENT);
+        outpoint.hash.Serialize(s);
+        ser_writedata32be(s, outpoint.n);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        if (ser_readdata8(s) != DB_SPENT) {
+            throw std::ios_base::failure("Invalid format for spent index DB key");
+        }
+        outpoint.hash.Unserialize(s);
+        outpoint.n = ser_readdata32be(s);
+    }
+};
+
+} // namespace
+
+/**
+ * Access to the spent index database (indexes/spentindex/)
+ */
+class SpentIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    bool ReadSpend(const COutPoint& outpoint, SpentIndexEntry& entry) const;
+
+    /// Write the spends of the block, replacing spends of the same outputs by other branches.
+    bool WriteSpends(const std::vector<std::pair<COutPoint, SpentIndexEntry>>& spends);
+};
+
+SpentIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "spentindex", n_cache_size, f_memory, f_wipe)
+{}
+
+bool SpentIndex::DB::ReadSpend(const COutPoint& outpoint, SpentIndexEntry& entry) const
+{
+    return Read(DBOutPointKey(outpoint), entry);
+}
+
+bool SpentIndex::DB::WriteSpends(const std::vector<std::pair<COutPoint, SpentIndexEntry>>& spends)
+{
+    CDBBatch batch(*this);
+    for (const auto& spend : spends) {
+        batch.Write(DBOutPointKey(spend.first), spend.second);
+    }
+    return WriteBatch(batch);
+}
+
+SpentIndex::SpentIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<SpentIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+SpentIndex::~SpentIndex() {}
+
+bool SpentIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    std::vector<std::pair<COutPoint, SpentIndexEntry>> spends;
+    // The coinbase spends nothing
+    for (size_t i = 1; i < block.vtx.size(); ++i) {
+        const CTransaction& tx = *block.vtx[i];
+        for (uint32_t n = 0; n < tx.vin.size(); ++n) {
+            SpentIndexEntry entry;
+            entry.txid = tx.GetHash();
+            entry.index = n;
+            entry.height = pindex->nHeight;
+            entry.block_hash = pindex->GetBlockHash();
+            spends.emplace_back(tx.vin[n].prevout, entry);
+        }
+    }
+    return m_db->WriteSpends(spends);
+}
+
+BaseIndex::DB& SpentIndex::GetDB() const { return *m_db; }
+
+void SpentIndex::Start()
+{
+    // Register before Init() so that blocks connected during the sync are not missed
+    RegisterValidationInterface(this);
+    BaseIndex::Start();
+}
+
+void SpentIndex::Stop()
+{
+    UnregisterValidationInterface(this);
+    BaseIndex::Stop();
+}
+
+bool SpentIndex::FindSpend(const COutPoint& outpoint, SpentIndexEntry& entry) const
+{
+    if (!m_db->ReadSpend(outpoint, entry)) {
+        return false;
+    }
+    // The spend may be left over from a block that was disconnected since
+    LOCK(cs_main);
+    const CBlockIndex* pindex = chainActive[entry.height];
+    return pindex && pindex->GetBlockHash() == entry.block_hash;
+}
@@ -0,0 +1,83 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BLOCKNET_INDEX_SPENTINDEX_H
+#define BLOCKNET_INDEX_SPENTINDEX_H
+
+#include <chain.h>
+#include <index/base.h>
+#include <primitives/transaction.h>
+#include <serialize.h>
+#include <uint256.h>
+
+static const bool DEFAULT_SPENTINDEX = false;
+
+/**
+ * The input of the active chain that spent an output.
+ */
+struct SpentIndexEntry
+{
+    uint256 txid;
+    uint32_t index{0};
+    int height{0};
+    uint256 block_hash;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(txid);
+        READWRITE(index);
+        READWRITE(height);
+        READWRITE(block_hash);
+    }
+};
+
+/**
+ * SpentIndex records the input spending each output of the blockchain, so that a spend
+ * can be found without scanning the transactions of the blocks after the output. Entries
+ * keep the block of the spend, entries of disconnected blocks are left out of lookups and
+ * overwritten when the output is spent again.
+ */
+class SpentIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+protected:
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "spentindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit SpentIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~SpentIndex() override;
+
+    /// Registers for block notifications and starts the sync thread.
+    void Start();
+
+    /// Unregisters from block notifications and joins the sync thread.
+    void Stop();
+
+    /// Returns true once the index caught up with the chain.
+    bool IsSynced() const { return m_synced; }
+
+    /// Look up the input of the active chain that spent the output.
+    ///
+    /// @return  true if the output was spent, false otherwise
+    bool FindSpend(const COutPoint& outpoint, SpentIndexEntry& entry) const;
+};
+
+/// The global spent output index, used by getspentinfo and XBridge. May be null.
+extern std::unique_ptr<SpentIndex> g_spentindex;
+
+#endif // BLOCKNET_INDEX_SPENTINDEX_H
@@ -0,0 +1,217 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/tradeindex.h>
+#include <util/system.h>
+#include <validationinterface.h>
+#include <xbridge/currencypair.h>
+
+#include <algorithm>
+
+extern CurrencyPair TxOutToCurrencyPair(const std::vector<CTxOut> & vout, std::string& snode_pubkey); // declared in rpcxbridge.cpp
+
+constexpr char DB_TRADE_HEIGHT = 'h';
+constexpr char DB_TRADE_TIME = 't';
+
+std::unique_ptr<TradeIndex> g_tradeindex;
+
+namespace {
+
+/// Big endian keys so that leveldb iterates the trades in height and time order.
+struct DBHeightKey {
+    int height{0};
+    uint32_t n{0};
+
+    DBHeightKey() = default;
+    DBHeightKey(int height_in, uint32_t n_in) : height(height_in), n(n_in) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_TRADE_HEIGHT);
+        ser_writedata32be(s, static_cast<uint32_t>(height));
+        ser_writedata32be(s, n);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        char prefix = ser_readdata8(s);
+        if (prefix != DB_TRADE_HEIGHT) {
+            throw std::ios_base::failure("Invalid format for trade index DB height key");
+        }
+        height = static_cast<int>(ser_readdata32be(s));
+        n = ser_readdata32be(s);
+    }
+};
+
+struct DBTimeKey {
+    int64_t time{0};
+    int height{0};
+    uint32_t n{0};
+
+    DBTimeKey() = default;
+    DBTimeKey(int64_t time_in, int height_in, uint32_t n_in) : time(time_in), height(height_in), n(n_in) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_TRADE_TIME);
+        ser_writedata64be(s, static_cast<uint64_t>(time));
+        ser_writedata32be(s, static_cast<uint32_t>(height));
+        ser_writedata32be(s, n);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        char prefix = ser_readdata8(s);
+        if (prefix != DB_TRADE_TIME) {
+            throw std::ios_base::failure("Invalid format for trade index DB time key");
+        }
+        time = static_cast<int64_t>(ser_readdata64be(s));
+        height = static_cast<int>(ser_readdata32be(s));
+        n = ser_readdata32be(s);
+    }
+};
+
+} // namespace
+
+/**
+ * Access to the trade index database (indexes/tradeindex/)
+ *
+ * Trades are stored by height and transaction position. A second set of empty entries
+ * keyed by block time points to the height entries for time range queries.
+ */
+class TradeIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    /// Replace the trades at and above the height with the trades of the block.
+    bool WriteTrades(int height, const std::vector<TradeRecord>& trades);
+
+    bool ReadTradesByTime(int64_t time_begin, int64_t time_end, std::vector<TradeRecord>& trades) const;
+
+    bool ReadTradesByHeight(int height_begin, std::vector<TradeRecord>& trades) const;
+};
+
+TradeIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "tradeindex", n_cache_size, f_memory, f_wipe)
+{}
+
+bool TradeIndex::DB::WriteTrades(int height, const std::vector<TradeRecord>& trades)
+{
+    CDBBatch batch(*this);
+
+    // Erase trades left over from a reorged branch
+    std::unique_ptr<CDBIterator> it(NewIterator());
+    for (it->Seek(DBHeightKey(height, 0)); it->Valid(); it->Next()) {
+        DBHeightKey key;
+        TradeRecord trade;
+        if (!it->GetKey(key) || !it->GetValue(trade)) {
+            break;
+        }
+        batch.Erase(key);
+        batch.Erase(DBTimeKey(trade.time, key.height, key.n));
+    }
+
+    for (uint32_t n = 0; n < trades.size(); ++n) {
+        const auto& trade = trades[n];
+        batch.Write(DBHeightKey(height, n), trade);
+        batch.Write(DBTimeKey(trade.time, height, n), '\0');
+    }
+    return WriteBatch(batch);
+}
+
+bool TradeIndex::DB::ReadTradesByTime(int64_t time_begin, int64_t time_end, std::vector<TradeRecord>& trades) const
+{
+    std::unique_ptr<CDBIterator> it(const_cast<DB*>(this)->NewIterator());
+    for (it->Seek(DBTimeKey(time_begin, 0, 0)); it->Valid(); it->Next()) {
+        DBTimeKey key;
+        if (!it->GetKey(key) || key.time >= time_end) {
+            break;
+        }
+        TradeRecord trade;
+        if (!Read(DBHeightKey(key.height, key.n), trade)) {
+            return error("%s: trade at height %d missing from index", __func__, key.height);
+        }
+        trades.push_back(std::move(trade));
+    }
+    return true;
+}
+
+bool TradeIndex::DB::ReadTradesByHeight(int height_begin, std::vector<TradeRecord>& trades) const
+{
+    std::unique_ptr<CDBIterator> it(const_cast<DB*>(this)->NewIterator());
+    for (it->Seek(DBHeightKey(std::max(height_begin, 0), 0)); it->Valid(); it->Next()) {
+        DBHeightKey key;
+        TradeRecord trade;
+        if (!it->GetKey(key) || !it->GetValue(trade)) {
+            break;
+        }
+        trades.push_back(std::move(trade));
+    }
+    // Most recent block first, trades of a block stay in block order
+    std::stable_sort(trades.begin(), trades.end(), [](const TradeRecord& a, const TradeRecord& b) {
+        return a.height > b.height;
+    });
+    return true;
+}
+
+TradeIndex::TradeIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<TradeIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+TradeIndex::~TradeIndex() {}
+
+bool TradeIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    std::vector<TradeRecord> trades;
+    for (const auto& tx : block.vtx) {
+        std::string snode_pubkey;
+        const CurrencyPair p = TxOutToCurrencyPair(tx->vout, snode_pubkey);
+        if (p.tag == CurrencyPair::Tag::Empty) {
+            continue;
+        }
+        TradeRecord trade;
+        trade.height = pindex->nHeight;
+        trade.time = pindex->GetBlockTime();
+        trade.txid = tx->GetHash();
+        trade.tag = p.tag == CurrencyPair::Tag::Valid ? TradeRecord::TRADE_VALID : TradeRecord::TRADE_ERROR;
+        trade.snode = snode_pubkey;
+        trade.xidOrError = p.xid_or_error;
+        trade.fromCurrency = p.from.currency().to_string();
+        trade.fromAmount = p.from.accumulator();
+        trade.toCurrency = p.to.currency().to_string();
+        trade.toAmount = p.to.accumulator();
+        trades.push_back(std::move(trade));
+    }
+    return m_db->WriteTrades(pindex->nHeight, trades);
+}
+
+BaseIndex::DB& TradeIndex::GetDB() const { return *m_db; }
+
+void TradeIndex::Start()
+{
+    // Register before Init() so that blocks connected during the sync are not missed
+    RegisterValidationInterface(this);
+    BaseIndex::Start();
+}
+
+void TradeIndex::Stop()
+{
+    UnregisterValidationInterface(this);
+    BaseIndex::Stop();
+}
+
+bool TradeIndex::FindTradesByTime(int64_t time_begin, int64_t time_end, std::vector<TradeRecord>& trades) const
+{
+    return m_db->ReadTradesByTime(time_begin, time_end, trades);
+}
+
+bool TradeIndex::FindTradesByHeight(int height_begin, std::vector<TradeRecord>& trades) const
+{
+    return m_db->ReadTradesByHeight(height_begin, trades);
+}
@@ -0,0 +1,103 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BLOCKNET_INDEX_TRADEINDEX_H
+#define BLOCKNET_INDEX_TRADEINDEX_H
+
+#include <chain.h>
+#include <index/base.h>
+#include <serialize.h>
+#include <uint256.h>
+
+#include <string>
+#include <vector>
+
+static const bool DEFAULT_TRADEINDEX = false;
+
+/**
+ * XBridge trade recorded on chain, i.e. the currency pair data of an XBridge fee transaction.
+ */
+struct TradeRecord
+{
+    /// Same values as CurrencyPair::Tag
+    enum Tag : uint8_t { TRADE_EMPTY = 0, TRADE_ERROR = 1, TRADE_VALID = 2 };
+
+    int height{0};
+    int64_t time{0};
+    uint256 txid;
+    uint8_t tag{TRADE_EMPTY};
+    std::string snode;
+    std::string xidOrError;
+    std::string fromCurrency;
+    uint64_t fromAmount{0};
+    std::string toCurrency;
+    uint64_t toAmount{0};
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(height);
+        READWRITE(time);
+        READWRITE(txid);
+        READWRITE(tag);
+        READWRITE(snode);
+        READWRITE(xidOrError);
+        READWRITE(fromCurrency);
+        READWRITE(fromAmount);
+        READWRITE(toCurrency);
+        READWRITE(toAmount);
+    }
+};
+
+/**
+ * TradeIndex records the XBridge trades in the blockchain by height and block time so
+ * that trading data queries don't need to read raw blocks or hold cs_main. Blocks of a
+ * reorged branch are replaced when the blocks of the new branch are connected.
+ */
+class TradeIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+protected:
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "tradeindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit TradeIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~TradeIndex() override;
+
+    /// Registers for block notifications and starts the sync thread.
+    void Start();
+
+    /// Unregisters from block notifications and joins the sync thread.
+    void Stop();
+
+    /// Returns true once the index caught up with the chain.
+    bool IsSynced() const { return m_synced; }
+
+    /// Returns the last block in the index, the block index entry is immutable.
+    const CBlockIndex* BestBlockIndex() const { return m_best_block_index; }
+
+    /// Look up the trades with a block time in the range [time_begin, time_end).
+    bool FindTradesByTime(int64_t time_begin, int64_t time_end, std::vector<TradeRecord>& trades) const;
+
+    /// Look up the trades in blocks at or above the height, most recent block first.
+    bool FindTradesByHeight(int height_begin, std::vector<TradeRecord>& trades) const;
+};
+
+/// The global trade index, used by the XBridge trading data queries. May be null.
+extern std::unique_ptr<TradeIndex> g_tradeindex;
+
+#endif // BLOCKNET_INDEX_TRADEINDEX_H
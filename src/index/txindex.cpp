@@ -9,12 +9,18 @@
 #include <util/system.h>
 #include <validation.h>
 
+#include <algorithm>
+#include <condition_variable>
+
 #include <boost/thread.hpp>
 
 constexpr char DB_BEST_BLOCK = 'B';
 constexpr char DB_TXINDEX = 't';
 constexpr char DB_TXINDEX_BLOCK = 'T';
 
+/** Number of transaction positions the parallel sync writes to the index database at once */
+static const size_t TXINDEX_SYNC_BATCH_SIZE = 1 << 18;
+
 std::unique_ptr<TxIndex> g_txindex;
 
 struct CDiskTxPos : public CDiskBlockPos
@@ -244,18 +250,27 @@ bool TxIndex::Init()
     return BaseIndex::Init();
 }
 
-bool TxIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+/** Appends the disk positions of the block's transactions, none for the genesis block. */
+static void GetTxPositions(const CBlock& block, const CBlockIndex* pindex, std::vector<std::pair<uint256, CDiskTxPos>>& vPos)
 {
     // Exclude genesis block transaction because outputs are not spendable.
-    if (pindex->nHeight == 0) return true;
+    if (pindex->nHeight == 0) return;
 
     CDiskTxPos pos(pindex->GetBlockPos(), GetSizeOfCompactSize(block.vtx.size()));
-    std::vector<std::pair<uint256, CDiskTxPos>> vPos;
-    vPos.reserve(block.vtx.size());
+    vPos.reserve(vPos.size() + block.vtx.size());
     for (const auto& tx : block.vtx) {
         vPos.emplace_back(tx->GetHash(), pos);
         pos.nTxOffset += ::GetSerializeSize(*tx, CLIENT_VERSION);
     }
+}
+
+bool TxIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    // Exclude genesis block transaction because outputs are not spendable.
+    if (pindex->nHeight == 0) return true;
+
+    std::vector<std::pair<uint256, CDiskTxPos>> vPos;
+    GetTxPositions(block, pindex, vPos);
     return m_db->WriteTxs(vPos);
 }
 
@@ -342,7 +357,7 @@ void TxIndex::ThreadSync()
 
     // For small number of blocks use single thread
     if (totalBlocks < 1440) {
-        for (int i = startingHeight; i < totalBlocks; ++i) {
+        for (int i = startingHeight; i <= startingHeight + totalBlocks; ++i) {
             CBlockIndex *blockIndex = nullptr;
             {
                 LOCK(cs_main);
@@ -364,13 +379,14 @@ void TxIndex::ThreadSync()
         return;
     }
 
-    // Use multiple threads to load the txindex. First the indices are sharded
-    // one for each cpu thread. SSDs will see the highest performance gain,
-    // older disks might not see any improvements. Each thread works on its
-    // own shard and loads transaction data from disk as needed. Threads sync
-    // on a counter to report progress. Threads will break on the shutdown
-    // request to prevent hangs during an abrupt shutdown. Caught exceptions
-    // will result in a graceful shutdown request if possible.
+    // Use multiple threads to load the txindex. The block indices are sharded
+    // one for each cpu thread. Reader threads load the blocks of their shard
+    // from disk and extract the transaction positions, which are handed to a
+    // single writer (this thread). The writer sorts each batch by txid before
+    // writing it to the index database, so leveldb receives large, ordered
+    // batches instead of many small concurrent ones. Readers block while the
+    // writer is behind to bound memory. Threads will break on the shutdown
+    // request or a failure of any other thread to prevent hangs.
 
     // Shard the block indices into 1 per cpu thread (or core depending on system)
     struct range {
@@ -378,7 +394,6 @@ void TxIndex::ThreadSync()
         int end{0};
         explicit range(int begin, int end) : begin(begin), end(end) {}
     };
-    std::vector<std::shared_ptr<CBlock>> blocks;
     std::vector<range> slices;
     const auto allIndices = static_cast<int>(totalBlocks);
     const auto shardSize = static_cast<int>(totalBlocks/cores);
@@ -389,14 +404,23 @@ void TxIndex::ThreadSync()
     }
     slices[cores-1].end += totalBlocks % cores + 1; // add remainder to last shard, plus the last block
 
-    // Init txindex db with multiple threads
-    boost::thread_group tg;
+    std::vector<std::pair<uint256, CDiskTxPos>> pending;
+    pending.reserve(TXINDEX_SYNC_BATCH_SIZE);
     unsigned int counter{0};
+    int running = cores;
+    bool failed{false};
     Mutex mu;
-    for (const auto & shard : slices) {
+    std::condition_variable_any cvWriter; // pending has a full batch or a reader is done
+    std::condition_variable_any cvReaders; // pending has room
+
+    boost::thread_group tg;
+    for (int n = 0; n < cores; ++n) {
+        const auto & shard = slices[n];
         try {
-            tg.create_thread([&shard,&mu,&allIndices,&counter,consensus,this] {
+            tg.create_thread([&,consensus,this] {
                 RenameThread("blocknet-txindex");
+                std::vector<std::pair<uint256, CDiskTxPos>> vPos;
+                bool ok{true};
                 for (int i = shard.begin; i <= shard.end; ++i) {
                     if (ShutdownRequested())
                         break;
@@ -410,34 +434,88 @@ void TxIndex::ThreadSync()
                     CBlock block;
                     if (!ReadBlockFromDisk(block, pindex, consensus)) {
                         FatalError("txindex failed to read block %s from disk", pindex->GetBlockHash().ToString());
-                        return;
-                    }
-                    if (!WriteBlock(block, pindex)) {
-                        FatalError("txindex failed to write block %s to index database", pindex->GetBlockHash().ToString());
-                        return;
+                        ok = false;
+                        break;
                     }
+                    vPos.clear();
+                    GetTxPositions(block, pindex, vPos);
 
-                    {
-                        LOCK(mu);
-                        ++counter;
-                        const int perticks = 10;
-                        const int shardpos = allIndices < perticks ? 1 : static_cast<int>((double)allIndices/(double)perticks);
-                        if (counter % shardpos == 0) {
-                            int p = static_cast<int>((double)counter/(double)allIndices*100.0);
-                            LogPrintf("Loading txindex [%u%%]\n", p);
-                            uiInterface.ShowProgress(_("Loading transaction index"), p, false);
-                        }
+                    WAIT_LOCK(mu, lock);
+                    cvReaders.wait(lock, [&]{ return failed || pending.size() < TXINDEX_SYNC_BATCH_SIZE * 2; });
+                    if (failed)
+                        break;
+                    pending.insert(pending.end(), vPos.begin(), vPos.end());
+                    if (pending.size() >= TXINDEX_SYNC_BATCH_SIZE)
+                        cvWriter.notify_one();
+
+                    ++counter;
+                    const int perticks = 10;
+                    const int shardpos = allIndices < perticks ? 1 : static_cast<int>((double)allIndices/(double)perticks);
+                    if (counter % shardpos == 0) {
+                        int p = static_cast<int>((double)counter/(double)allIndices*100.0);
+                        LogPrintf("Loading txindex [%u%%]\n", p);
+                        uiInterface.ShowProgress(_("Loading transaction index"), p, false);
                     }
-
                 }
+
+                LOCK(mu);
+                if (!ok)
+                    failed = true;
+                --running;
+                cvWriter.notify_one();
+                cvReaders.notify_all();
             });
         } catch (...) {
+            {
+                LOCK(mu);
+                failed = true;
+                running -= cores - n; // threads that were not started
+            }
+            cvReaders.notify_all();
+            tg.join_all();
             FatalError("txindex failed to create init thread");
             return;
         }
     }
+
+    // Single writer, merges the positions of all readers into sorted batches
+    std::vector<std::pair<uint256, CDiskTxPos>> batch;
+    batch.reserve(TXINDEX_SYNC_BATCH_SIZE);
+    while (true) {
+        bool done{false};
+        {
+            WAIT_LOCK(mu, lock);
+            cvWriter.wait(lock, [&]{ return failed || running == 0 || pending.size() >= TXINDEX_SYNC_BATCH_SIZE; });
+            if (failed)
+                break;
+            done = running == 0;
+            batch.swap(pending);
+        }
+        cvReaders.notify_all();
+
+        if (!batch.empty()) {
+            std::sort(batch.begin(), batch.end(), [](const std::pair<uint256, CDiskTxPos> & a,
+                                                     const std::pair<uint256, CDiskTxPos> & b) {
+                return a.first < b.first;
+            });
+            if (!m_db->WriteTxs(batch)) {
+                FatalError("txindex failed to write to index database");
+                LOCK(mu);
+                failed = true;
+                break;
+            }
+            batch.clear();
+        }
+        if (done)
+            break;
+    }
+    cvReaders.notify_all();
     tg.join_all();
 
+    if (failed || ShutdownRequested())
+        return;
+
     writeBestBlock(startingHeight + totalBlocks);
     m_synced = true;
+    uiInterface.ShowProgress(_("Loading transaction index"), 100, false);
 }
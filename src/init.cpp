@@ -13,6 +13,7 @@
 #include <addrman.h>
 #include <amount.h>
 #include <banman.h>
+#include <blockfilemap.h>
 #include <chain.h>
 #include <chainparams.h>
 #include <checkpoints.h>
@@ -24,9 +25,15 @@
 #include <httpserver.h>
 #include <httprpc.h>
 #include <interfaces/chain.h>
+#include <index/addressindex.h>
+#include <index/blockfilterindex.h>
+#include <index/coinstatsindex.h>
+#include <index/spentindex.h>
+#include <index/tradeindex.h>
 #include <index/txindex.h>
 #include <kernel.h>
 #include <key.h>
+#include <metrics.h>
 #include <validation.h>
 #include <miner.h>
 #include <netbase.h>
@@ -44,6 +51,7 @@
 #include <scheduler.h>
 #include <servicenode/servicenodemgr.h>
 #include <shutdown.h>
+#include <sigbatch.h>
 #include <timedata.h>
 #include <txdb.h>
 #include <txmempool.h>
@@ -63,6 +71,7 @@
 #ifndef WIN32
 #include <attributes.h>
 #include <cerrno>
+#include <future>
 #include <signal.h>
 #include <sys/stat.h>
 #endif
@@ -80,12 +89,16 @@
 #endif
 
 bool fFeeEstimatesInitialized = false;
+static bool fSnodeListLoaded = false;
 static const bool DEFAULT_PROXYRANDOMIZE = true;
 static const bool DEFAULT_REST_ENABLE = false;
 static const bool DEFAULT_STOPAFTERBLOCKIMPORT = false;
+static const int64_t DEFAULT_SERVICES_SHUTDOWN_TIMEOUT = 30;
 
 // Dump addresses to banlist.dat every 15 minutes (900s)
 static constexpr int DUMP_BANS_INTERVAL = 60 * 15;
+// Dump the servicenode list to servicenodes.dat every 15 minutes (900s)
+static constexpr int DUMP_SNODES_INTERVAL = 60 * 15;
 
 std::unique_ptr<CConnman> g_connman;
 std::unique_ptr<PeerLogicValidation> peerLogic;
@@ -197,8 +210,94 @@ void Interrupt()
     if (g_txindex) {
         g_txindex->Interrupt();
     }
+    if (g_tradeindex) {
+        g_tradeindex->Interrupt();
+    }
+    if (g_blockfilterindex) {
+        g_blockfilterindex->Interrupt();
+    }
+    if (g_coinstatsindex) {
+        g_coinstatsindex->Interrupt();
+    }
+    if (g_addressindex) {
+        g_addressindex->Interrupt();
+    }
+    if (g_spentindex) {
+        g_spentindex->Interrupt();
+    }
 }
 
+/**
+ * Runs independent shutdown steps on their own threads and waits for them at most until a
+ * deadline. The time each step took is logged. The threads are joined, WaitUntil() returns
+ * false if a step is still running at the deadline and the threads are left to the caller
+ * to exit without.
+ */
+class ShutdownSteps
+{
+public:
+    ~ShutdownSteps()
+    {
+        for (auto& step : m_steps) {
+            if (step.thread.joinable())
+                step.thread.join();
+        }
+    }
+
+    void Add(const std::string& name, std::function<void()> func)
+    {
+        std::promise<void> done;
+        std::future<void> finished = done.get_future();
+        std::thread thread([name, func](std::promise<void> done) {
+            RenameThread(("blocknet-stop-" + name).c_str());
+            const int64_t start = GetTimeMillis();
+            try {
+                func();
+            } catch (const std::exception& e) {
+                LogPrintf("ERROR: Shutdown step %s failed: %s\n", name, e.what());
+            } catch (...) {
+                LogPrintf("ERROR: Shutdown step %s failed\n", name);
+            }
+            LogPrintf("Shutdown step %s finished in %dms\n", name, GetTimeMillis() - start);
+            done.set_value();
+        }, std::move(done));
+        m_steps.push_back(Step{name, std::move(thread), std::move(finished)});
+    }
+
+    /**
+     * Waits for the steps until the GetTimeMillis() deadline, 0 waits without limit. Returns
+     * true once all steps finished and their threads are joined.
+     */
+    bool WaitUntil(const int64_t deadline)
+    {
+        bool finished{true};
+        for (auto& step : m_steps) {
+            if (deadline == 0) {
+                step.finished.wait();
+                continue;
+            }
+            const int64_t left = std::max<int64_t>(deadline - GetTimeMillis(), 0);
+            if (step.finished.wait_for(std::chrono::milliseconds(left)) != std::future_status::ready) {
+                LogPrintf("ERROR: Shutdown step %s did not finish in time\n", step.name);
+                finished = false;
+            }
+        }
+        if (!finished)
+            return false;
+        for (auto& step : m_steps)
+            step.thread.join();
+        return true;
+    }
+
+private:
+    struct Step {
+        std::string name;
+        std::thread thread;
+        std::future<void> finished;
+    };
+    std::vector<Step> m_steps;
+};
+
 void Shutdown(InitInterfaces& interfaces)
 {
     LogPrintf("%s: In progress...\n", __func__);
@@ -214,16 +313,38 @@ void Shutdown(InitInterfaces& interfaces)
     RenameThread("blocknet-shutoff");
     mempool.AddTransactionsUpdated(1);
 
-    // Shutdown xbridge
-    xbridge::App::instance().cancelMyXBridgeTransactions();
-    xbridge::App::instance().disconnectWallets();
-    xbridge::App::instance().stop();
-
-    // Shutdown xrouter
-    xrouter::App::instance().stop();
+    // Shutdown xbridge and xrouter in parallel, bounded by -servicesshutdowntimeout
+    {
+        const int64_t start = GetTimeMillis();
+        const int64_t timeout = gArgs.GetArg("-servicesshutdowntimeout", DEFAULT_SERVICES_SHUTDOWN_TIMEOUT);
+        const int64_t deadline = timeout > 0 ? start + timeout * 1000 : 0;
+        ShutdownSteps steps;
+        steps.Add("xbridge", [deadline]() {
+            xbridge::App::instance().cancelMyXBridgeTransactions(deadline);
+            xbridge::App::instance().disconnectWallets();
+            xbridge::App::instance().stop();
+        });
+        steps.Add("xrouter", []() {
+            xrouter::App::instance().stop();
+        });
+        if (!steps.WaitUntil(deadline)) {
+            // The steps still use the wallets and the chainstate, tearing those down under
+            // them isn't safe. Flush the chainstate if it's free and exit without the rest
+            // of the shutdown, the next start recovers as after a crash.
+            LogPrintf("ERROR: XBridge and XRouter did not stop within %ds, exiting\n", timeout);
+            {
+                TRY_LOCK(cs_main, lockMain);
+                if (lockMain && pcoinsTip)
+                    FlushStateToDisk();
+            }
+            std::_Exit(EXIT_FAILURE);
+        }
+        LogPrintf("XBridge and XRouter shutdown took %dms\n", GetTimeMillis() - start);
+    }
 
     StopHTTPRPC();
     StopREST();
+    StopHTTPMetrics();
     StopRPC();
     StopHTTPServer();
     for (const auto& client : interfaces.chain_clients) {
@@ -236,6 +357,11 @@ void Shutdown(InitInterfaces& interfaces)
     if (peerLogic) UnregisterValidationInterface(peerLogic.get());
     if (g_connman) g_connman->Stop();
     if (g_txindex) g_txindex->Stop();
+    if (g_tradeindex) g_tradeindex->Stop();
+    if (g_blockfilterindex) g_blockfilterindex->Stop();
+    if (g_coinstatsindex) g_coinstatsindex->Stop();
+    if (g_addressindex) g_addressindex->Stop();
+    if (g_spentindex) g_spentindex->Stop();
 
     StopTorControl();
 
@@ -244,17 +370,31 @@ void Shutdown(InitInterfaces& interfaces)
     threadGroup.interrupt_all();
     threadGroup.join_all();
 
+    if (fSnodeListLoaded) {
+        sn::ServiceNodeMgr::instance().writeSnListToDisk();
+        fSnodeListLoaded = false;
+    }
+
     // After the threads that potentially access these pointers have been stopped,
     // destruct and reset all to nullptr.
     peerLogic.reset();
     g_connman.reset();
     g_banman.reset();
     g_txindex.reset();
+    g_tradeindex.reset();
+    g_blockfilterindex.reset();
+    g_coinstatsindex.reset();
+    g_addressindex.reset();
+    g_spentindex.reset();
 
     if (g_is_mempool_loaded && gArgs.GetArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL)) {
         DumpMempool();
     }
 
+    if (gArgs.GetBoolArg("-persistsigcache", DEFAULT_PERSIST_SIGCACHE)) {
+        DumpSignatureCaches();
+    }
+
     if (fFeeEstimatesInitialized)
     {
         ::feeEstimator.FlushUnconfirmed();
@@ -275,6 +415,7 @@ void Shutdown(InitInterfaces& interfaces)
     // After there are no more peers/RPC left to give us new data which may generate
     // CValidationInterface callbacks, flush them...
     GetMainSignals().FlushBackgroundCallbacks();
+    gov::Governance::instance().closeCheckpoint();
 
     // Any future callbacks will be dropped. This should absolutely be safe - if
     // missing a callback results in an unrecoverable situation, unclean shutdown
@@ -286,9 +427,11 @@ void Shutdown(InitInterfaces& interfaces)
         LOCK(cs_main);
         if (pcoinsTip != nullptr) {
             FlushStateToDisk();
+            WriteBlockIndexSnapshot();
         }
         pcoinsTip.reset();
         pcoinscatcher.reset();
+        pcoinsflusher.reset();
         pcoinsdbview.reset();
         pblocktree.reset();
     }
@@ -318,6 +461,7 @@ void Shutdown(InitInterfaces& interfaces)
     globalVerifyHandle.reset();
     ECC_Stop();
     LogPrintf("%s: done\n", __func__);
+    LogInstance().StopAsyncLogging();
 }
 
 /**
@@ -392,10 +536,17 @@ void SetupServerArgs()
     gArgs.AddArg("-blocksdir=<dir>", "Specify blocks directory (default: <datadir>/blocks)", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blocknotify=<cmd>", "Execute command when the best block changes (%s in cmd is replaced by block hash)", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blockreconstructionextratxn=<n>", strprintf("Extra transactions to keep in memory for compact block reconstructions (default: %u)", DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-blockindexsnapshot", strprintf("Save the block index to a snapshot file on shutdown and load it from there on the next start (default: %u)", DEFAULT_BLOCK_INDEX_SNAPSHOT), true, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-blockmmap", strprintf("Read blocks through memory maps of the block files (default: %u)", DEFAULT_BLOCK_MMAP), true, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-blockreadcache=<n>", strprintf("Memory for blocks read by RPC, REST and xbridge, in MiB (default: %u)", DEFAULT_BLOCK_READ_CACHE), true, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blocksonly", strprintf("Whether to operate in a blocks only mode (default: %u)", DEFAULT_BLOCKSONLY), true, OptionsCategory::OPTIONS);
     gArgs.AddArg("-conf=<file>", strprintf("Specify configuration file. Relative paths will be prefixed by datadir location. (default: %s)", BITCOIN_CONF_FILENAME), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-datadir=<dir>", "Specify data directory", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-dbbatchsize", strprintf("Maximum database write batch size in bytes (default: %u)", nDefaultDbBatchSize), true, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-dbtune=<db>:<option>=<n>", "Tune the leveldb database <db> (chainstate, index, txindex, governance, xbridgehistory). Options: "
+        "blockcache (percent of the database cache for the block cache, the rest is for the write buffers, default: 50), "
+        "bloombits (bloom filter bits per key, 0 to disable, default: 10), blocksize (table block size in bytes, default: 4096), "
+        "compression (1 to compress table blocks when built with snappy, default: 0), maxopenfiles (default: platform). Can be specified multiple times", true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-dbcache=<n>", strprintf("Maximum database cache size <n> MiB (%d to %d, default: %d). In addition, unused mempool memory is shared for this cache (see -maxmempool).", nMinDbCache, nMaxDbCache, nDefaultDbCache), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-debuglogfile=<file>", strprintf("Specify location of debug log file. Relative paths will be prefixed by a net-specific datadir location. (-nodebuglogfile to disable; default: %s)", DEFAULT_DEBUGLOGFILE), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-feefilter", strprintf("Tell other nodes to filter invs to us by our mempool min fee (default: %u)", DEFAULT_FEEFILTER), true, OptionsCategory::OPTIONS);
@@ -407,12 +558,18 @@ void SetupServerArgs()
     gArgs.AddArg("-minimumchainwork=<hex>", strprintf("Minimum work assumed to exist on a valid chain in hex (default: %s, testnet: %s)", defaultChainParams->GetConsensus().nMinimumChainWork.GetHex(), testnetChainParams->GetConsensus().nMinimumChainWork.GetHex()), true, OptionsCategory::OPTIONS);
     gArgs.AddArg("-par=<n>", strprintf("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)",
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-schedulerthreads=<n>", strprintf("Set the number of threads running background tasks and validation notifications (1 to %d, default: %d)",
+        MAX_SCHEDULER_THREADS, DEFAULT_SCHEDULER_THREADS), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-persistsigcache", strprintf("Whether to save the signature and script execution caches on shutdown and load them on restart (default: %u)", DEFAULT_PERSIST_SIGCACHE), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-persistmempool", strprintf("Whether to save the mempool on shutdown and load on restart (default: %u)", DEFAULT_PERSIST_MEMPOOL), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-pid=<file>", strprintf("Specify pid file. Relative paths will be prefixed by a net-specific datadir location. (default: %s)", BITCOIN_PID_FILENAME), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-prune=<n>", "Pruning is not supported", false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-persiststakemodifiers", strprintf("Store the stake modifiers of staking protocol v03 inputs in the block index database (default: %u)", DEFAULT_PERSIST_STAKE_MODIFIERS), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-reindex", "Rebuild chain state and block index from the blk*.dat files on disk", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-reindex-chainstate", "Rebuild chain state from the currently indexed blocks. When in pruning mode or if blocks on disk might be corrupted, use full -reindex instead.", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-staking", "Mine blocks on this node (default: 1)", false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-stakingthreads=<n>", strprintf("Set the number of threads used to search for stakes (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)",
+        -GetNumCores(), MAX_STAKING_THREADS, DEFAULT_STAKING_THREADS), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-minstakeamount", strprintf("Only stakes UTXOs greater than or equal to this amount (default: %d)", 0), false, OptionsCategory::OPTIONS);
 #ifndef WIN32
     gArgs.AddArg("-sysperms", "Create new files with system default permissions, instead of umask 077 (only effective with disabled wallet functionality)", false, OptionsCategory::OPTIONS);
@@ -420,6 +577,11 @@ void SetupServerArgs()
     hidden_args.emplace_back("-sysperms");
 #endif
     gArgs.AddArg("-txindex", "Blocknet requires txindex to support the Proof of Stake protocol.", false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-addressindex", strprintf("Maintain the history and unspent outputs of every address, used by the address rpc calls and the XRouter getBalance call (default: %u)", DEFAULT_ADDRESSINDEX), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-blockfilterindex", strprintf("Maintain an index of the BIP 158 basic compact block filters, used by the getblockfilter rpc call (default: %u)", DEFAULT_BLOCKFILTERINDEX), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-coinstatsindex", strprintf("Maintain the UTXO set statistics of every block, used by the gettxoutsetinfo rpc call (default: %u)", DEFAULT_COINSTATSINDEX), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-spentindex", strprintf("Maintain the spending input of every output, used by the getspentinfo rpc call and XBridge (default: %u)", DEFAULT_SPENTINDEX), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-tradeindex", strprintf("Maintain an index of the XBridge trades in the blockchain, used by the trading data rpc calls (default: %u)", DEFAULT_TRADEINDEX), false, OptionsCategory::OPTIONS);
 
     gArgs.AddArg("-addnode=<ip>", "Add a node to connect to and attempt to keep the connection open (see the `addnode` RPC command help for more info). This option can be specified multiple times to add multiple nodes.", false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-banscore=<n>", strprintf("Threshold for disconnecting misbehaving peers (default: %u)", DEFAULT_BANSCORE_THRESHOLD), false, OptionsCategory::CONNECTION);
@@ -435,12 +597,15 @@ void SetupServerArgs()
     gArgs.AddArg("-listen", "Accept connections from outside (default: 1 if no -proxy or -connect)", false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-listenonion", strprintf("Automatically create Tor hidden service (default: %d)", DEFAULT_LISTEN_ONION), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-maxconnections=<n>", strprintf("Maintain at most <n> connections to peers (default: %u)", DEFAULT_MAX_PEER_CONNECTIONS), false, OptionsCategory::CONNECTION);
+    gArgs.AddArg("-maxxrouterconnections=<n>", strprintf("Maintain at most <n> connections to and from XRouter peers apart from -maxconnections, idle XRouter connections are closed after %d seconds (default: %u)", DEFAULT_XROUTER_IDLE_TIMEOUT, DEFAULT_MAX_XROUTER_CONNECTIONS), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-maxreceivebuffer=<n>", strprintf("Maximum per-connection receive buffer, <n>*1000 bytes (default: %u)", DEFAULT_MAXRECEIVEBUFFER), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-maxsendbuffer=<n>", strprintf("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)", DEFAULT_MAXSENDBUFFER), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-maxtimeadjustment", strprintf("Maximum allowed median peer time offset adjustment. Local perspective of time may be influenced by peers forward or backward by this amount. (default: %u seconds)", DEFAULT_MAX_TIME_ADJUSTMENT), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-maxuploadtarget=<n>", strprintf("Tries to keep outbound traffic under the given target (in MiB per 24h), 0 = no limit (default: %d)", DEFAULT_MAX_UPLOAD_TARGET), false, OptionsCategory::CONNECTION);
+    gArgs.AddArg("-msgworkers=<n>", strprintf("Number of threads handling xbridge, xrouter and servicenode messages apart from block and tx relay, 0 = handle them on the message handler thread (default: %d, maximum: %d)", DEFAULT_MESSAGE_WORKERS, MAX_MESSAGE_WORKERS), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-onion=<ip:port>", "Use separate SOCKS5 proxy to reach peers via Tor hidden services, set -noonion to disable (default: -proxy)", false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-onlynet=<net>", "Make outgoing connections only through network <net> (ipv4, ipv6 or onion). Incoming connections are not affected by this option. This option can be specified multiple times to allow multiple networks.", false, OptionsCategory::CONNECTION);
+    gArgs.AddArg("-peerblockfilters", strprintf("Serve compact block filters to peers per BIP 157, requires -blockfilterindex (default: %u)", DEFAULT_PEERBLOCKFILTERS), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-peerbloomfilters", strprintf("Support filtering of blocks and transaction with bloom filters (default: %u)", DEFAULT_PEERBLOOMFILTERS), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-permitbaremultisig", strprintf("Relay non-P2SH multisig (default: %u)", DEFAULT_PERMIT_BAREMULTISIG), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-port=<port>", strprintf("Listen for connections on <port> (default: %u, testnet: %u, regtest: %u)", defaultChainParams->GetDefaultPort(), testnetChainParams->GetDefaultPort(), regtestChainParams->GetDefaultPort()), false, OptionsCategory::CONNECTION);
@@ -475,6 +640,16 @@ void SetupServerArgs()
     gArgs.AddArg("-zmqpubhashtxhwm=<n>", strprintf("Set publish hash transaction outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), false, OptionsCategory::ZMQ);
     gArgs.AddArg("-zmqpubrawblockhwm=<n>", strprintf("Set publish raw block outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), false, OptionsCategory::ZMQ);
     gArgs.AddArg("-zmqpubrawtxhwm=<n>", strprintf("Set publish raw transaction outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubxbridgeorder=<address>", "Enable publish xbridge order add/update/cancel/fill events in <address>", false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubxbridgetrade=<address>", "Enable publish xbridge order fill events in <address>", false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubxbridgeorderhwm=<n>", strprintf("Set publish xbridge order outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubxbridgetradehwm=<n>", strprintf("Set publish xbridge trade outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubproposal=<address>", "Enable publish governance proposals accepted from connected blocks in <address>", false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubgovernancevote=<address>", "Enable publish governance votes accepted or changed by connected blocks in <address>", false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubservicenode=<address>", "Enable publish servicenode registration/ping/invalid/removal events in <address>", false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubproposalhwm=<n>", strprintf("Set publish proposal outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubgovernancevotehwm=<n>", strprintf("Set publish governance vote outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubservicenodehwm=<n>", strprintf("Set publish servicenode outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), false, OptionsCategory::ZMQ);
 #else
     hidden_args.emplace_back("-zmqpubhashblock=<address>");
     hidden_args.emplace_back("-zmqpubhashtx=<address>");
@@ -484,6 +659,16 @@ void SetupServerArgs()
     hidden_args.emplace_back("-zmqpubhashtxhwm=<n>");
     hidden_args.emplace_back("-zmqpubrawblockhwm=<n>");
     hidden_args.emplace_back("-zmqpubrawtxhwm=<n>");
+    hidden_args.emplace_back("-zmqpubxbridgeorder=<address>");
+    hidden_args.emplace_back("-zmqpubxbridgetrade=<address>");
+    hidden_args.emplace_back("-zmqpubxbridgeorderhwm=<n>");
+    hidden_args.emplace_back("-zmqpubxbridgetradehwm=<n>");
+    hidden_args.emplace_back("-zmqpubproposal=<address>");
+    hidden_args.emplace_back("-zmqpubgovernancevote=<address>");
+    hidden_args.emplace_back("-zmqpubservicenode=<address>");
+    hidden_args.emplace_back("-zmqpubproposalhwm=<n>");
+    hidden_args.emplace_back("-zmqpubgovernancevotehwm=<n>");
+    hidden_args.emplace_back("-zmqpubservicenodehwm=<n>");
 #endif
 
     gArgs.AddArg("-checkblocks=<n>", strprintf("How many blocks to check at startup (default: %u, 0 = all)", DEFAULT_CHECKBLOCKS), true, OptionsCategory::DEBUG_TEST);
@@ -507,11 +692,14 @@ void SetupServerArgs()
     gArgs.AddArg("-limitdescendantcount=<n>", strprintf("Do not accept transactions if any ancestor would have <n> or more in-mempool descendants (default: %u)", DEFAULT_DESCENDANT_LIMIT), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-limitdescendantsize=<n>", strprintf("Do not accept transactions if any ancestor would have more than <n> kilobytes of in-mempool descendants (default: %u).", DEFAULT_DESCENDANT_SIZE_LIMIT), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-addrmantest", "Allows to test address relay on localhost", true, OptionsCategory::DEBUG_TEST);
+    gArgs.AddArg("-validationstatsinterval=<n>", "Log the validation callback stats of getvalidationstats every <n> seconds (default: 0 = disabled)", true, OptionsCategory::DEBUG_TEST);
+    gArgs.AddArg("-lockprofile=<n>", strprintf("Time all contended lock acquisitions and the hold time of 1 in <n> acquisitions for getlockstats (0 to disable, default: %u)", DEFAULT_LOCK_PROFILE_SAMPLE), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-debug=<category>", "Output debugging information (default: -nodebug, supplying <category> is optional). "
         "If <category> is not supplied or if <category> = 1, output all debugging information. <category> can be: " + ListLogCategories() + ".", false, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-debugexclude=<category>", strprintf("Exclude debugging information for a category. Can be used in conjunction with -debug=1 to output debug logs for all categories except one or more specified categories."), false, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-logips", strprintf("Include IP addresses in debug output (default: %u)", DEFAULT_LOGIPS), false, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-logtimestamps", strprintf("Prepend debug output with timestamp (default: %u)", DEFAULT_LOGTIMESTAMPS), false, OptionsCategory::DEBUG_TEST);
+    gArgs.AddArg("-asynclogging", strprintf("Write the log on a background thread instead of the logging threads, lines are dropped when more than %u are waiting (default: %u)", ASYNC_LOG_BUFFER_SIZE, DEFAULT_ASYNCLOGGING), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-logtimemicros", strprintf("Add microsecond precision to debug timestamps (default: %u)", DEFAULT_LOGTIMEMICROS), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-mocktime=<n>", "Replace actual time with <n> seconds since epoch (default: 0)", true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-maxsigcachesize=<n>", strprintf("Limit sum of signature cache and script execution cache sizes to <n> MiB (default: %u)", DEFAULT_MAX_SIG_CACHE_SIZE), true, OptionsCategory::DEBUG_TEST);
@@ -542,6 +730,7 @@ void SetupServerArgs()
     gArgs.AddArg("-blockmintxfee=<amt>", strprintf("Set lowest fee rate (in %s/kB) for transactions to be included in block creation. (default: %s)", CURRENCY_UNIT, FormatMoney(DEFAULT_BLOCK_MIN_TX_FEE)), false, OptionsCategory::BLOCK_CREATION);
     gArgs.AddArg("-blockversion=<n>", "Override block version to test forking scenarios", true, OptionsCategory::BLOCK_CREATION);
 
+    gArgs.AddArg("-metrics", strprintf("Serve node, staking, servicenode, XRouter, XBridge and RPC metrics in the Prometheus text format on /metrics of the RPC port (default: %u)", DEFAULT_METRICS_ENABLE), false, OptionsCategory::RPC);
     gArgs.AddArg("-rest", strprintf("Accept public REST requests (default: %u)", DEFAULT_REST_ENABLE), false, OptionsCategory::RPC);
     gArgs.AddArg("-rpcallowip=<ip>", "Allow JSON-RPC connections from specified source. Valid for <ip> are a single IP (e.g. 1.2.3.4), a network/netmask (e.g. 1.2.3.4/255.255.255.0) or a network/CIDR (e.g. 1.2.3.4/24). This option can be specified multiple times", false, OptionsCategory::RPC);
     gArgs.AddArg("-rpcauth=<userpw>", "Username and HMAC-SHA-256 hashed password for JSON-RPC connections. The field <userpw> comes in the format: <USERNAME>:<SALT>$<HASH>. A canonical python script is included in share/rpcauth. The client then connects normally using the rpcuser=<USERNAME>/rpcpassword=<PASSWORD> pair of arguments. This option can be specified multiple times", false, OptionsCategory::RPC);
@@ -550,9 +739,12 @@ void SetupServerArgs()
     gArgs.AddArg("-rpcpassword=<pw>", "Password for JSON-RPC connections", false, OptionsCategory::RPC);
     gArgs.AddArg("-rpcport=<port>", strprintf("Listen for JSON-RPC connections on <port> (default: %u, testnet: %u, regtest: %u)", defaultBaseParams->RPCPort(), testnetBaseParams->RPCPort(), regtestBaseParams->RPCPort()), false, OptionsCategory::RPC);
     gArgs.AddArg("-rpcserialversion", strprintf("Sets the serialization of raw transaction or block hex returned in non-verbose mode, non-segwit(0) or segwit(1) (default: %d)", DEFAULT_RPC_SERIALIZE_VERSION), false, OptionsCategory::RPC);
-    gArgs.AddArg("-rpcservertimeout=<n>", strprintf("Timeout during HTTP requests (default: %d)", DEFAULT_HTTP_SERVER_TIMEOUT), true, OptionsCategory::RPC);
+    gArgs.AddArg("-rpcservertimeout=<n>", strprintf("Timeout during HTTP requests, also closes idle keep-alive connections (default: %d)", DEFAULT_HTTP_SERVER_TIMEOUT), true, OptionsCategory::RPC);
+    gArgs.AddArg("-rpcmaxconnections=<n>", strprintf("Maximum number of open (keep-alive) HTTP connections to the RPC server, requests on further connections are rejected, 0 = no limit (default: %d)", DEFAULT_HTTP_MAX_CONNECTIONS), true, OptionsCategory::RPC);
     gArgs.AddArg("-rpcthreads=<n>", strprintf("Set the number of threads to service RPC calls (default: %d)", DEFAULT_HTTP_THREADS), false, OptionsCategory::RPC);
     gArgs.AddArg("-rpcuser=<user>", "Username for JSON-RPC connections", false, OptionsCategory::RPC);
+    gArgs.AddArg("-rpcbatchthreads=<n>", strprintf("Execute consecutive read-only calls of a JSON-RPC batch request (e.g. getblock, getrawtransaction, gettxout) on up to <n> threads, the replies keep the request order (default: %d, 0 = sequential)", DEFAULT_RPC_BATCH_THREADS), false, OptionsCategory::RPC);
+    gArgs.AddArg("-rpcqueue=<categories>:<n>[:<depth>]", strprintf("Service the RPC calls of the comma separated categories (e.g. xrouter,xbridge,governance,blockchain,wallet) with <n> threads of their own and a work queue of the given depth (default: %d). Calls of other categories use the -rpcthreads. Can be specified multiple times", DEFAULT_HTTP_WORKQUEUE), false, OptionsCategory::RPC);
     gArgs.AddArg("-rpcworkqueue=<n>", strprintf("Set the depth of the work queue to service RPC calls (default: %d)", DEFAULT_HTTP_WORKQUEUE), true, OptionsCategory::RPC);
     gArgs.AddArg("-server", "Accept command line and JSON-RPC commands", false, OptionsCategory::RPC);
 
@@ -565,7 +757,12 @@ void SetupServerArgs()
     gArgs.AddArg("-enableexchange", strprintf("Enable exchange mode on this service node (default: %u)", false), false, OptionsCategory::XBRIDGE);
     gArgs.AddArg("-orderinputscheck", strprintf("Time interval for the utxo validity check on order inputs (default: %d seconds)", 900), false, OptionsCategory::XBRIDGE);
     gArgs.AddArg("-maxmempoolxbridge", strprintf("Maximum size in MB (megabytes) for the xbridge mempool (default: %dMB)", 128), false, OptionsCategory::XBRIDGE);
+    gArgs.AddArg("-servicesshutdowntimeout=<n>", strprintf("Seconds to wait on shutdown for XBridge to cancel the open orders and disconnect the wallets, and for XRouter to stop, the node exits without a clean shutdown after that, 0 = no limit (default: %d)", DEFAULT_SERVICES_SHUTDOWN_TIMEOUT), false, OptionsCategory::XBRIDGE);
     gArgs.AddArg("-rpcxbridgetimeout", strprintf("Timeout for internal XBridge RPC calls (default: %d seconds)", 120), false, OptionsCategory::XBRIDGE);
+    gArgs.AddArg("-rpcxbridgepoolsize", strprintf("Number of idle keep-alive connections kept per XBridge wallet (default: %d)", 4), false, OptionsCategory::XBRIDGE);
+    gArgs.AddArg("-rpcxbridgepoolidle", strprintf("Close idle XBridge wallet connections after this many seconds (default: %d seconds)", 60), false, OptionsCategory::XBRIDGE);
+    gArgs.AddArg("-rpcxbridgethreads", strprintf("Number of threads serving asynchronous XBridge wallet calls (default: %d)", 4), false, OptionsCategory::XBRIDGE);
+    gArgs.AddArg("-rpcxbridgemaxinflight", strprintf("Maximum number of concurrent asynchronous XBridge calls per wallet (default: %d)", 2), false, OptionsCategory::XBRIDGE);
 
 #if HAVE_DECL_DAEMON
     gArgs.AddArg("-daemon", "Run in the background as a daemon and accept commands", false, OptionsCategory::OPTIONS);
@@ -696,6 +893,7 @@ static void ThreadImport(std::vector<fs::path> vImportFiles)
 
     // -reindex
     if (fReindex) {
+        BlockFileSequentialScan scan;
         int nFile = 0;
         while (true) {
             CDiskBlockPos pos(nFile, 0);
@@ -803,6 +1001,7 @@ static bool AppInitServers()
     if (!StartHTTPRPC())
         return false;
     if (gArgs.GetBoolArg("-rest", DEFAULT_REST_ENABLE)) StartREST();
+    if (gArgs.GetBoolArg("-metrics", DEFAULT_METRICS_ENABLE)) StartHTTPMetrics();
     StartHTTPServer();
     return true;
 }
@@ -923,6 +1122,7 @@ void InitLogging()
 namespace { // Variables internal to initialization process only
 
 int nMaxConnections;
+int nMaxXRouterConnections;
 int nUserMaxConnections;
 int nFD;
 ServiceFlags nLocalServices = ServiceFlags(NODE_NETWORK | NODE_NETWORK_LIMITED);
@@ -1012,19 +1212,20 @@ bool AppInitParameterInteraction()
     int nBind = std::max(nUserBind, size_t(1));
     nUserMaxConnections = gArgs.GetArg("-maxconnections", DEFAULT_MAX_PEER_CONNECTIONS);
     nMaxConnections = std::max(nUserMaxConnections, 0);
+    nMaxXRouterConnections = std::max<int>(gArgs.GetArg("-maxxrouterconnections", DEFAULT_MAX_XROUTER_CONNECTIONS), 0);
 
     // Trim requested connection counts, to fit into system limitations
     // <int> in std::min<int>(...) to work around FreeBSD compilation issue described in #2695
-    nFD = RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS + MAX_ADDNODE_CONNECTIONS);
+    nFD = RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS + MAX_ADDNODE_CONNECTIONS + nMaxXRouterConnections);
 #ifdef USE_POLL
     int fd_max = nFD;
 #else
     int fd_max = FD_SETSIZE;
 #endif
-    nMaxConnections = std::max(std::min<int>(nMaxConnections, fd_max - nBind - MIN_CORE_FILEDESCRIPTORS - MAX_ADDNODE_CONNECTIONS), 0);
+    nMaxConnections = std::max(std::min<int>(nMaxConnections, fd_max - nBind - MIN_CORE_FILEDESCRIPTORS - MAX_ADDNODE_CONNECTIONS - nMaxXRouterConnections), 0);
     if (nFD < MIN_CORE_FILEDESCRIPTORS)
         return InitError(_("Not enough file descriptors available."));
-    nMaxConnections = std::min(nFD - MIN_CORE_FILEDESCRIPTORS - MAX_ADDNODE_CONNECTIONS, nMaxConnections);
+    nMaxConnections = std::min(nFD - MIN_CORE_FILEDESCRIPTORS - MAX_ADDNODE_CONNECTIONS - nMaxXRouterConnections, nMaxConnections);
 
     if (nMaxConnections < nUserMaxConnections)
         InitWarning(strprintf(_("Reducing -maxconnections from %d to %d, because of system limitations."), nUserMaxConnections, nMaxConnections));
@@ -1058,6 +1259,11 @@ bool AppInitParameterInteraction()
     }
     fCheckBlockIndex = gArgs.GetBoolArg("-checkblockindex", chainparams.DefaultConsistencyChecks());
     fCheckpointsEnabled = gArgs.GetBoolArg("-checkpoints", DEFAULT_CHECKPOINTS_ENABLED);
+    fBlockMmap = gArgs.GetBoolArg("-blockmmap", DEFAULT_BLOCK_MMAP);
+    fBlockIndexSnapshot = gArgs.GetBoolArg("-blockindexsnapshot", DEFAULT_BLOCK_INDEX_SNAPSHOT);
+    SetBlockReadCacheSize(std::max<int64_t>(0, gArgs.GetArg("-blockreadcache", DEFAULT_BLOCK_READ_CACHE)) << 20);
+    fPersistStakeModifiers = gArgs.GetBoolArg("-persiststakemodifiers", DEFAULT_PERSIST_STAKE_MODIFIERS);
+    g_lock_profile_sample = std::max<int64_t>(0, gArgs.GetArg("-lockprofile", DEFAULT_LOCK_PROFILE_SAMPLE));
 
     hashAssumeValid = uint256S(gArgs.GetArg("-assumevalid", chainparams.GetConsensus().defaultAssumeValid.GetHex()));
     if (!hashAssumeValid.IsNull())
@@ -1196,6 +1402,12 @@ bool AppInitParameterInteraction()
     if (gArgs.GetBoolArg("-peerbloomfilters", DEFAULT_PEERBLOOMFILTERS))
         nLocalServices = ServiceFlags(nLocalServices | NODE_BLOOM);
 
+    if (gArgs.GetBoolArg("-peerblockfilters", DEFAULT_PEERBLOCKFILTERS)) {
+        if (!gArgs.GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX))
+            return InitError(_("Cannot set -peerblockfilters without -blockfilterindex."));
+        nLocalServices = ServiceFlags(nLocalServices | NODE_COMPACT_FILTERS);
+    }
+
     if (gArgs.GetArg("-rpcserialversion", DEFAULT_RPC_SERIALIZE_VERSION) < 0)
         return InitError("rpcserialversion must be non-negative.");
 
@@ -1262,6 +1474,64 @@ bool AppInitLockDataDirectory()
     return true;
 }
 
+/**
+ * Runs independent init stages on their own threads. A stage starts once the stages
+ * it depends on finished and the time each stage took is logged. Stages still running
+ * are joined when the graph goes out of scope, early returns from AppInitMain never
+ * leave a stage behind.
+ */
+class InitTaskGraph
+{
+public:
+    ~InitTaskGraph() { WaitAll(); }
+
+    void Add(const std::string& name, std::function<void()> func, const std::vector<std::string>& deps = {})
+    {
+        std::vector<std::shared_future<void>> depFutures;
+        for (const auto& dep : deps) {
+            assert(m_tasks.count(dep));
+            depFutures.push_back(m_tasks[dep]);
+        }
+        m_tasks[name] = std::async(std::launch::async, [name, func, depFutures]() {
+            for (const auto& dep : depFutures)
+                dep.get(); // rethrows the failure of a dependency
+            RenameThread(("blocknet-init-" + name).c_str());
+            const int64_t start = GetTimeMillis();
+            func();
+            LogPrintf("Init stage %s finished in %dms\n", name, GetTimeMillis() - start);
+        }).share();
+    }
+
+    /** Waits for a stage, returns false if it failed with an exception. */
+    bool Wait(const std::string& name)
+    {
+        auto it = m_tasks.find(name);
+        if (it == m_tasks.end())
+            return true;
+        try {
+            it->second.get();
+        } catch (const std::exception& e) {
+            LogPrintf("ERROR: Init stage %s failed: %s\n", name, e.what());
+            return false;
+        } catch (...) {
+            LogPrintf("ERROR: Init stage %s failed\n", name);
+            return false;
+        }
+        return true;
+    }
+
+    bool WaitAll()
+    {
+        bool ok{true};
+        for (const auto& task : m_tasks)
+            ok = Wait(task.first) && ok;
+        return ok;
+    }
+
+private:
+    std::map<std::string, std::shared_future<void>> m_tasks;
+};
+
 bool AppInitMain(InitInterfaces& interfaces)
 {
     const CChainParams& chainparams = Params();
@@ -1281,6 +1551,8 @@ bool AppInitMain(InitInterfaces& interfaces)
                 LogInstance().m_file_path.string()));
         }
     }
+    if (gArgs.GetBoolArg("-asynclogging", DEFAULT_ASYNCLOGGING))
+        LogInstance().StartAsyncLogging();
 
     if (!LogInstance().m_log_timestamps)
         LogPrintf("Startup time: %s\n", FormatISO8601DateTime(GetTime()));
@@ -1312,16 +1584,30 @@ bool AppInitMain(InitInterfaces& interfaces)
 
     InitSignatureCache();
     InitScriptExecutionCache();
+    if (gArgs.GetBoolArg("-persistsigcache", DEFAULT_PERSIST_SIGCACHE)) {
+        LoadSignatureCaches();
+    }
 
     LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
         for (int i=0; i<nScriptCheckThreads-1; i++)
             threadGroup.create_thread(&ThreadScriptCheck);
+        for (int i=0; i<nScriptCheckThreads-1; i++)
+            threadGroup.create_thread(&ThreadStakeCheck);
+        for (int i=0; i<nScriptCheckThreads-1; i++)
+            threadGroup.create_thread(&gov::ThreadVoteCheck);
+        for (int i=0; i<nScriptCheckThreads-1; i++)
+            threadGroup.create_thread(&ThreadSignatureCheck);
     }
+    threadGroup.create_thread(&sn::ThreadServiceNodeCheck);
 
-    // Start the lightweight task scheduler thread
+    // Start the lightweight task scheduler threads, validation notifications of
+    // different subscribers are processed concurrently on them
+    const int nSchedulerThreads = std::max(1, std::min((int)gArgs.GetArg("-schedulerthreads", DEFAULT_SCHEDULER_THREADS), MAX_SCHEDULER_THREADS));
+    LogPrintf("Using %d threads for the task scheduler\n", nSchedulerThreads);
     CScheduler::Function serviceLoop = std::bind(&CScheduler::serviceQueue, &scheduler);
-    threadGroup.create_thread(std::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
+    for (int i = 0; i < nSchedulerThreads; ++i)
+        threadGroup.create_thread(std::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
 
     GetMainSignals().RegisterBackgroundSignalScheduler(scheduler);
     GetMainSignals().RegisterWithMempoolSignals(mempool);
@@ -1526,8 +1812,9 @@ bool AppInitMain(InitInterfaces& interfaces)
                 LOCK(cs_main);
                 UnloadBlockIndex();
                 pcoinsTip.reset();
-                pcoinsdbview.reset();
                 pcoinscatcher.reset();
+                pcoinsflusher.reset();
+                pcoinsdbview.reset();
                 // new CBlockTreeDB tries to delete the existing file, which
                 // fails if it's still open from the previous loop. Close it first:
                 pblocktree.reset();
@@ -1577,7 +1864,8 @@ bool AppInitMain(InitInterfaces& interfaces)
                 // block tree into mapBlockIndex!
 
                 pcoinsdbview.reset(new CCoinsViewDB(nCoinDBCache, false, fReset || fReindexChainState));
-                pcoinscatcher.reset(new CCoinsViewErrorCatcher(pcoinsdbview.get()));
+                pcoinsflusher.reset(new CCoinsViewBackgroundFlush(pcoinsdbview.get()));
+                pcoinscatcher.reset(new CCoinsViewErrorCatcher(pcoinsflusher.get()));
 
                 // If necessary, upgrade from older database format.
                 // This is a no-op if we cleared the coinsviewdb with -reindex or -reindex-chainstate
@@ -1695,6 +1983,26 @@ bool AppInitMain(InitInterfaces& interfaces)
 
     // ********************************************************* Step 8: start indexers
     // Blocknet PoS requires indexer to be started before chain load
+    if (gArgs.GetBoolArg("-tradeindex", DEFAULT_TRADEINDEX)) {
+        g_tradeindex = MakeUnique<TradeIndex>(1 << 22, false, fReindex);
+        g_tradeindex->Start();
+    }
+    if (gArgs.GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX)) {
+        g_blockfilterindex = MakeUnique<BlockFilterIndex>(1 << 24, false, fReindex);
+        g_blockfilterindex->Start();
+    }
+    if (gArgs.GetBoolArg("-coinstatsindex", DEFAULT_COINSTATSINDEX)) {
+        g_coinstatsindex = MakeUnique<CoinStatsIndex>(1 << 22, false, fReindex);
+        g_coinstatsindex->Start();
+    }
+    if (gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX)) {
+        g_addressindex = MakeUnique<AddressIndex>(1 << 24, false, fReindex);
+        g_addressindex->Start();
+    }
+    if (gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX)) {
+        g_spentindex = MakeUnique<SpentIndex>(1 << 22, false, fReindex);
+        g_spentindex->Start();
+    }
 
     // ********************************************************* Step 9: load wallet
     for (const auto& client : interfaces.chain_clients) {
@@ -1780,13 +2088,41 @@ bool AppInitMain(InitInterfaces& interfaces)
 
     // ********************************************************* Step 12: start node
 
-    // Load governance data from chain data
-    std::string failReason;
-    if (!gov::Governance::instance().loadGovernanceData(chainActive, cs_main, Params().GetConsensus(), failReason)) {
-        LogPrintf("ERROR: Failed to load Governance data: %s\n", failReason);
-        uiInterface.InitMessage(_("Failed to load Governance data. If the problem continues please perform a chain reindex. See debug.log for more details"));
-        return false;
-    }
+    // Stages that only need the chain tip run in parallel with the network startup below.
+    // Governance data must be loaded before peers can relay proposals and votes, XBridge
+    // wallet probing and the XRouter config are only needed once the node is running.
+    InitTaskGraph initTasks;
+
+    // Load governance data from chain data, resuming from the governance checkpoint if possible
+    bool govLoaded{false};
+    std::string govFailReason;
+    initTasks.Add("governance", [&govLoaded, &govFailReason]() {
+        if (!gov::Governance::instance().openCheckpoint(gov::GOVERNANCE_DB_CACHE, false, gArgs.GetBoolArg("-reindex", false)))
+            LogPrintf("WARNING: Failed to open the governance checkpoint database, governance data will be loaded from the chain\n");
+        govLoaded = gov::Governance::instance().loadGovernanceData(chainActive, cs_main, Params().GetConsensus(), govFailReason);
+    });
+
+#ifdef ENABLE_WALLET
+    std::set<sn::ServiceNodeConfigEntry> snEntries;
+    initTasks.Add("snconfig", [&snEntries]() {
+        if (!sn::ServiceNodeMgr::instance().loadSnConfig(snEntries))
+            LogPrint(BCLog::SNODE, "Failed to load service node entries from servicenode.conf");
+    });
+    initTasks.Add("xbridge", []() {
+        xbridge::App & xapp = xbridge::App::instance();
+        xapp.init(); // init xbridge
+        xapp.start(); // start xbridge, probes the configured wallets
+    }, {"snconfig"});
+    initTasks.Add("xrouter", []() {
+        xrouter::App & xrapp = xrouter::App::instance();
+        xrouter::App::createConf(); // create config if it doesn't exist
+        if (xrouter::App::isEnabled()) {
+            const auto xrinit = xrapp.init(); // init xrouter
+            if (!xrinit || !xrapp.start()) // start xrouter if init succeeds
+                LogPrintf("XRouter failed to start, please check your configs\n");
+        }
+    }, {"snconfig"});
+#endif // ENABLE_WALLET
 
     int chain_active_height;
 
@@ -1814,6 +2150,7 @@ bool AppInitMain(InitInterfaces& interfaces)
     connOptions.nMaxOutbound = std::min(MAX_OUTBOUND_CONNECTIONS, connOptions.nMaxConnections);
     connOptions.nMaxAddnode = MAX_ADDNODE_CONNECTIONS;
     connOptions.nMaxFeeler = 1;
+    connOptions.nMaxXRouter = nMaxXRouterConnections;
     connOptions.nBestHeight = chain_active_height;
     connOptions.uiInterface = &uiInterface;
     connOptions.m_banman = g_banman.get();
@@ -1825,6 +2162,7 @@ bool AppInitMain(InitInterfaces& interfaces)
     connOptions.nMaxOutboundTimeframe = nMaxOutboundTimeframe;
     connOptions.nMaxOutboundLimit = nMaxOutboundLimit;
     connOptions.m_peer_connect_timeout = peer_connect_timeout;
+    connOptions.m_message_workers = gArgs.GetArg("-msgworkers", DEFAULT_MESSAGE_WORKERS);
 
     for (const std::string& strBind : gArgs.GetArgs("-bind")) {
         CService addrBind;
@@ -1862,6 +2200,12 @@ bool AppInitMain(InitInterfaces& interfaces)
             connOptions.m_specified_outgoing = connect;
         }
     }
+    if (!initTasks.Wait("governance") || !govLoaded) {
+        LogPrintf("ERROR: Failed to load Governance data: %s\n", govFailReason);
+        uiInterface.InitMessage(_("Failed to load Governance data. If the problem continues please perform a chain reindex. See debug.log for more details"));
+        return false;
+    }
+
     if (!g_connman->Start(scheduler, connOptions)) {
         return false;
     }
@@ -1878,23 +2222,24 @@ bool AppInitMain(InitInterfaces& interfaces)
 #ifdef ENABLE_WALLET
     if (!ShutdownRequested()) {
         sn::ServiceNodeMgr & smgr = sn::ServiceNodeMgr::instance();
-        std::set<sn::ServiceNodeConfigEntry> entries;
-        if (!smgr.loadSnConfig(entries))
-            LogPrint(BCLog::SNODE, "Failed to load service node entries from servicenode.conf");
+        const std::set<sn::ServiceNodeConfigEntry> & entries = snEntries;
 
-        uiInterface.InitMessage(_("Starting xbridge service"));
+        uiInterface.InitMessage(_("Starting xbridge and xrouter services"));
+        if (!initTasks.WaitAll())
+            LogPrintf("XBridge or XRouter failed to start, see the init stage errors above\n");
         xbridge::App & xapp = xbridge::App::instance();
-        xapp.init(); // init xbridge
-        xapp.start(); // start xbridge
 
-        xrouter::App & xrapp = xrouter::App::instance();
-        xrouter::App::createConf(); // create config if it doesn't exist
-        if (xrouter::App::isEnabled()) {
-            uiInterface.InitMessage(_("Starting xrouter service"));
-            const auto xrinit = xrapp.init(); // init xrouter
-            if (!xrinit || !xrapp.start()) // start xrouter if init succeeds
-                LogPrintf("XRouter failed to start, please check your configs\n");
-        }
+        // Warm start from the servicenode list cache, cached pings are revalidated on the check thread
+        if (!smgr.loadSnListFromDisk([](const sn::ServiceNodePing & ping) {
+            bool isReady = xrouter::App::isEnabled() && xrouter::App::instance().isReady();
+            if (isReady)
+                xrouter::App::instance().processConfigMessage(ping.getSnode());
+        }))
+            LogPrint(BCLog::SNODE, "No servicenode list cache loaded from servicenodes.dat\n");
+        fSnodeListLoaded = true;
+        scheduler.scheduleEvery([]{
+            sn::ServiceNodeMgr::instance().writeSnListToDisk();
+        }, DUMP_SNODES_INTERVAL * 1000);
 
         // If there's snode entries, proceed to register them
         if (!entries.empty()) {
@@ -1943,5 +2288,20 @@ bool AppInitMain(InitInterfaces& interfaces)
         g_banman->DumpBanlist();
     }, DUMP_BANS_INTERVAL * 1000);
 
+    const int64_t nValidationStatsInterval = gArgs.GetArg("-validationstatsinterval", 0);
+    if (nValidationStatsInterval > 0) {
+        scheduler.scheduleEvery([]{
+            for (const ValidationInterfaceStats& subscriber : GetMainSignals().GetSubscriberStats()) {
+                std::string callbacks;
+                for (const auto& callback : subscriber.callbacks) {
+                    const ValidationCallbackStats& s = callback.second;
+                    callbacks += strprintf(", %s %u calls avg %.2fms max %.2fms (wait avg %.2fms)", callback.first, s.calls,
+                        s.run_micros * 0.001 / s.calls, s.max_run_micros * 0.001, s.wait_micros * 0.001 / s.calls);
+                }
+                LogPrintf("Validation callbacks of %s: %u pending%s\n", subscriber.name, subscriber.pending, callbacks);
+            }
+        }, nValidationStatsInterval * 1000);
+    }
+
     return true;
 }
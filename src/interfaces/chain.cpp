@@ -6,6 +6,7 @@
 
 #include <chain.h>
 #include <chainparams.h>
+#include <index/blockfilterindex.h>
 #include <primitives/block.h>
 #include <sync.h>
 #include <txmempool.h>
@@ -178,6 +179,18 @@ public:
         LOCK(cs_main);
         return GuessVerificationProgress(Params().TxData(), LookupBlockIndex(block_hash));
     }
+    Optional<bool> blockFilterMatchesAny(const uint256& block_hash, const GCSFilter::ElementSet& filter_set) override
+    {
+        if (!g_blockfilterindex) return nullopt;
+        const CBlockIndex* index;
+        {
+            LOCK(cs_main);
+            index = LookupBlockIndex(block_hash);
+        }
+        BlockFilter filter;
+        if (!index || !g_blockfilterindex->LookupFilter(index, filter)) return nullopt;
+        return filter.GetFilter().MatchAny(filter_set);
+    }
     void requestMempoolTransactions(std::function<void(const CTransactionRef&)> fn) override
     {
         LOCK2(::cs_main, ::mempool.cs);
@@ -5,6 +5,7 @@
 #ifndef BITCOIN_INTERFACES_CHAIN_H
 #define BITCOIN_INTERFACES_CHAIN_H
 
+#include <blockfilter.h>
 #include <optional.h>
 
 #include <memory>
@@ -131,6 +132,11 @@ public:
     //! the specified block hash are verified.
     virtual double guessVerificationProgress(const uint256& block_hash) = 0;
 
+    //! Return whether the block filter of the block matches any of the
+    //! elements, nullopt if the block filter index isn't enabled or doesn't
+    //! have the filter of the block.
+    virtual Optional<bool> blockFilterMatchesAny(const uint256& block_hash, const GCSFilter::ElementSet& filter_set) = 0;
+
     //! Synchronously send TransactionAddedToMempool notifications about all
     //! current mempool transactions to the specified handler and return after
     //! the last one is sent. These notifications aren't coordinated with async
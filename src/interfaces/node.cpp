@@ -308,6 +308,10 @@ public:
                     GuessVerificationProgress(Params().TxData(), block));
             }));
     }
+    std::unique_ptr<Handler> handleNotifyGovernanceChanged(NotifyGovernanceChangedFn fn) override
+    {
+        return MakeHandler(::uiInterface.NotifyGovernanceChanged_connect(fn));
+    }
     InitInterfaces m_interfaces;
 };
 
@@ -26,6 +26,7 @@ class Coin;
 class RPCTimerInterface;
 class UniValue;
 class proxyType;
+class uint256;
 struct CNodeStateStats;
 
 namespace interfaces {
@@ -246,6 +247,10 @@ public:
     using NotifyHeaderTipFn =
         std::function<void(bool initial_download, int height, int64_t block_time, double verification_progress)>;
     virtual std::unique_ptr<Handler> handleNotifyHeaderTip(NotifyHeaderTipFn fn) = 0;
+
+    //! Register handler for governance changes, called with the hashes of the changed proposals.
+    using NotifyGovernanceChangedFn = std::function<void(const std::vector<uint256>& proposals)>;
+    virtual std::unique_ptr<Handler> handleNotifyGovernanceChanged(NotifyGovernanceChangedFn fn) = 0;
 };
 
 //! Return implementation of Node interface.
@@ -32,6 +32,7 @@
 #include <wallet/wallet.h>
 #include <wallet/walletutil.h>
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <utility>
@@ -96,15 +97,23 @@ WalletTx MakeWalletTx(interfaces::Chain::Lock& locked_chain, CWallet& wallet, co
     return result;
 }
 
+//! Height of the block containing the wallet tx, unconfirmed txs sort above all blocks.
+int WalletTxHeight(interfaces::Chain::Lock& locked_chain, const CWalletTx& wtx)
+{
+    LockAnnotation lock(::cs_main); // The chain lock holds cs_main.
+
+    auto mi = ::mapBlockIndex.find(wtx.hashBlock);
+    CBlockIndex* block = mi != ::mapBlockIndex.end() ? mi->second : nullptr;
+    return block ? block->nHeight : std::numeric_limits<int>::max();
+}
+
 //! Construct wallet tx status struct.
 WalletTxStatus MakeWalletTxStatus(interfaces::Chain::Lock& locked_chain, const CWalletTx& wtx)
 {
     LockAnnotation lock(::cs_main); // Temporary, for CheckFinalTx below. Removed in upcoming commit.
 
     WalletTxStatus result;
-    auto mi = ::mapBlockIndex.find(wtx.hashBlock);
-    CBlockIndex* block = mi != ::mapBlockIndex.end() ? mi->second : nullptr;
-    result.block_height = (block ? block->nHeight : std::numeric_limits<int>::max());
+    result.block_height = WalletTxHeight(locked_chain, wtx);
     result.blocks_to_maturity = wtx.GetBlocksToMaturity(locked_chain);
     result.depth_in_main_chain = wtx.GetDepthInMainChain(locked_chain);
     result.time_received = wtx.nTimeReceived;
@@ -317,6 +326,42 @@ public:
         }
         return result;
     }
+    std::vector<WalletTx> getWalletTxsByHeight(int max_height, size_t count, int& next_height) override
+    {
+        auto locked_chain = m_wallet->chain().lock();
+        LOCK(m_wallet->cs_wallet);
+        std::vector<std::pair<int, const CWalletTx*>> txs;
+        for (const auto& entry : m_wallet->mapWallet) {
+            const int height = WalletTxHeight(*locked_chain, entry.second);
+            if (height <= max_height) {
+                txs.emplace_back(height, &entry.second);
+            }
+        }
+        // Only the requested blocks are ordered, the remaining transactions
+        // are left for the following pages.
+        auto by_height = [](const std::pair<int, const CWalletTx*>& a, const std::pair<int, const CWalletTx*>& b) {
+            return a.first > b.first;
+        };
+        next_height = -1;
+        if (count > 0 && txs.size() > count) {
+            std::nth_element(txs.begin(), txs.begin() + (count - 1), txs.end(), by_height);
+            const int last_height = txs[count - 1].first;
+            auto end = std::partition(txs.begin(), txs.end(), [last_height](const std::pair<int, const CWalletTx*>& tx) {
+                return tx.first >= last_height;
+            });
+            if (end != txs.end()) {
+                next_height = last_height - 1;
+            }
+            txs.erase(end, txs.end());
+        }
+        std::sort(txs.begin(), txs.end(), by_height);
+        std::vector<WalletTx> result;
+        result.reserve(txs.size());
+        for (const auto& tx : txs) {
+            result.emplace_back(MakeWalletTx(*locked_chain, *m_wallet, *tx.second));
+        }
+        return result;
+    }
     bool tryGetTxStatus(const uint256& txid,
         interfaces::WalletTxStatus& tx_status,
         int& num_blocks,
@@ -175,6 +175,12 @@ public:
     //! Get list of all wallet transactions.
     virtual std::vector<WalletTx> getWalletTxs() = 0;
 
+    //! Get wallet transactions in descending block height order, unconfirmed
+    //! transactions first. Starting at max_height, whole blocks are returned
+    //! until at least count transactions are collected. next_height is set to
+    //! the height to continue from, or -1 if no older transactions remain.
+    virtual std::vector<WalletTx> getWalletTxsByHeight(int max_height, size_t count, int& next_height) = 0;
+
     //! Try to get updated status for a particular transaction, if possible without blocking.
     virtual bool tryGetTxStatus(const uint256& txid,
         WalletTxStatus& tx_status,
@@ -9,8 +9,13 @@
 #include <db.h>
 #include <hash.h>
 #include <kernel.h>
+#include <metrics.h>
 #include <script/interpreter.h>
 #include <timedata.h>
+#include <txdb.h>
+
+#include <deque>
+#include <set>
 
 using namespace std;
 
@@ -32,13 +37,30 @@ unsigned int getIntervalVersion(bool fTestNet)
 static std::map<int, unsigned int> mapStakeModifierCheckpoints =
     boost::assign::map_list_of(0, 0xfd11f4e7u);
 
+static Mutex muModifierWindow;
+// Last block whose stake modifier generator was looked up, and the generator
+static const CBlockIndex* pindexModifierLookup GUARDED_BY(muModifierWindow){nullptr};
+static const CBlockIndex* pindexModifierGenerator GUARDED_BY(muModifierWindow){nullptr};
+
 // Get the last stake modifier and its generation time from a given block
 static bool GetLastStakeModifier(const CBlockIndex* pindex, uint64_t& nStakeModifier, int64_t& nModifierTime)
 {
     if (!pindex)
         return error("GetLastStakeModifier: null pindex");
-    while (pindex && pindex->pprev && !pindex->GeneratedStakeModifier())
-        pindex = pindex->pprev;
+    {
+        // The walk back stops at the block of the previous lookup, usually the parent
+        LOCK(muModifierWindow);
+        const CBlockIndex* pindexFrom = pindex;
+        while (pindex && pindex->pprev && !pindex->GeneratedStakeModifier()) {
+            if (pindex == pindexModifierLookup) {
+                pindex = pindexModifierGenerator;
+                break;
+            }
+            pindex = pindex->pprev;
+        }
+        pindexModifierLookup = pindexFrom;
+        pindexModifierGenerator = pindex;
+    }
     if (!pindex->GeneratedStakeModifier())
         return error("GetLastStakeModifier: no generation at genesis block");
     nStakeModifier = pindex->nStakeModifier;
@@ -64,72 +86,139 @@ int64_t GetStakeModifierSelectionInterval()
     return nSelectionInterval;
 }
 
-// select a block from the candidate blocks in vSortedByTimestamp, excluding
-// already selected blocks in vSelectedBlocks, and with timestamp up to
-// nSelectionIntervalStop.
-#include <boost/foreach.hpp>
+// A block of the stake modifier selection interval. Candidates are ordered by timestamp,
+// ties are broken by the block hash as a number (a side effect of the staking protocol).
+struct ModifierCandidate {
+    int64_t nTime;
+    arith_uint256 hashBlock;
+    const CBlockIndex* pindex;
+
+    explicit ModifierCandidate(const CBlockIndex* pindexIn)
+        : nTime(pindexIn->GetBlockTime()), hashBlock(UintToArith256(pindexIn->GetBlockHash())), pindex(pindexIn) {}
+
+    bool operator<(const ModifierCandidate & other) const {
+        if (nTime == other.nTime)
+            return hashBlock < other.hashBlock;
+        return nTime < other.nTime;
+    }
+};
+
+// Candidate blocks of the last stake modifier computation. The candidates are the blocks
+// after the last block, walking back from the tip, with a timestamp before the selection
+// interval start. The next computation on the same chain adds the new blocks in sorted
+// order and drops the ones before the new start instead of walking the interval again.
+class ModifierCandidateWindow {
+public:
+    // Moves the window to end at pindexPrev and start after the last block before nStart
+    void Update(const CBlockIndex* pindexPrev, const int64_t nStart) {
+        if (!tip || pindexPrev->GetAncestor(tip->nHeight) != tip
+                 || pindexPrev->nHeight - tip->nHeight > static_cast<int>(chain.size()))
+            Clear(); // reorg, or more new blocks than the window holds
+        std::vector<const CBlockIndex*> added;
+        for (const CBlockIndex* pindex = pindexPrev; pindex && pindex != tip; pindex = pindex->pprev) {
+            if (!tip && pindex->GetBlockTime() < nStart)
+                break; // rebuilding, the rest is before the start
+            added.push_back(pindex);
+        }
+        for (auto it = added.rbegin(); it != added.rend(); ++it)
+            PushBack(*it);
+        tip = pindexPrev;
+
+        // The window ends at the highest block before the start. The cuts have rising
+        // timestamps, so it's the last cut before the start if there is one.
+        auto cut = std::lower_bound(cuts.begin(), cuts.end(), nStart,
+            [](const CBlockIndex* pindex, const int64_t t) -> bool { return pindex->GetBlockTime() < t; });
+        if (cut != cuts.begin()) {
+            const int nCutHeight = (*(cut - 1))->nHeight;
+            while (!chain.empty() && chain.front()->nHeight <= nCutHeight) {
+                sorted.erase(ModifierCandidate(chain.front()));
+                chain.pop_front();
+            }
+            while (!cuts.empty() && cuts.front()->nHeight <= nCutHeight)
+                cuts.pop_front();
+            return;
+        }
+
+        // No block of the window is before the start, blocks below it may belong to it
+        const CBlockIndex* pindex = chain.empty() ? nullptr : chain.front()->pprev;
+        while (pindex && pindex->GetBlockTime() >= nStart) {
+            PushFront(pindex);
+            pindex = pindex->pprev;
+        }
+    }
+
+    const std::set<ModifierCandidate> & Sorted() const { return sorted; }
+
+    // Height of the first block of the window, one above pindexPrev if it's empty
+    int FirstHeight() const { return chain.empty() ? tip->nHeight + 1 : chain.front()->nHeight; }
+
+    void Clear() {
+        tip = nullptr;
+        chain.clear();
+        cuts.clear();
+        sorted.clear();
+    }
+
+private:
+    void PushBack(const CBlockIndex* pindex) {
+        chain.push_back(pindex);
+        sorted.insert(ModifierCandidate(pindex));
+        // An older block can't end the window while a newer one isn't after it
+        while (!cuts.empty() && cuts.back()->GetBlockTime() >= pindex->GetBlockTime())
+            cuts.pop_back();
+        cuts.push_back(pindex);
+    }
+
+    void PushFront(const CBlockIndex* pindex) {
+        chain.push_front(pindex);
+        sorted.insert(ModifierCandidate(pindex));
+        if (cuts.empty() || pindex->GetBlockTime() < cuts.front()->GetBlockTime())
+            cuts.push_front(pindex);
+    }
+
+private:
+    const CBlockIndex* tip{nullptr};
+    std::deque<const CBlockIndex*> chain; // the window by height
+    std::deque<const CBlockIndex*> cuts; // blocks that can end the window, by height
+    std::set<ModifierCandidate> sorted;
+};
+
+static ModifierCandidateWindow modifierWindow GUARDED_BY(muModifierWindow);
+
+// A selection candidate with the selection hash of the current computation
+struct ModifierSelection {
+    const CBlockIndex* pindex;
+    int64_t nTime;
+    arith_uint256 hashSelection;
+    bool fSelected;
+};
+
+// select a block from the candidate blocks in vCandidates, excluding
+// already selected blocks, and with timestamp up to nSelectionIntervalStop.
 static bool SelectBlockFromCandidates(
-    vector<pair<int64_t, uint256> >& vSortedByTimestamp,
-    map<uint256, const CBlockIndex*>& mapSelectedBlocks,
+    std::vector<ModifierSelection>& vCandidates,
     int64_t nSelectionIntervalStop,
-    uint64_t nStakeModifierPrev,
     const CBlockIndex** pindexSelected)
 {
-    bool fModifierV2 = false;
-    bool fModifierV3 = false;
-    bool fFirstRun = true;
     bool fSelected = false;
     arith_uint256 hashBest = 0;
+    ModifierSelection* best = nullptr;
     *pindexSelected = (const CBlockIndex*)0;
-    BOOST_FOREACH (const auto & item, vSortedByTimestamp) {
-        const CBlockIndex* pindex = nullptr;
-        {
-            LOCK(cs_main);
-            pindex = LookupBlockIndex(item.second);
-        }
-        if (!pindex)
-            return error("SelectBlockFromCandidates: failed to find block index for candidate block %s", item.second.ToString().c_str());
-        if (fSelected && pindex->GetBlockTime() > nSelectionIntervalStop)
+    for (auto & item : vCandidates) {
+        if (fSelected && item.nTime > nSelectionIntervalStop)
             break;
-
-        //if the lowest block height (vSortedByTimestamp[0]) is >= switch height, use new modifier calc
-        if (fFirstRun) {
-            fModifierV2 = pindex->nHeight >= Params().GetConsensus().stakingModiferV2Block;
-            fModifierV3 = IsProtocolV05(pindex->GetBlockTime());
-            fFirstRun = false;
-        }
-
-        if (mapSelectedBlocks.count(pindex->GetBlockHash()) > 0)
+        if (item.fSelected)
             continue;
-
-        // compute the selection hash by hashing an input that is unique to that block
-        uint256 hashProof;
-        if (fModifierV3)
-            hashProof = pindex->hashProofOfStake;
-        else if (fModifierV2)
-            hashProof = pindex->GetBlockHash();
-        else
-            hashProof = IsProofOfStake(pindex->nHeight) ? ArithToUint256(0) : pindex->GetBlockHash();
-
-        CDataStream ss(SER_GETHASH, 0);
-        ss << hashProof << nStakeModifierPrev;
-        arith_uint256 hashSelection = UintToArith256(Hash(ss.begin(), ss.end()));
-
-        // the selection hash is divided by 2**32 so that proof-of-stake block
-        // is always favored over proof-of-work block. this is to preserve
-        // the energy efficiency property
-        if (IsProofOfStake(pindex->nHeight))
-            hashSelection >>= 32;
-
-        if (fSelected && hashSelection < hashBest) {
-            hashBest = hashSelection;
-            *pindexSelected = (const CBlockIndex*)pindex;
-        } else if (!fSelected) {
+        if (!fSelected || item.hashSelection < hashBest) {
             fSelected = true;
-            hashBest = hashSelection;
-            *pindexSelected = (const CBlockIndex*)pindex;
+            hashBest = item.hashSelection;
+            best = &item;
         }
     }
+    if (fSelected) {
+        best->fSelected = true;
+        *pindexSelected = best->pindex;
+    }
     if (gArgs.GetBoolArg("-printstakemodifier", false))
         LogPrintf("SelectBlockFromCandidates: selection hash=%s\n", hashBest.ToString().c_str());
     return fSelected;
@@ -175,40 +264,58 @@ bool ComputeNextStakeModifier(const CBlockIndex* pindexPrev, uint64_t& nStakeMod
     if (nModifierTime / getIntervalVersion(fTestNet) >= pindexPrev->GetBlockTime() / getIntervalVersion(fTestNet))
         return true;
 
-    // Sort candidate blocks by timestamp
-    vector<pair<int64_t, uint256> > vSortedByTimestamp;
-    vSortedByTimestamp.reserve(64 * getIntervalVersion(fTestNet) / nStakeTargetSpacing);
+    // Candidate blocks sorted by timestamp, carried forward from the previous computation
     int64_t nSelectionInterval = GetStakeModifierSelectionInterval();
     int64_t nSelectionIntervalStart = (pindexPrev->GetBlockTime() / getIntervalVersion(fTestNet)) * getIntervalVersion(fTestNet) - nSelectionInterval;
     const CBlockIndex* pindex = pindexPrev;
-
-    while (pindex && pindex->GetBlockTime() >= nSelectionIntervalStart) {
-        vSortedByTimestamp.push_back(make_pair(pindex->GetBlockTime(), pindex->GetBlockHash()));
-        pindex = pindex->pprev;
+    std::vector<ModifierSelection> vCandidates;
+    int nHeightFirstCandidate;
+    {
+        LOCK(muModifierWindow);
+        modifierWindow.Update(pindexPrev, nSelectionIntervalStart);
+        nHeightFirstCandidate = modifierWindow.FirstHeight();
+        vCandidates.reserve(modifierWindow.Sorted().size());
+        for (const auto & candidate : modifierWindow.Sorted())
+            vCandidates.push_back({candidate.pindex, candidate.nTime, 0, false});
     }
 
-    int nHeightFirstCandidate = pindex ? (pindex->nHeight + 1) : 0;
-    reverse(vSortedByTimestamp.begin(), vSortedByTimestamp.end());
-    // Need to handle a side effect in the staking protocol, where selection of modifier
-    // breaks a tie based on hash instead of block number, see comparator below checking
-    // for this case.
-    sort(vSortedByTimestamp.begin(), vSortedByTimestamp.end(),
-            [](const pair<int64_t, uint256> & a, const pair<int64_t, uint256> & b) -> bool {
-                if (a.first == b.first)
-                    return UintToArith256(a.second) < UintToArith256(b.second);
-                return a.first < b.first;
-            });
+    // The selection hashes only depend on the previous modifier, they are computed once for
+    // all rounds. The first candidate decides the modifier version.
+    if (!vCandidates.empty()) {
+        const bool fModifierV2 = vCandidates.front().pindex->nHeight >= Params().GetConsensus().stakingModiferV2Block;
+        const bool fModifierV3 = IsProtocolV05(vCandidates.front().pindex->GetBlockTime());
+        for (auto & item : vCandidates) {
+            // compute the selection hash by hashing an input that is unique to that block
+            uint256 hashProof;
+            if (fModifierV3)
+                hashProof = item.pindex->hashProofOfStake;
+            else if (fModifierV2)
+                hashProof = item.pindex->GetBlockHash();
+            else
+                hashProof = IsProofOfStake(item.pindex->nHeight) ? ArithToUint256(0) : item.pindex->GetBlockHash();
+
+            CDataStream ss(SER_GETHASH, 0);
+            ss << hashProof << nStakeModifier;
+            item.hashSelection = UintToArith256(Hash(ss.begin(), ss.end()));
+
+            // the selection hash is divided by 2**32 so that proof-of-stake block
+            // is always favored over proof-of-work block. this is to preserve
+            // the energy efficiency property
+            if (IsProofOfStake(item.pindex->nHeight))
+                item.hashSelection >>= 32;
+        }
+    }
 
     // Select 64 blocks from candidate blocks to generate stake modifier
     uint64_t nStakeModifierNew = 0;
     int64_t nSelectionIntervalStop = nSelectionIntervalStart;
     map<uint256, const CBlockIndex*> mapSelectedBlocks;
-    for (int nRound = 0; nRound < min(64, (int)vSortedByTimestamp.size()); nRound++) {
+    for (int nRound = 0; nRound < min(64, (int)vCandidates.size()); nRound++) {
         // add an interval section to the current selection round
         nSelectionIntervalStop += GetStakeModifierSelectionIntervalSection(nRound);
 
         // select a block from the candidates of current round
-        if (!SelectBlockFromCandidates(vSortedByTimestamp, mapSelectedBlocks, nSelectionIntervalStop, nStakeModifier, &pindex))
+        if (!SelectBlockFromCandidates(vCandidates, nSelectionIntervalStop, &pindex))
             return error("ComputeNextStakeModifier: unable to select block at round %d", nRound);
 
         // write the entropy bit of the selected block
@@ -297,11 +404,112 @@ bool GetKernelStakeModifierBlocknet(const CBlockIndex* pindexPrev, const uint256
     return true;
 }
 
+static Mutex muStakingStats;
+static StakingStats stakingStats GUARDED_BY(muStakingStats);
+
+StakingStats GetStakingStats()
+{
+    LOCK(muStakingStats);
+    return stakingStats;
+}
+
+void SetStakingStats(const StakingStats & stats)
+{
+    LOCK(muStakingStats);
+    stakingStats = stats;
+}
+
+static metrics::CallbackGauge g_metric_stake_hashrate{"blocknet_stake_hashes_per_second",
+    "Kernel hashes per second of the last stake search", []{ return GetStakingStats().HashesPerSecond(); }};
+static metrics::CallbackGauge g_metric_stake_coins{"blocknet_stake_coins",
+    "Coins searched by the last stake search", []{ return (double)GetStakingStats().coinsSearched; }};
+static metrics::CallbackGauge g_metric_staked_blocks{"blocknet_staked_blocks",
+    "Blocks staked since startup", []{ return (double)GetStakingStats().stakes; }};
+
+std::atomic<bool> fPersistStakeModifiers{DEFAULT_PERSIST_STAKE_MODIFIERS};
+static Mutex muStakeModifiers;
+static limitedmap<uint256, StakeModifierEntry> mapStakeModifiers GUARDED_BY(muStakeModifiers){DEFAULT_STAKE_MODIFIER_CACHE_SIZE};
+static std::map<uint256, StakeModifierEntry> mapDirtyStakeModifiers GUARDED_BY(muStakeModifiers); // not yet written to db
+
+bool GetCachedStakeModifier(const uint256 & hashBlockFrom, StakeModifierEntry & entry)
+{
+    bool found{false};
+    {
+        LOCK(muStakeModifiers);
+        auto it = mapStakeModifiers.find(hashBlockFrom);
+        if (it != mapStakeModifiers.end()) {
+            entry = it->second;
+            found = true;
+        }
+    }
+    if (!found && fPersistStakeModifiers && pblocktree)
+        found = pblocktree->ReadStakeModifier(hashBlockFrom, entry);
+    if (!found)
+        return false;
+
+    // Entries selected from a chain that was since reorganized are stale
+    {
+        LOCK(cs_main);
+        const auto pindex = LookupBlockIndex(entry.hashModifierBlock);
+        if (!pindex || !chainActive.Contains(pindex))
+            found = false;
+    }
+    LOCK(muStakeModifiers);
+    if (!found)
+        mapStakeModifiers.erase(hashBlockFrom);
+    else if (!mapStakeModifiers.count(hashBlockFrom))
+        mapStakeModifiers.insert(std::make_pair(hashBlockFrom, entry)); // loaded from db
+    return found;
+}
+
+void CacheStakeModifier(const uint256 & hashBlockFrom, const StakeModifierEntry & entry)
+{
+    LOCK(muStakeModifiers);
+    mapStakeModifiers.erase(hashBlockFrom);
+    mapStakeModifiers.insert(std::make_pair(hashBlockFrom, entry));
+    if (fPersistStakeModifiers)
+        mapDirtyStakeModifiers[hashBlockFrom] = entry;
+}
+
+bool FlushStakeModifierCache()
+{
+    std::vector<std::pair<uint256, StakeModifierEntry>> entries;
+    {
+        LOCK(muStakeModifiers);
+        if (mapDirtyStakeModifiers.empty())
+            return true;
+        entries.assign(mapDirtyStakeModifiers.begin(), mapDirtyStakeModifiers.end());
+        mapDirtyStakeModifiers.clear();
+    }
+    if (!pblocktree)
+        return false;
+    return pblocktree->WriteStakeModifiers(entries);
+}
+
+void ClearStakeModifierCache()
+{
+    LOCK(muStakeModifiers);
+    mapStakeModifiers.clear();
+    mapDirtyStakeModifiers.clear();
+    LOCK(muModifierWindow);
+    modifierWindow.Clear();
+    pindexModifierLookup = nullptr;
+    pindexModifierGenerator = nullptr;
+}
+
 // The stake modifier used to hash for a stake kernel is chosen as the stake
 // modifier about a selection interval later than the coin generating the kernel
 bool GetKernelStakeModifierV03(uint256 hashBlockFrom, uint64_t& nStakeModifier, int& nStakeModifierHeight, int64_t& nStakeModifierTime, bool fPrintProofOfStake)
 {
     nStakeModifier = 0;
+    StakeModifierEntry cached;
+    if (GetCachedStakeModifier(hashBlockFrom, cached)) {
+        nStakeModifier = cached.nStakeModifier;
+        nStakeModifierHeight = cached.nStakeModifierHeight;
+        nStakeModifierTime = cached.nStakeModifierTime;
+        return true;
+    }
+
     const CBlockIndex *pindexFrom = nullptr;
     {
         LOCK(cs_main);
@@ -314,12 +522,8 @@ bool GetKernelStakeModifierV03(uint256 hashBlockFrom, uint64_t& nStakeModifier,
     int64_t nStakeModifierSelectionInterval = GetStakeModifierSelectionInterval();
     const CBlockIndex* pindex = pindexFrom;
     CBlockIndex* pindexNext = chainActive[pindexFrom->nHeight + 1];
-    auto slowSearch = [](std::map<int, CBlockIndex*> & mbi, const int blockNumber) -> CBlockIndex* {
-        LOCK(cs_main);
-        return mbi[blockNumber];
-    };
-    if (!pindexNext) // slow search
-        pindexNext = slowSearch(mapHeaderIndex, pindexFrom->nHeight + 1);
+    if (!pindexNext) // search the headers beyond the tip
+        pindexNext = chainHeaders.Get(pindexFrom->nHeight + 1);
 
     // loop to find the stake modifier later by a selection interval
     while (nStakeModifierTime < pindexFrom->GetBlockTime() + nStakeModifierSelectionInterval) {
@@ -331,14 +535,30 @@ bool GetKernelStakeModifierV03(uint256 hashBlockFrom, uint64_t& nStakeModifier,
         pindex = pindexNext;
         const int nextBlock = pindexNext->nHeight + 1;
         pindexNext = chainActive[nextBlock];
-        if (!pindexNext) // slow search
-            pindexNext = slowSearch(mapHeaderIndex, nextBlock);
+        if (!pindexNext) // search the headers beyond the tip
+            pindexNext = chainHeaders.Get(nextBlock);
         if (pindex->GeneratedStakeModifier()) {
             nStakeModifierHeight = pindex->nHeight;
             nStakeModifierTime = pindex->GetBlockTime();
         }
     }
     nStakeModifier = pindex->nStakeModifier;
+
+    // Only cache modifiers selected from the active chain, results that rely on
+    // headers beyond the tip may still change.
+    bool activeChain{false};
+    {
+        LOCK(cs_main);
+        activeChain = chainActive.Contains(pindex);
+    }
+    if (activeChain) {
+        StakeModifierEntry entry;
+        entry.nStakeModifier = nStakeModifier;
+        entry.nStakeModifierHeight = nStakeModifierHeight;
+        entry.nStakeModifierTime = nStakeModifierTime;
+        entry.hashModifierBlock = pindex->GetBlockHash();
+        CacheStakeModifier(hashBlockFrom, entry);
+    }
     return true;
 }
 
@@ -355,6 +575,24 @@ uint256 stakeHashV05(CDataStream ss, const unsigned int & nTimeBlockFrom, const
     return Hash(ss.begin(), ss.end());
 }
 
+StakeKernelHasher StakeKernelHasher::V05(const uint64_t & nStakeModifier, const unsigned int & nTimeBlockFrom, const int & blockHeight, const unsigned int & prevoutIndex) {
+    StakeKernelHasher hasher;
+    hasher.ss << nStakeModifier << nTimeBlockFrom << blockHeight << prevoutIndex;
+    return hasher;
+}
+
+StakeKernelHasher StakeKernelHasher::V03(const uint64_t & nStakeModifier, const unsigned int & nTimeBlockFrom, const unsigned int & prevoutIndex, const uint256 & prevoutHash) {
+    StakeKernelHasher hasher;
+    hasher.ss << nStakeModifier << nTimeBlockFrom << prevoutIndex << prevoutHash;
+    return hasher;
+}
+
+uint256 StakeKernelHasher::operator()(const unsigned int & nTimeTx) const {
+    CHashWriter h(ss); // copy of the midstate, no allocation
+    h << nTimeTx;
+    return h.GetHash();
+}
+
 //test hash vs target
 bool stakeTargetHit(uint256 hashProofOfStake, int64_t nValueIn, arith_uint256 bnTargetPerCoinDay)
 {
@@ -411,13 +649,14 @@ bool CheckStakeKernelHash(const CBlockIndex* pindexPrev, unsigned int nBits, con
     bool fSuccess = false;
     unsigned int nTryTime = 0;
     unsigned int i;
+    const auto hasherV05 = StakeKernelHasher::V05(nStakeModifier, nTimeBlockFrom, currentBlock, prevout.n);
+    const auto hasherV03 = StakeKernelHasher::V03(nStakeModifier, nTimeBlockFrom, prevout.n, prevout.hash);
     for (i = 0; i < (nHashDrift); i++) //iterate the hashing
     {
         //hash this iteration
         nTryTime = nTimeTx + nHashDrift - i;
         v05StakeProtocol = IsProtocolV05(nTryTime);
-        hashProofOfStake = v05StakeProtocol ? stakeHashV05(ss, nTimeBlockFrom, currentBlock, prevout.n, nTryTime)
-                                            : stakeHash(nTryTime, ss, prevout.n, prevout.hash, nTimeBlockFrom);
+        hashProofOfStake = v05StakeProtocol ? hasherV05(nTryTime) : hasherV03(nTryTime);
 
         // if stake hash does not meet the target then continue to next iteration
         if (!stakeTargetHit(hashProofOfStake, nValueIn, bnTargetPerCoinDay))
@@ -445,7 +684,39 @@ bool CheckStakeKernelHash(const CBlockIndex* pindexPrev, unsigned int nBits, con
     return fSuccess;
 }
 
+bool CheckStakeKernelHashV05(const CBlockHeader & block, const CBlockIndex *pindexPrev, const CBlockIndex *pindexFrom, uint256 & hashProofOfStake)
+{
+    const unsigned int nTimeTx = block.nTime;
+    if (!IsProtocolV05(nTimeTx))
+        return false;
+    const unsigned int nTimeBlockFrom = pindexFrom->GetBlockTime();
+    if (nTimeTx < nTimeBlockFrom) // Transaction timestamp violation
+        return false;
+    if (nTimeBlockFrom + Params().GetConsensus().stakeMinAge > nTimeTx) // min age violation
+        return false;
+    // Same modifier selection as GetKernelStakeModifierBlocknet
+    if (static_cast<int64_t>(nTimeTx) - static_cast<int64_t>(Params().GetConsensus().stakeMinAge) <= pindexFrom->GetBlockTime())
+        return false;
+
+    arith_uint256 bnTargetPerCoinDay;
+    bnTargetPerCoinDay.SetCompact(block.nBits);
+    const auto hasher = StakeKernelHasher::V05(pindexPrev->nStakeModifier, nTimeBlockFrom, pindexPrev->nHeight + 1, block.nStakeIndex);
+    hashProofOfStake = hasher(nTimeTx);
+    return stakeTargetHit(hashProofOfStake, block.nStakeAmount, bnTargetPerCoinDay);
+}
+
 bool CheckProofOfStake(const CBlockHeader & block, const CBlockIndex* pindexPrev, uint256 & hashProofOfStake, const Consensus::Params & consensusParams) {
+    return CheckProofOfStake(block, block.GetHash(), pindexPrev, hashProofOfStake, consensusParams);
+}
+
+bool CheckProofOfStake(const CBlockHeader & block, const uint256 & blockHash, const CBlockIndex* pindexPrev, uint256 & hashProofOfStake, const Consensus::Params & consensusParams) {
+    // Use the result of the stake check queue or of a previous check if there is one
+    StakeCheckResult check;
+    if (pindexPrev && pindexPrev->GetBlockHash() == block.hashPrevBlock && GetStakeCheck(blockHash, check) && check.kernel) {
+        hashProofOfStake = check.hashProofOfStake;
+        return true;
+    }
+
     CBlockIndex *pindex = nullptr;
     {
         LOCK(cs_main);
@@ -464,6 +735,15 @@ bool CheckProofOfStake(const CBlockHeader & block, const CBlockIndex* pindexPrev
                      block.hashStake.ToString().c_str(), hashProofOfStake.ToString().c_str(), __func__);
     }
 
+    // v05 kernels only depend on the previous block, remember the result
+    if (IsProtocolV05(block.nTime) && pindexPrev->GetBlockHash() == block.hashPrevBlock) {
+        StakeCheckResult result;
+        result.height = pindexPrev->nHeight + 1;
+        result.kernel = true;
+        result.hashProofOfStake = hashProofOfStake;
+        SetStakeCheck(blockHash, result);
+    }
+
     return true;
 }
 
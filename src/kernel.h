@@ -8,6 +8,8 @@
 #include <arith_uint256.h>
 #include <chain.h>
 #include <chainparams.h>
+#include <hash.h>
+#include <limitedmap.h>
 #include <miner.h>
 #include <shutdown.h>
 #include <streams.h>
@@ -15,8 +17,16 @@
 #include <logging.h>
 #include <util/system.h>
 #include <validation.h>
+#include <validationinterface.h>
 #include <wallet/wallet.h>
 
+#include <array>
+#include <functional>
+#include <numeric>
+#include <set>
+#include <thread>
+
+#include <boost/signals2/signal.hpp>
 #include <boost/thread.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 
@@ -26,6 +36,12 @@ static const unsigned int MODIFIER_INTERVAL_TESTNET = 60;
 extern unsigned int nModifierInterval;
 extern unsigned int getIntervalVersion(bool fTestNet);
 
+// Number of threads used by the staker to search for stake kernels (0 = auto)
+static const int DEFAULT_STAKING_THREADS = 1;
+static const int MAX_STAKING_THREADS = 16;
+// Minimum number of coins assigned to each stake search thread
+static const int MIN_STAKING_COINS_PER_THREAD = 100;
+
 // MODIFIER_INTERVAL_RATIO:
 // ratio of group interval length between the last group and the first group
 static const int MODIFIER_INTERVAL_RATIO = 3;
@@ -41,6 +57,26 @@ bool IsProtocolV05(uint64_t nTimeTx);
 uint256 stakeHash(unsigned int nTimeTx, CDataStream ss, unsigned int prevoutIndex, uint256 prevoutHash,unsigned int nTimeBlockFrom);
 uint256 stakeHashV05(CDataStream ss, const unsigned int & nTimeBlockFrom, const int & blockHeight, const unsigned int & prevoutIndex, const unsigned int & nTimeTx);
 
+/**
+ * Computes the stake kernel hashes of a single coin for many stake times. The part of the
+ * kernel that doesn't depend on the stake time (modifier, block time, height or prevout) is
+ * serialized once into a SHA256 midstate, each stake time only finishes the last 4 bytes.
+ * Produces the same hashes as stakeHash and stakeHashV05.
+ */
+class StakeKernelHasher {
+public:
+    /** Blocknet staking protocol v05 kernel (see stakeHashV05) */
+    static StakeKernelHasher V05(const uint64_t & nStakeModifier, const unsigned int & nTimeBlockFrom, const int & blockHeight, const unsigned int & prevoutIndex);
+    /** Blocknet staking protocol v03 kernel (see stakeHash) */
+    static StakeKernelHasher V03(const uint64_t & nStakeModifier, const unsigned int & nTimeBlockFrom, const unsigned int & prevoutIndex, const uint256 & prevoutHash);
+    /** Returns the kernel hash for the specified stake time. */
+    uint256 operator()(const unsigned int & nTimeTx) const;
+
+private:
+    StakeKernelHasher() : ss(SER_GETHASH, 0) {}
+    CHashWriter ss;
+};
+
 // Check whether stake kernel meets hash target
 bool stakeTargetHit(uint256 hashProofOfStake, int64_t nValueIn, arith_uint256 bnTargetPerCoinDay);
 
@@ -51,9 +87,55 @@ bool GetKernelStakeModifier(const CBlockIndex *pindexPrev, const uint256 & hashB
 bool GetKernelStakeModifierV03(uint256 hashBlockFrom, uint64_t& nStakeModifier, int& nStakeModifierHeight, int64_t& nStakeModifierTime, bool fPrintProofOfStake);
 bool GetKernelStakeModifierBlocknet(const CBlockIndex *pindexPrev, const uint256 & hashBlockFrom, const unsigned int & nTimeTx, uint64_t & nStakeModifier, int & nStakeModifierHeight, int64_t & nStakeModifierTime, bool fPrintProofOfStake);
 
+/**
+ * Stake modifier selected by the v03 staking protocol for a stake input confirmed in a specific
+ * block. The modifier only depends on the ancestry of hashModifierBlock, entries are valid as
+ * long as that block is in the active chain.
+ */
+struct StakeModifierEntry {
+    uint64_t nStakeModifier{0};
+    int nStakeModifierHeight{0};
+    int64_t nStakeModifierTime{0};
+    uint256 hashModifierBlock; // last block walked by the selection interval search
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(nStakeModifier);
+        READWRITE(nStakeModifierHeight);
+        READWRITE(nStakeModifierTime);
+        READWRITE(hashModifierBlock);
+    }
+
+    bool operator<(const StakeModifierEntry & other) const {
+        return nStakeModifierHeight < other.nStakeModifierHeight;
+    }
+};
+
+/** Maximum number of v03 stake modifiers kept in memory (lowest heights are evicted first) */
+static const unsigned int DEFAULT_STAKE_MODIFIER_CACHE_SIZE = 100000;
+/** Default for -persiststakemodifiers */
+static const bool DEFAULT_PERSIST_STAKE_MODIFIERS = false;
+/** Write v03 stake modifiers to the block index database */
+extern std::atomic<bool> fPersistStakeModifiers;
+
+/** Stake modifier cache management (shared by block validation and the staker) */
+bool GetCachedStakeModifier(const uint256 & hashBlockFrom, StakeModifierEntry & entry);
+void CacheStakeModifier(const uint256 & hashBlockFrom, const StakeModifierEntry & entry);
+bool FlushStakeModifierCache();
+void ClearStakeModifierCache();
+
 // Check kernel hash target and coinstake signature
 // Sets hashProofOfStake on success return
+/**
+ * Checks the v05 stake kernel of a block whose stake input block is known. Doesn't lock cs_main
+ * (used by the stake check queue). Returns false for kernels of other protocol versions.
+ */
+bool CheckStakeKernelHashV05(const CBlockHeader & block, const CBlockIndex *pindexPrev, const CBlockIndex *pindexFrom, uint256 & hashProofOfStake);
 bool CheckProofOfStake(const CBlockHeader & block, const CBlockIndex *pindexPrev, uint256 & hashProofOfStake, const Consensus::Params & consensusParams);
+// As above, for a header whose hash is known
+bool CheckProofOfStake(const CBlockHeader & block, const uint256 & blockHash, const CBlockIndex *pindexPrev, uint256 & hashProofOfStake, const Consensus::Params & consensusParams);
 
 // peercoin: For use with Staking Protocol V05.
 unsigned int GetStakeEntropyBit(const uint256 & blockHash, const int64_t & blockTime);
@@ -77,6 +159,314 @@ static std::string DateTimeStrFormat(const char* pszFormat, int64_t nTime) {
 bool IsProofOfStake(int blockHeight, const Consensus::Params & consensusParams);
 bool IsProofOfStake(int blockHeight);
 
+// Number of seconds covered by the stake schedule (must be larger than the stake search window)
+static const int STAKE_SCHEDULE_SECONDS = 256;
+// Maximum number of stake candidates kept for each second of the stake schedule
+static const int STAKE_SCHEDULE_BUCKET_SIZE = 4;
+
+/**
+ * Time-bucketed ring of stake candidates. Each stake time maps to a fixed bucket that holds up
+ * to STAKE_SCHEDULE_BUCKET_SIZE candidates (the smallest inputs are kept). The memory used is
+ * fixed and adding a candidate never allocates. Not thread safe, except for NextTime().
+ */
+class StakeSchedule {
+public:
+    struct Candidate {
+        COutPoint outpoint;
+        CAmount value{0};
+        uint32_t wallet{0}; // index into the staker's wallet list
+        int64_t time{0};
+        unsigned int blockTime{0}; // time of the block the input was confirmed in
+        uint256 hashProofOfStake;
+    };
+    struct Bucket {
+        int64_t time{0};
+        int count{0};
+        std::array<Candidate, STAKE_SCHEDULE_BUCKET_SIZE> items;
+    };
+
+public:
+    explicit StakeSchedule() : buckets(STAKE_SCHEDULE_SECONDS) {}
+
+    /**
+     * Adds a candidate to the bucket of its stake time. Returns false if the candidate is older
+     * than the times covered by the ring or if its bucket is full of smaller inputs.
+     */
+    bool Add(const Candidate & candidate) {
+        auto & bucket = buckets[candidate.time % STAKE_SCHEDULE_SECONDS];
+        if (bucket.count > 0 && bucket.time > candidate.time)
+            return false; // slot is used by a newer stake time
+        if (bucket.time != candidate.time) { // stale slot
+            bucket.time = candidate.time;
+            bucket.count = 0;
+        }
+        if (bucket.count < STAKE_SCHEDULE_BUCKET_SIZE) {
+            bucket.items[bucket.count++] = candidate;
+        } else { // replace the largest input
+            auto largest = std::max_element(bucket.items.begin(), bucket.items.end(),
+                    [](const Candidate & a, const Candidate & b) { return a.value < b.value; });
+            if (largest->value <= candidate.value)
+                return false;
+            *largest = candidate;
+        }
+        if (candidate.time > cutoffTime && (nextTime == 0 || candidate.time < nextTime))
+            nextTime = candidate.time;
+        return true;
+    }
+
+    /** Removes all candidates with a stake time at or before the cutoff. */
+    void Prune(const int64_t & cutoff) {
+        cutoffTime = cutoff;
+        int64_t next{0};
+        for (auto & bucket : buckets) {
+            if (bucket.count > 0 && bucket.time <= cutoff)
+                bucket.count = 0;
+            else if (bucket.count > 0 && (next == 0 || bucket.time < next))
+                next = bucket.time;
+        }
+        nextTime = next;
+    }
+
+    void Clear() {
+        for (auto & bucket : buckets)
+            bucket.count = 0;
+        nextTime = 0;
+    }
+
+    bool Empty() const {
+        for (const auto & bucket : buckets) {
+            if (bucket.count > 0)
+                return false;
+        }
+        return true;
+    }
+
+    /** Returns the non-empty buckets sorted by stake time (ascending). */
+    std::vector<const Bucket*> Buckets() const {
+        std::vector<const Bucket*> result;
+        for (const auto & bucket : buckets) {
+            if (bucket.count > 0)
+                result.push_back(&bucket);
+        }
+        std::sort(result.begin(), result.end(), [](const Bucket *a, const Bucket *b) { return a->time < b->time; });
+        return result;
+    }
+
+    /** Earliest stake time after the last cutoff (0 if there is none). Safe to call from any thread. */
+    int64_t NextTime() const {
+        return nextTime;
+    }
+
+private:
+    std::vector<Bucket> buckets;
+    int64_t cutoffTime{0};
+    std::atomic<int64_t> nextTime{0};
+};
+
+/** Staker performance counters of the last stake search (see getstakingstats). */
+struct StakingStats {
+    int64_t lastSearchTime{0}; // time of the last stake search
+    int height{0}; // tip height of the last stake search
+    uint64_t coins{0}; // coins in the staking coin indices
+    uint64_t coinsSearched{0}; // coins that were hashed in the last search
+    int64_t searchWindow{0}; // number of stake times (seconds) searched per coin
+    uint64_t hashes{0}; // kernel hashes computed in the last search
+    int64_t searchMicros{0}; // duration of the last stake search
+    int64_t lockWaitMicros{0}; // time the last stake search waited for cs_main and the wallets
+    int threads{0};
+    uint64_t stakes{0}; // blocks staked since startup
+    int64_t lastStakeTime{0};
+    int64_t lastHitLatencyMillis{0}; // time from seeing the tip to submitting the last staked block
+
+    double HashesPerSecond() const {
+        return searchMicros > 0 ? static_cast<double>(hashes) * 1000000 / searchMicros : 0;
+    }
+};
+/** Returns the latest staker counters. */
+StakingStats GetStakingStats();
+/** Publishes the staker counters (used by the staker). */
+void SetStakingStats(const StakingStats & stats);
+
+/**
+ * Staking coins of a wallet (confirmed, spendable outputs at or above the minimum stake amount).
+ * The coins are loaded once, afterwards only the transactions reported by the wallet's
+ * NotifyTransactionChanged signal (and the transactions confirmed in disconnected blocks) are
+ * evaluated again. This avoids a full wallet scan under cs_main on every staker update.
+ */
+class StakingCoinIndex {
+public:
+    struct Coin {
+        COutPoint outpoint;
+        CAmount value{0};
+        int64_t txTime{0};
+        uint256 hashBlock;
+        int64_t blockTime{0}; // time of the block the coin was confirmed in
+        int blockHeight{0};
+        bool coinStake{false};
+    };
+
+public:
+    explicit StakingCoinIndex(const std::shared_ptr<CWallet> & wallet, const std::function<void()> & onChanged) {
+        conn = MakeUnique<boost::signals2::scoped_connection>(wallet->NotifyTransactionChanged.connect(
+                [this,onChanged](CWallet*, const uint256 & hashTx, ChangeType) {
+                    {
+                        LOCK(mu);
+                        dirty.insert(hashTx);
+                    }
+                    onChanged();
+                }));
+    }
+
+    /**
+     * Applies the pending wallet changes to the index. The first call (or a change to the
+     * minimum stake amount) loads all the coins of the wallet.
+     */
+    void Sync(CWallet *pwallet, const CBlockIndex *tip, const CAmount & minStakeAmount, int64_t *lockWaitMicros=nullptr) {
+        std::set<uint256> txs;
+        if (!TakeChanges(tip, minStakeAmount, txs))
+            return;
+
+        const int64_t lockStart = GetTimeMicros();
+        auto locked_chain = pwallet->chain().lock();
+        LOCK2(cs_main, pwallet->cs_wallet);
+        if (lockWaitMicros)
+            *lockWaitMicros += GetTimeMicros() - lockStart;
+        ApplyChanges(*pwallet, *locked_chain, tip, minStakeAmount, txs);
+    }
+
+    /**
+     * Takes the pending wallet changes to apply with ApplyChanges(). Returns false if the
+     * index is up to date and there is nothing to apply.
+     */
+    bool TakeChanges(const CBlockIndex *tip, const CAmount & minStakeAmount, std::set<uint256> & txs) {
+        {
+            LOCK(mu);
+            txs.swap(dirty);
+        }
+        return !(loaded && minStakeAmount == minAmount && txs.empty() && tip == lastTip);
+    }
+
+    /** Applies the wallet changes taken with TakeChanges(). */
+    void ApplyChanges(CWallet & wallet, interfaces::Chain::Lock & locked_chain, const CBlockIndex *tip,
+                      const CAmount & minStakeAmount, std::set<uint256> & txs)
+        EXCLUSIVE_LOCKS_REQUIRED(cs_main, wallet.cs_wallet)
+    {
+        if (!loaded || minStakeAmount != minAmount) {
+            Load(wallet, locked_chain, minStakeAmount);
+            lastTip = tip;
+            return;
+        }
+        // Disconnected blocks don't necessarily notify the wallet, evaluate the
+        // coins that were confirmed above the fork again.
+        if (lastTip && tip && tip->GetAncestor(lastTip->nHeight) != lastTip) {
+            const auto fork = LastCommonAncestor(lastTip, tip);
+            for (const auto & item : coins) {
+                if (!fork || item.second.blockHeight > fork->nHeight)
+                    txs.insert(item.first.hash);
+            }
+        }
+        lastTip = tip;
+        for (const auto & hash : txs) {
+            const CWalletTx *wtx = wallet.GetWalletTx(hash);
+            if (!wtx) { // tx was removed from the wallet
+                EraseOutputs(hash);
+                continue;
+            }
+            AddOutputs(wallet, locked_chain, *wtx);
+            // Coins spent by the tx are removed, coins of abandoned or conflicted txs return
+            for (const auto & in : wtx->tx->vin) {
+                const CWalletTx *prev = wallet.GetWalletTx(in.prevout.hash);
+                if (prev)
+                    AddOutputs(wallet, locked_chain, *prev);
+                else
+                    coins.erase(in.prevout);
+            }
+        }
+    }
+
+    /** Returns the coins that meet the maturity and stake age requirements at the tip. */
+    std::vector<Coin> StakeableCoins(const CBlockIndex *tip, const Consensus::Params & params, const int64_t & adjustedTime) const {
+        std::vector<Coin> result;
+        for (const auto & item : coins) {
+            const auto & coin = item.second;
+            if (adjustedTime - coin.txTime < params.stakeMinAge) // skip coins that don't meet stake age
+                continue;
+            const int depth = tip->nHeight - coin.blockHeight + 1;
+            if (depth < params.coinMaturity || (coin.coinStake && depth <= params.coinMaturity)) // skip non-mature coins
+                continue;
+            result.push_back(coin);
+        }
+        return result;
+    }
+
+    size_t Size() const {
+        return coins.size();
+    }
+
+private:
+    void Load(CWallet & wallet, interfaces::Chain::Lock & locked_chain, const CAmount & minStakeAmount)
+        EXCLUSIVE_LOCKS_REQUIRED(cs_main, wallet.cs_wallet)
+    {
+        coins.clear();
+        for (const auto & entry : wallet.mapWallet)
+            AddOutputs(wallet, locked_chain, entry.second, minStakeAmount);
+        minAmount = minStakeAmount;
+        loaded = true;
+    }
+
+    void AddOutputs(CWallet & wallet, interfaces::Chain::Lock & locked_chain, const CWalletTx & wtx)
+        EXCLUSIVE_LOCKS_REQUIRED(cs_main, wallet.cs_wallet)
+    {
+        AddOutputs(wallet, locked_chain, wtx, minAmount);
+    }
+
+    /** Replaces the coins of the tx with its unspent staking outputs. */
+    void AddOutputs(CWallet & wallet, interfaces::Chain::Lock & locked_chain, const CWalletTx & wtx, const CAmount & minStakeAmount)
+        EXCLUSIVE_LOCKS_REQUIRED(cs_main, wallet.cs_wallet)
+    {
+        const auto & hash = wtx.GetHash();
+        EraseOutputs(hash);
+        if (wtx.IsCoinBase() || wtx.hashUnset()) // can't stake coinbase or unconfirmed coins
+            return;
+        const CBlockIndex *pindex = LookupBlockIndex(wtx.hashBlock);
+        if (!pindex || !chainActive.Contains(pindex))
+            return;
+        for (unsigned int i = 0; i < wtx.tx->vout.size(); ++i) {
+            const auto & txout = wtx.tx->vout[i];
+            if (txout.nValue < minStakeAmount || txout.nValue <= 0)
+                continue;
+            if (!(wallet.IsMine(txout) & ISMINE_SPENDABLE)) // skip coin we don't have keys for
+                continue;
+            if (wallet.IsSpent(locked_chain, hash, i))
+                continue;
+            Coin coin;
+            coin.outpoint = COutPoint(hash, i);
+            coin.value = txout.nValue;
+            coin.txTime = wtx.GetTxTime();
+            coin.hashBlock = wtx.hashBlock;
+            coin.blockTime = pindex->GetBlockTime();
+            coin.blockHeight = pindex->nHeight;
+            coin.coinStake = wtx.IsCoinStake();
+            coins[coin.outpoint] = coin;
+        }
+    }
+
+    void EraseOutputs(const uint256 & hash) {
+        auto it = coins.lower_bound(COutPoint(hash, 0));
+        while (it != coins.end() && it->first.hash == hash)
+            it = coins.erase(it);
+    }
+
+private:
+    Mutex mu;
+    std::set<uint256> dirty GUARDED_BY(mu); // wallet txs that changed since the last sync
+    std::map<COutPoint, Coin> coins;
+    std::unique_ptr<boost::signals2::scoped_connection> conn;
+    const CBlockIndex *lastTip{nullptr};
+    CAmount minAmount{0};
+    bool loaded{false};
+};
+
 class StakeMgr {
 public:
     struct StakeCoin {
@@ -86,6 +476,7 @@ public:
         uint256 hashBlock;
         int64_t hashBlockTime;
         uint256 hashProofOfStake;
+        std::shared_ptr<const StakeSigningContext> signer; // null if the key wasn't prepared
         explicit StakeCoin() {
             SetNull();
         }
@@ -104,79 +495,52 @@ public:
             hashBlock.SetNull();
             hashBlockTime = 0;
             hashProofOfStake.SetNull();
+            signer = nullptr;
         }
     };
-    struct StakeOutput {
-        std::shared_ptr<COutput> out;
-        std::shared_ptr<CWallet> wallet;
-        explicit StakeOutput() : out(nullptr), wallet(nullptr) {}
-        explicit StakeOutput(std::shared_ptr<COutput> out, std::shared_ptr<CWallet> wallet) : out(out), wallet(wallet) {}
-        bool IsNull() {
-            return out == nullptr;
-        }
+    struct StakeSearchCoin {
+        COutPoint outpoint;
+        CAmount value;
+        uint256 hashBlock; // block the utxo was confirmed in
+        int64_t blockTime; // time of the block the utxo was confirmed in
+        uint32_t wallet; // index into the staker's wallet list
+        explicit StakeSearchCoin(const StakingCoinIndex::Coin & coin, uint32_t wallet)
+            : outpoint(coin.outpoint), value(coin.value), hashBlock(coin.hashBlock),
+              blockTime(coin.blockTime), wallet(wallet) {}
     };
 
 public:
+    explicit StakeMgr() {
+        const int threads = static_cast<int>(gArgs.GetArg("-stakingthreads", DEFAULT_STAKING_THREADS));
+        searchThreads = threads <= 0 ? GetNumCores() + threads : threads;
+        searchThreads = std::max(1, std::min(searchThreads, MAX_STAKING_THREADS));
+    }
+
     bool Update(std::vector<std::shared_ptr<CWallet>> & wallets, const CBlockIndex *tip, const Consensus::Params & params, const bool & skipPeerRequirement=false) {
         if (IsInitialBlockDownload())
             return false;
+        int64_t lockWaitMicros{0};
         {
+            const int64_t lockStart = GetTimeMicros();
             LOCK(cs_main);
+            lockWaitMicros += GetTimeMicros() - lockStart;
             if (!skipPeerRequirement && SyncProgress(chainActive.Height()) < 1.0 - std::numeric_limits<double>::epsilon())
                 return false; /// not ready to stake yet (need to be synced up with peers)
         }
         const int stakeSearchPeriodSeconds{MAX_FUTURE_BLOCK_TIME_POS};
         const bool notExpired = GetAdjustedTime() <= lastUpdateTime;
         const bool tipChanged = tip->nHeight != lastBlockHeight;
+        const bool coinsChanged = coinsDirty.exchange(false);
         const bool staleTip = tip->nTime <= lastUpdateTime || tip->nTime < GetAdjustedTime() - params.stakeMinAge*2; // TODO Blocknet testnet could stall chain?
-        if (notExpired && !tipChanged && staleTip)
-            return false; // do not process if not expired, tip hasn't changed, and tip time is stale
+        if (notExpired && !tipChanged && !coinsChanged && staleTip)
+            return false; // do not process if not expired, tip and coins haven't changed, and tip time is stale
 
-        {
-            LOCK(mu);
-            stakeTimes.clear();
-        }
+        const int64_t updateStartTime = GetTimeMicros();
+        if (tipChanged)
+            tipSeenTime = GetTimeMillis();
 
-        std::vector<StakeOutput> selected; // selected coins that meet criteria for staking
-        const int coinMaturity = params.coinMaturity;
         const auto minStakeAmount = static_cast<CAmount>(gArgs.GetArg("-minstakeamount", 0) * COIN);
 
-        for (const auto & pwallet : wallets) {
-            std::vector<COutput> coins; // all confirmed coins
-            {
-                auto locked_chain = pwallet->chain().lock();
-                LOCK2(cs_main, pwallet->cs_wallet);
-                if (pwallet->IsLocked()) {
-                    LogPrintf("Wallet is locked not staking inputs: %s", pwallet->GetDisplayName());
-                    continue; // skip locked wallets
-                }
-                pwallet->AvailableCoins(*locked_chain, coins, true, nullptr, minStakeAmount, MAX_MONEY, MAX_MONEY, 0);
-            }
-
-            { // Remove all immature coins (any previous stakes that do not meet the maturity requirement)
-                LOCK(cs_main);
-                CCoinsViewCache &view = *pcoinsTip;
-                auto pred = [&view,&coinMaturity](const COutput & c) -> bool {
-                    const auto & coin = view.AccessCoin(c.GetInputCoin().outpoint);
-                    return coin.IsCoinBase() && coin.nHeight < coinMaturity;
-                };
-                coins.erase(std::remove_if(coins.begin(), coins.end(), pred), coins.end());
-            }
-
-            // Find suitable staking coins
-            for (const COutput & out : coins) {
-                if (GetAdjustedTime() - out.tx->GetTxTime() < params.stakeMinAge) // skip coins that don't meet stake age
-                    continue;
-                if (out.tx->IsCoinBase()) // can't stake coinbase
-                    continue;
-                if (out.nDepth < coinMaturity) // skip non-mature coins
-                    continue;
-                if (!out.fSpendable) // skip coin we don't have keys for
-                    continue;
-                selected.emplace_back(std::make_shared<COutput>(out), pwallet);
-            }
-        }
-
         if (lastUpdateTime == 0) // Use chain tip last time on first call
             lastUpdateTime = tip->nTime;
 
@@ -185,77 +549,165 @@ public:
         arith_uint256 bnTargetPerCoinDay;
         bnTargetPerCoinDay.SetCompact(tip->nBits);
 
-        // Cache all possible stakes between last update and few seconds into the future
-        for (const auto & item : selected) {
-            const auto out = item.out;
-            boost::this_thread::interruption_point();
-            const auto & txInBlockHash = out->tx->hashBlock;
-            int hashBlockTime{0};
-            {
-                LOCK(cs_main);
-                const auto pindex = LookupBlockIndex(out->tx->hashBlock);
-                if (!pindex)
-                    continue; // skip txs with block that can't be found
-                hashBlockTime = pindex->GetBlockTime();
+        // Only the part of the window that hasn't been searched yet needs to be hashed. Hits
+        // from previous updates remain valid until the tip changes. A new tip changes the
+        // kernel (height and modifier) so the window is searched again starting no earlier
+        // than the new tip. The same applies to new coins (spent coins are dropped).
+        int64_t searchStartTime = lastUpdateTime + 1;
+        std::set<COutPoint> pending; // coins that already have a valid stake time
+        std::vector<uint32_t> walletIndices;
+        {
+            LOCK(mu);
+            if (tipChanged || coinsChanged) {
+                schedule.Clear();
+                searchStartTime = std::max<int64_t>(tip->nTime + 1, std::min<int64_t>(searchStartTime, currentTime));
+            } else {
+                for (const auto bucket : schedule.Buckets()) {
+                    for (int j = 0; j < bucket->count; ++j)
+                        pending.insert(bucket->items[j].outpoint);
+                }
             }
+            schedule.Prune(tip->nTime);
+            for (const auto & pwallet : wallets)
+                walletIndices.push_back(WalletIndex(pwallet));
+        }
 
-            if (IsProtocolV05(lastUpdateTime)) { // if v05 staking protocol modifier is dynamic (not in hash lookup)
-                int64_t i = lastUpdateTime + 1;
-                for (; i < endTime; ++i) {
-                    uint64_t stakeModifier{0};
-                    int stakeModifierHeight{0};
-                    int64_t stakeModifierTime{0};
-                    if (!GetKernelStakeModifier(tip, txInBlockHash, static_cast<const unsigned int>(i), stakeModifier, stakeModifierHeight, stakeModifierTime, false))
+        // Find suitable staking coins. The coin indices only look at the wallet txs that
+        // changed since the last update. The coins of all wallets are collected in one
+        // pass, cs_main is taken once if any of the indices has changes to apply.
+        std::vector<StakeSearchCoin> searchCoins;
+        std::set<uint32_t> lockedWallets;
+        uint64_t indexedCoins{0};
+        std::vector<StakingCoinIndex*> indices(wallets.size(), nullptr);
+        std::vector<std::set<uint256>> changes(wallets.size());
+        std::vector<bool> changed(wallets.size(), false);
+        bool anyChanged{false};
+        for (size_t w = 0; w < wallets.size(); ++w) {
+            const auto & pwallet = wallets[w];
+            if (pwallet->IsLocked()) {
+                LogPrintf("Wallet is locked not staking inputs: %s", pwallet->GetDisplayName());
+                lockedWallets.insert(walletIndices[w]);
+                continue; // skip locked wallets
+            }
+            indices[w] = &CoinIndex(walletIndices[w], pwallet);
+            changed[w] = indices[w]->TakeChanges(tip, minStakeAmount, changes[w]);
+            anyChanged = anyChanged || changed[w];
+        }
+        auto collectCoins = [&](interfaces::Chain::Lock *locked_chain) {
+            const int64_t adjustedTime = GetAdjustedTime();
+            for (size_t w = 0; w < wallets.size(); ++w) {
+                if (!indices[w])
+                    continue;
+                const auto & pwallet = wallets[w];
+                const int64_t lockStart = GetTimeMicros();
+                LOCK(pwallet->cs_wallet);
+                lockWaitMicros += GetTimeMicros() - lockStart;
+                if (locked_chain && changed[w])
+                    indices[w]->ApplyChanges(*pwallet, *locked_chain, tip, minStakeAmount, changes[w]);
+                indexedCoins += indices[w]->Size();
+                for (const auto & coin : indices[w]->StakeableCoins(tip, params, adjustedTime)) {
+                    if (pending.count(coin.outpoint))
+                        continue; // skip coins that already have a hit in this window
+                    if (pwallet->IsLockedCoin(coin.outpoint.hash, coin.outpoint.n))
                         continue;
+                    searchCoins.emplace_back(coin, walletIndices[w]);
+                }
+            }
+        };
+        if (anyChanged) {
+            const int64_t lockStart = GetTimeMicros();
+            auto locked_chain = wallets.front()->chain().lock();
+            LOCK(cs_main);
+            lockWaitMicros += GetTimeMicros() - lockStart;
+            collectCoins(locked_chain.get());
+        } else {
+            collectCoins(nullptr);
+        }
 
-                    CDataStream ss(SER_GETHASH, 0);
-                    ss << stakeModifier;
+        // Split the coins across the search threads. Each thread collects its own hits so
+        // that no locking is required until the results are merged below.
+        const int threads = std::max(1, std::min(searchThreads, static_cast<int>(searchCoins.size() / MIN_STAKING_COINS_PER_THREAD)));
+        const size_t chunk = (searchCoins.size() + threads - 1) / threads;
+        std::vector<std::vector<StakeSchedule::Candidate>> hits(threads);
+        std::vector<uint64_t> hashes(threads, 0);
+        auto search = [this,&searchCoins,&hits,&hashes,&chunk,tip,&params,searchStartTime,endTime,&bnTargetPerCoinDay](const int t) {
+            const size_t start = t * chunk;
+            const size_t end = std::min(start + chunk, searchCoins.size());
+            for (size_t j = start; j < end && !ShutdownRequested(); ++j)
+                hashes[t] += SearchCoin(searchCoins[j], tip, params, searchStartTime, endTime, bnTargetPerCoinDay, hits[t]);
+        };
+        if (threads > 1) {
+            std::vector<std::thread> workers;
+            workers.reserve(threads);
+            for (int t = 0; t < threads; ++t)
+                workers.emplace_back(search, t);
+            for (auto & worker : workers)
+                worker.join();
+        } else if (!searchCoins.empty()) {
+            search(0);
+        }
+        boost::this_thread::interruption_point();
 
-                    const auto hashProofOfStake = stakeHashV05(ss, hashBlockTime, tip->nHeight + 1, out->i, i);
-                    if (!stakeTargetHit(hashProofOfStake, out->GetInputCoin().txout.nValue, bnTargetPerCoinDay))
-                        continue;
-                    {
-                        LOCK(mu);
-                        stakeTimes[i].emplace_back(std::make_shared<CInputCoin>(out->GetInputCoin()), item.wallet, i,
-                                                   out->tx->hashBlock, hashBlockTime, hashProofOfStake);
-                        break;
-                    }
-                }
-            } else {
-                uint64_t stakeModifier = HasStakeModifier(txInBlockHash) ? GetStakeModifier(txInBlockHash) : 0;
-                int stakeModifierHeight{0};
-                int64_t stakeModifierTime{0};
-                const unsigned int stakeTime{0}; // this is not used here by v03 staking protocol (see GetKernelStakeModifierV03)
-                if (stakeModifier == 0 && !GetKernelStakeModifier(tip, txInBlockHash, stakeTime, stakeModifier, stakeModifierHeight, stakeModifierTime, false))
+        // Look up the keys of the new hits now so that a hit is signed without any
+        // wallet lookups once its stake time is reached.
+        std::map<COutPoint, std::shared_ptr<const StakeSigningContext>> newSigners;
+        for (const auto & threadHits : hits) {
+            for (const auto & hit : threadHits) {
+                const auto w = static_cast<size_t>(std::find(walletIndices.begin(), walletIndices.end(), hit.wallet) - walletIndices.begin());
+                if (w >= wallets.size())
                     continue;
+                auto signer = StakeSigner(*wallets[w], hit.outpoint);
+                if (signer)
+                    newSigners[hit.outpoint] = signer;
+            }
+        }
 
-                if (!HasStakeModifier(txInBlockHash)) {
-                    LOCK(mu);
-                    stakeModifiers[txInBlockHash] = stakeModifier;
-                }
-                CDataStream ss(SER_GETHASH, 0);
-                ss << stakeModifier;
-
-                int64_t i = lastUpdateTime + 1;
-                for (; i < endTime; ++i) {
-                    const auto hashProofOfStake = stakeHash(i, ss, out->i, out->tx->GetHash(), hashBlockTime);
-                    if (!stakeTargetHit(hashProofOfStake, out->GetInputCoin().txout.nValue, bnTargetPerCoinDay))
-                        continue;
-                    {
-                        LOCK(mu);
-                        stakeTimes[i].emplace_back(std::make_shared<CInputCoin>(out->GetInputCoin()), item.wallet, i,
-                                                   out->tx->hashBlock, hashBlockTime, hashProofOfStake);
-                        break;
-                    }
+        bool found{false};
+        {
+            LOCK(mu);
+            for (const auto & threadHits : hits) {
+                for (const auto & hit : threadHits)
+                    schedule.Add(hit);
+            }
+            found = !schedule.Empty();
+            // Only keep the keys of scheduled coins whose wallet is unlocked, a wallet
+            // may have been locked while the keys were prepared
+            for (uint32_t j = 0; j < stakeWallets.size(); ++j) {
+                const auto pwallet = stakeWallets[j].lock();
+                if (pwallet && pwallet->IsLocked())
+                    lockedWallets.insert(j);
+            }
+            std::set<COutPoint> scheduled;
+            for (const auto bucket : schedule.Buckets()) {
+                for (int j = 0; j < bucket->count; ++j) {
+                    if (!lockedWallets.count(bucket->items[j].wallet))
+                        scheduled.insert(bucket->items[j].outpoint);
                 }
             }
-
+            signers.insert(newSigners.begin(), newSigners.end());
+            for (auto it = signers.begin(); it != signers.end(); ) {
+                if (!scheduled.count(it->first))
+                    it = signers.erase(it);
+                else
+                    ++it;
+            }
         }
 
         lastBlockHeight = tip->nHeight;
         lastUpdateTime = endTime;
-        LogPrintf("Staker: %u\n", lastBlockHeight); // TODO Blocknet PoS move to debug category
-        return !stakeTimes.empty();
+        stats.lastSearchTime = GetTime();
+        stats.height = tip->nHeight;
+        stats.coins = indexedCoins;
+        stats.coinsSearched = searchCoins.size();
+        stats.searchWindow = std::max<int64_t>(0, endTime - searchStartTime);
+        stats.hashes = std::accumulate(hashes.begin(), hashes.end(), static_cast<uint64_t>(0));
+        stats.searchMicros = GetTimeMicros() - updateStartTime;
+        stats.lockWaitMicros = lockWaitMicros;
+        stats.threads = threads;
+        SetStakingStats(stats);
+        LogPrintf("Staker: %u searched %u coins over %d seconds in %.2fms (%d threads)\n", lastBlockHeight, // TODO Blocknet PoS move to debug category
+                stats.coinsSearched, stats.searchWindow, 0.001 * stats.searchMicros, threads);
+        return found;
     }
 
     bool TryStake(const CBlockIndex *tip, const CChainParams & chainparams) {
@@ -266,7 +718,10 @@ public:
         if (!NextStake(nextStakes, tip, chainparams))
             return false;
 
-        stakeTimes.clear(); // reset stake selections on success or error
+        {
+            LOCK(mu);
+            schedule.Clear(); // reset stake selections on success or error
+        }
         for (const auto & nextStake : nextStakes) {
             if (StakeBlock(nextStake, chainparams))
                 return true;
@@ -275,35 +730,40 @@ public:
     }
 
     bool NextStake(std::vector<StakeCoin> & nextStakes, const CBlockIndex *tip, const CChainParams & chainparams) {
-        LOCK(mu);
-        if (stakeTimes.empty())
-            return false;
-
         const auto cutoffTime = tip->nTime; // must find stake input valid for a time newer than cutoff
         arith_uint256 bnTargetPerCoinDay; // current difficulty
         bnTargetPerCoinDay.SetCompact(tip->nBits);
 
         // sort ascending
-        auto sortCoins = [](const StakeCoin & a, const StakeCoin & b) -> bool {
-            return a.coin->txout.nValue < b.coin->txout.nValue;
+        auto sortCoins = [](const StakeSchedule::Candidate & a, const StakeSchedule::Candidate & b) -> bool {
+            return a.value < b.value;
         };
 
-        for (const auto & item : stakeTimes) {
-            if (item.first <= cutoffTime) // skip if input stake time doesn't meet the cutoff time
-                continue;
+        std::vector<StakeSchedule::Candidate> candidates;
+        {
+            LOCK(mu);
+            for (const auto bucket : schedule.Buckets()) {
+                if (bucket->time <= cutoffTime) // skip if input stake time doesn't meet the cutoff time
+                    continue;
 
-            auto stakes = item.second;
-            std::sort(stakes.begin(), stakes.end(), sortCoins);
+                std::vector<StakeSchedule::Candidate> stakes(bucket->items.begin(), bucket->items.begin() + bucket->count);
+                std::sort(stakes.begin(), stakes.end(), sortCoins);
 
-            // Find the smallest stake input that meets the protocol requirements
-            for (const auto & stake : stakes) {
-                // Make sure stake still meets network requirements
-                if (!stakeTargetHit(stake.hashProofOfStake, stake.coin->txout.nValue, bnTargetPerCoinDay))
-                    continue;
-                nextStakes.push_back(stake);
+                // Find the smallest stake input that meets the protocol requirements
+                for (const auto & stake : stakes) {
+                    // Make sure stake still meets network requirements
+                    if (!stakeTargetHit(stake.hashProofOfStake, stake.value, bnTargetPerCoinDay))
+                        continue;
+                    candidates.push_back(stake);
+                }
             }
         }
 
+        for (const auto & candidate : candidates) {
+            StakeCoin stake;
+            if (GetStakeCoin(candidate, stake))
+                nextStakes.push_back(stake);
+        }
         return !nextStakes.empty();
     }
 
@@ -319,7 +779,7 @@ public:
         bool fNewBlock = false;
         try {
             auto pblocktemplate = BlockAssembler(chainparams).CreateNewBlockPoS(*stakeCoin.coin, stakeCoin.hashBlock,
-                    stakeCoin.time, stakeCoin.wallet.get());
+                    stakeCoin.time, stakeCoin.wallet.get(), false, stakeCoin.signer.get());
             if (!pblocktemplate)
                 return false;
             auto pblock = std::make_shared<const CBlock>(pblocktemplate->block);
@@ -327,6 +787,12 @@ public:
                 return false;
             LogPrintf("Stake found! %s %d %f\n", stakeCoin.coin->outpoint.hash.ToString(), stakeCoin.coin->outpoint.n,
                     (double)stakeCoin.coin->txout.nValue/(double)COIN);
+            if (fNewBlock) {
+                ++stats.stakes;
+                stats.lastStakeTime = GetTime();
+                stats.lastHitLatencyMillis = GetTimeMillis() - tipSeenTime;
+                SetStakingStats(stats);
+            }
         } catch (std::exception & e) {
             LogPrintf("Error: Staking %s\n", e.what());
         }
@@ -337,57 +803,323 @@ public:
         return lastUpdateTime;
     }
 
-    const StakeCoin & GetStake() {
-        if (!stakeTimes.empty())
-            return *stakeTimes.begin()->second.begin();
-        return std::move(StakeCoin{});
+    /** Notifies the staker that the coins of a staking wallet changed. */
+    void CoinsChanged() {
+        coinsDirty = true;
     }
 
-private:
-    bool HasStakeModifier(const uint256 & blockHash) {
+    /** Releases the prepared keys of the wallet's scheduled coins (the wallet was locked). */
+    void DropSigners(const uint32_t & walletIndex) {
         LOCK(mu);
-        return stakeModifiers.count(blockHash);
+        for (const auto bucket : schedule.Buckets()) {
+            for (int j = 0; j < bucket->count; ++j) {
+                if (bucket->items[j].wallet == walletIndex)
+                    signers.erase(bucket->items[j].outpoint);
+            }
+        }
     }
-    uint64_t GetStakeModifier(const uint256 & blockHash) {
-        LOCK(mu);
-        return stakeModifiers.count(blockHash) ? stakeModifiers[blockHash] : 0;
+
+    /** Returns the earliest stake in the schedule (null if there is none). */
+    StakeCoin GetStake() {
+        StakeSchedule::Candidate candidate;
+        {
+            LOCK(mu);
+            const auto buckets = schedule.Buckets();
+            if (buckets.empty())
+                return StakeCoin{};
+            candidate = buckets.front()->items.front();
+        }
+        StakeCoin stake;
+        GetStakeCoin(candidate, stake);
+        return stake;
+    }
+
+    /** Earliest stake time that is newer than the tip, 0 if there is none. Doesn't lock. */
+    int64_t NextStakeTime() const {
+        return schedule.NextTime();
+    }
+
+private:
+    /**
+     * Searches the stake times [startTime, endTime) for the first kernel of the coin that meets
+     * the current target. Found stakes are added to hits. Returns the number of hashes computed.
+     * Safe to call from multiple threads.
+     */
+    uint64_t SearchCoin(const StakeSearchCoin & item, const CBlockIndex *tip, const Consensus::Params & params,
+                    const int64_t startTime, const int64_t endTime, const arith_uint256 & bnTargetPerCoinDay,
+                    std::vector<StakeSchedule::Candidate> & hits)
+    {
+        const auto & txInBlockHash = item.hashBlock;
+        const auto hashBlockTime = static_cast<unsigned int>(item.blockTime);
+
+        if (IsProtocolV05(startTime)) { // if v05 staking protocol modifier is dynamic (not in hash lookup)
+            // The v05 modifier only depends on the tip, fetch it once using the first
+            // stake time that satisfies the stake min age of the coin.
+            const int64_t firstTime = std::max<int64_t>(startTime, item.blockTime + params.stakeMinAge + 1);
+            if (firstTime >= endTime)
+                return 0;
+            uint64_t stakeModifier{0};
+            int stakeModifierHeight{0};
+            int64_t stakeModifierTime{0};
+            if (!GetKernelStakeModifier(tip, txInBlockHash, static_cast<unsigned int>(firstTime), stakeModifier, stakeModifierHeight, stakeModifierTime, false))
+                return 0;
+
+            const auto hasher = StakeKernelHasher::V05(stakeModifier, hashBlockTime, tip->nHeight + 1, item.outpoint.n);
+            for (int64_t i = firstTime; i < endTime; ++i) {
+                const auto hashProofOfStake = hasher(static_cast<unsigned int>(i));
+                if (!stakeTargetHit(hashProofOfStake, item.value, bnTargetPerCoinDay))
+                    continue;
+                hits.push_back(StakeCandidate(item, i, hashProofOfStake));
+                return i - firstTime + 1;
+            }
+            return endTime - firstTime;
+        } else {
+            uint64_t stakeModifier{0};
+            int stakeModifierHeight{0};
+            int64_t stakeModifierTime{0};
+            const unsigned int stakeTime{0}; // this is not used here by v03 staking protocol (see GetKernelStakeModifierV03)
+            if (!GetKernelStakeModifier(tip, txInBlockHash, stakeTime, stakeModifier, stakeModifierHeight, stakeModifierTime, false))
+                return 0; // v03 modifiers are served from the stake modifier cache
+            const auto hasher = StakeKernelHasher::V03(stakeModifier, hashBlockTime, item.outpoint.n, item.outpoint.hash);
+            for (int64_t i = startTime; i < endTime; ++i) {
+                const auto hashProofOfStake = hasher(static_cast<unsigned int>(i));
+                if (!stakeTargetHit(hashProofOfStake, item.value, bnTargetPerCoinDay))
+                    continue;
+                hits.push_back(StakeCandidate(item, i, hashProofOfStake));
+                return i - startTime + 1;
+            }
+            return std::max<int64_t>(0, endTime - startTime);
+        }
+    }
+
+    static StakeSchedule::Candidate StakeCandidate(const StakeSearchCoin & item, const int64_t & time,
+                                                   const uint256 & hashProofOfStake)
+    {
+        StakeSchedule::Candidate candidate;
+        candidate.outpoint = item.outpoint;
+        candidate.value = item.value;
+        candidate.wallet = item.wallet;
+        candidate.time = time;
+        candidate.blockTime = static_cast<unsigned int>(item.blockTime);
+        candidate.hashProofOfStake = hashProofOfStake;
+        return candidate;
+    }
+
+    /** Looks up the wallet transaction of a stake candidate. */
+    bool GetStakeCoin(const StakeSchedule::Candidate & candidate, StakeCoin & stake) {
+        std::shared_ptr<CWallet> wallet;
+        std::shared_ptr<const StakeSigningContext> signer;
+        {
+            LOCK(mu);
+            if (candidate.wallet < stakeWallets.size())
+                wallet = stakeWallets[candidate.wallet].lock();
+            auto it = signers.find(candidate.outpoint);
+            if (it != signers.end())
+                signer = it->second;
+        }
+        if (!wallet)
+            return false; // wallet was unloaded
+        const CWalletTx *wtx = wallet->GetWalletTx(candidate.outpoint.hash);
+        if (!wtx || candidate.outpoint.n >= wtx->tx->vout.size())
+            return false;
+        stake = StakeCoin{std::make_shared<CInputCoin>(wtx->tx, candidate.outpoint.n), wallet, candidate.time,
+                          wtx->hashBlock, candidate.blockTime, candidate.hashProofOfStake};
+        stake.signer = signer;
+        return true;
+    }
+
+    /** Key and scripts of the wallet's staking coin, null if the key isn't available. */
+    static std::shared_ptr<const StakeSigningContext> StakeSigner(const CWallet & wallet, const COutPoint & outpoint) {
+        const CWalletTx *wtx = wallet.GetWalletTx(outpoint.hash);
+        if (!wtx || outpoint.n >= wtx->tx->vout.size())
+            return nullptr;
+        auto signer = std::make_shared<StakeSigningContext>();
+        if (!StakeSigningContext::Create(wtx->tx->vout[outpoint.n].scriptPubKey, wallet, *signer))
+            return nullptr;
+        return signer;
+    }
+
+    /** Index of the wallet in the staker's wallet list. Requires mu. */
+    uint32_t WalletIndex(const std::shared_ptr<CWallet> & wallet) EXCLUSIVE_LOCKS_REQUIRED(mu) {
+        for (uint32_t j = 0; j < stakeWallets.size(); ++j) {
+            if (stakeWallets[j].lock() == wallet)
+                return j;
+        }
+        stakeWallets.push_back(wallet);
+        return static_cast<uint32_t>(stakeWallets.size() - 1);
+    }
+
+    /** Coin index of the wallet, indices of unloaded wallets are released. */
+    StakingCoinIndex & CoinIndex(const uint32_t & walletIndex, const std::shared_ptr<CWallet> & wallet) {
+        {
+            LOCK(mu);
+            for (auto it = coinIndices.begin(); it != coinIndices.end(); ) {
+                if (it->first < stakeWallets.size() && stakeWallets[it->first].expired()) {
+                    lockConns.erase(it->first);
+                    it = coinIndices.erase(it);
+                } else
+                    ++it;
+            }
+        }
+        auto & index = coinIndices[walletIndex];
+        if (!index) {
+            index = MakeUnique<StakingCoinIndex>(wallet, [this]() { coinsDirty = true; });
+            // Don't keep decrypted keys in memory after the wallet is locked
+            lockConns[walletIndex] = MakeUnique<boost::signals2::scoped_connection>(wallet->NotifyStatusChanged.connect(
+                    [this,walletIndex](CCryptoKeyStore *keystore) {
+                        if (keystore->IsLocked())
+                            DropSigners(walletIndex);
+                    }));
+        }
+        return *index;
     }
 
 private:
     Mutex mu;
-    std::map<int64_t, std::vector<StakeCoin>> stakeTimes;
-    std::map<uint256, uint64_t> stakeModifiers;
+    StakeSchedule schedule GUARDED_BY(mu);
+    std::vector<std::weak_ptr<CWallet>> stakeWallets GUARDED_BY(mu);
+    std::map<COutPoint, std::shared_ptr<const StakeSigningContext>> signers GUARDED_BY(mu); // keys of the scheduled coins
+    std::map<uint32_t, std::unique_ptr<StakingCoinIndex>> coinIndices; // only used by the thread calling Update
+    std::map<uint32_t, std::unique_ptr<boost::signals2::scoped_connection>> lockConns; // only used by the thread calling Update
     std::atomic<int64_t> lastUpdateTime{0};
     std::atomic<int> lastBlockHeight{0};
+    std::atomic<bool> coinsDirty{false};
+    int searchThreads{1};
+    StakingStats stats; // only used by the thread calling Update and TryStake
+    int64_t tipSeenTime{0}; // time in millis that Update first saw the current tip
 };
 
 
+// Maximum number of seconds the staker sleeps when no events are received
+static const int STAKER_MAX_SLEEP_SECONDS = 30;
+
+/**
+ * Wakes up the staker when the chain tip changes or when the coins of a staking wallet
+ * change (transactions added, coins spent, wallet unlocked).
+ */
+class StakerEvents : public CValidationInterface {
+public:
+    void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) override {
+        Notify(false);
+    }
+
+    std::string GetSubscriberName() const override {
+        return "staker";
+    }
+
+    /** Subscribes to the coin notifications of wallets that aren't watched yet. */
+    void Watch(const std::vector<std::shared_ptr<CWallet>> & wallets) {
+        std::set<CWallet*> current;
+        for (const auto & pwallet : wallets) {
+            current.insert(pwallet.get());
+            auto it = connections.find(pwallet.get());
+            if (it != connections.end() && it->second.wallet.lock() == pwallet)
+                continue;
+            auto & watched = connections[pwallet.get()];
+            watched.wallet = pwallet;
+            watched.conns.clear();
+            watched.conns.emplace_back(MakeUnique<boost::signals2::scoped_connection>(pwallet->NotifyTransactionChanged.connect(
+                    [this](CWallet*, const uint256&, ChangeType) { Notify(true); })));
+            watched.conns.emplace_back(MakeUnique<boost::signals2::scoped_connection>(pwallet->NotifyStatusChanged.connect(
+                    [this](CCryptoKeyStore*) { Notify(true); })));
+            Notify(true); // search the coins of new wallets
+        }
+        for (auto it = connections.begin(); it != connections.end(); ) {
+            if (!current.count(it->first))
+                it = connections.erase(it); // wallet was unloaded
+            else
+                ++it;
+        }
+    }
+
+    /** Returns true if the coins of a wallet changed since the last call. */
+    bool CoinsChanged() {
+        return coinsChanged.exchange(false);
+    }
+
+    /**
+     * Sleeps until an event is received or the specified number of seconds passes.
+     * This is an interruption point.
+     */
+    void Wait(const int64_t & seconds) {
+        boost::unique_lock<boost::mutex> lock(mu);
+        if (!fEvent)
+            cv.wait_for(lock, boost::chrono::seconds(seconds));
+        fEvent = false;
+    }
+
+private:
+    void Notify(const bool & coins) {
+        if (coins)
+            coinsChanged = true;
+        {
+            boost::unique_lock<boost::mutex> lock(mu);
+            fEvent = true;
+        }
+        cv.notify_all();
+    }
+
+private:
+    boost::mutex mu;
+    boost::condition_variable cv;
+    bool fEvent{false};
+    std::atomic<bool> coinsChanged{false};
+    struct WatchedWallet {
+        std::weak_ptr<CWallet> wallet;
+        std::vector<std::unique_ptr<boost::signals2::scoped_connection>> conns;
+    };
+    std::map<CWallet*, WatchedWallet> connections; // only used by the staker thread
+};
+
 void static ThreadStakeMinter() {
     RenameThread("blocknet-staker");
     LogPrintf("Staker has started\n");
     StakeMgr staker;
+    static StakerEvents events; // must outlive validation callbacks that are still queued
+    RegisterValidationInterface(&events);
     while (!ShutdownRequested()) {
         const int sleepTimeSeconds{1};
-        if (IsInitialBlockDownload()) { // do not stake during initial download
-            boost::this_thread::sleep_for(boost::chrono::seconds(sleepTimeSeconds));
-            continue;
-        }
         try {
+            if (IsInitialBlockDownload()) { // do not stake during initial download
+                boost::this_thread::sleep_for(boost::chrono::seconds(sleepTimeSeconds));
+                continue;
+            }
             auto wallets = GetWallets();
+            events.Watch(wallets);
+            if (events.CoinsChanged())
+                staker.CoinsChanged();
             CBlockIndex *pindex = nullptr;
             {
                 LOCK(cs_main);
                 pindex = chainActive.Tip();
             }
+            // Keep the transactions of the next block selected, a stake hit then
+            // only has to add the coinstake and sign
+            if (pindex && !wallets.empty())
+                BlockAssembler(Params()).PrepareNextBlock();
             if (pindex && staker.Update(wallets, pindex, Params().GetConsensus())) {
                 boost::this_thread::interruption_point();
                 staker.TryStake(pindex, Params());
             }
+
+            // Sleep until the search window expires or the next stake is due, unless
+            // the tip or the staking coins change before then.
+            int64_t wakeTime = staker.LastUpdateTime() + 1;
+            const auto nextStakeTime = staker.NextStakeTime();
+            if (nextStakeTime > 0)
+                wakeTime = std::min(wakeTime, nextStakeTime);
+            const auto sleepTime = std::max<int64_t>(sleepTimeSeconds, std::min<int64_t>(wakeTime - GetAdjustedTime(), STAKER_MAX_SLEEP_SECONDS));
+            events.Wait(sleepTime);
+        } catch (const boost::thread_interrupted &) {
+            break;
         } catch (std::exception & e) {
             LogPrintf("Staker ran into an exception: %s\n", e.what());
-        } catch (...) { }
-        boost::this_thread::sleep_for(boost::chrono::seconds(sleepTimeSeconds));
+            boost::this_thread::sleep_for(boost::chrono::seconds(sleepTimeSeconds));
+        } catch (...) {
+            boost::this_thread::sleep_for(boost::chrono::seconds(sleepTimeSeconds));
+        }
     }
+    UnregisterValidationInterface(&events);
     LogPrintf("Staker shutdown\n");
 }
 
@@ -49,6 +49,11 @@ public:
             rmap.insert(make_pair(x.second, ret.first));
         }
     }
+    void clear()
+    {
+        map.clear();
+        rmap.clear();
+    }
     void erase(const key_type& k)
     {
         iterator itTarget = map.find(k);
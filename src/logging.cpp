@@ -6,6 +6,10 @@
 #include <logging.h>
 #include <util/time.h>
 
+#include <condition_variable>
+#include <memory>
+#include <thread>
+
 const char * const DEFAULT_DEBUGLOGFILE = "debug.log";
 
 BCLog::Logger& LogInstance()
@@ -208,13 +212,74 @@ std::string BCLog::Logger::LogTimestampStr(const std::string &str)
     return strStamped;
 }
 
-void BCLog::Logger::LogPrintStr(const std::string &str)
+/**
+ * Bounded multi-producer single-consumer ring of log lines. Each slot carries a sequence
+ * number telling whether it is free for the producer of a position or filled for the
+ * consumer, producers claim positions with a compare-and-swap.
+ */
+struct BCLog::Logger::AsyncWriter
 {
-    std::string strTimestamped = LogTimestampStr(str);
+    struct Slot {
+        std::atomic<size_t> seq;
+        std::string str;
+    };
+
+    std::unique_ptr<Slot[]> m_slots{new Slot[ASYNC_LOG_BUFFER_SIZE]};
+    std::atomic<size_t> m_enqueue_pos{0};
+    size_t m_dequeue_pos{0}; // only used by the writer thread
+    std::atomic<uint64_t> m_dropped{0};
+
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::atomic<bool> m_waiting{false};
+    std::atomic<bool> m_stop{false};
+    std::thread m_thread;
+
+    AsyncWriter() {
+        for (size_t i = 0; i < ASYNC_LOG_BUFFER_SIZE; ++i)
+            m_slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    bool Push(std::string&& str) {
+        size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &m_slots[pos & (ASYNC_LOG_BUFFER_SIZE - 1)];
+            const intptr_t diff = (intptr_t)slot->seq.load(std::memory_order_acquire) - (intptr_t)pos;
+            if (diff == 0) {
+                if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                ++m_dropped;
+                return false;
+            } else {
+                pos = m_enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        slot->str = std::move(str);
+        slot->seq.store(pos + 1, std::memory_order_release);
+        if (m_waiting.load(std::memory_order_relaxed))
+            m_cond.notify_one();
+        return true;
+    }
+
+    bool Pop(std::string& str) {
+        Slot& slot = m_slots[m_dequeue_pos & (ASYNC_LOG_BUFFER_SIZE - 1)];
+        if (slot.seq.load(std::memory_order_acquire) != m_dequeue_pos + 1)
+            return false;
+        str.swap(slot.str);
+        slot.str.clear();
+        slot.seq.store(m_dequeue_pos + ASYNC_LOG_BUFFER_SIZE, std::memory_order_release);
+        ++m_dequeue_pos;
+        return true;
+    }
+};
 
+void BCLog::Logger::WriteStr(const std::string& str)
+{
     if (m_print_to_console) {
         // print to console
-        fwrite(strTimestamped.data(), 1, strTimestamped.size(), stdout);
+        fwrite(str.data(), 1, str.size(), stdout);
         fflush(stdout);
     }
     if (m_print_to_file) {
@@ -222,7 +287,7 @@ void BCLog::Logger::LogPrintStr(const std::string &str)
 
         // buffer if we haven't opened the log yet
         if (m_fileout == nullptr) {
-            m_msgs_before_open.push_back(strTimestamped);
+            m_msgs_before_open.push_back(str);
         }
         else
         {
@@ -236,11 +301,70 @@ void BCLog::Logger::LogPrintStr(const std::string &str)
                     m_fileout = new_fileout;
                 }
             }
-            FileWriteStr(strTimestamped, m_fileout);
+            FileWriteStr(str, m_fileout);
         }
     }
 }
 
+void BCLog::Logger::LogPrintStr(const std::string &str)
+{
+    std::string strTimestamped = LogTimestampStr(str);
+
+    AsyncWriter* writer = m_async_writer.load(std::memory_order_acquire);
+    if (writer) {
+        writer->Push(std::move(strTimestamped));
+        return;
+    }
+    WriteStr(strTimestamped);
+}
+
+void BCLog::Logger::StartAsyncLogging()
+{
+    if (m_async_writer.load() || !Enabled())
+        return;
+    AsyncWriter* writer = new AsyncWriter;
+    writer->m_thread = std::thread([this, writer] {
+        // Lines are joined so that a batch goes out with a single write
+        static constexpr size_t MAX_BATCH_SIZE = 1 << 16;
+        std::string batch, str;
+        uint64_t reported_dropped = 0;
+        while (true) {
+            const bool stopping = writer->m_stop.load();
+            while (batch.size() < MAX_BATCH_SIZE && writer->Pop(str))
+                batch += str;
+            const uint64_t dropped = writer->m_dropped.load(std::memory_order_relaxed);
+            if (dropped != reported_dropped) {
+                batch += strprintf("%s Logging buffer full, %u messages dropped\n", FormatISO8601DateTime(GetTime()), dropped - reported_dropped);
+                reported_dropped = dropped;
+            }
+            if (!batch.empty()) {
+                WriteStr(batch);
+                batch.clear();
+                continue;
+            }
+            if (stopping)
+                break;
+            std::unique_lock<std::mutex> lock(writer->m_mutex);
+            writer->m_waiting = true;
+            writer->m_cond.wait_for(lock, std::chrono::milliseconds(100));
+            writer->m_waiting = false;
+        }
+    });
+    m_async_writer.store(writer, std::memory_order_release);
+}
+
+void BCLog::Logger::StopAsyncLogging()
+{
+    AsyncWriter* writer = m_async_writer.exchange(nullptr);
+    if (!writer)
+        return;
+    // Lines pushed by threads that still saw the writer are written before the thread exits
+    writer->m_stop = true;
+    writer->m_cond.notify_one();
+    writer->m_thread.join();
+    // The writer is leaked, a thread that loaded it before the exchange may still push to it
+}
+
 void BCLog::Logger::ShrinkDebugFile()
 {
     // Amount of debug.log to save at end when shrinking (must fit in memory)
@@ -19,6 +19,9 @@
 static const bool DEFAULT_LOGTIMEMICROS = false;
 static const bool DEFAULT_LOGIPS        = false;
 static const bool DEFAULT_LOGTIMESTAMPS = true;
+static const bool DEFAULT_ASYNCLOGGING  = false;
+/** Number of messages the asynchronous log writer buffers, must be a power of two */
+static const size_t ASYNC_LOG_BUFFER_SIZE = 1 << 14;
 extern const char * const DEFAULT_DEBUGLOGFILE;
 
 extern bool fLogIPs;
@@ -79,6 +82,13 @@ namespace BCLog {
 
         std::string LogTimestampStr(const std::string& str);
 
+        /** Buffer and writer thread of the asynchronous mode, leaked like the logger */
+        struct AsyncWriter;
+        std::atomic<AsyncWriter*> m_async_writer{nullptr};
+
+        /** Writes a line to the console and debug.log */
+        void WriteStr(const std::string& str);
+
     public:
         bool m_print_to_console = false;
         bool m_print_to_file = false;
@@ -98,6 +108,15 @@ namespace BCLog {
         bool OpenDebugLog();
         void ShrinkDebugFile();
 
+        /**
+         * Moves the writing of the log lines to a writer thread. Lines are passed through a
+         * bounded lock-free buffer of ASYNC_LOG_BUFFER_SIZE lines, lines that don't fit are
+         * dropped and their number is logged by the writer.
+         */
+        void StartAsyncLogging();
+        /** Writes the buffered lines and returns to writing on the calling threads */
+        void StopAsyncLogging();
+
         uint32_t GetCategoryMask() const { return m_categories.load(); }
 
         void EnableCategory(LogFlags flag);
@@ -0,0 +1,111 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <metrics.h>
+
+#include <httpserver.h>
+#include <rpc/protocol.h>
+#include <tinyformat.h>
+#include <util/time.h>
+
+namespace metrics {
+
+//! Head of the list of registered metrics, constant initialized so that metrics
+//! constructed during the static initialization of any translation unit can use it
+static std::atomic<const Metric*> g_metrics{nullptr};
+
+Metric::Metric(const char* name, const char* help, const char* type)
+    : m_name(name), m_help(help), m_type(type)
+{
+    m_next = g_metrics.load(std::memory_order_relaxed);
+    while (!g_metrics.compare_exchange_weak(m_next, this, std::memory_order_release, std::memory_order_relaxed)) {}
+}
+
+void Metric::Write(std::string& out) const
+{
+    out += strprintf("# HELP %s %s\n# TYPE %s %s\n", m_name, m_help, m_name, m_type);
+    WriteSamples(out);
+}
+
+void Counter::WriteSamples(std::string& out) const
+{
+    out += strprintf("%s %u\n", m_name, Get());
+}
+
+void CallbackGauge::WriteSamples(std::string& out) const
+{
+    out += strprintf("%s %.17g\n", m_name, m_value());
+}
+
+void Histogram::Observe(int64_t micros)
+{
+    size_t bucket = 0;
+    while (bucket < HISTOGRAM_BUCKETS - 1 && micros >= (int64_t{1} << bucket))
+        ++bucket;
+    m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    m_sum_micros.fetch_add(std::max<int64_t>(0, micros), std::memory_order_relaxed);
+}
+
+void Histogram::WriteSamples(std::string& out) const
+{
+    std::array<uint64_t, HISTOGRAM_BUCKETS> counts;
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i)
+        counts[i] = m_buckets[i].load(std::memory_order_relaxed);
+    WriteHistogramSamples(out, m_name, "", counts.data(), counts.size(), m_sum_micros.load(std::memory_order_relaxed));
+}
+
+ScopedTimer::ScopedTimer(Histogram& histogram) : m_histogram(histogram), m_start(GetTimeMicros())
+{
+}
+
+ScopedTimer::~ScopedTimer()
+{
+    m_histogram.Observe(GetTimeMicros() - m_start);
+}
+
+void WriteHistogramSamples(std::string& out, const char* name, const std::string& labels,
+                           const uint64_t* counts, size_t num_buckets, uint64_t sum_micros)
+{
+    const std::string sep = labels.empty() ? "" : ",";
+    uint64_t cumulative{0};
+    for (size_t i = 0; i < num_buckets; ++i) {
+        cumulative += counts[i];
+        out += strprintf("%s_bucket{%s%sle=\"%.6f\"} %u\n", name, labels, sep, (double)(int64_t{1} << i) / 1e6, cumulative);
+    }
+    out += strprintf("%s_bucket{%s%sle=\"+Inf\"} %u\n", name, labels, sep, cumulative);
+    const std::string braces = labels.empty() ? "" : "{" + labels + "}";
+    out += strprintf("%s_sum%s %.6f\n", name, braces, sum_micros / 1e6);
+    out += strprintf("%s_count%s %u\n", name, braces, cumulative);
+}
+
+std::string Render()
+{
+    std::string out;
+    for (const Metric* metric = g_metrics.load(std::memory_order_acquire); metric; metric = metric->m_next)
+        metric->Write(out);
+    return out;
+}
+
+} // namespace metrics
+
+static bool HTTPReq_Metrics(HTTPRequest* req, const std::string&)
+{
+    if (req->GetRequestMethod() != HTTPRequest::GET) {
+        req->WriteReply(HTTP_BAD_METHOD, "Only GET is supported\n");
+        return false;
+    }
+    req->WriteHeader("Content-Type", "text/plain; version=0.0.4");
+    req->WriteReply(HTTP_OK, metrics::Render());
+    return true;
+}
+
+void StartHTTPMetrics()
+{
+    RegisterHTTPHandler("/metrics", true, HTTPReq_Metrics);
+}
+
+void StopHTTPMetrics()
+{
+    UnregisterHTTPHandler("/metrics", true);
+}
@@ -0,0 +1,126 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_METRICS_H
+#define BITCOIN_METRICS_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+static const bool DEFAULT_METRICS_ENABLE = false;
+
+namespace metrics {
+
+//! Histogram buckets, bucket i counts the observations below 2^i microseconds
+static const size_t HISTOGRAM_BUCKETS = 28;
+
+/**
+ * A metric exposed on the /metrics endpoint in the Prometheus text format. Metrics are
+ * global objects which add themselves to a lock-free list when they are constructed and
+ * stay registered for the lifetime of the process, updates are relaxed atomic operations.
+ */
+class Metric
+{
+public:
+    Metric(const char* name, const char* help, const char* type);
+    virtual ~Metric() = default;
+
+    /** Appends the HELP and TYPE lines and the samples of the metric */
+    void Write(std::string& out) const;
+
+    const char* const m_name;
+    const char* const m_help;
+    const char* const m_type;
+    //! Next metric in the list of registered metrics, set before the metric is published
+    const Metric* m_next{nullptr};
+
+protected:
+    /** Appends the samples of the metric */
+    virtual void WriteSamples(std::string& out) const = 0;
+};
+
+/** Value that only goes up */
+class Counter final : public Metric
+{
+    std::atomic<uint64_t> m_value{0};
+
+    void WriteSamples(std::string& out) const override;
+
+public:
+    Counter(const char* name, const char* help) : Metric(name, help, "counter") {}
+
+    void Inc(uint64_t n = 1) { m_value.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t Get() const { return m_value.load(std::memory_order_relaxed); }
+};
+
+/** Value that is read from the node when the metrics are scraped */
+class CallbackGauge final : public Metric
+{
+    const std::function<double()> m_value;
+
+    void WriteSamples(std::string& out) const override;
+
+public:
+    CallbackGauge(const char* name, const char* help, std::function<double()> value)
+        : Metric(name, help, "gauge"), m_value(std::move(value)) {}
+};
+
+/** Labelled samples that are written by a function when the metrics are scraped */
+class CallbackFamily final : public Metric
+{
+    const std::function<void(std::string&)> m_write;
+
+    void WriteSamples(std::string& out) const override { m_write(out); }
+
+public:
+    CallbackFamily(const char* name, const char* help, const char* type, std::function<void(std::string&)> write)
+        : Metric(name, help, type), m_write(std::move(write)) {}
+};
+
+/** Distribution of durations in power of two microsecond buckets */
+class Histogram final : public Metric
+{
+    std::array<std::atomic<uint64_t>, HISTOGRAM_BUCKETS> m_buckets{};
+    std::atomic<uint64_t> m_sum_micros{0};
+
+    void WriteSamples(std::string& out) const override;
+
+public:
+    Histogram(const char* name, const char* help) : Metric(name, help, "histogram") {}
+
+    void Observe(int64_t micros);
+};
+
+/** Observes the lifetime of the timer in a histogram */
+class ScopedTimer
+{
+    Histogram& m_histogram;
+    const int64_t m_start;
+
+public:
+    explicit ScopedTimer(Histogram& histogram);
+    ~ScopedTimer();
+};
+
+/**
+ * Appends the samples of a histogram with power of two microsecond buckets, counts[i]
+ * are the observations below 2^i microseconds. labels are added to every sample.
+ */
+void WriteHistogramSamples(std::string& out, const char* name, const std::string& labels,
+                           const uint64_t* counts, size_t num_buckets, uint64_t sum_micros);
+
+/** Returns all registered metrics in the Prometheus text format */
+std::string Render();
+
+} // namespace metrics
+
+/** Registers the /metrics endpoint on the HTTP server */
+void StartHTTPMetrics();
+/** Unregisters the /metrics endpoint */
+void StopHTTPMetrics();
+
+#endif // BITCOIN_METRICS_H
@@ -181,9 +181,71 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     return std::move(pblocktemplate);
 }
 
+bool StakeSigningContext::Create(const CScript & stakeScript, const CKeyStore & keystore, StakeSigningContext & ctx)
+{
+    std::vector<std::vector<unsigned char>> vSolutions;
+    const txnouttype whichType = Solver(stakeScript, vSolutions);
+
+    CKeyID keyID;
+    if (whichType == TX_PUBKEYHASH) {
+        keyID = CKeyID(uint160(vSolutions[0]));
+    } else if (whichType == TX_PUBKEY) {
+        keyID = CPubKey(vSolutions[0]).GetID();
+    } else {
+        return false; // unsupported type
+    }
+
+    CKey key;
+    if (!keystore.GetKey(keyID, key))
+        return false;
+
+    ctx.key = key;
+    ctx.pubkey = key.GetPubKey();
+    ctx.stakeScript = stakeScript;
+    ctx.type = whichType;
+    return true;
+}
+
+CScript StakeSigningContext::PaymentScript(const bool p2pkh) const
+{
+    if (p2pkh)
+        return GetScriptForDestination(pubkey.GetID());
+    return CScript() << ToByteVector(pubkey) << OP_CHECKSIG;
+}
+
+void StakeSigningContext::SetDummySignature(CMutableTransaction & tx, const unsigned int nIn) const
+{
+    // 71 byte low-r signature plus the sighash byte, the same size as the real one
+    const std::vector<unsigned char> dummySig(72, '\000');
+    if (type == TX_PUBKEY)
+        tx.vin[nIn].scriptSig = CScript() << dummySig;
+    else
+        tx.vin[nIn].scriptSig = CScript() << dummySig << ToByteVector(pubkey);
+}
+
+bool StakeSigningContext::SignInput(CMutableTransaction & tx, const unsigned int nIn, const CAmount & amount) const
+{
+    const uint256 hash = SignatureHash(stakeScript, tx, nIn, SIGHASH_ALL, amount, SigVersion::BASE);
+    std::vector<unsigned char> sig;
+    if (!key.Sign(hash, sig))
+        return false;
+    sig.push_back(static_cast<unsigned char>(SIGHASH_ALL));
+    if (type == TX_PUBKEY)
+        tx.vin[nIn].scriptSig = CScript() << sig;
+    else
+        tx.vin[nIn].scriptSig = CScript() << sig << ToByteVector(pubkey);
+    return true;
+}
+
+bool StakeSigningContext::SignBlock(CBlock & block) const
+{
+    return key.Sign(block.GetHash(), block.vchBlockSig);
+}
+
 std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlockPoS(const CInputCoin & stakeInput, const uint256 & stakeBlockHash,
                                                                   const int64_t & stakeTime, CWallet *keystore,
-                                                                  const bool & disableValidationChecks)
+                                                                  const bool & disableValidationChecks,
+                                                                  const StakeSigningContext *signer)
 {
     int64_t nTimeStart = GetTimeMicros();
 
@@ -200,7 +262,6 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlockPoS(const CInputCo
     pblocktemplate->vTxSigOpsCost.push_back(-1); // updated at end
 
     CBlockIndex* pindexPrev = nullptr;
-    int64_t nMedianTimePast;
     int nPackagesSelected = 0;
     int nDescendantsUpdated = 0;
 
@@ -208,33 +269,10 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlockPoS(const CInputCo
         LOCK2(cs_main, mempool.cs);
         pindexPrev = chainActive.Tip();
         assert(pindexPrev != nullptr);
-        nHeight = pindexPrev->nHeight + 1;
-
-        pblock->nVersion = ComputeBlockVersion(pindexPrev, chainparams.GetConsensus());
-        // -regtest only: allow overriding block.nVersion with
-        // -blockversion=N to test forking scenarios
-        if (chainparams.MineBlocksOnDemand())
-            pblock->nVersion = gArgs.GetArg("-blockversion", pblock->nVersion);
-
-        pblock->nTime = GetAdjustedTime();
-        nMedianTimePast = pindexPrev->GetMedianTimePast();
-
-        nLockTimeCutoff = (STANDARD_LOCKTIME_VERIFY_FLAGS & LOCKTIME_MEDIAN_TIME_PAST)
-                           ? nMedianTimePast
-                           : pblock->GetBlockTime();
-
-        // Decide whether to include witness transactions
-        // This is only needed in case the witness softfork activation is reverted
-        // (which would require a very deep reorganization).
-        // Note that the mempool would accept transactions with witness data before
-        // IsWitnessEnabled, but we would only ever mine blocks after IsWitnessEnabled
-        // unless there is a massive block reorganization with the witness softfork
-        // not activated.
-        // TODO: replace this with a call to main to assess validity of a mempool
-        // transaction (which in most cases can be a no-op).
-        fIncludeWitness = IsWitnessEnabled(pindexPrev, chainparams.GetConsensus());
-
-        addPackageTxs(nPackagesSelected, nDescendantsUpdated);
+        SetChainContext(pindexPrev);
+
+        // Usually selected ahead of time by PrepareNextBlock()
+        addPackageTxsCached(nPackagesSelected, nDescendantsUpdated);
     }
 
     int64_t nTime1 = GetTimeMicros();
@@ -277,45 +315,28 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlockPoS(const CInputCo
             (gov::Governance::isSuperblock(nHeight, chainparams.GetConsensus()) ? chainparams.GetConsensus().proposalMaxAmount : 0);
     const auto stakeAmount = (feesEnabled ? nFees : 0) + stakeSubsidy;
 
-    // Find pubkey of stake input
-    CTxDestination stakeInputDest;
-    if (!ExtractDestination(stakeInput.txout.scriptPubKey, stakeInputDest))
-        throw std::runtime_error(strprintf("%s: Failed to determine staked input address", __func__));
-    const auto keyid = GetKeyForDestination(*keystore, stakeInputDest);
-    if (keyid.IsNull())
-        throw std::runtime_error(strprintf("%s: Failed to obtain pubkey from the staked input", __func__));
-
-    CScript paymentScript;
-    if (VersionBitsState(pindexPrev, chainparams.GetConsensus(), Consensus::DEPLOYMENT_STAKEP2PKH, versionbitscache) == ThresholdState::ACTIVE) { // Stake to p2pkh
-        paymentScript = GetScriptForDestination(keyid);
-    } else { // stake to p2pk
-        CPubKey paymentPubKey;
-        if (!keystore->GetPubKey(keyid, paymentPubKey))
-            throw std::runtime_error(strprintf("%s: Failed to find staked input pubkey", __func__));
-        paymentScript = CScript() << ToByteVector(paymentPubKey) << OP_CHECKSIG;
+    // Key and scripts of the stake input, usually prepared by the staker ahead of the hit
+    StakeSigningContext stakeSigner;
+    if (!signer) {
+        if (!StakeSigningContext::Create(stakeInput.txout.scriptPubKey, *keystore, stakeSigner))
+            throw std::runtime_error(strprintf("%s: Failed to obtain the key of the staked input", __func__));
+        signer = &stakeSigner;
     }
+    const bool stakeToP2pkh = VersionBitsState(pindexPrev, chainparams.GetConsensus(), Consensus::DEPLOYMENT_STAKEP2PKH, versionbitscache) == ThresholdState::ACTIVE;
+    const CScript paymentScript = signer->PaymentScript(stakeToP2pkh);
 
     // stake amount and payment script
     coinstakeTx.vout[1] = CTxOut(stakeInput.txout.nValue + stakeAmount, paymentScript); // staker payment
 
-    // Sign stake input w/ keystore
-    auto signInput = [](CMutableTransaction & tx, CWallet *keystore) {
-        SignatureData empty; // clean script sig on all inputs
-        for (auto & txin : tx.vin)
-            UpdateInput(txin, empty);
-        auto locked_chain = keystore->chain().lock();
-        LOCK(keystore->cs_wallet);
-        if (!keystore->SignTransaction(tx))
-            throw std::runtime_error(strprintf("%s: Failed to sign the staked input", __func__));
-    };
-
-    // Calculate network fee for coinbase/coinstake txs
-    signInput(coinstakeTx, keystore); // add signature
+    // Calculate network fee for coinbase/coinstake txs, the coinstake is measured with a
+    // maximum size signature so that it's only signed once
+    signer->SetDummySignature(coinstakeTx, 0);
     const auto coinbaseBytes = ::GetSerializeSize(coinbaseTx, PROTOCOL_VERSION);
     const auto coinstakeBytes = ::GetSerializeSize(coinstakeTx, PROTOCOL_VERSION);
     CAmount estimatedNetworkFee = static_cast<CAmount>(::minRelayTxFee.GetFee(coinbaseBytes) + ::minRelayTxFee.GetFee(coinstakeBytes));
     coinstakeTx.vout[1] = CTxOut(stakeInput.txout.nValue + stakeAmount - estimatedNetworkFee, paymentScript); // staker payment w/ network fee taken out
-    signInput(coinstakeTx, keystore); // resign with correct fee estimation
+    if (!signer->SignInput(coinstakeTx, 0, stakeInput.txout.nValue))
+        throw std::runtime_error(strprintf("%s: Failed to sign the staked input", __func__));
 
     // Assign coinstake tx
     pblock->vtx[1] = MakeTransactionRef(std::move(coinstakeTx));
@@ -339,7 +360,7 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlockPoS(const CInputCo
     pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
     pblocktemplate->vTxSigOpsCost[0] = WITNESS_SCALE_FACTOR * GetLegacySigOpCount(*pblock->vtx[0]);
 
-    SignBlock(*pblock, stakeInput.txout.scriptPubKey, *keystore); // required to pass PoS checks
+    signer->SignBlock(*pblock); // required to pass PoS checks
 
     if (!disableValidationChecks) {
         LOCK(cs_main);
@@ -356,6 +377,116 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlockPoS(const CInputCo
     return std::move(pblocktemplate);
 }
 
+void BlockAssembler::SetChainContext(const CBlockIndex* pindexPrev)
+{
+    nHeight = pindexPrev->nHeight + 1;
+
+    pblock->nVersion = ComputeBlockVersion(pindexPrev, chainparams.GetConsensus());
+    // -regtest only: allow overriding block.nVersion with
+    // -blockversion=N to test forking scenarios
+    if (chainparams.MineBlocksOnDemand())
+        pblock->nVersion = gArgs.GetArg("-blockversion", pblock->nVersion);
+
+    pblock->nTime = GetAdjustedTime();
+
+    nLockTimeCutoff = (STANDARD_LOCKTIME_VERIFY_FLAGS & LOCKTIME_MEDIAN_TIME_PAST)
+                       ? pindexPrev->GetMedianTimePast()
+                       : pblock->GetBlockTime();
+
+    // Decide whether to include witness transactions
+    // This is only needed in case the witness softfork activation is reverted
+    // (which would require a very deep reorganization).
+    // Note that the mempool would accept transactions with witness data before
+    // IsWitnessEnabled, but we would only ever mine blocks after IsWitnessEnabled
+    // unless there is a massive block reorganization with the witness softfork
+    // not activated.
+    // TODO: replace this with a call to main to assess validity of a mempool
+    // transaction (which in most cases can be a no-op).
+    fIncludeWitness = IsWitnessEnabled(pindexPrev, chainparams.GetConsensus());
+}
+
+namespace {
+/** Mempool transactions selected for the next block on top of hashPrevBlock */
+struct NextBlockPackages {
+    uint256 hashPrevBlock;
+    unsigned int nMempoolUpdated;
+    unsigned int nBlockMaxWeight;
+    CFeeRate blockMinFeeRate;
+    bool fIncludeWitness;
+
+    std::vector<CTransactionRef> vtx;
+    std::vector<CAmount> vTxFees;
+    std::vector<int64_t> vTxSigOpsCost;
+    uint64_t nBlockWeight;
+    uint64_t nBlockTx;
+    uint64_t nBlockSigOpsCost;
+    CAmount nFees;
+};
+
+Mutex g_next_block_mutex;
+std::unique_ptr<const NextBlockPackages> g_next_block GUARDED_BY(g_next_block_mutex);
+} // namespace
+
+void BlockAssembler::addPackageTxsCached(int &nPackagesSelected, int &nDescendantsUpdated)
+{
+    const uint256 hashPrevBlock = chainActive.Tip()->GetBlockHash();
+    const unsigned int nMempoolUpdated = mempool.GetTransactionsUpdated();
+
+    LOCK(g_next_block_mutex);
+    const NextBlockPackages* next = g_next_block.get();
+    if (next && next->hashPrevBlock == hashPrevBlock && next->nMempoolUpdated == nMempoolUpdated &&
+        next->nBlockMaxWeight == nBlockMaxWeight && next->blockMinFeeRate == blockMinFeeRate &&
+        next->fIncludeWitness == fIncludeWitness)
+    {
+        pblock->vtx.insert(pblock->vtx.end(), next->vtx.begin(), next->vtx.end());
+        pblocktemplate->vTxFees.insert(pblocktemplate->vTxFees.end(), next->vTxFees.begin(), next->vTxFees.end());
+        pblocktemplate->vTxSigOpsCost.insert(pblocktemplate->vTxSigOpsCost.end(), next->vTxSigOpsCost.begin(), next->vTxSigOpsCost.end());
+        nBlockWeight = next->nBlockWeight;
+        nBlockTx = next->nBlockTx;
+        nBlockSigOpsCost = next->nBlockSigOpsCost;
+        nFees = next->nFees;
+        return;
+    }
+
+    const size_t nTxOffset = pblock->vtx.size();
+    const size_t nFeesOffset = pblocktemplate->vTxFees.size();
+    const size_t nSigOpsOffset = pblocktemplate->vTxSigOpsCost.size();
+    addPackageTxs(nPackagesSelected, nDescendantsUpdated);
+
+    auto packages = MakeUnique<NextBlockPackages>();
+    packages->hashPrevBlock = hashPrevBlock;
+    packages->nMempoolUpdated = nMempoolUpdated;
+    packages->nBlockMaxWeight = nBlockMaxWeight;
+    packages->blockMinFeeRate = blockMinFeeRate;
+    packages->fIncludeWitness = fIncludeWitness;
+    packages->vtx.assign(pblock->vtx.begin() + nTxOffset, pblock->vtx.end());
+    packages->vTxFees.assign(pblocktemplate->vTxFees.begin() + nFeesOffset, pblocktemplate->vTxFees.end());
+    packages->vTxSigOpsCost.assign(pblocktemplate->vTxSigOpsCost.begin() + nSigOpsOffset, pblocktemplate->vTxSigOpsCost.end());
+    packages->nBlockWeight = nBlockWeight;
+    packages->nBlockTx = nBlockTx;
+    packages->nBlockSigOpsCost = nBlockSigOpsCost;
+    packages->nFees = nFees;
+    g_next_block = std::move(packages);
+}
+
+void BlockAssembler::PrepareNextBlock()
+{
+    resetBlock();
+
+    pblocktemplate.reset(new CBlockTemplate());
+    pblock = &pblocktemplate->block;
+
+    LOCK2(cs_main, mempool.cs);
+    const CBlockIndex* pindexPrev = chainActive.Tip();
+    if (!pindexPrev)
+        return;
+    SetChainContext(pindexPrev);
+
+    int nPackagesSelected = 0;
+    int nDescendantsUpdated = 0;
+    addPackageTxsCached(nPackagesSelected, nDescendantsUpdated);
+}
+
 void BlockAssembler::onlyUnconfirmed(CTxMemPool::setEntries& testSet)
 {
     for (CTxMemPool::setEntries::iterator iit = testSet.begin(); iit != testSet.end(); ) {
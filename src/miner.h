@@ -34,6 +34,31 @@ struct CBlockTemplate
     std::vector<unsigned char> vchCoinbaseCommitment;
 };
 
+/**
+ * Key and scripts of a staked utxo, looked up ahead of a stake hit so that the coinstake
+ * and the block are signed without going through the wallet. Only p2pk and p2pkh stake
+ * inputs are supported, the same as for block signatures.
+ */
+struct StakeSigningContext
+{
+    CKey key;
+    CPubKey pubkey;
+    CScript stakeScript; //!< scriptPubKey of the staked utxo
+    txnouttype type{TX_NONSTANDARD};
+
+    /** Looks up the key of the stake script in the keystore */
+    static bool Create(const CScript & stakeScript, const CKeyStore & keystore, StakeSigningContext & ctx);
+
+    /** Stake payment to the staker, p2pkh or p2pk */
+    CScript PaymentScript(bool p2pkh) const;
+
+    /** Sets the scriptSig of the stake input with a maximum size signature, used for size estimation */
+    void SetDummySignature(CMutableTransaction & tx, unsigned int nIn) const;
+
+    bool SignInput(CMutableTransaction & tx, unsigned int nIn, const CAmount & amount) const;
+    bool SignBlock(CBlock & block) const;
+};
+
 // Container for tracking updates to ancestor feerate as we include (parent)
 // transactions in a block
 struct CTxMemPoolModifiedEntry {
@@ -164,7 +189,12 @@ public:
     /** Construct new PoS block */
     std::unique_ptr<CBlockTemplate> CreateNewBlockPoS(const CInputCoin & stakeInput, const uint256 & stakeBlockHash,
                                                       const int64_t & stakeTime, CWallet *keystore,
-                                                      const bool & disableValidationChecks = false);
+                                                      const bool & disableValidationChecks = false,
+                                                      const StakeSigningContext *signer = nullptr);
+
+    /** Select the mempool transactions of the next block ahead of time. The selection is
+      * reused by CreateNewBlockPoS until the tip or the mempool change. */
+    void PrepareNextBlock();
 
     static Optional<int64_t> m_last_block_num_txs;
     static Optional<int64_t> m_last_block_weight;
@@ -181,6 +211,11 @@ private:
       * Increments nPackagesSelected / nDescendantsUpdated with corresponding
       * statistics from the package selection (for logging statistics). */
     void addPackageTxs(int &nPackagesSelected, int &nDescendantsUpdated) EXCLUSIVE_LOCKS_REQUIRED(mempool.cs);
+    /** addPackageTxs() that reuses the selection of the previous call made on the same
+      * tip and mempool state */
+    void addPackageTxsCached(int &nPackagesSelected, int &nDescendantsUpdated) EXCLUSIVE_LOCKS_REQUIRED(cs_main, mempool.cs);
+    /** Set the chain context of the block on top of pindexPrev */
+    void SetChainContext(const CBlockIndex* pindexPrev) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     // helper functions for addPackageTxs()
     /** Remove confirmed (inBlock) entries from given set */
@@ -31,6 +31,14 @@
 #include <poll.h>
 #endif
 
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#endif
+
+#ifdef USE_KQUEUE
+#include <sys/event.h>
+#endif
+
 #ifdef USE_UPNP
 #include <miniupnpc/miniupnpc.h>
 #include <miniupnpc/miniwget.h>
@@ -70,6 +78,9 @@ enum BindFlags {
 // The sleep time needs to be small to avoid new sockets stalling
 static const uint64_t SELECT_TIMEOUT_MILLISECONDS = 50;
 
+// Bytes read from a socket per recv(), typical socket buffer is 8K-64K
+static const int SOCKET_RECV_CHUNK_SIZE = 0x10000;
+
 const std::string NET_MESSAGE_COMMAND_OTHER = "*other*";
 
 static const uint64_t RANDOMIZER_ID_NETGROUP = 0x6c0edd8036ef4036ULL; // SHA256("netgroup")[0:8]
@@ -632,6 +643,80 @@ int CNode::GetSendVersion() const
 }
 
 
+CNetMsgStats::CNetMsgStats()
+{
+    for (const std::string& msg : getAllNetMessageTypes())
+        m_entries[msg];
+    m_entries[NET_MESSAGE_COMMAND_OTHER];
+}
+
+void CNetMsgStats::Timing::Record(int64_t micros)
+{
+    const uint64_t nMicros = std::max<int64_t>(micros, 0);
+    size_t bucket = 0;
+    for (uint64_t bound = 10; bucket + 1 < TIME_BUCKETS && nMicros >= bound; bound *= 10)
+        bucket++;
+    buckets[bucket]++;
+    count++;
+    total_micros += nMicros;
+    uint64_t nMax = max_micros;
+    while (nMicros > nMax && !max_micros.compare_exchange_weak(nMax, nMicros)) {}
+}
+
+CNetMsgStats::Entry& CNetMsgStats::Get(const std::string& command)
+{
+    auto it = m_entries.find(command);
+    if (it == m_entries.end())
+        it = m_entries.find(NET_MESSAGE_COMMAND_OTHER);
+    return it->second;
+}
+
+void CNetMsgStats::RecordRecv(const std::string& command, size_t bytes)
+{
+    Entry& entry = Get(command);
+    entry.msgs_recv++;
+    entry.bytes_recv += bytes;
+}
+
+void CNetMsgStats::RecordSent(const std::string& command, size_t bytes)
+{
+    Entry& entry = Get(command);
+    entry.msgs_sent++;
+    entry.bytes_sent += bytes;
+}
+
+void CNetMsgStats::RecordHandlerTime(const std::string& command, int64_t micros)
+{
+    Get(command).handler.Record(micros);
+}
+
+void CNetMsgStats::RecordWorkerTime(const std::string& command, int64_t micros)
+{
+    Get(command).worker.Record(micros);
+}
+
+CNetPayload::CNetPayload(std::vector<unsigned char> bytes)
+{
+    auto owner = std::make_shared<const std::vector<unsigned char>>(std::move(bytes));
+    m_data = owner->data();
+    m_size = owner->size();
+    m_owner = std::move(owner);
+}
+
+CNetPayload CNetPayload::FromStream(CDataStream& stream)
+{
+    const uint64_t nSize = ReadCompactSize(stream);
+    if (nSize > stream.size())
+        throw std::ios_base::failure("CDataStream::read(): end of data");
+
+    CNetPayload payload;
+    auto owner = std::make_shared<const CDataStream>(std::move(stream));
+    payload.m_data = reinterpret_cast<const unsigned char*>(owner->data());
+    payload.m_size = nSize;
+    payload.m_owner = std::move(owner);
+    return payload;
+}
+
 int CNetMessage::readHeader(const char *pch, unsigned int nBytes)
 {
     // copy data to temporary parsing buffer
@@ -817,6 +902,8 @@ bool CConnman::AttemptToEvictConnection()
                 continue;
             if (node->fDisconnect)
                 continue;
+            if (node->fXRouter) // XRouter peers have connections of their own
+                continue;
             LOCK(node->cs_filter);
             NodeEvictionCandidate candidate = {node->GetId(), node->nTimeConnected, node->nMinPingUsecTime,
                                                node->nLastBlockTime, node->nLastTXTime,
@@ -906,7 +993,7 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
     {
         LOCK(cs_vNodes);
         for (const CNode* pnode : vNodes) {
-            if (pnode->fInbound) nInbound++;
+            if (pnode->fInbound && !pnode->fXRouter) nInbound++;
         }
     }
 
@@ -968,6 +1055,7 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
 
     LogPrint(BCLog::NET, "connection from %s accepted\n", addr.ToString());
 
+    AddNodeSocketEvents(pnode);
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
@@ -1080,6 +1168,12 @@ void CConnman::InactivityCheck(CNode *pnode)
             LogPrint(BCLog::NET, "version handshake timeout from %d\n", pnode->GetId());
             pnode->fDisconnect = true;
         }
+        else if (pnode->fXRouter && nTime - std::max(pnode->nTimeConnected, pnode->nLastXRouter.load()) > m_xrouter_idle_timeout)
+        {
+            LogPrint(BCLog::NET, "xrouter connection idle for %is, disconnecting peer=%d\n",
+                     nTime - std::max(pnode->nTimeConnected, pnode->nLastXRouter.load()), pnode->GetId());
+            pnode->fDisconnect = true;
+        }
     }
 }
 
@@ -1247,8 +1341,250 @@ void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_s
 }
 #endif
 
+void CConnman::AddNodeSocketEvents(CNode *pnode)
+{
+#if defined(USE_EPOLL) || defined(USE_KQUEUE)
+    if (m_event_fd == -1)
+        return;
+    LOCK(pnode->cs_hSocket);
+    if (pnode->hSocket != INVALID_SOCKET && !AddSocketEvents(pnode->hSocket, pnode, true)) {
+        LogPrintf("socket event registration error %s, dropping peer=%d\n", NetworkErrorString(WSAGetLastError()), pnode->GetId());
+        pnode->fDisconnect = true;
+    }
+#endif
+}
+
+#if defined(USE_EPOLL) || defined(USE_KQUEUE)
+bool CConnman::AddSocketEvents(SOCKET hSocket, void *data, bool edge_triggered)
+{
+    // Sockets are removed from the event queue by the kernel when they are closed
+#ifdef USE_EPOLL
+    struct epoll_event event;
+    event.events = edge_triggered ? (EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET) : EPOLLIN;
+    event.data.ptr = data;
+    return epoll_ctl(m_event_fd, EPOLL_CTL_ADD, hSocket, &event) == 0;
+#else
+    struct kevent events[2];
+    const unsigned short flags = edge_triggered ? (EV_ADD | EV_CLEAR) : EV_ADD;
+    EV_SET(&events[0], hSocket, EVFILT_READ, flags, 0, 0, data);
+    EV_SET(&events[1], hSocket, EVFILT_WRITE, flags, 0, 0, data);
+    return kevent(m_event_fd, events, edge_triggered ? 2 : 1, nullptr, 0, nullptr) == 0;
+#endif
+}
+
+void CConnman::WaitSocketEvents(int timeout_ms, std::vector<const ListenSocket*>& listen_ready)
+{
+    static const int MAX_SOCKET_EVENTS = 256;
+#ifdef USE_EPOLL
+    struct epoll_event events[MAX_SOCKET_EVENTS];
+    int nEvents = epoll_wait(m_event_fd, events, MAX_SOCKET_EVENTS, timeout_ms);
+#else
+    struct kevent events[MAX_SOCKET_EVENTS];
+    struct timespec timeout;
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_nsec = (timeout_ms % 1000) * 1000000;
+    int nEvents = kevent(m_event_fd, nullptr, 0, events, MAX_SOCKET_EVENTS, &timeout);
+#endif
+
+    if (interruptNet)
+        return;
+
+    if (nEvents < 0) {
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEINTR) {
+            LogPrintf("socket event wait error %s\n", NetworkErrorString(nErr));
+            interruptNet.sleep_for(std::chrono::milliseconds(SELECT_TIMEOUT_MILLISECONDS));
+        }
+        return;
+    }
+
+    for (int i = 0; i < nEvents; i++) {
+#ifdef USE_EPOLL
+        const void *data = events[i].data.ptr;
+        const bool readable = events[i].events & (EPOLLIN | EPOLLRDHUP);
+        const bool writable = events[i].events & EPOLLOUT;
+        const bool error = events[i].events & (EPOLLERR | EPOLLHUP);
+#else
+        const void *data = events[i].udata;
+        const bool readable = events[i].filter == EVFILT_READ;
+        const bool writable = events[i].filter == EVFILT_WRITE;
+        const bool error = events[i].flags & EV_ERROR;
+#endif
+        bool listen = false;
+        for (const ListenSocket& hListenSocket : vhListenSocket) {
+            if (data == &hListenSocket) {
+                listen_ready.push_back(&hListenSocket);
+                listen = true;
+                break;
+            }
+        }
+        if (listen)
+            continue;
+
+        CNode *pnode = static_cast<CNode*>(const_cast<void*>(data));
+        pnode->m_sock_readable |= readable;
+        pnode->m_sock_writable |= writable;
+        pnode->m_sock_error |= error;
+        m_ready_nodes.insert(pnode);
+    }
+}
+
+void CConnman::EventSocketHandler()
+{
+    // Don't wait while the nodes left over from the last iteration are making progress
+    std::vector<const ListenSocket*> listen_ready;
+    WaitSocketEvents(m_ready_progress && !m_ready_nodes.empty() ? 0 : SELECT_TIMEOUT_MILLISECONDS, listen_ready);
+
+    if (interruptNet) return;
+
+    //
+    // Accept new connections
+    //
+    for (const ListenSocket* hListenSocket : listen_ready)
+    {
+        AcceptConnection(*hListenSocket);
+    }
+
+    //
+    // Service the ready sockets. Nodes are only deleted by this thread, which
+    // drops them from m_ready_nodes first, so no reference needs to be held.
+    //
+    m_ready_progress = false;
+    for (auto it = m_ready_nodes.begin(); it != m_ready_nodes.end(); )
+    {
+        if (interruptNet)
+            return;
+
+        CNode* pnode = *it;
+        {
+            LOCK(pnode->cs_hSocket);
+            if (pnode->hSocket == INVALID_SOCKET) {
+                it = m_ready_nodes.erase(it);
+                continue;
+            }
+        }
+
+        //
+        // Send, until the socket buffer is full
+        //
+        bool pending_send;
+        {
+            LOCK(pnode->cs_vSend);
+            if (pnode->m_sock_writable && !pnode->vSendMsg.empty()) {
+                size_t nBytes = SocketSendData(pnode);
+                if (nBytes) {
+                    RecordBytesSent(nBytes);
+                    m_ready_progress = true;
+                }
+            }
+            pending_send = !pnode->vSendMsg.empty();
+        }
+        if (pending_send)
+            pnode->m_sock_writable = false;
+
+        //
+        // Receive, until a recv() doesn't fill the buffer. As in GenerateSelectSet()
+        // the send buffer is drained before receiving more.
+        //
+        if (pnode->m_sock_error || (pnode->m_sock_readable && !pending_send && !pnode->fPauseRecv))
+        {
+            int nBytes = SocketRecvData(pnode);
+            pnode->m_sock_readable = nBytes == SOCKET_RECV_CHUNK_SIZE;
+            if (nBytes > 0)
+                m_ready_progress = true;
+        }
+
+        if (pnode->m_sock_readable || pnode->m_sock_error)
+            ++it;
+        else
+            it = m_ready_nodes.erase(it);
+    }
+
+    int64_t nTime = GetSystemTimeInSeconds();
+    if (nTime != m_last_inactivity_check)
+    {
+        m_last_inactivity_check = nTime;
+        LOCK(cs_vNodes);
+        for (CNode* pnode : vNodes)
+        {
+            InactivityCheck(pnode);
+
+            // A send that stopped without filling the socket buffer gets no write event,
+            // retry the pending sends once a second
+            LOCK(pnode->cs_vSend);
+            if (!pnode->vSendMsg.empty() && !pnode->m_sock_writable) {
+                pnode->m_sock_writable = true;
+                m_ready_nodes.insert(pnode);
+            }
+        }
+    }
+}
+#endif
+
+int CConnman::SocketRecvData(CNode *pnode)
+{
+    char pchBuf[SOCKET_RECV_CHUNK_SIZE];
+    int nBytes = 0;
+    {
+        LOCK(pnode->cs_hSocket);
+        if (pnode->hSocket == INVALID_SOCKET)
+            return 0;
+        nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
+    }
+    if (nBytes > 0)
+    {
+        bool notify = false;
+        if (!pnode->ReceiveMsgBytes(pchBuf, nBytes, notify))
+            pnode->CloseSocketDisconnect();
+        RecordBytesRecv(nBytes);
+        if (notify) {
+            size_t nSizeAdded = 0;
+            auto it(pnode->vRecvMsg.begin());
+            for (; it != pnode->vRecvMsg.end(); ++it) {
+                if (!it->complete())
+                    break;
+                nSizeAdded += it->vRecv.size() + CMessageHeader::HEADER_SIZE;
+            }
+            {
+                LOCK(pnode->cs_vProcessMsg);
+                pnode->vProcessMsg.splice(pnode->vProcessMsg.end(), pnode->vRecvMsg, pnode->vRecvMsg.begin(), it);
+                pnode->nProcessQueueSize += nSizeAdded;
+                pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
+            }
+            WakeMessageHandler();
+        }
+    }
+    else if (nBytes == 0)
+    {
+        // socket closed gracefully
+        if (!pnode->fDisconnect) {
+            LogPrint(BCLog::NET, "socket closed\n");
+        }
+        pnode->CloseSocketDisconnect();
+    }
+    else if (nBytes < 0)
+    {
+        // error
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
+        {
+            if (!pnode->fDisconnect)
+                LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
+            pnode->CloseSocketDisconnect();
+        }
+    }
+    return nBytes;
+}
+
 void CConnman::SocketHandler()
 {
+#if defined(USE_EPOLL) || defined(USE_KQUEUE)
+    if (m_event_fd != -1) {
+        EventSocketHandler();
+        return;
+    }
+#endif
+
     std::set<SOCKET> recv_set, send_set, error_set;
     SocketEvents(recv_set, send_set, error_set);
 
@@ -1296,57 +1632,7 @@ void CConnman::SocketHandler()
         }
         if (recvSet || errorSet)
         {
-            // typical socket buffer is 8K-64K
-            char pchBuf[0x10000];
-            int nBytes = 0;
-            {
-                LOCK(pnode->cs_hSocket);
-                if (pnode->hSocket == INVALID_SOCKET)
-                    continue;
-                nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
-            }
-            if (nBytes > 0)
-            {
-                bool notify = false;
-                if (!pnode->ReceiveMsgBytes(pchBuf, nBytes, notify))
-                    pnode->CloseSocketDisconnect();
-                RecordBytesRecv(nBytes);
-                if (notify) {
-                    size_t nSizeAdded = 0;
-                    auto it(pnode->vRecvMsg.begin());
-                    for (; it != pnode->vRecvMsg.end(); ++it) {
-                        if (!it->complete())
-                            break;
-                        nSizeAdded += it->vRecv.size() + CMessageHeader::HEADER_SIZE;
-                    }
-                    {
-                        LOCK(pnode->cs_vProcessMsg);
-                        pnode->vProcessMsg.splice(pnode->vProcessMsg.end(), pnode->vRecvMsg, pnode->vRecvMsg.begin(), it);
-                        pnode->nProcessQueueSize += nSizeAdded;
-                        pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
-                    }
-                    WakeMessageHandler();
-                }
-            }
-            else if (nBytes == 0)
-            {
-                // socket closed gracefully
-                if (!pnode->fDisconnect) {
-                    LogPrint(BCLog::NET, "socket closed\n");
-                }
-                pnode->CloseSocketDisconnect();
-            }
-            else if (nBytes < 0)
-            {
-                // error
-                int nErr = WSAGetLastError();
-                if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
-                {
-                    if (!pnode->fDisconnect)
-                        LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
-                    pnode->CloseSocketDisconnect();
-                }
-            }
+            SocketRecvData(pnode);
         }
 
         //
@@ -1535,7 +1821,7 @@ void CConnman::ThreadDNSAddressSeed()
         LOCK(cs_vNodes);
         int nRelevant = 0;
         for (const CNode* pnode : vNodes) {
-            nRelevant += pnode->fSuccessfullyConnected && !pnode->fFeeler && !pnode->fOneShot && !pnode->m_manual_connection && !pnode->fInbound;
+            nRelevant += pnode->fSuccessfullyConnected && !pnode->fFeeler && !pnode->fOneShot && !pnode->m_manual_connection && !pnode->fInbound && !pnode->fXRouter;
         }
         if (nRelevant >= 2) {
             LogPrintf("P2P peers available. Skipped DNS seeding.\n");
@@ -1648,7 +1934,7 @@ int CConnman::GetExtraOutboundCount()
     {
         LOCK(cs_vNodes);
         for (const CNode* pnode : vNodes) {
-            if (!pnode->fInbound && !pnode->m_manual_connection && !pnode->fFeeler && !pnode->fDisconnect && !pnode->fOneShot && pnode->fSuccessfullyConnected) {
+            if (!pnode->fInbound && !pnode->m_manual_connection && !pnode->fFeeler && !pnode->fDisconnect && !pnode->fOneShot && !pnode->fXRouter && pnode->fSuccessfullyConnected) {
                 ++nOutbound;
             }
         }
@@ -1940,6 +2226,7 @@ void CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
         pnode->m_manual_connection = true;
 
     m_msgproc->InitializeNode(pnode);
+    AddNodeSocketEvents(pnode);
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
@@ -1995,6 +2282,57 @@ void CConnman::ThreadMessageHandler()
     }
 }
 
+bool CConnman::QueuePeerTask(CNode* pnode, const std::string& command, std::function<void()> task)
+{
+    if (m_message_workers.empty())
+        return false;
+
+    // Shard by peer so that a slow peer only holds up the peers on its own worker
+    MessageWorker& worker = *m_message_workers[pnode->GetId() % m_message_workers.size()];
+    pnode->AddRef();
+    pnode->m_pending_tasks++;
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(MessageWorker::Task{pnode, command, std::move(task)});
+    }
+    worker.cond.notify_one();
+    return true;
+}
+
+void CConnman::ThreadMessageWorker(MessageWorker& worker)
+{
+    while (!flagInterruptMsgProc)
+    {
+        MessageWorker::Task task;
+        {
+            std::unique_lock<std::mutex> lock(worker.mutex);
+            worker.cond.wait(lock, [&] { return flagInterruptMsgProc || !worker.tasks.empty(); });
+            if (flagInterruptMsgProc)
+                return;
+            task = std::move(worker.tasks.front());
+            worker.tasks.pop_front();
+        }
+
+        CNode* pnode = task.pnode;
+        if (!pnode->fDisconnect) {
+            const int64_t nStart = GetTimeMicros();
+            try {
+                task.func();
+            } catch (const std::exception& e) {
+                PrintExceptionContinue(&e, "ThreadMessageWorker()");
+            } catch (...) {
+                PrintExceptionContinue(nullptr, "ThreadMessageWorker()");
+            }
+            m_msg_stats.RecordWorkerTime(task.command, GetTimeMicros() - nStart);
+        }
+
+        // The node's next message may be processed now
+        pnode->m_pending_tasks--;
+        pnode->Release();
+        WakeMessageHandler();
+    }
+}
+
 
 
 
@@ -2139,6 +2477,16 @@ CConnman::CConnman(uint64_t nSeed0In, uint64_t nSeed1In) : nSeed0(nSeed0In), nSe
 
     Options connOptions;
     Init(connOptions);
+
+#ifdef USE_EPOLL
+    m_event_fd = epoll_create1(EPOLL_CLOEXEC);
+#elif defined(USE_KQUEUE)
+    m_event_fd = kqueue();
+#endif
+#if defined(USE_EPOLL) || defined(USE_KQUEUE)
+    if (m_event_fd == -1)
+        LogPrintf("Unable to create socket event queue (%s), polling all sockets instead\n", NetworkErrorString(WSAGetLastError()));
+#endif
 }
 
 NodeId CConnman::GetNewNodeId()
@@ -2248,6 +2596,19 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
         fMsgProcWake = false;
     }
 
+#if defined(USE_EPOLL) || defined(USE_KQUEUE)
+    if (m_event_fd != -1) {
+        for (ListenSocket& hListenSocket : vhListenSocket) {
+            if (!AddSocketEvents(hListenSocket.socket, &hListenSocket, false)) {
+                LogPrintf("socket event registration error %s, polling all sockets instead\n", NetworkErrorString(WSAGetLastError()));
+                close(m_event_fd);
+                m_event_fd = -1;
+                break;
+            }
+        }
+    }
+#endif
+
     // Send and receive from sockets, accept connections
     threadSocketHandler = std::thread(&TraceThread<std::function<void()> >, "net", std::function<void()>(std::bind(&CConnman::ThreadSocketHandler, this)));
 
@@ -2270,6 +2631,13 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
     if (connOptions.m_use_addrman_outgoing || !connOptions.m_specified_outgoing.empty())
         threadOpenConnections = std::thread(&TraceThread<std::function<void()> >, "opencon", std::function<void()>(std::bind(&CConnman::ThreadOpenConnections, this, connOptions.m_specified_outgoing)));
 
+    // Process the messages that don't need cs_main, sharded by peer
+    for (int i = 0; i < m_message_worker_count; i++) {
+        m_message_workers.emplace_back(MakeUnique<MessageWorker>());
+        MessageWorker& worker = *m_message_workers.back();
+        worker.thread = std::thread(&TraceThread<std::function<void()> >, "msgworker", std::function<void()>(std::bind(&CConnman::ThreadMessageWorker, this, std::ref(worker))));
+    }
+
     // Process messages
     threadMessageHandler = std::thread(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this)));
 
@@ -2301,6 +2669,12 @@ void CConnman::Interrupt()
         flagInterruptMsgProc = true;
     }
     condMsgProc.notify_all();
+    for (const auto& worker : m_message_workers) {
+        {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+        }
+        worker->cond.notify_all();
+    }
 
     interruptNet();
     InterruptSocks5(true);
@@ -2322,6 +2696,16 @@ void CConnman::Stop()
 {
     if (threadMessageHandler.joinable())
         threadMessageHandler.join();
+    for (const auto& worker : m_message_workers) {
+        if (worker->thread.joinable())
+            worker->thread.join();
+        // Drop the references of the tasks that didn't run
+        for (const auto& task : worker->tasks) {
+            task.pnode->m_pending_tasks--;
+            task.pnode->Release();
+        }
+    }
+    m_message_workers.clear();
     if (threadOpenConnections.joinable())
         threadOpenConnections.join();
     if (threadOpenAddedConnections.joinable())
@@ -2367,6 +2751,9 @@ void CConnman::DeleteNode(CNode* pnode)
     if(fUpdateConnectionTime) {
         addrman.Connected(pnode->addr);
     }
+#if defined(USE_EPOLL) || defined(USE_KQUEUE)
+    m_ready_nodes.erase(pnode);
+#endif
     delete pnode;
 }
 
@@ -2374,6 +2761,10 @@ CConnman::~CConnman()
 {
     Interrupt();
     Stop();
+#if defined(USE_EPOLL) || defined(USE_KQUEUE)
+    if (m_event_fd != -1)
+        close(m_event_fd);
+#endif
 }
 
 size_t CConnman::GetAddressCount() const
@@ -2712,6 +3103,7 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
 
         //log total amount of bytes per command
         pnode->mapSendBytesPerMsgCmd[msg.command] += nTotalSize;
+        m_msg_stats.RecordSent(msg.command, nTotalSize);
         pnode->nSendSize += nTotalSize;
 
         if (pnode->nSendSize > nSendBufferMaxSize)
@@ -2809,22 +3201,68 @@ CNode* CConnman::OpenXRouterConnection(const CAddress & addrConnect, const char
 
     CNode *pnode = nullptr;
     pnode = FindNode(static_cast<CNetAddr>(addrConnect));
-    if (pnode)
-        return pnode; // If node is already connected return
-    pnode = FindNode(addrConnect.ToStringIPPort());
-    if (pnode)
-        return pnode; // If node is already connected return
+    if (!pnode)
+        pnode = FindNode(addrConnect.ToStringIPPort());
+    if (pnode) { // If node is already connected return
+        if (pnode->fXRouter)
+            pnode->nLastXRouter = GetSystemTimeInSeconds();
+        return pnode;
+    }
+
+    if (CountXRouterConnections() >= nMaxXRouter && !ReapXRouterConnection()) {
+        LogPrint(BCLog::NET, "all %d xrouter connections in use, not connecting to %s\n", nMaxXRouter, addrConnect.ToString());
+        return nullptr;
+    }
 
     pnode = ConnectNode(addrConnect, pszDest, false, true);
     if (!pnode)
         return nullptr;
     pnode->fXRouter = true;
+    pnode->nLastXRouter = GetSystemTimeInSeconds();
 
     m_msgproc->InitializeNode(pnode);
+    AddNodeSocketEvents(pnode);
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
     }
 
     return pnode;
-}
\ No newline at end of file
+}
+
+bool CConnman::AcceptXRouterPeer(CNode *pnode) {
+    pnode->nLastXRouter = GetSystemTimeInSeconds();
+    if (CountXRouterConnections() <= nMaxXRouter || ReapXRouterConnection())
+        return true;
+    LogPrint(BCLog::NET, "all %d xrouter connections in use, disconnecting peer=%d\n", nMaxXRouter, pnode->GetId());
+    return false;
+}
+
+bool CConnman::ReapXRouterConnection() {
+    const int64_t nTime = GetSystemTimeInSeconds();
+    LOCK(cs_vNodes);
+    CNode *idle = nullptr;
+    for (CNode *pnode : vNodes) {
+        if (!pnode->fXRouter || pnode->fDisconnect)
+            continue;
+        if (nTime - pnode->nLastXRouter < XROUTER_MIN_IDLE_TIME)
+            continue; // in use
+        if (!idle || pnode->nLastXRouter < idle->nLastXRouter)
+            idle = pnode;
+    }
+    if (!idle)
+        return false;
+    LogPrint(BCLog::NET, "closing idle xrouter connection to make room, peer=%d\n", idle->GetId());
+    idle->fDisconnect = true;
+    return true;
+}
+
+int CConnman::CountXRouterConnections() {
+    LOCK(cs_vNodes);
+    int count{0};
+    for (const CNode *pnode : vNodes) {
+        if (pnode->fXRouter && !pnode->fDisconnect)
+            ++count;
+    }
+    return count;
+}
@@ -23,12 +23,15 @@
 #include <uint256.h>
 #include <threadinterrupt.h>
 
+#include <array>
 #include <atomic>
 #include <deque>
+#include <functional>
 #include <stdint.h>
 #include <thread>
 #include <memory>
 #include <condition_variable>
+#include <unordered_set>
 
 #ifndef WIN32
 #include <arpa/inet.h>
@@ -81,6 +84,16 @@ static const uint64_t MAX_UPLOAD_TIMEFRAME = 60 * 60 * 24;
 static const bool DEFAULT_BLOCKSONLY = false;
 /** -peertimeout default */
 static const int64_t DEFAULT_PEER_CONNECT_TIMEOUT = 60;
+/** -msgworkers default, threads handling the messages that don't need cs_main */
+static const int DEFAULT_MESSAGE_WORKERS = 2;
+/** Maximum number of message worker threads */
+static const int MAX_MESSAGE_WORKERS = 16;
+/** -maxxrouterconnections default, XRouter peers are not counted against -maxconnections */
+static const int DEFAULT_MAX_XROUTER_CONNECTIONS = 32;
+/** XRouter connections are closed after this many seconds without an XRouter packet */
+static const int64_t DEFAULT_XROUTER_IDLE_TIMEOUT = 5 * 60;
+/** XRouter connections used within this many seconds are not closed to make room for a new one */
+static const int64_t XROUTER_MIN_IDLE_TIME = 30;
 
 static const bool DEFAULT_FORCEDNSSEED = false;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
@@ -112,6 +125,57 @@ struct CSerializedNetMsg
     std::string command;
 };
 
+/**
+ * Message counters of all peers by message type: messages and bytes received and sent, and
+ * histograms of the processing time on the message handler thread and on the message
+ * workers. The message types are fixed on construction, the counters are updated without
+ * locking. Unknown message types are counted as NET_MESSAGE_COMMAND_OTHER.
+ */
+class CNetMsgStats
+{
+public:
+    /** Processing time buckets, bucket i counts the times below 10^(i+1) microseconds, the last one the rest */
+    static const size_t TIME_BUCKETS = 7;
+
+    struct Timing {
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> total_micros{0};
+        std::atomic<uint64_t> max_micros{0};
+        std::array<std::atomic<uint64_t>, TIME_BUCKETS> buckets{};
+
+        void Record(int64_t micros);
+    };
+
+    struct Entry {
+        std::atomic<uint64_t> msgs_recv{0};
+        std::atomic<uint64_t> bytes_recv{0};
+        std::atomic<uint64_t> msgs_sent{0};
+        std::atomic<uint64_t> bytes_sent{0};
+        Timing handler;
+        Timing worker;
+    };
+
+    CNetMsgStats();
+
+    void RecordRecv(const std::string& command, size_t bytes);
+    void RecordSent(const std::string& command, size_t bytes);
+    void RecordHandlerTime(const std::string& command, int64_t micros);
+    void RecordWorkerTime(const std::string& command, int64_t micros);
+
+    /** Call fn(command, entry) for the message types in alphabetical order */
+    template<typename Callable>
+    void ForEach(Callable&& fn) const
+    {
+        for (const auto& entry : m_entries)
+            fn(entry.first, entry.second);
+    }
+
+private:
+    Entry& Get(const std::string& command);
+
+    std::map<std::string, Entry> m_entries;
+};
+
 
 class NetEventsInterface;
 class CConnman
@@ -132,6 +196,8 @@ public:
         int nMaxOutbound = 0;
         int nMaxAddnode = 0;
         int nMaxFeeler = 0;
+        int nMaxXRouter = DEFAULT_MAX_XROUTER_CONNECTIONS;
+        int64_t m_xrouter_idle_timeout = DEFAULT_XROUTER_IDLE_TIMEOUT;
         int nBestHeight = 0;
         CClientUIInterface* uiInterface = nullptr;
         NetEventsInterface* m_msgproc = nullptr;
@@ -141,6 +207,7 @@ public:
         uint64_t nMaxOutboundTimeframe = 0;
         uint64_t nMaxOutboundLimit = 0;
         int64_t m_peer_connect_timeout = DEFAULT_PEER_CONNECT_TIMEOUT;
+        int m_message_workers = 0;
         std::vector<std::string> vSeedNodes;
         std::vector<CSubNet> vWhitelistedRange;
         std::vector<CService> vBinds, vWhiteBinds;
@@ -156,6 +223,8 @@ public:
         m_use_addrman_outgoing = connOptions.m_use_addrman_outgoing;
         nMaxAddnode = connOptions.nMaxAddnode;
         nMaxFeeler = connOptions.nMaxFeeler;
+        nMaxXRouter = connOptions.nMaxXRouter;
+        m_xrouter_idle_timeout = connOptions.m_xrouter_idle_timeout;
         nBestHeight = connOptions.nBestHeight;
         clientInterface = connOptions.uiInterface;
         m_banman = connOptions.m_banman;
@@ -163,6 +232,7 @@ public:
         nSendBufferMaxSize = connOptions.nSendBufferMaxSize;
         nReceiveFloodSize = connOptions.nReceiveFloodSize;
         m_peer_connect_timeout = connOptions.m_peer_connect_timeout;
+        m_message_worker_count = std::max(0, std::min(connOptions.m_message_workers, MAX_MESSAGE_WORKERS));
         {
             LOCK(cs_totalBytesSent);
             nMaxOutboundTimeframe = connOptions.nMaxOutboundTimeframe;
@@ -195,7 +265,10 @@ public:
     bool GetUseAddrmanOutgoing() const { return m_use_addrman_outgoing; };
     void SetNetworkActive(bool active);
     void OpenNetworkConnection(const CAddress& addrConnect, bool fCountFailure, CSemaphoreGrant *grantOutbound = nullptr, const char *strDest = nullptr, bool fOneShot = false, bool fFeeler = false, bool manual_connection = false);
+    /** Connects to an XRouter peer, returns null if all XRouter connections are in use */
     CNode* OpenXRouterConnection(const CAddress & addrConnect, const char *pszDest);
+    /** Returns false if the peer that announced itself as XRouter peer doesn't fit the XRouter connection limit */
+    bool AcceptXRouterPeer(CNode *pnode);
     bool CheckIncomingNonce(uint64_t nonce);
 
     bool ForNode(NodeId id, std::function<bool(CNode* pnode)> func);
@@ -311,6 +384,16 @@ public:
 
     void WakeMessageHandler();
 
+    /**
+     * Queue a task for the node on the message worker of its shard. The node's next message
+     * is not processed before the task ran, which keeps the node's messages in order. Returns
+     * false without queueing if there are no message workers, the caller runs the task then.
+     */
+    bool QueuePeerTask(CNode* pnode, const std::string& command, std::function<void()> task);
+
+    /** Message counters by message type */
+    CNetMsgStats& GetMsgStats() { return m_msg_stats; }
+
     /** Attempts to obfuscate tx time through exponentially distributed emitting.
         Works assuming that a single interval is used.
         Variable intervals will result in privacy decrease.
@@ -336,6 +419,8 @@ private:
     void ProcessOneShot();
     void ThreadOpenConnections(std::vector<std::string> connect);
     void ThreadMessageHandler();
+    struct MessageWorker;
+    void ThreadMessageWorker(MessageWorker& worker);
     void AcceptConnection(const ListenSocket& hListenSocket);
     void DisconnectNodes();
     void NotifyNumConnectionsChanged();
@@ -343,6 +428,18 @@ private:
     bool GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
     void SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
     void SocketHandler();
+    /** Receive one chunk from the node's socket and hand off complete messages, returns the recv() result */
+    int SocketRecvData(CNode *pnode);
+    /** Register a new node's socket with the event queue if there is one, the node is disconnected if that fails */
+    void AddNodeSocketEvents(CNode *pnode);
+#if defined(USE_EPOLL) || defined(USE_KQUEUE)
+    /** Register a socket with the event queue, node sockets edge triggered for reads and writes */
+    bool AddSocketEvents(SOCKET hSocket, void *data, bool edge_triggered);
+    /** Wait for readiness, marks the nodes that became ready and returns the listen sockets to accept on */
+    void WaitSocketEvents(int timeout_ms, std::vector<const ListenSocket*>& listen_ready);
+    /** SocketHandler() with the event queue, only the nodes with pending readiness are serviced */
+    void EventSocketHandler();
+#endif
     void ThreadSocketHandler();
     void ThreadDNSAddressSeed();
 
@@ -354,6 +451,10 @@ private:
     CNode* FindNode(const CService& addr);
 
     bool AttemptToEvictConnection();
+    /** Disconnects the least recently used XRouter connection that is idle, returns false if there is none */
+    bool ReapXRouterConnection();
+    /** Number of XRouter connections, except the ones being disconnected */
+    int CountXRouterConnections();
     CNode* ConnectNode(CAddress addrConnect, const char *pszDest, bool fCountFailure, bool manual_connection);
     bool IsWhitelistedRange(const CNetAddr &addr);
 
@@ -404,6 +505,15 @@ private:
     std::vector<CNode*> vNodes GUARDED_BY(cs_vNodes);
     std::list<CNode*> vNodesDisconnected;
     mutable CCriticalSection cs_vNodes;
+#if defined(USE_EPOLL) || defined(USE_KQUEUE)
+    // epoll or kqueue descriptor the sockets stay registered with, -1 to fall back to
+    // GenerateSelectSet() and SocketEvents() on every iteration
+    int m_event_fd{-1};
+    // Nodes with readiness that was not used up yet, only accessed by the socket handler thread
+    std::unordered_set<CNode*> m_ready_nodes;
+    int64_t m_last_inactivity_check{0};
+    bool m_ready_progress{false};
+#endif
     std::atomic<NodeId> nLastNodeId{0};
     unsigned int nPrevNodeCount{0};
 
@@ -416,6 +526,8 @@ private:
     int nMaxOutbound;
     int nMaxAddnode;
     int nMaxFeeler;
+    int nMaxXRouter;
+    int64_t m_xrouter_idle_timeout;
     bool m_use_addrman_outgoing;
     std::atomic<int> nBestHeight;
     CClientUIInterface* clientInterface;
@@ -440,6 +552,23 @@ private:
     std::thread threadOpenConnections;
     std::thread threadMessageHandler;
 
+    /** Thread and queue of one message worker shard */
+    struct MessageWorker {
+        std::mutex mutex;
+        std::condition_variable cond;
+        struct Task {
+            CNode* pnode;
+            std::string command;
+            std::function<void()> func;
+        };
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+    int m_message_worker_count{0};
+    std::vector<std::unique_ptr<MessageWorker>> m_message_workers;
+
+    CNetMsgStats m_msg_stats;
+
     /** flag for deciding to connect to an extra outbound peer,
      *  in excess of nMaxOutbound
      *  This takes the place of a feeler connection */
@@ -627,6 +756,43 @@ public:
     int readData(const char *pch, unsigned int nBytes);
 };
 
+/**
+ * Reference counted byte vector payload of a received message (xbridge and xrouter packets).
+ * The bytes stay in the receive buffer of the message, handlers parse them in place and queue
+ * or keep them for relay by sharing the reference. Serializes like std::vector<unsigned char>.
+ */
+class CNetPayload
+{
+    std::shared_ptr<const void> m_owner;
+    const unsigned char* m_data{nullptr};
+    size_t m_size{0};
+
+public:
+    CNetPayload() = default;
+    /** Payload of a locally created packet */
+    explicit CNetPayload(std::vector<unsigned char> bytes);
+
+    /**
+     * Take the byte vector at the read position of a received message's stream, the
+     * stream's buffer is moved into the payload. Throws like deserializing the vector.
+     */
+    static CNetPayload FromStream(CDataStream& stream);
+
+    const unsigned char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    const unsigned char* begin() const { return m_data; }
+    const unsigned char* end() const { return m_data + m_size; }
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        WriteCompactSize(s, m_size);
+        if (m_size)
+            s.write(reinterpret_cast<const char*>(m_data), m_size);
+    }
+};
+
 
 /** Information about a peer */
 class CNode
@@ -695,6 +861,15 @@ public:
     const uint64_t nKeyedNetGroup;
     std::atomic_bool fPauseRecv{false};
     std::atomic_bool fPauseSend{false};
+    // Tasks queued on a message worker, no further messages are processed while there are any
+    std::atomic<int> m_pending_tasks{0};
+#if defined(USE_EPOLL) || defined(USE_KQUEUE)
+    // Edge triggered socket readiness, only accessed by the socket handler thread. Set by the
+    // event queue and cleared once a recv() or send() finds the socket buffer drained or full.
+    bool m_sock_readable{false};
+    bool m_sock_writable{false};
+    bool m_sock_error{false};
+#endif
 
 protected:
     mapMsgCmdSize mapSendBytesPerMsgCmd;
@@ -721,6 +896,10 @@ public:
     // There is no final sorting before sending, as they are always sent immediately
     // and in the order requested.
     std::vector<uint256> vInventoryBlockToSend GUARDED_BY(cs_inventory);
+    // List of xbridge packet hashes we still have to announce, sent on the inventory trickle.
+    std::vector<uint256> vInventoryXBridgeToSend GUARDED_BY(cs_inventory);
+    // List of servicenode ping hashes we still have to send, sent on the inventory trickle.
+    std::vector<uint256> vInventorySnPingToSend GUARDED_BY(cs_inventory);
     CCriticalSection cs_inventory;
     std::set<uint256> setAskFor;
     std::multimap<int64_t, CInv> mapAskFor;
@@ -762,6 +941,12 @@ public:
     CNode& operator=(const CNode&) = delete;
 
     std::atomic<bool> fXRouter{false};
+    // Last time an XRouter packet was exchanged with the peer, idle XRouter connections are closed
+    std::atomic<int64_t> nLastXRouter{0};
+    // Whether the peer asked for xbridge packets to be announced with inv (sendxbinv)
+    std::atomic<bool> fPreferXBridgeInv{false};
+    // Whether the peer asked for servicenode pings to be sent in batches (sendsnps)
+    std::atomic<bool> fPreferSnPingBatch{false};
 
 private:
     const NodeId id;
@@ -865,6 +1050,14 @@ public:
             }
         } else if (inv.type == MSG_BLOCK) {
             vInventoryBlockToSend.push_back(inv.hash);
+        } else if (inv.type == MSG_XBRIDGE) {
+            if (!filterInventoryKnown.contains(inv.hash)) {
+                vInventoryXBridgeToSend.push_back(inv.hash);
+            }
+        } else if (inv.type == MSG_SNPING) {
+            if (!filterInventoryKnown.contains(inv.hash)) {
+                vInventorySnPingToSend.push_back(inv.hash);
+            }
         }
     }
 
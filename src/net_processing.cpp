@@ -12,6 +12,7 @@
 #include <chainparams.h>
 #include <consensus/validation.h>
 #include <hash.h>
+#include <index/blockfilterindex.h>
 #include <validation.h>
 #include <merkleblock.h>
 #include <netmessagemaker.h>
@@ -34,6 +35,7 @@
 #include <xbridge/xbridgeapp.h>
 #include <xrouter/xrouterapp.h>
 
+#include <list>
 #include <memory>
 
 #if defined(NDEBUG)
@@ -95,6 +97,16 @@ static constexpr unsigned int INVENTORY_BROADCAST_MAX = 7 * INVENTORY_BROADCAST_
 static constexpr unsigned int AVG_FEEFILTER_BROADCAST_INTERVAL = 10 * 60;
 /** Maximum feefilter broadcast delay after significant change. */
 static constexpr unsigned int MAX_FEEFILTER_CHANGE_DELAY = 5 * 60;
+/** Seconds an announced xbridge packet is kept in relay memory for getdata requests */
+static constexpr int64_t XBRIDGE_RELAY_EXPIRY = 5 * 60;
+/** Seconds a relayed servicenode ping is kept until it was sent on the peers' inventory trickle */
+static constexpr int64_t SNPING_RELAY_EXPIRY = 2 * 60;
+/** Maximum number of compact filters that may be requested with one getcfilters. See BIP 157. */
+static constexpr uint32_t MAX_GETCFILTERS_SIZE = 1000;
+/** Maximum number of cf hashes that may be requested with one getcfheaders. See BIP 157. */
+static constexpr uint32_t MAX_GETCFHEADERS_SIZE = 2000;
+/** Interval between compact filter checkpoints. See BIP 157. */
+static constexpr int CFCHECKPT_INTERVAL = 1000;
 
 // Internal stuff
 namespace {
@@ -161,6 +173,18 @@ namespace {
     /** Expiration-time ordered list of (expire time, relay map entry) pairs. */
     std::deque<std::pair<int64_t, MapRelay::iterator>> vRelayExpiration GUARDED_BY(cs_main);
 
+    /** Relay memory of the xbridge packets announced with inv, by packet hash */
+    Mutex g_cs_xbridge_relay;
+    typedef std::map<uint256, CNetPayload> MapXBridgeRelay;
+    MapXBridgeRelay mapXBridgeRelay GUARDED_BY(g_cs_xbridge_relay);
+    std::deque<std::pair<int64_t, MapXBridgeRelay::iterator>> vXBridgeRelayExpiration GUARDED_BY(g_cs_xbridge_relay);
+
+    /** Servicenode pings queued for the peers' inventory trickle, by ping hash */
+    Mutex g_cs_snping_relay;
+    typedef std::map<uint256, sn::ServiceNodePing> MapSnPingRelay;
+    MapSnPingRelay mapSnPingRelay GUARDED_BY(g_cs_snping_relay);
+    std::deque<std::pair<int64_t, MapSnPingRelay::iterator>> vSnPingRelayExpiration GUARDED_BY(g_cs_snping_relay);
+
     std::atomic<int64_t> nTimeBestReceived(0); // Used only to inform the wallet of when we last received a block
 
     struct IteratorComparator
@@ -278,6 +302,11 @@ struct CNodeState {
     //! Time of last new block announcement
     int64_t m_last_block_announcement;
 
+    //! Whether the servicenode list was sent to this peer
+    bool fSentSnodeList;
+    //! Our chain height when we requested the servicenode list of this peer, -1 if no request is outstanding
+    int nSnodeListRequested;
+
     CNodeState(CAddress addrIn, std::string addrNameIn) : address(addrIn), name(addrNameIn) {
         fCurrentlyConnected = false;
         nMisbehavior = 0;
@@ -302,6 +331,8 @@ struct CNodeState {
         fSupportsDesiredCmpctVersion = false;
         m_chain_sync = { 0, nullptr, false, false };
         m_last_block_announcement = 0;
+        fSentSnodeList = false;
+        nSnodeListRequested = -1;
     }
 };
 
@@ -612,7 +643,7 @@ void UpdateLastBlockAnnounceTime(NodeId node, int64_t time_in_seconds)
 // one-shots
 static bool IsOutboundDisconnectionCandidate(const CNode *node)
 {
-    return !(node->fInbound || node->m_manual_connection || node->fFeeler || node->fOneShot);
+    return !(node->fInbound || node->m_manual_connection || node->fFeeler || node->fOneShot || node->fXRouter);
 }
 
 void PeerLogicValidation::InitializeNode(CNode *pnode) {
@@ -1072,6 +1103,8 @@ bool static AlreadyHave(const CInv& inv) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
     case MSG_BLOCK:
     case MSG_WITNESS_BLOCK:
         return LookupBlockIndex(inv.hash) != nullptr;
+    case MSG_XBRIDGE:
+        return sn::ServiceNodeMgr::instance().hasSeenPacket(inv.hash);
     }
     // Don't know what it is, just say we already got one
     return true;
@@ -1086,6 +1119,53 @@ static void RelayTransaction(const CTransaction& tx, CConnman* connman)
     });
 }
 
+void RelayXBridgePacket(const uint256& hash, const CNetPayload& raw, CConnman* connman)
+{
+    {
+        LOCK(g_cs_xbridge_relay);
+        const int64_t nNow = GetTime();
+        while (!vXBridgeRelayExpiration.empty() && vXBridgeRelayExpiration.front().first < nNow) {
+            mapXBridgeRelay.erase(vXBridgeRelayExpiration.front().second);
+            vXBridgeRelayExpiration.pop_front();
+        }
+        auto ret = mapXBridgeRelay.insert(std::make_pair(hash, raw));
+        if (ret.second)
+            vXBridgeRelayExpiration.push_back(std::make_pair(nNow + XBRIDGE_RELAY_EXPIRY, ret.first));
+    }
+
+    const CInv inv(MSG_XBRIDGE, hash);
+    connman->ForEachNode([&](CNode* pnode) {
+        if (!pnode->fSuccessfullyConnected || pnode->fDisconnect || pnode->fXRouter) // do not relay to xrouter nodes
+            return;
+        if (pnode->fPreferXBridgeInv)
+            pnode->PushInventory(inv);
+        else
+            connman->PushMessage(pnode, CNetMsgMaker(pnode->GetSendVersion()).Make(NetMsgType::XBRIDGE, raw));
+    });
+}
+
+void RelayServiceNodePing(const sn::ServiceNodePing& ping, CConnman* connman)
+{
+    const uint256 hash = ping.getHash();
+    {
+        LOCK(g_cs_snping_relay);
+        const int64_t nNow = GetTime();
+        while (!vSnPingRelayExpiration.empty() && vSnPingRelayExpiration.front().first < nNow) {
+            mapSnPingRelay.erase(vSnPingRelayExpiration.front().second);
+            vSnPingRelayExpiration.pop_front();
+        }
+        auto ret = mapSnPingRelay.insert(std::make_pair(hash, ping));
+        if (ret.second)
+            vSnPingRelayExpiration.push_back(std::make_pair(nNow + SNPING_RELAY_EXPIRY, ret.first));
+    }
+
+    const CInv inv(MSG_SNPING, hash);
+    connman->ForEachNode([&](CNode* pnode) {
+        if (pnode->fSuccessfullyConnected && !pnode->fDisconnect)
+            pnode->PushInventory(inv);
+    });
+}
+
 static void RelayAddress(const CAddress& addr, bool fReachable, CConnman* connman)
 {
     unsigned int nRelayNodes = fReachable ? 2 : 1; // limited relaying of addresses outside our network(s)
@@ -1122,6 +1202,104 @@ static void RelayAddress(const CAddress& addr, bool fReachable, CConnman* connma
     connman->ForEachNodeThen(std::move(sortfunc), std::move(pushfunc));
 }
 
+/**
+ * Whether a serialized block carries witness data. Valid blocks only carry witnesses
+ * along with a witness commitment, which requires a coinbase witness, so the extended
+ * format marker of the coinbase tells. Unreadable blocks are reported as having witnesses
+ * so that they take the deserializing path.
+ */
+static bool RawBlockHasWitness(const std::vector<uint8_t>& block_data)
+{
+    try {
+        VectorReader s(SER_NETWORK, PROTOCOL_VERSION, block_data, 0);
+        CBlockHeader header;
+        s >> header;
+        if (ReadCompactSize(s) == 0)
+            return false;
+        int32_t tx_version;
+        uint8_t marker;
+        s >> tx_version >> marker;
+        // An empty input vector is the extended format marker, a coinbase has one input
+        return marker == 0;
+    } catch (const std::ios_base::failure&) {
+        return true;
+    }
+}
+
+/** Number of recently requested blocks whose filter elements are kept for bloom filter peers */
+static constexpr size_t MAX_FILTERED_BLOCKS = 16;
+/** Number of partial merkle trees kept per filtered block, one for each set of matched transactions */
+static constexpr size_t MAX_FILTERED_BLOCK_TREES = 64;
+
+// Blocks recently served to bloom filter peers, protected by cs_filtered_blocks
+static CCriticalSection cs_filtered_blocks;
+struct FilteredBlock {
+    std::vector<CBloomTxElements> elements; // immutable once cached
+    std::vector<uint256> hashes;
+    std::map<uint256, CPartialMerkleTree> trees GUARDED_BY(cs_filtered_blocks); // hash of the matched positions -> tree
+};
+static std::list<std::pair<uint256, std::shared_ptr<FilteredBlock>>> filtered_blocks GUARDED_BY(cs_filtered_blocks); // most recent first
+
+/**
+ * Same as CMerkleBlock(block, filter), but the scripts of the block are parsed once for all
+ * the peers requesting it and the partial merkle tree is built once for each set of matches.
+ */
+static CMerkleBlock MakeFilteredBlock(const CBlock& block, CBloomFilter& filter)
+{
+    const uint256 blockHash = block.GetHash();
+    std::shared_ptr<FilteredBlock> cached;
+    {
+        LOCK(cs_filtered_blocks);
+        for (auto it = filtered_blocks.begin(); it != filtered_blocks.end(); ++it) {
+            if (it->first == blockHash) {
+                cached = it->second;
+                filtered_blocks.splice(filtered_blocks.begin(), filtered_blocks, it);
+                break;
+            }
+        }
+    }
+    if (!cached) {
+        cached = std::make_shared<FilteredBlock>();
+        cached->elements.reserve(block.vtx.size());
+        cached->hashes.reserve(block.vtx.size());
+        for (const auto& tx : block.vtx) {
+            cached->elements.emplace_back(*tx);
+            cached->hashes.push_back(tx->GetHash());
+        }
+        LOCK(cs_filtered_blocks);
+        filtered_blocks.emplace_front(blockHash, cached);
+        if (filtered_blocks.size() > MAX_FILTERED_BLOCKS)
+            filtered_blocks.pop_back();
+    }
+
+    CMerkleBlock merkleBlock;
+    merkleBlock.header = block.GetBlockHeader();
+    std::vector<bool> vMatch(cached->elements.size(), false);
+    CHashWriter matches(SER_GETHASH, 0);
+    for (unsigned int i = 0; i < cached->elements.size(); i++) {
+        if (filter.IsRelevantAndUpdate(cached->elements[i])) {
+            vMatch[i] = true;
+            merkleBlock.vMatchedTxn.emplace_back(i, cached->hashes[i]);
+            matches << i;
+        }
+    }
+    const uint256 matchesHash = matches.GetHash();
+    {
+        LOCK(cs_filtered_blocks);
+        auto it = cached->trees.find(matchesHash);
+        if (it != cached->trees.end()) {
+            merkleBlock.txn = it->second;
+            return merkleBlock;
+        }
+    }
+    merkleBlock.txn = CPartialMerkleTree(cached->hashes, vMatch);
+    LOCK(cs_filtered_blocks);
+    if (cached->trees.size() >= MAX_FILTERED_BLOCK_TREES)
+        cached->trees.clear();
+    cached->trees.emplace(matchesHash, merkleBlock.txn);
+    return merkleBlock;
+}
+
 void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, const CInv& inv, CConnman* connman)
 {
     bool send = false;
@@ -1195,15 +1373,27 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
         std::shared_ptr<const CBlock> pblock;
         if (a_recent_block && a_recent_block->GetHash() == pindex->GetBlockHash()) {
             pblock = a_recent_block;
-        } else if (inv.type == MSG_WITNESS_BLOCK) {
+        } else if (inv.type == MSG_WITNESS_BLOCK || (inv.type == MSG_BLOCK && pfrom->nVersion > LEGACY_PROTOCOL_VERSION)) {
             // Fast-path: in this case it is possible to serve the block directly from disk,
-            // as the network format matches the format on disk
+            // as the network format matches the format on disk. Blocks without witnesses
+            // are the same with or without witness serialization.
             std::vector<uint8_t> block_data;
             if (!ReadRawBlockFromDisk(block_data, pindex, chainparams.MessageStart())) {
                 assert(!"cannot load block from disk");
             }
-            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, MakeSpan(block_data)));
-            // Don't set pblock as we've sent the block
+            if (inv.type == MSG_WITNESS_BLOCK || !RawBlockHasWitness(block_data)) {
+                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, MakeSpan(block_data)));
+                // Don't set pblock as we've sent the block
+            } else {
+                // The witnesses have to be stripped
+                std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
+                try {
+                    VectorReader(SER_NETWORK, PROTOCOL_VERSION, block_data, 0) >> *pblockRead;
+                } catch (const std::exception&) {
+                    assert(!"cannot load block from disk");
+                }
+                pblock = pblockRead;
+            }
         } else {
             // Send block from disk
             std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
@@ -1228,7 +1418,7 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
                     LOCK(pfrom->cs_filter);
                     if (pfrom->pfilter) {
                         sendMerkleBlock = true;
-                        merkleBlock = CMerkleBlock(*pblock, *pfrom->pfilter);
+                        merkleBlock = MakeFilteredBlock(*pblock, *pfrom->pfilter);
                     }
                 }
                 if (sendMerkleBlock) {
@@ -1291,7 +1481,7 @@ void static ProcessGetData(CNode* pfrom, const CChainParams& chainparams, CConnm
     {
         LOCK(cs_main);
 
-        while (it != pfrom->vRecvGetData.end() && (it->type == MSG_TX || it->type == MSG_WITNESS_TX)) {
+        while (it != pfrom->vRecvGetData.end() && (it->type == MSG_TX || it->type == MSG_WITNESS_TX || it->type == MSG_XBRIDGE)) {
             if (interruptMsgProc)
                 return;
             // Don't bother if send buffer is too full to respond anyway
@@ -1301,6 +1491,16 @@ void static ProcessGetData(CNode* pfrom, const CChainParams& chainparams, CConnm
             const CInv &inv = *it;
             it++;
 
+            if (inv.type == MSG_XBRIDGE) {
+                LOCK(g_cs_xbridge_relay);
+                auto mi = mapXBridgeRelay.find(inv.hash);
+                if (mi != mapXBridgeRelay.end())
+                    connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::XBRIDGE, mi->second));
+                else
+                    vNotFound.push_back(inv);
+                continue;
+            }
+
             // Send stream from relay memory
             bool push = false;
             auto mi = mapRelay.find(inv.hash);
@@ -1379,6 +1579,9 @@ bool static ProcessHeadersMessage(CNode *pfrom, CConnman *connman, const std::ve
         return true;
     }
 
+    // Hash the headers before taking cs_main, a full batch on several threads
+    const std::vector<uint256> hashes = GetBlockHeaderHashes(headers);
+
     bool received_new_header = false;
     const CBlockIndex *pindexLast = nullptr;
     {
@@ -1397,14 +1600,14 @@ bool static ProcessHeadersMessage(CNode *pfrom, CConnman *connman, const std::ve
             nodestate->nUnconnectingHeaders++;
             connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETHEADERS, chainActive.GetLocator(pindexBestHeader), uint256()));
             LogPrint(BCLog::NET, "received header %s: missing prev block %s, sending getheaders (%d) to end (peer=%d, nUnconnectingHeaders=%d)\n",
-                    headers[0].GetHash().ToString(),
+                    hashes[0].ToString(),
                     headers[0].hashPrevBlock.ToString(),
                     pindexBestHeader->nHeight,
                     pfrom->GetId(), nodestate->nUnconnectingHeaders);
             // Set hashLastUnknownBlock for this peer, so that if we
             // eventually get the headers - even from a different peer -
             // we can use this peer to download.
-            UpdateBlockAvailability(pfrom->GetId(), headers.back().GetHash());
+            UpdateBlockAvailability(pfrom->GetId(), hashes.back());
 
             if (nodestate->nUnconnectingHeaders % MAX_UNCONNECTING_HEADERS == 0) {
                 Misbehaving(pfrom->GetId(), 20);
@@ -1413,12 +1616,12 @@ bool static ProcessHeadersMessage(CNode *pfrom, CConnman *connman, const std::ve
         }
 
         uint256 hashLastBlock;
-        for (const CBlockHeader& header : headers) {
-            if (!hashLastBlock.IsNull() && header.hashPrevBlock != hashLastBlock) {
+        for (size_t i = 0; i < headers.size(); ++i) {
+            if (!hashLastBlock.IsNull() && headers[i].hashPrevBlock != hashLastBlock) {
                 Misbehaving(pfrom->GetId(), 20, "non-continuous headers sequence");
                 return false;
             }
-            hashLastBlock = header.GetHash();
+            hashLastBlock = hashes[i];
         }
 
         // If we don't have the last header, then they'll have given us
@@ -1430,7 +1633,7 @@ bool static ProcessHeadersMessage(CNode *pfrom, CConnman *connman, const std::ve
 
     CValidationState state;
     CBlockHeader first_invalid_header;
-    if (!ProcessNewBlockHeaders(headers, state, chainparams, &pindexLast, &first_invalid_header)) {
+    if (!ProcessNewBlockHeaders(headers, hashes, state, chainparams, &pindexLast, &first_invalid_header)) {
         int nDoS;
         if (state.IsInvalid(nDoS)) {
             LOCK(cs_main);
@@ -1590,6 +1793,192 @@ bool static ProcessHeadersMessage(CNode *pfrom, CConnman *connman, const std::ve
     return true;
 }
 
+/**
+ * Validation logic for compact filters request handling.
+ *
+ * May disconnect from the peer in the case of a bad request.
+ *
+ * @param[in]   pfrom           The peer that we received the request from
+ * @param[in]   chain_params    Chain parameters
+ * @param[in]   filter_type     The filter type the request is for. Must be basic filters.
+ * @param[in]   start_height    The start height for the request
+ * @param[in]   stop_hash       The stop_hash for the request
+ * @param[in]   max_height_diff The maximum number of items permitted to request, as specified in BIP 157
+ * @param[out]  stop_index      The CBlockIndex for the stop_hash block, if the request can be serviced.
+ * @return                      True if the request can be serviced.
+ */
+static bool PrepareBlockFilterRequest(CNode* pfrom, const CChainParams& chain_params,
+                                      uint8_t filter_type, uint32_t start_height,
+                                      const uint256& stop_hash, uint32_t max_height_diff,
+                                      const CBlockIndex*& stop_index)
+{
+    if (filter_type != BlockFilterType::BASIC || !(pfrom->GetLocalServices() & NODE_COMPACT_FILTERS)) {
+        LogPrint(BCLog::NET, "peer %d requested unsupported block filter type: %d\n",
+                 pfrom->GetId(), filter_type);
+        pfrom->fDisconnect = true;
+        return false;
+    }
+
+    {
+        LOCK(cs_main);
+        stop_index = LookupBlockIndex(stop_hash);
+
+        // Check that the stop block exists and the peer would be allowed to fetch it.
+        if (!stop_index || !BlockRequestAllowed(stop_index, chain_params.GetConsensus())) {
+            LogPrint(BCLog::NET, "peer %d requested invalid block hash: %s\n",
+                     pfrom->GetId(), stop_hash.ToString());
+            pfrom->fDisconnect = true;
+            return false;
+        }
+    }
+
+    uint32_t stop_height = stop_index->nHeight;
+    if (start_height > stop_height) {
+        LogPrint(BCLog::NET, "peer %d sent invalid getcfilters/getcfheaders with " /* Continued */
+                 "start height %d and stop height %d\n",
+                 pfrom->GetId(), start_height, stop_height);
+        pfrom->fDisconnect = true;
+        return false;
+    }
+    if (stop_height - start_height >= max_height_diff) {
+        LogPrint(BCLog::NET, "peer %d requested too many cfilters/cfheaders: %d / %d\n",
+                 pfrom->GetId(), stop_height - start_height + 1, max_height_diff);
+        pfrom->fDisconnect = true;
+        return false;
+    }
+
+    if (!g_blockfilterindex) {
+        LogPrint(BCLog::NET, "peer %d requested block filters but the filter index is not enabled\n", pfrom->GetId());
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Handle a cfilters request.
+ *
+ * May disconnect from the peer in the case of a bad request.
+ */
+static void ProcessGetCFilters(CNode* pfrom, CDataStream& vRecv, const CChainParams& chain_params,
+                               CConnman* connman)
+{
+    uint8_t filter_type;
+    uint32_t start_height;
+    uint256 stop_hash;
+
+    vRecv >> filter_type >> start_height >> stop_hash;
+
+    const CBlockIndex* stop_index;
+    if (!PrepareBlockFilterRequest(pfrom, chain_params, filter_type, start_height, stop_hash,
+                                   MAX_GETCFILTERS_SIZE, stop_index)) {
+        return;
+    }
+
+    std::vector<BlockFilter> filters;
+    if (!g_blockfilterindex->LookupFilterRange(start_height, stop_index, filters)) {
+        LogPrint(BCLog::NET, "Failed to find block filter in index: filter_type=%d, start_height=%d, stop_hash=%s\n",
+                 filter_type, start_height, stop_hash.ToString());
+        return;
+    }
+
+    for (const auto& filter : filters) {
+        CSerializedNetMsg msg = CNetMsgMaker(pfrom->GetSendVersion())
+            .Make(NetMsgType::CFILTER, filter);
+        connman->PushMessage(pfrom, std::move(msg));
+    }
+}
+
+/**
+ * Handle a cfheaders request.
+ *
+ * May disconnect from the peer in the case of a bad request.
+ */
+static void ProcessGetCFHeaders(CNode* pfrom, CDataStream& vRecv, const CChainParams& chain_params,
+                                CConnman* connman)
+{
+    uint8_t filter_type;
+    uint32_t start_height;
+    uint256 stop_hash;
+
+    vRecv >> filter_type >> start_height >> stop_hash;
+
+    const CBlockIndex* stop_index;
+    if (!PrepareBlockFilterRequest(pfrom, chain_params, filter_type, start_height, stop_hash,
+                                   MAX_GETCFHEADERS_SIZE, stop_index)) {
+        return;
+    }
+
+    uint256 prev_header;
+    if (start_height > 0) {
+        const CBlockIndex* const prev_block =
+            stop_index->GetAncestor(static_cast<int>(start_height - 1));
+        if (!g_blockfilterindex->LookupFilterHeader(prev_block, prev_header)) {
+            LogPrint(BCLog::NET, "Failed to find block filter header in index: filter_type=%d, block_hash=%s\n",
+                     filter_type, prev_block->GetBlockHash().ToString());
+            return;
+        }
+    }
+
+    std::vector<uint256> filter_hashes;
+    if (!g_blockfilterindex->LookupFilterHashRange(start_height, stop_index, filter_hashes)) {
+        LogPrint(BCLog::NET, "Failed to find block filter hashes in index: filter_type=%d, start_height=%d, stop_hash=%s\n",
+                 filter_type, start_height, stop_hash.ToString());
+        return;
+    }
+
+    CSerializedNetMsg msg = CNetMsgMaker(pfrom->GetSendVersion())
+        .Make(NetMsgType::CFHEADERS,
+              filter_type,
+              stop_index->GetBlockHash(),
+              prev_header,
+              filter_hashes);
+    connman->PushMessage(pfrom, std::move(msg));
+}
+
+/**
+ * Handle a getcfcheckpt request.
+ *
+ * May disconnect from the peer in the case of a bad request.
+ */
+static void ProcessGetCFCheckPt(CNode* pfrom, CDataStream& vRecv, const CChainParams& chain_params,
+                                CConnman* connman)
+{
+    uint8_t filter_type;
+    uint256 stop_hash;
+
+    vRecv >> filter_type >> stop_hash;
+
+    const CBlockIndex* stop_index;
+    if (!PrepareBlockFilterRequest(pfrom, chain_params, filter_type, /*start_height=*/0, stop_hash,
+                                   /*max_height_diff=*/std::numeric_limits<uint32_t>::max(),
+                                   stop_index)) {
+        return;
+    }
+
+    std::vector<uint256> headers(stop_index->nHeight / CFCHECKPT_INTERVAL);
+
+    // Populate headers.
+    const CBlockIndex* block_index = stop_index;
+    for (int i = headers.size() - 1; i >= 0; i--) {
+        int height = (i + 1) * CFCHECKPT_INTERVAL;
+        block_index = block_index->GetAncestor(height);
+
+        if (!g_blockfilterindex->LookupFilterHeader(block_index, headers[i])) {
+            LogPrint(BCLog::NET, "Failed to find block filter header in index: filter_type=%d, block_hash=%s\n",
+                     filter_type, block_index->GetBlockHash().ToString());
+            return;
+        }
+    }
+
+    CSerializedNetMsg msg = CNetMsgMaker(pfrom->GetSendVersion())
+        .Make(NetMsgType::CFCHECKPT,
+              filter_type,
+              stop_index->GetBlockHash(),
+              headers);
+    connman->PushMessage(pfrom, std::move(msg));
+}
+
 void static ProcessOrphanTx(CConnman* connman, std::set<uint256>& orphan_work_set, std::list<CTransactionRef>& removed_txn) EXCLUSIVE_LOCKS_REQUIRED(cs_main, g_cs_orphans)
 {
     AssertLockHeld(cs_main);
@@ -1651,6 +2040,165 @@ void static ProcessOrphanTx(CConnman* connman, std::set<uint256>& orphan_work_se
     }
 }
 
+/**
+ * Process an xbridge packet without cs_main, on the peer's message worker if there are any.
+ * The inventory bookkeeping and the size checks are done by ProcessMessage.
+ */
+static void ProcessXBridgePacket(CNode* pfrom, const CNetPayload& raw, const uint256& hash, CConnman* connman)
+{
+    auto & smgr = sn::ServiceNodeMgr::instance();
+    auto & xapp = xbridge::App::instance();
+
+    int dos = 0;
+
+    try {
+        // Process xbridge packet
+        if (!smgr.processXBridge(raw, hash))
+            return;
+
+        CValidationState state;
+
+        // Pass packet to XBridge
+        if (xapp.isEnabled()) {
+            static const std::vector<unsigned char> zero(20, 0);
+            const std::vector<unsigned char> addr(raw.begin(), raw.begin()+20);
+            // packet follows the addr and timestamp
+            const size_t offset = 20 + sizeof(uint64_t);
+            const XBridgePacketView packet(raw.data()+offset, raw.size()-offset);
+            if (addr != zero)
+                xapp.onMessageReceived(addr, packet, state);
+            else
+                xapp.onBroadcastReceived(packet, state);
+
+            if (state.IsInvalid(dos)) {
+                LogPrint(BCLog::XBRIDGE, "invalid xbridge packet from peer=%d %s : %s\n", pfrom->GetId(),
+                        pfrom->cleanSubVer, state.GetRejectReason());
+                if (dos > 0) {
+                    LOCK(cs_main);
+                    Misbehaving(pfrom->GetId(), dos);
+                }
+            }
+            else if (state.IsError()) {
+                LogPrint(BCLog::XBRIDGE, "xbridge packet from peer=%d %s processed with error: %s\n",
+                         pfrom->GetId(), pfrom->cleanSubVer,
+                         state.GetRejectReason());
+            }
+        }
+    } catch (...) {
+        LogPrint(BCLog::XBRIDGE, "Fatal XBridge error detected");
+    }
+
+    // Relay xbridge packets only if state is good
+    if (dos <= 0)
+        RelayXBridgePacket(hash, raw, connman);
+}
+
+/**
+ * Process the servicenode and xrouter messages that don't need cs_main, on the peer's
+ * message worker if there are any.
+ */
+static void ProcessServiceNodeMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman)
+{
+    auto & smgr = sn::ServiceNodeMgr::instance();
+
+    if (strCommand == NetMsgType::SNREGISTER) { // handle snode registrations
+        // Registrations are validated and relayed on the servicenode check thread
+        const NodeId from = pfrom->GetId();
+        try {
+            if (!smgr.queueRegistration(vRecv, [connman,from](const sn::ServiceNode & snode) {
+                auto & smgr = sn::ServiceNodeMgr::instance();
+                // Send the ping out if we are a snode waiting for registration
+                if (smgr.hasActiveSn() && smgr.getActiveSn().keyId() == snode.getSnodePubKey().GetID()) {
+                    sn::ServiceNodeMgr::writeSnRegistration(snode);
+                    if (!smgr.sendPing(XROUTER_PROTOCOL_VERSION, xbridge::App::instance().myServicesJSON(), connman))
+                        LogPrintf("Service node ping failed after registration for %s\n", smgr.getActiveSn().alias);
+                }
+
+                // Relay packets
+                connman->ForEachNode([&](CNode* pnode) {
+                    if (pnode->GetId() == from || !pnode->fSuccessfullyConnected)
+                        return;
+                    const CNetMsgMaker msgMaker(pnode->GetSendVersion());
+                    connman->PushMessage(pnode, msgMaker.Make(NetMsgType::SNREGISTER, snode));
+                });
+            }))
+                return;
+        } catch (std::exception & e) {
+            LOCK(cs_main);
+            LogPrint(BCLog::NET, "servicenode packet from peer=%d %s processed with error: %s\n",
+                     pfrom->GetId(), pfrom->cleanSubVer, std::string(e.what()));
+            // bad packet, small penalty
+            Misbehaving(pfrom->GetId(), 10);
+            return;
+        }
+
+        return;
+    }
+
+    if (strCommand == NetMsgType::SNPING || strCommand == NetMsgType::SNPINGS) { // handle snode pings
+        // Pings are validated on the servicenode check thread and relayed on the inventory trickle
+        auto onValid = [connman](const sn::ServiceNodePing & ping) {
+            RelayServiceNodePing(ping, connman);
+
+            bool isReady = xrouter::App::isEnabled() && xrouter::App::instance().isReady();
+            if (isReady)
+                xrouter::App::instance().processConfigMessage(ping.getSnode());
+        };
+        try {
+            std::vector<sn::ServiceNodePing> pings;
+            if (strCommand == NetMsgType::SNPINGS) {
+                vRecv >> pings;
+            } else {
+                pings.resize(1);
+                vRecv >> pings.front();
+            }
+            // The sender knows these pings, don't send them back
+            for (const auto & ping : pings)
+                pfrom->AddInventoryKnown(CInv(MSG_SNPING, ping.getHash()));
+
+            if (pings.size() == 1) {
+                smgr.queuePing(pings.front(), onValid);
+            } else if (!smgr.queuePings(pings, onValid)) {
+                // oversized batch, small penalty
+                LOCK(cs_main);
+                Misbehaving(pfrom->GetId(), 10);
+            }
+        } catch (std::exception & e) {
+            LOCK(cs_main);
+            LogPrint(BCLog::NET, "servicenode packet from peer=%d %s processed with error: %s\n",
+                     pfrom->GetId(), pfrom->cleanSubVer, std::string(e.what()));
+            // bad packet, small penalty
+            Misbehaving(pfrom->GetId(), 10);
+            return;
+        }
+
+        return;
+    }
+
+    if (strCommand == NetMsgType::XROUTER) { // handle xrouter packets
+        bool isReady = xrouter::App::isEnabled() && xrouter::App::instance().isReady();
+        if (isReady) {
+            const CNetPayload raw = CNetPayload::FromStream(vRecv);
+            pfrom->nLastXRouter = GetSystemTimeInSeconds();
+            if (raw.size() < (20 + sizeof(time_t))) {
+                // bad packet, small penalty
+                LOCK(cs_main);
+                Misbehaving(pfrom->GetId(), 10);
+            } else {
+                try {
+                    xrouter::App::instance().onMessageReceived(pfrom, raw);
+                } catch (std::exception & e) {
+                    LOCK(cs_main);
+                    LogPrint(BCLog::XROUTER, "xrouter packet from peer=%d %s processed with error: %s\n",
+                             pfrom->GetId(), pfrom->cleanSubVer, std::string(e.what()));
+                    // bad packet, small penalty
+                    Misbehaving(pfrom->GetId(), 10);
+                }
+            }
+        }
+    }
+}
+
 bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, int64_t nTimeReceived, const CChainParams& chainparams, CConnman* connman, const std::atomic<bool>& interruptMsgProc, bool enable_bip61)
 {
     LogPrint(BCLog::NET, "received: %s (%u bytes) peer=%d\n", SanitizeString(strCommand), vRecv.size(), pfrom->GetId());
@@ -1772,6 +2320,11 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         if (!vRecv.empty())
             vRecv >> fXRouter;
         pfrom->fXRouter = fXRouter;
+        // XRouter peers don't take up the slots of relay peers, they have their own limit
+        if (fXRouter && pfrom->fInbound && !connman->AcceptXRouterPeer(pfrom)) {
+            pfrom->fDisconnect = true;
+            return false;
+        }
 
         // Disconnect if we connected to ourself
         if (pfrom->fInbound && !connman->CheckIncomingNonce(nNonce))
@@ -1914,6 +2467,14 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             // nodes)
             connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SENDHEADERS));
         }
+        if (pfrom->nVersion >= XBRIDGE_INV_VERSION) {
+            // Tell our peer we prefer xbridge packet announcements over full packets
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SENDXBINV));
+        }
+        if (pfrom->nVersion >= SNPING_BATCH_VERSION) {
+            // Tell our peer we prefer servicenode pings in batches
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SENDSNPINGS));
+        }
         if (pfrom->nVersion >= SHORT_IDS_BLOCKS_VERSION) {
             // Tell our peer we are willing to provide version 1 or 2 cmpctblocks
             // However, we do not request new block announcements using
@@ -1928,6 +2489,17 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SENDCMPCT, fAnnounceUsingCMPCTBLOCK, nCMPCTBLOCKVersion));
         }
         pfrom->fSuccessfullyConnected = true;
+        xrouter::App::instance().onNodeConnected(); // wake xrouter threads waiting for the connection
+
+        // Request the servicenodes that sent pings since the last list we received
+        if (!pfrom->fInbound && pfrom->nVersion >= SNLIST_VERSION) {
+            {
+                LOCK(cs_main);
+                State(pfrom->GetId())->nSnodeListRequested = chainActive.Height();
+            }
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETSNLIST, sn::ServiceNodeList::CURRENT_VERSION,
+                                                      static_cast<int32_t>(sn::ServiceNodeMgr::instance().getSnListHeight())));
+        }
 
         // Used for logging purposes, update the mean block height across connected nodes
         double meanHeights; int nodeCount;
@@ -2003,6 +2575,16 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         return true;
     }
 
+    if (strCommand == NetMsgType::SENDXBINV) {
+        pfrom->fPreferXBridgeInv = true;
+        return true;
+    }
+
+    if (strCommand == NetMsgType::SENDSNPINGS) {
+        pfrom->fPreferSnPingBatch = true;
+        return true;
+    }
+
     if (strCommand == NetMsgType::SENDCMPCT) {
         bool fAnnounceUsingCMPCTBLOCK = false;
         uint64_t nCMPCTBLOCKVersion = 0;
@@ -2070,6 +2652,12 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                     LogPrint(BCLog::NET, "getheaders (%d) %s to peer=%d\n", pindexBestHeader->nHeight, inv.hash.ToString(), pfrom->GetId());
                 }
             }
+            else if (inv.type == MSG_XBRIDGE)
+            {
+                pfrom->AddInventoryKnown(inv);
+                if (!fAlreadyHave)
+                    pfrom->AskFor(inv);
+            }
             else
             {
                 pfrom->AddInventoryKnown(inv);
@@ -2994,12 +3582,18 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
 
     // Servicenode related packet handling
     auto & smgr = sn::ServiceNodeMgr::instance();
-    auto & xapp = xbridge::App::instance();
 
     if (strCommand == NetMsgType::XBRIDGE) { // handle xbridge packets
-        std::vector<unsigned char> raw;
-        vRecv >> raw;
-        auto rawcopy = raw;
+        // Parsed in place by ProcessXBridgePacket and relayed as received, without copies
+        const CNetPayload raw = CNetPayload::FromStream(vRecv);
+
+        const uint256 hash = Hash(raw.begin(), raw.end());
+        pfrom->AddInventoryKnown(CInv(MSG_XBRIDGE, hash));
+        pfrom->setAskFor.erase(hash);
+        {
+            LOCK(cs_main);
+            mapAlreadyAskedFor.erase(hash);
+        }
 
         // Top-level validation checks
         if (raw.size() < (20 + sizeof(time_t))) {
@@ -3009,134 +3603,82 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             return true;
         }
 
-        int dos = 0;
-
-        try {
-            // Process xbridge packet
-            if (!smgr.processXBridge(raw))
-                return true;
-
-            CValidationState state;
-
-            // Pass packet to XBridge
-            if (xapp.isEnabled()) {
-                static std::vector<unsigned char> zero(20, 0);
-                std::vector<unsigned char> addr(raw.begin(), raw.begin()+20);
-                raw.erase(raw.begin(), raw.begin()+20); // remove addr from raw
-                raw.erase(raw.begin(), raw.begin()+sizeof(uint64_t)); // remove timestamp from raw
-                if (addr != zero)
-                    xapp.onMessageReceived(addr, raw, state);
-                else
-                    xapp.onBroadcastReceived(raw, state);
-
-                if (state.IsInvalid(dos)) {
-                    LogPrint(BCLog::XBRIDGE, "invalid xbridge packet from peer=%d %s : %s\n", pfrom->GetId(),
-                            pfrom->cleanSubVer, state.GetRejectReason());
-                    if (dos > 0)
-                        Misbehaving(pfrom->GetId(), dos);
-                }
-                else if (state.IsError()) {
-                    LogPrint(BCLog::XBRIDGE, "xbridge packet from peer=%d %s processed with error: %s\n",
-                             pfrom->GetId(), pfrom->cleanSubVer,
-                             state.GetRejectReason());
-                }
-            }
-        } catch (...) {
-            LogPrint(BCLog::XBRIDGE, "Fatal XBridge error detected");
-        }
-
-        // Relay xbridge packets only if state is good
-        if (dos <= 0) {
-            connman->ForEachNode([&](CNode *pnode) {
-                if (!pnode->fSuccessfullyConnected)
-                    return;
-                connman->PushMessage(pnode, msgMaker.Make(NetMsgType::XBRIDGE, rawcopy));
-            });
-        }
+        // A slow packet must not hold up block and tx relay of the other peers
+        std::function<void()> task = [pfrom, raw, hash, connman]() { ProcessXBridgePacket(pfrom, raw, hash, connman); };
+        if (!connman->QueuePeerTask(pfrom, strCommand, task))
+            task();
+        return true;
+    }
 
+    if (strCommand == NetMsgType::SNREGISTER || strCommand == NetMsgType::SNPING ||
+        strCommand == NetMsgType::SNPINGS || strCommand == NetMsgType::XROUTER)
+    {
+        auto vData = std::make_shared<CDataStream>(std::move(vRecv));
+        std::function<void()> task = [pfrom, strCommand, vData, connman]() { ProcessServiceNodeMessage(pfrom, strCommand, *vData, connman); };
+        if (!connman->QueuePeerTask(pfrom, strCommand, task))
+            task();
         return true;
     }
 
-    if (strCommand == NetMsgType::SNREGISTER) { // handle snode registrations
-        sn::ServiceNode snode;
-        try {
-            if (!smgr.processRegistration(vRecv, snode))
-                return true;
-        } catch (std::exception & e) {
-            LOCK(cs_main);
-            LogPrint(BCLog::NET, "servicenode packet from peer=%d %s processed with error: %s\n",
-                     pfrom->GetId(), pfrom->cleanSubVer, std::string(e.what()));
-            // bad packet, small penalty
-            Misbehaving(pfrom->GetId(), 10);
+    if (strCommand == NetMsgType::GETSNLIST) { // handle snode list requests
+        if (pfrom->nVersion < SNLIST_VERSION)
             return true;
+        uint8_t version{0};
+        int32_t since{0};
+        vRecv >> version >> since;
+        {
+            LOCK(cs_main);
+            CNodeState *state = State(pfrom->GetId());
+            if (state->fSentSnodeList) // only one list per peer
+                return true;
+            state->fSentSnodeList = true;
         }
-
-        // Send the ping out if we are a snode waiting for registration
-        if (smgr.hasActiveSn() && smgr.getActiveSn().keyId() == snode.getSnodePubKey().GetID()) {
-            sn::ServiceNodeMgr::writeSnRegistration(snode);
-            if (!smgr.sendPing(XROUTER_PROTOCOL_VERSION, xapp.myServicesJSON(), connman))
-                LogPrintf("Service node ping failed after registration for %s\n", smgr.getActiveSn().alias);
-        }
-
-        // Relay packets
-        connman->ForEachNode([&](CNode* pnode) {
-            if (pfrom == pnode)
-                return;
-            connman->PushMessage(pnode, msgMaker.Make(NetMsgType::SNREGISTER, snode));
-        });
-
+        if (version != sn::ServiceNodeList::CURRENT_VERSION)
+            return true;
+        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SNLIST, smgr.getSnList(std::max(since, 0))));
         return true;
     }
 
-    if (strCommand == NetMsgType::SNPING) { // handle snode pings
-        sn::ServiceNodePing ping;
-        try {
-            if (!smgr.processPing(vRecv, ping))
-                return true;
-        } catch (std::exception & e) {
+    if (strCommand == NetMsgType::SNLIST) { // handle snode lists
+        // Only lists we asked this peer for are accepted, once
+        int requestHeight{-1};
+        {
+            LOCK(cs_main);
+            CNodeState *state = State(pfrom->GetId());
+            requestHeight = state->nSnodeListRequested;
+            state->nSnodeListRequested = -1;
+        }
+        if (requestHeight < 0) {
+            LogPrint(BCLog::NET, "unrequested servicenode list from peer=%d\n", pfrom->GetId());
             LOCK(cs_main);
-            LogPrint(BCLog::NET, "servicenode packet from peer=%d %s processed with error: %s\n",
-                     pfrom->GetId(), pfrom->cleanSubVer, std::string(e.what()));
-            // bad packet, small penalty
             Misbehaving(pfrom->GetId(), 10);
             return true;
         }
+        // List pings are validated on the servicenode check thread, they are not relayed
+        if (!smgr.processSnList(vRecv, requestHeight, [](const sn::ServiceNodePing & ping) {
+            bool isReady = xrouter::App::isEnabled() && xrouter::App::instance().isReady();
+            if (isReady)
+                xrouter::App::instance().processConfigMessage(ping.getSnode());
+        })) {
+            // bad packet, small penalty
+            LOCK(cs_main);
+            Misbehaving(pfrom->GetId(), 10);
+        }
+        return true;
+    }
 
-        // Relay packets
-        connman->ForEachNode([&](CNode* pnode) {
-            if (pfrom == pnode)
-                return;
-            connman->PushMessage(pnode, msgMaker.Make(NetMsgType::SNPING, ping));
-        });
-
-        bool isReady = xrouter::App::isEnabled() && xrouter::App::instance().isReady();
-        if (isReady)
-            xrouter::App::instance().processConfigMessage(ping.getSnode());
+    if (strCommand == NetMsgType::GETCFILTERS) {
+        ProcessGetCFilters(pfrom, vRecv, chainparams, connman);
+        return true;
+    }
 
+    if (strCommand == NetMsgType::GETCFHEADERS) {
+        ProcessGetCFHeaders(pfrom, vRecv, chainparams, connman);
         return true;
     }
 
-    if (strCommand == NetMsgType::XROUTER) { // handle xrouter packets
-        bool isReady = xrouter::App::isEnabled() && xrouter::App::instance().isReady();
-        if (isReady) {
-            std::vector<unsigned char> raw;
-            vRecv >> raw;
-            if (raw.size() < (20 + sizeof(time_t))) {
-                // bad packet, small penalty
-                LOCK(cs_main);
-                Misbehaving(pfrom->GetId(), 10);
-            } else {
-                try {
-                    xrouter::App::instance().onMessageReceived(pfrom, raw);
-                } catch (std::exception & e) {
-                    LOCK(cs_main);
-                    LogPrint(BCLog::XROUTER, "xrouter packet from peer=%d %s processed with error: %s\n",
-                             pfrom->GetId(), pfrom->cleanSubVer, std::string(e.what()));
-                    // bad packet, small penalty
-                    Misbehaving(pfrom->GetId(), 10);
-                }
-            }
-        }
+    if (strCommand == NetMsgType::GETCFCHECKPT) {
+        ProcessGetCFCheckPt(pfrom, vRecv, chainparams, connman);
         return true;
     }
 
@@ -3215,6 +3757,10 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
     if (pfrom->fPauseSend)
         return false;
 
+    // Keep the order of the peer's messages, the worker wakes us once its task ran
+    if (pfrom->m_pending_tasks > 0)
+        return false;
+
     std::list<CNetMessage> msgs;
     {
         LOCK(pfrom->cs_vProcessMsg);
@@ -3260,8 +3806,12 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
         return fMoreWork;
     }
 
+    CNetMsgStats& msgStats = connman->GetMsgStats();
+    msgStats.RecordRecv(strCommand, nMessageSize + CMessageHeader::HEADER_SIZE);
+
     // Process message
     bool fRet = false;
+    const int64_t nProcessStart = GetTimeMicros();
     try
     {
         fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, chainparams, connman, interruptMsgProc, m_enable_bip61);
@@ -3301,6 +3851,8 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
         PrintExceptionContinue(nullptr, "ProcessMessages()");
     }
 
+    msgStats.RecordHandlerTime(strCommand, GetTimeMicros() - nProcessStart);
+
     if (!fRet) {
         LogPrint(BCLog::NET, "%s(%s, %u bytes) FAILED peer=%d\n", __func__, SanitizeString(strCommand), nMessageSize, pfrom->GetId());
     }
@@ -3854,6 +4406,50 @@ bool PeerLogicValidation::SendMessages(CNode* pto)
                     pto->filterInventoryKnown.insert(hash);
                 }
             }
+
+            // Announce xbridge packets, in the order they were relayed
+            if (fSendTrickle) {
+                for (const uint256& hash : pto->vInventoryXBridgeToSend) {
+                    if (pto->filterInventoryKnown.contains(hash))
+                        continue;
+                    vInv.push_back(CInv(MSG_XBRIDGE, hash));
+                    if (vInv.size() == MAX_INV_SZ) {
+                        connman->PushMessage(pto, msgMaker.Make(NetMsgType::INV, vInv));
+                        vInv.clear();
+                    }
+                    pto->filterInventoryKnown.insert(hash);
+                }
+                pto->vInventoryXBridgeToSend.clear();
+            }
+
+            // Send servicenode pings, batched for peers that sent sendsnps
+            if (fSendTrickle && !pto->vInventorySnPingToSend.empty()) {
+                std::vector<sn::ServiceNodePing> vPings;
+                size_t nBatchBytes{0};
+                LOCK(g_cs_snping_relay);
+                for (const uint256& hash : pto->vInventorySnPingToSend) {
+                    if (pto->filterInventoryKnown.contains(hash))
+                        continue;
+                    pto->filterInventoryKnown.insert(hash);
+                    auto mi = mapSnPingRelay.find(hash);
+                    if (mi == mapSnPingRelay.end()) // expired
+                        continue;
+                    if (!pto->fPreferSnPingBatch) {
+                        connman->PushMessage(pto, msgMaker.Make(NetMsgType::SNPING, mi->second));
+                        continue;
+                    }
+                    vPings.push_back(mi->second);
+                    nBatchBytes += ::GetSerializeSize(mi->second, PROTOCOL_VERSION);
+                    if (vPings.size() == sn::MAX_SNODE_PING_BATCH || nBatchBytes >= sn::MAX_SNODE_PING_BATCH_BYTES) {
+                        connman->PushMessage(pto, msgMaker.Make(NetMsgType::SNPINGS, vPings));
+                        vPings.clear();
+                        nBatchBytes = 0;
+                    }
+                }
+                pto->vInventorySnPingToSend.clear();
+                if (!vPings.empty())
+                    connman->PushMessage(pto, msgMaker.Make(NetMsgType::SNPINGS, vPings));
+            }
         }
         if (!vInv.empty())
             connman->PushMessage(pto, msgMaker.Make(NetMsgType::INV, vInv));
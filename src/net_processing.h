@@ -13,6 +13,8 @@
 
 extern CCriticalSection cs_main;
 
+namespace sn { class ServiceNodePing; }
+
 /** Increase a node's misbehavior score. */
 extern void Misbehaving(NodeId nodeid, int howmuch, const std::string& message="") EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
@@ -48,6 +50,10 @@ public:
      * Overridden from CValidationInterface.
      */
     void NewPoWValidBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& pblock) override;
+    /**
+     * Overridden from CValidationInterface.
+     */
+    std::string GetSubscriberName() const override { return "net_processing"; }
 
     /** Initialize a peer by adding it to mapNodeState and pushing a message requesting its version */
     void InitializeNode(CNode* pnode) override;
@@ -92,4 +98,18 @@ struct CNodeStateStats {
 /** Get statistics from node state */
 bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats);
 
+/**
+ * Relay an xbridge packet. Peers that sent sendxbinv get an inv announcement on the
+ * next inventory trickle and fetch the packet with getdata, others get the full packet.
+ * The packet is kept for getdata requests until it expires from the relay memory.
+ */
+void RelayXBridgePacket(const uint256& hash, const CNetPayload& raw, CConnman* connman);
+
+/**
+ * Relay a servicenode ping. The ping is queued for each peer that doesn't know it and sent
+ * on the peer's next inventory trickle, batched with the other queued pings (snps) for
+ * peers that sent sendsnps.
+ */
+void RelayServiceNodePing(const sn::ServiceNodePing& ping, CConnman* connman);
+
 #endif // BITCOIN_NET_PROCESSING_H
@@ -0,0 +1,176 @@
+// Copyright (c) 2010 Satoshi Nakamoto
+// Copyright (c) 2009-2018 The Bitcoin Core developers
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/coinstats.h>
+
+#include <coins.h>
+#include <crypto/muhash.h>
+#include <hash.h>
+#include <serialize.h>
+#include <shutdown.h>
+#include <streams.h>
+#include <sync.h>
+#include <txdb.h>
+#include <util/system.h>
+#include <validation.h>
+
+#include <atomic>
+#include <map>
+#include <thread>
+
+//! Ranges the coins are split into for the parallel scan, more than there are threads
+//! so that the threads finish at about the same time
+static const size_t UTXO_STATS_RANGES = 64;
+
+uint64_t GetBogoSize(const CScript& scriptPubKey)
+{
+    return 32 /* txid */ + 4 /* vout index */ + 4 /* height + coinbase */ + 8 /* amount */ +
+           2 /* scriptPubKey len */ + scriptPubKey.size() /* scriptPubKey */;
+}
+
+static void TxOutSer(CDataStream& ss, const COutPoint& outpoint, const Coin& coin)
+{
+    ss << outpoint;
+    ss << static_cast<uint32_t>(coin.nHeight * 2 + coin.fCoinBase);
+    ss << coin.out;
+}
+
+void ApplyCoinHash(MuHash3072& muhash, const COutPoint& outpoint, const Coin& coin)
+{
+    CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+    TxOutSer(ss, outpoint, coin);
+    muhash.Insert(reinterpret_cast<const unsigned char*>(ss.data()), ss.size());
+}
+
+void RemoveCoinHash(MuHash3072& muhash, const COutPoint& outpoint, const Coin& coin)
+{
+    CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+    TxOutSer(ss, outpoint, coin);
+    muhash.Remove(reinterpret_cast<const unsigned char*>(ss.data()), ss.size());
+}
+
+static void ApplyStats(CCoinsStats& stats, CHashWriter& ss, MuHash3072& muhash, const uint256& hash, const std::map<uint32_t, Coin>& outputs)
+{
+    assert(!outputs.empty());
+    if (stats.hash_type == CoinStatsHashType::HASH_SERIALIZED) {
+        ss << hash;
+        ss << VARINT(outputs.begin()->second.nHeight * 2 + outputs.begin()->second.fCoinBase ? 1u : 0u);
+    }
+    stats.nTransactions++;
+    for (const auto& output : outputs) {
+        if (stats.hash_type == CoinStatsHashType::HASH_SERIALIZED) {
+            ss << VARINT(output.first + 1);
+            ss << output.second.out.scriptPubKey;
+            ss << VARINT(output.second.out.nValue, VarIntMode::NONNEGATIVE_SIGNED);
+        } else if (stats.hash_type == CoinStatsHashType::MUHASH) {
+            ApplyCoinHash(muhash, COutPoint(hash, output.first), output.second);
+        }
+        stats.nTransactionOutputs++;
+        stats.nTotalAmount += output.second.out.nValue;
+        stats.nBogoSize += GetBogoSize(output.second.out.scriptPubKey);
+    }
+    if (stats.hash_type == CoinStatsHashType::HASH_SERIALIZED) {
+        ss << VARINT(0u);
+    }
+}
+
+//! Adds the coins of the cursor to the stats, a transaction's coins are next to each other
+static bool ScanCoins(CCoinsViewCursor* pcursor, CCoinsStats& stats, CHashWriter& ss, MuHash3072& muhash)
+{
+    uint256 prevkey;
+    std::map<uint32_t, Coin> outputs;
+    while (pcursor->Valid()) {
+        if (ShutdownRequested()) {
+            return false;
+        }
+        COutPoint key;
+        Coin coin;
+        if (pcursor->GetKey(key) && pcursor->GetValue(coin)) {
+            if (!outputs.empty() && key.hash != prevkey) {
+                ApplyStats(stats, ss, muhash, prevkey, outputs);
+                outputs.clear();
+            }
+            prevkey = key.hash;
+            outputs[key.n] = std::move(coin);
+        } else {
+            return error("%s: unable to read value", __func__);
+        }
+        pcursor->Next();
+    }
+    if (!outputs.empty()) {
+        ApplyStats(stats, ss, muhash, prevkey, outputs);
+    }
+    return true;
+}
+
+bool GetUTXOStats(CCoinsViewDB* view, CCoinsStats& stats)
+{
+    // The serialized hash depends on the order of the coins and can't be split up
+    const bool parallel = stats.hash_type != CoinStatsHashType::HASH_SERIALIZED;
+
+    std::vector<std::unique_ptr<CCoinsViewCursor>> cursors;
+    {
+        LOCK(cs_main);
+        // Flushed coins are written in the background, no write starts without cs_main
+        if (pcoinsflusher && !pcoinsflusher->Sync()) {
+            return error("%s: failed to write the coins database", __func__);
+        }
+        cursors = view->RangeCursors(parallel ? UTXO_STATS_RANGES : 1);
+        stats.hashBlock = cursors.front()->GetBestBlock();
+        stats.nHeight = LookupBlockIndex(stats.hashBlock)->nHeight;
+    }
+
+    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+    MuHash3072 muhash;
+    if (!parallel) {
+        ss << stats.hashBlock;
+        if (!ScanCoins(cursors.front().get(), stats, ss, muhash)) {
+            return false;
+        }
+        stats.hashSerialized = ss.GetHash();
+        stats.nDiskSize = view->EstimateSize();
+        return true;
+    }
+
+    std::vector<CCoinsStats> range_stats(cursors.size());
+    std::vector<MuHash3072> range_hashes(cursors.size());
+    for (auto& range : range_stats) {
+        range.hash_type = stats.hash_type;
+    }
+    std::atomic<size_t> next{0};
+    std::atomic<bool> failed{false};
+    auto worker = [&]() {
+        CHashWriter unused(SER_GETHASH, PROTOCOL_VERSION);
+        for (size_t i = next++; i < cursors.size() && !failed; i = next++) {
+            if (!ScanCoins(cursors[i].get(), range_stats[i], unused, range_hashes[i])) {
+                failed = true;
+            }
+        }
+    };
+    const size_t num_threads = std::min<size_t>(std::max(GetNumCores(), 1), cursors.size());
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < num_threads; ++t)
+        threads.emplace_back(worker);
+    worker();
+    for (auto& thread : threads)
+        thread.join();
+    if (failed) {
+        return false;
+    }
+
+    for (size_t i = 0; i < range_stats.size(); ++i) {
+        stats.nTransactions += range_stats[i].nTransactions;
+        stats.nTransactionOutputs += range_stats[i].nTransactionOutputs;
+        stats.nTotalAmount += range_stats[i].nTotalAmount;
+        stats.nBogoSize += range_stats[i].nBogoSize;
+        muhash *= range_hashes[i];
+    }
+    if (stats.hash_type == CoinStatsHashType::MUHASH) {
+        muhash.Finalize(stats.hashSerialized);
+    }
+    stats.nDiskSize = view->EstimateSize();
+    return true;
+}
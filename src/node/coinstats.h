@@ -0,0 +1,59 @@
+// Copyright (c) 2010 Satoshi Nakamoto
+// Copyright (c) 2009-2018 The Bitcoin Core developers
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_COINSTATS_H
+#define BITCOIN_NODE_COINSTATS_H
+
+#include <amount.h>
+#include <uint256.h>
+
+#include <cstdint>
+
+class CCoinsViewDB;
+class COutPoint;
+class Coin;
+class CScript;
+class MuHash3072;
+
+enum class CoinStatsHashType {
+    HASH_SERIALIZED, //!< Sha256 of the serialized coins in database order, can't be split up
+    MUHASH,          //!< MuHash3072 of the coins, independent of their order
+    NONE,
+};
+
+struct CCoinsStats
+{
+    CoinStatsHashType hash_type{CoinStatsHashType::HASH_SERIALIZED};
+    int nHeight{0};
+    uint256 hashBlock;
+    uint64_t nTransactions{0};
+    uint64_t nTransactionOutputs{0};
+    uint64_t nBogoSize{0};
+    uint256 hashSerialized;
+    uint64_t nDiskSize{0};
+    CAmount nTotalAmount{0};
+
+    //! The stats were read from the coinstats index, which doesn't count transactions
+    //! or know the size of the database
+    bool from_index{false};
+};
+
+/**
+ * Calculate statistics about the unspent transaction output set of the coins database.
+ * The coins are read from a snapshot of the database taken after pending flushes were
+ * written. Unless the serialized hash is asked for, the coins are split into ranges
+ * that are read in parallel.
+ */
+bool GetUTXOStats(CCoinsViewDB* view, CCoinsStats& stats);
+
+//! The bytes the coin adds to the UTXO set hash, see MuHash3072
+void ApplyCoinHash(MuHash3072& muhash, const COutPoint& outpoint, const Coin& coin);
+void RemoveCoinHash(MuHash3072& muhash, const COutPoint& outpoint, const Coin& coin);
+
+//! A meaningless metric for the UTXO set size, what the coin adds to nBogoSize
+uint64_t GetBogoSize(const CScript& scriptPubKey);
+
+#endif // BITCOIN_NODE_COINSTATS_H
@@ -0,0 +1,136 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/utxo_snapshot.h>
+
+#include <chain.h>
+#include <coins.h>
+#include <crypto/muhash.h>
+#include <governance/governance.h>
+#include <node/coinstats.h>
+#include <servicenode/servicenodemgr.h>
+#include <shutdown.h>
+#include <streams.h>
+#include <sync.h>
+#include <txdb.h>
+#include <util/system.h>
+#include <validation.h>
+#include <validationinterface.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+//! Times the state is copied again when the tip moved while waiting for the validation queue
+static const int SNAPSHOT_STATE_ATTEMPTS = 3;
+
+bool WriteChainSnapshot(const fs::path& path, SnapshotMetadata& metadata, SnapshotStats& stats, std::string& error)
+{
+    std::unique_ptr<CCoinsViewCursor> pcursor;
+    std::vector<SnapshotStakeModifier> modifiers;
+    std::map<uint256, gov::Proposal> proposals;
+    std::map<uint256, gov::Vote> votes;
+    std::vector<sn::ServiceNode> snodes;
+
+    for (int attempt = 0; !pcursor; ++attempt) {
+        if (attempt == SNAPSHOT_STATE_ATTEMPTS) {
+            error = "The chain tip kept changing, try again later";
+            return false;
+        }
+        uint256 tip_hash;
+        {
+            LOCK(cs_main);
+            tip_hash = chainActive.Tip()->GetBlockHash();
+        }
+        // Governance follows the chain on the validation interface
+        SyncWithValidationInterfaceQueue();
+
+        LOCK(cs_main);
+        const CBlockIndex* tip = chainActive.Tip();
+        if (tip->GetBlockHash() != tip_hash) {
+            continue;
+        }
+        FlushStateToDisk();
+        // Flushed coins are written in the background, no write starts without cs_main
+        if (pcoinsflusher && !pcoinsflusher->Sync()) {
+            error = "Failed to write the coins database";
+            return false;
+        }
+        pcursor.reset(pcoinsdbview->Cursor());
+        if (pcursor->GetBestBlock() != tip_hash) {
+            error = "The coins database doesn't match the chain tip";
+            return false;
+        }
+
+        metadata.base_blockhash = tip_hash;
+        metadata.base_height = tip->nHeight;
+        modifiers.clear();
+        for (const CBlockIndex* pindex = tip; pindex && tip->nHeight - pindex->nHeight < SNAPSHOT_STAKE_MODIFIER_BLOCKS; pindex = pindex->pprev) {
+            SnapshotStakeModifier modifier;
+            modifier.height = pindex->nHeight;
+            modifier.block_hash = pindex->GetBlockHash();
+            modifier.stake_modifier = pindex->nStakeModifier;
+            modifier.generated = pindex->GeneratedStakeModifier();
+            modifiers.push_back(modifier);
+        }
+        gov::Governance::instance().copyState(proposals, votes);
+        snodes = sn::ServiceNodeMgr::instance().list();
+    }
+
+    FILE* file = fsbridge::fopen(path, "wb");
+    CAutoFile afile(file, SER_DISK, CLIENT_VERSION);
+    if (afile.IsNull()) {
+        error = strprintf("Couldn't open file %s for writing", path.string());
+        return false;
+    }
+
+    MuHash3072 muhash;
+    try {
+        // The coins count and hash are written again once all coins were written
+        afile << metadata;
+        afile << modifiers;
+        afile << proposals;
+        afile << votes;
+        afile << snodes;
+
+        metadata.coins_count = 0;
+        while (pcursor->Valid()) {
+            if (ShutdownRequested()) {
+                error = "Shutting down";
+                return false;
+            }
+            COutPoint key;
+            Coin coin;
+            if (!pcursor->GetKey(key) || !pcursor->GetValue(coin)) {
+                error = "Unable to read the UTXO set";
+                return false;
+            }
+            afile << key;
+            afile << coin;
+            ApplyCoinHash(muhash, key, coin);
+            ++metadata.coins_count;
+            pcursor->Next();
+        }
+        muhash.Finalize(metadata.utxo_muhash);
+
+        if (fseek(afile.Get(), 0, SEEK_SET) != 0) {
+            error = "Couldn't rewind the snapshot file";
+            return false;
+        }
+        afile << metadata;
+    } catch (const std::exception& e) {
+        error = strprintf("Failed to write the snapshot: %s", e.what());
+        return false;
+    }
+    if (fflush(afile.Get()) != 0 || !FileCommit(afile.Get())) {
+        error = "Failed to commit the snapshot file";
+        return false;
+    }
+
+    stats.stake_modifiers = modifiers.size();
+    stats.proposals = proposals.size();
+    stats.votes = votes.size();
+    stats.servicenodes = snodes.size();
+    return true;
+}
@@ -0,0 +1,83 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_UTXO_SNAPSHOT_H
+#define BITCOIN_NODE_UTXO_SNAPSHOT_H
+
+#include <fs.h>
+#include <serialize.h>
+#include <uint256.h>
+
+#include <cstdint>
+#include <string>
+
+//! Blocks before the snapshot base whose stake modifiers are written, a day of blocks
+static const int SNAPSHOT_STAKE_MODIFIER_BLOCKS = 1440;
+
+/**
+ * The metadata at the start of a snapshot file. The file continues with the stake
+ * modifiers of the last blocks, the governance proposals and votes, the servicenode
+ * list and last the coins as (outpoint, coin) pairs.
+ */
+struct SnapshotMetadata
+{
+    static const uint16_t CURRENT_VERSION = 1;
+
+    uint16_t version{CURRENT_VERSION};
+    uint256 base_blockhash;
+    int base_height{0};
+    uint64_t coins_count{0};
+    //! MuHash3072 of the coins, see gettxoutsetinfo "muhash"
+    uint256 utxo_muhash;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(version);
+        READWRITE(base_blockhash);
+        READWRITE(base_height);
+        READWRITE(coins_count);
+        READWRITE(utxo_muhash);
+    }
+};
+
+//! The stake modifier of a block, kernels of the blocks after the base need them
+struct SnapshotStakeModifier
+{
+    int height{0};
+    uint256 block_hash;
+    uint64_t stake_modifier{0};
+    bool generated{false};
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(height);
+        READWRITE(block_hash);
+        READWRITE(stake_modifier);
+        READWRITE(generated);
+    }
+};
+
+//! What was written to the snapshot, besides its metadata
+struct SnapshotStats
+{
+    size_t stake_modifiers{0};
+    size_t proposals{0};
+    size_t votes{0};
+    size_t servicenodes{0};
+};
+
+/**
+ * Writes a snapshot of the chain state at the tip to the file: the coins database,
+ * the governance state and the servicenode list. The governance and servicenode state
+ * are copied under cs_main once the validation queue caught up with the tip, the coins
+ * are read from a snapshot of the database taken at the same time, so the tip can
+ * move on while the coins are written.
+ */
+bool WriteChainSnapshot(const fs::path& path, SnapshotMetadata& metadata, SnapshotStats& stats, std::string& error);
+
+#endif // BITCOIN_NODE_UTXO_SNAPSHOT_H
@@ -13,6 +13,8 @@
 #include <util/system.h>
 
 static constexpr double INF_FEERATE = 1e99;
+/** Smallest pending decay of the moving averages before it is applied to the stored values */
+static constexpr double MIN_DECAY_SCALE = 1e-9;
 
 std::string StringForFeeEstimateHorizon(FeeEstimateHorizon horizon) {
     static const std::map<FeeEstimateHorizon, std::string> horizon_strings = {
@@ -98,6 +100,11 @@ private:
 
     double decay;
 
+    // The moving averages above are stored undecayed, the tracked value is the stored
+    // value times decayScale. Decaying all averages on a new block only multiplies
+    // decayScale, new data points are added divided by it.
+    double decayScale;
+
     // Resolution (# of blocks) with which confirmations are tracked
     unsigned int scale;
 
@@ -110,6 +117,9 @@ private:
 
     void resizeInMemoryCounters(size_t newbuckets);
 
+    /** Apply decayScale to the stored averages and reset it, keeps the stored values in range */
+    void Rescale();
+
 public:
     /**
      * Create new TxConfirmStats. This is called by BlockPolicyEstimator's
@@ -178,6 +188,7 @@ TxConfirmStats::TxConfirmStats(const std::vector<double>& defaultBuckets,
     : buckets(defaultBuckets), bucketMap(defaultBucketMap)
 {
     decay = _decay;
+    decayScale = 1;
     assert(_scale != 0 && "_scale must be non-zero");
     scale = _scale;
     confAvg.resize(maxPeriods);
@@ -221,23 +232,34 @@ void TxConfirmStats::Record(int blocksToConfirm, double val)
         return;
     int periodsToConfirm = (blocksToConfirm + scale - 1)/scale;
     unsigned int bucketindex = bucketMap.lower_bound(val)->second;
+    const double weight = 1 / decayScale;
     for (size_t i = periodsToConfirm; i <= confAvg.size(); i++) {
-        confAvg[i - 1][bucketindex]++;
+        confAvg[i - 1][bucketindex] += weight;
     }
-    txCtAvg[bucketindex]++;
-    avg[bucketindex] += val;
+    txCtAvg[bucketindex] += weight;
+    avg[bucketindex] += val * weight;
 }
 
-void TxConfirmStats::UpdateMovingAverages()
+void TxConfirmStats::Rescale()
 {
     for (unsigned int j = 0; j < buckets.size(); j++) {
         for (unsigned int i = 0; i < confAvg.size(); i++)
-            confAvg[i][j] = confAvg[i][j] * decay;
+            confAvg[i][j] = confAvg[i][j] * decayScale;
         for (unsigned int i = 0; i < failAvg.size(); i++)
-            failAvg[i][j] = failAvg[i][j] * decay;
-        avg[j] = avg[j] * decay;
-        txCtAvg[j] = txCtAvg[j] * decay;
+            failAvg[i][j] = failAvg[i][j] * decayScale;
+        avg[j] = avg[j] * decayScale;
+        txCtAvg[j] = txCtAvg[j] * decayScale;
     }
+    decayScale = 1;
+}
+
+void TxConfirmStats::UpdateMovingAverages()
+{
+    decayScale *= decay;
+    // Fold the scale into the stored values once in a while (every few hundred
+    // blocks for the shortest horizon) before the weights of new data grow large
+    if (decayScale < MIN_DECAY_SCALE)
+        Rescale();
 }
 
 // returns -1 on error conditions
@@ -285,9 +307,9 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
             newBucketRange = false;
         }
         curFarBucket = bucket;
-        nConf += confAvg[periodTarget - 1][bucket];
-        totalNum += txCtAvg[bucket];
-        failNum += failAvg[periodTarget - 1][bucket];
+        nConf += confAvg[periodTarget - 1][bucket] * decayScale;
+        totalNum += txCtAvg[bucket] * decayScale;
+        failNum += failAvg[periodTarget - 1][bucket] * decayScale;
         for (unsigned int confct = confTarget; confct < GetMaxConfirms(); confct++)
             extraNum += unconfTxs[(nBlockHeight - confct)%bins][bucket];
         extraNum += oldUnconfTxs[bucket];
@@ -395,12 +417,25 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
 
 void TxConfirmStats::Write(CAutoFile& fileout) const
 {
+    // The file holds the decayed averages
+    auto decayed = [this](std::vector<double> values) {
+        for (double& value : values)
+            value *= decayScale;
+        return values;
+    };
+    auto decayedPeriods = [&decayed](const std::vector<std::vector<double>>& periods) {
+        std::vector<std::vector<double>> values;
+        values.reserve(periods.size());
+        for (const auto& period : periods)
+            values.push_back(decayed(period));
+        return values;
+    };
     fileout << decay;
     fileout << scale;
-    fileout << avg;
-    fileout << txCtAvg;
-    fileout << confAvg;
-    fileout << failAvg;
+    fileout << decayed(avg);
+    fileout << decayed(txCtAvg);
+    fileout << decayedPeriods(confAvg);
+    fileout << decayedPeriods(failAvg);
 }
 
 void TxConfirmStats::Read(CAutoFile& filein, int nFileVersion, size_t numBuckets)
@@ -419,6 +454,7 @@ void TxConfirmStats::Read(CAutoFile& filein, int nFileVersion, size_t numBuckets
     if (scale == 0) {
         throw std::runtime_error("Corrupt estimates file. Scale must be non-zero");
     }
+    decayScale = 1;
 
     filein >> avg;
     if (avg.size() != numBuckets) {
@@ -498,8 +534,9 @@ void TxConfirmStats::removeTx(unsigned int entryHeight, unsigned int nBestSeenHe
     if (!inBlock && (unsigned int)blocksAgo >= scale) { // Only counts as a failure if not confirmed for entire period
         assert(scale != 0);
         unsigned int periodsAgo = blocksAgo / scale;
+        const double weight = 1 / decayScale;
         for (size_t i = 0; i < periodsAgo && i < failAvg.size(); i++) {
-            failAvg[i][bucketindex]++;
+            failAvg[i][bucketindex] += weight;
         }
     }
 }
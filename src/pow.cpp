@@ -96,7 +96,7 @@ bool CheckProofOfWork(uint256 hash, unsigned int nBits, const Consensus::Params&
     return true;
 }
 
-bool CheckPoS(const CBlockHeader & block, CValidationState & state, uint256 & hashProofOfStake, const Consensus::Params & params)
+bool CheckPoS(const CBlockHeader & block, const uint256 & blockHash, CValidationState & state, uint256 & hashProofOfStake, const Consensus::Params & params)
 {
     // Get prev block index
     CBlockIndex *pindexPrev = nullptr;
@@ -128,7 +128,7 @@ bool CheckPoS(const CBlockHeader & block, CValidationState & state, uint256 & ha
         return error("%s : incorrect work at %d", __func__, currentHeight);
     }
 
-    if (!CheckProofOfStake(block, pindexPrev, hashProofOfStake, params)) {
+    if (!CheckProofOfStake(block, blockHash, pindexPrev, hashProofOfStake, params)) {
         state.DoS(50, false, REJECT_INVALID, "bad-stake", false, "bad pow or pos block");
         return false;
     }
@@ -23,7 +23,7 @@ unsigned int CalculateNextWorkRequired(const CBlockIndex* pindexLast, int64_t nF
 /** Check whether a block hash satisfies the proof-of-work requirement specified by nBits */
 bool CheckProofOfWork(uint256 hash, unsigned int nBits, const Consensus::Params&);
 
-bool CheckPoS(const CBlockHeader & block, CValidationState & state, uint256 & hashProofOfStake, const Consensus::Params &);
+bool CheckPoS(const CBlockHeader & block, const uint256 & blockHash, CValidationState & state, uint256 & hashProofOfStake, const Consensus::Params &);
 unsigned int BlocknetGetNextWorkRequired(const CBlockIndex* pindexLast, const Consensus::Params& params);
 
 #endif // BITCOIN_POW_H
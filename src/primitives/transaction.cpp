@@ -79,6 +79,7 @@ uint256 CTransaction::ComputeWitnessHash() const
 CTransaction::CTransaction() : vin(), vout(), nVersion(CTransaction::CURRENT_VERSION), nLockTime(0), hash{}, m_witness_hash{} {}
 CTransaction::CTransaction(const CMutableTransaction& tx) : vin(tx.vin), vout(tx.vout), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash{ComputeHash()}, m_witness_hash{ComputeWitnessHash()} {}
 CTransaction::CTransaction(CMutableTransaction&& tx) : vin(std::move(tx.vin)), vout(std::move(tx.vout)), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash{ComputeHash()}, m_witness_hash{ComputeWitnessHash()} {}
+CTransaction::CTransaction(CHashedMutableTransaction&& htx) : vin(std::move(htx.tx.vin)), vout(std::move(htx.tx.vout)), nVersion(htx.tx.nVersion), nLockTime(htx.tx.nLockTime), hash{htx.hash}, m_witness_hash{htx.witness_hash} {}
 
 CAmount CTransaction::GetValueOut() const
 {
@@ -8,6 +8,7 @@
 
 #include <stdint.h>
 #include <amount.h>
+#include <hash.h>
 #include <script/script.h>
 #include <serialize.h>
 #include <uint256.h>
@@ -259,6 +260,102 @@ inline void SerializeTransaction(const TxType& tx, Stream& s) {
     s << tx.nLockTime;
 }
 
+/** Reads from the underlying stream while hashing the bytes read, so that a deserialized
+ *  transaction's hashes don't need a second serialization pass. */
+template<typename Source>
+class CTxHashingReader
+{
+private:
+    Source* source;
+
+public:
+    CHash256 txid;
+    CHash256 wtxid;
+    bool fHashTxid{true};
+    bool fHashWtxid{false};
+
+    explicit CTxHashingReader(Source* source_) : source(source_) {}
+
+    int GetType() const { return source->GetType(); }
+    int GetVersion() const { return source->GetVersion(); }
+
+    void read(char* pch, size_t nSize)
+    {
+        source->read(pch, nSize);
+        if (fHashTxid)
+            txid.Write((const unsigned char*)pch, nSize);
+        if (fHashWtxid)
+            wtxid.Write((const unsigned char*)pch, nSize);
+    }
+
+    template<typename T>
+    CTxHashingReader<Source>& operator>>(T&& obj)
+    {
+        // Unserialize from this stream
+        ::Unserialize(*this, obj);
+        return (*this);
+    }
+};
+
+/**
+ * Same as UnserializeTransaction, additionally computes the txid and witness hash from the
+ * bytes read. The txid excludes the extended format's dummy, flags and witnesses, the witness
+ * hash is only computed when the transaction has witnesses and is the txid otherwise.
+ */
+template<typename Stream, typename TxType>
+inline void UnserializeTransactionHashed(TxType& tx, Stream& stream, uint256& hash, uint256& witness_hash) {
+    const bool fAllowWitness = !(stream.GetVersion() & SERIALIZE_TRANSACTION_NO_WITNESS);
+    CTxHashingReader<Stream> s(&stream);
+
+    s >> tx.nVersion;
+    const CHash256 afterVersion = s.txid;
+    unsigned char flags = 0;
+    tx.vin.clear();
+    tx.vout.clear();
+    /* Try to read the vin. In case the dummy is there, this will be read as an empty vector. */
+    s >> tx.vin;
+    if (tx.vin.size() == 0 && fAllowWitness) {
+        /* We read a dummy or an empty vin. */
+        s >> flags;
+        if (flags != 0) {
+            /* Extended format: the dummy and flags are part of the witness hash only */
+            s.wtxid = s.txid;
+            s.txid = afterVersion;
+            s.fHashWtxid = true;
+            s >> tx.vin;
+            s >> tx.vout;
+        }
+    } else {
+        /* We read a non-empty vin. Assume a normal vout follows. */
+        s >> tx.vout;
+    }
+    if ((flags & 1) && fAllowWitness) {
+        /* The witness flag is present, and we support witnesses. */
+        flags ^= 1;
+        s.fHashTxid = false;
+        for (size_t i = 0; i < tx.vin.size(); i++) {
+            s >> tx.vin[i].scriptWitness.stack;
+        }
+        s.fHashTxid = true;
+    }
+    if (flags) {
+        /* Unknown flag in the serialization */
+        throw std::ios_base::failure("Unknown transaction optional data");
+    }
+    s >> tx.nLockTime;
+
+    s.txid.Finalize(hash.begin());
+    if (tx.HasWitness())
+        s.wtxid.Finalize(witness_hash.begin());
+    else
+        witness_hash = hash;
+}
+
+/** A transaction deserialized by UnserializeTransactionHashed together with its hashes. */
+struct CHashedMutableTransaction;
+
+template<typename Stream>
+CHashedMutableTransaction UnserializeHashedMutableTransaction(Stream& s);
 
 /** The basic transaction that is broadcasted on the network and contained in
  * blocks.  A transaction can contain multiple inputs and outputs.
@@ -306,10 +403,14 @@ public:
         SerializeTransaction(*this, s);
     }
 
+    /** Takes over a deserialized transaction and the hashes of the bytes it was read from. */
+    explicit CTransaction(CHashedMutableTransaction&& tx);
+
     /** This deserializing constructor is provided instead of an Unserialize method.
-     *  Unserialize is not possible, since it would require overwriting const fields. */
+     *  Unserialize is not possible, since it would require overwriting const fields.
+     *  The hashes are computed from the bytes read. */
     template <typename Stream>
-    CTransaction(deserialize_type, Stream& s) : CTransaction(CMutableTransaction(deserialize, s)) {}
+    CTransaction(deserialize_type, Stream& s) : CTransaction(UnserializeHashedMutableTransaction(s)) {}
 
     bool IsNull() const {
         return vin.empty() && vout.empty();
@@ -408,6 +509,21 @@ struct CMutableTransaction
     }
 };
 
+struct CHashedMutableTransaction
+{
+    CMutableTransaction tx;
+    uint256 hash;
+    uint256 witness_hash;
+};
+
+template<typename Stream>
+CHashedMutableTransaction UnserializeHashedMutableTransaction(Stream& s)
+{
+    CHashedMutableTransaction htx;
+    UnserializeTransactionHashed(htx.tx, s, htx.hash, htx.witness_hash);
+    return htx;
+}
+
 typedef std::shared_ptr<const CTransaction> CTransactionRef;
 static inline CTransactionRef MakeTransactionRef() { return std::make_shared<const CTransaction>(); }
 template <typename Tx> static inline CTransactionRef MakeTransactionRef(Tx&& txIn) { return std::make_shared<const CTransaction>(std::forward<Tx>(txIn)); }
@@ -0,0 +1,295 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <profiler.h>
+
+#include <sync.h>
+#include <tinyformat.h>
+#include <util/memory.h>
+#include <util/time.h>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__) && (defined(__x86_64__) || defined(__aarch64__))
+#define PROFILER_SUPPORTED 1
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <ucontext.h>
+#include <unistd.h>
+#endif
+
+#ifdef PROFILER_SUPPORTED
+namespace {
+
+//! Deepest stack recorded, deeper frames are cut off
+static const size_t MAX_FRAMES = 64;
+//! Samples buffered between two drains of the collector thread
+static const size_t SAMPLE_SLOTS = 4096;
+//! Largest frame size accepted while unwinding, larger steps end the walk
+static const uintptr_t MAX_FRAME_SIZE = 1 << 20;
+
+enum SlotState : int { SLOT_FREE, SLOT_WRITING, SLOT_READY };
+
+/** Stack of one sample, written by the signal handler and read by the collector thread */
+struct Sample {
+    std::atomic<int> state{SLOT_FREE};
+    char thread[16];
+    size_t depth{0};
+    uintptr_t frames[MAX_FRAMES];
+};
+
+Sample g_samples[SAMPLE_SLOTS];
+std::atomic<size_t> g_next_slot{0};
+std::atomic<uint64_t> g_dropped{0};
+std::atomic<bool> g_sampling{false};
+pid_t g_pid{0};
+
+/** Reads the frame record at fp, fails instead of faulting if fp isn't readable */
+bool ReadFrameRecord(uintptr_t fp, uintptr_t record[2])
+{
+    struct iovec local{record, 2 * sizeof(uintptr_t)};
+    struct iovec remote{reinterpret_cast<void*>(fp), 2 * sizeof(uintptr_t)};
+    return process_vm_readv(g_pid, &local, 1, &remote, 1, 0) == static_cast<ssize_t>(2 * sizeof(uintptr_t));
+}
+
+/** SIGPROF handler, only uses async-signal-safe calls */
+void ProfilerSignalHandler(int, siginfo_t*, void* context)
+{
+    if (!g_sampling.load(std::memory_order_relaxed))
+        return;
+    const int saved_errno = errno;
+    Sample& sample = g_samples[g_next_slot.fetch_add(1, std::memory_order_relaxed) % SAMPLE_SLOTS];
+    int expected = SLOT_FREE;
+    if (!sample.state.compare_exchange_strong(expected, SLOT_WRITING, std::memory_order_acquire)) {
+        g_dropped.fetch_add(1, std::memory_order_relaxed);
+        errno = saved_errno;
+        return;
+    }
+    if (prctl(PR_GET_NAME, sample.thread, 0, 0, 0) != 0)
+        sample.thread[0] = '\0';
+
+    const ucontext_t* uc = static_cast<const ucontext_t*>(context);
+#if defined(__x86_64__)
+    const uintptr_t pc = uc->uc_mcontext.gregs[REG_RIP];
+    const uintptr_t sp = uc->uc_mcontext.gregs[REG_RSP];
+    uintptr_t fp = uc->uc_mcontext.gregs[REG_RBP];
+#else
+    const uintptr_t pc = uc->uc_mcontext.pc;
+    const uintptr_t sp = uc->uc_mcontext.sp;
+    uintptr_t fp = uc->uc_mcontext.regs[29];
+#endif
+    size_t depth = 0;
+    sample.frames[depth++] = pc;
+    // Each frame record holds the frame pointer of the caller followed by the return address
+    while (depth < MAX_FRAMES && fp >= sp && fp % sizeof(uintptr_t) == 0) {
+        uintptr_t record[2];
+        if (!ReadFrameRecord(fp, record) || record[1] == 0)
+            break;
+        sample.frames[depth++] = record[1];
+        if (record[0] <= fp || record[0] - fp > MAX_FRAME_SIZE)
+            break;
+        fp = record[0];
+    }
+    sample.depth = depth;
+    sample.state.store(SLOT_READY, std::memory_order_release);
+    errno = saved_errno;
+}
+
+/** Samples aggregated by thread name and stack */
+typedef std::map<std::string, std::map<std::vector<uintptr_t>, uint64_t>> StackCounts;
+
+struct ProfilerRun {
+    std::thread collector;
+    std::atomic<bool> stop{false};
+    StackCounts stacks; // only used by the collector until it is joined
+    uint64_t samples{0};
+    int64_t start{0};
+
+    void Drain()
+    {
+        for (Sample& sample : g_samples) {
+            if (sample.state.load(std::memory_order_acquire) != SLOT_READY)
+                continue;
+            const std::string thread = sample.thread[0] ? std::string(sample.thread) : std::string("unnamed");
+            ++stacks[thread][std::vector<uintptr_t>(sample.frames, sample.frames + sample.depth)];
+            ++samples;
+            sample.state.store(SLOT_FREE, std::memory_order_release);
+        }
+    }
+};
+
+Mutex g_profiler_mutex;
+std::unique_ptr<ProfilerRun> g_run GUARDED_BY(g_profiler_mutex);
+
+std::string Symbolize(uintptr_t addr, std::map<uintptr_t, std::string>& cache)
+{
+    auto it = cache.find(addr);
+    if (it != cache.end())
+        return it->second;
+    std::string name;
+    Dl_info info;
+    if (dladdr(reinterpret_cast<void*>(addr), &info) && info.dli_sname) {
+        int status{0};
+        char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+        name = status == 0 && demangled ? demangled : info.dli_sname;
+        free(demangled);
+    } else if (info.dli_fname) {
+        // Unexported symbol, the module offset can be resolved with addr2line
+        const std::string module = info.dli_fname;
+        name = strprintf("%s+0x%x", module.substr(module.find_last_of('/') + 1), addr - reinterpret_cast<uintptr_t>(info.dli_fbase));
+    } else {
+        name = strprintf("0x%x", addr);
+    }
+    for (char& c : name) {
+        if (c == ';' || c == '\n')
+            c = ':';
+    }
+    cache.emplace(addr, name);
+    return name;
+}
+
+} // namespace
+#endif // PROFILER_SUPPORTED
+
+bool ProfilerSupported()
+{
+#ifdef PROFILER_SUPPORTED
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool ProfilerRunning()
+{
+#ifdef PROFILER_SUPPORTED
+    LOCK(g_profiler_mutex);
+    return g_run != nullptr;
+#else
+    return false;
+#endif
+}
+
+bool StartProfiler(int frequency, std::string& error)
+{
+#ifdef PROFILER_SUPPORTED
+    if (frequency < 1 || frequency > MAX_PROFILE_FREQUENCY) {
+        error = strprintf("frequency must be between 1 and %d", MAX_PROFILE_FREQUENCY);
+        return false;
+    }
+    LOCK(g_profiler_mutex);
+    if (g_run) {
+        error = "profiler is already running";
+        return false;
+    }
+    g_pid = getpid();
+    g_dropped = 0;
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = ProfilerSignalHandler;
+    sa.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGPROF, &sa, nullptr) != 0) {
+        error = strprintf("unable to install the SIGPROF handler: %s", strerror(errno));
+        return false;
+    }
+
+    auto run = MakeUnique<ProfilerRun>();
+    run->start = GetTime();
+    ProfilerRun* prun = run.get();
+    run->collector = std::thread([prun] {
+        while (!prun->stop) {
+            prun->Drain();
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    });
+    g_sampling = true;
+
+    struct itimerval timer;
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = 1000000 / frequency;
+    timer.it_value = timer.it_interval;
+    if (setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+        error = strprintf("unable to start the profiling timer: %s", strerror(errno));
+        g_sampling = false;
+        run->stop = true;
+        run->collector.join();
+        return false;
+    }
+    g_run = std::move(run);
+    return true;
+#else
+    error = "the profiler is not supported on this platform";
+    return false;
+#endif
+}
+
+bool StopProfiler(const fs::path& path, ProfileResult& result, std::string& error)
+{
+#ifdef PROFILER_SUPPORTED
+    std::unique_ptr<ProfilerRun> run;
+    {
+        LOCK(g_profiler_mutex);
+        if (!g_run) {
+            error = "profiler is not running";
+            return false;
+        }
+        run = std::move(g_run);
+    }
+
+    struct itimerval timer;
+    memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    g_sampling = false;
+    // Signals that are still pending find g_sampling unset, ignore later ones
+    signal(SIGPROF, SIG_IGN);
+    run->stop = true;
+    run->collector.join();
+    // Let handlers that were interrupted mid sample finish before the last drain
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    run->Drain();
+
+    result.path = path;
+    result.samples = run->samples;
+    result.dropped = g_dropped;
+    result.duration = GetTime() - run->start;
+
+    fsbridge::ofstream file(path);
+    if (!file.is_open()) {
+        error = strprintf("unable to open %s", path.string());
+        return false;
+    }
+    std::map<uintptr_t, std::string> symbols;
+    for (const auto& thread : run->stacks) {
+        for (const auto& stack : thread.second) {
+            std::string line = thread.first;
+            // Frames are recorded innermost first, return addresses point past the call
+            for (size_t i = stack.first.size(); i-- > 0; )
+                line += ";" + Symbolize(i == 0 ? stack.first[i] : stack.first[i] - 1, symbols);
+            file << line << " " << stack.second << "\n";
+        }
+    }
+    file.close();
+    if (file.fail()) {
+        error = strprintf("unable to write %s", path.string());
+        return false;
+    }
+    return true;
+#else
+    error = "the profiler is not supported on this platform";
+    return false;
+#endif
+}
@@ -0,0 +1,43 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_PROFILER_H
+#define BITCOIN_PROFILER_H
+
+#include <fs.h>
+
+#include <cstdint>
+#include <string>
+
+static const int DEFAULT_PROFILE_FREQUENCY = 99;
+static const int MAX_PROFILE_FREQUENCY = 1000;
+
+/** Result of a profiling run */
+struct ProfileResult {
+    fs::path path;
+    uint64_t samples{0};
+    uint64_t dropped{0}; // samples lost because the sample buffer was full
+    int64_t duration{0}; // seconds
+};
+
+/** Returns true if the sampling profiler is supported on this platform */
+bool ProfilerSupported();
+
+/** Returns true if a profiling run is in progress */
+bool ProfilerRunning();
+
+/**
+ * Starts sampling the stacks of the threads that use CPU time, frequency times per
+ * second of CPU time, using SIGPROF and frame pointer unwinding. Stacks are only
+ * complete in builds with -fno-omit-frame-pointer.
+ */
+bool StartProfiler(int frequency, std::string& error);
+
+/**
+ * Stops sampling and writes the samples to path in the collapsed stack format of
+ * flamegraph.pl, one "thread;outer;...;inner count" line per distinct stack.
+ */
+bool StopProfiler(const fs::path& path, ProfileResult& result, std::string& error);
+
+#endif // BITCOIN_PROFILER_H
@@ -44,7 +44,18 @@ const char *BLOCKTXN="blocktxn";
 const char *XBRIDGE="xbridge";
 const char *SNREGISTER="snr";
 const char *SNPING="snp";
+const char *GETSNLIST="getsnl";
+const char *SNLIST="snl";
 const char *XROUTER="xrouter";
+const char *SENDXBINV="sendxbinv";
+const char *SNPINGS="snps";
+const char *SENDSNPINGS="sendsnps";
+const char *GETCFILTERS="getcfilters";
+const char *CFILTER="cfilter";
+const char *GETCFHEADERS="getcfheaders";
+const char *CFHEADERS="cfheaders";
+const char *GETCFCHECKPT="getcfcheckpt";
+const char *CFCHECKPT="cfcheckpt";
 } // namespace NetMsgType
 
 /** All known message types. Keep this in the same order as the list of
@@ -80,7 +91,18 @@ const static std::string allNetMessageTypes[] = {
     NetMsgType::XBRIDGE,
     NetMsgType::SNREGISTER,
     NetMsgType::SNPING,
+    NetMsgType::GETSNLIST,
+    NetMsgType::SNLIST,
     NetMsgType::XROUTER,
+    NetMsgType::SENDXBINV,
+    NetMsgType::SNPINGS,
+    NetMsgType::SENDSNPINGS,
+    NetMsgType::GETCFILTERS,
+    NetMsgType::CFILTER,
+    NetMsgType::GETCFHEADERS,
+    NetMsgType::CFHEADERS,
+    NetMsgType::GETCFCHECKPT,
+    NetMsgType::CFCHECKPT,
 };
 const static std::vector<std::string> allNetMessageTypesVec(allNetMessageTypes, allNetMessageTypes+ARRAYLEN(allNetMessageTypes));
 
@@ -193,6 +215,8 @@ std::string CInv::GetCommand() const
     case MSG_BLOCK:          return cmd.append(NetMsgType::BLOCK);
     case MSG_FILTERED_BLOCK: return cmd.append(NetMsgType::MERKLEBLOCK);
     case MSG_CMPCT_BLOCK:    return cmd.append(NetMsgType::CMPCTBLOCK);
+    case MSG_XBRIDGE:        return cmd.append(NetMsgType::XBRIDGE);
+    case MSG_SNPING:         return cmd.append(NetMsgType::SNPING);
     default:
         throw std::out_of_range(strprintf("CInv::GetCommand(): type=%d unknown type", type));
     }
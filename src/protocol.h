@@ -253,11 +253,77 @@ extern const char *SNREGISTER;
  * @since protocol version 70713
  */
 extern const char *SNPING;
+/**
+ * Requests the Service Node list, only pings reporting a best block after
+ * the specified block are sent. Only sent to peers of SNLIST_VERSION or
+ * later, earlier releases of that version ignore it.
+ * @since protocol version 70713 (SNLIST_VERSION)
+ */
+extern const char *GETSNLIST;
+/**
+ * Contains the Service Node list, sent once in response to a getsnl message.
+ * Lists that weren't requested are rejected.
+ * @since protocol version 70713 (SNLIST_VERSION)
+ */
+extern const char *SNLIST;
 /**
  * Contains an XRouter message.
  * @since protocol version 70712
  */
 extern const char *XROUTER;
+/**
+ * Indicates that a node prefers to receive new xbridge packets by inv
+ * announcement instead of the full packet.
+ * @since protocol version 70713
+ */
+extern const char *SENDXBINV;
+/**
+ * Contains a batch of Service Node pings.
+ * @since protocol version 70713
+ */
+extern const char *SNPINGS;
+/**
+ * Indicates that a node prefers to receive servicenode pings in batches (snps)
+ * instead of one message per ping.
+ * @since protocol version 70713
+ */
+extern const char *SENDSNPINGS;
+/**
+ * getcfilters requests compact filters for a range of blocks.
+ * Only available with service bit NODE_COMPACT_FILTERS as described by
+ * BIP 157 & 158.
+ */
+extern const char *GETCFILTERS;
+/**
+ * cfilter is a response to a getcfilters request containing a single compact
+ * filter.
+ */
+extern const char *CFILTER;
+/**
+ * getcfheaders requests a compact filter header and the filter hashes for a
+ * range of blocks, which can then be used to reconstruct the filter headers
+ * for those blocks.
+ * Only available with service bit NODE_COMPACT_FILTERS as described by
+ * BIP 157 & 158.
+ */
+extern const char *GETCFHEADERS;
+/**
+ * cfheaders is a response to a getcfheaders request containing a filter header
+ * and a vector of filter hashes for each subsequent block in the requested range.
+ */
+extern const char *CFHEADERS;
+/**
+ * getcfcheckpt requests evenly spaced compact filter headers, enabling
+ * parallelized download and validation of the headers between them.
+ * Only available with service bit NODE_COMPACT_FILTERS as described by
+ * BIP 157 & 158.
+ */
+extern const char *GETCFCHECKPT;
+/**
+ * cfcheckpt is a response to a getcfcheckpt request containing a vector of
+ * evenly spaced filter headers for blocks on the requested chain.
+ */
+extern const char *CFCHECKPT;
 };
 
 /* Get a vector of all valid message types (see above) */
@@ -284,6 +350,9 @@ enum ServiceFlags : uint64_t {
     // NODE_XTHIN means the node supports Xtreme Thinblocks
     // If this is turned off then the node will not service nor make xthin requests
     NODE_XTHIN = (1 << 4),
+    // NODE_COMPACT_FILTERS means the node will service basic block filter requests.
+    // See BIP157 and BIP158 for details on how this is implemented.
+    NODE_COMPACT_FILTERS = (1 << 6),
     // NODE_NETWORK_LIMITED means the same as NODE_NETWORK with the limitation of only
     // serving the last 288 (2 day) blocks
     // See BIP159 for details on how this is implemented.
@@ -399,6 +468,8 @@ enum GetDataMsg
     MSG_WITNESS_BLOCK = MSG_BLOCK | MSG_WITNESS_FLAG, //!< Defined in BIP144
     MSG_WITNESS_TX = MSG_TX | MSG_WITNESS_FLAG,       //!< Defined in BIP144
     MSG_FILTERED_WITNESS_BLOCK = MSG_FILTERED_BLOCK | MSG_WITNESS_FLAG,
+    MSG_XBRIDGE = 64,        //!< XBridge packet, identified by the hash of the raw packet
+    MSG_SNPING = 65,         //!< Servicenode ping, only used to track relay, pings are never announced with inv
 };
 
 /** inv message data */
@@ -5,13 +5,20 @@
 #include <qt/blocknetcoincontrol.h>
 
 #include <qt/blocknetguiutil.h>
+#include <qt/blocknetmodelworker.h>
 
 #include <qt/addresstablemodel.h>
 #include <qt/bitcoinunits.h>
 #include <qt/optionsmodel.h>
 
+#include <interfaces/wallet.h>
 #include <key_io.h>
 #include <uint256.h>
+#include <wallet/wallet.h>
+
+#include <algorithm>
+#include <functional>
+#include <set>
 
 #include <QApplication>
 #include <QAbstractItemView>
@@ -22,12 +29,15 @@
 #include <QSettings>
 #include <QSizePolicy>
 
+/** Number of rows handed to the view each time it scrolls to the end of the fetched rows. */
+static const int COINCONTROL_FETCH_ROWS = 250;
+
 /**
  * @brief Dialog encapsulates the coin control table. The default size is 960x580
  * @param parent
  */
 BlocknetCoinControlDialog::BlocknetCoinControlDialog(WalletModel *w, QWidget *parent, Qt::WindowFlags f, bool standaloneMode) : 
-    QDialog(parent, f), walletModel(w), standaloneMode(standaloneMode) 
+    QDialog(parent, f), walletModel(w), modelWorker(new BlocknetModelWorker(this)), standaloneMode(standaloneMode)
 {
     //this->setStyleSheet("border: 1px solid red;");
     this->setContentsMargins(QMargins());
@@ -126,6 +136,8 @@ BlocknetCoinControlDialog::BlocknetCoinControlDialog(WalletModel *w, QWidget *pa
         Q_EMIT reject();
     });
     connect(cc, &BlocknetCoinControl::tableUpdated, this, &BlocknetCoinControlDialog::updateLabels);
+    if (standaloneMode) // only process utxo state changes in standalone mode
+        connect(cc, &BlocknetCoinControl::tableUpdated, this, &BlocknetCoinControlDialog::updateUTXOState);
 
     updateLabels();
 }
@@ -171,106 +183,111 @@ void BlocknetCoinControlDialog::updateLabels() {
 //    feePanel->setHidden(totalSelectedAmount == 0);
 }
 
+/**
+ * @brief Loads the unspent outputs of the wallet on the model worker thread, the dialog can't be
+ *        confirmed until they're displayed.
+ * @param txSelectedUtxos Outputs to check
+ */
 void BlocknetCoinControlDialog::populateUnspentTransactions(const QVector<BlocknetSimpleUTXO> & txSelectedUtxos) {
-    int displayUnit = walletModel->getOptionsModel()->getDisplayUnit();
-    QVector<BlocknetCoinControl::UTXO*> utxos;
-
-    auto mapCoins = walletModel->wallet().listCoins();
-    for (auto & item : mapCoins) {
-        CAmount nSum = 0;
-        double dPrioritySum = 0;
-        int nChildren = 0;
-        int nInputSum = 0;
-        const auto sWalletAddress = EncodeDestination(item.first);
-
-        for (auto & tup : item.second) {
-            const auto & out = std::get<0>(tup);
-            const auto & walletTx = std::get<1>(tup);
-            int nInputSize = 0;
-            nSum += walletTx.txout.nValue;
-            nChildren++;
-
-            auto *utxo = new BlocknetCoinControl::UTXO;
-            utxo->checked = false;
-
-            // address
-            CTxDestination outputAddress;
-            QString sAddress = "";
-            if (ExtractDestination(walletTx.txout.scriptPubKey, outputAddress)) {
-                sAddress = QString::fromStdString(EncodeDestination(outputAddress));
-                utxo->address = sAddress;
-                CPubKey pubkey;
-                CKeyID *keyid = boost::get<CKeyID>(&outputAddress);
-                if (keyid && walletModel->wallet().getPubKey(*keyid, pubkey) && !pubkey.IsCompressed())
-                    nInputSize = 29; // 29 = 180 - 151 (public key is 180 bytes, priority free area is 151 bytes)
-            }
+    const int displayUnit = walletModel->getOptionsModel()->getDisplayUnit();
+    const auto walletName = walletModel->getWalletName().toStdString();
+    std::set<COutPoint> selected;
+    for (auto &outpt : txSelectedUtxos)
+        selected.insert(COutPoint(outpt.hash, outpt.vout));
+
+    cc->setData(std::make_shared<BlocknetCoinControl::Model>());
+    confirmBtn->setEnabled(false);
+
+    modelWorker->fetch<BlocknetCoinControl::ModelPtr>(this, [walletName, displayUnit, selected]() {
+        auto ccData = std::make_shared<BlocknetCoinControl::Model>();
+        ccData->freeThreshold = COIN * 576 / 250; // TODO Blocknet Qt handle free threshold
+
+        // The wallet model may be removed in the meantime, look up the wallet itself
+        auto pwallet = GetWallet(walletName);
+        if (!pwallet)
+            return ccData;
+        auto wallet = interfaces::MakeWallet(pwallet);
+
+        auto mapCoins = wallet->listCoins();
+        for (auto & item : mapCoins) {
+            const auto sWalletAddress = EncodeDestination(item.first);
+
+            for (auto & tup : item.second) {
+                const auto & out = std::get<0>(tup);
+                const auto & walletTx = std::get<1>(tup);
+                int nInputSize = 0;
+
+                auto *utxo = new BlocknetCoinControl::UTXO;
+                utxo->checked = false;
+
+                // address
+                CTxDestination outputAddress;
+                QString sAddress = "";
+                if (ExtractDestination(walletTx.txout.scriptPubKey, outputAddress)) {
+                    sAddress = QString::fromStdString(EncodeDestination(outputAddress));
+                    utxo->address = sAddress;
+                    CPubKey pubkey;
+                    CKeyID *keyid = boost::get<CKeyID>(&outputAddress);
+                    if (keyid && wallet->getPubKey(*keyid, pubkey) && !pubkey.IsCompressed())
+                        nInputSize = 29; // 29 = 180 - 151 (public key is 180 bytes, priority free area is 151 bytes)
+                }
 
-            // label
-            if (!(sAddress.toStdString() == sWalletAddress)) { // if change
-                utxo->label = tr("(change)");
-            } else {
-                QString sLabel = walletModel->getAddressTableModel()->labelForAddress(sAddress);
-                if (sLabel.isEmpty())
-                    sLabel = tr("(no label)");
-                utxo->label = sLabel;
-            }
+                // label
+                if (!(sAddress.toStdString() == sWalletAddress)) { // if change
+                    utxo->label = BlocknetCoinControlDialog::tr("(change)");
+                } else {
+                    std::string name;
+                    QString sLabel;
+                    if (!sAddress.isEmpty() && wallet->getAddress(outputAddress, &name, nullptr, nullptr))
+                        sLabel = QString::fromStdString(name);
+                    if (sLabel.isEmpty())
+                        sLabel = BlocknetCoinControlDialog::tr("(no label)");
+                    utxo->label = sLabel;
+                }
 
-            // amount
-            utxo->amount = BitcoinUnits::format(displayUnit, walletTx.txout.nValue);
-            utxo->camount = walletTx.txout.nValue;
+                // amount
+                utxo->amount = BitcoinUnits::format(displayUnit, walletTx.txout.nValue);
+                utxo->camount = walletTx.txout.nValue;
 
-            // date
-            utxo->date = QDateTime::fromTime_t(static_cast<uint>(walletTx.time));
+                // date
+                utxo->date = QDateTime::fromTime_t(static_cast<uint>(walletTx.time));
 
-            // confirmations
-            utxo->confirmations = walletTx.depth_in_main_chain;
+                // confirmations
+                utxo->confirmations = walletTx.depth_in_main_chain;
 
-            // priority
-            double dPriority = ((double)walletTx.txout.nValue / (nInputSize + 78)) * (walletTx.depth_in_main_chain + 1); // 78 = 2 * 34 + 10
-            utxo->priority = dPriority;
-            dPrioritySum += (double)walletTx.txout.nValue * (walletTx.depth_in_main_chain + 1);
-            nInputSum += nInputSize;
+                // priority
+                double dPriority = ((double)walletTx.txout.nValue / (nInputSize + 78)) * (walletTx.depth_in_main_chain + 1); // 78 = 2 * 34 + 10
+                utxo->priority = dPriority;
 
-            // transaction hash & vout
-            uint256 txhash = out.hash;
-            utxo->transaction = QString::fromStdString(txhash.GetHex());
-            utxo->vout = static_cast<unsigned int>(out.n);
+                // transaction hash & vout
+                uint256 txhash = out.hash;
+                utxo->transaction = QString::fromStdString(txhash.GetHex());
+                utxo->vout = static_cast<unsigned int>(out.n);
 
-            // locked coins
-            utxo->locked = walletModel->wallet().isLockedCoin(out);
-            utxo->unlocked = !utxo->locked;
+                // locked coins
+                utxo->locked = wallet->isLockedCoin(out);
+                utxo->unlocked = !utxo->locked;
 
-            // selected coins
-            for (auto &outpt : txSelectedUtxos) {
-                if (outpt.hash == txhash && outpt.vout == static_cast<uint>(out.n) && !utxo->locked) {
+                // selected coins
+                if (!utxo->locked && selected.count(out))
                     utxo->checked = true;
-                    break;
-                }
-            }
 
-            utxos.push_back(utxo);
+                ccData->data.push_back(utxo);
+            }
         }
-    }
-
-    auto ccData = std::make_shared<BlocknetCoinControl::Model>();
-    ccData->freeThreshold = COIN * 576 / 250; // TODO Blocknet Qt handle free threshold
-    ccData->data = utxos;
-    getCC()->setData(ccData);
-    
-    if (standaloneMode) // only process utxo state changes in standalone mode
-        connect(getCC(), &BlocknetCoinControl::tableUpdated, this, &BlocknetCoinControlDialog::updateUTXOState);
+        return ccData;
+    }, [this](const BlocknetCoinControl::ModelPtr & ccData) {
+        cc->setData(ccData);
+        confirmBtn->setEnabled(true);
+    });
 }
 
 void BlocknetCoinControlDialog::updateUTXOState() {
-    for (auto *data : getCC()->getData()->data) {
-        if (data->locked) {
-            COutPoint utxo(uint256S(data->transaction.toStdString()), data->vout);
+    for (auto *data : getCC()->takeLockChanges()) {
+        COutPoint utxo(uint256S(data->transaction.toStdString()), data->vout);
+        if (data->locked)
             walletModel->wallet().lockCoin(utxo);
-        }
-        if (data->unlocked) {
-            COutPoint utxo(uint256S(data->transaction.toStdString()), data->vout);
-            walletModel->wallet().unlockCoin(utxo);
-        }
+        else walletModel->wallet().unlockCoin(utxo);
     }
 }
 
@@ -279,25 +296,27 @@ void BlocknetCoinControlDialog::updateUTXOState() {
  * @param parent
  */
 BlocknetCoinControl::BlocknetCoinControl(QWidget *parent) : QFrame(parent), layout(new QVBoxLayout),
-                                                           table(new QTableWidget), contextMenu(new QMenu) {
+                                                           table(new QTableView),
+                                                           tableModel(new BlocknetCoinControlTableModel(this)),
+                                                           contextMenu(new QMenu) {
     // this->setStyleSheet("border: 1px solid red");
     this->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
     layout->setContentsMargins(QMargins());
     this->setLayout(layout);
 
     // table
+    table->setModel(tableModel);
     table->setContentsMargins(QMargins());
-    table->setColumnCount(COLUMN_TXVOUT + 1);
     table->setEditTriggers(QAbstractItemView::NoEditTriggers);
     table->setSelectionBehavior(QAbstractItemView::SelectRows);
     table->setAlternatingRowColors(true);
-    table->setColumnWidth(COLUMN_PADDING, BGU::spi(10));
-    table->setColumnWidth(COLUMN_CHECKBOX, BGU::spi(30));
+    table->setColumnWidth(BlocknetCoinControlTableModel::COLUMN_PADDING, BGU::spi(10));
+    table->setColumnWidth(BlocknetCoinControlTableModel::COLUMN_CHECKBOX, BGU::spi(30));
     table->setShowGrid(false);
     table->setFocusPolicy(Qt::NoFocus);
     table->setContextMenuPolicy(Qt::CustomContextMenu);
-    table->setColumnHidden(COLUMN_TXHASH, true);
-    table->setColumnHidden(COLUMN_TXVOUT, true);
+    table->setColumnHidden(BlocknetCoinControlTableModel::COLUMN_TXHASH, true);
+    table->setColumnHidden(BlocknetCoinControlTableModel::COLUMN_TXVOUT, true);
     table->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
     table->verticalHeader()->setDefaultSectionSize(BGU::spi(60));
     table->verticalHeader()->setVisible(false);
@@ -305,11 +324,11 @@ BlocknetCoinControl::BlocknetCoinControl(QWidget *parent) : QFrame(parent), layo
     table->horizontalHeader()->setSortIndicatorShown(true);
     table->horizontalHeader()->setSectionsClickable(true);
     table->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
-    table->horizontalHeader()->setSectionResizeMode(COLUMN_PADDING, QHeaderView::Fixed);
-    table->horizontalHeader()->setSectionResizeMode(COLUMN_CHECKBOX, QHeaderView::Fixed);
-    table->horizontalHeader()->setSectionResizeMode(COLUMN_AMOUNT, QHeaderView::ResizeToContents);
-    table->horizontalHeader()->setSectionResizeMode(COLUMN_ADDRESS, QHeaderView::ResizeToContents);
-    table->setHorizontalHeaderLabels({ "", "", tr("Amount"), tr("Label"), tr("Address"), tr("Date"), tr("Confirmations"), tr("Priority"), "" });
+    table->horizontalHeader()->setSectionResizeMode(BlocknetCoinControlTableModel::COLUMN_PADDING, QHeaderView::Fixed);
+    table->horizontalHeader()->setSectionResizeMode(BlocknetCoinControlTableModel::COLUMN_CHECKBOX, QHeaderView::Fixed);
+    table->horizontalHeader()->setSectionResizeMode(BlocknetCoinControlTableModel::COLUMN_AMOUNT, QHeaderView::ResizeToContents);
+    table->horizontalHeader()->setSectionResizeMode(BlocknetCoinControlTableModel::COLUMN_ADDRESS, QHeaderView::ResizeToContents);
+    table->setSortingEnabled(true);
 
     // context menu actions
     selectCoins = new QAction(tr("Select coins"), this);
@@ -354,224 +373,65 @@ BlocknetCoinControl::BlocknetCoinControl(QWidget *parent) : QFrame(parent), layo
         settings.setValue("nCoinControlSortOrder", table->horizontalHeader()->sortIndicatorOrder());
         settings.setValue("nCoinControlSortColumn", table->horizontalHeader()->sortIndicatorSection());
     });
+    connect(tableModel, &BlocknetCoinControlTableModel::checkedChanged, this, &BlocknetCoinControl::tableUpdated);
 
     connect(selectCoins, &QAction::triggered, this, [this]() {
-        auto *select = table->selectionModel();
-        if (select->hasSelection()) {
-            unwatch();
-            auto idxs = select->selectedRows(COLUMN_CHECKBOX);
-            for (auto &idx : idxs) {
-                auto *item = table->item(idx.row(), idx.column());
-                if (item) {
-                    UTXO *utxo = nullptr;
-                    if (utxoForHash(getTransactionHash(item), getVOut(item), utxo) && utxo != nullptr && utxo->isValid()) {
-                        if (!utxo->locked) { // do not select locked coins
-                            utxo->checked = true;
-                            item->setCheckState(Qt::Checked);
-                        }
-                    }
-                }
-            }
-            watch();
-            Q_EMIT tableUpdated();
-        }
+        auto utxos = selectedUtxos();
+        if (utxos.isEmpty())
+            return;
+        for (auto *utxo : utxos)
+            tableModel->setChecked(utxo, true); // locked coins are not selected
+        Q_EMIT tableUpdated();
     });
     connect(deselectCoins, &QAction::triggered, this, [this]() {
-        auto *select = table->selectionModel();
-        if (select->hasSelection()) {
-            unwatch();
-            auto idxs = select->selectedRows(COLUMN_CHECKBOX);
-            for (auto &idx : idxs) {
-                auto *item = table->item(idx.row(), idx.column());
-                if (item) {
-                    UTXO *utxo = nullptr;
-                    if (utxoForHash(getTransactionHash(item), getVOut(item), utxo) && utxo != nullptr && utxo->isValid()) {
-                        if (!utxo->locked) { // do not modify locked coins
-                            utxo->checked = false;
-                            item->setCheckState(Qt::Unchecked);
-                        }
-                    }
-                }
-            }
-            watch();
-            Q_EMIT tableUpdated();
-        }
+        auto utxos = selectedUtxos();
+        if (utxos.isEmpty())
+            return;
+        for (auto *utxo : utxos)
+            tableModel->setChecked(utxo, false);
+        Q_EMIT tableUpdated();
     });
 
     connect(selectAllCoins, &QAction::triggered, this, [this]() {
-        unwatch();
-        for (int row = 0; row < table->rowCount(); ++row) {
-            auto *item = table->item(row, COLUMN_CHECKBOX);
-            if (item) {
-                UTXO *utxo = nullptr;
-                if (utxoForHash(getTransactionHash(item), getVOut(item), utxo) && utxo != nullptr && utxo->isValid()) {
-                    if (!utxo->locked) { // do not select locked coins
-                        utxo->checked = true;
-                        item->setCheckState(Qt::Checked);
-                    }
-                }
-            }
-        }
-        watch();
+        tableModel->setAllChecked(true);
         Q_EMIT tableUpdated();
     });
     connect(deselectAllCoins, &QAction::triggered, this, [this]() {
-        unwatch();
-        for (int row = 0; row < table->rowCount(); ++row) {
-            auto *item = table->item(row, COLUMN_CHECKBOX);
-            if (item) {
-                UTXO *utxo = nullptr;
-                if (utxoForHash(getTransactionHash(item), getVOut(item), utxo) && utxo != nullptr && utxo->isValid()) {
-                    if (!utxo->locked) { // do not select locked coins
-                        utxo->checked = false;
-                        item->setCheckState(Qt::Unchecked);
-                    }
-                }
-            }
-        }
-        watch();
+        tableModel->setAllChecked(false);
         Q_EMIT tableUpdated();
     });
 
     connect(copyAmountAction, &QAction::triggered, this, [this]() {
-        if (contextItem) {
-            UTXO *utxo = nullptr;
-            if (utxoForHash(getTransactionHash(contextItem), getVOut(contextItem), utxo) && utxo != nullptr && utxo->isValid())
-                setClipboard(utxo->amount);
-        }
+        if (contextItem)
+            setClipboard(contextItem->amount);
     });
     connect(copyLabelAction, &QAction::triggered, this, [this]() {
-        if (contextItem) {
-            UTXO *utxo = nullptr;
-            if (utxoForHash(getTransactionHash(contextItem), getVOut(contextItem), utxo) && utxo != nullptr && utxo->isValid())
-                setClipboard(utxo->label);
-        }
+        if (contextItem)
+            setClipboard(contextItem->label);
     });
     connect(copyAddressAction, &QAction::triggered, this, [this]() {
-        if (contextItem) {
-            UTXO *utxo = nullptr;
-            if (utxoForHash(getTransactionHash(contextItem), getVOut(contextItem), utxo) && utxo != nullptr && utxo->isValid())
-                setClipboard(utxo->address);
-        }
+        if (contextItem)
+            setClipboard(contextItem->address);
     });
     connect(copyTransactionAction, &QAction::triggered, this, [this]() {
-        if (contextItem) {
-            UTXO *utxo = nullptr;
-            if (utxoForHash(getTransactionHash(contextItem), getVOut(contextItem), utxo) && utxo != nullptr && utxo->isValid())
-                setClipboard(utxo->transaction);
-        }
+        if (contextItem)
+            setClipboard(contextItem->transaction);
     });
     connect(lockAction, &QAction::triggered, this, [this]() {
-        auto *select = table->selectionModel();
-        if (select->hasSelection()) {
-            unwatch();
-            auto idxs = select->selectedRows(COLUMN_CHECKBOX);
-            for (auto &idx : idxs) {
-                auto *item = table->item(idx.row(), COLUMN_TXHASH);
-                if (item) {
-                    UTXO *utxo = nullptr;
-                    if (utxoForHash(getTransactionHash(item), getVOut(item), utxo) && utxo != nullptr && utxo->isValid()) {
-                        utxo->locked = true;
-                        utxo->unlocked = !utxo->locked;
-                        utxo->checked = false;
-                        auto *cbItem = new QTableWidgetItem;
-                        cbItem->setIcon(QIcon(":/icons/lock_closed"));
-                        table->setItem(idx.row(), COLUMN_CHECKBOX, cbItem);
-                    }
-                }
-            }
-            watch();
-            Q_EMIT tableUpdated();
-        }
+        setLocked(selectedUtxos(), true);
     });
     connect(unlockAction, &QAction::triggered, this, [this]() {
-        auto *select = table->selectionModel();
-        if (select->hasSelection()) {
-            unwatch();
-            auto idxs = select->selectedRows(COLUMN_CHECKBOX);
-            for (auto &idx : idxs) {
-                auto *item = table->item(idx.row(), COLUMN_TXHASH);
-                if (item) {
-                    UTXO *utxo = nullptr;
-                    if (utxoForHash(getTransactionHash(item), getVOut(item), utxo) && utxo->isValid()) {
-                        utxo->locked = false;
-                        utxo->unlocked = !utxo->locked;
-                        utxo->checked = false;
-                        auto *cbItem = new QTableWidgetItem;
-                        cbItem->setCheckState(Qt::Unchecked);
-                        table->setItem(idx.row(), COLUMN_CHECKBOX, cbItem);
-                    }
-                }
-            }
-            watch();
-            Q_EMIT tableUpdated();
-        }
+        setLocked(selectedUtxos(), false);
     });
 }
 
 void BlocknetCoinControl::setData(ModelPtr dataModel) {
     this->dataModel = dataModel;
-
-    unwatch();
-    table->clearContents();
-    table->setRowCount(dataModel->data.count());
-    table->setSortingEnabled(false);
-
-    for (int i = 0; i < dataModel->data.count(); ++i) {
-        auto *d = dataModel->data[i];
-
-        // checkbox
-        auto *cbItem = new QTableWidgetItem;
-        if (d->locked)
-            cbItem->setIcon(QIcon(":/icons/lock_closed"));
-        else cbItem->setCheckState(d->checked ? Qt::Checked : Qt::Unchecked);
-        table->setItem(i, COLUMN_CHECKBOX, cbItem);
-
-        // amount
-        auto *amountItem = new BlocknetCoinControl::NumberItem;
-        amountItem->setData(Qt::DisplayRole, d->amount);
-        table->setItem(i, COLUMN_AMOUNT, amountItem);
-
-        // label
-        auto *labelItem = new QTableWidgetItem;
-        labelItem->setText(d->label);
-        table->setItem(i, COLUMN_LABEL, labelItem);
-
-        // address
-        auto *addressItem = new QTableWidgetItem;
-        addressItem->setText(d->address);
-        table->setItem(i, COLUMN_ADDRESS, addressItem);
-
-        // date
-        auto *dateItem = new QTableWidgetItem;
-        auto localDate = d->date.toLocalTime();
-        dateItem->setData(Qt::DisplayRole, d->date);
-        table->setItem(i, COLUMN_DATE, dateItem);
-
-        // confirmations
-        auto *confItem = new BlocknetCoinControl::NumberItem;
-        confItem->setData(Qt::DisplayRole, QString::number(d->confirmations));
-        table->setItem(i, COLUMN_CONFIRMATIONS, confItem);
-
-        // priority
-        auto *priorityItem = new BlocknetCoinControl::PriorityItem;
-        priorityItem->setData(PriorityItem::PriorityRole, d->priority);
-        priorityItem->setData(Qt::DisplayRole, getPriorityLabel(d->priority));
-        table->setItem(i, COLUMN_PRIORITY, priorityItem);
-
-        // txhash
-        auto *txhashItem = new QTableWidgetItem;
-        txhashItem->setData(Qt::DisplayRole, d->transaction);
-        table->setItem(i, COLUMN_TXHASH, txhashItem);
-
-        // tx vout
-        auto *txvoutItem = new QTableWidgetItem;
-        txvoutItem->setData(Qt::DisplayRole, d->vout);
-        table->setItem(i, COLUMN_TXVOUT, txvoutItem);
-    }
-
-    table->setSortingEnabled(true);
-    watch();
+    // Pointers into the previous data are no longer valid
+    contextItem = nullptr;
+    lockChanges.clear();
+    tableModel->setModel(dataModel);
+    table->sortByColumn(table->horizontalHeader()->sortIndicatorSection(), table->horizontalHeader()->sortIndicatorOrder());
 }
 
 BlocknetCoinControl::ModelPtr BlocknetCoinControl::getData() {
@@ -585,16 +445,20 @@ void BlocknetCoinControl::sizeTo(const int minimumHeight, const int maximumHeigh
     table->setFixedHeight(h);
 }
 
+QVector<BlocknetCoinControl::UTXO*> BlocknetCoinControl::takeLockChanges() {
+    QVector<UTXO*> changes;
+    changes.swap(lockChanges);
+    return changes;
+}
+
 void BlocknetCoinControl::showContextMenu(QPoint pt) {
     auto *select = table->selectionModel();
     selectCoins->setEnabled(select->hasSelection());
     deselectCoins->setEnabled(select->hasSelection());
-    auto *item = table->itemAt(pt);
-    if (!item) {
-        contextItem = nullptr;
+    auto idx = table->indexAt(pt);
+    contextItem = idx.isValid() ? tableModel->utxo(idx.row()) : nullptr;
+    if (!contextItem)
         return;
-    }
-    contextItem = item;
     contextMenu->exec(QCursor::pos());
 }
 
@@ -608,6 +472,70 @@ void BlocknetCoinControl::setClipboard(const QString &str) {
  * @return
  */
 QString BlocknetCoinControl::getPriorityLabel(double dPriority) {
+    return tableModel->getPriorityLabel(dPriority);
+}
+
+QVector<BlocknetCoinControl::UTXO*> BlocknetCoinControl::selectedUtxos() {
+    QVector<UTXO*> utxos;
+    auto *select = table->selectionModel();
+    if (!select->hasSelection())
+        return utxos;
+    for (auto &idx : select->selectedRows(BlocknetCoinControlTableModel::COLUMN_CHECKBOX)) {
+        auto *utxo = tableModel->utxo(idx.row());
+        if (utxo && utxo->isValid())
+            utxos.push_back(utxo);
+    }
+    return utxos;
+}
+
+void BlocknetCoinControl::setLocked(const QVector<UTXO*> & utxos, const bool locked) {
+    if (utxos.isEmpty())
+        return;
+    QVector<UTXO*> changed;
+    for (auto *utxo : utxos) {
+        tableModel->setChecked(utxo, false);
+        if (utxo->locked == locked)
+            continue;
+        utxo->locked = locked;
+        utxo->unlocked = !utxo->locked;
+        changed.push_back(utxo);
+        lockChanges.push_back(utxo);
+    }
+    tableModel->utxosChanged(changed);
+    Q_EMIT tableUpdated();
+}
+
+BlocknetCoinControlTableModel::BlocknetCoinControlTableModel(QObject *parent) : QAbstractTableModel(parent),
+                                                                               lockIcon(":/icons/lock_closed") { }
+
+void BlocknetCoinControlTableModel::setModel(BlocknetCoinControl::ModelPtr dataModel) {
+    beginResetModel();
+    this->dataModel = dataModel;
+    nFetched = 0;
+    nChecked = 0;
+    nCheckedAmount = 0;
+    if (dataModel) {
+        for (auto *utxo : dataModel->data) {
+            if (!utxo->checked)
+                continue;
+            ++nChecked;
+            nCheckedAmount += utxo->camount;
+        }
+    }
+    updateRows();
+    endResetModel();
+}
+
+BlocknetCoinControl::UTXO* BlocknetCoinControlTableModel::utxo(const int row) const {
+    if (!dataModel || row < 0 || row >= nFetched)
+        return nullptr;
+    return dataModel->data[row];
+}
+
+QString BlocknetCoinControlTableModel::getPriorityLabel(double dPriority) const {
+    if (!dataModel)
+        return QString();
+
     double dPriorityMedium = dataModel->mempoolPriority;
 
     if (dPriorityMedium <= 0)
@@ -633,38 +561,204 @@ QString BlocknetCoinControl::getPriorityLabel(double dPriority) {
         return tr("lowest");
 }
 
-void BlocknetCoinControl::unwatch() {
-    table->setEnabled(false);
-    disconnect(table, &QTableWidget::itemChanged, this, &BlocknetCoinControl::onItemChanged);
+bool BlocknetCoinControlTableModel::check(BlocknetCoinControl::UTXO *utxo, const bool checked) {
+    if (utxo->checked == checked || (checked && utxo->locked)) // do not select locked coins
+        return false;
+    utxo->checked = checked;
+    nChecked += checked ? 1 : -1;
+    nCheckedAmount += checked ? utxo->camount : -utxo->camount;
+    return true;
 }
 
-void BlocknetCoinControl::watch() {
-    table->setEnabled(true);
-    connect(table, &QTableWidget::itemChanged, this, &BlocknetCoinControl::onItemChanged);
+bool BlocknetCoinControlTableModel::setChecked(BlocknetCoinControl::UTXO *utxo, const bool checked) {
+    if (!check(utxo, checked))
+        return false;
+    utxosChanged({ utxo });
+    return true;
 }
 
-bool BlocknetCoinControl::utxoForHash(const QString transaction, const uint vout, UTXO *&utxo) {
-    for (auto *item : dataModel->data) {
-        if (transaction == item->transaction && vout == item->vout) {
-            utxo = item;
-            return true;
-        }
+void BlocknetCoinControlTableModel::setAllChecked(const bool checked) {
+    if (!dataModel)
+        return;
+    for (auto *utxo : dataModel->data)
+        check(utxo, checked);
+    if (nFetched > 0)
+        Q_EMIT dataChanged(index(0, COLUMN_CHECKBOX), index(nFetched - 1, COLUMN_CHECKBOX));
+}
+
+void BlocknetCoinControlTableModel::utxosChanged(const QVector<BlocknetCoinControl::UTXO*> & utxos) {
+    for (auto *utxo : utxos) {
+        auto it = rows.constFind(utxo);
+        if (it == rows.constEnd() || it.value() >= nFetched) // not displayed yet
+            continue;
+        const auto idx = index(it.value(), COLUMN_CHECKBOX);
+        Q_EMIT dataChanged(idx, idx);
     }
-    return false;
 }
 
-QString BlocknetCoinControl::getTransactionHash(QTableWidgetItem *item) {
-    return table->item(item->row(), COLUMN_TXHASH)->data(Qt::DisplayRole).toString();
+int BlocknetCoinControlTableModel::rowCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : nFetched;
 }
 
-uint BlocknetCoinControl::getVOut(QTableWidgetItem *item) {
-    return table->item(item->row(), COLUMN_TXVOUT)->data(Qt::DisplayRole).toUInt();
+int BlocknetCoinControlTableModel::columnCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : COLUMN_TXVOUT + 1;
 }
 
-void BlocknetCoinControl::onItemChanged(QTableWidgetItem *item) {
-    UTXO *utxo = nullptr;
-    if (utxoForHash(getTransactionHash(item), getVOut(item), utxo) && utxo != nullptr && utxo->isValid()) {
-        utxo->checked = item->checkState() == Qt::Checked;
-        Q_EMIT tableUpdated();
+QVariant BlocknetCoinControlTableModel::data(const QModelIndex &index, int role) const {
+    auto *d = index.isValid() ? utxo(index.row()) : nullptr;
+    if (!d)
+        return QVariant();
+
+    switch (role) {
+        case Qt::DisplayRole:
+            switch (index.column()) {
+                case COLUMN_AMOUNT:
+                    return d->amount;
+                case COLUMN_LABEL:
+                    return d->label;
+                case COLUMN_ADDRESS:
+                    return d->address;
+                case COLUMN_DATE:
+                    return d->date;
+                case COLUMN_CONFIRMATIONS:
+                    return QString::number(d->confirmations);
+                case COLUMN_PRIORITY:
+                    return getPriorityLabel(d->priority);
+                case COLUMN_TXHASH:
+                    return d->transaction;
+                case COLUMN_TXVOUT:
+                    return d->vout;
+                default:
+                    break;
+            }
+            break;
+        case Qt::CheckStateRole:
+            if (index.column() == COLUMN_CHECKBOX && !d->locked)
+                return d->checked ? Qt::Checked : Qt::Unchecked;
+            break;
+        case Qt::DecorationRole:
+            if (index.column() == COLUMN_CHECKBOX && d->locked)
+                return lockIcon;
+            break;
+        default:
+            break;
     }
+    return QVariant();
+}
+
+bool BlocknetCoinControlTableModel::setData(const QModelIndex &index, const QVariant &value, int role) {
+    if (!index.isValid() || index.column() != COLUMN_CHECKBOX || role != Qt::CheckStateRole)
+        return false;
+    auto *d = utxo(index.row());
+    if (!d || !setChecked(d, value.toInt() == Qt::Checked))
+        return false;
+    Q_EMIT checkedChanged();
+    return true;
+}
+
+QVariant BlocknetCoinControlTableModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+        return QVariant();
+    switch (section) {
+        case COLUMN_AMOUNT:
+            return tr("Amount");
+        case COLUMN_LABEL:
+            return tr("Label");
+        case COLUMN_ADDRESS:
+            return tr("Address");
+        case COLUMN_DATE:
+            return tr("Date");
+        case COLUMN_CONFIRMATIONS:
+            return tr("Confirmations");
+        case COLUMN_PRIORITY:
+            return tr("Priority");
+        default:
+            return QString();
+    }
+}
+
+Qt::ItemFlags BlocknetCoinControlTableModel::flags(const QModelIndex &index) const {
+    if (!index.isValid())
+        return Qt::NoItemFlags;
+    Qt::ItemFlags f = Qt::ItemIsSelectable | Qt::ItemIsEnabled;
+    if (index.column() == COLUMN_CHECKBOX) {
+        auto *d = utxo(index.row());
+        if (d && !d->locked)
+            f |= Qt::ItemIsUserCheckable;
+    }
+    return f;
+}
+
+bool BlocknetCoinControlTableModel::canFetchMore(const QModelIndex &parent) const {
+    return !parent.isValid() && dataModel && nFetched < dataModel->data.count();
+}
+
+void BlocknetCoinControlTableModel::fetchMore(const QModelIndex &parent) {
+    if (!canFetchMore(parent))
+        return;
+    const int n = std::min(dataModel->data.count() - nFetched, COINCONTROL_FETCH_ROWS);
+    beginInsertRows(QModelIndex(), nFetched, nFetched + n - 1);
+    nFetched += n;
+    endInsertRows();
+}
+
+/**
+ * @brief Sorts all utxos, including the ones not fetched by the view yet. The fetched rows are
+ *        kept, the view shows the first rows of the new order.
+ * @param column
+ * @param order
+ */
+void BlocknetCoinControlTableModel::sort(int column, Qt::SortOrder order) {
+    if (!dataModel)
+        return;
+
+    typedef BlocknetCoinControl::UTXO UTXO;
+    std::function<bool(const UTXO*, const UTXO*)> less;
+    switch (column) {
+        case COLUMN_CHECKBOX:
+            less = [](const UTXO *a, const UTXO *b) { return a->checked < b->checked; };
+            break;
+        case COLUMN_AMOUNT:
+            less = [](const UTXO *a, const UTXO *b) { return a->camount < b->camount; };
+            break;
+        case COLUMN_LABEL:
+            less = [](const UTXO *a, const UTXO *b) { return a->label < b->label; };
+            break;
+        case COLUMN_ADDRESS:
+            less = [](const UTXO *a, const UTXO *b) { return a->address < b->address; };
+            break;
+        case COLUMN_DATE:
+            less = [](const UTXO *a, const UTXO *b) { return a->date < b->date; };
+            break;
+        case COLUMN_CONFIRMATIONS:
+            less = [](const UTXO *a, const UTXO *b) { return a->confirmations < b->confirmations; };
+            break;
+        case COLUMN_PRIORITY:
+            less = [](const UTXO *a, const UTXO *b) { return a->priority < b->priority; };
+            break;
+        case COLUMN_TXHASH:
+            less = [](const UTXO *a, const UTXO *b) { return a->transaction < b->transaction; };
+            break;
+        case COLUMN_TXVOUT:
+            less = [](const UTXO *a, const UTXO *b) { return a->vout < b->vout; };
+            break;
+        default:
+            return;
+    }
+
+    beginResetModel();
+    if (order == Qt::AscendingOrder)
+        std::stable_sort(dataModel->data.begin(), dataModel->data.end(), less);
+    else std::stable_sort(dataModel->data.begin(), dataModel->data.end(), [&less](const UTXO *a, const UTXO *b) { return less(b, a); });
+    updateRows();
+    endResetModel();
+}
+
+void BlocknetCoinControlTableModel::updateRows() {
+    rows.clear();
+    if (!dataModel)
+        return;
+    rows.reserve(dataModel->data.count());
+    for (int i = 0; i < dataModel->data.count(); ++i)
+        rows.insert(dataModel->data[i], i);
 }
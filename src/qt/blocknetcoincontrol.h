@@ -12,18 +12,23 @@
 
 #include <memory>
 
+#include <QAbstractTableModel>
 #include <QDateTime>
 #include <QDialog>
-#include <QGridLayout>
 #include <QFrame>
+#include <QGridLayout>
 #include <QLabel>
+#include <QHash>
+#include <QIcon>
 #include <QMenu>
-#include <QTableWidget>
-#include <QTableWidgetItem>
+#include <QTableView>
 #include <QVBoxLayout>
 #include <QVector>
 #include <QWidget>
 
+class BlocknetCoinControlTableModel;
+class BlocknetModelWorker;
+
 class BlocknetCoinControl : public QFrame {
     Q_OBJECT
 public:
@@ -47,16 +52,11 @@ public:
         }
     };
     struct Model {
-        double freeThreshold;
-        double mempoolPriority;
-        QVector<UTXO*> data;
-        void copy(Model &m) {
-            freeThreshold = m.freeThreshold;
-            mempoolPriority = m.mempoolPriority;
-            data = m.data;
-        }
-        void copy(Model *m) {
-            copy(*m);
+        double freeThreshold{0};
+        double mempoolPriority{0};
+        QVector<UTXO*> data; // owned
+        ~Model() {
+            qDeleteAll(data);
         }
     };
     typedef std::shared_ptr<Model> ModelPtr;
@@ -65,19 +65,22 @@ public:
     ModelPtr getData();
 
     void clear() {
-        table->blockSignals(true);
-        if (dataModel != nullptr)
-            table->clearContents();
-        table->blockSignals(false);
+        setData(std::make_shared<Model>());
     };
 
-    QTableWidget* getTable() {
+    QTableView* getTable() {
         return table;
     }
 
     void sizeTo(int minimumHeight, int maximumHeight);
     QString getPriorityLabel(double dPriority);
 
+    /**
+     * @brief Returns the utxos that were locked or unlocked since the last call, so that
+     *        only those have to be passed on to the wallet.
+     */
+    QVector<UTXO*> takeLockChanges();
+
 Q_SIGNALS:
     void tableUpdated();
 
@@ -85,24 +88,33 @@ public Q_SLOTS:
 
 private Q_SLOTS:
     void showContextMenu(QPoint);
-    void onItemChanged(QTableWidgetItem *item);
 
 private:
     QVBoxLayout *layout;
-    QTableWidget *table;
+    QTableView *table;
+    BlocknetCoinControlTableModel *tableModel;
     QMenu *contextMenu;
-    QTableWidgetItem *contextItem = nullptr;
+    UTXO *contextItem = nullptr;
     QAction *selectCoins;
     QAction *deselectCoins;
 
     ModelPtr dataModel = nullptr;
+    QVector<UTXO*> lockChanges;
 
     void setClipboard(const QString &str);
-    void unwatch();
-    void watch();
-    bool utxoForHash(QString transaction, uint vout, UTXO *&utxo);
-    QString getTransactionHash(QTableWidgetItem *item);
-    uint getVOut(QTableWidgetItem *item);
+    QVector<UTXO*> selectedUtxos();
+    void setLocked(const QVector<UTXO*> & utxos, bool locked);
+};
+
+/**
+ * @brief Table model of the coin control utxos. The rows are handed to the view in batches as it
+ *        scrolls, and the count and amount of the checked utxos are kept up to date on each change
+ *        instead of being summed over all utxos.
+ */
+class BlocknetCoinControlTableModel : public QAbstractTableModel {
+    Q_OBJECT
+public:
+    explicit BlocknetCoinControlTableModel(QObject *parent = nullptr);
 
     enum {
         COLUMN_PADDING,
@@ -117,25 +129,50 @@ private:
         COLUMN_TXVOUT,
     };
 
-    class NumberItem : public QTableWidgetItem {
-    public:
-        explicit NumberItem() = default;
-        bool operator < (const QTableWidgetItem &other) const override {
-            auto i1 = text().toDouble();
-            auto i2 = other.text().toDouble();
-            return i1 < i2;
-        };
-    };
-    class PriorityItem : public QTableWidgetItem {
-    public:
-        explicit PriorityItem() = default;
-        enum {
-            PriorityRole = 200
-        };
-        bool operator < (const QTableWidgetItem &other) const override {
-            return data(PriorityRole).toDouble() < other.data(PriorityRole).toDouble();
-        };
-    };
+    void setModel(BlocknetCoinControl::ModelPtr dataModel);
+    BlocknetCoinControl::UTXO* utxo(int row) const;
+    QString getPriorityLabel(double dPriority) const;
+
+    /**
+     * @brief Checks or unchecks the utxo, locked utxos are left unchecked. Returns true if the
+     *        utxo was changed. The view is notified with dataChanged.
+     */
+    bool setChecked(BlocknetCoinControl::UTXO *utxo, bool checked);
+    /**
+     * @brief Checks or unchecks all utxos, including the ones not fetched by the view yet.
+     */
+    void setAllChecked(bool checked);
+    /**
+     * @brief Notifies the view that the checkbox column of the utxos changed.
+     */
+    void utxosChanged(const QVector<BlocknetCoinControl::UTXO*> & utxos);
+
+    int checkedCount() const { return nChecked; }
+    CAmount checkedAmount() const { return nCheckedAmount; }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role) const override;
+    bool setData(const QModelIndex &index, const QVariant &value, int role) override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role) const override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+    void sort(int column, Qt::SortOrder order) override;
+
+Q_SIGNALS:
+    void checkedChanged();
+
+private:
+    BlocknetCoinControl::ModelPtr dataModel;
+    QHash<BlocknetCoinControl::UTXO*, int> rows;
+    int nFetched{0};
+    int nChecked{0};
+    CAmount nCheckedAmount{0};
+    QIcon lockIcon;
+
+    bool check(BlocknetCoinControl::UTXO *utxo, bool checked);
+    void updateRows();
 };
 
 class BlocknetCoinControlDialog : public QDialog {
@@ -163,6 +200,7 @@ protected:
 
 private:
     WalletModel *walletModel;
+    BlocknetModelWorker *modelWorker;
     QFrame *content;
     BlocknetFormBtn *confirmBtn;
     BlocknetFormBtn *cancelBtn;
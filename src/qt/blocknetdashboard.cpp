@@ -18,7 +18,9 @@
 #include <QFont>
 #include <QHeaderView>
 
-BlocknetDashboard::BlocknetDashboard(QFrame *parent) : QFrame(parent), layout(new QVBoxLayout),
+BlocknetDashboard::BlocknetDashboard(BlocknetModelWorker *modelWorker, QFrame *parent) : QFrame(parent),
+                                                       layout(new QVBoxLayout),
+                                                       modelWorker(modelWorker),
                                                        walletModel(nullptr),
                                                        displayUnit(0), walletBalance(0),
                                                        unconfirmedBalance(0), immatureBalance(0) {
@@ -152,7 +154,7 @@ BlocknetDashboard::BlocknetDashboard(QFrame *parent) : QFrame(parent), layout(ne
 void BlocknetDashboard::setWalletModel(WalletModel *w) {
     if (walletModel == w) {
         displayUnit = walletModel->getOptionsModel()->getDisplayUnit();
-        balanceChanged(walletModel->wallet().getBalances());
+        fetchBalances();
         return;
     }
 
@@ -163,7 +165,7 @@ void BlocknetDashboard::setWalletModel(WalletModel *w) {
         return;
 
     displayUnit = walletModel->getOptionsModel()->getDisplayUnit();
-    balanceChanged(walletModel->wallet().getBalances());
+    fetchBalances();
 
     transactionsTbl->setWalletModel(walletModel);
     transactionsTbl->horizontalHeader()->setSectionResizeMode(BlocknetDashboardFilterProxy::DashboardStatus, QHeaderView::Fixed);
@@ -192,6 +194,17 @@ void BlocknetDashboard::hideEvent(QHideEvent *event) {
     transactionsTbl->leave();
 }
 
+/**
+ * @brief Fetches the wallet balances off the gui thread.
+ */
+void BlocknetDashboard::fetchBalances() {
+    const auto walletName = walletModel->getWalletName();
+    modelWorker->fetchBalances(this, walletName, [this, walletName](const interfaces::WalletBalances & balances) {
+        if (walletModel && walletModel->getWalletName() == walletName)
+            balanceChanged(balances);
+    });
+}
+
 void BlocknetDashboard::balanceChanged(const interfaces::WalletBalances & balances) {
     walletBalance = balances.balance;
     unconfirmedBalance = balances.unconfirmed_balance;
@@ -5,6 +5,7 @@
 #ifndef BLOCKNETDASHBOARD_H
 #define BLOCKNETDASHBOARD_H
 
+#include <qt/blocknetmodelworker.h>
 #include <qt/blocknetvars.h>
 
 #include <qt/optionsmodel.h>
@@ -32,7 +33,7 @@ class BlocknetDashboard : public QFrame
     Q_OBJECT
 
 public:
-    explicit BlocknetDashboard(QFrame *parent = nullptr);
+    explicit BlocknetDashboard(BlocknetModelWorker *modelWorker, QFrame *parent = nullptr);
     void setWalletModel(WalletModel *w);
 
 Q_SIGNALS:
@@ -53,6 +54,7 @@ private Q_SLOTS:
 
 private:
     QVBoxLayout *layout;
+    BlocknetModelWorker *modelWorker;
     WalletModel *walletModel;
     int displayUnit;
     CAmount walletBalance;
@@ -73,6 +75,7 @@ private:
     QFrame *recentTransactions;
     BlocknetDashboardTable *transactionsTbl;
 
+    void fetchBalances();
     void updateBalance();
     void walletEvents(bool on);
 };
@@ -365,6 +365,7 @@ void BlocknetGUI::createActions()
         connect(openCoinControlAction, &QAction::triggered, [this]{
             auto ccDialog = new BlocknetCoinControlDialog(walletFrame->currentWalletModel(), nullptr, Qt::WindowSystemMenuHint | Qt::WindowTitleHint, true);
             ccDialog->setStyleSheet(GUIUtil::loadStyleSheet());
+            ccDialog->setAttribute(Qt::WA_DeleteOnClose);
             QVector<BlocknetSimpleUTXO> txSelectedUtxos;
             ccDialog->populateUnspentTransactions(txSelectedUtxos);
             ccDialog->show();
@@ -0,0 +1,38 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <qt/blocknetmodelworker.h>
+
+#include <interfaces/wallet.h>
+#include <wallet/wallet.h>
+
+#include <utility>
+
+BlocknetModelWorker::BlocknetModelWorker(QObject *parent) : QObject(parent), executor(new QObject) {
+    executor->moveToThread(&thread);
+    connect(&thread, &QThread::finished, executor, &QObject::deleteLater);
+    thread.start();
+}
+
+BlocknetModelWorker::~BlocknetModelWorker() {
+    // Pending snapshots are dropped, a snapshot in progress is finished first
+    thread.quit();
+    thread.wait();
+}
+
+void BlocknetModelWorker::fetchBalances(QObject *receiver, const QString & walletName,
+                                        std::function<void(const interfaces::WalletBalances &)> done) {
+    typedef std::pair<bool, interfaces::WalletBalances> Balances;
+    const auto name = walletName.toStdString();
+    fetch<Balances>(receiver, [name]() {
+        // The wallet model may be removed in the meantime, look up the wallet itself
+        auto wallet = GetWallet(name);
+        if (!wallet)
+            return Balances(false, interfaces::WalletBalances());
+        return Balances(true, interfaces::MakeWallet(wallet)->getBalances());
+    }, [done](const Balances & balances) {
+        if (balances.first)
+            done(balances.second);
+    });
+}
@@ -0,0 +1,66 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BLOCKNETMODELWORKER_H
+#define BLOCKNETMODELWORKER_H
+
+#include <functional>
+
+#include <QObject>
+#include <QString>
+#include <QPointer>
+#include <QThread>
+#include <QTimer>
+
+/**
+ * Gathers snapshots of chain and wallet state on a background thread, so that views
+ * are not blocked while cs_main or cs_wallet are held by the core, for example by
+ * the staker. Results are passed back to the gui thread.
+ */
+namespace interfaces {
+struct WalletBalances;
+}
+
+class BlocknetModelWorker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit BlocknetModelWorker(QObject *parent = nullptr);
+    ~BlocknetModelWorker() override;
+
+    /**
+     * @brief Runs work on the worker thread and passes its result to done on the gui thread.
+     *        done is skipped if the receiver was destroyed in the meantime. work must not
+     *        access the receiver.
+     * @param receiver Object done belongs to
+     * @param work Gathers the snapshot
+     * @param done Displays the snapshot
+     */
+    template <typename T>
+    void fetch(QObject *receiver, std::function<T()> work, std::function<void(const T &)> done) {
+        QPointer<QObject> guard(receiver);
+        QTimer::singleShot(0, executor, [this, guard, work, done]() {
+            const T result = work();
+            QTimer::singleShot(0, this, [guard, result, done]() {
+                if (guard)
+                    done(result);
+            });
+        });
+    }
+
+    /**
+     * @brief Fetches the balances of the wallet. done is skipped if the wallet was unloaded.
+     * @param receiver Object done belongs to
+     * @param walletName
+     * @param done Displays the balances
+     */
+    void fetchBalances(QObject *receiver, const QString & walletName,
+                       std::function<void(const interfaces::WalletBalances &)> done);
+
+private:
+    QThread thread;
+    QObject *executor;
+};
+
+#endif // BLOCKNETMODELWORKER_H
@@ -17,8 +17,11 @@
 #include <qt/guiutil.h>
 #include <qt/optionsmodel.h>
 
+#include <interfaces/handler.h>
+#include <interfaces/node.h>
 #include <uint256.h>
 
+#include <algorithm>
 #include <utility>
 
 #include <QAbstractItemView>
@@ -30,7 +33,8 @@
 #include <QRadioButton>
 #include <QVariant>
 
-BlocknetProposals::BlocknetProposals(QFrame *parent) : QFrame(parent), layout(new QVBoxLayout),
+BlocknetProposals::BlocknetProposals(BlocknetModelWorker *modelWorker, QFrame *parent) : QFrame(parent),
+                                                       layout(new QVBoxLayout), modelWorker(modelWorker),
                                                        walletModel(nullptr), contextMenu(new QMenu) {
     this->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
     layout->setContentsMargins(BGU::spi(46), BGU::spi(10), BGU::spi(50), 0);
@@ -117,19 +121,6 @@ BlocknetProposals::BlocknetProposals(QFrame *parent) : QFrame(parent), layout(ne
     contextMenu->addAction(copyYes);
     contextMenu->addAction(copyNo);
 
-    // Timer used to check for vote capabilities and refresh proposals
-    int timerInterval = 5000;
-    timer = new QTimer(this);
-    timer->setInterval(timerInterval);
-    connect(timer, &QTimer::timeout, this, [this]() {
-        bool cannotVote = !canVote();
-        if (cannotVote) table->setColumnWidth(COLUMN_VOTE, 0);
-        else table->setColumnWidth(COLUMN_VOTE, BGU::spi(150));
-        table->setColumnHidden(COLUMN_VOTE, cannotVote);
-        refresh(false);
-    });
-    timer->start(timerInterval);
-
     connect(createProposal, SIGNAL(clicked()), this, SLOT(onCreateProposal()));
     connect(table, &QTableWidget::itemSelectionChanged, this, [this]() {
         lastSelection = QDateTime::currentMSecsSinceEpoch();
@@ -202,13 +193,30 @@ BlocknetProposals::BlocknetProposals(QFrame *parent) : QFrame(parent), layout(ne
     syncInProgress = false;
 }
 
+BlocknetProposals::~BlocknetProposals() {
+    unsubscribeFromCoreSignals();
+}
+
+/**
+ * @brief Loads the proposals on the model worker thread, the display is refreshed once they are available.
+ */
 void BlocknetProposals::initialize() {
     if (!walletModel)
         return;
-    dataModel.clear();
+    modelWorker->fetch<QVector<BlocknetProposal>>(this, &BlocknetProposals::loadProposals,
+            [this](const QVector<BlocknetProposal> & proposals) {
+        dataModel = proposals;
+        onFilter();
+    });
+}
 
+/**
+ * @brief Returns the display data of all proposals sorted on superblock descending. Called
+ *        on the model worker thread.
+ */
+QVector<BlocknetProposals::BlocknetProposal> BlocknetProposals::loadProposals() {
+    QVector<BlocknetProposal> data;
     const auto currentBlock = getChainHeight();
-    const auto nextSuperblock = gov::Governance::nextSuperblock(Params().GetConsensus(), currentBlock);
     auto proposals = gov::Governance::instance().getProposals();
     std::map<int, std::map<gov::Proposal, gov::Tally>> superblockResults;
 
@@ -225,105 +233,120 @@ void BlocknetProposals::initialize() {
         return a.getSuperblock() > b.getSuperblock();
     });
 
-    for (const auto & proposal : proposals) {
-        const auto & sbResults = superblockResults[proposal.getSuperblock()];
+    for (const auto & proposal : proposals)
+        data << proposalData(proposal, currentBlock, superblockResults[proposal.getSuperblock()]);
 
-        QString status = tr("Voting");
-        QString results = tr("Failing");
-        statusflags statusColor = STATUS_REJECTED;
+    // Sort on superblock descending
+    std::sort(data.begin(), data.end(), [](const BlocknetProposal &a, const BlocknetProposal &b) {
+        return a.superblock > b.superblock;
+    });
 
-        if (currentBlock >= proposal.getSuperblock()) {
-            status = tr("Finished");
-            statusColor = STATUS_PASSED;
-        }
+    return data;
+}
 
-        if (currentBlock < proposal.getSuperblock() && sbResults.count(proposal)) {
-            results = tr("Passing");
-            statusColor = STATUS_PASSED;
-        }
-        else if (currentBlock < proposal.getSuperblock() && !sbResults.count(proposal)) {
-            results = tr("Failing");
-            statusColor = STATUS_REJECTED;
-        }
-        else if (currentBlock >= proposal.getSuperblock() && sbResults.count(proposal)) {
-            results = tr("Passed");
-            status = tr("Finished");
-            statusColor = STATUS_PASSED;
-        }
-        else if (currentBlock >= proposal.getSuperblock() && !sbResults.count(proposal)) {
-            results = tr("Failed");
-            status = tr("Finished");
-            statusColor = STATUS_REJECTED;
-        }
-        else if (currentBlock < proposal.getSuperblock()) {
-            results = tr("Pending");
-            statusColor = STATUS_IN_PROGRESS;
-        }
+/**
+ * @brief Returns the display data of the proposal.
+ * @param proposal
+ * @param currentBlock Chain height
+ * @param sbResults Results of the proposal's superblock
+ */
+BlocknetProposals::BlocknetProposal BlocknetProposals::proposalData(const gov::Proposal & proposal, int currentBlock,
+                                                                    const std::map<gov::Proposal, gov::Tally> & sbResults)
+{
+    QString status = tr("Voting");
+    QString results = tr("Failing");
+    statusflags statusColor = STATUS_REJECTED;
 
-        gov::VoteType userVoteInt{gov::ABSTAIN};
-        QString userVote;
-        CAmount voteAmount{0};
-
-        // If proposal is invalid
-        std::string perr;
-        if (!proposal.isValid(Params().GetConsensus(), &perr)) {
-            status = tr("Invalid");
-            statusColor = STATUS_REJECTED;
-        } else {
-            // how many votes are mine?
-            auto wallets = GetWallets();
-            const auto castVote = gov::Governance::instance().getMyVotes(proposal.getHash(), pcoinsTip.get(),
-                    wallets, Params().GetConsensus());
-            const auto votes = std::get<0>(castVote);
-            const auto voteType = std::get<1>(castVote);
-            const auto voted = std::get<2>(castVote);
-            voteAmount = std::get<3>(castVote);
-            if (votes > 0) {
-                if (votes > 1)
-                    userVote = voteType == gov::YES ? tr("%1 YES").arg(QString::number(votes))
-                                                    : voteType == gov::ABSTAIN ? tr("%1 ABSTAIN").arg(QString::number(votes))
-                                                                               : tr("%1 NO").arg(QString::number(votes));
-                else
-                    userVote = voteType == gov::YES ? tr("YES")
-                                                    : voteType == gov::ABSTAIN ? tr("ABSTAIN")
-                                                                               : tr("NO");
-            } else if (voted)
-                userVote = tr("Insufficient funds");
-        }
+    if (currentBlock >= proposal.getSuperblock()) {
+        status = tr("Finished");
+        statusColor = STATUS_PASSED;
+    }
 
-        BlocknetProposal proposalData = {
-            proposal.getHash(),
-            statusColor,
-            QString::fromStdString(proposal.getName()),
-            proposal.getSuperblock(),
-            proposal.getAmount(),
-            QString::fromStdString(proposal.getUrl()),
-            QString::fromStdString(proposal.getDescription()),
-            status,
-            results,
-            userVoteInt,
-            userVote,
-            voteAmount
-        };
-        dataModel << proposalData;
+    if (currentBlock < proposal.getSuperblock() && sbResults.count(proposal)) {
+        results = tr("Passing");
+        statusColor = STATUS_PASSED;
+    }
+    else if (currentBlock < proposal.getSuperblock() && !sbResults.count(proposal)) {
+        results = tr("Failing");
+        statusColor = STATUS_REJECTED;
+    }
+    else if (currentBlock >= proposal.getSuperblock() && sbResults.count(proposal)) {
+        results = tr("Passed");
+        status = tr("Finished");
+        statusColor = STATUS_PASSED;
+    }
+    else if (currentBlock >= proposal.getSuperblock() && !sbResults.count(proposal)) {
+        results = tr("Failed");
+        status = tr("Finished");
+        statusColor = STATUS_REJECTED;
+    }
+    else if (currentBlock < proposal.getSuperblock()) {
+        results = tr("Pending");
+        statusColor = STATUS_IN_PROGRESS;
     }
 
-    // Sort on superblock descending
-    std::sort(dataModel.begin(), dataModel.end(), [](const BlocknetProposal &a, const BlocknetProposal &b) {
-        return a.superblock > b.superblock;
-    });
+    gov::VoteType userVoteInt{gov::ABSTAIN};
+    QString userVote;
+    CAmount voteAmount{0};
+
+    // If proposal is invalid
+    std::string perr;
+    if (!proposal.isValid(Params().GetConsensus(), &perr)) {
+        status = tr("Invalid");
+        statusColor = STATUS_REJECTED;
+    } else {
+        // how many votes are mine?
+        auto wallets = GetWallets();
+        const auto castVote = gov::Governance::instance().getMyVotes(proposal.getHash(), pcoinsTip.get(),
+                wallets, Params().GetConsensus());
+        const auto votes = std::get<0>(castVote);
+        const auto voteType = std::get<1>(castVote);
+        const auto voted = std::get<2>(castVote);
+        voteAmount = std::get<3>(castVote);
+        if (votes > 0) {
+            if (votes > 1)
+                userVote = voteType == gov::YES ? tr("%1 YES").arg(QString::number(votes))
+                                                : voteType == gov::ABSTAIN ? tr("%1 ABSTAIN").arg(QString::number(votes))
+                                                                           : tr("%1 NO").arg(QString::number(votes));
+            else
+                userVote = voteType == gov::YES ? tr("YES")
+                                                : voteType == gov::ABSTAIN ? tr("ABSTAIN")
+                                                                           : tr("NO");
+        } else if (voted)
+            userVote = tr("Insufficient funds");
+    }
 
-    this->setData(dataModel);
+    BlocknetProposal data = {
+        proposal.getHash(),
+        statusColor,
+        QString::fromStdString(proposal.getName()),
+        proposal.getSuperblock(),
+        proposal.getAmount(),
+        QString::fromStdString(proposal.getUrl()),
+        QString::fromStdString(proposal.getDescription()),
+        status,
+        results,
+        userVoteInt,
+        userVote,
+        voteAmount
+    };
+    return data;
 }
 
 void BlocknetProposals::setWalletModel(WalletModel *w) {
     if (walletModel == w)
         return;
 
+    unsubscribeFromCoreSignals();
     walletModel = w;
     if (!walletModel || !walletModel->getOptionsModel())
         return;
 
+    connect(walletModel, &WalletModel::balanceChanged, this, &BlocknetProposals::balanceChanged);
+    modelWorker->fetchBalances(this, walletModel->getWalletName(), [this](const interfaces::WalletBalances & balances) {
+        balanceChanged(balances);
+    });
+    subscribeToCoreSignals();
     initialize();
 }
 
@@ -335,180 +358,257 @@ void BlocknetProposals::setData(QVector<BlocknetProposal> data) {
     table->setRowCount(this->filteredData.count());
     table->setSortingEnabled(false);
 
-    for (int i = 0; i < this->filteredData.count(); ++i) {
-        auto &d = this->filteredData[i];
-
-        // color indicator
-        auto *colorItem = new QTableWidgetItem;
-        auto *indicatorBox = new QFrame;
-        indicatorBox->setObjectName("indicator");
-        indicatorBox->setContentsMargins(QMargins());
-        indicatorBox->setProperty("state", QVariant(d.color));
-        indicatorBox->setFixedWidth(BGU::spi(3));
-        table->setCellWidget(i, COLUMN_COLOR, indicatorBox);
-        table->setItem(i, COLUMN_COLOR, colorItem);
-
-        // proposal hash
-        auto *hashItem = new QTableWidgetItem;
-        hashItem->setData(Qt::DisplayRole, QString::fromStdString(d.hash.GetHex()));
-        table->setItem(i, COLUMN_HASH, hashItem);
-
-        // padding 1
-        auto *pad1Item = new QTableWidgetItem;
-        table->setItem(i, COLUMN_PADDING1, pad1Item);
-
-        // name
-        auto *nameItem = new QTableWidgetItem;
-        nameItem->setData(Qt::DisplayRole, d.name);
-        table->setItem(i, COLUMN_NAME, nameItem);
-
-        // superblock
-        auto *blockItem = new QTableWidgetItem;
-        blockItem->setData(Qt::DisplayRole, d.superblock);
-        table->setItem(i, COLUMN_SUPERBLOCK, blockItem);
-
-        // amount
-        auto *amountItem = new BlocknetProposals::NumberItem;
-        amountItem->amount = d.amount;
-        amountItem->setData(Qt::DisplayRole, BitcoinUnits::floorWithUnit(walletModel->getOptionsModel()->getDisplayUnit(),
-                d.amount, 0, false, BitcoinUnits::separatorStandard));
-        table->setItem(i, COLUMN_AMOUNT, amountItem);
-
-        // url
-        auto *urlItem = new QTableWidgetItem;
-        urlItem->setData(Qt::DisplayRole, d.url);
-        table->setItem(i, COLUMN_URL, urlItem);
-
-        // description
-        auto *descItem = new QTableWidgetItem;
-        descItem->setData(Qt::DisplayRole, d.description);
-        table->setItem(i, COLUMN_DESCRIPTION, descItem);
-
-        // status
-        auto *statusItem = new QTableWidgetItem;
-        statusItem->setData(Qt::DisplayRole, d.status);
-        table->setItem(i, COLUMN_STATUS, statusItem);
-
-        // results
-        auto *resultsItem = new QTableWidgetItem;
-        resultsItem->setData(Qt::DisplayRole, d.results);
-        table->setItem(i, COLUMN_RESULTS, resultsItem);
-
-        // voted
-        auto *votedItem = new QTableWidgetItem;
-        auto *widget = new QWidget();
-        widget->setContentsMargins(QMargins());
-        widget->setSizePolicy(QSizePolicy::MinimumExpanding, QSizePolicy::MinimumExpanding);
-        auto *boxLayout = new QVBoxLayout;
-        boxLayout->setContentsMargins(QMargins());
-        boxLayout->setSpacing(0);
-        widget->setLayout(boxLayout);
-
-        auto voteText = QString();
-        switch (d.vote) {
-            case gov::YES:
-            case gov::NO:
-            case gov::ABSTAIN:
-                if (!d.voteString.isEmpty())
-                    voteText = QString("%1 %2").arg(tr("Voted"), d.voteString);
-                break;
-            default:
-                break;
-        }
+    for (int i = 0; i < this->filteredData.count(); ++i)
+        setRow(i, this->filteredData[i]);
 
-        // If we've already voted, display a label with vote status above the vote button
-        auto *voteLbl = new QLabel;
-        voteLbl->setObjectName("h6");
-        voteLbl->setWordWrap(true);
-        voteLbl->setAlignment(Qt::AlignCenter);
-        if (!voteText.isEmpty()) {
-            voteLbl->setText(voteText);
-            boxLayout->addWidget(voteLbl, 0, Qt::AlignCenter);
-            table->setRowHeight(i, BGU::spi(50));
-        } else if (getChainHeight() >= d.superblock) {
-            voteLbl->setText(tr("Did not vote"));
-            boxLayout->addWidget(voteLbl, 0, Qt::AlignCenter);
-        }
+    // Hide the vote column if we're not able to vote
+    updateVoteColumn();
+    table->setSortingEnabled(true);
+    watch();
+}
 
-        // Only show vote button if proposal voting is in progress
-        if (getChainHeight() <= d.superblock - Params().GetConsensus().proposalCutoff) {
-            auto *button = new BlocknetFormBtn;
-            button->setText(voteText.isEmpty() ? tr("Vote") : tr("Change Vote"));
-            button->setFixedSize(BGU::spi(100), BGU::spi(25));
-            button->setID(QString::fromStdString(d.hash.GetHex()));
-            boxLayout->addWidget(button, 0, Qt::AlignCenter);
-            boxLayout->addSpacing(BGU::spi(3));
-            connect(button, &BlocknetFormBtn::clicked, this, &BlocknetProposals::onVote);
-            if (voteText.isEmpty())
-                table->setRowHeight(i, BGU::spi(50));
-            else table->setRowHeight(i, BGU::spi(75));
-        }
+/**
+ * @brief Creates the items and cell widgets of the table row.
+ * @param row
+ * @param d Proposal shown in the row
+ */
+void BlocknetProposals::setRow(int row, const BlocknetProposal & d) {
+    // color indicator
+    auto *colorItem = new QTableWidgetItem;
+    auto *indicatorBox = new QFrame;
+    indicatorBox->setObjectName("indicator");
+    indicatorBox->setContentsMargins(QMargins());
+    indicatorBox->setProperty("state", QVariant(d.color));
+    indicatorBox->setFixedWidth(BGU::spi(3));
+    table->setCellWidget(row, COLUMN_COLOR, indicatorBox);
+    table->setItem(row, COLUMN_COLOR, colorItem);
+
+    // proposal hash
+    auto *hashItem = new QTableWidgetItem;
+    hashItem->setData(Qt::DisplayRole, QString::fromStdString(d.hash.GetHex()));
+    table->setItem(row, COLUMN_HASH, hashItem);
+
+    // padding 1
+    auto *pad1Item = new QTableWidgetItem;
+    table->setItem(row, COLUMN_PADDING1, pad1Item);
+
+    // name
+    auto *nameItem = new QTableWidgetItem;
+    nameItem->setData(Qt::DisplayRole, d.name);
+    table->setItem(row, COLUMN_NAME, nameItem);
+
+    // superblock
+    auto *blockItem = new QTableWidgetItem;
+    blockItem->setData(Qt::DisplayRole, d.superblock);
+    table->setItem(row, COLUMN_SUPERBLOCK, blockItem);
+
+    // amount
+    auto *amountItem = new BlocknetProposals::NumberItem;
+    amountItem->amount = d.amount;
+    amountItem->setData(Qt::DisplayRole, BitcoinUnits::floorWithUnit(walletModel->getOptionsModel()->getDisplayUnit(),
+            d.amount, 0, false, BitcoinUnits::separatorStandard));
+    table->setItem(row, COLUMN_AMOUNT, amountItem);
+
+    // url
+    auto *urlItem = new QTableWidgetItem;
+    urlItem->setData(Qt::DisplayRole, d.url);
+    table->setItem(row, COLUMN_URL, urlItem);
+
+    // description
+    auto *descItem = new QTableWidgetItem;
+    descItem->setData(Qt::DisplayRole, d.description);
+    table->setItem(row, COLUMN_DESCRIPTION, descItem);
+
+    // status
+    auto *statusItem = new QTableWidgetItem;
+    statusItem->setData(Qt::DisplayRole, d.status);
+    table->setItem(row, COLUMN_STATUS, statusItem);
+
+    // results
+    auto *resultsItem = new QTableWidgetItem;
+    resultsItem->setData(Qt::DisplayRole, d.results);
+    table->setItem(row, COLUMN_RESULTS, resultsItem);
+
+    // voted
+    auto *votedItem = new QTableWidgetItem;
+    auto *widget = new QWidget();
+    widget->setContentsMargins(QMargins());
+    widget->setSizePolicy(QSizePolicy::MinimumExpanding, QSizePolicy::MinimumExpanding);
+    auto *boxLayout = new QVBoxLayout;
+    boxLayout->setContentsMargins(QMargins());
+    boxLayout->setSpacing(0);
+    widget->setLayout(boxLayout);
+
+    auto voteText = QString();
+    switch (d.vote) {
+        case gov::YES:
+        case gov::NO:
+        case gov::ABSTAIN:
+            if (!d.voteString.isEmpty())
+                voteText = QString("%1 %2").arg(tr("Voted"), d.voteString);
+            break;
+        default:
+            break;
+    }
 
-        table->setCellWidget(i, COLUMN_VOTE, widget);
-        table->setItem(i, COLUMN_VOTE, votedItem);
+    // If we've already voted, display a label with vote status above the vote button. Rows
+    // that are updated in place start from the default height again.
+    table->setRowHeight(row, table->verticalHeader()->defaultSectionSize());
+    auto *voteLbl = new QLabel;
+    voteLbl->setObjectName("h6");
+    voteLbl->setWordWrap(true);
+    voteLbl->setAlignment(Qt::AlignCenter);
+    if (!voteText.isEmpty()) {
+        voteLbl->setText(voteText);
+        boxLayout->addWidget(voteLbl, 0, Qt::AlignCenter);
+        table->setRowHeight(row, BGU::spi(50));
+    } else if (getChainHeight() >= d.superblock) {
+        voteLbl->setText(tr("Did not vote"));
+        boxLayout->addWidget(voteLbl, 0, Qt::AlignCenter);
+    }
 
-        // padding 2
-        auto *pad2Item = new QTableWidgetItem;
-        table->setItem(i, COLUMN_PADDING2, pad2Item);
+    // Only show vote button if proposal voting is in progress
+    if (getChainHeight() <= d.superblock - Params().GetConsensus().proposalCutoff) {
+        auto *button = new BlocknetFormBtn;
+        button->setText(voteText.isEmpty() ? tr("Vote") : tr("Change Vote"));
+        button->setFixedSize(BGU::spi(100), BGU::spi(25));
+        button->setID(QString::fromStdString(d.hash.GetHex()));
+        boxLayout->addWidget(button, 0, Qt::AlignCenter);
+        boxLayout->addSpacing(BGU::spi(3));
+        connect(button, &BlocknetFormBtn::clicked, this, &BlocknetProposals::onVote);
+        if (voteText.isEmpty())
+            table->setRowHeight(row, BGU::spi(50));
+        else table->setRowHeight(row, BGU::spi(75));
     }
-    // Hide the vote column if we're not able to vote
-    bool cannotVote = !canVote();
-    if (cannotVote) table->setColumnWidth(COLUMN_VOTE, 0);
-    else table->setColumnWidth(COLUMN_VOTE, BGU::spi(150));
-    table->setColumnHidden(COLUMN_VOTE, cannotVote);
-    table->setSortingEnabled(true);
-    watch();
+
+    table->setCellWidget(row, COLUMN_VOTE, widget);
+    table->setItem(row, COLUMN_VOTE, votedItem);
+
+    // padding 2
+    auto *pad2Item = new QTableWidgetItem;
+    table->setItem(row, COLUMN_PADDING2, pad2Item);
 }
 
 QVector<BlocknetProposals::BlocknetProposal> BlocknetProposals::filtered(int filter, int chainHeight) {
     QVector<BlocknetProposal> r;
     for (auto &d : dataModel) {
-        const auto endblock = gov::NextSuperblock(Params().GetConsensus(), d.superblock);
-        switch (filter) {
-            case FILTER_ACTIVE: {
-                if (chainHeight >= d.superblock && chainHeight < endblock)
-                    r.push_back(d);
-                break;
-            }
-            case FILTER_UPCOMING: {
-                if (chainHeight < d.superblock)
-                    r.push_back(d);
-                break;
-            }
-            case FILTER_COMPLETED: {
-                if (chainHeight >= endblock)
-                    r.push_back(d);
-                break;
-            }
-            case FILTER_ALL:
-            default:
-                r.push_back(d);
-                break;
-        }
+        if (matchesFilter(d, filter, chainHeight))
+            r.push_back(d);
     }
     return r;
 }
 
+bool BlocknetProposals::matchesFilter(const BlocknetProposal & d, int filter, int chainHeight) {
+    const auto endblock = gov::NextSuperblock(Params().GetConsensus(), d.superblock);
+    switch (filter) {
+        case FILTER_ACTIVE:
+            return chainHeight >= d.superblock && chainHeight < endblock;
+        case FILTER_UPCOMING:
+            return chainHeight < d.superblock;
+        case FILTER_COMPLETED:
+            return chainHeight >= endblock;
+        case FILTER_ALL:
+        default:
+            return true;
+    }
+}
+
 bool BlocknetProposals::canVote() {
-    return walletModel->wallet().getBalance() >= Params().GetConsensus().voteBalance;
+    return walletBalance >= Params().GetConsensus().voteBalance;
+}
+
+void BlocknetProposals::balanceChanged(const interfaces::WalletBalances & balances) {
+    walletBalance = balances.balance;
+    updateVoteColumn();
 }
 
 /**
- * @brief Refreshes the display if necessary.
- * @param force Set true to force a refresh (bypass all checks).
+ * @brief Hides the vote column if the wallet balance is not sufficient to vote.
  */
-void BlocknetProposals::refresh(bool force) {
-    if (!force && dataModel.size() == static_cast<int>(gov::Governance::instance().getProposals().size())) // ignore if the proposal list hasn't changed
+void BlocknetProposals::updateVoteColumn() {
+    if (!walletModel)
         return;
+    bool cannotVote = !canVote();
+    if (cannotVote) table->setColumnWidth(COLUMN_VOTE, 0);
+    else table->setColumnWidth(COLUMN_VOTE, BGU::spi(150));
+    table->setColumnHidden(COLUMN_VOTE, cannotVote);
+}
+
+/**
+ * @brief Reloads all proposals and refreshes the display.
+ */
+void BlocknetProposals::refresh() {
     initialize();
-    onFilter();
 }
 
 /**
  * @brief Filters the data model based on the current filter dropdown filter flag.
  */
 void BlocknetProposals::onFilter() {
-    setData(filtered(proposalsDropdown->currentIndex(), getChainHeight()));
+    filteredHeight = getChainHeight();
+    setData(filtered(proposalsDropdown->currentIndex(), filteredHeight));
+}
+
+/**
+ * @brief Updates the rows of the changed proposals in place. The display is refreshed if
+ *        proposals were added or removed, or if a changed proposal enters or leaves the
+ *        current filter.
+ * @param hashes Hashes of the changed proposals
+ */
+void BlocknetProposals::onGovernanceChanged(const QStringList & hashes) {
+    if (!walletModel)
+        return;
+
+    const auto currentBlock = getChainHeight();
+    const auto filter = proposalsDropdown->currentIndex();
+    std::map<int, std::map<gov::Proposal, gov::Tally>> superblockResults;
+    QVector<BlocknetProposal> changed;
+
+    for (const auto & hex : hashes) {
+        const auto hash = uint256S(hex.toStdString());
+        auto it = std::find_if(dataModel.begin(), dataModel.end(), [&hash](const BlocknetProposal & d) {
+            return d.hash == hash;
+        });
+        const auto proposal = gov::Governance::instance().getProposal(hash);
+        if (it == dataModel.end() || proposal.isNull()) {
+            refresh();
+            return;
+        }
+        const bool shown = matchesFilter(*it, filter, filteredHeight);
+        if (shown != matchesFilter(*it, filter, currentBlock)) {
+            refresh();
+            return;
+        }
+        const int superblock = proposal.getSuperblock();
+        if (!superblockResults.count(superblock))
+            superblockResults[superblock] = gov::Governance::instance()
+                    .getSuperblockResults(superblock, Params().GetConsensus());
+        *it = proposalData(proposal, currentBlock, superblockResults[superblock]);
+        if (shown)
+            changed.push_back(*it);
+    }
+    filteredHeight = currentBlock;
+    if (changed.isEmpty())
+        return;
+
+    unwatch();
+    table->setSortingEnabled(false);
+    for (const auto & d : changed) {
+        for (auto & fd : filteredData) {
+            if (fd.hash == d.hash)
+                fd = d;
+        }
+        const auto hex = QString::fromStdString(d.hash.GetHex());
+        for (int row = 0; row < table->rowCount(); ++row) {
+            auto *hashItem = table->item(row, COLUMN_HASH);
+            if (hashItem && hashItem->data(Qt::DisplayRole).toString() == hex) {
+                setRow(row, d);
+                break;
+            }
+        }
+    }
+    table->setSortingEnabled(true);
+    watch();
 }
 
 void BlocknetProposals::onVote() {
@@ -553,8 +653,7 @@ void BlocknetProposals::onVote() {
         else {// close dialog if no errors
             dialog->close();
             // refresh data
-            initialize();
-            onFilter();
+            refresh();
         }
     });
     dialog->exec();
@@ -586,6 +685,26 @@ void BlocknetProposals::showContextMenu(QPoint pt) {
     contextMenu->exec(QCursor::pos());
 }
 
+static void NotifyGovernanceChanged(BlocknetProposals *proposals, const std::vector<uint256> & hashes)
+{
+    QStringList list;
+    for (const auto & hash : hashes)
+        list << QString::fromStdString(hash.GetHex());
+    QMetaObject::invokeMethod(proposals, "onGovernanceChanged", Qt::QueuedConnection, Q_ARG(QStringList, list));
+}
+
+void BlocknetProposals::subscribeToCoreSignals() {
+    governanceChangedHandler = walletModel->node().handleNotifyGovernanceChanged(
+            std::bind(NotifyGovernanceChanged, this, std::placeholders::_1));
+}
+
+void BlocknetProposals::unsubscribeFromCoreSignals() {
+    if (governanceChangedHandler) {
+        governanceChangedHandler->disconnect();
+        governanceChangedHandler.reset();
+    }
+}
+
 void BlocknetProposals::showProposalDetails(const BlocknetProposal & proposal) {
     auto *dialog = new BlocknetProposalsDetailsDialog(proposal, walletModel->getOptionsModel()->getDisplayUnit());
     dialog->setStyleSheet(GUIUtil::loadStyleSheet());
@@ -6,6 +6,7 @@
 #define BLOCKNETPROPOSALS_H
 
 #include <qt/blocknetdropdown.h>
+#include <qt/blocknetmodelworker.h>
 #include <qt/blocknetvars.h>
 
 #include <qt/walletmodel.h>
@@ -23,16 +24,22 @@
 #include <QScrollArea>
 #include <QTableWidget>
 #include <QTableWidgetItem>
-#include <QTimer>
 #include <QVBoxLayout>
 #include <QVector>
 
+#include <memory>
+
+namespace interfaces {
+class Handler;
+}
+
 class BlocknetProposals : public QFrame
 {
     Q_OBJECT
 
 public:
-    explicit BlocknetProposals(QFrame *parent = nullptr);
+    explicit BlocknetProposals(BlocknetModelWorker *modelWorker, QFrame *parent = nullptr);
+    ~BlocknetProposals() override;
     void setWalletModel(WalletModel *w);
 
     enum statusflags {
@@ -79,9 +86,11 @@ private Q_SLOTS:
     void onItemChanged(QTableWidgetItem *item);
     void onFilter();
     void showProposalDetails(const BlocknetProposal & proposal);
+    void onGovernanceChanged(const QStringList & hashes);
+    void balanceChanged(const interfaces::WalletBalances & balances);
 
 private:
-    int getChainHeight() const {
+    static int getChainHeight() {
         int height{std::numeric_limits<int>::max()};
         {
             LOCK(cs_main);
@@ -92,7 +101,9 @@ private:
 
 private:
     QVBoxLayout *layout;
+    BlocknetModelWorker *modelWorker;
     WalletModel *walletModel;
+    CAmount walletBalance = 0;
     QLabel *titleLbl;
     QLabel *buttonLbl;
     QLabel *filterLbl;
@@ -102,19 +113,28 @@ private:
     BlocknetDropdown *proposalsDropdown;
     QVector<BlocknetProposal> dataModel;
     QVector<BlocknetProposal> filteredData;
-    QTimer *timer;
+    int filteredHeight = 0;
+    std::unique_ptr<interfaces::Handler> governanceChangedHandler;
     int lastRow = -1;
     qint64 lastSelection = 0;
     bool syncInProgress = false;
 
     void initialize();
+    static QVector<BlocknetProposal> loadProposals();
+    static BlocknetProposal proposalData(const gov::Proposal & proposal, int currentBlock,
+                                         const std::map<gov::Proposal, gov::Tally> & sbResults);
     void setData(QVector<BlocknetProposal> data);
+    void setRow(int row, const BlocknetProposal & d);
     QVector<BlocknetProposal> filtered(int filter, int chainHeight);
+    static bool matchesFilter(const BlocknetProposal & d, int filter, int chainHeight);
     void unwatch();
     void watch();
     bool canVote();
-    void refresh(bool force = false);
+    void updateVoteColumn();
+    void refresh();
     void showContextMenu(QPoint pt);
+    void subscribeToCoreSignals();
+    void unsubscribeFromCoreSignals();
 
     enum {
         COLUMN_HASH,
@@ -653,14 +653,13 @@ void BlocknetSendFunds2::ccAccepted() {
             BlocknetSimpleUTXO utxo(uint256S(data->transaction.toStdString()), data->vout, data->address, data->camount);
             selectedUtxos.push_back(utxo);
         }
-        if (data->locked) {
-            COutPoint utxo(uint256S(data->transaction.toStdString()), data->vout);
+    }
+    // Only the utxos locked or unlocked in the dialog are passed on to the wallet
+    for (auto *data : ccDialog->getCC()->takeLockChanges()) {
+        COutPoint utxo(uint256S(data->transaction.toStdString()), data->vout);
+        if (data->locked)
             walletModel->wallet().lockCoin(utxo);
-        }
-        if (data->unlocked) {
-            COutPoint utxo(uint256S(data->transaction.toStdString()), data->vout);
-            walletModel->wallet().unlockCoin(utxo);
-        }
+        else walletModel->wallet().unlockCoin(utxo);
     }
     this->model->setTxSelectedUtxos(selectedUtxos);
     updateCoinControlSummary();
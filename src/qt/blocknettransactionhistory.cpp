@@ -333,10 +333,15 @@ void BlocknetTransactionHistory::exportClicked() {
     if (filename.isNull())
         return;
 
+    // Load the transactions that are not paged in yet
+    auto *model = transactionsTbl->model();
+    while (model->canFetchMore(QModelIndex()))
+        model->fetchMore(QModelIndex());
+
     CSVModelWriter writer(filename);
 
     // name, column, role
-    writer.setModel(transactionsTbl->model());
+    writer.setModel(model);
     writer.addColumn(tr("Confirmed"), 0, TransactionTableModel::ConfirmedRole);
 //    if (model && model->haveWatchOnly())
 //        writer.addColumn(tr("Watch-only"), TransactionTableModel::Watchonly);
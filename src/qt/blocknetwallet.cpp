@@ -42,6 +42,7 @@ BlocknetWallet::BlocknetWallet(interfaces::Node & node, const PlatformStyle *pla
     contentBox->setLayout(contentBoxLayout);
 
     leftMenu = new BlocknetLeftMenu;
+    modelWorker = new BlocknetModelWorker(this);
 
     toolbar = new BlocknetToolBar(this);
     contentBoxLayout->addWidget(toolbar, 0, Qt::AlignTop);
@@ -84,7 +85,7 @@ bool BlocknetWallet::setCurrentWallet(const QString & name) {
 
     // Dashboard screen
     if (dashboard == nullptr) {
-        dashboard = new BlocknetDashboard;
+        dashboard = new BlocknetDashboard(modelWorker);
         dashboard->setWalletModel(walletModel);
         connect(dashboard, SIGNAL(quicksend()), this, SLOT(goToQuickSend()));
         connect(dashboard, SIGNAL(history()), this, SLOT(goToHistory()));
@@ -96,7 +97,7 @@ bool BlocknetWallet::setCurrentWallet(const QString & name) {
     setLock(walletModel->getEncryptionStatus() == WalletModel::Locked, util::unlockedForStakingOnly);
 
     // Update balances
-    balanceChanged(walletModel->wallet().getBalances());
+    updateBalances();
 
     return true;
 }
@@ -183,7 +184,7 @@ void BlocknetWallet::setPage(BlocknetPage page) {
 //            break;
 //        }
         case BlocknetPage::PROPOSALS: {
-            auto *proposals = new BlocknetProposals;
+            auto *proposals = new BlocknetProposals(modelWorker);
             connect(proposals, SIGNAL(createProposal()), this, SLOT(goToCreateProposal()));
             proposals->setWalletModel(walletModel);
             screen = proposals;
@@ -261,7 +262,18 @@ void BlocknetWallet::balanceChanged(const interfaces::WalletBalances & balances)
 }
 
 void BlocknetWallet::displayUnitChanged(const int unit) {
-    balanceChanged(walletModel->wallet().getBalances());
+    updateBalances();
+}
+
+/**
+ * @brief Fetches the balances of the current wallet off the gui thread.
+ */
+void BlocknetWallet::updateBalances() {
+    const auto walletName = walletModel->getWalletName();
+    modelWorker->fetchBalances(this, walletName, [this, walletName](const interfaces::WalletBalances & balances) {
+        if (walletModel && walletModel->getWalletName() == walletName)
+            balanceChanged(balances);
+    });
 }
 
 void BlocknetWallet::changePassphrase() {
@@ -393,7 +405,7 @@ void BlocknetWallet::processNewTransaction(const QModelIndex& parent, int start,
         return;
 
     TransactionTableModel *ttm = walletModel->getTransactionTableModel();
-    if (!ttm || ttm->processingQueuedTransactions())
+    if (!ttm || ttm->processingQueuedTransactions() || ttm->fetchingMore())
         return;
 
     QString date = ttm->index(start, TransactionTableModel::Date, parent).data().toString();
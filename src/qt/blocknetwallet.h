@@ -8,6 +8,7 @@
 #include <qt/blocknetcreateproposal.h>
 #include <qt/blocknetdashboard.h>
 #include <qt/blocknetleftmenu.h>
+#include <qt/blocknetmodelworker.h>
 #include <qt/blocknetproposals.h>
 #include <qt/blocknetsendfunds.h>
 #include <qt/blocknettoolbar.h>
@@ -110,8 +111,11 @@ private:
     BlocknetDashboard *dashboard = nullptr;
     BlocknetCreateProposal *createProposal = nullptr;
     BlocknetTools *btools = nullptr;
+    BlocknetModelWorker *modelWorker;
     QWidget *screen = nullptr;
     QProgressDialog *progressDialog = nullptr;
+
+    void updateBalances();
 };
 
 #endif // BLOCKNETWALLET_H
@@ -27,6 +27,9 @@
 #include <QIcon>
 #include <QList>
 
+#include <limits>
+#include <map>
+
 
 // Amount column is right-aligned it contains numbers
 static int column_alignments[] = {
@@ -38,22 +41,9 @@ static int column_alignments[] = {
         Qt::AlignRight|Qt::AlignVCenter /* amount */
     };
 
-// Comparison operator for sort/binary search of model tx list
-struct TxLessThan
-{
-    bool operator()(const TransactionRecord &a, const TransactionRecord &b) const
-    {
-        return a.hash < b.hash;
-    }
-    bool operator()(const TransactionRecord &a, const uint256 &b) const
-    {
-        return a.hash < b;
-    }
-    bool operator()(const uint256 &a, const TransactionRecord &b) const
-    {
-        return a < b.hash;
-    }
-};
+// Number of wallet transactions loaded at a time, older transactions are loaded
+// when the view scrolls to the end of the table
+static const size_t TRANSACTION_PAGE_SIZE = 1000;
 
 // Private implementation
 class TransactionTablePriv
@@ -67,24 +57,64 @@ public:
     TransactionTableModel *parent;
 
     /* Local cache of wallet.
-     * As it is in the same order as the CWallet, by definition
-     * this is sorted by sha256.
+     * Transactions are loaded a page of blocks at a time starting with the most
+     * recent ones, and are kept in the order they were added. The records of a
+     * transaction are adjacent.
      */
     QList<TransactionRecord> cachedWallet;
 
-    /* Query entire wallet anew from core.
+    /* Row of the first record of each transaction in the cache. */
+    std::map<uint256, int> txRows;
+
+    /* Block height of the next page, -1 once all transactions are loaded. */
+    int nextHeight{std::numeric_limits<int>::max()};
+
+    /* Query the first page of the wallet anew from core.
      */
     void refreshWallet(interfaces::Wallet& wallet)
     {
         qDebug() << "TransactionTablePriv::refreshWallet";
         cachedWallet.clear();
-        {
-            for (const auto& wtx : wallet.getWalletTxs()) {
-                if (TransactionRecord::showTransaction()) {
-                    cachedWallet.append(TransactionRecord::decomposeTransaction(wtx));
-                }
-            }
+        txRows.clear();
+        nextHeight = std::numeric_limits<int>::max();
+        append(loadPage(wallet));
+    }
+
+    /* Decompose the transactions of the next page. Transactions that are already
+       in the cache are skipped.
+     */
+    QList<TransactionRecord> loadPage(interfaces::Wallet& wallet)
+    {
+        QList<TransactionRecord> records;
+        if (nextHeight < 0 || !TransactionRecord::showTransaction())
+            return records;
+        int height = nextHeight;
+        for (const auto& wtx : wallet.getWalletTxsByHeight(height, TRANSACTION_PAGE_SIZE, nextHeight)) {
+            if (!txRows.count(wtx.tx->GetHash()))
+                records.append(TransactionRecord::decomposeTransaction(wtx));
         }
+        return records;
+    }
+
+    void append(const QList<TransactionRecord>& records)
+    {
+        for (const TransactionRecord &rec : records) {
+            txRows.emplace(rec.hash, cachedWallet.size());
+            cachedWallet.append(rec);
+        }
+    }
+
+    /* Load the next page of the wallet.
+     */
+    void fetchMore(interfaces::Wallet& wallet)
+    {
+        QList<TransactionRecord> records = loadPage(wallet);
+        qDebug() << "TransactionTablePriv::fetchMore: " + QString::number(records.size()) + " nextHeight=" + QString::number(nextHeight);
+        if (records.isEmpty())
+            return;
+        parent->beginInsertRows(QModelIndex(), cachedWallet.size(), cachedWallet.size()+records.size()-1);
+        append(records);
+        parent->endInsertRows();
     }
 
     /* Update our model of the wallet incrementally, to synchronize our model of the wallet
@@ -97,13 +127,12 @@ public:
         qDebug() << "TransactionTablePriv::updateWallet: " + QString::fromStdString(hash.ToString()) + " " + QString::number(status);
 
         // Find bounds of this transaction in model
-        QList<TransactionRecord>::iterator lower = qLowerBound(
-            cachedWallet.begin(), cachedWallet.end(), hash, TxLessThan());
-        QList<TransactionRecord>::iterator upper = qUpperBound(
-            cachedWallet.begin(), cachedWallet.end(), hash, TxLessThan());
-        int lowerIndex = (lower - cachedWallet.begin());
-        int upperIndex = (upper - cachedWallet.begin());
-        bool inModel = (lower != upper);
+        auto row = txRows.find(hash);
+        bool inModel = (row != txRows.end());
+        int lowerIndex = inModel ? row->second : cachedWallet.size();
+        int upperIndex = lowerIndex;
+        while (inModel && upperIndex < cachedWallet.size() && cachedWallet[upperIndex].hash == hash)
+            upperIndex++;
 
         if(status == CT_UPDATED)
         {
@@ -128,24 +157,26 @@ public:
             if(showTransaction)
             {
                 // Find transaction in wallet
-                interfaces::WalletTx wtx = wallet.getWalletTx(hash);
+                interfaces::WalletTxStatus txStatus;
+                interfaces::WalletOrderForm orderForm;
+                bool inMempool;
+                int numBlocks;
+                interfaces::WalletTx wtx = wallet.getWalletTxDetails(hash, txStatus, orderForm, inMempool, numBlocks);
                 if(!wtx.tx)
                 {
                     qWarning() << "TransactionTablePriv::updateWallet: Warning: Got CT_NEW, but transaction is not in wallet";
                     break;
                 }
-                // Added -- insert at the right position
+                // Transactions of blocks that are not loaded yet are added with their page
+                if(txStatus.block_height <= nextHeight)
+                    break;
+                // Added -- append to the end of the table
                 QList<TransactionRecord> toInsert =
                         TransactionRecord::decomposeTransaction(wtx);
                 if(!toInsert.isEmpty()) /* only if something to insert */
                 {
                     parent->beginInsertRows(QModelIndex(), lowerIndex, lowerIndex+toInsert.size()-1);
-                    int insert_idx = lowerIndex;
-                    for (const TransactionRecord &rec : toInsert)
-                    {
-                        cachedWallet.insert(insert_idx, rec);
-                        insert_idx += 1;
-                    }
+                    append(toInsert);
                     parent->endInsertRows();
                 }
             }
@@ -158,7 +189,12 @@ public:
             }
             // Removed -- remove entire transaction from table
             parent->beginRemoveRows(QModelIndex(), lowerIndex, upperIndex-1);
-            cachedWallet.erase(lower, upper);
+            cachedWallet.erase(cachedWallet.begin()+lowerIndex, cachedWallet.begin()+upperIndex);
+            txRows.erase(row);
+            for (auto& entry : txRows) {
+                if (entry.second > lowerIndex)
+                    entry.second -= upperIndex - lowerIndex;
+            }
             parent->endRemoveRows();
             break;
         case CT_UPDATED:
@@ -275,6 +311,20 @@ int TransactionTableModel::columnCount(const QModelIndex &parent) const
     return columns.length();
 }
 
+bool TransactionTableModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && priv->nextHeight >= 0;
+}
+
+void TransactionTableModel::fetchMore(const QModelIndex &parent)
+{
+    if (!canFetchMore(parent))
+        return;
+    fFetchingMore = true;
+    priv->fetchMore(walletModel->wallet());
+    fFetchingMore = false;
+}
+
 QString TransactionTableModel::formatTxStatus(const TransactionRecord *wtx) const
 {
     QString status;
@@ -78,10 +78,15 @@ public:
 
     int rowCount(const QModelIndex &parent) const;
     int columnCount(const QModelIndex &parent) const;
+    /** Transactions are loaded a page at a time, the most recent first. */
+    bool canFetchMore(const QModelIndex &parent) const;
+    void fetchMore(const QModelIndex &parent);
     QVariant data(const QModelIndex &index, int role) const;
     QVariant headerData(int section, Qt::Orientation orientation, int role) const;
     QModelIndex index(int row, int column, const QModelIndex & parent = QModelIndex()) const;
     bool processingQueuedTransactions() const { return fProcessingQueuedTransactions; }
+    /** True while older transactions are being loaded, their rows are not new to the wallet. */
+    bool fetchingMore() const { return fFetchingMore; }
 
 private:
     WalletModel *walletModel;
@@ -90,6 +95,7 @@ private:
     QStringList columns;
     TransactionTablePriv *priv;
     bool fProcessingQueuedTransactions;
+    bool fFetchingMore{false};
     const PlatformStyle *platformStyle;
 
     void subscribeToCoreSignals();
@@ -366,6 +366,10 @@ void TransactionView::exportClicked()
     if (filename.isNull())
         return;
 
+    // Load the transactions that are not paged in yet
+    while (transactionProxyModel->canFetchMore(QModelIndex()))
+        transactionProxyModel->fetchMore(QModelIndex());
+
     CSVModelWriter writer(filename);
 
     // name, column, role
@@ -7,24 +7,30 @@
 #include <chain.h>
 #include <chainparams.h>
 #include <core_io.h>
+#include <governance/governance.h>
 #include <httpserver.h>
 #include <index/txindex.h>
+#include <key_io.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <rpc/blockchain.h>
 #include <rpc/server.h>
+#include <servicenode/servicenodemgr.h>
 #include <streams.h>
 #include <sync.h>
 #include <txmempool.h>
 #include <util/strencodings.h>
 #include <validation.h>
 #include <version.h>
+#include <xbridge/util/xutil.h>
+#include <xbridge/xbridgeapp.h>
 
 #include <boost/algorithm/string.hpp>
 
 #include <univalue.h>
 
 static const size_t MAX_GETUTXOS_OUTPOINTS = 15; //allow a max of 15 outpoints to be queried at once
+static const size_t MAX_ORDERBOOK_LEVELS = 1000; //price levels per side of /rest/orderbook
 
 enum class RetFormat {
     UNDEF,
@@ -62,6 +68,72 @@ struct CCoin {
     }
 };
 
+/** Service node entry of /rest/servicenodes */
+struct CRESTServiceNode {
+    sn::ServiceNode snode;
+    int64_t nPingTime;
+    bool fRunning;
+    std::vector<std::string> services;
+
+    ADD_SERIALIZE_METHODS;
+
+    CRESTServiceNode() : nPingTime(0), fRunning(false) {}
+    explicit CRESTServiceNode(const sn::ServiceNode& s) : snode(s), nPingTime(s.getPingTime()),
+                                                          fRunning(!s.isNull() && s.running()), services(s.serviceList()) {}
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(snode);
+        READWRITE(nPingTime);
+        READWRITE(fRunning);
+        READWRITE(services);
+    }
+};
+
+/** Proposal entry of /rest/proposals, with the vote tally */
+struct CRESTProposal {
+    gov::Proposal proposal;
+    gov::Tally tally;
+
+    ADD_SERIALIZE_METHODS;
+
+    CRESTProposal() = default;
+    CRESTProposal(const gov::Proposal& p, const gov::Tally& t) : proposal(p), tally(t) {}
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(proposal);
+        READWRITE(tally.cyes);
+        READWRITE(tally.cno);
+        READWRITE(tally.cabstain);
+        READWRITE(tally.yes);
+        READWRITE(tally.no);
+        READWRITE(tally.abstain);
+    }
+};
+
+/** Order entry of /rest/orderbook, amounts are in xbridge units */
+struct CRESTOrder {
+    uint256 id;
+    uint64_t nFromAmount;
+    uint64_t nToAmount;
+
+    ADD_SERIALIZE_METHODS;
+
+    CRESTOrder() : nFromAmount(0), nToAmount(0) {}
+    explicit CRESTOrder(const xbridge::TransactionDescrPtr& order) : id(order->id), nFromAmount(order->fromAmount), nToAmount(order->toAmount) {}
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(id);
+        READWRITE(nFromAmount);
+        READWRITE(nToAmount);
+    }
+};
+
 static bool RESTERR(HTTPRequest* req, enum HTTPStatusCode status, std::string message)
 {
     req->WriteHeader("Content-Type", "text/plain");
@@ -204,7 +276,7 @@ static bool rest_block(HTTPRequest* req,
     if (!ParseHashStr(hashStr, hash))
         return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + hashStr);
 
-    CBlock block;
+    std::shared_ptr<const CBlock> pblock;
     CBlockIndex* pblockindex = nullptr;
     CBlockIndex* tip = nullptr;
     {
@@ -218,9 +290,11 @@ static bool rest_block(HTTPRequest* req,
         if (IsBlockPruned(pblockindex))
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not available (pruned data)");
 
-        if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
+        pblock = ReadBlockFromDiskCached(pblockindex, Params().GetConsensus());
+        if (!pblock)
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
     }
+    const CBlock& block = *pblock;
 
     switch (rf) {
     case RetFormat::BINARY: {
@@ -621,6 +695,161 @@ static bool rest_blockhash_by_height(HTTPRequest* req,
     }
 }
 
+/** Write data in the requested format, json is built by toJSON */
+template <typename T>
+static bool RESTWriteData(HTTPRequest* req, const RetFormat rf, const T& data, const std::function<UniValue()>& toJSON)
+{
+    switch (rf) {
+    case RetFormat::BINARY: {
+        CDataStream ssData(SER_NETWORK, PROTOCOL_VERSION);
+        ssData << data;
+        req->WriteHeader("Content-Type", "application/octet-stream");
+        req->WriteReply(HTTP_OK, ssData.str());
+        return true;
+    }
+    case RetFormat::HEX: {
+        CDataStream ssData(SER_NETWORK, PROTOCOL_VERSION);
+        ssData << data;
+        req->WriteHeader("Content-Type", "text/plain");
+        req->WriteReply(HTTP_OK, HexStr(ssData.begin(), ssData.end()) + "\n");
+        return true;
+    }
+    case RetFormat::JSON: {
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, toJSON().write() + "\n");
+        return true;
+    }
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+}
+
+static bool rest_servicenodes(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+    if (!param.empty())
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid URI format. Expected /rest/servicenodes.<ext>");
+
+    std::vector<CRESTServiceNode> snodes;
+    for (const auto& snode : sn::ServiceNodeMgr::instance().list())
+        snodes.emplace_back(snode);
+
+    return RESTWriteData(req, rf, snodes, [&snodes]() {
+        UniValue ret(UniValue::VARR);
+        for (const auto& entry : snodes) {
+            UniValue obj(UniValue::VOBJ);
+            obj.pushKV("snodekey", HexStr(entry.snode.getSnodePubKey()));
+            obj.pushKV("tier", sn::ServiceNodeMgr::tierString(entry.snode.getTier()));
+            obj.pushKV("address", EncodeDestination(entry.snode.getPaymentAddress()));
+            obj.pushKV("timelastseen", entry.nPingTime);
+            obj.pushKV("status", entry.fRunning ? "running" : "offline");
+            UniValue services(UniValue::VARR);
+            for (const auto& service : entry.services)
+                services.push_back(service);
+            obj.pushKV("services", services);
+            ret.push_back(obj);
+        }
+        return ret;
+    });
+}
+
+static bool rest_proposals(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+
+    // Current and upcoming proposals by default, like listproposals
+    int sinceBlock = gov::PreviousSuperblock(Params().GetConsensus());
+    if (!param.empty()) {
+        if (param[0] != '/' || !ParseInt32(param.substr(1), &sinceBlock) || sinceBlock < 0)
+            return RESTERR(req, HTTP_BAD_REQUEST, "Invalid URI format. Expected /rest/proposals[/<sinceblock>].<ext>");
+    }
+
+    gov::ProposalQuery query;
+    query.fromSuperblock = sinceBlock;
+    std::vector<gov::ProposalListing> listings;
+    gov::Governance::instance().listProposals(query, Params().GetConsensus(), listings);
+    std::vector<CRESTProposal> proposals;
+    proposals.reserve(listings.size());
+    for (const auto& listing : listings)
+        proposals.emplace_back(listing.proposal, listing.tally);
+
+    return RESTWriteData(req, rf, proposals, [&proposals]() {
+        UniValue ret(UniValue::VARR);
+        for (const auto& entry : proposals) {
+            UniValue prop(UniValue::VOBJ);
+            prop.pushKV("hash", entry.proposal.getHash().ToString());
+            prop.pushKV("name", entry.proposal.getName());
+            prop.pushKV("superblock", entry.proposal.getSuperblock());
+            prop.pushKV("amount", entry.proposal.getAmount() / COIN);
+            prop.pushKV("address", entry.proposal.getAddress());
+            prop.pushKV("url", entry.proposal.getUrl());
+            prop.pushKV("description", entry.proposal.getDescription());
+            prop.pushKV("votes_yes", entry.tally.yes);
+            prop.pushKV("votes_no", entry.tally.no);
+            prop.pushKV("votes_abstain", entry.tally.abstain);
+            ret.push_back(prop);
+        }
+        return ret;
+    });
+}
+
+static bool rest_orderbook(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+    std::vector<std::string> path;
+    boost::split(path, param, boost::is_any_of("/"));
+    if (path.size() != 2 || path[0].empty() || path[1].empty())
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid URI format. Expected /rest/orderbook/<maker>/<taker>.<ext>");
+    const std::string& maker = path[0];
+    const std::string& taker = path[1];
+
+    // Full book, best price first. Asks are based in the maker token, bids in the taker token.
+    auto& xapp = xbridge::App::instance();
+    std::vector<CRESTOrder> asks;
+    std::vector<CRESTOrder> bids;
+    for (const auto& level : xapp.orderBookLevels(maker, taker, MAX_ORDERBOOK_LEVELS)) {
+        for (const auto& order : level.orders)
+            asks.emplace_back(order);
+    }
+    for (const auto& level : xapp.orderBookLevels(taker, maker, MAX_ORDERBOOK_LEVELS)) {
+        for (const auto& order : level.orders)
+            bids.emplace_back(order);
+    }
+
+    return RESTWriteData(req, rf, std::make_pair(asks, bids), [&]() {
+        // price, size and id of the orders like dxGetOrderBook detail level 3
+        auto toJSON = [](const std::vector<CRESTOrder>& orders, const bool bid) {
+            UniValue ret(UniValue::VARR);
+            for (const auto& order : orders) {
+                const double price = bid ? static_cast<double>(order.nFromAmount) / static_cast<double>(order.nToAmount)
+                                         : static_cast<double>(order.nToAmount) / static_cast<double>(order.nFromAmount);
+                UniValue entry(UniValue::VARR);
+                entry.push_back(xbridge::xBridgeStringValueFromPrice(price));
+                entry.push_back(xbridge::xBridgeStringValueFromAmount(bid ? order.nToAmount : order.nFromAmount));
+                entry.push_back(order.id.GetHex());
+                ret.push_back(entry);
+            }
+            return ret;
+        };
+        UniValue ret(UniValue::VOBJ);
+        ret.pushKV("maker", maker);
+        ret.pushKV("taker", taker);
+        ret.pushKV("asks", toJSON(asks, false));
+        ret.pushKV("bids", toJSON(bids, true));
+        return ret;
+    });
+}
+
 static const struct {
     const char* prefix;
     bool (*handler)(HTTPRequest* req, const std::string& strReq);
@@ -634,6 +863,9 @@ static const struct {
       {"/rest/headers/", rest_headers},
       {"/rest/getutxos", rest_getutxos},
       {"/rest/blockhashbyheight/", rest_blockhash_by_height},
+      {"/rest/servicenodes", rest_servicenodes},
+      {"/rest/proposals", rest_proposals},
+      {"/rest/orderbook/", rest_orderbook},
 };
 
 void StartREST()
@@ -13,16 +13,24 @@
 #include <coins.h>
 #include <consensus/validation.h>
 #include <core_io.h>
+#include <crypto/siphash.h>
 #include <hash.h>
+#include <index/addressindex.h>
+#include <index/blockfilterindex.h>
+#include <index/coinstatsindex.h>
+#include <index/spentindex.h>
 #include <index/txindex.h>
 #include <key_io.h>
+#include <node/coinstats.h>
+#include <node/utxo_snapshot.h>
 #include <policy/feerate.h>
 #include <policy/policy.h>
-#include <policy/rbf.h>
 #include <primitives/transaction.h>
+#include <random.h>
 #include <rpc/server.h>
 #include <rpc/util.h>
 #include <script/descriptor.h>
+#include <shutdown.h>
 #include <streams.h>
 #include <sync.h>
 #include <txdb.h>
@@ -44,6 +52,8 @@
 #include <memory>
 #include <mutex>
 #include <condition_variable>
+#include <thread>
+#include <unordered_set>
 
 struct CUpdatedBlock
 {
@@ -405,36 +415,30 @@ static std::string EntryDescriptionString()
            "    \"bip125-replaceable\" : true|false,  (boolean) Whether this transaction could be replaced due to BIP125 (replace-by-fee)\n";
 }
 
-static void entryToJSON(UniValue &info, const CTxMemPoolEntry &e) EXCLUSIVE_LOCKS_REQUIRED(::mempool.cs)
+static void entryToJSON(UniValue &info, const TxMempoolEntrySnapshot &e)
 {
-    AssertLockHeld(mempool.cs);
-
     UniValue fees(UniValue::VOBJ);
-    fees.pushKV("base", ValueFromAmount(e.GetFee()));
-    fees.pushKV("modified", ValueFromAmount(e.GetModifiedFee()));
-    fees.pushKV("ancestor", ValueFromAmount(e.GetModFeesWithAncestors()));
-    fees.pushKV("descendant", ValueFromAmount(e.GetModFeesWithDescendants()));
+    fees.pushKV("base", ValueFromAmount(e.fee));
+    fees.pushKV("modified", ValueFromAmount(e.modified_fee));
+    fees.pushKV("ancestor", ValueFromAmount(e.mod_fees_with_ancestors));
+    fees.pushKV("descendant", ValueFromAmount(e.mod_fees_with_descendants));
     info.pushKV("fees", fees);
 
-    info.pushKV("size", (int)e.GetTxSize());
-    info.pushKV("fee", ValueFromAmount(e.GetFee()));
-    info.pushKV("modifiedfee", ValueFromAmount(e.GetModifiedFee()));
-    info.pushKV("time", e.GetTime());
-    info.pushKV("height", (int)e.GetHeight());
-    info.pushKV("descendantcount", e.GetCountWithDescendants());
-    info.pushKV("descendantsize", e.GetSizeWithDescendants());
-    info.pushKV("descendantfees", e.GetModFeesWithDescendants());
-    info.pushKV("ancestorcount", e.GetCountWithAncestors());
-    info.pushKV("ancestorsize", e.GetSizeWithAncestors());
-    info.pushKV("ancestorfees", e.GetModFeesWithAncestors());
-    info.pushKV("wtxid", mempool.vTxHashes[e.vTxHashesIdx].first.ToString());
-    const CTransaction& tx = e.GetTx();
+    info.pushKV("size", (int)e.tx_size);
+    info.pushKV("fee", ValueFromAmount(e.fee));
+    info.pushKV("modifiedfee", ValueFromAmount(e.modified_fee));
+    info.pushKV("time", e.time);
+    info.pushKV("height", (int)e.height);
+    info.pushKV("descendantcount", e.count_with_descendants);
+    info.pushKV("descendantsize", e.size_with_descendants);
+    info.pushKV("descendantfees", e.mod_fees_with_descendants);
+    info.pushKV("ancestorcount", e.count_with_ancestors);
+    info.pushKV("ancestorsize", e.size_with_ancestors);
+    info.pushKV("ancestorfees", e.mod_fees_with_ancestors);
+    info.pushKV("wtxid", e.wtxid.ToString());
     std::set<std::string> setDepends;
-    for (const CTxIn& txin : tx.vin)
-    {
-        if (mempool.exists(txin.prevout.hash))
-            setDepends.insert(txin.prevout.hash.ToString());
-    }
+    for (const uint256& parent : e.depends)
+        setDepends.insert(parent.ToString());
 
     UniValue depends(UniValue::VARR);
     for (const std::string& dep : setDepends)
@@ -445,38 +449,29 @@ static void entryToJSON(UniValue &info, const CTxMemPoolEntry &e) EXCLUSIVE_LOCK
     info.pushKV("depends", depends);
 
     UniValue spent(UniValue::VARR);
-    const CTxMemPool::txiter &it = mempool.mapTx.find(tx.GetHash());
-    const CTxMemPool::setEntries &setChildren = mempool.GetMemPoolChildren(it);
-    for (CTxMemPool::txiter childiter : setChildren) {
-        spent.push_back(childiter->GetTx().GetHash().ToString());
+    for (const uint256& child : e.spent_by) {
+        spent.push_back(child.ToString());
     }
 
     info.pushKV("spentby", spent);
 
     // Add opt-in RBF status
-    bool rbfStatus = false;
-    RBFTransactionState rbfState = IsRBFOptIn(tx, mempool);
-    if (rbfState == RBFTransactionState::UNKNOWN) {
-        throw JSONRPCError(RPC_MISC_ERROR, "Transaction is not in mempool");
-    } else if (rbfState == RBFTransactionState::REPLACEABLE_BIP125) {
-        rbfStatus = true;
-    }
-
-    info.pushKV("bip125-replaceable", rbfStatus);
+    info.pushKV("bip125-replaceable", e.bip125_replaceable);
 }
 
 UniValue mempoolToJSON(bool fVerbose)
 {
     if (fVerbose)
     {
-        LOCK(mempool.cs);
+        // Serialize from a snapshot, mempool.cs is only held while it is copied
+        const TxMempoolSnapshotRef snapshot = mempool.GetSnapshot();
         UniValue o(UniValue::VOBJ);
-        for (const CTxMemPoolEntry& e : mempool.mapTx)
+        for (const TxMempoolEntrySnapshot& e : snapshot->entries)
         {
-            const uint256& hash = e.GetTx().GetHash();
             UniValue info(UniValue::VOBJ);
             entryToJSON(info, e);
-            o.pushKV(hash.ToString(), info);
+            // txids are unique, skip the linear key lookup of pushKV
+            o.__pushKV(e.txid.ToString(), info);
         }
         return o;
     }
@@ -588,11 +583,10 @@ static UniValue getmempoolancestors(const JSONRPCRequest& request)
     } else {
         UniValue o(UniValue::VOBJ);
         for (CTxMemPool::txiter ancestorIt : setAncestors) {
-            const CTxMemPoolEntry &e = *ancestorIt;
-            const uint256& _hash = e.GetTx().GetHash();
+            const uint256& _hash = ancestorIt->GetTx().GetHash();
             UniValue info(UniValue::VOBJ);
-            entryToJSON(info, e);
-            o.pushKV(_hash.ToString(), info);
+            entryToJSON(info, mempool.GetEntrySnapshot(ancestorIt));
+            o.__pushKV(_hash.ToString(), info);
         }
         return o;
     }
@@ -658,11 +652,10 @@ static UniValue getmempooldescendants(const JSONRPCRequest& request)
     } else {
         UniValue o(UniValue::VOBJ);
         for (CTxMemPool::txiter descendantIt : setDescendants) {
-            const CTxMemPoolEntry &e = *descendantIt;
-            const uint256& _hash = e.GetTx().GetHash();
+            const uint256& _hash = descendantIt->GetTx().GetHash();
             UniValue info(UniValue::VOBJ);
-            entryToJSON(info, e);
-            o.pushKV(_hash.ToString(), info);
+            entryToJSON(info, mempool.GetEntrySnapshot(descendantIt));
+            o.__pushKV(_hash.ToString(), info);
         }
         return o;
     }
@@ -698,9 +691,8 @@ static UniValue getmempoolentry(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Transaction not in mempool");
     }
 
-    const CTxMemPoolEntry &e = *it;
     UniValue info(UniValue::VOBJ);
-    entryToJSON(info, e);
+    entryToJSON(info, mempool.GetEntrySnapshot(it));
     return info;
 }
 
@@ -802,14 +794,14 @@ static UniValue getblockheader(const JSONRPCRequest& request)
     return blockheaderToJSON(tip, pblockindex);
 }
 
-static CBlock GetBlockChecked(const CBlockIndex* pblockindex)
+static std::shared_ptr<const CBlock> GetBlockChecked(const CBlockIndex* pblockindex)
 {
-    CBlock block;
     if (IsBlockPruned(pblockindex)) {
         throw JSONRPCError(RPC_MISC_ERROR, "Block not available (pruned data)");
     }
 
-    if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus())) {
+    std::shared_ptr<const CBlock> block = ReadBlockFromDiskCached(pblockindex, Params().GetConsensus());
+    if (!block) {
         // Block not found on disk. This could be because we have the block
         // header in our index but don't have the block (for example if a
         // non-whitelisted node sends us an unrequested long chain of valid
@@ -896,7 +888,8 @@ static UniValue getblock(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
     }
 
-    const CBlock block = GetBlockChecked(pblockindex);
+    const std::shared_ptr<const CBlock> pblock = GetBlockChecked(pblockindex);
+    const CBlock& block = *pblock;
 
     if (verbosity <= 0)
     {
@@ -909,75 +902,33 @@ static UniValue getblock(const JSONRPCRequest& request)
     return blockToJSON(block, chainActive.Tip(), pblockindex, verbosity >= 2);
 }
 
-struct CCoinsStats
+/** Block of the active chain by height or by hash. Requires cs_main. */
+static CBlockIndex* ParseHashOrHeight(const UniValue& param) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
-    int nHeight;
-    uint256 hashBlock;
-    uint64_t nTransactions;
-    uint64_t nTransactionOutputs;
-    uint64_t nBogoSize;
-    uint256 hashSerialized;
-    uint64_t nDiskSize;
-    CAmount nTotalAmount;
-
-    CCoinsStats() : nHeight(0), nTransactions(0), nTransactionOutputs(0), nBogoSize(0), nDiskSize(0), nTotalAmount(0) {}
-};
-
-static void ApplyStats(CCoinsStats &stats, CHashWriter& ss, const uint256& hash, const std::map<uint32_t, Coin>& outputs)
-{
-    assert(!outputs.empty());
-    ss << hash;
-    ss << VARINT(outputs.begin()->second.nHeight * 2 + outputs.begin()->second.fCoinBase ? 1u : 0u);
-    stats.nTransactions++;
-    for (const auto& output : outputs) {
-        ss << VARINT(output.first + 1);
-        ss << output.second.out.scriptPubKey;
-        ss << VARINT(output.second.out.nValue, VarIntMode::NONNEGATIVE_SIGNED);
-        stats.nTransactionOutputs++;
-        stats.nTotalAmount += output.second.out.nValue;
-        stats.nBogoSize += 32 /* txid */ + 4 /* vout index */ + 4 /* height + coinbase */ + 8 /* amount */ +
-                           2 /* scriptPubKey len */ + output.second.out.scriptPubKey.size() /* scriptPubKey */;
-    }
-    ss << VARINT(0u);
-}
+    AssertLockHeld(cs_main);
 
-//! Calculate statistics about the unspent transaction output set
-static bool GetUTXOStats(CCoinsView *view, CCoinsStats &stats)
-{
-    std::unique_ptr<CCoinsViewCursor> pcursor(view->Cursor());
-    assert(pcursor);
+    if (param.isNum()) {
+        const int height = param.get_int();
+        const int current_tip = chainActive.Height();
+        if (height < 0) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Target block height %d is negative", height));
+        }
+        if (height > current_tip) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Target block height %d after current tip %d", height, current_tip));
+        }
 
-    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
-    stats.hashBlock = pcursor->GetBestBlock();
-    {
-        LOCK(cs_main);
-        stats.nHeight = LookupBlockIndex(stats.hashBlock)->nHeight;
+        return chainActive[height];
     }
-    ss << stats.hashBlock;
-    uint256 prevkey;
-    std::map<uint32_t, Coin> outputs;
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        COutPoint key;
-        Coin coin;
-        if (pcursor->GetKey(key) && pcursor->GetValue(coin)) {
-            if (!outputs.empty() && key.hash != prevkey) {
-                ApplyStats(stats, ss, prevkey, outputs);
-                outputs.clear();
-            }
-            prevkey = key.hash;
-            outputs[key.n] = std::move(coin);
-        } else {
-            return error("%s: unable to read value", __func__);
-        }
-        pcursor->Next();
+
+    const uint256 hash(ParseHashV(param, "hash_or_height"));
+    CBlockIndex* pindex = LookupBlockIndex(hash);
+    if (!pindex) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
     }
-    if (!outputs.empty()) {
-        ApplyStats(stats, ss, prevkey, outputs);
+    if (!chainActive.Contains(pindex)) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Block is not in chain %s", Params().NetworkIDString()));
     }
-    stats.hashSerialized = ss.GetHash();
-    stats.nDiskSize = view->EstimateSize();
-    return true;
+    return pindex;
 }
 
 static UniValue pruneblockchain(const JSONRPCRequest& request)
@@ -1035,46 +986,104 @@ static UniValue pruneblockchain(const JSONRPCRequest& request)
 
 static UniValue gettxoutsetinfo(const JSONRPCRequest& request)
 {
-    if (request.fHelp || request.params.size() != 0)
+    if (request.fHelp || request.params.size() > 3)
         throw std::runtime_error(
             RPCHelpMan{"gettxoutsetinfo",
                 "\nReturns statistics about the unspent transaction output set.\n"
-                "Note this call may take some time.\n",
-                {},
+                "Note this call may take some time unless the stats are read from -coinstatsindex.\n",
+                {
+                    {"hash_type", RPCArg::Type::STR, /* default */ "hash_serialized_2", "Which UTXO set hash should be calculated. Options: 'hash_serialized_2' (the legacy algorithm), 'muhash', 'none'.\n"
+            "                  'muhash' and 'none' read the coins in parallel."},
+                    {"hash_or_height", RPCArg::Type::NUM, /* default */ "the current best block", "The block hash or height of the target height (only available with coinstatsindex).", "", {"", "string or numeric"}},
+                    {"use_index", RPCArg::Type::BOOL, /* default */ "true", "Use coinstatsindex, if available."},
+                },
                 RPCResult{
             "{\n"
-            "  \"height\":n,     (numeric) The current block height (index)\n"
-            "  \"bestblock\": \"hex\",   (string) The hash of the block at the tip of the chain\n"
-            "  \"transactions\": n,      (numeric) The number of transactions with unspent outputs\n"
+            "  \"height\":n,     (numeric) The block height (index) of the returned statistics\n"
+            "  \"bestblock\": \"hex\",   (string) The hash of the block at which these statistics are calculated\n"
+            "  \"transactions\": n,      (numeric) The number of transactions with unspent outputs (not available when coinstatsindex is used)\n"
             "  \"txouts\": n,            (numeric) The number of unspent transaction outputs\n"
             "  \"bogosize\": n,          (numeric) A meaningless metric for UTXO set size\n"
-            "  \"hash_serialized_2\": \"hash\", (string) The serialized hash\n"
-            "  \"disk_size\": n,         (numeric) The estimated size of the chainstate on disk\n"
+            "  \"hash_serialized_2\": \"hash\", (string) The serialized hash (only present if 'hash_serialized_2' hash_type is chosen)\n"
+            "  \"muhash\": \"hash\",     (string) The serialized hash (only present if 'muhash' hash_type is chosen)\n"
+            "  \"disk_size\": n,         (numeric) The estimated size of the chainstate on disk (not available when coinstatsindex is used)\n"
             "  \"total_amount\": x.xxx          (numeric) The total amount\n"
             "}\n"
                 },
                 RPCExamples{
                     HelpExampleCli("gettxoutsetinfo", "")
+            + HelpExampleCli("gettxoutsetinfo", "\"none\"")
+            + HelpExampleCli("gettxoutsetinfo", "\"muhash\" 1000")
             + HelpExampleRpc("gettxoutsetinfo", "")
+            + HelpExampleRpc("gettxoutsetinfo", "\"muhash\", 1000")
                 },
             }.ToString());
 
     UniValue ret(UniValue::VOBJ);
 
     CCoinsStats stats;
-    FlushStateToDisk();
-    if (GetUTXOStats(pcoinsdbview.get(), stats)) {
-        ret.pushKV("height", (int64_t)stats.nHeight);
-        ret.pushKV("bestblock", stats.hashBlock.GetHex());
+    const std::string hash_type = request.params[0].isNull() ? "hash_serialized_2" : request.params[0].get_str();
+    if (hash_type == "hash_serialized_2") {
+        stats.hash_type = CoinStatsHashType::HASH_SERIALIZED;
+    } else if (hash_type == "muhash") {
+        stats.hash_type = CoinStatsHashType::MUHASH;
+    } else if (hash_type == "none") {
+        stats.hash_type = CoinStatsHashType::NONE;
+    } else {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("%s is not a valid hash_type", hash_type));
+    }
+    const bool use_index = request.params[2].isNull() || request.params[2].get_bool();
+
+    const CBlockIndex* pindex = nullptr;
+    if (!request.params[1].isNull()) {
+        if (!g_coinstatsindex) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Querying specific block heights requires coinstatsindex");
+        }
+        if (stats.hash_type == CoinStatsHashType::HASH_SERIALIZED) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "hash_serialized_2 hash type cannot be queried for a specific block");
+        }
+        if (!use_index) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Querying specific block heights requires use_index");
+        }
+        LOCK(cs_main);
+        pindex = ParseHashOrHeight(request.params[1]);
+    }
+
+    if (g_coinstatsindex && use_index && stats.hash_type != CoinStatsHashType::HASH_SERIALIZED) {
+        const bool index_ready = g_coinstatsindex->BlockUntilSyncedToCurrentChain();
+        if (!pindex) {
+            LOCK(cs_main);
+            pindex = chainActive.Tip();
+        }
+        if (!g_coinstatsindex->LookUpStats(pindex, stats)) {
+            if (!index_ready) {
+                throw JSONRPCError(RPC_MISC_ERROR, "UTXO set stats are still in the process of being indexed.");
+            }
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read UTXO set stats from coinstatsindex");
+        }
+    } else {
+        FlushStateToDisk();
+        if (!GetUTXOStats(pcoinsdbview.get(), stats)) {
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read UTXO set");
+        }
+    }
+
+    ret.pushKV("height", (int64_t)stats.nHeight);
+    ret.pushKV("bestblock", stats.hashBlock.GetHex());
+    if (!stats.from_index) {
         ret.pushKV("transactions", (int64_t)stats.nTransactions);
-        ret.pushKV("txouts", (int64_t)stats.nTransactionOutputs);
-        ret.pushKV("bogosize", (int64_t)stats.nBogoSize);
+    }
+    ret.pushKV("txouts", (int64_t)stats.nTransactionOutputs);
+    ret.pushKV("bogosize", (int64_t)stats.nBogoSize);
+    if (stats.hash_type == CoinStatsHashType::HASH_SERIALIZED) {
         ret.pushKV("hash_serialized_2", stats.hashSerialized.GetHex());
+    } else if (stats.hash_type == CoinStatsHashType::MUHASH) {
+        ret.pushKV("muhash", stats.hashSerialized.GetHex());
+    }
+    if (!stats.from_index) {
         ret.pushKV("disk_size", stats.nDiskSize);
-        ret.pushKV("total_amount", ValueFromAmount(stats.nTotalAmount));
-    } else {
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read UTXO set");
     }
+    ret.pushKV("total_amount", ValueFromAmount(stats.nTotalAmount));
     return ret;
 }
 
@@ -1833,28 +1842,7 @@ static UniValue getblockstats(const JSONRPCRequest& request)
 
     LOCK(cs_main);
 
-    CBlockIndex* pindex;
-    if (request.params[0].isNum()) {
-        const int height = request.params[0].get_int();
-        const int current_tip = chainActive.Height();
-        if (height < 0) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Target block height %d is negative", height));
-        }
-        if (height > current_tip) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Target block height %d after current tip %d", height, current_tip));
-        }
-
-        pindex = chainActive[height];
-    } else {
-        const uint256 hash(ParseHashV(request.params[0], "hash_or_height"));
-        pindex = LookupBlockIndex(hash);
-        if (!pindex) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
-        }
-        if (!chainActive.Contains(pindex)) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Block is not in chain %s", Params().NetworkIDString()));
-        }
-    }
+    CBlockIndex* pindex = ParseHashOrHeight(request.params[0]);
 
     assert(pindex != nullptr);
 
@@ -1867,7 +1855,8 @@ static UniValue getblockstats(const JSONRPCRequest& request)
         }
     }
 
-    const CBlock block = GetBlockChecked(pindex);
+    const std::shared_ptr<const CBlock> pblock = GetBlockChecked(pindex);
+    const CBlock& block = *pblock;
 
     const bool do_all = stats.size() == 0; // Calculate everything if nothing selected (default)
     const bool do_mediantxsize = do_all || stats.count("mediantxsize") != 0;
@@ -2061,17 +2050,43 @@ static UniValue savemempool(const JSONRPCRequest& request)
     return NullUniValue;
 }
 
-//! Search for a given set of pubkey scripts
-bool FindScriptPubKey(std::atomic<int>& scan_progress, const std::atomic<bool>& should_abort, int64_t& count, CCoinsViewCursor* cursor, const std::set<CScript>& needles, std::map<COutPoint, Coin>& out_results) {
-    scan_progress = 0;
+//! Ranges of the UTXO set scanned in parallel by scantxoutset
+static const size_t SCAN_RANGES = 64;
+//! The scan progress counts the first two bytes of the txids passed
+static const uint32_t SCAN_KEYSPACE = 0x10000;
+
+/** Salted hash of a script, for the set of scripts scantxoutset looks for */
+class SaltedScriptHasher
+{
+private:
+    uint64_t k0, k1;
+
+public:
+    SaltedScriptHasher()
+    {
+        GetRandBytes(reinterpret_cast<unsigned char*>(&k0), sizeof(k0));
+        GetRandBytes(reinterpret_cast<unsigned char*>(&k1), sizeof(k1));
+    }
+
+    size_t operator()(const CScript& script) const
+    {
+        return CSipHasher(k0, k1).Write(script.data(), script.size()).Finalize();
+    }
+};
+
+typedef std::unordered_set<CScript, SaltedScriptHasher> ScriptSet;
+
+//! Search for a given set of pubkey scripts in the coins of the cursor, which end before
+//! txids starting with range_end. The part of the txid space passed is added to scanned.
+bool FindScriptPubKey(std::atomic<uint32_t>& scanned, const std::atomic<bool>& should_abort, int64_t& count, CCoinsViewCursor* cursor, const ScriptSet& needles, std::map<COutPoint, Coin>& out_results, uint32_t range_begin, uint32_t range_end) {
     count = 0;
+    uint32_t pos = range_begin;
     while (cursor->Valid()) {
         COutPoint key;
         Coin coin;
         if (!cursor->GetKey(key) || !cursor->GetValue(coin)) return false;
         if (++count % 8192 == 0) {
-            boost::this_thread::interruption_point();
-            if (should_abort) {
+            if (should_abort || ShutdownRequested()) {
                 // allow to abort the scan via the abort reference
                 return false;
             }
@@ -2079,20 +2094,23 @@ bool FindScriptPubKey(std::atomic<int>& scan_progress, const std::atomic<bool>&
         if (count % 256 == 0) {
             // update progress reference every 256 item
             uint32_t high = 0x100 * *key.hash.begin() + *(key.hash.begin() + 1);
-            scan_progress = (int)(high * 100.0 / 65536.0 + 0.5);
+            if (high > pos) {
+                scanned += high - pos;
+                pos = high;
+            }
         }
         if (needles.count(coin.out.scriptPubKey)) {
             out_results.emplace(key, coin);
         }
         cursor->Next();
     }
-    scan_progress = 100;
+    scanned += range_end - pos;
     return true;
 }
 
 /** RAII object to prevent concurrency issue when scanning the txout set */
 static std::mutex g_utxosetscan;
-static std::atomic<int> g_scan_progress;
+static std::atomic<uint32_t> g_scan_scanned;
 static std::atomic<bool> g_scan_in_progress;
 static std::atomic<bool> g_should_abort_scan;
 class CoinsViewScanReserver
@@ -2128,6 +2146,7 @@ UniValue scantxoutset(const JSONRPCRequest& request)
             RPCHelpMan{"scantxoutset",
                 "\nEXPERIMENTAL warning: this call may be removed or changed in future releases.\n"
                 "\nScans the unspent transaction output set for entries that match certain output descriptors.\n"
+                "Ranges of the set are scanned in parallel, one thread per core.\n"
                 "Examples of output descriptors are:\n"
                 "    addr(<address>)                      Outputs whose scriptPubKey corresponds to the specified address (does not include P2PK)\n"
                 "    raw(<hex script>)                    Outputs whose scriptPubKey equals the specified hex scripts\n"
@@ -2185,7 +2204,7 @@ UniValue scantxoutset(const JSONRPCRequest& request)
             // no scan in progress
             return NullUniValue;
         }
-        result.pushKV("progress", g_scan_progress);
+        result.pushKV("progress", (int)(g_scan_scanned * 100.0 / SCAN_KEYSPACE + 0.5));
         return result;
     } else if (request.params[0].get_str() == "abort") {
         CoinsViewScanReserver reserver;
@@ -2201,7 +2220,7 @@ UniValue scantxoutset(const JSONRPCRequest& request)
         if (!reserver.reserve()) {
             throw JSONRPCError(RPC_INVALID_PARAMETER, "Scan already in progress, use action \"abort\" or \"status\"");
         }
-        std::set<CScript> needles;
+        ScriptSet needles;
         std::map<CScript, std::string> descriptors;
         CAmount total_in = 0;
 
@@ -2233,13 +2252,15 @@ UniValue scantxoutset(const JSONRPCRequest& request)
                 range.first = 0;
                 range.second = 0;
             }
-            for (int i = range.first; i <= range.second; ++i) {
-                std::vector<CScript> scripts;
-                if (!desc->Expand(i, provider, scripts, provider)) {
-                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, strprintf("Cannot derive script without private keys: '%s'", desc_str));
-                }
-                for (const auto& script : scripts) {
-                    std::string inferred = InferDescriptor(script, provider)->ToString();
+            std::vector<std::vector<CScript>> range_scripts;
+            std::vector<FlatSigningProvider> range_out;
+            if (!ExpandRange(*desc, range.first, range.second, provider, range_scripts, range_out)) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, strprintf("Cannot derive script without private keys: '%s'", desc_str));
+            }
+            for (size_t i = 0; i < range_scripts.size(); ++i) {
+                const FlatSigningProvider solving = Merge(provider, range_out[i]);
+                for (auto& script : range_scripts[i]) {
+                    std::string inferred = InferDescriptor(script, solving)->ToString();
                     needles.emplace(script);
                     descriptors.emplace(std::move(script), std::move(inferred));
                 }
@@ -2251,17 +2272,48 @@ UniValue scantxoutset(const JSONRPCRequest& request)
         std::vector<CTxOut> input_txos;
         std::map<COutPoint, Coin> coins;
         g_should_abort_scan = false;
-        g_scan_progress = 0;
-        int64_t count = 0;
-        std::unique_ptr<CCoinsViewCursor> pcursor;
+        g_scan_scanned = 0;
+        std::vector<std::unique_ptr<CCoinsViewCursor>> cursors;
         {
             LOCK(cs_main);
             FlushStateToDisk();
-            pcursor = std::unique_ptr<CCoinsViewCursor>(pcoinsdbview->Cursor());
-            assert(pcursor);
+            // Flushed coins are written in the background, no write starts without cs_main
+            if (pcoinsflusher && !pcoinsflusher->Sync()) {
+                throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to write the coins database");
+            }
+            cursors = pcoinsdbview->RangeCursors(SCAN_RANGES);
+        }
+
+        // The ranges are scanned in parallel, each thread takes the next range when done
+        const size_t num_ranges = cursors.size();
+        std::vector<std::map<COutPoint, Coin>> range_coins(num_ranges);
+        std::vector<int64_t> range_counts(num_ranges, 0);
+        std::atomic<size_t> next{0};
+        std::atomic<bool> failed{false};
+        auto worker = [&]() {
+            for (size_t i = next++; i < num_ranges && !failed; i = next++) {
+                const uint32_t range_begin = i * 256 / num_ranges * 0x100;
+                const uint32_t range_end = (i + 1) * 256 / num_ranges * 0x100;
+                if (!FindScriptPubKey(g_scan_scanned, g_should_abort_scan, range_counts[i], cursors[i].get(),
+                                      needles, range_coins[i], range_begin, range_end)) {
+                    failed = true;
+                }
+            }
+        };
+        const size_t num_threads = std::min<size_t>(std::max(GetNumCores(), 1), num_ranges);
+        std::vector<std::thread> threads;
+        for (size_t t = 1; t < num_threads; ++t)
+            threads.emplace_back(worker);
+        worker();
+        for (auto& thread : threads)
+            thread.join();
+
+        int64_t count = 0;
+        for (size_t i = 0; i < num_ranges; ++i) {
+            count += range_counts[i];
+            coins.insert(range_coins[i].begin(), range_coins[i].end());
         }
-        bool res = FindScriptPubKey(g_scan_progress, g_should_abort_scan, count, pcursor.get(), needles, coins);
-        result.pushKV("success", res);
+        result.pushKV("success", !failed);
         result.pushKV("searched_items", count);
 
         for (const auto& it : coins) {
@@ -2289,6 +2341,351 @@ UniValue scantxoutset(const JSONRPCRequest& request)
     return result;
 }
 
+static UniValue getblockfilter(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2) {
+        throw std::runtime_error(
+            RPCHelpMan{"getblockfilter",
+                "\nRetrieve a BIP 157 content filter for a particular block.\n"
+                "Requires -blockfilterindex.\n",
+                {
+                    {"blockhash", RPCArg::Type::STR_HEX, RPCArg::Optional::NO, "The hash of the block"},
+                    {"filtertype", RPCArg::Type::STR, /*default*/ "basic", "The type name of the filter"},
+                },
+                RPCResult{
+            "{\n"
+            "  \"filter\" : (string) the hex-encoded filter data\n"
+            "  \"header\" : (string) the hex-encoded filter header\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getblockfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\" \"basic\"")
+            + HelpExampleRpc("getblockfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\", \"basic\"")
+                },
+            }.ToString());
+    }
+
+    uint256 block_hash = ParseHashV(request.params[0], "blockhash");
+    if (!request.params[1].isNull() && request.params[1].get_str() != "basic") {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown filtertype");
+    }
+
+    if (!g_blockfilterindex) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Index is not enabled for filtertype basic");
+    }
+
+    const CBlockIndex* block_index;
+    bool block_was_connected;
+    {
+        LOCK(cs_main);
+        block_index = LookupBlockIndex(block_hash);
+        if (!block_index) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+        }
+        block_was_connected = block_index->IsValid(BLOCK_VALID_SCRIPTS);
+    }
+
+    bool index_ready = g_blockfilterindex->BlockUntilSyncedToCurrentChain();
+
+    BlockFilter filter;
+    uint256 filter_header;
+    if (!g_blockfilterindex->LookupFilter(block_index, filter) ||
+        !g_blockfilterindex->LookupFilterHeader(block_index, filter_header)) {
+        int err_code;
+        std::string errmsg = "Filter not found.";
+
+        if (!block_was_connected) {
+            err_code = RPC_INVALID_ADDRESS_OR_KEY;
+            errmsg += " Block was not connected to active chain.";
+        } else if (!index_ready) {
+            err_code = RPC_MISC_ERROR;
+            errmsg += " Block filters are still in the process of being indexed.";
+        } else {
+            err_code = RPC_INTERNAL_ERROR;
+            errmsg += " This error is unexpected and indicates index corruption.";
+        }
+
+        throw JSONRPCError(err_code, errmsg);
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("filter", HexStr(filter.GetEncodedFilter()));
+    ret.pushKV("header", filter_header.GetHex());
+    return ret;
+}
+
+static UniValue dumpsnapshot(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            RPCHelpMan{"dumpsnapshot",
+                "\nWrites a snapshot of the chain state at the tip to a file: the UTXO set, the governance\n"
+                "proposals and votes, the servicenode list and the stake modifiers of the last blocks.\n"
+                "The UTXO set hash of the snapshot can be compared with gettxoutsetinfo \"muhash\".\n",
+                {
+                    {"path", RPCArg::Type::STR, RPCArg::Optional::NO, "The path of the snapshot file, relative to the data directory unless absolute."},
+                },
+                RPCResult{
+            "{\n"
+            "  \"base_hash\": \"hex\",     (string) The hash of the block the snapshot was taken at\n"
+            "  \"base_height\": n,       (numeric) The height of the block the snapshot was taken at\n"
+            "  \"coins_written\": n,     (numeric) The number of coins written\n"
+            "  \"muhash\": \"hash\",       (string) The MuHash3072 of the coins\n"
+            "  \"stake_modifiers\": n,   (numeric) The number of stake modifiers written\n"
+            "  \"proposals\": n,         (numeric) The number of governance proposals written\n"
+            "  \"votes\": n,             (numeric) The number of governance votes written\n"
+            "  \"servicenodes\": n,      (numeric) The number of servicenodes written\n"
+            "  \"path\": \"path\"          (string) The absolute path of the snapshot file\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("dumpsnapshot", "\"snapshot.dat\"")
+            + HelpExampleRpc("dumpsnapshot", "\"snapshot.dat\"")
+                },
+            }.ToString());
+
+    const fs::path path = fs::absolute(request.params[0].get_str(), GetDataDir());
+    // The file is renamed once complete so that a partial snapshot is never mistaken for one
+    const fs::path temppath = path.string() + ".incomplete";
+    if (fs::exists(path)) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, path.string() + " already exists. If you are sure this is what you want, move it out of the way first");
+    }
+
+    SnapshotMetadata metadata;
+    SnapshotStats stats;
+    std::string error;
+    if (!WriteChainSnapshot(temppath, metadata, stats, error)) {
+        fs::remove(temppath);
+        throw JSONRPCError(RPC_MISC_ERROR, error);
+    }
+    if (!RenameOver(temppath, path)) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Failed to rename " + temppath.string());
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("base_hash", metadata.base_blockhash.GetHex());
+    ret.pushKV("base_height", metadata.base_height);
+    ret.pushKV("coins_written", (int64_t)metadata.coins_count);
+    ret.pushKV("muhash", metadata.utxo_muhash.GetHex());
+    ret.pushKV("stake_modifiers", (int64_t)stats.stake_modifiers);
+    ret.pushKV("proposals", (int64_t)stats.proposals);
+    ret.pushKV("votes", (int64_t)stats.votes);
+    ret.pushKV("servicenodes", (int64_t)stats.servicenodes);
+    ret.pushKV("path", path.string());
+    return ret;
+}
+
+//! Returns the script of the address parameter once the address index caught up with the chain
+static CScript AddressIndexScript(const UniValue& param)
+{
+    const CTxDestination dest = DecodeDestination(param.get_str());
+    if (!IsValidDestination(dest)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+    }
+    if (!g_addressindex) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Address index is not enabled, start with -addressindex");
+    }
+    if (!g_addressindex->BlockUntilSyncedToCurrentChain()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Addresses are still in the process of being indexed.");
+    }
+    return GetScriptForDestination(dest);
+}
+
+static UniValue getaddressbalance(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            RPCHelpMan{"getaddressbalance",
+                "\nReturns the balance of an address in the active chain.\n"
+                "Requires -addressindex.\n",
+                {
+                    {"address", RPCArg::Type::STR, RPCArg::Optional::NO, "The address"},
+                },
+                RPCResult{
+            "{\n"
+            "  \"balance\": x.xxx,     (numeric) The sum of the unspent outputs of the address\n"
+            "  \"received\": x.xxx,    (numeric) The sum of all outputs paid to the address\n"
+            "  \"utxos\": n            (numeric) The number of unspent outputs of the address\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getaddressbalance", "\"BmbQ6PZxAKAb3dpuQomoKmYYMV8qNfKK8E\"")
+            + HelpExampleRpc("getaddressbalance", "\"BmbQ6PZxAKAb3dpuQomoKmYYMV8qNfKK8E\"")
+                },
+            }.ToString());
+
+    const CScript script = AddressIndexScript(request.params[0]);
+    std::vector<AddressUnspentEntry> unspent;
+    std::vector<AddressHistoryEntry> history;
+    if (!g_addressindex->FindUnspent(script, unspent) || !g_addressindex->FindHistory(script, 0, history)) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read the address from addressindex");
+    }
+
+    CAmount balance{0};
+    for (const auto& entry : unspent) {
+        balance += entry.amount;
+    }
+    CAmount received{0};
+    for (const auto& entry : history) {
+        if (!entry.spending) {
+            received += entry.amount;
+        }
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("balance", ValueFromAmount(balance));
+    ret.pushKV("received", ValueFromAmount(received));
+    ret.pushKV("utxos", (int64_t)unspent.size());
+    return ret;
+}
+
+static UniValue getaddressutxos(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            RPCHelpMan{"getaddressutxos",
+                "\nReturns the unspent outputs of an address in the active chain.\n"
+                "Requires -addressindex.\n",
+                {
+                    {"address", RPCArg::Type::STR, RPCArg::Optional::NO, "The address"},
+                },
+                RPCResult{
+            "[\n"
+            "  {\n"
+            "    \"txid\": \"hash\",       (string) The transaction id\n"
+            "    \"vout\": n,            (numeric) The output number\n"
+            "    \"amount\": x.xxx,      (numeric) The amount of the output\n"
+            "    \"height\": n           (numeric) The height of the block that created the output\n"
+            "  },\n"
+            "  ...\n"
+            "]\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getaddressutxos", "\"BmbQ6PZxAKAb3dpuQomoKmYYMV8qNfKK8E\"")
+            + HelpExampleRpc("getaddressutxos", "\"BmbQ6PZxAKAb3dpuQomoKmYYMV8qNfKK8E\"")
+                },
+            }.ToString());
+
+    const CScript script = AddressIndexScript(request.params[0]);
+    std::vector<AddressUnspentEntry> unspent;
+    if (!g_addressindex->FindUnspent(script, unspent)) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read the address from addressindex");
+    }
+
+    UniValue ret(UniValue::VARR);
+    for (const auto& entry : unspent) {
+        UniValue utxo(UniValue::VOBJ);
+        utxo.pushKV("txid", entry.outpoint.hash.GetHex());
+        utxo.pushKV("vout", (int64_t)entry.outpoint.n);
+        utxo.pushKV("amount", ValueFromAmount(entry.amount));
+        utxo.pushKV("height", entry.height);
+        ret.push_back(utxo);
+    }
+    return ret;
+}
+
+static UniValue getaddresshistory(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        throw std::runtime_error(
+            RPCHelpMan{"getaddresshistory",
+                "\nReturns the transactions that paid to or spent from an address in the active chain, oldest first.\n"
+                "Requires -addressindex.\n",
+                {
+                    {"address", RPCArg::Type::STR, RPCArg::Optional::NO, "The address"},
+                    {"height_begin", RPCArg::Type::NUM, /* default */ "0", "Leave out the transactions of the blocks below this height"},
+                },
+                RPCResult{
+            "[\n"
+            "  {\n"
+            "    \"txid\": \"hash\",       (string) The transaction id\n"
+            "    \"height\": n,          (numeric) The height of the block of the transaction\n"
+            "    \"index\": n,           (numeric) The output number, or the input number when spending\n"
+            "    \"spending\": true|false, (boolean) Whether the transaction spent from the address\n"
+            "    \"amount\": x.xxx       (numeric) The amount received, negative when spending\n"
+            "  },\n"
+            "  ...\n"
+            "]\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getaddresshistory", "\"BmbQ6PZxAKAb3dpuQomoKmYYMV8qNfKK8E\" 1000")
+            + HelpExampleRpc("getaddresshistory", "\"BmbQ6PZxAKAb3dpuQomoKmYYMV8qNfKK8E\", 1000")
+                },
+            }.ToString());
+
+    const CScript script = AddressIndexScript(request.params[0]);
+    const int height_begin = request.params[1].isNull() ? 0 : request.params[1].get_int();
+    if (height_begin < 0) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative height_begin");
+    }
+    std::vector<AddressHistoryEntry> history;
+    if (!g_addressindex->FindHistory(script, height_begin, history)) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read the address from addressindex");
+    }
+
+    UniValue ret(UniValue::VARR);
+    for (const auto& entry : history) {
+        UniValue tx(UniValue::VOBJ);
+        tx.pushKV("txid", entry.txid.GetHex());
+        tx.pushKV("height", entry.height);
+        tx.pushKV("index", (int64_t)entry.index);
+        tx.pushKV("spending", entry.spending);
+        tx.pushKV("amount", ValueFromAmount(entry.amount));
+        ret.push_back(tx);
+    }
+    return ret;
+}
+
+static UniValue getspentinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 2)
+        throw std::runtime_error(
+            RPCHelpMan{"getspentinfo",
+                "\nReturns the input of the active chain that spent an output.\n"
+                "Requires -spentindex.\n",
+                {
+                    {"txid", RPCArg::Type::STR_HEX, RPCArg::Optional::NO, "The transaction id of the output"},
+                    {"n", RPCArg::Type::NUM, RPCArg::Optional::NO, "The output number"},
+                },
+                RPCResult{
+            "{\n"
+            "  \"txid\": \"hash\",       (string) The id of the spending transaction\n"
+            "  \"index\": n,           (numeric) The input number of the spending transaction\n"
+            "  \"height\": n,          (numeric) The height of the block of the spending transaction\n"
+            "  \"blockhash\": \"hash\"   (string) The hash of the block of the spending transaction\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getspentinfo", "\"txid\" 1")
+            + HelpExampleRpc("getspentinfo", "\"txid\", 1")
+                },
+            }.ToString());
+
+    const uint256 txid = ParseHashV(request.params[0], "txid");
+    const int n = request.params[1].get_int();
+    if (n < 0) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative output number");
+    }
+    if (!g_spentindex) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Spent index is not enabled, start with -spentindex");
+    }
+    if (!g_spentindex->BlockUntilSyncedToCurrentChain()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Spends are still in the process of being indexed.");
+    }
+
+    SpentIndexEntry entry;
+    if (!g_spentindex->FindSpend(COutPoint(txid, static_cast<uint32_t>(n)), entry)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No spend of the output in the active chain");
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("txid", entry.txid.GetHex());
+    ret.pushKV("index", (int64_t)entry.index);
+    ret.pushKV("height", entry.height);
+    ret.pushKV("blockhash", entry.block_hash.GetHex());
+    return ret;
+}
+
 // clang-format off
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
@@ -2301,6 +2698,7 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getblock",               &getblock,               {"blockhash","verbosity|verbose"} },
     { "blockchain",         "getblockhash",           &getblockhash,           {"height"} },
     { "blockchain",         "getblockheader",         &getblockheader,         {"blockhash","verbose"} },
+    { "blockchain",         "getblockfilter",         &getblockfilter,         {"blockhash", "filtertype"} },
     { "blockchain",         "getchaintips",           &getchaintips,           {} },
     { "blockchain",         "getdifficulty",          &getdifficulty,          {} },
     { "blockchain",         "getmempoolancestors",    &getmempoolancestors,    {"txid","verbose"} },
@@ -2309,13 +2707,18 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         {} },
     { "blockchain",         "getrawmempool",          &getrawmempool,          {"verbose"} },
     { "blockchain",         "gettxout",               &gettxout,               {"txid","n","include_mempool"} },
-    { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        {} },
+    { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        {"hash_type", "hash_or_height", "use_index"} },
     { "blockchain",         "pruneblockchain",        &pruneblockchain,        {"height"} },
     { "blockchain",         "savemempool",            &savemempool,            {} },
     { "blockchain",         "verifychain",            &verifychain,            {"checklevel","nblocks"} },
 
     { "blockchain",         "preciousblock",          &preciousblock,          {"blockhash"} },
     { "blockchain",         "scantxoutset",           &scantxoutset,           {"action", "scanobjects"} },
+    { "blockchain",         "dumpsnapshot",           &dumpsnapshot,           {"path"} },
+    { "blockchain",         "getaddressbalance",      &getaddressbalance,      {"address"} },
+    { "blockchain",         "getaddressutxos",        &getaddressutxos,        {"address"} },
+    { "blockchain",         "getaddresshistory",      &getaddresshistory,      {"address", "height_begin"} },
+    { "blockchain",         "getspentinfo",           &getspentinfo,           {"txid", "n"} },
 
     /* Not shown in help */
     { "hidden",             "invalidateblock",        &invalidateblock,        {"blockhash"} },
@@ -119,6 +119,10 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "gettxout", 1, "n" },
     { "gettxout", 2, "include_mempool" },
     { "gettxoutproof", 0, "txids" },
+    { "gettxoutsetinfo", 1, "hash_or_height" },
+    { "gettxoutsetinfo", 2, "use_index" },
+    { "getaddresshistory", 1, "height_begin" },
+    { "getspentinfo", 1, "n" },
     { "lockunspent", 0, "unlock" },
     { "lockunspent", 1, "transactions" },
     { "importprivkey", 2, "rescan" },
@@ -145,6 +149,10 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "getmempoolancestors", 1, "verbose" },
     { "getmempooldescendants", 1, "verbose" },
     { "bumpfee", 1, "options" },
+    { "getlockstats", 0, "count" },
+    { "getlockstats", 1, "reset" },
+    { "getvalidationstats", 0, "reset" },
+    { "profile", 1, "frequency" },
     { "logging", 0, "include" },
     { "logging", 1, "exclude" },
     { "disconnectnode", 1, "nodeid" },
@@ -170,6 +178,9 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "createproposal", 1, "superblock" },
     { "createproposal", 2, "amount" },
     { "listproposals", 0, "sinceblock" },
+    { "listproposals", 1, "untilblock" },
+    { "listproposals", 4, "limit" },
+    { "dxMakeOrders", 0 },
     { "dxGetOrderHistory", 2 },
     { "dxGetOrderHistory", 3 },
     { "dxGetOrderHistory", 4 },
@@ -199,7 +210,11 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "xrGetTxBloomFilter", 3 },
     { "xrGetBlockAtTime", 1 },
     { "xrGetBlockAtTime", 2 },
+    { "xrAsync", 1 },
     { "xrConnect", 1 },
+    { "xrTest", 0 },
+    { "xrTest", 1 },
+    { "xrTest", 2 },
 };
 // clang-format on
 
@@ -90,12 +90,19 @@ static UniValue createproposal(const JSONRPCRequest& request)
 
 static UniValue listproposals(const JSONRPCRequest& request)
 {
-    if (request.fHelp || request.params.size() > 1)
+    if (request.fHelp || request.params.size() > 6)
         throw std::runtime_error(
             RPCHelpMan{"listproposals",
-                "\nLists proposals since the specified block. By default lists the current and upcoming proposals.\n",
+                "\nLists proposals since the specified block. By default lists the current and upcoming proposals.\n"
+                "Proposals are listed in superblock and hash order. Pages of \"limit\" proposals are listed by\n"
+                "passing the hash of the last proposal of the previous page as \"after\".\n",
                 {
                     {"sinceblock", RPCArg::Type::NUM, RPCArg::Optional::OMITTED, "default=0 which pull most recent proposals. Otherwise specify the block number."},
+                    {"untilblock", RPCArg::Type::NUM, RPCArg::Optional::OMITTED, "default=0 which lists all upcoming proposals. Otherwise the last superblock to list."},
+                    {"status", RPCArg::Type::STR, /* default */ "all", "List \"all\" proposals, only \"passing\" or only \"failing\" proposals."},
+                    {"nameprefix", RPCArg::Type::STR, /* default */ "", "Only list proposals with names starting with the prefix."},
+                    {"limit", RPCArg::Type::NUM, /* default */ "0", "Maximum number of proposals to list, 0 for no limit."},
+                    {"after", RPCArg::Type::STR_HEX, /* default */ "", "Hash of the proposal to list the proposals after."},
                 },
                 RPCResult{
                 "{\n"
@@ -114,6 +121,7 @@ static UniValue listproposals(const JSONRPCRequest& request)
                 RPCExamples{
                     HelpExampleCli("listproposals", "")
                   + HelpExampleCli("listproposals", "1036800")
+                  + HelpExampleCli("listproposals", "1036800 0 \"passing\" \"\" 50")
                   + HelpExampleRpc("listproposals", "")
                   + HelpExampleRpc("listproposals", "1036800")
                 },
@@ -129,20 +137,37 @@ static UniValue listproposals(const JSONRPCRequest& request)
             throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("'sinceblock' is bad, cannot be greater than %d", chainActive.Height()));
     }
 
-    std::vector<gov::Proposal> proposals;
-    std::vector<gov::Vote> votes;
-    auto ps = gov::Governance::instance().getProposals();
-    for (const auto & proposal : ps) {
-        if (proposal.getSuperblock() < sinceBlock) // skip proposals prior to the since block
-            continue;
-        proposals.push_back(proposal);
-        const auto & v = gov::Governance::instance().getVotes(proposal.getHash());
-        votes.insert(votes.end(), v.begin(), v.end());
+    gov::ProposalQuery query;
+    query.fromSuperblock = sinceBlock;
+    if (!request.params[1].isNull() && request.params[1].get_int() > 0)
+        query.toSuperblock = request.params[1].get_int();
+    if (!request.params[2].isNull()) {
+        const auto & status = request.params[2].get_str();
+        if (status == "passing")
+            query.status = gov::PROPOSAL_PASSING;
+        else if (status == "failing")
+            query.status = gov::PROPOSAL_FAILING;
+        else if (status != "all")
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "'status' is bad, expecting all, passing or failing");
     }
+    if (!request.params[3].isNull())
+        query.namePrefix = request.params[3].get_str();
+    if (!request.params[4].isNull()) {
+        if (request.params[4].get_int() < 0)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "'limit' is bad, cannot be negative");
+        query.limit = static_cast<size_t>(request.params[4].get_int());
+    }
+    if (!request.params[5].isNull() && !request.params[5].get_str().empty())
+        query.after = ParseHashV(request.params[5], "after");
+
+    std::vector<gov::ProposalListing> listings;
+    if (!gov::Governance::instance().listProposals(query, Params().GetConsensus(), listings))
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "'after' is bad, proposal not found");
 
     UniValue ret(UniValue::VARR);
-    for (const auto & proposal : proposals) {
-        const auto tally = gov::Governance::getTally(proposal.getHash(), votes, Params().GetConsensus());
+    for (const auto & listing : listings) {
+        const auto & proposal = listing.proposal;
+        const auto & tally = listing.tally;
         UniValue prop(UniValue::VOBJ);
         prop.pushKV("hash", proposal.getHash().ToString());
         prop.pushKV("name", proposal.getName());
@@ -257,7 +282,7 @@ static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
   //  --------------------- ------------------------  -----------------------  ----------
     { "governance",         "createproposal",         &createproposal,         {"name", "superblock", "amount", "address", "url", "description"} },
-    { "governance",         "listproposals",          &listproposals,          {"sinceblock"} },
+    { "governance",         "listproposals",          &listproposals,          {"sinceblock", "untilblock", "status", "nameprefix", "limit", "after"} },
     { "governance",         "vote",                   &vote,                   {"proposal", "vote"} },
     { "governance",         "proposalfee",            &proposalfee,            {} },
 };
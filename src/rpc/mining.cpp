@@ -10,6 +10,7 @@
 #include <consensus/params.h>
 #include <consensus/validation.h>
 #include <core_io.h>
+#include <kernel.h>
 #include <key_io.h>
 #include <miner.h>
 #include <net.h>
@@ -225,6 +226,55 @@ static UniValue getmininginfo(const JSONRPCRequest& request)
     return obj;
 }
 
+static UniValue getstakingstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0) {
+        throw std::runtime_error(
+            RPCHelpMan{"getstakingstats",
+                "\nReturns the performance counters of the staker's last stake search.",
+                {},
+                RPCResult{
+                    "{\n"
+                    "  \"lastsearch\": nnn,          (numeric) The time of the last stake search (seconds since epoch)\n"
+                    "  \"height\": nnn,              (numeric) The chain height of the last stake search\n"
+                    "  \"coins\": nnn,               (numeric) The number of coins in the staking wallets\n"
+                    "  \"coinssearched\": nnn,       (numeric) The number of coins considered in the last stake search\n"
+                    "  \"searchwindow\": nnn,        (numeric) The number of stake times (seconds) searched per coin\n"
+                    "  \"hashes\": nnn,              (numeric) The number of kernel hashes computed in the last stake search\n"
+                    "  \"hashespersec\": xxx.xx,     (numeric) The kernel hashes per second of the last stake search\n"
+                    "  \"searchtimems\": xxx.xx,     (numeric) The duration of the last stake search in milliseconds\n"
+                    "  \"lockwaitms\": xxx.xx,       (numeric) Milliseconds the last stake search waited on the chain and wallet locks\n"
+                    "  \"threads\": nnn,             (numeric) The number of threads used by the last stake search\n"
+                    "  \"stakes\": nnn,              (numeric) The number of blocks staked since startup\n"
+                    "  \"laststake\": nnn,           (numeric) The time of the last staked block (seconds since epoch)\n"
+                    "  \"lasthitlatencyms\": nnn,    (numeric) Milliseconds from seeing the tip to submitting the last staked block\n"
+                    "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getstakingstats", "")
+            + HelpExampleRpc("getstakingstats", "")
+                },
+            }.ToString());
+    }
+
+    const auto stats = GetStakingStats();
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("lastsearch",       stats.lastSearchTime);
+    obj.pushKV("height",           stats.height);
+    obj.pushKV("coins",            stats.coins);
+    obj.pushKV("coinssearched",    stats.coinsSearched);
+    obj.pushKV("searchwindow",     stats.searchWindow);
+    obj.pushKV("hashes",           stats.hashes);
+    obj.pushKV("hashespersec",     stats.HashesPerSecond());
+    obj.pushKV("searchtimems",     0.001 * stats.searchMicros);
+    obj.pushKV("lockwaitms",       0.001 * stats.lockWaitMicros);
+    obj.pushKV("threads",          stats.threads);
+    obj.pushKV("stakes",           stats.stakes);
+    obj.pushKV("laststake",        stats.lastStakeTime);
+    obj.pushKV("lasthitlatencyms", stats.lastHitLatencyMillis);
+    return obj;
+}
+
 
 // NOTE: Unlike wallet RPC (which use BTC values), mining RPCs follow GBT (BIP 22) in using satoshi amounts
 static UniValue prioritisetransaction(const JSONRPCRequest& request)
@@ -978,6 +1028,7 @@ static const CRPCCommand commands[] =
   //  --------------------- ------------------------  -----------------------  ----------
     { "mining",             "getnetworkhashps",       &getnetworkhashps,       {"nblocks","height"} },
     { "mining",             "getmininginfo",          &getmininginfo,          {} },
+    { "mining",             "getstakingstats",        &getstakingstats,        {} },
     { "mining",             "prioritisetransaction",  &prioritisetransaction,  {"txid","dummy","fee_delta"} },
     { "mining",             "getblocktemplate",       &getblocktemplate,       {"template_request"} },
     { "mining",             "submitblock",            &submitblock,            {"hexdata","dummy"} },
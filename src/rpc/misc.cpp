@@ -7,12 +7,15 @@
 #include <clientversion.h>
 #include <core_io.h>
 #include <crypto/ripemd160.h>
+#include <dbwrapper.h>
+#include <governance/governance.h>
 #include <key_io.h>
 #include <validation.h>
 #include <httpserver.h>
 #include <net.h>
 #include <netbase.h>
 #include <outputtype.h>
+#include <profiler.h>
 #include <rpc/blockchain.h>
 #include <rpc/server.h>
 #include <rpc/util.h>
@@ -20,6 +23,7 @@
 #include <timedata.h>
 #include <util/system.h>
 #include <util/strencodings.h>
+#include <validationinterface.h>
 #include <warnings.h>
 
 #include <stdint.h>
@@ -244,12 +248,13 @@ UniValue deriveaddresses(const JSONRPCRequest& request)
 
     UniValue addresses(UniValue::VARR);
 
-    for (int i = range_begin; i <= range_end; ++i) {
-        std::vector<CScript> scripts;
-        if (!desc->Expand(i, provider, scripts, provider)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, strprintf("Cannot derive script without private keys"));
-        }
+    std::vector<std::vector<CScript>> range_scripts;
+    std::vector<FlatSigningProvider> range_out;
+    if (!ExpandRange(*desc, range_begin, range_end, provider, range_scripts, range_out)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, strprintf("Cannot derive script without private keys"));
+    }
 
+    for (const auto& scripts : range_scripts) {
         for (const CScript &script : scripts) {
             CTxDestination dest;
             if (!ExtractDestination(script, dest)) {
@@ -413,6 +418,22 @@ static UniValue RPCLockedMemoryInfo()
     return obj;
 }
 
+static UniValue RPCGovernanceMemoryInfo()
+{
+    const auto usage = gov::Governance::instance().getMemoryUsage();
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("proposals", uint64_t(usage.proposals));
+    obj.pushKV("votes", uint64_t(usage.votes));
+    obj.pushKV("vote_keys", uint64_t(usage.voteKeys));
+    obj.pushKV("proposals_usage", uint64_t(usage.proposalsUsage));
+    obj.pushKV("votes_usage", uint64_t(usage.votesUsage));
+    obj.pushKV("index_usage", uint64_t(usage.indexUsage));
+    obj.pushKV("cache_usage", uint64_t(usage.cacheUsage));
+    obj.pushKV("vote_keys_usage", uint64_t(usage.voteKeysUsage));
+    obj.pushKV("total", uint64_t(usage.proposalsUsage + usage.votesUsage + usage.indexUsage + usage.cacheUsage + usage.voteKeysUsage));
+    return obj;
+}
+
 #ifdef HAVE_MALLOC_INFO
 static std::string RPCMallocInfo()
 {
@@ -456,6 +477,17 @@ static UniValue getmemoryinfo(const JSONRPCRequest& request)
             "    \"locked\": xxxxxx,       (numeric) Amount of bytes that succeeded locking. If this number is smaller than total, locking pages failed at some point and key data could be swapped to disk.\n"
             "    \"chunks_used\": xxxxx,   (numeric) Number allocated chunks\n"
             "    \"chunks_free\": xxxxx,   (numeric) Number unused chunks\n"
+            "  },\n"
+            "  \"governance\": {           (json object) Estimated memory usage of the governance data\n"
+            "    \"proposals\": xxxxx,     (numeric) Number of proposals\n"
+            "    \"votes\": xxxxx,         (numeric) Number of votes\n"
+            "    \"vote_keys\": xxxxx,     (numeric) Number of cached vote keys\n"
+            "    \"proposals_usage\": xxxxx, (numeric) Bytes used by the proposals\n"
+            "    \"votes_usage\": xxxxx,   (numeric) Bytes used by the compact vote store\n"
+            "    \"index_usage\": xxxxx,   (numeric) Bytes used by the proposal and vote indexes\n"
+            "    \"cache_usage\": xxxxx,   (numeric) Bytes used by the cached tallies and superblock results\n"
+            "    \"vote_keys_usage\": xxxxx, (numeric) Bytes used by the vote key cache\n"
+            "    \"total\": xxxxx,         (numeric) Total number of bytes used\n"
             "  }\n"
             "}\n"
                     },
@@ -473,6 +505,7 @@ static UniValue getmemoryinfo(const JSONRPCRequest& request)
     if (mode == "stats") {
         UniValue obj(UniValue::VOBJ);
         obj.pushKV("locked", RPCLockedMemoryInfo());
+        obj.pushKV("governance", RPCGovernanceMemoryInfo());
         return obj;
     } else if (mode == "mallocinfo") {
 #ifdef HAVE_MALLOC_INFO
@@ -485,6 +518,286 @@ static UniValue getmemoryinfo(const JSONRPCRequest& request)
     }
 }
 
+static UniValue getdbstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 0)
+        throw std::runtime_error(
+            RPCHelpMan{"getdbstats",
+                "Returns the settings, counters and compaction statistics of the open leveldb databases.\n"
+                "Counters are since the database was opened. Settings are changed with -dbtune.\n",
+                {},
+                RPCResult{
+            "[\n"
+            "  {\n"
+            "    \"name\": \"xxxx\",             (string) Database name (chainstate, index, txindex, ...)\n"
+            "    \"block_cache_usage\": xxxxx,   (numeric) Bytes in the block cache\n"
+            "    \"write_buffer_size\": xxxxx,   (numeric) Size of a write buffer in bytes\n"
+            "    \"bloom_bits\": n,              (numeric) Bloom filter bits per key, 0 if disabled\n"
+            "    \"block_size\": xxxxx,          (numeric) Table block size in bytes\n"
+            "    \"compression\": true|false,    (boolean) Whether table blocks are compressed\n"
+            "    \"max_open_files\": n,          (numeric) Maximum number of open table files\n"
+            "    \"memory_usage\": xxxxx,        (numeric) Approximate memory usage in bytes\n"
+            "    \"reads\": n,                   (numeric) Number of reads\n"
+            "    \"cache_hits\": n,              (numeric) Block cache lookups that found the block\n"
+            "    \"cache_misses\": n,            (numeric) Block cache lookups that read the block from disk\n"
+            "    \"cache_hit_ratio\": x.xxx,     (numeric) cache_hits / (cache_hits + cache_misses)\n"
+            "    \"write_batches\": n,           (numeric) Number of write batches\n"
+            "    \"write_bytes\": xxxxx,         (numeric) Estimated bytes written by the batches\n"
+            "    \"write_time\": x.xxx,          (numeric) Seconds spent writing, including write stalls\n"
+            "    \"compaction_time\": x.xxx,     (numeric) Seconds spent compacting\n"
+            "    \"read_amplification\": n,      (numeric) Tables a read may have to check: level 0 files plus deeper non-empty levels\n"
+            "    \"write_amplification\": x.xxx, (numeric) Bytes written by compactions per byte written by the batches\n"
+            "    \"levels\": [                   (array) Levels with files or compactions\n"
+            "      {\n"
+            "        \"level\": n,               (numeric) Level\n"
+            "        \"files\": n,               (numeric) Number of table files\n"
+            "        \"size_mb\": x.x,           (numeric) Size of the level in MiB\n"
+            "        \"compaction_time\": x.x,   (numeric) Seconds spent compacting into the level\n"
+            "        \"read_mb\": x.x,           (numeric) MiB read by compactions into the level\n"
+            "        \"write_mb\": x.x           (numeric) MiB written by compactions into the level\n"
+            "      }, ...\n"
+            "    ]\n"
+            "  }, ...\n"
+            "]\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getdbstats", "")
+            + HelpExampleRpc("getdbstats", "")
+                },
+            }.ToString());
+
+    UniValue result(UniValue::VARR);
+    for (const CDBStats& stats : CDBWrapper::GetAllStats()) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("name", stats.name);
+        obj.pushKV("block_cache_usage", (uint64_t)stats.block_cache_size);
+        obj.pushKV("write_buffer_size", (uint64_t)stats.write_buffer_size);
+        obj.pushKV("bloom_bits", stats.bloom_bits);
+        obj.pushKV("block_size", (uint64_t)stats.block_size);
+        obj.pushKV("compression", stats.compression);
+        obj.pushKV("max_open_files", stats.max_open_files);
+        obj.pushKV("memory_usage", (uint64_t)stats.memory_usage);
+        obj.pushKV("reads", stats.reads);
+        obj.pushKV("cache_hits", stats.cache_hits);
+        obj.pushKV("cache_misses", stats.cache_misses);
+        const uint64_t lookups = stats.cache_hits + stats.cache_misses;
+        obj.pushKV("cache_hit_ratio", lookups ? (double)stats.cache_hits / lookups : 0.0);
+        obj.pushKV("write_batches", stats.write_batches);
+        obj.pushKV("write_bytes", stats.write_bytes);
+        obj.pushKV("write_time", stats.write_time_us / 1e6);
+
+        double compactionTime{0}, compactionWriteMb{0};
+        int readAmplification{0};
+        UniValue levels(UniValue::VARR);
+        for (const CDBStats::Level& level : stats.levels) {
+            compactionTime += level.compaction_sec;
+            compactionWriteMb += level.write_mb;
+            if (level.files > 0)
+                readAmplification += level.level == 0 ? level.files : 1;
+            UniValue l(UniValue::VOBJ);
+            l.pushKV("level", level.level);
+            l.pushKV("files", level.files);
+            l.pushKV("size_mb", level.size_mb);
+            l.pushKV("compaction_time", level.compaction_sec);
+            l.pushKV("read_mb", level.read_mb);
+            l.pushKV("write_mb", level.write_mb);
+            levels.push_back(l);
+        }
+        obj.pushKV("compaction_time", compactionTime);
+        obj.pushKV("read_amplification", readAmplification);
+        obj.pushKV("write_amplification", stats.write_bytes ? compactionWriteMb * 1048576.0 / stats.write_bytes : 0.0);
+        obj.pushKV("levels", levels);
+        result.push_back(obj);
+    }
+    return result;
+}
+
+static UniValue getlockstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 2)
+        throw std::runtime_error(
+            RPCHelpMan{"getlockstats",
+                "Returns the lock profiler stats of the LOCK sites, sorted by the time spent waiting.\n"
+                "Contended acquisitions are always timed, the hold time is sampled for 1 in -lockprofile\n"
+                "acquisitions. Counters are since startup or the last reset.\n",
+                {
+                    {"count", RPCArg::Type::NUM, /* default */ "50", "Number of lock sites to return, 0 for all"},
+                    {"reset", RPCArg::Type::BOOL, /* default */ "false", "Reset the counters after reading them"},
+                },
+                RPCResult{
+            "{\n"
+            "  \"sample\": n,                  (numeric) 1 in n acquisitions are sampled for the hold time, 0 if disabled\n"
+            "  \"locks\": [\n"
+            "    {\n"
+            "      \"lock\": \"xxxx\",           (string) Lock expression\n"
+            "      \"site\": \"file:line\",      (string) Source location of the LOCK\n"
+            "      \"contentions\": n,         (numeric) Acquisitions that had to wait\n"
+            "      \"wait_time\": x.xxx,       (numeric) Seconds spent waiting\n"
+            "      \"max_wait\": x.xxx,        (numeric) Longest wait in seconds\n"
+            "      \"hold_samples\": n,        (numeric) Acquisitions sampled for the hold time\n"
+            "      \"avg_hold\": x.xxx,        (numeric) Average hold time of the samples in seconds\n"
+            "      \"max_hold\": x.xxx,        (numeric) Longest sampled hold time in seconds\n"
+            "      \"est_hold_time\": x.xxx    (numeric) Estimated total hold time in seconds\n"
+            "    }, ...\n"
+            "  ]\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getlockstats", "")
+            + HelpExampleCli("getlockstats", "0 true")
+            + HelpExampleRpc("getlockstats", "10")
+                },
+            }.ToString());
+
+    const int count = request.params[0].isNull() ? 50 : request.params[0].get_int();
+    if (count < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "count must not be negative");
+    const bool reset = !request.params[1].isNull() && request.params[1].get_bool();
+
+    std::vector<LockStats> stats = GetLockStats();
+    if (reset)
+        ResetLockStats();
+    std::sort(stats.begin(), stats.end(), [](const LockStats& a, const LockStats& b) {
+        return a.wait_ns > b.wait_ns || (a.wait_ns == b.wait_ns && a.samples > b.samples);
+    });
+    if (count > 0 && stats.size() > (size_t)count)
+        stats.resize(count);
+
+    const unsigned int sample = g_lock_profile_sample;
+    UniValue locks(UniValue::VARR);
+    for (const LockStats& s : stats) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("lock", s.name);
+        obj.pushKV("site", strprintf("%s:%d", s.file, s.line));
+        obj.pushKV("contentions", s.contentions);
+        obj.pushKV("wait_time", s.wait_ns / 1e9);
+        obj.pushKV("max_wait", s.max_wait_ns / 1e9);
+        obj.pushKV("hold_samples", s.samples);
+        obj.pushKV("avg_hold", s.samples ? s.hold_ns / 1e9 / s.samples : 0.0);
+        obj.pushKV("max_hold", s.max_hold_ns / 1e9);
+        obj.pushKV("est_hold_time", s.hold_ns / 1e9 * sample);
+        locks.push_back(obj);
+    }
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("sample", (int)sample);
+    result.pushKV("locks", locks);
+    return result;
+}
+
+static UniValue getvalidationstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 1)
+        throw std::runtime_error(
+            RPCHelpMan{"getvalidationstats",
+                "Returns the queued validation callbacks and the time spent in them per validation interface\n"
+                "subscriber (wallets, indexes, governance, servicenodes, zmq, ...). Counters are since the\n"
+                "subscriber was registered or the last reset.\n",
+                {
+                    {"reset", RPCArg::Type::BOOL, /* default */ "false", "Reset the counters after reading them"},
+                },
+                RPCResult{
+            "[\n"
+            "  {\n"
+            "    \"name\": \"xxxx\",             (string) Subscriber name\n"
+            "    \"pending\": n,                 (numeric) Callbacks waiting in the queue of the subscriber\n"
+            "    \"callbacks\": {\n"
+            "      \"xxxx\": {                   (object) Callback name, e.g. BlockConnected\n"
+            "        \"calls\": n,               (numeric) Number of calls\n"
+            "        \"avg_wait\": x.xxx,        (numeric) Average time in seconds the calls waited in the queue\n"
+            "        \"max_wait\": x.xxx,        (numeric) Longest wait in seconds\n"
+            "        \"run_time\": x.xxx,        (numeric) Seconds spent in the calls\n"
+            "        \"avg_run\": x.xxx,         (numeric) Average call duration in seconds\n"
+            "        \"max_run\": x.xxx          (numeric) Longest call in seconds\n"
+            "      }, ...\n"
+            "    }\n"
+            "  }, ...\n"
+            "]\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getvalidationstats", "")
+            + HelpExampleCli("getvalidationstats", "true")
+            + HelpExampleRpc("getvalidationstats", "")
+                },
+            }.ToString());
+
+    const bool reset = !request.params[0].isNull() && request.params[0].get_bool();
+
+    UniValue result(UniValue::VARR);
+    for (const ValidationInterfaceStats& subscriber : GetMainSignals().GetSubscriberStats(reset)) {
+        UniValue callbacks(UniValue::VOBJ);
+        for (const auto& callback : subscriber.callbacks) {
+            const ValidationCallbackStats& s = callback.second;
+            UniValue obj(UniValue::VOBJ);
+            obj.pushKV("calls", s.calls);
+            obj.pushKV("avg_wait", s.wait_micros / 1e6 / s.calls);
+            obj.pushKV("max_wait", s.max_wait_micros / 1e6);
+            obj.pushKV("run_time", s.run_micros / 1e6);
+            obj.pushKV("avg_run", s.run_micros / 1e6 / s.calls);
+            obj.pushKV("max_run", s.max_run_micros / 1e6);
+            callbacks.pushKV(callback.first, obj);
+        }
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("name", subscriber.name);
+        obj.pushKV("pending", (uint64_t)subscriber.pending);
+        obj.pushKV("callbacks", callbacks);
+        result.push_back(obj);
+    }
+    return result;
+}
+
+static UniValue profile(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        throw std::runtime_error(
+            RPCHelpMan{"profile",
+                "Starts or stops the sampling profiler. While running, the stacks of the threads using CPU time\n"
+                "are sampled. Stopping writes the samples to profile-<time>.folded in the data directory, in the\n"
+                "collapsed stack format read by flamegraph.pl, with the thread name as the outermost frame.\n"
+                "Stacks are only complete in builds with -fno-omit-frame-pointer. Only supported on Linux.\n",
+                {
+                    {"action", RPCArg::Type::STR, RPCArg::Optional::NO, "\"start\" or \"stop\""},
+                    {"frequency", RPCArg::Type::NUM, /* default */ strprintf("%d", DEFAULT_PROFILE_FREQUENCY), strprintf("Samples per second of CPU time, at most %d (start only)", MAX_PROFILE_FREQUENCY)},
+                },
+                RPCResult{
+            "start: true\n"
+            "stop:\n"
+            "{\n"
+            "  \"file\": \"xxxx\",      (string) Path of the collapsed stack file\n"
+            "  \"samples\": n,        (numeric) Samples written\n"
+            "  \"dropped\": n,        (numeric) Samples lost because the sample buffer was full\n"
+            "  \"duration\": n        (numeric) Seconds the profiler ran\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("profile", "start")
+            + HelpExampleCli("profile", "start 499")
+            + HelpExampleCli("profile", "stop")
+            + HelpExampleRpc("profile", "\"stop\"")
+                },
+            }.ToString());
+
+    const std::string action = request.params[0].get_str();
+    std::string error;
+    if (action == "start") {
+        const int frequency = request.params[1].isNull() ? DEFAULT_PROFILE_FREQUENCY : request.params[1].get_int();
+        if (!StartProfiler(frequency, error))
+            throw JSONRPCError(RPC_MISC_ERROR, error);
+        return true;
+    }
+    if (action != "stop")
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "action must be \"start\" or \"stop\"");
+
+    ProfileResult profile;
+    if (!StopProfiler(GetDataDir() / strprintf("profile-%d.folded", GetTime()), profile, error))
+        throw JSONRPCError(RPC_MISC_ERROR, error);
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("file", profile.path.string());
+    result.pushKV("samples", profile.samples);
+    result.pushKV("dropped", profile.dropped);
+    result.pushKV("duration", profile.duration);
+    return result;
+}
+
 static void EnableOrDisableLogCategories(UniValue cats, bool enable) {
     cats = cats.get_array();
     for (unsigned int i = 0; i < cats.size(); ++i) {
@@ -596,7 +909,11 @@ static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
   //  --------------------- ------------------------  -----------------------  ----------
     { "control",            "getmemoryinfo",          &getmemoryinfo,          {"mode"} },
+    { "control",            "getdbstats",             &getdbstats,             {} },
+    { "control",            "getlockstats",           &getlockstats,           {"count", "reset"} },
+    { "control",            "getvalidationstats",     &getvalidationstats,     {"reset"} },
     { "control",            "logging",                &logging,                {"include", "exclude"}},
+    { "control",            "profile",                &profile,                {"action", "frequency"} },
     { "util",               "validateaddress",        &validateaddress,        {"address"} },
     { "util",               "createmultisig",         &createmultisig,         {"nrequired","keys","address_type"} },
     { "util",               "deriveaddresses",        &deriveaddresses,        {"descriptor", "range"} },
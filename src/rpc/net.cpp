@@ -421,6 +421,79 @@ static UniValue getnettotals(const JSONRPCRequest& request)
     return obj;
 }
 
+static UniValue NetMsgTimingToJSON(const CNetMsgStats::Timing& timing)
+{
+    static const char* bucketNames[CNetMsgStats::TIME_BUCKETS] = {"<10us", "<100us", "<1ms", "<10ms", "<100ms", "<1s", ">=1s"};
+
+    const uint64_t count = timing.count;
+    const uint64_t total = timing.total_micros;
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("count", count);
+    obj.pushKV("total_us", total);
+    obj.pushKV("mean_us", count > 0 ? total / count : 0);
+    obj.pushKV("max_us", (uint64_t)timing.max_micros);
+    UniValue histogram(UniValue::VOBJ);
+    for (size_t i = 0; i < CNetMsgStats::TIME_BUCKETS; i++)
+        histogram.pushKV(bucketNames[i], (uint64_t)timing.buckets[i]);
+    obj.pushKV("histogram", histogram);
+    return obj;
+}
+
+static UniValue getnetmsgstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 0)
+        throw std::runtime_error(
+            RPCHelpMan{"getnetmsgstats",
+                "\nReturns the traffic and processing time of the p2p messages of all peers since startup,\n"
+                "by message type. Message types without traffic are left out.\n",
+                {},
+                RPCResult{
+            "{\n"
+            "  \"msgtype\": {              (json object) The message type (\"*other*\" for unknown types)\n"
+            "    \"msgs_recv\": n,         (numeric) Messages received\n"
+            "    \"bytes_recv\": n,        (numeric) Bytes received, including the message headers\n"
+            "    \"msgs_sent\": n,         (numeric) Messages sent\n"
+            "    \"bytes_sent\": n,        (numeric) Bytes sent, including the message headers\n"
+            "    \"handler\": {            (json object) Processing time on the message handler thread\n"
+            "      \"count\": n,           (numeric) Messages processed\n"
+            "      \"total_us\": n,        (numeric) Total processing time in microseconds\n"
+            "      \"mean_us\": n,         (numeric) Mean processing time in microseconds\n"
+            "      \"max_us\": n,          (numeric) Longest processing time in microseconds\n"
+            "      \"histogram\": {        (json object) Messages by processing time\n"
+            "        \"<10us\": n,\n"
+            "        ...\n"
+            "        \">=1s\": n\n"
+            "      }\n"
+            "    },\n"
+            "    \"worker\": {...}         (json object) Processing time on the message workers (-msgworkers), same fields\n"
+            "  },\n"
+            "  ...\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getnetmsgstats", "")
+            + HelpExampleRpc("getnetmsgstats", "")
+                },
+            }.ToString());
+    if(!g_connman)
+        throw JSONRPCError(RPC_CLIENT_P2P_DISABLED, "Error: Peer-to-peer functionality missing or disabled");
+
+    UniValue obj(UniValue::VOBJ);
+    g_connman->GetMsgStats().ForEach([&obj](const std::string& command, const CNetMsgStats::Entry& entry) {
+        if (entry.msgs_recv == 0 && entry.msgs_sent == 0 && entry.worker.count == 0)
+            return;
+        UniValue msg(UniValue::VOBJ);
+        msg.pushKV("msgs_recv", (uint64_t)entry.msgs_recv);
+        msg.pushKV("bytes_recv", (uint64_t)entry.bytes_recv);
+        msg.pushKV("msgs_sent", (uint64_t)entry.msgs_sent);
+        msg.pushKV("bytes_sent", (uint64_t)entry.bytes_sent);
+        msg.pushKV("handler", NetMsgTimingToJSON(entry.handler));
+        msg.pushKV("worker", NetMsgTimingToJSON(entry.worker));
+        obj.pushKV(command, msg);
+    });
+    return obj;
+}
+
 static UniValue GetNetworksInfo()
 {
     UniValue networks(UniValue::VARR);
@@ -749,6 +822,7 @@ static const CRPCCommand commands[] =
     { "network",            "disconnectnode",         &disconnectnode,         {"address", "nodeid"} },
     { "network",            "getaddednodeinfo",       &getaddednodeinfo,       {"node"} },
     { "network",            "getnettotals",           &getnettotals,           {} },
+    { "network",            "getnetmsgstats",         &getnetmsgstats,         {} },
     { "network",            "getnetworkinfo",         &getnetworkinfo,         {} },
     { "network",            "setban",                 &setban,                 {"subnet", "command", "bantime", "absolute"} },
     { "network",            "listbanned",             &listbanned,             {} },
@@ -48,6 +48,63 @@ std::string JSONRPCReply(const UniValue& result, const UniValue& error, const Un
     return reply.write() + "\n";
 }
 
+//! Size of the pieces passed to a JSONWriteSink
+static const size_t JSON_WRITE_CHUNK_SIZE = 64 * 1024;
+
+static void JSONWriteValue(const UniValue& value, std::string& buffer, const JSONWriteSink& sink)
+{
+    if (value.isObject()) {
+        const std::vector<std::string>& keys = value.getKeys();
+        const std::vector<UniValue>& values = value.getValues();
+        buffer += '{';
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (i > 0)
+                buffer += ',';
+            buffer += UniValue(keys[i]).write();
+            buffer += ':';
+            JSONWriteValue(values[i], buffer, sink);
+        }
+        buffer += '}';
+    } else if (value.isArray()) {
+        const std::vector<UniValue>& values = value.getValues();
+        buffer += '[';
+        for (size_t i = 0; i < values.size(); ++i) {
+            if (i > 0)
+                buffer += ',';
+            JSONWriteValue(values[i], buffer, sink);
+        }
+        buffer += ']';
+    } else {
+        buffer += value.write();
+    }
+    if (buffer.size() >= JSON_WRITE_CHUNK_SIZE) {
+        sink(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+}
+
+void JSONWrite(const UniValue& value, const JSONWriteSink& sink)
+{
+    std::string buffer;
+    buffer.reserve(JSON_WRITE_CHUNK_SIZE * 2);
+    JSONWriteValue(value, buffer, sink);
+    if (!buffer.empty())
+        sink(buffer.data(), buffer.size());
+}
+
+void JSONRPCReplyWrite(const UniValue& result, const UniValue& error, const UniValue& id, const JSONWriteSink& sink)
+{
+    // Same layout as JSONRPCReplyObj
+    static const std::string result_key{"{\"result\":"};
+    sink(result_key.data(), result_key.size());
+    if (!error.isNull())
+        JSONWrite(NullUniValue, sink);
+    else
+        JSONWrite(result, sink);
+    const std::string tail = ",\"error\":" + error.write() + ",\"id\":" + id.write() + "}\n";
+    sink(tail.data(), tail.size());
+}
+
 UniValue JSONRPCError(int code, const std::string& message)
 {
     UniValue error(UniValue::VOBJ);
@@ -8,6 +8,7 @@
 
 #include <fs.h>
 
+#include <functional>
 #include <list>
 #include <map>
 #include <stdint.h>
@@ -97,6 +98,13 @@ UniValue JSONRPCReplyObj(const UniValue& result, const UniValue& error, const Un
 std::string JSONRPCReply(const UniValue& result, const UniValue& error, const UniValue& id);
 UniValue JSONRPCError(int code, const std::string& message);
 
+/** Receives the consecutive pieces of a serialized JSON document */
+typedef std::function<void(const char* data, size_t size)> JSONWriteSink;
+/** Serialize like UniValue::write() in pieces of a few kB, without building the whole document */
+void JSONWrite(const UniValue& value, const JSONWriteSink& sink);
+/** Serialize a reply like JSONRPCReply() in pieces, without copying the result */
+void JSONRPCReplyWrite(const UniValue& result, const UniValue& error, const UniValue& id, const JSONWriteSink& sink);
+
 /** Generate a new RPC authentication cookie and write it to disk */
 bool GenerateAuthCookie(std::string *cookie_out);
 /** Read the RPC authentication cookie from disk */
@@ -7,11 +7,13 @@
 
 #include <fs.h>
 #include <key_io.h>
+#include <metrics.h>
 #include <random.h>
 #include <rpc/util.h>
 #include <shutdown.h>
 #include <sync.h>
 #include <ui_interface.h>
+#include <util/memory.h>
 #include <util/strencodings.h>
 #include <util/system.h>
 #include <wallet/rpcwallet.h>
@@ -20,8 +22,12 @@
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/split.hpp>
 
+#include <array>
+#include <atomic>
 #include <memory> // for unique_ptr
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
 
 static CCriticalSection cs_rpcWarmup;
 static std::atomic<bool> g_rpc_running{false};
@@ -46,6 +52,86 @@ struct RPCServerInfo
 
 static RPCServerInfo g_rpc_server_info;
 
+//! Latency histogram buckets, bucket i counts the calls that took less than 2^i microseconds
+static const size_t RPC_LATENCY_BUCKETS = 36;
+
+/** Call statistics of a method, updated lock-free by every call */
+struct RPCMethodStats
+{
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> errors{0};
+    std::atomic<uint64_t> response_bytes{0};
+    std::atomic<uint64_t> latency_sum{0};
+    std::array<std::atomic<uint64_t>, RPC_LATENCY_BUCKETS> latency{};
+
+    void Record(int64_t duration, bool failed)
+    {
+        size_t bucket = 0;
+        while (bucket < RPC_LATENCY_BUCKETS - 1 && duration >= (int64_t{1} << bucket))
+            ++bucket;
+        latency[bucket].fetch_add(1, std::memory_order_relaxed);
+        latency_sum.fetch_add(std::max<int64_t>(0, duration), std::memory_order_relaxed);
+        calls.fetch_add(1, std::memory_order_relaxed);
+        if (failed)
+            errors.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    //! Upper bound in microseconds of the latency of the given fraction of the calls
+    int64_t Percentile(double fraction) const
+    {
+        std::array<uint64_t, RPC_LATENCY_BUCKETS> counts;
+        uint64_t total{0};
+        for (size_t i = 0; i < RPC_LATENCY_BUCKETS; ++i) {
+            counts[i] = latency[i].load(std::memory_order_relaxed);
+            total += counts[i];
+        }
+        uint64_t seen{0};
+        for (size_t i = 0; i < RPC_LATENCY_BUCKETS; ++i) {
+            seen += counts[i];
+            if (seen > 0 && seen >= fraction * total)
+                return int64_t{1} << i;
+        }
+        return 0;
+    }
+};
+
+//! Statistics of every registered method, only modified while the RPC server is stopped
+static std::unordered_map<std::string, std::unique_ptr<RPCMethodStats>> g_rpc_method_stats;
+
+static RPCMethodStats* GetRPCMethodStats(const std::string& method)
+{
+    auto it = g_rpc_method_stats.find(method);
+    return it == g_rpc_method_stats.end() ? nullptr : it->second.get();
+}
+
+static metrics::CallbackFamily g_metric_rpc_duration{"blocknet_rpc_duration_seconds", "Duration of the RPC calls by method", "histogram",
+    [](std::string& out) {
+        for (const auto& entry : g_rpc_method_stats) {
+            const RPCMethodStats& stats = *entry.second;
+            if (stats.calls.load(std::memory_order_relaxed) == 0)
+                continue;
+            std::array<uint64_t, RPC_LATENCY_BUCKETS> counts;
+            for (size_t i = 0; i < RPC_LATENCY_BUCKETS; ++i)
+                counts[i] = stats.latency[i].load(std::memory_order_relaxed);
+            metrics::WriteHistogramSamples(out, "blocknet_rpc_duration_seconds", strprintf("method=\"%s\"", entry.first),
+                                           counts.data(), counts.size(), stats.latency_sum.load(std::memory_order_relaxed));
+        }
+    }};
+static metrics::CallbackFamily g_metric_rpc_errors{"blocknet_rpc_errors_total", "Failed RPC calls by method", "counter",
+    [](std::string& out) {
+        for (const auto& entry : g_rpc_method_stats) {
+            const uint64_t errors = entry.second->errors.load(std::memory_order_relaxed);
+            if (errors > 0)
+                out += strprintf("blocknet_rpc_errors_total{method=\"%s\"} %u\n", entry.first, errors);
+        }
+    }};
+
+void RPCRecordResponseSize(const std::string& method, size_t bytes)
+{
+    if (RPCMethodStats* stats = GetRPCMethodStats(method))
+        stats->response_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
 struct RPCCommandExecution
 {
     std::list<RPCCommandExecutionInfo>::iterator it;
@@ -305,7 +391,18 @@ static UniValue getrpcinfo(const JSONRPCRequest& request)
             "    \"method\"       (string)  The name of the RPC command \n"
             "    \"duration\"     (numeric)  The running time in microseconds\n"
             "   },...\n"
-            "  ]\n"
+            "  ],\n"
+            " \"methods\" (object) Statistics of the commands called since startup\n"
+            "  {\n"
+            "   \"method\" : {            (object) Statistics of the RPC command\n"
+            "    \"calls\"          (numeric)  Number of calls\n"
+            "    \"errors\"         (numeric)  Number of calls that failed\n"
+            "    \"response_bytes\" (numeric)  Total size of the JSON-RPC replies of single (not batched) calls\n"
+            "    \"p50\"            (numeric)  Latency of 50% of the calls in microseconds, rounded up to a power of 2\n"
+            "    \"p90\"            (numeric)  Latency of 90% of the calls in microseconds, rounded up to a power of 2\n"
+            "    \"p99\"            (numeric)  Latency of 99% of the calls in microseconds, rounded up to a power of 2\n"
+            "   },...\n"
+            "  }\n"
             "}\n"
                 },
                 RPCExamples{
@@ -315,17 +412,38 @@ static UniValue getrpcinfo(const JSONRPCRequest& request)
         );
     }
 
-    LOCK(g_rpc_server_info.mutex);
     UniValue active_commands(UniValue::VARR);
-    for (const RPCCommandExecutionInfo& info : g_rpc_server_info.active_commands) {
-        UniValue entry(UniValue::VOBJ);
-        entry.pushKV("method", info.method);
-        entry.pushKV("duration", GetTimeMicros() - info.start);
-        active_commands.push_back(entry);
+    {
+        LOCK(g_rpc_server_info.mutex);
+        for (const RPCCommandExecutionInfo& info : g_rpc_server_info.active_commands) {
+            UniValue entry(UniValue::VOBJ);
+            entry.pushKV("method", info.method);
+            entry.pushKV("duration", GetTimeMicros() - info.start);
+            active_commands.push_back(entry);
+        }
+    }
+
+    std::map<std::string, const RPCMethodStats*> called; // sorted by method name
+    for (const auto& entry : g_rpc_method_stats) {
+        if (entry.second->calls.load(std::memory_order_relaxed) > 0)
+            called.emplace(entry.first, entry.second.get());
+    }
+    UniValue methods(UniValue::VOBJ);
+    for (const auto& entry : called) {
+        const RPCMethodStats& stats = *entry.second;
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("calls", stats.calls.load(std::memory_order_relaxed));
+        obj.pushKV("errors", stats.errors.load(std::memory_order_relaxed));
+        obj.pushKV("response_bytes", stats.response_bytes.load(std::memory_order_relaxed));
+        obj.pushKV("p50", stats.Percentile(0.50));
+        obj.pushKV("p90", stats.Percentile(0.90));
+        obj.pushKV("p99", stats.Percentile(0.99));
+        methods.pushKV(entry.first, obj);
     }
 
     UniValue result(UniValue::VOBJ);
     result.pushKV("active_commands", active_commands);
+    result.pushKV("methods", methods);
 
     return result;
 }
@@ -351,6 +469,7 @@ CRPCTable::CRPCTable()
 
         pcmd = &vRPCCommands[vcidx];
         mapCommands[pcmd->name] = pcmd;
+        g_rpc_method_stats.emplace(pcmd->name, MakeUnique<RPCMethodStats>());
     }
 }
 
@@ -373,6 +492,7 @@ bool CRPCTable::appendCommand(const std::string& name, const CRPCCommand* pcmd)
         return false;
 
     mapCommands[name] = pcmd;
+    g_rpc_method_stats.emplace(name, MakeUnique<RPCMethodStats>());
     return true;
 }
 
@@ -487,13 +607,61 @@ static UniValue JSONRPCExecOne(JSONRPCRequest jreq, const UniValue& req)
     return rpc_result;
 }
 
-std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq)
+/** Calls that only read chain or mempool state, these may run concurrently within a batch */
+static const std::unordered_set<std::string> g_read_only_rpcs{
+    "getbestblockhash", "getblock", "getblockcount", "getblockfilter", "getblockhash",
+    "getblockheader", "getblockstats", "getchaintips", "getdifficulty", "getmempoolancestors",
+    "getmempooldescendants", "getmempoolentry", "getrawmempool", "getrawtransaction", "gettxout",
+    "gettxoutproof", "verifytxoutproof", "decoderawtransaction", "decodescript", "validateaddress",
+};
+
+static bool IsReadOnlyRequest(const UniValue& req)
 {
+    if (!req.isObject())
+        return false;
+    const UniValue& method = find_value(req, "method");
+    return method.isStr() && g_read_only_rpcs.count(method.get_str());
+}
+
+UniValue JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq)
+{
+    const size_t count = vReq.size();
+    std::vector<UniValue> results(count);
+    const int batch_threads = static_cast<int>(gArgs.GetArg("-rpcbatchthreads", DEFAULT_RPC_BATCH_THREADS));
+
+    // Consecutive read-only calls are spread over the batch threads, other calls run
+    // in order on this thread so that their effects are seen by the calls after them.
+    size_t reqIdx = 0;
+    while (reqIdx < count) {
+        size_t end = reqIdx;
+        while (batch_threads > 1 && end < count && IsReadOnlyRequest(vReq[end]))
+            ++end;
+        if (end - reqIdx < 2) {
+            results[reqIdx] = JSONRPCExecOne(jreq, vReq[reqIdx]);
+            ++reqIdx;
+            continue;
+        }
+
+        std::atomic<size_t> next{reqIdx};
+        auto worker = [&]() {
+            for (size_t i = next++; i < end; i = next++)
+                results[i] = JSONRPCExecOne(jreq, vReq[i]);
+        };
+        const size_t num_threads = std::min<size_t>(batch_threads, end - reqIdx);
+        std::vector<std::thread> threads;
+        for (size_t t = 1; t < num_threads; ++t)
+            threads.emplace_back(worker);
+        worker();
+        for (auto& thread : threads)
+            thread.join();
+        reqIdx = end;
+    }
+
     UniValue ret(UniValue::VARR);
-    for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(jreq, vReq[reqIdx]));
+    for (auto& result : results)
+        ret.push_back(std::move(result));
 
-    return ret.write() + "\n";
+    return ret;
 }
 
 /**
@@ -564,20 +732,30 @@ UniValue CRPCTable::execute(const JSONRPCRequest &request) const
     if (util::unlockedForStakingOnly && util::unlockedForStakingOnlyBlockRPC.count(request.strMethod))
         throw JSONRPCError(RPC_METHOD_NOT_FOUND, "Wallet is locked for staking only");
 
+    RPCMethodStats* stats = GetRPCMethodStats(request.strMethod);
+    const int64_t start = GetTimeMicros();
     try
     {
         RPCCommandExecution execution(request.strMethod);
         // Execute, convert arguments to array if necessary
-        if (request.params.isObject()) {
-            return pcmd->actor(transformNamedArguments(request, pcmd->argNames));
-        } else {
-            return pcmd->actor(request);
-        }
+        UniValue result = request.params.isObject() ? pcmd->actor(transformNamedArguments(request, pcmd->argNames))
+                                                    : pcmd->actor(request);
+        if (stats)
+            stats->Record(GetTimeMicros() - start, false);
+        return result;
     }
     catch (const std::exception& e)
     {
+        if (stats)
+            stats->Record(GetTimeMicros() - start, true);
         throw JSONRPCError(RPC_MISC_ERROR, e.what());
     }
+    catch (...)
+    {
+        if (stats)
+            stats->Record(GetTimeMicros() - start, true);
+        throw;
+    }
 }
 
 std::vector<std::string> CRPCTable::listCommands() const
@@ -18,6 +18,8 @@
 #include <univalue.h>
 
 static const unsigned int DEFAULT_RPC_SERIALIZE_VERSION = 1;
+//! Threads used to execute the read-only calls of a batch request (0 = sequential)
+static const int DEFAULT_RPC_BATCH_THREADS = 0;
 
 class CRPCCommand;
 
@@ -183,6 +185,9 @@ public:
 
 bool IsDeprecatedRPCEnabled(const std::string& method);
 
+/** Adds the size of a JSON-RPC reply to the response_bytes of the method in getrpcinfo */
+void RPCRecordResponseSize(const std::string& method, size_t bytes);
+
 extern CRPCTable tableRPC;
 
 /**
@@ -201,7 +206,8 @@ extern std::string HelpExampleRpc(const std::string& methodname, const std::stri
 void StartRPC();
 void InterruptRPC();
 void StopRPC();
-std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq);
+/** Execute the calls of a batch request, returns the array of replies */
+UniValue JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq);
 
 // Retrieves any serialization flags requested in command line argument
 int RPCSerializationFlags();
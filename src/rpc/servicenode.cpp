@@ -682,27 +682,37 @@ static UniValue servicenodelist(const JSONRPCRequest& request)
                 },
             }.ToString());
 
-    UniValue ret(UniValue::VARR);
-
-    // List all the service node entries and their statuses
-    const auto & snodes = sn::ServiceNodeMgr::instance().list();
-    for (const auto & snode : snodes) {
-        UniValue obj(UniValue::VOBJ);
-        obj.pushKV("snodekey", HexStr(snode.getSnodePubKey()));
-        obj.pushKV("tier", sn::ServiceNodeMgr::tierString(snode.getTier()));
-        obj.pushKV("address", EncodeDestination(snode.getPaymentAddress()));
-        obj.pushKV("timelastseen", snode.getPingTime());
-        obj.pushKV("timelastseenstr", xbridge::iso8601(boost::posix_time::from_time_t(snode.getPingTime())));
-        obj.pushKV("status", !snode.isNull() && snode.running() ? "running" : "offline");
-        obj.pushKV("score", xrouter::App::instance().isReady() ? xrouter::App::instance().getScore(snode.getHost()) : 0);
-        UniValue services(UniValue::VARR);
-        for (const auto & service : snode.serviceList())
-            services.push_back(service);
-        obj.pushKV("services", services);
-        ret.push_back(obj);
-    }
+    // Scores change with every xrouter request, they are allowed to be this stale
+    static const int64_t scoreMaxAge = 5;
+    static sn::ServiceNodeListCache<UniValue> cache;
+    return cache.get([](int64_t & expires) {
+        UniValue ret(UniValue::VARR);
+        const int64_t now = GetAdjustedTime();
+        expires = now + scoreMaxAge;
+
+        // List all the service node entries and their statuses
+        const auto snodes = sn::ServiceNodeMgr::instance().snapshot();
+        for (const auto & item : *snodes) {
+            const auto & snode = *item.second;
+            if (snode.running())
+                expires = std::min(expires, snode.runningUntil());
+            UniValue obj(UniValue::VOBJ);
+            obj.pushKV("snodekey", HexStr(snode.getSnodePubKey()));
+            obj.pushKV("tier", sn::ServiceNodeMgr::tierString(snode.getTier()));
+            obj.pushKV("address", EncodeDestination(snode.getPaymentAddress()));
+            obj.pushKV("timelastseen", snode.getPingTime());
+            obj.pushKV("timelastseenstr", xbridge::iso8601(boost::posix_time::from_time_t(snode.getPingTime())));
+            obj.pushKV("status", !snode.isNull() && snode.running() ? "running" : "offline");
+            obj.pushKV("score", xrouter::App::instance().isReady() ? xrouter::App::instance().getScore(snode.getHost()) : 0);
+            UniValue services(UniValue::VARR);
+            for (const auto & service : snode.serviceList())
+                services.push_back(service);
+            obj.pushKV("services", services);
+            ret.push_back(obj);
+        }
 
-    return ret;
+        return ret;
+    });
 }
 
 static UniValue servicenodesendping(const JSONRPCRequest& request)
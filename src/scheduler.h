@@ -16,6 +16,11 @@
 
 #include <sync.h>
 
+/** Default number of threads servicing the task scheduler */
+static const int DEFAULT_SCHEDULER_THREADS = 4;
+/** Maximum number of threads servicing the task scheduler */
+static const int MAX_SCHEDULER_THREADS = 16;
+
 //
 // Simple class for background tasks that should be run
 // periodically or once "after a while"
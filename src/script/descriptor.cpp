@@ -10,12 +10,15 @@
 #include <script/standard.h>
 
 #include <span.h>
+#include <sync.h>
 #include <util/bip32.h>
 #include <util/system.h>
 #include <util/strencodings.h>
 
+#include <atomic>
 #include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace {
@@ -237,6 +240,11 @@ class BIP32PubkeyProvider final : public PubkeyProvider
     KeyPath m_path;
     DeriveType m_derive;
 
+    //! Extended public key at m_path, the parent of the ranged keys, derived once
+    mutable Mutex m_parent_mutex;
+    mutable bool m_have_parent GUARDED_BY(m_parent_mutex){false};
+    mutable CExtPubKey m_parent GUARDED_BY(m_parent_mutex);
+
     bool GetExtKey(const SigningProvider& arg, CExtKey& ret) const
     {
         CKey key;
@@ -249,15 +257,44 @@ class BIP32PubkeyProvider final : public PubkeyProvider
         return true;
     }
 
-    bool IsHardened() const
+    bool IsHardenedPath() const
     {
-        if (m_derive == DeriveType::HARDENED) return true;
         for (auto entry : m_path) {
             if (entry >> 31) return true;
         }
         return false;
     }
 
+    /** Extended public key at m_path. Hardened paths need the private key, also once cached. */
+    bool GetParentExtPubKey(const SigningProvider& arg, CExtPubKey& ret) const
+    {
+        const bool hardened = IsHardenedPath();
+        CExtKey extkey;
+        if (hardened && !GetExtKey(arg, extkey)) return false;
+        {
+            LOCK(m_parent_mutex);
+            if (m_have_parent) {
+                ret = m_parent;
+                return true;
+            }
+        }
+        if (hardened) {
+            for (auto entry : m_path) {
+                extkey.Derive(extkey, entry);
+            }
+            ret = extkey.Neuter();
+        } else {
+            ret = m_extkey;
+            for (auto entry : m_path) {
+                ret.Derive(ret, entry);
+            }
+        }
+        LOCK(m_parent_mutex);
+        m_parent = ret;
+        m_have_parent = true;
+        return true;
+    }
+
 public:
     BIP32PubkeyProvider(const CExtPubKey& extkey, KeyPath path, DeriveType derive) : m_extkey(extkey), m_path(std::move(path)), m_derive(derive) {}
     bool IsRange() const override { return m_derive != DeriveType::NO; }
@@ -265,23 +302,19 @@ public:
     bool GetPubKey(int pos, const SigningProvider& arg, CPubKey* key, KeyOriginInfo& info) const override
     {
         if (key) {
-            if (IsHardened()) {
+            if (m_derive == DeriveType::HARDENED) {
                 CExtKey extkey;
                 if (!GetExtKey(arg, extkey)) return false;
                 for (auto entry : m_path) {
                     extkey.Derive(extkey, entry);
                 }
-                if (m_derive == DeriveType::UNHARDENED) extkey.Derive(extkey, pos);
-                if (m_derive == DeriveType::HARDENED) extkey.Derive(extkey, pos | 0x80000000UL);
+                extkey.Derive(extkey, pos | 0x80000000UL);
                 *key = extkey.Neuter().pubkey;
             } else {
-                // TODO: optimize by caching
-                CExtPubKey extkey = m_extkey;
-                for (auto entry : m_path) {
-                    extkey.Derive(extkey, entry);
-                }
+                // Unhardened children are derived from the cached parent
+                CExtPubKey extkey;
+                if (!GetParentExtPubKey(arg, extkey)) return false;
                 if (m_derive == DeriveType::UNHARDENED) extkey.Derive(extkey, pos);
-                assert(m_derive != DeriveType::HARDENED);
                 *key = extkey.pubkey;
             }
         }
@@ -903,3 +936,28 @@ std::unique_ptr<Descriptor> InferDescriptor(const CScript& script, const Signing
 {
     return InferScript(script, ParseScriptContext::TOP, provider);
 }
+
+bool ExpandRange(const Descriptor& desc, int begin, int end, const SigningProvider& provider,
+                 std::vector<std::vector<CScript>>& output_scripts, std::vector<FlatSigningProvider>& out)
+{
+    const size_t count = end >= begin ? end - begin + 1 : 0;
+    output_scripts.assign(count, std::vector<CScript>());
+    out.assign(count, FlatSigningProvider());
+    std::atomic<size_t> next{0};
+    std::atomic<bool> failed{false};
+    auto worker = [&]() {
+        for (size_t i = next++; i < count && !failed; i = next++) {
+            if (!desc.Expand(begin + (int)i, provider, output_scripts[i], out[i])) failed = true;
+        }
+    };
+    const size_t num_threads = std::min<size_t>(std::max(GetNumCores(), 1), count / MIN_POSITIONS_PER_EXPAND_THREAD);
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < num_threads; ++t) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return !failed;
+}
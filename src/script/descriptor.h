@@ -62,6 +62,19 @@ struct Descriptor {
     virtual bool ExpandFromCache(int pos, const std::vector<unsigned char>& cache, std::vector<CScript>& output_scripts, FlatSigningProvider& out) const = 0;
 };
 
+/** Positions expanded per thread at least by ExpandRange */
+static const size_t MIN_POSITIONS_PER_EXPAND_THREAD = 64;
+
+/** Expand a descriptor at the positions begin to end (inclusive) on several threads.
+ *
+ * output_scripts and out receive the expansion of each position, in order. provider is only read
+ * while the positions are expanded.
+ *
+ * Returns false if any position could not be expanded.
+ */
+bool ExpandRange(const Descriptor& desc, int begin, int end, const SigningProvider& provider,
+                 std::vector<std::vector<CScript>>& output_scripts, std::vector<FlatSigningProvider>& out);
+
 /** Parse a descriptor string. Included private keys are put in out.
  *
  * If the descriptor has a checksum, it must be valid. If require_checksum
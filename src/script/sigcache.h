@@ -53,4 +53,9 @@ public:
 
 void InitSignatureCache();
 
+/** Copy the salt and the entries of the signature cache, see -persistsigcache */
+void GetSignatureCacheEntries(uint256& nonce, std::vector<uint256>& entries);
+/** Replace the salt and insert the entries of a previous signature cache, only valid before signatures are checked */
+void LoadSignatureCacheEntries(const uint256& nonce, const std::vector<uint256>& entries);
+
 #endif // BITCOIN_SCRIPT_SIGCACHE_H
@@ -3,3 +3,72 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "servicenode.h"
+
+#include <limitedmap.h>
+
+namespace sn {
+
+struct CachedSnodeKey {
+    CPubKey pubkey;
+    uint64_t sequence{0}; // oldest keys are evicted first
+    bool operator<(const CachedSnodeKey & other) const { return sequence < other.sequence; }
+};
+
+Mutex muSnodeKeys;
+limitedmap<uint256, CachedSnodeKey> mapSnodeKeys GUARDED_BY(muSnodeKeys){MAX_SNODE_KEY_CACHE};
+uint64_t nSnodeKeySequence GUARDED_BY(muSnodeKeys){0};
+
+struct CachedSnodeConfig {
+    ParsedSnodeConfig config;
+    uint64_t sequence{0}; // oldest configs are evicted first
+    bool operator<(const CachedSnodeConfig & other) const { return sequence < other.sequence; }
+};
+
+Mutex muSnodeConfigs;
+limitedmap<uint256, CachedSnodeConfig> mapSnodeConfigs GUARDED_BY(muSnodeConfigs){MAX_SNODE_CONFIG_CACHE};
+uint64_t nSnodeConfigSequence GUARDED_BY(muSnodeConfigs){0};
+
+bool RecoverSnodePubKey(const uint256 & sighash, const std::vector<unsigned char> & signature, CPubKey & pubkeyRet) {
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << sighash << signature;
+    const auto entry = ss.GetHash();
+    {
+        LOCK(muSnodeKeys);
+        auto it = mapSnodeKeys.find(entry);
+        if (it != mapSnodeKeys.end()) {
+            pubkeyRet = it->second.pubkey;
+            return true;
+        }
+    }
+    if (!pubkeyRet.RecoverCompact(sighash, signature))
+        return false;
+    CachedSnodeKey key;
+    key.pubkey = pubkeyRet;
+    LOCK(muSnodeKeys);
+    if (mapSnodeKeys.count(entry))
+        return true;
+    key.sequence = ++nSnodeKeySequence;
+    mapSnodeKeys.insert(std::make_pair(entry, key));
+    return true;
+}
+
+bool FindParsedSnodeConfig(const uint256 & configHash, ParsedSnodeConfig & parsedRet) {
+    LOCK(muSnodeConfigs);
+    auto it = mapSnodeConfigs.find(configHash);
+    if (it == mapSnodeConfigs.end())
+        return false;
+    parsedRet = it->second.config;
+    return true;
+}
+
+void CacheParsedSnodeConfig(const uint256 & configHash, const ParsedSnodeConfig & parsed) {
+    CachedSnodeConfig entry;
+    entry.config = parsed;
+    LOCK(muSnodeConfigs);
+    if (mapSnodeConfigs.count(configHash))
+        return;
+    entry.sequence = ++nSnodeConfigSequence;
+    mapSnodeConfigs.insert(std::make_pair(configHash, entry));
+}
+
+}
@@ -34,9 +34,53 @@
  */
 namespace sn {
 
-typedef std::function<CTransactionRef(const COutPoint & out)> TxFunc;
+typedef std::function<bool(const COutPoint & out, CTxOut & txOutRet)> CoinFunc;
 typedef std::function<bool(const uint32_t & blockNumber, const uint256 & blockHash, const bool & checkStale)> BlockValidFunc;
 
+/** Maximum number of recovered servicenode registration keys to cache */
+static const size_t MAX_SNODE_KEY_CACHE = 20000;
+
+/**
+ * Recovers the pubkey of a compact servicenode registration signature. Recovered keys are cached
+ * because the registration is validated again with every ping of the servicenode.
+ * @param sighash
+ * @param signature
+ * @param pubkeyRet
+ * @return
+ */
+bool RecoverSnodePubKey(const uint256 & sighash, const std::vector<unsigned char> & signature, CPubKey & pubkeyRet);
+
+/** Maximum number of parsed servicenode configs to cache */
+static const size_t MAX_SNODE_CONFIG_CACHE = 20000;
+
+/**
+ * The details parsed from a servicenode config.
+ */
+struct ParsedSnodeConfig {
+    bool valid{false};
+    uint32_t xbridgeversion{0};
+    uint32_t xbridgefeatures{0};
+    uint32_t xrouterversion{0};
+    CService addr;
+    std::vector<std::string> services;
+};
+
+/**
+ * Looks up the parsed servicenode config with the specified hash. Parsed configs are cached
+ * because every ping of a servicenode carries its config, which rarely changes.
+ * @param configHash
+ * @param parsedRet
+ * @return
+ */
+bool FindParsedSnodeConfig(const uint256 & configHash, ParsedSnodeConfig & parsedRet);
+
+/**
+ * Caches the parsed servicenode config with the specified hash.
+ * @param configHash
+ * @param parsed
+ */
+void CacheParsedSnodeConfig(const uint256 & configHash, const ParsedSnodeConfig & parsed);
+
 /**
  * Represents a legacy XBridge packet.
  */
@@ -57,6 +101,21 @@ public:
         body      = std::vector<unsigned char>(packet.begin()+offset, packet.end());
     }
 
+    /**
+     * Reads the command of the network packet in place.
+     * @param packet
+     * @param size
+     * @param command
+     * @return false if the packet is too small
+     */
+    static bool ReadCommand(const unsigned char *packet, const size_t size, uint32_t & command) {
+        const unsigned int offset{20+8+sizeof(uint32_t)}; // packet address, timestamp & version
+        if (size < offset + sizeof(uint32_t))
+            return false;
+        memcpy(&command, packet + offset, sizeof(uint32_t));
+        return true;
+    }
+
 public:
     uint32_t version;
     uint32_t command;
@@ -218,6 +277,15 @@ public:
         return xbridgeversion;
     }
 
+    /**
+     * Returns the XBRIDGE_FEATURE_* flags of the servicenode, 0 for servicenodes that
+     * don't announce any.
+     * @return
+     */
+    const uint32_t& getXBridgeFeatures() const {
+        return xbridgefeatures;
+    }
+
     /**
      * Returns the servicenode xrouter protocol version.
      * @return
@@ -233,7 +301,16 @@ public:
      */
     bool running() const {
         return (!invalid || (currentBlock - invalidBlock >= 0 && currentBlock - invalidBlock <= VALID_GRACEPERIOD_BLOCKS))
-               && GetAdjustedTime() - pingtime < 300;
+               && GetAdjustedTime() < runningUntil();
+    }
+
+    /**
+     * Returns the unix time at which the servicenode stops being considered running
+     * unless it pings again.
+     * @return
+     */
+    int64_t runningUntil() const {
+        return pingtime + 300;
     }
 
     /**
@@ -260,8 +337,28 @@ public:
      */
     void setConfig(const std::string & c) {
         config = c;
-        services.clear();
-        parseConfig();
+        configHash = Hash(config.begin(), config.end());
+        ParsedSnodeConfig parsed;
+        if (!FindParsedSnodeConfig(configHash, parsed)) {
+            xbridgeversion = 0;
+            xbridgefeatures = 0;
+            xrouterversion = 0;
+            addr = CService();
+            services.clear();
+            parsed.valid = parseConfig();
+            parsed.xbridgeversion = xbridgeversion;
+            parsed.xbridgefeatures = xbridgefeatures;
+            parsed.xrouterversion = xrouterversion;
+            parsed.addr = addr;
+            parsed.services = services;
+            CacheParsedSnodeConfig(configHash, parsed);
+            return;
+        }
+        xbridgeversion = parsed.xbridgeversion;
+        xbridgefeatures = parsed.xbridgefeatures;
+        xrouterversion = parsed.xrouterversion;
+        addr = parsed.addr;
+        services = std::move(parsed.services);
     }
 
     /**
@@ -272,6 +369,14 @@ public:
         return config;
     }
 
+    /**
+     * Return the hash of the servicenode config.
+     * @return
+     */
+    const uint256& getConfigHash() const {
+        return configHash;
+    }
+
     /**
      * Return the servicenode config filtered by the specified key name. The config's
      * json object matching the name of the specified filter will be returned.
@@ -363,12 +468,12 @@ public:
      * measures to verify a Servicenode. The Servicenode ping will change this state periodically, therefore it may
      * be necessary to specifically disable the stale check if initial validation checks passed at the time of the
      * initial Servicenode ping.
-     * @param getTxFunc
+     * @param getCoinFunc
      * @param isBlockValid
      * @param checkStale
      * @return
      */
-    bool isValid(const TxFunc & getTxFunc, const BlockValidFunc & isBlockValid, const bool & checkStale=true) const
+    bool isValid(const CoinFunc & getCoinFunc, const BlockValidFunc & isBlockValid, const bool & checkStale=true) const
     {
         // Block reported by snode must be ancestor of our chain tip
         if (!isBlockValid(pingBestBlock, pingBestBlockHash, checkStale))
@@ -382,7 +487,7 @@ public:
         if (tier == Tier::OPEN) {
             const auto & sighash = sigHash();
             CPubKey pubkey2;
-            if (!pubkey2.RecoverCompact(sighash, signature))
+            if (!RecoverSnodePubKey(sighash, signature, pubkey2))
                 return false; // not valid if bad sig
             return snodePubKey.GetID() == pubkey2.GetID();
         }
@@ -406,7 +511,7 @@ public:
 
         const auto & sighash = sigHash();
         CPubKey pubkey;
-        if (!pubkey.RecoverCompact(sighash, signature))
+        if (!RecoverSnodePubKey(sighash, signature, pubkey))
             return false; // not valid if bad sig
 
         CAmount total{0}; // Track the total collateral amount
@@ -414,14 +519,10 @@ public:
 
         // Determine if all collateral utxos validate the sig
         for (const auto & op : collateral) {
-            CTransactionRef tx = getTxFunc(op);
-            if (!tx)
-                return false; // not valid if no transaction found or utxo is already spent
+            CTxOut out;
+            if (!getCoinFunc(op, out))
+                return false; // not valid if utxo is not found or is already spent
 
-            if (tx->vout.size() <= op.n)
-                return false; // not valid if bad vout index
-
-            const auto & out = tx->vout[op.n];
             total += out.nValue;
 
             if (processed.count(CScriptID(out.scriptPubKey)))
@@ -432,7 +533,7 @@ public:
                 return false; // not valid if bad address
 
             CKeyID *keyid = boost::get<CKeyID>(&address);
-            if (pubkey.GetID() != *keyid)
+            if (!keyid || pubkey.GetID() != *keyid)
                 return false; // fail if pubkeys don't match
 
             processed.insert(CScriptID(out.scriptPubKey));
@@ -508,6 +609,11 @@ protected:
                 return false; // do not continue processing the config on bad protocol version
             xbridgeversion = uxbver.get_int();
 
+            // Optional xbridge features, not announced by older servicenodes
+            const auto uxbfeatures = find_value(uv, "xbridgefeatures");
+            if (!uxbfeatures.isNull() && uxbfeatures.isNum())
+                xbridgefeatures = uxbfeatures.get_int();
+
             // Get the config version
             const auto uxrver = find_value(uv, "xrouterversion");
             if (uxrver.isNull() || !uxrver.isNum())
@@ -580,7 +686,9 @@ protected: // in-memory only
     uint32_t pingBestBlock;
     uint256 pingBestBlockHash;
     std::string config;
+    uint256 configHash;
     uint32_t xbridgeversion{0};
+    uint32_t xbridgefeatures{0};
     uint32_t xrouterversion{0};
     CService addr;
     std::vector<std::string> services;
@@ -590,6 +698,7 @@ protected: // in-memory only
 };
 
 typedef std::shared_ptr<ServiceNode> ServiceNodePtr;
+typedef std::shared_ptr<const ServiceNode> ServiceNodeConstPtr;
 
 /**
  * The Servicenode ping is responsible for notifying peers of the latest servicenode details. The ping
@@ -672,6 +781,14 @@ public:
         return config;
     }
 
+    /**
+     * Best block reported by the ping.
+     * @return
+     */
+    uint32_t getBestBlock() const {
+        return bestBlock;
+    }
+
     /**
      * Hash used in signing.
      * @return
@@ -688,10 +805,19 @@ public:
      */
     uint256 getHash() const {
         CHashWriter ss(SER_GETHASH, 0);
-        ss << snodePubKey << bestBlock << bestBlockHash << pingTime << config << snode << signature;
+        writeHashData(ss);
         return ss.GetHash();
     }
 
+    /**
+     * Writes the data covered by the ping hash, e.g. to a CHashBatch.
+     * @param s
+     */
+    template <typename Stream>
+    void writeHashData(Stream & s) const {
+        s << snodePubKey << bestBlock << bestBlockHash << pingTime << config << snode << signature;
+    }
+
     /**
      * Sign's the servicenode ping with the specified key.
      * @param key
@@ -706,10 +832,10 @@ public:
      * validity. The ping is signed by the snode privkey while the registration is signed by the snode collateral
      * privkey. The exception is OPEN (free) tier nodes always sign with their snode privkeys since they are not
      * allowed to accept payments.
-     * @param getTxFunc
+     * @param getCoinFunc
      * @param isBlockValid
      */
-    bool isValid(const TxFunc & getTxFunc, const BlockValidFunc & isBlockValid) const {
+    bool isValid(const CoinFunc & getCoinFunc, const BlockValidFunc & isBlockValid) const {
         if (!isBlockValid(bestBlock, bestBlockHash, true))
             return false; // fail if ping is stale
 
@@ -734,13 +860,13 @@ public:
         }
 
         CPubKey pubkey;
-        if (!pubkey.RecoverCompact(sigHash(), signature))
+        if (!RecoverSnodePubKey(sigHash(), signature, pubkey))
             return false; // not valid if bad sig
 
         if (pubkey.GetID() != snodePubKey.GetID())
             return false; // fail if pubkeys don't match
 
-        return snode.isValid(getTxFunc, isBlockValid, false); // stale check not required here, it happens above on isBlockValid
+        return snode.isValid(getCoinFunc, isBlockValid, false); // stale check not required here, it happens above on isBlockValid
     }
 
 protected:
@@ -753,6 +879,77 @@ protected:
     std::vector<unsigned char> signature;
 };
 
+/**
+ * Servicenode list sent to peers on connect. Contains the latest ping of each servicenode or,
+ * for delta updates, only the pings reporting a best block after the requested block.
+ */
+class ServiceNodeList {
+public:
+    static const uint8_t CURRENT_VERSION = 2;
+
+    explicit ServiceNodeList() = default;
+    explicit ServiceNodeList(int32_t height, int32_t since, bool complete, std::vector<ServiceNodePing> pings) :
+                                 height(height), since(since), complete(complete), pings(std::move(pings)) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(version);
+        READWRITE(height);
+        READWRITE(since);
+        READWRITE(complete);
+        READWRITE(pings);
+    }
+
+    /**
+     * List format version.
+     * @return
+     */
+    uint8_t getVersion() const {
+        return version;
+    }
+
+    /**
+     * Chain height of the sender when the list was created.
+     * @return
+     */
+    int32_t getHeight() const {
+        return height;
+    }
+
+    /**
+     * Only pings reporting a best block after this block are included, 0 for the full list.
+     * @return
+     */
+    int32_t getSince() const {
+        return since;
+    }
+
+    /**
+     * False if the list was cut off at MAX_SNODE_LIST_SIZE pings or MAX_SNODE_LIST_BYTES.
+     * @return
+     */
+    bool isComplete() const {
+        return complete;
+    }
+
+    /**
+     * Latest servicenode pings.
+     * @return
+     */
+    const std::vector<ServiceNodePing> & getPings() const {
+        return pings;
+    }
+
+protected:
+    uint8_t version{CURRENT_VERSION};
+    int32_t height{0};
+    int32_t since{0};
+    bool complete{true};
+    std::vector<ServiceNodePing> pings;
+};
+
 }
 
 #endif //BLOCKNET_SERVICENODE_H
@@ -3,3 +3,24 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <servicenode/servicenodemgr.h>
+
+#include <metrics.h>
+
+namespace sn {
+
+static metrics::CallbackGauge g_metric_snodes{"blocknet_servicenodes", "Known servicenodes", []{
+    return (double)ServiceNodeMgr::instance().snapshot()->size();
+}};
+static metrics::CallbackGauge g_metric_snodes_running{"blocknet_servicenodes_running", "Servicenodes that pinged recently", []{
+    const auto snap = ServiceNodeMgr::instance().snapshot();
+    return (double)std::count_if(snap->begin(), snap->end(), [](const ServiceNodeMap::value_type & item) {
+        return item.second->running();
+    });
+}};
+
+void ThreadServiceNodeCheck() {
+    RenameThread("blocknet-snodech");
+    ServiceNodeMgr::instance().processPacketQueue();
+}
+
+}
@@ -6,10 +6,14 @@
 #define BLOCKNET_SERVICENODEMGR_H
 
 #include <amount.h>
+#include <bloom.h>
+#include <hash.h>
 #include <key_io.h>
 #include <net.h>
 #include <netmessagemaker.h>
+#include <net_processing.h>
 #include <servicenode/servicenode.h>
+#include <sigbatch.h>
 #include <script/standard.h>
 #include <streams.h>
 #include <sync.h>
@@ -17,20 +21,71 @@
 #include <util/system.h>
 #include <validation.h>
 #include <validationinterface.h>
+#include <wallet/coinselection.h>
 #include <wallet/wallet.h>
 
+#include <atomic>
+#include <deque>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
 #include <set>
 #include <utility>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/signals2/signal.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
 
 /**
  * Servicenode namepsace
  */
 namespace sn {
 
+/** Number of recent servicenode packet hashes remembered to avoid relaying packets twice */
+static const unsigned int SNODE_SEEN_PACKETS = 350000;
+/** Maximum number of servicenode packets waiting for validation */
+static const size_t MAX_SNODE_PACKET_QUEUE = 20000;
+/** Amount a collateral combination may exceed the tier collateral in the branch and bound search */
+static const CAmount COLLATERAL_SEARCH_TOLERANCE = COIN;
+/** Maximum number of pings and serialized size of a servicenode list message */
+static const size_t MAX_SNODE_LIST_SIZE = 10000;
+static const size_t MAX_SNODE_LIST_BYTES = 2 * 1000 * 1000;
+/** Maximum number of pings and serialized size of a batched ping message (snps) */
+static const size_t MAX_SNODE_PING_BATCH = 1000;
+static const size_t MAX_SNODE_PING_BATCH_BYTES = 1000 * 1000;
+/** Number of recent blocks whose servicenode invalidations are kept to undo them on a reorg */
+static const int SNODE_UNDO_BLOCKS = 1000;
+
+/**
+ * Servicenode registration or ping waiting to be validated on the servicenode check thread.
+ */
+struct ServiceNodePacket {
+    bool isPing{false};
+    ServiceNode snode; // registration
+    ServiceNodePing ping;
+    std::function<void(const ServiceNode & snode)> onRegistration; // called once the registration is added
+    std::function<void(const ServiceNodePing & ping)> onPing; // called once the ping is applied
+};
+
+/**
+ * Servicenode state changes published by ServiceNodeMgr::NotifyServiceNode.
+ */
+enum class ServiceNodeEvent : uint8_t {
+    ADDED = 0, // new or changed registration
+    PING,      // ping applied
+    INVALID,   // collateral spent
+    REMOVED,
+};
+
+/**
+ * Servicenode check thread, validates the queued servicenode registrations and pings.
+ */
+void ThreadServiceNodeCheck();
+
 /**
  * Service node configuration entry (from servicenode.conf).
  */
@@ -58,6 +113,8 @@ struct ServiceNodeConfigEntry {
     }
 };
 
+typedef std::map<CPubKey, ServiceNodeConstPtr> ServiceNodeMap;
+
 /**
  * Manages related servicenode functions including handling network messages and storing an active list
  * of valid servicenodes.
@@ -66,6 +123,9 @@ class ServiceNodeMgr : public CValidationInterface {
 public:
     ServiceNodeMgr() = default;
 
+    /** Fired outside the servicenode lock on the thread that applied the change */
+    boost::signals2::signal<void (const ServiceNode & snode, ServiceNodeEvent event)> NotifyServiceNode;
+
     /**
      * Singleton instance.
      * @return
@@ -81,30 +141,44 @@ public:
     void reset() {
         LOCK(mu);
         snodes.clear();
-        seenPackets.clear();
+        snodesByCollateral.clear();
+        snodePings.clear();
+        invalidations.clear();
+        listHeight = 0;
+        publishSnodes();
+        seenPackets.reset();
         snodeEntries.clear();
     }
 
     /**
      * Processes xbridge packets.
      * @param packet
+     * @param hash Hash of the packet
      * @return
      */
-    bool processXBridge(const std::vector<unsigned char> & packet) {
-        if (seenPacket(packet))
+    bool processXBridge(const CNetPayload & packet, const uint256 & hash) {
+        if (seenPacket(hash))
             return false;
 
-        try { // Check if legacy packet
-            LegacyXBridgePacket p;
-            p.CopyFrom(packet);
-            if (p.command > 0 && p.command != 50)
-                return true; // ignore all packets except service ping
-            // TODO Handle legacy snode ping packet
-        } catch (...) { } // ignore errors
+        // Check if legacy packet, the command is read in place
+        uint32_t command{0};
+        if (LegacyXBridgePacket::ReadCommand(packet.data(), packet.size(), command) && command > 0 && command != 50)
+            return true; // ignore all packets except service ping
+        // TODO Handle legacy snode ping packet
 
         return true;
     }
 
+    /**
+     * Returns true if the packet hash was seen, without marking it as seen.
+     * @param hash
+     * @return
+     */
+    bool hasSeenPacket(const uint256 & hash) {
+        LOCK(mu);
+        return seenPackets.contains(hash);
+    }
+
     /**
      * Processes a servicenode registration message from the network.
      * @param ss
@@ -168,13 +242,267 @@ public:
         if (seenPacket(ping.getHash()))
             return false;
 
-        if (!ping.isValid(GetTxFunc, IsServiceNodeBlockValidFunc))
+        if (!ping.isValid(GetCoinFunc, IsServiceNodeBlockValidFunc))
             return false; // bad ping
 
         addSn(ping.getSnode(), false); // skip validity check here because it's checked in the ping's
+        setPing(ping);
+        return true;
+    }
+
+    /**
+     * Returns the servicenode list for a peer. Only includes the pings reporting a best block
+     * after the specified block, 0 returns the full list.
+     * @param since
+     * @return
+     */
+    ServiceNodeList getSnList(const int & since) {
+        int height{0};
+        {
+            LOCK(cs_main);
+            height = chainActive.Height();
+        }
+        std::vector<ServiceNodePing> pings;
+        size_t bytes{0};
+        bool complete{true};
+        LOCK(mu);
+        for (const auto & item : snodePings) {
+            const auto & ping = item.second;
+            if (static_cast<int>(ping.getBestBlock()) <= since)
+                continue;
+            auto it = snodes.find(item.first);
+            if (it == snodes.end() || it->second->getInvalid())
+                continue;
+            bytes += GetSerializeSize(ping, PROTOCOL_VERSION);
+            if (pings.size() >= MAX_SNODE_LIST_SIZE || bytes > MAX_SNODE_LIST_BYTES) {
+                complete = false;
+                break;
+            }
+            pings.push_back(ping);
+        }
+        return ServiceNodeList(height, since, complete, std::move(pings));
+    }
+
+    /**
+     * Queues the pings of a servicenode list from the network for validation on the servicenode
+     * check thread. Returns false if the list is malformed or has an unknown version. The list
+     * height only advances to the height of our request, and only if the list is complete and
+     * all its pings were queued.
+     * @param ss
+     * @param requestHeight Our chain height when the list was requested
+     * @param onValid Called on the check thread with each applied ping
+     * @return
+     */
+    bool processSnList(CDataStream & ss, const int & requestHeight, std::function<void(const ServiceNodePing & ping)> onValid) {
+        ServiceNodeList list;
+        try {
+            ss >> list;
+        } catch (...) {
+            return false;
+        }
+        if (list.getVersion() != ServiceNodeList::CURRENT_VERSION || list.getPings().size() > MAX_SNODE_LIST_SIZE)
+            return false;
+        const auto & pings = list.getPings();
+        const auto hashes = pingHashes(pings);
+        for (size_t i = 0; i < pings.size(); ++i) {
+            const auto & ping = pings[i];
+            if (hasSeenPacket(hashes[i]))
+                continue;
+            ServiceNodePacket packet;
+            packet.isPing = true;
+            packet.ping = ping;
+            packet.onPing = onValid;
+            if (!queuePacket(std::move(packet), hashes[i]))
+                return true; // queue is full, the next list starts from the same height
+        }
+        if (!list.isComplete())
+            return true;
+        // The sender may only have pings up to its own height
+        const int newHeight = std::min(requestHeight, static_cast<int>(list.getHeight()));
+        int height = listHeight;
+        while (newHeight > height && !listHeight.compare_exchange_weak(height, newHeight));
+        return true;
+    }
+
+    /**
+     * Height of the most recent servicenode list received from a peer. Servicenode lists
+     * requested from new peers only include the pings after this block.
+     * @return
+     */
+    int getSnListHeight() const {
+        return listHeight;
+    }
+
+    /**
+     * Queues a servicenode registration from the network for validation on the servicenode check
+     * thread. Returns false if the packet is malformed, already seen or the queue is full.
+     * @param ss
+     * @param onValid Called on the check thread with the added snode
+     * @return
+     */
+    bool queueRegistration(CDataStream & ss, std::function<void(const ServiceNode & snode)> onValid) {
+        ServiceNodePacket packet;
+        try {
+            ss >> packet.snode;
+        } catch (...) {
+            return false;
+        }
+        const uint256 hash = packet.snode.getHash();
+        if (hasSeenPacket(hash))
+            return false;
+        packet.onRegistration = std::move(onValid);
+        return queuePacket(std::move(packet), hash);
+    }
+
+    /**
+     * Queues a servicenode ping from the network for validation on the servicenode check thread.
+     * Returns false if the packet is malformed, already seen or the queue is full.
+     * @param ss
+     * @param onValid Called on the check thread with the applied ping
+     * @return
+     */
+    bool queuePing(CDataStream & ss, std::function<void(const ServiceNodePing & ping)> onValid) {
+        ServiceNodePing ping;
+        try {
+            ss >> ping;
+        } catch (...) {
+            return false;
+        }
+        return queuePing(ping, std::move(onValid));
+    }
+
+    /**
+     * Queues a servicenode ping that was already read from the network.
+     * @param ping
+     * @param onValid Called on the check thread with the applied ping
+     * @return
+     */
+    bool queuePing(const ServiceNodePing & ping, std::function<void(const ServiceNodePing & ping)> onValid) {
+        const uint256 hash = ping.getHash();
+        if (hasSeenPacket(hash))
+            return false;
+        ServiceNodePacket packet;
+        packet.isPing = true;
+        packet.ping = ping;
+        packet.onPing = std::move(onValid);
+        return queuePacket(std::move(packet), hash);
+    }
+
+    /**
+     * Queues a batch of servicenode pings (snps) for validation, pings already seen are skipped.
+     * Returns false if the batch is too large.
+     * @param pings
+     * @param onValid Called on the check thread with each applied ping
+     * @return
+     */
+    bool queuePings(const std::vector<ServiceNodePing> & pings, const std::function<void(const ServiceNodePing & ping)> & onValid) {
+        if (pings.size() > MAX_SNODE_PING_BATCH)
+            return false;
+        const auto hashes = pingHashes(pings);
+        for (size_t i = 0; i < pings.size(); ++i) {
+            const auto & ping = pings[i];
+            if (hasSeenPacket(hashes[i]))
+                continue;
+            ServiceNodePacket packet;
+            packet.isPing = true;
+            packet.ping = ping;
+            packet.onPing = onValid;
+            if (!queuePacket(std::move(packet), hashes[i]))
+                break;
+        }
         return true;
     }
 
+    /**
+     * Hashes of the pings, computed side by side.
+     * @param pings
+     * @return
+     */
+    static std::vector<uint256> pingHashes(const std::vector<ServiceNodePing> & pings) {
+        CHashBatch batch(SER_GETHASH, 0);
+        for (const auto & ping : pings) {
+            ping.writeHashData(batch);
+            batch.Next();
+        }
+        return batch.GetHashes();
+    }
+
+    /**
+     * Adds the recovery of a snode signature's pubkey into the snode key cache to the batch.
+     * @param sigbatch
+     * @param sighash
+     * @param signature
+     */
+    static void addSnodeKeyRecovery(CSignatureBatch & sigbatch, const uint256 & sighash,
+            const std::vector<unsigned char> & signature)
+    {
+        sigbatch.Add([sighash, signature]() {
+            CPubKey pubkey;
+            return RecoverSnodePubKey(sighash, signature, pubkey);
+        });
+    }
+
+    /**
+     * Validates the queued servicenode packets until the thread is interrupted. Packets are
+     * validated in batches, only the most recent registration and ping of each snode in a batch
+     * is validated.
+     */
+    void processPacketQueue() {
+        while (true) {
+            std::deque<ServiceNodePacket> batch;
+            {
+                boost::unique_lock<boost::mutex> lock(muqueue);
+                while (packetQueue.empty())
+                    queueCond.wait(lock); // interruption point
+                batch.swap(packetQueue);
+            }
+
+            // Later packets of the same snode supersede the earlier ones in the batch
+            std::map<std::pair<bool, CPubKey>, size_t> latest;
+            for (size_t i = 0; i < batch.size(); ++i) {
+                const auto & packet = batch[i];
+                latest[{packet.isPing, packet.isPing ? packet.ping.getSnodePubKey() : packet.snode.getSnodePubKey()}] = i;
+            }
+
+            // Recover the signing keys of the batch on the signature check threads, the
+            // validation below finds them in the snode key cache
+            CSignatureBatch sigbatch;
+            for (const auto & item : latest) {
+                const auto & packet = batch[item.second];
+                const auto & snode = packet.isPing ? packet.ping.getSnode() : packet.snode;
+                if (packet.isPing)
+                    addSnodeKeyRecovery(sigbatch, packet.ping.sigHash(), packet.ping.getSignature());
+                addSnodeKeyRecovery(sigbatch, snode.sigHash(), snode.getSignature());
+            }
+            sigbatch.Verify();
+
+            for (size_t i = 0; i < batch.size(); ++i) {
+                boost::this_thread::interruption_point();
+                const auto & packet = batch[i];
+                if (latest[{packet.isPing, packet.isPing ? packet.ping.getSnodePubKey() : packet.snode.getSnodePubKey()}] != i)
+                    continue;
+                try {
+                    if (packet.isPing) {
+                        if (!packet.ping.isValid(GetCoinFunc, IsServiceNodeBlockValidFunc))
+                            continue; // bad ping
+                        addSn(packet.ping.getSnode(), false); // checked in the ping's validation
+                        setPing(packet.ping);
+                        if (packet.onPing)
+                            packet.onPing(packet.ping);
+                    } else {
+                        if (!packet.snode.isValid(GetCoinFunc, IsServiceNodeBlockValidFunc))
+                            continue; // bad registration
+                        auto snptr = addSn(packet.snode, false);
+                        if (snptr && packet.onRegistration)
+                            packet.onRegistration(*snptr);
+                    }
+                } catch (std::exception & e) {
+                    LogPrint(BCLog::SNODE, "servicenode packet processed with error: %s\n", e.what());
+                }
+            }
+        }
+    }
+
     /**
      * Registers a snode on the network. This will also automatically search the wallet for required collateral.
      * This requires the wallet to be unlocked any snodes that are not "OPEN" (free) snodes.
@@ -249,12 +577,9 @@ public:
             std::set<COutPoint> alreadyAllocatedUtxos;
             {
                 LOCK(mu);
-                for (const auto & item : snodes) {
-                    const auto & s = item.second;
-                    if (s->getSnodePubKey() != snodePubKey) { // exclude registering snode
-                        const auto & c = s->getCollateral();
-                        alreadyAllocatedUtxos.insert(c.begin(), c.end());
-                    }
+                for (const auto & item : snodesByCollateral) {
+                    if (item.second != snodePubKey) // exclude registering snode
+                        alreadyAllocatedUtxos.insert(alreadyAllocatedUtxos.end(), item.first);
                 }
             }
 
@@ -338,25 +663,22 @@ public:
         const uint32_t bestBlock = getActiveChainHeight();
         const uint256 & bestBlockHash = getActiveChainHash(bestBlock);
 
-        snode->setConfig(config);
-        snode->updatePing();
+        ServiceNode s(*snode); // the registry's servicenodes are immutable
+        s.setConfig(config);
+        s.updatePing();
 
-        ServiceNodePing ping(activesn.key.GetPubKey(), bestBlock, bestBlockHash, static_cast<uint32_t>(GetTime()), config, *snode);
+        ServiceNodePing ping(activesn.key.GetPubKey(), bestBlock, bestBlockHash, static_cast<uint32_t>(GetTime()), config, s);
         ping.sign(activesn.key);
-        if (!ping.isValid(GetTxFunc, IsServiceNodeBlockValidFunc)) {
+        if (!ping.isValid(GetCoinFunc, IsServiceNodeBlockValidFunc)) {
             LogPrint(BCLog::SNODE, "service node ping failed\n");
             return false;
         }
 
         addSn(ping.getSnode(), false); // skip validity check here because it's checked in the ping's
+        setPing(ping);
 
-        // Relay
-        connman->ForEachNode([&](CNode* pnode) {
-            if (!pnode->fSuccessfullyConnected)
-                return;
-            const CNetMsgMaker msgMaker(pnode->GetSendVersion());
-            connman->PushMessage(pnode, msgMaker.Make(NetMsgType::SNPING, ping));
-        });
+        // Relay on the peers' next inventory trickle
+        RelayServiceNodePing(ping, connman);
 
         return true;
     }
@@ -366,13 +688,33 @@ public:
      * @return
      */
     std::vector<ServiceNode> list() {
-        LOCK(mu);
-        std::vector<ServiceNode> l; l.reserve(snodes.size());
-        for (const auto & item : snodes)
+        const auto snap = snapshot();
+        std::vector<ServiceNode> l; l.reserve(snap->size());
+        for (const auto & item : *snap)
            l.push_back(*item.second);
         return std::move(l);
     }
 
+    /**
+     * Returns the current servicenode registry. The snapshot and its servicenodes are immutable,
+     * it is replaced each time a servicenode is added, removed or changed, readers never wait
+     * on network processing.
+     * @return
+     */
+    std::shared_ptr<const ServiceNodeMap> snapshot() {
+        LOCK(musnap);
+        return snodesSnapshot;
+    }
+
+    /**
+     * Returns the registry version, it changes every time a servicenode is added, removed,
+     * pinged or invalidated and on every new chain tip.
+     * @return
+     */
+    uint64_t registryVersion() const {
+        return version.load(std::memory_order_acquire);
+    }
+
     /**
      * Returns the servicenode with the specified pubkey.
      * @param snodePubKey
@@ -400,8 +742,8 @@ public:
      * @return
      */
     ServiceNode getSn(const std::string & nodeAddr) {
-        LOCK(mu);
-        for (const auto & s : snodes)
+        const auto snap = snapshot();
+        for (const auto & s : *snap)
             if (s.second->getHost() == nodeAddr)
                 return *s.second;
         return ServiceNode{};
@@ -448,7 +790,8 @@ public:
     void removeSnEntries() {
         LOCK(mu);
         for (const auto & entry : snodeEntries)
-            snodes.erase(entry.key.GetPubKey());
+            eraseSn(entry.key.GetPubKey());
+        publishSnodes();
         snodeEntries.clear();
     }
 
@@ -578,6 +921,14 @@ public:
         return std::move(GetDataDir() / ".servicenoderegistration");
     }
 
+    /**
+     * Returns the servicenode list cache file.
+     * @return
+     */
+    static boost::filesystem::path getServiceNodeListCache() {
+        return std::move(GetDataDir() / "servicenodes.dat");
+    }
+
     /**
      * Returns the collateral amount required for the specified tier.
      * @param tier
@@ -727,6 +1078,64 @@ public:
         return false;
     }
 
+    /**
+     * Writes the latest pings of all valid servicenodes to the servicenode list cache.
+     * @return
+     */
+    bool writeSnListToDisk() {
+        boost::filesystem::path fp = getServiceNodeListCache();
+        boost::filesystem::path fptmp = fp.string() + ".new";
+        try {
+            CDataStream ss(SER_DISK, 0);
+            ss << getSnList(0);
+            ss << Hash(ss.begin(), ss.end()); // checksum
+            {
+                boost::filesystem::ofstream file;
+                file.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+                file.open(fptmp, std::ios_base::binary);
+                file.write(ss.str().c_str(), ss.size());
+            }
+            if (!RenameOver(fptmp, fp))
+                throw std::runtime_error("rename failed");
+        } catch (std::exception & e) {
+            LogPrint(BCLog::SNODE, "Failed to write to servicenodes.dat: %s\n", e.what());
+            return false;
+        } catch (...) {
+            LogPrint(BCLog::SNODE, "Failed to write to servicenodes.dat unknown error\n");
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * Loads the servicenode list cache from disk. The cached pings are revalidated against the
+     * chain tip on the servicenode check thread, stale pings are dropped. Returns false if the
+     * cache does not exist or is corrupt.
+     * @param onValid Called on the check thread with each applied ping
+     * @return
+     */
+    bool loadSnListFromDisk(std::function<void(const ServiceNodePing & ping)> onValid) {
+        boost::filesystem::path fp = getServiceNodeListCache();
+        boost::filesystem::ifstream fs(fp, std::ios_base::binary);
+        if (!fs.good())
+            return false;
+        std::stringstream buffer;
+        buffer << fs.rdbuf();
+        auto str = buffer.str();
+        if (str.size() < sizeof(uint256))
+            return false;
+        CDataStream ss(std::vector<char>(str.begin(), str.end() - sizeof(uint256)), SER_DISK, 0);
+        uint256 checksum;
+        memcpy(checksum.begin(), str.data() + str.size() - sizeof(uint256), sizeof(uint256));
+        if (Hash(ss.begin(), ss.end()) != checksum) {
+            LogPrint(BCLog::SNODE, "Failed to load servicenodes.dat: checksum mismatch\n");
+            return false;
+        }
+        // Our own list, its height is trusted
+        return processSnList(ss, std::numeric_limits<int>::max(), std::move(onValid));
+    }
+
 protected:
     /**
      * Returns the height of the longest chain.
@@ -773,15 +1182,22 @@ protected:
      * @param staleCheck default true, skips stale check if false
      * @return
      */
-    ServiceNodePtr addSn(const ServiceNode & snode, const bool checkValid = true, const bool staleCheck = true) {
-        if (checkValid && !snode.isValid(GetTxFunc, IsServiceNodeBlockValidFunc, staleCheck))
+    ServiceNodeConstPtr addSn(const ServiceNode & snode, const bool checkValid = true, const bool staleCheck = true) {
+        if (checkValid && !snode.isValid(GetCoinFunc, IsServiceNodeBlockValidFunc, staleCheck))
             return nullptr;
-        removeSnWithCollateral(snode);
-        auto ptr = std::make_shared<ServiceNode>(snode);
+        ServiceNodeConstPtr ptr = std::make_shared<const ServiceNode>(snode);
+        bool changed{false};
         {
             LOCK(mu);
-            snodes[ptr->getSnodePubKey()] = ptr;
+            // Pings carry the registration, only new or changed registrations are published
+            auto it = snodes.find(snode.getSnodePubKey());
+            changed = it == snodes.end() || it->second->getHash() != snode.getHash();
+            removeSnWithCollateral(snode);
+            insertSn(ptr);
+            publishSnodes();
         }
+        if (changed)
+            NotifyServiceNode(*ptr, ServiceNodeEvent::ADDED);
         return ptr;
     }
 
@@ -790,10 +1206,11 @@ protected:
      * @param snodePubKey
      * @return
      */
-    ServiceNodePtr findSn(const CPubKey & snodePubKey) {
-        LOCK(mu);
-        if (snodes.count(snodePubKey))
-            return snodes[snodePubKey];
+    ServiceNodeConstPtr findSn(const CPubKey & snodePubKey) {
+        const auto snap = snapshot();
+        auto it = snap->find(snodePubKey);
+        if (it != snap->end())
+            return it->second;
         return nullptr;
     }
 
@@ -802,7 +1219,7 @@ protected:
      * @param snodePubKey
      * @return
      */
-    ServiceNodePtr findSn(const std::vector<unsigned char> & snodePubKey) {
+    ServiceNodeConstPtr findSn(const std::vector<unsigned char> & snodePubKey) {
         return findSn(CPubKey(snodePubKey));
     }
 
@@ -812,10 +1229,17 @@ protected:
      * @return
      */
     bool removeSn(const CPubKey & snodePubKey) {
-        if (!hasSn(snodePubKey))
-            return false;
-        LOCK(mu);
-        snodes.erase(snodePubKey);
+        ServiceNodeConstPtr snode;
+        {
+            LOCK(mu);
+            auto it = snodes.find(snodePubKey);
+            if (it == snodes.end())
+                return false;
+            snode = it->second;
+            eraseSn(snodePubKey);
+            publishSnodes();
+        }
+        NotifyServiceNode(*snode, ServiceNodeEvent::REMOVED);
         return true;
     }
 
@@ -825,8 +1249,8 @@ protected:
      * @return
      */
     bool hasSn(const CPubKey & snodePubKey) {
-        LOCK(mu);
-        return snodes.count(snodePubKey) > 0;
+        const auto snap = snapshot();
+        return snap->count(snodePubKey) > 0;
     }
 
     /**
@@ -836,11 +1260,9 @@ protected:
      */
     bool seenPacket(const uint256 & hash) {
         LOCK(mu);
-        if (seenPackets.count(hash))
+        if (seenPackets.contains(hash))
             return true; // already seen
-        if (seenPackets.size() > 350000)
-            seenPackets.clear(); // mem mgmt, ~12MB (32bytes * 350k)
-        seenPackets.insert(hash);
+        seenPackets.insert(hash); // the oldest hashes age out of the filter
         return false;
     }
 
@@ -862,20 +1284,97 @@ protected:
      * pointing to the same collateral inputs.
      * @param snode
      */
-    void removeSnWithCollateral(const ServiceNode & snode) {
-        LOCK(mu);
-        std::map<COutPoint, ServiceNodePtr> utxos;
-        for (const auto & item : snodes) {
-            const auto & s = item.second;
-            if (s->getSnodePubKey() != snode.getSnodePubKey()) { // exclude specified snode
-                for (const auto & utxo : s->getCollateral())
-                    utxos[utxo] = s;
-            }
-        }
+    void removeSnWithCollateral(const ServiceNode & snode) EXCLUSIVE_LOCKS_REQUIRED(mu) {
         for (const auto & utxo : snode.getCollateral()) {
-            if (utxos.count(utxo) && snodes.count(utxos[utxo]->getSnodePubKey()))
-                snodes.erase(utxos[utxo]->getSnodePubKey());
+            auto it = snodesByCollateral.find(utxo);
+            if (it != snodesByCollateral.end() && it->second != snode.getSnodePubKey()) // exclude specified snode
+                eraseSn(CPubKey(it->second)); // copy, erasing invalidates the iterator
+        }
+    }
+
+    /**
+     * Adds or replaces the servicenode and indexes its collateral.
+     * @param snode
+     */
+    void insertSn(const ServiceNodeConstPtr & snode) EXCLUSIVE_LOCKS_REQUIRED(mu) {
+        eraseSn(snode->getSnodePubKey());
+        snodes[snode->getSnodePubKey()] = snode;
+        for (const auto & utxo : snode->getCollateral())
+            snodesByCollateral[utxo] = snode->getSnodePubKey();
+    }
+
+    /**
+     * Removes the servicenode and its collateral from the collateral index. Returns false
+     * if the servicenode isn't known.
+     * @param snodePubKey
+     * @return
+     */
+    bool eraseSn(const CPubKey & snodePubKey) EXCLUSIVE_LOCKS_REQUIRED(mu) {
+        auto it = snodes.find(snodePubKey);
+        if (it == snodes.end())
+            return false;
+        for (const auto & utxo : it->second->getCollateral()) {
+            auto cit = snodesByCollateral.find(utxo);
+            if (cit != snodesByCollateral.end() && cit->second == snodePubKey)
+                snodesByCollateral.erase(cit);
+        }
+        snodePings.erase(snodePubKey);
+        snodes.erase(it);
+        return true;
+    }
+
+    /**
+     * Stores the ping as the latest ping of its servicenode.
+     * @param ping
+     */
+    void setPing(const ServiceNodePing & ping) {
+        ServiceNodeConstPtr snode;
+        {
+            LOCK(mu);
+            auto it = snodes.find(ping.getSnodePubKey());
+            if (it == snodes.end())
+                return;
+            snodePings[ping.getSnodePubKey()] = ping;
+            snode = it->second;
+            ++version;
         }
+        NotifyServiceNode(*snode, ServiceNodeEvent::PING);
+    }
+
+    /**
+     * Adds the packet to the validation queue and wakes the servicenode check thread. The
+     * packet is only marked as seen once it is queued, a packet dropped because the queue
+     * is full is accepted again when a peer relays it later. A packet that was seen in the
+     * meantime is skipped.
+     * @param packet
+     * @param hash Hash of the packet
+     * @return false if the queue is full
+     */
+    bool queuePacket(ServiceNodePacket && packet, const uint256 & hash) {
+        {
+            boost::unique_lock<boost::mutex> lock(muqueue);
+            if (packetQueue.size() >= MAX_SNODE_PACKET_QUEUE) {
+                LogPrint(BCLog::SNODE, "servicenode packet queue is full, dropping packet\n");
+                return false;
+            }
+            if (seenPacket(hash))
+                return true;
+            packetQueue.push_back(std::move(packet));
+        }
+        queueCond.notify_one();
+        return true;
+    }
+
+    /**
+     * Publishes a new registry snapshot, must be called once after the servicenodes change.
+     * The servicenodes are shared with the snapshots and never modified, a change replaces
+     * the servicenode with a modified copy.
+     */
+    void publishSnodes() EXCLUSIVE_LOCKS_REQUIRED(mu) {
+        auto snap = std::make_shared<const ServiceNodeMap>(snodes);
+        LOCK(musnap);
+        snodesSnapshot = std::move(snap);
+        ++version;
     }
 
     /**
@@ -916,73 +1415,75 @@ protected:
             return false; // not enough coin for snode
         }
 
-        // Run the algo to determine snode utxo selections
+        // Run the algo to determine snode utxo selections. The purpose of the search
+        // below is to find the combination of the smallest coins required to meet the
+        // collateral, using at most snMaxCollateralCount utxos. This keeps the larger
+        // coins available to the other snodes of the wallet.
+        const CAmount collateralAmount = collateralAmountForTier(tier);
+        const auto maxUtxoCollateralCount = static_cast<size_t>(Params().GetConsensus().snMaxCollateralCount);
 
-        // sort descending
+        // sort ascending
         std::sort(allCoins.begin(), allCoins.end(), [](const COutput & a, const COutput & b) -> bool {
-            return a.GetInputCoin().txout.nValue > b.GetInputCoin().txout.nValue;
+            return a.GetInputCoin().txout.nValue < b.GetInputCoin().txout.nValue;
         });
+        auto smallestCovering = [](std::vector<COutput>::const_iterator first, std::vector<COutput>::const_iterator last,
+                                    const CAmount amount) -> std::vector<COutput>::const_iterator {
+            return std::lower_bound(first, last, amount, [](const COutput & coin, const CAmount & a) -> bool {
+                return coin.GetInputCoin().txout.nValue < a;
+            });
+        };
 
-        int maxUtxoCollateralCount{Params().GetConsensus().snMaxCollateralCount};
-        std::vector<COutput> selected;
-        bool done{false};
+        std::vector<COutPoint> selected;
 
-        while (true) { // use while loop for breaking out of control flow
-            const auto & largest = allCoins[0];
-            selected.push_back(largest);
-            if (largest.GetInputCoin().txout.nValue >= collateralAmountForTier(tier)) {
-                done = true;
-                break;
-            }
+        // Prefer a single coin, the smallest that covers the collateral
+        auto single = smallestCovering(allCoins.begin(), allCoins.end(), collateralAmount);
+        if (single != allCoins.end())
+            selected.push_back(single->GetInputCoin().outpoint);
 
-            if (allCoins.size() == 1) {
-                LogPrint(BCLog::SNODE, "bad service node collateral, not enough coins %s\n", EncodeDestination(dest));
-                return false; // nothing to search
+        // Branch and bound search for a combination that matches the collateral amount
+        if (selected.empty()) {
+            std::vector<OutputGroup> groups;
+            groups.reserve(allCoins.size());
+            for (const auto & coin : allCoins) {
+                if (coin.GetInputCoin().txout.nValue <= 0)
+                    continue;
+                groups.emplace_back(coin.GetInputCoin(), coin.nDepth, true, 0, 0);
+                groups.back().effective_value = coin.GetInputCoin().txout.nValue;
+            }
+            std::set<CInputCoin> bnbCoins;
+            CAmount bnbValue{0};
+            if (SelectCoinsBnB(groups, collateralAmount, COLLATERAL_SEARCH_TOLERANCE, bnbCoins, bnbValue, 0, maxUtxoCollateralCount)) {
+                for (const auto & coin : bnbCoins)
+                    selected.push_back(coin.outpoint);
             }
+        }
 
-            // Conduct search rounds and find most suitable coin selections. The
-            // purpose of the search below is to find combination of the smallest
-            // coins required to meet the collateral. The list is sorted largest
-            // coins first, so we iterate backwards. Search rounds indicate the
-            // maximum number of utxos allowed to be associated with a snode.
+        // Otherwise take the largest coins until the rest of the collateral is covered by a
+        // single coin, then the smallest coin that covers the rest.
+        if (selected.empty()) {
+            auto last = allCoins.cend();
             CAmount running{0};
-            std::set<COutput> runningCoin;
-            std::vector<COutput> searchCoins(allCoins.begin()+1, allCoins.end());
-            for (int k = 0; k < maxUtxoCollateralCount; ++k) {
-                for (int j = static_cast<int>(searchCoins.size()) - 1; j >= 0; --j) {
-                    const auto & next = searchCoins[j];
-                    if (runningCoin.count(next) > 0)
-                        continue; // skip already selected coin
-
-                    if (largest.GetInputCoin().txout.nValue + running + next.GetInputCoin().txout.nValue >= collateralAmountForTier(tier)) {
-                        runningCoin.insert(next);
-                        done = true;
-                        break;
-                    }
-                    if (j == 0) { // store the largest possible value of this search round
-                        running += next.GetInputCoin().txout.nValue;
-                        runningCoin.insert(next);
-                        searchCoins.erase(searchCoins.begin());
-                    }
-                }
-                if (done) {
-                    selected.insert(selected.end(), runningCoin.begin(), runningCoin.end());
+            while (selected.size() < maxUtxoCollateralCount && last != allCoins.cbegin()) {
+                auto it = smallestCovering(allCoins.cbegin(), last, collateralAmount - running);
+                if (it != last) {
+                    selected.push_back(it->GetInputCoin().outpoint);
+                    running = collateralAmount;
                     break;
                 }
+                --last; // largest remaining coin
+                running += last->GetInputCoin().txout.nValue;
+                selected.push_back(last->GetInputCoin().outpoint);
             }
-
-            break;
+            if (running < collateralAmount)
+                selected.clear();
         }
 
-        if (!done) {
+        if (selected.empty()) {
             LogPrint(BCLog::SNODE, "bad service node collateral, not enough coins %s\n", EncodeDestination(dest));
             return false; // failed to find enough coin for snode
         }
 
-        collateral.clear(); collateral.reserve(selected.size());
-        for (const auto & coin : selected)
-            collateral.push_back(coin.GetInputCoin().outpoint);
-
+        collateral = std::move(selected);
         return true;
     }
 
@@ -1032,6 +1533,10 @@ protected:
     }
 
 protected:
+    std::string GetSubscriberName() const override {
+        return "servicenodes";
+    }
+
     void BlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex,
                         const std::vector<CTransactionRef>& txn_conflicted) override
     {
@@ -1039,19 +1544,69 @@ protected:
     }
 
     void BlockDisconnected(const std::shared_ptr<const CBlock>& block) override {
+        int blockNumber{0};
+        {
+            LOCK(cs_main);
+            const auto pindex = LookupBlockIndex(block->GetHash());
+            if (pindex)
+                blockNumber = pindex->nHeight;
+        }
+        undoInvalidations(block->GetHash(), blockNumber);
         processValidationBlock(block, false);
     }
 
+    /**
+     * Restores the servicenodes invalidated by the spends of the disconnected block to their
+     * state before the block, from the invalidations recorded when it was connected.
+     * @param blockHash
+     * @param blockNumber
+     */
+    void undoInvalidations(const uint256 & blockHash, const int & blockNumber) {
+        std::vector<ServiceNodeConstPtr> restored;
+        {
+            LOCK(mu);
+            auto it = invalidations.find(blockNumber);
+            if (it == invalidations.end() || it->second.blockHash != blockHash)
+                return;
+            for (const auto & entry : it->second.snodes) {
+                auto sit = snodes.find(entry.snodePubKey);
+                if (sit == snodes.end() || !sit->second->getInvalid()
+                        || sit->second->getInvalidBlockNumber() != blockNumber)
+                    continue; // changed since
+                auto snode = std::make_shared<ServiceNode>(*sit->second);
+                snode->markInvalid(entry.wasInvalid, entry.invalidBlock);
+                sit->second = snode;
+                if (!entry.wasInvalid)
+                    restored.push_back(snode);
+            }
+            invalidations.erase(it);
+            publishSnodes();
+        }
+        for (const auto & snode : restored)
+            NotifyServiceNode(*snode, ServiceNodeEvent::ADDED);
+    }
+
     void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) override {
         if (fInitialDownload)
             return; // do not try and register snode during initial download
 
+        // Update current block number on snode list, the running state of invalid snodes
+        // depends on the tip
+        {
+            LOCK(mu);
+            for (auto & item : snodes) {
+                if (item.second->getCurrentBlock() == pindexNew->nHeight)
+                    continue;
+                auto snode = std::make_shared<ServiceNode>(*item.second);
+                snode->setCurrentBlock(pindexNew->nHeight);
+                item.second = snode;
+            }
+            publishSnodes();
+        }
+
         std::set<ServiceNodeConfigEntry> copyReregister;
         {
             LOCK(mu);
-            // Update current block number on snode list
-            for (auto & item : snodes)
-                item.second->setCurrentBlock(pindexNew->nHeight);
             // Check if we need to re-register any snodes
             if (reregister.empty())
                 return;
@@ -1091,19 +1646,42 @@ protected:
             }
         }
 
-        // Check that existing snodes are valid
+        // Check that existing snodes are valid, one collateral index lookup per spent utxo
+        std::vector<ServiceNodeConstPtr> invalidated;
         {
             LOCK(mu);
-            for (auto & item : snodes) {
-                auto snode = item.second;
-                for (const auto & collateral : snode->getCollateral()) {
-                    if (spent.count(collateral)) {
-                        snode->markInvalid(true, blockNumber);
-                        break;
-                    }
-                }
+            BlockInvalidations undo;
+            bool changed{false};
+            for (const auto & utxo : spent) {
+                auto it = snodesByCollateral.find(utxo);
+                if (it == snodesByCollateral.end())
+                    continue;
+                auto sit = snodes.find(it->second);
+                if (sit == snodes.end())
+                    continue;
+                auto snode = std::make_shared<ServiceNode>(*sit->second);
+                if (!snode->getInvalid())
+                    invalidated.push_back(snode);
+                if (connected)
+                    undo.snodes.push_back({it->second, snode->getInvalid(), snode->getInvalidBlockNumber()});
+                snode->markInvalid(true, blockNumber);
+                sit->second = snode;
+                changed = true;
+            }
+            if (changed)
+                publishSnodes();
+            // Record the invalidations of the block so that a reorg can undo them
+            if (connected) {
+                invalidations.erase(invalidations.begin(), invalidations.lower_bound(blockNumber - SNODE_UNDO_BLOCKS));
+                if (!undo.snodes.empty()) {
+                    undo.blockHash = block->GetHash();
+                    invalidations[blockNumber] = std::move(undo);
+                } else
+                    invalidations.erase(blockNumber);
             }
         }
+        for (const auto & snode : invalidated)
+            NotifyServiceNode(*snode, ServiceNodeEvent::INVALID);
 
         // Check if any of our snodes have inputs that were spent and/or staked
         std::set<ServiceNodeConfigEntry> entries;
@@ -1132,10 +1710,67 @@ protected:
 
 protected:
     Mutex mu;
-    std::map<CPubKey, ServiceNodePtr> snodes;
-    std::set<uint256> seenPackets;
+    ServiceNodeMap snodes;
+    std::map<COutPoint, CPubKey> snodesByCollateral; // collateral utxo -> snode pubkey
+    std::map<CPubKey, ServiceNodePing> snodePings; // latest ping of each snode
+    struct SnodeInvalidation {
+        CPubKey snodePubKey;
+        bool wasInvalid;
+        int invalidBlock;
+    };
+    struct BlockInvalidations {
+        uint256 blockHash;
+        std::vector<SnodeInvalidation> snodes; // state before the block
+    };
+    std::map<int, BlockInvalidations> invalidations; // by height, the last SNODE_UNDO_BLOCKS blocks
+    std::atomic<int> listHeight{0}; // height of the most recent servicenode list from a peer
+    Mutex musnap; // protects snodesSnapshot only, never held while acquiring mu
+    std::shared_ptr<const ServiceNodeMap> snodesSnapshot{std::make_shared<const ServiceNodeMap>()};
+    std::atomic<uint64_t> version{0}; // see registryVersion()
+    CRollingBloomFilter seenPackets{SNODE_SEEN_PACKETS, 0.000001}; // ~4MB
     std::set<ServiceNodeConfigEntry> snodeEntries;
     std::set<ServiceNodeConfigEntry> reregister;
+    boost::mutex muqueue;
+    boost::condition_variable queueCond;
+    std::deque<ServiceNodePacket> packetQueue; // packets waiting for validation
+};
+
+/**
+ * Result built from the servicenode registry, memoized until the registry version changes or
+ * the result expires, e.g. when one of its servicenodes stops being considered running.
+ * Repeated calls return a copy of the prebuilt result.
+ */
+template <typename T>
+class ServiceNodeListCache {
+public:
+    /**
+     * Returns the cached result, calls build to rebuild it if stale. The builder may lower
+     * expires (unix time, adjusted) to bound the lifetime of the result.
+     * @param build
+     * @return
+     */
+    T get(const std::function<T(int64_t & expires)> & build) {
+        const auto version = ServiceNodeMgr::instance().registryVersion();
+        {
+            LOCK(mu);
+            if (result && version == builtVersion && GetAdjustedTime() < expiresAt)
+                return *result;
+        }
+        int64_t expires = std::numeric_limits<int64_t>::max();
+        auto built = std::make_shared<const T>(build(expires));
+        LOCK(mu);
+        // Registry changes during the build leave a stale version, the next call rebuilds
+        result = built;
+        builtVersion = version;
+        expiresAt = expires;
+        return *built;
+    }
+
+protected:
+    Mutex mu;
+    std::shared_ptr<const T> result GUARDED_BY(mu);
+    uint64_t builtVersion GUARDED_BY(mu){0};
+    int64_t expiresAt GUARDED_BY(mu){0};
 };
 
 }
@@ -0,0 +1,77 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <sigbatch.h>
+
+#include <checkqueue.h>
+#include <util/system.h>
+
+namespace {
+
+/** A check of a CSignatureBatch, stores its result instead of failing the queue */
+class CSignatureCheck
+{
+private:
+    const std::function<bool()>* m_check{nullptr};
+    char* m_result{nullptr};
+
+public:
+    CSignatureCheck() = default;
+    CSignatureCheck(const std::function<bool()>* check, char* result) : m_check(check), m_result(result) {}
+
+    bool operator()()
+    {
+        *m_result = (*m_check)() ? 1 : 0;
+        return true;
+    }
+
+    void swap(CSignatureCheck& check)
+    {
+        std::swap(m_check, check.m_check);
+        std::swap(m_result, check.m_result);
+    }
+};
+
+CCheckQueue<CSignatureCheck> sigcheckqueue(SIGNATURE_CHECK_BATCH_SIZE);
+
+} // namespace
+
+void CSignatureBatch::AddVerify(const CPubKey& pubkey, const uint256& hash, const std::vector<unsigned char>& sig)
+{
+    m_checks.emplace_back([pubkey, hash, sig]() { return pubkey.Verify(hash, sig); });
+}
+
+void CSignatureBatch::AddRecover(const uint256& hash, const std::vector<unsigned char>& sig, CPubKey* pubkeyRet)
+{
+    m_checks.emplace_back([hash, sig, pubkeyRet]() { return pubkeyRet->RecoverCompact(hash, sig); });
+}
+
+void CSignatureBatch::Add(std::function<bool()> check)
+{
+    m_checks.push_back(std::move(check));
+}
+
+std::vector<bool> CSignatureBatch::Verify()
+{
+    std::vector<char> results(m_checks.size(), 0);
+    if (m_checks.size() == 1) {
+        results[0] = m_checks[0]() ? 1 : 0;
+    } else if (!m_checks.empty()) {
+        std::vector<CSignatureCheck> vChecks;
+        vChecks.reserve(m_checks.size());
+        for (size_t i = 0; i < m_checks.size(); ++i)
+            vChecks.emplace_back(&m_checks[i], &results[i]);
+        CCheckQueueControl<CSignatureCheck> control(&sigcheckqueue);
+        control.Add(vChecks);
+        control.Wait();
+    }
+    m_checks.clear();
+    return std::vector<bool>(results.begin(), results.end());
+}
+
+void ThreadSignatureCheck()
+{
+    RenameThread("blocknet-sigch");
+    sigcheckqueue.Thread();
+}
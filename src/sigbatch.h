@@ -0,0 +1,47 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SIGBATCH_H
+#define BITCOIN_SIGBATCH_H
+
+#include <pubkey.h>
+#include <uint256.h>
+
+#include <functional>
+#include <vector>
+
+/** Number of signature checks a signature check thread takes from the queue at once */
+static const unsigned int SIGNATURE_CHECK_BATCH_SIZE = 16;
+
+/**
+ * Collects independent signature checks, e.g. of servicenode pings and registrations, and
+ * runs them on the signature check threads. libsecp256k1 has no ECDSA batch verification,
+ * the checks of a batch are spread over the threads instead. Without signature check
+ * threads the checks run on the calling thread.
+ */
+class CSignatureBatch
+{
+public:
+    /** Checks the DER signature of the hash by the pubkey */
+    void AddVerify(const CPubKey& pubkey, const uint256& hash, const std::vector<unsigned char>& sig);
+    /** Checks that the compact signature of the hash recovers a pubkey, which is stored in *pubkeyRet */
+    void AddRecover(const uint256& hash, const std::vector<unsigned char>& sig, CPubKey* pubkeyRet);
+    /** Adds any other independent check, it must be safe to run concurrently with the other checks */
+    void Add(std::function<bool()> check);
+
+    /** Runs the checks and returns whether each of them passed, in the order they were added.
+     *  The batch is empty afterwards. */
+    std::vector<bool> Verify();
+
+    size_t size() const { return m_checks.size(); }
+    bool empty() const { return m_checks.empty(); }
+
+private:
+    std::vector<std::function<bool()>> m_checks;
+};
+
+/** Run a signature check thread, returns when interrupted */
+void ThreadSignatureCheck();
+
+#endif // BITCOIN_SIGBATCH_H
@@ -0,0 +1,154 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BLOCKNET_SUPPORT_HTTPPOOL_H
+#define BLOCKNET_SUPPORT_HTTPPOOL_H
+
+#include <compat.h>
+#include <support/events.h>
+#include <util/strencodings.h>
+#include <util/time.h>
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <event2/bufferevent.h>
+
+/**
+ * Pool of persistent HTTP/1.1 keep-alive client connections. Each endpoint (host, port
+ * and credentials) keeps its own idle connections, a connection is used by one request
+ * at a time. Every connection has its own event base so that callers on different
+ * threads never share a loop.
+ */
+class HTTPConnectionPool
+{
+public:
+    struct Connection
+    {
+        raii_event_base base; // declared first so that it's freed after the connection
+        raii_evhttp_connection evcon;
+        int64_t lastUsed{0};
+    };
+    typedef std::unique_ptr<Connection> ConnectionPtr;
+
+    /**
+     * @param poolSize Maximum number of idle connections per endpoint
+     * @param idleTimeout Seconds an idle connection is kept open
+     * @param timeout Default request timeout in seconds
+     */
+    HTTPConnectionPool(const size_t poolSize, const int64_t idleTimeout, const int timeout)
+        : poolSize(poolSize), idleTimeout(idleTimeout), timeout(timeout)
+    {}
+
+    /**
+     * Returns an idle connection to the endpoint or opens a new one.
+     * @param reused Set to true if the connection was used before
+     * @param auth Set to the Basic Authorization header of the endpoint
+     * @param requestTimeout Request timeout in seconds, the pool default if not positive
+     */
+    ConnectionPtr acquire(const std::string & host, const int port, const std::string & rpcuser,
+                          const std::string & rpcpasswd, bool & reused, std::string & auth,
+                          const int requestTimeout = 0)
+    {
+        ConnectionPtr conn;
+        {
+            std::lock_guard<std::mutex> l(mu);
+            auto & endpoint = endpoints[endpointKey(host, port, rpcuser, rpcpasswd)];
+            if (endpoint.auth.empty())
+                endpoint.auth = "Basic " + EncodeBase64(rpcuser + ":" + rpcpasswd);
+            auth = endpoint.auth;
+            expire(endpoint);
+            while (!endpoint.idle.empty() && !conn) {
+                conn = std::move(endpoint.idle.back()); // most recently used
+                endpoint.idle.pop_back();
+                if (!isOpen(*conn))
+                    conn.reset(); // closed by the server, nothing was sent on it yet
+            }
+        }
+        reused = conn != nullptr;
+        if (!conn) {
+            conn.reset(new Connection);
+            conn->base = obtain_event_base();
+            conn->evcon = obtain_evhttp_connection_base(conn->base.get(), host, port);
+        }
+        evhttp_connection_set_timeout(conn->evcon.get(), requestTimeout > 0 ? requestTimeout : timeout);
+        return conn;
+    }
+
+    /**
+     * Returns the connection to the pool of idle connections.
+     */
+    void release(const std::string & host, const int port, const std::string & rpcuser,
+                 const std::string & rpcpasswd, ConnectionPtr conn)
+    {
+        conn->lastUsed = GetTime();
+        std::lock_guard<std::mutex> l(mu);
+        auto & endpoint = endpoints[endpointKey(host, port, rpcuser, rpcpasswd)];
+        expire(endpoint);
+        if (endpoint.idle.size() < poolSize)
+            endpoint.idle.push_back(std::move(conn));
+    }
+
+    /**
+     * Closes all idle connections.
+     */
+    void clear()
+    {
+        std::lock_guard<std::mutex> l(mu);
+        endpoints.clear();
+    }
+
+protected:
+    struct Endpoint
+    {
+        std::string auth;
+        std::deque<ConnectionPtr> idle; // oldest first
+    };
+
+    static std::string endpointKey(const std::string & host, const int port,
+                                   const std::string & rpcuser, const std::string & rpcpasswd)
+    {
+        return host + ":" + std::to_string(port) + "@" + rpcuser + ":" + rpcpasswd;
+    }
+
+    /**
+     * Returns false if the server closed the idle connection or sent unexpected data on it.
+     * Checked before a request is sent, so that requests don't have to be retried after
+     * they were sent on a stale connection.
+     */
+    static bool isOpen(Connection & conn)
+    {
+#if LIBEVENT_VERSION_NUMBER >= 0x02010300 && !defined(WIN32)
+        struct bufferevent* bev = evhttp_connection_get_bufferevent(conn.evcon.get());
+        const evutil_socket_t fd = bev ? bufferevent_getfd(bev) : -1;
+        if (fd < 0)
+            return true; // not connected, evhttp connects before the request is sent
+        char c;
+        const ssize_t n = recv(fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+        return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+#else
+        return true;
+#endif
+    }
+
+    void expire(Endpoint & endpoint)
+    {
+        const int64_t cutoff = GetTime() - idleTimeout;
+        while (!endpoint.idle.empty() && endpoint.idle.front()->lastUsed < cutoff)
+            endpoint.idle.pop_front();
+    }
+
+protected:
+    std::mutex mu;
+    std::map<std::string, Endpoint> endpoints;
+    const size_t poolSize;
+    const int64_t idleTimeout;
+    const int timeout;
+};
+
+#endif // BLOCKNET_SUPPORT_HTTPPOOL_H
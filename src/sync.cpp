@@ -9,9 +9,209 @@
 
 #include <stdio.h>
 
+#include <algorithm>
+#include <chrono>
 #include <map>
 #include <memory>
 #include <set>
+#include <tuple>
+
+std::atomic<unsigned int> g_lock_profile_sample{DEFAULT_LOCK_PROFILE_SAMPLE};
+
+//
+// Lock profiler.
+// Each thread records into its own buffer of lock sites, only the owning thread
+// writes the counters of a buffer so they are updated without atomic read-modify-write
+// operations. GetLockStats() reads the buffers of all threads concurrently. The
+// buffer of an exiting thread is merged into the retired stats.
+//
+
+struct LockProfileSite {
+    std::atomic<const char*> file{nullptr}; //!< Set last, a site is in use once file is set
+    const char* name{nullptr};
+    int line{0};
+    std::atomic<uint64_t> contentions{0};
+    std::atomic<uint64_t> wait_ns{0};
+    std::atomic<uint64_t> max_wait_ns{0};
+    std::atomic<uint64_t> samples{0};
+    std::atomic<uint64_t> hold_ns{0};
+    std::atomic<uint64_t> max_hold_ns{0};
+};
+
+static const size_t LOCK_PROFILE_SITES = 512; // power of two
+
+struct LockProfileBuffer {
+    LockProfileSite sites[LOCK_PROFILE_SITES];
+    LockProfileSite overflow; //!< Sites that did not fit into the buffer
+};
+
+struct LockProfiler {
+    std::mutex mutex;
+    std::set<LockProfileBuffer*> buffers;
+    std::map<std::tuple<std::string, int, std::string>, LockStats> retired;
+};
+
+static LockProfiler& GetLockProfiler()
+{
+    // Never destroyed, threads may exit after static destructors ran
+    static LockProfiler* profiler = new LockProfiler;
+    return *profiler;
+}
+
+static void AddSite(std::map<std::tuple<std::string, int, std::string>, LockStats>& stats, const LockProfileSite& site)
+{
+    const char* file = site.file.load(std::memory_order_acquire);
+    if (!file)
+        return;
+    // The same site has a different __FILE__ pointer in each translation unit
+    // that includes it, sites are merged by value.
+    LockStats& s = stats[std::make_tuple(std::string(file), site.line, std::string(site.name))];
+    s.name = site.name;
+    s.file = file;
+    s.line = site.line;
+    s.contentions += site.contentions.load(std::memory_order_relaxed);
+    s.wait_ns += site.wait_ns.load(std::memory_order_relaxed);
+    s.max_wait_ns = std::max(s.max_wait_ns, site.max_wait_ns.load(std::memory_order_relaxed));
+    s.samples += site.samples.load(std::memory_order_relaxed);
+    s.hold_ns += site.hold_ns.load(std::memory_order_relaxed);
+    s.max_hold_ns = std::max(s.max_hold_ns, site.max_hold_ns.load(std::memory_order_relaxed));
+}
+
+static void ResetSite(LockProfileSite& site)
+{
+    site.contentions.store(0, std::memory_order_relaxed);
+    site.wait_ns.store(0, std::memory_order_relaxed);
+    site.max_wait_ns.store(0, std::memory_order_relaxed);
+    site.samples.store(0, std::memory_order_relaxed);
+    site.hold_ns.store(0, std::memory_order_relaxed);
+    site.max_hold_ns.store(0, std::memory_order_relaxed);
+}
+
+struct LockProfileThread {
+    LockProfileBuffer* buffer{nullptr};
+    unsigned int count{0};
+
+    LockProfileBuffer& Buffer()
+    {
+        if (!buffer) {
+            buffer = new LockProfileBuffer;
+            LockProfiler& profiler = GetLockProfiler();
+            std::lock_guard<std::mutex> lock(profiler.mutex);
+            profiler.buffers.insert(buffer);
+        }
+        return *buffer;
+    }
+
+    ~LockProfileThread()
+    {
+        if (!buffer)
+            return;
+        LockProfiler& profiler = GetLockProfiler();
+        {
+            std::lock_guard<std::mutex> lock(profiler.mutex);
+            profiler.buffers.erase(buffer);
+            for (const LockProfileSite& site : buffer->sites)
+                AddSite(profiler.retired, site);
+            AddSite(profiler.retired, buffer->overflow);
+        }
+        delete buffer;
+    }
+};
+
+static thread_local LockProfileThread g_lock_profile_thread;
+
+LockProfileSite* GetLockProfileSite(const char* pszName, const char* pszFile, int nLine)
+{
+    LockProfileBuffer& buffer = g_lock_profile_thread.Buffer();
+    size_t i = (reinterpret_cast<uintptr_t>(pszFile) >> 3) * 31 + static_cast<size_t>(nLine);
+    for (size_t probe = 0; probe < LOCK_PROFILE_SITES; ++probe, ++i) {
+        LockProfileSite& site = buffer.sites[i & (LOCK_PROFILE_SITES - 1)];
+        const char* file = site.file.load(std::memory_order_relaxed);
+        if (file == pszFile && site.line == nLine && site.name == pszName)
+            return &site;
+        if (!file) {
+            site.name = pszName;
+            site.line = nLine;
+            site.file.store(pszFile, std::memory_order_release);
+            return &site;
+        }
+    }
+    if (!buffer.overflow.file.load(std::memory_order_relaxed)) {
+        buffer.overflow.name = "other";
+        buffer.overflow.file.store("other", std::memory_order_release);
+    }
+    return &buffer.overflow;
+}
+
+int64_t LockProfileTime()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool SampleLockHold(unsigned int sample)
+{
+    if (++g_lock_profile_thread.count < sample)
+        return false;
+    g_lock_profile_thread.count = 0;
+    return true;
+}
+
+// Only the thread owning the site writes its counters
+static inline void Add(std::atomic<uint64_t>& counter, uint64_t value)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+static inline void Max(std::atomic<uint64_t>& counter, uint64_t value)
+{
+    if (value > counter.load(std::memory_order_relaxed))
+        counter.store(value, std::memory_order_relaxed);
+}
+
+void RecordLockWait(LockProfileSite* site, int64_t wait_ns)
+{
+    const uint64_t ns = wait_ns > 0 ? wait_ns : 0;
+    Add(site->contentions, 1);
+    Add(site->wait_ns, ns);
+    Max(site->max_wait_ns, ns);
+}
+
+void RecordLockHold(LockProfileSite* site, int64_t hold_ns)
+{
+    const uint64_t ns = hold_ns > 0 ? hold_ns : 0;
+    Add(site->samples, 1);
+    Add(site->hold_ns, ns);
+    Max(site->max_hold_ns, ns);
+}
+
+std::vector<LockStats> GetLockStats()
+{
+    LockProfiler& profiler = GetLockProfiler();
+    std::lock_guard<std::mutex> lock(profiler.mutex);
+    std::map<std::tuple<std::string, int, std::string>, LockStats> stats = profiler.retired;
+    for (const LockProfileBuffer* buffer : profiler.buffers) {
+        for (const LockProfileSite& site : buffer->sites)
+            AddSite(stats, site);
+        AddSite(stats, buffer->overflow);
+    }
+    std::vector<LockStats> result;
+    result.reserve(stats.size());
+    for (const auto& entry : stats)
+        result.push_back(entry.second);
+    return result;
+}
+
+void ResetLockStats()
+{
+    LockProfiler& profiler = GetLockProfiler();
+    std::lock_guard<std::mutex> lock(profiler.mutex);
+    profiler.retired.clear();
+    for (LockProfileBuffer* buffer : profiler.buffers) {
+        for (LockProfileSite& site : buffer->sites)
+            ResetSite(site);
+        ResetSite(buffer->overflow);
+    }
+}
 
 #ifdef DEBUG_LOCKCONTENTION
 #if !defined(HAVE_THREAD_LOCAL)
@@ -8,9 +8,13 @@
 
 #include <threadsafety.h>
 
+#include <atomic>
 #include <condition_variable>
+#include <stdint.h>
+#include <string>
 #include <thread>
 #include <mutex>
+#include <vector>
 
 
 ////////////////////////////////////////////////
@@ -114,22 +118,66 @@ typedef AnnotatedMixin<std::mutex> Mutex;
 void PrintLockContention(const char* pszName, const char* pszFile, int nLine);
 #endif
 
+/**
+ * Lock profiler. Acquisitions that have to wait for the lock are always timed, the
+ * hold time is sampled for 1 in g_lock_profile_sample acquisitions. The stats are
+ * kept per LOCK site in per-thread buffers and merged by GetLockStats(). The hold
+ * time lasts until the end of the lock's scope, it includes condition variable waits.
+ */
+static const unsigned int DEFAULT_LOCK_PROFILE_SAMPLE = 64;
+/** 1 in n acquisitions is sampled for the hold time, 0 disables the lock profiler. */
+extern std::atomic<unsigned int> g_lock_profile_sample;
+
+struct LockProfileSite;
+LockProfileSite* GetLockProfileSite(const char* pszName, const char* pszFile, int nLine);
+int64_t LockProfileTime();
+bool SampleLockHold(unsigned int sample);
+void RecordLockWait(LockProfileSite* site, int64_t wait_ns);
+void RecordLockHold(LockProfileSite* site, int64_t hold_ns);
+
+/** Profiler stats of a LOCK site, over all threads. */
+struct LockStats {
+    std::string name;
+    std::string file;
+    int line{0};
+    uint64_t contentions{0}; //!< Acquisitions that had to wait
+    uint64_t wait_ns{0};     //!< Total time spent waiting
+    uint64_t max_wait_ns{0};
+    uint64_t samples{0};     //!< Acquisitions sampled for the hold time
+    uint64_t hold_ns{0};     //!< Total hold time of the samples
+    uint64_t max_hold_ns{0};
+};
+std::vector<LockStats> GetLockStats();
+void ResetLockStats();
+
 /** Wrapper around std::unique_lock style lock for Mutex. */
 template <typename Mutex, typename Base = typename Mutex::UniqueLock>
 class SCOPED_LOCKABLE UniqueLock : public Base
 {
 private:
+    LockProfileSite* m_profile_site{nullptr};
+    int64_t m_hold_start{0};
+
     void Enter(const char* pszName, const char* pszFile, int nLine)
     {
         EnterCritical(pszName, pszFile, nLine, (void*)(Base::mutex()));
-#ifdef DEBUG_LOCKCONTENTION
+        const unsigned int sample = g_lock_profile_sample.load(std::memory_order_relaxed);
         if (!Base::try_lock()) {
+#ifdef DEBUG_LOCKCONTENTION
             PrintLockContention(pszName, pszFile, nLine);
 #endif
+            if (sample == 0) {
+                Base::lock();
+                return;
+            }
+            const int64_t wait_start = LockProfileTime();
             Base::lock();
-#ifdef DEBUG_LOCKCONTENTION
+            RecordLockWait(GetLockProfileSite(pszName, pszFile, nLine), LockProfileTime() - wait_start);
+        }
+        if (sample != 0 && SampleLockHold(sample)) {
+            m_profile_site = GetLockProfileSite(pszName, pszFile, nLine);
+            m_hold_start = LockProfileTime();
         }
-#endif
     }
 
     bool TryEnter(const char* pszName, const char* pszFile, int nLine)
@@ -163,8 +211,11 @@ public:
 
     ~UniqueLock() UNLOCK_FUNCTION()
     {
-        if (Base::owns_lock())
+        if (Base::owns_lock()) {
+            if (m_profile_site)
+                RecordLockHold(m_profile_site, LockProfileTime() - m_hold_start);
             LeaveCritical();
+        }
     }
 
     operator bool()
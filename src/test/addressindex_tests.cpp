@@ -0,0 +1,91 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/addressindex.h>
+#include <script/sign.h>
+#include <script/standard.h>
+#include <test/test_bitcoin.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(addressindex_tests)
+
+BOOST_FIXTURE_TEST_CASE(addressindex_initial_sync, TestChain100Setup)
+{
+    g_addressindex = MakeUnique<AddressIndex>(1 << 20, true);
+    g_addressindex->Start();
+
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!g_addressindex->BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+
+    // Every coinbase of the setup chain paid to the coinbase key
+    const CScript coinbaseScript = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    std::vector<AddressUnspentEntry> unspent;
+    BOOST_CHECK(g_addressindex->FindUnspent(coinbaseScript, unspent));
+    const size_t coinbase_outputs = unspent.size();
+    BOOST_CHECK(coinbase_outputs >= m_coinbase_txns.size());
+
+    // Spend the first coinbase to a key hash of the same key
+    const CScript scriptPubKey = GetScriptForDestination(coinbaseKey.GetPubKey().GetID());
+    CBasicKeyStore keystore;
+    keystore.AddKey(coinbaseKey);
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    mtx.vin[0] = CTxIn(COutPoint(m_coinbase_txns[0]->GetHash(), 0));
+    mtx.vout.resize(1);
+    mtx.vout[0] = CTxOut(m_coinbase_txns[0]->vout[0].nValue - COIN, scriptPubKey);
+    const CTxOut& prevout = m_coinbase_txns[0]->vout[0];
+    SignatureData sigdata = DataFromTransaction(mtx, 0, prevout);
+    BOOST_CHECK(ProduceSignature(keystore, MutableTransactionSignatureCreator(&mtx, 0, prevout.nValue, SIGHASH_ALL), prevout.scriptPubKey, sigdata));
+    UpdateInput(mtx.vin[0], sigdata);
+    CreateAndProcessBlock({mtx}, scriptPubKey);
+    BOOST_CHECK(g_addressindex->BlockUntilSyncedToCurrentChain());
+
+    int height{0};
+    {
+        LOCK(cs_main);
+        height = chainActive.Height();
+    }
+
+    unspent.clear();
+    BOOST_REQUIRE(g_addressindex->FindUnspent(coinbaseScript, unspent));
+    BOOST_CHECK_EQUAL(unspent.size(), coinbase_outputs - 1);
+    for (const auto& entry : unspent) {
+        BOOST_CHECK(entry.outpoint != mtx.vin[0].prevout);
+    }
+
+    std::vector<AddressHistoryEntry> history;
+    BOOST_REQUIRE(g_addressindex->FindHistory(coinbaseScript, height, history));
+    BOOST_REQUIRE_EQUAL(history.size(), 1u);
+    BOOST_CHECK(history[0].spending);
+    BOOST_CHECK(history[0].txid == mtx.GetHash());
+    BOOST_CHECK_EQUAL(history[0].amount, -prevout.nValue);
+
+    // The new output and the coinbase of the new block
+    unspent.clear();
+    BOOST_REQUIRE(g_addressindex->FindUnspent(scriptPubKey, unspent));
+    bool found{false};
+    for (const auto& entry : unspent) {
+        if (entry.outpoint == COutPoint(mtx.GetHash(), 0)) {
+            found = true;
+            BOOST_CHECK_EQUAL(entry.amount, mtx.vout[0].nValue);
+            BOOST_CHECK_EQUAL(entry.height, height);
+        }
+    }
+    BOOST_CHECK(found);
+
+    g_addressindex->Stop();
+    g_addressindex.reset();
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,174 @@
+// Copyright (c) 2017-2018 The Bitcoin Core developers
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockfilter.h>
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <index/blockfilterindex.h>
+#include <script/standard.h>
+#include <test/test_bitcoin.h>
+#include <undo.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(blockfilter_index_tests)
+
+// Checks the indexed filter, filter hash and filter header of the block against the ones
+// computed from the block and undo data on disk
+static void CheckFilterLookups(BlockFilterIndex& filter_index, const CBlockIndex* block_index,
+                               uint256& last_header)
+{
+    CBlock block;
+    CBlockUndo block_undo;
+    BOOST_REQUIRE(ReadBlockFromDisk(block, block_index, Params().GetConsensus()));
+    if (block_index->nHeight > 0) {
+        BOOST_REQUIRE(UndoReadFromDisk(block_undo, block_index));
+    }
+    const BlockFilter expected_filter(BlockFilterType::BASIC, block, block_undo);
+
+    BlockFilter filter;
+    uint256 filter_header;
+    std::vector<BlockFilter> filters;
+    std::vector<uint256> filter_hashes;
+
+    BOOST_CHECK(filter_index.LookupFilter(block_index, filter));
+    BOOST_CHECK(filter_index.LookupFilterHeader(block_index, filter_header));
+    BOOST_CHECK(filter_index.LookupFilterRange(block_index->nHeight, block_index, filters));
+    BOOST_CHECK(filter_index.LookupFilterHashRange(block_index->nHeight, block_index, filter_hashes));
+
+    BOOST_CHECK_EQUAL(filters.size(), 1U);
+    BOOST_CHECK_EQUAL(filter_hashes.size(), 1U);
+
+    BOOST_CHECK_EQUAL(filter.GetBlockHash(), block_index->GetBlockHash());
+    BOOST_CHECK(filter.GetEncodedFilter() == expected_filter.GetEncodedFilter());
+    BOOST_CHECK_EQUAL(filter.GetHash(), expected_filter.GetHash());
+    BOOST_CHECK_EQUAL(filter_header, expected_filter.ComputeHeader(last_header));
+    if (!filters.empty()) {
+        BOOST_CHECK(filters[0].GetEncodedFilter() == expected_filter.GetEncodedFilter());
+    }
+    if (!filter_hashes.empty()) {
+        BOOST_CHECK_EQUAL(filter_hashes[0], expected_filter.GetHash());
+    }
+
+    last_header = filter_header;
+}
+
+// Checks the filters of the active chain, from genesis to the tip
+static void CheckChainFilters(BlockFilterIndex& filter_index)
+{
+    std::vector<const CBlockIndex*> chain;
+    {
+        LOCK(cs_main);
+        for (const CBlockIndex* block_index = chainActive.Genesis(); block_index; block_index = chainActive.Next(block_index)) {
+            chain.push_back(block_index);
+        }
+    }
+
+    uint256 last_header;
+    for (const CBlockIndex* block_index : chain) {
+        CheckFilterLookups(filter_index, block_index, last_header);
+    }
+
+    // Range lookups over the whole chain match the single lookups
+    std::vector<BlockFilter> filters;
+    std::vector<uint256> filter_hashes;
+    BOOST_CHECK(filter_index.LookupFilterRange(0, chain.back(), filters));
+    BOOST_CHECK(filter_index.LookupFilterHashRange(0, chain.back(), filter_hashes));
+    BOOST_REQUIRE_EQUAL(filters.size(), chain.size());
+    BOOST_REQUIRE_EQUAL(filter_hashes.size(), chain.size());
+    for (size_t i = 0; i < chain.size(); ++i) {
+        BOOST_CHECK_EQUAL(filters[i].GetBlockHash(), chain[i]->GetBlockHash());
+        BOOST_CHECK_EQUAL(filter_hashes[i], filters[i].GetHash());
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(blockfilter_index_initial_sync, TestChain100Setup)
+{
+    BlockFilterIndex filter_index(1 << 20, true);
+
+    const CBlockIndex* tip;
+    {
+        LOCK(cs_main);
+        tip = chainActive.Tip();
+    }
+
+    // Lookups fail before the index is started
+    BlockFilter filter;
+    uint256 filter_header;
+    std::vector<BlockFilter> filters;
+    std::vector<uint256> filter_hashes;
+    BOOST_CHECK(!filter_index.LookupFilter(tip, filter));
+    BOOST_CHECK(!filter_index.LookupFilterHeader(tip, filter_header));
+    BOOST_CHECK(!filter_index.LookupFilterRange(0, tip, filters));
+    BOOST_CHECK(!filter_index.LookupFilterHashRange(0, tip, filter_hashes));
+
+    // BlockUntilSyncedToCurrentChain should return false before the index is started.
+    BOOST_CHECK(!filter_index.BlockUntilSyncedToCurrentChain());
+
+    filter_index.Start();
+
+    // Allow the filter index to catch up with the block index.
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!filter_index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+
+    // The filters of the blocks that were in the chain before the index started
+    CheckChainFilters(filter_index);
+
+    // Invalid ranges fail
+    BOOST_CHECK(!filter_index.LookupFilterRange(-1, tip, filters));
+    BOOST_CHECK(!filter_index.LookupFilterRange(tip->nHeight + 1, tip, filters));
+    BOOST_CHECK(!filter_index.LookupFilterHashRange(-1, tip, filter_hashes));
+
+    // New blocks make it into the index
+    const CScript coinbase_script_pub_key = GetScriptForDestination(coinbaseKey.GetPubKey().GetID());
+    for (int i = 0; i < 10; i++) {
+        CreateAndProcessBlock({}, coinbase_script_pub_key);
+        BOOST_CHECK(filter_index.BlockUntilSyncedToCurrentChain());
+    }
+    CheckChainFilters(filter_index);
+
+    // Replace the last three blocks with a longer branch that pays to other scripts
+    std::vector<const CBlockIndex*> stale_blocks;
+    for (int i = 0; i < 3; ++i) {
+        CBlockIndex* block_index;
+        {
+            LOCK(cs_main);
+            block_index = chainActive.Tip();
+        }
+        stale_blocks.push_back(block_index);
+        CValidationState state;
+        BOOST_REQUIRE(InvalidateBlock(state, Params(), block_index));
+    }
+    const CScript fork_script_pub_key = CScript() << OP_TRUE;
+    for (int i = 0; i < 5; i++) {
+        CreateAndProcessBlock({}, fork_script_pub_key);
+        BOOST_CHECK(filter_index.BlockUntilSyncedToCurrentChain());
+    }
+
+    // The filters of the new branch replace the stale ones, the stale blocks aren't found
+    CheckChainFilters(filter_index);
+    for (const CBlockIndex* block_index : stale_blocks) {
+        BOOST_CHECK(!filter_index.LookupFilter(block_index, filter));
+        BOOST_CHECK(!filter_index.LookupFilterHeader(block_index, filter_header));
+        BOOST_CHECK(!filter_index.LookupFilterRange(0, block_index, filters));
+        BOOST_CHECK(!filter_index.LookupFilterHashRange(0, block_index, filter_hashes));
+    }
+
+    // shutdown sequence (c.f. Shutdown() in init.cpp)
+    filter_index.Stop();
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+
+    // Rest of shutdown sequence and destructors happen in ~TestingSetup()
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,192 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <coins.h>
+#include <consensus/validation.h>
+#include <crypto/muhash.h>
+#include <index/coinstatsindex.h>
+#include <node/coinstats.h>
+#include <script/sign.h>
+#include <script/standard.h>
+#include <test/test_bitcoin.h>
+#include <txdb.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(coinstatsindex_tests)
+
+// Stats of the coins database from a single serial scan, the way they were computed
+// before the scan was split into ranges
+static void ReferenceStats(CCoinsStats& stats)
+{
+    MuHash3072 muhash;
+    std::unique_ptr<CCoinsViewCursor> pcursor(pcoinsdbview->Cursor());
+    stats.hashBlock = pcursor->GetBestBlock();
+    uint256 prevhash;
+    for (; pcursor->Valid(); pcursor->Next()) {
+        COutPoint key;
+        Coin coin;
+        BOOST_REQUIRE(pcursor->GetKey(key) && pcursor->GetValue(coin));
+        if (stats.nTransactionOutputs == 0 || key.hash != prevhash)
+            ++stats.nTransactions;
+        prevhash = key.hash;
+        ApplyCoinHash(muhash, key, coin);
+        ++stats.nTransactionOutputs;
+        stats.nTotalAmount += coin.out.nValue;
+        stats.nBogoSize += GetBogoSize(coin.out.scriptPubKey);
+    }
+    muhash.Finalize(stats.hashSerialized);
+}
+
+static void CheckStatsEqual(const CCoinsStats& stats, const CCoinsStats& expected, const bool check_transactions)
+{
+    BOOST_CHECK_EQUAL(stats.hashBlock, expected.hashBlock);
+    BOOST_CHECK_EQUAL(stats.nTransactionOutputs, expected.nTransactionOutputs);
+    BOOST_CHECK_EQUAL(stats.nTotalAmount, expected.nTotalAmount);
+    BOOST_CHECK_EQUAL(stats.nBogoSize, expected.nBogoSize);
+    if (check_transactions)
+        BOOST_CHECK_EQUAL(stats.nTransactions, expected.nTransactions);
+}
+
+// Spends the coinbase output to two outputs, so blocks also remove coins from the set
+static CMutableTransaction SpendCoinbase(const CTransactionRef& coinbase, const CKey& key)
+{
+    const CScript scriptPubKey = CScript() << ToByteVector(key.GetPubKey()) << OP_CHECKSIG;
+    CMutableTransaction spend;
+    spend.nVersion = 1;
+    spend.vin.resize(1);
+    spend.vin[0].prevout = COutPoint(coinbase->GetHash(), 0);
+    spend.vout.resize(2);
+    spend.vout[0].nValue = coinbase->vout[0].nValue / 2;
+    spend.vout[0].scriptPubKey = scriptPubKey;
+    spend.vout[1].nValue = coinbase->vout[0].nValue / 4;
+    spend.vout[1].scriptPubKey = GetScriptForDestination(key.GetPubKey().GetID());
+
+    std::vector<unsigned char> vchSig;
+    const uint256 hash = SignatureHash(coinbase->vout[0].scriptPubKey, spend, 0, SIGHASH_ALL, 0, SigVersion::BASE);
+    BOOST_CHECK(key.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    spend.vin[0].scriptSig << vchSig;
+    return spend;
+}
+
+BOOST_FIXTURE_TEST_CASE(coinstats_parallel_scan, TestChain100Setup)
+{
+    const CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    CreateAndProcessBlock({SpendCoinbase(m_coinbase_txns[0], coinbaseKey)}, scriptPubKey);
+    FlushStateToDisk();
+
+    CCoinsStats expected;
+    ReferenceStats(expected);
+    BOOST_CHECK(expected.nTransactionOutputs > 0);
+
+    // The coins split into ranges and read in parallel add up to the serial scan
+    CCoinsStats muhash_stats;
+    muhash_stats.hash_type = CoinStatsHashType::MUHASH;
+    BOOST_REQUIRE(GetUTXOStats(pcoinsdbview.get(), muhash_stats));
+    CheckStatsEqual(muhash_stats, expected, true);
+    BOOST_CHECK_EQUAL(muhash_stats.hashSerialized, expected.hashSerialized);
+    BOOST_CHECK_EQUAL(muhash_stats.nHeight, chainActive.Height());
+
+    CCoinsStats none_stats;
+    none_stats.hash_type = CoinStatsHashType::NONE;
+    BOOST_REQUIRE(GetUTXOStats(pcoinsdbview.get(), none_stats));
+    CheckStatsEqual(none_stats, expected, true);
+    BOOST_CHECK(none_stats.hashSerialized.IsNull());
+
+    // The serial scan of the serialized hash counts the same coins
+    CCoinsStats serialized_stats;
+    BOOST_REQUIRE(GetUTXOStats(pcoinsdbview.get(), serialized_stats));
+    CheckStatsEqual(serialized_stats, expected, true);
+    BOOST_CHECK(!serialized_stats.hashSerialized.IsNull());
+    BOOST_CHECK(serialized_stats.hashSerialized != expected.hashSerialized);
+}
+
+BOOST_FIXTURE_TEST_CASE(coinstatsindex_initial_sync, TestChain100Setup)
+{
+    CoinStatsIndex coin_stats_index(1 << 20, true);
+
+    const CBlockIndex* tip;
+    {
+        LOCK(cs_main);
+        tip = chainActive.Tip();
+    }
+
+    // Stats should not be found in the index before it is started.
+    CCoinsStats stats;
+    stats.hash_type = CoinStatsHashType::MUHASH;
+    BOOST_CHECK(!coin_stats_index.LookUpStats(tip, stats));
+
+    // BlockUntilSyncedToCurrentChain should return false before the index is started.
+    BOOST_CHECK(!coin_stats_index.BlockUntilSyncedToCurrentChain());
+
+    coin_stats_index.Start();
+
+    // Allow the index to catch up with the block index.
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!coin_stats_index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+
+    // The index matches a scan of the coins database at the tip
+    auto check_tip = [&]() {
+        FlushStateToDisk();
+        CCoinsStats expected;
+        ReferenceStats(expected);
+        CCoinsStats index_stats;
+        index_stats.hash_type = CoinStatsHashType::MUHASH;
+        BOOST_REQUIRE(coin_stats_index.LookUpStats(chainActive.Tip(), index_stats));
+        BOOST_CHECK(index_stats.from_index);
+        CheckStatsEqual(index_stats, expected, false);
+        BOOST_CHECK_EQUAL(index_stats.hashSerialized, expected.hashSerialized);
+    };
+    check_tip();
+
+    // New blocks, with spends of coinbase outputs, make it into the index
+    const CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    for (int i = 0; i < 3; i++) {
+        CreateAndProcessBlock({SpendCoinbase(m_coinbase_txns[i], coinbaseKey)}, scriptPubKey);
+        BOOST_CHECK(coin_stats_index.BlockUntilSyncedToCurrentChain());
+    }
+    check_tip();
+
+    // Replace the last two blocks with a longer branch, the disconnected spends are taken
+    // out of the running hash
+    std::vector<const CBlockIndex*> stale_blocks;
+    for (int i = 0; i < 2; ++i) {
+        CBlockIndex* block_index;
+        {
+            LOCK(cs_main);
+            block_index = chainActive.Tip();
+        }
+        stale_blocks.push_back(block_index);
+        CValidationState state;
+        BOOST_REQUIRE(InvalidateBlock(state, Params(), block_index));
+    }
+    mempool.clear();
+    const CScript fork_script_pub_key = CScript() << OP_TRUE;
+    CreateAndProcessBlock({SpendCoinbase(m_coinbase_txns[1], coinbaseKey)}, fork_script_pub_key);
+    for (int i = 0; i < 2; i++) {
+        CreateAndProcessBlock({}, fork_script_pub_key);
+        BOOST_CHECK(coin_stats_index.BlockUntilSyncedToCurrentChain());
+    }
+    check_tip();
+    for (const CBlockIndex* block_index : stale_blocks) {
+        BOOST_CHECK(!coin_stats_index.LookUpStats(block_index, stats));
+    }
+
+    // shutdown sequence (c.f. Shutdown() in init.cpp)
+    coin_stats_index.Stop();
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+
+    // Rest of shutdown sequence and destructors happen in ~TestingSetup()
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -4,6 +4,7 @@
 
 #include <crypto/aes.h>
 #include <crypto/chacha20.h>
+#include <crypto/muhash.h>
 #include <crypto/ripemd160.h>
 #include <crypto/sha1.h>
 #include <crypto/sha256.h>
@@ -562,4 +563,105 @@ BOOST_AUTO_TEST_CASE(sha256d64)
     }
 }
 
+BOOST_AUTO_TEST_CASE(sha256d_multi)
+{
+    for (int i = 0; i <= 20; ++i) {
+        std::vector<std::vector<unsigned char>> in(i);
+        std::vector<const unsigned char*> inputs;
+        std::vector<size_t> sizes;
+        for (auto& msg : in) {
+            // Cover messages ending on either side of the padding boundaries
+            msg.resize(InsecureRandRange(200));
+            for (auto& c : msg)
+                c = InsecureRandBits(8);
+            inputs.push_back(msg.data());
+            sizes.push_back(msg.size());
+        }
+        std::vector<unsigned char> out1(32 * i), out2(32 * i);
+        for (int j = 0; j < i; ++j) {
+            CHash256().Write(in[j].data(), in[j].size()).Finalize(out1.data() + 32 * j);
+        }
+        SHA256DMulti(out2.data(), inputs.data(), sizes.data(), i);
+        BOOST_CHECK(out1 == out2);
+    }
+
+    CHashBatch batch(SER_GETHASH, 0);
+    for (int i = 0; i < 10; ++i) {
+        batch << std::string(i * 13, 'a') << i;
+        batch.Next();
+    }
+    const std::vector<uint256> hashes = batch.GetHashes();
+    BOOST_CHECK_EQUAL(hashes.size(), 10U);
+    for (int i = 0; i < 10; ++i) {
+        CHashWriter hw(SER_GETHASH, 0);
+        hw << std::string(i * 13, 'a') << i;
+        BOOST_CHECK(hashes[i] == hw.GetHash());
+    }
+}
+
+static MuHash3072 FromInt(unsigned char i) {
+    unsigned char tmp[32] = {i, 0};
+    return MuHash3072(tmp, sizeof(tmp));
+}
+
+BOOST_AUTO_TEST_CASE(muhash_tests)
+{
+    // The empty set is the number one
+    uint256 empty, expected;
+    unsigned char one[Num3072::BYTE_SIZE] = {1};
+    CSHA256().Write(one, sizeof(one)).Finalize(expected.begin());
+    MuHash3072().Finalize(empty);
+    BOOST_CHECK(empty == expected);
+
+    // The hash doesn't depend on the order of the elements or how the set was put together
+    uint256 res;
+    int table[4];
+    for (int i = 0; i < 4; ++i) {
+        table[i] = InsecureRandBits(3);
+    }
+    for (int order = 0; order < 4; ++order) {
+        MuHash3072 acc;
+        for (int i = 0; i < 4; ++i) {
+            int t = table[i ^ order];
+            if (t & 4) {
+                acc /= FromInt(t & 3);
+            } else {
+                acc *= FromInt(t & 3);
+            }
+        }
+        uint256 out;
+        acc.Finalize(out);
+        if (order == 0) {
+            res = out;
+        } else {
+            BOOST_CHECK(res == out);
+        }
+    }
+
+    unsigned char x[32] = {1}, y[32] = {2};
+    uint256 out, out2;
+    MuHash3072 acc = FromInt(1);
+    acc.Insert(y, sizeof(y)).Remove(x, sizeof(x));
+    acc.Finalize(out);
+    FromInt(2).Finalize(out2);
+    BOOST_CHECK(out == out2);
+
+    MuHash3072 inverse = FromInt(3);
+    inverse /= FromInt(3);
+    inverse.Finalize(out);
+    BOOST_CHECK(out == empty);
+
+    // The state survives serialization without being reduced
+    MuHash3072 state = FromInt(4);
+    state /= FromInt(5);
+    CDataStream ss(SER_DISK, 0);
+    ss << state;
+    BOOST_CHECK_EQUAL(ss.size(), 2 * Num3072::BYTE_SIZE);
+    MuHash3072 state2;
+    ss >> state2;
+    state.Finalize(out);
+    state2.Finalize(out2);
+    BOOST_CHECK(out == out2);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -6,6 +6,7 @@
 #include <script/sigcache.h>
 #include <test/test_bitcoin.h>
 #include <random.h>
+#include <set>
 #include <thread>
 
 /** Test Suite for CuckooCache
@@ -362,4 +363,32 @@ BOOST_AUTO_TEST_CASE(cuckoocache_generations)
     test_cache_generations<CuckooCache::cache<uint256, SignatureCacheHasher>>();
 }
 
+/** for_each visits the elements that were inserted and not erased, inserting
+ * them into a new cache restores it
+ */
+BOOST_AUTO_TEST_CASE(cuckoocache_for_each)
+{
+    SeedInsecureRand(true);
+    CuckooCache::cache<uint256, SignatureCacheHasher> cc{};
+    cc.setup_bytes(1 << 20);
+    std::vector<uint256> inserted;
+    for (int x = 0; x < 1000; ++x) {
+        inserted.push_back(InsecureRand256());
+        cc.insert(inserted.back());
+    }
+    BOOST_CHECK(cc.contains(inserted[0], true)); // erase
+
+    std::set<uint256> visited;
+    cc.for_each([&visited](const uint256& e) { visited.insert(e); });
+    BOOST_CHECK_EQUAL(visited.size(), inserted.size() - 1);
+    BOOST_CHECK(!visited.count(inserted[0]));
+
+    CuckooCache::cache<uint256, SignatureCacheHasher> restored{};
+    restored.setup_bytes(1 << 20);
+    for (const auto& e : visited)
+        restored.insert(e);
+    for (size_t x = 1; x < inserted.size(); ++x)
+        BOOST_CHECK(restored.contains(inserted[x], false));
+}
+
 BOOST_AUTO_TEST_SUITE_END();
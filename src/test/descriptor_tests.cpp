@@ -235,4 +235,43 @@ BOOST_AUTO_TEST_CASE(descriptor_test)
     CheckUnparsable("sh(multi(2,[00000000/111'/222]xprvA1RpRA33e1JQ7ifknakTFpgNXPmW2YvmhqLQYMmrj4xJXXWYpDPS3xz7iAxn8L39njGVyuoseXzU6rcxFLJ8HFsTjSyQbLYnMpCqE2VbFWc,xprv9uPDJpEQgRQfDcW7BkF7eTya6RPxXeJCqCJGHuCJ4GiRVLzkTXBAJMu2qaMWPrS7AANYqdq6vcBcBUdJCVVFceUvJFjaPdGZ2y9WACViL4L/0))#ggssrxfy", "sh(multi(2,[00000000/111'/222]xpub6ERApfZwUNrhLCkDtcHTcxd75RbzS1ed54G1LkBUHQVHQKqhMkhgbmJbZRkrgZw4koxb5JaHWkY4ALHY2grBGRjaDMzQLcgJvLJuZZvRcEL,xpub68NZiKmJWnxxS6aaHmn81bvJeTESw724CRDs6HbuccFQN9Ku14VQrADWgqbhhTHBaohPX4CjNLf9fq9MYo6oDaPPLPxSb7gwQN3ih19Zm4Y/0))#tjq09x4t"); // Error in checksum
 }
 
+BOOST_AUTO_TEST_CASE(descriptor_expandrange)
+{
+    // Unhardened path, and hardened path with an unhardened range
+    const std::vector<std::string> descs{
+        "wpkh([ffffffff/13']xpub69H7F5d8KSRgmmdJg2KhpAK8SR3DjMwAdkxj3ZuxV27CprR9LgpeyGmXUbC6wb7ERfvrnKZjXoUmmDznezpbZb7ap6r1D3tgFxHmwMkQTPH/1/2/*)",
+        "pkh(xprv9s21ZrQH143K31xYSDQpPDxsXRTUcvj2iNHm5NUtrGiGG5e2DtALGdso3pGz6ssrdK4PFmM8NSpSBHNqPqm55Qn3LqFtT2emdEXVYsCzC2U/2147483647'/*)",
+    };
+    for (const auto& str : descs) {
+        FlatSigningProvider keys;
+        auto desc = Parse(str, keys);
+        BOOST_CHECK(desc);
+
+        std::vector<std::vector<CScript>> scripts;
+        std::vector<FlatSigningProvider> out;
+        BOOST_CHECK(ExpandRange(*desc, 0, 299, keys, scripts, out));
+        BOOST_CHECK_EQUAL(scripts.size(), 300);
+        BOOST_CHECK_EQUAL(out.size(), 300);
+
+        // Positions match a descriptor expanded without the cached parent key
+        for (int i : {0, 1, 150, 299}) {
+            FlatSigningProvider fresh_keys, fresh_out;
+            auto fresh = Parse(str, fresh_keys);
+            std::vector<CScript> fresh_scripts;
+            BOOST_CHECK(fresh->Expand(i, fresh_keys, fresh_scripts, fresh_out));
+            BOOST_CHECK(scripts[i] == fresh_scripts);
+            BOOST_CHECK(out[i].pubkeys == fresh_out.pubkeys);
+            BOOST_CHECK(out[i].origins == fresh_out.origins);
+        }
+    }
+
+    // Hardened paths still need the private key once the parent is cached
+    FlatSigningProvider keys;
+    auto desc = Parse(descs[1], keys);
+    std::vector<std::vector<CScript>> scripts;
+    std::vector<FlatSigningProvider> out;
+    BOOST_CHECK(ExpandRange(*desc, 0, 1, keys, scripts, out));
+    BOOST_CHECK(!ExpandRange(*desc, 0, 1, DUMMY_SIGNING_PROVIDER, scripts, out));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
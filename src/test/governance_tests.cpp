@@ -1133,6 +1133,9 @@ BOOST_FIXTURE_TEST_CASE(governance_tests_vote_limits, TestChainPoS)
         BOOST_CHECK_EQUAL(tallyOther.cyes, 250*COIN);
         BOOST_CHECK_EQUAL(tallyOther.cno, 0);
         BOOST_CHECK_EQUAL(tallyOther.cabstain, 0);
+        auto cachedOther = gov::Governance::instance().getTally(proposal.getHash(), consensus);
+        BOOST_CHECK_EQUAL(cachedOther.yes, tallyOther.yes);
+        BOOST_CHECK_EQUAL(cachedOther.cyes, tallyOther.cyes);
 
         // Submit the votes for the current wallet
         std::vector<CTransactionRef> txns;
@@ -1142,6 +1145,18 @@ BOOST_FIXTURE_TEST_CASE(governance_tests_vote_limits, TestChainPoS)
         BOOST_CHECK_MESSAGE(txns.size() == 3, strprintf("Expected %d transactions, instead have %d on tally test", 3, txns.size()));
         StakeBlocks(1), SyncWithValidationInterfaceQueue();
         auto tally = gov::Governance::getTally(proposal.getHash(), gov::Governance::instance().getVotes(), consensus);
+        // Cached tally must be refreshed by the new votes
+        auto cached = gov::Governance::instance().getTally(proposal.getHash(), consensus);
+        BOOST_CHECK_EQUAL(cached.yes, tally.yes);
+        BOOST_CHECK_EQUAL(cached.no, tally.no);
+        BOOST_CHECK_EQUAL(cached.cyes, tally.cyes);
+        {
+            const auto allVotes = gov::Governance::instance().getVotes();
+            const auto proposalVotes = std::count_if(allVotes.begin(), allVotes.end(), [&proposal](const gov::Vote & vote) {
+                return vote.getProposal() == proposal.getHash();
+            });
+            BOOST_CHECK_EQUAL(gov::Governance::instance().getVotes(proposal.getHash()).size(), static_cast<size_t>(proposalVotes));
+        }
         CBlock block;
         BOOST_CHECK(ReadBlockFromDisk(block, chainActive.Tip(), consensus));
         std::set<gov::Proposal> ps;
@@ -1697,6 +1712,17 @@ BOOST_AUTO_TEST_CASE(governance_tests_superblockstakes)
                 auto blocktemplate = BlockAssembler(*params).CreateNewBlockPoS(*stake.coin, stake.hashBlock, stake.time, stake.wallet.get(), true);
                 BOOST_CHECK_MESSAGE(blocktemplate != nullptr, "CreateNewBlockPoS failed, superblock stake test");
                 const auto & results = gov::Governance::instance().getSuperblockResults(superblock, consensus);
+                BOOST_CHECK_MESSAGE(!results.empty(), "Superblock results should be precomputed after the voting cutoff");
+                // Cached superblock results must match a fresh tally
+                std::vector<gov::Proposal> sbproposals;
+                std::vector<gov::Vote> sbvotes;
+                gov::Governance::instance().getProposalsForSuperblock(superblock, sbproposals, sbvotes);
+                for (const auto & result : results) {
+                    const auto tally = gov::Governance::getTally(result.first.getHash(), sbvotes, consensus);
+                    BOOST_CHECK_EQUAL(result.second.yes, tally.yes);
+                    BOOST_CHECK_EQUAL(result.second.no, tally.no);
+                    BOOST_CHECK_EQUAL(result.second.abstain, tally.abstain);
+                }
                 const auto & payees = gov::Governance::getSuperblockPayees(superblock, results, consensus);
                 BOOST_CHECK_MESSAGE(applySuperblockPayees(pos, blocktemplate.get(), stake, payees, consensus), "Failed to create a valid PoS block for the superblock payee test");
                 auto block = std::make_shared<const CBlock>(blocktemplate->block);
@@ -1977,6 +2003,71 @@ BOOST_AUTO_TEST_CASE(governance_tests_loadgovernancedata2)
             }
         }
         BOOST_CHECK_MESSAGE(gvotes.size() == expecting, strprintf("Failed to load governance data votes, found %d expected %d", gvotes.size(), expecting));
+
+        // Votes read before their proposal, as by a loader shard ahead of the shard
+        // with the proposal, are added once the proposal is read
+        {
+            struct LoaderGovernance : public gov::Governance {
+                using gov::Governance::processBlock;
+            } gov;
+            for (int i = chainActive.Height(); i >= std::max(consensus.governanceBlock, 1); --i) {
+                CBlock block;
+                BOOST_CHECK(ReadBlockFromDisk(block, chainActive[i], consensus));
+                gov.processBlock(&block, chainActive[i], consensus, false);
+            }
+            BOOST_CHECK_EQUAL(gov.getProposals().size(), 2);
+            for (const auto & vote : gvotes)
+                BOOST_CHECK(gov.hasVote(vote.getHash()));
+        }
+
+        // Check that governance data resumes from a checkpoint
+        BOOST_CHECK(gov::Governance::instance().openCheckpoint(1 << 20, true, true));
+        const auto gprops = gov::Governance::instance().getProposals();
+        BOOST_CHECK(gov::Governance::instance().writeCheckpoint(chainActive.Tip()));
+        const auto checkpointTip = chainActive.Height();
+        pos.StakeBlocks(1), SyncWithValidationInterfaceQueue();
+        gov::Governance::instance().reset();
+        failReason.clear();
+        BOOST_CHECK_MESSAGE(gov::Governance::instance().loadGovernanceData(chainActive, cs_main, consensus, failReason), "Failed to load governance data from the checkpoint");
+        BOOST_CHECK_MESSAGE(failReason.empty(), "loadGovernanceData fail reason should be empty");
+        {
+            int height{0};
+            uint256 hash;
+            std::map<uint256, gov::Proposal> cps;
+            std::map<uint256, gov::Vote> cvs;
+            BOOST_CHECK(gov::Governance::instance().readCheckpoint(height, hash, cps, cvs));
+            BOOST_CHECK_EQUAL(height, checkpointTip);
+            BOOST_CHECK(hash == chainActive[checkpointTip]->GetBlockHash());
+            BOOST_CHECK_EQUAL(cps.size(), gprops.size());
+        }
+        {
+            // The block after the checkpoint was replayed from the archive
+            gov::GovernanceBlockRecord record;
+            BOOST_CHECK(gov::Governance::instance().readBlockRecord(checkpointTip + 1, record));
+            BOOST_CHECK(record.blockHash == chainActive[checkpointTip + 1]->GetBlockHash());
+            BOOST_CHECK(!gov::Governance::instance().readBlockRecord(checkpointTip + 2, record));
+        }
+        const auto cpprops = gov::Governance::instance().getProposals();
+        const auto cpvotes = gov::Governance::instance().getVotes();
+        BOOST_CHECK_EQUAL(cpprops.size(), gprops.size());
+        BOOST_CHECK_EQUAL(cpvotes.size(), gvotes.size());
+        for (const auto & vote : gvotes) {
+            const auto cpvote = gov::Governance::instance().getVote(vote.getHash());
+            BOOST_CHECK(cpvote.getHash() == vote.getHash());
+            BOOST_CHECK(cpvote.getKeyID() == vote.getKeyID());
+            BOOST_CHECK_EQUAL(cpvote.getAmount(), vote.getAmount());
+            BOOST_CHECK_EQUAL(cpvote.getBlockNumber(), vote.getBlockNumber());
+            BOOST_CHECK(cpvote.isValid(consensus));
+        }
+        // Verified vote keys are cached
+        for (const auto & vote : gvotes) {
+            gov::VoteKey key;
+            BOOST_CHECK(gov::GetCachedVoteKey(vote.keyCacheEntry(), key));
+            BOOST_CHECK(key.keyid == vote.getKeyID());
+            BOOST_CHECK(key.pubkey == vote.getPubKey());
+            BOOST_CHECK_EQUAL(key.amount, vote.getAmount());
+        }
+        gov::Governance::instance().closeCheckpoint();
     }
 
     cleanup(resetBlocks);
@@ -2267,6 +2358,35 @@ BOOST_AUTO_TEST_CASE(governance_tests_rpc)
             BOOST_CHECK_EQUAL(find_value(p, "votes_abstain").get_int(), tally.abstain);
         }
 
+        // Filters and pages
+        {
+            UniValue fparams(UniValue::VARR);
+            fparams.push_backV({ 0, nextSB, "all", "Test proposal", 1 });
+            UniValue page;
+            BOOST_CHECK_NO_THROW(page = CallRPC2("listproposals", fparams));
+            BOOST_CHECK_EQUAL(page.size(), 1);
+            const auto firstHash = find_value(page[0].get_obj(), "hash").get_str();
+            BOOST_CHECK_EQUAL(firstHash, proposal.getHash().ToString());
+            fparams.push_back(firstHash);
+            BOOST_CHECK_NO_THROW(page = CallRPC2("listproposals", fparams));
+            BOOST_CHECK_EQUAL(page.size(), 0); // only one proposal
+        }
+        {
+            UniValue fparams(UniValue::VARR);
+            fparams.push_backV({ 0, 0, "all", "Other proposal" });
+            BOOST_CHECK_EQUAL(CallRPC2("listproposals", fparams).size(), 0);
+        }
+        {
+            UniValue fparams(UniValue::VARR);
+            fparams.push_backV({ 0, 0, "bad status" });
+            BOOST_CHECK_THROW(CallRPC2("listproposals", fparams), std::runtime_error);
+        }
+        {
+            UniValue fparams(UniValue::VARR);
+            fparams.push_backV({ 0, 0, "all", "", 0, uint256S("1").ToString() });
+            BOOST_CHECK_THROW(CallRPC2("listproposals", fparams), std::runtime_error); // unknown proposal
+        }
+
         cleanup(resetBlocks, pos.wallet.get());
     }
 
@@ -2282,4 +2402,100 @@ BOOST_AUTO_TEST_CASE(governance_tests_rpc)
     UnregisterValidationInterface(&gov::Governance::instance());
 }
 
+BOOST_FIXTURE_TEST_CASE(governance_tests_payload, BasicTestingSetup)
+{
+    gov::Proposal proposal("Test proposal", 43200, 250 * COIN, "y7gbL6vX6QT5jhsGeQLyha1M2b9YYocM7k",
+                           "https://forum.blocknet.co", "Short description");
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << proposal;
+    const auto data = ToByteVector(ss);
+    Span<const unsigned char> payload;
+
+    // Governance data is found without copying the script
+    const CScript script = CScript() << OP_RETURN << data;
+    BOOST_CHECK(gov::GetGovernancePayload(script, payload));
+    BOOST_CHECK(payload == MakeSpan(data));
+    BOOST_CHECK(payload.data() >= script.data() && payload.end() <= script.data() + script.size());
+    gov::Proposal decoded;
+    SpanReader reader(SER_NETWORK, PROTOCOL_VERSION, payload);
+    reader >> decoded;
+    BOOST_CHECK(decoded.getHash() == proposal.getHash());
+    BOOST_CHECK(reader.empty());
+
+    // Empty pushes prior to the governance data are skipped
+    BOOST_CHECK(gov::GetGovernancePayload(CScript() << OP_RETURN << OP_0 << data, payload));
+    BOOST_CHECK(payload == MakeSpan(data));
+
+    // Non-governance scripts are rejected
+    BOOST_CHECK(!gov::GetGovernancePayload(CScript(), payload));
+    BOOST_CHECK(!gov::GetGovernancePayload(CScript() << OP_RETURN, payload));
+    BOOST_CHECK(!gov::GetGovernancePayload(CScript() << OP_TRUE << data, payload));
+    BOOST_CHECK(!gov::GetGovernancePayload(CScript() << OP_RETURN << ParseHex("deadbeef") << data, payload));
+    std::vector<unsigned char> badVersion = data;
+    badVersion[0] = gov::NETWORK_VERSION + 1;
+    BOOST_CHECK(!gov::GetGovernancePayload(CScript() << OP_RETURN << badVersion, payload));
+    std::vector<unsigned char> badType = data;
+    badType[1] = gov::NONE;
+    BOOST_CHECK(!gov::GetGovernancePayload(CScript() << OP_RETURN << badType, payload));
+
+    // Truncated pushes are rejected
+    CScript truncated = script;
+    truncated.resize(truncated.size() - 1);
+    BOOST_CHECK(!gov::GetGovernancePayload(truncated, payload));
+}
+
+BOOST_FIXTURE_TEST_CASE(governance_tests_votestore, BasicTestingSetup)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    const auto proposal = GetRandHash();
+    const COutPoint utxo(GetRandHash(), 1);
+    gov::Vote vote(proposal, gov::YES, utxo, gov::makeVinHash(COutPoint(GetRandHash(), 0)));
+    gov::VoteStore store;
+
+    // Votes without a compact signature can't be stored
+    BOOST_CHECK(!store.set(vote));
+    BOOST_CHECK(store.empty());
+
+    BOOST_CHECK(vote.sign(key));
+    BOOST_CHECK(store.set(vote));
+    BOOST_CHECK(store.contains(vote.getHash()));
+    BOOST_CHECK_EQUAL(store.size(), 1);
+    gov::Vote decoded;
+    BOOST_CHECK(store.get(vote.getHash(), decoded));
+    BOOST_CHECK(decoded.getHash() == vote.getHash());
+    BOOST_CHECK(decoded.sigHash() == vote.sigHash());
+    BOOST_CHECK(decoded.getSignature() == vote.getSignature());
+    BOOST_CHECK(decoded.getPubKey() == key.GetPubKey());
+    BOOST_CHECK(decoded.getUtxo() == utxo);
+    BOOST_CHECK(decoded.getVinHash() == vote.getVinHash());
+    BOOST_CHECK(store.getProposal(vote.getHash()) == proposal);
+
+    // Spent state is updated in place
+    const auto spentHash = GetRandHash();
+    store.spend(vote.getHash(), 10, spentHash);
+    BOOST_CHECK(store.spent(vote.getHash()));
+    BOOST_CHECK(!store.unspend(vote.getHash(), 11, spentHash));
+    BOOST_CHECK(store.unspend(vote.getHash(), 10, spentHash));
+    BOOST_CHECK(!store.spent(vote.getHash()));
+
+    // Changed votes replace the stored vote
+    gov::Vote changed(proposal, gov::NO, utxo, vote.getVinHash());
+    BOOST_CHECK(changed.sign(key));
+    BOOST_CHECK(store.set(changed));
+    BOOST_CHECK_EQUAL(store.size(), 1);
+    BOOST_CHECK(store.get(vote.getHash(), decoded));
+    BOOST_CHECK(decoded.getVote() == gov::NO);
+
+    BOOST_CHECK(store.DynamicMemoryUsage() > 0);
+    store.erase(vote.getHash());
+    BOOST_CHECK(!store.contains(vote.getHash()));
+    gov::Vote other(proposal, gov::YES, COutPoint(GetRandHash(), 0), vote.getVinHash());
+    BOOST_CHECK(other.sign(key));
+    BOOST_CHECK(store.set(other));
+    BOOST_CHECK_EQUAL(store.all().size(), 1);
+    store.clear();
+    BOOST_CHECK(store.empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
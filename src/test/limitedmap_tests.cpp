@@ -96,6 +96,18 @@ BOOST_AUTO_TEST_CASE(limitedmap_test)
 
     // check that the map is now empty
     BOOST_CHECK(map.empty());
+
+    // clear a full map and check that it can be filled again
+    for (int i = 0; i < 20; i++) {
+        map.insert(std::make_pair(i, i + 1));
+    }
+    map.clear();
+    BOOST_CHECK(map.empty());
+    for (int i = 0; i < 10; i++) {
+        map.insert(std::make_pair(i, i + 1));
+    }
+    BOOST_CHECK(map.size() == 10);
+    BOOST_CHECK(map.max_size() == 10);
 }
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,39 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <metrics.h>
+
+#include <test/test_bitcoin.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(metrics_tests, BasicTestingSetup)
+
+static metrics::Counter g_test_counter{"test_counter_total", "Test counter"};
+static metrics::Histogram g_test_histogram{"test_duration_seconds", "Test histogram"};
+
+BOOST_AUTO_TEST_CASE(render)
+{
+    g_test_counter.Inc();
+    g_test_counter.Inc(2);
+    BOOST_CHECK_EQUAL(g_test_counter.Get(), 3U);
+
+    g_test_histogram.Observe(0);
+    g_test_histogram.Observe(3);
+    g_test_histogram.Observe(1000000);
+
+    const std::string out = metrics::Render();
+    BOOST_CHECK(out.find("# HELP test_counter_total Test counter\n# TYPE test_counter_total counter\ntest_counter_total 3\n") != std::string::npos);
+    BOOST_CHECK(out.find("# TYPE test_duration_seconds histogram\n") != std::string::npos);
+    // 0us is below the first bound of 1us, 3us below 4us, 1s below 2^20us
+    BOOST_CHECK(out.find("test_duration_seconds_bucket{le=\"0.000001\"} 1\n") != std::string::npos);
+    BOOST_CHECK(out.find("test_duration_seconds_bucket{le=\"0.000002\"} 1\n") != std::string::npos);
+    BOOST_CHECK(out.find("test_duration_seconds_bucket{le=\"0.000004\"} 2\n") != std::string::npos);
+    BOOST_CHECK(out.find("test_duration_seconds_bucket{le=\"1.048576\"} 3\n") != std::string::npos);
+    BOOST_CHECK(out.find("test_duration_seconds_bucket{le=\"+Inf\"} 3\n") != std::string::npos);
+    BOOST_CHECK(out.find("test_duration_seconds_sum 1.000003\n") != std::string::npos);
+    BOOST_CHECK(out.find("test_duration_seconds_count 3\n") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
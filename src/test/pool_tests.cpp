@@ -0,0 +1,163 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <support/allocators/pool.h>
+
+#include <test/test_bitcoin.h>
+
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(pool_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(pool_free_list_reuse)
+{
+    PoolResource<128, 8> resource(1024);
+
+    // A freed block is handed out again for the same size class
+    void* block = resource.Allocate(8, 8);
+    resource.Deallocate(block, 8, 8);
+    BOOST_CHECK(resource.Allocate(8, 8) == block);
+
+    // Sizes are rounded up to the alignment, 5 and 8 bytes share a free list
+    void* small = resource.Allocate(5, 1);
+    resource.Deallocate(small, 5, 1);
+    BOOST_CHECK(resource.Allocate(8, 8) == small);
+
+    // Other size classes don't take blocks from that free list
+    void* other = resource.Allocate(8, 8);
+    resource.Deallocate(other, 8, 8);
+    void* bigger = resource.Allocate(16, 8);
+    BOOST_CHECK(bigger != other);
+    BOOST_CHECK(resource.Allocate(8, 8) == other);
+
+    // Freed blocks come back in reverse order
+    std::vector<void*> blocks;
+    for (int i = 0; i < 10; ++i)
+        blocks.push_back(resource.Allocate(24, 8));
+    for (void* p : blocks)
+        resource.Deallocate(p, 24, 8);
+    for (auto it = blocks.rbegin(); it != blocks.rend(); ++it)
+        BOOST_CHECK(resource.Allocate(24, 8) == *it);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+}
+
+BOOST_AUTO_TEST_CASE(pool_chunk_exhaustion)
+{
+    PoolResource<128, 8> resource(256);
+    BOOST_CHECK_EQUAL(resource.ChunkSizeBytes(), 256U);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 0U);
+
+    // Ten 24 byte blocks fill 240 bytes of the first chunk
+    char* first = static_cast<char*>(resource.Allocate(24, 8));
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+    for (int i = 1; i < 10; ++i)
+        BOOST_CHECK(resource.Allocate(24, 8) == first + i * 24);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+
+    // The next block doesn't fit, a new chunk is allocated
+    char* second = static_cast<char*>(resource.Allocate(24, 8));
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 2U);
+    BOOST_CHECK(second < first || second >= first + 256);
+
+    // The rest of the first chunk is kept in the free list of its size
+    BOOST_CHECK(resource.Allocate(16, 8) == first + 240);
+    BOOST_CHECK(resource.Allocate(24, 8) == second + 24);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 2U);
+
+    // Chunk sizes are rounded up to the alignment
+    PoolResource<128, 8> rounded(100);
+    BOOST_CHECK_EQUAL(rounded.ChunkSizeBytes(), 104U);
+}
+
+BOOST_AUTO_TEST_CASE(pool_fallback)
+{
+    PoolResource<128, 8> resource(1024);
+
+    // Blocks bigger than the maximum block size don't use the pool
+    void* big = resource.Allocate(129, 8);
+    BOOST_CHECK(big != nullptr);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 0U);
+    resource.Deallocate(big, 129, 8);
+
+    // Neither do blocks that need a stricter alignment than the pool's
+    void* aligned = resource.Allocate(16, 16);
+    BOOST_CHECK(aligned != nullptr);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 0U);
+    resource.Deallocate(aligned, 16, 16);
+
+    // The maximum block size itself is served from the pool
+    void* max = resource.Allocate(128, 8);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+    resource.Deallocate(max, 128, 8);
+    BOOST_CHECK(resource.Allocate(128, 8) == max);
+
+    // Zero byte allocations get a block of their own
+    void* empty1 = resource.Allocate(0, 1);
+    void* empty2 = resource.Allocate(0, 1);
+    BOOST_CHECK(empty1 != empty2);
+
+    // Without a resource the allocator uses operator new
+    PoolAllocator<uint64_t, 128, 8> allocator;
+    BOOST_CHECK(allocator.resource() == nullptr);
+    uint64_t* values = allocator.allocate(4);
+    values[3] = 42;
+    allocator.deallocate(values, 4);
+}
+
+BOOST_AUTO_TEST_CASE(pool_alignment)
+{
+    PoolResource<256, 16> resource(1000);
+    BOOST_CHECK_EQUAL(resource.ChunkSizeBytes() % 16, 0U);
+
+    // Blocks of all sizes, across several chunks, are aligned to the pool alignment
+    std::vector<std::pair<void*, std::size_t>> blocks;
+    for (int i = 0; i < 500; ++i) {
+        const std::size_t bytes = InsecureRandRange(257);
+        void* p = resource.Allocate(bytes, 1U << InsecureRandRange(5));
+        BOOST_CHECK_EQUAL(reinterpret_cast<std::uintptr_t>(p) % 16, 0U);
+        blocks.emplace_back(p, bytes);
+    }
+    BOOST_CHECK(resource.NumAllocatedChunks() > 1);
+    for (const auto& block : blocks)
+        resource.Deallocate(block.first, block.second, 1);
+    for (const auto& block : blocks) {
+        void* p = resource.Allocate(block.second, 8);
+        BOOST_CHECK_EQUAL(reinterpret_cast<std::uintptr_t>(p) % 16, 0U);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(pool_unordered_map)
+{
+    using Map = std::unordered_map<uint64_t, uint64_t, std::hash<uint64_t>, std::equal_to<uint64_t>,
+                                   PoolAllocator<std::pair<const uint64_t, uint64_t>, 64, alignof(void*)>>;
+    Map::allocator_type::ResourceType resource(4096);
+    std::map<uint64_t, uint64_t> reference;
+    {
+        Map map{0, Map::hasher{}, Map::key_equal{}, Map::allocator_type{&resource}};
+        for (int i = 0; i < 20000; ++i) {
+            const uint64_t key = InsecureRandRange(2000);
+            if (InsecureRandBool()) {
+                map[key] = i;
+                reference[key] = i;
+            } else {
+                BOOST_CHECK_EQUAL(map.erase(key), reference.erase(key));
+            }
+        }
+        BOOST_CHECK_EQUAL(map.size(), reference.size());
+        for (const auto& entry : reference) {
+            auto it = map.find(entry.first);
+            BOOST_REQUIRE(it != map.end());
+            BOOST_CHECK_EQUAL(it->second, entry.second);
+        }
+    }
+    // Erased nodes were reused, the live nodes fit in a few chunks
+    BOOST_CHECK(resource.NumAllocatedChunks() * 4096 < 2000 * 64 * 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -420,4 +420,40 @@ BOOST_AUTO_TEST_CASE(rpc_getblockstats_calculate_percentiles_by_weight)
     }
 }
 
+BOOST_AUTO_TEST_CASE(rpc_json_write)
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("hash", "00ff");
+    obj.pushKV("esc\"aped", "line\nbreak");
+    obj.pushKV("height", 12);
+    obj.pushKV("amount", ValueFromAmount(123456789));
+    obj.pushKV("flag", true);
+    obj.pushKV("empty", UniValue(UniValue::VARR));
+    UniValue txs(UniValue::VARR);
+    for (int i = 0; i < 5000; ++i) { // spans several pieces
+        UniValue tx(UniValue::VOBJ);
+        tx.pushKV("txid", strprintf("%064x", i));
+        tx.pushKV("vin", UniValue(UniValue::VARR));
+        tx.pushKV("n", NullUniValue);
+        txs.push_back(tx);
+    }
+    obj.pushKV("tx", txs);
+
+    std::string written;
+    int pieces{0};
+    auto sink = [&](const char* data, size_t size) { written.append(data, size); ++pieces; };
+    JSONWrite(obj, sink);
+    BOOST_CHECK_EQUAL(written, obj.write());
+    BOOST_CHECK(pieces > 1);
+
+    const UniValue id("1");
+    written.clear();
+    JSONRPCReplyWrite(obj, NullUniValue, id, sink);
+    BOOST_CHECK_EQUAL(written, JSONRPCReply(obj, NullUniValue, id));
+    written.clear();
+    const UniValue error = JSONRPCError(RPC_MISC_ERROR, "error");
+    JSONRPCReplyWrite(obj, error, id, sink);
+    BOOST_CHECK_EQUAL(written, JSONRPCReply(obj, error, id));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -3,13 +3,18 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <test/data/script_tests.json.h>
+#include <test/data/tx_invalid.json.h>
+#include <test/data/tx_valid.json.h>
 
 #include <core_io.h>
+#include <crypto/sha256.h>
 #include <key.h>
 #include <keystore.h>
+#include <policy/policy.h>
 #include <script/script.h>
 #include <script/script_error.h>
 #include <script/sign.h>
+#include <script/standard.h>
 #include <util/system.h>
 #include <util/strencodings.h>
 #include <test/test_bitcoin.h>
@@ -1662,4 +1667,406 @@ BOOST_AUTO_TEST_CASE(bitcoinconsensus_verify_script_invalid_flags)
 }
 
 #endif
+
+// VerifyScript as it was before the standard templates were verified without the interpreter
+// and before it evaluated on inline stacks: every script is evaluated by EvalScript on
+// std::vector stacks. Used to check that both give the same results and script errors.
+static bool ReferenceSetError(ScriptError* serror, const ScriptError serr)
+{
+    if (serror)
+        *serror = serr;
+    return serr == SCRIPT_ERR_OK;
+}
+
+static bool ReferenceCastToBool(const std::vector<unsigned char>& vch)
+{
+    for (unsigned int i = 0; i < vch.size(); i++) {
+        if (vch[i] != 0)
+            return !(i == vch.size() - 1 && vch[i] == 0x80); // can be negative zero
+    }
+    return false;
+}
+
+static bool ReferenceVerifyWitnessProgram(const CScriptWitness& witness, int witversion, const std::vector<unsigned char>& program, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror)
+{
+    std::vector<std::vector<unsigned char> > stack;
+    CScript scriptPubKey;
+
+    if (witversion == 0) {
+        if (program.size() == WITNESS_V0_SCRIPTHASH_SIZE) {
+            if (witness.stack.size() == 0)
+                return ReferenceSetError(serror, SCRIPT_ERR_WITNESS_PROGRAM_WITNESS_EMPTY);
+            scriptPubKey = CScript(witness.stack.back().begin(), witness.stack.back().end());
+            stack = std::vector<std::vector<unsigned char> >(witness.stack.begin(), witness.stack.end() - 1);
+            uint256 hashScriptPubKey;
+            CSHA256().Write(scriptPubKey.data(), scriptPubKey.size()).Finalize(hashScriptPubKey.begin());
+            if (memcmp(hashScriptPubKey.begin(), program.data(), 32))
+                return ReferenceSetError(serror, SCRIPT_ERR_WITNESS_PROGRAM_MISMATCH);
+        } else if (program.size() == WITNESS_V0_KEYHASH_SIZE) {
+            if (witness.stack.size() != 2)
+                return ReferenceSetError(serror, SCRIPT_ERR_WITNESS_PROGRAM_MISMATCH);
+            scriptPubKey << OP_DUP << OP_HASH160 << program << OP_EQUALVERIFY << OP_CHECKSIG;
+            stack = witness.stack;
+        } else {
+            return ReferenceSetError(serror, SCRIPT_ERR_WITNESS_PROGRAM_WRONG_LENGTH);
+        }
+    } else if (flags & SCRIPT_VERIFY_DISCOURAGE_UPGRADABLE_WITNESS_PROGRAM) {
+        return ReferenceSetError(serror, SCRIPT_ERR_DISCOURAGE_UPGRADABLE_WITNESS_PROGRAM);
+    } else {
+        return ReferenceSetError(serror, SCRIPT_ERR_OK);
+    }
+
+    for (unsigned int i = 0; i < stack.size(); i++) {
+        if (stack.at(i).size() > MAX_SCRIPT_ELEMENT_SIZE)
+            return ReferenceSetError(serror, SCRIPT_ERR_PUSH_SIZE);
+    }
+    if (!EvalScript(stack, scriptPubKey, flags, checker, SigVersion::WITNESS_V0, serror))
+        return false;
+    if (stack.size() != 1)
+        return ReferenceSetError(serror, SCRIPT_ERR_CLEANSTACK);
+    if (!ReferenceCastToBool(stack.back()))
+        return ReferenceSetError(serror, SCRIPT_ERR_EVAL_FALSE);
+    return true;
+}
+
+static bool ReferenceVerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror)
+{
+    bool hadWitness = false;
+    ReferenceSetError(serror, SCRIPT_ERR_UNKNOWN_ERROR);
+
+    if ((flags & SCRIPT_VERIFY_SIGPUSHONLY) != 0 && !scriptSig.IsPushOnly())
+        return ReferenceSetError(serror, SCRIPT_ERR_SIG_PUSHONLY);
+
+    std::vector<std::vector<unsigned char> > stack, stackCopy;
+    if (!EvalScript(stack, scriptSig, flags, checker, SigVersion::BASE, serror))
+        return false;
+    if (flags & SCRIPT_VERIFY_P2SH)
+        stackCopy = stack;
+    if (!EvalScript(stack, scriptPubKey, flags, checker, SigVersion::BASE, serror))
+        return false;
+    if (stack.empty() || !ReferenceCastToBool(stack.back()))
+        return ReferenceSetError(serror, SCRIPT_ERR_EVAL_FALSE);
+
+    int witnessversion;
+    std::vector<unsigned char> witnessprogram;
+    if ((flags & SCRIPT_VERIFY_WITNESS) && scriptPubKey.IsWitnessProgram(witnessversion, witnessprogram)) {
+        hadWitness = true;
+        if (scriptSig.size() != 0)
+            return ReferenceSetError(serror, SCRIPT_ERR_WITNESS_MALLEATED);
+        if (!ReferenceVerifyWitnessProgram(*witness, witnessversion, witnessprogram, flags, checker, serror))
+            return false;
+        stack.resize(1);
+    }
+
+    if ((flags & SCRIPT_VERIFY_P2SH) && scriptPubKey.IsPayToScriptHash()) {
+        if (!scriptSig.IsPushOnly())
+            return ReferenceSetError(serror, SCRIPT_ERR_SIG_PUSHONLY);
+        std::swap(stack, stackCopy);
+        const std::vector<unsigned char> pubKeySerialized = stack.back();
+        CScript pubKey2(pubKeySerialized.begin(), pubKeySerialized.end());
+        stack.pop_back();
+        if (!EvalScript(stack, pubKey2, flags, checker, SigVersion::BASE, serror))
+            return false;
+        if (stack.empty() || !ReferenceCastToBool(stack.back()))
+            return ReferenceSetError(serror, SCRIPT_ERR_EVAL_FALSE);
+        if ((flags & SCRIPT_VERIFY_WITNESS) && pubKey2.IsWitnessProgram(witnessversion, witnessprogram)) {
+            hadWitness = true;
+            if (scriptSig != CScript() << std::vector<unsigned char>(pubKey2.begin(), pubKey2.end()))
+                return ReferenceSetError(serror, SCRIPT_ERR_WITNESS_MALLEATED_P2SH);
+            if (!ReferenceVerifyWitnessProgram(*witness, witnessversion, witnessprogram, flags, checker, serror))
+                return false;
+            stack.resize(1);
+        }
+    }
+
+    if ((flags & SCRIPT_VERIFY_CLEANSTACK) != 0 && stack.size() != 1)
+        return ReferenceSetError(serror, SCRIPT_ERR_CLEANSTACK);
+    if ((flags & SCRIPT_VERIFY_WITNESS) && !hadWitness && !witness->IsNull())
+        return ReferenceSetError(serror, SCRIPT_ERR_WITNESS_UNEXPECTED);
+    return ReferenceSetError(serror, SCRIPT_ERR_OK);
+}
+
+// Random script flags, CLEANSTACK implies WITNESS and WITNESS implies P2SH
+static unsigned int RandomScriptFlags()
+{
+    unsigned int flags = InsecureRandBits(17);
+    if (flags & SCRIPT_VERIFY_CLEANSTACK)
+        flags |= SCRIPT_VERIFY_WITNESS;
+    if (flags & SCRIPT_VERIFY_WITNESS)
+        flags |= SCRIPT_VERIFY_P2SH;
+    return flags;
+}
+
+static void CheckSameAsReference(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness& witness, unsigned int flags, const BaseSignatureChecker& checker, const std::string& message)
+{
+    ScriptError err, errReference;
+    const bool result = VerifyScript(scriptSig, scriptPubKey, &witness, flags, checker, &err);
+    const bool resultReference = ReferenceVerifyScript(scriptSig, scriptPubKey, &witness, flags, checker, &errReference);
+    BOOST_CHECK_MESSAGE(result == resultReference && err == errReference,
+        message + strprintf(" (flags %x: %s where the interpreter gives %s)", flags, FormatScriptError(err), FormatScriptError(errReference)));
+}
+
+// Reads the inputs of a tx_valid.json/tx_invalid.json test and checks all of them
+static void CheckTxTestSameAsReference(const UniValue& test)
+{
+    const std::string strTest = test.write();
+    if (!test[0].isArray() || test.size() != 3 || !test[1].isStr() || !test[2].isStr())
+        return; // comment
+
+    std::map<COutPoint, CScript> mapprevOutScriptPubKeys;
+    std::map<COutPoint, int64_t> mapprevOutValues;
+    const UniValue& inputs = test[0].get_array();
+    for (unsigned int inpIdx = 0; inpIdx < inputs.size(); inpIdx++) {
+        const UniValue& vinput = inputs[inpIdx].get_array();
+        COutPoint outpoint(uint256S(vinput[0].get_str()), vinput[1].get_int());
+        mapprevOutScriptPubKeys[outpoint] = ParseScript(vinput[2].get_str());
+        if (vinput.size() >= 4)
+            mapprevOutValues[outpoint] = vinput[3].get_int64();
+    }
+
+    CDataStream stream(ParseHex(test[1].get_str()), SER_NETWORK, PROTOCOL_VERSION);
+    CTransaction tx(deserialize, stream);
+    PrecomputedTransactionData txdata(tx);
+    const unsigned int flags = ParseScriptFlags(test[2].get_str());
+    for (unsigned int i = 0; i < tx.vin.size(); i++) {
+        if (!mapprevOutScriptPubKeys.count(tx.vin[i].prevout))
+            continue;
+        const CAmount amount = mapprevOutValues.count(tx.vin[i].prevout) ? mapprevOutValues[tx.vin[i].prevout] : 0;
+        const TransactionSignatureChecker checker(&tx, i, amount, txdata);
+        CheckSameAsReference(tx.vin[i].scriptSig, mapprevOutScriptPubKeys[tx.vin[i].prevout], tx.vin[i].scriptWitness, flags, checker, strTest);
+        CheckSameAsReference(tx.vin[i].scriptSig, mapprevOutScriptPubKeys[tx.vin[i].prevout], tx.vin[i].scriptWitness, RandomScriptFlags(), checker, strTest);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(script_verify_standard_vectors)
+{
+    // script_tests.json, see script_json_test for the format
+    UniValue tests = read_json(std::string(json_tests::script_tests, json_tests::script_tests + sizeof(json_tests::script_tests)));
+    for (unsigned int idx = 0; idx < tests.size(); idx++) {
+        UniValue test = tests[idx];
+        std::string strTest = test.write();
+        CScriptWitness witness;
+        CAmount nValue = 0;
+        unsigned int pos = 0;
+        if (test.size() > 0 && test[pos].isArray()) {
+            unsigned int i = 0;
+            for (i = 0; i < test[pos].size() - 1; i++)
+                witness.stack.push_back(ParseHex(test[pos][i].get_str()));
+            nValue = AmountFromValue(test[pos][i]);
+            pos++;
+        }
+        if (test.size() < 4 + pos)
+            continue; // comment
+        CScript scriptSig = ParseScript(test[pos++].get_str());
+        CScript scriptPubKey = ParseScript(test[pos++].get_str());
+        unsigned int flags = ParseScriptFlags(test[pos++].get_str());
+        if (flags & SCRIPT_VERIFY_CLEANSTACK)
+            flags |= SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_WITNESS;
+
+        const CTransaction txCredit{BuildCreditingTransaction(scriptPubKey, nValue)};
+        CMutableTransaction tx = BuildSpendingTransaction(scriptSig, witness, txCredit);
+        const MutableTransactionSignatureChecker checker(&tx, 0, txCredit.vout[0].nValue);
+        CheckSameAsReference(scriptSig, scriptPubKey, witness, flags, checker, strTest);
+        for (int i = 0; i < 4; ++i)
+            CheckSameAsReference(scriptSig, scriptPubKey, witness, RandomScriptFlags(), checker, strTest);
+    }
+
+    // tx_valid.json and tx_invalid.json, see transaction_tests for the format
+    UniValue txValid = read_json(std::string(json_tests::tx_valid, json_tests::tx_valid + sizeof(json_tests::tx_valid)));
+    for (unsigned int idx = 0; idx < txValid.size(); idx++)
+        CheckTxTestSameAsReference(txValid[idx]);
+    UniValue txInvalid = read_json(std::string(json_tests::tx_invalid, json_tests::tx_invalid + sizeof(json_tests::tx_invalid)));
+    for (unsigned int idx = 0; idx < txInvalid.size(); idx++)
+        CheckTxTestSameAsReference(txInvalid[idx]);
+}
+
+BOOST_AUTO_TEST_CASE(script_verify_standard_random)
+{
+    // Randomized spends of the templates the fast path takes, valid and mutated
+    for (int i = 0; i < 3000; ++i) {
+        CKey key, otherKey;
+        key.MakeNewKey(InsecureRandBool());
+        otherKey.MakeNewKey(InsecureRandBool());
+        const CPubKey pubkey = key.GetPubKey();
+        std::vector<unsigned char> vchPubKey = ToByteVector(pubkey);
+
+        // 0: P2PKH, 1: P2PK, 2: P2WPKH
+        const int type = InsecureRandRange(3);
+        CScript scriptPubKey;
+        if (type == 0)
+            scriptPubKey = GetScriptForDestination(pubkey.GetID());
+        else if (type == 1)
+            scriptPubKey = GetScriptForRawPubKey(pubkey);
+        else
+            scriptPubKey = GetScriptForDestination(WitnessV0KeyHash(pubkey.GetID()));
+        const CScript scriptCode = type == 2 ? GetScriptForDestination(pubkey.GetID()) : scriptPubKey;
+        const SigVersion sigversion = type == 2 ? SigVersion::WITNESS_V0 : SigVersion::BASE;
+
+        const CTransaction txCredit{BuildCreditingTransaction(scriptPubKey, InsecureRandRange(1000000))};
+        CMutableTransaction tx = BuildSpendingTransaction(CScript(), CScriptWitness(), txCredit);
+        static const int hashTypes[] = {SIGHASH_ALL, SIGHASH_NONE, SIGHASH_SINGLE, SIGHASH_ALL | SIGHASH_ANYONECANPAY};
+        const int nHashType = hashTypes[InsecureRandRange(4)];
+        const uint256 hash = SignatureHash(scriptCode, tx, 0, nHashType, txCredit.vout[0].nValue, sigversion);
+        std::vector<unsigned char> vchSig;
+        BOOST_CHECK(key.Sign(hash, vchSig));
+
+        const int mutation = InsecureRandRange(10);
+        if (mutation == 1)
+            NegateSignatureS(vchSig); // high S
+        vchSig.push_back(static_cast<unsigned char>(mutation == 2 ? InsecureRandBits(8) : nHashType));
+        if (mutation == 3)
+            vchSig[InsecureRandRange(vchSig.size())] ^= 1 << InsecureRandRange(8);
+        if (mutation == 4)
+            vchPubKey = ToByteVector(otherKey.GetPubKey());
+        if (mutation == 5)
+            vchSig.clear();
+        if (mutation == 6)
+            vchPubKey[0] = InsecureRandBits(8); // invalid pubkey encoding
+
+        CScript scriptSig;
+        CScriptWitness witness;
+        if (type == 2) {
+            witness.stack = {vchSig, vchPubKey};
+        } else if (mutation == 7) {
+            // Non-minimal push of the signature
+            scriptSig << OP_PUSHDATA1;
+            scriptSig.push_back(static_cast<unsigned char>(vchSig.size()));
+            scriptSig.insert(scriptSig.end(), vchSig.begin(), vchSig.end());
+            if (type == 0)
+                scriptSig << vchPubKey;
+        } else {
+            scriptSig << vchSig;
+            if (type == 0)
+                scriptSig << vchPubKey;
+        }
+        if (mutation == 8) {
+            // Unexpected witness or scriptSig data
+            if (type == 2)
+                scriptSig << OP_1;
+            else
+                witness.stack.push_back(vchSig);
+        }
+        if (mutation == 9)
+            scriptSig << OP_NOP;
+        tx.vin[0].scriptSig = scriptSig;
+        tx.vin[0].scriptWitness = witness;
+
+        const MutableTransactionSignatureChecker checker(&tx, 0, txCredit.vout[0].nValue);
+        const std::string message = strprintf("template %d mutation %d", type, mutation);
+        CheckSameAsReference(scriptSig, scriptPubKey, witness, RandomScriptFlags(), checker, message);
+        CheckSameAsReference(scriptSig, scriptPubKey, witness, STANDARD_SCRIPT_VERIFY_FLAGS, checker, message);
+    }
+}
+
+// A random script of pushes, small numbers and opcodes
+static CScript RandomScript(int nMaxOps)
+{
+    CScript script;
+    const int nOps = InsecureRandRange(nMaxOps + 1);
+    for (int i = 0; i < nOps; ++i) {
+        switch (InsecureRandRange(4)) {
+        case 0:
+            script << std::vector<unsigned char>(InsecureRandRange(80), InsecureRandBits(8));
+            break;
+        case 1:
+            script << CScriptNum(InsecureRandRange(20) - 2);
+            break;
+        default:
+            script.push_back(static_cast<unsigned char>(InsecureRandRange(OP_NOP10 + 1)));
+            break;
+        }
+    }
+    return script;
+}
+
+BOOST_AUTO_TEST_CASE(script_verify_interpreter_random)
+{
+    // Randomized bare, P2SH and P2WSH multisig spends, which evaluate on the inline stacks
+    for (int i = 0; i < 1500; ++i) {
+        const int n = 1 + InsecureRandRange(3);
+        const int m = 1 + InsecureRandRange(n);
+        std::vector<CKey> keys(n);
+        std::vector<CPubKey> pubkeys;
+        for (auto& key : keys) {
+            key.MakeNewKey(InsecureRandBool());
+            pubkeys.push_back(key.GetPubKey());
+        }
+        const CScript redeemScript = GetScriptForMultisig(m, pubkeys);
+
+        // 0: bare, 1: P2SH, 2: P2WSH
+        const int type = InsecureRandRange(3);
+        CScript scriptPubKey;
+        if (type == 0)
+            scriptPubKey = redeemScript;
+        else if (type == 1)
+            scriptPubKey = GetScriptForDestination(CScriptID(redeemScript));
+        else
+            scriptPubKey = GetScriptForDestination(WitnessV0ScriptHash(redeemScript));
+        const SigVersion sigversion = type == 2 ? SigVersion::WITNESS_V0 : SigVersion::BASE;
+
+        const CTransaction txCredit{BuildCreditingTransaction(scriptPubKey, InsecureRandRange(1000000))};
+        CMutableTransaction tx = BuildSpendingTransaction(CScript(), CScriptWitness(), txCredit);
+        const uint256 hash = SignatureHash(redeemScript, tx, 0, SIGHASH_ALL, txCredit.vout[0].nValue, sigversion);
+
+        const int mutation = InsecureRandRange(6);
+        std::vector<std::vector<unsigned char>> stack;
+        stack.push_back(mutation == 1 ? std::vector<unsigned char>{1} : std::vector<unsigned char>()); // dummy
+        for (int k = 0; k < m; ++k) {
+            std::vector<unsigned char> vchSig;
+            BOOST_CHECK(keys[k].Sign(hash, vchSig));
+            if (mutation == 2 && k == 0)
+                NegateSignatureS(vchSig); // high S
+            vchSig.push_back(static_cast<unsigned char>(SIGHASH_ALL));
+            if (mutation == 3 && k == m - 1)
+                vchSig[InsecureRandRange(vchSig.size())] ^= 1 << InsecureRandRange(8);
+            stack.push_back(vchSig);
+        }
+        if (mutation == 4 && m > 1)
+            std::swap(stack[1], stack[2]); // signatures out of order
+        if (mutation == 5)
+            stack.pop_back();
+
+        CScript scriptSig;
+        CScriptWitness witness;
+        if (type == 2) {
+            witness.stack = stack;
+            witness.stack.push_back(std::vector<unsigned char>(redeemScript.begin(), redeemScript.end()));
+        } else {
+            for (const auto& item : stack)
+                scriptSig << item;
+            if (type == 1)
+                scriptSig << std::vector<unsigned char>(redeemScript.begin(), redeemScript.end());
+        }
+        tx.vin[0].scriptSig = scriptSig;
+        tx.vin[0].scriptWitness = witness;
+
+        const MutableTransactionSignatureChecker checker(&tx, 0, txCredit.vout[0].nValue);
+        const std::string message = strprintf("%d-of-%d multisig type %d mutation %d", m, n, type, mutation);
+        CheckSameAsReference(scriptSig, scriptPubKey, witness, RandomScriptFlags(), checker, message);
+        CheckSameAsReference(scriptSig, scriptPubKey, witness, STANDARD_SCRIPT_VERIFY_FLAGS, checker, message);
+    }
+
+    // Random scripts, also inside P2SH and P2WSH
+    const CTransaction txCredit{BuildCreditingTransaction(CScript())};
+    const CMutableTransaction tx = BuildSpendingTransaction(CScript(), CScriptWitness(), txCredit);
+    const MutableTransactionSignatureChecker checker(&tx, 0, txCredit.vout[0].nValue);
+    for (int i = 0; i < 20000; ++i) {
+        CScript scriptSig = RandomScript(8);
+        CScript scriptPubKey = RandomScript(12);
+        CScriptWitness witness;
+        const int type = InsecureRandRange(3);
+        if (type == 1) {
+            scriptSig << std::vector<unsigned char>(scriptPubKey.begin(), scriptPubKey.end());
+            scriptPubKey = GetScriptForDestination(CScriptID(scriptPubKey));
+        } else if (type == 2) {
+            for (int k = InsecureRandRange(4); k > 0; --k)
+                witness.stack.push_back(std::vector<unsigned char>(InsecureRandRange(4), InsecureRandBits(8)));
+            witness.stack.push_back(std::vector<unsigned char>(scriptPubKey.begin(), scriptPubKey.end()));
+            scriptPubKey = GetScriptForDestination(WitnessV0ScriptHash(scriptPubKey));
+            scriptSig = CScript();
+        }
+        CheckSameAsReference(scriptSig, scriptPubKey, witness, RandomScriptFlags(), checker, "random script " + HexStr(scriptSig) + " " + HexStr(scriptPubKey));
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
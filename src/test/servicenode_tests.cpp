@@ -8,9 +8,14 @@
 #include <rpc/server.h>
 #include <servicenode/servicenode.h>
 #include <servicenode/servicenodemgr.h>
+#include <util/time.h>
 #include <wallet/coincontrol.h>
 #include <xbridge/xbridgeapp.h>
 
+#include <atomic>
+
+#include <boost/thread.hpp>
+
 sn::ServiceNode snodeNetwork(const CPubKey & snodePubKey, const uint8_t & tier, const CKeyID & paymentAddr,
                          const std::vector<COutPoint> & collateral, const uint32_t & blockNumber,
                          const uint256 & blockHash, const std::vector<unsigned char> & sig)
@@ -51,7 +56,8 @@ BOOST_AUTO_TEST_CASE(servicenode_tests_isvalid)
     CAmount totalAmount{0};
     std::vector<COutPoint> collateral;
     for (const auto & tx : pos.m_coinbase_txns) {
-        if (!GetTxFunc({tx->GetHash(), 0})) // make sure tx exists
+        CTxOut out;
+        if (!GetCoinFunc({tx->GetHash(), 0}, out)) // make sure utxo exists
             continue;
         totalAmount += tx->vout[0].nValue;
         collateral.emplace_back(tx->GetHash(), 0);
@@ -67,7 +73,7 @@ BOOST_AUTO_TEST_CASE(servicenode_tests_isvalid)
     // Deserialize servicenode obj from network stream
     sn::ServiceNode snode;
     BOOST_CHECK_NO_THROW(snode = snodeNetwork(snodePubKey, tier, snodePubKey.GetID(), collateral, chainActive.Height(), chainActive.Tip()->GetBlockHash(), sig));
-    BOOST_CHECK(snode.isValid(GetTxFunc, IsServiceNodeBlockValidFunc));
+    BOOST_CHECK(snode.isValid(GetCoinFunc, IsServiceNodeBlockValidFunc));
 }
 
 /// Check open tier case
@@ -87,7 +93,7 @@ BOOST_FIXTURE_TEST_CASE(servicenode_tests_opentier, TestChainPoS)
         // Deserialize servicenode obj from network stream
         sn::ServiceNode snode;
         BOOST_CHECK_NO_THROW(snode = snodeNetwork(snodePubKey, tier, snodePubKey.GetID(), collateral, chainActive.Height(), chainActive.Tip()->GetBlockHash(), sig));
-        BOOST_CHECK_MESSAGE(snode.isValid(GetTxFunc, IsServiceNodeBlockValidFunc), "Failed on valid snode key sig");
+        BOOST_CHECK_MESSAGE(snode.isValid(GetCoinFunc, IsServiceNodeBlockValidFunc), "Failed on valid snode key sig");
     }
 
     // Case where wrong key is used to generate sig. For the open tier the snode private key
@@ -100,7 +106,7 @@ BOOST_FIXTURE_TEST_CASE(servicenode_tests_opentier, TestChainPoS)
         // Deserialize servicenode obj from network stream
         sn::ServiceNode snode;
         BOOST_CHECK_NO_THROW(snode = snodeNetwork(snodePubKey, tier, snodePubKey.GetID(), collateral, chainActive.Height(), chainActive.Tip()->GetBlockHash(), sig));
-        BOOST_CHECK_MESSAGE(!snode.isValid(GetTxFunc, IsServiceNodeBlockValidFunc), "Failed on invalid snode key sig");
+        BOOST_CHECK_MESSAGE(!snode.isValid(GetCoinFunc, IsServiceNodeBlockValidFunc), "Failed on invalid snode key sig");
     }
 }
 
@@ -127,7 +133,7 @@ BOOST_FIXTURE_TEST_CASE(servicenode_tests_duplicate_collateral, TestChainPoS)
     // Deserialize servicenode obj from network stream
     sn::ServiceNode snode;
     BOOST_CHECK_NO_THROW(snode = snodeNetwork(snodePubKey, tier, snodePubKey.GetID(), collateral, chainActive.Height(), chainActive.Tip()->GetBlockHash(), sig));
-    BOOST_CHECK(!snode.isValid(GetTxFunc, IsServiceNodeBlockValidFunc));
+    BOOST_CHECK(!snode.isValid(GetCoinFunc, IsServiceNodeBlockValidFunc));
 }
 
 /// Check case where there's not enough snode inputs
@@ -150,7 +156,7 @@ BOOST_FIXTURE_TEST_CASE(servicenode_tests_insufficient_collateral, TestChainPoS)
     // Deserialize servicenode obj from network stream
     sn::ServiceNode snode;
     BOOST_CHECK_NO_THROW(snode = snodeNetwork(snodePubKey, tier, snodePubKey.GetID(), collateral, chainActive.Height(), chainActive.Tip()->GetBlockHash(), sig));
-    BOOST_CHECK(!snode.isValid(GetTxFunc, IsServiceNodeBlockValidFunc));
+    BOOST_CHECK(!snode.isValid(GetCoinFunc, IsServiceNodeBlockValidFunc));
 }
 
 /// Check case where collateral inputs are spent
@@ -219,7 +225,7 @@ BOOST_AUTO_TEST_CASE(servicenode_tests_spent_collateral)
         // Deserialize servicenode obj from network stream
         sn::ServiceNode snode;
         BOOST_CHECK_NO_THROW(snode = snodeNetwork(snodePubKey, tier, snodePubKey.GetID(), collateral, chainActive.Height(), chainActive.Tip()->GetBlockHash(), sig));
-        BOOST_CHECK_MESSAGE(!snode.isValid(GetTxFunc, IsServiceNodeBlockValidFunc), "Should fail on spent collateral");
+        BOOST_CHECK_MESSAGE(!snode.isValid(GetCoinFunc, IsServiceNodeBlockValidFunc), "Should fail on spent collateral");
     }
 
     // Check case where spent collateral is in mempool
@@ -262,7 +268,7 @@ BOOST_AUTO_TEST_CASE(servicenode_tests_spent_collateral)
         // Deserialize servicenode obj from network stream
         sn::ServiceNode snode;
         BOOST_CHECK_NO_THROW(snode = snodeNetwork(snodePubKey, tier, snodePubKey.GetID(), collateral, chainActive.Height(), chainActive.Tip()->GetBlockHash(), sig));
-        BOOST_CHECK_MESSAGE(snode.isValid(GetTxFunc, IsServiceNodeBlockValidFunc), "Should not fail on spent collateral in mempool");
+        BOOST_CHECK_MESSAGE(snode.isValid(GetCoinFunc, IsServiceNodeBlockValidFunc), "Should not fail on spent collateral in mempool");
     }
 
     // Servicenode should be marked invalid if collateral is spent
@@ -311,10 +317,21 @@ BOOST_AUTO_TEST_CASE(servicenode_tests_spent_collateral)
             // Send transaction
             uint256 txid; std::string errstr; const TransactionError err = BroadcastTransaction(MakeTransactionRef(mtx), txid, errstr, 0);
             BOOST_CHECK_MESSAGE(err == TransactionError::OK, strprintf("Failed to spend snode collateral: %s", errstr));
+            const auto snapBefore = sn::ServiceNodeMgr::instance().snapshot();
             pos.StakeBlocks(1), SyncWithValidationInterfaceQueue();
             const auto checkSnode = sn::ServiceNodeMgr::instance().getSn(snodePubKey);
-            BOOST_CHECK_MESSAGE(!checkSnode.isValid(GetTxFunc, IsServiceNodeBlockValidFunc), "snode should be invalid because collateral was spent");
+            BOOST_CHECK_MESSAGE(!checkSnode.isValid(GetCoinFunc, IsServiceNodeBlockValidFunc), "snode should be invalid because collateral was spent");
             BOOST_CHECK_MESSAGE(checkSnode.getInvalid(), "snode should be marked invalid in the validation interface event (connect block)");
+            // Snapshots taken before the block are unchanged
+            BOOST_CHECK_MESSAGE(!snapBefore->at(snodePubKey)->getInvalid(), "snode in an older snapshot should not be modified");
+            BOOST_CHECK(snapBefore->at(snodePubKey)->getCurrentBlock() != chainActive.Height());
+            // Disconnecting the spending block undoes the invalidation
+            {
+                CValidationState state;
+                InvalidateBlock(state, *params, chainActive.Tip());
+                SyncWithValidationInterfaceQueue();
+            }
+            BOOST_CHECK_MESSAGE(!sn::ServiceNodeMgr::instance().getSn(snodePubKey).getInvalid(), "snode should be valid again in the validation interface event (disconnect block)");
             UnregisterValidationInterface(&sn::ServiceNodeMgr::instance());
         }
 
@@ -422,7 +439,7 @@ BOOST_AUTO_TEST_CASE(servicenode_tests_reregister_onspend)
         pos.StakeBlocks(2), SyncWithValidationInterfaceQueue();
 
         const auto checkSnode = sn::ServiceNodeMgr::instance().getSn(snodeEntry.key.GetPubKey());
-        BOOST_CHECK_MESSAGE(checkSnode.isValid(GetTxFunc, IsServiceNodeBlockValidFunc), "snode should be auto-registered after spent utxo detected (2 confirmations)");
+        BOOST_CHECK_MESSAGE(checkSnode.isValid(GetCoinFunc, IsServiceNodeBlockValidFunc), "snode should be auto-registered after spent utxo detected (2 confirmations)");
         // make sure spent collateral not in the new registration
         for (const auto & utxo : checkSnode.getCollateral())
             BOOST_CHECK_MESSAGE(utxo != selUtxo, "snode spent utxo should not exist after new registration");
@@ -503,7 +520,7 @@ BOOST_AUTO_TEST_CASE(servicenode_tests_immature_collateral)
         // Deserialize servicenode obj from network stream
         sn::ServiceNode snode;
         BOOST_CHECK_NO_THROW(snode = snodeNetwork(snodePubKey, tier, snodePubKey.GetID(), collateral, chainActive.Height(), chainActive.Tip()->GetBlockHash(), sig));
-        BOOST_CHECK_MESSAGE(snode.isValid(GetTxFunc, IsServiceNodeBlockValidFunc), "Service node should be valid with 1 confirmation on collateral");
+        BOOST_CHECK_MESSAGE(snode.isValid(GetCoinFunc, IsServiceNodeBlockValidFunc), "Service node should be valid with 1 confirmation on collateral");
         // Register the snode
         BOOST_CHECK_MESSAGE(sn::ServiceNodeMgr::instance().registerSn(key, sn::ServiceNode::SPV, EncodeDestination(sdest), g_connman.get(), {otherwallet}), "Service node should register on immature collateral");
         sn::ServiceNodeConfigEntry entry("snode0", sn::ServiceNode::SPV, key, sdest);
@@ -542,7 +559,7 @@ BOOST_AUTO_TEST_CASE(servicenode_tests_immature_collateral)
         BOOST_CHECK_MESSAGE(sn::ServiceNodeMgr::instance().sendPing(50, jservices, g_connman.get()), "Refresh snode ping before running state check");
         BOOST_CHECK_MESSAGE(sn::ServiceNodeMgr::instance().getSn(snodePubKey).running(), "Service node with recently spent collateral in grace period should still be in running state");
         pos.StakeBlocks(2), SyncWithValidationInterfaceQueue();
-        BOOST_CHECK_MESSAGE(sn::ServiceNodeMgr::instance().getSn(snodePubKey).isValid(GetTxFunc, IsServiceNodeBlockValidFunc),  "Service node with recently staked collateral should be valid");
+        BOOST_CHECK_MESSAGE(sn::ServiceNodeMgr::instance().getSn(snodePubKey).isValid(GetCoinFunc, IsServiceNodeBlockValidFunc),  "Service node with recently staked collateral should be valid");
         UnregisterValidationInterface(&sn::ServiceNodeMgr::instance());
     }
 
@@ -598,6 +615,64 @@ BOOST_AUTO_TEST_CASE(servicenode_tests_registration_pings)
         const auto & jservices = xbridge::App::instance().myServicesJSON();
         BOOST_CHECK_MESSAGE(sn::ServiceNodeMgr::instance().sendPing(50, jservices, g_connman.get()), "Snode ping w/ compressed key");
         BOOST_CHECK(sn::ServiceNodeMgr::instance().list().size() == 1);
+        // Servicenode list includes the latest ping, delta lists only include newer pings
+        const auto snlist = sn::ServiceNodeMgr::instance().getSnList(0);
+        BOOST_CHECK_EQUAL(snlist.getPings().size(), 1);
+        BOOST_CHECK_EQUAL(snlist.getHeight(), chainActive.Height());
+        BOOST_CHECK(snlist.getPings()[0].getSnodePubKey() == key.GetPubKey());
+        BOOST_CHECK(sn::ServiceNodeMgr::instance().getSnList(chainActive.Height()).getPings().empty());
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss << snlist;
+        sn::ServiceNodeList snlist2;
+        ss >> snlist2;
+        BOOST_CHECK_EQUAL(snlist2.getVersion(), sn::ServiceNodeList::CURRENT_VERSION);
+        BOOST_CHECK(snlist2.getPings()[0].getHash() == snlist.getPings()[0].getHash());
+        BOOST_CHECK(snlist2.isComplete());
+        // The list height only advances on complete lists, and not past the height we requested
+        {
+            auto & smgr = sn::ServiceNodeMgr::instance();
+            const int h = smgr.getSnListHeight();
+            auto processList = [&smgr](const sn::ServiceNodeList & l, const int requestHeight) -> bool {
+                CDataStream sl(SER_NETWORK, PROTOCOL_VERSION);
+                sl << l;
+                return smgr.processSnList(sl, requestHeight, nullptr);
+            };
+            BOOST_CHECK(processList(sn::ServiceNodeList(h + 50, h, false, {}), h + 100));
+            BOOST_CHECK_EQUAL(smgr.getSnListHeight(), h);
+            BOOST_CHECK(processList(sn::ServiceNodeList(h + 50, h, true, {}), h + 40));
+            BOOST_CHECK_EQUAL(smgr.getSnListHeight(), h + 40);
+            BOOST_CHECK(processList(sn::ServiceNodeList(h + 50, h, true, {}), h + 100));
+            BOOST_CHECK_EQUAL(smgr.getSnListHeight(), h + 50);
+            BOOST_CHECK(processList(sn::ServiceNodeList(h + 10, h, true, {}), h + 100));
+            BOOST_CHECK_EQUAL(smgr.getSnListHeight(), h + 50);
+            // Lists of another version are rejected
+            CDataStream sl(SER_NETWORK, PROTOCOL_VERSION);
+            sl << static_cast<uint8_t>(sn::ServiceNodeList::CURRENT_VERSION + 1) << sn::ServiceNodeList(h + 60, h, true, {});
+            BOOST_CHECK(!smgr.processSnList(sl, h + 100, nullptr));
+        }
+        // Servicenode list cache is reloaded and revalidated after a restart
+        BOOST_CHECK(sn::ServiceNodeMgr::instance().writeSnListToDisk());
+        sn::ServiceNodeMgr::instance().reset();
+        BOOST_CHECK(sn::ServiceNodeMgr::instance().list().empty());
+        {
+            boost::thread checkThread(&sn::ThreadServiceNodeCheck);
+            std::atomic<bool> loaded{false};
+            BOOST_CHECK(sn::ServiceNodeMgr::instance().loadSnListFromDisk([&loaded](const sn::ServiceNodePing & ping) { loaded = true; }));
+            for (int i = 0; i < 200 && !loaded; ++i)
+                MilliSleep(25);
+            BOOST_CHECK_MESSAGE(loaded, "Cached servicenode ping should be applied");
+            BOOST_CHECK_EQUAL(sn::ServiceNodeMgr::instance().list().size(), 1);
+            BOOST_CHECK_EQUAL(sn::ServiceNodeMgr::instance().getSnListHeight(), chainActive.Height());
+            checkThread.interrupt();
+            checkThread.join();
+        }
+        // Corrupt cache is rejected
+        {
+            boost::filesystem::ofstream file(sn::ServiceNodeMgr::getServiceNodeListCache(), std::ios_base::binary | std::ios_base::app);
+            file << "x";
+        }
+        BOOST_CHECK(!sn::ServiceNodeMgr::instance().loadSnListFromDisk(nullptr));
+        boost::filesystem::remove(sn::ServiceNodeMgr::getServiceNodeListCache());
         sn::ServiceNodeMgr::writeSnConfig(std::vector<sn::ServiceNodeConfigEntry>(), false); // reset
         sn::ServiceNodeMgr::instance().reset();
     }
@@ -692,11 +767,11 @@ BOOST_AUTO_TEST_CASE(servicenode_tests_registration_pings)
         sn::ServiceNodePing pingValid(key.GetPubKey(), bestBlock, bestBlockHash, static_cast<uint32_t>(GetTime()),
                 R"({"xbridgeversion":50,"xrouterversion":50,"xrouter":{"config":"[Main]\nwallets=\nplugins=CustomPlugin1,CustomPlugin2\nhost=127.0.0.1", "plugins":{"CustomPlugin1":"","CustomPlugin2":""}}})", snode);
         pingValid.sign(key);
-        BOOST_CHECK_MESSAGE(pingValid.isValid(GetTxFunc, IsServiceNodeBlockValidFunc), "Service node ping should be valid for open tier xrs services");
+        BOOST_CHECK_MESSAGE(pingValid.isValid(GetCoinFunc, IsServiceNodeBlockValidFunc), "Service node ping should be valid for open tier xrs services");
         sn::ServiceNodePing pingInvalid(key.GetPubKey(), bestBlock, bestBlockHash, static_cast<uint32_t>(GetTime()),
                 R"({"xbridgeversion":50,"xrouterversion":50,"xrouter":{"config":"[Main]\nwallets=BLOCK,LTC\nplugins=CustomPlugin1,CustomPlugin2\nhost=127.0.0.1", "plugins":{"CustomPlugin1":"","CustomPlugin2":""}}})", snode);
         pingInvalid.sign(key);
-        BOOST_CHECK_MESSAGE(!pingInvalid.isValid(GetTxFunc, IsServiceNodeBlockValidFunc), "Service node ping should be invalid for open tier non-xrs services");
+        BOOST_CHECK_MESSAGE(!pingInvalid.isValid(GetCoinFunc, IsServiceNodeBlockValidFunc), "Service node ping should be invalid for open tier non-xrs services");
         sn::ServiceNodeMgr::writeSnConfig(std::vector<sn::ServiceNodeConfigEntry>(), false); // reset
     }
 
@@ -754,7 +829,7 @@ BOOST_AUTO_TEST_CASE(servicenode_tests_misc_checks)
         // Deserialize servicenode obj from network stream
         sn::ServiceNode snode;
         BOOST_CHECK_NO_THROW(snode = snodeNetwork(snodePubKey, tier, snodePubKey.GetID(), collateral, chainActive.Height(), chainActive.Tip()->GetBlockHash(), sig));
-        BOOST_CHECK_MESSAGE(!snode.isValid(GetTxFunc, IsServiceNodeBlockValidFunc), "Fail on bad tier");
+        BOOST_CHECK_MESSAGE(!snode.isValid(GetCoinFunc, IsServiceNodeBlockValidFunc), "Fail on bad tier");
     }
 
     // Fail on empty collateral
@@ -770,7 +845,7 @@ BOOST_AUTO_TEST_CASE(servicenode_tests_misc_checks)
         // Deserialize servicenode obj from network stream
         sn::ServiceNode snode;
         BOOST_CHECK_NO_THROW(snode = snodeNetwork(snodePubKey, tier, snodePubKey.GetID(), collateral2, chainActive.Height(), chainActive.Tip()->GetBlockHash(), sig));
-        BOOST_CHECK_MESSAGE(!snode.isValid(GetTxFunc, IsServiceNodeBlockValidFunc), "Fail on empty collateral");
+        BOOST_CHECK_MESSAGE(!snode.isValid(GetCoinFunc, IsServiceNodeBlockValidFunc), "Fail on empty collateral");
     }
 
     // Fail on empty snode pubkey
@@ -781,7 +856,7 @@ BOOST_AUTO_TEST_CASE(servicenode_tests_misc_checks)
         BOOST_CHECK(pos.coinbaseKey.SignCompact(sighash, sig));
         sn::ServiceNode snode;
         BOOST_CHECK_NO_THROW(snode = snodeNetwork(CPubKey(), tier, CPubKey().GetID(), collateral, chainActive.Height(), chainActive.Tip()->GetBlockHash(), sig));
-        BOOST_CHECK_MESSAGE(!snode.isValid(GetTxFunc, IsServiceNodeBlockValidFunc), "Fail on empty snode pubkey");
+        BOOST_CHECK_MESSAGE(!snode.isValid(GetCoinFunc, IsServiceNodeBlockValidFunc), "Fail on empty snode pubkey");
     }
 
     // Fail on empty sighash
@@ -789,7 +864,7 @@ BOOST_AUTO_TEST_CASE(servicenode_tests_misc_checks)
         const auto tier = sn::ServiceNode::Tier::SPV;
         sn::ServiceNode snode;
         BOOST_CHECK_NO_THROW(snode = snodeNetwork(snodePubKey, tier, snodePubKey.GetID(), collateral, chainActive.Height(), chainActive.Tip()->GetBlockHash(), std::vector<unsigned char>()));
-        BOOST_CHECK_MESSAGE(!snode.isValid(GetTxFunc, IsServiceNodeBlockValidFunc), "Fail on empty sighash");
+        BOOST_CHECK_MESSAGE(!snode.isValid(GetCoinFunc, IsServiceNodeBlockValidFunc), "Fail on empty sighash");
     }
 
     // Fail on bad best block
@@ -801,7 +876,7 @@ BOOST_AUTO_TEST_CASE(servicenode_tests_misc_checks)
         // Deserialize servicenode obj from network stream
         sn::ServiceNode snode;
         BOOST_CHECK_NO_THROW(snode = snodeNetwork(snodePubKey, tier, snodePubKey.GetID(), collateral, 0, uint256(), sig));
-        BOOST_CHECK_MESSAGE(!snode.isValid(GetTxFunc, IsServiceNodeBlockValidFunc), "Fail on bad best block");
+        BOOST_CHECK_MESSAGE(!snode.isValid(GetCoinFunc, IsServiceNodeBlockValidFunc), "Fail on bad best block");
     }
 
     // Fail on stale best block (valid but stale block number)
@@ -814,7 +889,7 @@ BOOST_AUTO_TEST_CASE(servicenode_tests_misc_checks)
         // Deserialize servicenode obj from network stream
         sn::ServiceNode snode;
         BOOST_CHECK_NO_THROW(snode = snodeNetwork(snodePubKey, tier, snodePubKey.GetID(), collateral, staleBlockNumber, chainActive[staleBlockNumber]->GetBlockHash(), sig));
-        BOOST_CHECK_MESSAGE(!snode.isValid(GetTxFunc, IsServiceNodeBlockValidFunc), "Fail on stale best block");
+        BOOST_CHECK_MESSAGE(!snode.isValid(GetCoinFunc, IsServiceNodeBlockValidFunc), "Fail on stale best block");
     }
 
     // Fail on best block number being too far into future
@@ -826,7 +901,7 @@ BOOST_AUTO_TEST_CASE(servicenode_tests_misc_checks)
         // Deserialize servicenode obj from network stream
         sn::ServiceNode snode;
         BOOST_CHECK_NO_THROW(snode = snodeNetwork(snodePubKey, tier, snodePubKey.GetID(), collateral, chainActive.Height()+5, chainActive[5]->GetBlockHash(), sig));
-        BOOST_CHECK_MESSAGE(!snode.isValid(GetTxFunc, IsServiceNodeBlockValidFunc), "Fail on best block, unknown block, too far in future");
+        BOOST_CHECK_MESSAGE(!snode.isValid(GetCoinFunc, IsServiceNodeBlockValidFunc), "Fail on best block, unknown block, too far in future");
     }
 
     // Test disabling the stale check on the servicenode validation
@@ -839,7 +914,7 @@ BOOST_AUTO_TEST_CASE(servicenode_tests_misc_checks)
         // Deserialize servicenode obj from network stream
         sn::ServiceNode snode;
         BOOST_CHECK_NO_THROW(snode = snodeNetwork(snodePubKey, tier, snodePubKey.GetID(), collateral, staleBlockNumber, chainActive[staleBlockNumber]->GetBlockHash(), sig));
-        BOOST_CHECK_MESSAGE(snode.isValid(GetTxFunc, IsServiceNodeBlockValidFunc, false), "Fail on disabled stale check");
+        BOOST_CHECK_MESSAGE(snode.isValid(GetCoinFunc, IsServiceNodeBlockValidFunc, false), "Fail on disabled stale check");
     }
 
     // Test case where snode config doesn't exist on disk
@@ -961,6 +1036,63 @@ BOOST_AUTO_TEST_CASE(servicenode_tests_misc_checks)
         sn::ServiceNodeMgr::writeSnConfig(std::vector<sn::ServiceNodeConfigEntry>(), false); // reset
         sn::ServiceNodeMgr::instance().reset();
     }
+
+    // Test snapshots and registrations reusing collateral
+    {
+        const auto tier = sn::ServiceNode::Tier::SPV;
+        auto registerSnode = [&](const CPubKey & pubkey) -> bool {
+            const auto & sighash = sn::ServiceNode::CreateSigHash(pubkey, tier, pubkey.GetID(), collateral, chainActive.Height(), chainActive.Tip()->GetBlockHash());
+            std::vector<unsigned char> sig;
+            BOOST_CHECK(pos.coinbaseKey.SignCompact(sighash, sig));
+            sn::ServiceNode s;
+            BOOST_CHECK_NO_THROW(s = snodeNetwork(pubkey, tier, pubkey.GetID(), collateral, chainActive.Height(), chainActive.Tip()->GetBlockHash(), sig));
+            CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+            ss << s;
+            sn::ServiceNode s2;
+            return smgr.processRegistration(ss, s2);
+        };
+        BOOST_CHECK_MESSAGE(registerSnode(snodePubKey), "snode registration should succeed");
+        const auto snap = smgr.snapshot();
+        BOOST_CHECK_EQUAL(snap->size(), 1);
+        BOOST_CHECK(!smgr.getSn(snodePubKey).isNull());
+
+        // Registering another snode with the same collateral replaces the first snode
+        CKey key2; key2.MakeNewKey(true);
+        BOOST_CHECK_MESSAGE(registerSnode(key2.GetPubKey()), "snode registration with reused collateral should succeed");
+        BOOST_CHECK(smgr.getSn(snodePubKey).isNull());
+        BOOST_CHECK(!smgr.getSn(key2.GetPubKey()).isNull());
+        BOOST_CHECK_EQUAL(smgr.list().size(), 1);
+        // Previous snapshots are unchanged
+        BOOST_CHECK_EQUAL(snap->size(), 1);
+        BOOST_CHECK(snap->count(snodePubKey));
+
+        sn::ServiceNodeMgr::instance().reset();
+        BOOST_CHECK(smgr.list().empty());
+    }
+
+    // Test registrations queued for the servicenode check thread
+    {
+        boost::thread checkThread(&sn::ThreadServiceNodeCheck);
+        const auto tier = sn::ServiceNode::Tier::SPV;
+        const auto & sighash = sn::ServiceNode::CreateSigHash(snodePubKey, tier, snodePubKey.GetID(), collateral, chainActive.Height(), chainActive.Tip()->GetBlockHash());
+        std::vector<unsigned char> sig;
+        BOOST_CHECK(pos.coinbaseKey.SignCompact(sighash, sig));
+        sn::ServiceNode s;
+        BOOST_CHECK_NO_THROW(s = snodeNetwork(snodePubKey, tier, snodePubKey.GetID(), collateral, chainActive.Height(), chainActive.Tip()->GetBlockHash(), sig));
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss << s;
+        CDataStream ss2(ss);
+        std::atomic<bool> added{false};
+        BOOST_CHECK(smgr.queueRegistration(ss, [&added](const sn::ServiceNode & snode) { added = true; }));
+        BOOST_CHECK_MESSAGE(!smgr.queueRegistration(ss2, nullptr), "Duplicate registrations should not be queued");
+        for (int i = 0; i < 200 && !added; ++i)
+            MilliSleep(25);
+        BOOST_CHECK_MESSAGE(added, "Queued registration should be added");
+        BOOST_CHECK(!smgr.getSn(snodePubKey).isNull());
+        checkThread.interrupt();
+        checkThread.join();
+        sn::ServiceNodeMgr::instance().reset();
+    }
 }
 
 /// Check rpc cases
@@ -1431,4 +1563,34 @@ BOOST_AUTO_TEST_CASE(servicenode_tests_rpc)
     gArgs.SoftSetBoolArg("-servicenode", false);
 }
 
+/// Check that configs are parsed again only when they change
+BOOST_FIXTURE_TEST_CASE(servicenode_tests_config_cache, BasicTestingSetup)
+{
+    const std::string config1 = R"({"xbridgeversion":50,"xrouterversion":50,"xbridge":["BLOCK","LTC"],"xrouter":{"config":"[Main]\nwallets=BLOCK\nplugins=\nhost=127.0.0.1", "plugins":{}}})";
+    const std::string config2 = R"({"xbridgeversion":50,"xbridgefeatures":1,"xrouterversion":50,"xbridge":["BTC"],"xrouter":{"config":"[Main]\nwallets=BTC\nplugins=\nhost=127.0.0.2", "plugins":{}}})";
+
+    sn::ServiceNode snode1;
+    snode1.setConfig(config1);
+    BOOST_CHECK(snode1.hasService("BLOCK"));
+    BOOST_CHECK(snode1.hasService(xrouter::walletCommandKey("BLOCK")));
+    BOOST_CHECK_EQUAL(snode1.getXBridgeVersion(), 50u);
+    BOOST_CHECK_EQUAL(snode1.getXBridgeFeatures(), 0u);
+
+    // Same config from the cache
+    sn::ServiceNode snode2;
+    snode2.setConfig(config1);
+    BOOST_CHECK(snode2.getConfigHash() == snode1.getConfigHash());
+    BOOST_CHECK(snode2.serviceList() == snode1.serviceList());
+    BOOST_CHECK_EQUAL(snode2.getHost(), snode1.getHost());
+    BOOST_CHECK_EQUAL(snode2.getXRouterVersion(), 50u);
+
+    // Changed config replaces the services
+    snode2.setConfig(config2);
+    BOOST_CHECK(snode2.getConfigHash() != snode1.getConfigHash());
+    BOOST_CHECK(snode2.hasService("BTC"));
+    BOOST_CHECK(!snode2.hasService("BLOCK"));
+    BOOST_CHECK_EQUAL(snode2.getXBridgeFeatures(), 1u);
+    BOOST_CHECK(snode2.getHost() != snode1.getHost());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
@@ -0,0 +1,104 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <sigbatch.h>
+
+#include <key.h>
+#include <test/test_bitcoin.h>
+
+#include <atomic>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(sigbatch_tests)
+
+// Adds DER signature checks of random hashes to the batch, the checks of the odd indices
+// use a wrong hash or signature. Returns the expected results.
+static std::vector<bool> AddVerifyChecks(CSignatureBatch& batch, const int count)
+{
+    std::vector<bool> expected;
+    for (int i = 0; i < count; ++i) {
+        CKey key;
+        key.MakeNewKey(true);
+        const uint256 hash = InsecureRand256();
+        std::vector<unsigned char> sig;
+        BOOST_REQUIRE(key.Sign(hash, sig));
+        if (i % 2 == 0) {
+            batch.AddVerify(key.GetPubKey(), hash, sig);
+        } else if (i % 4 == 1) {
+            batch.AddVerify(key.GetPubKey(), InsecureRand256(), sig);
+        } else {
+            sig[sig.size() / 2] ^= 1;
+            batch.AddVerify(key.GetPubKey(), hash, sig);
+        }
+        expected.push_back(i % 2 == 0);
+    }
+    return expected;
+}
+
+// Checks the results of verify and recover checks, and of any other checks
+static void CheckBatch()
+{
+    CSignatureBatch batch;
+    BOOST_CHECK(batch.empty());
+    BOOST_CHECK(batch.Verify().empty());
+
+    // Results are returned in the order the checks were added, the batch is empty afterwards
+    std::vector<bool> expected = AddVerifyChecks(batch, 40);
+    BOOST_CHECK_EQUAL(batch.size(), 40U);
+    BOOST_CHECK(batch.Verify() == expected);
+    BOOST_CHECK(batch.empty());
+
+    // A single check
+    expected = AddVerifyChecks(batch, 1);
+    BOOST_CHECK(batch.Verify() == expected);
+    batch.Add([]() { return false; });
+    BOOST_CHECK(batch.Verify() == std::vector<bool>{false});
+
+    // Recovered pubkeys are stored, failed recoveries are reported
+    std::vector<CPubKey> pubkeys(20);
+    std::vector<CPubKey> recovered(pubkeys.size());
+    for (size_t i = 0; i < pubkeys.size(); ++i) {
+        CKey key;
+        key.MakeNewKey(i % 3 != 0);
+        pubkeys[i] = key.GetPubKey();
+        const uint256 hash = InsecureRand256();
+        std::vector<unsigned char> sig;
+        BOOST_REQUIRE(key.SignCompact(hash, sig));
+        if (i == 7)
+            sig.resize(64); // truncated signature
+        batch.AddRecover(hash, sig, &recovered[i]);
+    }
+    const std::vector<bool> results = batch.Verify();
+    BOOST_REQUIRE_EQUAL(results.size(), pubkeys.size());
+    for (size_t i = 0; i < pubkeys.size(); ++i) {
+        BOOST_CHECK_EQUAL(results[i], i != 7);
+        if (i != 7)
+            BOOST_CHECK(recovered[i] == pubkeys[i]);
+    }
+
+    // Other checks run once each, mixed with signature checks
+    std::atomic<int> runs{0};
+    expected = AddVerifyChecks(batch, 10);
+    for (int i = 0; i < 100; ++i) {
+        batch.Add([&runs, i]() { ++runs; return i % 5 != 0; });
+        expected.push_back(i % 5 != 0);
+    }
+    BOOST_CHECK(batch.Verify() == expected);
+    BOOST_CHECK_EQUAL(runs.load(), 100);
+}
+
+BOOST_FIXTURE_TEST_CASE(sigbatch_calling_thread, BasicTestingSetup)
+{
+    // Without signature check threads the checks run on the calling thread
+    CheckBatch();
+}
+
+BOOST_FIXTURE_TEST_CASE(sigbatch_check_threads, TestingSetup)
+{
+    // TestingSetup starts the signature check threads
+    CheckBatch();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -176,4 +176,27 @@ BOOST_AUTO_TEST_CASE(findearliestatleast_edge_test)
     BOOST_CHECK(!chain.FindEarliestAtLeast(int64_t(std::numeric_limits<unsigned int>::max()) + 1));
 }
 
+BOOST_AUTO_TEST_CASE(headerheightindex_test)
+{
+    std::vector<CBlockIndex> vIndex(3);
+    CHeaderHeightIndex headers;
+    BOOST_CHECK(headers.Get(0) == nullptr);
+    BOOST_CHECK(headers.Get(-1) == nullptr);
+    BOOST_CHECK(headers.Get(CHeaderHeightIndex::CHUNK_SIZE * CHeaderHeightIndex::MAX_CHUNKS) == nullptr);
+
+    headers.Set(0, &vIndex[0]);
+    headers.Set(CHeaderHeightIndex::CHUNK_SIZE + 5, &vIndex[1]);
+    BOOST_CHECK(headers.Get(0) == &vIndex[0]);
+    BOOST_CHECK(headers.Get(1) == nullptr);
+    BOOST_CHECK(headers.Get(CHeaderHeightIndex::CHUNK_SIZE + 5) == &vIndex[1]);
+
+    // A reorg replaces the header at a height
+    headers.Set(CHeaderHeightIndex::CHUNK_SIZE + 5, &vIndex[2]);
+    BOOST_CHECK(headers.Get(CHeaderHeightIndex::CHUNK_SIZE + 5) == &vIndex[2]);
+
+    headers.Clear();
+    BOOST_CHECK(headers.Get(0) == nullptr);
+    BOOST_CHECK(headers.Get(CHeaderHeightIndex::CHUNK_SIZE + 5) == nullptr);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,64 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/spentindex.h>
+#include <script/sign.h>
+#include <script/standard.h>
+#include <test/test_bitcoin.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(spentindex_tests)
+
+BOOST_FIXTURE_TEST_CASE(spentindex_initial_sync, TestChain100Setup)
+{
+    g_spentindex = MakeUnique<SpentIndex>(1 << 20, true);
+    g_spentindex->Start();
+
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!g_spentindex->BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+
+    // The coinbases of the setup chain are unspent
+    const COutPoint outpoint(m_coinbase_txns[0]->GetHash(), 0);
+    SpentIndexEntry entry;
+    BOOST_CHECK(!g_spentindex->FindSpend(outpoint, entry));
+
+    const CScript scriptPubKey = GetScriptForDestination(coinbaseKey.GetPubKey().GetID());
+    CBasicKeyStore keystore;
+    keystore.AddKey(coinbaseKey);
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    mtx.vin[0] = CTxIn(outpoint);
+    mtx.vout.resize(1);
+    mtx.vout[0] = CTxOut(m_coinbase_txns[0]->vout[0].nValue - COIN, scriptPubKey);
+    const CTxOut& prevout = m_coinbase_txns[0]->vout[0];
+    SignatureData sigdata = DataFromTransaction(mtx, 0, prevout);
+    BOOST_CHECK(ProduceSignature(keystore, MutableTransactionSignatureCreator(&mtx, 0, prevout.nValue, SIGHASH_ALL), prevout.scriptPubKey, sigdata));
+    UpdateInput(mtx.vin[0], sigdata);
+    const CBlock block = CreateAndProcessBlock({mtx}, scriptPubKey);
+    BOOST_CHECK(g_spentindex->BlockUntilSyncedToCurrentChain());
+
+    BOOST_REQUIRE(g_spentindex->FindSpend(outpoint, entry));
+    BOOST_CHECK(entry.txid == mtx.GetHash());
+    BOOST_CHECK_EQUAL(entry.index, 0u);
+    BOOST_CHECK(entry.block_hash == block.GetHash());
+    {
+        LOCK(cs_main);
+        BOOST_CHECK_EQUAL(entry.height, chainActive.Height());
+    }
+
+    g_spentindex->Stop();
+    g_spentindex.reset();
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
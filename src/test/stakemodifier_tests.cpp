@@ -0,0 +1,217 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <kernel.h>
+
+#include <arith_uint256.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <hash.h>
+#include <streams.h>
+#include <test/test_bitcoin.h>
+
+#include <algorithm>
+#include <deque>
+#include <set>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(stakemodifier_tests, BasicTestingSetup)
+
+// The stake modifier selection as it was before the candidates were carried forward between
+// blocks: the selection interval is walked and sorted again for every modifier and every
+// candidate is hashed again in each selection round.
+static int64_t ReferenceSelectionIntervalSection(int nSection)
+{
+    return getIntervalVersion(false) * 63 / (63 + ((63 - nSection) * (MODIFIER_INTERVAL_RATIO - 1)));
+}
+
+static bool ReferenceSelectBlock(const std::vector<const CBlockIndex*>& vSortedByTimestamp,
+                                 const std::set<const CBlockIndex*>& setSelected,
+                                 int64_t nSelectionIntervalStop, uint64_t nStakeModifierPrev,
+                                 const CBlockIndex** pindexSelected)
+{
+    const bool fModifierV2 = vSortedByTimestamp.front()->nHeight >= Params().GetConsensus().stakingModiferV2Block;
+    const bool fModifierV3 = IsProtocolV05(vSortedByTimestamp.front()->GetBlockTime());
+    bool fSelected = false;
+    arith_uint256 hashBest = 0;
+    *pindexSelected = nullptr;
+    for (const CBlockIndex* pindex : vSortedByTimestamp) {
+        if (fSelected && pindex->GetBlockTime() > nSelectionIntervalStop)
+            break;
+        if (setSelected.count(pindex) > 0)
+            continue;
+
+        uint256 hashProof;
+        if (fModifierV3)
+            hashProof = pindex->hashProofOfStake;
+        else if (fModifierV2)
+            hashProof = pindex->GetBlockHash();
+        else
+            hashProof = IsProofOfStake(pindex->nHeight) ? ArithToUint256(0) : pindex->GetBlockHash();
+
+        CDataStream ss(SER_GETHASH, 0);
+        ss << hashProof << nStakeModifierPrev;
+        arith_uint256 hashSelection = UintToArith256(Hash(ss.begin(), ss.end()));
+        if (IsProofOfStake(pindex->nHeight))
+            hashSelection >>= 32;
+
+        if (!fSelected || hashSelection < hashBest) {
+            fSelected = true;
+            hashBest = hashSelection;
+            *pindexSelected = pindex;
+        }
+    }
+    return fSelected;
+}
+
+static uint64_t ReferenceStakeModifier(const CBlockIndex* pindexPrev, bool& fGenerated)
+{
+    const int64_t nInterval = getIntervalVersion(false);
+    const CBlockIndex* pindex = pindexPrev;
+    while (pindex->pprev && !pindex->GeneratedStakeModifier())
+        pindex = pindex->pprev;
+    const uint64_t nStakeModifier = pindex->nStakeModifier;
+    fGenerated = false;
+    if (pindex->GetBlockTime() / nInterval >= pindexPrev->GetBlockTime() / nInterval)
+        return nStakeModifier;
+
+    int64_t nSelectionInterval = 0;
+    for (int nSection = 0; nSection < 64; nSection++)
+        nSelectionInterval += ReferenceSelectionIntervalSection(nSection);
+    const int64_t nSelectionIntervalStart = (pindexPrev->GetBlockTime() / nInterval) * nInterval - nSelectionInterval;
+
+    std::vector<const CBlockIndex*> vSortedByTimestamp;
+    for (pindex = pindexPrev; pindex && pindex->GetBlockTime() >= nSelectionIntervalStart; pindex = pindex->pprev)
+        vSortedByTimestamp.push_back(pindex);
+    std::reverse(vSortedByTimestamp.begin(), vSortedByTimestamp.end());
+    std::sort(vSortedByTimestamp.begin(), vSortedByTimestamp.end(),
+              [](const CBlockIndex* a, const CBlockIndex* b) -> bool {
+                  if (a->GetBlockTime() == b->GetBlockTime())
+                      return UintToArith256(a->GetBlockHash()) < UintToArith256(b->GetBlockHash());
+                  return a->GetBlockTime() < b->GetBlockTime();
+              });
+
+    uint64_t nStakeModifierNew = 0;
+    int64_t nSelectionIntervalStop = nSelectionIntervalStart;
+    std::set<const CBlockIndex*> setSelected;
+    for (int nRound = 0; nRound < std::min(64, (int)vSortedByTimestamp.size()); nRound++) {
+        nSelectionIntervalStop += ReferenceSelectionIntervalSection(nRound);
+        const CBlockIndex* pindexSelected;
+        BOOST_REQUIRE(ReferenceSelectBlock(vSortedByTimestamp, setSelected, nSelectionIntervalStop, nStakeModifier, &pindexSelected));
+        if (pindexSelected->GetStakeEntropyBit())
+            nStakeModifierNew |= 1ULL << nRound;
+        setSelected.insert(pindexSelected);
+    }
+    fGenerated = true;
+    return nStakeModifierNew;
+}
+
+// Block indexes of the test chains, the deques keep the pointers valid
+struct ModifierTestChains {
+    std::deque<CBlockIndex> blocks;
+    std::deque<uint256> hashes;
+    int nGenerated{0};
+
+    ModifierTestChains() {
+        hashes.push_back(InsecureRand256());
+        blocks.emplace_back();
+        CBlockIndex& genesis = blocks.back();
+        genesis.phashBlock = &hashes.back();
+        genesis.nHeight = 0;
+        genesis.nTime = Params().GetConsensus().stakingV05UpgradeTime - 1000 * 40;
+        genesis.SetStakeModifier(0, true);
+    }
+
+    CBlockIndex* Genesis() { return &blocks.front(); }
+
+    // Adds a child of pindexPrev with a timestamp around nSpacing after its parent, up to
+    // nSpacing * 5 earlier or later, or the parent's timestamp, and checks that its stake
+    // modifier is the one of the reference selection
+    CBlockIndex* Extend(CBlockIndex* pindexPrev, const int64_t nSpacing) {
+        hashes.push_back(InsecureRand256());
+        blocks.emplace_back();
+        CBlockIndex* pindex = &blocks.back();
+        pindex->phashBlock = &hashes.back();
+        pindex->pprev = pindexPrev;
+        pindex->nHeight = pindexPrev->nHeight + 1;
+        if (InsecureRandRange(8) == 0)
+            pindex->nTime = pindexPrev->nTime;
+        else
+            pindex->nTime = pindexPrev->nTime + nSpacing - nSpacing * 5 + InsecureRandRange(nSpacing * 10 + 1);
+        pindex->hashProofOfStake = InsecureRand256();
+        pindex->SetStakeEntropyBit(InsecureRandBool() ? 1 : 0);
+        pindex->BuildSkip();
+
+        uint64_t nStakeModifier = 0;
+        bool fGenerated = false;
+        BOOST_REQUIRE(ComputeNextStakeModifier(pindexPrev, nStakeModifier, fGenerated));
+        if (pindexPrev->nHeight > 0) {
+            // the first modifier is a constant of kernel.cpp
+            bool fGeneratedReference = false;
+            const uint64_t nStakeModifierReference = ReferenceStakeModifier(pindexPrev, fGeneratedReference);
+            BOOST_CHECK_EQUAL(fGenerated, fGeneratedReference);
+            BOOST_CHECK_EQUAL(nStakeModifier, nStakeModifierReference);
+        }
+        if (fGenerated)
+            ++nGenerated;
+        pindex->SetStakeModifier(nStakeModifier, fGenerated);
+        return pindex;
+    }
+
+    CBlockIndex* Extend(CBlockIndex* pindexPrev, const int64_t nSpacing, const int nBlocks) {
+        for (int i = 0; i < nBlocks; ++i)
+            pindexPrev = Extend(pindexPrev, nSpacing);
+        return pindexPrev;
+    }
+};
+
+BOOST_AUTO_TEST_CASE(stakemodifier_nonmonotonic_times)
+{
+    ClearStakeModifierCache();
+    ModifierTestChains chains;
+
+    // The chain crosses the modifier v05 upgrade time and the last proof-of-work block
+    const int nBlocks = Params().GetConsensus().lastPOWBlock + 200;
+    CBlockIndex* pindexTip = chains.Extend(chains.Genesis(), 40, nBlocks);
+    BOOST_CHECK(IsProtocolV05(pindexTip->GetBlockTime()));
+    BOOST_CHECK(chains.nGenerated > nBlocks / 4);
+
+    // Blocks further apart than the selection interval and bursts of blocks
+    pindexTip = chains.Extend(pindexTip, GetStakeModifierSelectionInterval(), 10);
+    pindexTip = chains.Extend(pindexTip, 2, 200);
+    chains.Extend(pindexTip, 40, 50);
+
+    ClearStakeModifierCache();
+}
+
+BOOST_AUTO_TEST_CASE(stakemodifier_reorg)
+{
+    ClearStakeModifierCache();
+    ModifierTestChains chains;
+
+    CBlockIndex* pindexMain = chains.Extend(chains.Genesis(), 40, Params().GetConsensus().lastPOWBlock + 100);
+    CBlockIndex* pindexFork = pindexMain->GetAncestor(pindexMain->nHeight - 30);
+
+    // A short fork, then the old chain is extended again (disconnect and reconnect)
+    pindexFork = chains.Extend(pindexFork, 40, 40);
+    pindexMain = chains.Extend(pindexMain, 40, 20);
+
+    // Both chains extended in turns
+    for (int i = 0; i < 30; ++i) {
+        pindexFork = chains.Extend(pindexFork, 30);
+        pindexMain = chains.Extend(pindexMain, 50);
+    }
+
+    // A fork deeper than the selection interval, back across the last proof-of-work block
+    CBlockIndex* pindexDeep = pindexMain->GetAncestor(Params().GetConsensus().lastPOWBlock - 50);
+    pindexDeep = chains.Extend(pindexDeep, 40, 150);
+    chains.Extend(pindexMain, 40, 20);
+    chains.Extend(pindexDeep, 40, 20);
+
+    ClearStakeModifierCache();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -166,7 +166,7 @@ struct TestChainPoS : public TestingSetup {
         }
     }
 
-    const StakeMgr::StakeCoin & FindStake() {
+    StakeMgr::StakeCoin FindStake() {
         int tries{0};
         const int currentBlockHeight = chainActive.Height();
         while (chainActive.Height() < currentBlockHeight + 1) {
@@ -190,7 +190,7 @@ struct TestChainPoS : public TestingSetup {
                 throw std::runtime_error("Staker failed to find stake");
             SetMockTime(staker.LastUpdateTime() + MAX_FUTURE_BLOCK_TIME_POS);
         }
-        return std::move(StakeMgr::StakeCoin{});
+        return StakeMgr::StakeCoin{};
     }
 
     ~TestChainPoS() {
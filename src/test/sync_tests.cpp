@@ -4,6 +4,10 @@
 
 #include <sync.h>
 #include <test/test_bitcoin.h>
+#include <util/time.h>
+
+#include <atomic>
+#include <thread>
 
 #include <boost/test/unit_test.hpp>
 
@@ -49,4 +53,46 @@ BOOST_AUTO_TEST_CASE(potential_deadlock_detected)
     #endif
 }
 
+BOOST_AUTO_TEST_CASE(lock_profiler)
+{
+    const unsigned int prev = g_lock_profile_sample.exchange(1);
+    ResetLockStats();
+
+    Mutex mutex;
+    std::atomic<bool> locked{false};
+    std::thread holder([&] {
+        LOCK(mutex);
+        locked = true;
+        MilliSleep(20);
+    });
+    while (!locked)
+        std::this_thread::yield();
+    const int wait_line = __LINE__ + 1;
+    { LOCK(mutex); }
+    holder.join();
+
+    bool found_wait = false, found_hold = false;
+    for (const LockStats& stats : GetLockStats()) {
+        if (stats.name != "mutex" || stats.file != __FILE__)
+            continue;
+        if (stats.line == wait_line) {
+            found_wait = true;
+            BOOST_CHECK_EQUAL(stats.contentions, 1U);
+            BOOST_CHECK(stats.wait_ns > 0);
+            BOOST_CHECK_EQUAL(stats.samples, 1U);
+        } else {
+            // The holder thread exited, its stats are kept
+            found_hold = true;
+            BOOST_CHECK_EQUAL(stats.contentions, 0U);
+            BOOST_CHECK_EQUAL(stats.samples, 1U);
+            BOOST_CHECK(stats.max_hold_ns >= 20 * 1000 * 1000U);
+        }
+    }
+    BOOST_CHECK(found_wait);
+    BOOST_CHECK(found_hold);
+
+    ResetLockStats();
+    g_lock_profile_sample = prev;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,79 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/tradeindex.h>
+#include <script/sign.h>
+#include <script/standard.h>
+#include <test/test_bitcoin.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(tradeindex_tests)
+
+BOOST_FIXTURE_TEST_CASE(tradeindex_initial_sync, TestChain100Setup)
+{
+    g_tradeindex = MakeUnique<TradeIndex>(1 << 20, true);
+    g_tradeindex->Start();
+
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!g_tradeindex->BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+
+    // No trades in the coinbase only chain
+    std::vector<TradeRecord> trades;
+    BOOST_CHECK(g_tradeindex->FindTradesByHeight(0, trades));
+    BOOST_CHECK(trades.empty());
+
+    // Fee transaction with the order data in an OP_RETURN output
+    const CScript scriptPubKey = GetScriptForDestination(coinbaseKey.GetPubKey().GetID());
+    const std::string json = R"(["xid","BLOCK",100000000,"LTC",200000000])";
+    CBasicKeyStore keystore;
+    keystore.AddKey(coinbaseKey);
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    mtx.vin[0] = CTxIn(COutPoint(m_coinbase_txns[0]->GetHash(), 0));
+    mtx.vout.resize(2);
+    mtx.vout[0] = CTxOut(0, CScript() << OP_RETURN << std::vector<unsigned char>(json.begin(), json.end()));
+    mtx.vout[1] = CTxOut(m_coinbase_txns[0]->vout[0].nValue - COIN, scriptPubKey);
+    const CTxOut& prevout = m_coinbase_txns[0]->vout[0];
+    SignatureData sigdata = DataFromTransaction(mtx, 0, prevout);
+    BOOST_CHECK(ProduceSignature(keystore, MutableTransactionSignatureCreator(&mtx, 0, prevout.nValue, SIGHASH_ALL), prevout.scriptPubKey, sigdata));
+    UpdateInput(mtx.vin[0], sigdata);
+    const CBlock block = CreateAndProcessBlock({mtx}, scriptPubKey);
+    BOOST_CHECK(g_tradeindex->BlockUntilSyncedToCurrentChain());
+
+    int height{0};
+    {
+        LOCK(cs_main);
+        height = chainActive.Height();
+    }
+    BOOST_REQUIRE(g_tradeindex->FindTradesByHeight(height, trades));
+    BOOST_REQUIRE_EQUAL(trades.size(), 1u);
+    BOOST_CHECK_EQUAL(trades[0].height, height);
+    BOOST_CHECK(trades[0].txid == mtx.GetHash());
+    BOOST_CHECK_EQUAL(trades[0].tag, TradeRecord::TRADE_VALID);
+    BOOST_CHECK_EQUAL(trades[0].xidOrError, "xid");
+    BOOST_CHECK_EQUAL(trades[0].fromCurrency, "BLOCK");
+    BOOST_CHECK_EQUAL(trades[0].toCurrency, "LTC");
+
+    std::vector<TradeRecord> byTime;
+    BOOST_CHECK(g_tradeindex->FindTradesByTime(block.GetBlockTime(), block.GetBlockTime() + 1, byTime));
+    BOOST_CHECK_EQUAL(byTime.size(), 1u);
+    byTime.clear();
+    BOOST_CHECK(g_tradeindex->FindTradesByTime(0, block.GetBlockTime(), byTime));
+    BOOST_CHECK(byTime.empty());
+
+    g_tradeindex->Stop();
+    g_tradeindex.reset();
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
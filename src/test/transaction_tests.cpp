@@ -281,6 +281,36 @@ BOOST_AUTO_TEST_CASE(basic_transaction_tests)
     BOOST_CHECK_MESSAGE(!CheckTransaction(CTransaction(tx), state) || !state.IsValid(), "Transaction with duplicate txins should be invalid.");
 }
 
+BOOST_AUTO_TEST_CASE(deserialized_transaction_hashes)
+{
+    CMutableTransaction mtx;
+    mtx.nVersion = 2;
+    mtx.nLockTime = 17;
+    mtx.vin.resize(2);
+    mtx.vin[0].prevout = COutPoint(InsecureRand256(), 3);
+    mtx.vin[0].scriptSig = CScript() << OP_1 << std::vector<unsigned char>(70, 0x42);
+    mtx.vin[1].prevout = COutPoint(InsecureRand256(), 0);
+    mtx.vout.resize(1);
+    mtx.vout[0].nValue = 5 * CENT;
+    mtx.vout[0].scriptPubKey = CScript() << OP_TRUE;
+
+    // Without and with witnesses, read from streams that allow and don't allow them
+    for (int i = 0; i < 2; ++i) {
+        if (i == 1)
+            mtx.vin[1].scriptWitness.stack = {std::vector<unsigned char>(33, 0x02), std::vector<unsigned char>(72, 0x30)};
+        for (const int version : {PROTOCOL_VERSION, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS}) {
+            CDataStream ss(SER_NETWORK, version);
+            ss << mtx;
+            CTransaction tx(deserialize, ss);
+            const CTransaction expected(CMutableTransaction{tx});
+            BOOST_CHECK(tx.GetHash() == expected.GetHash());
+            BOOST_CHECK(tx.GetWitnessHash() == expected.GetWitnessHash());
+            BOOST_CHECK(tx.GetHash() == mtx.GetHash());
+            BOOST_CHECK_EQUAL(tx.HasWitness(), i == 1 && version == PROTOCOL_VERSION);
+        }
+    }
+}
+
 //
 // Helper: create two dummy transactions, each with
 // two outputs.  The first has 11 and 50 CENT outputs
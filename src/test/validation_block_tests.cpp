@@ -121,6 +121,22 @@ void BuildChain(const uint256& root, int height, const unsigned int invalid_rate
     }
 }
 
+BOOST_AUTO_TEST_CASE(block_header_hashes)
+{
+    // Enough headers for several checks on the signature check threads
+    std::vector<CBlockHeader> headers(4 * MIN_HEADERS_PER_HASH_THREAD + 1);
+    for (CBlockHeader& header : headers) {
+        header.hashPrevBlock = InsecureRand256();
+        header.nTime = InsecureRand32();
+        header.nNonce = InsecureRand32();
+    }
+    const std::vector<uint256> hashes = GetBlockHeaderHashes(headers);
+    BOOST_CHECK_EQUAL(hashes.size(), headers.size());
+    for (size_t i = 0; i < headers.size(); ++i)
+        BOOST_CHECK(hashes[i] == headers[i].GetHash());
+    BOOST_CHECK(GetBlockHeaderHashes({}).empty());
+}
+
 BOOST_AUTO_TEST_CASE(processnewblock_signals_ordering)
 {
     auto *params = (CChainParams*)&Params();
@@ -0,0 +1,96 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <primitives/block.h>
+#include <scheduler.h>
+#include <test/test_bitcoin.h>
+#include <validationinterface.h>
+
+#include <chrono>
+#include <future>
+#include <thread>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(validationinterface_tests, TestingSetup)
+
+struct FlushSubscriber : public CValidationInterface {
+    std::atomic<int> m_flushed{0};
+    std::shared_future<void> m_release;
+
+    void ChainStateFlushed(const CBlockLocator& locator) override
+    {
+        if (m_release.valid())
+            m_release.wait();
+        ++m_flushed;
+    }
+
+    std::string GetSubscriberName() const override { return m_release.valid() ? "slow" : "fast"; }
+};
+
+BOOST_AUTO_TEST_CASE(subscriber_lanes)
+{
+    // A second scheduler thread lets the lanes of the two subscribers run at the same time
+    threadGroup.create_thread(std::bind(&CScheduler::serviceQueue, &scheduler));
+
+    std::promise<void> release;
+    FlushSubscriber slow, fast;
+    slow.m_release = release.get_future().share();
+    RegisterValidationInterface(&slow);
+    RegisterValidationInterface(&fast);
+
+    const CBlockLocator locator;
+    GetMainSignals().ChainStateFlushed(locator);
+    GetMainSignals().ChainStateFlushed(locator);
+
+    // The blocked subscriber does not hold back the other one
+    for (int i = 0; i < 500 && fast.m_flushed < 2; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    BOOST_CHECK_EQUAL(fast.m_flushed, 2);
+    BOOST_CHECK_EQUAL(slow.m_flushed, 0);
+
+    // Syncing waits for every subscriber
+    release.set_value();
+    SyncWithValidationInterfaceQueue();
+    BOOST_CHECK_EQUAL(slow.m_flushed, 2);
+
+    // Callbacks queued for an unregistered subscriber are dropped
+    UnregisterValidationInterface(&slow);
+    GetMainSignals().ChainStateFlushed(locator);
+    SyncWithValidationInterfaceQueue();
+    BOOST_CHECK_EQUAL(slow.m_flushed, 2);
+    BOOST_CHECK_EQUAL(fast.m_flushed, 3);
+
+    UnregisterValidationInterface(&fast);
+}
+
+BOOST_AUTO_TEST_CASE(subscriber_stats)
+{
+    FlushSubscriber fast;
+    RegisterValidationInterface(&fast);
+
+    const CBlockLocator locator;
+    GetMainSignals().ChainStateFlushed(locator);
+    GetMainSignals().ChainStateFlushed(locator);
+    SyncWithValidationInterfaceQueue();
+
+    std::vector<ValidationInterfaceStats> stats = GetMainSignals().GetSubscriberStats(/* reset */ true);
+    BOOST_REQUIRE_EQUAL(stats.size(), 1U);
+    BOOST_CHECK_EQUAL(stats[0].name, "fast");
+    BOOST_CHECK_EQUAL(stats[0].pending, 0U);
+    BOOST_REQUIRE_EQUAL(stats[0].callbacks.size(), 1U);
+    BOOST_CHECK_EQUAL(stats[0].callbacks[0].first, "ChainStateFlushed");
+    BOOST_CHECK_EQUAL(stats[0].callbacks[0].second.calls, 2U);
+    BOOST_CHECK(stats[0].callbacks[0].second.max_run_micros <= stats[0].callbacks[0].second.run_micros);
+
+    // Reset while reading
+    stats = GetMainSignals().GetSubscriberStats();
+    BOOST_REQUIRE_EQUAL(stats.size(), 1U);
+    BOOST_CHECK(stats[0].callbacks.empty());
+
+    UnregisterValidationInterface(&fast);
+    BOOST_CHECK(GetMainSignals().GetSubscriberStats().empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
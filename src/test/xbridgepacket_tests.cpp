@@ -0,0 +1,81 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <xbridge/xbridgepacket.h>
+
+#include <test/test_bitcoin.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(xbridgepacket_tests, BasicTestingSetup)
+
+static XBridgePacket heartbeat(const uint32_t count, const size_t ids)
+{
+    XBridgePacket packet(xbcOrderHeartbeat);
+    packet.append(count);
+    for (size_t i = 0; i < ids; ++i) {
+        const uint256 id = InsecureRand256();
+        packet.append(id.begin(), 32);
+    }
+    return packet;
+}
+
+BOOST_AUTO_TEST_CASE(order_heartbeat)
+{
+    std::vector<uint256> ids;
+
+    XBridgePacket packet(xbcOrderHeartbeat);
+    packet.append(static_cast<uint32_t>(2));
+    const uint256 id1 = InsecureRand256();
+    const uint256 id2 = InsecureRand256();
+    packet.append(id1.begin(), 32);
+    packet.append(id2.begin(), 32);
+    BOOST_CHECK(parseOrderHeartbeat(packet, ids));
+    BOOST_CHECK_EQUAL(ids.size(), 2U);
+    BOOST_CHECK(ids[0] == id1);
+    BOOST_CHECK(ids[1] == id2);
+
+    XBridgePacket max = heartbeat(XBRIDGE_MAX_HEARTBEAT_ORDERS, XBRIDGE_MAX_HEARTBEAT_ORDERS);
+    BOOST_CHECK(parseOrderHeartbeat(max, ids));
+    BOOST_CHECK_EQUAL(ids.size(), XBRIDGE_MAX_HEARTBEAT_ORDERS);
+}
+
+BOOST_AUTO_TEST_CASE(order_heartbeat_malformed)
+{
+    std::vector<uint256> ids{InsecureRand256()};
+
+    // count cut off
+    XBridgePacket empty(xbcOrderHeartbeat);
+    BOOST_CHECK(!parseOrderHeartbeat(empty, ids));
+    BOOST_CHECK(ids.empty());
+    XBridgePacket truncated(xbcOrderHeartbeat);
+    truncated.append(static_cast<uint16_t>(1));
+    BOOST_CHECK(!parseOrderHeartbeat(truncated, ids));
+
+    // no orders
+    XBridgePacket zero = heartbeat(0, 0);
+    BOOST_CHECK(!parseOrderHeartbeat(zero, ids));
+
+    // count doesn't match the ids
+    XBridgePacket fewer = heartbeat(3, 2);
+    BOOST_CHECK(!parseOrderHeartbeat(fewer, ids));
+    XBridgePacket more = heartbeat(1, 2);
+    BOOST_CHECK(!parseOrderHeartbeat(more, ids));
+    XBridgePacket partial = heartbeat(1, 1);
+    partial.append(static_cast<uint16_t>(0));
+    BOOST_CHECK(!parseOrderHeartbeat(partial, ids));
+
+    // 4 + count * 32 wraps around to 4 in 32 bits
+    XBridgePacket wrapped = heartbeat(0x08000000, 0);
+    BOOST_CHECK(!parseOrderHeartbeat(wrapped, ids));
+    XBridgePacket wrapped1 = heartbeat(0x08000001, 1);
+    BOOST_CHECK(!parseOrderHeartbeat(wrapped1, ids));
+
+    // too many orders for one heartbeat
+    XBridgePacket over = heartbeat(XBRIDGE_MAX_HEARTBEAT_ORDERS + 1, XBRIDGE_MAX_HEARTBEAT_ORDERS + 1);
+    BOOST_CHECK(!parseOrderHeartbeat(over, ids));
+    BOOST_CHECK(ids.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,156 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <xbridge/util/timingwheel.h>
+
+#include <test/test_bitcoin.h>
+
+#include <algorithm>
+#include <map>
+#include <set>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(xbridgetimingwheel_tests, BasicTestingSetup)
+
+static std::set<int> Expire(xbridge::TimingWheel<int> & wheel, const int64_t now)
+{
+    const std::vector<int> keys = wheel.advance(now);
+    const std::set<int> expired(keys.begin(), keys.end());
+    BOOST_CHECK_EQUAL(expired.size(), keys.size()); // a key expires once
+    return expired;
+}
+
+BOOST_AUTO_TEST_CASE(timingwheel_expiry_order)
+{
+    xbridge::TimingWheel<int> wheel;
+    wheel.advance(1000);
+
+    // Deadlines in the first slots, across the first level and in the levels above
+    const std::vector<int64_t> deadlines{1001, 1002, 1002, 1063, 1064, 1065, 1100, 5000, 1000 + 64 * 64 + 1};
+    for (size_t i = 0; i < deadlines.size(); ++i)
+        wheel.schedule(static_cast<int>(i), deadlines[i]);
+    BOOST_CHECK_EQUAL(wheel.size(), deadlines.size());
+
+    // Each key expires at its deadline, not before
+    for (int64_t now = 1001; now <= 1000 + 64 * 64 + 1; ++now) {
+        std::set<int> expected;
+        for (size_t i = 0; i < deadlines.size(); ++i) {
+            if (deadlines[i] == now)
+                expected.insert(static_cast<int>(i));
+        }
+        BOOST_CHECK(Expire(wheel, now) == expected);
+    }
+    BOOST_CHECK_EQUAL(wheel.size(), 0U);
+
+    // Keys that are due when scheduled expire on the next advance
+    wheel.schedule(1, 10);
+    wheel.schedule(2, 6000);
+    BOOST_CHECK(Expire(wheel, 5300) == std::set<int>{1});
+    BOOST_CHECK(wheel.has(2));
+
+    // Advancing over several ticks expires all the keys in between
+    wheel.schedule(3, 5500);
+    wheel.schedule(4, 5900);
+    BOOST_CHECK(Expire(wheel, 5899) == std::set<int>{3});
+    BOOST_CHECK(Expire(wheel, 6000) == (std::set<int>{2, 4}));
+}
+
+BOOST_AUTO_TEST_CASE(timingwheel_wrap_around)
+{
+    // The wheel against a map of the deadlines, with deadlines in every level, in the
+    // overflow list and around the slot boundaries of each level
+    xbridge::TimingWheel<int> wheel;
+    std::map<int, int64_t> reference;
+    int64_t now = (int64_t(1) << 24) - 70;
+    wheel.advance(now);
+
+    const std::vector<int64_t> spans{1, 63, 64, 65, 64 * 64 - 1, 64 * 64, 64 * 64 + 1,
+                                     64 * 64 * 64, int64_t(1) << 24, (int64_t(1) << 24) + 5};
+    for (int round = 0; round < 2000; ++round) {
+        const int key = static_cast<int>(InsecureRandRange(500));
+        const int64_t span = spans[InsecureRandRange(spans.size())];
+        const int64_t when = now + static_cast<int64_t>(InsecureRandRange(span + 1)) - 2;
+        wheel.schedule(key, when);
+        reference[key] = when;
+
+        // Mostly single ticks, sometimes a jump across a slot of a higher level
+        const uint64_t step = InsecureRandRange(10) == 0 ? InsecureRandRange(64 * 64 * 2) : InsecureRandRange(3);
+        now += static_cast<int64_t>(step);
+        std::set<int> expected;
+        for (auto it = reference.begin(); it != reference.end(); ) {
+            if (it->second <= now) {
+                expected.insert(it->first);
+                it = reference.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        BOOST_CHECK(Expire(wheel, now) == expected);
+        BOOST_CHECK_EQUAL(wheel.size(), reference.size());
+    }
+
+    // A jump past all the slots of the wheel
+    now += int64_t(1) << 25;
+    BOOST_CHECK_EQUAL(Expire(wheel, now).size(), reference.size());
+    BOOST_CHECK_EQUAL(wheel.size(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(timingwheel_cancel)
+{
+    xbridge::TimingWheel<int> wheel;
+    wheel.schedule(1, 10);
+    wheel.schedule(2, 10);
+    wheel.schedule(3, 500);
+    wheel.schedule(4, 100000);
+
+    BOOST_CHECK(wheel.cancel(2));
+    BOOST_CHECK(!wheel.cancel(2));
+    BOOST_CHECK(!wheel.cancel(5));
+    BOOST_CHECK(!wheel.has(2));
+    BOOST_CHECK(wheel.cancel(3));
+    BOOST_CHECK(wheel.cancel(4));
+    BOOST_CHECK_EQUAL(wheel.size(), 1U);
+
+    // Cancelled keys don't expire
+    BOOST_CHECK(Expire(wheel, 10) == std::set<int>{1});
+    BOOST_CHECK(Expire(wheel, 200000).empty());
+    BOOST_CHECK_EQUAL(wheel.size(), 0U);
+
+    // A cancelled key can be scheduled again
+    wheel.schedule(2, 200010);
+    BOOST_CHECK(Expire(wheel, 200010) == std::set<int>{2});
+}
+
+BOOST_AUTO_TEST_CASE(timingwheel_reschedule)
+{
+    xbridge::TimingWheel<int> wheel;
+    wheel.schedule(1, 100);
+    wheel.schedule(2, 100);
+    wheel.schedule(3, 5000);
+
+    // Later and earlier deadlines replace the first one
+    wheel.schedule(1, 300);
+    wheel.schedule(3, 50);
+    BOOST_CHECK_EQUAL(wheel.size(), 3U);
+    BOOST_CHECK(Expire(wheel, 50) == std::set<int>{3});
+    BOOST_CHECK(Expire(wheel, 100) == std::set<int>{2});
+    BOOST_CHECK(Expire(wheel, 299).empty());
+    BOOST_CHECK(Expire(wheel, 300) == std::set<int>{1});
+
+    // Rescheduling back to an earlier deadline expires the key once
+    wheel.schedule(1, 400);
+    wheel.schedule(1, 6000);
+    wheel.schedule(1, 400);
+    BOOST_CHECK(Expire(wheel, 400) == std::set<int>{1});
+    BOOST_CHECK(Expire(wheel, 7000).empty());
+
+    // Rescheduling a key that is due pushes it out
+    wheel.schedule(2, 7000);
+    wheel.schedule(2, 7100);
+    BOOST_CHECK(Expire(wheel, 7050).empty());
+    BOOST_CHECK(Expire(wheel, 7100) == std::set<int>{2});
+}
+
+BOOST_AUTO_TEST_SUITE_END()
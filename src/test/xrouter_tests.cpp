@@ -0,0 +1,134 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <xrouter/xrouterdef.h>
+#include <xrouter/xrouterutils.h>
+
+#include <key.h>
+#include <script/interpreter.h>
+#include <script/standard.h>
+
+#include <test/test_bitcoin.h>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace xrouter;
+
+BOOST_FIXTURE_TEST_SUITE(xrouter_tests, BasicTestingSetup)
+
+namespace {
+
+struct Channel {
+    CKey clientKey;
+    CKey snodeKey;
+    CScript redeemScript;
+    CTxOut funding;
+
+    Channel() {
+        clientKey.MakeNewKey(true);
+        snodeKey.MakeNewKey(true);
+        redeemScript = paymentChannelScript(clientKey.GetPubKey(), snodeKey.GetPubKey(), 1000);
+        funding = CTxOut(COIN, GetScriptForDestination(CScriptID(redeemScript)));
+    }
+
+    // update paying the service node, signed by the client
+    CMutableTransaction update(const CAmount & paid, const CAmount & change) const {
+        CMutableTransaction tx;
+        tx.vin.emplace_back(COutPoint(InsecureRand256(), 0));
+        tx.vout.emplace_back(paid, GetScriptForDestination(snodeKey.GetPubKey().GetID()));
+        if (change != 0)
+            tx.vout.emplace_back(change, GetScriptForDestination(clientKey.GetPubKey().GetID()));
+        sign(tx);
+        return tx;
+    }
+
+    void sign(CMutableTransaction & tx, const bool padR = false) const {
+        const uint256 hash = SignatureHash(redeemScript, tx, 0, SIGHASH_ALL, 0, SigVersion::BASE);
+        std::vector<unsigned char> sig;
+        BOOST_CHECK(clientKey.Sign(hash, sig));
+        if (padR) {
+            // leading zero in R, accepted by the lax parser but not DER
+            sig.insert(sig.begin() + 4, 0x00);
+            ++sig[1];
+            ++sig[3];
+        }
+        sig.push_back(static_cast<unsigned char>(SIGHASH_ALL));
+        tx.vin[0].scriptSig = CScript() << sig << OP_0 << OP_TRUE << ToByteVector(redeemScript);
+    }
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(payment_channel_update)
+{
+    const Channel ch;
+    const CMutableTransaction tx = ch.update(COIN/10, COIN - COIN/10 - XROUTER_CHANNEL_TXFEE);
+    CScript redeemScript;
+    BOOST_CHECK(decodePaymentChannelUpdate(tx, redeemScript));
+    BOOST_CHECK(redeemScript == ch.redeemScript);
+    BOOST_CHECK_NO_THROW(checkPaymentChannelUpdate(tx, ch.funding, ch.snodeKey));
+
+    // the whole funding less the network fee
+    BOOST_CHECK_NO_THROW(checkPaymentChannelUpdate(ch.update(COIN - XROUTER_CHANNEL_TXFEE, 0), ch.funding, ch.snodeKey));
+
+    // the settlement only verifies with the key of the channel's service node
+    CKey other;
+    other.MakeNewKey(true);
+    BOOST_CHECK_THROW(checkPaymentChannelUpdate(tx, ch.funding, other), std::runtime_error);
+
+    // funding of another channel
+    const Channel ch2;
+    BOOST_CHECK_THROW(checkPaymentChannelUpdate(tx, ch2.funding, ch.snodeKey), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(payment_channel_update_overspend)
+{
+    const Channel ch;
+    // no room for the network fee
+    BOOST_CHECK_THROW(checkPaymentChannelUpdate(ch.update(COIN, 0), ch.funding, ch.snodeKey), std::runtime_error);
+    BOOST_CHECK_THROW(checkPaymentChannelUpdate(ch.update(COIN/2, COIN/2), ch.funding, ch.snodeKey), std::runtime_error);
+    BOOST_CHECK_THROW(checkPaymentChannelUpdate(ch.update(COIN/2, COIN/2 - XROUTER_CHANNEL_TXFEE + 1), ch.funding, ch.snodeKey), std::runtime_error);
+    // out of range amounts can't hide an overspend
+    BOOST_CHECK_THROW(checkPaymentChannelUpdate(ch.update(MAX_MONEY, -MAX_MONEY + COIN/2), ch.funding, ch.snodeKey), std::runtime_error);
+    BOOST_CHECK_THROW(checkPaymentChannelUpdate(ch.update(-1, 0), ch.funding, ch.snodeKey), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(payment_channel_update_nonfinal)
+{
+    const Channel ch;
+
+    CMutableTransaction locked = ch.update(COIN/10, 0);
+    locked.nLockTime = 1;
+    ch.sign(locked);
+    BOOST_CHECK_THROW(checkPaymentChannelUpdate(locked, ch.funding, ch.snodeKey), std::runtime_error);
+
+    CMutableTransaction sequence = ch.update(COIN/10, 0);
+    sequence.vin[0].nSequence = CTxIn::SEQUENCE_FINAL - 1;
+    ch.sign(sequence);
+    BOOST_CHECK_THROW(checkPaymentChannelUpdate(sequence, ch.funding, ch.snodeKey), std::runtime_error);
+
+    // relative lock time
+    CMutableTransaction relative = ch.update(COIN/10, 0);
+    relative.vin[0].nSequence = 10;
+    ch.sign(relative);
+    BOOST_CHECK_THROW(checkPaymentChannelUpdate(relative, ch.funding, ch.snodeKey), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(payment_channel_update_nonstandard_signature)
+{
+    const Channel ch;
+
+    CMutableTransaction padded = ch.update(COIN/10, 0);
+    ch.sign(padded, true);
+    BOOST_CHECK_THROW(checkPaymentChannelUpdate(padded, ch.funding, ch.snodeKey), std::runtime_error);
+
+    // modified after signing
+    CMutableTransaction modified = ch.update(COIN/10, 0);
+    modified.vout[0].nValue = COIN/5;
+    CScript redeemScript;
+    BOOST_CHECK(!decodePaymentChannelUpdate(modified, redeemScript));
+    BOOST_CHECK_THROW(checkPaymentChannelUpdate(modified, ch.funding, ch.snodeKey), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
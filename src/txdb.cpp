@@ -5,6 +5,7 @@
 
 #include <txdb.h>
 
+#include <blockfilemap.h>
 #include <chainparams.h>
 #include <hash.h>
 #include <kernel.h>
@@ -29,6 +30,11 @@ static const char DB_HEAD_BLOCKS = 'H';
 static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
+static const char DB_STAKE_MODIFIER = 'M';
+static const char DB_INDEX_SNAPSHOT = 'S';
+
+//! Format version of the block index snapshot file
+static const uint32_t BLOCK_INDEX_SNAPSHOT_VERSION = 1;
 
 namespace {
 
@@ -82,6 +88,12 @@ std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
 }
 
 bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
+    bool ret = WriteCoins(mapCoins, hashBlock);
+    mapCoins.clear();
+    return ret;
+}
+
+bool CCoinsViewDB::WriteCoins(const CCoinsMap &mapCoins, const uint256 &hashBlock) {
     CDBBatch batch(db);
     size_t count = 0;
     size_t changed = 0;
@@ -106,7 +118,7 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     batch.Erase(DB_BEST_BLOCK);
     batch.Write(DB_HEAD_BLOCKS, std::vector<uint256>{hashBlock, old_tip});
 
-    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
+    for (CCoinsMap::const_iterator it = mapCoins.begin(); it != mapCoins.end(); ++it) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) {
             CoinEntry entry(&it->first);
             if (it->second.coin.IsSpent())
@@ -116,8 +128,6 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
             changed++;
         }
         count++;
-        CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
         if (batch.SizeEstimate() > batch_size) {
             LogPrint(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
             db.WriteBatch(batch);
@@ -147,6 +157,105 @@ size_t CCoinsViewDB::EstimateSize() const
     return db.EstimateSize(DB_COIN, (char)(DB_COIN+1));
 }
 
+CCoinsViewBackgroundFlush::CCoinsViewBackgroundFlush(CCoinsViewDB *dbIn) : CCoinsViewBacked(dbIn), db(dbIn) {}
+
+CCoinsViewBackgroundFlush::~CCoinsViewBackgroundFlush() {
+    Sync();
+}
+
+bool CCoinsViewBackgroundFlush::GetCoin(const COutPoint &outpoint, Coin &coin) const {
+    {
+        LOCK(cs);
+        if (snapshot) {
+            CCoinsMap::const_iterator it = snapshot->coins.find(outpoint);
+            if (it != snapshot->coins.end()) {
+                coin = it->second.coin;
+                return !coin.IsSpent();
+            }
+        }
+    }
+    return base->GetCoin(outpoint, coin);
+}
+
+bool CCoinsViewBackgroundFlush::HaveCoin(const COutPoint &outpoint) const {
+    {
+        LOCK(cs);
+        if (snapshot) {
+            CCoinsMap::const_iterator it = snapshot->coins.find(outpoint);
+            if (it != snapshot->coins.end())
+                return !it->second.coin.IsSpent();
+        }
+    }
+    return base->HaveCoin(outpoint);
+}
+
+uint256 CCoinsViewBackgroundFlush::GetBestBlock() const {
+    {
+        LOCK(cs);
+        if (snapshot)
+            return snapshot->hashBlock;
+    }
+    return base->GetBestBlock();
+}
+
+bool CCoinsViewBackgroundFlush::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
+    if (!Sync())
+        return false;
+
+    // Only the dirty coins have to be written, the copy lets the cache release its pool
+    std::unique_ptr<Snapshot> pending = MakeUnique<Snapshot>();
+    pending->hashBlock = hashBlock;
+    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end(); it = mapCoins.erase(it)) {
+        if (it->second.flags & CCoinsCacheEntry::DIRTY)
+            pending->coins.emplace(it->first, std::move(it->second));
+    }
+
+    const Snapshot *writing = pending.get();
+    {
+        LOCK(cs);
+        snapshot = std::move(pending);
+    }
+    LOCK(csWriter);
+    writer = std::thread(&CCoinsViewBackgroundFlush::Write, this, writing);
+    return true;
+}
+
+void CCoinsViewBackgroundFlush::Write(const Snapshot *pending) {
+    RenameThread("blocknet-coinsflush");
+    bool fOk = false;
+    try {
+        fOk = db->WriteCoins(pending->coins, pending->hashBlock);
+    } catch (const std::runtime_error& e) {
+        LogPrintf("%s: %s\n", __func__, e.what());
+    }
+    LOCK(cs);
+    if (!fOk) {
+        LogPrintf("%s: Failed to write to coin database\n", __func__);
+        fFailed = true;
+        return;
+    }
+    snapshot.reset();
+}
+
+CCoinsViewCursor *CCoinsViewBackgroundFlush::Cursor() const {
+    Sync();
+    return base->Cursor();
+}
+
+bool CCoinsViewBackgroundFlush::Sync() const {
+    {
+        LOCK(csWriter);
+        if (writer.joinable())
+            writer.join();
+    }
+    return !WriteFailed();
+}
+
+bool CCoinsViewBackgroundFlush::WriteFailed() const {
+    LOCK(cs);
+    return fFailed;
+}
+
 CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(gArgs.IsArgSet("-blocksdir") ? GetDataDir() / "blocks" / "index" : GetBlocksDir() / "index", nCacheSize, fMemory, fWipe) {
 }
 
@@ -177,14 +286,37 @@ CCoinsViewCursor *CCoinsViewDB::Cursor() const
        that restriction.  */
     i->pcursor->Seek(DB_COIN);
     // Cache key of first record
-    if (i->pcursor->Valid()) {
-        CoinEntry entry(&i->keyTmp.second);
-        i->pcursor->GetKey(entry);
-        i->keyTmp.first = entry.key;
+    i->CacheKey();
+    return i;
+}
+
+std::vector<std::unique_ptr<CCoinsViewCursor>> CCoinsViewDB::RangeCursors(size_t n) const
+{
+    n = std::max<size_t>(1, std::min<size_t>(n, 256));
+    const auto snapshot = db.GetSnapshot();
+    const uint256 hashBestChain = GetBestBlock();
+    std::vector<std::unique_ptr<CCoinsViewCursor>> cursors;
+    for (size_t r = 0; r < n; ++r) {
+        const unsigned int begin = r * 256 / n;
+        const unsigned int end = (r + 1) * 256 / n;
+        CCoinsViewDBCursor *i = new CCoinsViewDBCursor(const_cast<CDBWrapper&>(db).NewIterator(snapshot), hashBestChain, end);
+        cursors.emplace_back(i);
+        uint256 start;
+        *start.begin() = static_cast<unsigned char>(begin);
+        i->pcursor->Seek(std::make_pair(DB_COIN, start));
+        i->CacheKey();
+    }
+    return cursors;
+}
+
+void CCoinsViewDBCursor::CacheKey()
+{
+    CoinEntry entry(&keyTmp.second);
+    if (!pcursor->Valid() || !pcursor->GetKey(entry) || *keyTmp.second.hash.begin() >= rangeEnd) {
+        keyTmp.first = 0; // Make sure Valid() and GetKey() return false
     } else {
-        i->keyTmp.first = 0; // Make sure Valid() and GetKey() return false
+        keyTmp.first = entry.key;
     }
-    return i;
 }
 
 bool CCoinsViewDBCursor::GetKey(COutPoint &key) const
@@ -215,12 +347,7 @@ bool CCoinsViewDBCursor::Valid() const
 void CCoinsViewDBCursor::Next()
 {
     pcursor->Next();
-    CoinEntry entry(&keyTmp.second);
-    if (!pcursor->Valid() || !pcursor->GetKey(entry)) {
-        keyTmp.first = 0; // Invalidate cached key after last record so that Valid() and GetKey() return false
-    } else {
-        keyTmp.first = entry.key;
-    }
+    CacheKey(); // Invalidates the cursor after the last record of the range
 }
 
 bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo) {
@@ -229,6 +356,9 @@ bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockF
         batch.Write(std::make_pair(DB_BLOCK_FILES, it->first), *it->second);
     }
     batch.Write(DB_LAST_BLOCK, nLastFile);
+    // The block index snapshot no longer matches once index entries are written
+    if (!blockinfo.empty())
+        batch.Erase(DB_INDEX_SNAPSHOT);
     for (std::vector<const CBlockIndex*>::const_iterator it=blockinfo.begin(); it != blockinfo.end(); it++) {
         batch.Write(std::make_pair(DB_BLOCK_INDEX, (*it)->GetBlockHash()), CDiskBlockIndex(*it));
     }
@@ -247,6 +377,156 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
     return true;
 }
 
+bool CBlockTreeDB::WriteStakeModifiers(const std::vector<std::pair<uint256, StakeModifierEntry>>& entries) {
+    CDBBatch batch(*this);
+    for (const auto & item : entries)
+        batch.Write(std::make_pair(DB_STAKE_MODIFIER, item.first), item.second);
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadStakeModifier(const uint256& hashBlockFrom, StakeModifierEntry& entry) {
+    return Read(std::make_pair(DB_STAKE_MODIFIER, hashBlockFrom), entry);
+}
+
+static fs::path BlockIndexSnapshotPath()
+{
+    return GetDataDir() / "blockindex.dat";
+}
+
+#ifdef WIN32
+/** Reads the whole snapshot file, false if it is missing, empty or can't be read */
+static bool ReadSnapshotFile(const fs::path& path, std::vector<unsigned char>& buffer)
+{
+    FILE *file = fsbridge::fopen(path, "rb");
+    if (!file)
+        return false;
+    bool ok = fseek(file, 0, SEEK_END) == 0;
+    const long size = ok ? ftell(file) : -1;
+    ok = size > 0 && fseek(file, 0, SEEK_SET) == 0;
+    if (ok) {
+        buffer.resize(static_cast<size_t>(size));
+        ok = fread(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    }
+    fclose(file);
+    if (!ok)
+        return error("%s: failed to read %s", __func__, path.string());
+    return true;
+}
+#endif
+
+/** Sets up the block index entry of a block from its database record */
+static void LoadDiskBlockIndex(const uint256& hash, const CDiskBlockIndex& diskindex,
+                               const std::function<CBlockIndex*(const uint256&)>& insertBlockIndex)
+{
+    CBlockIndex *pindexNew      = insertBlockIndex(hash);
+    pindexNew->pprev            = insertBlockIndex(diskindex.hashPrev);
+    pindexNew->nHeight          = diskindex.nHeight;
+    pindexNew->nFile            = diskindex.nFile;
+    pindexNew->nDataPos         = diskindex.nDataPos;
+    pindexNew->nUndoPos         = diskindex.nUndoPos;
+    pindexNew->nVersion         = diskindex.nVersion;
+    pindexNew->hashMerkleRoot   = diskindex.hashMerkleRoot;
+    pindexNew->nTime            = diskindex.nTime;
+    pindexNew->nBits            = diskindex.nBits;
+    pindexNew->nNonce           = diskindex.nNonce;
+    pindexNew->nStatus          = diskindex.nStatus;
+    pindexNew->nTx              = diskindex.nTx;
+
+    // ppcoin: PoS
+    pindexNew->nMint            = diskindex.nMint;
+    pindexNew->nMoneySupply     = diskindex.nMoneySupply;
+    pindexNew->nFlags           = diskindex.nFlags;
+    pindexNew->nStakeModifier   = diskindex.nStakeModifier;
+    pindexNew->prevoutStake     = diskindex.prevoutStake;
+    pindexNew->nStakeAmount     = diskindex.nStakeAmount;
+    pindexNew->hashStakeBlock   = diskindex.hashStakeBlock;
+    pindexNew->hashProofOfStake = diskindex.hashProofOfStake;
+}
+
+/*
+ * The snapshot file holds the same records as the 'b' entries of the database, together
+ * with the block hashes, so they are loaded without hashing and proof checks:
+ *
+ * message start, version, snapshot id, entry count, (block hash, CDiskBlockIndex)...
+ *
+ * The snapshot id is also stored in the database when the snapshot is written and erased
+ * by the next write of index entries. A snapshot is only used while the ids match, the
+ * database stays the source of truth.
+ */
+bool CBlockTreeDB::LoadBlockIndexSnapshot(std::function<CBlockIndex*(const uint256&)> insertBlockIndex)
+{
+    uint256 id;
+    if (!Read(DB_INDEX_SNAPSHOT, id))
+        return false;
+    const fs::path path = BlockIndexSnapshotPath();
+    Span<const unsigned char> data;
+    const MappedBlockFileRef file = MapReadOnlyFile(path);
+    std::vector<unsigned char> buffer;
+    if (file) {
+        file->Advise(true);
+        data = file->Data();
+    } else {
+#ifdef WIN32
+        // Files can't be mapped on Windows, the snapshot is read into memory instead
+        if (!ReadSnapshotFile(path, buffer))
+            return false;
+        data = MakeSpan(buffer);
+#else
+        return false;
+#endif
+    }
+
+    // Entries are only inserted once the whole file was read, a damaged file leaves the index untouched
+    std::vector<std::pair<uint256, CDiskBlockIndex>> entries;
+    try {
+        SpanReader s(SER_DISK, CLIENT_VERSION, data);
+        CMessageHeader::MessageStartChars start;
+        uint32_t version;
+        uint256 fileId;
+        uint64_t count;
+        s >> start >> version >> fileId >> count;
+        if (memcmp(start, Params().MessageStart(), sizeof(start)) != 0 || version != BLOCK_INDEX_SNAPSHOT_VERSION || fileId != id)
+            return error("%s: snapshot does not match the block index database", __func__);
+        entries.resize(count);
+        for (auto & entry : entries)
+            s >> entry.first >> entry.second;
+        if (!s.empty())
+            return error("%s: unexpected data at the end of the snapshot", __func__);
+    } catch (const std::exception& e) {
+        return error("%s: failed to read the snapshot: %s", __func__, e.what());
+    }
+
+    uiInterface.ShowProgress("Loading block index", 0, false);
+    for (const auto & entry : entries)
+        LoadDiskBlockIndex(entry.first, entry.second, insertBlockIndex);
+    uiInterface.ShowProgress("Loading block index", 100, false);
+    LogPrintf("Loaded %u block index entries from the snapshot\n", entries.size());
+    return true;
+}
+
+bool CBlockTreeDB::WriteBlockIndexSnapshot(const std::vector<const CBlockIndex*>& blockinfo)
+{
+    const uint256 id = GetRandHash();
+    const fs::path path = BlockIndexSnapshotPath();
+    const fs::path pathTmp = path.string() + ".new";
+    CAutoFile fileout(fsbridge::fopen(pathTmp, "wb"), SER_DISK, CLIENT_VERSION);
+    if (fileout.IsNull())
+        return error("%s: failed to open %s", __func__, pathTmp.string());
+    try {
+        fileout << Params().MessageStart() << BLOCK_INDEX_SNAPSHOT_VERSION << id << static_cast<uint64_t>(blockinfo.size());
+        for (const CBlockIndex* pindex : blockinfo)
+            fileout << pindex->GetBlockHash() << CDiskBlockIndex(pindex);
+    } catch (const std::exception& e) {
+        return error("%s: failed to write the snapshot: %s", __func__, e.what());
+    }
+    if (!FileCommit(fileout.Get()))
+        return error("%s: failed to commit %s", __func__, pathTmp.string());
+    fileout.fclose();
+    if (!RenameOver(pathTmp, path))
+        return error("%s: failed to rename %s", __func__, pathTmp.string());
+    return Write(DB_INDEX_SNAPSHOT, id, true);
+}
+
 bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex)
 {
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
@@ -332,29 +612,7 @@ bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams,
             continue;
 
         // Construct block index object
-        CBlockIndex *pindexNew      = insertBlockIndex(hash);
-        pindexNew->pprev            = insertBlockIndex(diskindex->hashPrev);
-        pindexNew->nHeight          = diskindex->nHeight;
-        pindexNew->nFile            = diskindex->nFile;
-        pindexNew->nDataPos         = diskindex->nDataPos;
-        pindexNew->nUndoPos         = diskindex->nUndoPos;
-        pindexNew->nVersion         = diskindex->nVersion;
-        pindexNew->hashMerkleRoot   = diskindex->hashMerkleRoot;
-        pindexNew->nTime            = diskindex->nTime;
-        pindexNew->nBits            = diskindex->nBits;
-        pindexNew->nNonce           = diskindex->nNonce;
-        pindexNew->nStatus          = diskindex->nStatus;
-        pindexNew->nTx              = diskindex->nTx;
-
-        // ppcoin: PoS
-        pindexNew->nMint            = diskindex->nMint;
-        pindexNew->nMoneySupply     = diskindex->nMoneySupply;
-        pindexNew->nFlags           = diskindex->nFlags;
-        pindexNew->nStakeModifier   = diskindex->nStakeModifier;
-        pindexNew->prevoutStake     = diskindex->prevoutStake;
-        pindexNew->nStakeAmount     = diskindex->nStakeAmount;
-        pindexNew->hashStakeBlock   = diskindex->hashStakeBlock;
-        pindexNew->hashProofOfStake = diskindex->hashProofOfStake;
+        LoadDiskBlockIndex(hash, *diskindex, insertBlockIndex);
 
         ++counter;
         if (counter % 20000 == 0) { // update ui message every 20k blocks
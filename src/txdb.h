@@ -10,10 +10,12 @@
 #include <dbwrapper.h>
 #include <chain.h>
 #include <primitives/block.h>
+#include <sync.h>
 
 #include <map>
 #include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -55,11 +57,62 @@ public:
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
     CCoinsViewCursor *Cursor() const override;
 
+    //! Cursors over n consecutive ranges of the coins, split by the first byte of the txid.
+    //! They read one snapshot of the database, so they can be walked in parallel while
+    //! coins are written. Up to 256 ranges.
+    std::vector<std::unique_ptr<CCoinsViewCursor>> RangeCursors(size_t n) const;
+
+    //! Write the dirty coins without modifying the map, the db is marked as being in transition
+    //! to hashBlock (head blocks) until the last batch is written.
+    bool WriteCoins(const CCoinsMap &mapCoins, const uint256 &hashBlock);
+
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
     size_t EstimateSize() const override;
 };
 
+/**
+ * CCoinsView on top of the coin database that writes flushed coins from a background thread,
+ * so flushing pcoinsTip doesn't hold cs_main for the whole database write. The coins of the
+ * write in progress are served from its snapshot until they are in the database. Sync waits
+ * for the write, an interrupted write is recovered from the head blocks marker on startup.
+ */
+class CCoinsViewBackgroundFlush final : public CCoinsViewBacked
+{
+public:
+    explicit CCoinsViewBackgroundFlush(CCoinsViewDB *dbIn);
+    ~CCoinsViewBackgroundFlush() override;
+
+    bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
+    bool HaveCoin(const COutPoint &outpoint) const override;
+    uint256 GetBestBlock() const override;
+    //! Takes the dirty coins and starts writing them, waits for the previous write first
+    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
+    CCoinsViewCursor *Cursor() const override;
+
+    //! Wait for the write in progress. Returns false if a write failed.
+    bool Sync() const;
+    //! Whether a write failed, without waiting
+    bool WriteFailed() const;
+
+private:
+    struct Snapshot {
+        CCoinsMapMemoryResource resource;
+        CCoinsMap coins{0, SaltedOutpointHasher(), CCoinsMap::key_equal(), &resource};
+        uint256 hashBlock;
+    };
+
+    void Write(const Snapshot *pending);
+
+    CCoinsViewDB *db;
+    mutable Mutex cs;
+    //! Coins being written, kept if the write failed so reads stay consistent until shutdown
+    std::unique_ptr<Snapshot> snapshot GUARDED_BY(cs);
+    bool fFailed GUARDED_BY(cs){false};
+    mutable Mutex csWriter;
+    mutable std::thread writer GUARDED_BY(csWriter);
+};
+
 /** Specialization of CCoinsViewCursor to iterate over a CCoinsViewDB */
 class CCoinsViewDBCursor: public CCoinsViewCursor
 {
@@ -74,15 +127,22 @@ public:
     void Next() override;
 
 private:
-    CCoinsViewDBCursor(CDBIterator* pcursorIn, const uint256 &hashBlockIn):
-        CCoinsViewCursor(hashBlockIn), pcursor(pcursorIn) {}
+    CCoinsViewDBCursor(CDBIterator* pcursorIn, const uint256 &hashBlockIn, unsigned int rangeEndIn = 256):
+        CCoinsViewCursor(hashBlockIn), pcursor(pcursorIn), rangeEnd(rangeEndIn) {}
+    //! Caches the key of the current record, or invalidates the cursor past the coins
+    void CacheKey();
+
     std::unique_ptr<CDBIterator> pcursor;
     std::pair<char, COutPoint> keyTmp;
+    //! The cursor ends at the first txid starting with this byte
+    unsigned int rangeEnd;
 
     friend class CCoinsViewDB;
 };
 
 /** Access to the block database (blocks/index/) */
+struct StakeModifierEntry;
+
 class CBlockTreeDB : public CDBWrapper
 {
 public:
@@ -96,6 +156,15 @@ public:
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
     bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex);
+    /**
+     * Load the block index from the snapshot file written by WriteBlockIndexSnapshot. Fails without
+     * touching the index if there is no snapshot or the database changed since it was written.
+     */
+    bool LoadBlockIndexSnapshot(std::function<CBlockIndex*(const uint256&)> insertBlockIndex);
+    /** Write all entries of a fully flushed block index to the snapshot file. */
+    bool WriteBlockIndexSnapshot(const std::vector<const CBlockIndex*>& blockinfo);
+    bool WriteStakeModifiers(const std::vector<std::pair<uint256, StakeModifierEntry>>& entries);
+    bool ReadStakeModifier(const uint256& hashBlockFrom, StakeModifierEntry& entry);
 };
 
 #endif // BITCOIN_TXDB_H
@@ -11,6 +11,7 @@
 #include <validation.h>
 #include <policy/policy.h>
 #include <policy/fees.h>
+#include <policy/rbf.h>
 #include <reverse_iterator.h>
 #include <streams.h>
 #include <timedata.h>
@@ -22,7 +23,7 @@ CTxMemPoolEntry::CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFe
                                  int64_t _nTime, unsigned int _entryHeight,
                                  bool _spendsCoinbase, int64_t _sigOpsCost, LockPoints lp)
     : tx(_tx), nFee(_nFee), nTxWeight(GetTransactionWeight(*tx)), nUsageSize(RecursiveDynamicUsage(tx)), nTime(_nTime), entryHeight(_entryHeight),
-    spendsCoinbase(_spendsCoinbase), sigOpCost(_sigOpsCost), lockPoints(lp)
+    spendsCoinbase(_spendsCoinbase), sigOpCost(_sigOpsCost), lockPoints(lp), m_epoch(0)
 {
     nCountWithDescendants = 1;
     nSizeWithDescendants = GetTxSize();
@@ -148,7 +149,9 @@ void CTxMemPool::UpdateTransactionsFromBlock(const std::vector<uint256> &vHashes
 
 bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntries &setAncestors, uint64_t limitAncestorCount, uint64_t limitAncestorSize, uint64_t limitDescendantCount, uint64_t limitDescendantSize, std::string &errString, bool fSearchForParents /* = true */) const
 {
-    setEntries parentHashes;
+    // Ancestors are staged once per epoch, so long chains don't need a set lookup per parent
+    const EpochGuard epoch(*this);
+    std::vector<txiter> parentHashes;
     const CTransaction &tx = entry.GetTx();
 
     if (fSearchForParents) {
@@ -157,8 +160,8 @@ bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntr
         // iterate mapTx to find parents.
         for (unsigned int i = 0; i < tx.vin.size(); i++) {
             boost::optional<txiter> piter = GetIter(tx.vin[i].prevout.hash);
-            if (piter) {
-                parentHashes.insert(*piter);
+            if (piter && !visited(*piter)) {
+                parentHashes.push_back(*piter);
                 if (parentHashes.size() + 1 > limitAncestorCount) {
                     errString = strprintf("too many unconfirmed parents [limit: %u]", limitAncestorCount);
                     return false;
@@ -169,16 +172,19 @@ bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntr
         // If we're not searching for parents, we require this to be an
         // entry in the mempool already.
         txiter it = mapTx.iterator_to(entry);
-        parentHashes = GetMemPoolParents(it);
+        for (txiter piter : GetMemPoolParents(it)) {
+            if (!visited(piter))
+                parentHashes.push_back(piter);
+        }
     }
 
     size_t totalSizeWithAncestors = entry.GetTxSize();
 
     while (!parentHashes.empty()) {
-        txiter stageit = *parentHashes.begin();
+        txiter stageit = parentHashes.back();
 
         setAncestors.insert(stageit);
-        parentHashes.erase(stageit);
+        parentHashes.pop_back();
         totalSizeWithAncestors += stageit->GetTxSize();
 
         if (stageit->GetSizeWithDescendants() + entry.GetTxSize() > limitDescendantSize) {
@@ -195,8 +201,8 @@ bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntr
         const setEntries & setMemPoolParents = GetMemPoolParents(stageit);
         for (txiter phash : setMemPoolParents) {
             // If this is a new ancestor, add it.
-            if (setAncestors.count(phash) == 0) {
-                parentHashes.insert(phash);
+            if (!visited(phash)) {
+                parentHashes.push_back(phash);
             }
             if (parentHashes.size() + setAncestors.size() + 1 > limitAncestorCount) {
                 errString = strprintf("too many unconfirmed ancestors [limit: %u]", limitAncestorCount);
@@ -324,7 +330,7 @@ void CTxMemPoolEntry::UpdateAncestorState(int64_t modifySize, CAmount modifyFee,
 }
 
 CTxMemPool::CTxMemPool(CBlockPolicyEstimator* estimator) :
-    nTransactionsUpdated(0), minerPolicyEstimator(estimator)
+    nTransactionsUpdated(0), minerPolicyEstimator(estimator), m_epoch(0), m_has_epoch_guard(false)
 {
     _clear(); //lock free clear
 
@@ -334,6 +340,20 @@ CTxMemPool::CTxMemPool(CBlockPolicyEstimator* estimator) :
     nCheckFrequency = 0;
 }
 
+CTxMemPool::EpochGuard::EpochGuard(const CTxMemPool& in) : pool(in)
+{
+    assert(!pool.m_has_epoch_guard);
+    ++pool.m_epoch;
+    pool.m_has_epoch_guard = true;
+}
+
+CTxMemPool::EpochGuard::~EpochGuard()
+{
+    // Entries visited in this epoch are older than the next one
+    ++pool.m_epoch;
+    pool.m_has_epoch_guard = false;
+}
+
 bool CTxMemPool::isSpent(const COutPoint& outpoint) const
 {
     LOCK(cs);
@@ -795,6 +815,69 @@ std::vector<TxMempoolInfo> CTxMemPool::infoAll() const
     return ret;
 }
 
+bool CTxMemPool::SignalsRBF(txiter it, rbfCacheMap& cache) const
+{
+    auto cached = cache.find(it);
+    if (cached != cache.end())
+        return cached->second;
+    bool ret = SignalsOptInRBF(it->GetTx());
+    for (txiter parent : GetMemPoolParents(it)) {
+        if (ret)
+            break;
+        ret = SignalsRBF(parent, cache);
+    }
+    cache.emplace(it, ret);
+    return ret;
+}
+
+TxMempoolEntrySnapshot CTxMemPool::SnapshotEntry(txiter it, rbfCacheMap& cache) const
+{
+    TxMempoolEntrySnapshot entry;
+    entry.txid = it->GetTx().GetHash();
+    entry.wtxid = vTxHashes[it->vTxHashesIdx].first;
+    entry.fee = it->GetFee();
+    entry.modified_fee = it->GetModifiedFee();
+    entry.tx_size = it->GetTxSize();
+    entry.time = it->GetTime();
+    entry.height = it->GetHeight();
+    entry.count_with_descendants = it->GetCountWithDescendants();
+    entry.size_with_descendants = it->GetSizeWithDescendants();
+    entry.mod_fees_with_descendants = it->GetModFeesWithDescendants();
+    entry.count_with_ancestors = it->GetCountWithAncestors();
+    entry.size_with_ancestors = it->GetSizeWithAncestors();
+    entry.mod_fees_with_ancestors = it->GetModFeesWithAncestors();
+    for (txiter parent : GetMemPoolParents(it))
+        entry.depends.push_back(parent->GetTx().GetHash());
+    for (txiter child : GetMemPoolChildren(it))
+        entry.spent_by.push_back(child->GetTx().GetHash());
+    entry.bip125_replaceable = SignalsRBF(it, cache);
+    return entry;
+}
+
+TxMempoolEntrySnapshot CTxMemPool::GetEntrySnapshot(txiter it) const
+{
+    AssertLockHeld(cs);
+    rbfCacheMap cache;
+    return SnapshotEntry(it, cache);
+}
+
+TxMempoolSnapshotRef CTxMemPool::GetSnapshot() const
+{
+    LOCK(cs);
+    if (m_snapshot && m_snapshot->epoch == nTransactionsUpdated)
+        return m_snapshot;
+
+    auto snapshot = std::make_shared<TxMempoolSnapshot>();
+    snapshot->epoch = nTransactionsUpdated;
+    snapshot->entries.reserve(mapTx.size());
+    // Shared by the entries so that the ancestors are only looked at once
+    rbfCacheMap cache;
+    for (txiter it = mapTx.begin(); it != mapTx.end(); ++it)
+        snapshot->entries.push_back(SnapshotEntry(it, cache));
+    m_snapshot = std::move(snapshot);
+    return m_snapshot;
+}
+
 CTransactionRef CTxMemPool::get(const uint256& hash) const
 {
     LOCK(cs);
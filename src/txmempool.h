@@ -130,6 +130,7 @@ public:
     int64_t GetSigOpCostWithAncestors() const { return nSigOpCostWithAncestors; }
 
     mutable size_t vTxHashesIdx; //!< Index in mempool's vTxHashes
+    mutable uint64_t m_epoch; //!< Epoch of the mempool traversal that last visited the entry
 };
 
 // Helpers for modifying CTxMemPool::mapTx, which is a boost multi_index.
@@ -340,6 +341,45 @@ struct TxMempoolInfo
     int64_t nFeeDelta;
 };
 
+/**
+ * Copy of the state of a mempool entry that RPC readers report, taken by
+ * CTxMemPool::GetSnapshot.
+ */
+struct TxMempoolEntrySnapshot
+{
+    uint256 txid;
+    uint256 wtxid;
+    CAmount fee;
+    CAmount modified_fee;
+    size_t tx_size;
+    int64_t time;
+    unsigned int height;
+    uint64_t count_with_descendants;
+    uint64_t size_with_descendants;
+    CAmount mod_fees_with_descendants;
+    uint64_t count_with_ancestors;
+    uint64_t size_with_ancestors;
+    CAmount mod_fees_with_ancestors;
+    /** In mempool parents and children of the transaction */
+    std::vector<uint256> depends;
+    std::vector<uint256> spent_by;
+    /** The transaction or one of its in mempool ancestors signals BIP125 */
+    bool bip125_replaceable;
+};
+
+/**
+ * Immutable copy of the mempool entries. The snapshot belongs to an epoch
+ * (the transactions updated counter), it is shared by all readers until the
+ * mempool changes.
+ */
+struct TxMempoolSnapshot
+{
+    unsigned int epoch;
+    std::vector<TxMempoolEntrySnapshot> entries;
+};
+
+using TxMempoolSnapshotRef = std::shared_ptr<const TxMempoolSnapshot>;
+
 /** Reason why a transaction was removed from the mempool,
  * this is passed to the notification signal.
  */
@@ -452,6 +492,8 @@ private:
     mutable int64_t lastRollingFeeUpdate;
     mutable bool blockSinceLastRollingFeeBump;
     mutable double rollingMinimumFeeRate; //!< minimum fee to get into the pool, decreases exponentially
+    mutable uint64_t m_epoch; //!< Epoch of the current traversal, see visited()
+    mutable bool m_has_epoch_guard;
 
     void trackPackageRemoved(const CFeeRate& rate) EXCLUSIVE_LOCKS_REQUIRED(cs);
 
@@ -553,6 +595,13 @@ private:
 
     std::vector<indexed_transaction_set::const_iterator> GetSortedDepthAndScore() const EXCLUSIVE_LOCKS_REQUIRED(cs);
 
+    typedef std::map<txiter, bool, CompareIteratorByHash> rbfCacheMap;
+    /** Whether the entry or one of its ancestors signals BIP125, memoized in cache */
+    bool SignalsRBF(txiter it, rbfCacheMap& cache) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+    TxMempoolEntrySnapshot SnapshotEntry(txiter it, rbfCacheMap& cache) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+
+    mutable TxMempoolSnapshotRef m_snapshot GUARDED_BY(cs); //!< Latest snapshot, reused while its epoch is current
+
 public:
     indirectmap<COutPoint, const CTransaction*> mapNextTx GUARDED_BY(cs);
     std::map<uint256, CAmount> mapDeltas;
@@ -693,6 +742,14 @@ public:
     CTransactionRef get(const uint256& hash) const;
     TxMempoolInfo info(const uint256& hash) const;
     std::vector<TxMempoolInfo> infoAll() const;
+    /**
+     * Snapshot of all entries, for readers that would otherwise hold cs while
+     * they serialize the mempool. The snapshot is only rebuilt after the mempool
+     * changed, the entries are copied under cs without further processing.
+     */
+    TxMempoolSnapshotRef GetSnapshot() const;
+    /** Snapshot of a single entry */
+    TxMempoolEntrySnapshot GetEntrySnapshot(txiter it) const EXCLUSIVE_LOCKS_REQUIRED(cs);
 
     size_t DynamicMemoryUsage() const;
 
@@ -736,6 +793,24 @@ private:
      *  removal.
      */
     void removeUnchecked(txiter entry, MemPoolRemovalReason reason = MemPoolRemovalReason::UNKNOWN) EXCLUSIVE_LOCKS_REQUIRED(cs);
+
+    /** Starts a traversal epoch for its lifetime, entries are visited at most once per
+     *  epoch without a per-traversal set of the entries seen. Epochs can't be nested. */
+    class EpochGuard {
+        const CTxMemPool& pool;
+    public:
+        explicit EpochGuard(const CTxMemPool& in);
+        ~EpochGuard();
+    };
+
+    /** Returns true if the entry was already visited in the current epoch, and marks it
+     *  visited otherwise. Requires an EpochGuard. */
+    bool visited(txiter it) const EXCLUSIVE_LOCKS_REQUIRED(cs) {
+        assert(m_has_epoch_guard);
+        const bool ret = it->m_epoch >= m_epoch;
+        it->m_epoch = std::max(it->m_epoch, m_epoch);
+        return ret;
+    }
 };
 
 /**
@@ -10,9 +10,11 @@
 #include <memory>
 #include <stdint.h>
 #include <string>
+#include <vector>
 
 class CWallet;
 class CBlockIndex;
+class uint256;
 namespace boost {
 namespace signals2 {
 class connection;
@@ -118,6 +120,9 @@ public:
 
     /** Banlist did change. */
     ADD_SIGNALS_DECL_WRAPPER(BannedListChanged, void, void);
+
+    /** Governance proposals were added or removed, or their votes or status changed. */
+    ADD_SIGNALS_DECL_WRAPPER(NotifyGovernanceChanged, void, const std::vector<uint256>& proposals);
 };
 
 /** Show warning message **/
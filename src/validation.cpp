@@ -7,6 +7,7 @@
 #include <validation.h>
 
 #include <arith_uint256.h>
+#include <blockfilemap.h>
 #include <chain.h>
 #include <chainparams.h>
 #include <checkpoints.h>
@@ -16,11 +17,14 @@
 #include <consensus/merkle.h>
 #include <consensus/tx_verify.h>
 #include <consensus/validation.h>
+#include <core_memusage.h>
 #include <cuckoocache.h>
 #include <governance/governance.h>
 #include <hash.h>
 #include <kernel.h>
 #include <index/txindex.h>
+#include <limitedmap.h>
+#include <metrics.h>
 #include <net.h>
 #include <policy/fees.h>
 #include <policy/policy.h>
@@ -35,6 +39,7 @@
 #include <script/sigcache.h>
 #include <script/standard.h>
 #include <shutdown.h>
+#include <sigbatch.h>
 #include <timedata.h>
 #include <tinyformat.h>
 #include <txdb.h>
@@ -48,7 +53,9 @@
 #include <warnings.h>
 
 #include <future>
+#include <list>
 #include <sstream>
+#include <thread>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/thread.hpp>
@@ -168,6 +175,8 @@ public:
      * that it doesn't descend from an invalid block, and then add it to mapBlockIndex.
      */
     bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    /** As above, with the hash of the header computed by the caller. */
+    bool AcceptBlockHeader(const CBlockHeader& block, const uint256& hash, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fRequested, const CDiskBlockPos* dbp, bool* fNewBlock) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     // Block (dis)connection on a given view:
@@ -196,6 +205,7 @@ private:
     bool ConnectTip(CValidationState& state, const CChainParams& chainparams, CBlockIndex* pindexNew, const std::shared_ptr<const CBlock>& pblock, ConnectTrace& connectTrace, DisconnectedBlockTransactions &disconnectpool) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     CBlockIndex* AddToBlockIndex(const CBlockHeader& block) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    CBlockIndex* AddToBlockIndex(const CBlockHeader& block, const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     /** Create a new block index entry for a given block hash */
     CBlockIndex* InsertBlockIndex(const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     /**
@@ -207,6 +217,7 @@ private:
 
     void InvalidBlockFound(CBlockIndex *pindex, const CValidationState &state) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     CBlockIndex* FindMostWorkChain() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    void PrecheckStakes(const Consensus::Params& params) LOCKS_EXCLUDED(cs_main);
     void ReceivedBlockTransactions(const CBlock& block, CBlockIndex* pindexNew, const CDiskBlockPos& pos, const Consensus::Params& consensusParams) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     bool RollforwardBlock(const CBlockIndex* pindex, CCoinsViewCache& inputs, const CChainParams& params) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
@@ -228,7 +239,7 @@ private:
 RecursiveMutex cs_main;
 
 BlockMap& mapBlockIndex = g_chainstate.mapBlockIndex;
-std::map<int, CBlockIndex*> mapHeaderIndex;
+CHeaderHeightIndex chainHeaders;
 CChain& chainActive = g_chainstate.chainActive;
 CBlockIndex *pindexBestHeader = nullptr;
 Mutex g_best_block_mutex;
@@ -243,6 +254,8 @@ bool fIsBareMultisigStd = DEFAULT_PERMIT_BAREMULTISIG;
 bool fRequireStandard = true;
 bool fCheckBlockIndex = false;
 bool fCheckpointsEnabled = DEFAULT_CHECKPOINTS_ENABLED;
+bool fBlockMmap = DEFAULT_BLOCK_MMAP;
+bool fBlockIndexSnapshot = DEFAULT_BLOCK_INDEX_SNAPSHOT;
 size_t nCoinCacheUsage = 5000 * 300;
 uint64_t nPruneTarget = 0;
 int64_t nMaxTipAge = DEFAULT_MAX_TIP_AGE;
@@ -310,6 +323,7 @@ CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& loc
 }
 
 std::unique_ptr<CCoinsViewDB> pcoinsdbview;
+std::unique_ptr<CCoinsViewBackgroundFlush> pcoinsflusher;
 std::unique_ptr<CCoinsViewCache> pcoinsTip;
 std::unique_ptr<CBlockTreeDB> pblocktree;
 
@@ -1082,21 +1096,56 @@ static bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMes
     return true;
 }
 
+/**
+ * Deserializes the block at pos straight from the memory mapped block file. Returns false
+ * if the block is not in a mapping, the caller reads the file instead.
+ */
+static bool ReadBlockFromMappedFile(CBlock& block, const CDiskBlockPos& pos)
+{
+    if (pos.IsNull() || pos.nPos < sizeof(uint32_t))
+        return false;
+    const fs::path path = GetBlockPosFilename(pos, "blk");
+    MappedBlockFileRef file = g_block_file_maps.Get(pos.nFile, path, pos.nPos);
+    if (!file)
+        return false;
+    // The block size is written right before the block
+    const uint32_t nSize = ReadLE32(file->Data().data() + pos.nPos - sizeof(uint32_t));
+    const size_t nEnd = static_cast<size_t>(pos.nPos) + nSize;
+    if (file->Size() < nEnd && !(file = g_block_file_maps.Get(pos.nFile, path, nEnd)))
+        return false;
+
+    SpanReader ss(SER_DISK, CLIENT_VERSION, file->Data().subspan(pos.nPos, nSize));
+    ss >> block;
+    return true;
+}
+
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams)
 {
     block.SetNull();
 
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
-
-    // Read block
-    try {
-        filein >> block;
+    bool fRead = false;
+    if (fBlockMmap) {
+        try {
+            fRead = ReadBlockFromMappedFile(block, pos);
+        }
+        catch (const std::exception& e) {
+            return error("%s: Deserialize error - %s at %s", __func__, e.what(), pos.ToString());
+        }
     }
-    catch (const std::exception& e) {
-        return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+
+    if (!fRead) {
+        // Open history file to read
+        CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+            return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
+
+        // Read block
+        try {
+            filein >> block;
+        }
+        catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+        }
     }
 
     // Check the header
@@ -1132,6 +1181,86 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
     return true;
 }
 
+namespace {
+
+/** LRU cache of deserialized blocks by hash, bounded by their memory usage */
+class BlockReadCache
+{
+private:
+    struct Entry {
+        uint256 hash;
+        std::shared_ptr<const CBlock> block;
+        size_t usage;
+    };
+
+    Mutex m_mutex;
+    std::list<Entry> m_lru GUARDED_BY(m_mutex); // most recently used first
+    std::unordered_map<uint256, std::list<Entry>::iterator, BlockHasher> m_index GUARDED_BY(m_mutex);
+    size_t m_usage GUARDED_BY(m_mutex){0};
+    size_t m_max_usage GUARDED_BY(m_mutex){DEFAULT_BLOCK_READ_CACHE << 20};
+
+    void Trim() EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        while (m_usage > m_max_usage) {
+            m_usage -= m_lru.back().usage;
+            m_index.erase(m_lru.back().hash);
+            m_lru.pop_back();
+        }
+    }
+
+public:
+    std::shared_ptr<const CBlock> Get(const uint256& hash)
+    {
+        LOCK(m_mutex);
+        auto it = m_index.find(hash);
+        if (it == m_index.end())
+            return nullptr;
+        m_lru.splice(m_lru.begin(), m_lru, it->second);
+        return it->second->block;
+    }
+
+    void Add(const uint256& hash, const std::shared_ptr<const CBlock>& block)
+    {
+        const size_t usage = sizeof(CBlock) + RecursiveDynamicUsage(*block);
+        LOCK(m_mutex);
+        if (usage > m_max_usage || m_index.count(hash))
+            return;
+        m_lru.push_front({hash, block, usage});
+        m_index.emplace(hash, m_lru.begin());
+        m_usage += usage;
+        Trim();
+    }
+
+    void SetMaxUsage(size_t nBytes)
+    {
+        LOCK(m_mutex);
+        m_max_usage = nBytes;
+        Trim();
+    }
+};
+
+BlockReadCache blockReadCache;
+
+} // namespace
+
+void SetBlockReadCacheSize(size_t nBytes)
+{
+    blockReadCache.SetMaxUsage(nBytes);
+}
+
+std::shared_ptr<const CBlock> ReadBlockFromDiskCached(const CBlockIndex* pindex, const Consensus::Params& consensusParams)
+{
+    const uint256 hash = pindex->GetBlockHash();
+    std::shared_ptr<const CBlock> pblock = blockReadCache.Get(hash);
+    if (pblock)
+        return pblock;
+    std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
+    if (!ReadBlockFromDisk(*pblockRead, pindex, consensusParams))
+        return nullptr;
+    blockReadCache.Add(hash, pblockRead);
+    return pblockRead;
+}
+
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& message_start)
 {
     CDiskBlockPos hpos = pos;
@@ -1500,7 +1629,9 @@ bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint
     return true;
 }
 
-static bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex *pindex)
+} // namespace
+
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex *pindex)
 {
     CDiskBlockPos pos = pindex->GetUndoPos();
     if (pos.IsNull()) {
@@ -1531,6 +1662,8 @@ static bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex *pindex)
     return true;
 }
 
+namespace {
+
 /** Abort with a message */
 static bool AbortNode(const std::string& strMessage, const std::string& userMessage="")
 {
@@ -1655,8 +1788,10 @@ void static FlushBlockFile(bool fFinalize = false)
 
     FILE *fileOld = OpenBlockFile(posOld);
     if (fileOld) {
-        if (fFinalize)
+        if (fFinalize) {
+            g_block_file_maps.Drop(nLastBlockFile); // the mapping may extend past the new size
             status &= TruncateFile(fileOld, vinfoBlockFile[nLastBlockFile].nSize);
+        }
         status &= FileCommit(fileOld);
         fclose(fileOld);
     }
@@ -1702,6 +1837,273 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+/** Order the transactions of a batch so that parents come before the children spending them */
+static std::vector<size_t> SortByDependencies(const std::vector<CTransactionRef>& txs)
+{
+    std::map<uint256, size_t> batchIndex;
+    for (size_t i = 0; i < txs.size(); ++i)
+        batchIndex.emplace(txs[i]->GetHash(), i);
+
+    std::vector<size_t> order;
+    order.reserve(txs.size());
+    std::vector<bool> visited(txs.size(), false);
+    std::vector<std::pair<size_t, size_t>> stack; // (tx, next input to visit)
+    for (size_t root = 0; root < txs.size(); ++root) {
+        if (visited[root])
+            continue;
+        visited[root] = true;
+        stack.emplace_back(root, 0);
+        while (!stack.empty()) {
+            const size_t i = stack.back().first;
+            const CTransaction& tx = *txs[i];
+            if (stack.back().second < tx.vin.size()) {
+                auto it = batchIndex.find(tx.vin[stack.back().second++].prevout.hash);
+                if (it != batchIndex.end() && !visited[it->second]) {
+                    visited[it->second] = true;
+                    stack.emplace_back(it->second, 0);
+                }
+            } else {
+                order.push_back(i);
+                stack.pop_back();
+            }
+        }
+    }
+    return order;
+}
+
+/**
+ * Verify the scripts of the batch on the script check threads before the transactions are
+ * accepted one by one. Valid signatures end up in the signature cache, which makes the
+ * script checks of the acceptance cheap. Failures are ignored here, the acceptance reports
+ * them. The coins fetched into the coins tip are appended to coins_to_uncache per transaction.
+ */
+static void PreValidateBatchScripts(const std::vector<CTransactionRef>& txs, const std::vector<size_t>& order,
+                                    CTxMemPool& pool, std::vector<std::vector<COutPoint>>& coins_to_uncache) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    LOCK(pool.cs);
+    CCoinsViewMemPool viewMemPool(pcoinsTip.get(), pool);
+    CCoinsViewCache view(&viewMemPool);
+
+    // Checks keep pointers to the precomputed data, it must not be reallocated
+    std::vector<PrecomputedTransactionData> txdata;
+    txdata.reserve(order.size());
+
+    CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+    for (const size_t i : order) {
+        const CTransaction& tx = *txs[i];
+        CValidationState state;
+        if (tx.IsCoinBase() || tx.IsCoinStake() || !CheckTransaction(tx, state))
+            continue;
+
+        bool fHaveInputs = true;
+        for (const CTxIn& txin : tx.vin) {
+            if (!pcoinsTip->HaveCoinInCache(txin.prevout))
+                coins_to_uncache[i].push_back(txin.prevout);
+            if (!view.HaveCoin(txin.prevout)) {
+                fHaveInputs = false;
+                break;
+            }
+        }
+        if (!fHaveInputs)
+            continue;
+
+        txdata.emplace_back(tx);
+        std::vector<CScriptCheck> vChecks;
+        if (CheckInputs(tx, state, view, true, STANDARD_SCRIPT_VERIFY_FLAGS, true, false, txdata.back(), &vChecks))
+            control.Add(vChecks);
+
+        // Children later in the batch spend the outputs
+        AddCoins(view, tx, MEMPOOL_HEIGHT);
+    }
+    control.Wait();
+}
+
+std::vector<bool> AcceptToMemoryPoolBatch(CTxMemPool& pool, const std::vector<CTransactionRef>& txs,
+                                          std::vector<CValidationState>& states, bool bypass_limits, const CAmount nAbsurdFee,
+                                          const std::vector<int64_t>& accept_times)
+{
+    assert(accept_times.empty() || accept_times.size() == txs.size());
+    const CChainParams& chainparams = Params();
+    const int64_t nAcceptTime = GetTime();
+    states.assign(txs.size(), CValidationState());
+    std::vector<bool> accepted(txs.size(), false);
+
+    const std::vector<size_t> order = SortByDependencies(txs);
+    std::vector<std::vector<COutPoint>> coins_to_uncache(txs.size());
+    if (nScriptCheckThreads && txs.size() > 1)
+        PreValidateBatchScripts(txs, order, pool, coins_to_uncache);
+
+    for (const size_t i : order) {
+        accepted[i] = AcceptToMemoryPoolWorker(chainparams, pool, states[i], txs[i], nullptr,
+                                               accept_times.empty() ? nAcceptTime : accept_times[i], nullptr,
+                                               bypass_limits, nAbsurdFee, coins_to_uncache[i], false);
+    }
+    for (size_t i = 0; i < txs.size(); ++i) {
+        if (accepted[i])
+            continue;
+        for (const COutPoint& outpoint : coins_to_uncache[i])
+            pcoinsTip->Uncache(outpoint);
+    }
+    // After we've (potentially) uncached entries, ensure our coins cache is still within its size limits
+    CValidationState stateDummy;
+    FlushStateToDisk(chainparams, stateDummy, FlushStateMode::PERIODIC);
+    return accepted;
+}
+
+static CCheckQueue<CStakeCheck> stakecheckqueue(8);
+
+void ThreadStakeCheck() {
+    RenameThread("blocknet-stakech");
+    stakecheckqueue.Thread();
+}
+
+/** Blocks read and checked ahead by the stake check queue, taken by ConnectTip */
+static Mutex muPrefetchedBlocks;
+static std::map<uint256, std::shared_ptr<const CBlock>> mapPrefetchedBlocks GUARDED_BY(muPrefetchedBlocks);
+/** Unspent prevouts of the prefetched blocks read from the coins db, warmed into pcoinsTip */
+static std::vector<std::pair<COutPoint, Coin>> vPrefetchedCoins GUARDED_BY(muPrefetchedBlocks);
+/** Flushes of pcoinsTip to the coins db, prefetched coins read before a flush are stale */
+static uint64_t nCoinsFlushes GUARDED_BY(cs_main) = 0;
+
+/** Reads the prevouts of the block from the coins db. Prevouts created by blocks that are
+ *  not connected yet are not found and left to the serial lookup. */
+static void PrefetchCoins(const CBlock & block) {
+    // Coins of a background flush in progress are not in the db yet
+    const CCoinsView *coinsdb = pcoinsflusher ? static_cast<const CCoinsView*>(pcoinsflusher.get()) : pcoinsdbview.get();
+    std::vector<std::pair<COutPoint, Coin>> coins;
+    try {
+        for (const auto & tx : block.vtx) {
+            if (tx->IsCoinBase())
+                continue;
+            for (const auto & txin : tx->vin) {
+                Coin coin;
+                if (coinsdb->GetCoin(txin.prevout, coin))
+                    coins.emplace_back(txin.prevout, std::move(coin));
+            }
+        }
+    } catch (const std::runtime_error & e) {
+        LogPrintf("%s: failed to read coins of block %s: %s\n", __func__, block.GetHash().ToString(), e.what());
+        return; // read errors are reported by the serial lookup
+    }
+    LOCK(muPrefetchedBlocks);
+    std::move(coins.begin(), coins.end(), std::back_inserter(vPrefetchedCoins));
+}
+
+static std::shared_ptr<const CBlock> TakePrefetchedBlock(const uint256 & hash) {
+    LOCK(muPrefetchedBlocks);
+    auto it = mapPrefetchedBlocks.find(hash);
+    if (it == mapPrefetchedBlocks.end())
+        return nullptr;
+    std::shared_ptr<const CBlock> pblock = it->second;
+    mapPrefetchedBlocks.erase(it);
+    return pblock;
+}
+
+bool CStakeCheck::operator()() {
+    // Read ahead and run the context-free checks, CheckBlock marks the block as checked
+    // so ConnectBlock doesn't repeat them
+    std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+    if (ReadBlockFromDisk(*pblock, pos, *params) && pblock->GetHash() == pindex->GetBlockHash()) {
+        CValidationState state;
+        if (CheckBlock(*pblock, state, *params)) {
+            PrefetchCoins(*pblock);
+            LOCK(muPrefetchedBlocks);
+            mapPrefetchedBlocks[pindex->GetBlockHash()] = pblock;
+        }
+    } else {
+        pblock.reset();
+    }
+
+    if (!pindexFrom)
+        return true; // not a proof-of-stake block, or its stake was already checked
+
+    StakeCheckResult result;
+    result.height = pindex->nHeight;
+    result.prechecked = true;
+    const CBlockHeader header = pindex->GetBlockHeader();
+    result.kernel = CheckStakeKernelHashV05(header, pindex->pprev, pindexFrom, result.hashProofOfStake);
+
+    if (g_txindex && pblock && pblock->vtx.size() > 1 && pblock->vtx[1]->IsCoinStake())
+    {
+        const CBlock & block = *pblock;
+        const auto & txin = block.vtx[1]->vin[0];
+        uint256 hashStakeInputBlock;
+        CTransactionRef txStake;
+        if (g_txindex->FindTx(txin.prevout.hash, hashStakeInputBlock, txStake) && txStake->vout.size() > txin.prevout.n) {
+            const auto & txout = txStake->vout[txin.prevout.n];
+            result.signature = txout.nValue == block.nStakeAmount && txout.nValue > 0
+                && (VerifySig(block, txout.scriptPubKey) || VerifySig(block, block.vtx[1]->vout[1].scriptPubKey));
+        }
+    }
+
+    SetStakeCheck(pindex->GetBlockHash(), result);
+    return true; // failures are reported by the serial checks
+}
+
+/**
+ * Reads, deserializes and runs the context-free checks of the next blocks to connect on the
+ * stake check threads, together with their proof-of-stake checks, and warms the coins they
+ * spend into pcoinsTip. ConnectTip takes the prefetched blocks and ConnectBlock and
+ * CheckProofOfStake use the results instead of repeating the checks and the coins db reads
+ * serially. The blocks are collected under cs_main and checked without it.
+ */
+void CChainState::PrecheckStakes(const Consensus::Params & params)
+{
+    if (!nScriptCheckThreads)
+        return;
+    std::vector<CStakeCheck> vChecks;
+    const CBlockIndex *pindexTip = nullptr;
+    uint64_t nFlushes = 0;
+    {
+        LOCK(cs_main);
+        CBlockIndex *pindexMostWork = FindMostWorkChain();
+        pindexTip = chainActive.Tip();
+        nFlushes = nCoinsFlushes;
+        std::set<uint256> setWindow;
+        LOCK(muPrefetchedBlocks);
+        if (pindexMostWork && pindexMostWork != pindexTip) {
+            // The same window of blocks the next ActivateBestChainStep connects, blocks that
+            // were prefetched for a previous window are kept
+            const CBlockIndex *pindexFork = chainActive.FindFork(pindexMostWork);
+            const int nHeight = pindexFork ? pindexFork->nHeight : -1;
+            for (CBlockIndex *pindex = pindexMostWork->GetAncestor(std::min(nHeight + 32, pindexMostWork->nHeight));
+                    pindex && pindex->nHeight != nHeight; pindex = pindex->pprev) {
+                setWindow.insert(pindex->GetBlockHash());
+                if (!pindex->pprev || !(pindex->nStatus & BLOCK_HAVE_DATA) || mapPrefetchedBlocks.count(pindex->GetBlockHash()))
+                    continue;
+                const CBlockIndex *pindexFrom = nullptr;
+                StakeCheckResult result;
+                if (pindex->IsProofOfStake() && !(GetStakeCheck(pindex->GetBlockHash(), result) && result.prechecked))
+                    pindexFrom = LookupBlockIndex(pindex->hashStakeBlock);
+                vChecks.emplace_back(pindex, pindexFrom, pindex->GetBlockPos(), params);
+            }
+        }
+        // Blocks that are not in the window anymore won't be connected next
+        for (auto it = mapPrefetchedBlocks.begin(); it != mapPrefetchedBlocks.end(); ) {
+            if (setWindow.count(it->first))
+                ++it;
+            else
+                it = mapPrefetchedBlocks.erase(it);
+        }
+        vPrefetchedCoins.clear();
+    }
+    if (vChecks.empty())
+        return;
+    CCheckQueueControl<CStakeCheck> control(&stakecheckqueue);
+    control.Add(vChecks);
+    control.Wait();
+
+    // The coins read by the checks are only current while no block was connected or
+    // disconnected and pcoinsTip wasn't flushed since they were collected, pcoinsTip may have
+    // a newer version of a coin, which WarmCoin keeps
+    LOCK2(cs_main, muPrefetchedBlocks);
+    if (chainActive.Tip() == pindexTip && nCoinsFlushes == nFlushes) {
+        for (auto & entry : vPrefetchedCoins)
+            pcoinsTip->WarmCoin(entry.first, std::move(entry.second));
+    }
+    vPrefetchedCoins.clear();
+}
+
 VersionBitsCache versionbitscache GUARDED_BY(cs_main);
 
 int32_t ComputeBlockVersion(const CBlockIndex* pindexPrev, const Consensus::Params& params)
@@ -1802,6 +2204,7 @@ static unsigned int GetBlockScriptFlags(const CBlockIndex* pindex, const Consens
 
 
 static int64_t nTimeCheck = 0;
+static int64_t nTimeStake = 0;
 static int64_t nTimeForks = 0;
 static int64_t nTimeVerify = 0;
 static int64_t nTimeConnect = 0;
@@ -1845,7 +2248,10 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     }
 
     // PoS verification checks
-    if (IsProofOfStake(pindex->nHeight) || block.IsProofOfStake()) {
+    const int64_t nTimeStakeStart = GetTimeMicros();
+    StakeCheckResult stakeCheck;
+    const bool stakeSignatureChecked = GetStakeCheck(pindex->GetBlockHash(), stakeCheck) && stakeCheck.signature;
+    if ((IsProofOfStake(pindex->nHeight) || block.IsProofOfStake()) && !stakeSignatureChecked) {
         const auto & txin = block.vtx[1]->vin[0];
         uint256 hashStakeInputBlock;
         CTransactionRef txStake;
@@ -1866,6 +2272,8 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     // PoS check that only staking blocks are allowed
     if (pindex->nHeight > chainparams.GetConsensus().lastPOWBlock && !block.IsProofOfStake())
         return state.DoS(100, false, REJECT_INVALID, "PoW-ended");
+    const int64_t nTimeStakeEnd = GetTimeMicros(); nTimeStake += nTimeStakeEnd - nTimeStakeStart;
+    LogPrint(BCLog::BENCH, "    - Stake checks: %.2fms [%.2fs]\n", MILLI * (nTimeStakeEnd - nTimeStakeStart), nTimeStake * MICRO);
 
     // verify that the view's current state corresponds to the previous block
     uint256 hashPrevBlock = pindex->pprev == nullptr ? uint256() : pindex->pprev->GetBlockHash();
@@ -2117,6 +2525,11 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
         bool fPeriodicFlush = mode == FlushStateMode::PERIODIC && nNow > nLastFlush + (int64_t)DATABASE_FLUSH_INTERVAL * 1000000;
         // Combine all conditions that result in a full cache flush.
         fDoFullFlush = (mode == FlushStateMode::ALWAYS) || fCacheLarge || fCacheCritical || fPeriodicFlush || fFlushForPrune;
+        // Write the chainstate in the background unless it has to be on disk when this returns. Pruning
+        // needs the coins db to be past the blocks of the pruned files in case the write is interrupted.
+        bool fBackgroundFlush = pcoinsflusher && mode != FlushStateMode::ALWAYS && !fFlushForPrune;
+        if (pcoinsflusher && pcoinsflusher->WriteFailed())
+            return AbortNode(state, "Failed to write to coin database");
         // Write blocks and block index to disk.
         if (fDoFullFlush || fPeriodicWrite) {
             // Depend on nMinDiskSpace to ensure we can write block index
@@ -2141,6 +2554,9 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
                 if (!pblocktree->WriteBatchSync(vFiles, nLastBlockFile, vBlocks)) {
                     return AbortNode(state, "Failed to write to block index database");
                 }
+                if (!FlushStakeModifierCache()) {
+                    return AbortNode(state, "Failed to write stake modifiers to block index database");
+                }
             }
             // Finally remove any pruned files
             if (fFlushForPrune)
@@ -2159,6 +2575,9 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
             // Flush the chainstate (which may refer to block index entries).
             if (!pcoinsTip->Flush())
                 return AbortNode(state, "Failed to write to coin database");
+            ++nCoinsFlushes;
+            if (pcoinsflusher && !fBackgroundFlush && !pcoinsflusher->Sync())
+                return AbortNode(state, "Failed to write to coin database");
             nLastFlush = nNow;
             full_flush_completed = true;
         }
@@ -2184,6 +2603,24 @@ void FlushStateToDisk() {
     }
 }
 
+void WriteBlockIndexSnapshot() {
+    AssertLockHeld(cs_main);
+    if (!fBlockIndexSnapshot || !pblocktree)
+        return;
+    // Entries that failed to flush are not in the database, the snapshot must not have them either
+    if (!setDirtyBlockIndex.empty()) {
+        LogPrintf("%s: block index not fully flushed, skipping the snapshot\n", __func__);
+        return;
+    }
+    std::vector<const CBlockIndex*> vBlocks;
+    vBlocks.reserve(mapBlockIndex.size());
+    for (const auto& entry : mapBlockIndex)
+        vBlocks.push_back(entry.second);
+    const int64_t nStart = GetTimeMillis();
+    if (pblocktree->WriteBlockIndexSnapshot(vBlocks))
+        LogPrintf("Wrote block index snapshot with %u entries in %dms\n", vBlocks.size(), GetTimeMillis() - nStart);
+}
+
 void PruneAndFlush() {
     CValidationState state;
     fCheckForPruning = true;
@@ -2318,10 +2755,36 @@ bool CChainState::DisconnectTip(CValidationState& state, const CChainParams& cha
 
 static int64_t nTimeReadFromDisk = 0;
 static int64_t nTimeConnectTotal = 0;
+static metrics::Histogram g_metric_connect_block{"blocknet_block_connect_seconds", "Duration of connecting a block to the tip"};
+static metrics::CallbackGauge g_metric_blocks{"blocknet_blocks", "Height of the active chain", []{
+    LOCK(cs_main);
+    return (double)chainActive.Height();
+}};
+static metrics::CallbackGauge g_metric_mempool_txs{"blocknet_mempool_transactions", "Transactions in the mempool", []{
+    return (double)mempool.size();
+}};
+static metrics::CallbackGauge g_metric_mempool_bytes{"blocknet_mempool_usage_bytes", "Memory usage of the mempool", []{
+    return (double)mempool.DynamicMemoryUsage();
+}};
 static int64_t nTimeFlush = 0;
 static int64_t nTimeChainState = 0;
 static int64_t nTimePostConnect = 0;
 
+ConnectBlockTimes GetConnectBlockTimes()
+{
+    LOCK(cs_main);
+    ConnectBlockTimes times;
+    times.blocks = nBlocksTotal;
+    times.stake = nTimeStake;
+    times.checks = nTimeCheck;
+    times.connect = nTimeConnect;
+    times.verify = nTimeVerify;
+    times.flush = nTimeFlush;
+    times.chainstate = nTimeChainState;
+    times.total = nTimeTotal;
+    return times;
+}
+
 struct PerBlockConnectTrace {
     CBlockIndex* pindex = nullptr;
     std::shared_ptr<const CBlock> pblock;
@@ -2397,10 +2860,19 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
     int64_t nTime1 = GetTimeMicros();
     std::shared_ptr<const CBlock> pthisBlock;
     if (!pblock) {
-        std::shared_ptr<CBlock> pblockNew = std::make_shared<CBlock>();
-        if (!ReadBlockFromDisk(*pblockNew, pindexNew, chainparams.GetConsensus()))
-            return AbortNode(state, "Failed to read block");
-        pthisBlock = pblockNew;
+        std::shared_ptr<const CBlock> pblockPrefetched = TakePrefetchedBlock(pindexNew->GetBlockHash());
+        if (pblockPrefetched) {
+            // Same proof-of-stake check as ReadBlockFromDisk, the kernel was checked ahead
+            uint256 hashProofOfStake;
+            if (pblockPrefetched->IsProofOfStake() && !CheckProofOfStake(*pblockPrefetched, pindexNew->pprev, hashProofOfStake, chainparams.GetConsensus()))
+                return AbortNode(state, "Failed to read block");
+            pthisBlock = pblockPrefetched;
+        } else {
+            std::shared_ptr<CBlock> pblockNew = std::make_shared<CBlock>();
+            if (!ReadBlockFromDisk(*pblockNew, pindexNew, chainparams.GetConsensus()))
+                return AbortNode(state, "Failed to read block");
+            pthisBlock = pblockNew;
+        }
     } else {
         pthisBlock = pblock;
     }
@@ -2440,6 +2912,11 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
     int64_t nTime6 = GetTimeMicros(); nTimePostConnect += nTime6 - nTime5; nTimeTotal += nTime6 - nTime1;
     LogPrint(BCLog::BENCH, "  - Connect postprocess: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime6 - nTime5) * MILLI, nTimePostConnect * MICRO, nTimePostConnect * MILLI / nBlocksTotal);
     LogPrint(BCLog::BENCH, "- Connect block: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime6 - nTime1) * MILLI, nTimeTotal * MICRO, nTimeTotal * MILLI / nBlocksTotal);
+    g_metric_connect_block.Observe(nTime6 - nTime1);
+
+    // Blocks near the tip are the ones read again by RPC, REST and xbridge
+    if (!IsInitialBlockDownload())
+        blockReadCache.Add(pindexNew->GetBlockHash(), pthisBlock);
 
     connectTrace.BlockConnected(pindexNew, std::move(pthisBlock));
     return true;
@@ -2667,6 +3144,9 @@ bool CChainState::ActivateBestChain(CValidationState &state, const CChainParams&
         // probably have a DEBUG_LOCKORDER test for this in the future.
         LimitValidationInterfaceQueue();
 
+        // Check the stakes of the next blocks in parallel, before cs_main is taken
+        PrecheckStakes(chainparams.GetConsensus());
+
         {
             LOCK(cs_main);
             CBlockIndex* starting_tip = chainActive.Tip();
@@ -2904,11 +3384,15 @@ void ResetBlockFailureFlags(CBlockIndex *pindex) {
 }
 
 CBlockIndex* CChainState::AddToBlockIndex(const CBlockHeader& block)
+{
+    return AddToBlockIndex(block, block.GetHash());
+}
+
+CBlockIndex* CChainState::AddToBlockIndex(const CBlockHeader& block, const uint256& hash)
 {
     AssertLockHeld(cs_main);
 
     // Check for duplicate
-    uint256 hash = block.GetHash();
     BlockMap::iterator it = mapBlockIndex.find(hash);
     if (it != mapBlockIndex.end())
         return it->second;
@@ -2933,15 +3417,13 @@ CBlockIndex* CChainState::AddToBlockIndex(const CBlockHeader& block)
         pindexNew->SetStakeEntropyBit(ebit);
         if (IsProofOfStake(pindexNew->nHeight)) {
             pindexNew->SetProofOfStake();
-            if (HasHashProofOfStake(hash))
-                pindexNew->hashProofOfStake = GetHashProofOfStake(hash);
-            else {
-                uint256 hashProofOfStake;
-                if (!CheckProofOfStake(block, pindexNew->pprev, hashProofOfStake, Params().GetConsensus()))
+            // The hash computed by CheckBlockHeader is only needed until the entry holds it
+            uint256 hashProofOfStake;
+            if (!TakeHashProofOfStake(hash, hashProofOfStake)) {
+                if (!CheckProofOfStake(block, hash, pindexNew->pprev, hashProofOfStake, Params().GetConsensus()))
                     LogPrint(BCLog::ALL, "AddToBlockIndex() : CheckProofOfStake failed\n");
-                pindexNew->hashProofOfStake = hashProofOfStake;
-                SetHashProofOfStake(block.GetHash(), hashProofOfStake);
             }
+            pindexNew->hashProofOfStake = hashProofOfStake;
         }
 
         // ppcoin: compute stake modifier
@@ -2960,7 +3442,7 @@ CBlockIndex* CChainState::AddToBlockIndex(const CBlockHeader& block)
     setDirtyBlockIndex.insert(pindexNew);
 
     // Store in header index
-    mapHeaderIndex[pindexNew->nHeight] = pindexNew;
+    chainHeaders.Set(pindexNew->nHeight, pindexNew);
     if (pindexNew->nHeight % 10000 == 0)
         LogPrintf("Processing block indices at %u %s\n", pindexNew->nHeight, pindexNew->GetBlockHash().ToString());
 
@@ -3102,27 +3584,30 @@ static bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos,
     return true;
 }
 
-static bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true)
+static bool CheckBlockHeader(const CBlockHeader& block, const uint256& blockHash, CValidationState& state, const Consensus::Params& consensusParams)
 {
-    if (!fCheckPOW)
-        return true;
-
     // Check proof of work matches claimed amount
     if (block.hashStake.IsNull()) {
-        if (!CheckProofOfWork(block.GetHash(), block.nBits, consensusParams))
+        if (!CheckProofOfWork(blockHash, block.nBits, consensusParams))
             return state.DoS(50, false, REJECT_INVALID, "high-hash", false, "proof of work failed");
         return true;
     }
 
     // Check proof of stake
-    uint256 blockHash = block.GetHash();
     uint256 hashProofOfStake;
-    bool valid = CheckPoS(block, state, hashProofOfStake, consensusParams);
+    bool valid = CheckPoS(block, blockHash, state, hashProofOfStake, consensusParams);
     if (valid && !HasHashProofOfStake(blockHash))
         SetHashProofOfStake(blockHash, hashProofOfStake);
     return valid;
 }
 
+static bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true)
+{
+    if (!fCheckPOW)
+        return true;
+    return CheckBlockHeader(block, block.GetHash(), state, consensusParams);
+}
+
 bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW, bool fCheckMerkleRoot)
 {
     // These are checks that are independent of context.
@@ -3442,10 +3927,14 @@ static bool ContextualCheckBlock(const CBlock& block, CValidationState& state, c
 }
 
 bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex)
+{
+    return AcceptBlockHeader(block, block.GetHash(), state, chainparams, ppindex);
+}
+
+bool CChainState::AcceptBlockHeader(const CBlockHeader& block, const uint256& hash, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex)
 {
     AssertLockHeld(cs_main);
     // Check for duplicate
-    uint256 hash = block.GetHash();
     BlockMap::iterator miSelf = mapBlockIndex.find(hash);
     CBlockIndex *pindex = nullptr;
     if (hash != chainparams.GetConsensus().hashGenesisBlock) {
@@ -3459,7 +3948,7 @@ bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState&
             return true;
         }
 
-        if (!CheckBlockHeader(block, state, chainparams.GetConsensus()))
+        if (!CheckBlockHeader(block, hash, state, chainparams.GetConsensus()))
             return error("%s: Consensus::CheckBlockHeader: %s, %s", __func__, hash.ToString(), FormatStateMessage(state));
 
         // Get prev block index
@@ -3512,7 +4001,7 @@ bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState&
         }
     }
     if (pindex == nullptr)
-        pindex = AddToBlockIndex(block);
+        pindex = AddToBlockIndex(block, hash);
 
     if (ppindex)
         *ppindex = pindex;
@@ -3522,15 +4011,40 @@ bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState&
     return true;
 }
 
+std::vector<uint256> GetBlockHeaderHashes(const std::vector<CBlockHeader>& headers)
+{
+    std::vector<uint256> hashes(headers.size());
+    // Ranges of headers are hashed on the signature check threads, a handful of headers
+    // per check keeps the queue overhead small compared to the hashing
+    CSignatureBatch batch;
+    for (size_t begin = 0; begin < headers.size(); begin += MIN_HEADERS_PER_HASH_THREAD) {
+        const size_t end = std::min(begin + MIN_HEADERS_PER_HASH_THREAD, headers.size());
+        batch.Add([&headers, &hashes, begin, end]() {
+            for (size_t i = begin; i < end; ++i)
+                hashes[i] = headers[i].GetHash();
+            return true;
+        });
+    }
+    batch.Verify();
+    return hashes;
+}
+
 // Exposed wrapper for AcceptBlockHeader
 bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex, CBlockHeader *first_invalid)
 {
+    return ProcessNewBlockHeaders(headers, GetBlockHeaderHashes(headers), state, chainparams, ppindex, first_invalid);
+}
+
+bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, const std::vector<uint256>& hashes, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex, CBlockHeader *first_invalid)
+{
+    assert(hashes.size() == headers.size());
     if (first_invalid != nullptr) first_invalid->SetNull();
     {
         LOCK(cs_main);
-        for (const CBlockHeader& header : headers) {
+        for (size_t i = 0; i < headers.size(); ++i) {
+            const CBlockHeader& header = headers[i];
             CBlockIndex *pindex = nullptr; // Use a temp pindex instead of ppindex to avoid a const_cast
-            if (!g_chainstate.AcceptBlockHeader(header, state, chainparams, &pindex)) {
+            if (!g_chainstate.AcceptBlockHeader(header, hashes[i], state, chainparams, &pindex)) {
                 if (first_invalid) *first_invalid = header;
                 return false;
             }
@@ -3760,6 +4274,7 @@ void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune)
 {
     for (std::set<int>::iterator it = setFilesToPrune.begin(); it != setFilesToPrune.end(); ++it) {
         CDiskBlockPos pos(*it, 0);
+        g_block_file_maps.Drop(*it);
         fs::remove(GetBlockPosFilename(pos, "blk"));
         fs::remove(GetBlockPosFilename(pos, "rev"));
         LogPrintf("Prune: %s deleted blk/rev (%05u)\n", __func__, *it);
@@ -3939,7 +4454,9 @@ CBlockIndex * CChainState::InsertBlockIndex(const uint256& hash)
 
 bool CChainState::LoadBlockIndex(const Consensus::Params& consensus_params, CBlockTreeDB& blocktree)
 {
-    if (!blocktree.LoadBlockIndexGuts(consensus_params, [this](const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main) { return this->InsertBlockIndex(hash); }))
+    const auto insertBlockIndex = [this](const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main) { return this->InsertBlockIndex(hash); };
+    if (!(fBlockIndexSnapshot && blocktree.LoadBlockIndexSnapshot(insertBlockIndex))
+        && !blocktree.LoadBlockIndexGuts(consensus_params, insertBlockIndex))
         return false;
 
     // Calculate nChainWork
@@ -3984,7 +4501,7 @@ bool CChainState::LoadBlockIndex(const Consensus::Params& consensus_params, CBlo
             pindexBestHeader = pindex;
 
         // Store in header index
-        mapHeaderIndex[pindex->nHeight] = pindex;
+        chainHeaders.Set(pindex->nHeight, pindex);
     }
 
     return true;
@@ -4104,15 +4621,10 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
     CValidationState state;
     int reportDone = 0;
     LogPrintf("[0%%]..."); /* Continued */
+
+    // Blocks to verify, tip first
+    std::vector<CBlockIndex*> vIndex;
     for (pindex = chainActive.Tip(); pindex && pindex->pprev; pindex = pindex->pprev) {
-        boost::this_thread::interruption_point();
-        const int percentageDone = std::max(1, std::min(99, (int)(((double)(chainActive.Height() - pindex->nHeight)) / (double)nCheckDepth * (nCheckLevel >= 4 ? 50 : 100))));
-        if (reportDone < percentageDone/10) {
-            // report every 10% step
-            LogPrintf("[%d%%]...", percentageDone); /* Continued */
-            reportDone = percentageDone/10;
-        }
-        uiInterface.ShowProgress(_("Verifying blocks..."), percentageDone, false);
         if (pindex->nHeight <= chainActive.Height()-nCheckDepth)
             break;
         if (fPruneMode && !(pindex->nStatus & BLOCK_HAVE_DATA)) {
@@ -4120,39 +4632,93 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
             LogPrintf("VerifyDB(): block verification stopping at height %d (pruning, no data)\n", pindex->nHeight);
             break;
         }
-        CBlock block;
-        // check level 0: read from disk
-        if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus()))
-            return error("VerifyDB(): *** ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
-        // check level 1: verify block validity
-        if (nCheckLevel >= 1 && !CheckBlock(block, state, chainparams.GetConsensus()))
-            return error("%s: *** found bad block at %d, hash=%s (%s)\n", __func__,
-                         pindex->nHeight, pindex->GetBlockHash().ToString(), FormatStateMessage(state));
-        // check level 2: verify undo validity
-        if (nCheckLevel >= 2 && pindex) {
-            CBlockUndo undo;
-            if (!pindex->GetUndoPos().IsNull()) {
-                if (!UndoReadFromDisk(undo, pindex)) {
-                    return error("VerifyDB(): *** found bad undo data at %d, hash=%s\n", pindex->nHeight, pindex->GetBlockHash().ToString());
+        vIndex.push_back(pindex);
+    }
+
+    // Levels 0 to 2 are checked in parallel a batch of blocks at a time, the workers don't
+    // take cs_main. The proof of stake checks and level 3 follow in chain order.
+    const size_t nThreads = std::max(GetNumCores(), 1);
+    const size_t nBatch = nThreads * VERIFYDB_BLOCKS_PER_THREAD;
+    for (size_t nStart = 0; nStart < vIndex.size(); nStart += nBatch) {
+        const size_t nEnd = std::min(vIndex.size(), nStart + nBatch);
+        std::vector<CDiskBlockPos> positions;
+        for (size_t i = nStart; i < nEnd; ++i)
+            positions.push_back(vIndex[i]->GetBlockPos());
+        std::vector<CBlock> blocks(nEnd - nStart);
+        std::vector<std::string> failures(nEnd - nStart);
+        std::atomic<size_t> next{nStart};
+        auto worker = [&]() {
+            for (size_t i = next++; i < nEnd; i = next++) {
+                if (ShutdownRequested())
+                    break;
+                const CBlockIndex* pindexCheck = vIndex[i];
+                CBlock& block = blocks[i - nStart];
+                // check level 0: read from disk
+                if (!ReadBlockFromDisk(block, positions[i - nStart], chainparams.GetConsensus()) || block.GetHash() != pindexCheck->GetBlockHash()) {
+                    failures[i - nStart] = strprintf("VerifyDB(): *** ReadBlockFromDisk failed at %d, hash=%s", pindexCheck->nHeight, pindexCheck->GetBlockHash().ToString());
+                    continue;
+                }
+                // check level 1: verify block validity
+                CValidationState blockState;
+                if (nCheckLevel >= 1 && !CheckBlock(block, blockState, chainparams.GetConsensus())) {
+                    failures[i - nStart] = strprintf("%s: *** found bad block at %d, hash=%s (%s)\n", __func__,
+                                                     pindexCheck->nHeight, pindexCheck->GetBlockHash().ToString(), FormatStateMessage(blockState));
+                    continue;
+                }
+                // check level 2: verify undo validity
+                if (nCheckLevel >= 2) {
+                    CBlockUndo undo;
+                    if (!pindexCheck->GetUndoPos().IsNull()) {
+                        if (!UndoReadFromDisk(undo, pindexCheck)) {
+                            failures[i - nStart] = strprintf("VerifyDB(): *** found bad undo data at %d, hash=%s\n", pindexCheck->nHeight, pindexCheck->GetBlockHash().ToString());
+                        }
+                    }
                 }
             }
-        }
-        // check level 3: check for inconsistencies during memory-only disconnect of tip blocks
-        if (nCheckLevel >= 3 && (coins.DynamicMemoryUsage() + pcoinsTip->DynamicMemoryUsage()) <= nCoinCacheUsage) {
-            assert(coins.GetBestBlock() == pindex->GetBlockHash());
-            DisconnectResult res = g_chainstate.DisconnectBlock(block, pindex, coins);
-            if (res == DISCONNECT_FAILED) {
-                return error("VerifyDB(): *** irrecoverable inconsistency in block data at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
+        };
+        const size_t nWorkers = std::min(nThreads, nEnd - nStart);
+        std::vector<std::thread> threads;
+        for (size_t t = 1; t < nWorkers; ++t)
+            threads.emplace_back(worker);
+        worker();
+        for (auto& thread : threads)
+            thread.join();
+
+        for (size_t i = nStart; i < nEnd; ++i) {
+            CBlockIndex* pindexCheck = vIndex[i];
+            boost::this_thread::interruption_point();
+            const int percentageDone = std::max(1, std::min(99, (int)(((double)(chainActive.Height() - pindexCheck->nHeight)) / (double)nCheckDepth * (nCheckLevel >= 4 ? 50 : 100))));
+            if (reportDone < percentageDone/10) {
+                // report every 10% step
+                LogPrintf("[%d%%]...", percentageDone); /* Continued */
+                reportDone = percentageDone/10;
             }
-            if (res == DISCONNECT_UNCLEAN) {
-                nGoodTransactions = 0;
-                pindexFailure = pindex;
-            } else {
-                nGoodTransactions += block.vtx.size();
+            uiInterface.ShowProgress(_("Verifying blocks..."), percentageDone, false);
+            if (ShutdownRequested())
+                return true;
+            if (!failures[i - nStart].empty())
+                return error("%s", failures[i - nStart]);
+            const CBlock& block = blocks[i - nStart];
+            if (block.IsProofOfStake()) { // the proof of stake check of ReadBlockFromDisk
+                uint256 hashProofOfStake;
+                if (!CheckProofOfStake(block, pindexCheck->pprev, hashProofOfStake, chainparams.GetConsensus()))
+                    return error("VerifyDB(): *** proof of stake check failed at %d, hash=%s", pindexCheck->nHeight, pindexCheck->GetBlockHash().ToString());
+            }
+            // check level 3: check for inconsistencies during memory-only disconnect of tip blocks
+            if (nCheckLevel >= 3 && (coins.DynamicMemoryUsage() + pcoinsTip->DynamicMemoryUsage()) <= nCoinCacheUsage) {
+                assert(coins.GetBestBlock() == pindexCheck->GetBlockHash());
+                DisconnectResult res = g_chainstate.DisconnectBlock(block, pindexCheck, coins);
+                if (res == DISCONNECT_FAILED) {
+                    return error("VerifyDB(): *** irrecoverable inconsistency in block data at %d, hash=%s", pindexCheck->nHeight, pindexCheck->GetBlockHash().ToString());
+                }
+                if (res == DISCONNECT_UNCLEAN) {
+                    nGoodTransactions = 0;
+                    pindexFailure = pindexCheck;
+                } else {
+                    nGoodTransactions += block.vtx.size();
+                }
             }
         }
-        if (ShutdownRequested())
-            return true;
     }
     if (pindexFailure)
         return error("VerifyDB(): *** coin database inconsistencies found (last %i blocks, %i good transactions before that)\n", chainActive.Height() - pindexFailure->nHeight + 1, nGoodTransactions);
@@ -4455,7 +5021,8 @@ void UnloadBlockIndex()
         delete entry.second;
     }
     mapBlockIndex.clear();
-    mapHeaderIndex.clear();
+    chainHeaders.Clear();
+    ClearStakeModifierCache();
     fHavePruned = false;
 
     g_chainstate.UnloadBlockIndex();
@@ -4846,12 +5413,19 @@ int VersionBitsTipStateSinceHeight(const Consensus::Params& params, Consensus::D
 }
 
 static const uint64_t MEMPOOL_DUMP_VERSION = 1;
+/** Size of the stdio buffer of mempool.dat reads and writes */
+static const size_t MEMPOOL_FILE_BUFFER_SIZE = 1 << 20;
+/** Transactions of mempool.dat accepted per AcceptToMemoryPoolBatch call */
+static const size_t MEMPOOL_LOAD_BATCH_SIZE = 1000;
 
 bool LoadMempool()
 {
     const CChainParams& chainparams = Params();
     int64_t nExpiryTimeout = gArgs.GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60;
+    std::vector<char> buffer(MEMPOOL_FILE_BUFFER_SIZE);
     FILE* filestr = fsbridge::fopen(GetDataDir() / "mempool.dat", "rb");
+    if (filestr)
+        setvbuf(filestr, buffer.data(), _IOFBF, buffer.size());
     CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
     if (file.IsNull()) {
         LogPrintf("Failed to open mempool file from disk. Continuing anyway.\n");
@@ -4864,6 +5438,38 @@ bool LoadMempool()
     int64_t already_there = 0;
     int64_t nNow = GetTime();
 
+    // Transactions are accepted in batches, so that their scripts are verified in parallel.
+    // The dump lists parents before their children.
+    std::vector<CTransactionRef> txs;
+    std::vector<int64_t> times;
+    auto acceptBatch = [&]() {
+        if (txs.empty())
+            return;
+        std::vector<CValidationState> states;
+        std::vector<bool> accepted;
+        {
+            LOCK(cs_main);
+            accepted = AcceptToMemoryPoolBatch(mempool, txs, states, false /* bypass_limits */, 0 /* nAbsurdFee */, times);
+        }
+        for (size_t i = 0; i < txs.size(); ++i) {
+            if (accepted[i]) {
+                ++count;
+            } else {
+                // mempool may contain the transaction already, e.g. from
+                // wallet(s) having loaded it while we were processing
+                // mempool transactions; consider these as valid, instead of
+                // failed, but mark them as 'already there'
+                if (mempool.exists(txs[i]->GetHash())) {
+                    ++already_there;
+                } else {
+                    ++failed;
+                }
+            }
+        }
+        txs.clear();
+        times.clear();
+    };
+
     try {
         uint64_t version;
         file >> version;
@@ -4884,31 +5490,18 @@ bool LoadMempool()
             if (amountdelta) {
                 mempool.PrioritiseTransaction(tx->GetHash(), amountdelta);
             }
-            CValidationState state;
             if (nTime + nExpiryTimeout > nNow) {
-                LOCK(cs_main);
-                AcceptToMemoryPoolWithTime(chainparams, mempool, state, tx, nullptr /* pfMissingInputs */, nTime,
-                                           nullptr /* plTxnReplaced */, false /* bypass_limits */, 0 /* nAbsurdFee */,
-                                           false /* test_accept */);
-                if (state.IsValid()) {
-                    ++count;
-                } else {
-                    // mempool may contain the transaction already, e.g. from
-                    // wallet(s) having loaded it while we were processing
-                    // mempool transactions; consider these as valid, instead of
-                    // failed, but mark them as 'already there'
-                    if (mempool.exists(tx->GetHash())) {
-                        ++already_there;
-                    } else {
-                        ++failed;
-                    }
-                }
+                txs.push_back(tx);
+                times.push_back(nTime);
             } else {
                 ++expired;
             }
+            if (txs.size() >= MEMPOOL_LOAD_BATCH_SIZE)
+                acceptBatch();
             if (ShutdownRequested())
                 return false;
         }
+        acceptBatch();
         std::map<uint256, CAmount> mapDeltas;
         file >> mapDeltas;
 
@@ -4924,6 +5517,83 @@ bool LoadMempool()
     return true;
 }
 
+static const uint64_t SIGCACHE_DUMP_VERSION = 1;
+
+bool DumpSignatureCaches()
+{
+    int64_t start = GetTimeMicros();
+
+    uint256 sigNonce, scriptNonce;
+    std::vector<uint256> sigEntries, scriptEntries;
+    GetSignatureCacheEntries(sigNonce, sigEntries);
+    {
+        LOCK(cs_main); // guards scriptExecutionCache inserts
+        scriptNonce = scriptExecutionCacheNonce;
+        scriptExecutionCache.for_each([&scriptEntries](const uint256& entry) { scriptEntries.push_back(entry); });
+    }
+
+    try {
+        FILE* filestr = fsbridge::fopen(GetDataDir() / "sigcache.dat.new", "wb");
+        if (!filestr) {
+            return false;
+        }
+
+        CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+        file << SIGCACHE_DUMP_VERSION;
+        file << sigNonce << sigEntries;
+        file << scriptNonce << scriptEntries;
+        if (!FileCommit(file.Get()))
+            throw std::runtime_error("FileCommit failed");
+        file.fclose();
+        RenameOver(GetDataDir() / "sigcache.dat.new", GetDataDir() / "sigcache.dat");
+        LogPrintf("Dumped %u signature and %u script execution cache entries in %gs\n",
+                  sigEntries.size(), scriptEntries.size(), (GetTimeMicros()-start)*MICRO);
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to dump signature caches: %s. Continuing anyway.\n", e.what());
+        return false;
+    }
+    return true;
+}
+
+bool LoadSignatureCaches()
+{
+    FILE* filestr = fsbridge::fopen(GetDataDir() / "sigcache.dat", "rb");
+    CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        LogPrintf("Failed to open signature cache file from disk. Continuing anyway.\n");
+        return false;
+    }
+
+    uint256 sigNonce, scriptNonce;
+    std::vector<uint256> sigEntries, scriptEntries;
+    try {
+        uint64_t version;
+        file >> version;
+        if (version != SIGCACHE_DUMP_VERSION) {
+            return false;
+        }
+        file >> sigNonce >> sigEntries;
+        file >> scriptNonce >> scriptEntries;
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to deserialize signature cache data on disk: %s. Continuing anyway.\n", e.what());
+        return false;
+    }
+    file.fclose();
+    // Entries are only valid for the next run, a crash must not bring back stale ones
+    fs::remove(GetDataDir() / "sigcache.dat");
+
+    // The entries are salted, they only match with the salt they were computed with
+    LoadSignatureCacheEntries(sigNonce, sigEntries);
+    {
+        LOCK(cs_main);
+        scriptExecutionCacheNonce = scriptNonce;
+        for (const auto& entry : scriptEntries)
+            scriptExecutionCache.insert(entry);
+    }
+    LogPrintf("Loaded %u signature and %u script execution cache entries\n", sigEntries.size(), scriptEntries.size());
+    return true;
+}
+
 bool DumpMempool()
 {
     int64_t start = GetTimeMicros();
@@ -4945,10 +5615,12 @@ bool DumpMempool()
     int64_t mid = GetTimeMicros();
 
     try {
+        std::vector<char> buffer(MEMPOOL_FILE_BUFFER_SIZE);
         FILE* filestr = fsbridge::fopen(GetDataDir() / "mempool.dat.new", "wb");
         if (!filestr) {
             return false;
         }
+        setvbuf(filestr, buffer.data(), _IOFBF, buffer.size());
 
         CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
 
@@ -5006,7 +5678,7 @@ public:
         for (; it1 != mapBlockIndex.end(); it1++)
             delete (*it1).second;
         mapBlockIndex.clear();
-        mapHeaderIndex.clear();
+        chainHeaders.Clear();
     }
 } instance_of_cmaincleanup;
 
@@ -5099,18 +5771,26 @@ bool SignBlock(CBlock & block, const CScript & stakeScript, const CKeyStore & ke
     return true;
 }
 
-CTransactionRef GetTxFunc(const COutPoint & out) {
-    CTransactionRef tx;
-    uint256 hashBlock;
-    if (!GetTransaction(out.hash, tx, Params().GetConsensus(), hashBlock))
-        return nullptr;
-    {
-        LOCK(cs_main);
-        Coin coin;
-        if (!pcoinsTip->GetCoin(out, coin))
-            return nullptr;
-    }
-    return tx;
+uint256 coinFuncTip GUARDED_BY(cs_main);
+std::map<COutPoint, CTxOut> mapCoinFuncMemo GUARDED_BY(cs_main); // null outputs for spent or unknown utxos
+bool GetCoinFunc(const COutPoint & out, CTxOut & txOutRet) {
+    LOCK(cs_main);
+    const auto tip = chainActive.Tip() ? chainActive.Tip()->GetBlockHash() : uint256();
+    if (tip != coinFuncTip) {
+        mapCoinFuncMemo.clear();
+        coinFuncTip = tip;
+    }
+    auto it = mapCoinFuncMemo.find(out);
+    if (it == mapCoinFuncMemo.end()) {
+        if (mapCoinFuncMemo.size() >= MAX_COIN_FUNC_MEMO)
+            mapCoinFuncMemo.clear();
+        const Coin & coin = pcoinsTip->AccessCoin(out);
+        it = mapCoinFuncMemo.emplace(out, coin.IsSpent() ? CTxOut() : coin.out).first;
+    }
+    if (it->second.IsNull())
+        return false;
+    txOutRet = it->second;
+    return true;
 }
 
 bool IsServiceNodeBlockValidFunc(const uint64_t & blockNumber, const uint256 & blockHash, const bool & checkStale) {
@@ -5124,12 +5804,15 @@ bool IsServiceNodeBlockValidFunc(const uint64_t & blockNumber, const uint256 & b
 }
 
 Mutex muMapProofOfStake;
-std::map<uint256, uint256> mapProofOfStake;
-uint256 GetHashProofOfStake(const uint256 & blockHash) {
+limitedmap<uint256, uint256> mapProofOfStake GUARDED_BY(muMapProofOfStake){MAX_PROOF_OF_STAKE_HASHES};
+bool TakeHashProofOfStake(const uint256 & blockHash, uint256 & hashProofOfStake) {
     LOCK(muMapProofOfStake);
-    if (mapProofOfStake.count(blockHash))
-        return mapProofOfStake[blockHash];
-    return {};
+    auto it = mapProofOfStake.find(blockHash);
+    if (it == mapProofOfStake.end())
+        return false;
+    hashProofOfStake = it->second;
+    mapProofOfStake.erase(blockHash);
+    return true;
 }
 bool HasHashProofOfStake(const uint256 & blockHash) {
     LOCK(muMapProofOfStake);
@@ -5137,5 +5820,36 @@ bool HasHashProofOfStake(const uint256 & blockHash) {
 }
 void SetHashProofOfStake(const uint256 & blockHash, const uint256 & hashProofOfStake) {
     LOCK(muMapProofOfStake);
-    mapProofOfStake[blockHash] = hashProofOfStake;
-}
\ No newline at end of file
+    auto it = mapProofOfStake.find(blockHash);
+    if (it == mapProofOfStake.end())
+        mapProofOfStake.insert(std::make_pair(blockHash, hashProofOfStake));
+    else
+        mapProofOfStake.update(it, hashProofOfStake);
+}
+
+Mutex muStakeChecks;
+limitedmap<uint256, StakeCheckResult> mapStakeChecks GUARDED_BY(muStakeChecks){MAX_STAKE_CHECK_RESULTS};
+bool GetStakeCheck(const uint256 & blockHash, StakeCheckResult & result) {
+    LOCK(muStakeChecks);
+    auto it = mapStakeChecks.find(blockHash);
+    if (it == mapStakeChecks.end())
+        return false;
+    result = it->second;
+    return true;
+}
+void SetStakeCheck(const uint256 & blockHash, const StakeCheckResult & result) {
+    LOCK(muStakeChecks);
+    auto it = mapStakeChecks.find(blockHash);
+    if (it == mapStakeChecks.end()) {
+        mapStakeChecks.insert(std::make_pair(blockHash, result));
+        return;
+    }
+    StakeCheckResult merged = it->second;
+    if (result.kernel) {
+        merged.kernel = true;
+        merged.hashProofOfStake = result.hashProofOfStake;
+    }
+    merged.signature |= result.signature;
+    merged.prechecked |= result.prechecked;
+    mapStakeChecks.update(it, merged);
+}
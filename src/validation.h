@@ -39,7 +39,9 @@
 
 class CBlockIndex;
 class CBlockTreeDB;
+class CBlockUndo;
 class CChainParams;
+class CCoinsViewBackgroundFlush;
 class CCoinsViewDB;
 class CInv;
 class CConnman;
@@ -82,6 +84,10 @@ static const unsigned int MAX_BLOCKFILE_SIZE = 0x8000000; // 128 MiB
 static const unsigned int BLOCKFILE_CHUNK_SIZE = 0x1000000; // 16 MiB
 /** The pre-allocation chunk size for rev?????.dat files (since 0.8) */
 static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
+/** Headers hashed by each check GetBlockHeaderHashes queues on the signature check threads */
+static const size_t MIN_HEADERS_PER_HASH_THREAD = 64;
+/** Blocks read and checked per thread by each parallel pass of VerifyDB */
+static const size_t VERIFYDB_BLOCKS_PER_THREAD = 8;
 
 /** Maximum number of script-checking threads allowed */
 static const int MAX_SCRIPTCHECK_THREADS = 16;
@@ -122,10 +128,18 @@ static const int64_t MAX_FEE_ESTIMATION_TIP_AGE = 20 * 60; // 20 minutes
 /** Default for -permitbaremultisig */
 static const bool DEFAULT_PERMIT_BAREMULTISIG = true;
 static const bool DEFAULT_CHECKPOINTS_ENABLED = true;
+/** Default for -blockmmap */
+static const bool DEFAULT_BLOCK_MMAP = false;
+/** Default for -blockindexsnapshot */
+static const bool DEFAULT_BLOCK_INDEX_SNAPSHOT = true;
+/** Default for -blockreadcache (MiB) */
+static const size_t DEFAULT_BLOCK_READ_CACHE = 32;
 static const bool DEFAULT_TXINDEX = true;
 static const unsigned int DEFAULT_BANSCORE_THRESHOLD = 100;
 /** Default for -persistmempool */
 static const bool DEFAULT_PERSIST_MEMPOOL = true;
+/** Default for -persistsigcache, save and load the signature and script execution caches */
+static const bool DEFAULT_PERSIST_SIGCACHE = false;
 /** Default for -mempoolreplacement */
 static const bool DEFAULT_ENABLE_REPLACEMENT = true;
 /** Default for using fee filter */
@@ -138,6 +152,7 @@ static const unsigned int MAX_BLOCKS_TO_ANNOUNCE = 8;
 static const int MAX_UNCONNECTING_HEADERS = 10;
 
 static const bool DEFAULT_PEERBLOOMFILTERS = true;
+static const bool DEFAULT_PEERBLOCKFILTERS = false;
 
 /** Default for -stopatheight */
 static const int DEFAULT_STOPATHEIGHT = 0;
@@ -157,7 +172,8 @@ extern CTxMemPool mempool;
 extern std::atomic_bool g_is_mempool_loaded;
 typedef std::unordered_map<uint256, CBlockIndex*, BlockHasher> BlockMap;
 extern BlockMap& mapBlockIndex GUARDED_BY(cs_main);
-extern std::map<int, CBlockIndex*> mapHeaderIndex GUARDED_BY(cs_main);
+/** The latest header at each height, written under cs_main and read without it */
+extern CHeaderHeightIndex chainHeaders;
 extern const std::string strMessageMagic;
 extern Mutex g_best_block_mutex;
 extern std::condition_variable g_best_block_cv;
@@ -169,6 +185,10 @@ extern bool fIsBareMultisigStd;
 extern bool fRequireStandard;
 extern bool fCheckBlockIndex;
 extern bool fCheckpointsEnabled;
+/** Whether ReadBlockFromDisk reads through memory maps of the block files (-blockmmap) */
+extern bool fBlockMmap;
+/** Whether the block index is loaded from and saved to a snapshot file (-blockindexsnapshot) */
+extern bool fBlockIndexSnapshot;
 extern size_t nCoinCacheUsage;
 /** A fee rate smaller than this is considered zero fee (for relaying, mining and transaction creation) */
 extern CFeeRate minRelayTxFee;
@@ -252,6 +272,16 @@ bool ProcessNewBlock(const CChainParams& chainparams, const std::shared_ptr<cons
  */
 bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& block, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex = nullptr, CBlockHeader* first_invalid = nullptr) LOCKS_EXCLUDED(cs_main);
 
+/** As above, with the hashes of the headers from GetBlockHeaderHashes. */
+bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& block, const std::vector<uint256>& hashes, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex = nullptr, CBlockHeader* first_invalid = nullptr) LOCKS_EXCLUDED(cs_main);
+
+/**
+ * Hash block headers, a large batch on the signature check threads. The quark header hash
+ * is the most expensive part of accepting a header, hashing before cs_main is taken keeps it
+ * out of the serial part of the header sync.
+ */
+std::vector<uint256> GetBlockHeaderHashes(const std::vector<CBlockHeader>& headers) LOCKS_EXCLUDED(cs_main);
+
 /** Check whether enough disk space is available for an incoming block */
 bool CheckDiskSpace(uint64_t nAdditionalBytes = 0, bool blocks_dir = false);
 /** Open a block file (blk?????.dat) */
@@ -271,6 +301,8 @@ bool LoadChainTip(const CChainParams& chainparams) EXCLUSIVE_LOCKS_REQUIRED(cs_m
 void UnloadBlockIndex();
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the stake checking thread */
+void ThreadStakeCheck();
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
 /** Retrieve a transaction (from memory pool, or from disk, if possible) */
@@ -304,15 +336,40 @@ void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune);
 void FlushStateToDisk();
 /** Prune block files and flush state to disk. */
 void PruneAndFlush();
+/** Write the block index snapshot loaded on the next start, only after the index was fully flushed. */
+void WriteBlockIndexSnapshot() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 /** Prune block files up to a given height */
 void PruneBlockFilesManual(int nManualPruneHeight);
 
+/** Time in microseconds spent in the stages of connecting blocks to the tip since startup, see -debug=bench. */
+struct ConnectBlockTimes {
+    int64_t blocks{0};
+    int64_t stake{0};      //!< PoS stake input and block signature checks
+    int64_t checks{0};     //!< Sanity checks, including the stake checks
+    int64_t connect{0};    //!< Spending the inputs and adding the outputs of the transactions
+    int64_t verify{0};     //!< Connecting plus waiting for the script checks
+    int64_t flush{0};      //!< Writing the coins of the block to the coins tip
+    int64_t chainstate{0}; //!< Writing the coins tip to disk when it's due
+    int64_t total{0};
+};
+ConnectBlockTimes GetConnectBlockTimes();
+
 /** (try to) add transaction to memory pool
  * plTxnReplaced will be appended to with all transactions replaced from mempool **/
 bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransactionRef &tx,
                         bool* pfMissingInputs, std::list<CTransactionRef>* plTxnReplaced,
                         bool bypass_limits, const CAmount nAbsurdFee, bool test_accept=false) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+/** (try to) add a batch of transactions to memory pool, under a single cs_main acquisition.
+ * Parents in the batch are accepted before their children, the scripts of the batch are
+ * verified in parallel on the script check threads first. states receives the result of
+ * each transaction, the returned flags tell which ones were accepted. accept_times optionally
+ * gives the time of entry of each transaction, the current time is used otherwise. **/
+std::vector<bool> AcceptToMemoryPoolBatch(CTxMemPool& pool, const std::vector<CTransactionRef>& txs,
+                                          std::vector<CValidationState>& states, bool bypass_limits,
+                                          const CAmount nAbsurdFee,
+                                          const std::vector<int64_t>& accept_times = {}) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
 /** Convert CValidationState to a human-readable message for logging */
 std::string FormatStateMessage(const CValidationState &state);
 
@@ -393,6 +450,35 @@ public:
     ScriptError GetScriptError() const { return error; }
 };
 
+/**
+ * Closure representing the read-ahead checks of one block about to be connected: reading and
+ * deserializing it, CheckBlock and, for proof-of-stake blocks with pindexFrom set, the stake
+ * kernel and block signature. The stake results are recorded with SetStakeCheck, failed checks
+ * are left to the serial validation.
+ */
+class CStakeCheck
+{
+private:
+    const CBlockIndex *pindex;
+    const CBlockIndex *pindexFrom; // block the stake input was confirmed in
+    CDiskBlockPos pos;
+    const Consensus::Params *params;
+
+public:
+    CStakeCheck(): pindex(nullptr), pindexFrom(nullptr), params(nullptr) {}
+    CStakeCheck(const CBlockIndex *pindexIn, const CBlockIndex *pindexFromIn, const CDiskBlockPos & posIn, const Consensus::Params & paramsIn) :
+        pindex(pindexIn), pindexFrom(pindexFromIn), pos(posIn), params(&paramsIn) { }
+
+    bool operator()();
+
+    void swap(CStakeCheck &check) {
+        std::swap(pindex, check.pindex);
+        std::swap(pindexFrom, check.pindexFrom);
+        std::swap(pos, check.pos);
+        std::swap(params, check.params);
+    }
+};
+
 /** Initializes the script-execution cache */
 void InitScriptExecutionCache();
 
@@ -400,6 +486,14 @@ void InitScriptExecutionCache();
 /** Functions for disk access for blocks */
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
+/**
+ * Reads the block through a cache of recently read and connected blocks shared by the
+ * readers that don't modify the block (RPC, REST, xbridge). Returns nullptr on failure.
+ */
+std::shared_ptr<const CBlock> ReadBlockFromDiskCached(const CBlockIndex* pindex, const Consensus::Params& consensusParams);
+/** Set the memory limit of the ReadBlockFromDiskCached cache (-blockreadcache) */
+void SetBlockReadCacheSize(size_t nBytes);
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex);
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& message_start);
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& message_start);
 
@@ -469,6 +563,9 @@ extern CChain& chainActive;
 /** Global variable that points to the coins database (protected by cs_main) */
 extern std::unique_ptr<CCoinsViewDB> pcoinsdbview;
 
+/** Global variable that points to the background writer on top of pcoinsdbview (protected by cs_main) */
+extern std::unique_ptr<CCoinsViewBackgroundFlush> pcoinsflusher;
+
 /** Global variable that points to the active CCoinsView (protected by cs_main) */
 extern std::unique_ptr<CCoinsViewCache> pcoinsTip;
 
@@ -506,6 +603,12 @@ bool DumpMempool();
 /** Load the mempool from disk. */
 bool LoadMempool();
 
+/** Dump the signature and script execution caches, salts included, to disk. */
+bool DumpSignatureCaches();
+
+/** Load the signature and script execution caches from disk, before any scripts are checked. */
+bool LoadSignatureCaches();
+
 //! Check whether the block associated with this index entry is pruned or not.
 inline bool IsBlockPruned(const CBlockIndex* pblockindex)
 {
@@ -535,12 +638,14 @@ bool VerifySig(const CBlock & block, const CScript & stakeScript);
 bool SignBlock(CBlock & block, const CScript & stakeScript, const CKeyStore & keystore);
 
 /**
- * Only return transaction for utxo that hasn't been spent. If the utxo has been spent
- * this will return nullptr. This method will check the mempool.
+ * Returns the output of the utxo if it hasn't been spent on the chain tip. Only the coins
+ * tip is read and results are memoized until the chain tip changes.
  * @param out
- * @return CTransactionRef
+ * @param txOutRet
+ * @return bool
  */
-CTransactionRef GetTxFunc(const COutPoint & out);
+static const size_t MAX_COIN_FUNC_MEMO = 10000;
+bool GetCoinFunc(const COutPoint & out, CTxOut & txOutRet);
 
 /**
  * Returns true if the specified block is found in the chain tip.
@@ -552,9 +657,31 @@ CTransactionRef GetTxFunc(const COutPoint & out);
 static const int SNODE_STALE_BLOCKS = 5; // number of blocks to allow before a snode is marked "stale"
 bool IsServiceNodeBlockValidFunc(const uint64_t & blockNumber, const uint256 & blockHash, const bool & checkStale=true);
 
-/** hashProofOfStake management */
-uint256 GetHashProofOfStake(const uint256 & blockHash);
+/** Number of checked header proof-of-stake hashes kept until the header is added to the block index */
+static const unsigned int MAX_PROOF_OF_STAKE_HASHES = 20000;
+
+/** hashProofOfStake management, the hash of a header is removed once it is taken for its block index entry */
+bool TakeHashProofOfStake(const uint256 & blockHash, uint256 & hashProofOfStake);
 bool HasHashProofOfStake(const uint256 & blockHash);
 void SetHashProofOfStake(const uint256 & blockHash, const uint256 & hashProofOfStake);
 
+/** Number of blocks with proof-of-stake check results kept in memory */
+static const unsigned int MAX_STAKE_CHECK_RESULTS = 1024;
+
+/** Proof-of-stake checks that already passed for a block */
+struct StakeCheckResult {
+    int height{0};
+    bool kernel{false}; // stake kernel meets the target
+    uint256 hashProofOfStake;
+    bool signature{false}; // stake input, amount and block signature are valid
+    bool prechecked{false}; // block was processed by the stake check queue
+    bool operator<(const StakeCheckResult & other) const {
+        return height < other.height;
+    }
+};
+/** Returns the proof-of-stake results recorded for the block. */
+bool GetStakeCheck(const uint256 & blockHash, StakeCheckResult & result);
+/** Merges the passed checks into the results of the block. */
+void SetStakeCheck(const uint256 & blockHash, const StakeCheckResult & result);
+
 #endif // BITCOIN_VALIDATION_H
@@ -9,45 +9,153 @@
 #include <scheduler.h>
 #include <txmempool.h>
 #include <util/system.h>
+#include <util/time.h>
 #include <validation.h>
 
-#include <list>
+#include <algorithm>
 #include <atomic>
 #include <future>
+#include <typeinfo>
+#include <unordered_map>
 #include <utility>
 
 #include <boost/signals2/signal.hpp>
 
-struct ValidationInterfaceConnections {
-    boost::signals2::scoped_connection UpdatedBlockTip;
-    boost::signals2::scoped_connection TransactionAddedToMempool;
-    boost::signals2::scoped_connection BlockConnected;
-    boost::signals2::scoped_connection BlockDisconnected;
-    boost::signals2::scoped_connection TransactionRemovedFromMempool;
-    boost::signals2::scoped_connection ChainStateFlushed;
-    boost::signals2::scoped_connection Broadcast;
-    boost::signals2::scoped_connection BlockChecked;
-    boost::signals2::scoped_connection NewPoWValidBlock;
+/** Queued callbacks that are timed per subscriber */
+enum ValidationCallback {
+    CALLBACK_UPDATED_BLOCK_TIP,
+    CALLBACK_TRANSACTION_ADDED_TO_MEMPOOL,
+    CALLBACK_TRANSACTION_REMOVED_FROM_MEMPOOL,
+    CALLBACK_BLOCK_CONNECTED,
+    CALLBACK_BLOCK_DISCONNECTED,
+    CALLBACK_CHAIN_STATE_FLUSHED,
+    CALLBACK_TYPES
+};
+
+static const char* const VALIDATION_CALLBACK_NAMES[CALLBACK_TYPES] = {
+    "UpdatedBlockTip",
+    "TransactionAddedToMempool",
+    "TransactionRemovedFromMempool",
+    "BlockConnected",
+    "BlockDisconnected",
+    "ChainStateFlushed",
+};
+
+/**
+ * Serial callback queue of a single subscriber. Lanes run concurrently on the
+ * scheduler threads, callbacks of one lane run in the order they were queued.
+ * Lanes are kept until the scheduler is unregistered because the scheduler may
+ * still hold queue processing tasks for them, the lanes of unregistered
+ * subscribers are reused by the next registrations.
+ */
+struct ValidationInterfaceLane {
+    SingleThreadedSchedulerClient m_schedulerClient;
+    /** Subscriber the lane currently serves, callbacks queued for a previous subscriber are dropped */
+    std::atomic<CValidationInterface*> m_subscriber{nullptr};
+
+    CCriticalSection m_cs_stats;
+    /** Subscriber the stats belong to, differs from m_subscriber once it is unregistered */
+    CValidationInterface* m_stats_subscriber GUARDED_BY(m_cs_stats){nullptr};
+    std::string m_name GUARDED_BY(m_cs_stats);
+    ValidationCallbackStats m_stats[CALLBACK_TYPES] GUARDED_BY(m_cs_stats);
+
+    explicit ValidationInterfaceLane(CScheduler *pscheduler) : m_schedulerClient(pscheduler) {}
+
+    void ResetStats(CValidationInterface* subscriber, const std::string& name) {
+        LOCK(m_cs_stats);
+        m_stats_subscriber = subscriber;
+        m_name = name;
+        for (int i = 0; i < CALLBACK_TYPES; ++i)
+            m_stats[i] = ValidationCallbackStats{};
+    }
+
+    void RecordCallback(CValidationInterface* subscriber, ValidationCallback type, int64_t wait_micros, int64_t run_micros) {
+        LOCK(m_cs_stats);
+        if (m_stats_subscriber != subscriber) return;
+        ValidationCallbackStats& stats = m_stats[type];
+        ++stats.calls;
+        stats.wait_micros += wait_micros;
+        stats.max_wait_micros = std::max(stats.max_wait_micros, wait_micros);
+        stats.run_micros += run_micros;
+        stats.max_run_micros = std::max(stats.max_run_micros, run_micros);
+    }
 };
 
 struct MainSignalsInstance {
-    boost::signals2::signal<void (const CBlockIndex *, const CBlockIndex *, bool fInitialDownload)> UpdatedBlockTip;
-    boost::signals2::signal<void (const CTransactionRef &)> TransactionAddedToMempool;
-    boost::signals2::signal<void (const std::shared_ptr<const CBlock> &, const CBlockIndex *pindex, const std::vector<CTransactionRef>&)> BlockConnected;
-    boost::signals2::signal<void (const std::shared_ptr<const CBlock> &)> BlockDisconnected;
-    boost::signals2::signal<void (const CTransactionRef &)> TransactionRemovedFromMempool;
-    boost::signals2::signal<void (const CBlockLocator &)> ChainStateFlushed;
-    boost::signals2::signal<void (int64_t nBestBlockTime, CConnman* connman)> Broadcast;
-    boost::signals2::signal<void (const CBlock&, const CValidationState&)> BlockChecked;
-    boost::signals2::signal<void (const CBlockIndex *, const std::shared_ptr<const CBlock>&)> NewPoWValidBlock;
-
-    // We are not allowed to assume the scheduler only runs in one thread,
-    // but must ensure all callbacks happen in-order, so we end up creating
-    // our own queue here :(
+    CScheduler *m_pscheduler;
+    // Runs CallFunctionInValidationInterfaceQueue functions when there are no subscribers
     SingleThreadedSchedulerClient m_schedulerClient;
-    std::unordered_map<CValidationInterface*, ValidationInterfaceConnections> m_connMainSignals;
 
-    explicit MainSignalsInstance(CScheduler *pscheduler) : m_schedulerClient(pscheduler) {}
+    CCriticalSection m_cs_lanes;
+    std::vector<std::unique_ptr<ValidationInterfaceLane>> m_lanes GUARDED_BY(m_cs_lanes);
+    std::vector<ValidationInterfaceLane*> m_free_lanes GUARDED_BY(m_cs_lanes);
+    std::unordered_map<CValidationInterface*, ValidationInterfaceLane*> m_subscribers GUARDED_BY(m_cs_lanes);
+
+    explicit MainSignalsInstance(CScheduler *pscheduler) : m_pscheduler(pscheduler), m_schedulerClient(pscheduler) {}
+
+    /** Queues func on the lane of every subscriber. Events are queued under m_cs_lanes so that
+     *  all lanes see them in the same order. */
+    void Enqueue(ValidationCallback type, std::function<void (CValidationInterface*)> func) {
+        LOCK(m_cs_lanes);
+        if (m_subscribers.empty()) return;
+        auto shared_func = std::make_shared<const std::function<void (CValidationInterface*)>>(std::move(func));
+        const int64_t queued = GetTimeMicros();
+        for (const auto& it : m_subscribers) {
+            CValidationInterface* subscriber = it.first;
+            ValidationInterfaceLane* lane = it.second;
+            lane->m_schedulerClient.AddToProcessQueue([shared_func, subscriber, lane, type, queued] {
+                if (lane->m_subscriber != subscriber) return;
+                const int64_t start = GetTimeMicros();
+                (*shared_func)(subscriber);
+                lane->RecordCallback(subscriber, type, start - queued, GetTimeMicros() - start);
+            });
+        }
+    }
+
+    /** Calls func on every subscriber on the calling thread. */
+    void Notify(const std::function<void (CValidationInterface*)>& func) {
+        std::vector<CValidationInterface*> subscribers;
+        {
+            LOCK(m_cs_lanes);
+            subscribers.reserve(m_subscribers.size());
+            for (const auto& it : m_subscribers) subscribers.push_back(it.first);
+        }
+        for (CValidationInterface* subscriber : subscribers) func(subscriber);
+    }
+
+    void Register(CValidationInterface* subscriber, const std::string& name) {
+        LOCK(m_cs_lanes);
+        if (m_subscribers.count(subscriber)) return;
+        ValidationInterfaceLane* lane;
+        if (!m_free_lanes.empty()) {
+            lane = m_free_lanes.back();
+            m_free_lanes.pop_back();
+        } else {
+            m_lanes.emplace_back(new ValidationInterfaceLane(m_pscheduler));
+            lane = m_lanes.back().get();
+        }
+        lane->ResetStats(subscriber, name);
+        lane->m_subscriber = subscriber;
+        m_subscribers.emplace(subscriber, lane);
+    }
+
+    void Unregister(CValidationInterface* subscriber) {
+        LOCK(m_cs_lanes);
+        auto it = m_subscribers.find(subscriber);
+        if (it == m_subscribers.end()) return;
+        it->second->m_subscriber = nullptr;
+        m_free_lanes.push_back(it->second);
+        m_subscribers.erase(it);
+    }
+
+    void UnregisterAll() {
+        LOCK(m_cs_lanes);
+        for (const auto& it : m_subscribers) {
+            it.second->m_subscriber = nullptr;
+            m_free_lanes.push_back(it.second);
+        }
+        m_subscribers.clear();
+    }
 };
 
 static CMainSignals g_signals;
@@ -57,6 +165,10 @@ static CMainSignals g_signals;
 // so MainSignalsInstance hasn't been created yet.
 static std::unordered_map<CTxMemPool*, boost::signals2::scoped_connection> g_connNotifyEntryRemoved;
 
+std::string CValidationInterface::GetSubscriberName() const {
+    return typeid(*this).name();
+}
+
 void CMainSignals::RegisterBackgroundSignalScheduler(CScheduler& scheduler) {
     assert(!m_internals);
     m_internals.reset(new MainSignalsInstance(&scheduler));
@@ -69,12 +181,43 @@ void CMainSignals::UnregisterBackgroundSignalScheduler() {
 void CMainSignals::FlushBackgroundCallbacks() {
     if (m_internals) {
         m_internals->m_schedulerClient.EmptyQueue();
+        std::vector<ValidationInterfaceLane*> lanes;
+        {
+            LOCK(m_internals->m_cs_lanes);
+            for (const auto& lane : m_internals->m_lanes) lanes.push_back(lane.get());
+        }
+        for (ValidationInterfaceLane* lane : lanes)
+            lane->m_schedulerClient.EmptyQueue();
     }
 }
 
 size_t CMainSignals::CallbacksPending() {
     if (!m_internals) return 0;
-    return m_internals->m_schedulerClient.CallbacksPending();
+    size_t pending = m_internals->m_schedulerClient.CallbacksPending();
+    LOCK(m_internals->m_cs_lanes);
+    for (const auto& lane : m_internals->m_lanes)
+        pending = std::max(pending, lane->m_schedulerClient.CallbacksPending());
+    return pending;
+}
+
+std::vector<ValidationInterfaceStats> CMainSignals::GetSubscriberStats(bool reset) {
+    std::vector<ValidationInterfaceStats> result;
+    if (!m_internals) return result;
+    LOCK(m_internals->m_cs_lanes);
+    for (const auto& it : m_internals->m_subscribers) {
+        ValidationInterfaceLane* lane = it.second;
+        ValidationInterfaceStats stats;
+        stats.pending = lane->m_schedulerClient.CallbacksPending();
+        LOCK(lane->m_cs_stats);
+        stats.name = lane->m_name;
+        for (int i = 0; i < CALLBACK_TYPES; ++i) {
+            if (lane->m_stats[i].calls == 0) continue;
+            stats.callbacks.emplace_back(VALIDATION_CALLBACK_NAMES[i], lane->m_stats[i]);
+            if (reset) lane->m_stats[i] = ValidationCallbackStats{};
+        }
+        result.push_back(std::move(stats));
+    }
+    return result;
 }
 
 void CMainSignals::RegisterWithMempoolSignals(CTxMemPool& pool) {
@@ -94,21 +237,12 @@ CMainSignals& GetMainSignals()
 }
 
 void RegisterValidationInterface(CValidationInterface* pwalletIn) {
-    ValidationInterfaceConnections& conns = g_signals.m_internals->m_connMainSignals[pwalletIn];
-    conns.UpdatedBlockTip = g_signals.m_internals->UpdatedBlockTip.connect(std::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
-    conns.TransactionAddedToMempool = g_signals.m_internals->TransactionAddedToMempool.connect(std::bind(&CValidationInterface::TransactionAddedToMempool, pwalletIn, std::placeholders::_1));
-    conns.BlockConnected = g_signals.m_internals->BlockConnected.connect(std::bind(&CValidationInterface::BlockConnected, pwalletIn, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
-    conns.BlockDisconnected = g_signals.m_internals->BlockDisconnected.connect(std::bind(&CValidationInterface::BlockDisconnected, pwalletIn, std::placeholders::_1));
-    conns.TransactionRemovedFromMempool = g_signals.m_internals->TransactionRemovedFromMempool.connect(std::bind(&CValidationInterface::TransactionRemovedFromMempool, pwalletIn, std::placeholders::_1));
-    conns.ChainStateFlushed = g_signals.m_internals->ChainStateFlushed.connect(std::bind(&CValidationInterface::ChainStateFlushed, pwalletIn, std::placeholders::_1));
-    conns.Broadcast = g_signals.m_internals->Broadcast.connect(std::bind(&CValidationInterface::ResendWalletTransactions, pwalletIn, std::placeholders::_1, std::placeholders::_2));
-    conns.BlockChecked = g_signals.m_internals->BlockChecked.connect(std::bind(&CValidationInterface::BlockChecked, pwalletIn, std::placeholders::_1, std::placeholders::_2));
-    conns.NewPoWValidBlock = g_signals.m_internals->NewPoWValidBlock.connect(std::bind(&CValidationInterface::NewPoWValidBlock, pwalletIn, std::placeholders::_1, std::placeholders::_2));
+    g_signals.m_internals->Register(pwalletIn, pwalletIn->GetSubscriberName());
 }
 
 void UnregisterValidationInterface(CValidationInterface* pwalletIn) {
     if (g_signals.m_internals) {
-        g_signals.m_internals->m_connMainSignals.erase(pwalletIn);
+        g_signals.m_internals->Unregister(pwalletIn);
     }
 }
 
@@ -116,11 +250,24 @@ void UnregisterAllValidationInterfaces() {
     if (!g_signals.m_internals) {
         return;
     }
-    g_signals.m_internals->m_connMainSignals.clear();
+    g_signals.m_internals->UnregisterAll();
 }
 
 void CallFunctionInValidationInterfaceQueue(std::function<void ()> func) {
-    g_signals.m_internals->m_schedulerClient.AddToProcessQueue(std::move(func));
+    MainSignalsInstance& internals = *g_signals.m_internals;
+    LOCK(internals.m_cs_lanes);
+    if (internals.m_subscribers.empty()) {
+        internals.m_schedulerClient.AddToProcessQueue(std::move(func));
+        return;
+    }
+    // Queue a barrier on every lane, the lane that reaches it last runs func
+    auto remaining = std::make_shared<std::atomic<size_t>>(internals.m_subscribers.size());
+    auto shared_func = std::make_shared<std::function<void ()>>(std::move(func));
+    for (const auto& it : internals.m_subscribers) {
+        it.second->m_schedulerClient.AddToProcessQueue([remaining, shared_func] {
+            if (--*remaining == 0) (*shared_func)();
+        });
+    }
 }
 
 void SyncWithValidationInterfaceQueue() {
@@ -135,8 +282,8 @@ void SyncWithValidationInterfaceQueue() {
 
 void CMainSignals::MempoolEntryRemoved(CTransactionRef ptx, MemPoolRemovalReason reason) {
     if (reason != MemPoolRemovalReason::BLOCK && reason != MemPoolRemovalReason::CONFLICT) {
-        m_internals->m_schedulerClient.AddToProcessQueue([ptx, this] {
-            m_internals->TransactionRemovedFromMempool(ptx);
+        m_internals->Enqueue(CALLBACK_TRANSACTION_REMOVED_FROM_MEMPOOL, [ptx](CValidationInterface* subscriber) {
+            subscriber->TransactionRemovedFromMempool(ptx);
         });
     }
 }
@@ -146,43 +293,49 @@ void CMainSignals::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockInd
     // the chain actually updates. One way to ensure this is for the caller to invoke this signal
     // in the same critical section where the chain is updated
 
-    m_internals->m_schedulerClient.AddToProcessQueue([pindexNew, pindexFork, fInitialDownload, this] {
-        m_internals->UpdatedBlockTip(pindexNew, pindexFork, fInitialDownload);
+    m_internals->Enqueue(CALLBACK_UPDATED_BLOCK_TIP, [pindexNew, pindexFork, fInitialDownload](CValidationInterface* subscriber) {
+        subscriber->UpdatedBlockTip(pindexNew, pindexFork, fInitialDownload);
     });
 }
 
 void CMainSignals::TransactionAddedToMempool(const CTransactionRef &ptx) {
-    m_internals->m_schedulerClient.AddToProcessQueue([ptx, this] {
-        m_internals->TransactionAddedToMempool(ptx);
+    m_internals->Enqueue(CALLBACK_TRANSACTION_ADDED_TO_MEMPOOL, [ptx](CValidationInterface* subscriber) {
+        subscriber->TransactionAddedToMempool(ptx);
     });
 }
 
 void CMainSignals::BlockConnected(const std::shared_ptr<const CBlock> &pblock, const CBlockIndex *pindex, const std::shared_ptr<const std::vector<CTransactionRef>>& pvtxConflicted) {
-    m_internals->m_schedulerClient.AddToProcessQueue([pblock, pindex, pvtxConflicted, this] {
-        m_internals->BlockConnected(pblock, pindex, *pvtxConflicted);
+    m_internals->Enqueue(CALLBACK_BLOCK_CONNECTED, [pblock, pindex, pvtxConflicted](CValidationInterface* subscriber) {
+        subscriber->BlockConnected(pblock, pindex, *pvtxConflicted);
     });
 }
 
 void CMainSignals::BlockDisconnected(const std::shared_ptr<const CBlock> &pblock) {
-    m_internals->m_schedulerClient.AddToProcessQueue([pblock, this] {
-        m_internals->BlockDisconnected(pblock);
+    m_internals->Enqueue(CALLBACK_BLOCK_DISCONNECTED, [pblock](CValidationInterface* subscriber) {
+        subscriber->BlockDisconnected(pblock);
     });
 }
 
 void CMainSignals::ChainStateFlushed(const CBlockLocator &locator) {
-    m_internals->m_schedulerClient.AddToProcessQueue([locator, this] {
-        m_internals->ChainStateFlushed(locator);
+    m_internals->Enqueue(CALLBACK_CHAIN_STATE_FLUSHED, [locator](CValidationInterface* subscriber) {
+        subscriber->ChainStateFlushed(locator);
     });
 }
 
 void CMainSignals::Broadcast(int64_t nBestBlockTime, CConnman* connman) {
-    m_internals->Broadcast(nBestBlockTime, connman);
+    m_internals->Notify([nBestBlockTime, connman](CValidationInterface* subscriber) {
+        subscriber->ResendWalletTransactions(nBestBlockTime, connman);
+    });
 }
 
 void CMainSignals::BlockChecked(const CBlock& block, const CValidationState& state) {
-    m_internals->BlockChecked(block, state);
+    m_internals->Notify([&block, &state](CValidationInterface* subscriber) {
+        subscriber->BlockChecked(block, state);
+    });
 }
 
 void CMainSignals::NewPoWValidBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock> &block) {
-    m_internals->NewPoWValidBlock(pindex, block);
+    m_internals->Notify([pindex, &block](CValidationInterface* subscriber) {
+        subscriber->NewPoWValidBlock(pindex, block);
+    });
 }
@@ -11,6 +11,9 @@
 
 #include <functional>
 #include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
 extern CCriticalSection cs_main;
 class CBlock;
@@ -37,6 +40,8 @@ void UnregisterAllValidationInterfaces();
 /**
  * Pushes a function to callback onto the notification queue, guaranteeing any
  * callbacks generated prior to now are finished when the function is called.
+ * The function runs on the queue of the subscriber that finishes last, so it
+ * may run concurrently with later callbacks of other subscribers.
  *
  * Be very careful blocking on func to be called if any locks are held -
  * validation interface clients may not be able to make progress as they often
@@ -55,6 +60,25 @@ void CallFunctionInValidationInterfaceQueue(std::function<void ()> func);
  */
 void SyncWithValidationInterfaceQueue() LOCKS_EXCLUDED(cs_main);
 
+/** Callback count and durations of one kind of queued callback of a subscriber */
+struct ValidationCallbackStats {
+    uint64_t calls{0};
+    /** Time between queuing and starting the callbacks */
+    int64_t wait_micros{0};
+    int64_t max_wait_micros{0};
+    /** Time spent in the callbacks */
+    int64_t run_micros{0};
+    int64_t max_run_micros{0};
+};
+
+/** Callback stats of a subscriber since it was registered or the stats were last reset */
+struct ValidationInterfaceStats {
+    std::string name;
+    /** Callbacks waiting in the queue of the subscriber */
+    size_t pending{0};
+    std::vector<std::pair<std::string, ValidationCallbackStats>> callbacks;
+};
+
 /**
  * Implement this to subscribe to events generated in validation
  *
@@ -68,7 +92,9 @@ void SyncWithValidationInterfaceQueue() LOCKS_EXCLUDED(cs_main);
  * UpdatedBlockTip() callback may depend on an operation performed in
  * the BlockConnected() callback without worrying about explicit
  * synchronization. No ordering should be assumed across
- * ValidationInterface() subscribers.
+ * ValidationInterface() subscribers, each subscriber has its own queue and
+ * the queues of different subscribers are processed concurrently when the
+ * scheduler runs more than one thread.
  */
 class CValidationInterface {
 protected:
@@ -147,6 +173,9 @@ protected:
      * Notifies listeners that a block which builds directly on our current tip
      * has been received and connected to the headers tree, though not validated yet */
     virtual void NewPoWValidBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& block) {};
+    /** Name of the subscriber in the callback stats */
+    virtual std::string GetSubscriberName() const;
+    friend class CMainSignals;
     friend void ::RegisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterAllValidationInterfaces();
@@ -172,7 +201,10 @@ public:
     /** Call any remaining callbacks on the calling thread */
     void FlushBackgroundCallbacks();
 
+    /** Number of callbacks waiting in the longest subscriber queue */
     size_t CallbacksPending();
+    /** Returns the callback stats of the registered subscribers, optionally resetting them */
+    std::vector<ValidationInterfaceStats> GetSubscriberStats(bool reset = false);
 
     /** Register with mempool to call TransactionRemovedFromMempool callbacks */
     void RegisterWithMempoolSignals(CTxMemPool& pool);
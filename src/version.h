@@ -36,6 +36,15 @@ static const int NO_BLOOM_VERSION = 70005;
 //! "sendheaders" command and announcing blocks with headers starts with this version
 static const int SENDHEADERS_VERSION = 70713;
 
+//! "sendxbinv" command and announcing xbridge packets with inv starts with this version
+static const int XBRIDGE_INV_VERSION = 70713;
+
+//! "sendsnps" command and batched servicenode pings start with this version
+static const int SNPING_BATCH_VERSION = 70713;
+
+//! "getsnl" and "snl" servicenode list sync starts with this version
+static const int SNLIST_VERSION = 70713;
+
 //! not banning for invalid compact blocks starts with this version
 static const int GETSERVICES_VERSION = 70714;
 
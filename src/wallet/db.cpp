@@ -623,7 +623,9 @@ void BerkeleyBatch::Close()
     activeTxn = nullptr;
     pdb = nullptr;
 
-    if (fFlushOnClose)
+    // With a flush delay, the writes of the batch are in the database log and the
+    // periodic flush checkpoints them once the delay has passed
+    if (fFlushOnClose && gArgs.GetArg("-walletflushdelay", DEFAULT_WALLET_FLUSH_DELAY) <= 0)
         Flush();
 
     {
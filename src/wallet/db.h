@@ -24,6 +24,8 @@
 #include <db_cxx.h>
 
 static const unsigned int DEFAULT_WALLET_DBLOGSIZE = 100;
+//! -walletflushdelay default, 0 checkpoints the database when a batch is closed
+static const int64_t DEFAULT_WALLET_FLUSH_DELAY = 0;
 static const bool DEFAULT_WALLET_PRIVDB = true;
 
 struct WalletDatabaseFileId {
@@ -170,6 +172,8 @@ public:
     unsigned int nLastSeen;
     unsigned int nLastFlushed;
     int64_t nLastWalletUpdate;
+    //! Time of the oldest update that isn't flushed yet
+    int64_t nFirstUnflushedUpdate{0};
 
     /**
      * Pointer to shared database environment.
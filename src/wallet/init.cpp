@@ -52,6 +52,7 @@ void WalletInit::AddWalletOptions() const
     gArgs.AddArg("-paytxfee=<amt>", strprintf("Fee (in %s/kB) to add to transactions you send (default: %s)",
                                                             CURRENCY_UNIT, FormatMoney(CFeeRate{DEFAULT_PAY_TX_FEE}.GetFeePerK())), false, OptionsCategory::WALLET);
     gArgs.AddArg("-rescan", "Rescan the block chain for missing wallet transactions on startup", false, OptionsCategory::WALLET);
+    gArgs.AddArg("-rescanblockfilter", strprintf("Skip the blocks whose compact block filter doesn't match the wallet scripts during rescans, requires -blockfilterindex (default: %u)", DEFAULT_RESCAN_BLOCKFILTER), false, OptionsCategory::WALLET);
     gArgs.AddArg("-salvagewallet", "Attempt to recover private keys from a corrupt wallet on startup", false, OptionsCategory::WALLET);
     gArgs.AddArg("-spendzeroconfchange", strprintf("Spend unconfirmed change when sending transactions (default: %u)", DEFAULT_SPEND_ZEROCONF_CHANGE), false, OptionsCategory::WALLET);
     gArgs.AddArg("-txconfirmtarget=<n>", strprintf("If paytxfee is not set, include enough fee so transactions begin confirmation on average within n blocks (default: %u)", DEFAULT_TX_CONFIRM_TARGET), false, OptionsCategory::WALLET);
@@ -66,6 +67,7 @@ void WalletInit::AddWalletOptions() const
 
     gArgs.AddArg("-dblogsize=<n>", strprintf("Flush wallet database activity from memory to disk log every <n> megabytes (default: %u)", DEFAULT_WALLET_DBLOGSIZE), true, OptionsCategory::WALLET_DEBUG_TEST);
     gArgs.AddArg("-flushwallet", strprintf("Run a thread to flush wallet periodically (default: %u)", DEFAULT_FLUSHWALLET), true, OptionsCategory::WALLET_DEBUG_TEST);
+    gArgs.AddArg("-walletflushdelay=<n>", strprintf("Keep wallet changes in the database log for up to <n> seconds and flush them to the wallet file together, instead of on every write. Requires -flushwallet (default: %u)", DEFAULT_WALLET_FLUSH_DELAY), false, OptionsCategory::WALLET);
     gArgs.AddArg("-privdb", strprintf("Sets the DB_PRIVATE flag in the wallet db environment (default: %u)", DEFAULT_WALLET_PRIVDB), true, OptionsCategory::WALLET_DEBUG_TEST);
     gArgs.AddArg("-walletrejectlongchains", strprintf("Wallet will not create transactions that violate mempool chain limits (default: %u)", DEFAULT_WALLET_REJECT_LONG_CHAINS), true, OptionsCategory::WALLET_DEBUG_TEST);
 }
@@ -112,6 +114,12 @@ bool WalletInit::ParameterInteraction() const
         }
     }
 
+    // -walletflushdelay relies on the periodic wallet flush
+    if (!gArgs.GetBoolArg("-flushwallet", DEFAULT_FLUSHWALLET) && gArgs.GetArg("-walletflushdelay", DEFAULT_WALLET_FLUSH_DELAY) > 0) {
+        gArgs.ForceSetArg("-walletflushdelay", "0");
+        LogPrintf("%s: parameter interaction: -flushwallet=0 -> setting -walletflushdelay=0\n", __func__);
+    }
+
     if (is_multiwallet) {
         if (gArgs.GetBoolArg("-upgradewallet", false)) {
             return InitError(strprintf("%s is only allowed with a single wallet file", "-upgradewallet"));
@@ -1152,10 +1152,12 @@ static UniValue ProcessImportDescriptor(ImportData& import_data, std::map<CKeyID
 
     // Expand all descriptors to get public keys and scripts.
     // TODO: get private keys from descriptors too
-    for (int i = range_start; i <= range_end; ++i) {
-        FlatSigningProvider out_keys;
-        std::vector<CScript> scripts_temp;
-        parsed_desc->Expand(i, keys, scripts_temp, out_keys);
+    std::vector<std::vector<CScript>> range_scripts;
+    std::vector<FlatSigningProvider> range_out;
+    ExpandRange(*parsed_desc, range_start, range_end, keys, range_scripts, range_out);
+    for (size_t i = 0; i < range_scripts.size(); ++i) {
+        const FlatSigningProvider& out_keys = range_out[i];
+        const std::vector<CScript>& scripts_temp = range_scripts[i];
         std::copy(scripts_temp.begin(), scripts_temp.end(), std::inserter(script_pub_keys, script_pub_keys.end()));
         for (const auto& key_pair : out_keys.pubkeys) {
             ordered_pubkeys.push_back(key_pair.first);
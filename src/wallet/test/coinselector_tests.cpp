@@ -204,6 +204,19 @@ BOOST_AUTO_TEST_CASE(bnb_search_test)
     actual_selection.clear();
     selection.clear();
 
+    // Select 10 Cent with at most 3 inputs
+    add_coin(5 * CENT, 5, actual_selection);
+    add_coin(3 * CENT, 3, actual_selection);
+    add_coin(2 * CENT, 2, actual_selection);
+    BOOST_CHECK(SelectCoinsBnB(GroupCoins(utxo_pool), 10 * CENT, 0.5 * CENT, selection, value_ret, not_input_fees, 3));
+    BOOST_CHECK(equal_sets(selection, actual_selection));
+    BOOST_CHECK_EQUAL(value_ret, 10 * CENT);
+    actual_selection.clear();
+    selection.clear();
+
+    // Select 15 Cent with at most 2 inputs, not possible
+    BOOST_CHECK(!SelectCoinsBnB(GroupCoins(utxo_pool), 15 * CENT, 0.5 * CENT, selection, value_ret, not_input_fees, 2));
+
     // Iteration exhaustion test
     CAmount target = make_hard_case(17, utxo_pool);
     BOOST_CHECK(!SelectCoinsBnB(GroupCoins(utxo_pool), target, 0, selection, value_ret, not_input_fees)); // Should exhaust
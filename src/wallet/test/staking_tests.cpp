@@ -75,6 +75,14 @@ BOOST_AUTO_TEST_CASE(staking_tests_v03modifier)
         if (firstStakeModifier == 0)
             firstStakeModifier = nStakeModifier;
         else BOOST_CHECK_MESSAGE(nStakeModifier == firstStakeModifier, "Stake modifier v03 should be the same indefinitely");
+        // the cached modifier must match the selection interval search
+        StakeModifierEntry cached;
+        BOOST_CHECK(GetCachedStakeModifier(stakeBlock.GetHash(), cached));
+        BOOST_CHECK_EQUAL(cached.nStakeModifier, nStakeModifier);
+        ClearStakeModifierCache();
+        uint64_t nStakeModifierUncached{0};
+        BOOST_CHECK(GetKernelStakeModifier(chainActive.Tip(), stakeBlock.GetHash(), runningTime, nStakeModifierUncached, nStakeModifierHeight, nStakeModifierTime, false));
+        BOOST_CHECK_EQUAL(nStakeModifierUncached, nStakeModifier);
         pos.StakeBlocks(1);
     }
 }
@@ -121,6 +129,173 @@ BOOST_AUTO_TEST_CASE(staking_tests_protocolupgrade)
     BOOST_CHECK_EQUAL(chainActive.Height(), blocks + 25);
 }
 
+/// Check that the midstate kernel hasher produces the same hashes as the stake hash functions
+BOOST_FIXTURE_TEST_CASE(staking_tests_kernelhasher, BasicTestingSetup)
+{
+    for (int j = 0; j < 20; ++j) {
+        const uint64_t nStakeModifier = InsecureRandBits(64);
+        const auto nTimeBlockFrom = static_cast<unsigned int>(InsecureRand32());
+        const auto blockHeight = static_cast<int>(InsecureRandRange(10000000));
+        const auto prevoutIndex = static_cast<unsigned int>(InsecureRandRange(100));
+        const uint256 prevoutHash = InsecureRand256();
+        CDataStream ss(SER_GETHASH, 0);
+        ss << nStakeModifier;
+
+        const auto hasherV05 = StakeKernelHasher::V05(nStakeModifier, nTimeBlockFrom, blockHeight, prevoutIndex);
+        const auto hasherV03 = StakeKernelHasher::V03(nStakeModifier, nTimeBlockFrom, prevoutIndex, prevoutHash);
+        const auto nTimeStart = static_cast<unsigned int>(InsecureRand32());
+        for (unsigned int nTimeTx = nTimeStart; nTimeTx < nTimeStart + 60; ++nTimeTx) {
+            BOOST_CHECK_EQUAL(hasherV05(nTimeTx), stakeHashV05(ss, nTimeBlockFrom, blockHeight, prevoutIndex, nTimeTx));
+            BOOST_CHECK_EQUAL(hasherV03(nTimeTx), stakeHash(nTimeTx, ss, prevoutIndex, prevoutHash, nTimeBlockFrom));
+        }
+    }
+}
+
+/// Check the stake schedule ring buckets
+BOOST_FIXTURE_TEST_CASE(staking_tests_schedule, BasicTestingSetup)
+{
+    StakeSchedule schedule;
+    BOOST_CHECK(schedule.Empty());
+    BOOST_CHECK_EQUAL(schedule.NextTime(), 0);
+
+    auto candidate = [](const int64_t & time, const CAmount & value) -> StakeSchedule::Candidate {
+        StakeSchedule::Candidate c;
+        c.outpoint = COutPoint(InsecureRand256(), 0);
+        c.value = value;
+        c.time = time;
+        return c;
+    };
+
+    const int64_t now = 1500000000;
+    schedule.Prune(now);
+    BOOST_CHECK(schedule.Add(candidate(now + 10, 5 * COIN)));
+    BOOST_CHECK(schedule.Add(candidate(now + 2, 5 * COIN)));
+    BOOST_CHECK_EQUAL(schedule.NextTime(), now + 2);
+
+    // Full buckets only keep the smallest inputs
+    for (int i = 0; i < STAKE_SCHEDULE_BUCKET_SIZE - 1; ++i)
+        BOOST_CHECK(schedule.Add(candidate(now + 10, (10 + i) * COIN)));
+    BOOST_CHECK(!schedule.Add(candidate(now + 10, 100 * COIN)));
+    BOOST_CHECK(schedule.Add(candidate(now + 10, 1 * COIN)));
+    auto buckets = schedule.Buckets();
+    BOOST_CHECK_EQUAL(buckets.size(), 2);
+    BOOST_CHECK_EQUAL(buckets[0]->time, now + 2);
+    BOOST_CHECK_EQUAL(buckets[1]->time, now + 10);
+    BOOST_CHECK_EQUAL(buckets[1]->count, STAKE_SCHEDULE_BUCKET_SIZE);
+    CAmount largest{0};
+    for (int i = 0; i < buckets[1]->count; ++i)
+        largest = std::max(largest, buckets[1]->items[i].value);
+    BOOST_CHECK_EQUAL(largest, (10 + STAKE_SCHEDULE_BUCKET_SIZE - 3) * COIN); // largest input was replaced
+
+    // Times older than the ring are rejected, newer times replace stale slots
+    BOOST_CHECK(schedule.Add(candidate(now + 10 + STAKE_SCHEDULE_SECONDS, 5 * COIN)));
+    BOOST_CHECK(!schedule.Add(candidate(now + 10, 1 * COIN)));
+    BOOST_CHECK_EQUAL(schedule.Buckets().size(), 2);
+
+    // Pruning removes everything at or before the cutoff
+    schedule.Prune(now + 10);
+    BOOST_CHECK_EQUAL(schedule.Buckets().size(), 1);
+    BOOST_CHECK_EQUAL(schedule.NextTime(), now + 10 + STAKE_SCHEDULE_SECONDS);
+    schedule.Clear();
+    BOOST_CHECK(schedule.Empty());
+    BOOST_CHECK_EQUAL(schedule.NextTime(), 0);
+}
+
+/// Check that the staking coin index follows the wallet's confirmed coins.
+BOOST_FIXTURE_TEST_CASE(staking_tests_coinindex, TestChainPoS)
+{
+    auto confirmedCoins = [this]() -> std::set<COutPoint> {
+        std::set<COutPoint> result;
+        std::vector<COutput> coins;
+        {
+            auto locked_chain = wallet->chain().lock();
+            LOCK2(cs_main, wallet->cs_wallet);
+            wallet->AvailableCoins(*locked_chain, coins, true, nullptr, 0, MAX_MONEY, MAX_MONEY, 0, 1);
+        }
+        for (const auto & out : coins) {
+            if (!out.tx->IsCoinBase() && out.fSpendable && out.nDepth >= Params().GetConsensus().coinMaturity)
+                result.insert(out.GetInputCoin().outpoint);
+        }
+        return result;
+    };
+    auto indexedCoins = [](StakingCoinIndex & index, const CBlockIndex *tip) -> std::set<COutPoint> {
+        Consensus::Params params = Params().GetConsensus();
+        params.stakeMinAge = 0;
+        std::set<COutPoint> result;
+        for (const auto & coin : index.StakeableCoins(tip, params, GetAdjustedTime()))
+            result.insert(coin.outpoint);
+        return result;
+    };
+
+    int changes{0};
+    StakingCoinIndex index(wallet, [&changes]() { ++changes; });
+    auto chainTip = []() -> const CBlockIndex* {
+        LOCK(cs_main);
+        return chainActive.Tip();
+    };
+    const CBlockIndex *tip = chainTip();
+    index.Sync(wallet.get(), tip, 0);
+    BOOST_CHECK(index.Size() >= confirmedCoins().size());
+    BOOST_CHECK(!confirmedCoins().empty());
+    BOOST_CHECK(indexedCoins(index, tip) == confirmedCoins());
+
+    // Staking spends a coin and adds the coinstake outputs
+    StakeBlocks(1), SyncWithValidationInterfaceQueue();
+    BOOST_CHECK(changes > 0);
+    const auto stats = GetStakingStats();
+    BOOST_CHECK(stats.stakes > 0);
+    BOOST_CHECK(stats.hashes > 0);
+    BOOST_CHECK(stats.coinsSearched <= stats.coins);
+    tip = chainTip();
+    index.Sync(wallet.get(), tip, 0);
+    BOOST_CHECK(indexedCoins(index, tip) == confirmedCoins());
+
+    // Higher minimum stake amount reloads the index
+    index.Sync(wallet.get(), tip, 1000*COIN);
+    LOCK(wallet->cs_wallet);
+    for (const auto & coin : indexedCoins(index, tip))
+        BOOST_CHECK(wallet->GetWalletTx(coin.hash)->tx->vout[coin.n].nValue >= 1000*COIN);
+}
+
+/// Check that the stake check queue agrees with the serial proof-of-stake checks.
+BOOST_FIXTURE_TEST_CASE(staking_tests_stakecheck, TestChainPoS)
+{
+    LOCK(cs_main);
+    const auto & consensus = Params().GetConsensus();
+    for (CBlockIndex *pindex = chainActive.Tip(); pindex && pindex->nHeight > consensus.lastPOWBlock; pindex = pindex->pprev) {
+        const CBlockIndex *pindexFrom = LookupBlockIndex(pindex->hashStakeBlock);
+        BOOST_CHECK(pindexFrom != nullptr);
+        if (!pindexFrom)
+            continue;
+
+        // Lock free kernel check matches the full kernel check
+        const CBlockHeader header = pindex->GetBlockHeader();
+        uint256 hashProofOfStake;
+        BOOST_CHECK(CheckStakeKernelHashV05(header, pindex->pprev, pindexFrom, hashProofOfStake));
+        unsigned int nTime = header.nTime;
+        uint256 hashProofOfStakeSerial;
+        BOOST_CHECK(CheckStakeKernelHash(pindex->pprev, header.nBits, pindexFrom->GetBlockHash(), pindexFrom->GetBlockTime(),
+                header.nStakeAmount, { header.hashStake, header.nStakeIndex }, nTime, 0, true, hashProofOfStakeSerial, false));
+        BOOST_CHECK_EQUAL(hashProofOfStake, hashProofOfStakeSerial);
+
+        // Kernel fails on a different stake amount
+        CBlockHeader badHeader = header;
+        badHeader.nStakeAmount = 1;
+        uint256 badHash;
+        BOOST_CHECK(!CheckStakeKernelHashV05(badHeader, pindex->pprev, pindexFrom, badHash));
+
+        // Queue check records the kernel and the block signature
+        CStakeCheck check(pindex, pindexFrom, pindex->GetBlockPos(), consensus);
+        BOOST_CHECK(check());
+        StakeCheckResult result;
+        BOOST_CHECK(GetStakeCheck(pindex->GetBlockHash(), result));
+        BOOST_CHECK(result.prechecked);
+        BOOST_CHECK(result.kernel);
+        BOOST_CHECK(result.signature);
+        BOOST_CHECK_EQUAL(result.hashProofOfStake, hashProofOfStakeSerial);
+    }
+}
+
 /// Ensure that bad stakes are not accepted by the protocol.
 BOOST_FIXTURE_TEST_CASE(staking_tests_stakes, TestChainPoS)
 {
@@ -448,6 +448,137 @@ BOOST_FIXTURE_TEST_CASE(ListCoins, ListCoinsTestingSetup)
     BOOST_CHECK_EQUAL(list.begin()->second.size(), 2U);
 }
 
+// The outputs AvailableCoins returned when it scanned every output of every wallet transaction,
+// before the unspent output index
+static std::vector<COutPoint> ScanAvailableCoins(const CWallet& wallet, interfaces::Chain::Lock& locked_chain, bool fOnlySafe) EXCLUSIVE_LOCKS_REQUIRED(cs_main, wallet.cs_wallet)
+{
+    std::vector<COutPoint> coins;
+    for (const auto& entry : wallet.mapWallet) {
+        const CWalletTx& wtx = entry.second;
+        if (!CheckFinalTx(*wtx.tx) || wtx.IsImmatureCoinBase(locked_chain))
+            continue;
+        const int nDepth = wtx.GetDepthInMainChain(locked_chain);
+        if (nDepth < 0 || (nDepth == 0 && !wtx.InMempool()))
+            continue;
+        bool safeTx = wtx.IsTrusted(locked_chain);
+        if (nDepth == 0 && (wtx.mapValue.count("replaces_txid") || wtx.mapValue.count("replaced_by_txid")))
+            safeTx = false;
+        if (fOnlySafe && !safeTx)
+            continue;
+        for (unsigned int i = 0; i < wtx.tx->vout.size(); i++) {
+            if (wallet.IsLockedCoin(entry.first, i) || wallet.IsSpent(locked_chain, entry.first, i) || wallet.IsMine(wtx.tx->vout[i]) == ISMINE_NO)
+                continue;
+            coins.emplace_back(entry.first, i);
+        }
+    }
+    return coins;
+}
+
+static void CheckAvailableCoins(const CWallet& wallet, interfaces::Chain::Lock& locked_chain, const std::string& step)
+{
+    LOCK2(cs_main, wallet.cs_wallet);
+    for (const bool fOnlySafe : {true, false}) {
+        std::vector<COutput> available;
+        wallet.AvailableCoins(locked_chain, available, fOnlySafe);
+        std::vector<COutPoint> coins;
+        for (const COutput& out : available)
+            coins.emplace_back(out.tx->GetHash(), out.i);
+        BOOST_CHECK_MESSAGE(coins == ScanAvailableCoins(wallet, locked_chain, fOnlySafe), step);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(unspent_output_index, ListCoinsTestingSetup)
+{
+    const CScript coinbaseScript = GetScriptForRawPubKey(coinbaseKey.GetPubKey());
+    auto connectBlock = [&](const std::vector<CMutableTransaction>& txns, const CScript& scriptPubKey) {
+        const CBlock block = CreateAndProcessBlock(txns, scriptPubKey);
+        wallet->BlockConnected(std::make_shared<const CBlock>(block), chainActive.Tip(), {});
+        return block;
+    };
+    auto commitTx = [&](const CRecipient& recipient) {
+        CTransactionRef tx;
+        CReserveKey reservekey(wallet.get());
+        CAmount fee;
+        int changePos = -1;
+        std::string error;
+        CCoinControl dummy;
+        BOOST_CHECK(wallet->CreateTransaction(*m_locked_chain, {recipient}, tx, reservekey, fee, changePos, error, dummy));
+        CValidationState state;
+        BOOST_CHECK(wallet->CommitTransaction(tx, {}, {}, reservekey, nullptr, state));
+        return tx;
+    };
+    CheckAvailableCoins(*wallet, *m_locked_chain, "initial");
+
+    // Confirmed and unconfirmed spends with change
+    AddTx(CRecipient{GetScriptForRawPubKey({}), 1 * COIN, false /* subtract fee */});
+    CheckAvailableCoins(*wallet, *m_locked_chain, "confirmed spend");
+    CTransactionRef pending = commitTx(CRecipient{GetScriptForRawPubKey({}), 2 * COIN, false /* subtract fee */});
+    CheckAvailableCoins(*wallet, *m_locked_chain, "unconfirmed spend");
+
+    // abandontransaction frees the inputs of the spend
+    mempool.clear();
+    wallet->TransactionRemovedFromMempool(pending);
+    BOOST_CHECK(wallet->AbandonTransaction(*m_locked_chain, pending->GetHash()));
+    CheckAvailableCoins(*wallet, *m_locked_chain, "abandoned spend");
+
+    // A transaction that conflicts with an unconfirmed spend is mined
+    pending = commitTx(CRecipient{GetScriptForRawPubKey({}), 3 * COIN, false /* subtract fee */});
+    mempool.clear();
+    wallet->TransactionRemovedFromMempool(pending);
+    CMutableTransaction conflict;
+    conflict.vin.emplace_back(pending->vin[0].prevout);
+    {
+        LOCK(wallet->cs_wallet);
+        const CWalletTx& prev = wallet->mapWallet.at(pending->vin[0].prevout.hash);
+        conflict.vout.emplace_back(prev.tx->vout[pending->vin[0].prevout.n].nValue - 10000, coinbaseScript);
+        BOOST_CHECK(wallet->SignTransaction(conflict));
+    }
+    connectBlock({conflict}, coinbaseScript);
+    CheckAvailableCoins(*wallet, *m_locked_chain, "conflicting spend");
+    {
+        LOCK2(cs_main, wallet->cs_wallet);
+        BOOST_CHECK(wallet->mapWallet.at(pending->GetHash()).GetDepthInMainChain(*m_locked_chain) < 0);
+    }
+
+    // Outputs to a key and to a script become ours on import and rescan
+    CKey importKey;
+    importKey.MakeNewKey(true);
+    CKey watchKey;
+    watchKey.MakeNewKey(true);
+    const CScript watchScript = GetScriptForDestination(watchKey.GetPubKey().GetID());
+    AddTx(CRecipient{GetScriptForDestination(importKey.GetPubKey().GetID()), 4 * COIN, false /* subtract fee */});
+    AddTx(CRecipient{watchScript, 5 * COIN, false /* subtract fee */});
+    CheckAvailableCoins(*wallet, *m_locked_chain, "payments to other keys");
+    AddKey(*wallet, importKey);
+    CheckAvailableCoins(*wallet, *m_locked_chain, "imported key");
+    {
+        LOCK(wallet->cs_wallet);
+        BOOST_CHECK(wallet->AddWatchOnly(watchScript, 0 /* nCreateTime */));
+    }
+    CheckAvailableCoins(*wallet, *m_locked_chain, "imported watch-only script");
+    {
+        WalletRescanReserver reserver(wallet.get());
+        reserver.reserve();
+        CWallet::ScanResult result = wallet->ScanForWalletTransactions(chainActive.Genesis()->GetBlockHash(), {} /* stop_block */, reserver, true /* update */);
+        BOOST_CHECK_EQUAL(result.status, CWallet::ScanResult::SUCCESS);
+    }
+    CheckAvailableCoins(*wallet, *m_locked_chain, "rescan");
+
+    // A block with a wallet spend is replaced in a reorg
+    const CTransactionRef spend = commitTx(CRecipient{GetScriptForRawPubKey({}), 6 * COIN, false /* subtract fee */});
+    const CBlock block = connectBlock({CMutableTransaction(*spend)}, coinbaseScript);
+    CheckAvailableCoins(*wallet, *m_locked_chain, "spend confirmed");
+    {
+        CValidationState state;
+        BOOST_CHECK(InvalidateBlock(state, Params(), chainActive.Tip()));
+    }
+    wallet->BlockDisconnected(std::make_shared<const CBlock>(block));
+    mempool.clear();
+    CheckAvailableCoins(*wallet, *m_locked_chain, "spend disconnected");
+    connectBlock({}, GetScriptForRawPubKey(importKey.GetPubKey()));
+    CheckAvailableCoins(*wallet, *m_locked_chain, "reorg");
+}
+
 BOOST_FIXTURE_TEST_CASE(wallet_disableprivkeys, TestChain100Setup)
 {
     auto chain = interfaces::MakeChain();
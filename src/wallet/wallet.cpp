@@ -34,6 +34,7 @@
 #include <algorithm>
 #include <assert.h>
 #include <future>
+#include <thread>
 
 #include <boost/algorithm/string/replace.hpp>
 
@@ -281,6 +282,88 @@ void CWallet::DeriveNewChildKey(WalletBatch &batch, CKeyMetadata& metadata, CKey
         throw std::runtime_error(std::string(__func__) + ": Writing HD chain model failed");
 }
 
+std::vector<CWallet::DerivedKey> CWallet::DeriveNewChildKeys(WalletBatch& batch, size_t count, bool internal)
+{
+    // same keypath scheme as DeriveNewChildKey, m/0'/0'/k (external) or m/0'/1'/k (internal)
+    CKey seed;
+    CExtKey masterKey;
+    CExtKey accountKey;
+    CExtKey chainChildKey;
+
+    if (!GetKey(hdChain.seed_id, seed))
+        throw std::runtime_error(std::string(__func__) + ": seed not found");
+
+    masterKey.SetSeed(seed.begin(), seed.size());
+    masterKey.Derive(accountKey, BIP32_HARDENED_KEY_LIMIT);
+    assert(internal ? CanSupportFeature(FEATURE_HD_SPLIT) : true);
+    accountKey.Derive(chainChildKey, BIP32_HARDENED_KEY_LIMIT+(internal ? 1 : 0));
+    const CKeyID master_id = masterKey.key.GetPubKey().GetID();
+    uint32_t& counter = internal ? hdChain.nInternalChainCounter : hdChain.nExternalChainCounter;
+
+    std::vector<DerivedKey> keys;
+    keys.reserve(count);
+    while (keys.size() < count) {
+        // The child keys and their public keys only depend on their index, derive them in parallel
+        const size_t missing = count - keys.size();
+        const uint32_t first = counter;
+        std::vector<DerivedKey> derived(missing);
+        ParallelFor(missing, [&](size_t i) {
+            CExtKey childKey;
+            chainChildKey.Derive(childKey, (first + i) | BIP32_HARDENED_KEY_LIMIT);
+            derived[i].secret = childKey.key;
+            derived[i].pubkey = childKey.key.GetPubKey();
+        });
+
+        for (auto& key : derived) {
+            const uint32_t index = counter++;
+            if (HaveKey(key.pubkey.GetID()))
+                continue; // skip keys already known to the wallet
+            key.metadata = CKeyMetadata(GetTime());
+            key.metadata.hdKeypath = std::string("m/0'/") + (internal ? "1'/" : "0'/") + std::to_string(index) + "'";
+            key.metadata.key_origin.path.push_back(0 | BIP32_HARDENED_KEY_LIMIT);
+            key.metadata.key_origin.path.push_back((internal ? 1 : 0) | BIP32_HARDENED_KEY_LIMIT);
+            key.metadata.key_origin.path.push_back(index | BIP32_HARDENED_KEY_LIMIT);
+            key.metadata.hd_seed_id = hdChain.seed_id;
+            std::copy(master_id.begin(), master_id.begin() + 4, key.metadata.key_origin.fingerprint);
+            key.metadata.has_key_origin = true;
+            keys.push_back(std::move(key));
+        }
+    }
+    // update the chain model in the database once for all the keys
+    if (!batch.WriteHDChain(hdChain))
+        throw std::runtime_error(std::string(__func__) + ": Writing HD chain model failed");
+    return keys;
+}
+
+std::vector<CPubKey> CWallet::GenerateNewKeys(WalletBatch& batch, size_t count, bool internal)
+{
+    std::vector<CPubKey> pubkeys;
+    if (!IsHDEnabled()) {
+        for (size_t i = 0; i < count; ++i) {
+            pubkeys.push_back(GenerateNewKey(batch, internal));
+        }
+        return pubkeys;
+    }
+
+    assert(!IsWalletFlagSet(WALLET_FLAG_DISABLE_PRIVATE_KEYS));
+    assert(!IsWalletFlagSet(WALLET_FLAG_BLANK_WALLET));
+    // Compressed public keys were introduced in version 0.6.0
+    if (CanSupportFeature(FEATURE_COMPRPUBKEY)) {
+        SetMinVersion(FEATURE_COMPRPUBKEY, &batch);
+    }
+
+    pubkeys.reserve(count);
+    for (const auto& key : DeriveNewChildKeys(batch, count, CanSupportFeature(FEATURE_HD_SPLIT) ? internal : false)) {
+        mapKeyMetadata[key.pubkey.GetID()] = key.metadata;
+        UpdateTimeFirstKey(key.metadata.nCreateTime);
+        if (!AddKeyPubKeyWithDB(batch, key.secret, key.pubkey)) {
+            throw std::runtime_error(std::string(__func__) + ": AddKey failed");
+        }
+        pubkeys.push_back(key.pubkey);
+    }
+    return pubkeys;
+}
+
 bool CWallet::AddKeyPubKeyWithDB(WalletBatch &batch, const CKey& secret, const CPubKey &pubkey)
 {
     AssertLockHeld(cs_wallet); // mapKeyMetadata
@@ -300,6 +383,8 @@ bool CWallet::AddKeyPubKeyWithDB(WalletBatch &batch, const CKey& secret, const C
         return false;
     }
     if (needsDB) encrypted_batch = nullptr;
+    // Outputs of wallet transactions may pay to the new key
+    m_unspent_outputs_dirty = true;
 
     // check if we need to remove from watch-only
     CScript script;
@@ -317,7 +402,9 @@ bool CWallet::AddKeyPubKeyWithDB(WalletBatch &batch, const CKey& secret, const C
                                                  secret.GetPrivKey(),
                                                  mapKeyMetadata[pubkey.GetID()]);
     }
-    UnsetWalletFlag(WALLET_FLAG_BLANK_WALLET);
+    if (IsWalletFlagSet(WALLET_FLAG_BLANK_WALLET)) {
+        UnsetWalletFlag(WALLET_FLAG_BLANK_WALLET);
+    }
     return true;
 }
 
@@ -432,6 +519,10 @@ bool CWallet::AddCScript(const CScript& redeemScript)
 {
     if (!CCryptoKeyStore::AddCScript(redeemScript))
         return false;
+    {
+        LOCK(cs_wallet);
+        m_unspent_outputs_dirty = true;
+    }
     if (WalletBatch(*database).WriteCScript(Hash160(redeemScript), redeemScript)) {
         UnsetWalletFlag(WALLET_FLAG_BLANK_WALLET);
         return true;
@@ -458,6 +549,7 @@ bool CWallet::AddWatchOnly(const CScript& dest)
 {
     if (!CCryptoKeyStore::AddWatchOnly(dest))
         return false;
+    m_unspent_outputs_dirty = true;
     const CKeyMetadata& meta = m_script_metadata[CScriptID(dest)];
     UpdateTimeFirstKey(meta.nCreateTime);
     NotifyWatchonlyChanged(true);
@@ -479,6 +571,7 @@ bool CWallet::RemoveWatchOnly(const CScript &dest)
     AssertLockHeld(cs_wallet);
     if (!CCryptoKeyStore::RemoveWatchOnly(dest))
         return false;
+    m_unspent_outputs_dirty = true;
     if (!HaveWatchOnly())
         NotifyWatchonlyChanged(false);
     if (!WalletBatch(*database).EraseWatchOnly(dest))
@@ -724,6 +817,63 @@ void CWallet::AddToSpends(const uint256& wtxid)
         AddToSpends(txin.prevout, wtxid);
 }
 
+bool CWallet::HasUnconflictedSpender(const COutPoint& outpoint) const
+{
+    const auto range = mapTxSpends.equal_range(outpoint);
+    for (auto it = range.first; it != range.second; ++it) {
+        const auto mit = mapWallet.find(it->second);
+        if (mit == mapWallet.end())
+            continue;
+        const CWalletTx& spender = mit->second;
+        // Conflicted transactions keep the conflicting block with nIndex -1
+        if (!spender.isAbandoned() && !(spender.nIndex == -1 && !spender.hashUnset()))
+            return true;
+    }
+    return false;
+}
+
+void CWallet::UpdateUnspentOutput(const COutPoint& outpoint)
+{
+    if (m_unspent_outputs_dirty)
+        return;
+    const auto it = mapWallet.find(outpoint.hash);
+    if (it != mapWallet.end() && outpoint.n < it->second.tx->vout.size() &&
+        IsMine(it->second.tx->vout[outpoint.n]) != ISMINE_NO && !HasUnconflictedSpender(outpoint))
+        m_unspent_outputs.insert(outpoint);
+    else
+        m_unspent_outputs.erase(outpoint);
+}
+
+void CWallet::UpdateUnspentOutputs(const CWalletTx& wtx)
+{
+    if (m_unspent_outputs_dirty)
+        return;
+    const uint256& hash = wtx.GetHash();
+    for (unsigned int i = 0; i < wtx.tx->vout.size(); i++)
+        UpdateUnspentOutput(COutPoint(hash, i));
+    if (!wtx.IsCoinBase()) {
+        for (const CTxIn& txin : wtx.tx->vin)
+            UpdateUnspentOutput(txin.prevout);
+    }
+}
+
+const std::set<COutPoint>& CWallet::GetUnspentOutputs() const
+{
+    if (m_unspent_outputs_dirty) {
+        m_unspent_outputs.clear();
+        for (const auto& entry : mapWallet) {
+            const CWalletTx& wtx = entry.second;
+            for (unsigned int i = 0; i < wtx.tx->vout.size(); i++) {
+                const COutPoint outpoint(entry.first, i);
+                if (IsMine(wtx.tx->vout[i]) != ISMINE_NO && !HasUnconflictedSpender(outpoint))
+                    m_unspent_outputs.insert(m_unspent_outputs.end(), outpoint);
+            }
+        }
+        m_unspent_outputs_dirty = false;
+    }
+    return m_unspent_outputs;
+}
+
 bool CWallet::EncryptWallet(const SecureString& strWalletPassphrase)
 {
     if (IsCrypted())
@@ -895,6 +1045,9 @@ void CWallet::MarkDirty()
         LOCK(cs_wallet);
         for (std::pair<const uint256, CWalletTx>& item : mapWallet)
             item.second.MarkDirty();
+        // Imported keys and scripts change which outputs are ours
+        m_unspent_outputs_dirty = true;
+        MarkBalancesDirty();
     }
 }
 
@@ -994,6 +1147,8 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
 
     // Break debit/credit balance caches:
     wtx.MarkDirty();
+    MarkBalancesDirty();
+    UpdateUnspentOutputs(wtx);
 
     // Notify UI of new or updated transaction
     NotifyTransactionChanged(this, hash, fInsertedNew ? CT_NEW : CT_UPDATED);
@@ -1017,6 +1172,8 @@ void CWallet::LoadToWallet(const CWalletTx& wtxIn)
     const auto& ins = mapWallet.emplace(hash, wtxIn);
     CWalletTx& wtx = ins.first->second;
     wtx.BindWallet(this);
+    m_unspent_outputs_dirty = true;
+    MarkBalancesDirty();
     if (/* insertion took place */ ins.second) {
         wtx.m_it_wtxOrdered = wtxOrdered.insert(std::make_pair(wtx.nOrderPos, &wtx));
     }
@@ -1103,8 +1260,10 @@ void CWallet::MarkInputsDirty(const CTransactionRef& tx)
         auto it = mapWallet.find(txin.prevout.hash);
         if (it != mapWallet.end()) {
             it->second.MarkDirty();
+            UpdateUnspentOutput(txin.prevout);
         }
     }
+    MarkBalancesDirty();
 }
 
 bool CWallet::AbandonTransaction(interfaces::Chain::Lock& locked_chain, const uint256& hashTx)
@@ -1232,6 +1391,7 @@ void CWallet::TransactionAddedToMempool(const CTransactionRef& ptx) {
     auto it = mapWallet.find(ptx->GetHash());
     if (it != mapWallet.end()) {
         it->second.fInMempool = true;
+        MarkBalancesDirty();
     }
 }
 
@@ -1240,6 +1400,7 @@ void CWallet::TransactionRemovedFromMempool(const CTransactionRef &ptx) {
     auto it = mapWallet.find(ptx->GetHash());
     if (it != mapWallet.end()) {
         it->second.fInMempool = false;
+        MarkBalancesDirty();
     }
 }
 
@@ -1749,6 +1910,78 @@ int64_t CWallet::RescanFromTime(int64_t startTime, const WalletRescanReserver& r
     return startTime;
 }
 
+GCSFilter::ElementSet CWallet::GetBlockFilterScripts() const
+{
+    GCSFilter::ElementSet elements;
+    auto add_script = [&elements](const CScript& script) {
+        elements.emplace(script.begin(), script.end());
+    };
+    auto add_pubkey = [&add_script](const CPubKey& pubkey) {
+        add_script(GetScriptForRawPubKey(pubkey));
+        for (const auto& dest : GetAllDestinationsForKey(pubkey)) {
+            add_script(GetScriptForDestination(dest));
+        }
+    };
+
+    LOCK(cs_KeyStore);
+    for (const CKeyID& keyid : GetKeys()) {
+        CPubKey pubkey;
+        if (GetPubKey(keyid, pubkey)) {
+            add_pubkey(pubkey);
+        }
+    }
+    for (const auto& entry : mapWatchKeys) {
+        add_pubkey(entry.second);
+    }
+    for (const auto& entry : mapScripts) {
+        add_script(entry.second);
+        add_script(GetScriptForDestination(CScriptID(entry.second)));
+        add_script(GetScriptForDestination(WitnessV0ScriptHash(entry.second)));
+    }
+    for (const CScript& script : setWatchOnly) {
+        add_script(script);
+    }
+    return elements;
+}
+
+namespace {
+//! A block read ahead of the rescan
+struct PrefetchedBlock {
+    uint256 hash;
+    //! The block filter doesn't match any of the wallet scripts, the block wasn't read
+    bool skipped{false};
+    bool read{false};
+    CBlock block;
+    //! Transactions of the block with outputs that are mine
+    std::vector<bool> pays_to_wallet;
+};
+
+//! Reads the blocks on worker threads and marks their transactions that pay to the wallet.
+//! With a filter set blocks whose filter doesn't match it aren't read.
+void PrefetchBlocks(const CWallet& wallet, interfaces::Chain& chain, std::vector<PrefetchedBlock>& blocks,
+                    const GCSFilter::ElementSet* filter_set)
+{
+    ParallelFor(blocks.size(), [&](size_t i) {
+        PrefetchedBlock& prefetched = blocks[i];
+        if (filter_set) {
+            const Optional<bool> match = chain.blockFilterMatchesAny(prefetched.hash, *filter_set);
+            if (match && !*match) {
+                prefetched.skipped = true;
+                return;
+            }
+        }
+        if (!chain.findBlock(prefetched.hash, &prefetched.block) || prefetched.block.IsNull()) {
+            return;
+        }
+        prefetched.pays_to_wallet.resize(prefetched.block.vtx.size());
+        for (size_t pos = 0; pos < prefetched.block.vtx.size(); ++pos) {
+            prefetched.pays_to_wallet[pos] = wallet.IsMine(*prefetched.block.vtx[pos]);
+        }
+        prefetched.read = true;
+    });
+}
+} // namespace
+
 /**
  * Scan the block chain (starting in start_block) for transactions
  * from or to us. If fUpdate is true, found transactions that already
@@ -1799,6 +2032,27 @@ CWallet::ScanResult CWallet::ScanForWalletTransactions(const uint256& start_bloc
             progress_end = chain().guessVerificationProgress(stop_block.IsNull() ? tip_hash : stop_block);
         }
         double progress_current = progress_begin;
+
+        // Blocks are read and matched against the wallet ahead of the scan on worker
+        // threads. Transactions are added to the wallet in block order on this thread.
+        std::vector<PrefetchedBlock> prefetched;
+        size_t prefetch_pos{0};
+        size_t prefetch_keys{0};
+        const bool use_block_filter = gArgs.GetBoolArg("-rescanblockfilter", DEFAULT_RESCAN_BLOCKFILTER);
+        GCSFilter::ElementSet filter_set;
+        auto wallet_keys = [this]() EXCLUSIVE_LOCKS_REQUIRED(cs_wallet) {
+            return mapKeyMetadata.size() + m_script_metadata.size();
+        };
+        // A transaction is only synced if it pays to the wallet, is already in it,
+        // or spends or conflicts with a wallet transaction
+        auto involves_wallet = [this](const CTransaction& tx) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet) {
+            if (mapWallet.count(tx.GetHash())) return true;
+            for (const CTxIn& txin : tx.vin) {
+                if (mapWallet.count(txin.prevout.hash) || mapTxSpends.count(txin.prevout)) return true;
+            }
+            return false;
+        };
+
         while (block_height && !fAbortRescan && !ShutdownRequested()) {
             if (*block_height % 100 == 0 && progress_end - progress_begin > 0.0) {
                 ShowProgress(strprintf("%s " + _("Rescanning..."), GetDisplayName()), std::max(1, std::min(99, (int)((progress_current - progress_begin) / (progress_end - progress_begin) * 100))));
@@ -1808,8 +2062,31 @@ CWallet::ScanResult CWallet::ScanForWalletTransactions(const uint256& start_bloc
                 WalletLogPrintf("Still rescanning. At block %d. Progress=%f\n", *block_height, progress_current);
             }
 
-            CBlock block;
-            if (chain().findBlock(block_hash, &block) && !block.IsNull()) {
+            if (prefetch_pos >= prefetched.size() || prefetched[prefetch_pos].hash != block_hash) {
+                prefetched.clear();
+                prefetch_pos = 0;
+                prefetched.emplace_back();
+                prefetched.back().hash = block_hash;
+                {
+                    auto locked_chain = chain().lock();
+                    const Optional<int> tip_height = locked_chain->getHeight();
+                    for (int height = *block_height + 1; block_hash != stop_block && tip_height && height <= *tip_height &&
+                                                         prefetched.size() < RESCAN_PREFETCH_BLOCKS; ++height) {
+                        prefetched.emplace_back();
+                        prefetched.back().hash = locked_chain->getBlockHash(height);
+                        if (prefetched.back().hash == stop_block) break;
+                    }
+                    LOCK(cs_wallet);
+                    prefetch_keys = wallet_keys();
+                }
+                if (use_block_filter) {
+                    filter_set = GetBlockFilterScripts();
+                }
+                PrefetchBlocks(*this, chain(), prefetched, use_block_filter ? &filter_set : nullptr);
+            }
+            const PrefetchedBlock& next = prefetched[prefetch_pos++];
+
+            if (next.read || next.skipped) {
                 auto locked_chain = chain().lock();
                 LOCK(cs_wallet);
                 if (!locked_chain->getBlockHeight(block_hash)) {
@@ -1821,8 +2098,17 @@ CWallet::ScanResult CWallet::ScanForWalletTransactions(const uint256& start_bloc
                     result.status = ScanResult::FAILURE;
                     break;
                 }
-                for (size_t posInBlock = 0; posInBlock < block.vtx.size(); ++posInBlock) {
-                    SyncTransaction(block.vtx[posInBlock], block_hash, posInBlock, fUpdate);
+                if (next.read) {
+                    const CBlock& block = next.block;
+                    for (size_t posInBlock = 0; posInBlock < block.vtx.size(); ++posInBlock) {
+                        // Keys added by the scan (keypool top up) weren't matched against the prefetched block
+                        if (next.pays_to_wallet[posInBlock] || involves_wallet(*block.vtx[posInBlock]) || wallet_keys() != prefetch_keys) {
+                            SyncTransaction(block.vtx[posInBlock], block_hash, posInBlock, fUpdate);
+                        }
+                    }
+                }
+                if (wallet_keys() != prefetch_keys) {
+                    prefetched.clear(); // read the following blocks again with the new keys
                 }
                 // scan succeeded, record block as most recent successfully scanned
                 result.last_scanned_block = block_hash;
@@ -1890,12 +2176,20 @@ void CWallet::ReacceptWalletTransactions(interfaces::Chain::Lock& locked_chain)
         }
     }
 
-    // Try to add wallet transactions to memory pool
-    for (const std::pair<const int64_t, CWalletTx*>& item : mapSorted) {
-        CWalletTx& wtx = *(item.second);
-        CValidationState state;
-        wtx.AcceptToMemoryPool(locked_chain, maxTxFee, state);
-    }
+    // Try to add wallet transactions to memory pool, in one batch so that the
+    // scripts are verified in parallel
+    std::vector<CTransactionRef> txs;
+    txs.reserve(mapSorted.size());
+    for (const std::pair<const int64_t, CWalletTx*>& item : mapSorted)
+        txs.push_back(item.second->tx);
+
+    LockAnnotation lock(::cs_main); // Temporary, for AcceptToMemoryPoolBatch below. Removed in upcoming commit.
+    std::vector<CValidationState> states;
+    const std::vector<bool> accepted = ::AcceptToMemoryPoolBatch(mempool, txs, states, false /* bypass_limits */, maxTxFee);
+    size_t i = 0;
+    for (const std::pair<const int64_t, CWalletTx*>& item : mapSorted)
+        item.second->fInMempool |= accepted[i++];
+    MarkBalancesDirty();
 }
 
 bool CWalletTx::RelayWalletTransaction(interfaces::Chain::Lock& locked_chain, CConnman* connman)
@@ -2183,8 +2477,45 @@ void CWallet::ResendWalletTransactions(int64_t nBestBlockTime, CConnman* connman
  */
 
 
+CWallet::Balance CWallet::GetBalances() const
+{
+    auto locked_chain = chain().lock();
+    LOCK(cs_wallet);
+    const Optional<int> height = locked_chain->getHeight();
+    const uint256 tip = height ? locked_chain->getBlockHash(*height) : uint256();
+    const uint64_t epoch = m_balance_epoch;
+    if (m_balance_cache_epoch && *m_balance_cache_epoch == epoch && m_balance_cache_tip == tip)
+        return m_balance_cache;
+
+    Balance ret;
+    for (const auto& entry : mapWallet)
+    {
+        const CWalletTx* pcoin = &entry.second;
+        const bool is_trusted = pcoin->IsTrusted(*locked_chain);
+        if (is_trusted) {
+            ret.m_mine_trusted += pcoin->GetAvailableCredit(*locked_chain, true, ISMINE_SPENDABLE);
+            ret.m_watchonly_trusted += pcoin->GetAvailableCredit(*locked_chain, true, ISMINE_WATCH_ONLY);
+        } else if (pcoin->GetDepthInMainChain(*locked_chain) == 0 && pcoin->InMempool()) {
+            ret.m_mine_untrusted_pending += pcoin->GetAvailableCredit(*locked_chain, true, ISMINE_SPENDABLE);
+            ret.m_watchonly_untrusted_pending += pcoin->GetAvailableCredit(*locked_chain, true, ISMINE_WATCH_ONLY);
+        }
+        ret.m_mine_immature += pcoin->GetImmatureCredit(*locked_chain);
+        ret.m_watchonly_immature += pcoin->GetImmatureWatchOnlyCredit(*locked_chain);
+    }
+
+    m_balance_cache = ret;
+    m_balance_cache_epoch = epoch;
+    m_balance_cache_tip = tip;
+    return ret;
+}
+
 CAmount CWallet::GetBalance(const isminefilter& filter, const int min_depth) const
 {
+    if (min_depth == 0 && filter == ISMINE_SPENDABLE)
+        return GetBalances().m_mine_trusted;
+    if (min_depth == 0 && filter == ISMINE_WATCH_ONLY)
+        return GetBalances().m_watchonly_trusted;
+
     CAmount nTotal = 0;
     {
         auto locked_chain = chain().lock();
@@ -2203,64 +2534,22 @@ CAmount CWallet::GetBalance(const isminefilter& filter, const int min_depth) con
 
 CAmount CWallet::GetUnconfirmedBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        auto locked_chain = chain().lock();
-        LOCK(cs_wallet);
-        for (const auto& entry : mapWallet)
-        {
-            const CWalletTx* pcoin = &entry.second;
-            if (!pcoin->IsTrusted(*locked_chain) && pcoin->GetDepthInMainChain(*locked_chain) == 0 && pcoin->InMempool())
-                nTotal += pcoin->GetAvailableCredit(*locked_chain);
-        }
-    }
-    return nTotal;
+    return GetBalances().m_mine_untrusted_pending;
 }
 
 CAmount CWallet::GetImmatureBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        auto locked_chain = chain().lock();
-        LOCK(cs_wallet);
-        for (const auto& entry : mapWallet)
-        {
-            const CWalletTx* pcoin = &entry.second;
-            nTotal += pcoin->GetImmatureCredit(*locked_chain);
-        }
-    }
-    return nTotal;
+    return GetBalances().m_mine_immature;
 }
 
 CAmount CWallet::GetUnconfirmedWatchOnlyBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        auto locked_chain = chain().lock();
-        LOCK(cs_wallet);
-        for (const auto& entry : mapWallet)
-        {
-            const CWalletTx* pcoin = &entry.second;
-            if (!pcoin->IsTrusted(*locked_chain) && pcoin->GetDepthInMainChain(*locked_chain) == 0 && pcoin->InMempool())
-                nTotal += pcoin->GetAvailableCredit(*locked_chain, true, ISMINE_WATCH_ONLY);
-        }
-    }
-    return nTotal;
+    return GetBalances().m_watchonly_untrusted_pending;
 }
 
 CAmount CWallet::GetImmatureWatchOnlyBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        auto locked_chain = chain().lock();
-        LOCK(cs_wallet);
-        for (const auto& entry : mapWallet)
-        {
-            const CWalletTx* pcoin = &entry.second;
-            nTotal += pcoin->GetImmatureWatchOnlyCredit(*locked_chain);
-        }
-    }
-    return nTotal;
+    return GetBalances().m_watchonly_immature;
 }
 
 // Calculate total balance in a different way from GetBalance. The biggest
@@ -2328,10 +2617,21 @@ void CWallet::AvailableCoins(interfaces::Chain::Lock& locked_chain, std::vector<
     vCoins.clear();
     CAmount nTotal = 0;
 
-    for (const auto& entry : mapWallet)
+    // Outputs are grouped by transaction, in the order of mapWallet
+    const std::set<COutPoint>& unspent = GetUnspentOutputs();
+    auto next = unspent.begin();
+    while (next != unspent.end())
     {
-        const uint256& wtxid = entry.first;
-        const CWalletTx* pcoin = &entry.second;
+        const uint256 wtxid = next->hash;
+        const auto first = next;
+        while (next != unspent.end() && next->hash == wtxid)
+            ++next;
+        const auto last = next;
+
+        const auto mit = mapWallet.find(wtxid);
+        if (mit == mapWallet.end())
+            continue;
+        const CWalletTx* pcoin = &mit->second;
 
         if (!CheckFinalTx(*pcoin->tx))
             continue;
@@ -2388,14 +2688,15 @@ void CWallet::AvailableCoins(interfaces::Chain::Lock& locked_chain, std::vector<
         if (nDepth < nMinDepth || nDepth > nMaxDepth)
             continue;
 
-        for (unsigned int i = 0; i < pcoin->tx->vout.size(); i++) {
+        for (auto output = first; output != last; ++output) {
+            const unsigned int i = output->n;
             if (pcoin->tx->vout[i].nValue < nMinimumAmount || pcoin->tx->vout[i].nValue > nMaximumAmount)
                 continue;
 
-            if (coinControl && coinControl->HasSelected() && !coinControl->fAllowOtherInputs && !coinControl->IsSelected(COutPoint(entry.first, i)))
+            if (coinControl && coinControl->HasSelected() && !coinControl->fAllowOtherInputs && !coinControl->IsSelected(*output))
                 continue;
 
-            if (IsLockedCoin(entry.first, i))
+            if (IsLockedCoin(wtxid, i))
                 continue;
 
             if (IsSpent(locked_chain, wtxid, i))
@@ -3268,6 +3569,8 @@ DBErrors CWallet::ZapSelectTx(std::vector<uint256>& vHashIn, std::vector<uint256
         wtxOrdered.erase(it->second.m_it_wtxOrdered);
         mapWallet.erase(it);
     }
+    m_unspent_outputs_dirty = true;
+    MarkBalancesDirty();
 
     if (nZapSelectTxRet == DBErrors::NEED_REWRITE)
     {
@@ -3461,16 +3764,16 @@ bool CWallet::TopUpKeyPool(unsigned int kpSize)
             // don't create extra internal keys
             missingInternal = 0;
         }
-        bool internal = false;
         WalletBatch batch(*database);
-        for (int64_t i = missingInternal + missingExternal; i--;)
-        {
-            if (i < missingInternal) {
-                internal = true;
+        // External keys first, then the internal keys
+        for (const bool internal : {false, true}) {
+            const int64_t missing = internal ? missingInternal : missingExternal;
+            if (missing <= 0) {
+                continue;
+            }
+            for (const CPubKey& pubkey : GenerateNewKeys(batch, missing, internal)) {
+                AddKeypoolPubkeyWithDB(pubkey, internal, batch);
             }
-
-            CPubKey pubkey(GenerateNewKey(batch, internal));
-            AddKeypoolPubkeyWithDB(pubkey, internal, batch);
         }
         if (missingInternal + missingExternal > 0) {
             WalletLogPrintf("keypool added %d keys (%d internal), size=%u (%u internal)\n", missingInternal + missingExternal, missingInternal, setInternalKeyPool.size() + setExternalKeyPool.size() + set_pre_split_keypool.size(), setInternalKeyPool.size());
@@ -4530,6 +4833,7 @@ bool CWalletTx::AcceptToMemoryPool(interfaces::Chain::Lock& locked_chain, const
     bool ret = ::AcceptToMemoryPool(mempool, state, tx, nullptr /* pfMissingInputs */,
                                 nullptr /* plTxnReplaced */, false /* bypass_limits */, nAbsurdFee);
     fInMempool |= ret;
+    pwallet->MarkBalancesDirty();
     return ret;
 }
 
@@ -7,6 +7,7 @@
 #define BITCOIN_WALLET_WALLET_H
 
 #include <amount.h>
+#include <blockfilter.h>
 #include <interfaces/chain.h>
 #include <outputtype.h>
 #include <policy/feerate.h>
@@ -92,6 +93,10 @@ static const unsigned int DEFAULT_TX_CONFIRM_TARGET = 1;
 static const bool DEFAULT_WALLET_RBF = false;
 static const bool DEFAULT_WALLETBROADCAST = true;
 static const bool DEFAULT_DISABLE_WALLET = false;
+//! -rescanblockfilter default
+static const bool DEFAULT_RESCAN_BLOCKFILTER = false;
+//! Number of blocks read ahead of a rescan
+static const unsigned int RESCAN_PREFETCH_BLOCKS = 64;
 
 //! Pre-calculated constants for input size estimation in *virtual size*
 static constexpr size_t DUMMY_NESTED_P2WPKH_INPUT_SIZE = 91;
@@ -657,6 +662,17 @@ class WalletRescanReserver; //forward declarations for ScanForWalletTransactions
  */
 class CWallet final : public CCryptoKeyStore, public CValidationInterface
 {
+public:
+    /** Balances of the wallet at depth 0 */
+    struct Balance {
+        CAmount m_mine_trusted{0};           //!< Trusted, in the main chain or trusted in mempool
+        CAmount m_mine_untrusted_pending{0}; //!< Untrusted, but in mempool (pending)
+        CAmount m_mine_immature{0};          //!< Immature coinbases and coinstakes in the main chain
+        CAmount m_watchonly_trusted{0};
+        CAmount m_watchonly_untrusted_pending{0};
+        CAmount m_watchonly_immature{0};
+    };
+
 private:
     std::atomic<bool> fAbortRescan{false};
     std::atomic<bool> fScanningWallet{false}; // controlled by WalletRescanReserver
@@ -685,6 +701,27 @@ private:
     void AddToSpends(const COutPoint& outpoint, const uint256& wtxid) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
     void AddToSpends(const uint256& wtxid) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
 
+    /**
+     * Outputs of wallet transactions that are ours and not spent by a wallet
+     * transaction, unless that transaction is abandoned or marked conflicted.
+     * This is a superset of the unspent outputs that doesn't depend on the
+     * chain, AvailableCoins checks depth and spent state on these only. Rebuilt
+     * from mapWallet when marked dirty (loads, zaps and key, script or watch-only
+     * changes), otherwise updated per changed transaction.
+     */
+    mutable std::set<COutPoint> m_unspent_outputs GUARDED_BY(cs_wallet);
+    mutable bool m_unspent_outputs_dirty GUARDED_BY(cs_wallet){true};
+    bool HasUnconflictedSpender(const COutPoint& outpoint) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    void UpdateUnspentOutput(const COutPoint& outpoint) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    void UpdateUnspentOutputs(const CWalletTx& wtx) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    const std::set<COutPoint>& GetUnspentOutputs() const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
+    //! Incremented by MarkBalancesDirty, the cached balances belong to one epoch and tip
+    mutable std::atomic<uint64_t> m_balance_epoch{0};
+    mutable Optional<uint64_t> m_balance_cache_epoch GUARDED_BY(cs_wallet);
+    mutable uint256 m_balance_cache_tip GUARDED_BY(cs_wallet);
+    mutable Balance m_balance_cache GUARDED_BY(cs_wallet);
+
     /**
      * Add a transaction to the wallet, or update it.  pIndex and posInBlock should
      * be set when the transaction was known to be included in a block.  When
@@ -718,6 +755,14 @@ private:
     /* HD derive new child key (on internal or external chain) */
     void DeriveNewChildKey(WalletBatch &batch, CKeyMetadata& metadata, CKey& secret, bool internal = false) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
 
+    struct DerivedKey {
+        CKey secret;
+        CPubKey pubkey;
+        CKeyMetadata metadata;
+    };
+    /* HD derive count new child keys (on internal or external chain), the keys are derived in parallel */
+    std::vector<DerivedKey> DeriveNewChildKeys(WalletBatch& batch, size_t count, bool internal) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
     std::set<int64_t> setInternalKeyPool;
     std::set<int64_t> setExternalKeyPool GUARDED_BY(cs_wallet);
     std::set<int64_t> set_pre_split_keypool;
@@ -879,6 +924,8 @@ public:
      * Generate a new key
      */
     CPubKey GenerateNewKey(WalletBatch& batch, bool internal = false) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    //! Generate count new keys, HD keys are derived in parallel
+    std::vector<CPubKey> GenerateNewKeys(WalletBatch& batch, size_t count, bool internal) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
     //! Adds a key to the store, and saves it to disk.
     bool AddKeyPubKey(const CKey& key, const CPubKey &pubkey) override EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
     bool AddKeyPubKeyWithDB(WalletBatch &batch,const CKey& key, const CPubKey &pubkey) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
@@ -940,6 +987,7 @@ public:
     void TransactionAddedToMempool(const CTransactionRef& tx) override;
     void BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex *pindex, const std::vector<CTransactionRef>& vtxConflicted) override;
     void BlockDisconnected(const std::shared_ptr<const CBlock>& pblock) override;
+    std::string GetSubscriberName() const override { return "wallet " + (GetName().empty() ? std::string("(default)") : GetName()); }
     int64_t RescanFromTime(int64_t startTime, const WalletRescanReserver& reserver, bool update);
 
     struct ScanResult {
@@ -958,11 +1006,19 @@ public:
         uint256 last_failed_block;
     };
     ScanResult ScanForWalletTransactions(const uint256& first_block, const uint256& last_block, const WalletRescanReserver& reserver, bool fUpdate);
+    //! Output scripts of the wallet keys, scripts and watch-only scripts, used to match block filters during a rescan
+    GCSFilter::ElementSet GetBlockFilterScripts() const;
     void TransactionRemovedFromMempool(const CTransactionRef &ptx) override;
     void ReacceptWalletTransactions(interfaces::Chain::Lock& locked_chain) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
     void ResendWalletTransactions(int64_t nBestBlockTime, CConnman* connman) override EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     // ResendWalletTransactionsBefore may only be called if fBroadcastTransactions!
     std::vector<uint256> ResendWalletTransactionsBefore(interfaces::Chain::Lock& locked_chain, int64_t nTime, CConnman* connman);
+    /** All balances at depth 0 in one pass over the wallet, reused until a wallet
+     *  transaction or the tip changes */
+    Balance GetBalances() const;
+    /** Invalidate the balances returned by GetBalances */
+    void MarkBalancesDirty() const { ++m_balance_epoch; }
+
     CAmount GetBalance(const isminefilter& filter=ISMINE_SPENDABLE, const int min_depth=0) const;
     CAmount GetUnconfirmedBalance() const;
     CAmount GetImmatureBalance() const;
@@ -167,6 +167,8 @@ public:
     bool fAnyUnordered{false};
     int nFileVersion{0};
     std::vector<uint256> vWalletUpgrade;
+    //! "tx" records, decoded after the cursor pass (see LoadWalletTxs)
+    std::vector<std::pair<uint256, CDataStream>> vTxRecords;
 
     CWalletScanState() {
     }
@@ -197,37 +199,7 @@ ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue,
         {
             uint256 hash;
             ssKey >> hash;
-            CWalletTx wtx(nullptr /* pwallet */, MakeTransactionRef());
-            ssValue >> wtx;
-            CValidationState state;
-            if (!(CheckTransaction(*wtx.tx, state) && (wtx.GetHash() == hash) && state.IsValid()))
-                return false;
-
-            // Undo serialize changes in 31600
-            if (31404 <= wtx.fTimeReceivedIsTxTime && wtx.fTimeReceivedIsTxTime <= 31703)
-            {
-                if (!ssValue.empty())
-                {
-                    char fTmp;
-                    char fUnused;
-                    std::string unused_string;
-                    ssValue >> fTmp >> fUnused >> unused_string;
-                    strErr = strprintf("LoadWallet() upgrading tx ver=%d %d %s",
-                                       wtx.fTimeReceivedIsTxTime, fTmp, hash.ToString());
-                    wtx.fTimeReceivedIsTxTime = fTmp;
-                }
-                else
-                {
-                    strErr = strprintf("LoadWallet() repairing tx ver=%d %s", wtx.fTimeReceivedIsTxTime, hash.ToString());
-                    wtx.fTimeReceivedIsTxTime = 0;
-                }
-                wss.vWalletUpgrade.push_back(hash);
-            }
-
-            if (wtx.nOrderPos == -1)
-                wss.fAnyUnordered = true;
-
-            pwallet->LoadToWallet(wtx);
+            wss.vTxRecords.emplace_back(hash, std::move(ssValue));
         }
         else if (strType == "watchs")
         {
@@ -429,6 +401,82 @@ ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue,
     return true;
 }
 
+//! Decodes and checks a "tx" record, safe to call without cs_wallet
+static bool ReadWalletTx(const uint256& hash, CDataStream& ssValue, CWalletTx& wtx, bool& fUpgraded, std::string& strErr)
+{
+    try {
+        ssValue >> wtx;
+        CValidationState state;
+        if (!(CheckTransaction(*wtx.tx, state) && (wtx.GetHash() == hash) && state.IsValid()))
+            return false;
+
+        // Undo serialize changes in 31600
+        if (31404 <= wtx.fTimeReceivedIsTxTime && wtx.fTimeReceivedIsTxTime <= 31703)
+        {
+            if (!ssValue.empty())
+            {
+                char fTmp;
+                char fUnused;
+                std::string unused_string;
+                ssValue >> fTmp >> fUnused >> unused_string;
+                strErr = strprintf("LoadWallet() upgrading tx ver=%d %d %s",
+                                   wtx.fTimeReceivedIsTxTime, fTmp, hash.ToString());
+                wtx.fTimeReceivedIsTxTime = fTmp;
+            }
+            else
+            {
+                strErr = strprintf("LoadWallet() repairing tx ver=%d %s", wtx.fTimeReceivedIsTxTime, hash.ToString());
+                wtx.fTimeReceivedIsTxTime = 0;
+            }
+            fUpgraded = true;
+        }
+    } catch (...)
+    {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Adds the "tx" records collected by the cursor pass to the wallet. Deserializing and
+ * checking the transactions dominates the load time of large wallets, the records are
+ * decoded on worker threads and added in database order. Returns false if a record
+ * failed to decode.
+ */
+static bool LoadWalletTxs(CWallet* pwallet, CWalletScanState& wss) EXCLUSIVE_LOCKS_REQUIRED(pwallet->cs_wallet)
+{
+    struct TxRecord {
+        std::unique_ptr<CWalletTx> wtx;
+        bool fOK{false};
+        bool fUpgraded{false};
+        std::string strErr;
+    };
+    std::vector<TxRecord> records(wss.vTxRecords.size());
+    ParallelFor(records.size(), [&](size_t i) {
+        auto& record = records[i];
+        record.wtx = MakeUnique<CWalletTx>(nullptr /* pwallet */, MakeTransactionRef());
+        record.fOK = ReadWalletTx(wss.vTxRecords[i].first, wss.vTxRecords[i].second, *record.wtx, record.fUpgraded, record.strErr);
+    });
+
+    bool fAllOK = true;
+    for (size_t i = 0; i < records.size(); ++i) {
+        const auto& record = records[i];
+        if (!record.strErr.empty())
+            pwallet->WalletLogPrintf("%s\n", record.strErr);
+        if (!record.fOK) {
+            fAllOK = false;
+            continue;
+        }
+        if (record.fUpgraded)
+            wss.vWalletUpgrade.push_back(wss.vTxRecords[i].first);
+        if (record.wtx->nOrderPos == -1)
+            wss.fAnyUnordered = true;
+        pwallet->LoadToWallet(*record.wtx);
+    }
+    wss.vTxRecords.clear();
+    return fAllOK;
+}
+
 bool WalletBatch::IsKeyType(const std::string& strType)
 {
     return (strType== "key" || strType == "wkey" ||
@@ -496,6 +544,12 @@ DBErrors WalletBatch::LoadWallet(CWallet* pwallet)
                 pwallet->WalletLogPrintf("%s\n", strErr);
         }
         pcursor->close();
+
+        if (!LoadWalletTxs(pwallet, wss)) {
+            fNoncriticalErrors = true;
+            // Rescan if there is a bad transaction record:
+            gArgs.SoftSetBoolArg("-rescan", true);
+        }
     }
     catch (const boost::thread_interrupted&) {
         throw;
@@ -669,17 +723,25 @@ void MaybeCompactWalletDB()
         return;
     }
 
+    const int64_t flush_delay = gArgs.GetArg("-walletflushdelay", DEFAULT_WALLET_FLUSH_DELAY);
+
     for (const std::shared_ptr<CWallet>& pwallet : GetWallets()) {
         WalletDatabase& dbh = pwallet->GetDBHandle();
 
         unsigned int nUpdateCounter = dbh.nUpdateCounter;
 
         if (dbh.nLastSeen != nUpdateCounter) {
+            if (dbh.nLastSeen == dbh.nLastFlushed)
+                dbh.nFirstUnflushedUpdate = GetTime();
             dbh.nLastSeen = nUpdateCounter;
             dbh.nLastWalletUpdate = GetTime();
         }
 
-        if (dbh.nLastFlushed != nUpdateCounter && GetTime() - dbh.nLastWalletUpdate >= 2) {
+        // Flush once the wallet is idle, or once the oldest unflushed update is older
+        // than the flush delay on a wallet that is updated all the time
+        const bool idle = GetTime() - dbh.nLastWalletUpdate >= 2;
+        const bool delayed = flush_delay > 0 && GetTime() - dbh.nFirstUnflushedUpdate >= flush_delay;
+        if (dbh.nLastFlushed != nUpdateCounter && (idle || delayed)) {
             if (BerkeleyBatch::PeriodicFlush(dbh)) {
                 dbh.nLastFlushed = nUpdateCounter;
             }
@@ -7,6 +7,9 @@
 #include <logging.h>
 #include <util/system.h>
 
+#include <atomic>
+#include <thread>
+
 fs::path GetWalletDir()
 {
     fs::path path;
@@ -100,3 +103,22 @@ bool WalletLocation::Exists() const
 {
     return fs::symlink_status(m_path).type() != fs::file_not_found;
 }
+
+void ParallelFor(size_t count, const std::function<void(size_t)>& fn)
+{
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t i = next++; i < count; i = next++) {
+            fn(i);
+        }
+    };
+    const size_t num_threads = std::min<size_t>(std::max(GetNumCores(), 1), count);
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < num_threads; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
@@ -7,6 +7,7 @@
 
 #include <fs.h>
 
+#include <functional>
 #include <vector>
 
 //! Get the path of the wallet directory.
@@ -15,6 +16,9 @@ fs::path GetWalletDir();
 //! Get wallets in wallet directory.
 std::vector<fs::path> ListWalletDir();
 
+//! Runs fn for the indices [0, count) on up to num_cores threads, including the calling thread
+void ParallelFor(size_t count, const std::function<void(size_t)>& fn);
+
 //! The WalletLocation class provides wallet information.
 class WalletLocation final
 {
@@ -66,6 +66,45 @@ static std::vector<COutput> availableCoins(const bool & onlySafe = true, const i
     return std::move(r);
 }
 
+//*****************************************************************************
+//*****************************************************************************
+bool signLocalTransaction(CMutableTransaction & mtx)
+{
+    // Find the wallet and the previous output of every input first
+    std::vector<std::shared_ptr<CWallet>> signers(mtx.vin.size());
+    std::vector<CTxOut> prevouts(mtx.vin.size());
+    const auto wallets = GetWallets();
+    for (size_t i = 0; i < mtx.vin.size(); ++i) {
+        const auto & prevout = mtx.vin[i].prevout;
+        for (const auto & wallet : wallets) {
+            const auto wtx = wallet->GetWalletTx(prevout.hash);
+            if (!wtx || prevout.n >= wtx->tx->vout.size())
+                continue;
+            signers[i] = wallet;
+            prevouts[i] = wtx->tx->vout[prevout.n];
+            break;
+        }
+        if (!signers[i]) {
+            LOG() << "input " << prevout.ToString() << " not found in the local wallets " << __FUNCTION__;
+            return false;
+        }
+        if (signers[i]->IsLocked()) {
+            LOG() << "wallet " << signers[i]->GetName() << " is locked " << __FUNCTION__;
+            return false;
+        }
+    }
+
+    const PrecomputedTransactionData txdata(mtx);
+    for (size_t i = 0; i < mtx.vin.size(); ++i) {
+        SignatureData sigdata = DataFromTransaction(mtx, i, prevouts[i]);
+        if (!ProduceSignature(*signers[i], MutableTransactionSignatureCreator(&mtx, i, prevouts[i].nValue, &txdata, SIGHASH_ALL),
+                              prevouts[i].scriptPubKey, sigdata))
+            return false;
+        UpdateInput(mtx.vin[i], sigdata);
+    }
+    return true;
+}
+
 //*****************************************************************************
 //*****************************************************************************
 bool createFeeTransaction(const CScript & dstScript, const double amount,
@@ -210,27 +249,8 @@ bool createFeeTransaction(const CScript & dstScript, const double amount,
             mtx.vout[i] = vouts[i];
 
         // Sign all the inputs
-        auto wallets = GetWallets();
-        for (int i = 0; i < mtx.vin.size(); ++i) {
-            const auto & vin = mtx.vin[i];
-            for (const auto & wallet : wallets) {
-                const auto & wtx = wallet->GetWalletTx(vin.prevout.hash);
-                if (!wtx)
-                    continue;
-                if (wallet->IsLocked())
-                    throw std::runtime_error("Unable to send fee tx, wallet is locked");
-                const auto & prevtxout = wtx->tx->vout[vin.prevout.n];
-                SignatureData sigdata = DataFromTransaction(mtx, i, prevtxout);
-                ProduceSignature(*wallet, MutableTransactionSignatureCreator(&mtx, i, prevtxout.nValue, SIGHASH_ALL),
-                                 prevtxout.scriptPubKey, sigdata);
-                UpdateInput(mtx.vin[i], sigdata);
-            }
-        }
-
-        for (const auto & vin : mtx.vin) {
-            if (vin.scriptSig.empty())
-                throw std::runtime_error("Sign transaction error or not completed, failed to sign transaction");
-        }
+        if (!signLocalTransaction(mtx))
+            throw std::runtime_error("Sign transaction error or not completed, failed to sign transaction");
 
         // Send transaction
         uint256 txid;
@@ -10,6 +10,7 @@
 
 #include <xbridge/xbridgewallet.h>
 
+#include <primitives/transaction.h>
 #include <script/script.h>
 
 #include <vector>
@@ -45,6 +46,14 @@ namespace rpc
                               std::set<xbridge::wallet::UtxoEntry> & feeUtxos,
                               std::string & rawTx);
 
+    /**
+     * @brief Sign all inputs of a transaction with the node's own wallets, without rpc
+     * round trips. The witness sighash parts are computed once for all inputs.
+     * @param mtx Transaction to sign, the outputs must be final
+     * @return false if an input isn't owned by an unlocked local wallet or can't be signed
+     */
+    bool signLocalTransaction(CMutableTransaction & mtx);
+
     /**
      * @brief storeDataIntoBlockchain Submits the Service Node order fee to the network.
      * @param rawTx
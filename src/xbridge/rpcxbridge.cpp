@@ -310,11 +310,11 @@ UniValue dxGetOrders(const JSONRPCRequest& request)
     }
 
     auto &xapp = xbridge::App::instance();
-    TransactionMap trlist = xapp.transactions();
+    const auto trlist = xapp.transactions();
     auto currentTime = boost::posix_time::second_clock::universal_time();
 
     Array result;
-    for (const auto& trEntry : trlist) {
+    for (const auto& trEntry : *trlist) {
 
         const auto &tr = trEntry.second;
 
@@ -388,25 +388,13 @@ UniValue dxGetOrderFills(const JSONRPCRequest& request)
 
 
 
-    TransactionMap history = xbridge::App::instance().history();
-
-
-
-    TransactionVector result;
-
-    for (auto &item : history) {
-        const xbridge::TransactionDescrPtr &ptr = item.second;
-        if ((ptr->state == xbridge::TransactionDescr::trFinished) &&
-            (combined ? ((ptr->fromCurrency == maker && ptr->toCurrency == taker) || (ptr->toCurrency == maker && ptr->fromCurrency == taker)) : (ptr->fromCurrency == maker && ptr->toCurrency == taker))) {
-            result.push_back(ptr);
-        }
-    }
-
-    std::sort(result.begin(), result.end(),
-              [](const xbridge::TransactionDescrPtr &a,  const xbridge::TransactionDescrPtr &b)
-    {
-         return (a->txtime) > (b->txtime);
-    });
+    // filled orders of the pair, newest first
+    xbridge::OrderHistoryQuery query;
+    query.fromCurrency = maker;
+    query.toCurrency   = taker;
+    query.withInverse  = combined;
+    query.states.insert(xbridge::TransactionDescr::trFinished);
+    const TransactionVector result = xbridge::App::instance().historyOrders(query);
 
     Array arr;
     for(const auto &transaction : result) {
@@ -772,6 +760,182 @@ UniValue dxMakeOrder(const JSONRPCRequest& request)
     }
 }
 
+UniValue dxMakeOrders(const JSONRPCRequest& request)
+{
+    if (request.fHelp)
+        throw std::runtime_error(
+            RPCHelpMan{"dxMakeOrders",
+                "\nCreate new orders in one pass. The service nodes, wallet utxos and block hash are looked up once "
+                "for all orders. Returns the created order or the error of each order in the request order.\n",
+                {
+                    {"orders", RPCArg::Type::ARR, RPCArg::Optional::NO, "Orders to create",
+                        {
+                            {"", RPCArg::Type::OBJ, RPCArg::Optional::OMITTED, "",
+                                {
+                                    {"maker", RPCArg::Type::STR, RPCArg::Optional::NO, "Maker (e.g. LTC)"},
+                                    {"maker_size", RPCArg::Type::STR, RPCArg::Optional::NO, "Amount of maker coin being sent"},
+                                    {"maker_address", RPCArg::Type::STR, RPCArg::Optional::NO, "Maker address containing coin being sent"},
+                                    {"taker", RPCArg::Type::STR, RPCArg::Optional::NO, "Taker (e.g. BLOCK)"},
+                                    {"taker_size", RPCArg::Type::STR, RPCArg::Optional::NO, "Amount of taker coin being recieved"},
+                                    {"taker_address", RPCArg::Type::STR, RPCArg::Optional::NO, "Taker address receiving the coin"},
+                                    {"type", RPCArg::Type::STR, RPCArg::Optional::NO, "Order type (e.g. exact)"},
+                                },
+                            },
+                        },
+                    },
+                },
+                RPCResult{
+                "\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("dxMakeOrders", "'[{\"maker\":\"LTC\",\"maker_size\":\"25\",\"maker_address\":\"LLZ1pgb6Jqx8hu84fcr5WC5HMoKRUsRE8H\",\"taker\":\"BLOCK\",\"taker_size\":\"1000\",\"taker_address\":\"BWQrvmuHB4C68KH5V7fcn9bFtWN8y5hBmR\",\"type\":\"exact\"}]'")
+                  + HelpExampleRpc("dxMakeOrders", "[{\"maker\":\"LTC\",\"maker_size\":\"25\",\"maker_address\":\"LLZ1pgb6Jqx8hu84fcr5WC5HMoKRUsRE8H\",\"taker\":\"BLOCK\",\"taker_size\":\"1000\",\"taker_address\":\"BWQrvmuHB4C68KH5V7fcn9bFtWN8y5hBmR\",\"type\":\"exact\"}]")
+                },
+            }.ToString());
+    Value js; json_spirit::read_string(request.params.write(), js); Array params = js.get_array();
+
+    if (params.size() != 1 || params[0].type() != array_type) {
+        return uret(xbridge::makeError(xbridge::INVALID_PARAMETERS, __FUNCTION__,
+                               "(orders)"));
+    }
+
+    xbridge::App &app = xbridge::App::instance();
+
+    const Array & items = params[0].get_array();
+    Array results(items.size());
+    std::vector<xbridge::App::NewOrder> orders;
+    std::vector<size_t> indexes;
+    orders.reserve(items.size());
+    indexes.reserve(items.size());
+
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+        if (items[i].type() != obj_type) {
+            results[i] = xbridge::makeError(xbridge::INVALID_PARAMETERS, __FUNCTION__, "order must be an object");
+            continue;
+        }
+
+        const Object & item = items[i].get_obj();
+        std::string fields[7];
+        const char * names[7] = {"maker", "maker_size", "maker_address", "taker", "taker_size", "taker_address", "type"};
+        bool valid = true;
+        for (size_t j = 0; j < 7; ++j)
+        {
+            const Value & v = find_value(item, names[j]);
+            if (v.type() != str_type) {
+                results[i] = xbridge::makeError(xbridge::INVALID_PARAMETERS, __FUNCTION__, names[j]);
+                valid = false;
+                break;
+            }
+            fields[j] = v.get_str();
+        }
+        if (!valid)
+            continue;
+
+        if (!xbridge::xBridgeValidCoin(fields[1]) || !xbridge::xBridgeValidCoin(fields[4])) {
+            results[i] = xbridge::makeError(xbridge::INVALID_PARAMETERS, __FUNCTION__,
+                          "size is too precise, maximum precision supported is " +
+                                  std::to_string(xbridge::xBridgeSignificantDigits(xbridge::TransactionDescr::COIN)) + " digits");
+            continue;
+        }
+
+        const std::string & fromCurrency = fields[0];
+        const double        fromAmount   = boost::lexical_cast<double>(fields[1]);
+        const std::string & fromAddress  = fields[2];
+        const std::string & toCurrency   = fields[3];
+        const double        toAmount     = boost::lexical_cast<double>(fields[4]);
+        const std::string & toAddress    = fields[5];
+
+        if (fields[6] != "exact") {
+            results[i] = xbridge::makeError(xbridge::INVALID_PARAMETERS, __FUNCTION__,
+                                   "Only the exact type is supported at this time.");
+            continue;
+        }
+        if (fromAddress == toAddress) {
+            results[i] = xbridge::makeError(xbridge::INVALID_PARAMETERS, __FUNCTION__,
+                                   "maker address and taker address cannot be the same: " + fromAddress);
+            continue;
+        }
+        if (fromAmount > (double)xbridge::TransactionDescr::MAX_COIN ||
+                toAmount > (double)xbridge::TransactionDescr::MAX_COIN) {
+            results[i] = xbridge::makeError(xbridge::INVALID_PARAMETERS, __FUNCTION__,
+                                   "Maximum supported size is " + std::to_string(xbridge::TransactionDescr::MAX_COIN));
+            continue;
+        }
+        if (fromAmount <= 0 || toAmount <= 0) {
+            results[i] = xbridge::makeError(xbridge::INVALID_PARAMETERS, __FUNCTION__,
+                                   "Minimum supported size is " + xbridge::xBridgeStringValueFromPrice(1.0/xbridge::TransactionDescr::COIN));
+            continue;
+        }
+
+        xbridge::WalletConnectorPtr connFrom = app.connectorByCurrency(fromCurrency);
+        xbridge::WalletConnectorPtr connTo   = app.connectorByCurrency(toCurrency);
+        if (!connFrom || !connTo) {
+            results[i] = xbridge::makeError(xbridge::NO_SESSION, __FUNCTION__,
+                                   "unable to connect to wallet: " + (connFrom ? toCurrency : fromCurrency));
+            continue;
+        }
+        if (!app.isValidAddress(fromAddress, connFrom)) {
+            results[i] = xbridge::makeError(xbridge::INVALID_ADDRESS, __FUNCTION__, fromAddress);
+            continue;
+        }
+        if (!app.isValidAddress(toAddress, connTo)) {
+            results[i] = xbridge::makeError(xbridge::INVALID_ADDRESS, __FUNCTION__, toAddress);
+            continue;
+        }
+
+        xbridge::App::NewOrder order;
+        order.from         = fromAddress;
+        order.fromCurrency = fromCurrency;
+        order.fromAmount   = xbridge::xBridgeAmountFromReal(fromAmount);
+        order.to           = toAddress;
+        order.toCurrency   = toCurrency;
+        order.toAmount     = xbridge::xBridgeAmountFromReal(toAmount);
+        orders.push_back(order);
+        indexes.push_back(i);
+    }
+
+    app.sendXBridgeTransactions(orders);
+
+    for (size_t k = 0; k < orders.size(); ++k)
+    {
+        const xbridge::App::NewOrder & order = orders[k];
+        Value & result = results[indexes[k]];
+
+        switch (order.status) {
+        case xbridge::SUCCESS:
+            break;
+        case xbridge::INVALID_CURRENCY:
+        case xbridge::NO_SESSION:
+            result = xbridge::makeError(order.status, __FUNCTION__, order.fromCurrency);
+            continue;
+        case xbridge::INSIFFICIENT_FUNDS:
+            result = xbridge::makeError(order.status, __FUNCTION__, order.from);
+            continue;
+        default:
+            result = xbridge::makeError(order.status, __FUNCTION__);
+            continue;
+        }
+
+        Object obj;
+        obj.emplace_back(Pair("id",             order.id.GetHex()));
+        obj.emplace_back(Pair("maker_address",  order.from));
+        obj.emplace_back(Pair("maker",          order.fromCurrency));
+        obj.emplace_back(Pair("maker_size",     xbridge::xBridgeStringValueFromAmount(order.fromAmount)));
+        obj.emplace_back(Pair("taker_address",  order.to));
+        obj.emplace_back(Pair("taker",          order.toCurrency));
+        obj.emplace_back(Pair("taker_size",     xbridge::xBridgeStringValueFromAmount(order.toAmount)));
+        const auto &createdTime = app.transaction(order.id)->created;
+        obj.emplace_back(Pair("created_at",     xbridge::iso8601(createdTime)));
+        obj.emplace_back(Pair("updated_at",     xbridge::iso8601(boost::posix_time::microsec_clock::universal_time()))); // TODO Need actual updated time, this is just estimate
+        obj.emplace_back(Pair("block_id",       order.blockHash.GetHex()));
+        obj.emplace_back(Pair("status",         "created"));
+        result = obj;
+    }
+
+    return uret(results);
+}
+
 UniValue dxTakeOrder(const JSONRPCRequest& request)
 {
     if (request.fHelp)
@@ -988,6 +1152,103 @@ UniValue dxCancelOrder(const JSONRPCRequest& request)
     return uret(obj);
 }
 
+UniValue dxCancelOrders(const JSONRPCRequest& request)
+{
+    if(request.fHelp)
+        throw std::runtime_error(
+            RPCHelpMan{"dxCancelOrders",
+                "\nCancel xbridge orders. Returns the cancelled order or the error of each order in the request order.\n",
+                {
+                    {"id", RPCArg::Type::STR_HEX, RPCArg::Optional::NO, "Orders to cancel, one or more ids"},
+                },
+                RPCResult{
+                "\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("dxCancelOrders", "e1e493130d784d6ce22e4976962d9837c7a671555b0cf78b022dfdf861496872 3d7e4f9f4e1c5d8f1e1b7c2f0a6b6e0c5a4d3c2b1a09f8e7d6c5b4a392817065")
+                  + HelpExampleRpc("dxCancelOrders", "e1e493130d784d6ce22e4976962d9837c7a671555b0cf78b022dfdf861496872 3d7e4f9f4e1c5d8f1e1b7c2f0a6b6e0c5a4d3c2b1a09f8e7d6c5b4a392817065")
+                },
+            }.ToString());
+    Value js; json_spirit::read_string(request.params.write(), js); Array params = js.get_array();
+
+    if (params.empty())
+    {
+        return uret(xbridge::makeError(xbridge::INVALID_PARAMETERS, __FUNCTION__,
+                               "(id) [(id) ...]"));
+    }
+
+    LOG() << "rpc cancel orders " << params.size() << " " << __FUNCTION__;
+
+    xbridge::App &app = xbridge::App::instance();
+
+    Array results(params.size());
+    std::vector<xbridge::TransactionDescrPtr> txs;
+    std::vector<uint256> ids;
+    std::vector<size_t> indexes;
+    for (size_t i = 0; i < params.size(); ++i)
+    {
+        if (params[i].type() != str_type) {
+            results[i] = xbridge::makeError(xbridge::INVALID_PARAMETERS, __FUNCTION__, "id must be a string");
+            continue;
+        }
+
+        const uint256 id = uint256S(params[i].get_str());
+        xbridge::TransactionDescrPtr tx = app.transaction(id);
+        if (!tx) {
+            results[i] = xbridge::makeError(xbridge::TRANSACTION_NOT_FOUND, __FUNCTION__, id.ToString());
+            continue;
+        }
+        if (tx->state >= xbridge::TransactionDescr::trCreated) {
+            results[i] = xbridge::makeError(xbridge::INVALID_STATE, __FUNCTION__, "order is already " + tx->strState());
+            continue;
+        }
+
+        txs.push_back(tx);
+        ids.push_back(id);
+        indexes.push_back(i);
+    }
+
+    const std::vector<xbridge::Error> statuses = app.cancelXBridgeTransactions(ids, crRpcRequest);
+
+    for (size_t k = 0; k < txs.size(); ++k)
+    {
+        const xbridge::TransactionDescrPtr & tx = txs[k];
+        Value & result = results[indexes[k]];
+
+        if (statuses[k] != xbridge::SUCCESS) {
+            result = xbridge::makeError(statuses[k], __FUNCTION__);
+            continue;
+        }
+
+        xbridge::WalletConnectorPtr connFrom = app.connectorByCurrency(tx->fromCurrency);
+        xbridge::WalletConnectorPtr connTo   = app.connectorByCurrency(tx->toCurrency);
+        if (!connFrom || !connTo) {
+            result = xbridge::makeError(xbridge::NO_SESSION, __FUNCTION__, connFrom ? tx->toCurrency : tx->fromCurrency);
+            continue;
+        }
+
+        Object obj;
+        obj.emplace_back(Pair("id", tx->id.GetHex()));
+
+        obj.emplace_back(Pair("maker", tx->fromCurrency));
+        obj.emplace_back(Pair("maker_size", xbridge::xBridgeStringValueFromAmount(tx->fromAmount)));
+        obj.emplace_back(Pair("maker_address", connFrom->fromXAddr(tx->from)));
+
+        obj.emplace_back(Pair("taker", tx->toCurrency));
+        obj.emplace_back(Pair("taker_size", xbridge::xBridgeStringValueFromAmount(tx->toAmount)));
+        obj.emplace_back(Pair("taker_address", connTo->fromXAddr(tx->to)));
+        obj.emplace_back(Pair("refund_tx", tx->refTx));
+
+        obj.emplace_back(Pair("updated_at", xbridge::iso8601(tx->txtime)));
+        obj.emplace_back(Pair("created_at", xbridge::iso8601(tx->created)));
+
+        obj.emplace_back(Pair("status", tx->strState()));
+        result = obj;
+    }
+
+    return uret(results);
+}
+
 UniValue dxFlushCancelledOrders(const JSONRPCRequest& request)
 {
     if(request.fHelp)
@@ -1071,7 +1332,6 @@ UniValue dxGetOrderBook(const JSONRPCRequest& request)
     }
 
     Object res;
-    TransactionMap trList = xbridge::App::instance().transactions();
     {
         /**
          * @brief detaiLevel - Get a list of open orders for a product.
@@ -1107,186 +1367,32 @@ UniValue dxGetOrderBook(const JSONRPCRequest& request)
          */
         Array asks;
 
-        if(trList.empty())
-        {
-            LOG() << "empty transactions list";
-            res.emplace_back(Pair("asks", asks));
-            res.emplace_back(Pair("bids", bids));
-            return uret(res);
-        }
-
-        TransactionMap asksList;
-        TransactionMap bidsList;
-
-        //copy all transactions in currencies specified in the parameters
-
-        // ask orders are based in the first token in the trading pair
-        std::copy_if(trList.begin(), trList.end(), std::inserter(asksList, asksList.end()),
-                     [&toCurrency, &fromCurrency](const TransactionPair &transaction)
-        {
-            if(transaction.second == nullptr)
-                return false;
-            if (transaction.second->fromAmount <= 0 || transaction.second->toAmount <= 0)
-                return false;
-            if (transaction.second->state != xbridge::TransactionDescr::trPending)
-                return false;
-
-            return  ((transaction.second->toCurrency == toCurrency) &&
-                    (transaction.second->fromCurrency == fromCurrency));
-        });
-
-        // bid orders are based in the second token in the trading pair (inverse of asks)
-        std::copy_if(trList.begin(), trList.end(), std::inserter(bidsList, bidsList.end()),
-                     [&toCurrency, &fromCurrency](const TransactionPair &transaction)
-        {
-            if(transaction.second == nullptr)
-                return false;
-            if (transaction.second->fromAmount <= 0 || transaction.second->toAmount <= 0)
-                return false;
-            if (transaction.second->state != xbridge::TransactionDescr::trPending)
-                return false;
-
-            return  ((transaction.second->toCurrency == fromCurrency) &&
-                    (transaction.second->fromCurrency == toCurrency));
-        });
-
-        std::vector<xbridge::TransactionDescrPtr> asksVector;
-        std::vector<xbridge::TransactionDescrPtr> bidsVector;
-
-        for (const auto &trEntry : asksList)
-            asksVector.emplace_back(trEntry.second);
-
-        for (const auto &trEntry : bidsList)
-            bidsVector.emplace_back(trEntry.second);
-
-        // sort asks descending
-        std::sort(asksVector.begin(), asksVector.end(),
-                  [](const xbridge::TransactionDescrPtr &a, const xbridge::TransactionDescrPtr &b)
-        {
-            const auto priceA = xbridge::price(a);
-            const auto priceB = xbridge::price(b);
-            return priceA > priceB;
-        });
-
-        //sort bids descending
-        std::sort(bidsVector.begin(), bidsVector.end(),
-                  [](const xbridge::TransactionDescrPtr &a, const xbridge::TransactionDescrPtr &b)
-        {
-            const auto priceA = xbridge::priceBid(a);
-            const auto priceB = xbridge::priceBid(b);
-            return priceA > priceB;
-        });
-
-        // floating point comparisons
-        // see Knuth 4.2.2 Eq 36
-        auto floatCompare = [](const double a, const double b) -> bool
-        {
-            const auto epsilon = std::numeric_limits<double>::epsilon();
-            return (fabs(a - b) / fabs(a) <= epsilon) && (fabs(a - b) / fabs(b) <= epsilon);
-        };
+        // ask orders are based in the first token in the trading pair, bid orders are
+        // based in the second token (inverse of asks), both are listed best price first
+        auto & xapp = xbridge::App::instance();
+        const std::size_t maxLevels = detailLevel == 1 || detailLevel == 4 ? 1 : maxOrders;
+        const auto askLevels = xapp.orderBookLevels(fromCurrency, toCurrency, maxLevels);
+        const auto bidLevels = xapp.orderBookLevels(toCurrency, fromCurrency, maxLevels);
 
         switch (detailLevel)
         {
         case 1:
         {
             //return only the best bid and ask
-            if (!bidsList.empty()) {
-                const auto bidsItem = std::max_element(bidsList.begin(), bidsList.end(),
-                                       [](const TransactionPair &a, const TransactionPair &b)
-                {
-                    //find transaction with best bids
-                    const auto &tr1 = a.second;
-                    const auto &tr2 = b.second;
-
-                    if(tr1 == nullptr)
-                        return true;
-
-                    if(tr2 == nullptr)
-                        return false;
-
-                    const auto priceA = xbridge::priceBid(tr1);
-                    const auto priceB = xbridge::priceBid(tr2);
-
-                    return priceA < priceB;
-                });
-
-                const auto bidsCount = std::count_if(bidsList.begin(), bidsList.end(),
-                                                     [bidsItem, floatCompare](const TransactionPair &a)
-                {
-                    const auto &tr = a.second;
-
-                    if(tr == nullptr)
-                        return false;
-
-                    const auto price = xbridge::priceBid(tr);
-
-                    const auto &bestTr = bidsItem->second;
-                    if (bestTr != nullptr)
-                    {
-                        const auto bestBidPrice = xbridge::priceBid(bestTr);
-                        return floatCompare(price, bestBidPrice);
-                    }
-
-                    return false;
-                });
-
-                const auto &tr = bidsItem->second;
-                if (tr != nullptr)
-                {
-                    const auto bidPrice = xbridge::priceBid(tr);
-                    bids.emplace_back(Array{xbridge::xBridgeStringValueFromPrice(bidPrice),
-                                            xbridge::xBridgeStringValueFromAmount(tr->toAmount),
-                                            static_cast<int64_t>(bidsCount)});
-                }
+            if (!bidLevels.empty()) {
+                const auto & level = bidLevels.front();
+                const auto & tr = level.orders.front();
+                bids.emplace_back(Array{xbridge::xBridgeStringValueFromPrice(xbridge::priceBid(tr)),
+                                        xbridge::xBridgeStringValueFromAmount(tr->toAmount),
+                                        static_cast<int64_t>(level.orders.size())});
             }
 
-            if (!asksList.empty()) {
-                const auto asksItem = std::min_element(asksList.begin(), asksList.end(),
-                                                   [](const TransactionPair &a, const TransactionPair &b)
-                {
-                    //find transactions with best asks
-                    const auto &tr1 = a.second;
-                    const auto &tr2 = b.second;
-
-                    if(tr1 == nullptr)
-                        return true;
-
-                    if(tr2 == nullptr)
-                        return false;
-
-                    const auto priceA = xbridge::price(tr1);
-                    const auto priceB = xbridge::price(tr2);
-                    return priceA < priceB;
-                });
-
-                const auto asksCount = std::count_if(asksList.begin(), asksList.end(),
-                                                     [asksItem, floatCompare](const TransactionPair &a)
-                {
-                    const auto &tr = a.second;
-
-                    if(tr == nullptr)
-                        return false;
-
-                    const auto price = xbridge::price(tr);
-
-                    const auto &bestTr = asksItem->second;
-                    if (bestTr != nullptr)
-                    {
-                        const auto bestAskPrice = xbridge::price(bestTr);
-                        return floatCompare(price, bestAskPrice);
-                    }
-
-                    return false;
-                });
-
-                const auto &tr = asksItem->second;
-                if (tr != nullptr)
-                {
-                    const auto askPrice = xbridge::price(tr);
-                    asks.emplace_back(Array{xbridge::xBridgeStringValueFromPrice(askPrice),
-                                            xbridge::xBridgeStringValueFromAmount(tr->fromAmount),
-                                            static_cast<int64_t>(asksCount)});
-                }
+            if (!askLevels.empty()) {
+                const auto & level = askLevels.front();
+                const auto & tr = level.orders.front();
+                asks.emplace_back(Array{xbridge::xBridgeStringValueFromPrice(xbridge::price(tr)),
+                                        xbridge::xBridgeStringValueFromAmount(tr->fromAmount),
+                                        static_cast<int64_t>(level.orders.size())});
             }
 
             res.emplace_back(Pair("asks", asks));
@@ -1296,76 +1402,24 @@ UniValue dxGetOrderBook(const JSONRPCRequest& request)
         case 2:
         {
             //Top X bids and asks (aggregated)
-
-            /**
-             * @brief bound - calculate upper bound
-             */
-            auto bound = std::min<int32_t>(maxOrders, bidsVector.size());
-            for (size_t i = 0; i < bound; ++i) // Best bids are at the beginning of the stack (sorted descending, highest price better)
+            for (const auto & level : bidLevels) // Best bids first (descending, highest price better)
             {
-                if(bidsVector[i] == nullptr)
-                    continue;
-
-                Array bid;
-                //calculate bids and push to array
-                const auto bidAmount    = bidsVector[i]->toAmount;
-                const auto bidPrice     = xbridge::priceBid(bidsVector[i]);
-                auto bidSize            = bidAmount;
-                const auto bidsCount    = std::count_if(bidsList.begin(), bidsList.end(),
-                                                     [bidPrice, floatCompare](const TransactionPair &a)
-                {
-                    const auto &tr = a.second;
-
-                    if(tr == nullptr)
-                        return false;
-
-                    const auto price = xbridge::priceBid(tr);
-
-                    return floatCompare(price, bidPrice);
-                });
-                //array sorted by bid price, we can to skip the transactions with equals bid price
-                while((++i < bound) && floatCompare(xbridge::priceBid(bidsVector[i]), bidPrice)) {
-                    bidSize += bidsVector[i]->toAmount;
-                }
-                bid.emplace_back(xbridge::xBridgeStringValueFromPrice(bidPrice));
-                bid.emplace_back(xbridge::xBridgeStringValueFromAmount(bidSize));
-                bid.emplace_back(static_cast<int64_t>(bidsCount));
-                bids.emplace_back(bid);
+                uint64_t bidSize = 0;
+                for (const auto & tr : level.orders)
+                    bidSize += tr->toAmount;
+                bids.emplace_back(Array{xbridge::xBridgeStringValueFromPrice(xbridge::priceBid(level.orders.front())),
+                                        xbridge::xBridgeStringValueFromAmount(bidSize),
+                                        static_cast<int64_t>(level.orders.size())});
             }
 
-            bound = std::min<int32_t>(maxOrders, asksVector.size());
-            const auto asks_len = static_cast<int32_t>(asksVector.size());
-            for (int32_t i = asks_len - bound; i < asks_len; ++i) // Best asks are at the back of the stack (sorted descending, lowest price better)
+            for (auto it = askLevels.rbegin(); it != askLevels.rend(); ++it) // Best asks last (descending, lowest price better)
             {
-                if(asksVector[i] == nullptr)
-                    continue;
-
-                Array ask;
-                //calculate asks and push to array
-                const auto askAmount    = asksVector[i]->fromAmount;
-                const auto askPrice     = xbridge::price(asksVector[i]);
-                auto askSize            = askAmount;
-                const auto asksCount    = std::count_if(asksList.begin(), asksList.end(),
-                                                     [askPrice, floatCompare](const TransactionPair &a)
-                {
-                    const auto &tr = a.second;
-
-                    if(tr == nullptr)
-                        return false;
-
-                    const auto price = xbridge::price(tr);
-
-                    return floatCompare(price, askPrice);
-                });
-
-                //array sorted by price, we can to skip the transactions with equals price
-                while((++i < bound) && floatCompare(xbridge::price(asksVector[i]), askPrice)){
-                    askSize += asksVector[i]->fromAmount;
-                }
-                ask.emplace_back(xbridge::xBridgeStringValueFromPrice(askPrice));
-                ask.emplace_back(xbridge::xBridgeStringValueFromAmount(askSize));
-                ask.emplace_back(static_cast<int64_t>(asksCount));
-                asks.emplace_back(ask);
+                uint64_t askSize = 0;
+                for (const auto & tr : it->orders)
+                    askSize += tr->fromAmount;
+                asks.emplace_back(Array{xbridge::xBridgeStringValueFromPrice(xbridge::price(it->orders.front())),
+                                        xbridge::xBridgeStringValueFromAmount(askSize),
+                                        static_cast<int64_t>(it->orders.size())});
             }
 
             res.emplace_back(Pair("asks", asks));
@@ -1375,38 +1429,30 @@ UniValue dxGetOrderBook(const JSONRPCRequest& request)
         case 3:
         {
             //Full order book (non aggregated)
-            auto bound = std::min<int32_t>(maxOrders, bidsVector.size());
-            for (size_t i = 0; i < bound; ++i) // Best bids are at the beginning of the stack (sorted descending, highest price better)
+            for (const auto & level : bidLevels) // Best bids first (descending, highest price better)
             {
-                if(bidsVector[i] == nullptr)
-                    continue;
-
-                Array bid;
-                const auto bidAmount   = bidsVector[i]->toAmount;
-                const auto bidPrice    = xbridge::priceBid(bidsVector[i]);
-                bid.emplace_back(xbridge::xBridgeStringValueFromPrice(bidPrice));
-                bid.emplace_back(xbridge::xBridgeStringValueFromAmount(bidAmount));
-                bid.emplace_back(bidsVector[i]->id.GetHex());
-
-                bids.emplace_back(bid);
+                for (const auto & tr : level.orders)
+                {
+                    if (bids.size() >= maxOrders)
+                        break;
+                    bids.emplace_back(Array{xbridge::xBridgeStringValueFromPrice(xbridge::priceBid(tr)),
+                                            xbridge::xBridgeStringValueFromAmount(tr->toAmount),
+                                            tr->id.GetHex()});
+                }
             }
 
-            bound = std::min<int32_t>(maxOrders, asksVector.size());
-            const auto asks_len = static_cast<int32_t>(asksVector.size());
-            for (int32_t i = asks_len - bound; i < asks_len; ++i) // Best asks are at the back of the stack (sorted descending, lowest price better)
+            for (const auto & level : askLevels) // Best asks last (descending, lowest price better)
             {
-                if(asksVector[i] == nullptr)
-                    continue;
-
-                Array ask;
-                const auto bidAmount    = asksVector[i]->fromAmount;
-                const auto askPrice     = xbridge::price(asksVector[i]);
-                ask.emplace_back(xbridge::xBridgeStringValueFromPrice(askPrice));
-                ask.emplace_back(xbridge::xBridgeStringValueFromAmount(bidAmount));
-                ask.emplace_back(asksVector[i]->id.GetHex());
-
-                asks.emplace_back(ask);
+                for (const auto & tr : level.orders)
+                {
+                    if (asks.size() >= maxOrders)
+                        break;
+                    asks.emplace_back(Array{xbridge::xBridgeStringValueFromPrice(xbridge::price(tr)),
+                                            xbridge::xBridgeStringValueFromAmount(tr->fromAmount),
+                                            tr->id.GetHex()});
+                }
             }
+            std::reverse(asks.begin(), asks.end());
 
             res.emplace_back(Pair("asks", asks));
             res.emplace_back(Pair("bids", bids));
@@ -1415,107 +1461,28 @@ UniValue dxGetOrderBook(const JSONRPCRequest& request)
         case 4:
         {
             //return Only the best bid and ask
-            if (!bidsList.empty()) {
-                const auto bidsItem = std::max_element(bidsList.begin(), bidsList.end(),
-                                           [](const TransactionPair &a, const TransactionPair &b)
-                {
-                    //find transaction with best bids
-                    const auto &tr1 = a.second;
-                    const auto &tr2 = b.second;
-
-                    if(tr1 == nullptr)
-                        return true;
-
-                    if(tr2 == nullptr)
-                        return false;
-
-                    const auto priceA = xbridge::priceBid(tr1);
-                    const auto priceB = xbridge::priceBid(tr2);
-
-                    return priceA < priceB;
-                });
-
-                const auto &tr = bidsItem->second;
-                if (tr != nullptr)
-                {
-                    const auto bidPrice = xbridge::priceBid(tr);
-                    bids.emplace_back(xbridge::xBridgeStringValueFromPrice(bidPrice));
-                    bids.emplace_back(xbridge::xBridgeStringValueFromAmount(tr->toAmount));
-
-                    Array bidsIds;
-                    bidsIds.emplace_back(tr->id.GetHex());
-
-                    for(const TransactionPair &tp : bidsList)
-                    {
-                        const auto &otherTr = tp.second;
-
-                        if(otherTr == nullptr)
-                            continue;
-
-                        if(tr->id == otherTr->id)
-                            continue;
-
-                        const auto otherTrBidPrice = xbridge::priceBid(otherTr);
-
-                        if(!floatCompare(bidPrice, otherTrBidPrice))
-                            continue;
-
-                        bidsIds.emplace_back(otherTr->id.GetHex());
-                    }
-
-                    bids.emplace_back(bidsIds);
-                }
+            if (!bidLevels.empty()) {
+                const auto & level = bidLevels.front();
+                const auto & tr = level.orders.front();
+                bids.emplace_back(xbridge::xBridgeStringValueFromPrice(xbridge::priceBid(tr)));
+                bids.emplace_back(xbridge::xBridgeStringValueFromAmount(tr->toAmount));
+
+                Array bidsIds;
+                for (const auto & order : level.orders)
+                    bidsIds.emplace_back(order->id.GetHex());
+                bids.emplace_back(bidsIds);
             }
 
-            if (!asksList.empty()) {
-                const auto asksItem = std::min_element(asksList.begin(), asksList.end(),
-                                                   [](const TransactionPair &a, const TransactionPair &b)
-                {
-                    //find transactions with best asks
-                    const auto &tr1 = a.second;
-                    const auto &tr2 = b.second;
-
-                    if(tr1 == nullptr)
-                        return true;
-
-                    if(tr2 == nullptr)
-                        return false;
-
-                    const auto priceA = xbridge::price(tr1);
-                    const auto priceB = xbridge::price(tr2);
-                    return priceA < priceB;
-                });
-
-                const auto &tr = asksItem->second;
-                if (tr != nullptr)
-                {
-                    const auto askPrice = xbridge::price(tr);
-                    asks.emplace_back(xbridge::xBridgeStringValueFromPrice(askPrice));
-                    asks.emplace_back(xbridge::xBridgeStringValueFromAmount(tr->fromAmount));
-
-                    Array asksIds;
-                    asksIds.emplace_back(tr->id.GetHex());
-
-                    for(const TransactionPair &tp : asksList)
-                    {
-                        const auto &otherTr = tp.second;
+            if (!askLevels.empty()) {
+                const auto & level = askLevels.front();
+                const auto & tr = level.orders.front();
+                asks.emplace_back(xbridge::xBridgeStringValueFromPrice(xbridge::price(tr)));
+                asks.emplace_back(xbridge::xBridgeStringValueFromAmount(tr->fromAmount));
 
-                        if(otherTr == nullptr)
-                            continue;
-
-                        if(tr->id == otherTr->id)
-                            continue;
-
-                        const auto otherTrAskPrice = xbridge::price(otherTr);
-
-                        if(!floatCompare(askPrice, otherTrAskPrice))
-                            continue;
-
-                        asksIds.emplace_back(otherTr->id.GetHex());
-                    }
-
-                    asks.emplace_back(asksIds);
-                }
+                Array asksIds;
+                for (const auto & order : level.orders)
+                    asksIds.emplace_back(order->id.GetHex());
+                asks.emplace_back(asksIds);
             }
 
             res.emplace_back(Pair("asks", asks));
@@ -1563,28 +1530,23 @@ UniValue dxGetMyOrders(const JSONRPCRequest& request)
     Array r;
     TransactionVector orders;
 
-    TransactionMap trList = xbridge::App::instance().transactions();
+    const auto trList = xbridge::App::instance().transactions();
 
     // Filter local orders
-    for (auto i : trList) {
+    for (const auto & i : *trList) {
         const xbridge::TransactionDescrPtr &t = i.second;
         if(!t->isLocal())
             continue;
         orders.push_back(t);
     }
 
-    // Add historical orders
-    TransactionMap history = xbridge::App::instance().history();
-
-    // Filter local orders only
-    for (auto &item : history) {
-        const xbridge::TransactionDescrPtr &ptr = item.second;
-        if (ptr->isLocal() &&
-                (ptr->state == xbridge::TransactionDescr::trFinished ||
-                 ptr->state == xbridge::TransactionDescr::trCancelled)) {
-            orders.push_back(ptr);
-        }
-    }
+    // Add historical local orders
+    xbridge::OrderHistoryQuery query;
+    query.localOnly = true;
+    query.states.insert(xbridge::TransactionDescr::trFinished);
+    query.states.insert(xbridge::TransactionDescr::trCancelled);
+    const TransactionVector history = xapp.historyOrders(query);
+    orders.insert(orders.end(), history.begin(), history.end());
 
     // Return if no records
     if (orders.empty())
@@ -1817,54 +1779,72 @@ UniValue gettradingdata(const JSONRPCRequest& request)
         showErrors = params[1].get_bool();
     }
 
-    LOCK(cs_main);
-
     Array records;
+    auto addRecord = [&records,showErrors](const int64_t timestamp, const std::string & txid,
+                                           const std::string & snode_pubkey, const CurrencyPair & p) {
+        switch(p.tag) {
+        case CurrencyPair::Tag::Error:
+            // Show errors
+            if (showErrors)
+                records.emplace_back(Object{
+                    Pair{"timestamp",  timestamp},
+                    Pair{"txid",       txid},
+                    Pair{"xid",        p.error()}
+                });
+            break;
+        case CurrencyPair::Tag::Valid:
+            records.emplace_back(Object{
+                        Pair{"timestamp",  timestamp},
+                        Pair{"txid",       txid},
+                        Pair{"to",         snode_pubkey},
+                        Pair{"xid",        p.xid()},
+                        Pair{"from",       p.from.currency().to_string()},
+                        Pair{"fromAmount", p.from.amount<double>()},
+                        Pair{"to",         p.to.currency().to_string()},
+                        Pair{"toAmount",   p.to.amount<double>()},
+                        });
+            break;
+        case CurrencyPair::Tag::Empty:
+        default:
+            break;
+        }
+    };
+
+    // Use the trade index if available, it doesn't read blocks or lock cs_main
+    const CBlockIndex * tradeTip = g_tradeindex && g_tradeindex->IsSynced() ? g_tradeindex->BestBlockIndex() : nullptr;
+    std::vector<TradeRecord> trades;
+    if (tradeTip) {
+        const int64_t timeBegin = tradeTip->GetBlockTime();
+        const int64_t heightBegin = std::max<int64_t>(1, static_cast<int64_t>(tradeTip->nHeight) - countOfBlocks + 1);
+        if (g_tradeindex->FindTradesByHeight(static_cast<int>(heightBegin), trades)) {
+            for (const auto & trade : trades) {
+                if (trade.time <= timeBegin-30*24*60*60)
+                    break;
+                addRecord(trade.time, trade.txid.GetHex(), trade.snode, TradeRecordToCurrencyPair(trade));
+            }
+            return uret(records);
+        }
+    }
+
+    LOCK(cs_main);
 
     CBlockIndex * pindex = chainActive.Tip();
     int64_t timeBegin = chainActive.Tip()->GetBlockTime();
     for (; pindex->pprev && pindex->GetBlockTime() > (timeBegin-30*24*60*60) && countOfBlocks > 0;
              pindex = pindex->pprev, --countOfBlocks)
     {
-        CBlock block;
-        if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus()))
+        const std::shared_ptr<const CBlock> pblock = ReadBlockFromDiskCached(pindex, Params().GetConsensus());
+        if (!pblock)
         {
             // throw
             continue;
         }
-        const auto timestamp = block.GetBlockTime();
-        for (const CTransactionRef & tx : block.vtx)
+        const auto timestamp = pblock->GetBlockTime();
+        for (const CTransactionRef & tx : pblock->vtx)
         {
-            const auto txid = tx->GetHash().GetHex();
             std::string snode_pubkey{};
-
             const CurrencyPair p = TxOutToCurrencyPair(tx->vout, snode_pubkey);
-            switch(p.tag) {
-            case CurrencyPair::Tag::Error:
-                // Show errors
-                if (showErrors)
-                    records.emplace_back(Object{
-                        Pair{"timestamp",  timestamp},
-                        Pair{"txid",       txid},
-                        Pair{"xid",        p.error()}
-                    });
-                break;
-            case CurrencyPair::Tag::Valid:
-                records.emplace_back(Object{
-                            Pair{"timestamp",  timestamp},
-                            Pair{"txid",       txid},
-                            Pair{"to",         snode_pubkey},
-                            Pair{"xid",        p.xid()},
-                            Pair{"from",       p.from.currency().to_string()},
-                            Pair{"fromAmount", p.from.amount<double>()},
-                            Pair{"to",         p.to.currency().to_string()},
-                            Pair{"toAmount",   p.to.amount<double>()},
-                            });
-                break;
-            case CurrencyPair::Tag::Empty:
-            default:
-                break;
-            }
+            addRecord(timestamp, tx->GetHash().GetHex(), snode_pubkey, p);
         }
     }
 
@@ -1883,8 +1863,10 @@ static const CRPCCommand commands[] =
     { "xbridge",            "dxGetNewTokenAddress",    &dxGetNewTokenAddress,    {} },
     { "xbridge",            "dxGetNetworkTokens",      &dxGetNetworkTokens,      {} },
     { "xbridge",            "dxMakeOrder",             &dxMakeOrder,             {} },
+    { "xbridge",            "dxMakeOrders",            &dxMakeOrders,            {} },
     { "xbridge",            "dxTakeOrder",             &dxTakeOrder,             {} },
     { "xbridge",            "dxCancelOrder",           &dxCancelOrder,           {} },
+    { "xbridge",            "dxCancelOrders",          &dxCancelOrders,          {} },
     { "xbridge",            "dxGetOrderHistory",       &dxGetOrderHistory,       {} },
     { "xbridge",            "dxGetOrderBook",          &dxGetOrderBook,          {} },
     { "xbridge",            "dxGetTokenBalances",      &dxGetTokenBalances,      {} },
@@ -7,6 +7,7 @@
 
 #include <xbridge/util/logger.h>
 
+#include <xbridge/util/logwriter.h>
 #include <xbridge/util/settings.h>
 #include <xbridge/xuiconnector.h>
 
@@ -36,8 +37,8 @@ LOG::LOG(const char reason)
     , m_r(reason)
 {
     *this << "\n" << "[" << (char)std::toupper(m_r) << "] "
-          << boost::posix_time::second_clock::local_time()
-          << " [0x" << boost::this_thread::get_id() << "] ";
+          << LogWriter::timestamp()
+          << " [0x" << LogWriter::threadId() << "] ";
 }
 
 //******************************************************************************
@@ -52,39 +53,35 @@ std::string LOG::logFileName()
 //******************************************************************************
 LOG::~LOG()
 {
-    boost::lock_guard<boost::mutex> lock(logLocker);
-
-    // const static std::string path     = settings().logPath().size() ? settings().logPath() : settings().appPath();
-    const static bool logToFile       = true; // !path.empty();
-    static boost::gregorian::date day =
-            boost::gregorian::day_clock::local_day();
-    if (m_logFileName.empty())
-    {
-        m_logFileName    = makeFileName();
-    }
-
-    // std::cout << str().c_str();
-
+    std::string fileName;
     try
     {
-        if (logToFile)
+        boost::lock_guard<boost::mutex> lock(logLocker);
+
+        static boost::gregorian::date day =
+                boost::gregorian::day_clock::local_day();
+        if (m_logFileName.empty())
         {
-            boost::gregorian::date tmpday =
-                    boost::gregorian::day_clock::local_day();
+            m_logFileName    = makeFileName();
+        }
 
-            if (day != tmpday)
-            {
-                m_logFileName = makeFileName();
-                day = tmpday;
-            }
+        boost::gregorian::date tmpday =
+                boost::gregorian::day_clock::local_day();
 
-            std::ofstream file(m_logFileName.c_str(), std::ios_base::app);
-            file << str().c_str();
+        if (day != tmpday)
+        {
+            m_logFileName = makeFileName();
+            day = tmpday;
         }
+        fileName = m_logFileName;
     }
     catch (std::exception &)
     {
+        return;
     }
+
+    const auto & text = str();
+    LogWriter::instance().write(fileName, std::string(text.data(), text.size()), m_r == 'E');
 }
 
 //******************************************************************************
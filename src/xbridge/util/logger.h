@@ -8,17 +8,26 @@
 #ifndef BLOCKNET_XBRIDGE_LOGGER_H
 #define BLOCKNET_XBRIDGE_LOGGER_H
 
+#include <logging.h>
+
 #include <sstream>
 
 #include <boost/pool/pool_alloc.hpp>
 
 #define WARN()  LOG('W')
 #define ERR()   LOG('E')
-#define TRACE() LOG('T')
 
-#define DEBUG_TRACE() (TRACE() << __FUNCTION__)
-#define DEBUG_TRACE_LOG(str) (TRACE() << str << " " << __FUNCTION__)
-#define DEBUG_TRACE_TODO() (TRACE() << "TODO " << __FUNCTION__)
+// Trace messages are logged with -debug=xbridge, and compiled out with XBRIDGE_NO_TRACE_LOG.
+// Disabled messages aren't formatted.
+#ifdef XBRIDGE_NO_TRACE_LOG
+#define TRACE() if (true) {} else LOG('T')
+#else
+#define TRACE() if (!LogAcceptCategory(BCLog::XBRIDGE)) {} else LOG('T')
+#endif
+
+#define DEBUG_TRACE() TRACE() << __FUNCTION__
+#define DEBUG_TRACE_LOG(str) TRACE() << str << " " << __FUNCTION__
+#define DEBUG_TRACE_TODO() TRACE() << "TODO " << __FUNCTION__
 // #define DEBUG_TRACE()
 // #define DEBUG_TRACE_TODO()
 
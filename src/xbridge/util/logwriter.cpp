@@ -0,0 +1,206 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+//******************************************************************************
+//******************************************************************************
+
+#include <xbridge/util/logwriter.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <sstream>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/thread/thread.hpp>
+
+namespace
+{
+const size_t   MAX_QUEUE_BYTES = 16 * 1024 * 1024;  // messages waiting for the writer
+const uint64_t MAX_FILE_SIZE   = 256 * 1024 * 1024; // log file size that triggers rotation
+const int64_t  FILE_IDLE       = 600;               // seconds an unused file is kept open
+const auto     FLUSH_INTERVAL  = std::chrono::seconds(1);
+
+void stopAtExit()
+{
+    LogWriter::instance().stop();
+}
+}
+
+//******************************************************************************
+//******************************************************************************
+// static
+LogWriter & LogWriter::instance()
+{
+    // Never destroyed so that logging from static destructors is safe
+    static LogWriter * writer = []() {
+        auto w = new LogWriter;
+        std::atexit(stopAtExit);
+        return w;
+    }();
+    return *writer;
+}
+
+//******************************************************************************
+//******************************************************************************
+LogWriter::LogWriter()
+    : m_thread(&LogWriter::run, this)
+{
+}
+
+//******************************************************************************
+//******************************************************************************
+void LogWriter::write(const std::string & fileName, std::string message, const bool urgent)
+{
+    bool stopped;
+    {
+        std::lock_guard<std::mutex> l(m_lock);
+        stopped = m_stopped;
+        if (!stopped && m_queueBytes + message.size() > MAX_QUEUE_BYTES)
+        {
+            ++m_dropped;
+            return;
+        }
+        m_queueBytes += message.size();
+        m_queue.push_back(Message{fileName, std::move(message)});
+        if (urgent)
+            m_urgent = true;
+    }
+
+    if (stopped)
+        writeQueued(); // no writer thread after shutdown
+    else if (urgent)
+        m_cond.notify_one();
+}
+
+//******************************************************************************
+//******************************************************************************
+void LogWriter::flush()
+{
+    writeQueued();
+}
+
+//******************************************************************************
+//******************************************************************************
+void LogWriter::stop()
+{
+    {
+        std::lock_guard<std::mutex> l(m_lock);
+        if (m_stopped)
+            return;
+        m_stopped = true;
+    }
+    m_cond.notify_one();
+    if (m_thread.joinable())
+        m_thread.join();
+    writeQueued();
+}
+
+//******************************************************************************
+//******************************************************************************
+void LogWriter::run()
+{
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> l(m_lock);
+            m_cond.wait_for(l, FLUSH_INTERVAL, [this]() { return m_urgent || m_stopped; });
+            m_urgent = false;
+            if (m_stopped)
+                return;
+        }
+        writeQueued();
+    }
+}
+
+//******************************************************************************
+//******************************************************************************
+void LogWriter::writeQueued()
+{
+    std::lock_guard<std::mutex> fl(m_filesLock);
+
+    std::vector<Message> messages;
+    uint64_t dropped{0};
+    {
+        std::lock_guard<std::mutex> l(m_lock);
+        messages.swap(m_queue);
+        m_queueBytes = 0;
+        std::swap(dropped, m_dropped);
+    }
+    if (dropped > 0 && !messages.empty())
+        messages.back().text += "\n[W] log buffer full, " + std::to_string(dropped) + " messages dropped";
+
+    const int64_t now = std::time(nullptr);
+    for (Message & m : messages)
+    {
+        try
+        {
+            File & f = m_files[m.fileName];
+            if (f.stream.is_open() && f.size + m.text.size() > MAX_FILE_SIZE)
+            {
+                f.stream.close();
+                const std::string rotated = m.fileName + ".1";
+                std::remove(rotated.c_str());
+                std::rename(m.fileName.c_str(), rotated.c_str());
+            }
+            if (!f.stream.is_open())
+            {
+                f.stream.open(m.fileName.c_str(), std::ios_base::app);
+                boost::system::error_code ec;
+                const auto size = boost::filesystem::file_size(m.fileName, ec);
+                f.size = ec ? 0 : size;
+            }
+            f.stream.write(m.text.data(), m.text.size());
+            f.size += m.text.size();
+            f.lastUsed = now;
+        }
+        catch (std::exception &)
+        {
+        }
+    }
+
+    for (auto it = m_files.begin(); it != m_files.end(); )
+    {
+        if (it->second.lastUsed + FILE_IDLE < now) // e.g. the file of the previous day
+        {
+            it = m_files.erase(it);
+            continue;
+        }
+        it->second.stream.flush();
+        ++it;
+    }
+}
+
+//******************************************************************************
+//******************************************************************************
+// static
+const std::string & LogWriter::timestamp()
+{
+    thread_local std::time_t second{0};
+    thread_local std::string formatted;
+    const std::time_t now = std::time(nullptr);
+    if (now != second)
+    {
+        std::ostringstream ss;
+        ss << boost::posix_time::second_clock::local_time();
+        formatted = ss.str();
+        second = now;
+    }
+    return formatted;
+}
+
+//******************************************************************************
+//******************************************************************************
+// static
+const std::string & LogWriter::threadId()
+{
+    thread_local const std::string id = []() {
+        std::ostringstream ss;
+        ss << boost::this_thread::get_id();
+        return ss.str();
+    }();
+    return id;
+}
@@ -0,0 +1,98 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+//******************************************************************************
+//******************************************************************************
+
+#ifndef BLOCKNET_XBRIDGE_LOGWRITER_H
+#define BLOCKNET_XBRIDGE_LOGWRITER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//******************************************************************************
+//******************************************************************************
+/**
+ * @brief LogWriter - background writer of the XBridge and XRouter log files (LOG, TXLOG).
+ * Log statements only append to a buffer, a thread writes the buffer once a second, or
+ * right away when an error is logged, to files that are kept open. Files that grow past
+ * the maximum size are rotated to <file>.1, and if the buffer is full new messages are
+ * dropped and counted.
+ */
+class LogWriter
+{
+public:
+    static LogWriter & instance();
+
+    /**
+     * @brief write - queue the message
+     * @param fileName - log file
+     * @param message
+     * @param urgent - wake the writer instead of waiting for the next flush
+     */
+    void write(const std::string & fileName, std::string message, const bool urgent = false);
+
+    /**
+     * @brief flush - write the queued messages, returns once they're written
+     */
+    void flush();
+
+    /**
+     * @brief stop - flush and stop the writer thread, later messages are written
+     * by the caller
+     */
+    void stop();
+
+    /**
+     * @brief timestamp - local time formatted like boost::posix_time ("2019-Jun-01 12:00:00"),
+     * formatted once a second per thread
+     */
+    static const std::string & timestamp();
+
+    /**
+     * @brief threadId - id of the calling thread, formatted once per thread
+     */
+    static const std::string & threadId();
+
+private:
+    LogWriter();
+
+    void run();
+    void writeQueued();
+
+    struct Message
+    {
+        std::string fileName;
+        std::string text;
+    };
+
+    struct File
+    {
+        std::ofstream stream;
+        uint64_t      size{0};
+        int64_t       lastUsed{0};
+    };
+
+private:
+    std::mutex                   m_lock;
+    std::condition_variable      m_cond;
+    std::vector<Message>         m_queue;
+    size_t                       m_queueBytes{0};
+    uint64_t                     m_dropped{0};
+    bool                         m_urgent{false};
+    bool                         m_stopped{false};
+
+    std::mutex                   m_filesLock; // held while writing
+    std::map<std::string, File>  m_files;
+
+    std::thread                  m_thread;
+};
+
+#endif // BLOCKNET_XBRIDGE_LOGWRITER_H
@@ -35,6 +35,9 @@ public:
 public:
     bool isFullLog()
         { return get<bool>("Main.FullLog", false); }
+    // Format of the transaction log, "text" or "json" (one json object per line)
+    std::string txLogFormat()
+        { return get<std::string>("Main.TxLogFormat", "text"); }
 
     bool isExchangeEnabled() const { return m_isExchangeEnabled; }
     std::string appPath() const    { return m_appPath; }
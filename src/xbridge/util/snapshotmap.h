@@ -0,0 +1,72 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+//*****************************************************************************
+//*****************************************************************************
+
+#ifndef BLOCKNET_XBRIDGE_UTIL_SNAPSHOTMAP_H
+#define BLOCKNET_XBRIDGE_UTIL_SNAPSHOTMAP_H
+
+#include <atomic>
+#include <map>
+#include <memory>
+
+//******************************************************************************
+//******************************************************************************
+namespace xbridge
+{
+
+//******************************************************************************
+//******************************************************************************
+/**
+ * @brief SnapshotMap - std::map with copy-on-write snapshots. snapshot() shares the
+ * current map with the reader, a write copies the map only while a snapshot of it
+ * is still in use. Not thread safe, the owner guards all calls with its lock, the
+ * returned snapshots can be read without the lock.
+ */
+template <typename K, typename V>
+class SnapshotMap
+{
+public:
+    typedef std::map<K, V> Map;
+    typedef std::shared_ptr<const Map> Snapshot;
+
+public:
+    SnapshotMap() : m_map(std::make_shared<Map>()) {}
+
+    /**
+     * @brief snapshot - immutable view of the map at the time of the call
+     */
+    Snapshot snapshot() const { return m_map; }
+
+    bool empty() const { return m_map->empty(); }
+    size_t size() const { return m_map->size(); }
+    size_t count(const K & key) const { return m_map->count(key); }
+    const V & at(const K & key) const { return m_map->at(key); }
+    typename Map::const_iterator begin() const { return m_map->cbegin(); }
+    typename Map::const_iterator end() const { return m_map->cend(); }
+
+    void set(const K & key, const V & value) { modify()[key] = value; }
+    size_t erase(const K & key) { return m_map->count(key) ? modify().erase(key) : 0; }
+    void clear() { m_map = std::make_shared<Map>(); }
+
+    /**
+     * @brief modify - the map for writing, copied first if a snapshot shares it
+     */
+    Map & modify()
+    {
+        if (m_map.use_count() > 1)
+            m_map = std::make_shared<Map>(*m_map);
+        // readers of released snapshots are done with the map
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return *m_map;
+    }
+
+private:
+    std::shared_ptr<Map> m_map;
+};
+
+} // namespace xbridge
+
+#endif // BLOCKNET_XBRIDGE_UTIL_SNAPSHOTMAP_H
@@ -0,0 +1,220 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+//*****************************************************************************
+//*****************************************************************************
+
+#ifndef BLOCKNET_XBRIDGE_UTIL_TIMINGWHEEL_H
+#define BLOCKNET_XBRIDGE_UTIL_TIMINGWHEEL_H
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+//******************************************************************************
+//******************************************************************************
+namespace xbridge
+{
+
+//******************************************************************************
+//******************************************************************************
+/**
+ * @brief TimingWheel - hierarchical timing wheel of deadlines by key. Level 0 has a
+ * slot per tick, each level above a slot per 64 slots of the level below, deadlines
+ * further out than the top level wait in an overflow list. Keys move down a level
+ * when the wheel reaches their slot, so advancing costs the number of expired keys
+ * plus a constant per tick instead of a scan of all keys.
+ * A tick is whatever the owner counts in, seconds for ttls or block heights.
+ * Not thread safe, the owner guards all calls with its lock.
+ */
+template <typename K, typename Hasher = std::hash<K>>
+class TimingWheel
+{
+public:
+    TimingWheel() : m_slots(LEVELS, std::vector<Slot>(SLOTS)) {}
+
+    /**
+     * @brief schedule - sets the deadline of the key, replaces an earlier one
+     * @param key
+     * @param when first tick the key is expired at
+     */
+    void schedule(const K & key, const int64_t when)
+    {
+        if (m_deadlines.empty() && when > m_cursor)
+            m_cursor = when - 1; // nothing scheduled, no ticks to walk through
+        m_deadlines[key] = when;
+        insert(key, when);
+    }
+
+    /**
+     * @brief cancel - forgets the key, its stale slot entry is skipped
+     * @param key
+     * @return false if the key wasn't scheduled
+     */
+    bool cancel(const K & key)
+    {
+        return m_deadlines.erase(key) > 0;
+    }
+
+    /**
+     * @brief has
+     * @param key
+     * @return true if the key is scheduled
+     */
+    bool has(const K & key) const
+    {
+        return m_deadlines.count(key) > 0;
+    }
+
+    size_t size() const
+    {
+        return m_deadlines.size();
+    }
+
+    /**
+     * @brief advance - moves the wheel to the tick and unschedules the expired keys
+     * @param now
+     * @return keys with a deadline at or before now, in no particular order
+     */
+    std::vector<K> advance(const int64_t now)
+    {
+        std::vector<K> expired;
+        if (m_deadlines.empty())
+        {
+            m_cursor = std::max(m_cursor, now);
+            return expired;
+        }
+
+        // Long sleeps are cheaper to handle by sorting out every key once
+        if (now - m_cursor > static_cast<int64_t>(SLOTS * SLOTS))
+        {
+            for (auto & level : m_slots)
+                for (auto & slot : level)
+                    slot.clear();
+            m_overflow.clear();
+            m_cursor = now;
+            for (auto it = m_deadlines.begin(); it != m_deadlines.end(); )
+            {
+                if (it->second <= now)
+                {
+                    expired.push_back(it->first);
+                    it = m_deadlines.erase(it);
+                }
+                else
+                {
+                    insert(it->first, it->second);
+                    ++it;
+                }
+            }
+            return expired;
+        }
+
+        // Keys that were already due when scheduled
+        Slot due;
+        due.swap(m_due);
+        collect(due, now, expired);
+
+        while (m_cursor < now)
+        {
+            ++m_cursor;
+
+            // Keys of the block the cursor entered move down, the highest level first
+            if ((m_cursor & ((int64_t(1) << (BITS * LEVELS)) - 1)) == 0)
+            {
+                Slot overflow;
+                overflow.swap(m_overflow);
+                cascade(overflow);
+            }
+            for (int level = LEVELS - 1; level > 0; --level)
+            {
+                if ((m_cursor & ((int64_t(1) << (BITS * level)) - 1)) != 0)
+                    continue;
+                Slot slot;
+                slot.swap(m_slots[level][(m_cursor >> (BITS * level)) & MASK]);
+                cascade(slot);
+            }
+
+            // A key cascaded onto the cursor's tick lands in m_due
+            Slot slot;
+            slot.swap(m_slots[0][m_cursor & MASK]);
+            slot.insert(slot.end(), m_due.begin(), m_due.end());
+            m_due.clear();
+            collect(slot, m_cursor, expired);
+        }
+        return expired;
+    }
+
+private:
+    typedef std::vector<std::pair<K, int64_t>> Slot;
+
+    static const int BITS = 6;
+    static const int LEVELS = 4; // 2^24 ticks, 194 days of seconds
+    static const size_t SLOTS = size_t(1) << BITS;
+    static const int64_t MASK = SLOTS - 1;
+
+    void insert(const K & key, const int64_t when)
+    {
+        if (when <= m_cursor)
+        {
+            m_due.emplace_back(key, when);
+            return;
+        }
+        // The lowest level whose block of the cursor contains the deadline
+        for (int level = 0; level < LEVELS; ++level)
+        {
+            if ((when >> (BITS * (level + 1))) == (m_cursor >> (BITS * (level + 1))))
+            {
+                m_slots[level][(when >> (BITS * level)) & MASK].emplace_back(key, when);
+                return;
+            }
+        }
+        m_overflow.emplace_back(key, when);
+    }
+
+    void cascade(const Slot & slot)
+    {
+        for (const auto & entry : slot)
+        {
+            if (current(entry))
+                insert(entry.first, entry.second);
+        }
+    }
+
+    void collect(const Slot & slot, const int64_t now, std::vector<K> & expired)
+    {
+        for (const auto & entry : slot)
+        {
+            if (!current(entry))
+                continue;
+            if (entry.second > now)
+            {
+                insert(entry.first, entry.second);
+                continue;
+            }
+            m_deadlines.erase(entry.first);
+            expired.push_back(entry.first);
+        }
+    }
+
+    // false if the key was cancelled or rescheduled since the entry was added
+    bool current(const std::pair<K, int64_t> & entry) const
+    {
+        auto it = m_deadlines.find(entry.first);
+        return it != m_deadlines.end() && it->second == entry.second;
+    }
+
+private:
+    std::unordered_map<K, int64_t, Hasher> m_deadlines;
+    std::vector<std::vector<Slot>>         m_slots;
+    Slot                                   m_overflow;
+    Slot                                   m_due;
+    int64_t                                m_cursor{0}; // last tick expired
+};
+
+} // namespace xbridge
+
+#endif // BLOCKNET_XBRIDGE_UTIL_TIMINGWHEEL_H
@@ -5,10 +5,12 @@
 //******************************************************************************
 //******************************************************************************
 
+#include <xbridge/util/logwriter.h>
 #include <xbridge/util/settings.h>
 #include <xbridge/util/txlog.h>
 #include <xbridge/xuiconnector.h>
 
+#include <univalue.h>
 #include <util/system.h>
 
 #include <string>
@@ -31,10 +33,9 @@ std::string TXLOG::m_logFileName;
 TXLOG::TXLOG()
     : std::basic_stringstream<char, std::char_traits<char>,
                     boost::pool_allocator<char> >()
+    , m_time(LogWriter::timestamp())
+    , m_threadId(LogWriter::threadId())
 {
-    *this << "\n"
-          << boost::posix_time::second_clock::local_time()
-          << " [0x" << boost::this_thread::get_id() << "] ";
 }
 
 //******************************************************************************
@@ -49,45 +50,57 @@ std::string TXLOG::logFileName()
 //******************************************************************************
 TXLOG::~TXLOG()
 {
-    boost::mutex::scoped_lock l(txlogLocker);
-
-    // const static std::string path     = settings().logPath().size() ? settings().logPath() : settings().appPath();
-    const static bool logToFile       = true; // !path.empty();
-    static boost::gregorian::date day =
-            boost::gregorian::day_clock::local_day();
-    if (m_logFileName.empty())
+    std::string fileName;
+    bool json{false};
+    try
     {
-        m_logFileName    = makeFileName();
-    }
+        boost::mutex::scoped_lock l(txlogLocker);
 
-    // std::cout << str().c_str();
+        static const bool jsonFormat = settings().txLogFormat() == "json";
+        json = jsonFormat;
 
-    try
-    {
-        if (logToFile)
+        static boost::gregorian::date day =
+                boost::gregorian::day_clock::local_day();
+        if (m_logFileName.empty())
         {
-            boost::gregorian::date tmpday =
-                    boost::gregorian::day_clock::local_day();
+            m_logFileName    = makeFileName(json);
+        }
 
-            if (day != tmpday)
-            {
-                m_logFileName = makeFileName();
-                day = tmpday;
-            }
+        boost::gregorian::date tmpday =
+                boost::gregorian::day_clock::local_day();
 
-            std::ofstream file(m_logFileName.c_str(), std::ios_base::app);
-            file << str().c_str();
+        if (day != tmpday)
+        {
+            m_logFileName = makeFileName(json);
+            day = tmpday;
         }
+        fileName = m_logFileName;
     }
     catch (std::exception &)
     {
+        return;
     }
+
+    const auto & text = str();
+    if (json)
+    {
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("time", m_time);
+        entry.pushKV("thread", "0x" + m_threadId);
+        entry.pushKV("message", std::string(text.data(), text.size()));
+        LogWriter::instance().write(fileName, entry.write() + "\n");
+        return;
+    }
+
+    std::string entry = "\n" + m_time + " [0x" + m_threadId + "] ";
+    entry.append(text.data(), text.size());
+    LogWriter::instance().write(fileName, std::move(entry));
 }
 
 //******************************************************************************
 //******************************************************************************
 // static
-std::string TXLOG::makeFileName()
+std::string TXLOG::makeFileName(const bool json)
 {
     boost::filesystem::path directory = GetDataDir(false) / "log-tx";
     boost::filesystem::create_directory(directory);
@@ -98,5 +111,5 @@ std::string TXLOG::makeFileName()
     ss.imbue(std::locale(ss.getloc(), df));
     ss << lt.date();
     return directory.string() + "/" +
-            "xbridgep2p_" + ss.str() + ".log";
+            "xbridgep2p_" + ss.str() + (json ? ".json" : ".log");
 }
@@ -18,6 +18,12 @@
 
 //******************************************************************************
 //******************************************************************************
+/**
+ * @brief TXLOG - entry of the transaction log (log-tx/xbridgep2p_<date>.log), written
+ * by LogWriter. With Main.TxLogFormat=json in xbridge.conf the entries are written as one
+ * json object per line ({"time", "thread", "message"}) to xbridgep2p_<date>.json instead.
+ * The format is read once.
+ */
 class TXLOG : public std::basic_stringstream<char, std::char_traits<char>,
         boost::pool_allocator<char> > // std::stringstream
 {
@@ -28,9 +34,13 @@ public:
     static std::string logFileName();
 
 private:
-    static std::string makeFileName();
+    static std::string makeFileName(const bool json);
 
 private:
+    // Prefix of the entry, written by the destructor in the configured format
+    std::string m_time;
+    const std::string & m_threadId;
+
     static std::string m_logFileName;
 };
 
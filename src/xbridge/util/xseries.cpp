@@ -10,6 +10,8 @@
 
 #include <json/json_spirit_reader_template.h>
 
+#include <set>
+
 //******************************************************************************
 //******************************************************************************
 extern CurrencyPair TxOutToCurrencyPair(const std::vector<CTxOut> & vout, std::string& snode_pubkey); // declared in rpcxbridge.cpp
@@ -53,15 +55,56 @@ namespace {
             series.at(idx).update(tf == xQuery::Transform::Invert ? it->inverse() : *it, q.with_txids);
         }
     }
-    std::vector<CurrencyPair> get_tradingdata(boost::posix_time::time_period query)
+    int64_t epoch_seconds(const boost::posix_time::ptime& t) {
+        return (t - boost::posix_time::from_time_t(0)).total_seconds();
+    }
+    const CBlockIndex* get_tradeindex_tip() {
+        return g_tradeindex && g_tradeindex->IsSynced() ? g_tradeindex->BestBlockIndex() : nullptr;
+    }
+    std::string get_pair_symbol(const CurrencyPair& p) {
+        return p.to.currency().to_string() +"/"+ p.from.currency().to_string();
+    }
+    std::vector<CurrencyPair> get_block_tradingdata(const CBlock& block, const boost::posix_time::ptime& ts)
+    {
+        std::vector<CurrencyPair> records;
+        for (const CTransactionRef & tx : block.vtx)
+        {
+            std::string snode_pubkey{};
+            CurrencyPair p = TxOutToCurrencyPair(tx->vout, snode_pubkey);
+            if (p.tag == CurrencyPair::Tag::Valid) {
+                p.timeStamp = ts;
+                records.emplace_back(p);
+            }
+        }
+        return records;
+    }
+    /**
+     * Returns the trades in the period from the blocks in the chain ending at tip,
+     * ascending by time.
+     */
+    std::vector<CurrencyPair> get_tradingdata(const boost::posix_time::time_period& query, const CBlockIndex* tip)
     {
-        LOCK(cs_main);
-
         std::vector<CurrencyPair> records;
+        if (!tip)
+            return records;
+
+        // Use the trade index if it has the chain up to tip, it doesn't read blocks
+        const CBlockIndex* indexTip = get_tradeindex_tip();
+        if (indexTip && indexTip->GetAncestor(tip->nHeight) == tip) {
+            std::vector<TradeRecord> trades;
+            if (g_tradeindex->FindTradesByTime(epoch_seconds(query.begin()), epoch_seconds(query.end()), trades)) {
+                for (const auto& trade : trades) {
+                    if (trade.tag == TradeRecord::TRADE_VALID && trade.height > 0 && trade.height <= tip->nHeight)
+                        records.emplace_back(TradeRecordToCurrencyPair(trade));
+                }
+                return records;
+            }
+        }
 
-        CBlockIndex * pindex = chainActive.Tip();
+        // Block index entries are never deleted, walking the ancestors of tip doesn't need cs_main
+        const CBlockIndex * pindex = tip;
         auto ts = boost::posix_time::from_time_t(pindex->GetBlockTime());
-        while (pindex->pprev != nullptr && query.end() < ts) {
+        while (pindex->pprev != nullptr && query.end() <= ts) {
             pindex = pindex->pprev;
             ts = boost::posix_time::from_time_t(pindex->GetBlockTime());
         }
@@ -69,22 +112,25 @@ namespace {
         for (; pindex->pprev != nullptr && query.contains(ts);
              pindex = pindex->pprev, ts = boost::posix_time::from_time_t(pindex->GetBlockTime()))
         {
-            CBlock block;
-            if (not ReadBlockFromDisk(block, pindex, Params().GetConsensus()))
+            const auto pblock = ReadBlockFromDiskCached(pindex, Params().GetConsensus());
+            if (not pblock)
                 continue; // throw?
-            for (const CTransactionRef & tx : block.vtx)
-            {
-                std::string snode_pubkey{};
-                CurrencyPair p = TxOutToCurrencyPair(tx->vout, snode_pubkey);
-                if (p.tag == CurrencyPair::Tag::Valid) {
-                    p.timeStamp = ts;
-                    records.emplace_back(p);
-                }
-            }
+            const auto pairs = get_block_tradingdata(*pblock, ts);
+            records.insert(records.end(), pairs.begin(), pairs.end());
         }
+        std::stable_sort(records.begin(), records.end(), // ascending by updated time
+                         [](const CurrencyPair& a, const CurrencyPair& b) {
+                             return a.timeStamp < b.timeStamp; });
         return records;
     }
 
+    boost::posix_time::ptime get_start_time(const boost::posix_time::ptime& start_time, boost::posix_time::time_duration granularity) {
+        const int64_t psec = granularity.total_seconds();
+        const int64_t secs = epoch_seconds(start_time);
+        if (secs < 0 || psec < 1)
+            return boost::posix_time::from_time_t(0);
+        return boost::posix_time::from_time_t((secs / psec) * psec);
+    }
     boost::posix_time::ptime get_end_time(int64_t end_secs, boost::posix_time::time_duration cache_granularity) {
         const int64_t psec = cache_granularity.total_seconds();
         if (end_secs < 0 || psec < 1)
@@ -92,8 +138,45 @@ namespace {
         return boost::posix_time::from_time_t(((end_secs + psec - 1) / psec) * psec);
     }
     boost::posix_time::ptime get_end_time(boost::posix_time::ptime end_time, boost::posix_time::time_duration cache_granularity) {
-        auto epoch_duration = end_time - boost::posix_time::from_time_t(0);
-        return get_end_time(epoch_duration.total_seconds(), cache_granularity);
+        return get_end_time(epoch_seconds(end_time), cache_granularity);
+    }
+    /**
+     * Returns the timeEnd of the interval [timeEnd - granularity, timeEnd) containing ts.
+     */
+    boost::posix_time::ptime get_bucket_end(const boost::posix_time::ptime& ts, boost::posix_time::time_duration granularity) {
+        return get_end_time(epoch_seconds(ts) + 1, granularity);
+    }
+    xAggregate& get_bucket(xSeriesCache::xAggregateContainer& xac, const boost::posix_time::ptime& timeEnd,
+                           const ccy::Currency& from, const ccy::Currency& to)
+    {
+        auto it = std::lower_bound(xac.begin(), xac.end(), timeEnd,
+                                   [](const xAggregate& a, const boost::posix_time::ptime& b) {
+                                       return a.timeEnd < b; });
+        if (it == xac.end() || it->timeEnd != timeEnd) {
+            it = xac.insert(it, xAggregate{from, to});
+            it->timeEnd = timeEnd;
+        }
+        return *it;
+    }
+    void erase_bucket(xSeriesCache::xAggregateContainer& xac, const boost::posix_time::ptime& timeEnd)
+    {
+        auto it = std::lower_bound(xac.begin(), xac.end(), timeEnd,
+                                   [](const xAggregate& a, const boost::posix_time::ptime& b) {
+                                       return a.timeEnd < b; });
+        if (it != xac.end() && it->timeEnd == timeEnd)
+            xac.erase(it);
+    }
+}
+
+//******************************************************************************
+//******************************************************************************
+xSeriesCache::xSeriesCache()
+{
+    const int64_t base = m_cache_granularity.total_seconds();
+    m_levels.push_back(m_cache_granularity);
+    for (const int secs : rollup_seconds()) {
+        if (base > 0 && secs > base && secs % base == 0)
+            m_levels.emplace_back(boost::posix_time::seconds{secs});
     }
 }
 
@@ -119,14 +202,16 @@ xSeriesCache::getChainXAggregateSeries(const xQuery& query)
         series[i].timeEnd = t;
     }
 
-    if (not m_cache_period.contains(q.period))
+    LOCK(m_xSeriesCacheUpdateLock);
+    if (!m_cache_tip || not m_cache_period.contains(q.period))
         updateSeriesCache(q.period);
 
+    const size_t level = getLevel(q.granularity);
     updateXSeries(series, q.fromCurrency, q.toCurrency,
-                  q, xQuery::Transform::None);
+                  q, level, xQuery::Transform::None);
     if (q.with_inverse == xQuery::WithInverse::Included) {
         updateXSeries(series, q.toCurrency, q.fromCurrency,
-                      q, xQuery::Transform::Invert);
+                      q, level, xQuery::Transform::Invert);
     }
     return series;
 }
@@ -134,41 +219,177 @@ xSeriesCache::getChainXAggregateSeries(const xQuery& query)
 //******************************************************************************
 //******************************************************************************
 xSeriesCache::xAggregateContainer&
-xSeriesCache::getXAggregateContainer(const pairSymbol& key)
+xSeriesCache::getXAggregateContainer(const pairSymbol& key, size_t level)
 {
     auto f = mSparseSeries.find(key);
-    if (f == mSparseSeries.end()) {
-        mSparseSeries[key] = {};
-        f = mSparseSeries.find(key);
+    if (f == mSparseSeries.end())
+        f = mSparseSeries.emplace(key, std::vector<xAggregateContainer>(m_levels.size())).first;
+    return f->second.at(level);
+}
+
+//******************************************************************************
+//******************************************************************************
+size_t xSeriesCache::getLevel(const boost::posix_time::time_duration& granularity) const
+{
+    size_t level = 0;
+    for (size_t i = 0; i < m_levels.size(); ++i) {
+        if (granularity.total_seconds() % m_levels[i].total_seconds() == 0)
+            level = i;
+    }
+    return level;
+}
+
+//******************************************************************************
+//******************************************************************************
+void xSeriesCache::addTrades(const std::vector<CurrencyPair>& pairs)
+{
+    for (const auto& p : pairs) {
+        const pairSymbol key = get_pair_symbol(p);
+        for (size_t level = 0; level < m_levels.size(); ++level) {
+            auto& xac = getXAggregateContainer(key, level);
+            get_bucket(xac, get_bucket_end(p.timeStamp, m_levels[level]), p.from.currency(), p.to.currency())
+                .update(p, xQuery::WithTxids::Included);
+        }
     }
-    return f->second;
+}
+
+//******************************************************************************
+//******************************************************************************
+void xSeriesCache::rebuildBuckets(const std::vector<CurrencyPair>& removed, const boost::posix_time::ptime& ts)
+{
+    // Rebuild the finest interval from the chain, then roll it up into the larger ones
+    const auto end = get_bucket_end(ts, m_levels.front());
+    const std::vector<CurrencyPair> pairs = get_tradingdata({end - m_levels.front(), end}, m_cache_tip);
+
+    std::set<pairSymbol> keys;
+    for (const auto& p : removed)
+        keys.insert(get_pair_symbol(p));
+
+    for (const auto& key : keys) {
+        auto& finest = getXAggregateContainer(key, 0);
+        erase_bucket(finest, end);
+        for (const auto& p : pairs) {
+            if (get_pair_symbol(p) == key)
+                get_bucket(finest, end, p.from.currency(), p.to.currency()).update(p, xQuery::WithTxids::Included);
+        }
+        for (size_t level = 1; level < m_levels.size(); ++level) {
+            auto& xac = getXAggregateContainer(key, level);
+            auto& finer = getXAggregateContainer(key, level - 1);
+            const auto bucketEnd = get_bucket_end(ts, m_levels[level]);
+            erase_bucket(xac, bucketEnd);
+            const boost::posix_time::time_period bucket{bucketEnd - m_levels[level], bucketEnd};
+            for (const auto& x : getXAggregateRange(finer.begin(), finer.end(), bucket))
+                get_bucket(xac, bucketEnd, x.fromVolume.currency(), x.toVolume.currency())
+                    .update(x, xQuery::WithTxids::Included);
+        }
+    }
+}
+
+//******************************************************************************
+//******************************************************************************
+void xSeriesCache::clearCache()
+{
+    mSparseSeries.clear();
+    m_cache_period = boost::posix_time::time_period{boost::posix_time::ptime{},boost::posix_time::ptime{}};
+    m_cache_tip = nullptr;
 }
 
 //******************************************************************************
 //******************************************************************************
 void xSeriesCache::updateSeriesCache(const boost::posix_time::time_period& period)
 {
-    // TODO(amdn) cached aggregate series for blocks that are purged from the chain
-    // need to be invalidated... this code invalidates on every query to
-    // ensure results are up-to-date, cache can be enabled when invalidation
-    // hook is in place
     LOCK(m_xSeriesCacheUpdateLock);
-    std::vector<CurrencyPair> pairs = get_tradingdata(period);
-    std::sort(pairs.begin(), pairs.end(), // ascending by updated time
-              [](const CurrencyPair& a, const CurrencyPair& b) {
-                  return a.timeStamp < b.timeStamp; });
+    const CBlockIndex* tip{nullptr};
+    {
+        LOCK(cs_main);
+        tip = chainActive.Tip();
+    }
+    if (!tip)
+        return;
 
-    mSparseSeries.clear();
-    for (const auto& p : pairs) {
-        pairSymbol key = p.to.currency().to_string() +"/"+ p.from.currency().to_string();
-        auto& q = getXAggregateContainer(key);
-        if (q.empty() || q.back().timeEnd <= p.timeStamp) {
-            q.emplace_back(xAggregate{p.from.currency(), p.to.currency()});
-            q.back().timeEnd = get_end_time(p.timeStamp,m_cache_granularity);
-        }
-        q.back().update(p,xQuery::WithTxids::Included);
+    // Load whole intervals of the largest rollup, up to the tip so that connected
+    // blocks can be appended, and keep the period that is already cached
+    const auto& granularity = m_levels.back();
+    auto begin = get_start_time(period.begin(), granularity);
+    auto end = std::max(get_end_time(period.end(), granularity),
+                        get_bucket_end(boost::posix_time::from_time_t(tip->GetBlockTime()), granularity));
+    if (m_cache_tip) {
+        begin = std::min(begin, m_cache_period.begin());
+        end = std::max(end, m_cache_period.end());
+    }
+
+    const boost::posix_time::time_period cachePeriod{begin, end};
+    std::vector<CurrencyPair> pairs = get_tradingdata(cachePeriod, tip);
+
+    clearCache();
+    addTrades(pairs);
+    m_cache_period = cachePeriod;
+    m_cache_tip = tip;
+}
+
+//******************************************************************************
+//******************************************************************************
+void xSeriesCache::BlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex,
+                                  const std::vector<CTransactionRef>& txnConflicted)
+{
+    LOCK(m_xSeriesCacheUpdateLock);
+    if (!m_cache_tip)
+        return; // nothing cached yet
+    if (m_cache_tip->GetAncestor(pindex->nHeight) == pindex)
+        return; // connected before the cache was loaded
+    if (pindex->pprev != m_cache_tip) {
+        clearCache(); // missed blocks, reload on the next query
+        return;
     }
-    m_cache_period = period;
+
+    m_cache_tip = pindex;
+    const auto ts = boost::posix_time::from_time_t(pindex->GetBlockTime());
+    if (ts < m_cache_period.begin())
+        return;
+    addTrades(get_block_tradingdata(*block, ts));
+    if (ts >= m_cache_period.end())
+        m_cache_period = boost::posix_time::time_period{m_cache_period.begin(), get_bucket_end(ts, m_levels.back())};
+}
+
+//******************************************************************************
+//******************************************************************************
+void xSeriesCache::BlockDisconnected(const std::shared_ptr<const CBlock>& block)
+{
+    LOCK(m_xSeriesCacheUpdateLock);
+    if (!m_cache_tip)
+        return; // nothing cached yet
+    if (m_cache_tip->GetBlockHash() != block->GetHash()) {
+        clearCache(); // not the last block in the cache, reload on the next query
+        return;
+    }
+
+    const auto ts = boost::posix_time::from_time_t(m_cache_tip->GetBlockTime());
+    m_cache_tip = m_cache_tip->pprev;
+    if (!m_cache_tip) {
+        clearCache();
+        return;
+    }
+    if (not m_cache_period.contains(ts))
+        return;
+    const auto removed = get_block_tradingdata(*block, ts);
+    if (!removed.empty())
+        rebuildBuckets(removed, ts);
+}
+
+//******************************************************************************
+//******************************************************************************
+CurrencyPair TradeRecordToCurrencyPair(const TradeRecord& trade)
+{
+    if (trade.tag == TradeRecord::TRADE_ERROR)
+        return CurrencyPair{trade.xidOrError};
+    if (trade.tag != TradeRecord::TRADE_VALID)
+        return {};
+    return CurrencyPair{
+            trade.xidOrError,
+            {ccy::Currency{trade.fromCurrency, xbridge::TransactionDescr::COIN}, trade.fromAmount},
+            {ccy::Currency{trade.toCurrency, xbridge::TransactionDescr::COIN}, trade.toAmount},
+            boost::posix_time::from_time_t(trade.time)
+    };
 }
 
 //******************************************************************************
@@ -219,10 +440,11 @@ void xSeriesCache::updateXSeries(std::vector<xAggregate>& series,
                                  const ccy::Currency& from,
                                  const ccy::Currency& to,
                                  const xQuery& q,
+                                 size_t level,
                                  xQuery::Transform tf)
 {
     pairSymbol key = to.to_string() +"/"+ from.to_string();
-    auto& xac = getXAggregateContainer(key);
+    auto& xac = getXAggregateContainer(key, level);
     const auto& range = getXAggregateRange(xac.begin(), xac.end(), q.period);
     updateXSeriesHelper(series, range, q, tf);
 }
@@ -9,10 +9,13 @@
 #include <xbridge/xbridgetransactiondescr.h>
 
 #include <chainparams.h>
+#include <index/tradeindex.h>
 #include <key_io.h>
 #include <script/standard.h>
+#include <validationinterface.h>
 
 #include <algorithm>
+#include <array>
 #include <cstdint>
 #include <deque>
 #include <limits>
@@ -26,6 +29,11 @@
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/date_time/posix_time/ptime.hpp>
 
+/**
+ * @brief Returns the currency pair of a trade from the trade index
+ */
+CurrencyPair TradeRecordToCurrencyPair(const TradeRecord& trade);
+
 /**
  * @brief validate and hold parameters used by dxGetOrderHistory() and others
  */
@@ -190,8 +198,11 @@ public:
 
 /**
  * @brief Cache of open,high,low,close transaction aggregated series
+ *
+ * The cache is built on the first query and then kept up to date with the
+ * blocks connected to and disconnected from the chain.
  */
-class xSeriesCache
+class xSeriesCache : public CValidationInterface
 {
 private: // types
     using pairSymbol = std::string;
@@ -206,10 +217,14 @@ public:
         xAggregateIterator begin() const { return b; }
         xAggregateIterator end() const { return e; }
     };
-    xSeriesCache() = default;
+    xSeriesCache();
     std::vector<xAggregate> getChainXAggregateSeries(const xQuery&);
     std::vector<xAggregate> getXAggregateSeries(const xQuery&);
-    xAggregateContainer& getXAggregateContainer(const pairSymbol&);
+    xAggregateContainer& getXAggregateContainer(const pairSymbol&, size_t level);
+    /**
+     * Returns the aggregates with a timeEnd in (period.begin, period.end], i.e. the
+     * intervals [timeEnd - granularity, timeEnd) inside the period.
+     */
     template <class Iterator>
     xRange getXAggregateRange(const Iterator& begin,
                               const Iterator& end,
@@ -220,17 +235,36 @@ public:
                                         return a.timeEnd <= b; });
         auto up = std::upper_bound(low, end, period.end(),
                                    [](const boost::posix_time::ptime& period_end, const xAggregate& b) {
-                                       return period_end <= b.timeEnd; });
+                                       return period_end < b.timeEnd; });
         return {low, up};
     }
 
     void updateSeriesCache(const boost::posix_time::time_period&);
 
+protected:
+    // CValidationInterface
+    void BlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex,
+                        const std::vector<CTransactionRef>& txnConflicted) override;
+    void BlockDisconnected(const std::shared_ptr<const CBlock>& block) override;
+    std::string GetSubscriberName() const override { return "xseries"; }
+
 private:
+    /**
+     * Granularities precomputed on top of the cache granularity, a query uses the
+     * largest one its granularity is a multiple of.
+     */
+    static inline constexpr std::array<int,3> rollup_seconds() {
+        return {{ 15*60, 1*60*60, 24*60*60 }};
+    }
+    size_t getLevel(const boost::posix_time::time_duration& granularity) const;
+    void addTrades(const std::vector<CurrencyPair>& pairs);
+    void rebuildBuckets(const std::vector<CurrencyPair>& removed, const boost::posix_time::ptime& ts);
+    void clearCache();
     void updateXSeries(std::vector<xAggregate>& series,
                        const ccy::Currency& from,
                        const ccy::Currency& to,
                        const xQuery& q,
+                       size_t level,
                        xQuery::Transform tf);
 private:
     CCriticalSection m_xSeriesCacheUpdateLock;
@@ -243,8 +277,10 @@ private:
     boost::posix_time::time_duration m_cache_granularity{
         std::min(xQuery::min_granularity(), boost::posix_time::time_duration{boost::posix_time::seconds{
                      static_cast<long>(Params().GetConsensus().nPowTargetSpacing)}})};
+    std::vector<boost::posix_time::time_duration> m_levels; // m_cache_granularity followed by the rollups
     boost::posix_time::time_period m_cache_period{boost::posix_time::ptime{},boost::posix_time::ptime{}};
-    std::unordered_map<pairSymbol, xAggregateContainer> mSparseSeries;
+    const CBlockIndex* m_cache_tip{nullptr}; // last block in the cache, null if the cache is empty
+    std::unordered_map<pairSymbol, std::vector<xAggregateContainer>> mSparseSeries; // one container per level
 };
 
 #endif // BLOCKNET_XBRIDGE_UTIL_XSERIES_H
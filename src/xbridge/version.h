@@ -7,5 +7,9 @@
 
 #define XBRIDGE_PROTOCOL_VERSION 51
 
+// Features are announced by servicenodes in the xbridgefeatures field of their config,
+// clients only use the features of a servicenode it announced.
+#define XBRIDGE_FEATURE_ORDER_HEARTBEAT 0x1 // processes xbcOrderHeartbeat
+
 #endif // BLOCKNET_XBRIDGE_VERSION_H
 
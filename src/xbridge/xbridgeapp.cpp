@@ -9,34 +9,45 @@
 
 #include <xbridge/util/logger.h>
 #include <xbridge/util/settings.h>
+#include <xbridge/util/timingwheel.h>
 #include <xbridge/util/txlog.h>
 #include <xbridge/util/xassert.h>
 #include <xbridge/util/xbridgeerror.h>
 #include <xbridge/util/xseries.h>
 #include <xbridge/xbridgecryptoproviderbtc.h>
 #include <xbridge/xbridgeexchange.h>
+#include <xbridge/xbridgependingpackets.h>
 #include <xbridge/xbridgewalletconnector.h>
 #include <xbridge/xbridgewalletconnectorbtc.h>
 #include <xbridge/xbridgewalletconnectorbch.h>
 #include <xbridge/xbridgewalletconnectordgb.h>
+#include <xbridge/xbridgezmqfeed.h>
 #include <xbridge/xuiconnector.h>
 #include <xrouter/xrouterapp.h>
 
+#include <bloom.h>
 #include <init.h>
+#include <metrics.h>
 #include <net.h>
+#include <net_processing.h>
 #include <netmessagemaker.h>
 #include <rpc/server.h>
 #include <servicenode/servicenodemgr.h>
 #include <shutdown.h>
 #include <sync.h>
+#include <txmempool.h>
 #include <ui_interface.h>
+#include <util/memory.h>
 #include <version.h>
 
 #include <algorithm>
 #include <assert.h>
+#include <chrono>
+#include <future>
 #include <random>
 #include <regex>
 #include <string.h>
+#include <thread>
 
 #include <boost/algorithm/string/join.hpp>
 #include <boost/chrono/chrono.hpp>
@@ -76,7 +87,16 @@ class App::Impl
 
     enum
     {
-        TIMER_INTERVAL = 15
+        TIMER_INTERVAL = 15,
+        PENDING_PACKETS_MAX = 10000,
+        PENDING_PACKETS_TTL = 24 * 3600, // longer than the deposit locktimes, rollbacks wait for them
+        PENDING_RETRY_INTERVAL = 2 * TIMER_INTERVAL,
+        PENDING_MAX_RETRY_INTERVAL = 16 * TIMER_INTERVAL,
+        UTXO_CACHE_TTL = 5, // seconds the wallet's unspent list is reused for new orders
+        BAD_WALLET_RETRY_INTERVAL = 2 * TIMER_INTERVAL, // doubles on each failed check
+        BAD_WALLET_MAX_RETRY_INTERVAL = 40 * TIMER_INTERVAL,
+        HISTORY_MEMORY_TTL = 24 * 3600, // seconds historic orders stay in memory, older ones only in the store
+        ZMQ_FALLBACK_POLL_INTERVAL = 10 * TIMER_INTERVAL // seconds between deposit polls of wallets with a zmq feed
     };
 
 protected:
@@ -125,6 +145,21 @@ protected:
      */
     SessionPtr getSession(const std::vector<unsigned char> & address);
 
+    /**
+     * @brief dispatchPacket - process packets of an order on the thread and session the
+     * order id hashes to, so the packets of an order are handled in sequence on one thread
+     * and unrelated orders in parallel. Packets without an order id are processed inline.
+     * @param packet
+     * @param session - session to process with, the order's session if empty
+     */
+    void dispatchPacket(const XBridgePacketPtr & packet, SessionPtr session = SessionPtr());
+
+    /**
+     * @brief wakePendingPackets - process the deferred packets waiting on the dependency
+     * @param awaiting - dependency of the packets, e.g. the currency of a wallet
+     */
+    void wakePendingPackets(const std::string & awaiting);
+
 protected:
     /**
      * @brief sendPendingTransaction - check transaction data,
@@ -133,6 +168,13 @@ protected:
      * @return  true, if all date  correctly and packet has send to network
      */
     bool sendPendingTransaction(const TransactionDescrPtr & ptr);
+    /**
+     * @brief sendOrderHeartbeat - refresh the timestamps of pending orders on their
+     * servicenode with one packet, see xbcOrderHeartbeat
+     * @param orders - orders assigned to the same servicenode
+     * @return true, if packet has send to network
+     */
+    bool sendOrderHeartbeat(const std::vector<TransactionDescrPtr> & orders);
     /**
      * @brief sendAcceptingTransaction - check transaction date,
      * make new packet and - sent packet with cancelled command
@@ -174,17 +216,63 @@ protected:
      */
     void checkAndEraseExpiredTransactions();
 
+    /**
+     * @brief nextExpiryCheck - time the order's state may have to change at, the caller
+     * holds the order's lock
+     * @param tx
+     * @param now
+     * @return unix time in seconds
+     */
+    int64_t nextExpiryCheck(const TransactionDescrPtr & tx, const int64_t now) const;
+
+    /**
+     * @brief Writes the orders moved to history since the last call to the order history
+     *        store and drops the persisted orders older than HISTORY_MEMORY_TTL from memory.
+     */
+    void persistHistory();
+
     /**
      * @brief Check for deposits that were spent by the counterparty.
      */
     void checkWatchesOnDepositSpends();
 
+    /**
+     * @brief Looks for the spend of the order's deposit and redeems the deposits that can be
+     *        redeemed. Runs on the wallet reactor.
+     */
+    void checkDepositSpend(const TransactionDescrPtr & xtx);
+
     /**
      * @brief Servicenodes watch for trader deposit locktimes to expire and when they do automatically
      *        submits the refund transaction for those orders that haven't reported completing.
      */
     void watchTraderDeposits();
 
+    /**
+     * @brief Subscribes to the zmq feed of the currency's wallet if <currency>.ZmqAddress is set
+     *        in xbridge.conf, otherwise drops the feed.
+     * @param currency
+     */
+    void updateZmqFeed(const std::string & currency);
+
+    /**
+     * @brief Handles a zmq notification of the currency's wallet. A transaction spending a
+     *        watched deposit is recorded as the counterparty's pay tx, a new block or spend makes
+     *        the deposit watches of the currency check right away.
+     * @param currency
+     * @param topic rawtx or hashblock
+     * @param body
+     */
+    void onZmqNotification(const std::string & currency, const std::string & topic,
+                           const std::vector<unsigned char> & body);
+
+    /**
+     * @brief hasZmqFeed
+     * @param currency
+     * @return true if the deposit watches of the currency are driven by its zmq feed
+     */
+    bool hasZmqFeed(const std::string & currency);
+
 protected:
     // workers
     std::deque<IoServicePtr>                           m_services;
@@ -197,10 +285,16 @@ protected:
     boost::thread                                      m_timerThread;
     boost::asio::deadline_timer                        m_timer;
 
+    // wallet checks, kept off the timer and session threads
+    boost::asio::io_service                            m_walletsIo;
+    std::shared_ptr<boost::asio::io_service::work>     m_walletsIoWork;
+    boost::thread                                      m_walletsThread;
+
     // sessions
     mutable CCriticalSection                           m_sessionsLock;
     SessionQueue                                       m_sessions;
     SessionsAddrMap                                    m_sessionAddressMap;
+    std::vector<std::pair<IoServicePtr, SessionPtr>>   m_shards; // order id -> worker thread and session
 
     // connectors
     mutable CCriticalSection                           m_connectorsLock;
@@ -210,8 +304,7 @@ protected:
 
     // pending messages (packet processing loop)
     CCriticalSection                                   m_messagesLock;
-    typedef std::set<uint256> ProcessedMessages;
-    ProcessedMessages                                  m_processedMessages;
+    std::unique_ptr<CRollingBloomFilter>               m_processedMessages; // created on first use
 
     // address book
     CCriticalSection                                   m_addressBookLock;
@@ -220,19 +313,29 @@ protected:
 
     // transactions
     CCriticalSection                                   m_txLocker;
-    std::map<uint256, TransactionDescrPtr>             m_transactions;
-    std::map<uint256, TransactionDescrPtr>             m_historicTransactions;
+    TransactionSnapshotMap                             m_transactions;
+    TransactionSnapshotMap                             m_historicTransactions;
+    OrderBook                                          m_orderBook; // open orders of m_transactions by price
+    TimingWheel<uint256, SaltedTxidHasher>             m_txExpiry; // next expiry check of m_transactions
+    std::set<uint256>                                  m_historyPending; // moved to history, not yet persisted
+    std::unique_ptr<OrderHistoryDB>                    m_historyDb; // null if it failed to open
     xSeriesCache                                       m_xSeriesCache;
 
     // network packets queue
     CCriticalSection                                   m_ppLocker;
-    std::map<uint256, XBridgePacketPtr>                m_pendingPackets;
+    PendingPackets                                     m_pendingPackets;
 
     // store deposit watches
     CCriticalSection                                   m_watchDepositsLocker;
     std::map<uint256, TransactionDescrPtr>             m_watchDeposits;
+    std::map<COutPoint, uint256>                       m_watchDepositOutpoints; // watched deposit -> order id
+    std::map<std::string, int64_t>                     m_depositPollTimes; // last poll of currencies with a zmq feed
     bool                                               m_watching{false};
 
+    // wallet zmq feeds
+    CCriticalSection                                   m_zmqFeedsLock;
+    std::map<std::string, std::unique_ptr<ZmqFeed>>    m_zmqFeeds;
+
     // store trader watches
     CCriticalSection                                   m_watchTradersLocker;
     std::map<uint256, TransactionPtr>                  m_watchTraders;
@@ -245,6 +348,10 @@ App::Impl::Impl()
     : m_timerIoWork(new boost::asio::io_service::work(m_timerIo))
     , m_timerThread(boost::bind(&boost::asio::io_service::run, &m_timerIo))
     , m_timer(m_timerIo, boost::posix_time::seconds(TIMER_INTERVAL))
+    , m_walletsIoWork(new boost::asio::io_service::work(m_walletsIo))
+    , m_walletsThread(boost::bind(&boost::asio::io_service::run, &m_walletsIo))
+    , m_pendingPackets(PENDING_PACKETS_MAX, PENDING_PACKETS_TTL,
+                       PENDING_RETRY_INTERVAL, PENDING_MAX_RETRY_INTERVAL)
 {
 
 }
@@ -252,7 +359,7 @@ App::Impl::Impl()
 //*****************************************************************************
 //*****************************************************************************
 App::App()
-    : m_p(new Impl), m_disconnecting(false)
+    : m_p(new Impl), m_disconnecting(false), m_utxos(Impl::UTXO_CACHE_TTL)
 {
 }
 
@@ -296,6 +403,9 @@ bool App::start()
 {
     auto s = m_p->start();
 
+    // Keep the cached order history in sync with the chain
+    RegisterValidationInterface(&m_p->m_xSeriesCache);
+
     // This will update the wallet connectors on both the app & exchange
     updateActiveWallets();
 
@@ -315,6 +425,8 @@ bool App::Impl::start()
     // start xbrige
     try
     {
+        WalletReactor::instance().start();
+
         // services and thredas
         for (size_t i = 0; i < boost::thread::hardware_concurrency(); ++i)
         {
@@ -324,6 +436,11 @@ bool App::Impl::start()
             m_works.push_back(WorkPtr(new boost::asio::io_service::work(*ios)));
 
             m_threads.create_thread(boost::bind(&boost::asio::io_service::run, ios));
+
+            SessionPtr session(new Session());
+            LOCK(m_sessionsLock);
+            m_shards.emplace_back(ios, session);
+            m_sessionAddressMap[session->sessionAddr()] = session;
         }
 
         m_timer.async_wait(boost::bind(&Impl::onTimer, this));
@@ -350,6 +467,17 @@ bool App::init()
     Exchange & e = Exchange::instance();
     e.init();
 
+    // order history store
+    try
+    {
+        LOCK(m_p->m_txLocker);
+        m_p->m_historyDb = MakeUnique<OrderHistoryDB>(ORDER_HISTORY_DB_CACHE);
+    }
+    catch (std::exception & e)
+    {
+        ERR() << "failed to open the order history store " << e.what() << " " << __FUNCTION__;
+    }
+
     // sessions
     {
         LOCK(m_p->m_sessionsLock);
@@ -370,7 +498,10 @@ bool App::init()
 //*****************************************************************************
 bool App::stop()
 {
+    UnregisterValidationInterface(&m_p->m_xSeriesCache);
     bool s = m_p->stop();
+    m_p->persistHistory();
+    WalletReactor::instance().stop();
     return s;
 }
 
@@ -392,9 +523,13 @@ bool App::disconnectWallets()
         for (auto & conn : m_p->m_connectors)
             wallets.insert(conn->currency);
     }
-    // Remove all connectors
+    // Remove all connectors, the zmq feeds of the wallets are stopped in parallel
+    std::vector<std::thread> removals;
     for (auto & wallet : wallets)
-        removeConnector(wallet);
+        removals.emplace_back([this, wallet]() { removeConnector(wallet); });
+    for (auto & removal : removals)
+        removal.join();
+    RPCConnectionPool::instance().clear(); // close the wallet rpc connections
 
     std::set<std::string> noWallets;
     xbridge::Exchange::instance().loadWallets(noWallets);
@@ -430,11 +565,20 @@ bool App::Impl::stop()
 {
     LOG() << "stopping xbridge threads...";
 
+    {
+        LOCK(m_zmqFeedsLock);
+        m_zmqFeeds.clear();
+    }
+
     m_timer.cancel();
     m_timerIo.stop();
     m_timerIoWork.reset();
     m_timerThread.join();
 
+    m_walletsIo.stop();
+    m_walletsIoWork.reset();
+    m_walletsThread.join();
+
 //    for (IoServicePtr & i : m_services)
 //    {
 //        i->stop();
@@ -463,13 +607,16 @@ void App::sendPacket(const XBridgePacketPtr & packet)
 //*****************************************************************************
 void App::Impl::onSend(const std::vector<unsigned char> & id, const std::vector<unsigned char> & message)
 {
-    std::vector<unsigned char> msg(id);
-    if (msg.size() != 20)
+    if (id.size() != 20)
     {
         ERR() << "bad send address " << __FUNCTION__;
         return;
     }
 
+    std::vector<unsigned char> msg;
+    msg.reserve(id.size() + sizeof(uint64_t) + message.size());
+    msg.insert(msg.end(), id.begin(), id.end());
+
     // timestamp
     boost::posix_time::ptime timestamp = boost::posix_time::microsec_clock::universal_time();
     uint64_t timestampValue = timeToInt(timestamp);
@@ -484,13 +631,7 @@ void App::Impl::onSend(const std::vector<unsigned char> & id, const std::vector<
     App::instance().addToKnown(hash);
 
     // Relay
-    const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
-    g_connman->ForEachNode([&](CNode* pnode) {
-        if (!pnode->fSuccessfullyConnected)
-            return;
-        if (pnode->fSuccessfullyConnected && !pnode->fDisconnect && !pnode->fXRouter) // do not relay to xrouter nodes
-            g_connman->PushMessage(pnode, msgMaker.Make(NetMsgType::XBRIDGE, msg));
-    });
+    RelayXBridgePacket(hash, CNetPayload(std::move(msg)), g_connman.get());
 }
 
 //*****************************************************************************
@@ -535,18 +676,43 @@ SessionPtr App::Impl::getSession(const std::vector<unsigned char> & address)
     return SessionPtr();
 }
 
+//*****************************************************************************
+//*****************************************************************************
+void App::Impl::dispatchPacket(const XBridgePacketPtr & packet, SessionPtr session)
+{
+    uint256 id;
+    if (Session::orderId(packet, id))
+    {
+        LOCK(m_sessionsLock);
+        if (!m_shards.empty())
+        {
+            const auto & shard = m_shards[id.GetUint64(0) % m_shards.size()];
+            if (!session)
+                session = shard.second;
+            shard.first->post(boost::bind(&xbridge::Session::processPacket, session, packet, nullptr));
+            return;
+        }
+    }
+
+    if (!session)
+        session = getSession();
+    if (session)
+        session->processPacket(packet);
+}
+
 //*****************************************************************************
 //*****************************************************************************
 void App::onMessageReceived(const std::vector<unsigned char> & id,
-                            const std::vector<unsigned char> & message,
+                            const XBridgePacketView & message,
                             CValidationState & /*state*/)
 {
-    if (isKnownMessage(message))
+    const uint256 hash = Hash(message.begin(), message.end());
+    if (isKnownMessage(hash))
     {
         return;
     }
 
-    addToKnown(message);
+    addToKnown(hash);
 
     if (!Session::checkXBridgePacketVersion(message))
     {
@@ -561,7 +727,7 @@ void App::onMessageReceived(const std::vector<unsigned char> & id,
         return;
     }
 
-    if (!packet->verify())
+    if (!packet->verify(hash))
     {
         LOG() << "unsigned packet or signature error " << __FUNCTION__;
         return;
@@ -574,8 +740,7 @@ void App::onMessageReceived(const std::vector<unsigned char> & id,
     SessionPtr ptr = m_p->getSession(id);
     if (ptr)
     {
-        // TODO use post or future
-        ptr->processPacket(packet);
+        m_p->dispatchPacket(packet, ptr);
         return;
     }
     else
@@ -598,8 +763,7 @@ void App::onMessageReceived(const std::vector<unsigned char> & id,
 
         if (ptr)
         {
-            // TODO use post or future
-            ptr->processPacket(packet);
+            m_p->dispatchPacket(packet, ptr);
             return;
         }
 
@@ -617,25 +781,22 @@ void App::onMessageReceived(const std::vector<unsigned char> & id,
         if (memcmp(&snodeAddr[0], &id[0], 20) != 0)
             return;
 
-        SessionPtr ptr = m_p->getSession();
-        if (ptr)
-        {
-            ptr->processPacket(packet);
-        }
+        m_p->dispatchPacket(packet);
     }
 }
 
 //*****************************************************************************
 //*****************************************************************************
-void App::onBroadcastReceived(const std::vector<unsigned char> & message,
+void App::onBroadcastReceived(const XBridgePacketView & message,
                               CValidationState & state)
 {
-    if (isKnownMessage(message))
+    const uint256 hash = Hash(message.begin(), message.end());
+    if (isKnownMessage(hash))
     {
         return;
     }
 
-    addToKnown(message);
+    addToKnown(hash);
 
     if (!Session::checkXBridgePacketVersion(message))
     {
@@ -651,7 +812,7 @@ void App::onBroadcastReceived(const std::vector<unsigned char> & message,
         return;
     }
 
-    if (!packet->verify())
+    if (!packet->verify(hash))
     {
         LOG() << "unsigned packet or signature error " << __FUNCTION__;
         return;
@@ -659,20 +820,21 @@ void App::onBroadcastReceived(const std::vector<unsigned char> & message,
 
     LOG() << "broadcast message, command " << packet->command();
 
-    SessionPtr ptr = m_p->getSession();
-    if (ptr)
-    {
-        // TODO use post or future
-        ptr->processPacket(packet);
-    }
+    m_p->dispatchPacket(packet);
 }
 
 //*****************************************************************************
 //*****************************************************************************
-bool App::processLater(const uint256 & txid, const XBridgePacketPtr & packet)
+bool App::processLater(const uint256 & txid, const XBridgePacketPtr & packet,
+                       const std::string & awaiting)
 {
     LOCK(m_p->m_ppLocker);
-    m_p->m_pendingPackets[txid] = packet;
+    const uint256 evicted = m_p->m_pendingPackets.add(txid, packet, awaiting, GetTime());
+    if (!evicted.IsNull())
+    {
+        WARN() << "pending packets queue is full, dropped packet of order "
+               << evicted.GetHex() << " " << __FUNCTION__;
+    }
     return true;
 }
 
@@ -683,14 +845,23 @@ bool App::removePackets(const uint256 & txid)
     // remove from pending packets (if added)
 
     LOCK(m_p->m_ppLocker);
-    size_t removed = m_p->m_pendingPackets.erase(txid);
-    if(removed > 1) {
-        ERR() << "duplicate packets in packets queue" << __FUNCTION__;
-        return false;
-    }
-//    assert(removed < 2 && "duplicate packets in packets queue");
+    return m_p->m_pendingPackets.remove(txid);
+}
 
-    return true;
+//*****************************************************************************
+//*****************************************************************************
+void App::Impl::wakePendingPackets(const std::string & awaiting)
+{
+    std::vector<XBridgePacketPtr> packets;
+    {
+        LOCK(m_ppLocker);
+        packets = m_pendingPackets.wake(awaiting, GetTime());
+    }
+    for (const XBridgePacketPtr & packet : packets)
+    {
+        // posted to the thread of the order
+        dispatchPacket(packet);
+    }
 }
 
 //*****************************************************************************
@@ -759,32 +930,49 @@ bool App::hasCurrency(const std::string & currency) const
 // The connector is not added if it already exists.
 void App::addConnector(const WalletConnectorPtr & conn)
 {
-    LOCK(m_p->m_connectorsLock);
+    {
+        LOCK(m_p->m_connectorsLock);
 
-    // Remove existing connector
-    bool found = false;
-    for (int i = m_p->m_connectors.size() - 1; i >= 0; --i) {
-        if (m_p->m_connectors[i]->currency == conn->currency) {
-            found = true;
-            m_p->m_connectors.erase(m_p->m_connectors.begin() + i);
+        // Remove existing connector
+        bool found = false;
+        for (int i = m_p->m_connectors.size() - 1; i >= 0; --i) {
+            if (m_p->m_connectors[i]->currency == conn->currency) {
+                found = true;
+                m_p->m_connectors.erase(m_p->m_connectors.begin() + i);
+            }
         }
-    }
 
-    // Add new connector
-    m_p->m_connectors.push_back(conn);
-    m_p->m_connectorCurrencyMap[conn->currency] = conn;
+        // Add new connector
+        m_p->m_connectors.push_back(conn);
+        m_p->m_connectorCurrencyMap[conn->currency] = conn;
 
-    // Update address connectors
-    for (auto iter = m_p->m_connectorAddressMap.rbegin(); iter != m_p->m_connectorAddressMap.rend(); ++iter) {
-        if (iter->second->currency == conn->currency)
-            m_p->m_connectorAddressMap[iter->first] = conn;
+        // Update address connectors
+        for (auto iter = m_p->m_connectorAddressMap.rbegin(); iter != m_p->m_connectorAddressMap.rend(); ++iter) {
+            if (iter->second->currency == conn->currency)
+                m_p->m_connectorAddressMap[iter->first] = conn;
+        }
     }
+
+    // Orders that waited for the wallet
+    m_p->wakePendingPackets(conn->currency);
+
+    m_p->updateZmqFeed(conn->currency);
 }
 
 //*****************************************************************************
 //*****************************************************************************
 void App::removeConnector(const std::string & currency)
 {
+    std::unique_ptr<ZmqFeed> feed; // stopped outside the locks
+    {
+        LOCK(m_p->m_zmqFeedsLock);
+        auto it = m_p->m_zmqFeeds.find(currency);
+        if (it != m_p->m_zmqFeeds.end()) {
+            feed = std::move(it->second);
+            m_p->m_zmqFeeds.erase(it);
+        }
+    }
+
     LOCK(m_p->m_connectorsLock);
 
     for (int i = m_p->m_connectors.size() - 1; i >= 0; --i) {
@@ -819,14 +1007,14 @@ void App::updateConnector(const WalletConnectorPtr & conn,
 //*****************************************************************************
 void App::updateActiveWallets()
 {
+    if (ShutdownRequested())
+        return;
     {
         LOCK(m_updatingWalletsLock);
         if (m_updatingWallets)
             return;
         m_updatingWallets = true;
     }
-    if (ShutdownRequested())
-        return;
 
     Settings & s = settings();
     std::vector<std::string> wallets = s.exchangeWallets();
@@ -854,25 +1042,19 @@ void App::updateActiveWallets()
     std::vector<WalletConnectorPtr> conns;
 
     // Copy bad wallets
-    std::map<std::string, boost::posix_time::ptime> badWallets;
+    std::map<std::string, BadWallet> badWallets;
     {
         LOCK(m_updatingWalletsLock);
         badWallets = m_badWallets;
     }
+    const int64_t now = GetTime();
 
     for (std::vector<std::string>::iterator i = wallets.begin(); i != wallets.end(); ++i)
     {
-        // Ignore bad wallets until expiry
-        if (badWallets.count(*i)) {
-            const auto last_time = badWallets[*i];
-            const auto current_time = boost::posix_time::second_clock::universal_time();
-            // Wait ~5 minutes before doing wallet check on bad wallet
-            if (static_cast<boost::posix_time::time_duration>(current_time - last_time).total_seconds() >= 300) {
-                LOCK(m_updatingWalletsLock);
-                m_badWallets.erase(*i);
-            } else // not ready to do wallet check
-                continue;
-        }
+        // Ignore bad wallets until their next check
+        auto bad = badWallets.find(*i);
+        if (bad != badWallets.end() && bad->second.retryTime > now)
+            continue;
 
         WalletParam wp;
         wp.currency                    = *i;
@@ -956,73 +1138,38 @@ void App::updateActiveWallets()
 
     // Process connections
     if (!conns.empty()) {
-        // TLDR: Multithreaded connection checks
-        // The code below utilizes boost async to spawn threads up to the reported hardware concurrency
-        // capabilities of the host. All of the wallets loaded into xbridge.conf will be checked here,
-        // specifically for valid connections. This implementation also supports being interrupted via
-        // a boost interruption point. A mutex is used to synchronize checks across async threads.
-        boost::mutex muJobs;
-        auto rpcThreads = static_cast<int32_t>(gArgs.GetArg("-rpcthreads", 4));
-        if (rpcThreads <= 0)
-            rpcThreads = 4;
-        const uint32_t maxPendingJobs = static_cast<uint32_t>(rpcThreads);
-        uint32_t pendingJobs = 0;
-        uint32_t allJobs = static_cast<uint32_t>(conns.size());
-        boost::thread_group tg;
-
-        // Synchronize all connection checks
+        // Connection checks run on the wallet reactor. Every wallet gets until the rpc timeout
+        // to respond, an unresponsive wallet is marked bad instead of holding up this thread.
+        std::vector<std::pair<WalletConnectorPtr, std::future<bool>>> checks;
+        for (auto & conn : conns)
+            checks.emplace_back(conn, AsyncWalletCall<bool>(conn, [](WalletConnector & c) { return c.init(); }));
+
+        const auto deadline = std::chrono::steady_clock::now()
+                            + std::chrono::seconds(gArgs.GetArg("-rpcxbridgetimeout", 120) + 5);
         try {
-            while (true) {
-                boost::this_thread::interruption_point();
-                if (ShutdownRequested())
-                    break;
-
-                const int32_t size = conns.size();
-                for (int32_t i = size - 1; i >= 0; --i) {
-                    {
-                        boost::mutex::scoped_lock l(muJobs);
-                        if (pendingJobs >= maxPendingJobs)
-                            break;
-                        ++pendingJobs;
+            for (auto & check : checks) {
+                bool valid{false};
+                while (!ShutdownRequested()) {
+                    boost::this_thread::interruption_point();
+                    // wake up every second to notice a shutdown
+                    const auto wait = std::min(deadline, std::chrono::steady_clock::now() + std::chrono::seconds(1));
+                    if (check.second.wait_until(wait) == std::future_status::ready) {
+                        try {
+                            valid = check.second.get();
+                        } catch (...) { } // stopped reactor or failed check
+                        break;
                     }
-                    WalletConnectorPtr conn = conns.back();
-                    conns.pop_back();
-                    // Asynchronously check connection
-                    tg.create_thread([conn, &muJobs, &allJobs, &pendingJobs, &validConnections, &badConnections]() {
-                        RenameThread("blocknet-xbridgewalletcheck");
-                        if (ShutdownRequested())
-                            return;
-                        // Check that wallet is reachable
-                        if (!conn->init()) {
-                            {
-                                boost::mutex::scoped_lock l(muJobs);
-                                --pendingJobs;
-                                --allJobs;
-                                badConnections.push_back(conn);
-                            }
-                            return;
-                        }
-                        {
-                            boost::mutex::scoped_lock l(muJobs);
-                            --pendingJobs;
-                            --allJobs;
-                            validConnections.push_back(conn);
-                        }
-                    });
-                }
-
-                {
-                    boost::mutex::scoped_lock l(muJobs);
-                    if (allJobs == 0)
+                    if (std::chrono::steady_clock::now() >= deadline) {
+                        ERR() << check.first->currency << " \"" << check.first->title << "\"" << " wallet check deadline exceeded";
                         break;
+                    }
                 }
-
-                boost::this_thread::sleep_for(boost::chrono::milliseconds(100));
+                if (valid)
+                    validConnections.push_back(check.first);
+                else
+                    badConnections.push_back(check.first);
             }
-            tg.join_all();
         } catch (...) { // bail on error (possible thread error etc)
-            tg.interrupt_all();
-            tg.join_all();
             LOCK(m_updatingWalletsLock);
             m_updatingWallets = false;
             WARN() << "Potential issue with active xbridge wallets checks (unknown threading error). If issue persists please notify the dev team";
@@ -1035,18 +1182,27 @@ void App::updateActiveWallets()
             for (auto & conn : validConnections) {
                 addConnector(conn);
                 validWallets.insert(conn->currency);
+                {
+                    LOCK(m_updatingWalletsLock);
+                    m_badWallets.erase(conn->currency);
+                }
                 LOG() << conn->currency << " \"" << conn->title << "\"" << " connected " << conn->m_ip << ":" << conn->m_port;
             }
 
-            // Remove bad connections
+            // Remove bad connections, a wallet that keeps failing is checked less often
             for (auto & conn : badConnections) {
                 removeConnector(conn->currency);
+                int64_t retry{0};
                 {
                     LOCK(m_updatingWalletsLock);
-                    boost::posix_time::ptime time{boost::posix_time::second_clock::universal_time()};
-                    m_badWallets[conn->currency] = time;
+                    auto & bad = m_badWallets[conn->currency];
+                    retry = std::min(static_cast<int64_t>(Impl::BAD_WALLET_RETRY_INTERVAL) << std::min(bad.failures, 8u),
+                                     static_cast<int64_t>(Impl::BAD_WALLET_MAX_RETRY_INTERVAL));
+                    bad.retryTime = GetTime() + retry;
+                    ++bad.failures;
                 }
-                WARN() << conn->currency << " \"" << conn->title << "\"" << " Failed to connect, check the config";
+                WARN() << conn->currency << " \"" << conn->title << "\"" << " Failed to connect, check the config"
+                       << " (next check in " << retry << " seconds)";
             }
         }
     }
@@ -1074,7 +1230,7 @@ std::vector<WalletConnectorPtr> App::connectors() const
 bool App::isKnownMessage(const std::vector<unsigned char> & message)
 {
     LOCK(m_p->m_messagesLock);
-    return m_p->m_processedMessages.count(Hash(message.begin(), message.end())) > 0;
+    return knownMessages().contains(Hash(message.begin(), message.end()));
 }
 
 //*****************************************************************************
@@ -1082,7 +1238,7 @@ bool App::isKnownMessage(const std::vector<unsigned char> & message)
 bool App::isKnownMessage(const uint256 & hash)
 {
     LOCK(m_p->m_messagesLock);
-    return m_p->m_processedMessages.count(hash) > 0;
+    return knownMessages().contains(hash);
 }
 
 //*****************************************************************************
@@ -1091,9 +1247,7 @@ void App::addToKnown(const std::vector<unsigned char> & message)
 {
     // add to known
     LOCK(m_p->m_messagesLock);
-    // clear memory if it's larger than mempool threshold
-    clearMempool();
-    m_p->m_processedMessages.insert(Hash(message.begin(), message.end()));
+    knownMessages().insert(Hash(message.begin(), message.end()));
 }
 
 //*****************************************************************************
@@ -1102,9 +1256,7 @@ void App::addToKnown(const uint256 & hash)
 {
     // add to known
     LOCK(m_p->m_messagesLock);
-    // clear memory if it's larger than mempool threshold
-    clearMempool();
-    m_p->m_processedMessages.insert(hash);
+    knownMessages().insert(hash);
 }
 
 //******************************************************************************
@@ -1117,7 +1269,7 @@ TransactionDescrPtr App::transaction(const uint256 & id) const
 
     if (m_p->m_transactions.count(id))
     {
-        result = m_p->m_transactions[id];
+        result = m_p->m_transactions.at(id);
     }
 
     if (m_p->m_historicTransactions.count(id))
@@ -1127,25 +1279,59 @@ TransactionDescrPtr App::transaction(const uint256 & id) const
             return result;
         }
 //        assert(!result && "duplicate objects");
-        result = m_p->m_historicTransactions[id];
+        result = m_p->m_historicTransactions.at(id);
     }
     return result;
 }
 
 //******************************************************************************
 //******************************************************************************
-std::map<uint256, xbridge::TransactionDescrPtr> App::transactions() const
+App::TransactionMapSnapshot App::transactions() const
+{
+    LOCK(m_p->m_txLocker);
+    return m_p->m_transactions.snapshot();
+}
+
+static metrics::CallbackGauge g_metric_orders{"blocknet_xbridge_orders", "Open XBridge orders", []{
+    return (double)App::instance().transactions()->size();
+}};
+
+//******************************************************************************
+//******************************************************************************
+std::vector<OrderBook::Level> App::orderBookLevels(const std::string & fromCurrency,
+                                                   const std::string & toCurrency,
+                                                   const size_t maxLevels) const
 {
     LOCK(m_p->m_txLocker);
-    return m_p->m_transactions;
+    return m_p->m_orderBook.levels(fromCurrency, toCurrency, maxLevels);
 }
 
 //******************************************************************************
 //******************************************************************************
-std::map<uint256, xbridge::TransactionDescrPtr> App::history() const
+App::TransactionMapSnapshot App::history() const
 {
     LOCK(m_p->m_txLocker);
-    return m_p->m_historicTransactions;
+    return m_p->m_historicTransactions.snapshot();
+}
+
+//******************************************************************************
+//******************************************************************************
+std::vector<TransactionDescrPtr> App::historyOrders(const OrderHistoryQuery & query)
+{
+    m_p->persistHistory();
+
+    std::vector<TransactionDescrPtr> orders;
+    std::vector<OrderHistoryRecord> records;
+    {
+        LOCK(m_p->m_txLocker);
+        if (!m_p->m_historyDb)
+            return orders;
+        records = m_p->m_historyDb->query(query);
+    }
+    orders.reserve(records.size());
+    for (const OrderHistoryRecord & r : records)
+        orders.push_back(r.toTransaction());
+    return orders;
 }
 
 //******************************************************************************
@@ -1172,16 +1358,28 @@ App::flushCancelledOrders(bpt::time_duration minAge) const
 {
     std::vector<App::FlushedOrder> list{};
     const bpt::ptime keepTime{bpt::microsec_clock::universal_time() - minAge};
-    const std::vector<TransactionMap*> maps{&m_p->m_transactions, &m_p->m_historicTransactions};
+    const std::vector<TransactionSnapshotMap*> maps{&m_p->m_transactions, &m_p->m_historicTransactions};
 
     LOCK(m_p->m_txLocker);
 
-    for(auto mp : maps) {
+    for(auto smp : maps) {
+        bool found{false};
+        for(const auto & it : *smp) {
+            found = it.second->state == xbridge::TransactionDescr::trCancelled && it.second->txtime < keepTime;
+            if (found)
+                break;
+        }
+        if (!found)
+            continue; // don't copy the map of a snapshot in use
+        auto mp = &smp->modify();
         for(auto it = mp->begin(); it != mp->end(); ) {
             const TransactionDescrPtr & ptr = it->second;
             if (ptr->state == xbridge::TransactionDescr::trCancelled
                 && ptr->txtime < keepTime) {
                 list.emplace_back(ptr->id,ptr->txtime,ptr.use_count());
+                m_p->m_orderBook.remove(ptr->id);
+                m_p->m_historyPending.erase(ptr->id);
+                m_p->m_txExpiry.cancel(ptr->id);
                 mp->erase(it++);
             } else {
                 ++it;
@@ -1189,6 +1387,26 @@ App::flushCancelledOrders(bpt::time_duration minAge) const
         }
     }
 
+    // cancelled orders of the history store, including those no longer in memory
+    if (m_p->m_historyDb) {
+        OrderHistoryQuery query;
+        query.states.insert(xbridge::TransactionDescr::trCancelled);
+        query.endTime = timeToInt(keepTime);
+
+        std::set<uint256> flushed;
+        for (const auto & order : list)
+            flushed.insert(order.id);
+
+        std::vector<uint256> ids;
+        for (const OrderHistoryRecord & r : m_p->m_historyDb->query(query)) {
+            ids.push_back(r.id);
+            if (!flushed.count(r.id))
+                list.emplace_back(r.id,intToTime(r.txtime),0);
+        }
+        if (!ids.empty() && !m_p->m_historyDb->erase(ids))
+            ERR() << "failed to erase cancelled orders from the order history store " << __FUNCTION__;
+    }
+
     return list;
 }
 
@@ -1206,12 +1424,27 @@ void App::appendTransaction(const TransactionDescrPtr & ptr)
     if (!m_p->m_transactions.count(ptr->id))
     {
         // new transaction, copy data
-        m_p->m_transactions[ptr->id] = ptr;
+        m_p->m_transactions.set(ptr->id, ptr);
+        m_p->m_orderBook.add(ptr);
+        m_p->m_txExpiry.schedule(ptr->id, boost::posix_time::to_time_t(ptr->txtime) + Transaction::pendingTTL + 1);
     }
     else
     {
         // existing, update timestamp
-        m_p->m_transactions[ptr->id]->updateTimestamp(*ptr);
+        m_p->m_transactions.at(ptr->id)->updateTimestamp(*ptr);
+        m_p->m_txExpiry.schedule(ptr->id, GetTime()); // may be pending again
+    }
+}
+
+//******************************************************************************
+//******************************************************************************
+void App::checkTransactionExpiry(const uint256 & id)
+{
+    LOCK(m_p->m_txLocker);
+
+    if (m_p->m_transactions.count(id))
+    {
+        m_p->m_txExpiry.schedule(id, GetTime());
     }
 }
 
@@ -1228,9 +1461,11 @@ void App::moveTransactionToHistory(const uint256 & id)
 
         if (m_p->m_transactions.count(id))
         {
-            xtx = m_p->m_transactions[id];
+            xtx = m_p->m_transactions.at(id);
 
             counter = m_p->m_transactions.erase(id);
+            m_p->m_orderBook.remove(id);
+            m_p->m_txExpiry.cancel(id);
             if(counter > 1) {
                 ERR() << "duplicate transaction id = " << id.GetHex() << " " << __FUNCTION__;
             }
@@ -1242,7 +1477,8 @@ void App::moveTransactionToHistory(const uint256 & id)
                 ERR() << "duplicate tx " << id.GetHex() << " in tx list and history " << __FUNCTION__;
                 return;
             }
-            m_p->m_historicTransactions[id] = xtx;
+            m_p->m_historicTransactions.set(id, xtx);
+            m_p->m_historyPending.insert(id);
         }
     }
 
@@ -1267,82 +1503,120 @@ xbridge::Error App::sendXBridgeTransaction(const std::string & from,
                                            uint256 & id,
                                            uint256 & blockHash)
 {
-    // search for service node
-    std::set<std::string> currencies{fromCurrency, toCurrency};
-    CPubKey snode;
-    std::set<CPubKey> notIn;
-    if (!findNodeWithService(currencies, snode, notIn))
-    {
-        ERR() << "Failed to find servicenode for pair " << boost::algorithm::join(currencies, ",") << " "
-              << __FUNCTION__;
-        return xbridge::Error::NO_SERVICE_NODE;
-    }
-
-    auto pmn = sn::ServiceNodeMgr::instance().getSn(snode);
-    if (pmn.isNull()) {
-        if (snode.Decompress()) // try to uncompress pubkey and search
-            pmn = sn::ServiceNodeMgr::instance().getSn(snode);
-        if (pmn.isNull()) {
-            ERR() << "Failed to find servicenode for pair " << boost::algorithm::join(currencies, ",") << " "
-                  << " servicenode in xwallets is not in servicenode list " << __FUNCTION__;
-            return xbridge::NO_SERVICE_NODE;
-        }
-    }
+    std::vector<NewOrder> orders(1);
+    NewOrder & order    = orders.front();
+    order.from          = from;
+    order.fromCurrency  = fromCurrency;
+    order.fromAmount    = fromAmount;
+    order.to            = to;
+    order.toCurrency    = toCurrency;
+    order.toAmount      = toAmount;
 
-    std::vector<unsigned char> snodeAddress(20);
-    std::vector<unsigned char> sPubKey(33);
-    CKeyID snodeID = snode.GetID();
-    std::copy(snodeID.begin(), snodeID.end(), snodeAddress.begin());
+    sendXBridgeTransactions(orders);
 
-    if (!snode.IsCompressed()) {
-        snode.Compress();
-    }
-    sPubKey = std::vector<unsigned char>(snode.begin(), snode.end());
+    id        = order.id;
+    blockHash = order.blockHash;
+    return order.status;
+}
 
-    const auto statusCode = checkCreateParams(fromCurrency, toCurrency, fromAmount, from);
-    if(statusCode != xbridge::SUCCESS)
+//******************************************************************************
+//******************************************************************************
+size_t App::sendXBridgeTransactions(std::vector<NewOrder> & orders)
+{
+    struct Snode
     {
-        return statusCode;
-    }
+        xbridge::Error             status{xbridge::SUCCESS};
+        CPubKey                    snodePubKey;
+        std::vector<unsigned char> address;
+        std::vector<unsigned char> pubKey;
+    };
 
-    if (fromCurrency.size() > 8 || toCurrency.size() > 8)
+    struct Pending
     {
-        WARN() << "invalid currency " << __FUNCTION__;
-        return xbridge::Error::INVALID_CURRENCY;
-    }
+        NewOrder &                     order;
+        const Snode &                  snode;
+        WalletConnectorPtr             connFrom;
+        WalletConnectorPtr             connTo;
+        std::vector<wallet::UtxoEntry> outputsForUse;
+    };
 
-    WalletConnectorPtr connFrom = connectorByCurrency(fromCurrency);
-    WalletConnectorPtr connTo   = connectorByCurrency(toCurrency);
-    if (!connFrom || !connTo)
+    // search for service node
+    auto findSnode = [this](const std::set<std::string> & currencies) -> Snode
     {
-        // no session
-        WARN() << "no session for <" << (connFrom ? toCurrency : fromCurrency) << "> " << __FUNCTION__;
-        return xbridge::Error::NO_SESSION;
-    }
+        Snode res;
+        CPubKey snode;
+        std::set<CPubKey> notIn;
+        if (!findNodeWithService(currencies, snode, notIn))
+        {
+            ERR() << "Failed to find servicenode for pair " << boost::algorithm::join(currencies, ",") << " "
+                  << __FUNCTION__;
+            res.status = xbridge::Error::NO_SERVICE_NODE;
+            return res;
+        }
 
-    if (connFrom->isDustAmount(static_cast<double>(fromAmount) / TransactionDescr::COIN))
-    {
-        return xbridge::Error::DUST;
-    }
+        auto pmn = sn::ServiceNodeMgr::instance().getSn(snode);
+        if (pmn.isNull()) {
+            if (snode.Decompress()) // try to uncompress pubkey and search
+                pmn = sn::ServiceNodeMgr::instance().getSn(snode);
+            if (pmn.isNull()) {
+                ERR() << "Failed to find servicenode for pair " << boost::algorithm::join(currencies, ",") << " "
+                      << " servicenode in xwallets is not in servicenode list " << __FUNCTION__;
+                res.status = xbridge::NO_SERVICE_NODE;
+                return res;
+            }
+        }
+        res.snodePubKey = pmn.getSnodePubKey();
 
-    if (connTo->isDustAmount(static_cast<double>(toAmount) / TransactionDescr::COIN))
-    {
-        return xbridge::Error::DUST;
-    }
+        CKeyID snodeID = snode.GetID();
+        res.address = std::vector<unsigned char>(snodeID.begin(), snodeID.end());
 
-    TransactionDescrPtr ptr(new TransactionDescr);
-    std::vector<wallet::UtxoEntry> outputsForUse;
+        if (!snode.IsCompressed()) {
+            snode.Compress();
+        }
+        res.pubKey = std::vector<unsigned char>(snode.begin(), snode.end());
+        return res;
+    };
 
-    // Utxo selection
+    auto checkOrder = [this](const NewOrder & order, WalletConnectorPtr & connFrom, WalletConnectorPtr & connTo) -> xbridge::Error
     {
-        LOCK(m_utxosOrderLock);
+        const auto statusCode = checkCreateParams(order.fromCurrency, order.toCurrency, order.fromAmount, order.from);
+        if(statusCode != xbridge::SUCCESS)
+        {
+            return statusCode;
+        }
 
-        // Exclude the used uxtos
-        const auto excludedUtxos = getAllLockedUtxos(connFrom->currency);
+        if (order.fromCurrency.size() > 8 || order.toCurrency.size() > 8)
+        {
+            WARN() << "invalid currency " << __FUNCTION__;
+            return xbridge::Error::INVALID_CURRENCY;
+        }
 
-        // Available utxos from from wallet
-        std::vector<wallet::UtxoEntry> outputs;
-        connFrom->getUnspent(outputs, excludedUtxos);
+        connFrom = connectorByCurrency(order.fromCurrency);
+        connTo   = connectorByCurrency(order.toCurrency);
+        if (!connFrom || !connTo)
+        {
+            // no session
+            WARN() << "no session for <" << (connFrom ? order.toCurrency : order.fromCurrency) << "> " << __FUNCTION__;
+            return xbridge::Error::NO_SESSION;
+        }
+
+        if (connFrom->isDustAmount(static_cast<double>(order.fromAmount) / TransactionDescr::COIN))
+        {
+            return xbridge::Error::DUST;
+        }
+
+        if (connTo->isDustAmount(static_cast<double>(order.toAmount) / TransactionDescr::COIN))
+        {
+            return xbridge::Error::DUST;
+        }
+        return xbridge::SUCCESS;
+    };
+
+    // Selects, signs and locks the utxos of the order, selected utxos are removed from outputs
+    auto selectOrderUtxos = [this](Pending & p, std::vector<wallet::UtxoEntry> & outputs) -> xbridge::Error
+    {
+        const WalletConnectorPtr & connFrom = p.connFrom;
+        std::vector<wallet::UtxoEntry> & outputsForUse = p.outputsForUse;
 
         uint64_t utxoAmount = 0;
         uint64_t fee1 = 0;
@@ -1356,10 +1630,10 @@ xbridge::Error App::sendXBridgeTransaction(const std::string & from,
         };
 
         // Select utxos
-        if (!selectUtxos(from, outputs, minTxFee1, minTxFee2, fromAmount,
+        if (!selectUtxos(p.order.from, outputs, minTxFee1, minTxFee2, p.order.fromAmount,
                          TransactionDescr::COIN, outputsForUse, utxoAmount, fee1, fee2))
         {
-            WARN() << "insufficient funds for <" << fromCurrency << "> " << __FUNCTION__;
+            WARN() << "insufficient funds for <" << p.order.fromCurrency << "> " << __FUNCTION__;
             return xbridge::Error::INSIFFICIENT_FUNDS;
         }
 
@@ -1367,20 +1641,20 @@ xbridge::Error App::sendXBridgeTransaction(const std::string & from,
         LOG() << "fee2: " << (static_cast<double>(fee2) / TransactionDescr::COIN);
         LOG() << "amount of used utxo items: " << (static_cast<double>(utxoAmount) / TransactionDescr::COIN)
               << " required amount + fees: "
-              << (static_cast<double>(fromAmount + fee1 + fee2) / TransactionDescr::COIN);
+              << (static_cast<double>(p.order.fromAmount + fee1 + fee2) / TransactionDescr::COIN);
 
         // sign used coins
         for (wallet::UtxoEntry &entry : outputsForUse) {
             std::string signature;
             if (!connFrom->signMessage(entry.address, entry.toString(), signature)) {
-                WARN() << "funds not signed <" << fromCurrency << "> " << __FUNCTION__;
+                WARN() << "funds not signed <" << p.order.fromCurrency << "> " << __FUNCTION__;
                 return xbridge::Error::FUNDS_NOT_SIGNED;
             }
 
             bool isInvalid = false;
             entry.signature = DecodeBase64(signature.c_str(), &isInvalid);
             if (isInvalid) {
-                WARN() << "invalid signature <" << fromCurrency << "> " << __FUNCTION__;
+                WARN() << "invalid signature <" << p.order.fromCurrency << "> " << __FUNCTION__;
                 return xbridge::Error::FUNDS_NOT_SIGNED;
             }
 
@@ -1398,93 +1672,163 @@ xbridge::Error App::sendXBridgeTransaction(const std::string & from,
             xassert(entry.rawAddress.size() == 20 && "incorrect raw address length, need 20 bytes");
         }
 
-        ptr->usedCoins = outputsForUse;
+        // the next orders of the batch use the remaining outputs
+        const std::set<wallet::UtxoEntry> used(outputsForUse.begin(), outputsForUse.end());
+        outputs.erase(std::remove_if(outputs.begin(), outputs.end(), [&used](const wallet::UtxoEntry & u) {
+            return used.count(u) > 0;
+        }), outputs.end());
 
         // lock used coins
-        if (!lockCoins(connFrom->currency, ptr->usedCoins)) {
+        if (!lockCoins(connFrom->currency, outputsForUse)) {
             ERR() << "failed to create order, cannot reuse utxo inputs for " << connFrom->currency
                   << " across multiple orders " << __FUNCTION__;
             return xbridge::Error::INSIFFICIENT_FUNDS;
         }
+        return xbridge::SUCCESS;
+    };
+
+    std::map<std::set<std::string>, Snode> snodes;
+    std::vector<Pending> pending;
+    pending.reserve(orders.size());
+    for (NewOrder & order : orders)
+    {
+        order.status = xbridge::SUCCESS;
+
+        // one service node per currency pair
+        const std::set<std::string> currencies{order.fromCurrency, order.toCurrency};
+        auto it = snodes.find(currencies);
+        if (it == snodes.end())
+            it = snodes.emplace(currencies, findSnode(currencies)).first;
+        if (it->second.status != xbridge::SUCCESS)
+        {
+            order.status = it->second.status;
+            continue;
+        }
+
+        WalletConnectorPtr connFrom;
+        WalletConnectorPtr connTo;
+        order.status = checkOrder(order, connFrom, connTo);
+        if (order.status != xbridge::SUCCESS)
+            continue;
+
+        pending.push_back(Pending{order, it->second, connFrom, connTo, std::vector<wallet::UtxoEntry>()});
     }
 
-    boost::posix_time::ptime timestamp = boost::posix_time::microsec_clock::universal_time();
-    uint64_t timestampValue = timeToInt(timestamp);
+    // Utxo selection
+    {
+        LOCK(m_utxosOrderLock);
+
+        // Available utxos from from wallets, excluding the used utxos
+        std::map<std::string, std::vector<wallet::UtxoEntry>> outputs;
+        for (Pending & p : pending)
+        {
+            if (!outputs.count(p.order.fromCurrency))
+                getAvailableUtxos(p.connFrom, outputs[p.order.fromCurrency]);
+            p.order.status = selectOrderUtxos(p, outputs[p.order.fromCurrency]);
+        }
+    }
 
+    uint256 blockHash;
     {
         LOCK(cs_main);
         blockHash = chainActive.Tip()->pprev->GetBlockHash();
     }
 
-    std::vector<unsigned char> firstUtxoSig = outputsForUse.at(0).signature;
-
-    CHashWriter ss(SER_GETHASH, 0);
-    ss << from
-       << fromCurrency
-       << fromAmount
-       << to
-       << toCurrency
-       << toAmount
-       << timestampValue
-       << blockHash
-       << firstUtxoSig;
-    id = ss.GetHash();
-
-    ptr->hubAddress   = snodeAddress;
-    ptr->sPubKey      = sPubKey;
-    ptr->created      = timestamp;
-    ptr->txtime       = timestamp;
-    ptr->id           = id;
-    ptr->fromAddr     = from;
-    ptr->from         = connFrom->toXAddr(from);
-    ptr->fromCurrency = fromCurrency;
-    ptr->fromAmount   = fromAmount;
-    ptr->toAddr       = to;
-    ptr->to           = connTo->toXAddr(to);
-    ptr->toCurrency   = toCurrency;
-    ptr->toAmount     = toAmount;
-    ptr->blockHash    = blockHash;
-    ptr->role         = 'A';
-
-    LOG() << "using servicenode " << HexStr(pmn.getSnodePubKey()) << " for order " << id.ToString();
-
-    // m key
-    connTo->newKeyPair(ptr->mPubKey, ptr->mPrivKey);
-    assert(ptr->mPubKey.size() == 33 && "bad pubkey size");
+    std::vector<TransactionDescrPtr> created;
+    for (Pending & p : pending)
+    {
+        NewOrder & order = p.order;
+        if (order.status != xbridge::SUCCESS)
+            continue;
 
-    // x key
-    connTo->newKeyPair(ptr->xPubKey, ptr->xPrivKey);
-    assert(ptr->xPubKey.size() == 33 && "bad pubkey size");
+        TransactionDescrPtr ptr(new TransactionDescr);
+        ptr->usedCoins = p.outputsForUse;
+
+        boost::posix_time::ptime timestamp = boost::posix_time::microsec_clock::universal_time();
+        uint64_t timestampValue = timeToInt(timestamp);
+
+        std::vector<unsigned char> firstUtxoSig = p.outputsForUse.at(0).signature;
+
+        CHashWriter ss(SER_GETHASH, 0);
+        ss << order.from
+           << order.fromCurrency
+           << order.fromAmount
+           << order.to
+           << order.toCurrency
+           << order.toAmount
+           << timestampValue
+           << blockHash
+           << firstUtxoSig;
+        const uint256 id = ss.GetHash();
+        order.id        = id;
+        order.blockHash = blockHash;
+
+        ptr->hubAddress   = p.snode.address;
+        ptr->sPubKey      = p.snode.pubKey;
+        ptr->created      = timestamp;
+        ptr->txtime       = timestamp;
+        ptr->id           = id;
+        ptr->fromAddr     = order.from;
+        ptr->from         = p.connFrom->toXAddr(order.from);
+        ptr->fromCurrency = order.fromCurrency;
+        ptr->fromAmount   = order.fromAmount;
+        ptr->toAddr       = order.to;
+        ptr->to           = p.connTo->toXAddr(order.to);
+        ptr->toCurrency   = order.toCurrency;
+        ptr->toAmount     = order.toAmount;
+        ptr->blockHash    = blockHash;
+        ptr->role         = 'A';
+
+        LOG() << "using servicenode " << HexStr(p.snode.snodePubKey) << " for order " << id.ToString();
+
+        WalletConnectorPtr & connTo = p.connTo;
+
+        // m key
+        connTo->newKeyPair(ptr->mPubKey, ptr->mPrivKey);
+        assert(ptr->mPubKey.size() == 33 && "bad pubkey size");
+
+        // x key
+        connTo->newKeyPair(ptr->xPubKey, ptr->xPrivKey);
+        assert(ptr->xPubKey.size() == 33 && "bad pubkey size");
 
 #ifdef LOG_KEYPAIR_VALUES
-    TXLOG() << "generated M keypair for order " << ptr->id.ToString() << std::endl <<
-             "    pub    " << HexStr(ptr->mPubKey) << std::endl <<
-             "    pub id " << HexStr(connTo->getKeyId(ptr->mPubKey)) << std::endl <<
-             "    priv   " << HexStr(ptr->mPrivKey);
-    TXLOG() << "generated X keypair for order " << ptr->id.ToString() << std::endl <<
-             "    pub    " << HexStr(ptr->xPubKey) << std::endl <<
-             "    pub id " << HexStr(connTo->getKeyId(ptr->xPubKey)) << std::endl <<
-             "    priv   " << HexStr(ptr->xPrivKey);
+        TXLOG() << "generated M keypair for order " << ptr->id.ToString() << std::endl <<
+                 "    pub    " << HexStr(ptr->mPubKey) << std::endl <<
+                 "    pub id " << HexStr(connTo->getKeyId(ptr->mPubKey)) << std::endl <<
+                 "    priv   " << HexStr(ptr->mPrivKey);
+        TXLOG() << "generated X keypair for order " << ptr->id.ToString() << std::endl <<
+                 "    pub    " << HexStr(ptr->xPubKey) << std::endl <<
+                 "    pub id " << HexStr(connTo->getKeyId(ptr->xPubKey)) << std::endl <<
+                 "    priv   " << HexStr(ptr->xPrivKey);
 #endif
 
-    // Add destination address
-    updateConnector(connFrom, ptr->from, ptr->fromCurrency);
-    updateConnector(connTo, ptr->to, ptr->toCurrency);
+        // Add destination address
+        updateConnector(p.connFrom, ptr->from, ptr->fromCurrency);
+        updateConnector(connTo, ptr->to, ptr->toCurrency);
 
-    // notify ui about new order
-    xuiConnector.NotifyXBridgeTransactionReceived(ptr);
+        // notify ui about new order
+        xuiConnector.NotifyXBridgeTransactionReceived(ptr);
 
-    // try send immediatelly
-    m_p->sendPendingTransaction(ptr);
+        // try send immediatelly
+        m_p->sendPendingTransaction(ptr);
+
+        created.push_back(ptr);
+    }
 
     {
         LOCK(m_p->m_txLocker);
-        m_p->m_transactions[id] = ptr;
+        for (const TransactionDescrPtr & ptr : created)
+        {
+            m_p->m_transactions.set(ptr->id, ptr);
+            m_p->m_orderBook.add(ptr);
+            m_p->m_txExpiry.schedule(ptr->id, boost::posix_time::to_time_t(ptr->txtime) + Transaction::pendingTTL + 1);
+        }
     }
 
-    LOG() << "order created" << ptr << __FUNCTION__;
+    for (const TransactionDescrPtr & ptr : created)
+        LOG() << "order created" << ptr << __FUNCTION__;
 
-    return xbridge::Error::SUCCESS;
+    return created.size();
 }
 
 //******************************************************************************
@@ -1554,6 +1898,38 @@ bool App::Impl::sendPendingTransaction(const TransactionDescrPtr & ptr)
     return true;
 }
 
+//******************************************************************************
+//******************************************************************************
+bool App::Impl::sendOrderHeartbeat(const std::vector<TransactionDescrPtr> & orders)
+{
+    if (orders.empty())
+    {
+        return false;
+    }
+
+    const TransactionDescrPtr & first = orders.front();
+    if (first->hubAddress.size() == 0)
+    {
+        xassert(!"not defined service node for transaction");
+        return false;
+    }
+
+    XBridgePacketPtr packet(new XBridgePacket(xbcOrderHeartbeat));
+
+    packet->append(static_cast<uint32_t>(orders.size()));
+    for (const TransactionDescrPtr & order : orders)
+    {
+        packet->append(order->id.begin(), 32);
+    }
+
+    // the servicenode checks the signature with the key of the first order
+    packet->sign(first->mPubKey, first->mPrivKey);
+
+    onSend(first->hubAddress, packet->body());
+
+    return true;
+}
+
 //******************************************************************************
 //******************************************************************************
 Error App::acceptXBridgeTransaction(const uint256     & id,
@@ -1576,7 +1952,7 @@ Error App::acceptXBridgeTransaction(const uint256     & id,
             WARN() << "transaction not found " << __FUNCTION__;
             return xbridge::TRANSACTION_NOT_FOUND;
         }
-        ptr = m_p->m_transactions[id];
+        ptr = m_p->m_transactions.at(id);
     }
 
     WalletConnectorPtr connFrom = connectorByCurrency(ptr->fromCurrency);
@@ -1696,21 +2072,9 @@ Error App::acceptXBridgeTransaction(const uint256     & id,
         // Lock the fee utxos
         lockFeeUtxos(ptr->feeUtxos);
 
-        // Exclude the used uxtos
-        excludedUtxos = getAllLockedUtxos(connFrom->currency);
-
-//        std::cout << "All utxos: " << outputs.size() << std::endl;
-//        std::cout << "Exclude utxos: " << excludeUtxos.size() << std::endl;
-//        for (const auto & utxo : excludeUtxos)
-//            std::cout << "    Exclude: " << utxo.txId << " " << utxo.vout << std::endl;
-
-        // Available utxos from from wallet
+        // Available utxos from from wallet, excluding the used utxos
         std::vector<wallet::UtxoEntry> outputs;
-        connFrom->getUnspent(outputs, excludedUtxos);
-
-//        std::cout << "After exclude: " << outputs.size() << std::endl;
-//        for (const auto & utxo : outputs)
-//            std::cout << "    After: " << utxo.txId << " " << utxo.vout << std::endl;
+        getAvailableUtxos(connFrom, outputs);
 
         uint64_t utxoAmount = 0;
         uint64_t fee1       = 0;
@@ -1903,7 +2267,19 @@ xbridge::Error App::cancelXBridgeTransaction(const uint256 &id,
 
 //******************************************************************************
 //******************************************************************************
-void App::cancelMyXBridgeTransactions()
+std::vector<xbridge::Error> App::cancelXBridgeTransactions(const std::vector<uint256> & ids,
+                                                           const TxCancelReason & reason)
+{
+    std::vector<xbridge::Error> res;
+    res.reserve(ids.size());
+    for (const uint256 & id : ids)
+        res.push_back(cancelXBridgeTransaction(id, reason));
+    return res;
+}
+
+//******************************************************************************
+//******************************************************************************
+void App::cancelMyXBridgeTransactions(const int64_t deadline)
 {
     // If service node cancel all open orders
     Exchange & e = Exchange::instance();
@@ -1911,21 +2287,34 @@ void App::cancelMyXBridgeTransactions()
         xbridge::SessionPtr session = m_p->getSession();
         if (!session)
             return;
-        auto txs = e.pendingTransactions();
-        for (auto & tx : txs)
-            session->sendCancelTransaction(tx, crTimeout);
+        const auto txs = e.pendingTransactions();
+        for (const auto & tx : *txs)
+            session->sendCancelTransaction(tx.second, crTimeout);
         return;
     }
 
-    // Local orders (traders)
-    for(const auto &transaction : transactions())
+    // Local orders (traders) that cancelXBridgeTransaction would cancel
+    std::vector<TransactionDescrPtr> mine;
+    const auto txs = transactions();
+    for(const auto &transaction : *txs)
     {
-        if(transaction.second == nullptr)
+        const TransactionDescrPtr & ptr = transaction.second;
+        if (ptr == nullptr || !ptr->isLocal() || ptr->state > TransactionDescr::trCreated)
             continue;
-
-        if(transaction.second->isLocal())
-            cancelXBridgeTransaction(transaction.second->id, crUserRequest);
+        if (!connectorByCurrency(ptr->fromCurrency))
+            continue;
+        mine.push_back(ptr);
     }
+    if (mine.empty())
+        return;
+
+    xbridge::SessionPtr session = m_p->getSession();
+    if (!session)
+        return;
+    const size_t processed = session->sendCancelTransactions(mine, crUserRequest, deadline);
+    if (processed < mine.size())
+        WARN() << "deadline passed, " << mine.size() - processed << " of " << mine.size()
+               << " canceled orders were not processed locally " << __FUNCTION__;
 }
 
 //******************************************************************************
@@ -1984,8 +2373,17 @@ Error App::checkAmount(const std::string & currency,
     }
 
     // Check that wallet balance is larger than the smallest supported balance
-    const auto & excluded = getAllLockedUtxos(currency);
-    if (conn->getWalletBalance(excluded, address) < (static_cast<double>(amount) / TransactionDescr::COIN)) {
+    std::vector<wallet::UtxoEntry> utxos;
+    if (!getAvailableUtxos(conn, utxos)) {
+        WARN() << "insufficient funds for <" << currency << "> " << __FUNCTION__;
+        return xbridge::INSIFFICIENT_FUNDS;
+    }
+    double balance = 0;
+    for (const wallet::UtxoEntry & utxo : utxos) {
+        if (address.empty() || utxo.address == address)
+            balance += utxo.amount;
+    }
+    if (balance < (static_cast<double>(amount) / TransactionDescr::COIN)) {
         WARN() << "insufficient funds for <" << currency << "> " << __FUNCTION__;
         return xbridge::INSIFFICIENT_FUNDS;
     }
@@ -2004,6 +2402,7 @@ bool App::watchForSpentDeposit(TransactionDescrPtr tr) {
         return false;
     LOCK(m_p->m_watchDepositsLocker);
     m_p->m_watchDeposits[tr->id] = tr;
+    m_p->m_watchDepositOutpoints[COutPoint(uint256S(tr->binTxId), tr->binTxVout)] = tr->id;
     return true;
 }
 
@@ -2018,6 +2417,7 @@ void App::unwatchSpentDeposit(TransactionDescrPtr tr) {
         return;
     LOCK(m_p->m_watchDepositsLocker);
     m_p->m_watchDeposits.erase(tr->id);
+    m_p->m_watchDepositOutpoints.erase(COutPoint(uint256S(tr->binTxId), tr->binTxVout));
 }
 
 //******************************************************************************
@@ -2106,6 +2506,7 @@ std::string App::myServicesJSON() const {
     }
     result.emplace_back("xrouterversion", static_cast<int>(XROUTER_PROTOCOL_VERSION));
     result.emplace_back("xbridgeversion", static_cast<int>(version()));
+    result.emplace_back("xbridgefeatures", static_cast<int>(XBRIDGE_FEATURE_ORDER_HEARTBEAT));
     result.emplace_back("xrouter", xrouterConfigVal);
     result.emplace_back("xbridge", xwallets);
     return json_spirit::write_string(json_spirit::Value(result), json_spirit::none, 8);
@@ -2207,40 +2608,36 @@ bool App::findNodeWithService(const std::set<std::string> & services,
 //******************************************************************************
 const std::set<xbridge::wallet::UtxoEntry> App::getFeeUtxos() {
     LOCK(m_utxosLock);
-    return m_feeUtxos;
+    return m_utxos.feeLocked();
 }
 
 //******************************************************************************
 //******************************************************************************
 void App::lockFeeUtxos(std::set<xbridge::wallet::UtxoEntry> & feeUtxos) {
     LOCK(m_utxosLock);
-    m_feeUtxos.insert(feeUtxos.begin(), feeUtxos.end());
+    m_utxos.lockFee(feeUtxos);
 }
 
 //******************************************************************************
 //******************************************************************************
 void App::unlockFeeUtxos(std::set<xbridge::wallet::UtxoEntry> & feeUtxos) {
     LOCK(m_utxosLock);
-    for (const auto & utxo : feeUtxos)
-        m_feeUtxos.erase(utxo);
+    m_utxos.unlockFee(feeUtxos);
 }
 
 //******************************************************************************
 //******************************************************************************
 const std::set<xbridge::wallet::UtxoEntry> App::getLockedUtxos(const std::string & token) {
     LOCK(m_utxosLock);
-    const auto & utxos = m_utxosDict[token];
-    return utxos;
+    return m_utxos.locked(token);
 }
 
 //******************************************************************************
 //******************************************************************************
 const std::set<xbridge::wallet::UtxoEntry> App::getAllLockedUtxos(const std::string & token) {
-    auto & fees = getFeeUtxos();
-    auto & other = getLockedUtxos(token);
-    std::set<xbridge::wallet::UtxoEntry> all;
-    all.insert(fees.begin(), fees.end());
-    all.insert(other.begin(), other.end());
+    LOCK(m_utxosLock);
+    std::set<xbridge::wallet::UtxoEntry> all = m_utxos.locked(token);
+    all.insert(m_utxos.feeLocked().begin(), m_utxos.feeLocked().end());
     return all;
 }
 
@@ -2248,41 +2645,38 @@ const std::set<xbridge::wallet::UtxoEntry> App::getAllLockedUtxos(const std::str
 //******************************************************************************
 bool App::lockCoins(const std::string & token, const std::vector<wallet::UtxoEntry> & utxos) {
     LOCK(m_utxosLock);
-
-    // Get existing coins
-    if (!m_utxosDict.count(token)) {
-        std::set<wallet::UtxoEntry> o(utxos.begin(), utxos.end());
-        m_utxosDict[token] = o;
-        return true;
-    }
-
-    // Check if existing utxos are already locked, don't accept this request if so
-    auto & o = m_utxosDict[token];
-    for (const wallet::UtxoEntry & u : utxos) {
-        if (o.count(u))
-            return false;
-    }
-
-    // Add new utxos
-    o.insert(utxos.begin(), utxos.end());
-
-    return true;
+    return m_utxos.lock(token, utxos);
 }
 
 //******************************************************************************
 //******************************************************************************
 void App::unlockCoins(const std::string & token, const std::vector<wallet::UtxoEntry> & utxos) {
     LOCK(m_utxosLock);
+    m_utxos.unlock(token, utxos);
+}
 
-    // If no existing, ignore
-    if (!m_utxosDict.count(token))
-        return;
+//******************************************************************************
+//******************************************************************************
+bool App::getAvailableUtxos(const WalletConnectorPtr & conn, std::vector<wallet::UtxoEntry> & utxos) {
+    {
+        LOCK(m_utxosLock);
+        if (m_utxos.fresh(conn->currency, GetTime())) {
+            utxos = m_utxos.available(conn->currency);
+            return true;
+        }
+    }
+
+    // Query the wallet without holding the lock, locked utxos are excluded by the pool
+    std::vector<wallet::UtxoEntry> unspent;
+    if (!conn->getUnspent(unspent, std::set<wallet::UtxoEntry>())) {
+        LOG() << "getUnspent failed " << __FUNCTION__;
+        return false;
+    }
 
-    // Remove utxos if they exist
-    auto & o = m_utxosDict[token];
-    for (const wallet::UtxoEntry & u : utxos)
-        if (o.count(u))
-            o.erase(u);
+    LOCK(m_utxosLock);
+    m_utxos.update(conn->currency, unspent, GetTime());
+    utxos = m_utxos.available(conn->currency);
+    return true;
 }
 
 //******************************************************************************
@@ -2493,15 +2887,28 @@ bool App::selectUtxos(const std::string &addr, const std::vector<wallet::UtxoEnt
 void App::Impl::checkAndRelayPendingOrders() {
     // Try and rebroadcast my orders older than N seconds (see below)
     auto currentTime = boost::posix_time::second_clock::universal_time();
-    std::map<uint256, TransactionDescrPtr> txs;
+    TransactionMapSnapshot txs;
     {
         LOCK(m_txLocker);
-        txs = m_transactions;
+        txs = m_transactions.snapshot();
     }
-    if (txs.empty())
+    if (txs->empty())
         return;
 
-    for (const auto & i : txs) {
+    std::map<std::vector<unsigned char>, std::vector<TransactionDescrPtr>> heartbeats; // by hub address
+    std::map<std::vector<unsigned char>, bool> snodeFeatures;
+    auto heartbeatSupported = [&snodeFeatures](const std::vector<unsigned char> & snodePubKey) -> bool {
+        auto it = snodeFeatures.find(snodePubKey);
+        if (it == snodeFeatures.end()) {
+            const auto snode = sn::ServiceNodeMgr::instance().getSn(snodePubKey);
+            const bool supported = !snode.isNull()
+                    && (snode.getXBridgeFeatures() & XBRIDGE_FEATURE_ORDER_HEARTBEAT) != 0;
+            it = snodeFeatures.emplace(snodePubKey, supported).first;
+        }
+        return it->second;
+    };
+
+    for (const auto & i : *txs) {
         TransactionDescrPtr order = i.second;
         if (!order->isLocal()) // only process local orders
             continue;
@@ -2535,7 +2942,24 @@ void App::Impl::checkAndRelayPendingOrders() {
         }
         else if (pendingOrderShouldRebroadcast && order->state == xbridge::TransactionDescr::trPending) {
             order->updateTimestamp();
-            sendPendingTransaction(order);
+            // The servicenode relays the order back on each refresh. Orders it relayed since
+            // the last heartbeat only need a heartbeat, the others are sent again in full.
+            if (!order->heartbeatSent && heartbeatSupported(order->sPubKey)) {
+                order->heartbeatSent = true;
+                heartbeats[order->hubAddress].push_back(order);
+            } else {
+                order->heartbeatSent = false;
+                sendPendingTransaction(order);
+            }
+        }
+    }
+
+    // One heartbeat per servicenode and XBRIDGE_MAX_HEARTBEAT_ORDERS orders
+    for (const auto & item : heartbeats) {
+        const std::vector<TransactionDescrPtr> & orders = item.second;
+        for (size_t i = 0; i < orders.size(); i += XBRIDGE_MAX_HEARTBEAT_ORDERS) {
+            const size_t end = std::min<size_t>(i + XBRIDGE_MAX_HEARTBEAT_ORDERS, orders.size());
+            sendOrderHeartbeat(std::vector<TransactionDescrPtr>(orders.begin() + i, orders.begin() + end));
         }
     }
 }
@@ -2560,105 +2984,230 @@ void App::Impl::checkWatchesOnDepositSpends()
         watches = m_watchDeposits;
     }
 
-    // Check blockchain for spends
-    xbridge::App & app = xbridge::App::instance();
+    // Wallets with a zmq feed are checked when the feed reports a block or a spend, and
+    // polled every ZMQ_FALLBACK_POLL_INTERVAL in case notifications were lost
+    std::set<std::string> polled;
+    std::set<std::string> skipped;
+    {
+        const int64_t now = GetTime();
+        std::set<std::string> currencies;
+        for (auto & item : watches)
+            currencies.insert(item.second->fromCurrency);
+        for (const auto & currency : currencies) {
+            if (!hasZmqFeed(currency))
+                continue;
+            LOCK(m_watchDepositsLocker);
+            if (m_depositPollTimes[currency] + ZMQ_FALLBACK_POLL_INTERVAL > now)
+                skipped.insert(currency);
+            else
+                polled.insert(currency);
+        }
+    }
+
+    // Check blockchain for spends, each wallet on the wallet reactor. The last task to finish
+    // (or to be dropped on shutdown) releases the watch.
+    std::map<std::string, std::vector<TransactionDescrPtr>> byCurrency;
     for (auto & item : watches) {
         auto & xtx = item.second;
-        if (xtx->isWatching())
+        if (xtx->isWatching() || skipped.count(xtx->fromCurrency))
             continue;
+        byCurrency[xtx->fromCurrency].push_back(xtx);
+    }
+
+    std::shared_ptr<void> done(nullptr, [this, polled](void*) {
+        LOCK(m_watchDepositsLocker);
+        const int64_t now = GetTime();
+        for (const auto & currency : polled)
+            m_depositPollTimes[currency] = now;
+        m_watching = false;
+    });
+    for (auto & item : byCurrency) {
+        std::vector<TransactionDescrPtr> xtxs = std::move(item.second);
+        WalletReactor::instance().post(item.first, [this, xtxs, done]() {
+            for (const auto & xtx : xtxs)
+                checkDepositSpend(xtx);
+        });
+    }
+}
 
-        WalletConnectorPtr connFrom = app.connectorByCurrency(xtx->fromCurrency);
-        if (!connFrom)
-            continue; // skip (maybe wallet went offline)
+//******************************************************************************
+//******************************************************************************
+void App::Impl::checkDepositSpend(const TransactionDescrPtr & xtx)
+{
+    xbridge::App & app = xbridge::App::instance();
+    WalletConnectorPtr connFrom = app.connectorByCurrency(xtx->fromCurrency);
+    if (!connFrom)
+        return; // skip (maybe wallet went offline)
 
-        xtx->setWatching(true);
+    xtx->setWatching(true);
 
-        rpc::WalletInfo info;
-        if (!connFrom->getInfo(info)) {
-            xtx->setWatching(false);
-            continue;
-        }
+    rpc::WalletInfo info;
+    if (!connFrom->getInfo(info)) {
+        xtx->setWatching(false);
+        return;
+    }
 
-        // If we don't have the secret yet, look for the pay tx
-        if (!xtx->hasSecret()) {
-            // Obtain the transactions to search (current mempool or current block)
-            std::vector<std::string> txids;
-            if (xtx->getWatchStartBlock() == info.blocks) {
-                if (!connFrom->getRawMempool(txids)) {
-                    xtx->setWatching(false);
-                    continue;
+    // If we don't have the secret yet, look for the pay tx
+    if (!xtx->hasSecret()) {
+        // Obtain the transactions to search (current mempool or current block)
+        std::vector<std::string> txids;
+        std::string spendTxId;
+        if (connFrom->findUTXOSpend(xtx->binTxId, xtx->binTxVout, spendTxId)) {
+            // The spend was looked up directly, there are no transactions to search
+            if (!spendTxId.empty())
+                txids.push_back(spendTxId);
+        } else if (xtx->getWatchStartBlock() == info.blocks) {
+            if (!connFrom->getRawMempool(txids)) {
+                xtx->setWatching(false);
+                return;
+            }
+        } else { // check in next block to search
+            uint32_t blocks = xtx->getWatchCurrentBlock();
+            bool failure = false;
+
+            // Search all tx in blocks up to current block
+            while (blocks <= info.blocks) {
+                std::string blockHash;
+                std::vector<std::string> txs;
+                if (!connFrom->getBlockHash(blocks, blockHash)) {
+                    failure = true;
+                    break;
                 }
-            } else { // check in next block to search
-                uint32_t blocks = xtx->getWatchCurrentBlock();
-                bool failure = false;
-
-                // Search all tx in blocks up to current block
-                while (blocks <= info.blocks) {
-                    std::string blockHash;
-                    std::vector<std::string> txs;
-                    if (!connFrom->getBlockHash(blocks, blockHash)) {
-                        failure = true;
-                        break;
-                    }
-                    if (!connFrom->getTransactionsInBlock(blockHash, txs)) {
-                        failure = true;
-                        break;
-                    }
-                    txids.insert(txids.end(), txs.begin(), txs.end());
-                    xtx->setWatchBlock(++blocks); // mark that we've processed current block
+                if (!connFrom->getTransactionsInBlock(blockHash, txs)) {
+                    failure = true;
+                    break;
                 }
+                txids.insert(txids.end(), txs.begin(), txs.end());
+                xtx->setWatchBlock(++blocks); // mark that we've processed current block
+            }
 
-                // If any failure, skip
-                if (failure) {
-                    xtx->setWatching(false);
-                    continue;
-                }
+            // If any failure, skip
+            if (failure) {
+                xtx->setWatching(false);
+                return;
             }
+        }
 
-            // Look for the spent pay tx
-            for (auto & txid : txids) {
-                bool isSpent = false;
-                if (connFrom->isUTXOSpentInTx(txid, xtx->binTxId, xtx->binTxVout, isSpent) && isSpent) {
-                    // Found valid spent pay tx, now assign
-                    xtx->setOtherPayTxId(txid);
-                    xtx->doneWatching(); // report that we're done looking
-                    break;
-                }
+        // Look for the spent pay tx
+        for (auto & txid : txids) {
+            bool isSpent = false;
+            if (connFrom->isUTXOSpentInTx(txid, xtx->binTxId, xtx->binTxVout, isSpent) && isSpent) {
+                // Found valid spent pay tx, now assign
+                xtx->setOtherPayTxId(txid);
+                xtx->doneWatching(); // report that we're done looking
+                break;
             }
         }
+    }
 
-        // If a redeem of origin deposit or pay tx is successful
-        bool done = false;
+    // If a redeem of origin deposit or pay tx is successful
+    bool done = false;
 
-        // If lockTime has expired on original deposit, attempt to redeem it
-        if (xtx->lockTime <= info.blocks) {
-            xbridge::SessionPtr session = getSession();
-            int32_t errCode = 0;
-            if (session->redeemOrderDeposit(xtx, errCode))
-                done = true;
-        }
+    // If lockTime has expired on original deposit, attempt to redeem it
+    if (xtx->lockTime <= info.blocks) {
+        xbridge::SessionPtr session = getSession();
+        int32_t errCode = 0;
+        if (session->redeemOrderDeposit(xtx, errCode))
+            done = true;
+    }
 
-        // If we've found the spent paytx and haven't redeemed it yet, do that now
-        if (xtx->isDoneWatching() && !xtx->hasRedeemedCounterpartyDeposit()) {
-            xbridge::SessionPtr session = getSession();
-            int32_t errCode = 0;
-            if (session->redeemOrderCounterpartyDeposit(xtx, errCode))
-                done = true;
-        }
+    // If we've found the spent paytx and haven't redeemed it yet, do that now
+    if (xtx->isDoneWatching() && !xtx->hasRedeemedCounterpartyDeposit()) {
+        xbridge::SessionPtr session = getSession();
+        int32_t errCode = 0;
+        if (session->redeemOrderCounterpartyDeposit(xtx, errCode))
+            done = true;
+    }
 
-        if (done) {
-            xtx->doneWatching();
-            xbridge::App & xapp = xbridge::App::instance();
-            xapp.unwatchSpentDeposit(xtx);
-        }
+    if (done) {
+        xtx->doneWatching();
+        xbridge::App & xapp = xbridge::App::instance();
+        xapp.unwatchSpentDeposit(xtx);
+    }
 
-        xtx->setWatching(false);
+    xtx->setWatching(false);
+}
+
+//******************************************************************************
+//******************************************************************************
+void App::Impl::updateZmqFeed(const std::string & currency)
+{
+    const std::string address = settings().get<std::string>(currency + ".ZmqAddress", "");
+
+    std::unique_ptr<ZmqFeed> old; // stopped outside the lock
+    LOCK(m_zmqFeedsLock);
+    auto it = m_zmqFeeds.find(currency);
+    if (it != m_zmqFeeds.end() && it->second->getAddress() == address)
+        return;
+    if (it != m_zmqFeeds.end()) {
+        old = std::move(it->second);
+        m_zmqFeeds.erase(it);
     }
+    if (address.empty())
+        return;
+    m_zmqFeeds[currency] = MakeUnique<ZmqFeed>(currency, address,
+        [this, currency](const std::string & topic, const std::vector<unsigned char> & body) {
+            onZmqNotification(currency, topic, body);
+        });
+}
 
-    {
+//******************************************************************************
+//******************************************************************************
+bool App::Impl::hasZmqFeed(const std::string & currency)
+{
+    LOCK(m_zmqFeedsLock);
+    auto it = m_zmqFeeds.find(currency);
+    return it != m_zmqFeeds.end() && it->second->isActive();
+}
+
+//******************************************************************************
+//******************************************************************************
+void App::Impl::onZmqNotification(const std::string & currency, const std::string & topic,
+                                  const std::vector<unsigned char> & body)
+{
+    if (topic == "rawtx") {
+        CMutableTransaction mtx;
+        try {
+            CDataStream ss(body, SER_NETWORK, PROTOCOL_VERSION);
+            ss >> mtx;
+        } catch (...) {
+            return; // not a bitcoin serialized tx, the poll finds the spend
+        }
+
+        bool found{false};
+        {
+            LOCK(m_watchDepositsLocker);
+            if (m_watchDepositOutpoints.empty())
+                return;
+            std::string txid;
+            for (const auto & in : mtx.vin) {
+                auto it = m_watchDepositOutpoints.find(in.prevout);
+                if (it == m_watchDepositOutpoints.end())
+                    continue;
+                auto watch = m_watchDeposits.find(it->second);
+                if (watch == m_watchDeposits.end() || watch->second->fromCurrency != currency)
+                    continue;
+                auto & xtx = watch->second;
+                if (xtx->hasSecret() || xtx->isDoneWatching())
+                    continue;
+                if (txid.empty())
+                    txid = mtx.GetHash().GetHex();
+                LOG() << "zmq found the spend of the deposit of order " << xtx->id.GetHex() << " in tx " << txid;
+                xtx->setOtherPayTxId(txid);
+                xtx->doneWatching();
+                found = true;
+            }
+            if (!found)
+                return;
+            m_depositPollTimes.erase(currency);
+        }
+    } else if (topic == "hashblock") {
         LOCK(m_watchDepositsLocker);
-        m_watching = false;
+        m_depositPollTimes.erase(currency); // locktimes may have expired
+    } else {
+        return;
     }
+    m_walletsIo.post(boost::bind(&Impl::checkWatchesOnDepositSpends, this));
 }
 
 //******************************************************************************
@@ -2709,37 +3258,45 @@ void App::Impl::watchTraderDeposits()
         return done;
     };
 
-    // Check blockchain for spends
-    xbridge::App & app = xbridge::App::instance();
+    // Check blockchain for spends, each trader's wallet on the wallet reactor. The last task to
+    // finish (or to be dropped on shutdown) unwatches the refunded orders and releases the watch.
+    std::shared_ptr<void> done(nullptr, [this, watches](void*) {
+        xbridge::App & xapp = xbridge::App::instance();
+        for (auto & item : watches) {
+            auto & tr = item.second;
+            if ((tr->a_refunded() && tr->b_refunded()) || tr->state() == xbridge::Transaction::trFinished)
+                xapp.unwatchTraderDeposit(tr);
+        }
+        LOCK(m_watchTradersLocker);
+        m_watchingTraders = false;
+    });
+
+    xbridge::App & xapp = xbridge::App::instance();
+    xbridge::SessionPtr session = getSession();
     for (auto & item : watches) {
         auto & tr = item.second;
 
-        xbridge::App & xapp = xbridge::App::instance();
-        xbridge::SessionPtr session = getSession();
-
         // Trader A check (if not refunded, has valid refund tx, and order not marked finished)
         if (!tr->a_refunded() && !tr->a_refTx().empty() && tr->state() != xbridge::Transaction::trFinished) {
             WalletConnectorPtr connA = xapp.connectorByCurrency(tr->a_currency());
-            if (connA && check(session, tr->id().ToString(), connA, tr->a_lockTime(), tr->a_refTx())) {
-                tr->a_setRefunded(true);
+            if (connA) {
+                WalletReactor::instance().post(connA->currency, [check, session, tr, connA, done]() {
+                    if (check(session, tr->id().ToString(), connA, tr->a_lockTime(), tr->a_refTx()))
+                        tr->a_setRefunded(true);
+                });
             }
         }
 
         // Trader B check (if not refunded, has valid refund tx, and order not marked finished)
         if (!tr->b_refunded() && !tr->b_refTx().empty() && tr->state() != xbridge::Transaction::trFinished) {
-            WalletConnectorPtr connB = app.connectorByCurrency(tr->b_currency());
-            if (connB && check(session, tr->id().ToString(), connB, tr->b_lockTime(), tr->b_refTx())) {
-                tr->b_setRefunded(true);
+            WalletConnectorPtr connB = xapp.connectorByCurrency(tr->b_currency());
+            if (connB) {
+                WalletReactor::instance().post(connB->currency, [check, session, tr, connB, done]() {
+                    if (check(session, tr->id().ToString(), connB, tr->b_lockTime(), tr->b_refTx()))
+                        tr->b_setRefunded(true);
+                });
             }
         }
-
-        if ((tr->a_refunded() && tr->b_refunded()) || tr->state() == xbridge::Transaction::trFinished)
-            xapp.unwatchTraderDeposit(tr);
-    }
-
-    {
-        LOCK(m_watchTradersLocker);
-        m_watchingTraders = false;
     }
 }
 
@@ -2751,27 +3308,33 @@ void App::Impl::checkAndEraseExpiredTransactions()
     Exchange & e = Exchange::instance();
     e.eraseExpiredTransactions();
 
-    // check client transactions
-    auto currentTime = boost::posix_time::microsec_clock::universal_time();
-    std::map<uint256, TransactionDescrPtr> txs;
-    std::set<uint256> forErase;
+    // check the client transactions that are due
+    const int64_t now = GetTime();
+    std::vector<TransactionDescrPtr> txs;
     {
         LOCK(m_txLocker);
-        txs = m_transactions;
+        for (const uint256 & id : m_txExpiry.advance(now))
+        {
+            if (m_transactions.count(id))
+                txs.push_back(m_transactions.at(id));
+        }
     }
     if (txs.empty())
     {
         return;
     }
     // check...
-    for (const std::pair<uint256, TransactionDescrPtr> & i : txs)
+    auto currentTime = boost::posix_time::microsec_clock::universal_time();
+    std::set<uint256> forErase;
+    std::map<uint256, int64_t> nextChecks;
+    for (const TransactionDescrPtr & tx : txs)
     {
-        TransactionDescrPtr tx = i.second;
         bool stateChanged = false;
         {
             TRY_LOCK(tx->_lock, txlock);
             if (!txlock)
             {
+                nextChecks[tx->id] = now + 1;
                 continue;
             }
             boost::posix_time::time_duration td = currentTime - tx->txtime;
@@ -2799,25 +3362,35 @@ void App::Impl::checkAndEraseExpiredTransactions()
                       tx->state == xbridge::TransactionDescr::trOffline) &&
                      td.total_seconds() > xbridge::Transaction::TTL)
             {
-                forErase.insert(i.first);
+                forErase.insert(tx->id);
+                continue;
             }
             else if (tx->state == xbridge::TransactionDescr::trPending &&
                      tc.total_seconds() > xbridge::Transaction::deadlineTTL)
             {
-                forErase.insert(i.first);
+                forErase.insert(tx->id);
+                continue;
             }
+            nextChecks[tx->id] = nextExpiryCheck(tx, now);
         }
         if (stateChanged)
         {
             xuiConnector.NotifyXBridgeTransactionChanged(tx->id);
         }
     }
-    // ...erase expired...
+    // ...erase expired and reschedule the others
     {
         LOCK(m_txLocker);
         for (const uint256 & id : forErase)
         {
             m_transactions.erase(id);
+            m_orderBook.remove(id);
+        }
+        for (const auto & item : nextChecks)
+        {
+            // an order updated in the meantime was scheduled already
+            if (m_transactions.count(item.first) && !m_txExpiry.has(item.first))
+                m_txExpiry.schedule(item.first, item.second);
         }
     }
     // ...and notify
@@ -2827,6 +3400,87 @@ void App::Impl::checkAndEraseExpiredTransactions()
 //    }
 }
 
+//******************************************************************************
+//******************************************************************************
+int64_t App::Impl::nextExpiryCheck(const TransactionDescrPtr & tx, const int64_t now) const
+{
+    // whole seconds are compared, a check that's early is rescheduled
+    auto after = [](const boost::posix_time::ptime & t, const int ttl) -> int64_t {
+        return boost::posix_time::to_time_t(t) + ttl + 1;
+    };
+
+    int64_t next;
+    switch (tx->state)
+    {
+        case xbridge::TransactionDescr::trNew:
+            next = after(tx->txtime, xbridge::Transaction::pendingTTL);
+            break;
+        case xbridge::TransactionDescr::trPending:
+            next = std::min(after(tx->txtime, xbridge::Transaction::pendingTTL),
+                            after(tx->created, xbridge::Transaction::deadlineTTL));
+            break;
+        case xbridge::TransactionDescr::trExpired:
+        case xbridge::TransactionDescr::trOffline:
+            // an update of the order makes it pending again, see checkTransactionExpiry()
+            next = after(tx->txtime, xbridge::Transaction::TTL);
+            break;
+        default:
+            // orders in other states don't expire here, look at them now and then
+            next = now + xbridge::Transaction::pendingTTL;
+            break;
+    }
+    return std::max(next, now + 1);
+}
+
+//******************************************************************************
+//******************************************************************************
+void App::Impl::persistHistory()
+{
+    const auto expired = boost::posix_time::microsec_clock::universal_time()
+                       - boost::posix_time::seconds(HISTORY_MEMORY_TTL);
+
+    LOCK(m_txLocker);
+
+    if (!m_historyDb)
+        return;
+
+    if (!m_historyPending.empty())
+    {
+        std::vector<OrderHistoryRecord> records;
+        records.reserve(m_historyPending.size());
+        for (const uint256 & id : m_historyPending)
+        {
+            if (m_historicTransactions.count(id))
+                records.emplace_back(*m_historicTransactions.at(id));
+        }
+        if (!m_historyDb->write(records))
+        {
+            ERR() << "failed to write " << records.size() << " orders to the order history store " << __FUNCTION__;
+            return;
+        }
+        m_historyPending.clear();
+    }
+
+    // the store keeps the older history, don't copy the map of a snapshot in use for nothing
+    bool found{false};
+    for (const auto & it : m_historicTransactions)
+    {
+        found = it.second->txtime < expired;
+        if (found)
+            break;
+    }
+    if (!found)
+        return;
+    auto mp = &m_historicTransactions.modify();
+    for (auto it = mp->begin(); it != mp->end(); )
+    {
+        if (it->second->txtime < expired)
+            mp->erase(it++);
+        else
+            ++it;
+    }
+}
+
 //******************************************************************************
 //******************************************************************************
 void App::Impl::onTimer()
@@ -2848,7 +3502,7 @@ void App::Impl::onTimer()
         static uint32_t updateActiveWallets_c = 0;
         if (++updateActiveWallets_c == 2) { // every ~30 seconds
             updateActiveWallets_c = 0;
-            io->post(boost::bind(&xbridge::App::updateActiveWallets, app));
+            m_walletsIo.post(boost::bind(&xbridge::App::updateActiveWallets, app));
         }
 
         // Check orders
@@ -2857,6 +3511,9 @@ void App::Impl::onTimer()
         // erase expired tx
         io->post(boost::bind(&Impl::checkAndEraseExpiredTransactions, this));
 
+        // store the order history
+        io->post(boost::bind(&Impl::persistHistory, this));
+
         Exchange & e = Exchange::instance();
         auto isServicenode = e.isStarted();
 
@@ -2881,26 +3538,20 @@ void App::Impl::onTimer()
             }
         }
 
-        // unprocessed packets
+        // unprocessed packets whose retry time passed
         {
-            static uint32_t counter = 0;
-            if (++counter == 2)
+            std::vector<XBridgePacketPtr> packets;
+            size_t expired{0};
             {
-                counter = 0;
-                std::map<uint256, XBridgePacketPtr> map;
-                {
-                    LOCK(m_ppLocker);
-                    map = m_pendingPackets;
-                    m_pendingPackets.clear();
-                }
-                for (const std::pair<uint256, XBridgePacketPtr> & item : map)
-                {
-
-                    xbridge::SessionPtr s = getSession();
-                    XBridgePacketPtr packet   = item.second;
-                    io->post(boost::bind(&xbridge::Session::processPacket, s, packet, nullptr));
-
-                }
+                LOCK(m_ppLocker);
+                packets = m_pendingPackets.due(GetTime(), expired);
+            }
+            if (expired > 0)
+                WARN() << "dropped " << expired << " expired pending packets " << __FUNCTION__;
+            for (const XBridgePacketPtr & packet : packets)
+            {
+                // posted to the thread of the order
+                dispatchPacket(packet);
             }
         }
     }
@@ -2910,13 +3561,16 @@ void App::Impl::onTimer()
 }
 
 /**
- * Clears the xbridge message mempool. This is not threadsafe, locks required outside this func.
+ * Returns the filter of processed xbridge messages. The filter holds as many hashes as
+ * -maxmempoolxbridge allowed at an estimated 64 bytes per hash, the oldest hashes age out
+ * instead of the whole history being cleared. This is not threadsafe, locks required outside this func.
  */
-void App::clearMempool() {
-    auto count = m_p->m_processedMessages.size();
-    auto maxMBytes = static_cast<unsigned int>(gArgs.GetArg("-maxmempoolxbridge", 128)) * 1000000;
-    if (count * 64 > maxMBytes) // estimated 64 bytes per hash
-        m_p->m_processedMessages.clear();
+CRollingBloomFilter & App::knownMessages() {
+    if (!m_p->m_processedMessages) {
+        const auto maxBytes = static_cast<unsigned int>(gArgs.GetArg("-maxmempoolxbridge", 128)) * 1000000;
+        m_p->m_processedMessages = MakeUnique<CRollingBloomFilter>(std::max(maxBytes / 64, 1000u), 0.000001);
+    }
+    return *m_p->m_processedMessages;
 }
 
 
@@ -8,12 +8,16 @@
 #ifndef BLOCKNET_XBRIDGE_XBRIDGEAPP_H
 #define BLOCKNET_XBRIDGE_XBRIDGEAPP_H
 
+#include <xbridge/util/snapshotmap.h>
 #include <xbridge/util/xbridgeerror.h>
 #include <xbridge/util/xutil.h>
 #include <xbridge/xbridgedef.h>
+#include <xbridge/xbridgeorderbook.h>
+#include <xbridge/xbridgeorderhistory.h>
 #include <xbridge/xbridgepacket.h>
 #include <xbridge/xbridgesession.h>
 #include <xbridge/xbridgetransactiondescr.h>
+#include <xbridge/xbridgeutxopool.h>
 #include <xbridge/xbridgewalletconnector.h>
 
 #include <uint256.h>
@@ -33,6 +37,7 @@
 // #include <Ws2tcpip.h>
 #endif
 
+class CRollingBloomFilter;
 class xQuery;
 class CurrencyPair;
 class xAggregate;
@@ -61,6 +66,8 @@ private:
     virtual ~App();
 
 public:
+    typedef SnapshotMap<uint256, TransactionDescrPtr> TransactionSnapshotMap;
+    typedef TransactionSnapshotMap::Snapshot TransactionMapSnapshot;
 
     /**
      * @brief instance - the classical implementation of singletone
@@ -139,6 +146,23 @@ public:
             : id{id}, txtime{txtime}, use_count{use_count} {}
     };
 
+    /**
+     * @brief parameters and result of an order placed by sendXBridgeTransactions()
+     */
+    struct NewOrder
+    {
+        std::string from;
+        std::string fromCurrency;
+        uint64_t    fromAmount{0};
+        std::string to;
+        std::string toCurrency;
+        uint64_t    toAmount{0};
+
+        Error       status{SUCCESS};
+        uint256     id;
+        uint256     blockHash;
+    };
+
     // Settings
     /**
      * @brief Load xbridge.conf settings file.
@@ -160,14 +184,33 @@ public:
     TransactionDescrPtr transaction(const uint256 & id) const;
     /**
      * @brief transactions
-     * @return map of all transaction
+     * @return snapshot of the map of all transaction, safe to read without locking
+     */
+    TransactionMapSnapshot transactions() const;
+    /**
+     * @brief orderBookLevels - pending orders selling fromCurrency for toCurrency grouped
+     * by price, best price first, without copying the list of transactions
+     * @param fromCurrency
+     * @param toCurrency
+     * @param maxLevels - maximum number of price levels
+     * @return
      */
-    std::map<uint256, xbridge::TransactionDescrPtr> transactions() const;
+    std::vector<OrderBook::Level> orderBookLevels(const std::string & fromCurrency,
+                                                  const std::string & toCurrency,
+                                                  const size_t maxLevels) const;
     /**
      * @brief history
-     * @return map of historical transaction (local canceled and finished)
+     * @return snapshot of the map of historical transaction (local canceled and finished)
+     */
+    TransactionMapSnapshot history() const;
+
+    /**
+     * @brief historyOrders - orders of the persisted order history matching the query,
+     * newest first. Older history is only kept in the store, not in history().
+     * @param query - pair, state, time range and page of the orders
+     * @return detached copies of the matching orders
      */
-    std::map<uint256, xbridge::TransactionDescrPtr> history() const;
+    std::vector<TransactionDescrPtr> historyOrders(const OrderHistoryQuery & query);
 
     /**
      * @brief history_matches returns details of local transactions that match given filter,
@@ -200,6 +243,13 @@ public:
      */
     void appendTransaction(const TransactionDescrPtr & ptr);
 
+    /**
+     * @brief checkTransactionExpiry - checks the state of the order on the next timer tick,
+     * e.g. after its timestamp was updated
+     * @param id - id of transaction
+     */
+    void checkTransactionExpiry(const uint256 & id);
+
     /**
      * @brief moveTransactionToHistory - move transaction from list of opened transactions
      * to list (map) historycal transactions,
@@ -228,6 +278,14 @@ public:
                                  const uint64_t & toAmount,
                                  uint256 & id,
                                  uint256& blockHash);
+    /**
+     * @brief sendXBridgeTransactions - create new xbridge transactions and send to network.
+     * The service nodes, wallet utxos and block hash are looked up once for all orders,
+     * and the utxos are selected and locked in one pass.
+     * @param orders - orders to create, status, id and blockHash are set on each order
+     * @return number of created orders
+     */
+    size_t sendXBridgeTransactions(std::vector<NewOrder> & orders);
     // TODO make protected
     /**
      * @brief sendPendingTransaction - send packet with data of pending transaction to network
@@ -254,10 +312,19 @@ public:
      * @return  status of operation
      */
     xbridge::Error cancelXBridgeTransaction(const uint256 &id, const TxCancelReason &reason);
+    /**
+     * @brief cancelXBridgeTransactions - cancel xbridge transactions
+     * @param ids - ids of transactions
+     * @param reason reason of cancel
+     * @return status of operation for each transaction
+     */
+    std::vector<xbridge::Error> cancelXBridgeTransactions(const std::vector<uint256> & ids, const TxCancelReason &reason);
     /**
      * @brief cancelMyXBridgeTransactions - canclel all local transactions
+     * @param deadline GetTimeMillis() time after which no more orders are cancelled locally, 0 for none.
+     * The cancels are broadcast for all orders.
      */
-    void cancelMyXBridgeTransactions();
+    void cancelMyXBridgeTransactions(const int64_t deadline = 0);
 
     /**
      * @brief isValidAddress checks the correctness of the address
@@ -417,28 +484,32 @@ public:
     /**
      * @brief onMessageReceived  call when message from xbridge network received
      * @param id packet id
-     * @param message
+     * @param message - packet over the network receive buffer, copied once if processed
      * @param state
      */
     void onMessageReceived(const std::vector<unsigned char> & id,
-                           const std::vector<unsigned char> & message,
+                           const XBridgePacketView & message,
                            CValidationState & state);
     //
     /**
      * @brief onBroadcastReceived - processing recieved   broadcast message
-     * @param message
+     * @param message - packet over the network receive buffer, copied once if processed
      * @param state
      */
-    void onBroadcastReceived(const std::vector<unsigned char> & message,
+    void onBroadcastReceived(const XBridgePacketView & message,
                              CValidationState & state);
 
     /**
-     * @brief processLater
-     * @param txid
+     * @brief processLater - defer the packet of the order, it is processed again when the
+     * dependency is ready or on a retry that backs off each time the order is deferred
+     * @param txid - id of order
      * @param packet
+     * @param awaiting - dependency of the packet (the currency of a missing wallet), empty
+     * if the packet is only retried on time
      * @return
      */
-    bool processLater(const uint256 & txid, const XBridgePacketPtr & packet);
+    bool processLater(const uint256 & txid, const XBridgePacketPtr & packet,
+                      const std::string & awaiting = std::string());
     /**
      * @brief removePackets remove packet from pending packets (if added)
      * @param txid
@@ -551,6 +622,15 @@ public:
      */
     void unlockCoins(const std::string & token, const std::vector<wallet::UtxoEntry> & utxos);
 
+    /**
+     * @brief Returns the unspent utxos of the wallet that aren't locked by orders or fee
+     * payments. The wallet's unspent list is cached for a few seconds.
+     * @param conn
+     * @param utxos
+     * @return false if the wallet's unspent list couldn't be fetched
+     */
+    bool getAvailableUtxos(const WalletConnectorPtr & conn, std::vector<wallet::UtxoEntry> & utxos);
+
     /**
      * @brief Returns true if xbridge can afford to pay the specified BLOCK fee. i.e. there's
      * sufficient utxos available to cover the fee.
@@ -588,18 +668,22 @@ public:
     }
 
 protected:
-    void clearMempool();
+    CRollingBloomFilter & knownMessages();
 
 private:
     std::unique_ptr<Impl> m_p;
     bool m_disconnecting;
     CCriticalSection m_lock;
-    std::map<std::string, boost::posix_time::ptime> m_badWallets;
+    struct BadWallet
+    {
+        int64_t  retryTime{0}; // seconds
+        uint32_t failures{0};
+    };
+    std::map<std::string, BadWallet> m_badWallets;
     bool m_updatingWallets{false};
     CCriticalSection m_updatingWalletsLock;
 
-    std::set<xbridge::wallet::UtxoEntry> m_feeUtxos;
-    std::map<std::string, std::set<xbridge::wallet::UtxoEntry> > m_utxosDict;
+    UtxoPool m_utxos;
     CCriticalSection m_utxosLock;
     CCriticalSection m_utxosOrderLock;
 
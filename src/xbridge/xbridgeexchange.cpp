@@ -10,6 +10,7 @@
 #include <xbridge/bitcoinrpcconnector.h>
 #include <xbridge/util/logger.h>
 #include <xbridge/util/settings.h>
+#include <xbridge/util/timingwheel.h>
 #include <xbridge/xbridgeapp.h>
 
 #include <chainparamsbase.h>
@@ -18,6 +19,9 @@
 #include <pubkey.h>
 #include <servicenode/servicenodemgr.h>
 #include <sync.h>
+#include <txmempool.h>
+#include <util/time.h>
+#include <validation.h>
 
 #include <algorithm>
 
@@ -35,7 +39,11 @@ class Exchange::Impl
 protected:
     bool initKeyPair();
 
-    std::list<TransactionPtr> transactions(bool onlyFinished) const;
+    std::list<TransactionPtr> finishedTransactions() const;
+
+    // pending orders and their deadlines, callers hold m_pendingTransactionsLock
+    void addPendingTransaction(const TransactionPtr & tr);
+    void erasePendingTransaction(const uint256 & id);
 
 protected:
     // connected wallets
@@ -45,10 +53,14 @@ protected:
 
     mutable CCriticalSection                           m_pendingTransactionsLock;
     std::map<uint256, uint256>                         m_hashToIdMap;
-    std::map<uint256, TransactionPtr>                  m_pendingTransactions;
+    TransactionSnapshotMap                             m_pendingTransactions;
+    // pending orders by the earliest time and block height they can expire at, orders
+    // that aren't expired when due are rescheduled
+    TimingWheel<uint256, SaltedTxidHasher>             m_pendingExpiry;
+    TimingWheel<uint256, SaltedTxidHasher>             m_pendingBlockExpiry;
 
     mutable CCriticalSection                           m_transactionsLock;
-    std::map<uint256, TransactionPtr>                  m_transactions;
+    TransactionSnapshotMap                             m_transactions;
 
     // utxo records
     CCriticalSection                                   m_utxoLocker;
@@ -59,6 +71,24 @@ protected:
     std::vector<unsigned char>                         m_privkey;
 };
 
+//*****************************************************************************
+//*****************************************************************************
+void Exchange::Impl::addPendingTransaction(const TransactionPtr & tr)
+{
+    m_pendingTransactions.set(tr->id(), tr);
+    m_pendingExpiry.schedule(tr->id(), tr->expiryTime());
+    m_pendingBlockExpiry.schedule(tr->id(), tr->expiryBlock());
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void Exchange::Impl::erasePendingTransaction(const uint256 & id)
+{
+    m_pendingTransactions.erase(id);
+    m_pendingExpiry.cancel(id);
+    m_pendingBlockExpiry.cancel(id);
+}
+
 //*****************************************************************************
 //*****************************************************************************
 Exchange::Exchange()
@@ -366,28 +396,28 @@ bool Exchange::createTransaction(const uint256                        & txid,
         {
             // new transaction
             isCreated = true;
-            m_p->m_pendingTransactions[txid] = tr;
+            m_p->addPendingTransaction(tr);
         }
         else
         {
-            m_p->m_pendingTransactions[txid]->m_lock.lock();
+            m_p->m_pendingTransactions.at(txid)->m_lock.lock();
 
             // found, check if expired
-            if (!m_p->m_pendingTransactions[txid]->isExpired())
+            if (!m_p->m_pendingTransactions.at(txid)->isExpired())
             {
-                m_p->m_pendingTransactions[txid]->updateTimestamp();
+                m_p->m_pendingTransactions.at(txid)->updateTimestamp();
 
-                m_p->m_pendingTransactions[txid]->m_lock.unlock();
+                m_p->m_pendingTransactions.at(txid)->m_lock.unlock();
             }
             else
             {
-                m_p->m_pendingTransactions[txid]->m_lock.unlock();
+                m_p->m_pendingTransactions.at(txid)->m_lock.unlock();
 
                 // if expired - delete old transaction
-                m_p->m_pendingTransactions.erase(txid);
+                m_p->erasePendingTransaction(txid);
 
                 // create new
-                m_p->m_pendingTransactions[txid] = tr;
+                m_p->addPendingTransaction(tr);
             }
         }
     }
@@ -452,35 +482,35 @@ bool Exchange::acceptTransaction(const uint256                        & txid,
         }
         else
         {
-            m_p->m_pendingTransactions[txid]->m_lock.lock();
+            m_p->m_pendingTransactions.at(txid)->m_lock.lock();
 
             // found, check if expired
-            if (m_p->m_pendingTransactions[txid]->isExpired())
+            if (m_p->m_pendingTransactions.at(txid)->isExpired())
             {
-                m_p->m_pendingTransactions[txid]->m_lock.unlock();
+                m_p->m_pendingTransactions.at(txid)->m_lock.unlock();
 
                 // if expired - delete old transaction
-                m_p->m_pendingTransactions.erase(txid);
+                m_p->erasePendingTransaction(txid);
                 LOG() << "try accept expired transaction " << __FUNCTION__;
                 return false;
             }
             else
             {
                 // try join with existing transaction
-                if (!m_p->m_pendingTransactions[txid]->tryJoin(tr))
+                if (!m_p->m_pendingTransactions.at(txid)->tryJoin(tr))
                 {
                     LOG() << "transaction not joined " << __FUNCTION__;
-                    m_p->m_pendingTransactions[txid]->m_lock.unlock();
+                    m_p->m_pendingTransactions.at(txid)->m_lock.unlock();
                     return false;
                 }
                 else
                 {
                     LOG() << "transactions joined, id <" << tr->id().GetHex() << ">";
-                    tmp = m_p->m_pendingTransactions[txid];
+                    tmp = m_p->m_pendingTransactions.at(txid);
                 }
             }
 
-            m_p->m_pendingTransactions[txid]->m_lock.unlock();
+            m_p->m_pendingTransactions.at(txid)->m_lock.unlock();
         }
     }
 
@@ -489,11 +519,11 @@ bool Exchange::acceptTransaction(const uint256                        & txid,
         // move to transactions
         {
             LOCK(m_p->m_transactionsLock);
-            m_p->m_transactions[txid] = tmp;
+            m_p->m_transactions.set(txid, tmp);
         }
         {
             LOCK(m_p->m_pendingTransactionsLock);
-            m_p->m_pendingTransactions.erase(txid);
+            m_p->erasePendingTransaction(txid);
         }
     }
 
@@ -514,7 +544,7 @@ bool Exchange::deletePendingTransaction(const uint256 & id)
     // if there are any locked utxo's for this txid, unlock them
     unlockUtxos(id);
 
-    m_p->m_pendingTransactions.erase(id);
+    m_p->erasePendingTransaction(id);
 
     return true;
 }
@@ -612,7 +642,7 @@ const TransactionPtr Exchange::transaction(const uint256 & hash)
 
         if (m_p->m_transactions.count(hash))
         {
-            return m_p->m_transactions[hash];
+            return m_p->m_transactions.at(hash);
         }
         else
         {
@@ -633,7 +663,7 @@ const TransactionPtr Exchange::pendingTransaction(const uint256 & hash)
 
         if (m_p->m_pendingTransactions.count(hash))
         {
-            return m_p->m_pendingTransactions[hash];
+            return m_p->m_pendingTransactions.at(hash);
         }
         else
         {
@@ -648,38 +678,29 @@ const TransactionPtr Exchange::pendingTransaction(const uint256 & hash)
 
 //*****************************************************************************
 //*****************************************************************************
-std::list<TransactionPtr> Exchange::pendingTransactions() const
+Exchange::TransactionsSnapshot Exchange::pendingTransactions() const
 {
     LOCK(m_p->m_pendingTransactionsLock);
-
-    std::list<TransactionPtr> list;
-
-    for (std::map<uint256, TransactionPtr>::const_iterator i = m_p->m_pendingTransactions.begin();
-         i != m_p->m_pendingTransactions.end(); ++i)
-    {
-        list.push_back(i->second);
-    }
-
-    return list;
+    return m_p->m_pendingTransactions.snapshot();
 }
 
 //*****************************************************************************
 //*****************************************************************************
-std::list<TransactionPtr> Exchange::Impl::transactions(bool onlyFinished) const
+std::list<TransactionPtr> Exchange::Impl::finishedTransactions() const
 {
-    LOCK(m_transactionsLock);
+    TransactionsSnapshot txs;
+    {
+        LOCK(m_transactionsLock);
+        txs = m_transactions.snapshot();
+    }
 
     std::list<TransactionPtr> list;
 
-    for (const std::pair<uint256, TransactionPtr> & i : m_transactions)
+    for (const std::pair<const uint256, TransactionPtr> & i : *txs)
     {
-        if (!onlyFinished)
-        {
-            list.push_back(i.second);
-        }
-        else if (i.second->isExpired() ||
-                 !i.second->isValid() ||
-                 i.second->isFinished())
+        if (i.second->isExpired() ||
+            !i.second->isValid() ||
+            i.second->isFinished())
         {
             list.push_back(i.second);
         }
@@ -690,16 +711,17 @@ std::list<TransactionPtr> Exchange::Impl::transactions(bool onlyFinished) const
 
 //*****************************************************************************
 //*****************************************************************************
-std::list<TransactionPtr> Exchange::transactions() const
+Exchange::TransactionsSnapshot Exchange::transactions() const
 {
-    return m_p->transactions(false);
+    LOCK(m_p->m_transactionsLock);
+    return m_p->m_transactions.snapshot();
 }
 
 //*****************************************************************************
 //*****************************************************************************
 std::list<TransactionPtr> Exchange::finishedTransactions() const
 {
-    return m_p->transactions(true);
+    return m_p->finishedTransactions();
 }
 
 //*****************************************************************************
@@ -713,31 +735,62 @@ size_t Exchange::eraseExpiredTransactions()
 
     size_t result = 0;
 
+    const int64_t now = GetTime();
+    int height;
+    {
+        LOCK(cs_main);
+        height = chainActive.Height();
+    }
+
     LOCK(m_p->m_pendingTransactionsLock);
 
-    // Use non-hoisted iterator to prevent invalidation during erase
-    for (auto it = m_p->m_pendingTransactions.cbegin(); it != m_p->m_pendingTransactions.cend(); )
+    // Only the orders whose deadline passed are checked, the others are rescheduled
+    std::vector<TransactionPtr> expired;
+    std::set<uint256> checked;
+    for (const uint256 & id : m_p->m_pendingBlockExpiry.advance(height))
     {
-        TransactionPtr ptr = it->second;
+        if (!m_p->m_pendingTransactions.count(id))
+            continue;
+        const TransactionPtr & ptr = m_p->m_pendingTransactions.at(id);
+        checked.insert(id);
 
         if (ptr->isExpiredByBlockNumber())
         {
-             LOG() << __FUNCTION__ << std::endl << "order block expired" << ptr;
-             m_p->m_pendingTransactions.erase(it++);
-             unlockUtxos(ptr->id());
-             ++result;
-         }
-        else if(ptr->isExpired())
+            LOG() << __FUNCTION__ << std::endl << "order block expired" << ptr;
+            expired.push_back(ptr);
+        }
+        else
+        {
+            m_p->m_pendingBlockExpiry.schedule(id, std::max(ptr->expiryBlock(), height + 1));
+        }
+    }
+    for (const uint256 & id : m_p->m_pendingExpiry.advance(now))
+    {
+        if (!m_p->m_pendingTransactions.count(id))
+            continue;
+        const TransactionPtr & ptr = m_p->m_pendingTransactions.at(id);
+        if (checked.count(id) && !m_p->m_pendingBlockExpiry.has(id))
+            continue; // expired by block number
+
+        if (ptr->isExpired())
         {
             LOG() << __FUNCTION__ << std::endl << "order expired by ttl" << ptr;
-            m_p->m_pendingTransactions.erase(it++);
-            unlockUtxos(ptr->id());
-            ++result;
-        } else {
-            ++it;
+            expired.push_back(ptr);
+        }
+        else
+        {
+            m_p->m_pendingExpiry.schedule(id, std::max(ptr->expiryTime(), now + 1));
         }
     }
 
+    // Erase after the loop, the map is only copied for writing if a snapshot is in use
+    for (const TransactionPtr & ptr : expired)
+    {
+        m_p->erasePendingTransaction(ptr->id());
+        unlockUtxos(ptr->id());
+        ++result;
+    }
+
     if(result > 0)
         LOG() << "deleted " << result << "  expired transactions";
 
@@ -802,26 +855,28 @@ bool Exchange::updateTimestampOrRemoveExpired(const TransactionPtr & tx)
     LOCK(m_p->m_pendingTransactionsLock);
 
     auto txid = tx->id();
-    m_p->m_pendingTransactions[txid]->m_lock.lock();
+    if (!m_p->m_pendingTransactions.count(txid))
+        return false;
+    m_p->m_pendingTransactions.at(txid)->m_lock.lock();
 
     // found, check if expired
-    if (!m_p->m_pendingTransactions[txid]->isExpired())
+    if (!m_p->m_pendingTransactions.at(txid)->isExpired())
     {
         // return false if update is too soon
-        if (m_p->m_pendingTransactions[txid]->updateTooSoon()) {
-            m_p->m_pendingTransactions[txid]->m_lock.unlock();
+        if (m_p->m_pendingTransactions.at(txid)->updateTooSoon()) {
+            m_p->m_pendingTransactions.at(txid)->m_lock.unlock();
             return false;
         }
-        m_p->m_pendingTransactions[txid]->updateTimestamp();
-        m_p->m_pendingTransactions[txid]->m_lock.unlock();
+        m_p->m_pendingTransactions.at(txid)->updateTimestamp();
+        m_p->m_pendingTransactions.at(txid)->m_lock.unlock();
         return true;
     }
     else
     {
-        m_p->m_pendingTransactions[txid]->m_lock.unlock();
+        m_p->m_pendingTransactions.at(txid)->m_lock.unlock();
 
         // if expired - delete old transaction
-        m_p->m_pendingTransactions.erase(txid);
+        m_p->erasePendingTransaction(txid);
         return false;
     }
 }
@@ -842,11 +897,15 @@ bool Exchange::makerUtxosAreStillValid(const TransactionPtr & tx)
     if (!makerConn) // non-fatal just skip
         return true;
 
-    auto & makerUtxos = tx->a_utxos();
-    for (auto entry : makerUtxos) {
-        if (!makerConn->getTxOut(entry)) {
+    // Check the whole utxo set of the order in one request
+    auto makerUtxos = tx->a_utxos();
+    std::vector<bool> found;
+    if (!makerConn->getTxOuts(makerUtxos, found))
+        return true; // non-fatal just skip
+    for (size_t i = 0; i < makerUtxos.size(); ++i) {
+        if (!found[i]) {
             // Invalid utxos cancel order
-            ERR() << "bad maker utxo in order " << tx->id().ToString() << " , utxo txid " << entry.txId << " vout " << entry.vout
+            ERR() << "bad maker utxo in order " << tx->id().ToString() << " , utxo txid " << makerUtxos[i].txId << " vout " << makerUtxos[i].vout
                   << " " << __FUNCTION__;
             return false;
         }
@@ -8,6 +8,7 @@
 #ifndef BLOCKNET_XBRIDGE_XBRIDGEEXCHANGE_H
 #define BLOCKNET_XBRIDGE_XBRIDGEEXCHANGE_H
 
+#include <xbridge/util/snapshotmap.h>
 #include <xbridge/xbridgepacket.h>
 #include <xbridge/xbridgetransaction.h>
 #include <xbridge/xbridgewallet.h>
@@ -35,6 +36,10 @@ class Exchange
 {
     class Impl;
 
+public:
+    typedef SnapshotMap<uint256, TransactionPtr> TransactionSnapshotMap;
+    typedef TransactionSnapshotMap::Snapshot TransactionsSnapshot;
+
 public:
     /**
      * @brief instance - classical implementation of singletone
@@ -219,14 +224,14 @@ public:
     const TransactionPtr      pendingTransaction(const uint256 & hash);
     /**
      * @brief pendingTransactions
-     * @return list of pending (open)
+     * @return snapshot of pending (open), safe to read without locking
      */
-    std::list<TransactionPtr> pendingTransactions() const;
+    TransactionsSnapshot pendingTransactions() const;
     /**
      * @brief transactions
-     * @return list of transactions
+     * @return snapshot of transactions, safe to read without locking
      */
-    std::list<TransactionPtr> transactions() const;
+    TransactionsSnapshot transactions() const;
     /**
      * @brief finishedTransactions
      * @return list of finished transactions
@@ -0,0 +1,96 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <xbridge/xbridgeorderbook.h>
+
+#include <xbridge/util/xutil.h>
+
+#include <algorithm>
+
+//******************************************************************************
+//******************************************************************************
+namespace xbridge
+{
+
+//******************************************************************************
+//******************************************************************************
+void OrderBook::add(const TransactionDescrPtr & ptr)
+{
+    if (!ptr || m_orders.count(ptr->id))
+        return;
+
+    // Amounts of an order don't change once it is created
+    const PairKey key{ptr->fromCurrency, ptr->toCurrency};
+    const double p = xbridge::price(ptr);
+    m_sides[key][p].push_back(ptr);
+    m_orders[ptr->id] = std::make_pair(key, p);
+}
+
+//******************************************************************************
+//******************************************************************************
+void OrderBook::remove(const uint256 & id)
+{
+    auto it = m_orders.find(id);
+    if (it == m_orders.end())
+        return;
+
+    auto side = m_sides.find(it->second.first);
+    if (side != m_sides.end())
+    {
+        auto level = side->second.find(it->second.second);
+        if (level != side->second.end())
+        {
+            auto & orders = level->second;
+            orders.erase(std::remove_if(orders.begin(), orders.end(),
+                                        [&id](const TransactionDescrPtr & ptr) { return ptr->id == id; }),
+                         orders.end());
+            if (orders.empty())
+                side->second.erase(level);
+        }
+        if (side->second.empty())
+            m_sides.erase(side);
+    }
+    m_orders.erase(it);
+}
+
+//******************************************************************************
+//******************************************************************************
+void OrderBook::clear()
+{
+    m_sides.clear();
+    m_orders.clear();
+}
+
+//******************************************************************************
+//******************************************************************************
+std::vector<OrderBook::Level> OrderBook::levels(const std::string & fromCurrency,
+                                                const std::string & toCurrency,
+                                                const size_t maxLevels) const
+{
+    std::vector<Level> result;
+
+    auto side = m_sides.find(PairKey{fromCurrency, toCurrency});
+    if (side == m_sides.end())
+        return result;
+
+    for (const auto & level : side->second)
+    {
+        if (result.size() >= maxLevels)
+            break;
+
+        Level l;
+        l.price = level.first;
+        for (const auto & ptr : level.second)
+        {
+            if (ptr->state != TransactionDescr::trPending || ptr->fromAmount == 0 || ptr->toAmount == 0)
+                continue;
+            l.orders.push_back(ptr);
+        }
+        if (!l.orders.empty())
+            result.push_back(std::move(l));
+    }
+    return result;
+}
+
+} // namespace xbridge
@@ -0,0 +1,78 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BLOCKNET_XBRIDGE_XBRIDGEORDERBOOK_H
+#define BLOCKNET_XBRIDGE_XBRIDGEORDERBOOK_H
+
+#include <xbridge/xbridgetransactiondescr.h>
+
+#include <uint256.h>
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+//******************************************************************************
+//******************************************************************************
+namespace xbridge
+{
+
+//******************************************************************************
+//******************************************************************************
+/**
+ * @brief OrderBook - open orders of each currency pair grouped by price level.
+ * Orders are added and removed together with the App's open transactions, the
+ * caller guards the book with the same lock.
+ */
+class OrderBook
+{
+public:
+    /**
+     * @brief Level - orders with the same price, in the order they were added
+     */
+    struct Level
+    {
+        double                           price{0};
+        std::vector<TransactionDescrPtr> orders;
+    };
+
+public:
+    /**
+     * @brief add - add the order to the book of its currency pair
+     * @param ptr
+     */
+    void add(const TransactionDescrPtr & ptr);
+
+    /**
+     * @brief remove - remove the order from the book
+     * @param id - id of order
+     */
+    void remove(const uint256 & id);
+
+    void clear();
+
+    /**
+     * @brief levels - pending orders selling fromCurrency for toCurrency, best (lowest)
+     * price first. Orders that are no longer pending are skipped.
+     * @param fromCurrency
+     * @param toCurrency
+     * @param maxLevels - maximum number of levels returned
+     * @return
+     */
+    std::vector<Level> levels(const std::string & fromCurrency,
+                              const std::string & toCurrency,
+                              const size_t maxLevels) const;
+
+private:
+    typedef std::pair<std::string, std::string> PairKey;
+    typedef std::map<double, std::vector<TransactionDescrPtr>> Side;
+
+    std::map<PairKey, Side>                          m_sides;
+    std::map<uint256, std::pair<PairKey, double>>    m_orders;
+};
+
+} // namespace xbridge
+
+#endif // BLOCKNET_XBRIDGE_XBRIDGEORDERBOOK_H
@@ -0,0 +1,305 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <xbridge/xbridgeorderhistory.h>
+
+#include <xbridge/util/xutil.h>
+
+#include <util/system.h>
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+
+//******************************************************************************
+//******************************************************************************
+namespace xbridge
+{
+
+static const char DB_ORDER       = 'o';
+static const char DB_ORDER_TIME  = 't';
+static const char DB_ORDER_PAIR  = 'p';
+static const char DB_ORDER_STATE = 's';
+
+namespace
+{
+
+// Index times are stored inverted and big endian so the newest entries sort first
+uint64_t invertTime(const uint64_t time)
+{
+    return std::numeric_limits<uint64_t>::max() - time;
+}
+
+struct TimeKey
+{
+    char     prefix{DB_ORDER_TIME};
+    uint64_t time{0};
+    uint256  id;
+
+    TimeKey() = default;
+    TimeKey(const uint64_t time, const uint256 & id) : time(time), id(id) {}
+
+    bool sameIndex(const TimeKey & o) const { return prefix == o.prefix; }
+
+    template <typename Stream>
+    void Serialize(Stream & s) const {
+        s << prefix;
+        ser_writedata64be(s, invertTime(time));
+        s << id;
+    }
+    template <typename Stream>
+    void Unserialize(Stream & s) {
+        s >> prefix;
+        if (prefix != DB_ORDER_TIME)
+            return;
+        time = invertTime(ser_readdata64be(s));
+        s >> id;
+    }
+};
+
+struct PairKey
+{
+    char        prefix{DB_ORDER_PAIR};
+    std::string fromCurrency;
+    std::string toCurrency;
+    uint64_t    time{0};
+    uint256     id;
+
+    PairKey() = default;
+    PairKey(const std::string & fromCurrency, const std::string & toCurrency, const uint64_t time, const uint256 & id)
+        : fromCurrency(fromCurrency), toCurrency(toCurrency), time(time), id(id) {}
+
+    bool sameIndex(const PairKey & o) const {
+        return prefix == o.prefix && fromCurrency == o.fromCurrency && toCurrency == o.toCurrency;
+    }
+
+    template <typename Stream>
+    void Serialize(Stream & s) const {
+        s << prefix << fromCurrency << toCurrency;
+        ser_writedata64be(s, invertTime(time));
+        s << id;
+    }
+    template <typename Stream>
+    void Unserialize(Stream & s) {
+        s >> prefix;
+        if (prefix != DB_ORDER_PAIR)
+            return;
+        s >> fromCurrency >> toCurrency;
+        time = invertTime(ser_readdata64be(s));
+        s >> id;
+    }
+};
+
+struct StateKey
+{
+    char     prefix{DB_ORDER_STATE};
+    int32_t  state{0};
+    uint64_t time{0};
+    uint256  id;
+
+    StateKey() = default;
+    StateKey(const int32_t state, const uint64_t time, const uint256 & id) : state(state), time(time), id(id) {}
+
+    bool sameIndex(const StateKey & o) const { return prefix == o.prefix && state == o.state; }
+
+    template <typename Stream>
+    void Serialize(Stream & s) const {
+        s << prefix;
+        ser_writedata32be(s, static_cast<uint32_t>(state));
+        ser_writedata64be(s, invertTime(time));
+        s << id;
+    }
+    template <typename Stream>
+    void Unserialize(Stream & s) {
+        s >> prefix;
+        if (prefix != DB_ORDER_STATE)
+            return;
+        state = static_cast<int32_t>(ser_readdata32be(s));
+        time = invertTime(ser_readdata64be(s));
+        s >> id;
+    }
+};
+
+bool matches(const OrderHistoryQuery & q, const OrderHistoryRecord & r)
+{
+    if (r.txtime < q.startTime || r.txtime >= q.endTime)
+        return false;
+    if (!q.fromCurrency.empty() || !q.toCurrency.empty())
+    {
+        const bool pair    = r.fromCurrency == q.fromCurrency && r.toCurrency == q.toCurrency;
+        const bool inverse = r.fromCurrency == q.toCurrency && r.toCurrency == q.fromCurrency;
+        if (!pair && !(q.withInverse && inverse))
+            return false;
+    }
+    if (!q.states.empty() && !q.states.count(r.state))
+        return false;
+    if (q.localOnly && !r.isLocal())
+        return false;
+    return true;
+}
+
+bool newerThan(const OrderHistoryRecord & a, const OrderHistoryRecord & b)
+{
+    return a.txtime > b.txtime;
+}
+
+} // namespace
+
+//******************************************************************************
+//******************************************************************************
+OrderHistoryRecord::OrderHistoryRecord(const TransactionDescr & tx)
+    : id(tx.id)
+    , fromCurrency(tx.fromCurrency)
+    , fromAmount(tx.fromAmount)
+    , from(tx.from)
+    , toCurrency(tx.toCurrency)
+    , toAmount(tx.toAmount)
+    , to(tx.to)
+    , state(tx.state)
+    , created(timeToInt(tx.created))
+    , txtime(timeToInt(tx.txtime))
+{
+}
+
+//******************************************************************************
+//******************************************************************************
+TransactionDescrPtr OrderHistoryRecord::toTransaction() const
+{
+    TransactionDescrPtr ptr(new TransactionDescr);
+    ptr->id           = id;
+    ptr->fromCurrency = fromCurrency;
+    ptr->fromAmount   = fromAmount;
+    ptr->from         = from;
+    ptr->toCurrency   = toCurrency;
+    ptr->toAmount     = toAmount;
+    ptr->to           = to;
+    ptr->state        = static_cast<TransactionDescr::State>(state);
+    ptr->created      = intToTime(created);
+    ptr->txtime       = intToTime(txtime);
+    return ptr;
+}
+
+//******************************************************************************
+//******************************************************************************
+OrderHistoryDB::OrderHistoryDB(size_t cacheSize, bool memory, bool wipe)
+    : CDBWrapper(GetDataDir() / "xbridgehistory", cacheSize, memory, wipe)
+{
+}
+
+//******************************************************************************
+//******************************************************************************
+bool OrderHistoryDB::write(const std::vector<OrderHistoryRecord> & records)
+{
+    CDBBatch batch(*this);
+    for (const OrderHistoryRecord & r : records)
+    {
+        OrderHistoryRecord old;
+        if (Read(std::make_pair(DB_ORDER, r.id), old))
+        {
+            batch.Erase(TimeKey(old.txtime, old.id));
+            batch.Erase(PairKey(old.fromCurrency, old.toCurrency, old.txtime, old.id));
+            batch.Erase(StateKey(old.state, old.txtime, old.id));
+        }
+        batch.Write(std::make_pair(DB_ORDER, r.id), r);
+        batch.Write(TimeKey(r.txtime, r.id), '\0');
+        batch.Write(PairKey(r.fromCurrency, r.toCurrency, r.txtime, r.id), '\0');
+        batch.Write(StateKey(r.state, r.txtime, r.id), '\0');
+    }
+    return WriteBatch(batch);
+}
+
+//******************************************************************************
+//******************************************************************************
+bool OrderHistoryDB::erase(const std::vector<uint256> & ids)
+{
+    CDBBatch batch(*this);
+    for (const uint256 & id : ids)
+    {
+        OrderHistoryRecord old;
+        if (!Read(std::make_pair(DB_ORDER, id), old))
+            continue;
+        batch.Erase(std::make_pair(DB_ORDER, id));
+        batch.Erase(TimeKey(old.txtime, old.id));
+        batch.Erase(PairKey(old.fromCurrency, old.toCurrency, old.txtime, old.id));
+        batch.Erase(StateKey(old.state, old.txtime, old.id));
+    }
+    return WriteBatch(batch);
+}
+
+//******************************************************************************
+//******************************************************************************
+template <typename Key, typename MakeKey>
+void OrderHistoryDB::scan(const MakeKey & makeKey, const OrderHistoryQuery & q, const size_t max,
+                          std::vector<OrderHistoryRecord> & records)
+{
+    if (q.endTime == 0 || q.startTime >= q.endTime)
+        return;
+
+    // The newest entry in range is the first one at or after endTime - 1
+    const Key first = makeKey(q.endTime - 1);
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    for (pcursor->Seek(first); pcursor->Valid() && records.size() < max; pcursor->Next())
+    {
+        Key key;
+        if (!pcursor->GetKey(key) || !key.sameIndex(first) || key.time < q.startTime)
+            break;
+        OrderHistoryRecord r;
+        if (!Read(std::make_pair(DB_ORDER, key.id), r))
+        {
+            LogPrintf("%s: missing order history record %s\n", __func__, key.id.ToString());
+            continue;
+        }
+        if (matches(q, r))
+            records.push_back(r);
+    }
+}
+
+//******************************************************************************
+//******************************************************************************
+std::vector<OrderHistoryRecord> OrderHistoryDB::query(const OrderHistoryQuery & q)
+{
+    const size_t max = q.limit > std::numeric_limits<size_t>::max() - q.offset
+                     ? std::numeric_limits<size_t>::max()
+                     : q.offset + q.limit;
+
+    std::vector<OrderHistoryRecord> records;
+    if (!q.fromCurrency.empty() || !q.toCurrency.empty())
+    {
+        auto pairKey = [](const std::string & fromCurrency, const std::string & toCurrency) {
+            return [&fromCurrency, &toCurrency](const uint64_t time) {
+                return PairKey(fromCurrency, toCurrency, time, uint256());
+            };
+        };
+        scan<PairKey>(pairKey(q.fromCurrency, q.toCurrency), q, max, records);
+        if (q.withInverse && q.fromCurrency != q.toCurrency)
+        {
+            std::vector<OrderHistoryRecord> inverse;
+            scan<PairKey>(pairKey(q.toCurrency, q.fromCurrency), q, max, inverse);
+
+            std::vector<OrderHistoryRecord> merged;
+            merged.reserve(records.size() + inverse.size());
+            std::merge(records.begin(), records.end(), inverse.begin(), inverse.end(),
+                       std::back_inserter(merged), newerThan);
+            if (merged.size() > max)
+                merged.resize(max);
+            records.swap(merged);
+        }
+    }
+    else if (q.states.size() == 1)
+    {
+        const int32_t state = *q.states.begin();
+        scan<StateKey>([state](const uint64_t time) { return StateKey(state, time, uint256()); }, q, max, records);
+    }
+    else
+    {
+        scan<TimeKey>([](const uint64_t time) { return TimeKey(time, uint256()); }, q, max, records);
+    }
+
+    if (q.offset >= records.size())
+        return std::vector<OrderHistoryRecord>();
+    records.erase(records.begin(), records.begin() + q.offset);
+    return records;
+}
+
+} // namespace xbridge
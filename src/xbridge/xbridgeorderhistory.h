@@ -0,0 +1,135 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BLOCKNET_XBRIDGE_XBRIDGEORDERHISTORY_H
+#define BLOCKNET_XBRIDGE_XBRIDGEORDERHISTORY_H
+
+#include <xbridge/xbridgetransactiondescr.h>
+
+#include <dbwrapper.h>
+#include <serialize.h>
+#include <uint256.h>
+
+#include <limits>
+#include <set>
+#include <string>
+#include <vector>
+
+//******************************************************************************
+//******************************************************************************
+namespace xbridge
+{
+
+static const size_t ORDER_HISTORY_DB_CACHE = 2 << 20;
+
+//******************************************************************************
+//******************************************************************************
+/**
+ * @brief OrderHistoryRecord - persisted summary of an order moved to history
+ */
+struct OrderHistoryRecord
+{
+    uint256                    id;
+    std::string                fromCurrency;
+    uint64_t                   fromAmount{0};
+    std::vector<unsigned char> from; // empty for orders of other traders
+    std::string                toCurrency;
+    uint64_t                   toAmount{0};
+    std::vector<unsigned char> to;
+    int32_t                    state{TransactionDescr::trInvalid};
+    uint64_t                   created{0}; // microseconds since epoch
+    uint64_t                   txtime{0};
+
+    OrderHistoryRecord() = default;
+    explicit OrderHistoryRecord(const TransactionDescr & tx);
+
+    /**
+     * @brief toTransaction - detached transaction with the fields of the record
+     */
+    TransactionDescrPtr toTransaction() const;
+
+    bool isLocal() const { return !from.empty() && !to.empty(); }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream & s, Operation ser_action) {
+        READWRITE(id);
+        READWRITE(fromCurrency);
+        READWRITE(fromAmount);
+        READWRITE(from);
+        READWRITE(toCurrency);
+        READWRITE(toAmount);
+        READWRITE(to);
+        READWRITE(state);
+        READWRITE(created);
+        READWRITE(txtime);
+    }
+};
+
+//******************************************************************************
+//******************************************************************************
+/**
+ * @brief OrderHistoryQuery - filter and page of an order history query
+ */
+struct OrderHistoryQuery
+{
+    std::string       fromCurrency; // pair, any pair if empty
+    std::string       toCurrency;
+    bool              withInverse{false}; // also match the toCurrency/fromCurrency pair
+    std::set<int32_t> states; // any state if empty
+    bool              localOnly{false};
+    uint64_t          startTime{0}; // [startTime, endTime) of txtime
+    uint64_t          endTime{std::numeric_limits<uint64_t>::max()};
+    size_t            offset{0};
+    size_t            limit{std::numeric_limits<size_t>::max()};
+};
+
+//******************************************************************************
+//******************************************************************************
+/**
+ * @brief OrderHistoryDB - leveldb store of the order history. Records are indexed
+ * by time, by pair and time and by state and time, newest first, so range queries
+ * only read the matching part of the index.
+ */
+class OrderHistoryDB : public CDBWrapper
+{
+public:
+    explicit OrderHistoryDB(size_t cacheSize, bool memory = false, bool wipe = false);
+
+    /**
+     * @brief write - add or replace the records, the index entries of the
+     * replaced records are moved
+     * @param records
+     * @return false on write error
+     */
+    bool write(const std::vector<OrderHistoryRecord> & records);
+
+    /**
+     * @brief erase - remove the records and their index entries
+     * @param ids
+     * @return false on write error
+     */
+    bool erase(const std::vector<uint256> & ids);
+
+    /**
+     * @brief query - records matching the query, newest (by txtime) first
+     * @param query
+     * @return
+     */
+    std::vector<OrderHistoryRecord> query(const OrderHistoryQuery & query);
+
+private:
+    /**
+     * @brief scan - walks one index from the newest entry in the query time range
+     * and appends the matching records, stops after max records
+     */
+    template <typename Key, typename MakeKey>
+    void scan(const MakeKey & makeKey, const OrderHistoryQuery & q, const size_t max,
+              std::vector<OrderHistoryRecord> & records);
+};
+
+} // namespace xbridge
+
+#endif // BLOCKNET_XBRIDGE_XBRIDGEORDERHISTORY_H
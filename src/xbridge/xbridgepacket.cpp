@@ -9,9 +9,14 @@
 #include <xbridge/xbridgepacket.h>
 
 #include <crypto/sha256.h>
+#include <hash.h>
 #include <random.h>
 #include <secp256k1.h>
 #include <support/allocators/secure.h>
+#include <sync.h>
+
+#include <deque>
+#include <set>
 
 //******************************************************************************
 //******************************************************************************
@@ -52,8 +57,73 @@ public:
 };
 static SecpInstance secpInstance;
 
+struct PacketBuffers
+{
+    Mutex mu;
+    std::vector<std::vector<unsigned char>> buffers GUARDED_BY(mu);
+};
+
+// never destroyed, packets may be released by other static destructors
+PacketBuffers & packetBuffers()
+{
+    static PacketBuffers * pool = new PacketBuffers;
+    return *pool;
+}
+
+// packets with a correct signature, keyed by the hash of all packet bytes
+// including pubkey and signature, the oldest hashes are evicted first
+struct VerifiedPackets
+{
+    Mutex mu;
+    std::set<uint256> hashes GUARDED_BY(mu);
+    std::deque<uint256> order GUARDED_BY(mu);
+};
+
+VerifiedPackets & verifiedPackets()
+{
+    static VerifiedPackets * cache = new VerifiedPackets;
+    return *cache;
+}
+
 } // namespace
 
+//******************************************************************************
+//******************************************************************************
+// static
+std::vector<unsigned char> XBridgePacketBufferPool::take(const size_t size)
+{
+    std::vector<unsigned char> buffer;
+    {
+        PacketBuffers & pool = packetBuffers();
+        LOCK(pool.mu);
+        if (!pool.buffers.empty())
+        {
+            buffer.swap(pool.buffers.back());
+            pool.buffers.pop_back();
+        }
+    }
+    buffer.assign(size, 0);
+    return buffer;
+}
+
+//******************************************************************************
+//******************************************************************************
+// static
+void XBridgePacketBufferPool::release(std::vector<unsigned char> && buffer)
+{
+    if (buffer.capacity() == 0 || buffer.capacity() > maxBufferCapacity)
+    {
+        return;
+    }
+
+    PacketBuffers & pool = packetBuffers();
+    LOCK(pool.mu);
+    if (pool.buffers.size() < maxBuffers)
+    {
+        pool.buffers.push_back(std::move(buffer));
+    }
+}
+
 //******************************************************************************
 //******************************************************************************
 bool XBridgePacket::sign(const std::vector<unsigned char> & pubkey,
@@ -88,10 +158,56 @@ bool XBridgePacket::sign(const std::vector<unsigned char> & pubkey,
     return verify();
 }
 
+//******************************************************************************
+//******************************************************************************
+uint256 XBridgePacket::hash() const
+{
+    return Hash(m_body.begin(), m_body.end());
+}
+
 //******************************************************************************
 // verify signature
 //******************************************************************************
 bool XBridgePacket::verify()
+{
+    return verify(hash());
+}
+
+//******************************************************************************
+// verify signature, skipped when the packet was verified before
+//******************************************************************************
+bool XBridgePacket::verify(const uint256 & packetHash)
+{
+    VerifiedPackets & cache = verifiedPackets();
+    {
+        LOCK(cache.mu);
+        if (cache.hashes.count(packetHash))
+        {
+            return true;
+        }
+    }
+
+    if (!verifySignature())
+    {
+        return false;
+    }
+
+    LOCK(cache.mu);
+    if (cache.hashes.insert(packetHash).second)
+    {
+        cache.order.push_back(packetHash);
+        if (cache.order.size() > maxVerifiedPackets)
+        {
+            cache.hashes.erase(cache.order.front());
+            cache.order.pop_front();
+        }
+    }
+    return true;
+}
+
+//******************************************************************************
+//******************************************************************************
+bool XBridgePacket::verifySignature()
 {
     unsigned char signature[rawSignatureSize];
     memcpy(signature, signatureField(), rawSignatureSize);
@@ -160,3 +276,35 @@ bool XBridgePacket::verify(const std::vector<unsigned char> & pubkey)
 
     return verify();
 }
+
+//******************************************************************************
+//******************************************************************************
+bool parseOrderHeartbeat(XBridgePacket & packet, std::vector<uint256> & ids)
+{
+    ids.clear();
+
+    const uint64_t size = packet.size();
+    if (size < sizeof(uint32_t))
+    {
+        return false;
+    }
+
+    uint32_t count = 0;
+    memcpy(&count, packet.data(), sizeof(uint32_t));
+    const uint64_t offset = sizeof(uint32_t);
+    if (count == 0 || count > XBRIDGE_MAX_HEARTBEAT_ORDERS ||
+        static_cast<uint64_t>(count) != (size - offset) / XBridgePacket::hashSize ||
+        (size - offset) % XBridgePacket::hashSize != 0)
+    {
+        return false;
+    }
+
+    ids.reserve(count);
+    const unsigned char * ptr = packet.data() + offset;
+    for (uint32_t i = 0; i < count; ++i, ptr += XBridgePacket::hashSize)
+    {
+        ids.emplace_back(std::vector<unsigned char>(ptr, ptr + XBridgePacket::hashSize));
+    }
+
+    return true;
+}
@@ -11,10 +11,13 @@
 #include <xbridge/util/logger.h>
 #include <xbridge/version.h>
 
+#include <uint256.h>
+
 #include <vector>
 #include <deque>
 #include <memory>
 #include <ctime>
+#include <string.h>
 
 //******************************************************************************
 //******************************************************************************
@@ -249,6 +252,17 @@ enum XBridgeCommand
     //
     xbcTransactionFinished = 24,
 
+    //
+    // xbcOrderHeartbeat
+    // client refreshes the timestamps of its pending orders on the servicenode,
+    // instead of sending each order again. Signed with the key of the first
+    // order, only sent to servicenodes with XBRIDGE_FEATURE_ORDER_HEARTBEAT
+    //    uint32_t count of orders, max XBRIDGE_MAX_HEARTBEAT_ORDERS
+    //    array items
+    //      uint256 client transaction id
+    //
+    xbcOrderHeartbeat = 25,
+
     //
     // xbcServicesPing
     //    array of supported services
@@ -262,6 +276,26 @@ enum XBridgeCommand
 //******************************************************************************
 typedef uint32_t crc_t;
 
+//******************************************************************************
+// recycles the bodies of released packets, so that building an outgoing
+// packet doesn't allocate once the pool is warm, threadsafe
+//******************************************************************************
+class XBridgePacketBufferPool
+{
+public:
+    enum
+    {
+        maxBuffers        = 256,
+        maxBufferCapacity = 4096
+    };
+
+    // buffer of the size filled with zeros
+    static std::vector<unsigned char> take(const size_t size);
+    static void release(std::vector<unsigned char> && buffer);
+};
+
+class XBridgePacketView;
+
 //******************************************************************************
 // header 8*4 bytes
 //
@@ -473,29 +507,38 @@ public:
         return true;
     }
 
-    XBridgePacket() : m_body(headerSize, 0)
+    // copies the bytes of the view once, the view is checked with XBridgePacketView::valid()
+    inline bool copyFrom(const XBridgePacketView & view);
+
+    XBridgePacket() : m_body(XBridgePacketBufferPool::take(headerSize))
     {
         versionField()   = static_cast<uint32_t>(XBRIDGE_PROTOCOL_VERSION);
         timestampField() = static_cast<uint32_t>(time(0));
     }
 
-    explicit XBridgePacket(const std::string& raw) : m_body(raw.begin(), raw.end())
+    explicit XBridgePacket(const std::string& raw) : m_body(XBridgePacketBufferPool::take(0))
     {
+        m_body.assign(raw.begin(), raw.end());
         timestampField() = static_cast<uint32_t>(time(0));
     }
 
-    XBridgePacket(const XBridgePacket & other)
+    XBridgePacket(const XBridgePacket & other) : m_body(XBridgePacketBufferPool::take(0))
     {
         m_body = other.m_body;
     }
 
-    XBridgePacket(XBridgeCommand c) : m_body(headerSize, 0)
+    XBridgePacket(XBridgeCommand c) : m_body(XBridgePacketBufferPool::take(headerSize))
     {
         versionField()   = static_cast<uint32_t>(XBRIDGE_PROTOCOL_VERSION);
         commandField()   = static_cast<uint32_t>(c);
         timestampField() = static_cast<uint32_t>(time(0));
     }
 
+    ~XBridgePacket()
+    {
+        XBridgePacketBufferPool::release(std::move(m_body));
+    }
+
     XBridgePacket & operator = (const XBridgePacket & other)
     {
         m_body    = other.m_body;
@@ -507,6 +550,12 @@ public:
               const std::vector<unsigned char> & privkey);
     bool verify();
     bool verify(const std::vector<unsigned char> & pubkey);
+    // packetHash must be hash(), e.g. the hash the relay dedup computed
+    // over the received bytes
+    bool verify(const uint256 & packetHash);
+
+    // hash of all packet bytes, the same hash relayed packets are deduplicated by
+    uint256 hash() const;
 
 protected:
     template<uint32_t INDEX>
@@ -534,6 +583,15 @@ protected:
     const unsigned char * signatureField() const { return &m_body[53]; }
 
 private:
+    // packets that verified are remembered so that the handlers checking
+    // the sender's pubkey don't verify the signature again
+    enum
+    {
+        maxVerifiedPackets = 50000
+    };
+
+    bool verifySignature();
+
     // TODO temporary constants for backward compatibility
     enum
     {
@@ -550,4 +608,80 @@ private:
 typedef std::shared_ptr<XBridgePacket> XBridgePacketPtr;
 typedef std::deque<XBridgePacketPtr>   XBridgePacketQueue;
 
+//******************************************************************************
+// read only packet over bytes owned by the caller, e.g. the network receive
+// buffer, the fields are read in place and the bytes must outlive the view
+//******************************************************************************
+class XBridgePacketView
+{
+    const unsigned char * m_data;
+    size_t                m_size;
+
+public:
+    XBridgePacketView(const unsigned char * data, const size_t size)
+        : m_data(data), m_size(size)
+    {
+    }
+
+    // header is complete and the size field matches the data
+    bool valid() const
+    {
+        return m_size >= XBridgePacket::headerSize &&
+               field32(4) == m_size - XBridgePacket::headerSize;
+    }
+
+    uint32_t        version() const         { return field32(0); }
+    XBridgeCommand  command() const         { return static_cast<XBridgeCommand>(field32(1)); }
+    uint32_t        size()    const         { return field32(4); }
+    uint32_t        allSize() const         { return static_cast<uint32_t>(m_size); }
+
+    // pubkey, signature and data require a valid() view
+    const unsigned char * pubkey() const    { return m_data + 20; }
+    const unsigned char * signature() const { return m_data + 53; }
+    const unsigned char * data() const      { return m_data + XBridgePacket::headerSize; }
+
+    const unsigned char * begin() const     { return m_data; }
+    const unsigned char * end() const       { return m_data + m_size; }
+
+private:
+    // 0 if the header is cut off, the bytes don't need to be aligned
+    uint32_t field32(const uint32_t index) const
+    {
+        uint32_t value = 0;
+        if (m_size >= (index + 1) * sizeof(uint32_t))
+        {
+            memcpy(&value, m_data + index * sizeof(uint32_t), sizeof(uint32_t));
+        }
+        return value;
+    }
+};
+
+//******************************************************************************
+//******************************************************************************
+inline bool XBridgePacket::copyFrom(const XBridgePacketView & view)
+{
+    if (!view.valid())
+    {
+        ERR() << "incorrect data size " << __FUNCTION__;
+        return false;
+    }
+
+    m_body.assign(view.begin(), view.end());
+
+    // TODO check packet crc
+    return true;
+}
+
+//******************************************************************************
+// xbcOrderHeartbeat
+//******************************************************************************
+
+// max orders in one xbcOrderHeartbeat, clients with more orders on one
+// servicenode send several heartbeats
+static const uint32_t XBRIDGE_MAX_HEARTBEAT_ORDERS = 1000;
+
+// reads the order ids, false if the count is 0, above XBRIDGE_MAX_HEARTBEAT_ORDERS
+// or doesn't match the packet size
+bool parseOrderHeartbeat(XBridgePacket & packet, std::vector<uint256> & ids);
+
 #endif // BLOCKNET_XBRIDGE_XBRIDGEPACKET_H
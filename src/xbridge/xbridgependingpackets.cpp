@@ -0,0 +1,163 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <xbridge/xbridgependingpackets.h>
+
+#include <algorithm>
+
+//******************************************************************************
+//******************************************************************************
+namespace xbridge
+{
+
+//******************************************************************************
+//******************************************************************************
+PendingPackets::PendingPackets(const size_t maxSize, const int64_t ttl,
+                               const int64_t retryInterval, const int64_t maxRetryInterval)
+    : m_maxSize(std::max(maxSize, static_cast<size_t>(1)))
+    , m_ttl(ttl)
+    , m_retryInterval(std::max(retryInterval, static_cast<int64_t>(1)))
+    , m_maxRetryInterval(std::max(maxRetryInterval, m_retryInterval))
+{
+}
+
+//******************************************************************************
+//******************************************************************************
+uint256 PendingPackets::add(const uint256 & id, const XBridgePacketPtr & packet,
+                            const std::string & awaiting, const int64_t now)
+{
+    uint256 evicted;
+
+    auto it = m_entries.find(id);
+    if (it == m_entries.end())
+    {
+        if (m_entries.size() >= m_maxSize)
+        {
+            evicted = m_age.begin()->second;
+            erase(m_entries.find(evicted));
+        }
+        it = m_entries.emplace(id, Entry()).first;
+        it->second.queued = now;
+        m_age.emplace(now, id);
+    }
+    else
+    {
+        // Deferred again, the previous packet of the order is replaced
+        take(it, now);
+        m_schedule.erase(std::make_pair(it->second.nextTime, id));
+        ++it->second.retries;
+    }
+
+    Entry & e = it->second;
+    e.packet   = packet;
+    e.awaiting = awaiting;
+    e.nextTime = now + std::min(m_retryInterval << std::min(e.retries, 16u), m_maxRetryInterval);
+    m_schedule.emplace(e.nextTime, id);
+    if (!awaiting.empty())
+        m_awaiting.emplace(awaiting, id);
+
+    return evicted;
+}
+
+//******************************************************************************
+//******************************************************************************
+bool PendingPackets::remove(const uint256 & id)
+{
+    auto it = m_entries.find(id);
+    if (it == m_entries.end())
+        return false;
+    erase(it);
+    return true;
+}
+
+//******************************************************************************
+//******************************************************************************
+std::vector<XBridgePacketPtr> PendingPackets::wake(const std::string & awaiting, const int64_t now)
+{
+    std::vector<uint256> ids;
+    const auto range = m_awaiting.equal_range(awaiting);
+    for (auto it = range.first; it != range.second; ++it)
+        ids.push_back(it->second);
+
+    std::vector<XBridgePacketPtr> packets;
+    for (const uint256 & id : ids)
+        packets.push_back(take(m_entries.find(id), now));
+    return packets;
+}
+
+//******************************************************************************
+//******************************************************************************
+std::vector<XBridgePacketPtr> PendingPackets::due(const int64_t now, size_t & expired)
+{
+    expired = 0;
+    while (!m_age.empty() && m_age.begin()->first + m_ttl <= now)
+    {
+        erase(m_entries.find(m_age.begin()->second));
+        ++expired;
+    }
+
+    std::vector<XBridgePacketPtr> packets;
+    while (!m_schedule.empty() && m_schedule.begin()->first <= now)
+    {
+        auto it = m_entries.find(m_schedule.begin()->second);
+        if (it->second.packet)
+            packets.push_back(take(it, now));
+        else
+            erase(it); // taken packet was not deferred again, the order moved on
+    }
+    return packets;
+}
+
+//******************************************************************************
+//******************************************************************************
+void PendingPackets::clear()
+{
+    m_entries.clear();
+    m_schedule.clear();
+    m_age.clear();
+    m_awaiting.clear();
+}
+
+//******************************************************************************
+//******************************************************************************
+XBridgePacketPtr PendingPackets::take(Entries::iterator it, const int64_t now)
+{
+    Entry & e = it->second;
+    XBridgePacketPtr packet;
+    packet.swap(e.packet);
+    if (!packet)
+        return packet;
+
+    if (!e.awaiting.empty())
+    {
+        const auto range = m_awaiting.equal_range(e.awaiting);
+        for (auto a = range.first; a != range.second; ++a)
+        {
+            if (a->second == it->first)
+            {
+                m_awaiting.erase(a);
+                break;
+            }
+        }
+        e.awaiting.clear();
+    }
+
+    // Keep the retry count while the packet is processed, in case it is deferred again
+    m_schedule.erase(std::make_pair(e.nextTime, it->first));
+    e.nextTime = now + m_maxRetryInterval;
+    m_schedule.emplace(e.nextTime, it->first);
+    return packet;
+}
+
+//******************************************************************************
+//******************************************************************************
+void PendingPackets::erase(Entries::iterator it)
+{
+    take(it, 0);
+    m_schedule.erase(std::make_pair(it->second.nextTime, it->first));
+    m_age.erase(std::make_pair(it->second.queued, it->first));
+    m_entries.erase(it);
+}
+
+} // namespace xbridge
@@ -0,0 +1,113 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BLOCKNET_XBRIDGE_XBRIDGEPENDINGPACKETS_H
+#define BLOCKNET_XBRIDGE_XBRIDGEPENDINGPACKETS_H
+
+#include <xbridge/xbridgepacket.h>
+
+#include <uint256.h>
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+//******************************************************************************
+//******************************************************************************
+namespace xbridge
+{
+
+//******************************************************************************
+//******************************************************************************
+/**
+ * @brief PendingPackets - packets of orders that could not be processed yet, one per
+ * order. A packet waits until the dependency it names is ready (see wake) or until
+ * its retry time, which doubles each time the order is deferred again. Orders that
+ * wait longer than the ttl are dropped, and the oldest order is dropped when the
+ * queue is full. Not threadsafe, the caller guards the queue.
+ */
+class PendingPackets
+{
+public:
+    /**
+     * @param maxSize - maximum number of orders in the queue
+     * @param ttl - seconds an order may wait since it was first deferred
+     * @param retryInterval - seconds until the first retry
+     * @param maxRetryInterval - maximum seconds between retries
+     */
+    PendingPackets(const size_t maxSize, const int64_t ttl,
+                   const int64_t retryInterval, const int64_t maxRetryInterval);
+
+    /**
+     * @brief add - defer the packet of the order, replaces an earlier packet of the order
+     * @param id - id of order
+     * @param packet
+     * @param awaiting - dependency that wakes the packet, empty if only retried on time
+     * @param now - current time in seconds
+     * @return id of the order dropped to make room, null if none
+     */
+    uint256 add(const uint256 & id, const XBridgePacketPtr & packet,
+                const std::string & awaiting, const int64_t now);
+
+    /**
+     * @brief remove - forget the order
+     * @param id - id of order
+     * @return true, if the order was in the queue
+     */
+    bool remove(const uint256 & id);
+
+    /**
+     * @brief wake - take the packets that wait on the dependency
+     * @param awaiting
+     * @param now - current time in seconds
+     * @return
+     */
+    std::vector<XBridgePacketPtr> wake(const std::string & awaiting, const int64_t now);
+
+    /**
+     * @brief due - take the packets whose retry time passed and drop expired orders
+     * @param now - current time in seconds
+     * @param expired - number of dropped orders
+     * @return
+     */
+    std::vector<XBridgePacketPtr> due(const int64_t now, size_t & expired);
+
+    /**
+     * @brief size - number of orders in the queue, including orders whose packet was
+     * taken and that may be deferred again
+     */
+    size_t size() const { return m_entries.size(); }
+
+    void clear();
+
+private:
+    struct Entry
+    {
+        XBridgePacketPtr packet;   // null once taken
+        std::string      awaiting;
+        int64_t          queued{0};
+        int64_t          nextTime{0}; // retry time, or the time to forget a taken packet
+        uint32_t         retries{0};
+    };
+    typedef std::map<uint256, Entry> Entries;
+
+    XBridgePacketPtr take(Entries::iterator it, const int64_t now);
+    void erase(Entries::iterator it);
+
+    const size_t                                m_maxSize;
+    const int64_t                               m_ttl;
+    const int64_t                               m_retryInterval;
+    const int64_t                               m_maxRetryInterval;
+
+    Entries                                     m_entries;
+    std::set<std::pair<int64_t, uint256>>       m_schedule; // nextTime of each order
+    std::set<std::pair<int64_t, uint256>>       m_age;      // queued time of each order
+    std::multimap<std::string, uint256>         m_awaiting; // dependency of each waiting packet
+};
+
+} // namespace xbridge
+
+#endif // BLOCKNET_XBRIDGE_XBRIDGEPENDINGPACKETS_H
@@ -96,6 +96,7 @@ protected:
     bool processServicesPing(XBridgePacketPtr packet) const;
 
     bool processTransaction(XBridgePacketPtr packet) const;
+    bool processOrderHeartbeat(XBridgePacketPtr packet) const;
     bool processPendingTransaction(XBridgePacketPtr packet) const;
     bool processTransactionAccepting(XBridgePacketPtr packet) const;
 
@@ -122,6 +123,8 @@ protected:
                                const TxCancelReason & reason) const;
     bool sendCancelTransaction(const TransactionDescrPtr & tx,
                                const TxCancelReason & reason) const;
+    size_t sendCancelTransactions(const std::vector<TransactionDescrPtr> & txs,
+                                  const TxCancelReason & reason, const int64_t deadline) const;
 
     bool processTransactionCancel(XBridgePacketPtr packet) const;
 
@@ -184,6 +187,7 @@ void Session::Impl::init()
     {
         // server side
         m_handlers[xbcTransaction]           .bind(this, &Impl::processTransaction);
+        m_handlers[xbcOrderHeartbeat]        .bind(this, &Impl::processOrderHeartbeat);
         m_handlers[xbcTransactionAccepting]  .bind(this, &Impl::processTransactionAccepting);
         m_handlers[xbcTransactionHoldApply]  .bind(this, &Impl::processTransactionHoldApply);
         m_handlers[xbcTransactionInitialized].bind(this, &Impl::processTransactionInitialized);
@@ -334,9 +338,9 @@ bool Session::Impl::processZero(XBridgePacketPtr /*packet*/) const
 //*****************************************************************************
 //*****************************************************************************
 // static
-bool Session::checkXBridgePacketVersion(const std::vector<unsigned char> & message)
+bool Session::checkXBridgePacketVersion(const XBridgePacketView & message)
 {
-    const uint32_t version = *reinterpret_cast<const uint32_t *>(&message[0]);
+    const uint32_t version = message.version();
 
     if (version != static_cast<boost::uint32_t>(XBRIDGE_PROTOCOL_VERSION))
     {
@@ -361,6 +365,52 @@ bool Session::checkXBridgePacketVersion(XBridgePacketPtr packet)
     return true;
 }
 
+//*****************************************************************************
+//*****************************************************************************
+bool Session::orderId(XBridgePacketPtr packet, uint256 & id)
+{
+    // position of the order id in the packet data, see the command handlers
+    uint32_t offset = 0;
+    switch (packet->command())
+    {
+        case xbcTransaction:
+        case xbcPendingTransaction:
+        case xbcTransactionCancel:
+        case xbcTransactionFinished:
+            offset = 0;
+            break;
+        case xbcTransactionAccepting:
+        case xbcTransactionHold:
+        case xbcTransactionCreateA:
+        case xbcTransactionCreatedA:
+        case xbcTransactionCreateB:
+        case xbcTransactionCreatedB:
+        case xbcTransactionConfirmA:
+        case xbcTransactionConfirmedA:
+        case xbcTransactionConfirmB:
+        case xbcTransactionConfirmedB:
+            offset = XBridgePacket::addressSize;
+            break;
+        case xbcTransactionHoldApply:
+        case xbcTransactionInit:
+        case xbcTransactionInitialized:
+            offset = 2 * XBridgePacket::addressSize;
+            break;
+        default:
+            return false;
+    }
+
+    if (packet->size() < offset + XBridgePacket::hashSize ||
+        packet->allSize() < XBridgePacket::headerSize + offset + XBridgePacket::hashSize)
+    {
+        return false;
+    }
+
+    std::vector<unsigned char> sid(packet->data()+offset, packet->data()+offset+XBridgePacket::hashSize);
+    id = uint256(sid);
+    return true;
+}
+
 //*****************************************************************************
 // retranslate packets from wallet to xbridge network
 //*****************************************************************************
@@ -648,6 +698,63 @@ bool Session::Impl::processTransaction(XBridgePacketPtr packet) const
     return true;
 }
 
+//*****************************************************************************
+// refresh the timestamps of known orders, see xbcOrderHeartbeat
+//*****************************************************************************
+bool Session::Impl::processOrderHeartbeat(XBridgePacketPtr packet) const
+{
+    Exchange & e = Exchange::instance();
+    if (!e.isStarted())
+    {
+        return true;
+    }
+
+    DEBUG_TRACE();
+
+    std::vector<uint256> ids;
+    if (!parseOrderHeartbeat(*packet, ids))
+    {
+        ERR() << "invalid packet for xbcOrderHeartbeat, received " << packet->size() << " bytes "
+              << __FUNCTION__;
+        return false;
+    }
+
+    // The orders are signed with keys of their own, the heartbeat is signed with the
+    // key of the first order only. Refreshing an order is no more than what
+    // xbcTransaction does for a known order.
+    TransactionPtr first = e.pendingTransaction(ids.front());
+    if (!first->matches(ids.front()) || !packet->verify(first->a_pk1()))
+    {
+        LOG() << "ignoring heartbeat, unknown order or invalid signature " << ids.front().ToString()
+              << " " << __FUNCTION__;
+        return true;
+    }
+
+    for (uint256 & id : ids)
+    {
+        TransactionPtr t = e.pendingTransaction(id);
+        if (!t->matches(id))
+        {
+            // the maker sends the order again if it isn't relayed
+            continue;
+        }
+
+        if (e.updateTimestampOrRemoveExpired(t))
+        {
+            if (!e.makerUtxosAreStillValid(t)) { // if the maker utxos are no longer valid, cancel the order
+                sendCancelTransaction(t, crBadUtxo);
+                continue;
+            }
+            LOG() << "order heartbeat, updating timestamp " << id.ToString()
+                  << " " << __FUNCTION__;
+            // relay order to network
+            sendTransaction(id);
+        }
+    }
+
+    return true;
+}
+
 //******************************************************************************
 // broadcast
 //******************************************************************************
@@ -740,6 +847,8 @@ bool Session::Impl::processPendingTransaction(XBridgePacketPtr packet) const
 
         // update timestamp
         ptr->updateTimestamp();
+        ptr->heartbeatSent = false;
+        xapp.checkTransactionExpiry(ptr->id);
 
         LOG() << __FUNCTION__ << ptr;
 
@@ -872,11 +981,14 @@ bool Session::Impl::processTransactionAccepting(XBridgePacketPtr packet) const
         return true;
     }
 
-    auto & makerUtxos = trPending->a_utxos();
-    for (auto entry : makerUtxos) {
-        if (!makerConn->getTxOut(entry)) {
+    auto makerUtxos = trPending->a_utxos();
+    std::vector<bool> found;
+    if (!makerConn->getTxOuts(makerUtxos, found))
+        found.assign(makerUtxos.size(), false);
+    for (size_t i = 0; i < makerUtxos.size(); ++i) {
+        if (!found[i]) {
             // Invalid utxos cancel order
-            ERR() << "bad maker utxo in order " << id.ToString() << " , utxo txid " << entry.txId << " vout " << entry.vout
+            ERR() << "bad maker utxo in order " << id.ToString() << " , utxo txid " << makerUtxos[i].txId << " vout " << makerUtxos[i].vout
                   << " " << __FUNCTION__;
             sendCancelTransaction(trPending, crBadUtxo);
             return false;
@@ -2644,7 +2756,7 @@ bool Session::Impl::processTransactionConfirmB(XBridgePacketPtr packet) const
     if (!connFrom || !connTo)
     {
         WARN() << "no connector for <" << (!connTo ? xtx->toCurrency : xtx->fromCurrency) << "> " << __FUNCTION__;
-        xapp.processLater(txid, packet);
+        xapp.processLater(txid, packet, !connTo ? xtx->toCurrency : xtx->fromCurrency);
         return true;
     }
 
@@ -2968,6 +3080,46 @@ bool Session::Impl::sendCancelTransaction(const TransactionDescrPtr & tx,
     return true;
 }
 
+//*****************************************************************************
+//*****************************************************************************
+size_t Session::sendCancelTransactions(const std::vector<TransactionDescrPtr> & txs,
+                                       const TxCancelReason & reason, const int64_t deadline) const {
+    return m_p->sendCancelTransactions(txs, reason, deadline);
+}
+
+//*****************************************************************************
+//*****************************************************************************
+size_t Session::Impl::sendCancelTransactions(const std::vector<TransactionDescrPtr> & txs,
+                                             const TxCancelReason & reason, const int64_t deadline) const
+{
+    std::vector<XBridgePacketPtr> packets;
+    packets.reserve(txs.size());
+    for (const auto & tx : txs)
+    {
+        LOG() << "canceling order " << tx->id.GetHex();
+
+        XBridgePacketPtr reply(new XBridgePacket(xbcTransactionCancel));
+        reply->append(tx->id.begin(), 32);
+        reply->append(static_cast<uint32_t>(reason));
+
+        reply->sign(tx->mPubKey, tx->mPrivKey);
+
+        sendPacketBroadcast(reply);
+        packets.push_back(reply);
+    }
+
+    // Local processing may call the wallets
+    size_t processed{0};
+    for (; processed < txs.size(); ++processed)
+    {
+        if (deadline > 0 && GetTimeMillis() > deadline)
+            break;
+        processTransactionCancel(packets[processed]);
+        xuiConnector.NotifyXBridgeTransactionChanged(txs[processed]->id);
+    }
+    return processed;
+}
+
 //*****************************************************************************
 //*****************************************************************************
 void Session::sendListOfTransactions() const
@@ -2981,11 +3133,10 @@ void Session::sendListOfTransactions() const
         return;
     }
 
-    std::list<TransactionPtr> list = e.pendingTransactions();
-    std::list<TransactionPtr>::iterator i = list.begin();
-    for (; i != list.end(); ++i)
+    const auto pending = e.pendingTransactions();
+    for (const auto & i : *pending)
     {
-        TransactionPtr & ptr = *i;
+        const TransactionPtr & ptr = i.second;
 
         XBridgePacketPtr packet(new XBridgePacket(xbcPendingTransaction));
 
@@ -66,13 +66,20 @@ public:
      * @param message - data
      * @return true, packet version == current xbridge protocol version
      */
-    static bool checkXBridgePacketVersion(const std::vector<unsigned char> & message);
+    static bool checkXBridgePacketVersion(const XBridgePacketView & message);
     /**
      * @brief checkXBridgePacketVersion - equal packet version with current xbridge protocol version
      * @param packet - data
      * @return true, packet version == current xbridge protocol version
      */
     static bool checkXBridgePacketVersion(XBridgePacketPtr packet);
+    /**
+     * @brief orderId - id of the order a packet refers to
+     * @param packet - data
+     * @param id - order id
+     * @return false if the command doesn't refer to an order or the packet is too short
+     */
+    static bool orderId(XBridgePacketPtr packet, uint256 & id);
     /**
      * @brief processPacket - decrypt packet, execute packet command
      * @param packet
@@ -102,6 +109,18 @@ public:
      */
     bool sendCancelTransaction(const TransactionDescrPtr & tx, const TxCancelReason & reason) const;
 
+    /**
+     * @brief Cancels the specified orders. The cancels of all the orders are broadcast before
+     * they are processed locally (coin unlocks and refunds), the local processing stops at the
+     * deadline.
+     * @param txs
+     * @param reason
+     * @param deadline GetTimeMillis() deadline, 0 for none
+     * @return Number of orders processed locally
+     */
+    size_t sendCancelTransactions(const std::vector<TransactionDescrPtr> & txs, const TxCancelReason & reason,
+                                  const int64_t deadline) const;
+
     /**
      * Redeems the specified order's deposit.
      * @param xtx
@@ -300,6 +300,33 @@ bool Transaction::isExpiredByBlockNumber() const
     return false;
 }
 
+//*****************************************************************************
+//*****************************************************************************
+int64_t Transaction::expiryTime() const
+{
+    LOCK(m_lock);
+    const int64_t created = boost::posix_time::to_time_t(m_created);
+    const int64_t last = boost::posix_time::to_time_t(m_last);
+
+    // isExpired() compares whole seconds
+    if (m_state == trNew)
+        return std::min(created + deadlineTTL, last + pendingTTL) + 1;
+    return last + TTL + 1;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+int Transaction::expiryBlock() const
+{
+    LOCK2(m_lock, cs_main);
+
+    CBlockIndex* blockindex = LookupBlockIndex(m_blockHash);
+    if (!blockindex)
+        return 0;
+
+    return blockindex->nHeight + blocksTTL + 1;
+}
+
 //*****************************************************************************
 //*****************************************************************************
 void Transaction::cancel()
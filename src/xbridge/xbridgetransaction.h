@@ -173,6 +173,18 @@ public:
     bool isExpired() const;
     bool isExpiredByBlockNumber() const;
 
+    /**
+     * @brief expiryTime - earliest time isExpired() can be true at, the deadline only
+     * moves later as the order is updated
+     * @return unix time in seconds
+     */
+    int64_t expiryTime() const;
+    /**
+     * @brief expiryBlock - earliest block height isExpiredByBlockNumber() can be true at
+     * @return 0 if the order's block is unknown
+     */
+    int expiryBlock() const;
+
     /**
      * @brief cancel - set transaction state to trCancelled
      */
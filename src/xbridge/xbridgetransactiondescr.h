@@ -134,6 +134,9 @@ struct TransactionDescr
     bool     redeemedCounterpartyDeposit{false};
     bool     depositSent{false};
 
+    // order heartbeat sent since the servicenode last relayed the order
+    bool     heartbeatSent{false};
+
     // keep track of excluded servicenodes (snodes can be excluded if they fail to post)
     std::set<CPubKey> _excludedSnodes;
     void excludeNode(CPubKey &key) {
@@ -0,0 +1,158 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <xbridge/xbridgeutxopool.h>
+
+//******************************************************************************
+//******************************************************************************
+namespace xbridge
+{
+
+//******************************************************************************
+//******************************************************************************
+UtxoPool::UtxoPool(const int64_t ttl)
+    : m_ttl(ttl)
+{
+}
+
+//******************************************************************************
+//******************************************************************************
+bool UtxoPool::fresh(const std::string & token, const int64_t now) const
+{
+    auto it = m_tokens.find(token);
+    return it != m_tokens.end() && it->second.updated > 0 && it->second.updated + m_ttl > now;
+}
+
+//******************************************************************************
+//******************************************************************************
+void UtxoPool::update(const std::string & token, const std::vector<wallet::UtxoEntry> & unspent, const int64_t now)
+{
+    Token & t = m_tokens[token];
+    for (auto & item : t.coins)
+        item.second.unspent = false;
+
+    for (const wallet::UtxoEntry & u : unspent)
+    {
+        Coin & c = t.coins[u];
+        c.utxo    = u;
+        c.unspent = true;
+    }
+
+    for (auto it = t.coins.begin(); it != t.coins.end(); )
+    {
+        if (!it->second.unspent && !it->second.locked)
+            it = t.coins.erase(it);
+        else
+            ++it;
+    }
+
+    t.updated = now;
+}
+
+//******************************************************************************
+//******************************************************************************
+void UtxoPool::invalidate(const std::string & token)
+{
+    auto it = m_tokens.find(token);
+    if (it != m_tokens.end())
+        it->second.updated = 0;
+}
+
+//******************************************************************************
+//******************************************************************************
+std::vector<wallet::UtxoEntry> UtxoPool::available(const std::string & token) const
+{
+    std::vector<wallet::UtxoEntry> utxos;
+    auto it = m_tokens.find(token);
+    if (it == m_tokens.end())
+        return utxos;
+
+    for (const auto & item : it->second.coins)
+    {
+        const Coin & c = item.second;
+        if (c.unspent && !c.locked && !m_feeLocked.count(c.utxo))
+            utxos.push_back(c.utxo);
+    }
+    return utxos;
+}
+
+//******************************************************************************
+//******************************************************************************
+bool UtxoPool::lock(const std::string & token, const std::vector<wallet::UtxoEntry> & utxos)
+{
+    Token & t = m_tokens[token];
+    for (const wallet::UtxoEntry & u : utxos)
+    {
+        auto it = t.coins.find(u);
+        if (it != t.coins.end() && it->second.locked)
+            return false;
+    }
+
+    for (const wallet::UtxoEntry & u : utxos)
+    {
+        Coin & c = t.coins[u];
+        c.utxo   = u;
+        c.locked = true;
+    }
+    return true;
+}
+
+//******************************************************************************
+//******************************************************************************
+void UtxoPool::unlock(const std::string & token, const std::vector<wallet::UtxoEntry> & utxos)
+{
+    auto t = m_tokens.find(token);
+    if (t == m_tokens.end())
+        return;
+
+    for (const wallet::UtxoEntry & u : utxos)
+    {
+        auto it = t->second.coins.find(u);
+        if (it == t->second.coins.end())
+            continue;
+        if (it->second.unspent)
+            it->second.locked = false;
+        else
+            t->second.coins.erase(it);
+    }
+    t->second.updated = 0;
+}
+
+//******************************************************************************
+//******************************************************************************
+std::set<wallet::UtxoEntry> UtxoPool::locked(const std::string & token) const
+{
+    std::set<wallet::UtxoEntry> utxos;
+    auto it = m_tokens.find(token);
+    if (it == m_tokens.end())
+        return utxos;
+
+    for (const auto & item : it->second.coins)
+    {
+        if (item.second.locked)
+            utxos.insert(utxos.end(), item.second.utxo);
+    }
+    return utxos;
+}
+
+//******************************************************************************
+//******************************************************************************
+void UtxoPool::lockFee(const std::set<wallet::UtxoEntry> & utxos)
+{
+    m_feeLocked.insert(utxos.begin(), utxos.end());
+}
+
+//******************************************************************************
+//******************************************************************************
+void UtxoPool::unlockFee(const std::set<wallet::UtxoEntry> & utxos)
+{
+    for (const wallet::UtxoEntry & u : utxos)
+        m_feeLocked.erase(u);
+
+    // Fee outputs are spent by the fee transaction
+    for (auto & item : m_tokens)
+        item.second.updated = 0;
+}
+
+} // namespace xbridge
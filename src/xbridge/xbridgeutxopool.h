@@ -0,0 +1,118 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BLOCKNET_XBRIDGE_XBRIDGEUTXOPOOL_H
+#define BLOCKNET_XBRIDGE_XBRIDGEUTXOPOOL_H
+
+#include <xbridge/xbridgewallet.h>
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+//******************************************************************************
+//******************************************************************************
+namespace xbridge
+{
+
+//******************************************************************************
+//******************************************************************************
+/**
+ * @brief UtxoPool - unspent outputs of each token wallet and the outputs locked by
+ * orders and fee payments. The unspent list of a token is cached for ttl seconds and
+ * merged into the pool on refresh, lock flags stay on the coins so that the available
+ * coins are found without copying and subtracting the locked sets. Locked coins stay
+ * in the pool until they're unlocked, even if the wallet no longer lists them.
+ * Not threadsafe, the caller guards the pool.
+ */
+class UtxoPool
+{
+public:
+    /**
+     * @param ttl - seconds the unspent list of a token is used before it's refreshed
+     */
+    explicit UtxoPool(const int64_t ttl);
+
+    /**
+     * @brief fresh - true if the cached unspent list of the token can be used
+     * @param token
+     * @param now - current time in seconds
+     */
+    bool fresh(const std::string & token, const int64_t now) const;
+
+    /**
+     * @brief update - replace the unspent list of the token, lock flags are kept
+     * @param token
+     * @param unspent - all unspent outputs listed by the wallet
+     * @param now - current time in seconds
+     */
+    void update(const std::string & token, const std::vector<wallet::UtxoEntry> & unspent, const int64_t now);
+
+    /**
+     * @brief invalidate - refresh the unspent list of the token on next use
+     * @param token
+     */
+    void invalidate(const std::string & token);
+
+    /**
+     * @brief available - unspent outputs of the token that aren't locked
+     * @param token
+     * @return
+     */
+    std::vector<wallet::UtxoEntry> available(const std::string & token) const;
+
+    /**
+     * @brief lock - lock the outputs for an order
+     * @param token
+     * @param utxos
+     * @return false if any of the outputs is already locked, nothing is locked then
+     */
+    bool lock(const std::string & token, const std::vector<wallet::UtxoEntry> & utxos);
+
+    /**
+     * @brief unlock - unlock the outputs of an order, the token is refreshed on next use
+     * because unlocked outputs are usually spent
+     * @param token
+     * @param utxos
+     */
+    void unlock(const std::string & token, const std::vector<wallet::UtxoEntry> & utxos);
+
+    /**
+     * @brief locked - outputs of the token locked by orders
+     * @param token
+     * @return
+     */
+    std::set<wallet::UtxoEntry> locked(const std::string & token) const;
+
+    void lockFee(const std::set<wallet::UtxoEntry> & utxos);
+    /**
+     * @brief unlockFee - unlock fee outputs, all tokens are refreshed on next use
+     */
+    void unlockFee(const std::set<wallet::UtxoEntry> & utxos);
+    const std::set<wallet::UtxoEntry> & feeLocked() const { return m_feeLocked; }
+
+private:
+    struct Coin
+    {
+        wallet::UtxoEntry utxo;
+        bool              unspent{false}; // listed by the wallet on last refresh
+        bool              locked{false};
+    };
+
+    struct Token
+    {
+        std::map<wallet::UtxoEntry, Coin> coins;
+        int64_t                           updated{0}; // 0 if the unspent list is stale
+    };
+
+    const int64_t                         m_ttl;
+
+    std::map<std::string, Token>          m_tokens;
+    std::set<wallet::UtxoEntry>           m_feeLocked; // fee outputs exclude coins of every token
+};
+
+} // namespace xbridge
+
+#endif // BLOCKNET_XBRIDGE_XBRIDGEUTXOPOOL_H
@@ -7,8 +7,10 @@
 
 #include <xbridge/xbridgewalletconnector.h>
 #include <xbridge/xbridgetransactiondescr.h>
+#include <xbridge/util/logger.h>
 
 #include <base58.h>
+#include <util/system.h>
 
 //*****************************************************************************
 //*****************************************************************************
@@ -87,4 +89,125 @@ std::string WalletConnector::getNewTokenAddress()
     return newaddress;
 }
 
+/**
+ * \brief Look up the utxos one at a time, found is set for each entry.
+ */
+bool WalletConnector::getTxOuts(std::vector<wallet::UtxoEntry> & entries, std::vector<bool> & found)
+{
+    found.assign(entries.size(), false);
+    for (size_t i = 0; i < entries.size(); ++i)
+        found[i] = getTxOut(entries[i]);
+    return true;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+bool WalletConnector::findUTXOSpend(const std::string & /*utxoPrevTxId*/, const uint32_t & /*utxoVoutN*/,
+                                    std::string & /*spendTxId*/)
+{
+    return false;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+WalletReactor & WalletReactor::instance()
+{
+    static WalletReactor reactor;
+    return reactor;
+}
+
+void WalletReactor::start()
+{
+    boost::mutex::scoped_lock l(m_lock);
+    m_stopped = false;
+    startThreads();
+}
+
+void WalletReactor::startThreads()
+{
+    if (m_started)
+        return;
+    m_maxInflight = std::max(1, static_cast<int>(gArgs.GetArg("-rpcxbridgemaxinflight", DEFAULT_XBRIDGE_RPC_MAX_INFLIGHT)));
+    const int threads = std::max(1, static_cast<int>(gArgs.GetArg("-rpcxbridgethreads", DEFAULT_XBRIDGE_RPC_THREADS)));
+    m_io.reset(new boost::asio::io_service);
+    m_work.reset(new boost::asio::io_service::work(*m_io));
+    boost::asio::io_service * io = m_io.get();
+    for (int i = 0; i < threads; ++i)
+    {
+        m_threads.emplace_back([io]() {
+            RenameThread("blocknet-xbridgerpc");
+            io->run();
+        });
+    }
+    m_started = true;
+}
+
+void WalletReactor::post(const std::string & currency, std::function<void()> task)
+{
+    boost::mutex::scoped_lock l(m_lock);
+    if (m_stopped)
+        return; // dropping the task breaks its promise
+    startThreads();
+    if (m_inflight[currency] >= m_maxInflight)
+    {
+        m_pending[currency].push_back(std::move(task));
+        return;
+    }
+    ++m_inflight[currency];
+    m_io->post(std::bind(&WalletReactor::run, this, currency, std::move(task)));
+}
+
+void WalletReactor::run(const std::string & currency, std::function<void()> task)
+{
+    while (task)
+    {
+        try
+        {
+            task();
+        }
+        catch (std::exception & e)
+        {
+            ERR() << "wallet rpc call for " << currency << " failed: " << e.what() << " " << __FUNCTION__;
+        }
+        task = nullptr;
+
+        // Run the next queued call of the currency on this thread
+        boost::mutex::scoped_lock l(m_lock);
+        auto & pending = m_pending[currency];
+        if (m_stopped || pending.empty())
+        {
+            --m_inflight[currency];
+            break;
+        }
+        task = std::move(pending.front());
+        pending.pop_front();
+    }
+}
+
+void WalletReactor::stop()
+{
+    std::vector<std::thread> threads;
+    std::unique_ptr<boost::asio::io_service> io;
+    std::map<std::string, std::deque<std::function<void()>>> pending; // dropped outside the lock
+    {
+        boost::mutex::scoped_lock l(m_lock);
+        m_stopped = true;
+        if (!m_started)
+            return;
+        pending.swap(m_pending);
+        m_work.reset();
+        m_io->stop();
+        threads.swap(m_threads);
+        io = std::move(m_io);
+    }
+    for (auto & thread : threads)
+        thread.join();
+    // destroying the io service drops the calls that didn't run
+    io.reset();
+
+    boost::mutex::scoped_lock l(m_lock);
+    m_inflight.clear();
+    m_started = false;
+}
+
 } // namespace xbridge
@@ -8,14 +8,24 @@
 #ifndef BLOCKNET_XBRIDGE_XBRIDGEWALLETCONNECTOR_H
 #define BLOCKNET_XBRIDGE_XBRIDGEWALLETCONNECTOR_H
 
+#include <xbridge/xbridgedef.h>
 #include <xbridge/xbridgewallet.h>
 
 #include <script/script.h>
 #include <uint256.h>
 
-#include <vector>
-#include <string>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
 #include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
 
 //*****************************************************************************
 //*****************************************************************************
@@ -96,6 +106,11 @@ public:
     virtual bool getBlockHash(const uint32_t & block, std::string & blockHash) = 0;
 
     virtual bool getTxOut(wallet::UtxoEntry & entry) = 0;
+    /**
+     * Looks up all entries, found is set for each entry. Connectors that support json-rpc
+     * batching check all entries in one request.
+     */
+    virtual bool getTxOuts(std::vector<wallet::UtxoEntry> & entries, std::vector<bool> & found);
 
     virtual bool sendRawTransaction(const std::string & rawtx,
                                     std::string & txid,
@@ -175,9 +190,84 @@ public:
     virtual bool isUTXOSpentInTx(const std::string & txid, const std::string & utxoPrevTxId,
                                  const uint32_t & utxoVoutN, bool & isSpent) = 0;
 
+    /**
+     * Looks up the transaction spending the utxo without scanning transactions. Returns
+     * false if the connector can't look up spends, otherwise spendTxId is the spending
+     * transaction or empty if the utxo is unspent.
+     */
+    virtual bool findUTXOSpend(const std::string & utxoPrevTxId, const uint32_t & utxoVoutN,
+                               std::string & spendTxId);
+
     virtual bool getTransactionsInBlock(const std::string & blockHash, std::vector<std::string> & txids) = 0;
 };
 
+/** Default number of threads serving asynchronous wallet rpc calls */
+static const int DEFAULT_XBRIDGE_RPC_THREADS = 4;
+/** Default maximum number of concurrent asynchronous rpc calls per currency */
+static const int DEFAULT_XBRIDGE_RPC_MAX_INFLIGHT = 2;
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * Runs wallet rpc calls on dedicated threads so that session threads don't block on
+ * wallet i/o. Each currency has at most -rpcxbridgemaxinflight calls running, so a slow
+ * or dead wallet only holds a few of the reactor threads, calls above the limit wait
+ * in the currency's queue.
+ */
+class WalletReactor
+{
+public:
+    static WalletReactor & instance();
+
+    /**
+     * Starts the reactor threads, also after stop(). The first post() starts the reactor if
+     * it was never started.
+     */
+    void start();
+
+    /**
+     * Queues the task for the currency. Tasks posted after stop() are dropped until the
+     * reactor is started again.
+     */
+    void post(const std::string & currency, std::function<void()> task);
+
+    /**
+     * Drops the queued tasks and joins the reactor threads.
+     */
+    void stop();
+
+protected:
+    WalletReactor() = default;
+    void startThreads();
+    void run(const std::string & currency, std::function<void()> task);
+
+protected:
+    boost::mutex m_lock;
+    // created on each start, destroying it drops the calls that didn't run
+    std::unique_ptr<boost::asio::io_service> m_io;
+    std::unique_ptr<boost::asio::io_service::work> m_work;
+    std::vector<std::thread> m_threads;
+    std::map<std::string, std::deque<std::function<void()>>> m_pending;
+    std::map<std::string, int> m_inflight;
+    int m_maxInflight{DEFAULT_XBRIDGE_RPC_MAX_INFLIGHT};
+    bool m_started{false};
+    bool m_stopped{false};
+};
+
+/**
+ * Runs the call on the wallet reactor. The future is ready once the call is done, callers
+ * use wait_for() to bound the time spent on an unresponsive wallet. The future holds a
+ * broken_promise error if the reactor is stopped before the call runs.
+ */
+template <typename R>
+std::future<R> AsyncWalletCall(const WalletConnectorPtr & conn, std::function<R(WalletConnector & conn)> call)
+{
+    auto task = std::make_shared<std::packaged_task<R()>>([conn, call]() { return call(*conn); });
+    std::future<R> result = task->get_future();
+    WalletReactor::instance().post(conn->currency, [task]() { (*task)(); });
+    return result;
+}
+
 } // namespace xbridge
 
 #endif // BLOCKNET_XBRIDGE_XBRIDGEWALLETCONNECTOR_H
@@ -31,11 +31,6 @@ bool getnetworkinfo(const std::string & rpcuser, const std::string & rpcpasswd,
                     const std::string & rpcip, const std::string & rpcport,
                     WalletInfo & info);
 
-bool decodeRawTransaction(const std::string & rpcuser, const std::string & rpcpasswd,
-                          const std::string & rpcip, const std::string & rpcport,
-                          const std::string & rawtx,
-                          std::string & txid, std::string & tx);
-
 }
 
 //******************************************************************************
@@ -756,16 +751,6 @@ CashAddrContent DecodeCashAddrContent(const std::string & addr,
 
 } // namespace
 
-//******************************************************************************
-//******************************************************************************
-xbridge::CTransactionPtr createTransaction(const bool txWithTimeField);
-xbridge::CTransactionPtr createTransaction(const std::vector<XTxIn> & inputs,
-                                           const std::vector<std::pair<std::string, double> >  & outputs,
-                                           const uint64_t COIN,
-                                           const uint32_t txversion,
-                                           const uint32_t lockTime,
-                                           const bool txWithTimeField);
-
 //******************************************************************************
 //******************************************************************************
 BchWalletConnector::BchWalletConnector()
@@ -830,141 +815,12 @@ std::string BchWalletConnector::scriptIdToString(const std::vector<unsigned char
 
 //******************************************************************************
 //******************************************************************************
-xbridge::CTransactionPtr createTransaction(const bool txWithTimeField = false);
-xbridge::CTransactionPtr createTransaction(const WalletConnector & conn,
-                                           const std::vector<XTxIn> & inputs,
-                                           const std::vector<std::pair<std::string, double> >  & outputs,
-                                           const uint64_t COIN,
-                                           const uint32_t txversion,
-                                           const uint32_t lockTime,
-                                           const bool txWithTimeField = false);
-
-//******************************************************************************
-//******************************************************************************
-bool BchWalletConnector::createRefundTransaction(const std::vector<XTxIn> & inputs,
-                                                 const std::vector<std::pair<std::string, double> > & outputs,
-                                                 const std::vector<unsigned char> & mpubKey,
-                                                 const std::vector<unsigned char> & mprivKey,
-                                                 const std::vector<unsigned char> & innerScript,
-                                                 const uint32_t lockTime,
-                                                 std::string & txId,
-                                                 std::string & rawTx)
-{
-    xbridge::CTransactionPtr txUnsigned = createTransaction(*this, inputs, outputs, COIN, txVersion, lockTime, txWithTimeField);
-    // Correctly set tx input sequence. If lockTime is specified sequence must be 2^32-2, otherwise 2^32-1 (Final)
-    uint32_t sequence = lockTime > 0 ? xbridge::SEQUENCE_FINAL-1 : xbridge::SEQUENCE_FINAL;
-    txUnsigned->vin[0].nSequence = sequence;
-
-    CScript inner(innerScript.begin(), innerScript.end());
-
-    CScript redeem;
-    {
-        CScript tmp;
-        tmp << ToByteVector(mpubKey) << OP_TRUE << ToByteVector(inner);
-
-        SigHashType sigHashType = SigHashType(SIGHASH_ALL).withForkId();
-        std::vector<unsigned char> signature;
-        uint256 hash = xbridge::SignatureHash(inner, txUnsigned, 0, sigHashType, inputs[0].amount*COIN);
-        if (!m_cp.sign(mprivKey, hash, signature))
-        {
-            // cancel transaction
-            LOG() << "sign transaction error, transaction canceled " << __FUNCTION__;
-//                sendCancelTransaction(xtx, crNotSigned);
-            return false;
-        }
-
-        signature.push_back(uint8_t(sigHashType.getRawSigHashType()));
-
-        redeem << signature;
-        redeem += tmp;
-    }
-
-    xbridge::CTransactionPtr tx(createTransaction(txWithTimeField));
-    if (!tx)
-    {
-        ERR() << "transaction not created " << __FUNCTION__;
-//            sendCancelTransaction(xtx, crBadSettings);
-        return false;
-    }
-    tx->nVersion  = txUnsigned->nVersion;
-    tx->vin.push_back(CTxIn(txUnsigned->vin[0].prevout, redeem, sequence));
-    tx->vout      = txUnsigned->vout;
-    tx->nLockTime = txUnsigned->nLockTime;
-
-    rawTx = tx->toString();
-
-    std::string json;
-    std::string reftxid;
-    if (!rpc::decodeRawTransaction(m_user, m_passwd, m_ip, m_port, rawTx, reftxid, json))
-    {
-        LOG() << "decode signed transaction error, transaction canceled " << __FUNCTION__;
-//            sendCancelTransaction(xtx, crRpcError);
-            return true;
-    }
-
-    txId  = reftxid;
-
-    return true;
-}
-
-//******************************************************************************
-//******************************************************************************
-bool BchWalletConnector::createPaymentTransaction(const std::vector<XTxIn> & inputs,
-                                                  const std::vector<std::pair<std::string, double> > & outputs,
-                                                  const std::vector<unsigned char> & mpubKey,
-                                                  const std::vector<unsigned char> & mprivKey,
-                                                  const std::vector<unsigned char> & xpubKey,
-                                                  const std::vector<unsigned char> & innerScript,
-                                                  std::string & txId,
-                                                  std::string & rawTx)
+uint256 BchWalletConnector::signatureHash(const CScript & inner, const CTransactionPtr & tx, const uint32_t nIn,
+                                          const CAmount amount, uint32_t & hashType) const
 {
-    xbridge::CTransactionPtr txUnsigned = createTransaction(*this, inputs, outputs, COIN, txVersion, 0, txWithTimeField);
-
-    CScript inner(innerScript.begin(), innerScript.end());
-
     SigHashType sigHashType = SigHashType(SIGHASH_ALL).withForkId();
-    std::vector<unsigned char> signature;
-    uint256 hash = SignatureHash(inner, txUnsigned, 0, sigHashType, inputs[0].amount*COIN);
-    if (!m_cp.sign(mprivKey, hash, signature))
-    {
-        // cancel transaction
-        LOG() << "sign transaction error, transaction canceled " << __FUNCTION__;
-//                sendCancelTransaction(xtx, crNotSigned);
-        return false;
-    }
-
-    signature.push_back(uint8_t(sigHashType.getRawSigHashType()));
-
-    CScript redeem;
-    redeem << xpubKey
-           << signature << mpubKey
-           << OP_FALSE << ToByteVector(inner);
-
-    xbridge::CTransactionPtr tx(createTransaction(txWithTimeField));
-    if (!tx)
-    {
-        ERR() << "transaction not created " << __FUNCTION__;
-//                sendCancelTransaction(xtx, crBadSettings);
-        return false;
-    }
-    tx->nVersion  = txUnsigned->nVersion;
-    tx->vin.push_back(CTxIn(txUnsigned->vin[0].prevout, redeem));
-    tx->vout      = txUnsigned->vout;
-
-    rawTx = tx->toString();
-
-    std::string json;
-    std::string paytxid;
-    if (!rpc::decodeRawTransaction(m_user, m_passwd, m_ip, m_port, rawTx, paytxid, json))
-    {
-            LOG() << "decode signed transaction error, transaction canceled " << __FUNCTION__;
-//                sendCancelTransaction(xtx, crRpcError);
-        return true;
-    }
-
-    txId  = paytxid;
-
-    return true;
+    hashType = sigHashType.getRawSigHashType();
+    return xbridge::SignatureHash(inner, tx, nIn, sigHashType, amount);
 }
 
 } // namespace xbridge
@@ -34,24 +34,9 @@ public:
 
     std::string scriptIdToString(const std::vector<unsigned char> & id) const;
 
-public:
-    bool createRefundTransaction(const std::vector<XTxIn> & inputs,
-                                 const std::vector<std::pair<std::string, double> > & outputs,
-                                 const std::vector<unsigned char> & mpubKey,
-                                 const std::vector<unsigned char> & mprivKey,
-                                 const std::vector<unsigned char> & innerScript,
-                                 const uint32_t lockTime,
-                                 std::string & txId,
-                                 std::string & rawTx);
-
-    bool createPaymentTransaction(const std::vector<XTxIn> & inputs,
-                                  const std::vector<std::pair<std::string, double> > & outputs,
-                                  const std::vector<unsigned char> & mpubKey,
-                                  const std::vector<unsigned char> & mprivKey,
-                                  const std::vector<unsigned char> & xpubKey,
-                                  const std::vector<unsigned char> & innerScript,
-                                  std::string & txId,
-                                  std::string & rawTx);
+protected:
+    uint256 signatureHash(const CScript & inner, const CTransactionPtr & tx, const uint32_t nIn,
+                          const CAmount amount, uint32_t & hashType) const override;
 };
 
 } // namespace xbridge
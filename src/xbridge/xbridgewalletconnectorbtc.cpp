@@ -7,6 +7,7 @@
 
 #include <xbridge/xbridgewalletconnectorbtc.h>
 
+#include <xbridge/bitcoinrpcconnector.h>
 #include <xbridge/util/logger.h>
 #include <xbridge/util/xutil.h>
 #include <xbridge/xbitcoinaddress.h>
@@ -14,7 +15,13 @@
 #include <xbridge/xbridgecryptoproviderbtc.h>
 
 #include <base58.h>
+#include <core_io.h>
+#include <index/spentindex.h>
+#include <key_io.h>
 #include <primitives/transaction.h>
+#include <script/standard.h>
+#include <txmempool.h>
+#include <validation.h>
 
 #include <json/json_spirit_reader_template.h>
 #include <json/json_spirit_writer_template.h>
@@ -614,6 +621,42 @@ bool lockUnspent(const std::string & rpcuser,
     return true;
 }
 
+//*****************************************************************************
+//*****************************************************************************
+static bool parsetxout(const Object & reply, wallet::UtxoEntry & txout)
+{
+    // Parse reply
+    const Value & result = find_value(reply, "result");
+    const Value & error  = find_value(reply, "error");
+
+    if (error.type() != null_type)
+    {
+        // Error
+        LOG() << "error: " << write_string(error, false);
+        // int code = find_value(error.get_obj(), "code").get_int();
+        return false;
+    }
+    else if (result.type() != obj_type)
+    {
+        // Result
+        LOG() << "result not an object " <<
+                 (result.type() == null_type ? "" :
+                  result.type() == str_type  ? result.get_str() :
+                                               write_string(result, true));
+        return false;
+    }
+
+    Object o = result.get_obj();
+    txout.amount = find_value(o, "value").get_real();
+
+    // Assign confirmations
+    const auto & rconfs = find_value(o, "confirmations");
+    if (rconfs.type() == int_type)
+        txout.setConfirmations(rconfs.get_int());
+
+    return true;
+}
+
 //*****************************************************************************
 //*****************************************************************************
 bool gettxout(const std::string & rpcuser,
@@ -632,39 +675,47 @@ bool gettxout(const std::string & rpcuser,
         params.push_back(txout.txId);
         params.push_back(static_cast<int>(txout.vout));
         Object reply = CallRPC(rpcuser, rpcpasswd, rpcip, rpcport, "gettxout", params);
+        return parsetxout(reply, txout);
+    }
+    catch (std::exception & e)
+    {
+        LOG() << "gettxout exception " << e.what();
+        return false;
+    }
+}
 
-        // Parse reply
-        const Value & result = find_value(reply, "result");
-        const Value & error  = find_value(reply, "error");
+//*****************************************************************************
+//*****************************************************************************
+bool gettxouts(const std::string & rpcuser,
+               const std::string & rpcpasswd,
+               const std::string & rpcip,
+               const std::string & rpcport,
+               std::vector<wallet::UtxoEntry> & txouts,
+               std::vector<bool> & found)
+{
+    try
+    {
+        LOG() << "rpc call <gettxout> batch of " << txouts.size();
 
-        if (error.type() != null_type)
-        {
-            // Error
-            LOG() << "error: " << write_string(error, false);
-            // int code = find_value(error.get_obj(), "code").get_int();
-            return false;
-        }
-        else if (result.type() != obj_type)
+        std::vector<std::pair<std::string, Array>> calls;
+        calls.reserve(txouts.size());
+        for (auto & txout : txouts)
         {
-            // Result
-            LOG() << "result not an object " <<
-                     (result.type() == null_type ? "" :
-                      result.type() == str_type  ? result.get_str() :
-                                                   write_string(result, true));
-            return false;
+            txout.amount = 0;
+            Array params;
+            params.push_back(txout.txId);
+            params.push_back(static_cast<int>(txout.vout));
+            calls.emplace_back("gettxout", params);
         }
 
-        Object o = result.get_obj();
-        txout.amount = find_value(o, "value").get_real();
-
-        // Assign confirmations
-        const auto & rconfs = find_value(o, "confirmations");
-        if (rconfs.type() == int_type)
-            txout.setConfirmations(rconfs.get_int());
+        const auto replies = CallRPCBatch(rpcuser, rpcpasswd, rpcip, rpcport, calls);
+        found.assign(txouts.size(), false);
+        for (size_t i = 0; i < txouts.size(); ++i)
+            found[i] = parsetxout(replies[i], txouts[i]);
     }
     catch (std::exception & e)
     {
-        LOG() << "gettxout exception " << e.what();
+        LOG() << "gettxout batch exception " << e.what();
         return false;
     }
 
@@ -1635,6 +1686,23 @@ bool BtcWalletConnector<CryptoProvider>::getTxOut(wallet::UtxoEntry & entry)
     return true;
 }
 
+//******************************************************************************
+//******************************************************************************
+template <class CryptoProvider>
+bool BtcWalletConnector<CryptoProvider>::getTxOuts(std::vector<wallet::UtxoEntry> & entries, std::vector<bool> & found)
+{
+    if (entries.size() < 2)
+        return WalletConnector::getTxOuts(entries, found);
+
+    if (!rpc::gettxouts(m_user, m_passwd, m_ip, m_port, entries, found))
+    {
+        LOG() << "batch gettxout failed, trying single calls " << __FUNCTION__;
+        return WalletConnector::getTxOuts(entries, found);
+    }
+
+    return true;
+}
+
 //******************************************************************************
 //******************************************************************************
 template <class CryptoProvider>
@@ -1711,6 +1779,13 @@ template <class CryptoProvider>
 bool BtcWalletConnector<CryptoProvider>::isUTXOSpentInTx(const std::string & txid,
         const std::string & utxoPrevTxId, const uint32_t & utxoVoutN, bool & isSpent)
 {
+    std::string spendTxId;
+    if (findUTXOSpend(utxoPrevTxId, utxoVoutN, spendTxId))
+    {
+        isSpent = !spendTxId.empty() && spendTxId == txid;
+        return true;
+    }
+
     std::string json;
     if (!rpc::getRawTransaction(m_user, m_passwd, m_ip, m_port, txid, true, json)) {
         LOG() << "rpc::getRawTransaction failed " << __FUNCTION__;
@@ -1748,6 +1823,38 @@ bool BtcWalletConnector<CryptoProvider>::isUTXOSpentInTx(const std::string & txi
     return true;
 }
 
+//******************************************************************************
+//******************************************************************************
+template <class CryptoProvider>
+bool BtcWalletConnector<CryptoProvider>::findUTXOSpend(const std::string & utxoPrevTxId,
+        const uint32_t & utxoVoutN, std::string & spendTxId)
+{
+    // spends of the node's own chain are looked up in the mempool and the spent index
+    if (!isLocalChain() || !g_spentindex || !g_spentindex->BlockUntilSyncedToCurrentChain())
+    {
+        return false;
+    }
+
+    const COutPoint outpoint(uint256S(utxoPrevTxId), utxoVoutN);
+    spendTxId.clear();
+    {
+        LOCK(mempool.cs);
+        const ::CTransaction * tx = mempool.GetConflictTx(outpoint);
+        if (tx)
+        {
+            spendTxId = tx->GetHash().GetHex();
+            return true;
+        }
+    }
+
+    SpentIndexEntry entry;
+    if (g_spentindex->FindSpend(outpoint, entry))
+    {
+        spendTxId = entry.txid.GetHex();
+    }
+    return true;
+}
+
 //******************************************************************************
 //******************************************************************************
 template <class CryptoProvider>
@@ -2319,6 +2426,11 @@ bool BtcWalletConnector<CryptoProvider>::createDepositTransaction(const std::vec
                                                                   uint32_t & txVout,
                                                                   std::string & rawTx)
 {
+    if (isLocalChain() && createLocalDepositTransaction(inputs, outputs, txId, txVout, rawTx))
+    {
+        return true;
+    }
+
     if (!rpc::createRawTransaction(m_user, m_passwd, m_ip, m_port,
                                    inputs, outputs, 0, rawTx, true))
     {
@@ -2329,7 +2441,7 @@ bool BtcWalletConnector<CryptoProvider>::createDepositTransaction(const std::vec
 
     // sign
     bool complete = false;
-    if (!rpc::signRawTransaction(m_user, m_passwd, m_ip, m_port, rawTx, complete))
+    if (!signTransaction(rawTx, complete))
     {
         // do not sign, cancel
         LOG() << "sign transaction error, transaction canceled " << __FUNCTION__;
@@ -2356,6 +2468,73 @@ bool BtcWalletConnector<CryptoProvider>::createDepositTransaction(const std::vec
     return true;
 }
 
+//******************************************************************************
+//******************************************************************************
+template <class CryptoProvider>
+bool BtcWalletConnector<CryptoProvider>::signTransaction(std::string & rawTx, bool & complete) const
+{
+    return rpc::signRawTransaction(m_user, m_passwd, m_ip, m_port, rawTx, complete);
+}
+
+//******************************************************************************
+//******************************************************************************
+template <class CryptoProvider>
+uint256 BtcWalletConnector<CryptoProvider>::signatureHash(const CScript & inner, const CTransactionPtr & tx,
+                                                         const uint32_t nIn, const CAmount /*amount*/,
+                                                         uint32_t & hashType) const
+{
+    hashType = SIGHASH_ALL;
+    return SignatureHash(inner, tx, nIn, SIGHASH_ALL);
+}
+
+//******************************************************************************
+//******************************************************************************
+template <class CryptoProvider>
+bool BtcWalletConnector<CryptoProvider>::isLocalChain() const
+{
+    return currency == "BLOCK";
+}
+
+//******************************************************************************
+//******************************************************************************
+template <class CryptoProvider>
+bool BtcWalletConnector<CryptoProvider>::createLocalDepositTransaction(const std::vector<XTxIn> & inputs,
+                                                                       const std::vector<std::pair<std::string, double> > & outputs,
+                                                                       std::string & txId,
+                                                                       uint32_t & txVout,
+                                                                       std::string & rawTx)
+{
+    CMutableTransaction mtx;
+    for (const XTxIn & in : inputs)
+    {
+        mtx.vin.emplace_back(COutPoint(uint256S(in.txid), in.n), CScript(), CTxIn::SEQUENCE_FINAL);
+    }
+
+    for (const std::pair<std::string, double> & out : outputs)
+    {
+        const CTxDestination dest = DecodeDestination(out.first);
+        if (!IsValidDestination(dest))
+        {
+            LOG() << "invalid local address " << out.first << " " << __FUNCTION__;
+            return false;
+        }
+        mtx.vout.emplace_back(static_cast<CAmount>(std::llround(out.second * COIN)), GetScriptForDestination(dest));
+    }
+
+    // falls back to the wallet rpc if the inputs aren't in the node's wallets
+    if (!rpc::signLocalTransaction(mtx))
+    {
+        return false;
+    }
+
+    const ::CTransaction tx(mtx);
+    rawTx  = EncodeHexTx(tx);
+    txId   = tx.GetHash().GetHex();
+    txVout = 0;
+
+    return true;
+}
+
 //******************************************************************************
 //******************************************************************************
 xbridge::CTransactionPtr createTransaction(const bool txWithTimeField)
@@ -2423,7 +2602,8 @@ bool BtcWalletConnector<CryptoProvider>::createRefundTransaction(const std::vect
         tmp << ToByteVector(mpubKey) << OP_TRUE << ToByteVector(inner);
 
         std::vector<unsigned char> signature;
-        uint256 hash = SignatureHash(inner, txUnsigned, 0, SIGHASH_ALL);
+        uint32_t hashType;
+        uint256 hash = signatureHash(inner, txUnsigned, 0, inputs[0].amount*COIN, hashType);
         if (!m_cp.sign(mprivKey, hash, signature))
         {
             // cancel transaction
@@ -2432,7 +2612,7 @@ bool BtcWalletConnector<CryptoProvider>::createRefundTransaction(const std::vect
             return false;
         }
 
-        signature.push_back((unsigned char)SIGHASH_ALL);
+        signature.push_back(static_cast<unsigned char>(hashType));
 
         redeem << signature;
         redeem += tmp;
@@ -2453,6 +2633,13 @@ bool BtcWalletConnector<CryptoProvider>::createRefundTransaction(const std::vect
 
     rawTx = tx->toString();
 
+    if (isLocalChain())
+    {
+        // no need for a decoderawtransaction round trip
+        txId = tx->GetHash().GetHex();
+        return true;
+    }
+
     std::string json;
     std::string reftxid;
     if (!rpc::decodeRawTransaction(m_user, m_passwd, m_ip, m_port, rawTx, reftxid, json))
@@ -2487,7 +2674,8 @@ bool BtcWalletConnector<CryptoProvider>::createPaymentTransaction(const std::vec
     CScript inner(innerScript.begin(), innerScript.end());
 
     std::vector<unsigned char> signature;
-    uint256 hash = SignatureHash(inner, txUnsigned, 0, SIGHASH_ALL);
+    uint32_t hashType;
+    uint256 hash = signatureHash(inner, txUnsigned, 0, inputs[0].amount*COIN, hashType);
     if (!m_cp.sign(mprivKey, hash, signature))
     {
         // cancel transaction
@@ -2496,7 +2684,7 @@ bool BtcWalletConnector<CryptoProvider>::createPaymentTransaction(const std::vec
         return false;
     }
 
-    signature.push_back((unsigned char)SIGHASH_ALL);
+    signature.push_back(static_cast<unsigned char>(hashType));
 
     CScript redeem;
     redeem << xpubKey
@@ -2517,6 +2705,13 @@ bool BtcWalletConnector<CryptoProvider>::createPaymentTransaction(const std::vec
 
     rawTx = tx->toString();
 
+    if (isLocalChain())
+    {
+        // no need for a decoderawtransaction round trip
+        txId = tx->GetHash().GetHex();
+        return true;
+    }
+
     std::string json;
     std::string paytxid;
     if (!rpc::decodeRawTransaction(m_user, m_passwd, m_ip, m_port, rawTx, paytxid, json))
@@ -8,12 +8,15 @@
 #ifndef BLOCKNET_XBRIDGE_XBRIDGEWALLETCONNECTORBTC_H
 #define BLOCKNET_XBRIDGE_XBRIDGEWALLETCONNECTORBTC_H
 
+#include <xbridge/xbitcointransaction.h>
 #include <xbridge/xbridgewalletconnector.h>
 
+#include <amount.h>
 #include <event2/buffer.h>
 #include <rpc/protocol.h>
 #include <rpc/client.h>
 #include <support/events.h>
+#include <support/httppool.h>
 #include <tinyformat.h>
 #include <util/strencodings.h>
 #include <util/system.h>
@@ -23,6 +26,7 @@
 
 #include <json/json_spirit.h>
 #include <json/json_spirit_reader_template.h>
+#include <json/json_spirit_utils.h>
 #include <json/json_spirit_writer_template.h>
 
 //*****************************************************************************
@@ -32,11 +36,12 @@ namespace xbridge
     /** Reply structure for request_done to fill in */
     struct HTTPReply
     {
-        HTTPReply(): status(0), error(-1) {}
+        HTTPReply(): status(0), error(-1), base(nullptr) {}
 
         int status;
         int error;
         std::string body;
+        struct event_base *base; // loop to exit once the request is done
     };
 
     static const char *http_errorstring(int code)
@@ -64,6 +69,9 @@ namespace xbridge
     static void http_request_done(struct evhttp_request *req, void *ctx)
     {
         HTTPReply *reply = static_cast<HTTPReply*>(ctx);
+        // Keep-alive connections keep the loop busy, exit as soon as the request is done
+        if (reply->base)
+            event_base_loopbreak(reply->base);
 
         if (req == nullptr) {
             /* If req is nullptr, it means an error occurred while connecting: the
@@ -94,6 +102,32 @@ namespace xbridge
     }
 #endif
 
+/** Default number of idle keep-alive connections kept per wallet rpc endpoint */
+static const int DEFAULT_XBRIDGE_RPC_POOL_SIZE = 4;
+/** Default number of seconds an idle wallet rpc connection is kept open */
+static const int DEFAULT_XBRIDGE_RPC_POOL_IDLE = 60;
+
+/**
+ * Pool of persistent keep-alive connections to the wallet rpc endpoints, shared by all
+ * wallet connectors.
+ */
+class RPCConnectionPool : public HTTPConnectionPool
+{
+public:
+    static RPCConnectionPool & instance()
+    {
+        static RPCConnectionPool pool;
+        return pool;
+    }
+
+protected:
+    RPCConnectionPool()
+        : HTTPConnectionPool(static_cast<size_t>(std::max<int64_t>(0, gArgs.GetArg("-rpcxbridgepoolsize", DEFAULT_XBRIDGE_RPC_POOL_SIZE))),
+                             gArgs.GetArg("-rpcxbridgepoolidle", DEFAULT_XBRIDGE_RPC_POOL_IDLE),
+                             static_cast<int>(gArgs.GetArg("-rpcxbridgetimeout", 120)))
+    {}
+};
+
 static UniValue XBridgeJSONRPCRequestObj(const std::string& strMethod, const UniValue& params,
         const UniValue& id, const std::string& jsonver="")
 {
@@ -106,58 +140,98 @@ static UniValue XBridgeJSONRPCRequestObj(const std::string& strMethod, const Uni
     return request;
 }
 
-static json_spirit::Object CallRPC(const std::string & rpcuser, const std::string & rpcpasswd,
-                      const std::string & rpcip, const std::string & rpcport,
-                      const std::string & strMethod, const json_spirit::Array & params,
-                      const std::string & jsonver="")
+/**
+ * Converts json_spirit data to UniValue without a round trip through json text.
+ * Reals keep the fixed 8 decimal format the wallets were sent before.
+ */
+static UniValue XBridgeToUniValue(const json_spirit::Value & value)
 {
-    const std::string & host = rpcip;
-    const int port = stoi(rpcport);
+    switch (value.type()) {
+        case json_spirit::obj_type: {
+            const json_spirit::Object & obj = value.get_obj();
+            UniValue r(UniValue::VOBJ);
+            for (const auto & pair : obj)
+                r.pushKV(pair.name_, XBridgeToUniValue(pair.value_));
+            return r;
+        }
+        case json_spirit::array_type: {
+            const json_spirit::Array & arr = value.get_array();
+            UniValue r(UniValue::VARR);
+            for (const auto & item : arr)
+                r.push_back(XBridgeToUniValue(item));
+            return r;
+        }
+        case json_spirit::str_type:
+            return UniValue(value.get_str());
+        case json_spirit::bool_type:
+            return UniValue(value.get_bool());
+        case json_spirit::int_type:
+            return value.is_uint64() ? UniValue(value.get_uint64()) : UniValue(value.get_int64());
+        case json_spirit::real_type:
+            return UniValue(UniValue::VNUM, strprintf("%.8f", value.get_real()));
+        case json_spirit::null_type:
+        default:
+            return NullUniValue;
+    }
+}
 
-    // Obtain event base
-    raii_event_base base = obtain_event_base();
+static UniValue XBridgeJSONRPCParams(const json_spirit::Array & params)
+{
+    return XBridgeToUniValue(json_spirit::Value(params));
+}
 
-    // Synchronously look up hostname
-    raii_evhttp_connection evcon = obtain_evhttp_connection_base(base.get(), host, port);
-    evhttp_connection_set_timeout(evcon.get(), gArgs.GetArg("-rpcxbridgetimeout", 120));
+/**
+ * Posts the json-rpc request to the wallet and returns the parsed reply.
+ */
+static json_spirit::Value PostRPC(const std::string & rpcuser, const std::string & rpcpasswd,
+                                  const std::string & rpcip, const std::string & rpcport,
+                                  const std::string & strRequest)
+{
+    const std::string & host = rpcip;
+    const int port = stoi(rpcport);
 
+    auto & pool = RPCConnectionPool::instance();
     HTTPReply response;
-    raii_evhttp_request req = obtain_evhttp_request(http_request_done, (void*)&response);
-    if (req == nullptr)
-        throw std::runtime_error("create http request failed");
+    bool reused{false};
+    do {
+        // Use a persistent connection from the pool, the handshake is only done for new connections
+        std::string auth;
+        RPCConnectionPool::ConnectionPtr conn = pool.acquire(host, port, rpcuser, rpcpasswd, reused, auth);
+
+        response = HTTPReply();
+        response.base = conn->base.get();
+        raii_evhttp_request req = obtain_evhttp_request(http_request_done, (void*)&response);
+        if (req == nullptr)
+            throw std::runtime_error("create http request failed");
 #if LIBEVENT_VERSION_NUMBER >= 0x02010300
-    evhttp_request_set_error_cb(req.get(), http_error_cb);
+        evhttp_request_set_error_cb(req.get(), http_error_cb);
 #endif
 
-    // Get credentials
-    std::string strRPCUserColonPass = rpcuser + ":" + rpcpasswd;
-
-    struct evkeyvalq* output_headers = evhttp_request_get_output_headers(req.get());
-    assert(output_headers);
-    evhttp_add_header(output_headers, "Host", host.c_str());
-    evhttp_add_header(output_headers, "Connection", "close");
-    evhttp_add_header(output_headers, "Authorization", (std::string("Basic ") + EncodeBase64(strRPCUserColonPass)).c_str());
-
-    // Attach request data
-    const auto tostring = json_spirit::write_string(json_spirit::Value(params), json_spirit::none, 8);
-    UniValue toval;
-    if (!toval.read(tostring))
-        throw std::runtime_error(strprintf("failed to decode json_spirit data: %s", tostring));
-    const auto reqobj = XBridgeJSONRPCRequestObj(strMethod, toval.get_array(), 1, jsonver);
-    std::string strRequest = reqobj.write() + "\n";
-    struct evbuffer* output_buffer = evhttp_request_get_output_buffer(req.get());
-    assert(output_buffer);
-    evbuffer_add(output_buffer, strRequest.data(), strRequest.size());
-
-    // check if we should use a special wallet endpoint
-    std::string endpoint = "/";
-    int r = evhttp_make_request(evcon.get(), req.get(), EVHTTP_REQ_POST, endpoint.c_str());
-    req.release(); // ownership moved to evcon in above call
-    if (r != 0) {
-        throw std::runtime_error("send http request failed");
-    }
+        struct evkeyvalq* output_headers = evhttp_request_get_output_headers(req.get());
+        assert(output_headers);
+        evhttp_add_header(output_headers, "Host", host.c_str());
+        evhttp_add_header(output_headers, "Connection", "keep-alive");
+        evhttp_add_header(output_headers, "Authorization", auth.c_str());
+
+        struct evbuffer* output_buffer = evhttp_request_get_output_buffer(req.get());
+        assert(output_buffer);
+        evbuffer_add(output_buffer, strRequest.data(), strRequest.size());
+
+        // check if we should use a special wallet endpoint
+        std::string endpoint = "/";
+        int r = evhttp_make_request(conn->evcon.get(), req.get(), EVHTTP_REQ_POST, endpoint.c_str());
+        req.release(); // ownership moved to evcon in above call
+        if (r != 0) {
+            throw std::runtime_error("send http request failed");
+        }
 
-    event_base_dispatch(base.get());
+        event_base_dispatch(conn->base.get());
+
+        // Only healthy connections go back to the pool. A failed request on a reused
+        // connection is retried once on a new connection in case the server closed it.
+        if (response.status != 0)
+            pool.release(host, port, rpcuser, rpcpasswd, std::move(conn));
+    } while (response.status == 0 && reused);
 
     if (response.status == 0) {
         std::string responseErrorMessage;
@@ -176,6 +250,16 @@ static json_spirit::Object CallRPC(const std::string & rpcuser, const std::strin
     json_spirit::Value valReply;
     if (!json_spirit::read_string(response.body, valReply))
         throw std::runtime_error("couldn't parse reply from server");
+    return valReply;
+}
+
+static json_spirit::Object CallRPC(const std::string & rpcuser, const std::string & rpcpasswd,
+                      const std::string & rpcip, const std::string & rpcport,
+                      const std::string & strMethod, const json_spirit::Array & params,
+                      const std::string & jsonver="")
+{
+    const auto reqobj = XBridgeJSONRPCRequestObj(strMethod, XBridgeJSONRPCParams(params), 1, jsonver);
+    const json_spirit::Value valReply = PostRPC(rpcuser, rpcpasswd, rpcip, rpcport, reqobj.write() + "\n");
     const json_spirit::Object& reply = valReply.get_obj();
     if (reply.empty())
         throw std::runtime_error("expected reply to have result, error and id properties");
@@ -183,6 +267,43 @@ static json_spirit::Object CallRPC(const std::string & rpcuser, const std::strin
     return reply;
 }
 
+/**
+ * Sends the calls in a single json-rpc batch request. Returns the reply objects in the same
+ * order as the calls.
+ */
+static std::vector<json_spirit::Object> CallRPCBatch(const std::string & rpcuser, const std::string & rpcpasswd,
+                      const std::string & rpcip, const std::string & rpcport,
+                      const std::vector<std::pair<std::string, json_spirit::Array>> & calls,
+                      const std::string & jsonver="")
+{
+    if (calls.empty())
+        return {};
+    UniValue batch(UniValue::VARR);
+    for (size_t i = 0; i < calls.size(); ++i)
+        batch.push_back(XBridgeJSONRPCRequestObj(calls[i].first, XBridgeJSONRPCParams(calls[i].second),
+                                                 static_cast<int>(i), jsonver));
+    const json_spirit::Value valReply = PostRPC(rpcuser, rpcpasswd, rpcip, rpcport, batch.write() + "\n");
+    if (valReply.type() != json_spirit::array_type)
+        throw std::runtime_error("expected batch reply to be an array");
+
+    // Replies may arrive in any order, match them to the calls by id
+    std::vector<json_spirit::Object> replies(calls.size());
+    for (const auto & item : valReply.get_array()) {
+        if (item.type() != json_spirit::obj_type)
+            throw std::runtime_error("expected batch reply to contain objects");
+        const json_spirit::Value & id = json_spirit::find_value(item.get_obj(), "id");
+        if (id.type() != json_spirit::int_type || id.get_int() < 0 || id.get_int() >= static_cast<int>(calls.size()))
+            throw std::runtime_error("unexpected id in batch reply");
+        replies[id.get_int()] = item.get_obj();
+    }
+    for (const auto & reply : replies) {
+        if (reply.empty())
+            throw std::runtime_error("expected batch reply to have a result for every call");
+    }
+
+    return replies;
+}
+
 //*****************************************************************************
 //*****************************************************************************
 template <class CryptoProvider>
@@ -210,6 +331,7 @@ public:
     bool getNewAddress(std::string & addr);
 
     bool getTxOut(wallet::UtxoEntry & entry);
+    bool getTxOuts(std::vector<wallet::UtxoEntry> & entries, std::vector<bool> & found);
 
     bool sendRawTransaction(const std::string & rawtx,
                             std::string & txid,
@@ -292,8 +414,51 @@ public:
     bool isUTXOSpentInTx(const std::string & txid, const std::string & utxoPrevTxId,
                          const uint32_t & utxoVoutN, bool & isSpent);
 
+    bool findUTXOSpend(const std::string & utxoPrevTxId, const uint32_t & utxoVoutN,
+                       std::string & spendTxId);
+
     bool getTransactionsInBlock(const std::string & blockHash, std::vector<std::string> & txids);
 
+protected:
+    /**
+     * @brief isLocalChain
+     * @return true if the connector is for the chain of this node, its wallets are available in-process
+     */
+    bool isLocalChain() const;
+
+    /**
+     * @brief createLocalDepositTransaction - create and sign the deposit with the node's wallets,
+     * without rpc round trips
+     * @return false if the inputs aren't owned by an unlocked local wallet
+     */
+    bool createLocalDepositTransaction(const std::vector<XTxIn> & inputs,
+                                       const std::vector<std::pair<std::string, double> > & outputs,
+                                       std::string & txId,
+                                       uint32_t & txVout,
+                                       std::string & rawTx);
+
+protected:
+    /**
+     * @brief signatureHash - hash signed by the refund and payment transactions, chains
+     * with their own sighash algorithm override it
+     * @param inner deposit script spent by the input
+     * @param tx
+     * @param nIn input index
+     * @param amount value of the spent deposit output
+     * @param hashType sighash type appended to the signature
+     * @return
+     */
+    virtual uint256 signatureHash(const CScript & inner, const CTransactionPtr & tx, const uint32_t nIn,
+                                  const CAmount amount, uint32_t & hashType) const;
+
+    /**
+     * @brief signTransaction - sign the deposit transaction with the wallet of the backend
+     * @param rawTx
+     * @param complete true if all inputs were signed
+     * @return false on rpc error
+     */
+    virtual bool signTransaction(std::string & rawTx, bool & complete) const;
+
 protected:
     CryptoProvider m_cp;
 };
@@ -26,25 +26,6 @@ namespace rpc
 
 using namespace json_spirit;
 
-//*****************************************************************************
-//*****************************************************************************
-bool createRawTransaction(const std::string & rpcuser,
-                          const std::string & rpcpasswd,
-                          const std::string & rpcip,
-                          const std::string & rpcport,
-                          const std::vector<XTxIn> & inputs,
-                          const std::vector<std::pair<std::string, double> > & outputs,
-                          const uint32_t lockTime,
-                          std::string & tx,
-                          bool cltv);
-
-//*****************************************************************************
-//*****************************************************************************
-bool decodeRawTransaction(const std::string & rpcuser, const std::string & rpcpasswd,
-                          const std::string & rpcip, const std::string & rpcport,
-                          const std::string & rawtx,
-                          std::string & txid, std::string & tx);
-
 //*****************************************************************************
 //*****************************************************************************
 namespace
@@ -128,47 +109,9 @@ DgbWalletConnector::DgbWalletConnector()
 
 //******************************************************************************
 //******************************************************************************
-bool DgbWalletConnector::createDepositTransaction(const std::vector<XTxIn> & inputs,
-                                                  const std::vector<std::pair<std::string, double> > & outputs,
-                                                  std::string & txId,
-                                                  uint32_t & txVout,
-                                                  std::string & rawTx)
+bool DgbWalletConnector::signTransaction(std::string & rawTx, bool & complete) const
 {
-    if (!rpc::createRawTransaction(m_user, m_passwd, m_ip, m_port,
-                                   inputs, outputs, 0, rawTx, true))
-    {
-        // cancel transaction
-        LOG() << "create transaction error, transaction canceled " << __FUNCTION__;
-        return false;
-    }
-
-    // sign
-    bool complete = false;
-    if (!rpc::signRawTransactionWithWallet(m_user, m_passwd, m_ip, m_port, rawTx, complete))
-    {
-        // do not sign, cancel
-        LOG() << "sign transaction error, transaction canceled " << __FUNCTION__;
-        return false;
-    }
-
-    if(!complete)
-    {
-        LOG() << "transaction not fully signed " << __FUNCTION__;
-        return false;
-    }
-
-    std::string txid;
-    std::string json;
-    if (!rpc::decodeRawTransaction(m_user, m_passwd, m_ip, m_port, rawTx, txid, json))
-    {
-        LOG() << "decode signed transaction error, transaction canceled " << __FUNCTION__;
-        return false;
-    }
-
-    txId = txid;
-    txVout = 0;
-
-    return true;
+    return rpc::signRawTransactionWithWallet(m_user, m_passwd, m_ip, m_port, rawTx, complete);
 }
 
 } // namespace xbridge
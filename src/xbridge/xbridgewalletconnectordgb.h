@@ -20,12 +20,8 @@ class DgbWalletConnector : public BtcWalletConnector<BtcCryptoProvider>
 public:
     DgbWalletConnector();
 
-public:
-    bool createDepositTransaction(const std::vector<XTxIn> & inputs,
-                                  const std::vector<std::pair<std::string, double> > & outputs,
-                                  std::string & txId,
-                                  uint32_t & txVout,
-                                  std::string & rawTx);
+protected:
+    bool signTransaction(std::string & rawTx, bool & complete) const override;
 };
 
 } // namespace xbridge
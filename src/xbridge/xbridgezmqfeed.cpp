@@ -0,0 +1,121 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#if defined(HAVE_CONFIG_H)
+#include <config/bitcoin-config.h>
+#endif
+
+#include <xbridge/xbridgezmqfeed.h>
+
+#include <xbridge/util/logger.h>
+
+#include <util/system.h>
+
+#include <cstring>
+
+#if ENABLE_ZMQ
+#include <zmq.h>
+#endif
+
+//*****************************************************************************
+//*****************************************************************************
+namespace xbridge
+{
+
+static const char *ZMQ_FEED_TOPICS[] = {"rawtx", "hashblock"};
+
+//*****************************************************************************
+//*****************************************************************************
+ZmqFeed::ZmqFeed(std::string currency, std::string address, Handler handler)
+    : currency(std::move(currency))
+    , address(std::move(address))
+    , handler(std::move(handler))
+{
+#if ENABLE_ZMQ
+    active = true;
+    thread = std::thread(&ZmqFeed::run, this);
+#else
+    WARN() << this->currency << " ZmqAddress is ignored, blocknet was built without zmq";
+#endif
+}
+
+//*****************************************************************************
+//*****************************************************************************
+ZmqFeed::~ZmqFeed()
+{
+    stopping = true;
+    if (thread.joinable())
+        thread.join();
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void ZmqFeed::run()
+{
+#if ENABLE_ZMQ
+    RenameThread(("blocknet-xbzmq-" + currency).c_str());
+
+    void *context = zmq_ctx_new();
+    void *socket = context ? zmq_socket(context, ZMQ_SUB) : nullptr;
+    const int linger{0};
+    if (!socket || zmq_setsockopt(socket, ZMQ_LINGER, &linger, sizeof(linger)) != 0
+                || zmq_connect(socket, address.c_str()) != 0)
+    {
+        ERR() << currency << " failed to subscribe to zmq " << address << ": " << zmq_strerror(zmq_errno());
+        active = false;
+        if (socket)
+            zmq_close(socket);
+        if (context)
+            zmq_ctx_term(context);
+        return;
+    }
+    for (const char *topic : ZMQ_FEED_TOPICS)
+        zmq_setsockopt(socket, ZMQ_SUBSCRIBE, topic, strlen(topic));
+    LOG() << currency << " subscribed to zmq " << address;
+
+    // Messages are [topic, body, sequence number]
+    std::vector<std::vector<unsigned char>> parts;
+    while (!stopping)
+    {
+        zmq_pollitem_t item{socket, 0, ZMQ_POLLIN, 0};
+        if (zmq_poll(&item, 1, 1000) <= 0 || !(item.revents & ZMQ_POLLIN))
+            continue; // wakes up every second to notice stop
+
+        parts.clear();
+        int more{0};
+        do
+        {
+            zmq_msg_t msg;
+            zmq_msg_init(&msg);
+            if (zmq_msg_recv(&msg, socket, 0) < 0)
+            {
+                zmq_msg_close(&msg);
+                break;
+            }
+            const auto data = static_cast<const unsigned char*>(zmq_msg_data(&msg));
+            parts.emplace_back(data, data + zmq_msg_size(&msg));
+            size_t size = sizeof(more);
+            zmq_getsockopt(socket, ZMQ_RCVMORE, &more, &size);
+            zmq_msg_close(&msg);
+        }
+        while (more);
+
+        if (parts.size() < 2)
+            continue;
+        try
+        {
+            handler(std::string(parts[0].begin(), parts[0].end()), parts[1]);
+        }
+        catch (std::exception & e)
+        {
+            ERR() << currency << " zmq notification failed " << e.what();
+        }
+    }
+
+    zmq_close(socket);
+    zmq_ctx_term(context);
+#endif
+}
+
+} // namespace xbridge
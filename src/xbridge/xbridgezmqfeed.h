@@ -0,0 +1,56 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BLOCKNET_XBRIDGE_XBRIDGEZMQFEED_H
+#define BLOCKNET_XBRIDGE_XBRIDGEZMQFEED_H
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+//*****************************************************************************
+//*****************************************************************************
+namespace xbridge
+{
+
+/**
+ * Subscription to the rawtx and hashblock zmq notifications of a wallet backend
+ * (-zmqpubrawtx, -zmqpubhashblock). The handler is called on the feed's thread with the
+ * topic and the message body. Zmq notifications are lossy, the feed only tells the
+ * deposit watches to check early, they still poll now and then.
+ */
+class ZmqFeed
+{
+public:
+    typedef std::function<void(const std::string & topic, const std::vector<unsigned char> & body)> Handler;
+
+    ZmqFeed(std::string currency, std::string address, Handler handler);
+    ~ZmqFeed();
+
+    const std::string & getAddress() const { return address; }
+
+    /**
+     * @brief isActive
+     * @return false if the node was built without zmq or the address is invalid
+     */
+    bool isActive() const { return active; }
+
+private:
+    void run();
+
+private:
+    const std::string currency;
+    const std::string address;
+    const Handler handler;
+
+    std::atomic<bool> active{false};
+    std::atomic<bool> stopping{false};
+    std::thread thread;
+};
+
+} // namespace xbridge
+
+#endif // BLOCKNET_XBRIDGE_XBRIDGEZMQFEED_H
@@ -4,6 +4,7 @@
 
 #include <rpc/server.h>
 
+#include <servicenode/servicenodemgr.h>
 #include <xbridge/xbridgeapp.h>
 #include <xrouter/xrouterapp.h>
 #include <xrouter/xroutererror.h>
@@ -735,10 +736,13 @@ static UniValue xrGetTxBloomFilter(const JSONRPCRequest& request)
     if (request.fHelp)
         throw std::runtime_error(
             RPCHelpMan{"xrGetTxBloomFilter",
-                "\nLists transactions in json format matching bloom filter starting with block number.\n",
+                "\nLists the raw transactions paying to or spending from the addresses starting with block number. "
+                "Service nodes match the blocks against compact block filters and only read the matching blocks. "
+                "On chains other than BLOCK spends of outputs received before the block number are not listed.\n",
                 {
                     {"currency", RPCArg::Type::STR, RPCArg::Optional::NO, "Blockchain to query"},
-                    {"filter", RPCArg::Type::STR, RPCArg::Optional::NO, "Bloom filter"},
+                    {"addresses", RPCArg::Type::STR, RPCArg::Optional::NO, "Comma delimited list of base58 addresses or hex scripts, example: address1,address2"},
+                    {"block_number", RPCArg::Type::NUM, RPCArg::Optional::OMITTED, "First block to search (default=0)"},
                     {"node_count", RPCArg::Type::NUM, RPCArg::Optional::OMITTED, "Number of XRouter nodes to query (default=1) "
                                                                                   "The most common reply will be returned (i.e. the reply "
                                                                                   "with the most consensus). To see all reply results use "
@@ -748,10 +752,10 @@ static UniValue xrGetTxBloomFilter(const JSONRPCRequest& request)
                 "\n"
                 },
                 RPCExamples{
-                    HelpExampleCli("xrGetTxBloomFilter", "BLOCK 0x0000000018")
-                  + HelpExampleRpc("xrGetTxBloomFilter", "BLOCK 0x0000000018")
-                  + HelpExampleCli("xrGetTxBloomFilter", "BLOCK 0x0000000018 2")
-                  + HelpExampleRpc("xrGetTxBloomFilter", "BLOCK 0x0000000018 2")
+                    HelpExampleCli("xrGetTxBloomFilter", "BLOCK BXziudHsEee8vDTgvXXNLCXwKouSssLMQ3 1000000")
+                  + HelpExampleRpc("xrGetTxBloomFilter", "\"BLOCK\", \"BXziudHsEee8vDTgvXXNLCXwKouSssLMQ3\", 1000000")
+                  + HelpExampleCli("xrGetTxBloomFilter", "BLOCK BXziudHsEee8vDTgvXXNLCXwKouSssLMQ3,BgSDpy7F7PuBZpG4PQfryX9m94NNcmjWAX 1000000 2")
+                  + HelpExampleRpc("xrGetTxBloomFilter", "\"BLOCK\", \"BXziudHsEee8vDTgvXXNLCXwKouSssLMQ3,BgSDpy7F7PuBZpG4PQfryX9m94NNcmjWAX\", 1000000, 2")
                 },
             }.ToString());
     Value js; json_spirit::read_string(request.params.write(), js); Array params = js.get_array();
@@ -767,7 +771,7 @@ static UniValue xrGetTxBloomFilter(const JSONRPCRequest& request)
     if (params.size() < 2)
     {
         Object error;
-        error.emplace_back("error", "Filter not specified");
+        error.emplace_back("error", "Addresses not specified");
         error.emplace_back("code", xrouter::INVALID_PARAMETERS);
         return uret_xr(error);
     }
@@ -1084,6 +1088,64 @@ static UniValue xrGetReply(const JSONRPCRequest& request)
     return uret_xr(xrouter::form_reply(uuid, reply));
 }
 
+static UniValue xrAsync(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        throw std::runtime_error(
+            RPCHelpMan{"xrAsync",
+                "\nRuns an XRouter call in the background and returns its id right away. The reply is delivered "
+                "by the long-poll endpoint GET /xrouter/reply/<id> (same authentication as the RPC server), "
+                "which answers as soon as the call completed. Replies are kept for "
+                + std::to_string(XROUTER_ASYNC_REPLY_TTL) + " seconds.\n",
+                {
+                    {"method", RPCArg::Type::STR, RPCArg::Optional::NO, "XRouter call, e.g. xrGetBlockCount"},
+                    {"params", RPCArg::Type::ARR, /* default */ "[]", "Parameters of the call",
+                        {
+                            {"param", RPCArg::Type::STR, RPCArg::Optional::OMITTED, "Parameter of the call, numbers are passed as numbers"},
+                        },
+                    },
+                },
+                RPCResult{
+                "{\n"
+                "  \"id\": \"xxxx\"     (string) Id of the reply\n"
+                "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("xrAsync", "xrGetBlockCount '[\"BTC\", 2]'")
+                  + HelpExampleRpc("xrAsync", "\"xrGetBlockCount\", [\"BTC\", 2]")
+                },
+            }.ToString());
+
+    JSONRPCRequest call(request);
+    call.strMethod = request.params[0].get_str();
+    call.params = request.params.size() > 1 ? request.params[1].get_array() : UniValue(UniValue::VARR);
+    const CRPCCommand *command = tableRPC[call.strMethod];
+    if (!command || command->category != "xrouter" || call.strMethod == "xrAsync") {
+        Object error;
+        error.emplace_back("error", "Not an XRouter call: " + call.strMethod);
+        error.emplace_back("code", xrouter::INVALID_PARAMETERS);
+        return uret_xr(error);
+    }
+
+    const std::string id = xrouter::App::instance().callAsync([call]() -> std::string {
+        try {
+            return tableRPC.execute(call).write();
+        } catch (const UniValue & error) {
+            return error.write();
+        }
+    });
+    if (id.empty()) {
+        Object error;
+        error.emplace_back("error", "Too many XRouter calls in flight");
+        error.emplace_back("code", xrouter::TOO_MANY_REQUESTS);
+        return uret_xr(error);
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("id", id);
+    return ret;
+}
+
 static UniValue xrShowConfigs(const JSONRPCRequest& request)
 {
     if (request.fHelp)
@@ -1306,50 +1368,103 @@ static UniValue xrGetNetworkServices(const JSONRPCRequest& request)
 
     const std::string & uuid = xrouter::generateUUID();
 
-    std::regex rwallet("^"+xrouter::xr+"::.*?$"); // match spv wallets
-    std::regex rservice("^"+xrouter::xrs+"::.*?$"); // match services
-    std::smatch m;
-
-    std::map<std::string, int> counts;
-    std::set<std::string> spvwallets;
-    std::set<std::string> services;
-    for (const auto & item : xbridge::App::allServices()) {
-        const auto & xwallet = item.second;
-        const auto & xservices = xwallet.services();
-        for (const auto & s : xservices) {
-            if (std::regex_match(s, m, rwallet)) {
-                spvwallets.insert(s);
-                counts[s] += 1;
-            } else if (std::regex_match(s, m, rservice)) {
-                services.insert(s);
-                counts[s] += 1;
+    // Services of the running snodes, rebuilt when the registry changes or a snode stops running
+    static sn::ServiceNodeListCache<Object> cache;
+    const Object data = cache.get([](int64_t & expires) {
+        std::regex rwallet("^"+xrouter::xr+"::.*?$"); // match spv wallets
+        std::regex rservice("^"+xrouter::xrs+"::.*?$"); // match services
+        std::smatch m;
+
+        std::map<std::string, int> counts;
+        std::set<std::string> spvwallets;
+        std::set<std::string> services;
+        const auto snodes = sn::ServiceNodeMgr::instance().snapshot();
+        for (const auto & item : *snodes) {
+            const auto & snode = *item.second;
+            if (!snode.running())
+                continue;
+            expires = std::min(expires, snode.runningUntil());
+            const std::set<std::string> xservices{snode.serviceList().begin(), snode.serviceList().end()};
+            for (const auto & s : xservices) {
+                if (std::regex_match(s, m, rwallet)) {
+                    spvwallets.insert(s);
+                    counts[s] += 1;
+                } else if (std::regex_match(s, m, rservice)) {
+                    services.insert(s);
+                    counts[s] += 1;
+                }
             }
         }
-    }
 
-    Array jspv{spvwallets.begin(), spvwallets.end()};
-    Array jxr{services.begin(), services.end()};
-    Object jnodes;
+        Array jspv{spvwallets.begin(), spvwallets.end()};
+        Array jxr{services.begin(), services.end()};
+        Object jnodes;
 
-    Object data;
-    data.emplace_back("spvwallets", jspv);
-    data.emplace_back("services", jxr);
-    for (const auto & item : counts) // show number of nodes with each service
-        jnodes.emplace_back(item.first, item.second);
-    data.emplace_back("nodecounts", jnodes);
+        Object data;
+        data.emplace_back("spvwallets", jspv);
+        data.emplace_back("services", jxr);
+        for (const auto & item : counts) // show number of nodes with each service
+            jnodes.emplace_back(item.first, item.second);
+        data.emplace_back("nodecounts", jnodes);
+        return data;
+    });
 
     return uret_xr(xrouter::form_reply(uuid, data));
 }
 
 static UniValue xrTest(const JSONRPCRequest& request)
 {
-    if (request.fHelp) {
-        throw std::runtime_error("xrTest\nAuxiliary call");
-    }
+    if (request.fHelp)
+        throw std::runtime_error(
+            RPCHelpMan{"xrTest",
+                "\nLoad test of the XRouter request path against a fake backend. Synthetic clients sign queries, "
+                "the server checks the signature and fee payment, runs the query (with the result cache) and signs "
+                "the reply, the clients check and decode the reply. The node's connectors and peers aren't used.\n",
+                {
+                    {"clients", RPCArg::Type::NUM, /* default */ "4", "Number of concurrent clients"},
+                    {"requests", RPCArg::Type::NUM, /* default */ "1000", "Requests sent by each client"},
+                    {"backend_ms", RPCArg::Type::NUM, /* default */ "0", "Simulated backend response time in milliseconds"},
+                },
+                RPCResult{
+                "{\n"
+                "  \"clients\": n,            (numeric) Number of clients\n"
+                "  \"requests\": n,           (numeric) Total number of requests\n"
+                "  \"backendms\": n,          (numeric) Simulated backend response time\n"
+                "  \"errors\": n,             (numeric) Failed requests\n"
+                "  \"seconds\": n,            (numeric) Duration of the test\n"
+                "  \"requestspersec\": n,     (numeric) Throughput\n"
+                "  \"latencyp50ms\": n,       (numeric) Median request latency\n"
+                "  \"latencyp99ms\": n,       (numeric) 99th percentile request latency\n"
+                "  \"latencymaxms\": n,       (numeric) Maximum request latency\n"
+                "  \"signaturecheckus\": n,   (numeric) Microseconds to check the signature of a query\n"
+                "  \"feecheckus\": n,         (numeric) Microseconds to decode and check a fee payment\n"
+                "  \"querybytes\": n          (numeric) Bytes of the query and reply packets of a query in flight\n"
+                "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("xrTest", "")
+                  + HelpExampleRpc("xrTest", "")
+                  + HelpExampleCli("xrTest", "16 500 20")
+                  + HelpExampleRpc("xrTest", "16, 500, 20")
+                },
+            }.ToString());
     Value js; json_spirit::read_string(request.params.write(), js); Array params = js.get_array();
-    
-    xrouter::App::instance().runTests();
-    return uret_xr(true);
+
+    int clients{4}, requests{1000}, backendMs{0};
+    if (params.size() >= 1)
+        clients = params[0].get_int();
+    if (params.size() >= 2)
+        requests = params[1].get_int();
+    if (params.size() >= 3)
+        backendMs = params[2].get_int();
+    if (clients < 1 || clients > 64 || requests < 1 || requests > 100000 || backendMs < 0 || backendMs > 10000) {
+        Object error;
+        error.emplace_back("error", "Clients must be 1-64, requests 1-100000 and backend_ms 0-10000");
+        error.emplace_back("code", xrouter::INVALID_PARAMETERS);
+        return uret_xr(error);
+    }
+
+    return uret_xr(xrouter::App::instance().runTests(clients, requests, backendMs));
 }
 
 // clang-format off
@@ -1365,6 +1480,7 @@ static const CRPCCommand commands[] =
     { "xrouter",      "xrGetTransactions",               &xrGetTransactions,              {} },
     { "xrouter",      "xrSendTransaction",               &xrSendTransaction,              {} },
 
+    { "xrouter",      "xrAsync",                         &xrAsync,                        {"method", "params"} },
     { "xrouter",      "xrConnect",                       &xrConnect,                      {} },
     { "xrouter",      "xrConnectedNodes",                &xrConnectedNodes,               {} },
     { "xrouter",      "xrGenerateBloomFilter",           &xrGenerateBloomFilter,          {} },
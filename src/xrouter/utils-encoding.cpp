@@ -0,0 +1,205 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <xrouter/xrouterutils.h>
+
+#include <serialize.h>
+#include <streams.h>
+#include <util/strencodings.h>
+#include <version.h>
+
+#include <univalue.h>
+
+#include <map>
+
+//*****************************************************************************
+//*****************************************************************************
+namespace xrouter
+{
+
+/**
+ * Binary reply encoding. Every value starts with a tag byte, lengths and counts are
+ * compact sizes. Lowercase hex strings (hashes, scripts, raw transactions) are sent as
+ * raw bytes, and object keys are sent once and then referred to by their index.
+ */
+enum ReplyTag : uint8_t {
+    REPLY_NULL   = 0,
+    REPLY_FALSE  = 1,
+    REPLY_TRUE   = 2,
+    REPLY_NUMBER = 3, // decimal string, exact as received from the backend
+    REPLY_STRING = 4,
+    REPLY_HEX    = 5,
+    REPLY_ARRAY  = 6,
+    REPLY_OBJECT = 7,
+};
+
+static const int MAX_REPLY_DEPTH = 64;
+static const size_t MIN_HEX_SIZE = 8; // shorter hex strings are sent as strings
+
+static bool isLowerHex(const std::string & s)
+{
+    if (s.size() < MIN_HEX_SIZE || s.size() % 2 != 0)
+        return false;
+    for (const char c : s) {
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f')))
+            return false;
+    }
+    return true;
+}
+
+static void writeString(CDataStream & ss, const std::string & s)
+{
+    WriteCompactSize(ss, s.size());
+    ss.write(s.data(), s.size());
+}
+
+static std::string readString(CDataStream & ss)
+{
+    const auto size = ReadCompactSize(ss);
+    std::string s(size, '\0');
+    ss.read(&s[0], size);
+    return s;
+}
+
+static bool encodeValue(CDataStream & ss, const UniValue & v, std::map<std::string, uint64_t> & keys, const int depth)
+{
+    if (depth > MAX_REPLY_DEPTH)
+        return false;
+
+    switch (v.getType()) {
+        case UniValue::VNULL:
+            ss << static_cast<uint8_t>(REPLY_NULL);
+            break;
+        case UniValue::VBOOL:
+            ss << static_cast<uint8_t>(v.isTrue() ? REPLY_TRUE : REPLY_FALSE);
+            break;
+        case UniValue::VNUM:
+            ss << static_cast<uint8_t>(REPLY_NUMBER);
+            writeString(ss, v.getValStr());
+            break;
+        case UniValue::VSTR:
+            if (isLowerHex(v.get_str())) {
+                const auto bytes = ParseHex(v.get_str());
+                ss << static_cast<uint8_t>(REPLY_HEX);
+                WriteCompactSize(ss, bytes.size());
+                ss.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+            } else {
+                ss << static_cast<uint8_t>(REPLY_STRING);
+                writeString(ss, v.get_str());
+            }
+            break;
+        case UniValue::VARR:
+            ss << static_cast<uint8_t>(REPLY_ARRAY);
+            WriteCompactSize(ss, v.size());
+            for (const auto & item : v.getValues()) {
+                if (!encodeValue(ss, item, keys, depth + 1))
+                    return false;
+            }
+            break;
+        case UniValue::VOBJ: {
+            ss << static_cast<uint8_t>(REPLY_OBJECT);
+            WriteCompactSize(ss, v.size());
+            const auto & k = v.getKeys();
+            const auto & values = v.getValues();
+            for (size_t i = 0; i < k.size(); ++i) {
+                // 0 is followed by a new key, otherwise the index of a previous key + 1
+                auto it = keys.find(k[i]);
+                if (it != keys.end())
+                    WriteCompactSize(ss, it->second + 1);
+                else {
+                    WriteCompactSize(ss, 0);
+                    writeString(ss, k[i]);
+                    keys.emplace(k[i], keys.size());
+                }
+                if (!encodeValue(ss, values[i], keys, depth + 1))
+                    return false;
+            }
+            break;
+        }
+    }
+    return true;
+}
+
+static UniValue decodeValue(CDataStream & ss, std::vector<std::string> & keys, const int depth)
+{
+    if (depth > MAX_REPLY_DEPTH)
+        throw std::ios_base::failure("reply nested too deep");
+
+    uint8_t tag;
+    ss >> tag;
+    switch (tag) {
+        case REPLY_NULL:
+            return UniValue(UniValue::VNULL);
+        case REPLY_FALSE:
+            return UniValue(false);
+        case REPLY_TRUE:
+            return UniValue(true);
+        case REPLY_NUMBER: {
+            UniValue v;
+            if (!v.setNumStr(readString(ss)))
+                throw std::ios_base::failure("bad number in reply");
+            return v;
+        }
+        case REPLY_STRING:
+            return UniValue(readString(ss));
+        case REPLY_HEX: {
+            const auto size = ReadCompactSize(ss);
+            std::vector<unsigned char> bytes(size);
+            ss.read(reinterpret_cast<char*>(bytes.data()), size);
+            return UniValue(HexStr(bytes));
+        }
+        case REPLY_ARRAY: {
+            UniValue v(UniValue::VARR);
+            const auto count = ReadCompactSize(ss);
+            for (uint64_t i = 0; i < count; ++i)
+                v.push_back(decodeValue(ss, keys, depth + 1));
+            return v;
+        }
+        case REPLY_OBJECT: {
+            UniValue v(UniValue::VOBJ);
+            const auto count = ReadCompactSize(ss);
+            for (uint64_t i = 0; i < count; ++i) {
+                const auto ref = ReadCompactSize(ss);
+                if (ref == 0)
+                    keys.push_back(readString(ss));
+                else if (ref > keys.size())
+                    throw std::ios_base::failure("bad key in reply");
+                const std::string key = ref == 0 ? keys.back() : keys[ref - 1];
+                v.__pushKV(key, decodeValue(ss, keys, depth + 1));
+            }
+            return v;
+        }
+        default:
+            throw std::ios_base::failure("unknown value in reply");
+    }
+}
+
+bool EncodeBinaryReply(const std::string & reply, std::vector<unsigned char> & encoded)
+{
+    UniValue v;
+    if (!v.read(reply))
+        return false; // not json, sent as is
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    std::map<std::string, uint64_t> keys;
+    if (!encodeValue(ss, v, keys, 0))
+        return false;
+    encoded.assign(ss.begin(), ss.end());
+    return true;
+}
+
+bool DecodeBinaryReply(const unsigned char *data, const size_t size, UniValue & reply)
+{
+    try {
+        CDataStream ss(reinterpret_cast<const char*>(data), reinterpret_cast<const char*>(data) + size,
+                       SER_NETWORK, PROTOCOL_VERSION);
+        std::vector<std::string> keys;
+        reply = decodeValue(ss, keys, 0);
+        return ss.empty();
+    } catch (const std::exception &) {
+        return false;
+    }
+}
+
+} // namespace xrouter
@@ -9,11 +9,13 @@
 #include <event2/buffer.h>
 #include <rpc/protocol.h>
 #include <support/events.h>
+#include <support/httppool.h>
 #include <tinyformat.h>
 #include <util/strencodings.h>
 #include <util/system.h>
 #include <univalue.h>
 
+#include <algorithm>
 #include <array>
 #include <stdio.h>
 
@@ -27,13 +29,14 @@ namespace xrouter
 /** Reply structure for request_done to fill in */
 struct HTTPReply
 {
-    HTTPReply(): status(0), error(-1) {}
+    HTTPReply(): status(0), error(-1), base(nullptr) {}
 
     int status;
     int error;
     CPubKey hdrpubkey;
     std::vector<unsigned char> hdrsignature;
     std::string body;
+    struct event_base *base; // loop to exit once the request is done
 };
 
 static const char *http_errorstring(int code)
@@ -61,6 +64,9 @@ static const char *http_errorstring(int code)
 static void http_request_done(struct evhttp_request *req, void *ctx)
 {
     HTTPReply *reply = static_cast<HTTPReply*>(ctx);
+    // Keep-alive connections keep the loop busy, exit as soon as the request is done
+    if (reply->base)
+        event_base_loopbreak(reply->base);
 
     if (req == nullptr) {
         /* If req is nullptr, it means an error occurred while connecting: the
@@ -103,6 +109,80 @@ static void http_error_cb(enum evhttp_request_error err, void *ctx)
 }
 #endif
 
+/**
+ * Connections to the backend wallets, plugin endpoints and service nodes, shared by
+ * all XRouter calls.
+ */
+static HTTPConnectionPool & connectionPool()
+{
+    static HTTPConnectionPool pool(XROUTER_HTTP_POOL_SIZE, XROUTER_HTTP_POOL_IDLE,
+                                   static_cast<int>(gArgs.GetArg("-rpcxroutertimeout", 60)));
+    return pool;
+}
+
+void ClearHTTPConnections()
+{
+    connectionPool().clear();
+}
+
+/**
+ * Posts the request on a pooled keep-alive connection. The headers are added after
+ * the Host, Connection and (if authorize is set) Authorization headers. Only idempotent
+ * requests are sent again when they fail on a reused connection, the server may have
+ * processed a request that failed after it was sent.
+ */
+static HTTPReply PostHTTP(const std::string & host, const int port, const std::string & url,
+                          const bool authorize, const std::string & rpcuser, const std::string & rpcpasswd,
+                          const std::vector<std::pair<std::string, std::string>> & headers,
+                          const std::string & strRequest, const int timeout, const bool idempotent)
+{
+    auto & pool = connectionPool();
+    HTTPReply response;
+    bool reused{false};
+    do {
+        std::string auth;
+        HTTPConnectionPool::ConnectionPtr conn = pool.acquire(host, port, rpcuser, rpcpasswd, reused, auth, timeout);
+
+        response = HTTPReply();
+        response.base = conn->base.get();
+        raii_evhttp_request req = obtain_evhttp_request(http_request_done, (void*)&response);
+        if (req == nullptr)
+            throw std::runtime_error("create http request failed");
+#if LIBEVENT_VERSION_NUMBER >= 0x02010300
+        evhttp_request_set_error_cb(req.get(), http_error_cb);
+#endif
+
+        struct evkeyvalq* output_headers = evhttp_request_get_output_headers(req.get());
+        if (!output_headers)
+            throw std::runtime_error(strprintf("Internal error in connection to server %s:%d failed to set headers\n", host, port));
+        evhttp_add_header(output_headers, "Host", host.c_str());
+        evhttp_add_header(output_headers, "Connection", "keep-alive");
+        if (authorize)
+            evhttp_add_header(output_headers, "Authorization", auth.c_str());
+        for (const auto & header : headers)
+            evhttp_add_header(output_headers, header.first.c_str(), header.second.c_str());
+
+        struct evbuffer* output_buffer = evhttp_request_get_output_buffer(req.get());
+        if (!output_buffer)
+            throw std::runtime_error(strprintf("Internal error in connection to server %s:%d failed to set headers\n", host, port));
+        evbuffer_add(output_buffer, strRequest.data(), strRequest.size());
+
+        int r = evhttp_make_request(conn->evcon.get(), req.get(), EVHTTP_REQ_POST, url.c_str());
+        req.release(); // ownership moved to evcon in above call
+        if (r != 0)
+            throw std::runtime_error("send http request failed");
+
+        event_base_dispatch(conn->base.get());
+
+        // Only healthy connections go back to the pool. A failed idempotent request on a
+        // reused connection is retried once on a new connection in case the server closed it.
+        if (response.status != 0)
+            pool.release(host, port, rpcuser, rpcpasswd, std::move(conn));
+    } while (response.status == 0 && reused && idempotent);
+
+    return response;
+}
+
 UniValue XRouterJSONRPCRequestObj(const std::string& strMethod, const UniValue& params,
         const UniValue& id, const std::string& jsonver="")
 {
@@ -115,6 +195,26 @@ UniValue XRouterJSONRPCRequestObj(const std::string& strMethod, const UniValue&
     return request;
 }
 
+/**
+ * Throws if the rpc call failed in transport, the body of json-rpc errors is left to
+ * the caller.
+ */
+static void checkRPCResponse(const std::string & host, const int port, const HTTPReply & response)
+{
+    if (response.status == 0) {
+        std::string responseErrorMessage;
+        if (response.error != -1) {
+            responseErrorMessage = strprintf(" (error code %d - \"%s\")", response.error, http_errorstring(response.error));
+        }
+        throw std::runtime_error(strprintf("Could not connect to the server %s:%d%s\n\nMake sure the blocknetd server is running and that you are connecting to the correct RPC port.", host, port, responseErrorMessage));
+    } else if (response.status == HTTP_UNAUTHORIZED) {
+        throw std::runtime_error("Authorization failed: Incorrect rpcuser or rpcpassword");
+    } else if (response.status >= 400 && response.status != HTTP_BAD_REQUEST && response.status != HTTP_NOT_FOUND && response.status != HTTP_INTERNAL_SERVER_ERROR)
+        throw std::runtime_error(strprintf("server returned HTTP error %d", response.status));
+    else if (response.body.empty())
+        throw std::runtime_error("no response from server");
+}
+
 std::string CallRPC(const std::string & rpcip, const std::string & rpcport, const std::string & strMethod,
                     const Array & params, const std::string & jsonver)
 {
@@ -129,111 +229,90 @@ std::string CallRPC(const std::string & rpcuser, const std::string & rpcpasswd,
     const std::string & host = rpcip;
     const int port = stoi(rpcport);
 
-    // Obtain event base
-    raii_event_base base = obtain_event_base();
-
-    // Synchronously look up hostname
-    raii_evhttp_connection evcon = obtain_evhttp_connection_base(base.get(), host, port);
-    evhttp_connection_set_timeout(evcon.get(), gArgs.GetArg("-rpcxroutertimeout", 60));
-
-    HTTPReply response;
-    raii_evhttp_request req = obtain_evhttp_request(http_request_done, (void*)&response);
-    if (req == nullptr)
-        throw std::runtime_error("create http request failed");
-#if LIBEVENT_VERSION_NUMBER >= 0x02010300
-    evhttp_request_set_error_cb(req.get(), http_error_cb);
-#endif
-
-    // Get credentials
-    std::string strRPCUserColonPass = rpcuser + ":" + rpcpasswd;
-
-    struct evkeyvalq* output_headers = evhttp_request_get_output_headers(req.get());
-    assert(output_headers);
-    evhttp_add_header(output_headers, "Host", host.c_str());
-    evhttp_add_header(output_headers, "Connection", "close");
-    evhttp_add_header(output_headers, "Authorization", (std::string("Basic ") + EncodeBase64(strRPCUserColonPass)).c_str());
-
     // Attach request data
     const auto tostring = json_spirit::write_string(json_spirit::Value(params), json_spirit::none, 8);
     UniValue toval;
     if (!toval.read(tostring))
         throw std::runtime_error(strprintf("failed to decode json_spirit data: %s", tostring));
     const auto reqobj = XRouterJSONRPCRequestObj(strMethod, toval.get_array(), 1, jsonver);
-    std::string strRequest = reqobj.write() + "\n";
-    struct evbuffer* output_buffer = evhttp_request_get_output_buffer(req.get());
-    assert(output_buffer);
-    evbuffer_add(output_buffer, strRequest.data(), strRequest.size());
-
-    int r = evhttp_make_request(evcon.get(), req.get(), EVHTTP_REQ_POST, "/");
-    req.release(); // ownership moved to evcon in above call
-    if (r != 0) {
-        throw std::runtime_error("send http request failed");
-    }
+    const std::string strRequest = reqobj.write() + "\n";
 
-    event_base_dispatch(base.get());
-
-    if (response.status == 0) {
-        std::string responseErrorMessage;
-        if (response.error != -1) {
-            responseErrorMessage = strprintf(" (error code %d - \"%s\")", response.error, http_errorstring(response.error));
-        }
-        throw std::runtime_error(strprintf("Could not connect to the server %s:%d%s\n\nMake sure the blocknetd server is running and that you are connecting to the correct RPC port.", host, port, responseErrorMessage));
-    } else if (response.status == HTTP_UNAUTHORIZED) {
-        throw std::runtime_error("Authorization failed: Incorrect rpcuser or rpcpassword");
-    } else if (response.status >= 400 && response.status != HTTP_BAD_REQUEST && response.status != HTTP_NOT_FOUND && response.status != HTTP_INTERNAL_SERVER_ERROR)
-        throw std::runtime_error(strprintf("server returned HTTP error %d", response.status));
-    else if (response.body.empty())
-        throw std::runtime_error("no response from server");
+    // The method may be any backend or plugin command, it's not sent twice
+    const HTTPReply response = PostHTTP(host, port, "/", true, rpcuser, rpcpasswd, {}, strRequest, 0, false);
 
+    checkRPCResponse(host, port, response);
     return response.body;
 }
 
-XRouterReply CallXRouterUrl(const std::string & host, const int & port, const std::string & url, const std::string & data,
-                    const int & timeout, const CKey & signingkey, const CPubKey & serverkey, const std::string & paymentrawtx)
+std::vector<std::string> CallRPCBatch(const std::string & rpcuser, const std::string & rpcpasswd,
+                                      const std::string & rpcip, const std::string & rpcport,
+                                      const std::string & strMethod, const std::vector<Array> & params,
+                                      const std::string & jsonver)
 {
-    // Obtain event base
-    raii_event_base base = obtain_event_base();
+    const std::string & host = rpcip;
+    const int port = stoi(rpcport);
 
-    // Synchronously look up hostname
-    raii_evhttp_connection evcon = obtain_evhttp_connection_base(base.get(), host, port);
-    evhttp_connection_set_timeout(evcon.get(), timeout > 0 ? timeout
-                                                           : static_cast<int>(gArgs.GetArg("-rpcxroutertimeout", 60)));
+    std::vector<std::string> results(params.size());
+    for (size_t begin = 0; begin < params.size(); begin += XROUTER_RPC_BATCH_SIZE) {
+        const size_t end = std::min(params.size(), begin + XROUTER_RPC_BATCH_SIZE);
+
+        // The request ids are the positions in the batch
+        UniValue batch(UniValue::VARR);
+        for (size_t i = begin; i < end; ++i) {
+            const auto tostring = json_spirit::write_string(json_spirit::Value(params[i]), json_spirit::none, 8);
+            UniValue toval;
+            if (!toval.read(tostring))
+                throw std::runtime_error(strprintf("failed to decode json_spirit data: %s", tostring));
+            batch.push_back(XRouterJSONRPCRequestObj(strMethod, toval.get_array(), static_cast<uint64_t>(i - begin), jsonver));
+        }
+        const std::string strRequest = batch.write() + "\n";
+
+        // Batches are only used for block and transaction lookups, which can be sent again
+        const HTTPReply response = PostHTTP(host, port, "/", true, rpcuser, rpcpasswd, {}, strRequest, 0, true);
+        checkRPCResponse(host, port, response);
+
+        UniValue replies;
+        if (!replies.read(response.body) || !replies.isArray()) {
+            // Backend doesn't support batches, fall back to one call per request
+            for (size_t i = begin; i < end; ++i)
+                results[i] = CallRPC(rpcuser, rpcpasswd, rpcip, rpcport, strMethod, params[i], jsonver);
+            continue;
+        }
 
-    HTTPReply response;
-    raii_evhttp_request req = obtain_evhttp_request(http_request_done, (void*)&response);
-    if (req == nullptr)
-        throw std::runtime_error("create http request failed");
-#if LIBEVENT_VERSION_NUMBER >= 0x02010300
-    evhttp_request_set_error_cb(req.get(), http_error_cb);
-#endif
+        for (size_t i = 0; i < replies.size(); ++i) {
+            const UniValue & id = find_value(replies[i], "id");
+            if (!id.isNum() || id.get_int64() < 0 || static_cast<size_t>(id.get_int64()) >= end - begin)
+                continue;
+            results[begin + id.get_int64()] = replies[i].write();
+        }
+        for (size_t i = begin; i < end; ++i) {
+            if (results[i].empty())
+                throw std::runtime_error(strprintf("server %s:%d did not reply to all batched %s requests", host, port, strMethod));
+        }
+    }
 
-    struct evkeyvalq* output_headers = evhttp_request_get_output_headers(req.get());
-    assert(output_headers);
-    evhttp_add_header(output_headers, "Host", host.c_str());
-    evhttp_add_header(output_headers, "Connection", "close");
-    evhttp_add_header(output_headers, "XR-Pubkey", HexStr(signingkey.GetPubKey()).c_str());
+    return results;
+}
 
+XRouterReply CallXRouterUrl(const std::string & host, const int & port, const std::string & url, const std::string & data,
+                    const int & timeout, const CKey & signingkey, const CPubKey & serverkey, const std::string & paymentrawtx)
+{
     CHashWriter hw(SER_GETHASH, 0);
     hw << data;
     std::vector<unsigned char> signature;
     if (!signingkey.SignCompact(hw.GetHash(), signature))
         throw std::runtime_error("failed to produce signature on payload");
-    evhttp_add_header(output_headers, "XR-Signature", HexStr(signature).c_str());
-    evhttp_add_header(output_headers, "XR-Payment", paymentrawtx.c_str());
+
+    const std::vector<std::pair<std::string, std::string>> headers{
+        {"XR-Pubkey", HexStr(signingkey.GetPubKey())},
+        {"XR-Signature", HexStr(signature)},
+        {"XR-Payment", paymentrawtx},
+    };
 
     // Attach request data
-    std::string strRequest = data + "\n";
-    struct evbuffer *output_buffer = evhttp_request_get_output_buffer(req.get());
-    if (!output_buffer)
-        throw std::runtime_error(strprintf("Internal error in connection to server %s:%d failed to set headers\n", host, port));
-    evbuffer_add(output_buffer, strRequest.data(), strRequest.size());
-
-    int r = evhttp_make_request(evcon.get(), req.get(), EVHTTP_REQ_POST, url.c_str());
-    req.release(); // ownership moved to evcon in above call
-    if (r != 0)
-        throw std::runtime_error("send http request failed");
-
-    event_base_dispatch(base.get());
+    const std::string strRequest = data + "\n";
+    // Requests carry payments, a request that may have reached the server isn't sent again
+    const HTTPReply response = PostHTTP(host, port, url, false, "", "", headers, strRequest, timeout, false);
 
     if (response.status == 0) {
         std::string responseErrorMessage;
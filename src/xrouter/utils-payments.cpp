@@ -10,13 +10,25 @@
 #include <xrouter/xrouterlogger.h>
 
 #include <base58.h>
+#include <clientversion.h>
+#include <coins.h>
 #include <core_io.h>
 #include <key.h>
+#include <net.h>
 #include <node/transaction.h>
+#include <policy/policy.h>
 #include <rpc/client.h>
+#include <script/interpreter.h>
+#include <script/standard.h>
+#include <streams.h>
+#include <txmempool.h>
+#include <util/system.h>
 #include <validation.h>
+#include <validationinterface.h>
 #include <wallet/wallet.h>
 
+#include <future>
+
 #include <boost/lexical_cast.hpp>
 
 using namespace json_spirit;
@@ -195,19 +207,54 @@ bool sendTransactionBlockchain(const std::string & rawtx, std::string & txid)
     return err == TransactionError::OK;
 }
 
-double checkPayment(const std::string & rawtx, const std::string & address, const CAmount & expectedFee)
+std::vector<bool> sendTransactionsBlockchain(const std::vector<CTransactionRef> & txs)
 {
-    CMutableTransaction tx;
-    if (!DecodeHexTx(tx, rawtx) || tx.vin.empty() || tx.vout.empty())
-        throw std::runtime_error("Bad fee payment");
-
-    for (const auto & input : tx.vin) {
-        CTransactionRef t;
-        uint256 hashBlock;
-        if (!GetTransaction(input.prevout.hash, t, Params().GetConsensus(), hashBlock))
-            throw std::runtime_error("Bad fee payment, failed to find fee inputs");
+    // Same as BroadcastTransaction, but the txs share the cs_main lock, the wait
+    // for the wallets and the relay to peers
+    std::vector<bool> accepted(txs.size(), false);
+    std::vector<uint256> relay;
+    bool added{false};
+    std::promise<void> promise;
+    {
+        LOCK(cs_main);
+        for (size_t i = 0; i < txs.size(); ++i) {
+            const auto & tx = txs[i];
+            const auto & hash = tx->GetHash();
+            bool haveChain = false;
+            for (size_t o = 0; !haveChain && o < tx->vout.size(); ++o)
+                haveChain = !pcoinsTip->AccessCoin(COutPoint(hash, o)).IsSpent();
+            if (haveChain)
+                continue; // already in block chain
+            if (!mempool.exists(hash)) {
+                CValidationState state;
+                bool missingInputs;
+                if (!AcceptToMemoryPool(mempool, state, tx, &missingInputs,
+                                        nullptr /* plTxnReplaced */, false /* bypass_limits */, 0)) {
+                    ERR() << "Failed to send tx " << hash.ToString() << " " << FormatStateMessage(state);
+                    continue;
+                }
+                added = true;
+            }
+            accepted[i] = true;
+            relay.push_back(hash);
+        }
+        if (added)
+            CallFunctionInValidationInterfaceQueue([&promise] { promise.set_value(); });
     }
+    if (added)
+        promise.get_future().wait();
+
+    if (!g_connman)
+        return std::vector<bool>(txs.size(), false);
+    g_connman->ForEachNode([&relay](CNode* pnode) {
+        for (const auto & hash : relay)
+            pnode->PushInventory(CInv(MSG_TX, hash));
+    });
+    return accepted;
+}
 
+CAmount paymentAmount(const CMutableTransaction & tx, const std::string & address)
+{
     CAmount payment{0};
     for (const auto & output : tx.vout) {
         std::vector<CTxDestination> addresses;
@@ -221,7 +268,33 @@ double checkPayment(const std::string & rawtx, const std::string & address, cons
             }
         }
     }
+    return payment;
+}
 
+double checkPayment(const std::string & rawtx, const std::string & address, const CAmount & expectedFee)
+{
+    CMutableTransaction tx;
+    if (!DecodeHexTx(tx, rawtx))
+        throw std::runtime_error("Bad fee payment");
+    return checkPayment(tx, address, expectedFee);
+}
+
+CAmount checkPayment(const CMutableTransaction & tx, const std::string & address, const CAmount & expectedFee,
+                     const std::function<bool(const uint256 &)> & knownTx)
+{
+    if (tx.vin.empty() || tx.vout.empty())
+        throw std::runtime_error("Bad fee payment");
+
+    for (const auto & input : tx.vin) {
+        if (knownTx && knownTx(input.prevout.hash))
+            continue; // e.g. change of a payment that was accepted before
+        CTransactionRef t;
+        uint256 hashBlock;
+        if (!GetTransaction(input.prevout.hash, t, Params().GetConsensus(), hashBlock))
+            throw std::runtime_error("Bad fee payment, failed to find fee inputs");
+    }
+
+    const CAmount payment = paymentAmount(tx, address);
     if (payment == 0)
         throw std::runtime_error("Bad fee payment, payment address is missing");
 
@@ -264,5 +337,349 @@ double checkPayment(const std::string & rawtx, const std::string & address, cons
 //
 //    return 0.0;
 }
+
+CScript paymentChannelScript(const CPubKey & clientKey, const CPubKey & snodeKey, const uint32_t & lockTime)
+{
+    return CScript() << OP_IF << ToByteVector(snodeKey) << OP_CHECKSIGVERIFY
+                     << OP_ELSE << static_cast<int64_t>(lockTime) << OP_CHECKLOCKTIMEVERIFY << OP_DROP
+                     << OP_ENDIF << ToByteVector(clientKey) << OP_CHECKSIG;
+}
+
+bool decodePaymentChannelScript(const CScript & script, CPubKey & clientKey, CPubKey & snodeKey, uint32_t & lockTime)
+{
+    CScript::const_iterator pc = script.begin();
+    opcodetype op;
+    std::vector<unsigned char> data;
+    if (!script.GetOp(pc, op) || op != OP_IF)
+        return false;
+    if (!script.GetOp(pc, op, data) || op > OP_PUSHDATA4)
+        return false;
+    snodeKey.Set(data.begin(), data.end());
+    if (!script.GetOp(pc, op) || op != OP_CHECKSIGVERIFY || !script.GetOp(pc, op) || op != OP_ELSE)
+        return false;
+    if (!script.GetOp(pc, op, data) || op > OP_PUSHDATA4 || data.empty() || data.size() > 4)
+        return false;
+    const int64_t n = CScriptNum(data, false).getint();
+    if (n <= 0 || n >= LOCKTIME_THRESHOLD) // block heights only
+        return false;
+    lockTime = static_cast<uint32_t>(n);
+    for (const auto expected : {OP_CHECKLOCKTIMEVERIFY, OP_DROP, OP_ENDIF}) {
+        if (!script.GetOp(pc, op) || op != expected)
+            return false;
+    }
+    if (!script.GetOp(pc, op, data) || op > OP_PUSHDATA4)
+        return false;
+    clientKey.Set(data.begin(), data.end());
+    if (!clientKey.IsFullyValid() || !snodeKey.IsFullyValid())
+        return false;
+    // Only the canonical encoding, the funding output pays to its hash
+    return script == paymentChannelScript(clientKey, snodeKey, lockTime);
+}
+
+/**
+ * Signs the input of a spend of the channel funding.
+ */
+static bool signChannelSpend(const CMutableTransaction & tx, const CKey & key, const CScript & redeemScript,
+                             std::vector<unsigned char> & sig)
+{
+    const uint256 hash = SignatureHash(redeemScript, tx, 0, SIGHASH_ALL, 0, SigVersion::BASE);
+    if (!key.Sign(hash, sig))
+        return false;
+    sig.push_back(static_cast<unsigned char>(SIGHASH_ALL));
+    return true;
+}
+
+/**
+ * Splits the input script of an update, <client sig> OP_0 OP_TRUE <redeem script>, the
+ * service node replaces OP_0 with its signature.
+ */
+static bool parseChannelUpdate(const CMutableTransaction & tx, std::vector<unsigned char> & clientSig, CScript & redeemScript)
+{
+    if (tx.vin.size() != 1 || tx.vout.empty() || tx.vout.size() > 2)
+        return false;
+    const CScript & scriptSig = tx.vin[0].scriptSig;
+    CScript::const_iterator pc = scriptSig.begin();
+    opcodetype op;
+    std::vector<unsigned char> data;
+    if (!scriptSig.GetOp(pc, op, clientSig) || op > OP_PUSHDATA4 || clientSig.empty())
+        return false;
+    if (!scriptSig.GetOp(pc, op) || op != OP_0 || !scriptSig.GetOp(pc, op) || op != OP_TRUE)
+        return false;
+    if (!scriptSig.GetOp(pc, op, data) || op > OP_PUSHDATA4 || pc != scriptSig.end())
+        return false;
+    redeemScript = CScript(data.begin(), data.end());
+    return true;
+}
+
+bool decodePaymentChannelUpdate(const CMutableTransaction & tx, CScript & redeemScript)
+{
+    std::vector<unsigned char> clientSig;
+    if (!parseChannelUpdate(tx, clientSig, redeemScript))
+        return false;
+    CPubKey clientKey, snodeKey;
+    uint32_t lockTime;
+    if (!decodePaymentChannelScript(redeemScript, clientKey, snodeKey, lockTime))
+        return false;
+    if (clientSig.back() != SIGHASH_ALL)
+        return false;
+    const uint256 hash = SignatureHash(redeemScript, tx, 0, SIGHASH_ALL, 0, SigVersion::BASE);
+    return clientKey.Verify(hash, std::vector<unsigned char>(clientSig.begin(), clientSig.end() - 1));
+}
+
+bool signPaymentChannelUpdate(CMutableTransaction & tx, const CKey & snodeKey)
+{
+    std::vector<unsigned char> clientSig;
+    CScript redeemScript;
+    if (!parseChannelUpdate(tx, clientSig, redeemScript))
+        return false;
+    std::vector<unsigned char> sig;
+    if (!signChannelSpend(tx, snodeKey, redeemScript, sig))
+        return false;
+    tx.vin[0].scriptSig = CScript() << clientSig << sig << OP_TRUE << ToByteVector(redeemScript);
+    return true;
+}
+
+void checkPaymentChannelUpdate(const CMutableTransaction & tx, const CTxOut & funding, const CKey & snodeKey)
+{
+    std::vector<unsigned char> clientSig;
+    CScript redeemScript;
+    if (!parseChannelUpdate(tx, clientSig, redeemScript))
+        throw std::runtime_error("Bad fee payment, payment channel update is invalid");
+
+    // The settlement can't spend more than the funding less the network fee
+    CAmount total{0};
+    for (const auto & out : tx.vout) {
+        if (!MoneyRange(out.nValue) || !MoneyRange(total + out.nValue))
+            throw std::runtime_error("Bad fee payment, payment channel update is invalid");
+        total += out.nValue;
+    }
+    if (total > funding.nValue - XROUTER_CHANNEL_TXFEE)
+        throw std::runtime_error("Bad fee payment, payment channel update spends more than the funding");
+
+    // The settlement is sent at any time before the lock time
+    if (tx.nLockTime != 0 || tx.vin[0].nSequence != CTxIn::SEQUENCE_FINAL)
+        throw std::runtime_error("Bad fee payment, payment channel update isn't final");
+
+    // Check the settlement the service node would send, the client signature has to be standard
+    CMutableTransaction settlement(tx);
+    if (!signPaymentChannelUpdate(settlement, snodeKey))
+        throw std::runtime_error("Bad fee payment, failed to sign payment channel update");
+    const CTransaction settlementTx(settlement);
+    ScriptError serror;
+    if (!VerifyScript(settlementTx.vin[0].scriptSig, funding.scriptPubKey, nullptr, STANDARD_SCRIPT_VERIFY_FLAGS,
+                      TransactionSignatureChecker(&settlementTx, 0, funding.nValue), &serror))
+        throw std::runtime_error(std::string("Bad fee payment, payment channel update doesn't verify: ") + ScriptErrorString(serror));
+}
+
+namespace {
+
+/**
+ * Payment channel of the client to a service node.
+ */
+struct PaymentChannel {
+    CKey key;
+    CPubKey snodeKey;
+    CScript payScript;    // payment address of the service node
+    CScript redeemScript;
+    CScript refundScript; // change address of the funding tx
+    COutPoint funding;
+    CAmount capacity{0};
+    uint32_t lockTime{0};
+    CAmount paid{0};      // fees signed over to the service node
+};
+
+Mutex cs_paymentChannels;
+std::map<NodeAddr, PaymentChannel> paymentChannels GUARDED_BY(cs_paymentChannels);
+std::vector<CTransactionRef> channelRefunds GUARDED_BY(cs_paymentChannels); // signed when the channel is opened
+bool channelRefundsLoaded GUARDED_BY(cs_paymentChannels){false};
+
+fs::path channelRefundsPath()
+{
+    return GetDataDir() / "xrouterrefunds.dat";
+}
+
+void loadChannelRefunds() EXCLUSIVE_LOCKS_REQUIRED(cs_paymentChannels)
+{
+    if (channelRefundsLoaded)
+        return;
+    channelRefundsLoaded = true;
+    CAutoFile file(fsbridge::fopen(channelRefundsPath(), "rb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull())
+        return;
+    try {
+        file >> channelRefunds;
+    } catch (const std::exception & e) {
+        ERR() << "Failed to read payment channel refunds: " << e.what();
+    }
+}
+
+bool writeChannelRefunds() EXCLUSIVE_LOCKS_REQUIRED(cs_paymentChannels)
+{
+    const fs::path tmp = channelRefundsPath().string() + ".new";
+    CAutoFile file(fsbridge::fopen(tmp, "wb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull())
+        return error("%s: Failed to open %s", __func__, tmp.string());
+    try {
+        file << channelRefunds;
+    } catch (const std::exception & e) {
+        return error("%s: Failed to write payment channel refunds: %s", __func__, e.what());
+    }
+    if (!FileCommit(file.Get()))
+        return error("%s: Failed to commit %s", __func__, tmp.string());
+    file.fclose();
+    return RenameOver(tmp, channelRefundsPath());
+}
+
+/**
+ * Returns true if the funding of the channel is unspent, counting the mempool.
+ */
+bool isChannelOpen(const COutPoint & funding)
+{
+    LOCK2(cs_main, mempool.cs);
+    CCoinsViewMemPool view(pcoinsTip.get(), mempool);
+    Coin coin;
+    return view.GetCoin(funding, coin) && !mempool.isSpent(funding);
+}
+
+bool openPaymentChannel(const CPubKey & snodeKey, const CScript & payScript, const CAmount & capacity,
+                        const int & height, PaymentChannel & ch) EXCLUSIVE_LOCKS_REQUIRED(cs_paymentChannels)
+{
+    ch.key.MakeNewKey(true);
+    ch.snodeKey = snodeKey;
+    ch.payScript = payScript;
+    ch.lockTime = static_cast<uint32_t>(height + XROUTER_CHANNEL_LOCKTIME);
+    ch.redeemScript = paymentChannelScript(ch.key.GetPubKey(), snodeKey, ch.lockTime);
+
+    std::string fundingTx;
+    if (!createAndSignTransaction(EncodeDestination(CScriptID(ch.redeemScript)), capacity, fundingTx))
+        return false;
+    CMutableTransaction mtx;
+    if (!DecodeHexTx(mtx, fundingTx) || mtx.vout.size() < 2) {
+        unlockOutputs(fundingTx);
+        return false;
+    }
+    ch.refundScript = mtx.vout[1].scriptPubKey;
+    ch.funding = COutPoint(mtx.GetHash(), 0);
+    ch.capacity = capacity;
+
+    // The refund is stored before the funding is sent so that the funding can't be lost
+    CMutableTransaction refund;
+    refund.nLockTime = ch.lockTime;
+    refund.vin.emplace_back(ch.funding, CScript(), CTxIn::SEQUENCE_FINAL - 1);
+    refund.vout.emplace_back(capacity - XROUTER_CHANNEL_TXFEE, ch.refundScript);
+    std::vector<unsigned char> sig;
+    if (!signChannelSpend(refund, ch.key, ch.redeemScript, sig)) {
+        unlockOutputs(fundingTx);
+        return false;
+    }
+    refund.vin[0].scriptSig = CScript() << sig << OP_FALSE << ToByteVector(ch.redeemScript);
+    channelRefunds.push_back(MakeTransactionRef(std::move(refund)));
+    if (!writeChannelRefunds()) {
+        channelRefunds.pop_back();
+        unlockOutputs(fundingTx);
+        return false;
+    }
+
+    std::string txid;
+    const bool sent = sendTransactionBlockchain(fundingTx, txid);
+    unlockOutputs(fundingTx); // spent by the funding tx
+    if (!sent) {
+        ERR() << "Failed to send payment channel funding " << txid;
+        channelRefunds.pop_back();
+        writeChannelRefunds();
+        return false;
+    }
+    LOG() << "Opened payment channel " << txid << " to service node " << HexStr(snodeKey);
+    return true;
+}
+
+} // namespace
+
+bool createChannelPayment(const NodeAddr & node, const CPubKey & snodeKey, const std::string & address,
+                          const CAmount & fee, const CAmount & funding, std::string & raw_tx)
+{
+    const CTxDestination dest = DecodeDestination(address);
+    if (!IsValidDestination(dest) || !snodeKey.IsFullyValid())
+        return false;
+    const CScript payScript = GetScriptForDestination(dest);
+    int height{0};
+    {
+        LOCK(cs_main);
+        height = chainActive.Height();
+    }
+
+    LOCK(cs_paymentChannels);
+    loadChannelRefunds();
+    auto it = paymentChannels.find(node);
+    if (it != paymentChannels.end()) {
+        // Channels near their lock time are settled by the service node or refunded
+        const auto & ch = it->second;
+        if (ch.snodeKey != snodeKey || ch.payScript != payScript
+                || ch.lockTime <= static_cast<uint32_t>(height + 2 * XROUTER_CHANNEL_SETTLE_BLOCKS)
+                || ch.capacity - XROUTER_CHANNEL_TXFEE - ch.paid < fee || !isChannelOpen(ch.funding))
+            paymentChannels.erase(it);
+    }
+    if (!paymentChannels.count(node)) {
+        PaymentChannel ch;
+        if (!openPaymentChannel(snodeKey, payScript, std::max(funding, fee + XROUTER_CHANNEL_TXFEE), height, ch))
+            return false;
+        paymentChannels[node] = ch;
+    }
+
+    // Each update pays the fees so far, the service node settles the last one
+    auto & ch = paymentChannels[node];
+    const CAmount paid = ch.paid + fee;
+    CMutableTransaction mtx;
+    mtx.vin.emplace_back(ch.funding);
+    mtx.vout.emplace_back(paid, ch.payScript);
+    const CTxOut change(ch.capacity - XROUTER_CHANNEL_TXFEE - paid, ch.refundScript);
+    if (!IsDust(change, dustRelayFee))
+        mtx.vout.push_back(change);
+    std::vector<unsigned char> sig;
+    if (!signChannelSpend(mtx, ch.key, ch.redeemScript, sig))
+        return false;
+    mtx.vin[0].scriptSig = CScript() << sig << OP_0 << OP_TRUE << ToByteVector(ch.redeemScript);
+    ch.paid = paid;
+    raw_tx = EncodeHexTx(CTransaction(mtx));
+    return true;
+}
+
+void refundPaymentChannels()
+{
+    int height{0};
+    {
+        LOCK(cs_main);
+        height = chainActive.Height();
+    }
+    std::vector<CTransactionRef> due;
+    {
+        LOCK(cs_paymentChannels);
+        loadChannelRefunds();
+        for (const auto & refund : channelRefunds) {
+            if (static_cast<int64_t>(refund->nLockTime) <= height)
+                due.push_back(refund);
+        }
+    }
+    if (due.empty())
+        return;
+
+    const auto accepted = sendTransactionsBlockchain(due);
+    LOCK(cs_paymentChannels);
+    std::set<uint256> done;
+    for (size_t i = 0; i < due.size(); ++i) {
+        // The funding of settled channels is spent, their refunds are dropped
+        if (accepted[i] || !isChannelOpen(due[i]->vin[0].prevout)) {
+            if (accepted[i])
+                LOG() << "Refunded payment channel " << due[i]->vin[0].prevout.hash.ToString();
+            done.insert(due[i]->GetHash());
+        }
+    }
+    if (done.empty())
+        return;
+    channelRefunds.erase(std::remove_if(channelRefunds.begin(), channelRefunds.end(), [&done](const CTransactionRef & tx) {
+        return done.count(tx->GetHash()) > 0;
+    }), channelRefunds.end());
+    writeChannelRefunds();
+}
     
 } // namespace xrouter
@@ -7,4 +7,9 @@
 
 #define XROUTER_PROTOCOL_VERSION 50
 
+// Features are negotiated with the flags field of the packet header, which older nodes
+// leave unset. A client sets the flags of the features it supports on its requests, a
+// server only uses the features flagged in the request.
+#define XROUTER_FLAG_BINARY_REPLY 0x1 // reply in the binary encoding (see EncodeBinaryReply)
+
 #endif // BLOCKNET_XROUTER_XROUTERVERSION_H
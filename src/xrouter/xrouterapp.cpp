@@ -11,6 +11,7 @@
 #include <addrman.h>
 #include <bloom.h>
 #include <keystore.h>
+#include <metrics.h>
 #include <net.h>
 #include <script/standard.h>
 #include <servicenode/servicenodemgr.h>
@@ -20,6 +21,7 @@
 
 #include <chrono>
 #include <iostream>
+#include <thread>
 #include <vector>
 
 #include <boost/algorithm/string.hpp>
@@ -34,6 +36,8 @@
 namespace xrouter
 {
 
+static metrics::Histogram g_metric_query_time{"blocknet_xrouter_query_seconds", "Duration of the XRouter calls of this client"};
+
 template <typename T>
 bool PushXRouterMessage(CNode *pnode, const T & message) {
     const CNetMsgMaker msgMaker(pnode->GetSendVersion());
@@ -128,6 +132,17 @@ bool App::createConf()
                 "#! timeout is the maximum time in seconds you're willing to wait for an XRouter response"          + eol +
                 "timeout=30"                                                                                        + eol +
                 ""                                                                                                  + eol +
+                "#! hedgerequests=1 sends the query to a backup service node if a reply takes longer than most"     + eol +
+                "#! replies of that node usually take"                                                              + eol +
+                "#! hedgerequests=0"                                                                                + eol +
+                ""                                                                                                  + eol +
+                "#! clientrequestburst is the number of requests a client may send at once, after that clients"     + eol +
+                "#! get one request back every clientrequestlimit milliseconds"                                     + eol +
+                "#! clientrequestburst=1"                                                                           + eol +
+                ""                                                                                                  + eol +
+                "#! connectorconcurrency is the number of calls a servicenode sends to a wallet at the same time"   + eol +
+                "#! connectorconcurrency=4"                                                                         + eol +
+                ""                                                                                                  + eol +
                 "#! Optionally set per-call config options:"                                                        + eol +
                 "#! [xrGetBlockCount]"                                                                              + eol +
                 "#! maxfee=0.01"                                                                                    + eol +
@@ -138,6 +153,9 @@ bool App::createConf()
                 "#! [SYS::xrGetBlockCount]"                                                                         + eol +
                 "#! maxfee=0.01"                                                                                    + eol +
                 ""                                                                                                  + eol +
+                "#! [BTC]"                                                                                          + eol +
+                "#! connectorconcurrency=8"                                                                         + eol +
+                ""                                                                                                  + eol +
                 "#! It's possible to set config options for Custom XRouter services"                                + eol +
                 "#! [xrs::GetBestBlockHashBTC]"                                                                     + eol +
                 "#! maxfee=0.1"                                                                                     + eol
@@ -179,6 +197,7 @@ bool App::createConf()
                 "#! can only request at most once per 50 milliseconds (i.e. 20 times per second). If client"        + eol +
                 "#! requests exceed this value they will be penalized and eventually banned by your node."          + eol +
                 "clientrequestlimit=-1"                                                                             + eol +
+                "#! clientrequestburst=1 lets a client send that many requests at once"                             + eol +
                 ""                                                                                                  + eol +
                 "#! This is a sample configuration for the RPC plugin type for a syscoin plugin."                   + eol +
                 "#! private:: config entries will not be sent to XRouter clients. Below is a sample rpc"            + eol +
@@ -225,6 +244,7 @@ bool App::createConf()
                 "#! can only request at most once per 50 milliseconds (i.e. 20 times per second). If client"          + eol +
                 "#! requests exceed this value they will be penalized and eventually banned by your node."            + eol +
                 "clientrequestlimit=-1"                                                                               + eol +
+                "#! clientrequestburst=1 lets a client send that many requests at once"                               + eol +
                 ""                                                                                                    + eol +
                 "#! This is a sample configuration of a docker plugin running a syscoin container."                   + eol +
                 "#! private:: config entries will not be sent to XRouter clients. Below is a sample rpc"              + eol +
@@ -304,6 +324,12 @@ bool App::start()
     } else if (!initKeyPair()) // init on regular xrouter clients (non-snodes)
         return false;
 
+    // Packets received by the message handler are processed here
+    requests.start();
+    for (int i = 0; i < XROUTER_REQUEST_THREADS; ++i)
+        requestHandlers.create_thread(boost::bind(&App::processRequests, this));
+    requestHandlers.create_thread(boost::bind(&App::maintainConnections, this));
+
     {
         LOCK(mu);
         xrouterIsReady = true;
@@ -412,7 +438,7 @@ bool App::openConnections(enum XRouterCommand command, const std::string & servi
             return true; // fetch limit exceeded
         }
         auto rateLimit = settings->clientRequestLimit(command, service);
-        if (rateLimitExceeded(nodeAddr, fqService, getLastRequest(nodeAddr, fqService), rateLimit)) {
+        if (rateLimitExceeded(nodeAddr, fqService, rateLimit, settings->clientRequestBurst(command, service))) {
             LOG() << "Skipping node " << nodeAddr << " because not enough time passed since the last call";
             return true;
         }
@@ -438,7 +464,7 @@ bool App::openConnections(enum XRouterCommand command, const std::string & servi
         const std::string & nodeAddr = node->GetAddrName();
 
         // fetch config
-        updateSentRequest(nodeAddr, XRouterCommand_ToString(xrGetConfig));
+        updateSentRequest(nodeAddr, XRouterCommand_ToString(xrGetConfig), XROUTER_CONFIG_UPDATE_LIMIT);
         std::string uuid = sendXRouterConfigRequest(node);
         LOG() << "Requesting config from snode " << EncodeDestination(CTxDestination(snode.getPaymentAddress()))
               << " query " << uuid;
@@ -512,16 +538,19 @@ bool App::openConnections(enum XRouterCommand command, const std::string & servi
         CAddress addr(snode.getHostAddr(), NODE_NONE);
         CNode *node = g_connman->OpenXRouterConnection(addr, snodeAddr.c_str()); // Filters out bad nodes (banned, etc)
         if (node) {
-            const auto startTime = GetTime();
-            while (!node->fSuccessfullyConnected) { // wait n seconds for node to become available
-                const auto currentTime = GetTime();
-                if (ShutdownRequested() || currentTime - startTime > 3) { // wait 3 seconds
+            // wait 3 seconds for node to become available, woken when a handshake completes
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+            while (!node->fSuccessfullyConnected) {
+                const auto now = std::chrono::steady_clock::now();
+                if (ShutdownRequested() || now >= deadline) {
                     updateScore(snodeAddr, -5);
                     pendingConnMgr.notify(snodeAddr);
                     return;
                 }
                 boost::this_thread::interruption_point();
-                boost::this_thread::sleep_for(boost::chrono::milliseconds(10));
+                WAIT_LOCK(muConnected, lock);
+                connectedCond.wait_until(lock, std::min(deadline, now + std::chrono::milliseconds(100)),
+                                         [node]() { return node->fSuccessfullyConnected.load(); });
             }
             LOG() << "Connected to servicenode " << EncodeDestination(CTxDestination(snode.getPaymentAddress()));
             addNode(node); // store the node connection
@@ -683,9 +712,11 @@ bool App::openConnections(enum XRouterCommand command, const std::string & servi
             // Wait until we have all required connections (adjustedCount - connected = 0)
             // Wait while thread group has more running threads than we need connections for -or-
             //            thread group has too many threads (2 per cpu core)
+            // A few more attempts than needed run at the same time, so a slow or unreachable
+            // node doesn't hold up the connection setup
             auto waitTime = GetAdjustedTime();
             while (adjustedCount - connectedCount() > 0 && // only continue waiting for threads if we need more connections
-                  (tg.size() > (adjustedCount - connectedCount()) || tg.size() >= boost::thread::hardware_concurrency() * 2)) {
+                  (tg.size() > (adjustedCount - connectedCount()) + XROUTER_CONNECT_EXTRA || tg.size() >= boost::thread::hardware_concurrency() * 2)) {
                 if (ShutdownRequested()) {
                     tg.interrupt_all();
                     tg.join_all();
@@ -759,7 +790,7 @@ std::string App::updateConfigs(bool force)
 
         // Request the config
         auto & snode = snodes[nodeAddr]; // safe here due to check above
-        updateSentRequest(nodeAddr, XRouterCommand_ToString(xrGetConfig));
+        updateSentRequest(nodeAddr, XRouterCommand_ToString(xrGetConfig), XROUTER_CONFIG_UPDATE_LIMIT);
         std::string uuid = sendXRouterConfigRequest(pnode);
         LOG() << "Requesting config from snode " << EncodeDestination(CTxDestination(snode.getPaymentAddress()))
               << " query " << uuid;
@@ -805,12 +836,20 @@ bool App::stop()
         return false;
 
     // shutdown threads
+    requests.interrupt();
     requestHandlers.interrupt_all();
     requestHandlers.join_all();
+    {
+        // Queries return once they see the shutdown request
+        WAIT_LOCK(muAsync, lock);
+        asyncCond.wait(lock, [this]() EXCLUSIVE_LOCKS_REQUIRED(muAsync) { return asyncRunning == 0; });
+    }
 
     if (!server->stop())
         return false;
 
+    ClearHTTPConnections(); // close the backend and service node connections
+
     return true;
 }
  
@@ -889,7 +928,7 @@ std::vector<CNode*> App::availableNodesRetained(enum XRouterCommand command, con
         }
 
         auto rateLimit = settings->clientRequestLimit(command, service);
-        if (rateLimitExceeded(nodeAddr, fqCmd, getLastRequest(nodeAddr, fqCmd), rateLimit)) {
+        if (rateLimitExceeded(nodeAddr, fqCmd, rateLimit, settings->clientRequestBurst(command, service))) {
             const auto & snodeAddr = EncodeDestination(CTxDestination(snodec[nodeAddr].getPaymentAddress()));
             LOG() << "Skipping node " << snodeAddr << " because not enough time passed since the last call";
             continue;
@@ -971,9 +1010,19 @@ bool App::processReply(CNode *node, XRouterPacketPtr packet, CValidationState &
         return false;
     }
 
-    uint32_t offset = 0;
-    std::string reply((const char *)packet->data()+offset);
-    offset += reply.size() + 1;
+    std::string reply;
+    if (packet->flags() & XROUTER_FLAG_BINARY_REPLY) {
+        UniValue v;
+        if (!DecodeBinaryReply(packet->data(), packet->size(), v)) {
+            state.DoS(20, error("XRouter: bad binary reply"), REJECT_INVALID, "xrouter-error");
+            return false;
+        }
+        reply = v.write();
+    } else {
+        uint32_t offset = 0;
+        reply = std::string((const char *)packet->data()+offset);
+        offset += reply.size() + 1;
+    }
 
     // Store the reply
     queryMgr.addReply(uuid, nodeAddr, reply);
@@ -1057,6 +1106,16 @@ bool App::processConfigMessage(const sn::ServiceNode & snode) {
     if (smgr.hasActiveSn() && smgr.getActiveSn().key.GetPubKey() == snode.getSnodePubKey())
         return false; // do not process own config
 
+    // Pings repeat the config of the snode, it's only parsed again when it changed
+    const auto & snodePubKey = snode.getSnodePubKey();
+    const auto & configHash = snode.getConfigHash();
+    {
+        LOCK(mu);
+        auto it = snodeConfigHashes.find(snodePubKey);
+        if (it != snodeConfigHashes.end() && it->second.first == configHash && snodeConfigs.count(it->second.second))
+            return true;
+    }
+
     const auto & rawconfig = snode.getConfig("xrouter");
     UniValue uv;
     if (!uv.read(rawconfig))
@@ -1088,106 +1147,154 @@ bool App::processConfigMessage(const sn::ServiceNode & snode) {
     }
 
     // Update settings for node
-    updateConfig(settings->getNode(), settings);
+    const auto & node = settings->getNode();
+    updateConfig(node, settings);
+    {
+        LOCK(mu);
+        snodeConfigHashes[snodePubKey] = std::make_pair(configHash, node);
+    }
     return true;
 }
 
 //*****************************************************************************
 //*****************************************************************************
-void App::onMessageReceived(CNode* node, const std::vector<unsigned char> & message)
+void App::onNodeConnected()
+{
+    {
+        // Waiters check the node while holding the lock, the notification isn't lost
+        LOCK(muConnected);
+    }
+    connectedCond.notify_all();
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void App::onMessageReceived(CNode* node, const CNetPayload & message)
 {
     // If xrouter == 0, xrouter is turned off on this node
     if (!isEnabled() || !isReady())
         return;
 
-    auto retainNode = [](CNode *pnode) {
-        pnode->AddRef();
-    };
-
-    retainNode(node); // retain for thread below
+    // Handle the xrouter request on a request handler, the queue retains the node
+    if (!requests.push(node, message))
+        LOG() << "XRouter request queue is full, dropped packet from node " << node->GetAddrName();
+}
 
-    // Handle the xrouter request
-    requestHandlers.create_thread([this, node, message]() {
-        RenameThread("blocknet-xrrequest");
-        boost::this_thread::interruption_point();
-        CValidationState state;
+//*****************************************************************************
+//*****************************************************************************
+void App::processRequests()
+{
+    RenameThread("blocknet-xrrequest");
+    RequestQueue::Request request;
+    while (requests.pop(request))
+        processMessage(request.first, request.second); // releases the node
+}
 
-        bool released{false};
-        auto releaseNode = [&released](CNode *pnode) {
-            if (!released) {
-                released = true;
-                pnode->Release();
+//*****************************************************************************
+//*****************************************************************************
+void App::maintainConnections()
+{
+    RenameThread("blocknet-xrwarmpool");
+    try {
+        while (!ShutdownRequested()) {
+            boost::this_thread::sleep_for(boost::chrono::seconds(XROUTER_TIMER_SECONDS));
+            refundPaymentChannels();
+            for (const auto & s : warmServices.popular()) {
+                if (ShutdownRequested())
+                    return;
+                std::vector<sn::ServiceNode> nonWalletSnodes;
+                uint32_t found{0};
+                openConnections(s.command, s.service, s.count, -1, {}, nonWalletSnodes, found);
             }
-        };
-
-        try {
-            XRouterPacketPtr packet(new XRouterPacket);
-            if (!packet->copyFrom(message)) {
-                if (server->isStarted()) { // Send error back to client
-                    try {
-                        Object error;
-                        error.emplace_back("error", "XRouter Node reported a protocol error on a received packet. "
-                                                    "Unable to deserialize packet, possible bad packet header");
-                        error.emplace_back("code", xrouter::BAD_REQUEST);
-                        const std::string reply = json_spirit::write_string(Value(error), true);
-                        XRouterPacket packet(xrInvalid, "protocol_error");
-                        packet.append(reply);
-                        packet.sign(server->pubKey(), server->privKey());
-                        PushXRouterMessage(node, packet.body());
-                    } catch (std::exception & e) { // catch json errors
-                        ERR() << "Failed to send error reply to client " << node->GetAddrName() << " error: "
-                              << e.what();
-                    }
-                }
-
-                updateScore(node->GetAddrName(), -10);
-                state.DoS(10, error("XRouter: invalid packet received"), REJECT_INVALID, "xrouter-error");
-                checkDoS(state, node);
-                releaseNode(node);
+        }
+    } catch (boost::thread_interrupted &) {
+        // stopped
+    } catch (std::exception & e) {
+        ERR() << "XRouter warm pool stopped: " << e.what();
+    }
+}
 
-                return;
-            }
+//*****************************************************************************
+//*****************************************************************************
+void App::processMessage(CNode* node, const CNetPayload & message)
+{
+    CValidationState state;
 
-            const auto & command = packet->command();
-            const auto & uuid = packet->suuid();
-            const auto & nodeAddr = node->GetAddrName();
-            const auto & commandStr = XRouterCommand_ToString(command);
+    bool released{false};
+    auto releaseNode = [&released](CNode *pnode) {
+        if (!released) {
+            released = true;
+            pnode->Release();
+        }
+    };
 
-            if (command == xrService) {
-                auto service = packet->service();
-                if (service.size() > 100) // truncate service name
-                    service = service.substr(0, 100);
-                LOG() << "XRouter command: " << commandStr << xrdelimiter + service << " query: " << uuid << " node: " << nodeAddr;
-            }
-            else
-                LOG() << "XRouter command: " << commandStr << " query: " << uuid << " node: " << nodeAddr;
-
-            if (command == xrInvalid) { // Process invalid packets (protocol error packets)
-                processInvalid(node, packet, state);
-            } else if (command == xrReply) { // Process replies
-                processReply(node, packet, state);
-            } else if (command == xrConfigReply) { // Process config replies
-                processConfigReply(node, packet, state);
-            } else if (canListen() && server->isStarted()) { // Process server requests
-                server->addInFlightQuery(nodeAddr, uuid);
+    try {
+        XRouterPacketPtr packet(new XRouterPacket);
+        if (!packet->copyFrom(message.data(), message.size())) {
+            if (server->isStarted()) { // Send error back to client
                 try {
-                    server->onMessageReceived(node, packet, state);
-                    server->removeInFlightQuery(nodeAddr, uuid);
-                } catch (...) { // clean up on error
-                    server->removeInFlightQuery(nodeAddr, uuid);
+                    Object error;
+                    error.emplace_back("error", "XRouter Node reported a protocol error on a received packet. "
+                                                "Unable to deserialize packet, possible bad packet header");
+                    error.emplace_back("code", xrouter::BAD_REQUEST);
+                    const std::string reply = json_spirit::write_string(Value(error), true);
+                    XRouterPacket packet(xrInvalid, "protocol_error");
+                    packet.append(reply);
+                    packet.sign(server->pubKey(), server->privKey());
+                    PushXRouterMessage(node, packet.body());
+                } catch (std::exception & e) { // catch json errors
+                    ERR() << "Failed to send error reply to client " << node->GetAddrName() << " error: "
+                          << e.what();
                 }
             }
 
-            // Done with request, process DoS and release node
+            updateScore(node->GetAddrName(), -10);
+            state.DoS(10, error("XRouter: invalid packet received"), REJECT_INVALID, "xrouter-error");
             checkDoS(state, node);
             releaseNode(node);
 
-        } catch (...) {
-            ERR() << strprintf("xrouter query from %s processed with error: ", node->GetAddrName());
-            checkDoS(state, node);
-            releaseNode(node);
+            return;
         }
-    });
+
+        const auto & command = packet->command();
+        const auto & uuid = packet->suuid();
+        const auto & nodeAddr = node->GetAddrName();
+        const auto & commandStr = XRouterCommand_ToString(command);
+
+        if (command == xrService) {
+            auto service = packet->service();
+            if (service.size() > 100) // truncate service name
+                service = service.substr(0, 100);
+            LOG() << "XRouter command: " << commandStr << xrdelimiter + service << " query: " << uuid << " node: " << nodeAddr;
+        }
+        else
+            LOG() << "XRouter command: " << commandStr << " query: " << uuid << " node: " << nodeAddr;
+
+        if (command == xrInvalid) { // Process invalid packets (protocol error packets)
+            processInvalid(node, packet, state);
+        } else if (command == xrReply) { // Process replies
+            processReply(node, packet, state);
+        } else if (command == xrConfigReply) { // Process config replies
+            processConfigReply(node, packet, state);
+        } else if (canListen() && server->isStarted()) { // Process server requests
+            server->addInFlightQuery(nodeAddr, uuid);
+            try {
+                server->onMessageReceived(node, packet, state);
+                server->removeInFlightQuery(nodeAddr, uuid);
+            } catch (...) { // clean up on error
+                server->removeInFlightQuery(nodeAddr, uuid);
+            }
+        }
+
+        // Done with request, process DoS and release node
+        checkDoS(state, node);
+        releaseNode(node);
+
+    } catch (...) {
+        ERR() << strprintf("xrouter query from %s processed with error: ", node->GetAddrName());
+        checkDoS(state, node);
+        releaseNode(node);
+    }
 }
 
 //*****************************************************************************
@@ -1195,6 +1302,7 @@ void App::onMessageReceived(CNode* node, const std::vector<unsigned char> & mess
 std::string App::xrouterCall(enum XRouterCommand command, std::string & uuidRet, const std::string & fqServiceName,
                              const int & confirmations, const std::vector<std::string> & params)
 {
+    metrics::ScopedTimer queryTimer(g_metric_query_time);
     const std::string & uuid = generateUUID();
     uuidRet = uuid; // set uuid
     std::map<std::string, std::string> feePaymentTxs;
@@ -1219,8 +1327,8 @@ std::string App::xrouterCall(enum XRouterCommand command, std::string & uuidRet,
                         throw XRouterError("Incorrect block number: " + params[0], xrouter::INVALID_PARAMETERS);
                     break;
                 case xrGetTxBloomFilter:
-                    if (params.size() > 0 && (!is_hash(params[0]) || (params[0].size() % 10 != 0)))
-                        throw XRouterError("Incorrect bloom filter: " + params[0], xrouter::INVALID_PARAMETERS);
+                    if (params.empty() || params[0].empty())
+                        throw XRouterError("Missing addresses for " + fqServiceName, xrouter::INVALID_PARAMETERS);
                     break;
                 case xrGetBlock:
                 case xrGetTransaction:
@@ -1257,6 +1365,8 @@ std::string App::xrouterCall(enum XRouterCommand command, std::string & uuidRet,
         const auto & fqService = (command == xrService) ? pluginCommandKey(service) // plugin
                                                         : walletCommandKey(service, commandStr); // spv wallet
 
+        warmServices.touch(command, service, confs); // keep nodes of the service connected
+
         // Open connections (at least number equal to how many confirmations we want)
         std::vector<sn::ServiceNode> nonWalletSnodes;
         uint32_t found{0};
@@ -1292,16 +1402,19 @@ std::string App::xrouterCall(enum XRouterCommand command, std::string & uuidRet,
         for (auto & snode : nonWalletSnodes)
             mapSelectedSnodes[snode.getHostAddr().ToStringIPPort()] = snode;
 
-        // Compose a final list of snodes to request. selectedNodes here should be sorted
-        // ascending best to worst
+        // Compose a final list of snodes to request, ranked best to worst (see bestNode)
+        std::vector<NodeAddr> candidates;
         for (auto & item : mapSelectedSnodes) {
-            const auto & addr = item.first;
-            if (!hasConfig(addr))
-                continue; // skip nodes that do not have configs
+            if (hasConfig(item.first)) // skip nodes that do not have configs
+                candidates.push_back(item.first);
+        }
+        std::sort(candidates.begin(), candidates.end(), [this,command,service](const NodeAddr & a, const NodeAddr & b) {
+            return bestNode(a, b, command, service);
+        });
 
+        // Create the fee payment, returns false if the node can't be paid
+        auto payNode = [&](const NodeAddr & addr) -> bool {
             auto config = getConfig(addr);
-
-            // Create the fee payment
             CAmount fee = to_amount(config->commandFee(command, service));
             if (fee > 0) {
                 try {
@@ -1314,14 +1427,19 @@ std::string App::xrouterCall(enum XRouterCommand command, std::string & uuidRet,
                 } catch (XRouterError & e) {
                     ERR() << "Failed to create payment to node " << addr << " " << e.msg;
                     nodeErrors.emplace_back(e.msg, e.code);
-                    continue;
+                    return false;
                 }
             }
+            return true;
+        };
 
-            queryNodes.push_back(item.second);
+        size_t nextCandidate = 0; // candidates after this one are spares for hedged requests
+        for (; nextCandidate < candidates.size() && snodeCount < confs; ++nextCandidate) {
+            const auto & addr = candidates[nextCandidate];
+            if (!payNode(addr))
+                continue;
+            queryNodes.push_back(mapSelectedSnodes[addr]);
             ++snodeCount;
-            if (snodeCount == confs)
-                break;
         }
 
         // Do we have enough snodes? If not unlock utxos
@@ -1333,22 +1451,29 @@ std::string App::xrouterCall(enum XRouterCommand command, std::string & uuidRet,
 
         const int timeout = xrsettings->commandTimeout(command, service);
         boost::thread_group tg;
+        std::map<NodeAddr, std::chrono::steady_clock::time_point> sentTimes;
 
-        // Send xrouter request to each selected node
-        for (auto & snode : queryNodes) {
+        // Send xrouter request to the node
+        auto sendQuery = [&](const sn::ServiceNode & snode) {
             const std::string & addr = snode.getHost();
             std::string feetx;
             if (feePaymentTxs.count(addr))
                 feetx = feePaymentTxs[addr];
 
+            auto settings = getConfig(addr);
+            const int rateLimit = settings ? settings->clientRequestLimit(command, service) : -1;
+            const int rateBurst = settings ? settings->clientRequestBurst(command, service) : 1;
+
             // Record the node sending request to
             addQuery(uuid, addr);
             queryMgr.addQuery(uuid, addr);
+            sentTimes[addr] = std::chrono::steady_clock::now();
 
             if (mapSelectedNodes.count(addr)) { // query via the blocknet network
                 auto pnode = mapSelectedNodes[addr];
                 // Send packet to xrouter node
                 XRouterPacket packet(command, uuid);
+                packet.setFlags(XROUTER_FLAG_BINARY_REPLY); // accept binary replies
                 packet.append(service);
                 packet.append(feetx); // feetx
                 packet.append(static_cast<uint32_t>(params.size()));
@@ -1356,7 +1481,7 @@ std::string App::xrouterCall(enum XRouterCommand command, std::string & uuidRet,
                     packet.append(p);
                 packet.sign(cpubkey, cprivkey);
                 PushXRouterMessage(pnode, packet.body());
-                updateSentRequest(addr, fqService);
+                updateSentRequest(addr, fqService, rateLimit, rateBurst);
             } else { // query via external ip specified in config
                 // Set the fully qualified service url to the form /xr/BLOCK/xrGetBlockCount
                 const auto & fqUrl = fqServiceToUrl((command == xrService) ? pluginCommandKey(service) // plugin
@@ -1409,34 +1534,89 @@ std::string App::xrouterCall(enum XRouterCommand command, std::string & uuidRet,
                         queryMgr.purge(uuid, addr);
                     });
                 } catch (...) { }
-                updateSentRequest(addr, fqService);
+                updateSentRequest(addr, fqService, rateLimit, rateBurst);
             }
             LOG() << "Sent command " << fqService << " query " << uuid << " to node " << addr;
+        };
+        for (auto & snode : queryNodes)
+            sendQuery(snode);
+
+        // At this point we need to wait for responses, the response time of each reply is
+        // recorded as it arrives. With hedged requests a late reply is backed up by a query
+        // to the next spare node once the pending nodes passed their usual response time.
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(timeout);
+        const bool hedge = xrsettings->hedgeRequests(command, service);
+        bool hedged{false};
+        std::set<NodeAddr> replied;
+        auto elapsedMs = [](const std::chrono::steady_clock::time_point & since) -> int64_t {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - since).count();
+        };
+        while (!ShutdownRequested()) {
+            for (const auto & item : sentTimes) {
+                if (!replied.count(item.first) && queryMgr.hasReply(uuid, item.first)) {
+                    replied.insert(item.first);
+                    nodeStats.addReply(item.first, fqService, elapsedMs(item.second));
+                }
+            }
+            if (static_cast<int>(replied.size()) >= confs)
+                break;
+            const auto now = std::chrono::steady_clock::now();
+            if (now >= deadline)
+                break;
+
+            auto until = deadline;
+            if (hedge && !hedged && nextCandidate < candidates.size()) {
+                // Nodes without a record of replies are waited for until the timeout
+                auto hedgeTime = std::chrono::steady_clock::time_point::min();
+                for (const auto & item : sentTimes) {
+                    if (replied.count(item.first))
+                        continue;
+                    const auto ms = nodeStats.deadline(item.first, fqService);
+                    if (ms <= 0) {
+                        hedgeTime = deadline;
+                        break;
+                    }
+                    hedgeTime = std::max(hedgeTime, item.second + std::chrono::milliseconds(ms));
+                }
+                if (hedgeTime <= now) {
+                    hedged = true;
+                    int missing = confs - static_cast<int>(replied.size());
+                    for (; nextCandidate < candidates.size() && missing > 0; ++nextCandidate) {
+                        const auto & addr = candidates[nextCandidate];
+                        if (!payNode(addr))
+                            continue;
+                        LOG() << "Hedging query " << uuid << " with node " << addr;
+                        sendQuery(mapSelectedSnodes[addr]);
+                        --missing;
+                    }
+                    continue;
+                }
+                until = std::min(until, hedgeTime);
+            }
+            queryMgr.waitForReplies(uuid, static_cast<int>(replied.size()) + 1, until);
         }
 
-        // At this point we need to wait for responses
-        int confirmation_count = 0;
-        auto queryCheckStart = GetAdjustedTime();
-        auto queries = queryMgr.allLocks(uuid);
+        int confirmation_count = static_cast<int>(replied.size());
         std::vector<NodeAddr> review;
-        for (auto & query : queries)
-            review.push_back(query.first);
-
-        // Check that all replies have arrived, only run as long as timeout
-        while (!ShutdownRequested() && confirmation_count < confs
-            && GetAdjustedTime() - queryCheckStart < timeout)
-        {
-            boost::this_thread::sleep_for(boost::chrono::milliseconds(5));
-            for (int i = review.size() - 1; i >= 0; --i)
-                if (queryMgr.hasReply(uuid, review[i])) {
-                    ++confirmation_count;
-                    review.erase(review.begin()+i);
-                }
+        for (const auto & item : sentTimes) {
+            if (!replied.count(item.first))
+                review.push_back(item.first);
         }
 
         // Clean up
         queryMgr.purge(uuid);
 
+        // Nodes that missed the timeout failed, nodes that were still pending when enough
+        // replies arrived took at least as long as the query
+        for (const auto & addr : review) {
+            if (confirmation_count < confs)
+                nodeStats.addFailure(addr, fqService);
+            else {
+                nodeStats.addReply(addr, fqService, elapsedMs(sentTimes[addr]));
+                unlockOutputs(feePaymentTxs[addr]);
+            }
+        }
+
         std::set<NodeAddr> failed;
 
         if (confirmation_count < confs) {
@@ -1660,6 +1840,86 @@ std::string App::getBalance(std::string & uuidRet, const std::string & currency,
     return this->xrouterCall(xrGetBalance, uuidRet, currency, confirmations, { address });
 }
 
+std::string App::callAsync(const std::function<std::string()> & call)
+{
+    const std::string id = generateUUID();
+    {
+        LOCK(muAsync);
+        if (asyncRunning >= XROUTER_ASYNC_MAX_CALLS)
+            return "";
+        for (const auto & expired : asyncExpiry.advance(GetTime()))
+            asyncCalls.erase(expired);
+        asyncCalls[id];
+        ++asyncRunning;
+    }
+
+    auto run = [this, id, call]() {
+        std::string reply;
+        try {
+            reply = call();
+        } catch (std::exception & e) {
+            Object error;
+            error.emplace_back("error", e.what());
+            error.emplace_back("code", INTERNAL_SERVER_ERROR);
+            reply = json_spirit::write_string(Value(error), true);
+        }
+        std::vector<AsyncReplyHandler> waiters;
+        {
+            LOCK(muAsync);
+            auto & entry = asyncCalls[id];
+            entry.done = true;
+            entry.reply = reply;
+            asyncExpiry.schedule(id, GetTime() + XROUTER_ASYNC_REPLY_TTL + 1);
+            waiters.swap(entry.waiters);
+            --asyncRunning;
+        }
+        asyncCond.notify_all();
+        for (const auto & onReply : waiters)
+            onReply(reply);
+    };
+
+    try {
+        std::thread([run]() {
+            RenameThread("blocknet-xrasync");
+            run();
+        }).detach();
+    } catch (std::system_error & e) {
+        ERR() << "Failed to start async call " << id << " " << e.what();
+        run(); // out of threads, complete the call on the caller's thread
+    }
+    return id;
+}
+
+bool App::waitAsyncReply(const std::string & id, const AsyncReplyHandler & onReply)
+{
+    std::string reply;
+    {
+        LOCK(muAsync);
+        auto it = asyncCalls.find(id);
+        if (it == asyncCalls.end())
+            return false;
+        if (!it->second.done) {
+            it->second.waiters.push_back(onReply);
+            return true;
+        }
+        reply = it->second.reply;
+    }
+    onReply(reply);
+    return true;
+}
+
+std::vector<App::AsyncReplyHandler> App::cancelAsyncWaiters()
+{
+    std::vector<AsyncReplyHandler> waiters;
+    LOCK(muAsync);
+    for (auto & item : asyncCalls) {
+        auto & pending = item.second.waiters;
+        waiters.insert(waiters.end(), pending.begin(), pending.end());
+        pending.clear();
+    }
+    return waiters;
+}
+
 std::string App::getReply(const std::string & id)
 {
     auto replies = queryMgr.allReplies(id);
@@ -1729,6 +1989,14 @@ bool App::generatePayment(const NodeAddr & nodeAddr, const std::string & payment
             return false;
     }
 
+    // Pay over a payment channel if both sides use them
+    const CAmount funding = to_amount(xrsettings->paymentChannelFunding());
+    if (funding > 0 && getConfig(nodeAddr)->paymentChannels()) {
+        sn::ServiceNode snode = sn::ServiceNodeMgr::instance().getSn(nodeAddr);
+        if (!snode.isNull())
+            return createChannelPayment(nodeAddr, snode.getSnodePubKey(), snodeAddress, fee, funding, payment);
+    }
+
     bool res = createAndSignTransaction(snodeAddress, fee, payment);
     if (!res)
         return false;
@@ -1788,6 +2056,9 @@ std::map<NodeAddr, XRouterSettingsPtr> App::xrConnect(const std::string & fqServ
     const std::string plugin = boost::algorithm::join(std::vector<std::string>{nparts.begin()+1, nparts.end()}, xrdelimiter);
     const std::string service = command != xrService ? wallet : plugin;
 
+    if (count > 0)
+        warmServices.touch(command, service, static_cast<uint32_t>(count));
+
     std::vector<sn::ServiceNode> nonWalletSnodes;
     uint32_t found{0};
     openConnections(command, service, count, -1, { }, nonWalletSnodes, found); // open connections to snodes that have our service
@@ -1848,6 +2119,7 @@ void App::snodeConfigJSON(const std::map<NodeAddr, XRouterSettingsPtr> & configs
                 co.emplace_back("fee", item.second->commandFee(cmd, w));
                 co.emplace_back("paymentaddress", item.second->paymentAddress(cmd, w));
                 co.emplace_back("requestlimit", item.second->clientRequestLimit(cmd, w));
+                co.emplace_back("requestburst", item.second->clientRequestBurst(cmd, w));
                 co.emplace_back("fetchlimit", item.second->commandFetchLimit(cmd, w));
                 co.emplace_back("timeout", item.second->commandTimeout(cmd, w));
                 co.emplace_back("disabled", !item.second->isAvailableCommand(cmd, w));
@@ -1876,6 +2148,7 @@ void App::snodeConfigJSON(const std::map<NodeAddr, XRouterSettingsPtr> & configs
                 plg.emplace_back("fee", item.second->commandFee(xrService, plugin));
                 plg.emplace_back("paymentaddress", item.second->paymentAddress(xrService, plugin));
                 plg.emplace_back("requestlimit", item.second->clientRequestLimit(xrService, plugin));
+                plg.emplace_back("requestburst", item.second->clientRequestBurst(xrService, plugin));
                 plg.emplace_back("fetchlimit", item.second->commandFetchLimit(xrService, plugin));
                 plg.emplace_back("timeout", item.second->commandTimeout(xrService, plugin));
                 plg.emplace_back("disabled", !item.second->isAvailableCommand(xrService, plugin));
@@ -1959,6 +2232,7 @@ std::string App::getStatus() {
     result.emplace_back("xrouter", isEnabled());
     result.emplace_back("servicenode", sn::ServiceNodeMgr::instance().hasActiveSn());
     result.emplace_back("config", xrsettings->rawText());
+    result.emplace_back("ratelimits", rateLimitStats());
 
     Object plugins;
     for (const auto & p : xrsettings->getPlugins()) {
@@ -1996,8 +2270,8 @@ void App::getLatestNodeContainers(std::vector<sn::ServiceNode> & snodes, std::ve
     }
 }
 
-void App::runTests() {
-    server->runPerformanceTests();
+Object App::runTests(const int clients, const int requests, const int backendMs) {
+    return XRouterServer::runPerformanceTests(clients, requests, backendMs);
 }
 
 std::string App::getMyPaymentAddress() {
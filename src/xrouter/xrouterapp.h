@@ -18,12 +18,19 @@
 #include <key_io.h>
 #include <net.h>
 #include <net_processing.h>
+#include <shutdown.h>
 #include <sync.h>
 #include <uint256.h>
 
 #include <algorithm>
+#include <array>
 #include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <list>
 #include <memory>
+#include <unordered_map>
 
 #include <json/json_spirit.h>
 #include <json/json_spirit_reader_template.h>
@@ -46,6 +53,123 @@ typedef std::shared_ptr<XRouterServer> XRouterServerPtr;
 template <typename T>
 bool PushXRouterMessage(CNode *pnode, const T & message);
 
+/**
+ * Token buckets of the requests between nodes, by node and service. A bucket holds up to
+ * burst requests and gets one request back every interval. A missing bucket is a full one,
+ * so buckets that refilled are dropped, and the least recently used bucket is evicted when
+ * the limiter holds maxBuckets.
+ */
+class XRouterRateLimiter
+{
+public:
+    explicit XRouterRateLimiter(const size_t maxBuckets) : maxBuckets(maxBuckets) {}
+
+    /**
+     * Returns true if the node has no requests left for the service.
+     * @param node
+     * @param service
+     * @param interval Milliseconds to get back one request, no limit if not positive
+     * @param burst Requests allowed at once
+     * @return
+     */
+    bool exceeded(const NodeAddr & node, const std::string & service, const int interval, const int burst) {
+        if (interval <= 0)
+            return false;
+        const auto now = GetTimeMillis();
+        LOCK(mu);
+        auto it = index.find(key(node, service));
+        if (it == index.end())
+            return false;
+        return available(*it->second, now, interval, burst) < 1;
+    }
+
+    /**
+     * Takes a request from the bucket of the node and service. Throttled requests are counted.
+     * @param node
+     * @param service
+     * @param interval Milliseconds to get back one request, no limit if not positive
+     * @param burst Requests allowed at once
+     * @return false if the rate limit was exceeded
+     */
+    bool consume(const NodeAddr & node, const std::string & service, const int interval, const int burst) {
+        if (interval <= 0)
+            return true;
+        const auto now = GetTimeMillis();
+        LOCK(mu);
+        const auto k = key(node, service);
+        auto it = index.find(k);
+        if (it == index.end()) {
+            buckets.push_front(Bucket{k, static_cast<double>(burst), now, interval, burst});
+            index[k] = buckets.begin();
+        } else
+            buckets.splice(buckets.begin(), buckets, it->second); // most recently used
+
+        auto & b = buckets.front();
+        b.tokens = available(b, now, interval, burst);
+        b.last = now;
+        b.interval = interval;
+        b.burst = burst;
+        const bool allowed = b.tokens >= 1;
+        if (allowed)
+            b.tokens -= 1;
+        else
+            ++throttled;
+
+        while (!buckets.empty() && available(buckets.back(), now, buckets.back().interval,
+                                             buckets.back().burst) >= buckets.back().burst)
+            erase(std::prev(buckets.end()));
+        while (buckets.size() > maxBuckets) {
+            erase(std::prev(buckets.end()));
+            ++evicted;
+        }
+        return allowed;
+    }
+
+    /**
+     * Returns the number of buckets, throttled requests and evicted buckets.
+     * @return
+     */
+    Object stats() {
+        LOCK(mu);
+        Object o;
+        o.emplace_back("buckets", static_cast<uint64_t>(buckets.size()));
+        o.emplace_back("throttled", throttled);
+        o.emplace_back("evicted", evicted);
+        return o;
+    }
+
+private:
+    struct Bucket {
+        std::string key;
+        double tokens;
+        int64_t last; // milliseconds
+        int interval;
+        int burst;
+    };
+
+    static std::string key(const NodeAddr & node, const std::string & service) {
+        return node + " " + service;
+    }
+
+    static double available(const Bucket & b, const int64_t now, const int interval, const int burst) {
+        return std::min(static_cast<double>(burst),
+                        b.tokens + static_cast<double>(std::max(now - b.last, static_cast<int64_t>(0))) / interval);
+    }
+
+    void erase(std::list<Bucket>::iterator it) EXCLUSIVE_LOCKS_REQUIRED(mu) {
+        index.erase(it->key);
+        buckets.erase(it);
+    }
+
+private:
+    const size_t maxBuckets;
+    Mutex mu;
+    std::list<Bucket> buckets GUARDED_BY(mu); // most recently used first
+    std::unordered_map<std::string, std::list<Bucket>::iterator> index GUARDED_BY(mu);
+    uint64_t throttled GUARDED_BY(mu){0};
+    uint64_t evicted GUARDED_BY(mu){0};
+};
+
 //*****************************************************************************
 //*****************************************************************************
 class App
@@ -292,6 +416,36 @@ public:
      */
     std::string getReply(const std::string & uuid);
 
+    /**
+     * Called with the reply of an async call.
+     */
+    typedef std::function<void(const std::string & reply)> AsyncReplyHandler;
+
+    /**
+     * @brief Runs the call on its own thread and returns the id of its reply right away, the
+     * reply is delivered by waitAsyncReply. Returns an empty id if too many calls are in flight.
+     * @param call Returns the reply
+     * @return
+     */
+    std::string callAsync(const std::function<std::string()> & call);
+
+    /**
+     * @brief Calls onReply with the reply of the async call, right away if the call already
+     * completed, otherwise on the thread that completes it. Returns false if the id is unknown
+     * or the reply expired.
+     * @param id
+     * @param onReply
+     * @return
+     */
+    bool waitAsyncReply(const std::string & id, const AsyncReplyHandler & onReply);
+
+    /**
+     * @brief Removes and returns the handlers still waiting for async replies, used on shutdown
+     * to complete the waiting requests.
+     * @return
+     */
+    std::vector<AsyncReplyHandler> cancelAsyncWaiters();
+
     /**
      * JSON output of specified configurations.
      * @param configs
@@ -383,7 +537,8 @@ public:
     bool processConfigReply(CNode *node, XRouterPacketPtr packet, CValidationState & state);
 
     /**
-     * @brief process config message from NetMsgType::SNPING packet.
+     * @brief process config message from NetMsgType::SNPING packet. The config is only parsed
+     * again when its hash changed since the last ping of the service node.
      * @param snode Service node to process config from
      * @return
      */
@@ -417,12 +572,22 @@ public:
      * @param node source CNode
      * @param message packet contents
      */
-    void onMessageReceived(CNode* node, const std::vector<unsigned char> & message);
+    void onMessageReceived(CNode* node, const CNetPayload & message);
+
+    /**
+     * @brief onNodeConnected call when the version handshake of a node completed, wakes
+     * the threads waiting for xrouter connections
+     */
+    void onNodeConnected();
     
     /**
-     * @brief run performance tests (xrTest)
+     * @brief run the load test against a fake backend (xrTest), see XRouterServer::runPerformanceTests
+     * @param clients number of concurrent clients
+     * @param requests requests sent by each client
+     * @param backendMs simulated backend response time in milliseconds
+     * @return results json object
      */
-    void runTests();
+    Object runTests(const int clients, const int requests, const int backendMs);
 
     /**
      * @brief returns service node collateral address
@@ -453,20 +618,12 @@ public:
      * Returns true if the rate limit has been exceeded on requests to the specified node.
      * @param node Node address
      * @param service Name of the command or service
-     * @param lastRequest Time of last request
      * @param rateLimit Rate limit in milliseconds
+     * @param burst Requests allowed at once
      * @return
      */
-    bool rateLimitExceeded(const NodeAddr & node, const std::string & service,
-            const std::chrono::time_point<std::chrono::system_clock> lastRequest, const int rateLimit)
-    {
-        if (hasSentRequest(node, service)) {
-            std::chrono::time_point<std::chrono::system_clock> time = std::chrono::system_clock::now();
-            std::chrono::system_clock::duration diff = time - lastRequest;
-            if (std::chrono::duration_cast<std::chrono::milliseconds>(diff).count() < std::chrono::milliseconds(rateLimit).count())
-                return true;
-        }
-        return false;
+    bool rateLimitExceeded(const NodeAddr & node, const std::string & service, const int rateLimit, const int burst = 1) {
+        return rateLimiter.exceeded(node, service, rateLimit, burst);
     }
 
     /**
@@ -504,37 +661,23 @@ public:
     }
 
     /**
-     * Return time of the last request to specified node.
+     * Records a request to (or from) the specified node and command.
      * @param node
      * @param command
-     * @return
+     * @param rateLimit Rate limit in milliseconds
+     * @param burst Requests allowed at once
+     * @return false if the request exceeded the rate limit
      */
-    std::chrono::time_point<std::chrono::system_clock> getLastRequest(const NodeAddr & node, const std::string & command) {
-        LOCK(mu);
-        if (lastPacketsSent.count(node) && lastPacketsSent[node].count(command))
-            return lastPacketsSent[node][command];
-        return std::chrono::system_clock::from_time_t(0);
+    bool updateSentRequest(const NodeAddr & node, const std::string & command, const int rateLimit, const int burst = 1) {
+        return rateLimiter.consume(node, command, rateLimit, burst);
     }
 
     /**
-     * Returns true if a request to a node has been made previously.
-     * @param node
-     * @param command
+     * Returns the rate limiter counters.
      * @return
      */
-    bool hasSentRequest(const NodeAddr & node, const std::string & command) {
-        LOCK(mu);
-        return lastPacketsSent.count(node) && lastPacketsSent[node].count(command);
-    }
-
-    /**
-     * Updates (or adds) a request time for the specified node and command.
-     * @param node
-     * @param command
-     */
-    void updateSentRequest(const NodeAddr & node, const std::string & command) {
-        LOCK(mu);
-        lastPacketsSent[node][command] = std::chrono::system_clock::now();
+    Object rateLimitStats() {
+        return rateLimiter.stats();
     }
 
     /**
@@ -602,7 +745,15 @@ private:
         auto sb = getConfig(b);
         if (!sa || !sb)
             return a_score > b_score;
-        return sa->commandFee(command, service) < sb->commandFee(command, service);
+        const auto a_fee = sa->commandFee(command, service);
+        const auto b_fee = sb->commandFee(command, service);
+        if (a_fee != b_fee)
+            return a_fee < b_fee;
+        // Equal fees, prefer the node that replies faster
+        const auto & fqService = (command == xrService) ? pluginCommandKey(service)
+                                                        : walletCommandKey(service, XRouterCommand_ToString(command));
+        const int64_t timeoutMs = xrsettings->commandTimeout(command, service) * 1000;
+        return nodeStats.cost(a, fqService, timeoutMs) < nodeStats.cost(b, fqService, timeoutMs);
     }
 
     std::map<NodeAddr, XRouterSettingsPtr> getConfigs() {
@@ -658,8 +809,7 @@ private:
     }
     bool needConfigUpdate(const NodeAddr & node, const bool & isServer = false) {
         const auto & service = XRouterCommand_ToString(xrGetConfig);
-        return !rateLimitExceeded(node, service, getLastRequest(node, service),
-                isServer ? 10000 : 600000); // server default is 10 seconds, client default is 10 minutes
+        return !rateLimitExceeded(node, service, isServer ? XROUTER_CONFIG_REQUEST_LIMIT : XROUTER_CONFIG_UPDATE_LIMIT);
     }
 
     /**
@@ -687,6 +837,167 @@ private:
      */
     void checkDoS(CValidationState & state, CNode *pnode);
 
+    /**
+     * Request handler thread, processes the queued packets until the queue is interrupted.
+     */
+    void processRequests();
+
+    /**
+     * Keeps connections with fetched configs open to service nodes of the most used services,
+     * so that a query after an idle period doesn't wait for the connection and config.
+     */
+    void maintainConnections();
+
+    /**
+     * Processes a packet received from the node and releases the node.
+     * @param node
+     * @param message
+     */
+    void processMessage(CNode* node, const CNetPayload & message);
+
+    /**
+     * Packets received from nodes waiting for a request handler. Nodes are served round robin,
+     * so a node flooding this node doesn't delay the packets of the other nodes.
+     */
+    class RequestQueue {
+    public:
+        typedef std::pair<CNode*, CNetPayload> Request;
+        /**
+         * Accepts packets again after an interrupt, called before the request handlers start.
+         */
+        void start() {
+            LOCK(mu);
+            interrupted = false;
+        }
+        /**
+         * Queues the packet, the node is retained until the packet is processed.
+         * @param node
+         * @param message
+         * @return false if the queue of the node or of all nodes is full
+         */
+        bool push(CNode *node, const CNetPayload & message) {
+            {
+                LOCK(mu);
+                if (interrupted || total >= XROUTER_MAX_REQUESTS)
+                    return false;
+                auto & q = pending[node->GetId()];
+                if (q.size() >= XROUTER_MAX_NODE_REQUESTS)
+                    return false;
+                if (q.empty())
+                    nodes.push_back(node->GetId());
+                node->AddRef();
+                q.emplace_back(node, message);
+                ++total;
+            }
+            cond.notify_one();
+            return true;
+        }
+        /**
+         * Takes the next packet, blocks until a packet is queued.
+         * @param request
+         * @return false if the queue was interrupted
+         */
+        bool pop(Request & request) {
+            WAIT_LOCK(mu, lock);
+            cond.wait(lock, [this]() EXCLUSIVE_LOCKS_REQUIRED(mu) { return interrupted || total > 0; });
+            if (interrupted)
+                return false;
+            const NodeId id = nodes.front();
+            nodes.pop_front();
+            auto it = pending.find(id);
+            request = std::move(it->second.front());
+            it->second.pop_front();
+            --total;
+            if (it->second.empty())
+                pending.erase(it);
+            else
+                nodes.push_back(id); // next packet of the node after the other nodes
+            return true;
+        }
+        /**
+         * Wakes the request handlers and releases the nodes of the queued packets.
+         */
+        void interrupt() {
+            std::map<NodeId, std::deque<Request> > dropped;
+            {
+                LOCK(mu);
+                interrupted = true;
+                dropped.swap(pending);
+                nodes.clear();
+                total = 0;
+            }
+            cond.notify_all();
+            for (auto & item : dropped) {
+                for (auto & request : item.second)
+                    request.first->Release();
+            }
+        }
+    private:
+        Mutex mu;
+        std::condition_variable cond;
+        std::map<NodeId, std::deque<Request> > pending;
+        std::deque<NodeId> nodes; // round robin order of the nodes with queued packets
+        size_t total{0};
+        bool interrupted{false};
+    };
+
+    /**
+     * Services used by recent queries and the number of nodes they need.
+     */
+    class WarmServices {
+    public:
+        struct Service {
+            XRouterCommand command;
+            std::string service;
+            uint32_t count;
+        };
+        /**
+         * Records a use of the service.
+         * @param command
+         * @param service
+         * @param count Number of nodes the use needed
+         */
+        void touch(const XRouterCommand command, const std::string & service, const uint32_t count) {
+            LOCK(mu);
+            auto & u = uses[std::make_pair(command, service)];
+            u.lastUsed = GetTime();
+            u.count = std::max(u.count, count);
+            ++u.hits;
+        }
+        /**
+         * Returns the most used services used in the last XROUTER_WARMPOOL_IDLE seconds, and
+         * forgets the others.
+         */
+        std::vector<Service> popular() {
+            LOCK(mu);
+            const int64_t cutoff = GetTime() - XROUTER_WARMPOOL_IDLE;
+            std::vector<std::pair<uint64_t, Service> > list;
+            for (auto it = uses.begin(); it != uses.end(); ) {
+                if (it->second.lastUsed < cutoff) {
+                    it = uses.erase(it);
+                    continue;
+                }
+                list.emplace_back(it->second.hits, Service{it->first.first, it->first.second, it->second.count});
+                ++it;
+            }
+            std::sort(list.begin(), list.end(), [](const std::pair<uint64_t, Service> & a, const std::pair<uint64_t, Service> & b) {
+                return a.first > b.first;
+            });
+            std::vector<Service> services;
+            for (size_t i = 0; i < list.size() && i < XROUTER_WARMPOOL_SERVICES; ++i)
+                services.push_back(list[i].second);
+            return services;
+        }
+    private:
+        struct Use {
+            int64_t lastUsed{0};
+            uint32_t count{0};
+            uint64_t hits{0};
+        };
+        Mutex mu;
+        std::map<std::pair<XRouterCommand, std::string>, Use> uses;
+    };
+
     class PendingConnectionMgr {
     public:
         PendingConnectionMgr() = default;
@@ -796,11 +1107,17 @@ private:
         std::map<NodeAddr, PendingConnection> pendingConnections;
     };
 
+    /**
+     * Pending and answered queries. Queries are spread over XROUTER_QUERY_SHARDS tables by
+     * their id, each query has its own lock and condition variable so that queries don't
+     * wait on each other. Replies are grouped by content as they arrive, the most common
+     * reply is read from the groups.
+     */
     class QueryMgr {
     public:
         typedef std::string QueryReply;
         typedef std::pair<std::shared_ptr<boost::mutex>, std::shared_ptr<boost::condition_variable> > QueryCondition;
-        QueryMgr() : queriesLocks(), queries() {}
+        QueryMgr() = default;
         /**
          * Add a query. This stores interal state including condition variables and associated mutexes.
          * @param id uuid of query, can't be empty
@@ -810,19 +1127,25 @@ private:
             if (id.empty() || node.empty())
                 return;
 
-            LOCK(mu);
-
-            if (!queries.count(id))
-                queries[id] = std::map<NodeAddr, std::string>{};
-
-            std::shared_ptr<boost::mutex> m(new boost::mutex());
-            std::shared_ptr<boost::condition_variable> cond(new boost::condition_variable());
-
-            if (!queriesLocks.count(id))
-                queriesLocks[id] = std::map<NodeAddr, QueryCondition>{};
+            QueryPtr q;
+            {
+                auto & s = shard(id);
+                LOCK(s.mu);
+                auto & entry = s.queries[id];
+                if (!entry)
+                    entry = std::make_shared<Query>();
+                q = entry;
+            }
 
-            auto qc = QueryCondition{m, cond};
-            queriesLocks[id][node] = qc;
+            auto qc = QueryCondition{std::make_shared<boost::mutex>(), std::make_shared<boost::condition_variable>()};
+            LOCK(q->mu);
+            q->active = true;
+            if (q->locks.count(node))
+                q->locks[node] = qc;
+            else {
+                q->locks.emplace(node, qc);
+                addPending(node);
+            }
         }
         /**
          * Store a query reply.
@@ -835,33 +1158,102 @@ private:
             if (id.empty() || node.empty())
                 return 0;
 
-            int replies{0};
-            QueryCondition qcond;
+            auto q = find(id);
+            if (!q)
+                return 0; // done, no query found with id
+
+            // Replies that only differ in formatting or key order count as the same reply
+            std::string normalized = reply;
+            try {
+                Value j; read_string(reply, j);
+                if (j.type() == obj_type || j.type() == array_type) {
+                    canonicalize(j);
+                    normalized = write_string(j, false);
+                }
+            } catch (...) { }
+            const auto hash = Hash(normalized.begin(), normalized.end());
+            const bool error = hasError(reply);
 
+            QueryCondition qcond;
+            int count{0};
             {
-                LOCK(mu);
-
-                if (!queries.count(id))
-                    return 0; // done, no query found with id
-
-                // Total replies
-                replies = queriesLocks.count(id);
-                // Query condition
-                if (replies)
-                    qcond = queriesLocks[id][node];
+                LOCK(q->mu);
+                // Query condition, only handle locks if they exist for this query
+                auto it = q->locks.find(node);
+                if (it == q->locks.end())
+                    return 0;
+                qcond = it->second;
                 // If invalid query condition return
                 if (!qcond.first || !qcond.second)
                     return 0;
+
+                auto prev = q->replyHashes.find(node);
+                bool replaced{false};
+                if (prev != q->replyHashes.end()) { // replaced reply
+                    auto & group = q->groups[prev->second];
+                    group.nodes.erase(node);
+                    if (group.nodes.empty())
+                        q->groups.erase(prev->second);
+                    replaced = true;
+                }
+                auto & group = q->groups[hash];
+                if (group.nodes.empty()) {
+                    group.reply = reply;
+                    group.error = error;
+                }
+                group.nodes.insert(node);
+                q->replyHashes[node] = hash;
+                if (replaced) { // a group may have shrunk
+                    q->best = nullptr;
+                    for (auto & item : q->groups) {
+                        if (!q->best || moreCommon(item.second, *q->best))
+                            q->best = &item.second;
+                    }
+                } else if (!q->best || moreCommon(group, *q->best))
+                    q->best = &group;
+                q->replies[node] = reply; // Assign reply
+                count = static_cast<int>(q->replies.size());
             }
 
-            if (replies) { // only handle locks if they exist for this query
+            {
+                // Waiters check for the reply while holding the query lock
                 boost::mutex::scoped_lock l(*qcond.first);
-                queries[id][node] = reply; // Assign reply
                 qcond.second->notify_all();
             }
-
-            LOCK(mu);
-            return queries.count(id);
+            q->cond.notify_all();
+            return count;
+        }
+        /**
+         * Waits until the query with specified id has the number of replies. Returns as soon as
+         * the reply arrives, when the timeout passed or when shutdown was requested.
+         * @param id
+         * @param count Number of replies to wait for
+         * @param timeout Seconds to wait
+         * @return Number of replies
+         */
+        int waitForReplies(const std::string & id, const int count, const int timeout) {
+            return waitForReplies(id, count, std::chrono::steady_clock::now() + std::chrono::seconds(timeout));
+        }
+        /**
+         * Waits until the query with specified id has the number of replies or until the deadline.
+         * @param id
+         * @param count Number of replies to wait for
+         * @param deadline
+         * @return Number of replies
+         */
+        int waitForReplies(const std::string & id, const int count, const std::chrono::steady_clock::time_point & deadline) {
+            auto q = find(id);
+            if (!q)
+                return 0;
+            WAIT_LOCK(q->mu, lock);
+            while (static_cast<int>(q->replies.size()) < count && !ShutdownRequested()) {
+                const auto now = std::chrono::steady_clock::now();
+                if (now >= deadline)
+                    break;
+                // Shutdown doesn't notify, check for it every second
+                q->cond.wait_until(lock, std::min(deadline, now + std::chrono::seconds(1)));
+            }
+            return static_cast<int>(q->replies.size());
         }
         /**
          * Fetch a reply. This method returns the number of matching replies.
@@ -870,14 +1262,14 @@ private:
          * @return
          */
         int reply(const std::string & id, const NodeAddr & node, std::string & reply) {
-            LOCK(mu);
-
-            int consensus = queries.count(id);
-            if (!consensus)
+            auto q = find(id);
+            if (!q)
                 return 0;
 
-            reply = queries[id][node];
-            return consensus;
+            LOCK(q->mu);
+            auto it = q->replies.find(node);
+            reply = it != q->replies.end() ? it->second : "";
+            return 1;
         }
         /**
          * Fetch the most common reply for a specific query. If a group of nodes return results and 2 of 3 are
@@ -892,74 +1284,31 @@ private:
         int mostCommonReply(const std::string & id, std::string & reply, std::map<NodeAddr, std::string> & replies,
                             std::set<NodeAddr> & agree, std::set<NodeAddr> & diff)
         {
-            LOCK(mu);
+            auto q = find(id);
+            if (!q)
+                return 0;
 
-            int consensus = queries.count(id);
-            if (!consensus || queries[id].empty())
+            LOCK(q->mu);
+            if (!q->best)
                 return 0;
 
             // all replies
-            replies = queries[id];
-
-            std::map<uint256, std::string> hashes;
-            std::map<uint256, int> counts;
-            std::map<uint256, std::set<NodeAddr> > nodes;
-            for (auto & item : queries[id]) {
-                auto result = item.second;
-                try {
-                    Value j; read_string(result, j);
-                    if (j.type() == obj_type)
-                        result = write_string(j, false);
-                } catch (...) {
-                    result = item.second;
-                }
-                auto hash = Hash(result.begin(), result.end());
-                hashes[hash] = item.second;
-                counts[hash] = counts.count(hash) + 1; // update counts for common replies
-                nodes[hash].insert(item.first);
-            }
-
-            // sort reply counts descending (most similar replies are more valuable)
-            std::vector<std::pair<uint256, int> > tmp(counts.begin(), counts.end());
-            std::sort(tmp.begin(), tmp.end(),
-                      [](std::pair<uint256, int> & a, std::pair<uint256, int> & b) {
-                          return a.second > b.second;
-                      });
+            replies = q->replies;
 
+            // Filter nodes that responded with different results, do not penalize equal counts, only fewer
+            const auto & best = *q->best;
             diff.clear();
-            if (tmp.size() > 1) {
-                if (tmp[0].second == tmp[1].second) { // Check for errors and re-sort if there's a tie and highest rank has error
-                    const auto &r = hashes[tmp[0].first];
-                    if (hasError(r)) { // in tie arrangements we don't want errors to take precendence
-                        std::sort(tmp.begin(), tmp.end(), // sort descending
-                            [this, &hashes](std::pair<uint256, int> & a, std::pair<uint256, int> & b) {
-                                const auto & ae = hasError(hashes[a.first]);
-                                const auto & be = hasError(hashes[b.first]);
-                                if ((!ae && !be) || (ae && be))
-                                    return a.second > b.second;
-                                return be;
-                            });
-                    }
-                }
-                // Filter nodes that responded with different results
-                for (int i = 1; i < static_cast<int>(tmp.size()); ++i) {
-                    const auto & hash = tmp[i].first;
-                    if (!nodes.count(hash) || tmp[i].second >= tmp[0].second) // do not penalize equal counts, only fewer
-                        continue;
-                    auto ns = nodes[hash];
-                    diff.insert(ns.begin(), ns.end());
-                }
+            for (const auto & item : q->groups) {
+                if (item.second.nodes.size() < best.nodes.size())
+                    diff.insert(item.second.nodes.begin(), item.second.nodes.end());
             }
 
-            auto selhash = tmp[0].first;
-
             // store agreeing nodes
-            agree.clear();
-            agree = nodes[selhash];
+            agree = best.nodes;
 
             // select the most common replies
-            reply = hashes[selhash];
-            return tmp[0].second;
+            reply = best.reply;
+            return static_cast<int>(best.nodes.size());
         }
         /**
          * Returns true if the query with specified id.
@@ -967,8 +1316,11 @@ private:
          * @return
          */
         bool hasQuery(const std::string & id) {
-            LOCK(mu);
-            return queriesLocks.count(id);
+            auto q = find(id);
+            if (!q)
+                return false;
+            LOCK(q->mu);
+            return q->active;
         }
         /**
          * Returns true if the query with specified id and node address is valid.
@@ -977,8 +1329,11 @@ private:
          * @return
          */
         bool hasQuery(const std::string & id, const NodeAddr & node) {
-            LOCK(mu);
-            return queriesLocks.count(id) && queriesLocks[id].count(node);
+            auto q = find(id);
+            if (!q)
+                return false;
+            LOCK(q->mu);
+            return q->locks.count(node) > 0;
         }
         /**
          * Returns true if a query for the specified node exists.
@@ -986,12 +1341,8 @@ private:
          * @return
          */
         bool hasNodeQuery(const NodeAddr & node) {
-            LOCK(mu);
-            for (const auto & item : queriesLocks) {
-                if (item.second.count(node))
-                    return true;
-            }
-            return false;
+            LOCK(pendingMu);
+            return pendingNodes.count(node) > 0;
         }
         /**
          * Returns true if the reply exists for the specified node.
@@ -1000,8 +1351,11 @@ private:
          * @return
          */
         bool hasReply(const std::string & id, const NodeAddr & node) {
-            LOCK(mu);
-            return queries.count(id) && queries[id].count(node);
+            auto q = find(id);
+            if (!q)
+                return false;
+            LOCK(q->mu);
+            return q->replies.count(node) > 0;
         }
         /**
          * Returns the query's mutex.
@@ -1010,12 +1364,12 @@ private:
          * @return
          */
         std::shared_ptr<boost::mutex> queryLock(const std::string & id, const NodeAddr & node) {
-            LOCK(mu);
-            if (!queriesLocks.count(id))
+            auto q = find(id);
+            if (!q)
                 return nullptr;
-            if (!queriesLocks[id].count(node))
-                return nullptr;
-            return queriesLocks[id][node].first;
+            LOCK(q->mu);
+            auto it = q->locks.find(node);
+            return it != q->locks.end() ? it->second.first : nullptr;
         }
         /**
          * Returns the queries condition variable.
@@ -1024,12 +1378,12 @@ private:
          * @return
          */
         std::shared_ptr<boost::condition_variable> queryCond(const std::string & id, const NodeAddr & node) {
-            LOCK(mu);
-            if (!queriesLocks.count(id))
+            auto q = find(id);
+            if (!q)
                 return nullptr;
-            if (!queriesLocks[id].count(node))
-                return nullptr;
-            return queriesLocks[id][node].second;
+            LOCK(q->mu);
+            auto it = q->locks.find(node);
+            return it != q->locks.end() ? it->second.second : nullptr;
         }
         /**
          * Return all replies associated with a query.
@@ -1037,8 +1391,11 @@ private:
          * @return
          */
         std::map<std::string, QueryReply> allReplies(const std::string & id) {
-            LOCK(mu);
-            return queries[id];
+            auto q = find(id);
+            if (!q)
+                return {};
+            LOCK(q->mu);
+            return q->replies;
         }
         /**
          * Return all query locks associated with an id.
@@ -1046,16 +1403,25 @@ private:
          * @return
          */
         std::map<std::string, QueryCondition> allLocks(const std::string & id) {
-            LOCK(mu);
-            return queriesLocks[id];
+            auto q = find(id);
+            if (!q)
+                return {};
+            LOCK(q->mu);
+            return q->locks;
         }
         /**
          * Purges the ephemeral state of a query with specified id.
          * @param id
          */
         void purge(const std::string & id) {
-            LOCK(mu);
-            queriesLocks.erase(id);
+            auto q = find(id);
+            if (!q)
+                return;
+            LOCK(q->mu);
+            for (const auto & item : q->locks)
+                removePending(item.first);
+            q->locks.clear();
+            q->active = false;
         }
         /**
          * Purges the ephemeral state of a query with specified id and node address.
@@ -1063,11 +1429,80 @@ private:
          * @param node
          */
         void purge(const std::string & id, const NodeAddr & node) {
-            LOCK(mu);
-            if (queriesLocks.count(id))
-                queriesLocks[id].erase(node);
+            auto q = find(id);
+            if (!q)
+                return;
+            LOCK(q->mu);
+            if (q->locks.erase(node))
+                removePending(node);
         }
     private:
+        struct ReplyGroup {
+            std::string reply; // first reply of the group
+            bool error{false};
+            std::set<NodeAddr> nodes;
+        };
+        struct Query {
+            Mutex mu;
+            std::condition_variable cond; // notified on every reply
+            bool active GUARDED_BY(mu){true};
+            std::map<NodeAddr, QueryCondition> locks GUARDED_BY(mu); // nodes still expected to reply
+            std::map<NodeAddr, QueryReply> replies GUARDED_BY(mu);
+            std::map<NodeAddr, uint256> replyHashes GUARDED_BY(mu);
+            std::map<uint256, ReplyGroup> groups GUARDED_BY(mu); // replies by normalized content
+            const ReplyGroup *best GUARDED_BY(mu){nullptr}; // most common group, see moreCommon
+        };
+        typedef std::shared_ptr<Query> QueryPtr;
+        struct Shard {
+            Mutex mu;
+            std::unordered_map<std::string, QueryPtr> queries GUARDED_BY(mu);
+        };
+
+        Shard & shard(const std::string & id) {
+            return shards[std::hash<std::string>()(id) % shards.size()];
+        }
+        QueryPtr find(const std::string & id) {
+            auto & s = shard(id);
+            LOCK(s.mu);
+            auto it = s.queries.find(id);
+            return it != s.queries.end() ? it->second : nullptr;
+        }
+        void addPending(const NodeAddr & node) {
+            LOCK(pendingMu);
+            ++pendingNodes[node];
+        }
+        void removePending(const NodeAddr & node) {
+            LOCK(pendingMu);
+            auto it = pendingNodes.find(node);
+            if (it != pendingNodes.end() && --it->second <= 0)
+                pendingNodes.erase(it);
+        }
+        /**
+         * Most similar replies are more valuable, in ties replies without errors take precedence
+         * and otherwise the first group stays ahead.
+         */
+        static bool moreCommon(const ReplyGroup & a, const ReplyGroup & b) {
+            if (a.nodes.size() != b.nodes.size())
+                return a.nodes.size() > b.nodes.size();
+            return !a.error && b.error;
+        }
+        /**
+         * Sorts the keys of all objects so that the serialized value doesn't depend on the
+         * key order of the service node's backend.
+         */
+        static void canonicalize(Value & v) {
+            if (v.type() == obj_type) {
+                auto & o = v.get_obj();
+                for (auto & pair : o)
+                    canonicalize(pair.value_);
+                std::stable_sort(o.begin(), o.end(), [](const json_spirit::Pair & a, const json_spirit::Pair & b) {
+                    return a.name_ < b.name_;
+                });
+            } else if (v.type() == array_type) {
+                for (auto & item : v.get_array())
+                    canonicalize(item);
+            }
+        }
         bool hasError(const std::string & reply) {
             Value v; json_spirit::read_string(reply, v);
             if (v.type() != json_spirit::obj_type)
@@ -1075,10 +1510,95 @@ private:
             const auto & err_v = json_spirit::find_value(v.get_obj(), "error");
             return err_v.type() != json_spirit::null_type;
         }
+    private:
+        std::array<Shard, XROUTER_QUERY_SHARDS> shards;
+        Mutex pendingMu;
+        std::unordered_map<NodeAddr, int> pendingNodes GUARDED_BY(pendingMu); // nodes with pending queries
+    };
+
+    /**
+     * Response times and failure rates of the service nodes per service. The values are
+     * exponentially weighted moving averages so that recent queries count the most, the
+     * response time deviation is smoothed the same way (see RFC 6298).
+     */
+    class NodeStats {
+    public:
+        struct Stats {
+            double latency{0};   // milliseconds
+            double deviation{0}; // mean deviation of the latency in milliseconds
+            double failures{0};  // failure rate [0,1]
+            uint32_t replies{0};
+        };
+        /**
+         * Records a reply that arrived after the specified time.
+         * @param node
+         * @param service
+         * @param ms
+         */
+        void addReply(const NodeAddr & node, const std::string & service, const int64_t ms) {
+            LOCK(mu);
+            auto & st = stats[std::make_pair(node, service)];
+            if (st.replies == 0) {
+                st.latency = static_cast<double>(ms);
+                st.deviation = st.latency / 2;
+            } else {
+                st.deviation += (std::abs(ms - st.latency) - st.deviation) / 4;
+                st.latency += (ms - st.latency) / 8;
+            }
+            st.failures -= st.failures / 8;
+            ++st.replies;
+        }
+        /**
+         * Records a query the node didn't reply to in time.
+         * @param node
+         * @param service
+         */
+        void addFailure(const NodeAddr & node, const std::string & service) {
+            LOCK(mu);
+            auto & st = stats[std::make_pair(node, service)];
+            st.failures += (1.0 - st.failures) / 8;
+        }
+        /**
+         * Returns false if there's no record of queries to the node.
+         * @param node
+         * @param service
+         * @param st
+         */
+        bool get(const NodeAddr & node, const std::string & service, Stats & st) {
+            LOCK(mu);
+            auto it = stats.find(std::make_pair(node, service));
+            if (it == stats.end())
+                return false;
+            st = it->second;
+            return true;
+        }
+        /**
+         * Expected time in milliseconds to get a reply, failures count as the timeout.
+         * Nodes without records cost nothing so that they are tried and measured.
+         * @param node
+         * @param service
+         * @param timeoutMs
+         */
+        double cost(const NodeAddr & node, const std::string & service, const int64_t timeoutMs) {
+            Stats st;
+            if (!get(node, service, st))
+                return 0;
+            return (1.0 - st.failures) * st.latency + st.failures * timeoutMs;
+        }
+        /**
+         * Milliseconds within which about 95% of the node's replies arrive, 0 if unknown.
+         * @param node
+         * @param service
+         */
+        int64_t deadline(const NodeAddr & node, const std::string & service) {
+            Stats st;
+            if (!get(node, service, st) || st.replies == 0)
+                return 0;
+            return static_cast<int64_t>(st.latency + 2 * st.deviation);
+        }
     private:
         Mutex mu;
-        std::map<std::string, std::map<NodeAddr, QueryCondition> > queriesLocks;
-        std::map<std::string, std::map<NodeAddr, QueryReply> > queries;
+        std::map<std::pair<NodeAddr, std::string>, Stats> stats;
     };
 
 private:
@@ -1090,8 +1610,9 @@ private:
     std::map<NodeAddr, int> snodeScore;
 
     std::map<std::string, std::set<NodeAddr> > configQueries;
-    std::map<NodeAddr, std::map<std::string, std::chrono::time_point<std::chrono::system_clock> > > lastPacketsSent;
+    XRouterRateLimiter rateLimiter{XROUTER_RATELIMIT_BUCKETS};
     std::map<NodeAddr, XRouterSettingsPtr> snodeConfigs;
+    std::map<CPubKey, std::pair<uint256, NodeAddr> > snodeConfigHashes; // config hash of the last processed ping
     std::map<std::string, NodeAddr> snodeDomains;
 
     boost::filesystem::path xrouterpath;
@@ -1112,7 +1633,27 @@ private:
     std::vector<unsigned char> cprivkey;
 
     QueryMgr queryMgr;
+    NodeStats nodeStats;
+    WarmServices warmServices;
     PendingConnectionMgr pendingConnMgr;
+    RequestQueue requests;
+
+    Mutex muConnected;
+    std::condition_variable connectedCond; // notified when a node completed the handshake
+
+    /**
+     * Async calls and their replies, replies are kept for XROUTER_ASYNC_REPLY_TTL seconds.
+     */
+    struct AsyncCall {
+        bool done{false};
+        std::string reply;
+        std::vector<AsyncReplyHandler> waiters;
+    };
+    Mutex muAsync;
+    std::map<std::string, AsyncCall> asyncCalls GUARDED_BY(muAsync);
+    xbridge::TimingWheel<std::string> asyncExpiry GUARDED_BY(muAsync); // completed calls by expiry
+    int asyncRunning GUARDED_BY(muAsync){0};
+    std::condition_variable asyncCond; // notified when an async call completed
 };
 
 } // namespace xrouter
@@ -0,0 +1,171 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <xrouter/xrouterconnectorbench.h>
+
+#include <hash.h>
+#include <util/time.h>
+
+#include <json/json_spirit.h>
+#include <json/json_spirit_writer_template.h>
+
+using namespace json_spirit;
+
+namespace xrouter
+{
+
+BenchWalletConnectorXRouter::BenchWalletConnectorXRouter(const int latencyMs, const int blockTxs)
+    : latencyMs(latencyMs), blockTxs(blockTxs)
+{
+    currency = "XRBENCH";
+    title = "XRouter benchmark";
+}
+
+std::string BenchWalletConnectorXRouter::fakeHash(const std::string & data)
+{
+    return Hash(data.begin(), data.end()).GetHex();
+}
+
+void BenchWalletConnectorXRouter::wait() const
+{
+    if (latencyMs > 0)
+        MilliSleep(latencyMs);
+}
+
+std::string BenchWalletConnectorXRouter::reply(const Value & result)
+{
+    Object o;
+    o.emplace_back("result", result);
+    o.emplace_back("error", Value());
+    o.emplace_back("id", 1);
+    return write_string(Value(o));
+}
+
+Object BenchWalletConnectorXRouter::block(const std::string & hash) const
+{
+    Array txs;
+    for (int i = 0; i < blockTxs; ++i)
+        txs.emplace_back(fakeHash(hash + std::to_string(i)));
+    Object o;
+    o.emplace_back("hash", hash);
+    o.emplace_back("confirmations", 1);
+    o.emplace_back("size", 250 * blockTxs);
+    o.emplace_back("height", chainHeight);
+    o.emplace_back("version", 536870912);
+    o.emplace_back("merkleroot", fakeHash(hash + "merkle"));
+    o.emplace_back("tx", txs);
+    o.emplace_back("time", 1560000000);
+    o.emplace_back("nonce", 0);
+    o.emplace_back("bits", "1a0fffff");
+    o.emplace_back("difficulty", 1048575.99998474);
+    o.emplace_back("chainwork", fakeHash(hash + "work"));
+    o.emplace_back("previousblockhash", fakeHash(hash + "prev"));
+    return o;
+}
+
+Object BenchWalletConnectorXRouter::transaction(const std::string & txid)
+{
+    const std::string script = "76a914" + fakeHash(txid).substr(0, 40) + "88ac";
+    Object vin;
+    vin.emplace_back("txid", fakeHash(txid + "in"));
+    vin.emplace_back("vout", 0);
+    vin.emplace_back("scriptSig", Object{Pair("asm", ""), Pair("hex", fakeHash(txid + "sig") + fakeHash(txid + "sig2"))});
+    vin.emplace_back("sequence", static_cast<int64_t>(0xffffffff));
+    Object vout;
+    vout.emplace_back("value", 1.5);
+    vout.emplace_back("n", 0);
+    vout.emplace_back("scriptPubKey", Object{Pair("hex", script), Pair("type", "pubkeyhash")});
+    Object o;
+    o.emplace_back("txid", txid);
+    o.emplace_back("hash", txid);
+    o.emplace_back("version", 1);
+    o.emplace_back("size", 225);
+    o.emplace_back("locktime", 0);
+    o.emplace_back("vin", Array{vin});
+    o.emplace_back("vout", Array{vout});
+    return o;
+}
+
+std::string BenchWalletConnectorXRouter::getBlockCount() const
+{
+    wait();
+    return reply(chainHeight);
+}
+
+std::string BenchWalletConnectorXRouter::getBlockHash(const int & block) const
+{
+    wait();
+    return reply(fakeHash(std::to_string(block)));
+}
+
+std::string BenchWalletConnectorXRouter::getBlock(const std::string & hash) const
+{
+    wait();
+    return reply(block(hash));
+}
+
+std::vector<std::string> BenchWalletConnectorXRouter::getBlocks(const std::vector<std::string> & blockHashes) const
+{
+    wait(); // one batched backend call
+    std::vector<std::string> result;
+    for (const auto & hash : blockHashes)
+        result.push_back(reply(block(hash)));
+    return result;
+}
+
+std::string BenchWalletConnectorXRouter::getTransaction(const std::string & hash) const
+{
+    wait();
+    return reply(transaction(hash));
+}
+
+std::vector<std::string> BenchWalletConnectorXRouter::getTransactions(const std::vector<std::string> & txHashes) const
+{
+    wait(); // one batched backend call
+    std::vector<std::string> result;
+    for (const auto & hash : txHashes)
+        result.push_back(reply(transaction(hash)));
+    return result;
+}
+
+std::vector<std::string> BenchWalletConnectorXRouter::getBlockHashes(const int & from, const int & to) const
+{
+    wait();
+    std::vector<std::string> hashes;
+    for (int i = from; i <= to; ++i)
+        hashes.push_back(fakeHash(std::to_string(i)));
+    return hashes;
+}
+
+std::vector<std::string> BenchWalletConnectorXRouter::getBlockRawTransactions(const std::string & blockHash) const
+{
+    wait();
+    return {};
+}
+
+std::string BenchWalletConnectorXRouter::sendTransaction(const std::string & transaction) const
+{
+    wait();
+    return reply(fakeHash(transaction));
+}
+
+std::string BenchWalletConnectorXRouter::decodeRawTransaction(const std::string & hex) const
+{
+    wait();
+    return reply(transaction(fakeHash(hex)));
+}
+
+std::string BenchWalletConnectorXRouter::convertTimeToBlockCount(const std::string & timestamp) const
+{
+    wait();
+    return reply(chainHeight);
+}
+
+std::string BenchWalletConnectorXRouter::getBalance(const std::string & address) const
+{
+    wait();
+    return reply(0);
+}
+
+} // namespace xrouter
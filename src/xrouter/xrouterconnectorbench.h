@@ -0,0 +1,66 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BLOCKNET_XROUTER_XROUTERCONNECTORBENCH_H
+#define BLOCKNET_XROUTER_XROUTERCONNECTORBENCH_H
+
+#include <xrouter/xrouterconnector.h>
+
+#include <json/json_spirit.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace xrouter
+{
+
+/**
+ * Fake backend used by the XRouter load test (XRouterServer::runPerformanceTests). Replies
+ * look like bitcoind json-rpc replies and are derived from the parameters, every call
+ * takes the configured backend response time.
+ */
+class BenchWalletConnectorXRouter : public WalletConnectorXRouter {
+public:
+    /**
+     * @param latencyMs Simulated backend response time in milliseconds
+     * @param blockTxs Number of transactions in each block
+     */
+    explicit BenchWalletConnectorXRouter(const int latencyMs, const int blockTxs = 64);
+
+    std::string              getBlockCount() const override;
+    std::string              getBlockHash(const int & block) const override;
+    std::string              getBlock(const std::string & hash) const override;
+    std::vector<std::string> getBlocks(const std::vector<std::string> & blockHashes) const override;
+    std::string              getTransaction(const std::string & hash) const override;
+    std::vector<std::string> getTransactions(const std::vector<std::string> & txHashes) const override;
+    std::vector<std::string> getBlockHashes(const int & from, const int & to) const override;
+    std::vector<std::string> getBlockRawTransactions(const std::string & blockHash) const override;
+    std::string              sendTransaction(const std::string & transaction) const override;
+    std::string              decodeRawTransaction(const std::string & hex) const override;
+    std::string              convertTimeToBlockCount(const std::string & timestamp) const override;
+    std::string              getBalance(const std::string & address) const override;
+
+    static const int chainHeight = 500000;
+
+    /**
+     * Deterministic hash of the data, used for block hashes and transaction ids.
+     * @param data
+     * @return
+     */
+    static std::string fakeHash(const std::string & data);
+
+private:
+    void wait() const;
+    static std::string reply(const json_spirit::Value & result);
+    json_spirit::Object block(const std::string & hash) const;
+    static json_spirit::Object transaction(const std::string & txid);
+
+    const int latencyMs;
+    const int blockTxs;
+};
+
+} // namespace xrouter
+
+#endif
@@ -6,8 +6,6 @@
 
 #include <xrouter/xroutererror.h>
 
-#include <bloom.h>
-
 #include <json/json_spirit.h>
 #include <json/json_spirit_reader_template.h>
 #include <json/json_spirit_writer_template.h>
@@ -97,15 +95,24 @@ std::vector<std::string> BtcWalletConnectorXRouter::getBlocks(const std::vector<
 {
     static const std::string commandGB("getblock");
 
-    std::set<std::string> unique{blockHashes.begin(), blockHashes.end()};
-    std::map<std::string, std::string> results;
-    std::vector<std::string> list;
+    // One batched backend request for the unique hashes
+    std::vector<std::string> unique;
+    std::map<std::string, size_t> index;
+    for (const auto & hash : blockHashes) {
+        if (index.emplace(hash, unique.size()).second)
+            unique.push_back(hash);
+    }
 
+    std::vector<Array> params;
+    params.reserve(unique.size());
     for (const auto & hash : unique)
-        results[hash] = getBlock(hash);
+        params.push_back({ hash });
+    const auto results = CallRPCBatch(m_user, m_passwd, m_ip, m_port, commandGB, params);
 
+    std::vector<std::string> list;
+    list.reserve(blockHashes.size());
     for (const auto & hash : blockHashes)
-        list.push_back(results[hash]);
+        list.push_back(results[index[hash]]);
 
     return list;
 }
@@ -133,15 +140,44 @@ std::vector<std::string> BtcWalletConnectorXRouter::getTransactions(const std::v
     static const std::string commandGRT("getrawtransaction");
     static const std::string commandDRT("decoderawtransaction");
 
-    std::set<std::string> unique{txHashes.begin(), txHashes.end()};
-    std::map<std::string, std::string> results;
-    std::vector<std::string> list;
+    std::vector<std::string> unique;
+    std::map<std::string, size_t> index;
+    for (const auto & hash : txHashes) {
+        if (index.emplace(hash, unique.size()).second)
+            unique.push_back(hash);
+    }
 
+    // One batch for the raw transactions and one to decode them, failed lookups
+    // keep their error reply
+    std::vector<Array> params;
+    params.reserve(unique.size());
     for (const auto & hash : unique)
-        results[hash] = getTransaction(hash);
+        params.push_back({ hash });
+    auto results = CallRPCBatch(m_user, m_passwd, m_ip, m_port, commandGRT, params);
+
+    params.clear();
+    std::vector<size_t> decoded;
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (hasError(results[i]))
+            continue;
+        const auto & rawTr_val = getResult(results[i]);
+        if (rawTr_val.type() != str_type) {
+            results[i].clear();
+            continue;
+        }
+        params.push_back({ rawTr_val.get_str() });
+        decoded.push_back(i);
+    }
+    if (!params.empty()) {
+        auto txs = CallRPCBatch(m_user, m_passwd, m_ip, m_port, commandDRT, params);
+        for (size_t i = 0; i < decoded.size(); ++i)
+            results[decoded[i]] = std::move(txs[i]);
+    }
 
+    std::vector<std::string> list;
+    list.reserve(txHashes.size());
     for (const auto & hash : txHashes)
-        list.push_back(results[hash]);
+        list.push_back(results[index[hash]]);
 
     return list;
 }
@@ -152,55 +188,63 @@ std::string BtcWalletConnectorXRouter::decodeRawTransaction(const std::string &
     return CallRPC(m_user, m_passwd, m_ip, m_port, commandDRT, { hex });
 }
 
-std::vector<std::string> BtcWalletConnectorXRouter::getTransactionsBloomFilter(const int & number, CDataStream & stream, const int & fetchlimit) const
+std::vector<std::string> BtcWalletConnectorXRouter::getBlockHashes(const int & from, const int & to) const
+{
+    static const std::string command("getblockhash");
+
+    std::vector<Array> params;
+    for (int i = from; i <= to; ++i)
+        params.push_back({ i });
+    const auto results = CallRPCBatch(m_user, m_passwd, m_ip, m_port, command, params);
+
+    std::vector<std::string> hashes;
+    hashes.reserve(results.size());
+    for (const auto & r : results) {
+        const auto & hash = getResult(r);
+        if (hasError(r) || hash.type() != str_type)
+            throw XRouterError("Failed to get the block hashes from " + std::to_string(from), xrouter::BAD_CONNECTOR);
+        hashes.push_back(hash.get_str());
+    }
+    return hashes;
+}
+
+std::vector<std::string> BtcWalletConnectorXRouter::getBlockRawTransactions(const std::string & blockHash) const
 {
-    static const std::string commandGBC("getblockcount");
-    static const std::string commandGBH("getblockhash");
     static const std::string commandGB("getblock");
     static const std::string commandGRT("getrawtransaction");
-    static const std::string commandDRT("decoderawtransaction");
 
-    CBloomFilter ft;
-    stream >> ft;
-    CBloomFilter filter(ft);
-    filter.UpdateEmptyFull();
+    // Verbosity 2 includes the raw transactions, older backends only list the txids
+    auto blockObj = CallRPC(m_user, m_passwd, m_ip, m_port, commandGB, { blockHash, 2 });
+    if (hasError(blockObj))
+        blockObj = CallRPC(m_user, m_passwd, m_ip, m_port, commandGB, { blockHash });
+    const auto & block = getResult(blockObj);
+    if (hasError(blockObj) || block.type() != obj_type)
+        throw XRouterError("Failed to get block " + blockHash, xrouter::BAD_CONNECTOR);
+    const auto & txs = find_value(block.get_obj(), "tx");
+    if (txs.type() != array_type)
+        throw XRouterError("Failed to get the transactions of block " + blockHash, xrouter::BAD_CONNECTOR);
 
-    std::vector<std::string> results;
-
-    const auto & blockCountObj = CallRPC(m_user, m_passwd, m_ip, m_port, commandGBC, Array());
-    int blockcount = getResult(blockCountObj).get_int();
-
-    if ((fetchlimit > 0) && (blockcount - number > fetchlimit)) {
-        throw XRouterError("Too many blocks requested", xrouter::INVALID_PARAMETERS);
-    }
-    
-    for (int id = number; id <= blockcount; id++)
-    {
-        const auto & blockHashObj = CallRPC(m_user, m_passwd, m_ip, m_port, commandGBH, { id });
-        const auto & hash = getResult(blockHashObj).get_str();
-        const auto & blockObj = CallRPC(m_user, m_passwd, m_ip, m_port, commandGB, { hash });
-        Object block = getResult(blockObj).get_obj();
-
-        Array txs = find_value(block, "tx").get_array();
-
-        for (const auto & j : txs) {
-            const auto & txid = Value(j).get_str();
-            const auto & rawTrObj = CallRPC(m_user, m_passwd, m_ip, m_port, commandGRT, { txid });
-            const auto & txData_str = getResult(rawTrObj).get_str();
-
-            std::vector<unsigned char> txData(ParseHex(txData_str));
-            CDataStream ssData(txData, SER_NETWORK, PROTOCOL_VERSION);
-            CMutableTransaction mtx;
-            ssData >> mtx;
-
-            const CTransaction ctx(mtx);
-            if (filter.IsRelevantAndUpdate(ctx)) {
-                results.push_back(txData_str);
-            }
+    std::vector<std::string> list;
+    std::vector<Array> params;
+    for (const auto & tx : txs.get_array()) {
+        if (tx.type() == obj_type) {
+            const auto & hex = find_value(tx.get_obj(), "hex");
+            if (hex.type() == str_type)
+                list.push_back(hex.get_str());
+        } else if (tx.type() == str_type) {
+            params.push_back({ tx.get_str() });
         }
     }
-    
-    return results;
+    if (params.empty())
+        return list;
+
+    for (const auto & r : CallRPCBatch(m_user, m_passwd, m_ip, m_port, commandGRT, params)) {
+        const auto & hex = getResult(r);
+        if (hasError(r) || hex.type() != str_type)
+            throw XRouterError("Failed to get the transactions of block " + blockHash, xrouter::BAD_CONNECTOR);
+        list.push_back(hex.get_str());
+    }
+    return list;
 }
 
 std::string BtcWalletConnectorXRouter::sendTransaction(const std::string & transaction) const
@@ -22,7 +22,8 @@ public:
     std::vector<std::string> getBlocks(const std::vector<std::string> & blockHashes) const override;
     std::string              getTransaction(const std::string & hash) const override;
     std::vector<std::string> getTransactions(const std::vector<std::string> & txHashes) const override;
-    std::vector<std::string> getTransactionsBloomFilter(const int & number, CDataStream & stream, const int & fetchlimit) const override;
+    std::vector<std::string> getBlockHashes(const int & from, const int & to) const override;
+    std::vector<std::string> getBlockRawTransactions(const std::string & blockHash) const override;
     std::string              sendTransaction(const std::string & transaction) const override;
     std::string              decodeRawTransaction(const std::string & hex) const override;
     std::string              convertTimeToBlockCount(const std::string & timestamp) const override;
@@ -4,6 +4,8 @@
 
 #include <xrouter/xrouterconnectoreth.h>
 
+#include <xrouter/xroutererror.h>
+
 #include <tinyformat.h>
 #include <uint256.h>
 
@@ -45,10 +47,46 @@ static int hex2dec(std::string s) {
     return result;
 }
 
+void EthWalletConnectorXRouter::setIpcPath(const std::string & path)
+{
+    if (path.empty())
+        ipc.reset();
+    else if (!ipc || ipc->getPath() != path)
+        ipc = std::make_shared<EthIpcClient>(path, jsonver);
+}
+
+std::string EthWalletConnectorXRouter::rpc(const std::string & command, const Array & params) const
+{
+    std::string reply;
+    if (ipc && ipc->call(command, params, reply))
+        return reply;
+    return CallRPC(m_ip, m_port, command, params, jsonver);
+}
+
+std::vector<std::string> EthWalletConnectorXRouter::rpcBatch(const std::string & command, const std::vector<Array> & params) const
+{
+    std::vector<std::string> replies;
+    if (ipc && ipc->callBatch(command, params, replies))
+        return replies;
+    return CallRPCBatch("", "", m_ip, m_port, command, params, jsonver);
+}
+
 std::string EthWalletConnectorXRouter::getBlockCount() const
 {
+    if (ipc) {
+        const auto blockNumber = ipc->blockNumber();
+        if (blockNumber >= 0) {
+            Object o;
+            if (!jsonver.empty())
+                o.emplace_back("jsonrpc", jsonver);
+            o.emplace_back("id", 1);
+            o.emplace_back("result", blockNumber);
+            return write_string(Value(o));
+        }
+    }
+
     static const std::string command("eth_blockNumber");
-    const auto & data = CallRPC(m_ip, m_port, command, Array(), jsonver);
+    const auto & data = rpc(command, Array());
 
     Value data_val; read_string(data, data_val);
     if (data_val.type() != obj_type)
@@ -76,27 +114,29 @@ std::string EthWalletConnectorXRouter::getBlockCount() const
 std::string EthWalletConnectorXRouter::getBlockHash(const int & block) const
 {
     static const std::string command("eth_getBlockByNumber");
-    return CallRPC(m_ip, m_port, command, { dec2hex(block), false }, jsonver);
+    return rpc(command, { dec2hex(block), false });
 }
 
 std::string EthWalletConnectorXRouter::getBlock(const std::string & blockHash) const
 {
     static const std::string command("eth_getBlockByHash");
-    return CallRPC(m_ip, m_port, command, { blockHash, true }, jsonver);
+    return rpc(command, { blockHash, true });
 }
 
 std::vector<std::string> EthWalletConnectorXRouter::getBlocks(const std::vector<std::string> & blockHashes) const
 {
-    std::vector<std::string> results;
+    static const std::string command("eth_getBlockByHash");
+    std::vector<Array> params;
+    params.reserve(blockHashes.size());
     for (const auto & hash : blockHashes)
-        results.push_back(getBlock(hash));
-    return results;
+        params.push_back({ hash, true });
+    return rpcBatch(command, params);
 }
 
 std::string EthWalletConnectorXRouter::getTransaction(const std::string & trHash) const
 {
     static const std::string command("eth_getTransactionByHash");
-    return CallRPC(m_ip, m_port, command, { trHash }, jsonver);
+    return rpc(command, { trHash });
 }
 
 std::string EthWalletConnectorXRouter::decodeRawTransaction(const std::string & trHash) const
@@ -107,22 +147,28 @@ std::string EthWalletConnectorXRouter::decodeRawTransaction(const std::string &
 
 std::vector<std::string> EthWalletConnectorXRouter::getTransactions(const std::vector<std::string> & txHashes) const
 {
-    std::vector<std::string> results;
+    static const std::string command("eth_getTransactionByHash");
+    std::vector<Array> params;
+    params.reserve(txHashes.size());
     for (const auto & hash : txHashes)
-        results.push_back(getTransaction(hash));
-    return results;
+        params.push_back({ hash });
+    return rpcBatch(command, params);
 }
 
-std::vector<std::string> EthWalletConnectorXRouter::getTransactionsBloomFilter(const int &, CDataStream &, const int &) const
+std::vector<std::string> EthWalletConnectorXRouter::getBlockHashes(const int &, const int &) const
 {
-    Object unsupported; unsupported.emplace_back("error", "Unsupported");
-    return std::vector<std::string>{write_string(Value(unsupported), pretty_print)};
+    throw XRouterError("Unsupported", xrouter::UNSUPPORTED_SERVICE);
+}
+
+std::vector<std::string> EthWalletConnectorXRouter::getBlockRawTransactions(const std::string &) const
+{
+    throw XRouterError("Unsupported", xrouter::UNSUPPORTED_SERVICE);
 }
 
 std::string EthWalletConnectorXRouter::sendTransaction(const std::string & rawtx) const
 {
     static const std::string command("eth_sendRawTransaction");
-    return CallRPC(m_ip, m_port, command, { rawtx }, jsonver);
+    return rpc(command, { rawtx });
 }
 
 std::string EthWalletConnectorXRouter::convertTimeToBlockCount(const std::string & timestamp) const
@@ -6,10 +6,12 @@
 #define BLOCKNET_XROUTER_XROUTERCONNECTORETH_H
 
 #include <xrouter/xrouterconnector.h>
+#include <xrouter/xrouterethipc.h>
 
 #include <streams.h>
 
 #include <cstdint>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -25,11 +27,26 @@ public:
     std::vector<std::string> getBlocks(const std::vector<std::string> & blockHashes) const override;
     std::string              getTransaction(const std::string & hash) const override;
     std::vector<std::string> getTransactions(const std::vector<std::string> & txHashes) const override;
-    std::vector<std::string> getTransactionsBloomFilter(const int &, CDataStream &, const int & fetchlimit=0) const override;
+    std::vector<std::string> getBlockHashes(const int & from, const int & to) const override;
+    std::vector<std::string> getBlockRawTransactions(const std::string & blockHash) const override;
     std::string              sendTransaction(const std::string & rawtx) const override;
     std::string              decodeRawTransaction(const std::string & hex) const override;
     std::string              convertTimeToBlockCount(const std::string & timestamp) const override;
     std::string              getBalance(const std::string & address) const override;
+
+    /**
+     * Sends the calls over the node's ipc socket (geth.ipc) while it's connected, over
+     * http otherwise. The block count is answered from the socket's newHeads subscription.
+     * @param path empty for http only
+     */
+    void setIpcPath(const std::string & path);
+
+private:
+    std::string              rpc(const std::string & command, const json_spirit::Array & params) const;
+    std::vector<std::string> rpcBatch(const std::string & command, const std::vector<json_spirit::Array> & params) const;
+
+private:
+    std::shared_ptr<EthIpcClient> ipc;
 };
 
 } // namespace xrouter
@@ -14,6 +14,40 @@
 #define XROUTER_CONFIGSYNC_TIMEOUT 3 // seconds
 #define XROUTER_DEFAULT_FETCHLIMIT 50
 #define XROUTER_DEFAULT_CONFIRMATIONS 1
+#define XROUTER_DEFAULT_CONNECTORCONCURRENCY 4 // concurrent backend calls, bitcoind serves 4 rpc threads by default
 #define XROUTER_TIMER_SECONDS 15
+#define XROUTER_REQUEST_THREADS 8        // threads processing received packets
+#define XROUTER_MAX_NODE_REQUESTS 32     // queued packets per node
+#define XROUTER_MAX_REQUESTS 1024        // queued packets of all nodes
+#define XROUTER_QUERY_SHARDS 16          // query tables, queries with different ids rarely share a lock
+#define XROUTER_RESULTCACHE_SIZE (32 * 1024 * 1024) // bytes of cached backend replies
+#define XROUTER_RESULTCACHE_TTL 60       // seconds, block and tx replies (include the confirmations)
+#define XROUTER_RESULTCACHE_MAX_TTL 600  // seconds, replies that only depend on the parameters
+#define XROUTER_TIP_POLL 1000            // milliseconds between polls of a backend's chain tip
+#define XROUTER_TIP_MAX_AGE 5000         // milliseconds a polled tip is used without a newer poll
+#define XROUTER_TIP_HASHES 100           // recent block hashes per currency answered from memory
+#define XROUTER_FILTERCACHE_SIZE (32 * 1024 * 1024) // bytes of compact filters of backend blocks
+#define XROUTER_FILTERCACHE_TTL 86400    // seconds, the filter of a block hash doesn't change
+#define XROUTER_FILTER_BATCH 1000        // blocks matched per batch of filters
+#define XROUTER_FILTER_MAX_ADDRESSES 1000 // addresses per xrGetTxBloomFilter request
+#define XROUTER_HTTP_POOL_SIZE 8         // idle keep-alive connections per backend or service node
+#define XROUTER_HTTP_POOL_IDLE 60        // seconds an idle connection is kept open
+#define XROUTER_RPC_BATCH_SIZE 100       // backend calls per json-rpc batch request
+#define XROUTER_CONNECT_EXTRA 2          // connection attempts in flight beyond the connections needed
+#define XROUTER_WARMPOOL_SERVICES 8      // most used services kept connected
+#define XROUTER_WARMPOOL_IDLE 600        // seconds a service stays in the warm pool after its last use
+#define XROUTER_RATELIMIT_BUCKETS 65536  // rate limited (node, service) pairs tracked at once
+#define XROUTER_CONFIG_REQUEST_LIMIT 10000 // milliseconds between config requests a client may send
+#define XROUTER_CONFIG_UPDATE_LIMIT 600000 // milliseconds between config requests to a service node
+#define XROUTER_PAYMENTCACHE_TTL 3600    // seconds an accepted fee payment can't be used again
+#define XROUTER_CHANNEL_LOCKTIME 1440    // blocks until the client can refund an unsettled payment channel
+#define XROUTER_CHANNEL_SETTLE_BLOCKS 60 // blocks before the refund a service node settles a payment channel
+#define XROUTER_CHANNEL_SETTLE_INTERVAL 3600 // seconds a service node keeps a payment channel open
+#define XROUTER_CHANNEL_TXFEE 10000      // satoshis, network fee of the payment channel spends
+#define XROUTER_ASYNC_MAX_CALLS 1024     // async calls in flight
+#define XROUTER_ASYNC_REPLY_TTL 600      // seconds the reply of an async call is kept
+#define XROUTER_PLUGIN_WORKERS 2         // processes of a "worker" plugin
+#define XROUTER_PLUGIN_MAX_WORKERS 32
+#define XROUTER_ETH_IPC_TIMEOUT 30       // seconds, calls over an Ethereum node's ipc socket
 
 #endif // BLOCKNET_XROUTER_XROUTERDEF_H
@@ -0,0 +1,342 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <xrouter/xrouterethipc.h>
+
+#include <xrouter/xrouterdef.h>
+#include <xrouter/xrouterlogger.h>
+
+#include <util/system.h>
+
+#include <json/json_spirit_reader_template.h>
+#include <json/json_spirit_writer_template.h>
+
+#include <chrono>
+
+#ifndef WIN32
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace json_spirit;
+
+namespace xrouter
+{
+
+//! Seconds between attempts to reopen the ipc socket
+static const int ETH_IPC_RETRY = 5;
+
+//! Ids of the client's own requests, their replies are handled by the reader thread
+static const uint64_t ETH_IPC_SUBSCRIBE_ID = 0;
+static const uint64_t ETH_IPC_BLOCKNUMBER_ID = 1;
+
+static int64_t parseQuantity(const Value & v)
+{
+    if (v.type() != str_type)
+        return -1;
+    try {
+        return std::stoll(v.get_str(), nullptr, 16);
+    } catch (...) {
+        return -1;
+    }
+}
+
+EthIpcClient::EthIpcClient(std::string path, std::string jsonver)
+    : path(std::move(path)), jsonver(std::move(jsonver))
+{
+    reader = std::thread(&EthIpcClient::run, this);
+}
+
+EthIpcClient::~EthIpcClient()
+{
+    stopping = true;
+    {
+        LOCK(mu);
+#ifndef WIN32
+        if (fd != -1)
+            shutdown(fd, SHUT_RDWR); // wakes the reader, which closes the socket
+#endif
+    }
+    cond.notify_all();
+    if (reader.joinable())
+        reader.join();
+}
+
+bool EthIpcClient::call(const std::string & method, const Array & params, std::string & reply)
+{
+    std::vector<std::string> r;
+    if (!callBatch(method, std::vector<Array>{params}, r))
+        return false;
+    reply = r.front();
+    return true;
+}
+
+bool EthIpcClient::callBatch(const std::string & method, const std::vector<Array> & params,
+                             std::vector<std::string> & result)
+{
+    std::vector<uint64_t> ids;
+    ids.reserve(params.size());
+    bool sent{true};
+    for (const auto & p : params) {
+        uint64_t id;
+        {
+            LOCK(mu);
+            if (fd == -1) {
+                sent = false;
+                break;
+            }
+            id = nextId++;
+            pending[id] = connection;
+        }
+        ids.push_back(id);
+        if (!send(method, p, id)) {
+            sent = false;
+            break;
+        }
+    }
+    if (!sent) {
+        LOCK(mu);
+        for (const auto & id : ids) {
+            pending.erase(id);
+            replies.erase(id);
+        }
+        return false;
+    }
+    return wait(ids, result);
+}
+
+bool EthIpcClient::send(const std::string & method, const Array & params, const uint64_t id)
+{
+#ifdef WIN32
+    return false;
+#else
+    Object req;
+    if (!jsonver.empty())
+        req.emplace_back("jsonrpc", jsonver);
+    req.emplace_back("method", method);
+    req.emplace_back("params", params);
+    req.emplace_back("id", static_cast<int64_t>(id));
+    const std::string data = write_string(Value(req), false) + "\n";
+
+    // The socket is only closed while holding writeMu, see disconnect()
+    LOCK(writeMu);
+    int s;
+    {
+        LOCK(mu);
+        s = fd;
+    }
+    if (s == -1)
+        return false;
+    size_t written{0};
+    while (written < data.size()) {
+        const ssize_t n = ::send(s, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            shutdown(s, SHUT_RDWR); // the reader reconnects
+            return false;
+        }
+        written += n;
+    }
+    return true;
+#endif
+}
+
+bool EthIpcClient::wait(const std::vector<uint64_t> & ids, std::vector<std::string> & result)
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(XROUTER_ETH_IPC_TIMEOUT);
+    WAIT_LOCK(mu, lock);
+    bool ok{true};
+    for (const auto & id : ids) {
+        while (ok && !replies.count(id)) {
+            if (pending.count(id) && pending[id] != connection)
+                ok = false; // the connection was lost
+            else if (cond.wait_until(lock, deadline) == std::cv_status::timeout && !replies.count(id))
+                ok = false;
+        }
+    }
+    if (ok) {
+        result.clear();
+        result.reserve(ids.size());
+        for (const auto & id : ids)
+            result.push_back(std::move(replies[id]));
+    }
+    for (const auto & id : ids) {
+        pending.erase(id);
+        replies.erase(id);
+    }
+    return ok;
+}
+
+void EthIpcClient::run()
+{
+    RenameThread("blocknet-xrethipc");
+#ifdef WIN32
+    LOG() << "Ethereum ipc sockets are not supported on Windows, using http for " << path;
+#else
+    bool wasConnected{true}; // logs the first failure
+    while (!stopping) {
+        if (!connect()) {
+            if (wasConnected)
+                ERR() << "Failed to connect to the Ethereum ipc socket " << path << ", using http";
+            wasConnected = false;
+            WAIT_LOCK(mu, lock);
+            cond.wait_for(lock, std::chrono::seconds(ETH_IPC_RETRY), [this]() -> bool { return stopping; });
+            continue;
+        }
+        wasConnected = true;
+        LOG() << "Connected to the Ethereum ipc socket " << path;
+
+        send("eth_subscribe", Array{Value("newHeads")}, ETH_IPC_SUBSCRIBE_ID);
+        send("eth_blockNumber", Array(), ETH_IPC_BLOCKNUMBER_ID);
+
+        int s;
+        {
+            LOCK(mu);
+            s = fd;
+        }
+        // Splits the stream into json values, the nodes don't reliably end them with a newline
+        std::string buffer;
+        size_t start{0}, pos{0};
+        int depth{0};
+        bool inString{false}, escaped{false};
+        char buf[65536];
+        while (!stopping) {
+            const ssize_t n = read(s, buf, sizeof(buf));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                break;
+            buffer.append(buf, n);
+            for (; pos < buffer.size(); ++pos) {
+                const char c = buffer[pos];
+                if (inString) {
+                    if (escaped)
+                        escaped = false;
+                    else if (c == '\\')
+                        escaped = true;
+                    else if (c == '"')
+                        inString = false;
+                } else if (c == '"') {
+                    inString = true;
+                } else if (c == '{' || c == '[') {
+                    if (depth++ == 0)
+                        start = pos;
+                } else if ((c == '}' || c == ']') && depth > 0 && --depth == 0) {
+                    process(buffer.substr(start, pos - start + 1));
+                    start = pos + 1;
+                }
+            }
+            if (depth == 0) {
+                buffer.clear();
+                start = pos = 0;
+            } else if (start > 0) {
+                buffer.erase(0, start);
+                pos -= start;
+                start = 0;
+            }
+        }
+
+        disconnect();
+        if (!stopping)
+            ERR() << "Lost the connection to the Ethereum ipc socket " << path << ", using http";
+    }
+#endif
+}
+
+bool EthIpcClient::connect()
+{
+#ifdef WIN32
+    return false;
+#else
+    struct sockaddr_un addr{};
+    if (path.size() >= sizeof(addr.sun_path))
+        return false;
+    addr.sun_family = AF_UNIX;
+    path.copy(addr.sun_path, path.size());
+
+    const int s = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (s == -1)
+        return false;
+    if (::connect(s, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+        close(s);
+        return false;
+    }
+    // A node that stops reading must not block the callers forever
+    struct timeval tv{XROUTER_ETH_IPC_TIMEOUT, 0};
+    setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    LOCK(mu);
+    if (stopping) {
+        close(s);
+        return false;
+    }
+    fd = s;
+    return true;
+#endif
+}
+
+void EthIpcClient::disconnect()
+{
+#ifndef WIN32
+    LOCK2(writeMu, mu);
+    if (fd != -1)
+        close(fd);
+    fd = -1;
+    ++connection; // fails the calls waiting on this connection
+    head = -1;
+    cond.notify_all();
+#endif
+}
+
+void EthIpcClient::process(const std::string & msg)
+{
+    Value val;
+    if (!read_string(msg, val) || val.type() != obj_type)
+        return;
+    const auto & obj = val.get_obj();
+
+    // newHeads notification
+    const auto & method = find_value(obj, "method");
+    if (method.type() == str_type) {
+        if (method.get_str() != "eth_subscription")
+            return;
+        const auto & params = find_value(obj, "params");
+        if (params.type() != obj_type)
+            return;
+        const auto & block = find_value(params.get_obj(), "result");
+        if (block.type() != obj_type)
+            return;
+        const auto number = parseQuantity(find_value(block.get_obj(), "number"));
+        if (number >= 0)
+            head = number;
+        return;
+    }
+
+    const auto & idVal = find_value(obj, "id");
+    if (idVal.type() != int_type || idVal.get_int64() < 0)
+        return;
+    const auto id = static_cast<uint64_t>(idVal.get_int64());
+    if (id == ETH_IPC_SUBSCRIBE_ID) {
+        if (find_value(obj, "error").type() == obj_type)
+            ERR() << "Ethereum node " << path << " refused the newHeads subscription: " << msg;
+        return;
+    }
+    if (id == ETH_IPC_BLOCKNUMBER_ID) {
+        const auto number = parseQuantity(find_value(obj, "result"));
+        if (number >= 0 && head < 0)
+            head = number;
+        return;
+    }
+
+    LOCK(mu);
+    if (!pending.count(id))
+        return; // the caller gave up
+    replies[id] = msg;
+    cond.notify_all();
+}
+
+} // namespace xrouter
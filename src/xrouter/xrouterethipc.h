@@ -0,0 +1,93 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BLOCKNET_XROUTER_XROUTERETHIPC_H
+#define BLOCKNET_XROUTER_XROUTERETHIPC_H
+
+#include <sync.h>
+
+#include <json/json_spirit.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace xrouter
+{
+
+/**
+ * Persistent json-rpc connection to the ipc socket of geth or parity. Requests from any
+ * thread share the connection, replies are matched to the callers by request id. The
+ * client subscribes to newHeads so the chain height is known without a request. A lost
+ * connection is reopened by the reader thread, calls made while it's down fail and the
+ * connector falls back to http.
+ */
+class EthIpcClient
+{
+public:
+    EthIpcClient(std::string path, std::string jsonver);
+    ~EthIpcClient();
+
+    /**
+     * Sends the request and waits for the reply. Returns false if not connected or
+     * there was no reply within XROUTER_ETH_IPC_TIMEOUT.
+     * @param method
+     * @param params
+     * @param reply the json-rpc reply object
+     * @return
+     */
+    bool call(const std::string & method, const json_spirit::Array & params, std::string & reply);
+
+    /**
+     * Sends all requests at once and waits for all replies. Returns false if any of
+     * the requests failed.
+     * @param method
+     * @param params parameters of each request
+     * @param replies in the order of params
+     * @return
+     */
+    bool callBatch(const std::string & method, const std::vector<json_spirit::Array> & params,
+                   std::vector<std::string> & replies);
+
+    /**
+     * Number of the last block announced by the node, -1 if unknown.
+     * @return
+     */
+    int64_t blockNumber() const { return head; }
+
+    const std::string & getPath() const { return path; }
+
+private:
+    void run();
+    bool connect();
+    void disconnect();
+    bool send(const std::string & method, const json_spirit::Array & params, const uint64_t id);
+    bool wait(const std::vector<uint64_t> & ids, std::vector<std::string> & replies);
+    void process(const std::string & msg);
+
+private:
+    const std::string path;
+    const std::string jsonver;
+
+    Mutex mu;
+    std::condition_variable cond;
+    int fd GUARDED_BY(mu){-1};
+    uint64_t connection GUARDED_BY(mu){0}; // changes on every reconnect
+    uint64_t nextId GUARDED_BY(mu){2}; // 0 and 1 are the client's own requests
+    std::map<uint64_t, uint64_t> pending GUARDED_BY(mu); // request id -> connection
+    std::map<uint64_t, std::string> replies GUARDED_BY(mu);
+    Mutex writeMu;
+
+    std::atomic<int64_t> head{-1};
+    std::atomic<bool> stopping{false};
+    std::thread reader;
+};
+
+} // namespace xrouter
+
+#endif // BLOCKNET_XROUTER_XROUTERETHIPC_H
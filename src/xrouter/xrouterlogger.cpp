@@ -4,6 +4,8 @@
 
 #include <xrouter/xrouterlogger.h>
 
+#include <xbridge/util/logwriter.h>
+
 #include <util/system.h>
 
 #include <sstream>
@@ -32,17 +34,12 @@ LOG::LOG(const char reason, std::string filename)
                     boost::pool_allocator<char> >()
     , m_r(reason), filenameOverride("")
 {
-    // 'D' is turned on when debug=1 in blocknet.conf
-    if (reason == 'D')
-        if (!gArgs.GetBoolArg("-debug", false))
-            return;
-
     if (!filename.empty())
         filenameOverride = filename;
         
     *this << "\n" << "[" << (char)std::toupper(m_r) << "] "
-          << boost::posix_time::second_clock::local_time()
-          << " [0x" << boost::this_thread::get_id() << "] ";
+          << LogWriter::timestamp()
+          << " [0x" << LogWriter::threadId() << "] ";
 }
 
 //******************************************************************************
@@ -56,33 +53,34 @@ std::string LOG::logFileName() {
 //******************************************************************************
 LOG::~LOG()
 {
-    boost::lock_guard<boost::mutex> lock(logLocker);
-
-    static boost::gregorian::date day = boost::gregorian::day_clock::local_day();
-    if (m_logFileName.empty())
-        m_logFileName = makeFileName();
-
+    std::string fileName;
     try
     {
+        boost::lock_guard<boost::mutex> lock(logLocker);
+
+        static boost::gregorian::date day = boost::gregorian::day_clock::local_day();
+        if (m_logFileName.empty())
+            m_logFileName = makeFileName();
+
         if (!filenameOverride.empty()) {
             boost::filesystem::path directory = GetDataDir(false) / "log";
             boost::filesystem::create_directory(directory);
-
-            std::ofstream file(directory.string() + "/" + filenameOverride, std::ios_base::app);
-            file << str().c_str();
-            return;
-        }
-
-        boost::gregorian::date tmpday = boost::gregorian::day_clock::local_day();
-        if (day != tmpday) {
-            m_logFileName = makeFileName();
-            day = tmpday;
+            fileName = directory.string() + "/" + filenameOverride;
+        } else {
+            boost::gregorian::date tmpday = boost::gregorian::day_clock::local_day();
+            if (day != tmpday) {
+                m_logFileName = makeFileName();
+                day = tmpday;
+            }
+            fileName = m_logFileName;
         }
-
-        std::ofstream file(m_logFileName.c_str(), std::ios_base::app);
-        file << str().c_str();
     }
-    catch (...) { }
+    catch (...) {
+        return;
+    }
+
+    const auto & text = str();
+    LogWriter::instance().write(fileName, std::string(text.data(), text.size()), m_r == 'E');
 }
 
 //******************************************************************************
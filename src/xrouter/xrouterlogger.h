@@ -5,15 +5,25 @@
 #ifndef BLOCKNET_XROUTER_XROUTERLOGGER_H
 #define BLOCKNET_XROUTER_XROUTERLOGGER_H
 
+#include <logging.h>
+
 #include <sstream>
 
 #include <boost/pool/pool_alloc.hpp>
 
 #define WARN()  LOG('W')
 #define ERR()   LOG('E')
-#define TRACE() LOG('T')
 #define TESTLOG() LOG('I',"test_xrouter.log")
-#define DEBUGLOG() LOG('D')
+
+// Trace and debug messages are logged with -debug=xrouter (or debug=1), and compiled out
+// with XROUTER_NO_DEBUG_LOG. Disabled messages aren't formatted.
+#ifdef XROUTER_NO_DEBUG_LOG
+#define TRACE() if (true) {} else LOG('T')
+#define DEBUGLOG() if (true) {} else LOG('D')
+#else
+#define TRACE() if (!LogAcceptCategory(BCLog::XROUTER)) {} else LOG('T')
+#define DEBUGLOG() if (!LogAcceptCategory(BCLog::XROUTER)) {} else LOG('D')
+#endif
 
 #define LOG_KEYPAIR_VALUES
 
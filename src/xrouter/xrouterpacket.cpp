@@ -161,17 +161,17 @@ bool XRouterPacket::verify(const std::vector<unsigned char> & pubkey)
     return verify();
 }
 
-bool XRouterPacket::copyFrom(const std::vector<unsigned char> & data)
+bool XRouterPacket::copyFrom(const unsigned char * data, const size_t size)
 {
-    if (data.size() < headerSize)
+    if (size < headerSize)
     {
         ERR() << "received data size less than packet header size " << __FUNCTION__;
         return false;
     }
 
-    m_body = data;
+    m_body.assign(data, data + size);
 
-    if (sizeField() != static_cast<uint32_t>(data.size())-headerSize)
+    if (sizeField() != static_cast<uint32_t>(size)-headerSize)
     {
         ERR() << "incorrect data size " << __FUNCTION__;
         return false;
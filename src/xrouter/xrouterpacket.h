@@ -139,13 +139,13 @@ inline std::set<XRouterCommand> XRouterCommands()
     r.insert(xrGetBlock);
     r.insert(xrGetTransaction);
     r.insert(xrSendTransaction);
-//    r.insert(xrGetTxBloomFilter);
+    r.insert(xrGetTxBloomFilter);
 //    r.insert(xrGenerateBloomFilter);
     r.insert(xrGetBlocks);
     r.insert(xrGetTransactions);
 //    r.insert(xrGetBlockAtTime);
     r.insert(xrDecodeRawTransaction);
-//    r.insert(xrGetBalance);
+    r.insert(xrGetBalance);
     return r;
 };
 
@@ -159,7 +159,7 @@ inline std::set<XRouterCommand> XRouterCommands()
 // uint32_t command
 // uint32_t timestamp
 // uint32_t size
-// uint32_t reserved
+// uint32_t flags (XROUTER_FLAG_*)
 // uint32_t reserved
 // unsigned char * uuid
 // unsigned char * pubkey
@@ -215,6 +215,8 @@ public:
     uint32_t     allSize() const     { return static_cast<uint32_t>(m_body.size()); }
 
     uint32_t version() const                         { return versionField(); }
+    uint32_t flags() const                           { return flagsField(); }
+    void setFlags(const uint32_t flags)              { flagsField() = flags; }
     XRouterCommand command() const                   { return static_cast<XRouterCommand>(commandField()); }
     const unsigned char * uuid() const               { return uuidField(); }
     const unsigned char * pubkey() const             { return pubkeyField(); }
@@ -338,7 +340,7 @@ public:
         return *this;
     }
 
-    bool copyFrom(const std::vector<unsigned char> & data);
+    bool copyFrom(const unsigned char * data, const size_t size);
     bool sign(const std::vector<unsigned char> & pubkey,
               const std::vector<unsigned char> & privkey);
     bool verify();
@@ -361,6 +363,8 @@ private:
     uint32_t const & timestampField() const      { return field32<2>(); }
     uint32_t &       sizeField()                 { return field32<3>(); }
     uint32_t const & sizeField() const           { return field32<3>(); }
+    uint32_t &       flagsField()                { return field32<4>(); }
+    uint32_t const & flagsField() const          { return field32<4>(); }
 
     unsigned char *       uuidField()            { return &m_body[versionSize + commandSize + timestampSize + packetSize + reservedSize]; }
     const unsigned char * uuidField() const      { return &m_body[versionSize + commandSize + timestampSize + packetSize + reservedSize]; }
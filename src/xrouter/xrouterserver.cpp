@@ -4,9 +4,19 @@
 
 #include <xrouter/xrouterserver.h>
 
+#include <chainparams.h>
+#include <core_io.h>
+#include <index/addressindex.h>
+#include <index/blockfilterindex.h>
+#include <key_io.h>
+#include <script/standard.h>
 #include <servicenode/servicenodemgr.h>
+#include <undo.h>
+#include <util/moneystr.h>
+#include <validation.h>
 #include <xbridge/util/settings.h>
 #include <xrouter/xrouterapp.h>
+#include <xrouter/xrouterconnectorbench.h>
 #include <xrouter/xroutererror.h>
 #include <xrouter/xrouterlogger.h>
 #include <xrouter/xrouterutils.h>
@@ -15,6 +25,8 @@
 #include <iostream>
 #include <chrono>
 #include <future>
+#include <limits>
+#include <thread>
 
 #include <json/json_spirit_reader_template.h>
 #include <json/json_spirit_writer_template.h>
@@ -37,17 +49,42 @@ bool XRouterServer::start()
 
     createConnectors();
 
+    if (!tipThread.joinable()) {
+        tipInterrupt.reset();
+        tipThread = std::thread(&XRouterServer::trackTips, this);
+    }
+    if (!settleThread.joinable()) {
+        settleInterrupt.reset();
+        settleThread = std::thread(&XRouterServer::settleChannels, this);
+    }
+
     LOCK(_lock);
     started = true;
 
     return true;
 }
 
+XRouterServer::~XRouterServer()
+{
+    stop();
+}
+
 bool XRouterServer::stop()
 {
+    tipInterrupt();
+    if (tipThread.joinable())
+        tipThread.join();
+    tipTracker.clear();
+    settleInterrupt();
+    if (settleThread.joinable())
+        settleThread.join();
+
     LOCK(_lock);
     connectors.clear();
-    connectorLocks.clear();
+    connectorSlots.clear();
+    pluginWorkers.clear(); // workers are stopped once their pool's calls return
+    resultCache.clear();
+    filterCache.clear();
     return true;
 }
 
@@ -90,8 +127,10 @@ bool XRouterServer::createConnectors() {
             xrouter::WalletConnectorXRouterPtr conn;
             if ((wp.method == "ETH") || (wp.method == "ETHER"))
             {
-                conn.reset(new EthWalletConnectorXRouter);
+                auto eth = std::make_shared<EthWalletConnectorXRouter>();
+                conn = eth;
                 *conn = wp;
+                eth->setIpcPath(s.get<std::string>(*i + ".IpcPath", ""));
             }
             else if ((wp.method == "BTC") || (wp.method == "BLOCK"))
             {
@@ -122,7 +161,8 @@ void XRouterServer::addConnector(const WalletConnectorXRouterPtr & conn)
 {
     LOCK(_lock);
     connectors[conn->currency] = conn;
-    connectorLocks[conn->currency] = std::make_shared<boost::mutex>();
+    const int concurrency = std::max(App::instance().xrSettings()->connectorConcurrency(conn->currency), 1);
+    connectorSlots[conn->currency] = std::make_shared<CSemaphore>(concurrency);
 }
 
 WalletConnectorXRouterPtr XRouterServer::connectorByCurrency(const std::string & currency) const
@@ -135,28 +175,57 @@ WalletConnectorXRouterPtr XRouterServer::connectorByCurrency(const std::string &
     return WalletConnectorXRouterPtr();
 }
 
-void XRouterServer::sendPacketToClient(const std::string & uuid, const std::string & reply, CNode* pnode)
+void XRouterServer::sendPacketToClient(const std::string & uuid, const std::string & reply, CNode* pnode,
+                                       const uint32_t flags)
 {
     LOG() << "Sending reply to client for query " << uuid;
+    const XRouterPacket rpacket = replyPacket(uuid, reply, flags);
+    xrouter::PushXRouterMessage(pnode, rpacket.body());
+}
+
+XRouterPacket XRouterServer::replyPacket(const std::string & uuid, const std::string & reply, const uint32_t flags)
+{
     XRouterPacket rpacket(xrReply, uuid);
-    rpacket.append(reply);
+    std::vector<unsigned char> encoded;
+    if ((flags & XROUTER_FLAG_BINARY_REPLY) && EncodeBinaryReply(reply, encoded)) {
+        rpacket.setFlags(XROUTER_FLAG_BINARY_REPLY);
+        rpacket.append(encoded);
+    } else
+        rpacket.append(reply);
     rpacket.sign(spubkey, sprivkey);
-    xrouter::PushXRouterMessage(pnode, rpacket.body());
+    return rpacket;
 }
 
-bool XRouterServer::processPayment(const std::string & feetx)
+bool XRouterServer::processPayment(const CTransactionRef & payment)
 {
-    std::string txid;
-    bool res = sendTransactionBlockchain(feetx, txid);
-    if (!res) {
-        ERR() << "Failed to spend client fee:\n" + feetx;
+    // Channel updates are settled later
+    CScript redeemScript;
+    CPubKey clientKey, snodeKey;
+    uint32_t lockTime;
+    if (decodePaymentChannelUpdate(CMutableTransaction(*payment), redeemScript)
+            && decodePaymentChannelScript(redeemScript, clientKey, snodeKey, lockTime)) {
+        if (!paymentChannels.update(lockTime, payment)) {
+            ERR() << "Client sent an old payment channel update: " << payment->vin[0].prevout.hash.ToString();
+            return false;
+        }
+        return true;
+    }
+
+    const auto & txid = payment->GetHash();
+    if (!paymentCache.add(txid)) {
+        ERR() << "Client fee was already spent: " << txid.ToString();
+        return false;
+    }
+    if (!paymentQueue.submit(payment)) {
+        paymentCache.remove(txid);
+        ERR() << "Failed to spend client fee: " << txid.ToString();
         return false;
     }
     return true;
 }
 
 bool XRouterServer::checkFeePayment(const NodeAddr & nodeAddr, const std::string & paymentAddress,
-        const std::string & feetx, const CAmount & requiredFee)
+        const std::string & feetx, const CAmount & requiredFee, CTransactionRef & payment)
 {
     if (feetx.empty()) {
         ERR() << "Client sent a bad feetx: " << nodeAddr;
@@ -166,15 +235,186 @@ bool XRouterServer::checkFeePayment(const NodeAddr & nodeAddr, const std::string
     if (paymentAddress.empty()) // check payment address
         return false;
 
-    checkPayment(feetx, paymentAddress, requiredFee);
+    CMutableTransaction tx;
+    if (!DecodeHexTx(tx, feetx))
+        throw std::runtime_error("Bad fee payment");
+    if (paymentCache.has(tx.GetHash())) {
+        ERR() << "Client sent a fee that was already spent: " << nodeAddr;
+        return false;
+    }
+    CScript redeemScript;
+    if (decodePaymentChannelUpdate(tx, redeemScript)) {
+        if (!checkChannelPayment(paymentAddress, tx, redeemScript, requiredFee)) {
+            ERR() << "Client sent a bad payment channel update: " << nodeAddr;
+            return false;
+        }
+        payment = MakeTransactionRef(std::move(tx));
+        return true;
+    }
+    checkPayment(tx, paymentAddress, requiredFee, [this](const uint256 & txid) {
+        return paymentCache.has(txid);
+    });
+    payment = MakeTransactionRef(std::move(tx));
+    return true;
+}
+
+bool XRouterServer::checkChannelPayment(const std::string & paymentAddress, const CMutableTransaction & tx,
+        const CScript & redeemScript, const CAmount & requiredFee)
+{
+    if (!App::instance().xrSettings()->paymentChannels())
+        return false;
+
+    CPubKey clientKey, snodeKey;
+    uint32_t lockTime;
+    if (!decodePaymentChannelScript(redeemScript, clientKey, snodeKey, lockTime))
+        return false;
+    // The channel has to pay this service node, keys may differ in compression
+    CPubKey ownKey(spubkey.begin(), spubkey.end());
+    if (!ownKey.Decompress() || !snodeKey.Decompress() || ownKey != snodeKey)
+        return false;
+
+    CTxDestination dest;
+    if (!ExtractDestination(tx.vout[0].scriptPubKey, dest) || EncodeDestination(dest) != paymentAddress)
+        throw std::runtime_error("Bad fee payment, payment address is missing");
+
+    const auto & funding = tx.vin[0].prevout;
+    CTxOut fundingOut;
+    {
+        LOCK2(cs_main, mempool.cs);
+        if (lockTime <= static_cast<uint32_t>(chainActive.Height() + XROUTER_CHANNEL_SETTLE_BLOCKS))
+            throw std::runtime_error("Bad fee payment, payment channel is expiring");
+        CCoinsViewMemPool view(pcoinsTip.get(), mempool);
+        Coin coin;
+        if (!view.GetCoin(funding, coin) || mempool.isSpent(funding))
+            throw std::runtime_error("Bad fee payment, payment channel is closed");
+        if (coin.out.scriptPubKey != GetScriptForDestination(CScriptID(redeemScript)))
+            throw std::runtime_error("Bad fee payment, payment channel funding is invalid");
+        fundingOut = coin.out;
+    }
+
+    CKey key;
+    key.Set(sprivkey.begin(), sprivkey.end(), true);
+    checkPaymentChannelUpdate(tx, fundingOut, key);
+
+    if (!paymentChannels.accepts(funding, tx.vout[0].nValue, requiredFee))
+        throw std::runtime_error("Bad fee payment, fee is too low");
     return true;
 }
 
+void XRouterServer::settleChannels()
+{
+    RenameThread("blocknet-xrchannels");
+    auto settle = [this](const int64_t opened, const int64_t height) {
+        const auto txs = paymentChannels.settle(opened, height);
+        if (txs.empty())
+            return;
+        CKey key;
+        key.Set(sprivkey.begin(), sprivkey.end(), true);
+        for (const auto & tx : txs) {
+            CMutableTransaction mtx(*tx);
+            if (!signPaymentChannelUpdate(mtx, key) || !paymentQueue.submit(MakeTransactionRef(std::move(mtx))))
+                ERR() << "Failed to settle payment channel " << tx->vin[0].prevout.hash.ToString();
+            else
+                LOG() << "Settled payment channel " << tx->vin[0].prevout.hash.ToString()
+                      << " for " << FormatMoney(tx->vout[0].nValue);
+            paymentChannels.erase(tx->vin[0].prevout);
+        }
+    };
+    while (settleInterrupt.sleep_for(std::chrono::seconds(XROUTER_TIMER_SECONDS))) {
+        int height{0};
+        {
+            LOCK(cs_main);
+            height = chainActive.Height();
+        }
+        settle(GetTime() - XROUTER_CHANNEL_SETTLE_INTERVAL, height + XROUTER_CHANNEL_SETTLE_BLOCKS);
+    }
+    settle(std::numeric_limits<int64_t>::max(), std::numeric_limits<int64_t>::max());
+}
+
+/**
+ * Seconds the backend reply of the command is cached, 0 if the reply isn't cached.
+ * @param command
+ * @return
+ */
+static int64_t resultCacheTtl(const XRouterCommand command)
+{
+    switch (command) {
+        case xrGetBlockHash:
+        case xrGetBlock:
+        case xrGetBlocks:
+        case xrGetTransaction:
+        case xrGetTransactions:
+            return XROUTER_RESULTCACHE_TTL;
+        case xrDecodeRawTransaction:
+            return XROUTER_RESULTCACHE_MAX_TTL;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Returns true if the reply, or an item of a reply array, is an error object.
+ * @param reply
+ * @return
+ */
+static bool hasErrorReply(const std::string & reply)
+{
+    auto isError = [](const Value & v) -> bool {
+        return v.type() == obj_type && find_value(v.get_obj(), "error").type() != null_type;
+    };
+    Value v;
+    if (!read_string(reply, v))
+        return false;
+    if (v.type() == array_type) {
+        for (const auto & item : v.get_array()) {
+            if (isError(item))
+                return true;
+        }
+        return false;
+    }
+    return isError(v);
+}
+
+void XRouterServer::trackTips()
+{
+    RenameThread("blocknet-xrtips");
+    do {
+        std::map<std::string, WalletConnectorXRouterPtr> conns;
+        {
+            LOCK(_lock);
+            conns = connectors;
+        }
+        for (const auto & item : conns) {
+            const auto & currency = item.first;
+            try {
+                auto slots = getConnectorSlots(currency);
+                if (!slots)
+                    continue;
+                CSemaphoreGrant grant(*slots);
+                const auto countReply = item.second->getBlockCount();
+                Value count;
+                if (!read_string(parseResult(countReply), count) || count.type() != int_type || count.get_int64() < 0) {
+                    tipTracker.erase(currency);
+                    continue;
+                }
+                const auto hashReply = item.second->getBlockHash(count.get_int());
+                if (hasErrorReply(parseResult(hashReply))) {
+                    tipTracker.erase(currency);
+                    continue;
+                }
+                tipTracker.update(currency, count.get_int64(), countReply, hashReply);
+            } catch (...) {
+                tipTracker.erase(currency); // backend is down, calls go to the backend
+            }
+        }
+    } while (tipInterrupt.sleep_for(std::chrono::milliseconds(XROUTER_TIP_POLL)));
+}
+
 //*****************************************************************************
 //*****************************************************************************
 void XRouterServer::onMessageReceived(CNode* node, XRouterPacketPtr packet, CValidationState& state)
 {
-    clearHashedQueries(); // clean up
+    paymentCache.expire(); // clean up
 
     // Make sure this node is designated as an xrouter node
     node->fXRouter = true;
@@ -207,9 +447,8 @@ void XRouterServer::onMessageReceived(CNode* node, XRouterPacketPtr packet, CVal
             XRouterSettingsPtr cfg = app.xrSettings();
 
             // Check request rate
-            if (!app.needConfigUpdate(nodeAddr, true))
+            if (!app.updateSentRequest(nodeAddr, commandStr, XROUTER_CONFIG_REQUEST_LIMIT))
                 state.DoS(10, error("XRouter: too many config requests"), REJECT_INVALID, "xrouter-error");
-            app.updateSentRequest(nodeAddr, commandStr);
 
             // Prep reply (serialize config)
             reply = app.parseConfig(cfg);
@@ -246,7 +485,7 @@ void XRouterServer::onMessageReceived(CNode* node, XRouterPacketPtr packet, CVal
             throw XRouterError("Too many parameters from client, max is " +
                                std::to_string(fetchLimit) + ": " + fqService, xrouter::BAD_REQUEST);
 
-        auto handlePayment = [this](const bool & expectingPayment, const std::string & feeTransaction,
+        auto handlePayment = [this](const bool & expectingPayment, const CTransactionRef & feeTransaction,
                 const std::string & fqService, CValidationState & state, const NodeAddr & nodeAddr)
         {
             if (!expectingPayment)
@@ -257,7 +496,8 @@ void XRouterServer::onMessageReceived(CNode* node, XRouterPacketPtr packet, CVal
                     state.DoS(50, error(err_msg.c_str()), REJECT_INVALID, "xrouter-error");
                     throw XRouterError(err_msg, xrouter::INSUFFICIENT_FEE);
                 }
-                LOG() << "Received payment for service " << fqService << " from node " << nodeAddr << "\n" << feeTransaction;
+                LOG() << "Received payment for service " << fqService << " from node " << nodeAddr << " "
+                      << feeTransaction->GetHash().ToString();
             } catch (XRouterError & e) {
                 state.DoS(1, error("XRouter: bad request"), REJECT_INVALID, "xrouter-error"); // prevent abuse
                 throw e;
@@ -274,12 +514,12 @@ void XRouterServer::onMessageReceived(CNode* node, XRouterPacketPtr packet, CVal
 
             // Check rate limit
             XRouterPluginSettingsPtr psettings = app.xrSettings()->getPluginSettings(service);
-            auto rateLimit = app.xrSettings()->clientRequestLimit(command, service);
-            if (rateLimit >= 0 && rateLimitExceeded(nodeAddr, fqService, rateLimit)) {
+            const auto rateLimit = app.xrSettings()->clientRequestLimit(command, service);
+            const auto burst = app.xrSettings()->clientRequestBurst(command, service);
+            if (!app.updateSentRequest(nodeAddr, fqService, rateLimit, burst)) { // Record request
                 std::string err_msg = "Rate limit exceeded: " + fqService;
                 state.DoS(20, error(err_msg.c_str()), REJECT_INVALID, "xrouter-error");
             }
-            app.updateSentRequest(nodeAddr, fqService); // Record request time
 
             if (!app.xrSettings()->isAvailableCommand(command, service))
                 throw XRouterError("Unsupported command: " + fqService, xrouter::UNSUPPORTED_SERVICE);
@@ -296,8 +536,9 @@ void XRouterServer::onMessageReceived(CNode* node, XRouterPacketPtr packet, CVal
             const auto dfee = app.xrSettings()->commandFee(command, service);
             const auto fee = to_amount(dfee);
             bool expectingPayment = fee > 0;
+            CTransactionRef payment;
             if (expectingPayment) {
-                if (!checkFeePayment(nodeAddr, app.xrSettings()->paymentAddress(command, service), feetx, fee)) {
+                if (!checkFeePayment(nodeAddr, app.xrSettings()->paymentAddress(command, service), feetx, fee, payment)) {
                     const std::string err_msg = strprintf("Bad fee payment from client %s service %s", nodeAddr, fqService);
                     state.DoS(25, error(err_msg.c_str()), REJECT_INVALID, "xrouter-error");
                     throw XRouterError(err_msg, xrouter::INSUFFICIENT_FEE);
@@ -317,19 +558,19 @@ void XRouterServer::onMessageReceived(CNode* node, XRouterPacketPtr packet, CVal
             }
 
             // Spend client payment
-            handlePayment(expectingPayment, feetx, fqService, state, nodeAddr);
+            handlePayment(expectingPayment, payment, fqService, state, nodeAddr);
 
         } else { // Handle default XRouter calls
             const auto dfee = app.xrSettings()->commandFee(command, service);
             const auto fee = to_amount(dfee); // convert to satoshi
 
             // Rate limit check
-            int rateLimit = app.xrSettings()->clientRequestLimit(command, service);
-            if (rateLimit >= 0 && rateLimitExceeded(nodeAddr, fqService, rateLimit)) {
+            const auto rateLimit = app.xrSettings()->clientRequestLimit(command, service);
+            const auto burst = app.xrSettings()->clientRequestBurst(command, service);
+            if (!app.updateSentRequest(nodeAddr, fqService, rateLimit, burst)) { // Record request
                 std::string err_msg = "Rate limit exceeded: " + fqService;
                 state.DoS(20, error(err_msg.c_str()), REJECT_INVALID, "xrouter-error");
             }
-            app.updateSentRequest(nodeAddr, fqService); // Record request time
 
             if (!app.xrSettings()->isAvailableCommand(command, service))
                 throw XRouterError("Unsupported command: " + fqService, xrouter::UNSUPPORTED_SERVICE);
@@ -343,8 +584,9 @@ void XRouterServer::onMessageReceived(CNode* node, XRouterPacketPtr packet, CVal
 
             // Check payment
             bool expectingPayment = fee > 0;
+            CTransactionRef payment;
             if (expectingPayment) {
-                if (!checkFeePayment(nodeAddr, app.xrSettings()->paymentAddress(command, service), feetx, fee)) {
+                if (!checkFeePayment(nodeAddr, app.xrSettings()->paymentAddress(command, service), feetx, fee, payment)) {
                     const std::string err_msg = strprintf("Bad fee payment from client %s service %s", nodeAddr, fqService);
                     state.DoS(25, error(err_msg.c_str()), REJECT_INVALID, "xrouter-error");
                     throw XRouterError(err_msg, xrouter::INSUFFICIENT_FEE);
@@ -353,53 +595,7 @@ void XRouterServer::onMessageReceived(CNode* node, XRouterPacketPtr packet, CVal
             }
 
             try {
-                switch (command) {
-                    case xrGetBlockCount:
-                        reply = parseResult(processGetBlockCount(service, params));
-                        break;
-                    case xrGetBlockHash:
-                        reply = parseResult(processGetBlockHash(service, params));
-                        break;
-                    case xrGetBlock:
-                        reply = parseResult(processGetBlock(service, params));
-                        break;
-                    case xrGetTransaction:
-                        reply = parseResult(processGetTransaction(service, params));
-                        break;
-                    case xrGetBlocks:
-                        reply = parseResult(processGetBlocks(service, params));
-                        break;
-                    case xrGetTransactions:
-                        reply = parseResult(processGetTransactions(service, params));
-                        break;
-                    case xrDecodeRawTransaction:
-                        reply = parseResult(processDecodeRawTransaction(service, params));
-                        break;
-                    case xrGetBalance:
-                        throw XRouterError("This call is not supported: " + fqService, xrouter::UNSUPPORTED_SERVICE);
-//                        reply = parseResult(processGetBalance(service, params));
-                        break;
-                    case xrGetTxBloomFilter:
-                        throw XRouterError("This call is not supported: " + fqService, xrouter::UNSUPPORTED_SERVICE);
-//                        reply = parseResult(processGetTxBloomFilter(service, params));
-                        break;
-                    case xrGenerateBloomFilter:
-                        throw XRouterError("This call is not supported: " + fqService, xrouter::UNSUPPORTED_SERVICE);
-//                        reply = parseResult(processGenerateBloomFilter(service, params));
-                        break;
-                    case xrGetBlockAtTime:
-                        throw XRouterError("This call is not supported: " + fqService, xrouter::UNSUPPORTED_SERVICE);
-//                        reply = parseResult(processConvertTimeToBlockCount(service, params));
-                        break;
-                    case xrGetReply:
-                        reply = parseResult(processFetchReply(uuid));
-                        break;
-                    case xrSendTransaction:
-                        reply = parseResult(processSendTransaction(service, params));
-                        break;
-                    default:
-                        throw XRouterError("Unknown command " + fqService, xrouter::UNSUPPORTED_SERVICE);
-                }
+                reply = processCommand(command, service, params, uuid);
             } catch (XRouterError & e) {
                 state.DoS(1, error("XRouter: bad request"), REJECT_INVALID, "xrouter-error"); // prevent abuse
                 ERR() << "Failed to process " << fqService << "from node " << nodeAddr << " msg: " << e.msg << " code: " << e.code;
@@ -411,7 +607,7 @@ void XRouterServer::onMessageReceived(CNode* node, XRouterPacketPtr packet, CVal
             }
 
             // Spend client payment
-            handlePayment(expectingPayment, feetx, fqService, state, nodeAddr);
+            handlePayment(expectingPayment, payment, fqService, state, nodeAddr);
         }
 
     } catch (XRouterError & e) {
@@ -428,15 +624,89 @@ void XRouterServer::onMessageReceived(CNode* node, XRouterPacketPtr packet, CVal
         reply = json_spirit::write_string(Value(error), true);
     }
 
-    sendPacketToClient(uuid, reply, node);
+    sendPacketToClient(uuid, reply, node, packet->flags());
 }
 
 //*****************************************************************************
 //*****************************************************************************
+std::string XRouterServer::processCommand(const XRouterCommand command, const std::string & service,
+                                          const std::vector<std::string> & params, const std::string & uuid)
+{
+    const std::string commandStr = XRouterCommand_ToString(command);
+    const auto & fqService = walletCommandKey(service, commandStr);
+    std::string reply;
+
+    // Backend replies are cached, see resultCacheTtl
+    const int64_t cacheTtl = resultCacheTtl(command);
+    std::string cacheKey;
+    if (cacheTtl > 0) {
+        cacheKey = service + '\0' + commandStr;
+        for (const auto & p : params)
+            cacheKey += '\0' + p;
+    }
+    if (cacheTtl > 0 && resultCache.get(cacheKey, reply)) {
+        LOG() << "XRouter command: " << fqService << " cached reply for query " << uuid;
+    } else {
+        switch (command) {
+            case xrGetBlockCount:
+                reply = parseResult(processGetBlockCount(service, params));
+                break;
+            case xrGetBlockHash:
+                reply = parseResult(processGetBlockHash(service, params));
+                break;
+            case xrGetBlock:
+                reply = parseResult(processGetBlock(service, params));
+                break;
+            case xrGetTransaction:
+                reply = parseResult(processGetTransaction(service, params));
+                break;
+            case xrGetBlocks:
+                reply = parseResult(processGetBlocks(service, params));
+                break;
+            case xrGetTransactions:
+                reply = parseResult(processGetTransactions(service, params));
+                break;
+            case xrDecodeRawTransaction:
+                reply = parseResult(processDecodeRawTransaction(service, params));
+                break;
+            case xrGetBalance:
+                reply = parseResult(processGetBalance(service, params));
+                break;
+            case xrGetTxBloomFilter:
+                reply = parseResult(processGetTxBloomFilter(service, params));
+                break;
+            case xrGenerateBloomFilter:
+                throw XRouterError("This call is not supported: " + fqService, xrouter::UNSUPPORTED_SERVICE);
+                // reply = parseResult(processGenerateBloomFilter(service, params));
+                break;
+            case xrGetBlockAtTime:
+                throw XRouterError("This call is not supported: " + fqService, xrouter::UNSUPPORTED_SERVICE);
+                // reply = parseResult(processConvertTimeToBlockCount(service, params));
+                break;
+            case xrGetReply:
+                reply = parseResult(processFetchReply(uuid));
+                break;
+            case xrSendTransaction:
+                reply = parseResult(processSendTransaction(service, params));
+                break;
+            default:
+                throw XRouterError("Unknown command " + fqService, xrouter::UNSUPPORTED_SERVICE);
+        }
+        if (cacheTtl > 0 && !hasErrorReply(reply))
+            resultCache.put(cacheKey, reply, cacheTtl);
+    }
+    return reply;
+}
+
 std::string XRouterServer::processGetBlockCount(const std::string & currency, const std::vector<std::string> & params) {
+    std::string reply;
+    if (tipTracker.blockCount(currency, reply))
+        return reply;
+
     xrouter::WalletConnectorXRouterPtr conn = connectorByCurrency(currency);
-    if (conn && hasConnectorLock(currency)) {
-        boost::mutex::scoped_lock l(*getConnectorLock(currency));
+    if (conn && hasConnectorSlots(currency)) {
+        auto slots = getConnectorSlots(currency); // held until the call returns
+        CSemaphoreGrant grant(*slots);
         return conn->getBlockCount();
     }
 
@@ -447,8 +717,9 @@ std::string XRouterServer::processGetBlockHash(const std::string & currency, con
     const auto & blockId = params[0];
 
     xrouter::WalletConnectorXRouterPtr conn = connectorByCurrency(currency);
-    if (conn && hasConnectorLock(currency)) {
-        boost::mutex::scoped_lock l(*getConnectorLock(currency));
+    if (conn && hasConnectorSlots(currency)) {
+        auto slots = getConnectorSlots(currency); // held until the call returns
+        CSemaphoreGrant grant(*slots);
         uint32_t block_n{0};
         if (boost::algorithm::starts_with(blockId, "0x")) { // handle hex values (specifically for eth)
             try {
@@ -463,7 +734,14 @@ std::string XRouterServer::processGetBlockHash(const std::string & currency, con
                 throw XRouterError("Problem with the specified block number, is it a number?", xrouter::INVALID_PARAMETERS);
             }
         }
-        return conn->getBlockHash(block_n);
+        std::string reply;
+        uint64_t generation;
+        if (tipTracker.blockHash(currency, block_n, reply, generation))
+            return reply;
+        reply = conn->getBlockHash(block_n);
+        if (!hasErrorReply(parseResult(reply)))
+            tipTracker.putBlockHash(currency, block_n, reply, generation);
+        return reply;
     }
 
     throw XRouterError("Internal Server Error: No connector for " + currency, xrouter::BAD_CONNECTOR);
@@ -473,8 +751,9 @@ std::string XRouterServer::processGetBlock(const std::string & currency, const s
     const auto & blockHash = params[0];
 
     xrouter::WalletConnectorXRouterPtr conn = connectorByCurrency(currency);
-    if (conn && hasConnectorLock(currency)) {
-        boost::mutex::scoped_lock l(*getConnectorLock(currency));
+    if (conn && hasConnectorSlots(currency)) {
+        auto slots = getConnectorSlots(currency); // held until the call returns
+        CSemaphoreGrant grant(*slots);
         return conn->getBlock(blockHash);
     }
 
@@ -492,8 +771,9 @@ std::vector<std::string> XRouterServer::processGetBlocks(const std::string & cur
                            std::to_string(fetchlimit) + " received " + std::to_string(params.size()), xrouter::BAD_REQUEST);
 
     xrouter::WalletConnectorXRouterPtr conn = connectorByCurrency(currency);
-    if (conn && hasConnectorLock(currency)) {
-        boost::mutex::scoped_lock l(*getConnectorLock(currency));
+    if (conn && hasConnectorSlots(currency)) {
+        auto slots = getConnectorSlots(currency); // held until the call returns
+        CSemaphoreGrant grant(*slots);
         return conn->getBlocks(params);
     }
 
@@ -505,8 +785,9 @@ std::string XRouterServer::processGetTransaction(const std::string & currency, c
     const auto & hash = params[0];
 
     xrouter::WalletConnectorXRouterPtr conn = connectorByCurrency(currency);
-    if (conn && hasConnectorLock(currency)) {
-        boost::mutex::scoped_lock l(*getConnectorLock(currency));
+    if (conn && hasConnectorSlots(currency)) {
+        auto slots = getConnectorSlots(currency); // held until the call returns
+        CSemaphoreGrant grant(*slots);
         return conn->getTransaction(hash);
     }
 
@@ -524,8 +805,9 @@ std::vector<std::string> XRouterServer::processGetTransactions(const std::string
                            std::to_string(fetchlimit) + " received " + std::to_string(params.size()), xrouter::BAD_REQUEST);
     
     xrouter::WalletConnectorXRouterPtr conn = connectorByCurrency(currency);
-    if (conn && hasConnectorLock(currency)) {
-        boost::mutex::scoped_lock l(*getConnectorLock(currency));
+    if (conn && hasConnectorSlots(currency)) {
+        auto slots = getConnectorSlots(currency); // held until the call returns
+        CSemaphoreGrant grant(*slots);
         return conn->getTransactions(params);
     }
 
@@ -536,8 +818,9 @@ std::string XRouterServer::processDecodeRawTransaction(const std::string & curre
     const auto & hex = params[0];
 
     xrouter::WalletConnectorXRouterPtr conn = connectorByCurrency(currency);
-    if (conn && hasConnectorLock(currency)) {
-        boost::mutex::scoped_lock l(*getConnectorLock(currency));
+    if (conn && hasConnectorSlots(currency)) {
+        auto slots = getConnectorSlots(currency); // held until the call returns
+        CSemaphoreGrant grant(*slots);
         return conn->decodeRawTransaction(hex);
     }
 
@@ -548,8 +831,9 @@ std::string XRouterServer::processSendTransaction(const std::string & currency,
     const auto & transaction = params[0];
 
     xrouter::WalletConnectorXRouterPtr conn = connectorByCurrency(currency);
-    if (conn && hasConnectorLock(currency)) {
-        boost::mutex::scoped_lock l(*getConnectorLock(currency));
+    if (conn && hasConnectorSlots(currency)) {
+        auto slots = getConnectorSlots(currency); // held until the call returns
+        CSemaphoreGrant grant(*slots);
         return conn->sendTransaction(transaction);
     }
 
@@ -559,35 +843,192 @@ std::string XRouterServer::processSendTransaction(const std::string & currency,
 //*****************************************************************************
 //*****************************************************************************
 
-std::vector<std::string> XRouterServer::processGetTxBloomFilter(const std::string & currency, const std::vector<std::string> & params) {
-    const auto & filter = params[0];
+//! Scripts of the watched addresses. A base58 address of another chain can't be told apart
+//! from a script hash address, its hash is watched as both p2pkh and p2sh.
+static GCSFilter::ElementSet watchedScripts(const std::string & param)
+{
+    std::vector<std::string> items;
+    boost::split(items, param, boost::is_any_of(","));
+    if (items.size() > XROUTER_FILTER_MAX_ADDRESSES)
+        throw XRouterError("Too many addresses, limit is " + std::to_string(XROUTER_FILTER_MAX_ADDRESSES), xrouter::INVALID_PARAMETERS);
+
+    GCSFilter::ElementSet scripts;
+    for (auto & item : items) {
+        boost::trim(item);
+        std::vector<unsigned char> data;
+        if (DecodeBase58Check(item, data) && (data.size() == 21 || data.size() == 22)) {
+            const uint160 hash(std::vector<unsigned char>(data.end() - 20, data.end()));
+            const CScript p2pkh = GetScriptForDestination(CKeyID(hash));
+            const CScript p2sh = GetScriptForDestination(CScriptID(hash));
+            scripts.emplace(p2pkh.begin(), p2pkh.end());
+            scripts.emplace(p2sh.begin(), p2sh.end());
+        } else if (!item.empty() && IsHex(item)) {
+            scripts.insert(ParseHex(item));
+        } else {
+            throw XRouterError("Incorrect address: " + item, xrouter::INVALID_PARAMETERS);
+        }
+    }
+    return scripts;
+}
 
-    // 10 is a constant for bloom filters currently
-    if (!is_hash(filter) || (filter.size() % 10 != 0))
-        throw XRouterError("Incorrect bloom filter: " + filter, xrouter::INVALID_PARAMETERS);
-    
-    CBloomFilter f(filter.size(), 0.1, 5, 0);
-//    f.from_hex(filter); // TODO Blocknet XRouter fixme
-    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
-    stream << f;
+static GCSFilter::Element outpointElement(const COutPoint & out)
+{
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << out;
+    return GCSFilter::Element(ss.begin(), ss.end());
+}
 
-    std::string number_s(params[1]);
+std::vector<std::string> XRouterServer::processGetTxBloomFilter(const std::string & currency, const std::vector<std::string> & params) {
+    if (params.size() < 2)
+        throw XRouterError("Missing parameters for " + currency, xrouter::INVALID_PARAMETERS);
+    const auto scripts = watchedScripts(params[0]);
+
+    const std::string & number_s(params[1]);
     if (!is_number(number_s))
         throw XRouterError("Incorrect block number: " + number_s, xrouter::INVALID_PARAMETERS);
-    int number = std::stoi(number_s);
+    const int number = std::stoi(number_s);
+    if (number < 0)
+        throw XRouterError("Incorrect block number: " + number_s, xrouter::INVALID_PARAMETERS);
 
     App & app = App::instance();
-    int fetchlimit = app.xrSettings()->commandFetchLimit(xrGetTxBloomFilter, currency);
+    const int fetchlimit = app.xrSettings()->commandFetchLimit(xrGetTxBloomFilter, currency);
+
+    // The node's own chain is matched against the basic block filter index
+    std::vector<std::string> txs;
+    if (currency == "BLOCK" && scanLocalChain(scripts, number, fetchlimit, txs))
+        return txs;
 
     xrouter::WalletConnectorXRouterPtr conn = connectorByCurrency(currency);
-    if (conn && hasConnectorLock(currency)) {
-        boost::mutex::scoped_lock l(*getConnectorLock(currency));
-        return conn->getTransactionsBloomFilter(number, stream, fetchlimit);
+    if (conn && hasConnectorSlots(currency)) {
+        auto slots = getConnectorSlots(currency); // held until the call returns
+        CSemaphoreGrant grant(*slots);
+        return scanConnector(conn, currency, scripts, number, fetchlimit);
     }
 
     throw XRouterError("Internal Server Error: No connector for " + currency, xrouter::BAD_CONNECTOR);
 }
 
+static void checkFetchLimit(const int number, const int height, const int fetchlimit)
+{
+    if (number > height)
+        throw XRouterError("Block number " + std::to_string(number) + " is above the chain height " + std::to_string(height), xrouter::INVALID_PARAMETERS);
+    if (fetchlimit > 0 && height - number + 1 > fetchlimit)
+        throw XRouterError("Too many blocks requested, limit is " + std::to_string(fetchlimit), xrouter::INVALID_PARAMETERS);
+}
+
+bool XRouterServer::scanLocalChain(const GCSFilter::ElementSet & scripts, const int number, const int fetchlimit,
+                                   std::vector<std::string> & txs)
+{
+    if (!g_blockfilterindex)
+        return false;
+
+    const CBlockIndex* tip;
+    {
+        LOCK(cs_main);
+        tip = chainActive.Tip();
+    }
+    if (!tip)
+        return false;
+    checkFetchLimit(number, tip->nHeight, fetchlimit);
+
+    for (int from = number; from <= tip->nHeight; from += XROUTER_FILTER_BATCH) {
+        const CBlockIndex* stop = tip->GetAncestor(std::min(from + XROUTER_FILTER_BATCH - 1, tip->nHeight));
+        std::vector<BlockFilter> filters;
+        if (!g_blockfilterindex->LookupFilterRange(from, stop, filters)) {
+            txs.clear();
+            return false; // index behind the chain, scan through the connector
+        }
+
+        for (size_t i = 0; i < filters.size(); ++i) {
+            // Basic filters include the spent scripts, a match needs no outpoint tracking
+            if (!filters[i].GetFilter().MatchAny(scripts))
+                continue;
+            const CBlockIndex* pindex = stop->GetAncestor(from + static_cast<int>(i));
+            const auto block = ReadBlockFromDiskCached(pindex, Params().GetConsensus());
+            CBlockUndo undo;
+            if (!block || (pindex->nHeight > 0 && !UndoReadFromDisk(undo, pindex)))
+                throw XRouterError("Failed to read block " + pindex->GetBlockHash().ToString(), xrouter::INTERNAL_SERVER_ERROR);
+
+            for (size_t t = 0; t < block->vtx.size(); ++t) {
+                const auto & tx = block->vtx[t];
+                bool relevant{false};
+                for (const auto & out : tx->vout)
+                    relevant = relevant || scripts.count(GCSFilter::Element(out.scriptPubKey.begin(), out.scriptPubKey.end()));
+                if (!relevant && t > 0 && t - 1 < undo.vtxundo.size()) {
+                    for (const auto & coin : undo.vtxundo[t - 1].vprevout) {
+                        const auto & script = coin.out.scriptPubKey;
+                        relevant = relevant || scripts.count(GCSFilter::Element(script.begin(), script.end()));
+                    }
+                }
+                if (relevant)
+                    txs.push_back(EncodeHexTx(*tx));
+            }
+        }
+    }
+    return true;
+}
+
+std::vector<std::string> XRouterServer::scanConnector(const WalletConnectorXRouterPtr & conn, const std::string & currency,
+                                                      const GCSFilter::ElementSet & scripts, const int number, const int fetchlimit)
+{
+    Value count;
+    if (!read_string(parseResult(conn->getBlockCount()), count) || count.type() != int_type)
+        throw XRouterError("Failed to get the block count of " + currency, xrouter::BAD_CONNECTOR);
+    const int height = count.get_int();
+    checkFetchLimit(number, height, fetchlimit);
+
+    // Backends don't report the spent scripts, the spends are found by the outpoints of
+    // the matched outputs. Spends of outputs received before the start block are missed.
+    GCSFilter::ElementSet watched(scripts);
+    std::vector<std::string> txs;
+
+    for (int from = number; from <= height; from += XROUTER_FILTER_BATCH) {
+        const auto hashes = conn->getBlockHashes(from, std::min(from + XROUTER_FILTER_BATCH - 1, height));
+        for (const auto & hash : hashes) {
+            const uint256 blockHash = uint256S(hash);
+            const GCSFilter::Params params(blockHash.GetUint64(0), blockHash.GetUint64(1), BASIC_FILTER_P, BASIC_FILTER_M);
+            const std::string cacheKey = currency + "/" + hash;
+
+            std::string encoded;
+            if (filterCache.get(cacheKey, encoded)
+                && !GCSFilter(params, std::vector<unsigned char>(encoded.begin(), encoded.end())).MatchAny(watched))
+                continue;
+
+            GCSFilter::ElementSet elements;
+            for (const auto & hex : conn->getBlockRawTransactions(hash)) {
+                CMutableTransaction mtx;
+                if (!DecodeHexTx(mtx, hex))
+                    throw XRouterError("Failed to decode a transaction of block " + hash, xrouter::BAD_CONNECTOR);
+
+                bool relevant{false};
+                for (const auto & in : mtx.vin) {
+                    const auto outpoint = outpointElement(in.prevout);
+                    relevant = relevant || watched.count(outpoint);
+                    elements.insert(outpoint);
+                }
+                const uint256 txid = mtx.GetHash();
+                for (uint32_t n = 0; n < mtx.vout.size(); ++n) {
+                    const auto & script = mtx.vout[n].scriptPubKey;
+                    if (script.empty() || script[0] == OP_RETURN)
+                        continue;
+                    GCSFilter::Element element(script.begin(), script.end());
+                    if (scripts.count(element)) {
+                        relevant = true;
+                        watched.insert(outpointElement(COutPoint(txid, n)));
+                    }
+                    elements.insert(std::move(element));
+                }
+                if (relevant)
+                    txs.push_back(hex);
+            }
+
+            const auto & filter = GCSFilter(params, elements).GetEncoded();
+            filterCache.put(cacheKey, std::string(filter.begin(), filter.end()), XROUTER_FILTERCACHE_TTL);
+        }
+    }
+    return txs;
+}
+
 std::string XRouterServer::processGenerateBloomFilter(const std::string & currency, const std::vector<std::string> & params) {
     CBloomFilter f(10 * static_cast<unsigned int>(params.size()), 0.1, 5, 0);
 
@@ -632,8 +1073,9 @@ std::string XRouterServer::processConvertTimeToBlockCount(const std::string & cu
     const std::string timestamp(params[0]);
 
     xrouter::WalletConnectorXRouterPtr conn = connectorByCurrency(currency);
-    if (conn && hasConnectorLock(currency)) {
-        boost::mutex::scoped_lock l(*getConnectorLock(currency));
+    if (conn && hasConnectorSlots(currency)) {
+        auto slots = getConnectorSlots(currency); // held until the call returns
+        CSemaphoreGrant grant(*slots);
         return conn->convertTimeToBlockCount(timestamp);
     }
 
@@ -641,7 +1083,25 @@ std::string XRouterServer::processConvertTimeToBlockCount(const std::string & cu
 }
 
 std::string XRouterServer::processGetBalance(const std::string & currency, const std::vector<std::string> & params) {
-    throw XRouterError("Internal Server Error: Not implemented for " + currency, xrouter::BAD_CONNECTOR);
+    if (params.empty())
+        throw XRouterError("Missing parameters for " + currency, xrouter::INVALID_PARAMETERS);
+
+    // Only the node's own chain can be served, from the address index
+    if (currency != "BLOCK" || !g_addressindex || !g_addressindex->IsSynced())
+        throw XRouterError("Internal Server Error: Not implemented for " + currency, xrouter::BAD_CONNECTOR);
+
+    const CTxDestination dest = DecodeDestination(params[0]);
+    if (!IsValidDestination(dest))
+        throw XRouterError("Incorrect address: " + params[0], xrouter::INVALID_PARAMETERS);
+
+    std::vector<AddressUnspentEntry> unspent;
+    if (!g_addressindex->FindUnspent(GetScriptForDestination(dest), unspent))
+        throw XRouterError("Internal Server Error: Failed to read the address index", xrouter::INTERNAL_SERVER_ERROR);
+
+    CAmount balance{0};
+    for (const auto & entry : unspent)
+        balance += entry.amount;
+    return FormatMoney(balance);
 }
 
 std::string XRouterServer::processServiceCall(const std::string & name, const std::vector<std::string> & params)
@@ -660,7 +1120,8 @@ std::string XRouterServer::processServiceCall(const std::string & name, const st
         throw XRouterError(strprintf("Received parameters count %ld do not match expected %ld",
                 params.size(), expectedParams.size()), INVALID_PARAMETERS);
 
-    if (callType == "rpc") {
+    // Converts the parameters to the json types of the plugin's parameters= setting
+    auto jsonParams = [&expectedParams, &params]() -> Array {
         Array jsonparams;
         for (int i = 0; i < static_cast<int>(expectedParams.size()); ++i) {
             const auto & p = expectedParams[i];
@@ -683,6 +1144,11 @@ std::string XRouterServer::processServiceCall(const std::string & name, const st
                 jsonparams.push_back(rec);
             }
         }
+        return jsonparams;
+    };
+
+    if (callType == "rpc") {
+        const Array jsonparams = jsonParams();
 
         std::string result;
         const auto & user     = psettings->stringParam("rpcuser");
@@ -781,6 +1247,25 @@ std::string XRouterServer::processServiceCall(const std::string & name, const st
         else
             return json_spirit::write_string(val, false);
 
+    } else if (callType == "worker") {
+        // The request is the json array of the parameters on one line, the reply is the
+        // next line the worker writes
+        const auto & exe = psettings->command();
+        if (exe.empty()) {
+            ERR() << "Failed to run plugin " + name + " \"command\" cannot be empty";
+            throw XRouterError("Internal Server Error in command " + name, INTERNAL_SERVER_ERROR);
+        }
+        auto pool = pluginWorkerPool(name, exe, psettings->workers());
+        DEBUGLOG() << "Calling worker plugin " << name;
+        const auto & r = pool->call(json_spirit::write_string(Value(jsonParams()), false), psettings->commandTimeout());
+
+        if (psettings->hasCustomResponse())
+            return psettings->customResponse();
+        Value val;
+        if (!json_spirit::read_string(r, val) || val.type() == null_type)
+            val = Value(r); // raw string
+        return json_spirit::write_string(val, false);
+
     } else if (callType == "url") {
         throw XRouterError("url calls are unsupported at this time", UNSUPPORTED_SERVICE);
 //
@@ -803,14 +1288,11 @@ std::string XRouterServer::processServiceCall(const std::string & name, const st
 }
 
 std::string XRouterServer::processFetchReply(const std::string & uuid) {
-    if (hasQuery(uuid))
-        return getQuery(uuid);
-    else {
-        Object error;
-        error.emplace_back("error", "Unknown query id: " + uuid);
-        error.emplace_back("code", xrouter::INVALID_PARAMETERS);
-        return json_spirit::write_string(Value(error), true);
-    }
+    // Replies aren't stored by the service node
+    Object error;
+    error.emplace_back("error", "Unknown query id: " + uuid);
+    error.emplace_back("code", xrouter::INVALID_PARAMETERS);
+    return json_spirit::write_string(Value(error), true);
 }
 
 bool XRouterServer::processParameters(XRouterPacketPtr packet, const int & paramsCount,
@@ -845,120 +1327,169 @@ std::string XRouterServer::getMyPaymentAddress()
     return addr;
 }
 
-void XRouterServer::clearHashedQueries() {
-    LOCK(_lock);
+Object XRouterServer::runPerformanceTests(const int clients, const int requests, const int backendMs) {
+    typedef std::chrono::steady_clock clock;
+    auto micros = [](const clock::time_point & since) -> int64_t {
+        return std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - since).count();
+    };
+
+    auto conn = std::make_shared<BenchWalletConnectorXRouter>(backendMs);
+    const std::string currency = conn->currency;
+    XRouterServer bench;
+    {
+        LOCK(bench._lock);
+        bench.connectors[currency] = conn;
+        bench.connectorSlots[currency] = std::make_shared<CSemaphore>(XROUTER_DEFAULT_CONNECTORCONCURRENCY);
+    }
+
+    CKey snodeKey; snodeKey.MakeNewKey(true);
+    const CPubKey snodePubKey = snodeKey.GetPubKey();
+    bench.spubkey = std::vector<unsigned char>(snodePubKey.begin(), snodePubKey.end());
+    bench.sprivkey = std::vector<unsigned char>(snodeKey.begin(), snodeKey.end());
+
+    // Every query pays the service node
+    const CAmount fee = to_amount(0.01);
+    const std::string paymentAddress = EncodeDestination(snodePubKey.GetID());
+    CMutableTransaction feeTx;
+    feeTx.vin.emplace_back(COutPoint(uint256S(BenchWalletConnectorXRouter::fakeHash("fee")), 0));
+    feeTx.vout.emplace_back(fee, GetScriptForDestination(snodePubKey.GetID()));
+    const std::string feetx = EncodeHexTx(CTransaction(feeTx));
+
+    struct ClientStats {
+        std::vector<int64_t> latencies; // microseconds
+        int64_t verifyUs{0};
+        int64_t feeUs{0};
+        int64_t bytes{0};
+        int errors{0};
+    };
+    std::vector<ClientStats> stats(clients);
+
+    // Block count, hash and block queries repeat (cached), transaction queries don't
+    auto client = [&](const int c) {
+        auto & st = stats[c];
+        st.latencies.reserve(requests);
+        CKey key; key.MakeNewKey(true);
+        const CPubKey pubkey = key.GetPubKey();
+        const std::vector<unsigned char> cpubkey(pubkey.begin(), pubkey.end());
+        const std::vector<unsigned char> cprivkey(key.begin(), key.end());
+
+        for (int i = 0; i < requests; ++i) {
+            XRouterCommand command;
+            std::vector<std::string> params;
+            const int height = BenchWalletConnectorXRouter::chainHeight - i / 4 % 100;
+            switch (i % 4) {
+                case 0:
+                    command = xrGetBlockCount;
+                    break;
+                case 1:
+                    command = xrGetBlockHash;
+                    params.push_back(std::to_string(height));
+                    break;
+                case 2:
+                    command = xrGetBlock;
+                    params.push_back(BenchWalletConnectorXRouter::fakeHash(std::to_string(height)));
+                    break;
+                default:
+                    command = xrGetTransaction;
+                    params.push_back(BenchWalletConnectorXRouter::fakeHash(strprintf("%d:%d", c, i)));
+                    break;
+            }
+
+            const auto start = clock::now();
+
+            // Client sends the query
+            XRouterPacketPtr packet = std::make_shared<XRouterPacket>(command, generateUUID());
+            packet->setFlags(XROUTER_FLAG_BINARY_REPLY);
+            packet->append(currency);
+            packet->append(feetx);
+            packet->append(static_cast<uint32_t>(params.size()));
+            for (const auto & p : params)
+                packet->append(p);
+            packet->sign(cpubkey, cprivkey);
+
+            // Service node checks the query and runs it
+            auto t = clock::now();
+            bool ok = packet->verify(packet->vpubkey());
+            st.verifyUs += micros(t);
+
+            uint32_t offset = packet->service().size() + 1;
+            const std::string qfeetx((const char *)packet->data()+offset);
+            offset += qfeetx.size() + 1;
+            const auto paramsCount = *static_cast<uint32_t *>(static_cast<void *>(packet->data()+offset));
+            offset += sizeof(uint32_t);
+            std::vector<std::string> qparams;
+            ok = ok && bench.processParameters(packet, paramsCount, qparams, offset);
+
+            t = clock::now();
+            CMutableTransaction tx;
+            ok = ok && DecodeHexTx(tx, qfeetx) && paymentAmount(tx, paymentAddress) >= fee;
+            st.feeUs += micros(t);
+
+            std::string reply;
+            try {
+                reply = bench.processCommand(command, currency, qparams, packet->suuid());
+            } catch (const std::exception &) {
+                ok = false;
+            }
+            const XRouterPacket rpacket = bench.replyPacket(packet->suuid(), reply, packet->flags());
+
+            // Client checks the reply
+            XRouterPacket received(rpacket);
+            UniValue result;
+            ok = ok && received.verify(bench.spubkey);
+            if (received.flags() & XROUTER_FLAG_BINARY_REPLY)
+                ok = ok && DecodeBinaryReply(received.data(), received.size(), result);
+            else
+                ok = ok && result.read(std::string((const char *)received.data()));
 
-    std::vector<std::string> to_remove;
-    for (auto & it : hashedQueriesDeadlines) {
-        std::chrono::time_point<std::chrono::system_clock> time = std::chrono::system_clock::now();
-        std::chrono::system_clock::duration diff = time - it.second;
-        // TODO: move 1000 seconds to settings?
-        if (std::chrono::duration_cast<std::chrono::milliseconds>(diff) < std::chrono::milliseconds(1000 * 1000)) {
-            to_remove.push_back(it.first);
+            st.latencies.push_back(micros(start));
+            st.bytes += packet->allSize() + rpacket.allSize();
+            if (!ok)
+                ++st.errors;
         }
+    };
+
+    const auto begin = clock::now();
+    std::vector<std::thread> threads;
+    for (int c = 0; c < clients; ++c)
+        threads.emplace_back(client, c);
+    for (auto & th : threads)
+        th.join();
+    const double seconds = std::max(micros(begin), static_cast<int64_t>(1)) / 1000000.0;
+
+    std::vector<int64_t> latencies;
+    int64_t verifyUs{0}, feeUs{0}, bytes{0};
+    int errors{0};
+    for (const auto & st : stats) {
+        latencies.insert(latencies.end(), st.latencies.begin(), st.latencies.end());
+        verifyUs += st.verifyUs;
+        feeUs += st.feeUs;
+        bytes += st.bytes;
+        errors += st.errors;
     }
-    
-    for (const auto & i : to_remove) {
-        hashedQueries.erase(i);
-        hashedQueriesDeadlines.erase(i);
-    }
-}
-
-void XRouterServer::runPerformanceTests() {
-//    LOCK(_lock);
-//    std::chrono::time_point<std::chrono::system_clock> time;
-//    std::chrono::system_clock::duration diff;
-//    for (const auto& it : this->connectors) {
-//        std::string currency = it.first;
-//        WalletConnectorXRouterPtr conn = it.second;
-//        boost::mutex::scoped_lock l(*connectorLocks[currency]);
-//        TESTLOG() << "Testing connector to currency " << currency;
-//        TESTLOG() << "xrGetBlockCount";
-//        time = std::chrono::system_clock::now();
-//        int blocks = std::stoi(conn->getBlockCount());
-//        diff = std::chrono::system_clock::now() - time;
-//        TESTLOG() << std::chrono::duration_cast<std::chrono::milliseconds>(diff).count() << " ms";
-//
-//        TESTLOG() << "xrGetBlockHash";
-//        time = std::chrono::system_clock::now();
-//        Object obj = conn->getBlockHash(blocks-1);
-//        const Value & result = find_value(obj, "result");
-//        const std::string & blockhash = result.get_str();
-//        diff = std::chrono::system_clock::now() - time;
-//        TESTLOG() << std::chrono::duration_cast<std::chrono::milliseconds>(diff).count() << " ms";
-//
-//        TESTLOG() << "xrGetBlock";
-//        time = std::chrono::system_clock::now();
-//        conn->getBlock(blockhash);
-//        diff = std::chrono::system_clock::now() - time;
-//        TESTLOG() << std::chrono::duration_cast<std::chrono::milliseconds>(diff).count() << " ms";
-//
-//        TESTLOG() << "xrGetBlocks - 10 blocks";
-//        time = std::chrono::system_clock::now();
-//        conn->getBlocks({ "302a309d6b6c4a65e4b9ff06c7ea81bb17e985d00abdb01978ace62cc5e18421",
-//                          "175d2a428b5649c2a4732113e7f348ba22a0e69cc0a87631449d1d77cd6e1b04",
-//                          "34989eca8ed66ff53631294519e147a12f4860123b4bdba36feac6da8db492ab",
-//                          "504540bb0c63470e2007a1c0145d9c92513a1a309b6452445f21eb1f7223dc85",
-//                          "309eff15ee88810ddb779bad676ba1ac13e0b92ef3d335e63f83633cc3fa3c78",
-//                          "8bfe0b683a7cc5301f40252090f59c98850ee9d2337c446e7d64e7c141cbfdfa",
-//                          "fe5fe66e026624c2cc39024212c0e27ecbb50f83b96da007c7e5f28af0d340ec",
-//                          "4f4b6ab9094ff37edfd708834c70c9aa8e4c5bb72ba85ebe0d287018cbcbcbef",
-//                          "22e379280b11bdd006229a0192116a16a7ce22628435fe035788e414ae0ce5fa",
-//                          "f1450f0dac81bb08470217abe27a8303c34e31626b0a09afa851ffea5e35c788",
-//                          "695038b66bc7b1bcd2c4e60ef1017209a832e94fe78bbcd81a5c8fc166817457" });
-//        diff = std::chrono::system_clock::now() - time;
-//        TESTLOG() << std::chrono::duration_cast<std::chrono::milliseconds>(diff).count() << " ms";
-//
-//        TESTLOG() << "xrGetBlocks - 100 blocks";
-//        time = std::chrono::system_clock::now();
-//        conn->getBlocks({ });
-//        diff = std::chrono::system_clock::now() - time;
-//        TESTLOG() << std::chrono::duration_cast<std::chrono::milliseconds>(diff).count() << " ms";
-//
-//        TESTLOG() << "xrGetBlocks - 1000 blocks";
-//        time = std::chrono::system_clock::now();
-//        conn->getBlocks({ });
-//        diff = std::chrono::system_clock::now() - time;
-//        TESTLOG() << std::chrono::duration_cast<std::chrono::milliseconds>(diff).count() << " ms";
-//
-//        TESTLOG() << "xrGetTransactions - 10 blocks";
-//        time = std::chrono::system_clock::now();
-//        conn->getTransactions({ "24ff5506a30772acfb65012f1b3309d62786bc386be3b6ea853a798a71c010c8",
-//                                "24b6bcb44f045d7a4cf8cd47c94a14cc609352851ea973f8a47b20578391629f",
-//                                "66a5809c7090456965fe30280b88f69943e620894e1c4538a724ed9a89c769be",
-//                                "b981a5f85354342ad9d627b367f070a688d8cd054eb9df6e7549c9d388dd6070",
-//                                "7821c916acc487e019e11fab947aa3ace75b035831790f7d06796a92b6cb5f18",
-//                                "34e876cbe8d4e97290db089c680bd4b6c5d4f7f56f916d0c9bd4393739f273eb",
-//                                "e5d585f6d0fa35accda2113a55f5a090c746592b4afc1fae770bc1bb3dd0b6e7",
-//                                "28de1d6012490c8421480644dd644eb9c800bad33f76c477f792ef13d24baac1",
-//                                "fddd4e01390653b5cfea74ef717515738b04b63a33f646ed25210c1cc9a68385",
-//                                "b8d9cb15d6a1d8e0c79e3a7140f974185d08ce78d38bfdfe705ce80f48e57e7b" });
-//        diff = std::chrono::system_clock::now() - time;
-//        TESTLOG() << std::chrono::duration_cast<std::chrono::milliseconds>(diff).count() << " ms";
-//
-//        TESTLOG() << "xrGetTransactions - 100 blocks";
-//        time = std::chrono::system_clock::now();
-//        conn->getTransactions({ "" });
-//        diff = std::chrono::system_clock::now() - time;
-//        TESTLOG() << std::chrono::duration_cast<std::chrono::milliseconds>(diff).count() << " ms";
-//
-//        TESTLOG() << "xrGetTransactions - 1000 blocks";
-//        time = std::chrono::system_clock::now();
-//        conn->getTransactions({ "" });
-//        diff = std::chrono::system_clock::now() - time;
-//        TESTLOG() << std::chrono::duration_cast<std::chrono::milliseconds>(diff).count() << " ms";
-//
-//        TESTLOG() << "xrGetBlockAtTime";
-//        time = std::chrono::system_clock::now();
-//        conn->convertTimeToBlockCount("1241469643");
-//        diff = std::chrono::system_clock::now() - time;
-//        TESTLOG() << std::chrono::duration_cast<std::chrono::milliseconds>(diff).count() << " ms";
-//    }
-}
+    std::sort(latencies.begin(), latencies.end());
+    const auto total = static_cast<int64_t>(latencies.size());
+    auto percentile = [&latencies, total](const int p) -> double {
+        if (total == 0)
+            return 0;
+        return latencies[std::min(total - 1, total * p / 100)] / 1000.0;
+    };
+    const int64_t n = std::max(total, static_cast<int64_t>(1));
 
-bool XRouterServer::rateLimitExceeded(const std::string & nodeAddr, const std::string & key, const int & rateLimit) {
-    auto & app = App::instance();
-    return app.rateLimitExceeded(nodeAddr, key, app.getLastRequest(nodeAddr, key), rateLimit);
+    Object result;
+    result.emplace_back("clients", clients);
+    result.emplace_back("requests", total);
+    result.emplace_back("backendms", backendMs);
+    result.emplace_back("errors", errors);
+    result.emplace_back("seconds", seconds);
+    result.emplace_back("requestspersec", total / seconds);
+    result.emplace_back("latencyp50ms", percentile(50));
+    result.emplace_back("latencyp99ms", percentile(99));
+    result.emplace_back("latencymaxms", percentile(100));
+    result.emplace_back("signaturecheckus", static_cast<double>(verifyUs) / n); // per query
+    result.emplace_back("feecheckus", static_cast<double>(feeUs) / n);          // per query, without the broadcast
+    result.emplace_back("querybytes", bytes / n); // query and reply packets held while a query is in flight
+    return result;
 }
 
 bool XRouterServer::initKeyPair() {
@@ -987,11 +1518,17 @@ std::string XRouterServer::parseResult(const std::string & res) {
     return res;
 };
 
-std::string XRouterServer::parseResult(const std::vector<std::string> & resv) {
-    std::vector<std::string> parsed;
-    for (const auto & r : resv)
-        parsed.push_back(parseResult(r));
-    return "[" + boost::algorithm::join(parsed, ",") + "]";
+std::string XRouterServer::parseResult(std::vector<std::string> resv) {
+    // Append in place and free each backend reply once it's copied
+    std::string result("[");
+    for (auto & r : resv) {
+        if (result.size() > 1)
+            result += ',';
+        result += parseResult(r);
+        std::string().swap(r);
+    }
+    result += ']';
+    return result;
 };
 
 } // namespace xrouter
@@ -10,18 +10,423 @@
 #include <xrouter/xrouterconnector.h>
 #include <xrouter/xrouterconnectorbtc.h>
 #include <xrouter/xrouterconnectoreth.h>
+#include <xrouter/xrouterworker.h>
 
+#include <xbridge/util/timingwheel.h>
+
+#include <blockfilter.h>
 #include <consensus/validation.h>
 #include <net.h>
+#include <primitives/transaction.h>
 #include <sync.h>
+#include <threadinterrupt.h>
+#include <txmempool.h>
+#include <util/time.h>
 #include <validationinterface.h>
 
+#include <condition_variable>
+#include <list>
+#include <thread>
+#include <unordered_map>
+
 namespace xrouter
 {
 
 class WalletConnectorXRouter;
 typedef std::shared_ptr<WalletConnectorXRouter> WalletConnectorXRouterPtr;
 
+/**
+ * Recent backend replies by currency, command and parameters. Replies expire after their ttl,
+ * the least recently used replies are evicted when the cache exceeds its size in bytes.
+ */
+class XRouterResultCache
+{
+public:
+    explicit XRouterResultCache(const size_t maxBytes) : maxBytes(maxBytes) {}
+
+    /**
+     * Returns true if an unexpired reply is cached for the key.
+     * @param key
+     * @param reply
+     * @return
+     */
+    bool get(const std::string & key, std::string & reply) {
+        LOCK(mu);
+        auto it = index.find(key);
+        if (it == index.end())
+            return false;
+        if (it->second->expiry <= GetTime()) {
+            erase(it->second);
+            return false;
+        }
+        entries.splice(entries.begin(), entries, it->second); // most recently used
+        reply = it->second->reply;
+        return true;
+    }
+
+    /**
+     * Caches the reply for ttl seconds.
+     * @param key
+     * @param reply
+     * @param ttl
+     */
+    void put(const std::string & key, const std::string & reply, const int64_t ttl) {
+        if (key.size() + reply.size() > maxBytes)
+            return;
+        LOCK(mu);
+        auto it = index.find(key);
+        if (it != index.end())
+            erase(it->second);
+        entries.push_front(Entry{key, reply, GetTime() + ttl});
+        index[key] = entries.begin();
+        usage += key.size() + reply.size();
+        while (usage > maxBytes)
+            erase(std::prev(entries.end()));
+    }
+
+    void clear() {
+        LOCK(mu);
+        entries.clear();
+        index.clear();
+        usage = 0;
+    }
+
+private:
+    struct Entry {
+        std::string key;
+        std::string reply;
+        int64_t expiry;
+    };
+
+    void erase(std::list<Entry>::iterator it) EXCLUSIVE_LOCKS_REQUIRED(mu) {
+        usage -= it->key.size() + it->reply.size();
+        index.erase(it->key);
+        entries.erase(it);
+    }
+
+private:
+    const size_t maxBytes;
+    Mutex mu;
+    std::list<Entry> entries GUARDED_BY(mu); // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> index GUARDED_BY(mu);
+    size_t usage GUARDED_BY(mu){0};
+};
+
+/**
+ * Chain tip of each connector's backend, polled in the background so that block count
+ * and recent block hash requests are answered from memory. A tip is only used while the
+ * polls succeed, the recent block hashes are dropped when the tip changes.
+ */
+class XRouterTipTracker
+{
+public:
+    /**
+     * Records the polled tip of the currency's backend.
+     * @param currency
+     * @param height
+     * @param countReply backend reply to the block count call
+     * @param hashReply backend reply to the block hash call of the tip
+     */
+    void update(const std::string & currency, const int64_t height, const std::string & countReply,
+                const std::string & hashReply) {
+        LOCK(mu);
+        auto & tip = tips[currency];
+        if (tip.height != height || tip.hashReply != hashReply) {
+            tip.height = height;
+            tip.countReply = countReply;
+            tip.hashReply = hashReply;
+            tip.hashes.clear();
+            tip.hashes[height] = hashReply;
+            ++tip.generation;
+        }
+        tip.updated = GetTimeMillis();
+    }
+
+    /**
+     * Forgets the tip of a backend that failed to answer the poll.
+     * @param currency
+     */
+    void erase(const std::string & currency) {
+        LOCK(mu);
+        tips.erase(currency);
+    }
+
+    /**
+     * Returns true if the block count of the currency is known.
+     * @param currency
+     * @param reply
+     * @return
+     */
+    bool blockCount(const std::string & currency, std::string & reply) {
+        LOCK(mu);
+        auto tip = current(currency);
+        if (!tip)
+            return false;
+        reply = tip->countReply;
+        return true;
+    }
+
+    /**
+     * Returns true if the hash of the recent block is known, otherwise generation is the
+     * tip to pass to putBlockHash, 0 if the block isn't tracked.
+     * @param currency
+     * @param height
+     * @param reply
+     * @param generation
+     * @return
+     */
+    bool blockHash(const std::string & currency, const int64_t height, std::string & reply, uint64_t & generation) {
+        LOCK(mu);
+        generation = 0;
+        auto tip = current(currency);
+        if (!tip || height > tip->height || height <= tip->height - XROUTER_TIP_HASHES)
+            return false;
+        auto it = tip->hashes.find(height);
+        if (it == tip->hashes.end()) {
+            generation = tip->generation;
+            return false;
+        }
+        reply = it->second;
+        return true;
+    }
+
+    /**
+     * Stores the hash of a recent block unless the tip changed since blockHash returned
+     * the generation.
+     * @param currency
+     * @param height
+     * @param reply
+     * @param generation
+     */
+    void putBlockHash(const std::string & currency, const int64_t height, const std::string & reply,
+                      const uint64_t generation) {
+        LOCK(mu);
+        auto tip = current(currency);
+        if (tip && generation != 0 && tip->generation == generation)
+            tip->hashes[height] = reply;
+    }
+
+    void clear() {
+        LOCK(mu);
+        tips.clear();
+    }
+
+private:
+    struct Tip {
+        int64_t height{-1};
+        std::string countReply;
+        std::string hashReply;
+        std::map<int64_t, std::string> hashes; // recent blocks by height
+        uint64_t generation{0}; // changes with the tip
+        int64_t updated{0}; // milliseconds
+    };
+
+    Tip *current(const std::string & currency) EXCLUSIVE_LOCKS_REQUIRED(mu) {
+        auto it = tips.find(currency);
+        if (it == tips.end() || it->second.updated + XROUTER_TIP_MAX_AGE < GetTimeMillis())
+            return nullptr;
+        return &it->second;
+    }
+
+private:
+    Mutex mu;
+    std::map<std::string, Tip> tips GUARDED_BY(mu);
+};
+
+/**
+ * Fee payments accepted by the service node, by txid. A payment is accepted once, its id
+ * expires after the ttl on a timing wheel so that expiring ids doesn't scan the cache.
+ */
+class XRouterPaymentCache
+{
+public:
+    explicit XRouterPaymentCache(const int64_t ttl) : ttl(ttl) {}
+
+    /**
+     * Returns true if the payment was accepted.
+     * @param txid
+     * @return
+     */
+    bool has(const uint256 & txid) {
+        LOCK(mu);
+        expiry.advance(GetTime());
+        return expiry.has(txid);
+    }
+
+    /**
+     * Records the payment, returns false if it was accepted before.
+     * @param txid
+     * @return
+     */
+    bool add(const uint256 & txid) {
+        const auto now = GetTime();
+        LOCK(mu);
+        expiry.advance(now);
+        if (expiry.has(txid))
+            return false;
+        expiry.schedule(txid, now + ttl);
+        return true;
+    }
+
+    /**
+     * Forgets the payment, e.g. if it wasn't spent.
+     * @param txid
+     */
+    void remove(const uint256 & txid) {
+        LOCK(mu);
+        expiry.cancel(txid);
+    }
+
+    /**
+     * Drops the expired payments.
+     */
+    void expire() {
+        LOCK(mu);
+        expiry.advance(GetTime());
+    }
+
+private:
+    const int64_t ttl;
+    Mutex mu;
+    xbridge::TimingWheel<uint256, SaltedTxidHasher> expiry GUARDED_BY(mu);
+};
+
+/**
+ * Fee payments waiting to be sent to the mempool. Payments of concurrent requests are
+ * sent together: the request that finds no submission in progress sends every queued
+ * payment while the other requests wait for their result.
+ */
+class XRouterPaymentQueue
+{
+public:
+    /**
+     * Sends the payment to the mempool and the network.
+     * @param tx
+     * @return false if the payment was rejected
+     */
+    bool submit(const CTransactionRef & tx) {
+        auto payment = std::make_shared<Payment>();
+        payment->tx = tx;
+        WAIT_LOCK(mu, lock);
+        queue.push_back(payment);
+        while (!payment->done) {
+            if (submitting) {
+                cond.wait(lock);
+                continue;
+            }
+            submitting = true;
+            std::vector<std::shared_ptr<Payment>> batch;
+            batch.swap(queue);
+            lock.unlock();
+            std::vector<CTransactionRef> txs;
+            for (const auto & p : batch)
+                txs.push_back(p->tx);
+            const auto accepted = sendTransactionsBlockchain(txs);
+            lock.lock();
+            for (size_t i = 0; i < batch.size(); ++i) {
+                batch[i]->accepted = accepted[i];
+                batch[i]->done = true;
+            }
+            submitting = false;
+            cond.notify_all();
+        }
+        return payment->accepted;
+    }
+
+private:
+    struct Payment {
+        CTransactionRef tx;
+        bool accepted{false};
+        bool done{false};
+    };
+
+private:
+    Mutex mu;
+    std::condition_variable cond;
+    std::vector<std::shared_ptr<Payment>> queue GUARDED_BY(mu);
+    bool submitting GUARDED_BY(mu){false};
+};
+
+/**
+ * Open payment channels of clients by funding outpoint, with the last update of each
+ * channel. The service node settles a channel by signing and sending its last update.
+ */
+class XRouterPaymentChannels
+{
+public:
+    /**
+     * Returns true if the update pays at least the fee more than the last update of its channel.
+     * @param funding
+     * @param payment
+     * @param fee
+     * @return
+     */
+    bool accepts(const COutPoint & funding, const CAmount & payment, const CAmount & fee) {
+        LOCK(mu);
+        auto it = channels.find(funding);
+        if (it == channels.end())
+            return payment >= fee;
+        return !it->second.settling && payment - it->second.tx->vout[0].nValue >= fee;
+    }
+
+    /**
+     * Records the update, returns false if it doesn't pay more than the last update.
+     * @param lockTime
+     * @param tx
+     * @return
+     */
+    bool update(const uint32_t & lockTime, const CTransactionRef & tx) {
+        const auto & funding = tx->vin[0].prevout;
+        LOCK(mu);
+        auto it = channels.find(funding);
+        if (it == channels.end()) {
+            channels[funding] = Channel{tx, GetTime(), lockTime, false};
+            return true;
+        }
+        if (it->second.settling || tx->vout[0].nValue <= it->second.tx->vout[0].nValue)
+            return false;
+        it->second.tx = tx;
+        return true;
+    }
+
+    /**
+     * Returns the last updates of the channels opened before the time or locked until
+     * the height, the channels accept no updates until they're erased.
+     * @param opened
+     * @param height
+     * @return
+     */
+    std::vector<CTransactionRef> settle(const int64_t & opened, const int64_t & height) {
+        std::vector<CTransactionRef> txs;
+        LOCK(mu);
+        for (auto & item : channels) {
+            auto & channel = item.second;
+            if (!channel.settling && (channel.opened <= opened || channel.lockTime <= height)) {
+                channel.settling = true;
+                txs.push_back(channel.tx);
+            }
+        }
+        return txs;
+    }
+
+    void erase(const COutPoint & funding) {
+        LOCK(mu);
+        channels.erase(funding);
+    }
+
+private:
+    struct Channel {
+        CTransactionRef tx;
+        int64_t opened;
+        uint32_t lockTime;
+        bool settling;
+    };
+
+private:
+    Mutex mu;
+    std::map<COutPoint, Channel> channels GUARDED_BY(mu);
+};
+
 //*****************************************************************************
 //*****************************************************************************
 class XRouterServer
@@ -29,6 +434,7 @@ class XRouterServer
 public:
 
     XRouterServer() = default;
+    ~XRouterServer();
     
     /**
      * @brief start - run sessions, threads and services
@@ -116,9 +522,11 @@ public:
     std::string processDecodeRawTransaction(const std::string & currency, const std::vector<std::string> & params);
 
     /**
-     * @brief process xrGetTransactionsBloomFilter call on service node side
+     * @brief process xrGetTxBloomFilter call on service node side, lists the raw transactions
+     * paying to or spending from the addresses since the block number. Blocks are matched
+     * against compact filters first, only matching blocks are read.
      * @param currency blockchain to query
-     * @param params list of parameters
+     * @param params comma delimited addresses or hex scripts, block number
      * @return
      */
     std::vector<std::string> processGetTxBloomFilter(const std::string & currency, const std::vector<std::string> & params);
@@ -171,10 +579,10 @@ public:
     std::string processFetchReply(const std::string & uuid);
     
     /**
-     * @brief process payment transaction 
-     * @param feetx hex-encoded payment tx and additional data
+     * @brief process payment transaction, a payment is only accepted once
+     * @param payment payment tx returned by checkFeePayment
      */
-    bool processPayment(const std::string & feetx);
+    bool processPayment(const CTransactionRef & payment);
 
     /**
      * @brief Checks the payment
@@ -182,11 +590,19 @@ public:
      * @param paymentAddress the desired payment address
      * @param feetx hex-encoded payment tx and additional data
      * @param requiredFee fee to be paid
+     * @param payment decoded payment tx
      * @return true if fee payment is valid, otherwise false
      * @throws std::runtime_error in case of incorrect payment
      */
     bool checkFeePayment(const NodeAddr & nodeAddr, const std::string & paymentAddress,
-            const std::string & feetx, const CAmount & requiredFee);
+            const std::string & feetx, const CAmount & requiredFee, CTransactionRef & payment);
+
+    /**
+     * @brief Checks a payment channel update, see checkFeePayment
+     * @throws std::runtime_error in case of incorrect payment
+     */
+    bool checkChannelPayment(const std::string & paymentAddress, const CMutableTransaction & tx,
+            const CScript & redeemScript, const CAmount & requiredFee);
 
     /**
      * @brief returns own snode pubkey hash
@@ -194,27 +610,12 @@ public:
      */
     std::string getMyPaymentAddress();
     
-    /**
-     * @brief clears stored replies to queries periodically after timeout
-     * @return 
-     */
-    void clearHashedQueries();
-
     /**
      * Get a raw change address from the wallet.
      * @return
      */
     std::string changeAddress();
 
-    /**
-     * Returns true if the rate limit has been exceeded by the specified node for the command.
-     * @param nodeAddr
-     * @param key
-     * @param rateLimit
-     * @return
-     */
-    bool rateLimitExceeded(const std::string & nodeAddr, const std::string & key, const int & rateLimit);
-
     /**
      * Loads the exchange wallets specified in settings.
      * @return true if wallets loaded, otherwise false
@@ -263,7 +664,17 @@ public:
      */
     const std::vector<unsigned char> & privKey() const { return sprivkey; }
 
-    void runPerformanceTests();
+    /**
+     * Load test of the request path: synthetic clients sign queries, the server checks the
+     * signature and fee, runs the command against a fake backend (with the result cache)
+     * and signs the reply, the client checks and decodes the reply. Runs on its own server
+     * instance, the node's connectors aren't used.
+     * @param clients Number of concurrent clients
+     * @param requests Requests sent by each client
+     * @param backendMs Simulated backend response time in milliseconds
+     * @return requests/sec, latency percentiles, signature and fee check cost and bytes per in-flight query
+     */
+    static Object runPerformanceTests(const int clients, const int requests, const int backendMs);
 
 private:
     /**
@@ -285,7 +696,27 @@ private:
      * @param packet send message via xrouter
      * @param wallet walletconnector ID = currency ID (BTC, LTC etc)
      */
-    void sendPacketToClient(const std::string & uuid, const std::string & reply, CNode* pnode);
+    void sendPacketToClient(const std::string & uuid, const std::string & reply, CNode* pnode, const uint32_t flags = 0);
+
+    /**
+     * Signed reply packet, binary encoded if the flags of the query ask for it.
+     * @param uuid query UUID
+     * @param reply
+     * @param flags flags of the query (XROUTER_FLAG_*)
+     * @return
+     */
+    XRouterPacket replyPacket(const std::string & uuid, const std::string & reply, const uint32_t flags);
+
+    /**
+     * Runs the command against the currency's backend, replies are cached (see resultCacheTtl).
+     * @param command
+     * @param service currency
+     * @param params
+     * @param uuid query UUID
+     * @return reply
+     */
+    std::string processCommand(const XRouterCommand command, const std::string & service,
+                               const std::vector<std::string> & params, const std::string & uuid);
 
     /**
      * Loads the servicenode key from config.
@@ -293,6 +724,45 @@ private:
      */
     bool initKeyPair();
 
+    /**
+     * Polls the chain tip of each connector every XROUTER_TIP_POLL milliseconds until
+     * the server is stopped.
+     */
+    void trackTips();
+
+    /**
+     * Settles the payment channels that were open for XROUTER_CHANNEL_SETTLE_INTERVAL seconds
+     * or near their lock time every XROUTER_TIMER_SECONDS until the server is stopped, the
+     * open channels are settled on stop.
+     */
+    void settleChannels();
+
+    /**
+     * Transactions of the node's own chain paying to or spending from the scripts, matched
+     * against the basic block filter index.
+     * @param scripts
+     * @param number first block
+     * @param fetchlimit max blocks, 0 for no limit
+     * @param txs raw transactions
+     * @return false if the index isn't available or behind the chain
+     */
+    bool scanLocalChain(const GCSFilter::ElementSet & scripts, const int number, const int fetchlimit,
+                        std::vector<std::string> & txs);
+
+    /**
+     * Transactions of the connector's chain paying to or spending from the scripts. The
+     * compact filters of the backend blocks are built on first read and cached, blocks
+     * whose filter doesn't match aren't requested again.
+     * @param conn
+     * @param currency
+     * @param scripts
+     * @param number first block
+     * @param fetchlimit max blocks, 0 for no limit
+     * @return raw transactions
+     */
+    std::vector<std::string> scanConnector(const WalletConnectorXRouterPtr & conn, const std::string & currency,
+                                           const GCSFilter::ElementSet & scripts, const int number, const int fetchlimit);
+
     /**
      * Pulls the parameters out of the packet and adds to "parameters"
      * @param packet
@@ -315,42 +785,50 @@ private:
      * @param resv
      * @return
      */
-    std::string parseResult(const std::vector<std::string> & resv);
+    std::string parseResult(std::vector<std::string> resv);
 
 private:
     bool started{false};
 
     std::map<std::string, WalletConnectorXRouterPtr> connectors;
-    std::map<std::string, std::shared_ptr<boost::mutex> > connectorLocks;
+    std::map<std::string, std::shared_ptr<CSemaphore> > connectorSlots; // concurrent backend calls per currency
+    std::map<std::string, std::shared_ptr<PluginWorkerPool> > pluginWorkers; // by plugin name
 
-    std::map<std::string, std::pair<std::string, CAmount> > hashedQueries;
-    std::map<std::string, std::chrono::time_point<std::chrono::system_clock> > hashedQueriesDeadlines;
     std::map<NodeAddr, std::set<std::string> > inFlightQueries;
+    XRouterResultCache resultCache{XROUTER_RESULTCACHE_SIZE};
+    XRouterResultCache filterCache{XROUTER_FILTERCACHE_SIZE}; // compact filters of backend blocks by currency and hash
+    XRouterTipTracker tipTracker;
+    std::thread tipThread;
+    CThreadInterrupt tipInterrupt;
+    XRouterPaymentCache paymentCache{XROUTER_PAYMENTCACHE_TTL};
+    XRouterPaymentQueue paymentQueue;
+    XRouterPaymentChannels paymentChannels;
+    std::thread settleThread;
+    CThreadInterrupt settleInterrupt;
 
     std::vector<unsigned char> spubkey;
     std::vector<unsigned char> sprivkey;
 
     mutable Mutex _lock;
 
-    std::string getQuery(const std::string & uuid) {
-        LOCK(_lock);
-        return hashedQueries[uuid].first;
-    }
-    CAmount getQueryFee(const std::string & uuid) {
+    std::shared_ptr<CSemaphore> getConnectorSlots(const std::string & currency) {
         LOCK(_lock);
-        return hashedQueries[uuid].second;
+        return connectorSlots[currency];
     }
-    bool hasQuery(const std::string & uuid) {
+    bool hasConnectorSlots(const std::string & currency) {
         LOCK(_lock);
-        return hashedQueries.count(uuid);
+        return connectorSlots.count(currency);
     }
-    std::shared_ptr<boost::mutex> getConnectorLock(const std::string & currency) {
-        LOCK(_lock);
-        return connectorLocks[currency];
-    }
-    bool hasConnectorLock(const std::string & currency) {
+    /**
+     * Returns the worker pool of the plugin, a new pool replaces the old one if the plugin's
+     * command or workers setting changed.
+     */
+    std::shared_ptr<PluginWorkerPool> pluginWorkerPool(const std::string & name, const std::string & command, const int workers) {
         LOCK(_lock);
-        return connectorLocks.count(currency);
+        auto & pool = pluginWorkers[name];
+        if (!pool || pool->getCommand() != command || pool->getMaxWorkers() != workers)
+            pool = std::make_shared<PluginWorkerPool>(command, workers);
+        return pool;
     }
 
 };
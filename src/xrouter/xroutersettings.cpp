@@ -24,6 +24,13 @@ static std::set<std::string> acceptableParameterTypes{"string","bool","int","dou
 static const std::string privatePrefix{"private::"};
 static const std::string privateComment{"#!"};
 
+// Commands that are looked up in the compiled config
+static const std::vector<XRouterCommand> compiledCommands{
+    xrDefault, xrGetBlockCount, xrGetBlockHash, xrGetBlock, xrGetTransaction, xrSendTransaction,
+    xrGetTxBloomFilter, xrGenerateBloomFilter, xrGetBlocks, xrGetTransactions, xrGetBlockAtTime,
+    xrDecodeRawTransaction, xrGetBalance, xrService,
+};
+
 static int maxFetchLimit(const int & fl) {
     if (fl < 0)
         return std::numeric_limits<int>::max();
@@ -167,6 +174,7 @@ void XRouterSettings::loadWallets() {
             LOCK(mu);
             wallets.insert(w);
         }
+    compile();
 }
 
 void XRouterSettings::loadPlugins()
@@ -185,6 +193,7 @@ void XRouterSettings::loadPlugins()
             LOCK(mu);
             pluginList.insert(s);
         }
+    compile();
 }
 
 bool XRouterSettings::hasPlugin(const std::string & name)
@@ -215,24 +224,9 @@ void XRouterSettings::defaultPaymentAddress(const std::string & paymentAddress)
 
 bool XRouterSettings::isAvailableCommand(XRouterCommand c, const std::string & service)
 {
-    // Handle plugin
-    if (c == xrService) {
-        if (!hasPlugin(service))
-            return false;
-        auto ps = getPluginSettings(service); // check if plugin is disabled
-        if (ps)
-            return !ps->disabled();
-        return false; // something's wrong with the plugin, report that it's disabled
-    }
-
-    // XRouter command...
-    if (service.empty())
-        return false;
-    if (!hasWallet(service)) // check if wallet supported
-        return false;
-    // Wallet commands are implicitly enabled until disabled
-    auto disabled = get<bool>(service + xrdelimiter + std::string(XRouterCommand_ToString(c)) + ".disabled", false);
-    return !disabled;
+    std::shared_ptr<const CompiledConfig> cfg;
+    CommandConfig tmp;
+    return commandConfig(c, service, cfg, tmp).available;
 }
 
 std::string XRouterSettings::host(XRouterCommand c, const std::string & service) {
@@ -275,40 +269,16 @@ int XRouterSettings::port(XRouterCommand c, const std::string & service) {
 
 double XRouterSettings::maxFee(XRouterCommand c, const std::string & service, double def)
 {
-    const std::string cstr{XRouterCommand_ToString(c)};
-    auto res = get<double>("Main.maxfee", def);
-
-    if (c == xrService) { // Handle plugin
-        if (!service.empty())
-            res = get<double>(cstr + xrdelimiter + service + ".maxfee", res);
-    } else {
-        res = get<double>(cstr + ".maxfee", res);
-        if (!service.empty()) {
-            res = get<double>(service + ".maxfee", res);
-            res = get<double>(service + xrdelimiter + cstr + ".maxfee", res);
-        }
-    }
-
-    return res;
+    std::shared_ptr<const CompiledConfig> cfg;
+    CommandConfig tmp;
+    return commandConfig(c, service, cfg, tmp).maxFee.get(def);
 }
 
 int XRouterSettings::commandTimeout(XRouterCommand c, const std::string & service, int def)
 {
-    const std::string cstr{XRouterCommand_ToString(c)};
-    auto res = get<int>("Main.timeout", def);
-
-    if (c == xrService) { // Handle plugin
-        if (!service.empty())
-            res = get<int>(cstr + xrdelimiter + service + ".timeout", res);
-    } else {
-        res = get<int>(cstr + ".timeout", res);
-        if (!service.empty()) {
-            res = get<int>(service + ".timeout", res);
-            res = get<int>(service + xrdelimiter + cstr + ".timeout", res);
-        }
-    }
-
-    return res;
+    std::shared_ptr<const CompiledConfig> cfg;
+    CommandConfig tmp;
+    return commandConfig(c, service, cfg, tmp).timeout.get(def);
 }
 
 int XRouterSettings::confirmations(XRouterCommand c, std::string service, int def) {
@@ -316,21 +286,9 @@ int XRouterSettings::confirmations(XRouterCommand c, std::string service, int de
         return def;
     def = std::max(def, 1); // default must be at least 1 confirmation
 
-    const std::string cstr{XRouterCommand_ToString(c)};
-    auto res = get<int>("Main.consensus", def);
-
-    if (c == xrService) { // Handle plugin
-        if (!service.empty())
-            res = get<int>(cstr + xrdelimiter + service + ".consensus", res);
-    } else {
-        res = get<int>(cstr + ".consensus", res);
-        if (!service.empty()) {
-            res = get<int>(service + ".consensus", res);
-            res = get<int>(service + xrdelimiter + cstr + ".consensus", res);
-        }
-    }
-
-    return res;
+    std::shared_ptr<const CompiledConfig> cfg;
+    CommandConfig tmp;
+    return commandConfig(c, service, cfg, tmp).confirmations.get(def);
 }
 
 double XRouterSettings::defaultFee() {
@@ -339,88 +297,49 @@ double XRouterSettings::defaultFee() {
 
 double XRouterSettings::commandFee(XRouterCommand c, const std::string & service, double def)
 {
-    // Handle plugin
-    if (c == xrService && hasPlugin(service)) {
-        auto ps = getPluginSettings(service);
-        if (ps->has("fee"))
-            return ps->fee();
-        else
-            return get<double>("Main.fee", def);
-    }
+    std::shared_ptr<const CompiledConfig> cfg;
+    CommandConfig tmp;
+    return commandConfig(c, service, cfg, tmp).fee.get(def);
+}
 
-    auto res = get<double>("Main.fee", def);
-    res = get<double>(std::string(XRouterCommand_ToString(c)) + ".fee", res);
-    if (!service.empty()) {
-        res = get<double>(service + ".fee", res);
-        res = get<double>(service + xrdelimiter + std::string(XRouterCommand_ToString(c)) + ".fee", res);
-    }
-    return res;
+bool XRouterSettings::hedgeRequests(XRouterCommand c, const std::string & service, bool def)
+{
+    std::shared_ptr<const CompiledConfig> cfg;
+    CommandConfig tmp;
+    return commandConfig(c, service, cfg, tmp).hedgeRequests.get(def);
 }
 
 int XRouterSettings::commandFetchLimit(XRouterCommand c, const std::string & service, int def)
 {
-    // Handle plugin
-    if (c == xrService && hasPlugin(service)) {
-        auto ps = getPluginSettings(service);
-        if (ps->has("fetchlimit"))
-            return maxFetchLimit(ps->fetchLimit());
-        else
-            return maxFetchLimit(get<int>("Main.fetchlimit", def));
-    }
-
-    auto res = get<int>("Main.fetchlimit", def);
-    res = get<int>(std::string(XRouterCommand_ToString(c)) + ".fetchlimit", res);
-    if (!service.empty()) {
-        res = get<int>(service + ".fetchlimit", res);
-        res = get<int>(service + xrdelimiter + std::string(XRouterCommand_ToString(c)) + ".fetchlimit", res);
-    }
-    return maxFetchLimit(res);
-}    
+    std::shared_ptr<const CompiledConfig> cfg;
+    CommandConfig tmp;
+    return maxFetchLimit(commandConfig(c, service, cfg, tmp).fetchLimit.get(def));
+}
 
 int XRouterSettings::clientRequestLimit(XRouterCommand c, const std::string & service, int def) {
-    // Handle plugin
-    if (c == xrService && hasPlugin(service)) {
-        auto ps = getPluginSettings(service);
-        if (ps->has("clientrequestlimit"))
-            return ps->clientRequestLimit();
-        else
-            return get<double>("Main.clientrequestlimit", def);
-    }
+    std::shared_ptr<const CompiledConfig> cfg;
+    CommandConfig tmp;
+    return commandConfig(c, service, cfg, tmp).clientRequestLimit.get(def);
+}
 
-    auto res = get<int>("Main.clientrequestlimit", def);
-    res = get<int>(std::string(XRouterCommand_ToString(c)) + ".clientrequestlimit", res);
-    if (!service.empty()) {
-        res = get<int>(service + ".clientrequestlimit", res);
-        res = get<int>(service + xrdelimiter + std::string(XRouterCommand_ToString(c)) + ".clientrequestlimit", res);
-    }
-    return res;
+int XRouterSettings::clientRequestBurst(XRouterCommand c, const std::string & service, int def) {
+    std::shared_ptr<const CompiledConfig> cfg;
+    CommandConfig tmp;
+    return std::max(commandConfig(c, service, cfg, tmp).clientRequestBurst.get(def), 1);
 }
 
 std::string XRouterSettings::paymentAddress(XRouterCommand c, const std::string & service) {
-    std::string def;
-    static const auto s_paymentaddress = "paymentaddress";
-    static const auto s_mainpaymentaddress = "Main.paymentaddress";
-
-    // Handle plugin
-    if (c == xrService && hasPlugin(service)) {
-        auto ps = getPluginSettings(service);
-        if (ps->has(s_paymentaddress) && !ps->paymentAddress().empty())
-            return ps->paymentAddress();
-        else
-            return get<std::string>(s_mainpaymentaddress, def);
-    }
+    std::shared_ptr<const CompiledConfig> cfg;
+    CommandConfig tmp;
+    const auto & cc = commandConfig(c, service, cfg, tmp);
+    if (cc.paymentAddress.set || cc.plugin)
+        return cc.paymentAddress.value;
 
-    auto snode = sn::ServiceNodeMgr::instance().getSn(node);
     // default payment address is snode vin address
+    auto snode = sn::ServiceNodeMgr::instance().getSn(getNode());
     if (!snode.isNull())
-        def = EncodeDestination(CTxDestination(snode.getPaymentAddress()));
-    auto res = get<std::string>(s_mainpaymentaddress, def);
-    res = get<std::string>(std::string(XRouterCommand_ToString(c)) + "." + s_paymentaddress, res);
-    if (!service.empty()) {
-        res = get<std::string>(service + "." + s_paymentaddress, res);
-        res = get<std::string>(service + xrdelimiter + std::string(XRouterCommand_ToString(c)) + "." + s_paymentaddress, res);
-    }
-    return res;
+        return EncodeDestination(CTxDestination(snode.getPaymentAddress()));
+    return "";
 }
 
 int XRouterSettings::configSyncTimeout()
@@ -429,6 +348,23 @@ int XRouterSettings::configSyncTimeout()
     return res;
 }
 
+bool XRouterSettings::paymentChannels()
+{
+    return get<bool>("Main.paymentchannels", false);
+}
+
+double XRouterSettings::paymentChannelFunding()
+{
+    return get<double>("Main.paymentchannelfunding", 0);
+}
+
+int XRouterSettings::connectorConcurrency(const std::string & currency)
+{
+    auto res = get<int>("Main.connectorconcurrency", XROUTER_DEFAULT_CONNECTORCONCURRENCY);
+    res = get<int>(currency + ".connectorconcurrency", res);
+    return res;
+}
+
 std::map<std::string, double> XRouterSettings::feeSchedule() {
 
     double fee = defaultFee();
@@ -470,6 +406,135 @@ std::map<std::string, double> XRouterSettings::feeSchedule() {
     return s;
 }
 
+void XRouterSettings::compile()
+{
+    // Every service that may have settings of its own
+    std::set<std::string> services;
+    {
+        LOCK(mu);
+        services.insert(wallets.begin(), wallets.end());
+        services.insert(pluginList.begin(), pluginList.end());
+        for (const auto & p : m_pt) {
+            std::vector<std::string> parts;
+            xrsplit(p.first, xrdelimiter, parts);
+            if (parts.size() > 1 && parts[0] == XRouterCommand_ToString(xrService))
+                services.insert(parts[1]);
+            else if (!parts.empty())
+                services.insert(parts[0]);
+        }
+    }
+
+    auto cfg = std::make_shared<CompiledConfig>();
+    for (const auto c : compiledCommands) {
+        cfg->defaults[c] = compileCommand(c, "");
+        for (const auto & service : services)
+            cfg->services[service][c] = compileCommand(c, service);
+    }
+    std::atomic_store(&compiled, std::shared_ptr<const CompiledConfig>(cfg));
+}
+
+XRouterSettings::CommandConfig XRouterSettings::compileCommand(XRouterCommand c, const std::string & service)
+{
+    const std::string cstr{XRouterCommand_ToString(c)};
+    CommandConfig cc;
+
+    // Later keys override earlier ones
+    auto keys = [&](const std::string & key) -> std::vector<std::string> {
+        if (service.empty())
+            return {"Main." + key, cstr + "." + key};
+        return {"Main." + key, cstr + "." + key, service + "." + key, service + xrdelimiter + cstr + "." + key};
+    };
+    auto pluginKeys = [&](const std::string & key) -> std::vector<std::string> {
+        if (service.empty())
+            return {"Main." + key};
+        return {"Main." + key, cstr + xrdelimiter + service + "." + key};
+    };
+
+    if (c == xrService) { // Handle plugin
+        resolve(cc.timeout, pluginKeys("timeout"));
+        resolve(cc.hedgeRequests, pluginKeys("hedgerequests"));
+        resolve(cc.maxFee, pluginKeys("maxfee"));
+        resolve(cc.confirmations, pluginKeys("consensus"));
+    } else {
+        resolve(cc.timeout, keys("timeout"));
+        resolve(cc.hedgeRequests, keys("hedgerequests"));
+        resolve(cc.maxFee, keys("maxfee"));
+        resolve(cc.confirmations, keys("consensus"));
+    }
+
+    auto ps = c == xrService && hasPlugin(service) ? getPluginSettings(service) : nullptr;
+    if (ps) {
+        cc.plugin = true;
+        cc.available = !ps->disabled();
+        auto fromPlugin = [](Setting<int> & s, const int value) { s.set = true; s.value = value; };
+        if (ps->has("fee")) {
+            cc.fee.set = true;
+            cc.fee.value = ps->fee();
+        } else
+            resolve(cc.fee, {"Main.fee"});
+        if (ps->has("fetchlimit"))
+            fromPlugin(cc.fetchLimit, ps->fetchLimit());
+        else
+            resolve(cc.fetchLimit, {"Main.fetchlimit"});
+        if (ps->has("clientrequestlimit"))
+            fromPlugin(cc.clientRequestLimit, ps->clientRequestLimit());
+        else
+            resolve(cc.clientRequestLimit, {"Main.clientrequestlimit"});
+        if (ps->has("clientrequestburst"))
+            fromPlugin(cc.clientRequestBurst, ps->clientRequestBurst());
+        else
+            resolve(cc.clientRequestBurst, {"Main.clientrequestburst"});
+        if (ps->has("paymentaddress") && !ps->paymentAddress().empty()) {
+            cc.paymentAddress.set = true;
+            cc.paymentAddress.value = ps->paymentAddress();
+        } else
+            resolve(cc.paymentAddress, {"Main.paymentaddress"});
+        return cc;
+    }
+
+    // Wallet commands are implicitly enabled until disabled
+    if (c != xrService && !service.empty() && hasWallet(service)) {
+        Setting<bool> disabled;
+        resolve(disabled, {service + xrdelimiter + cstr + ".disabled"});
+        cc.available = !disabled.get(false);
+    }
+    resolve(cc.fee, keys("fee"));
+    resolve(cc.fetchLimit, keys("fetchlimit"));
+    resolve(cc.clientRequestLimit, keys("clientrequestlimit"));
+    resolve(cc.clientRequestBurst, keys("clientrequestburst"));
+    resolve(cc.paymentAddress, keys("paymentaddress"));
+    return cc;
+}
+
+template <typename T>
+void XRouterSettings::resolve(Setting<T> & s, const std::vector<std::string> & keys)
+{
+    LOCK(mu);
+    for (const auto & key : keys) {
+        const auto value = m_pt.get_optional<T>(key);
+        if (value) {
+            s.set = true;
+            s.value = *value;
+        }
+    }
+}
+
+const XRouterSettings::CommandConfig & XRouterSettings::commandConfig(XRouterCommand c, const std::string & service,
+                                                                      std::shared_ptr<const CompiledConfig> & cfg,
+                                                                      CommandConfig & tmp)
+{
+    cfg = std::atomic_load(&compiled);
+    if (cfg) {
+        const auto it = service.empty() ? cfg->services.end() : cfg->services.find(service);
+        const auto & commands = it != cfg->services.end() ? it->second : cfg->defaults;
+        const auto cit = commands.find(c);
+        if (cit != commands.end())
+            return cit->second;
+    }
+    tmp = compileCommand(c, service); // not compiled yet or not a service command
+    return tmp;
+}
+
 bool XRouterSettings::loadPlugin(const std::string & name)
 {
     if (!ismine) // only load our own configs
@@ -497,21 +562,24 @@ boost::filesystem::path XRouterSettings::pluginPath() const
 
 void XRouterSettings::genPublic()
 {
-    LOCK(mu);
-    std::string publictext;
-    std::vector<std::string> lines;
-    boost::split(lines, rawtext, boost::is_any_of("\n"));
+    {
+        LOCK(mu);
+        std::string publictext;
+        std::vector<std::string> lines;
+        boost::split(lines, rawtext, boost::is_any_of("\n"));
+
+        // Exclude commands with the private prefixes
+        std::regex rprivateComment("^\\s*"+privateComment+".*$");
+        std::smatch m;
+        for (const std::string & line : lines) {
+            if (line.find(privatePrefix) != std::string::npos || std::regex_match(line, m, rprivateComment))
+                continue;
+            publictext += line + "\n";
+        }
 
-    // Exclude commands with the private prefixes
-    std::regex rprivateComment("^\\s*"+privateComment+".*$");
-    std::smatch m;
-    for (const std::string & line : lines) {
-        if (line.find(privatePrefix) != std::string::npos || std::regex_match(line, m, rprivateComment))
-            continue;
-        publictext += line + "\n";
+        pubtext = publictext;
     }
-
-    pubtext = publictext;
+    compile();
 }
 
 ///////////////////////////////////
@@ -612,6 +680,11 @@ int XRouterPluginSettings::clientRequestLimit() {
     return res;
 }
 
+int XRouterPluginSettings::clientRequestBurst() {
+    int res = get<int>("clientrequestburst", 1);
+    return res;
+}
+
 int XRouterPluginSettings::fetchLimit() {
     int res = get<int>("fetchlimit", XROUTER_DEFAULT_FETCHLIMIT);
     return maxFetchLimit(res);
@@ -656,6 +729,12 @@ std::string XRouterPluginSettings::commandArgs() {
     return t;
 }
 
+int XRouterPluginSettings::workers() {
+    auto t = get<int>("workers", XROUTER_PLUGIN_WORKERS);
+    t = get<int>(privatePrefix + "workers", t);
+    return std::max(1, std::min(t, XROUTER_PLUGIN_MAX_WORKERS));
+}
+
 bool XRouterPluginSettings::hasCustomResponse() {
     return has("response") || has(privatePrefix + "response");
 }
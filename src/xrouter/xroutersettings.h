@@ -11,7 +11,10 @@
 #include <netaddress.h>
 #include <sync.h>
 
+#include <map>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <boost/filesystem.hpp>
@@ -113,6 +116,7 @@ public:
     double fee();
     std::vector<std::string> parameters();
     int clientRequestLimit();
+    int clientRequestBurst();
     int fetchLimit();
     int commandTimeout();
     std::string paymentAddress();
@@ -121,6 +125,7 @@ public:
     std::string container();
     std::string command();
     std::string commandArgs();
+    int workers();
     bool hasCustomResponse();
     std::string customResponse();
 
@@ -175,8 +180,11 @@ public:
     bool hasPlugin(const std::string & name);
 
     void addPlugin(const std::string &name, XRouterPluginSettingsPtr s) {
-        LOCK(mu);
-        plugins[name] = s; pluginList.insert(name);
+        {
+            LOCK(mu);
+            plugins[name] = s; pluginList.insert(name);
+        }
+        compile();
     }
 
     XRouterPluginSettingsPtr getPluginSettings(const std::string & name) {
@@ -189,12 +197,17 @@ public:
     int port(XRouterCommand c, const std::string & service="");
     double commandFee(XRouterCommand c, const std::string & service, double def=0.0);
     int commandTimeout(XRouterCommand c, const std::string & service, int def=XROUTER_DEFAULT_TIMEOUT);
+    bool hedgeRequests(XRouterCommand c, const std::string & service, bool def=false); // query a backup node when replies are late
     int commandFetchLimit(XRouterCommand c, const std::string & service, int def=XROUTER_DEFAULT_FETCHLIMIT);
     double maxFee(XRouterCommand c, const std::string& currency="", double def=0.0);
     int clientRequestLimit(XRouterCommand c, const std::string & service, int def=-1); // -1 is no limit
+    int clientRequestBurst(XRouterCommand c, const std::string & service, int def=1); // requests allowed at once
     int confirmations(XRouterCommand c, std::string currency="", int def=XROUTER_DEFAULT_CONFIRMATIONS); // 1 confirmation default
     std::string paymentAddress(XRouterCommand c, const std::string & service="");
     int configSyncTimeout();
+    bool paymentChannels(); // the service node accepts fees over payment channels
+    double paymentChannelFunding(); // amount a client funds a payment channel with, 0 pays each request with a transaction
+    int connectorConcurrency(const std::string & currency); // concurrent calls to the currency's backend
 
     double defaultFee();
     std::map<std::string, double> feeSchedule();
@@ -203,10 +216,52 @@ protected:
     void genPublic() override;
 
 private:
+    /**
+     * Command settings resolved from the Main, command, service and service::command
+     * sections. Settings that aren't in the config are unset so that the caller's
+     * default applies.
+     */
+    template <typename T>
+    struct Setting {
+        bool set{false};
+        T value{};
+        T get(const T & def) const { return set ? value : def; }
+    };
+    struct CommandConfig {
+        bool available{false};
+        bool plugin{false}; // settings come from the plugin config
+        Setting<double> fee;
+        Setting<int> timeout;
+        Setting<bool> hedgeRequests;
+        Setting<int> fetchLimit;
+        Setting<double> maxFee;
+        Setting<int> clientRequestLimit;
+        Setting<int> clientRequestBurst;
+        Setting<int> confirmations;
+        Setting<std::string> paymentAddress;
+    };
+    typedef std::map<XRouterCommand, CommandConfig> CommandConfigs;
+    /**
+     * Immutable lookup table of the command settings of every service in the config,
+     * rebuilt and swapped in whenever the config, wallets or plugins change.
+     */
+    struct CompiledConfig {
+        CommandConfigs defaults; // services without a section of their own
+        std::unordered_map<std::string, CommandConfigs> services;
+    };
+
+    void compile();
+    CommandConfig compileCommand(XRouterCommand c, const std::string & service);
+    template <typename T>
+    void resolve(Setting<T> & s, const std::vector<std::string> & keys);
+    const CommandConfig & commandConfig(XRouterCommand c, const std::string & service,
+                                        std::shared_ptr<const CompiledConfig> & cfg, CommandConfig & tmp);
+
     boost::filesystem::path pluginPath() const;
     bool loadPlugin(const std::string & name);
 
 private:
+    std::shared_ptr<const CompiledConfig> compiled; // accessed with std::atomic_load/atomic_store
     std::map<std::string, XRouterPluginSettingsPtr> plugins;
     std::set<std::string> pluginList;
     std::set<std::string> wallets;
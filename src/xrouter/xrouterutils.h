@@ -9,11 +9,13 @@
 #include <xrouter/xroutererror.h>
 
 #include <streams.h>
+#include <univalue.h>
 #include <wallet/wallet.h>
 
 #include <vector>
 #include <string>
 #include <cstdint>
+#include <functional>
 
 #include <json/json_spirit.h>
 
@@ -109,13 +111,41 @@ std::string CallRPC(const std::string & rpcuser, const std::string & rpcpasswd,
                            const std::string & rpcip, const std::string & rpcport,
                            const std::string & strMethod, const Array & params,
                            const std::string & jsonver="");
+// Calls the method once per parameter list in json-rpc batches, returns the reply of each call in order
+std::vector<std::string> CallRPCBatch(const std::string & rpcuser, const std::string & rpcpasswd,
+                                      const std::string & rpcip, const std::string & rpcport,
+                                      const std::string & strMethod, const std::vector<Array> & params,
+                                      const std::string & jsonver="");
+// Closes the idle keep-alive connections used by CallRPC and CallXRouterUrl
+void ClearHTTPConnections();
+
+// Binary reply encoding (XROUTER_FLAG_BINARY_REPLY), returns false if the reply isn't json
+bool EncodeBinaryReply(const std::string & reply, std::vector<unsigned char> & encoded);
+bool DecodeBinaryReply(const unsigned char *data, const size_t size, UniValue & reply);
 
 // Payment functions
 bool createAndSignTransaction(const std::string & address, const CAmount & amount, std::string & raw_tx);
 void unlockOutputs(const std::string & tx);
 bool sendTransactionBlockchain(const std::string & rawtx, std::string & txid);
+std::vector<bool> sendTransactionsBlockchain(const std::vector<CTransactionRef> & txs); // true for each accepted tx
 CMutableTransaction decodeTransaction(const std::string & tx);
+CAmount paymentAmount(const CMutableTransaction & tx, const std::string & address); // sum of the outputs to the address
 double checkPayment(const std::string & rawtx, const std::string & address, const CAmount & expectedFee);
+CAmount checkPayment(const CMutableTransaction & tx, const std::string & address, const CAmount & expectedFee,
+                     const std::function<bool(const uint256 &)> & knownTx = nullptr); // inputs of known txs aren't looked up
+
+// Payment channel functions. A client funds a channel to a service node once, each paid
+// request then sends a spend of the funding signed by the client that pays the service
+// node the fees so far. The service node adds its signature to settle the last update,
+// the client can take the funding back after the lock time.
+CScript paymentChannelScript(const CPubKey & clientKey, const CPubKey & snodeKey, const uint32_t & lockTime);
+bool decodePaymentChannelScript(const CScript & script, CPubKey & clientKey, CPubKey & snodeKey, uint32_t & lockTime);
+bool decodePaymentChannelUpdate(const CMutableTransaction & tx, CScript & redeemScript); // true if the client signature is valid
+bool signPaymentChannelUpdate(CMutableTransaction & tx, const CKey & snodeKey);
+void checkPaymentChannelUpdate(const CMutableTransaction & tx, const CTxOut & funding, const CKey & snodeKey); // throws std::runtime_error if the signed update wouldn't be accepted
+bool createChannelPayment(const NodeAddr & node, const CPubKey & snodeKey, const std::string & address,
+                          const CAmount & fee, const CAmount & funding, std::string & raw_tx);
+void refundPaymentChannels(); // sends the refunds of channels past their lock time
 
 // Miscellaneous functions
 CAmount to_amount(double val);
@@ -0,0 +1,212 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <xrouter/xrouterworker.h>
+
+#include <xrouter/xroutererror.h>
+#include <xrouter/xrouterlogger.h>
+
+#include <util/memory.h>
+#include <util/time.h>
+
+#include <algorithm>
+#include <chrono>
+
+#ifndef WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace xrouter
+{
+
+//! Longest reply line accepted from a worker
+static const size_t MAX_WORKER_REPLY = 16 * 1024 * 1024;
+
+PluginWorkerPool::PluginWorkerPool(std::string command, const int maxWorkers)
+    : command(std::move(command)), maxWorkers(std::max(1, maxWorkers)) { }
+
+PluginWorkerPool::~PluginWorkerPool()
+{
+    // Calls hold a reference to the pool, only idle workers are left
+    LOCK(mu);
+    for (auto & worker : idle)
+        terminate(worker);
+}
+
+std::string PluginWorkerPool::call(const std::string & request, const int timeout)
+{
+#ifdef WIN32
+    throw XRouterError("Worker plugins are not supported on Windows", UNSUPPORTED_SERVICE);
+#else
+    const int64_t deadline = GetTimeMillis() + static_cast<int64_t>(timeout) * 1000;
+
+    WorkerPtr worker;
+    {
+        WAIT_LOCK(mu, lock);
+        while (busy >= maxWorkers) {
+            if (cond.wait_for(lock, std::chrono::milliseconds(std::max<int64_t>(deadline - GetTimeMillis(), 0))) == std::cv_status::timeout
+                && busy >= maxWorkers)
+                throw XRouterError("All plugin workers are busy", SERVER_TIMEOUT);
+        }
+        ++busy;
+        if (!idle.empty()) {
+            worker = std::move(idle.back());
+            idle.pop_back();
+        }
+    }
+    // Gives the worker back to the pool, a failed worker is not reused
+    auto release = [this](WorkerPtr & w) {
+        LOCK(mu);
+        if (w)
+            idle.push_back(std::move(w));
+        --busy;
+        cond.notify_one();
+    };
+
+    if (!worker)
+        worker = spawn();
+    if (!worker) {
+        release(worker);
+        throw XRouterError("Failed to start the plugin worker", INTERNAL_SERVER_ERROR);
+    }
+
+    std::string reply;
+    if (!writeAll(*worker, request + "\n", deadline) || !readLine(*worker, reply, deadline)) {
+        const bool timedOut = GetTimeMillis() >= deadline;
+        ERR() << "Plugin worker " << worker->pid << " of \"" << command << "\" "
+              << (timedOut ? "timed out" : "failed") << ", restarting it";
+        terminate(worker);
+        release(worker);
+        if (timedOut)
+            throw XRouterError("Plugin worker timed out", SERVER_TIMEOUT);
+        throw XRouterError("Plugin worker failed", INTERNAL_SERVER_ERROR);
+    }
+    release(worker);
+    return reply;
+#endif
+}
+
+PluginWorkerPool::WorkerPtr PluginWorkerPool::spawn()
+{
+#ifdef WIN32
+    return nullptr;
+#else
+    int in[2], out[2];
+    if (pipe(in) != 0)
+        return nullptr;
+    if (pipe(out) != 0) {
+        close(in[0]); close(in[1]);
+        return nullptr;
+    }
+    // The node's ends must not leak into other children
+    fcntl(in[1], F_SETFD, FD_CLOEXEC);
+    fcntl(out[0], F_SETFD, FD_CLOEXEC);
+    const long maxfd = sysconf(_SC_OPEN_MAX);
+
+    const pid_t pid = fork();
+    if (pid == 0) {
+        // Only async-signal-safe calls until exec
+        dup2(in[0], STDIN_FILENO);
+        dup2(out[1], STDOUT_FILENO);
+        for (long fd = 3; fd < maxfd; ++fd)
+            close(static_cast<int>(fd));
+        execl("/bin/sh", "sh", "-c", command.c_str(), static_cast<char*>(nullptr));
+        _exit(127);
+    }
+    close(in[0]);
+    close(out[1]);
+    if (pid < 0) {
+        close(in[1]);
+        close(out[0]);
+        return nullptr;
+    }
+    fcntl(in[1], F_SETFL, fcntl(in[1], F_GETFL) | O_NONBLOCK);
+    fcntl(out[0], F_SETFL, fcntl(out[0], F_GETFL) | O_NONBLOCK);
+
+    auto worker = MakeUnique<Worker>();
+    worker->pid = pid;
+    worker->in = in[1];
+    worker->out = out[0];
+    LOG() << "Started plugin worker " << pid << ": " << command;
+    return worker;
+#endif
+}
+
+void PluginWorkerPool::terminate(WorkerPtr & worker)
+{
+#ifndef WIN32
+    if (!worker)
+        return;
+    close(worker->in);
+    close(worker->out);
+    kill(worker->pid, SIGKILL);
+    while (waitpid(worker->pid, nullptr, 0) == -1 && errno == EINTR) { }
+    worker.reset();
+#endif
+}
+
+bool PluginWorkerPool::writeAll(Worker & worker, const std::string & data, const int64_t deadline)
+{
+#ifdef WIN32
+    return false;
+#else
+    size_t written{0};
+    while (written < data.size()) {
+        const ssize_t n = write(worker.in, data.data() + written, data.size() - written);
+        if (n > 0) {
+            written += n;
+            continue;
+        }
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            return false; // EPIPE if the worker exited
+        const int64_t remaining = deadline - GetTimeMillis();
+        if (remaining <= 0)
+            return false;
+        struct pollfd pfd{worker.in, POLLOUT, 0};
+        poll(&pfd, 1, static_cast<int>(remaining));
+    }
+    return true;
+#endif
+}
+
+bool PluginWorkerPool::readLine(Worker & worker, std::string & line, const int64_t deadline)
+{
+#ifdef WIN32
+    return false;
+#else
+    size_t searched{0};
+    char buf[4096];
+    while (true) {
+        const auto pos = worker.buffer.find('\n', searched);
+        if (pos != std::string::npos) {
+            line = worker.buffer.substr(0, pos);
+            worker.buffer.erase(0, pos + 1);
+            return true;
+        }
+        searched = worker.buffer.size();
+        if (worker.buffer.size() > MAX_WORKER_REPLY)
+            return false;
+
+        const ssize_t n = read(worker.out, buf, sizeof(buf));
+        if (n > 0) {
+            worker.buffer.append(buf, n);
+            continue;
+        }
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+            return false; // the worker exited
+        const int64_t remaining = deadline - GetTimeMillis();
+        if (remaining <= 0)
+            return false;
+        struct pollfd pfd{worker.out, POLLIN, 0};
+        poll(&pfd, 1, static_cast<int>(remaining));
+    }
+#endif
+}
+
+} // namespace xrouter
@@ -0,0 +1,68 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BLOCKNET_XROUTER_XROUTERWORKER_H
+#define BLOCKNET_XROUTER_XROUTERWORKER_H
+
+#include <sync.h>
+
+#include <condition_variable>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace xrouter
+{
+
+/**
+ * Long-lived processes serving a "worker" plugin. The command is started once per worker
+ * with /bin/sh -c, a worker reads one request per line on stdin and writes one reply per
+ * line on stdout. A worker serves one request at a time: up to maxWorkers requests run at
+ * once and the others wait for a free worker. Workers that time out, exit or break the
+ * protocol are killed and replaced on a later request.
+ */
+class PluginWorkerPool
+{
+public:
+    PluginWorkerPool(std::string command, const int maxWorkers);
+    ~PluginWorkerPool();
+
+    /**
+     * Sends the request line to a worker and returns its reply line. Throws XRouterError
+     * if no worker replied within timeout seconds, including the wait for a free worker.
+     * @param request must not contain a newline
+     * @param timeout
+     * @return reply without the newline
+     */
+    std::string call(const std::string & request, const int timeout);
+
+    const std::string & getCommand() const { return command; }
+    int getMaxWorkers() const { return maxWorkers; }
+
+private:
+    struct Worker {
+        int pid{-1};
+        int in{-1};  // worker's stdin
+        int out{-1}; // worker's stdout
+        std::string buffer; // bytes read past the last reply
+    };
+    typedef std::unique_ptr<Worker> WorkerPtr;
+
+    WorkerPtr spawn();
+    static void terminate(WorkerPtr & worker);
+    static bool writeAll(Worker & worker, const std::string & data, const int64_t deadline);
+    static bool readLine(Worker & worker, std::string & line, const int64_t deadline);
+
+private:
+    const std::string command;
+    const int maxWorkers;
+    Mutex mu;
+    std::condition_variable cond;
+    std::vector<WorkerPtr> idle GUARDED_BY(mu);
+    int busy GUARDED_BY(mu){0}; // workers serving a request, including ones being started
+};
+
+} // namespace xrouter
+
+#endif // BLOCKNET_XROUTER_XROUTERWORKER_H
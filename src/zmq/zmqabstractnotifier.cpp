@@ -21,3 +21,23 @@ bool CZMQAbstractNotifier::NotifyTransaction(const CTransaction &/*transaction*/
 {
     return true;
 }
+
+bool CZMQAbstractNotifier::NotifyXBridgeOrder(const xbridge::TransactionDescr &/*order*/, XBridgeOrderEvent /*event*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyProposal(const gov::Proposal &/*proposal*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyGovernanceVote(const gov::Vote &/*vote*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyServiceNode(const sn::ServiceNode &/*snode*/, sn::ServiceNodeEvent /*event*/)
+{
+    return true;
+}
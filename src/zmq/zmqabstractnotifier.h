@@ -9,6 +9,9 @@
 
 class CBlockIndex;
 class CZMQAbstractNotifier;
+namespace xbridge { struct TransactionDescr; }
+namespace gov { class Proposal; class Vote; }
+namespace sn { class ServiceNode; enum class ServiceNodeEvent : uint8_t; }
 
 typedef CZMQAbstractNotifier* (*CZMQNotifierFactory)();
 
@@ -43,6 +46,13 @@ public:
     virtual bool NotifyBlock(const CBlockIndex *pindex);
     virtual bool NotifyTransaction(const CTransaction &transaction);
 
+    enum XBridgeOrderEvent : uint8_t { XBRIDGE_ORDER_ADD = 0, XBRIDGE_ORDER_UPDATE, XBRIDGE_ORDER_CANCEL, XBRIDGE_ORDER_FILL };
+    virtual bool NotifyXBridgeOrder(const xbridge::TransactionDescr &order, XBridgeOrderEvent event);
+
+    virtual bool NotifyProposal(const gov::Proposal &proposal);
+    virtual bool NotifyGovernanceVote(const gov::Vote &vote);
+    virtual bool NotifyServiceNode(const sn::ServiceNode &snode, sn::ServiceNodeEvent event);
+
 protected:
     void *psocket;
     std::string type;
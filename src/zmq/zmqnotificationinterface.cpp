@@ -5,10 +5,14 @@
 #include <zmq/zmqnotificationinterface.h>
 #include <zmq/zmqpublishnotifier.h>
 
+#include <governance/governance.h>
+#include <servicenode/servicenodemgr.h>
 #include <version.h>
 #include <validation.h>
 #include <streams.h>
 #include <util/system.h>
+#include <xbridge/xbridgeapp.h>
+#include <xbridge/xbridgetransactiondescr.h>
 
 void zmqError(const char *str)
 {
@@ -48,6 +52,11 @@ CZMQNotificationInterface* CZMQNotificationInterface::Create()
     factories["pubhashtx"] = CZMQAbstractNotifier::Create<CZMQPublishHashTransactionNotifier>;
     factories["pubrawblock"] = CZMQAbstractNotifier::Create<CZMQPublishRawBlockNotifier>;
     factories["pubrawtx"] = CZMQAbstractNotifier::Create<CZMQPublishRawTransactionNotifier>;
+    factories["pubxbridgeorder"] = CZMQAbstractNotifier::Create<CZMQPublishXBridgeOrderNotifier>;
+    factories["pubxbridgetrade"] = CZMQAbstractNotifier::Create<CZMQPublishXBridgeTradeNotifier>;
+    factories["pubproposal"] = CZMQAbstractNotifier::Create<CZMQPublishProposalNotifier>;
+    factories["pubgovernancevote"] = CZMQAbstractNotifier::Create<CZMQPublishGovernanceVoteNotifier>;
+    factories["pubservicenode"] = CZMQAbstractNotifier::Create<CZMQPublishServiceNodeNotifier>;
 
     for (const auto& entry : factories)
     {
@@ -117,6 +126,17 @@ bool CZMQNotificationInterface::Initialize()
         return false;
     }
 
+    xbridgeOrderReceived = xuiConnector.NotifyXBridgeTransactionReceived.connect(
+            std::bind(&CZMQNotificationInterface::XBridgeOrderReceived, this, std::placeholders::_1));
+    xbridgeOrderChanged = xuiConnector.NotifyXBridgeTransactionChanged.connect(
+            std::bind(&CZMQNotificationInterface::XBridgeOrderChanged, this, std::placeholders::_1));
+    proposalAccepted = gov::Governance::instance().NotifyProposal.connect(
+            std::bind(&CZMQNotificationInterface::NotifyProposal, this, std::placeholders::_1));
+    voteAccepted = gov::Governance::instance().NotifyVote.connect(
+            std::bind(&CZMQNotificationInterface::NotifyGovernanceVote, this, std::placeholders::_1));
+    servicenodeChanged = sn::ServiceNodeMgr::instance().NotifyServiceNode.connect(
+            std::bind(&CZMQNotificationInterface::NotifyServiceNode, this, std::placeholders::_1, std::placeholders::_2));
+
     return true;
 }
 
@@ -124,6 +144,13 @@ bool CZMQNotificationInterface::Initialize()
 void CZMQNotificationInterface::Shutdown()
 {
     LogPrint(BCLog::ZMQ, "zmq: Shutdown notification interface\n");
+    xbridgeOrderReceived.disconnect();
+    xbridgeOrderChanged.disconnect();
+    proposalAccepted.disconnect();
+    voteAccepted.disconnect();
+    servicenodeChanged.disconnect();
+
+    LOCK(cs_notifiers);
     if (pcontext)
     {
         for (std::list<CZMQAbstractNotifier*>::iterator i=notifiers.begin(); i!=notifiers.end(); ++i)
@@ -143,6 +170,8 @@ void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindexNew, co
     if (fInitialDownload || pindexNew == pindexFork) // In IBD or blocks were disconnected without any new ones
         return;
 
+    LOCK(cs_notifiers);
+
     for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
     {
         CZMQAbstractNotifier *notifier = *i;
@@ -164,6 +193,8 @@ void CZMQNotificationInterface::TransactionAddedToMempool(const CTransactionRef&
     // all the same external callback.
     const CTransaction& tx = *ptx;
 
+    LOCK(cs_notifiers);
+
     for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
     {
         CZMQAbstractNotifier *notifier = *i;
@@ -195,4 +226,75 @@ void CZMQNotificationInterface::BlockDisconnected(const std::shared_ptr<const CB
     }
 }
 
+void CZMQNotificationInterface::XBridgeOrderReceived(const xbridge::TransactionDescrPtr& order)
+{
+    // Orders are received again on every rebroadcast, subscribers treat add as add or refresh
+    NotifyXBridgeOrder(*order, CZMQAbstractNotifier::XBRIDGE_ORDER_ADD);
+}
+
+void CZMQNotificationInterface::XBridgeOrderChanged(const uint256& id)
+{
+    const xbridge::TransactionDescrPtr order = xbridge::App::instance().transaction(id);
+    if (!order)
+        return;
+
+    CZMQAbstractNotifier::XBridgeOrderEvent event;
+    switch (order->state)
+    {
+    case xbridge::TransactionDescr::trFinished:
+        event = CZMQAbstractNotifier::XBRIDGE_ORDER_FILL;
+        break;
+    case xbridge::TransactionDescr::trExpired:
+    case xbridge::TransactionDescr::trRollback:
+    case xbridge::TransactionDescr::trRollbackFailed:
+    case xbridge::TransactionDescr::trDropped:
+    case xbridge::TransactionDescr::trCancelled:
+    case xbridge::TransactionDescr::trInvalid:
+        event = CZMQAbstractNotifier::XBRIDGE_ORDER_CANCEL;
+        break;
+    default:
+        event = CZMQAbstractNotifier::XBRIDGE_ORDER_UPDATE;
+        break;
+    }
+    NotifyXBridgeOrder(*order, event);
+}
+
+void CZMQNotificationInterface::NotifyXBridgeOrder(const xbridge::TransactionDescr& order, CZMQAbstractNotifier::XBridgeOrderEvent event)
+{
+    NotifyAll([&](CZMQAbstractNotifier* notifier) { return notifier->NotifyXBridgeOrder(order, event); });
+}
+
+void CZMQNotificationInterface::NotifyProposal(const gov::Proposal& proposal)
+{
+    NotifyAll([&](CZMQAbstractNotifier* notifier) { return notifier->NotifyProposal(proposal); });
+}
+
+void CZMQNotificationInterface::NotifyGovernanceVote(const gov::Vote& vote)
+{
+    NotifyAll([&](CZMQAbstractNotifier* notifier) { return notifier->NotifyGovernanceVote(vote); });
+}
+
+void CZMQNotificationInterface::NotifyServiceNode(const sn::ServiceNode& snode, sn::ServiceNodeEvent event)
+{
+    NotifyAll([&](CZMQAbstractNotifier* notifier) { return notifier->NotifyServiceNode(snode, event); });
+}
+
+void CZMQNotificationInterface::NotifyAll(const std::function<bool(CZMQAbstractNotifier*)>& notify)
+{
+    LOCK(cs_notifiers);
+    for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
+    {
+        CZMQAbstractNotifier *notifier = *i;
+        if (notify(notifier))
+        {
+            i++;
+        }
+        else
+        {
+            notifier->Shutdown();
+            i = notifiers.erase(i);
+        }
+    }
+}
+
 CZMQNotificationInterface* g_zmq_notification_interface = nullptr;
@@ -5,13 +5,16 @@
 #ifndef BITCOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
 #define BITCOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
 
+#include <sync.h>
 #include <validationinterface.h>
+#include <xbridge/xuiconnector.h>
+#include <zmq/zmqabstractnotifier.h>
+#include <functional>
 #include <string>
 #include <map>
 #include <list>
 
 class CBlockIndex;
-class CZMQAbstractNotifier;
 
 class CZMQNotificationInterface final : public CValidationInterface
 {
@@ -31,12 +34,33 @@ protected:
     void BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexConnected, const std::vector<CTransactionRef>& vtxConflicted) override;
     void BlockDisconnected(const std::shared_ptr<const CBlock>& pblock) override;
     void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) override;
+    std::string GetSubscriberName() const override { return "zmq"; }
 
 private:
     CZMQNotificationInterface();
 
+    // XBridge order events, connected to xuiConnector
+    void XBridgeOrderReceived(const xbridge::TransactionDescrPtr& order);
+    void XBridgeOrderChanged(const uint256& id);
+    void NotifyXBridgeOrder(const xbridge::TransactionDescr& order, CZMQAbstractNotifier::XBridgeOrderEvent event);
+
+    // Governance and servicenode events, connected to their managers
+    void NotifyProposal(const gov::Proposal& proposal);
+    void NotifyGovernanceVote(const gov::Vote& vote);
+    void NotifyServiceNode(const sn::ServiceNode& snode, sn::ServiceNodeEvent event);
+
+    // Calls notify on every notifier, shuts down and drops the notifiers that fail
+    void NotifyAll(const std::function<bool(CZMQAbstractNotifier*)>& notify);
+
     void *pcontext;
+    // xbridge notifications arrive from the xbridge threads, guards the notifiers and their sockets
+    CCriticalSection cs_notifiers;
     std::list<CZMQAbstractNotifier*> notifiers;
+    boost::signals2::connection xbridgeOrderReceived;
+    boost::signals2::connection xbridgeOrderChanged;
+    boost::signals2::connection proposalAccepted;
+    boost::signals2::connection voteAccepted;
+    boost::signals2::connection servicenodeChanged;
 };
 
 extern CZMQNotificationInterface* g_zmq_notification_interface;
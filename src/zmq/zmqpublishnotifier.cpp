@@ -4,11 +4,14 @@
 
 #include <chain.h>
 #include <chainparams.h>
+#include <governance/governance.h>
+#include <servicenode/servicenodemgr.h>
 #include <streams.h>
 #include <zmq/zmqpublishnotifier.h>
 #include <validation.h>
 #include <util/system.h>
 #include <rpc/server.h>
+#include <xbridge/xbridgetransactiondescr.h>
 
 static std::multimap<std::string, CZMQAbstractPublishNotifier*> mapPublishNotifiers;
 
@@ -16,6 +19,11 @@ static const char *MSG_HASHBLOCK = "hashblock";
 static const char *MSG_HASHTX    = "hashtx";
 static const char *MSG_RAWBLOCK  = "rawblock";
 static const char *MSG_RAWTX     = "rawtx";
+static const char *MSG_XBRIDGEORDER = "xbridgeorder";
+static const char *MSG_XBRIDGETRADE = "xbridgetrade";
+static const char *MSG_PROPOSAL = "proposal";
+static const char *MSG_GOVERNANCEVOTE = "governancevote";
+static const char *MSG_SERVICENODE = "servicenode";
 
 // Internal function to send multipart message
 static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
@@ -184,15 +192,14 @@ bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
     const Consensus::Params& consensusParams = Params().GetConsensus();
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
     {
-        LOCK(cs_main);
-        CBlock block;
-        if(!ReadBlockFromDisk(block, pindex, consensusParams))
+        const std::shared_ptr<const CBlock> pblock = ReadBlockFromDiskCached(pindex, consensusParams);
+        if (!pblock)
         {
             zmqError("Can't read block from disk");
             return false;
         }
 
-        ss << block;
+        ss << *pblock;
     }
 
     return SendMessage(MSG_RAWBLOCK, &(*ss.begin()), ss.size());
@@ -206,3 +213,61 @@ bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &tr
     ss << transaction;
     return SendMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
 }
+
+// Compact xbridge order event: event, id, state, maker, maker size, taker, taker size, updated at (ms since epoch)
+static void SerializeXBridgeOrder(CDataStream &ss, const xbridge::TransactionDescr &order, CZMQAbstractNotifier::XBridgeOrderEvent event)
+{
+    static const boost::posix_time::ptime epoch(boost::gregorian::date(1970, 1, 1));
+    ss << static_cast<uint8_t>(event)
+       << order.id
+       << static_cast<int32_t>(order.state)
+       << order.fromCurrency
+       << order.fromAmount
+       << order.toCurrency
+       << order.toAmount
+       << static_cast<int64_t>((order.txtime - epoch).total_milliseconds());
+}
+
+bool CZMQPublishXBridgeOrderNotifier::NotifyXBridgeOrder(const xbridge::TransactionDescr &order, XBridgeOrderEvent event)
+{
+    LogPrint(BCLog::ZMQ, "zmq: Publish xbridgeorder %s\n", order.id.GetHex());
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    SerializeXBridgeOrder(ss, order, event);
+    return SendMessage(MSG_XBRIDGEORDER, &(*ss.begin()), ss.size());
+}
+
+bool CZMQPublishXBridgeTradeNotifier::NotifyXBridgeOrder(const xbridge::TransactionDescr &order, XBridgeOrderEvent event)
+{
+    if (event != XBRIDGE_ORDER_FILL)
+        return true;
+    LogPrint(BCLog::ZMQ, "zmq: Publish xbridgetrade %s\n", order.id.GetHex());
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    SerializeXBridgeOrder(ss, order, event);
+    return SendMessage(MSG_XBRIDGETRADE, &(*ss.begin()), ss.size());
+}
+
+bool CZMQPublishProposalNotifier::NotifyProposal(const gov::Proposal &proposal)
+{
+    const uint256 hash = proposal.getHash();
+    LogPrint(BCLog::ZMQ, "zmq: Publish proposal %s\n", hash.GetHex());
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << hash << proposal;
+    return SendMessage(MSG_PROPOSAL, &(*ss.begin()), ss.size());
+}
+
+bool CZMQPublishGovernanceVoteNotifier::NotifyGovernanceVote(const gov::Vote &vote)
+{
+    const uint256 hash = vote.getHash();
+    LogPrint(BCLog::ZMQ, "zmq: Publish governancevote %s\n", hash.GetHex());
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << hash << vote;
+    return SendMessage(MSG_GOVERNANCEVOTE, &(*ss.begin()), ss.size());
+}
+
+bool CZMQPublishServiceNodeNotifier::NotifyServiceNode(const sn::ServiceNode &snode, sn::ServiceNodeEvent event)
+{
+    LogPrint(BCLog::ZMQ, "zmq: Publish servicenode %s\n", HexStr(snode.getSnodePubKey()));
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << static_cast<uint8_t>(event) << snode << snode.getPingTime();
+    return SendMessage(MSG_SERVICENODE, &(*ss.begin()), ss.size());
+}
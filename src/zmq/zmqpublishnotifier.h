@@ -52,4 +52,39 @@ public:
     bool NotifyTransaction(const CTransaction &transaction) override;
 };
 
+/** Publishes every add/update/cancel/fill of an xbridge order. */
+class CZMQPublishXBridgeOrderNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyXBridgeOrder(const xbridge::TransactionDescr &order, XBridgeOrderEvent event) override;
+};
+
+/** Publishes only the fills of xbridge orders. */
+class CZMQPublishXBridgeTradeNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyXBridgeOrder(const xbridge::TransactionDescr &order, XBridgeOrderEvent event) override;
+};
+
+/** Publishes the proposals accepted from connected blocks. */
+class CZMQPublishProposalNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyProposal(const gov::Proposal &proposal) override;
+};
+
+/** Publishes the votes accepted or changed by connected blocks. */
+class CZMQPublishGovernanceVoteNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyGovernanceVote(const gov::Vote &vote) override;
+};
+
+/** Publishes servicenode registrations, pings, invalidations and removals. */
+class CZMQPublishServiceNodeNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyServiceNode(const sn::ServiceNode &snode, sn::ServiceNodeEvent event) override;
+};
+
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H
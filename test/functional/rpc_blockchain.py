@@ -7,6 +7,7 @@
 Test the following RPCs:
     - getblockchaininfo
     - gettxoutsetinfo
+    - dumpsnapshot
     - getdifficulty
     - getbestblockhash
     - getblockhash
@@ -20,6 +21,7 @@ Tests correspond to code in rpc/blockchain.cpp.
 
 from decimal import Decimal
 import http.client
+import os
 import subprocess
 
 from test_framework.test_framework import BitcoinTestFramework
@@ -57,6 +59,7 @@ class BlockchainTest(BitcoinTestFramework):
         self._test_getblockchaininfo()
         self._test_getchaintxstats()
         self._test_gettxoutsetinfo()
+        self._test_dumpsnapshot()
         self._test_getblockheader()
         self._test_getdifficulty()
         self._test_getnetworkhashps()
@@ -214,6 +217,32 @@ class BlockchainTest(BitcoinTestFramework):
         del res['disk_size'], res3['disk_size']
         assert_equal(res, res3)
 
+        self.log.info("Test that gettxoutsetinfo() counts the same coins when they are read in parallel")
+        res4 = node.gettxoutsetinfo("muhash")
+        res5 = node.gettxoutsetinfo(hash_type="none")
+        assert_equal(len(res4['muhash']), 64)
+        assert 'muhash' not in res5 and 'hash_serialized_2' not in res5
+        for r in (res4, res5):
+            for key in ('height', 'bestblock', 'transactions', 'txouts', 'bogosize', 'total_amount'):
+                assert_equal(r[key], res[key])
+        assert_raises_rpc_error(-8, "foo is not a valid hash_type", node.gettxoutsetinfo, "foo")
+        assert_raises_rpc_error(-8, "Querying specific block heights requires coinstatsindex", node.gettxoutsetinfo, "muhash", 1)
+
+    def _test_dumpsnapshot(self):
+        node = self.nodes[0]
+
+        self.log.info("Test that dumpsnapshot writes the coins counted by gettxoutsetinfo")
+        res = node.dumpsnapshot('snapshot.dat')
+        stats = node.gettxoutsetinfo("muhash")
+        assert_equal(res['base_hash'], stats['bestblock'])
+        assert_equal(res['base_height'], stats['height'])
+        assert_equal(res['coins_written'], stats['txouts'])
+        assert_equal(res['muhash'], stats['muhash'])
+        assert_equal(res['stake_modifiers'], stats['height'] + 1)
+        assert os.path.isfile(res['path'])
+        assert not os.path.exists(res['path'] + '.incomplete')
+        assert_raises_rpc_error(-8, "already exists", node.dumpsnapshot, 'snapshot.dat')
+
     def _test_getblockheader(self):
         node = self.nodes[0]
 